@@ -101,6 +101,8 @@ class AstImpl : public Ast {
     return type_map_;
   }
 
+  absl::flat_hash_map<int64_t, Type>& type_map() { return type_map_; }
+
   absl::string_view expr_version() const { return expr_version_; }
 
   AstImpl DeepCopy() const;
@@ -17,9 +17,9 @@
 
 #include <vector>
 
-#include "absl/container/btree_set.h"
 #include "absl/types/span.h"
 #include "base/attribute.h"
+#include "base/internal/sorted_vector_set.h"
 
 namespace google::api::expr::runtime {
 class AttributeUtility;
@@ -36,7 +36,7 @@ class UnknownSet;
 // unknown during expression evaluation.
 class AttributeSet final {
  private:
-  using Container = absl::btree_set<Attribute>;
+  using Container = base_internal::SortedVectorSet<Attribute>;
 
  public:
   using value_type = typename Container::value_type;
@@ -50,26 +50,21 @@ class AttributeSet final {
   AttributeSet& operator=(const AttributeSet&) = default;
   AttributeSet& operator=(AttributeSet&&) = default;
 
-  explicit AttributeSet(absl::Span<const Attribute> attributes) {
-    for (const auto& attr : attributes) {
-      Add(attr);
-    }
-  }
+  explicit AttributeSet(absl::Span<const Attribute> attributes)
+      : attributes_(attributes) {}
 
   AttributeSet(const AttributeSet& set1, const AttributeSet& set2)
       : attributes_(set1.attributes_) {
-    for (const auto& attr : set2.attributes_) {
-      Add(attr);
-    }
+    attributes_.Merge(set2.attributes_);
   }
 
   iterator begin() const { return attributes_.begin(); }
 
-  const_iterator cbegin() const { return attributes_.cbegin(); }
+  const_iterator cbegin() const { return attributes_.begin(); }
 
   iterator end() const { return attributes_.end(); }
 
-  const_iterator cend() const { return attributes_.cend(); }
+  const_iterator cend() const { return attributes_.end(); }
 
   size_type size() const { return attributes_.size(); }
 
@@ -93,13 +88,9 @@ class AttributeSet final {
   friend class UnknownValue;
   friend class base_internal::UnknownSet;
 
-  void Add(const Attribute& attribute) { attributes_.insert(attribute); }
+  void Add(const Attribute& attribute) { attributes_.Insert(attribute); }
 
-  void Add(const AttributeSet& other) {
-    for (const auto& attribute : other) {
-      Add(attribute);
-    }
-  }
+  void Add(const AttributeSet& other) { attributes_.Merge(other.attributes_); }
 
   // Attribute container.
   Container attributes_;
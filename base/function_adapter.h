@@ -22,6 +22,8 @@
 
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/functional/bind_front.h"
@@ -198,23 +200,36 @@ template <typename T, typename U, typename V>
 class BinaryFunctionAdapter {
  public:
   using FunctionType = std::function<T(ValueFactory&, U, V)>;
+  using FunctionPointerType = T (*)(ValueFactory&, U, V);
 
   static std::unique_ptr<cel::Function> WrapFunction(FunctionType fn) {
-    return std::make_unique<BinaryFunctionImpl>(std::move(fn));
+    return std::make_unique<BinaryFunctionImpl<FunctionType>>(std::move(fn));
+  }
+
+  // Overload for plain functions with exactly the adapted signature, e.g.
+  // WrapFunction(&LessThan<int64_t>). The function is called through the
+  // pointer instead of a type-erased std::function.
+  template <typename F, typename = std::enable_if_t<
+                            std::is_same_v<F, FunctionPointerType>>>
+  static std::unique_ptr<cel::Function> WrapFunction(F fn) {
+    return std::make_unique<BinaryFunctionImpl<FunctionPointerType>>(fn);
   }
 
   static FunctionDescriptor CreateDescriptor(absl::string_view name,
                                              bool receiver_style,
-                                             bool is_strict = true) {
+                                             bool is_strict = true,
+                                             bool is_pure = false) {
     return FunctionDescriptor(
         name, receiver_style,
-        {internal::AdaptedKind<U>(), internal::AdaptedKind<V>()}, is_strict);
+        {internal::AdaptedKind<U>(), internal::AdaptedKind<V>()}, is_strict,
+        is_pure);
   }
 
  private:
+  template <typename Fn>
   class BinaryFunctionImpl : public cel::Function {
    public:
-    explicit BinaryFunctionImpl(FunctionType fn) : fn_(std::move(fn)) {}
+    explicit BinaryFunctionImpl(Fn fn) : fn_(std::move(fn)) {}
     absl::StatusOr<Handle<Value>> Invoke(
         const FunctionEvaluationContext& context,
         absl::Span<const Handle<Value>> args) const override {
@@ -237,7 +252,7 @@ class BinaryFunctionAdapter {
     }
 
    private:
-    BinaryFunctionAdapter::FunctionType fn_;
+    Fn fn_;
   };
 };
 
@@ -266,22 +281,35 @@ template <typename T, typename U>
 class UnaryFunctionAdapter {
  public:
   using FunctionType = std::function<T(ValueFactory&, U)>;
+  using FunctionPointerType = T (*)(ValueFactory&, U);
 
   static std::unique_ptr<cel::Function> WrapFunction(FunctionType fn) {
-    return std::make_unique<UnaryFunctionImpl>(std::move(fn));
+    return std::make_unique<UnaryFunctionImpl<FunctionType>>(std::move(fn));
+  }
+
+  // Overload for plain functions with exactly the adapted signature. The
+  // function is called through the pointer instead of a type-erased
+  // std::function.
+  template <typename F, typename = std::enable_if_t<
+                            std::is_same_v<F, FunctionPointerType>>>
+  static std::unique_ptr<cel::Function> WrapFunction(F fn) {
+    return std::make_unique<UnaryFunctionImpl<FunctionPointerType>>(fn);
   }
 
   static FunctionDescriptor CreateDescriptor(absl::string_view name,
                                              bool receiver_style,
-                                             bool is_strict = true) {
+                                             bool is_strict = true,
+                                             bool is_pure = false) {
     return FunctionDescriptor(name, receiver_style,
-                              {internal::AdaptedKind<U>()}, is_strict);
+                              {internal::AdaptedKind<U>()}, is_strict,
+                              is_pure);
   }
 
  private:
+  template <typename Fn>
   class UnaryFunctionImpl : public cel::Function {
    public:
-    explicit UnaryFunctionImpl(FunctionType fn) : fn_(std::move(fn)) {}
+    explicit UnaryFunctionImpl(Fn fn) : fn_(std::move(fn)) {}
     absl::StatusOr<Handle<Value>> Invoke(
         const FunctionEvaluationContext& context,
         absl::Span<const Handle<Value>> args) const override {
@@ -301,7 +329,7 @@ class UnaryFunctionAdapter {
     }
 
    private:
-    FunctionType fn_;
+    Fn fn_;
   };
 };
 
@@ -321,9 +349,11 @@ class VariadicFunctionAdapter {
 
   static FunctionDescriptor CreateDescriptor(absl::string_view name,
                                              bool receiver_style,
-                                             bool is_strict = true) {
+                                             bool is_strict = true,
+                                             bool is_pure = false) {
     return FunctionDescriptor(name, receiver_style,
-                              internal::KindAdder<Args...>::Kinds(), is_strict);
+                              internal::KindAdder<Args...>::Kinds(), is_strict,
+                              is_pure);
   }
 
  private:
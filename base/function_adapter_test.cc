@@ -37,6 +37,7 @@
 #include "base/values/double_value.h"
 #include "base/values/duration_value.h"
 #include "base/values/int_value.h"
+#include "base/values/string_value.h"
 #include "base/values/timestamp_value.h"
 #include "base/values/uint_value.h"
 #include "internal/testing.h"
@@ -584,6 +585,42 @@ TEST_F(FunctionAdapterTest, BinaryFunctionAdapterWrapFunctionPropagateStatus) {
               StatusIs(absl::StatusCode::kInternal, "test_error"));
 }
 
+bool IntLessThan(ValueFactory&, int64_t x, int64_t y) { return x < y; }
+
+bool StringLessThan(ValueFactory&, const Handle<StringValue>& x,
+                    const Handle<StringValue>& y) {
+  return x->Compare(*y) < 0;
+}
+
+TEST_F(FunctionAdapterTest, BinaryFunctionAdapterWrapFunctionPointer) {
+  std::unique_ptr<Function> wrapped =
+      BinaryFunctionAdapter<bool, int64_t, int64_t>::WrapFunction(
+          &IntLessThan);
+
+  std::vector<Handle<Value>> args{value_factory().CreateIntValue(1),
+                                  value_factory().CreateIntValue(2)};
+  ASSERT_OK_AND_ASSIGN(auto result, wrapped->Invoke(test_context(), args));
+  ASSERT_TRUE(result->Is<BoolValue>());
+  EXPECT_TRUE(result.As<BoolValue>()->NativeValue());
+
+  wrapped = BinaryFunctionAdapter<bool, const Handle<StringValue>&,
+                                  const Handle<StringValue>&>::
+      WrapFunction(&StringLessThan);
+  args.clear();
+  ASSERT_OK_AND_ASSIGN(args.emplace_back(),
+                       value_factory().CreateStringValue("b"));
+  ASSERT_OK_AND_ASSIGN(args.emplace_back(),
+                       value_factory().CreateStringValue("a"));
+  ASSERT_OK_AND_ASSIGN(result, wrapped->Invoke(test_context(), args));
+  ASSERT_TRUE(result->Is<BoolValue>());
+  EXPECT_FALSE(result.As<BoolValue>()->NativeValue());
+
+  args[0] = value_factory().CreateIntValue(1);
+  EXPECT_THAT(wrapped->Invoke(test_context(), args),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("expected string value")));
+}
+
 TEST_F(FunctionAdapterTest,
        BinaryFunctionAdapterWrapFunctionWrongArgCountError) {
   using FunctionAdapter =
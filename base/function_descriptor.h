@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_FUNCTION_DESCRIPTOR_H_
 #define THIRD_PARTY_CEL_CPP_BASE_FUNCTION_DESCRIPTOR_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -30,9 +31,10 @@ namespace cel {
 class FunctionDescriptor final {
  public:
   FunctionDescriptor(absl::string_view name, bool receiver_style,
-                     std::vector<Kind> types, bool is_strict = true)
+                     std::vector<Kind> types, bool is_strict = true,
+                     bool is_pure = false, int64_t cost = 1)
       : impl_(std::make_shared<Impl>(name, receiver_style, std::move(types),
-                                     is_strict)) {}
+                                     is_strict, is_pure, cost)) {}
 
   // Function name.
   const std::string& name() const { return impl_->name; }
@@ -50,6 +52,16 @@ class FunctionDescriptor final {
   // receive error or unknown values as arguments.
   bool is_strict() const { return impl_->is_strict; }
 
+  // if true, the function has no side effects and its result only depends on
+  // its arguments, so results may be reused across calls (see
+  // RuntimeOptions::function_result_cache). Defaults to false.
+  bool is_pure() const { return impl_->is_pure; }
+
+  // Cost charged for each call of the function towards
+  // RuntimeOptions::max_evaluation_cost, e.g. higher for functions making
+  // RPCs or scanning large values. Defaults to 1.
+  int64_t cost() const { return impl_->cost; }
+
   // Helper for matching a descriptor. This tests that the shape is the same --
   // |other| accepts the same number and types of arguments and is the same call
   // style).
@@ -65,16 +77,20 @@ class FunctionDescriptor final {
  private:
   struct Impl final {
     Impl(absl::string_view name, bool receiver_style, std::vector<Kind> types,
-         bool is_strict)
+         bool is_strict, bool is_pure, int64_t cost)
         : name(name),
           types(std::move(types)),
           receiver_style(receiver_style),
-          is_strict(is_strict) {}
+          is_strict(is_strict),
+          is_pure(is_pure),
+          cost(cost) {}
 
     std::string name;
     std::vector<Kind> types;
     bool receiver_style;
     bool is_strict;
+    bool is_pure;
+    int64_t cost;
   };
 
   std::shared_ptr<const Impl> impl_;
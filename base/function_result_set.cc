@@ -20,9 +20,7 @@ namespace cel {
 FunctionResultSet::FunctionResultSet(const FunctionResultSet& lhs,
                                      const FunctionResultSet& rhs)
     : function_results_(lhs.function_results_) {
-  for (const auto& function_result : rhs) {
-    function_results_.insert(function_result);
-  }
+  function_results_.Merge(rhs.function_results_);
 }
 
 }  // namespace cel
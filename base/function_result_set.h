@@ -18,8 +18,9 @@
 #include <initializer_list>
 #include <utility>
 
-#include "absl/container/btree_set.h"
+#include "absl/types/span.h"
 #include "base/function_result.h"
+#include "base/internal/sorted_vector_set.h"
 
 namespace google::api::expr::runtime {
 class AttributeUtility;
@@ -38,7 +39,7 @@ class UnknownSet;
 // Set semantics use |IsEqualTo()| defined on |FunctionResult|.
 class FunctionResultSet final {
  private:
-  using Container = absl::btree_set<FunctionResult>;
+  using Container = base_internal::SortedVectorSet<FunctionResult>;
 
  public:
   using value_type = typename Container::value_type;
@@ -56,19 +57,20 @@ class FunctionResultSet final {
   FunctionResultSet(const FunctionResultSet& lhs, const FunctionResultSet& rhs);
 
   // Initialize with a single FunctionResult.
-  explicit FunctionResultSet(FunctionResult initial)
-      : function_results_{std::move(initial)} {}
+  explicit FunctionResultSet(FunctionResult initial) {
+    function_results_.Insert(initial);
+  }
 
   FunctionResultSet(std::initializer_list<FunctionResult> il)
-      : function_results_(il) {}
+      : function_results_(absl::MakeConstSpan(il.begin(), il.size())) {}
 
   iterator begin() const { return function_results_.begin(); }
 
-  const_iterator cbegin() const { return function_results_.cbegin(); }
+  const_iterator cbegin() const { return function_results_.begin(); }
 
   iterator end() const { return function_results_.end(); }
 
-  const_iterator cend() const { return function_results_.cend(); }
+  const_iterator cend() const { return function_results_.end(); }
 
   size_type size() const { return function_results_.size(); }
 
@@ -88,13 +90,11 @@ class FunctionResultSet final {
   friend class base_internal::UnknownSet;
 
   void Add(const FunctionResult& function_result) {
-    function_results_.insert(function_result);
+    function_results_.Insert(function_result);
   }
 
   void Add(const FunctionResultSet& other) {
-    for (const auto& function_result : other) {
-      Add(function_result);
-    }
+    function_results_.Merge(other.function_results_);
   }
 
   Container function_results_;
@@ -0,0 +1,136 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_BASE_INTERNAL_SORTED_VECTOR_SET_H_
+#define THIRD_PARTY_CEL_CPP_BASE_INTERNAL_SORTED_VECTOR_SET_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace cel::base_internal {
+
+// Ordered set backed by a sorted vector, which is shared between copies until
+// one of them is modified (copy-on-write). Elements are ordered and considered
+// equivalent by `operator<`, as with `absl::btree_set`.
+//
+// Used for the attribute and function result sets of unknowns. These are
+// usually tiny and are mostly copied and merged, so copies share the
+// elements, and merges walk both sets once. Merging with an empty set or a
+// subset copies nothing.
+template <typename T>
+class SortedVectorSet final {
+ private:
+  using Container = std::vector<T>;
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using iterator = typename Container::const_iterator;
+  using const_iterator = typename Container::const_iterator;
+
+  SortedVectorSet() = default;
+  SortedVectorSet(const SortedVectorSet&) = default;
+  SortedVectorSet(SortedVectorSet&&) = default;
+  SortedVectorSet& operator=(const SortedVectorSet&) = default;
+  SortedVectorSet& operator=(SortedVectorSet&&) = default;
+
+  explicit SortedVectorSet(absl::Span<const T> values) {
+    if (values.empty()) {
+      return;
+    }
+    Container sorted(values.begin(), values.end());
+    std::stable_sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), Equivalent),
+                 sorted.end());
+    values_ = std::make_shared<Container>(std::move(sorted));
+  }
+
+  iterator begin() const { return values().begin(); }
+
+  iterator end() const { return values().end(); }
+
+  size_type size() const { return values_ == nullptr ? 0 : values_->size(); }
+
+  bool empty() const { return size() == 0; }
+
+  bool operator==(const SortedVectorSet& other) const {
+    return values_ == other.values_ ||
+           (size() == other.size() &&
+            std::equal(begin(), end(), other.begin()));
+  }
+
+  bool operator!=(const SortedVectorSet& other) const {
+    return !operator==(other);
+  }
+
+  // Inserts `value` unless an equivalent element is present.
+  void Insert(const T& value) {
+    auto it = std::lower_bound(begin(), end(), value);
+    if (it != end() && !(value < *it)) {
+      return;
+    }
+    size_t index = static_cast<size_t>(std::distance(begin(), it));
+    if (values_ != nullptr && values_.use_count() == 1) {
+      // Not shared, so insert in place.
+      values_->insert(values_->begin() + index, value);
+      return;
+    }
+    Container values;
+    values.reserve(size() + 1);
+    values.insert(values.end(), begin(), begin() + index);
+    values.push_back(value);
+    values.insert(values.end(), begin() + index, end());
+    values_ = std::make_shared<Container>(std::move(values));
+  }
+
+  // Inserts the elements of `other` which are not present.
+  void Merge(const SortedVectorSet& other) {
+    if (other.empty() || values_ == other.values_ ||
+        std::includes(begin(), end(), other.begin(), other.end())) {
+      return;
+    }
+    if (std::includes(other.begin(), other.end(), begin(), end())) {
+      values_ = other.values_;
+      return;
+    }
+    Container values;
+    values.reserve(size() + other.size());
+    std::set_union(begin(), end(), other.begin(), other.end(),
+                   std::back_inserter(values));
+    values_ = std::make_shared<Container>(std::move(values));
+  }
+
+ private:
+  static bool Equivalent(const T& lhs, const T& rhs) {
+    return !(lhs < rhs) && !(rhs < lhs);
+  }
+
+  const Container& values() const {
+    static const Container* const kEmpty = new Container();
+    return values_ == nullptr ? *kEmpty : *values_;
+  }
+
+  // Null while empty. Only modified in place while not shared.
+  std::shared_ptr<Container> values_;
+};
+
+}  // namespace cel::base_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_BASE_INTERNAL_SORTED_VECTOR_SET_H_
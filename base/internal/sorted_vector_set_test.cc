@@ -0,0 +1,75 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/internal/sorted_vector_set.h"
+
+#include <vector>
+
+#include "internal/testing.h"
+
+namespace cel::base_internal {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(SortedVectorSet, Construct) {
+  SortedVectorSet<int> set(std::vector<int>{3, 1, 2, 3, 1});
+  EXPECT_THAT(set, ElementsAre(1, 2, 3));
+  EXPECT_THAT(SortedVectorSet<int>(), IsEmpty());
+}
+
+TEST(SortedVectorSet, InsertDoesNotModifyCopies) {
+  SortedVectorSet<int> set(std::vector<int>{1, 3});
+  SortedVectorSet<int> copy = set;
+  copy.Insert(2);
+  copy.Insert(2);
+  copy.Insert(0);
+  EXPECT_THAT(set, ElementsAre(1, 3));
+  EXPECT_THAT(copy, ElementsAre(0, 1, 2, 3));
+}
+
+TEST(SortedVectorSet, Merge) {
+  SortedVectorSet<int> set(std::vector<int>{1, 4});
+  SortedVectorSet<int> other(std::vector<int>{2, 4, 5});
+  set.Merge(other);
+  EXPECT_THAT(set, ElementsAre(1, 2, 4, 5));
+  EXPECT_THAT(other, ElementsAre(2, 4, 5));
+
+  // Merging a subset or superset results in equal sets.
+  SortedVectorSet<int> subset(std::vector<int>{2, 5});
+  subset.Merge(set);
+  EXPECT_EQ(subset, set);
+  set.Merge(other);
+  EXPECT_THAT(set, ElementsAre(1, 2, 4, 5));
+
+  SortedVectorSet<int> empty;
+  empty.Merge(other);
+  EXPECT_EQ(empty, other);
+  // The merged set is shared, so modifying it must not modify the other.
+  empty.Insert(0);
+  EXPECT_THAT(empty, ElementsAre(0, 2, 4, 5));
+  EXPECT_THAT(other, ElementsAre(2, 4, 5));
+}
+
+TEST(SortedVectorSet, Equality) {
+  EXPECT_EQ(SortedVectorSet<int>(std::vector<int>{2, 1}),
+            SortedVectorSet<int>(std::vector<int>{1, 2}));
+  EXPECT_NE(SortedVectorSet<int>(std::vector<int>{1}),
+            SortedVectorSet<int>(std::vector<int>{1, 2}));
+  EXPECT_EQ(SortedVectorSet<int>(), SortedVectorSet<int>());
+}
+
+}  // namespace
+}  // namespace cel::base_internal
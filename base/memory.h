@@ -26,7 +26,10 @@
 #include "base/handle.h"
 #include "base/internal/data.h"
 #include "base/internal/memory_manager.h"
+#include "common/allocation_observer.h"
 #include "common/memory.h"  // IWYU pragma: export
+#include "common/type_kind.h"
+#include "common/value_kind.h"
 
 namespace cel {
 
@@ -158,6 +161,44 @@ class Allocator {
 
 namespace base_internal {
 
+template <typename F, typename = void>
+struct AllocationCategoryOf {
+  static constexpr AllocationCategory value = AllocationCategory::kOther;
+};
+
+template <typename F>
+struct AllocationCategoryOf<F, std::void_t<decltype(F::kKind)>> {
+  static constexpr AllocationCategory Get() {
+    using K = std::decay_t<decltype(F::kKind)>;
+    if constexpr (std::is_same_v<K, TypeKind>) {
+      return AllocationCategory::kType;
+    } else if constexpr (std::is_same_v<K, ValueKind>) {
+      switch (F::kKind) {
+        case ValueKind::kString:
+          return AllocationCategory::kString;
+        case ValueKind::kBytes:
+          return AllocationCategory::kBytes;
+        case ValueKind::kList:
+          return AllocationCategory::kList;
+        case ValueKind::kMap:
+          return AllocationCategory::kMap;
+        case ValueKind::kStruct:
+          return AllocationCategory::kStruct;
+        case ValueKind::kError:
+          return AllocationCategory::kError;
+        case ValueKind::kType:
+          return AllocationCategory::kType;
+        default:
+          return AllocationCategory::kOther;
+      }
+    } else {
+      return AllocationCategory::kOther;
+    }
+  }
+
+  static constexpr AllocationCategory value = Get();
+};
+
 template <typename T>
 template <typename F, typename... Args>
 std::enable_if_t<IsDerivedHeapDataV<F>, Handle<T>> HandleFactory<T>::Make(
@@ -169,6 +210,10 @@ std::enable_if_t<IsDerivedHeapDataV<F>, Handle<T>> HandleFactory<T>::Make(
   static_assert(std::is_pointer_interconvertible_base_of_v<Data, F>,
                 "F must be pointer interconvertible to Data");
 #endif
+  if (common_internal::AllocationObservers::Enabled()) {
+    common_internal::AllocationObservers::Notify(
+        memory_manager, AllocationCategoryOf<F>::value, sizeof(F));
+  }
   if (memory_manager.memory_management() == MemoryManagement::kPooling) {
     void* addr;
     if (memory_manager.pointer_ == nullptr) {
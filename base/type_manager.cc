@@ -14,6 +14,7 @@
 
 #include "base/type_manager.h"
 
+#include <atomic>
 #include <utility>
 
 #include "absl/base/macros.h"
@@ -37,6 +38,7 @@ absl::StatusOr<absl::optional<Handle<Type>>> TypeManager::ResolveType(
       return existing->second;
     }
   }
+  cache_misses_.fetch_add(1, std::memory_order_relaxed);
   // Check for builtin types.
   TypeProvider& builtin_type_provider = TypeProvider::Builtin();
   {
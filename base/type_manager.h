@@ -15,6 +15,9 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_TYPE_MANAGER_H_
 #define THIRD_PARTY_CEL_CPP_BASE_TYPE_MANAGER_H_
 
+#include <atomic>
+#include <cstdint>
+
 #include "absl/base/attributes.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
@@ -49,6 +52,11 @@ class TypeManager final {
   absl::StatusOr<absl::optional<Handle<Type>>> ResolveType(
       absl::string_view name);
 
+  // Returns how many calls to ResolveType did not find the name in the cache.
+  int64_t cache_misses() const {
+    return cache_misses_.load(std::memory_order_relaxed);
+  }
+
  private:
   Handle<Type> CacheType(absl::string_view name, Handle<Type>&& type);
 
@@ -62,6 +70,7 @@ class TypeManager final {
   // std::string as the key because we also cache types which do not exist.
   absl::flat_hash_map<absl::string_view, Handle<Type>> types_
       ABSL_GUARDED_BY(mutex_);
+  std::atomic<int64_t> cache_misses_ = 0;
 };
 
 }  // namespace cel
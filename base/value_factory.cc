@@ -152,6 +152,19 @@ absl::StatusOr<Handle<StringValue>> ValueFactory::CreateStringValue(
                                                              std::move(value));
 }
 
+absl::StatusOr<Handle<StringValue>> ValueFactory::CreateUnownedStringValue(
+    absl::string_view value) {
+  if (value.empty()) {
+    return GetEmptyStringValue();
+  }
+  auto [count, ok] = internal::Utf8Validate(value);
+  if (ABSL_PREDICT_FALSE(!ok)) {
+    return absl::InvalidArgumentError(
+        "Illegal byte sequence in UTF-8 encoded string");
+  }
+  return HandleFactory<StringValue>::Make<InlinedStringViewStringValue>(value);
+}
+
 Handle<StringValue> ValueFactory::CreateUncheckedStringValue(
     std::string value) {
   // Avoid persisting empty strings which may have underlying storage after
@@ -181,6 +181,19 @@ class ValueFactory final {
     return CreateMemberBytesValue(value, pointer);
   }
 
+  // Create a bytes value which refers to `value` without copying it. The
+  // caller must ensure `value` outlives the returned value and any value
+  // derived from it, e.g. request data which is kept alive until evaluation
+  // results are discarded.
+  Handle<BytesValue> CreateUnownedBytesValue(absl::string_view value)
+      ABSL_ATTRIBUTE_LIFETIME_BOUND {
+    if (value.empty()) {
+      return GetEmptyBytesValue();
+    }
+    return base_internal::HandleFactory<BytesValue>::Make<
+        base_internal::InlinedStringViewBytesValue>(value);
+  }
+
   Handle<StringValue> GetStringValue() ABSL_ATTRIBUTE_LIFETIME_BOUND {
     return GetEmptyStringValue();
   }
@@ -235,6 +248,12 @@ class ValueFactory final {
     return CreateMemberStringValue(value, pointer);
   }
 
+  // Create a string value which refers to `value` without copying it. The
+  // same lifetime requirements as for `CreateUnownedBytesValue` apply. `value`
+  // is validated to be UTF-8.
+  absl::StatusOr<Handle<StringValue>> CreateUnownedStringValue(
+      absl::string_view value) ABSL_ATTRIBUTE_LIFETIME_BOUND;
+
   absl::StatusOr<Handle<DurationValue>> CreateDurationValue(
       absl::Duration value) ABSL_ATTRIBUTE_LIFETIME_BOUND;
 
@@ -14,9 +14,12 @@
 
 #include "base/value_factory.h"
 
+#include <string>
+
 #include "absl/status/status.h"
 #include "base/memory.h"
 #include "base/testing/value_matchers.h"
+#include "common/allocation_observer.h"
 #include "internal/testing.h"
 
 namespace cel {
@@ -45,6 +48,51 @@ TEST(ValueFactory, CreateStringValueIllegalByteSequence) {
               StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+TEST(ValueFactory, AllocationObserver) {
+  auto pooling = NewThreadCompatiblePoolingMemoryManager();
+  for (MemoryManagerRef memory_manager :
+       {MemoryManagerRef::ReferenceCounting(), MemoryManagerRef(*pooling)}) {
+    TypeFactory type_factory(memory_manager);
+    TypeManager type_manager(type_factory, TypeProvider::Builtin());
+    ValueFactory value_factory(type_manager);
+    AllocationRecorder recorder;
+    {
+      ScopedAllocationObserver scope(memory_manager, recorder);
+      auto string_value = value_factory.CreateUncheckedStringValue(
+          std::string("a string long enough to be allocated"));
+      ASSERT_OK_AND_ASSIGN(auto bytes_value,
+                           value_factory.CreateBytesValue(std::string("ab")));
+      // Unowned values reference the caller's data.
+      auto unowned_value = value_factory.CreateUnownedBytesValue("ab");
+    }
+    EXPECT_EQ(recorder.stats(AllocationCategory::kString).count, 1);
+    EXPECT_EQ(recorder.stats(AllocationCategory::kBytes).count, 1);
+    EXPECT_GT(recorder.stats(AllocationCategory::kString).bytes, 0);
+    EXPECT_EQ(recorder.count(), 2);
+  }
+}
+
+TEST(ValueFactory, CreateUnownedValues) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  std::string request_data = "request data";
+
+  ASSERT_OK_AND_ASSIGN(auto string_value,
+                       value_factory.CreateUnownedStringValue(request_data));
+  EXPECT_EQ(string_value->ToString(), "request data");
+  auto bytes_value = value_factory.CreateUnownedBytesValue(request_data);
+  EXPECT_EQ(bytes_value->ToString(), "request data");
+
+  // The values refer to the caller's buffer.
+  request_data[0] = 'R';
+  EXPECT_EQ(string_value->ToString(), "Request data");
+  EXPECT_EQ(bytes_value->ToString(), "Request data");
+
+  EXPECT_THAT(value_factory.CreateUnownedStringValue("\xff"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST(ValueFactory, JsonNull) {
   TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
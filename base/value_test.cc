@@ -30,9 +30,11 @@
 
 #include "absl/base/macros.h"
 #include "absl/base/nullability.h"
+#include "absl/hash/hash.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
+#include "absl/strings/cord_test_helpers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
@@ -1618,6 +1620,24 @@ TEST_P(ValueTest, StringFromExternal) {
   EXPECT_NE(one_value, zero_value);
 }
 
+TEST_P(ValueTest, StringHash) {
+  TypeFactory type_factory(memory_manager());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  std::string contents = "a string long enough to not be trivially hashed";
+  size_t hash = absl::HashOf(contents);
+  auto heap_value = Must(value_factory.CreateStringValue(contents));
+  EXPECT_EQ(heap_value->Hash(), hash);
+  // The second call is answered from the cache.
+  EXPECT_EQ(heap_value->Hash(), hash);
+  EXPECT_EQ(Must(value_factory.CreateStringValue(absl::Cord(contents)))->Hash(),
+            hash);
+  EXPECT_EQ(Must(value_factory.CreateUnownedStringValue(contents))->Hash(),
+            hash);
+  EXPECT_EQ(value_factory.GetStringValue()->Hash(),
+            absl::HashOf(absl::string_view()));
+}
+
 TEST_P(ValueTest, Type) {
   TypeFactory type_factory(memory_manager());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
@@ -2173,6 +2193,54 @@ INSTANTIATE_TEST_SUITE_P(
                          {"foo", "bar", false},
                      })));
 
+struct StringSubstringTestCase final {
+  std::string subject;
+  std::string substr;
+  bool starts_with;
+  bool ends_with;
+  bool contains;
+};
+
+using StringSubstringTest = BaseValueTest<StringSubstringTestCase>;
+
+TEST_P(StringSubstringTest, Substring) {
+  TypeFactory type_factory(memory_manager());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  // One byte per chunk, so that matches span chunk boundaries.
+  std::vector<std::string> fragments;
+  for (char c : test_case().subject) {
+    fragments.push_back(std::string(1, c));
+  }
+  for (const auto& subject :
+       {MakeStringString(value_factory, test_case().subject),
+        MakeCordString(value_factory, test_case().subject),
+        Must(value_factory.CreateStringValue(
+            absl::MakeFragmentedCord(fragments)))}) {
+    EXPECT_EQ(subject->StartsWith(test_case().substr),
+              test_case().starts_with);
+    EXPECT_EQ(subject->EndsWith(test_case().substr), test_case().ends_with);
+    EXPECT_EQ(subject->Contains(test_case().substr), test_case().contains);
+    EXPECT_EQ(
+        subject->Contains(*MakeCordString(value_factory, test_case().substr)),
+        test_case().contains);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    StringSubstringTest, StringSubstringTest,
+    testing::Combine(base_internal::MemoryManagerTestModeAll(),
+                     testing::ValuesIn<StringSubstringTestCase>({
+                         {"", "", true, true, true},
+                         {"foo", "", true, true, true},
+                         {"foobar", "foo", true, false, true},
+                         {"foobar", "bar", false, true, true},
+                         {"foobar", "oba", false, false, true},
+                         {"foobar", "obo", false, false, false},
+                         {"foobar", "foobarbaz", false, false, false},
+                         {"aaab", "aab", false, true, true},
+                     })));
+
 struct StringSizeTestCase final {
   std::string data;
   size_t size;
@@ -2184,8 +2252,10 @@ TEST_P(StringSizeTest, Size) {
   TypeFactory type_factory(memory_manager());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
   ValueFactory value_factory(type_manager);
-  EXPECT_EQ(MakeStringString(value_factory, test_case().data)->Size(),
-            test_case().size);
+  auto heap_value = MakeStringString(value_factory, test_case().data);
+  EXPECT_EQ(heap_value->Size(), test_case().size);
+  // The second call is answered from the cache.
+  EXPECT_EQ(heap_value->Size(), test_case().size);
   EXPECT_EQ(MakeCordString(value_factory, test_case().data)->Size(),
             test_case().size);
   EXPECT_EQ(MakeExternalString(value_factory, test_case().data)->Size(),
@@ -2200,6 +2270,8 @@ INSTANTIATE_TEST_SUITE_P(
                          {"1", 1},
                          {"foo", 3},
                          {"\xef\xbf\xbd", 1},
+                         {"a string long enough to be allocated \xef\xbf\xbd",
+                          38},
                      })));
 
 struct StringEmptyTestCase final {
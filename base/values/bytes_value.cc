@@ -85,6 +85,10 @@ struct EmptyVisitor final {
 };
 
 bool EqualsImpl(absl::string_view lhs, absl::string_view rhs) {
+  if (lhs.data() == rhs.data()) {
+    // Same storage, e.g. interned constants (see cel::ConstantPool).
+    return lhs.size() == rhs.size();
+  }
   return lhs == rhs;
 }
 
@@ -335,11 +335,29 @@ class StaticListValue final : public AbstractListValue {
   using value_traits = ValueTraits<T>;
   using underlying_type = typename value_traits::underlying_type;
 
+  static bool Is(const Value& value) {
+    return AbstractListValue::Is(value) &&
+           GetListValueTypeId(static_cast<const ListValue&>(value)) ==
+               NativeTypeId::For<StaticListValue<T>>();
+  }
+
+  static const StaticListValue& Cast(const Value& value) {
+    ABSL_ASSERT(Is(value));
+    return static_cast<const StaticListValue&>(value);
+  }
+
   StaticListValue(
       Handle<ListType> type,
       std::vector<underlying_type, Allocator<underlying_type>> storage)
       : AbstractListValue(std::move(type)), storage_(std::move(storage)) {}
 
+  // The natively stored elements, which may be scanned without creating a
+  // handle per element.
+  const std::vector<underlying_type, Allocator<underlying_type>>&
+  NativeValues() const {
+    return storage_;
+  }
+
   std::string DebugString() const override {
     size_t count = Size();
     std::string out;
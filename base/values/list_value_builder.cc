@@ -14,10 +14,24 @@
 
 #include "base/values/list_value_builder.h"
 
+#include <cstdint>
+#include <string>
+
+#include "absl/base/casts.h"
 #include "absl/base/optimization.h"
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
 #include "base/kind.h"
 #include "base/type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/null_value.h"
+#include "base/values/uint_value.h"
+#include "internal/number.h"
 
 namespace cel::base_internal {
 
@@ -35,4 +49,85 @@ absl::Status CheckListElement(const Type& expected_type, const Value& value) {
   return absl::OkStatus();
 }
 
+absl::optional<CompactScalar> CompactScalar::From(const Value& value) {
+  switch (value.kind()) {
+    case ValueKind::kNullType:
+      return Null();
+    case ValueKind::kBool:
+      return Bool(value.As<BoolValue>().NativeValue());
+    case ValueKind::kInt:
+      return Int(value.As<IntValue>().NativeValue());
+    case ValueKind::kUint:
+      return Uint(value.As<UintValue>().NativeValue());
+    case ValueKind::kDouble:
+      return Double(value.As<DoubleValue>().NativeValue());
+    default:
+      return absl::nullopt;
+  }
+}
+
+namespace {
+
+absl::optional<internal::Number> AsNumber(ValueKind kind, uint64_t bits) {
+  switch (kind) {
+    case ValueKind::kInt:
+      return internal::Number::FromInt64(absl::bit_cast<int64_t>(bits));
+    case ValueKind::kUint:
+      return internal::Number::FromUint64(bits);
+    case ValueKind::kDouble:
+      return internal::Number::FromDouble(absl::bit_cast<double>(bits));
+    default:
+      return absl::nullopt;
+  }
+}
+
+}  // namespace
+
+bool CompactScalar::Equals(const CompactScalar& other,
+                           bool heterogeneous) const {
+  if (kind_ != other.kind_) {
+    if (!heterogeneous) {
+      return false;
+    }
+    absl::optional<internal::Number> lhs = AsNumber(kind_, bits_);
+    absl::optional<internal::Number> rhs = AsNumber(other.kind_, other.bits_);
+    return lhs.has_value() && rhs.has_value() && *lhs == *rhs;
+  }
+  if (kind_ == ValueKind::kDouble) {
+    // Not a bitwise comparison: NaN is not equal to itself, 0.0 == -0.0.
+    return absl::bit_cast<double>(bits_) == absl::bit_cast<double>(other.bits_);
+  }
+  return bits_ == other.bits_;
+}
+
+Handle<Value> CompactScalar::ToHandle(ValueFactory& value_factory) const {
+  switch (kind_) {
+    case ValueKind::kBool:
+      return value_factory.CreateBoolValue(bits_ != 0);
+    case ValueKind::kInt:
+      return value_factory.CreateIntValue(absl::bit_cast<int64_t>(bits_));
+    case ValueKind::kUint:
+      return value_factory.CreateUintValue(bits_);
+    case ValueKind::kDouble:
+      return value_factory.CreateDoubleValue(absl::bit_cast<double>(bits_));
+    default:
+      return value_factory.GetNullValue();
+  }
+}
+
+std::string CompactScalar::DebugString() const {
+  switch (kind_) {
+    case ValueKind::kBool:
+      return BoolValue::DebugString(bits_ != 0);
+    case ValueKind::kInt:
+      return IntValue::DebugString(absl::bit_cast<int64_t>(bits_));
+    case ValueKind::kUint:
+      return UintValue::DebugString(bits_);
+    case ValueKind::kDouble:
+      return DoubleValue::DebugString(absl::bit_cast<double>(bits_));
+    default:
+      return NullValue::DebugString();
+  }
+}
+
 }  // namespace cel::base_internal
@@ -15,21 +15,26 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_VALUES_LIST_VALUE_BUILDER_H_
 #define THIRD_PARTY_CEL_CPP_BASE_VALUES_LIST_VALUE_BUILDER_H_
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/base/casts.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "absl/utility/utility.h"
 #include "base/handle.h"
 #include "base/memory.h"
 #include "base/types/list_type.h"
 #include "base/value.h"
+#include "base/kind.h"
 #include "base/value_factory.h"
 #include "base/values/list_value.h"
 #include "internal/overloaded.h"
@@ -162,6 +167,118 @@ struct ComposedListType {
 
 inline constexpr ComposedListType kComposedListType{};
 
+// Compact tagged representation of null, bool, int, uint and double values,
+// half the size of Handle<Value>. Used by ListValueBuilder<Value> to store
+// dynamically typed scalar elements, for example the results of numeric
+// map() comprehensions. Values are converted back to Handle<Value> when read.
+class CompactScalar final {
+ public:
+  // Returns the compact representation of value, or absl::nullopt if value is
+  // not a scalar.
+  static absl::optional<CompactScalar> From(const Value& value);
+
+  static CompactScalar Null() { return CompactScalar(ValueKind::kNullType, 0); }
+
+  static CompactScalar Bool(bool value) {
+    return CompactScalar(ValueKind::kBool, value ? 1 : 0);
+  }
+
+  static CompactScalar Int(int64_t value) {
+    return CompactScalar(ValueKind::kInt, absl::bit_cast<uint64_t>(value));
+  }
+
+  static CompactScalar Uint(uint64_t value) {
+    return CompactScalar(ValueKind::kUint, value);
+  }
+
+  static CompactScalar Double(double value) {
+    return CompactScalar(ValueKind::kDouble, absl::bit_cast<uint64_t>(value));
+  }
+
+  ValueKind kind() const { return kind_; }
+
+  // The value of an int, uint or double scalar respectively.
+  int64_t int_value() const {
+    ABSL_ASSERT(kind_ == ValueKind::kInt);
+    return absl::bit_cast<int64_t>(bits_);
+  }
+  uint64_t uint_value() const {
+    ABSL_ASSERT(kind_ == ValueKind::kUint);
+    return bits_;
+  }
+  double double_value() const {
+    ABSL_ASSERT(kind_ == ValueKind::kDouble);
+    return absl::bit_cast<double>(bits_);
+  }
+
+  // Compares two scalars. When heterogeneous is true, int, uint and double
+  // values are compared numerically as with heterogeneous equality, otherwise
+  // values of different kinds are never equal.
+  bool Equals(const CompactScalar& other, bool heterogeneous) const;
+
+  Handle<Value> ToHandle(ValueFactory& value_factory) const;
+
+  std::string DebugString() const;
+
+ private:
+  CompactScalar(ValueKind kind, uint64_t bits) : kind_(kind), bits_(bits) {}
+
+  ValueKind kind_;
+  // Bit pattern of the bool, int64_t, uint64_t or double value.
+  uint64_t bits_;
+};
+
+static_assert(sizeof(CompactScalar) <= 16);
+
+// List value storing only scalars as CompactScalar.
+class CompactListValue final : public AbstractListValue {
+ public:
+  CompactListValue(
+      Handle<ListType> type,
+      std::vector<CompactScalar, Allocator<CompactScalar>> storage)
+      : AbstractListValue(std::move(type)), storage_(std::move(storage)) {}
+
+  static bool Is(const Value& value) {
+    return AbstractListValue::Is(value) &&
+           GetListValueTypeId(static_cast<const ListValue&>(value)) ==
+               NativeTypeId::For<CompactListValue>();
+  }
+
+  static const CompactListValue& Cast(const Value& value) {
+    ABSL_ASSERT(Is(value));
+    return static_cast<const CompactListValue&>(value);
+  }
+
+  // The natively stored elements, which may be scanned without creating a
+  // handle per element.
+  const std::vector<CompactScalar, Allocator<CompactScalar>>& NativeValues()
+      const {
+    return storage_;
+  }
+
+  std::string DebugString() const override {
+    return ComposeListValueDebugString(
+        storage_, [](const CompactScalar& value) { return value.DebugString(); });
+  }
+
+  size_t Size() const override { return storage_.size(); }
+
+  bool IsEmpty() const override { return storage_.empty(); }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return storage_[index].ToHandle(value_factory);
+  }
+
+ private:
+  NativeTypeId GetNativeTypeId() const override {
+    return NativeTypeId::For<CompactListValue>();
+  }
+
+  std::vector<CompactScalar, Allocator<CompactScalar>> storage_;
+};
+
 // Implementation of ListValueBuilder. Specialized to store some value types as
 // C++ primitives, avoiding Handle overhead. Anything that does not have a C++
 // primitive is stored as Handle<Value>.
@@ -229,6 +346,9 @@ class ListValueBuilderImpl<T, void> : public ListValueBuilderInterface {
 
 // Specialization for when the element type is Value itself and has no C++
 // primitive types.
+//
+// Elements are stored as CompactScalar until the first non-scalar element is
+// added, at which point the elements are converted to Handle<Value>.
 template <>
 class ListValueBuilderImpl<Value, void> : public ListValueBuilderInterface {
  public:
@@ -237,6 +357,8 @@ class ListValueBuilderImpl<Value, void> : public ListValueBuilderInterface {
       Handle<Type> type)
       : ListValueBuilderInterface(value_factory),
         type_(absl::in_place_type<Handle<Type>>, std::move(type)),
+        compact_storage_(
+            Allocator<CompactScalar>{value_factory.GetMemoryManager()}),
         storage_(Allocator<Handle<Value>>{value_factory.GetMemoryManager()}) {}
 
   ListValueBuilderImpl(
@@ -245,9 +367,16 @@ class ListValueBuilderImpl<Value, void> : public ListValueBuilderInterface {
       Handle<ListType> type)
       : ListValueBuilderInterface(value_factory),
         type_(absl::in_place_type<Handle<ListType>>, std::move(type)),
+        compact_storage_(
+            Allocator<CompactScalar>{value_factory.GetMemoryManager()}),
         storage_(Allocator<Handle<Value>>{value_factory.GetMemoryManager()}) {}
 
   std::string DebugString() const override {
+    if (compact_) {
+      return ComposeListValueDebugString(
+          compact_storage_,
+          [](const CompactScalar& value) { return value.DebugString(); });
+    }
     return ComposeListValueDebugString(
         storage_,
         [](const Handle<Value>& value) { return value->DebugString(); });
@@ -256,26 +385,62 @@ class ListValueBuilderImpl<Value, void> : public ListValueBuilderInterface {
   absl::Status Add(Handle<Value> value) override {
     CEL_RETURN_IF_ERROR(
         CheckListElement(ComposableListTypeElement(type_), *value));
+    if (compact_) {
+      if (auto scalar = CompactScalar::From(*value); scalar.has_value()) {
+        compact_storage_.push_back(*scalar);
+        return absl::OkStatus();
+      }
+      Expand();
+    }
     storage_.push_back(std::move(value));
     return absl::OkStatus();
   }
 
-  size_t Size() const override { return storage_.size(); }
+  size_t Size() const override {
+    return compact_ ? compact_storage_.size() : storage_.size();
+  }
 
-  bool IsEmpty() const override { return storage_.empty(); }
+  bool IsEmpty() const override {
+    return compact_ ? compact_storage_.empty() : storage_.empty();
+  }
 
-  void Reserve(size_t size) override { storage_.reserve(size); }
+  void Reserve(size_t size) override {
+    if (compact_) {
+      compact_storage_.reserve(size);
+    } else {
+      storage_.reserve(size);
+    }
+  }
 
   absl::StatusOr<Handle<ListValue>> Build() && override {
     CEL_ASSIGN_OR_RETURN(auto type,
                          ComposeListType(value_factory(), std::move(type_)));
+    if (compact_ && !compact_storage_.empty()) {
+      return value_factory()
+          .template CreateListValue<base_internal::CompactListValue>(
+              std::move(type), std::move(compact_storage_));
+    }
     return value_factory()
         .template CreateListValue<base_internal::DynamicListValue>(
             std::move(type), std::move(storage_));
   }
 
  private:
+  // Converts the compact elements to Handle<Value>.
+  void Expand() {
+    storage_.reserve(
+        std::max(compact_storage_.capacity(), compact_storage_.size() + 1));
+    for (const auto& scalar : compact_storage_) {
+      storage_.push_back(scalar.ToHandle(value_factory()));
+    }
+    compact_storage_.clear();
+    compact_storage_.shrink_to_fit();
+    compact_ = false;
+  }
+
   ComposableListType<Type> type_;
+  bool compact_ = true;
+  std::vector<CompactScalar, Allocator<CompactScalar>> compact_storage_;
   std::vector<Handle<Value>, Allocator<Handle<Value>>> storage_;
 };
 
@@ -14,6 +14,7 @@
 
 #include "base/values/list_value_builder.h"
 
+#include <cmath>
 #include <utility>
 
 #include "absl/status/status.h"
@@ -32,6 +33,7 @@
 namespace cel {
 namespace {
 
+using testing::ElementsAre;
 using testing::NotNull;
 using testing::WhenDynamicCastTo;
 using cel::internal::IsOkAndHolds;
@@ -106,6 +108,80 @@ TEST(ListValueBuilder, Value) {
   EXPECT_TRUE(element.As<BytesValue>()->Equals(value->As<BytesValue>()));
 }
 
+TEST(ListValueBuilder, CompactScalars) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  auto list_builder =
+      ListValueBuilder<Value>(value_factory, type_factory.GetDynType());
+  list_builder.Reserve(5);
+  EXPECT_OK(list_builder.Add(value_factory.GetNullValue()));
+  EXPECT_OK(list_builder.Add(value_factory.CreateBoolValue(true)));
+  EXPECT_OK(list_builder.Add(value_factory.CreateIntValue(-1)));
+  EXPECT_OK(list_builder.Add(value_factory.CreateUintValue(1)));
+  EXPECT_OK(list_builder.Add(value_factory.CreateDoubleValue(0.5)));
+  EXPECT_EQ(list_builder.Size(), 5);
+  EXPECT_EQ(list_builder.DebugString(), "[null, true, -1, 1u, 0.5]");
+  ASSERT_OK_AND_ASSIGN(auto list, std::move(list_builder).Build());
+  EXPECT_EQ(list->Size(), 5);
+  EXPECT_EQ(list->DebugString(), "[null, true, -1, 1u, 0.5]");
+  ASSERT_OK_AND_ASSIGN(auto element, list->Get(value_factory, 2));
+  ASSERT_TRUE(element->Is<IntValue>());
+  EXPECT_EQ(element.As<IntValue>()->NativeValue(), -1);
+  ASSERT_OK_AND_ASSIGN(element, list->Get(value_factory, 4));
+  ASSERT_TRUE(element->Is<DoubleValue>());
+  EXPECT_EQ(element.As<DoubleValue>()->NativeValue(), 0.5);
+}
+
+TEST(ListValueBuilder, CompactScalarsExpand) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  auto list_builder =
+      ListValueBuilder<Value>(value_factory, type_factory.GetDynType());
+  EXPECT_OK(list_builder.Add(value_factory.CreateIntValue(1)));
+  EXPECT_OK(list_builder.Add(value_factory.GetBytesValue()));
+  EXPECT_OK(list_builder.Add(value_factory.CreateIntValue(2)));
+  EXPECT_EQ(list_builder.Size(), 3);
+  EXPECT_EQ(list_builder.DebugString(), "[1, b\"\", 2]");
+  ASSERT_OK_AND_ASSIGN(auto list, std::move(list_builder).Build());
+  EXPECT_EQ(list->DebugString(), "[1, b\"\", 2]");
+  ASSERT_OK_AND_ASSIGN(auto element, list->Get(value_factory, 0));
+  ASSERT_TRUE(element->Is<IntValue>());
+  EXPECT_EQ(element.As<IntValue>()->NativeValue(), 1);
+  ASSERT_OK_AND_ASSIGN(element, list->Get(value_factory, 1));
+  EXPECT_TRUE(element->Is<BytesValue>());
+}
+
+TEST(ListValueBuilder, CompactScalarEquals) {
+  using base_internal::CompactScalar;
+  EXPECT_TRUE(CompactScalar::Int(1).Equals(CompactScalar::Int(1), false));
+  EXPECT_FALSE(CompactScalar::Int(1).Equals(CompactScalar::Uint(1), false));
+  EXPECT_TRUE(CompactScalar::Int(1).Equals(CompactScalar::Uint(1), true));
+  EXPECT_TRUE(CompactScalar::Int(1).Equals(CompactScalar::Double(1.0), true));
+  EXPECT_FALSE(CompactScalar::Int(1).Equals(CompactScalar::Bool(true), true));
+  EXPECT_TRUE(CompactScalar::Null().Equals(CompactScalar::Null(), true));
+  EXPECT_TRUE(
+      CompactScalar::Double(0.0).Equals(CompactScalar::Double(-0.0), false));
+  EXPECT_FALSE(CompactScalar::Double(std::nan(""))
+                   .Equals(CompactScalar::Double(std::nan("")), false));
+}
+
+TEST(ListValueBuilder, NativeValues) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  auto list_builder =
+      ListValueBuilder<IntValue>(value_factory, type_factory.GetIntType());
+  EXPECT_OK(list_builder.Add(1));
+  EXPECT_OK(list_builder.Add(2));
+  ASSERT_OK_AND_ASSIGN(auto list, std::move(list_builder).Build());
+  using IntListValue = base_internal::StaticListValue<IntValue>;
+  ASSERT_TRUE(list->Is<IntListValue>());
+  EXPECT_FALSE(list->Is<base_internal::CompactListValue>());
+  EXPECT_THAT(list->As<IntListValue>().NativeValues(), ElementsAre(1, 2));
+}
+
 TEST(ListValueBuilder, Bool) {
   TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
@@ -15,13 +15,18 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_VALUES_MAP_VALUE_BUILDER_H_
 #define THIRD_PARTY_CEL_CPP_BASE_VALUES_MAP_VALUE_BUILDER_H_
 
+#include <algorithm>
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "absl/base/attributes.h"
 #include "absl/base/macros.h"
+#include "absl/base/nullability.h"
+#include "absl/base/optimization.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -121,17 +126,19 @@ struct MapKeyHasher<uint64_t> {
   }
 };
 
+// Strings are hashed through `absl::HashOf` of their contents, which
+// `StringValue::Hash` caches for heap allocated strings.
 template <>
 struct MapKeyHasher<absl::string_view> {
   inline size_t operator()(absl::string_view key) const {
-    return absl::HashOf(ValueKind::kString, key);
+    return absl::HashOf(ValueKind::kString, absl::HashOf(key));
   }
 };
 
 template <>
 struct MapKeyHasher<absl::Cord> {
   inline size_t operator()(const absl::Cord& key) const {
-    return absl::HashOf(ValueKind::kString, key);
+    return absl::HashOf(ValueKind::kString, absl::HashOf(key));
   }
 };
 
@@ -159,13 +166,7 @@ struct MapKeyHasher<UintValue> {
 template <>
 struct MapKeyHasher<StringValue> {
   inline size_t operator()(const StringValue& key) const {
-    return key.Visit(cel::internal::Overloaded{
-        [](absl::string_view string_key) -> size_t {
-          return MapKeyHasher<absl::string_view>{}(string_key);
-        },
-        [](const absl::Cord& string_key) -> size_t {
-          return MapKeyHasher<absl::Cord>{}(string_key);
-        }});
+    return absl::HashOf(ValueKind::kString, key.Hash());
   }
 };
 
@@ -316,6 +317,49 @@ std::string ComposeMapValueDebugString(
   return out;
 }
 
+// Iterator over the keys of the storage of a map value, yielding them one at a
+// time instead of materializing a list of keys. K is the value type of the
+// keys, used to wrap keys which are not stored as handles.
+template <typename K, typename Storage>
+class MapValueStorageKeyIterator final : public MapValue::Iterator {
+ public:
+  MapValueStorageKeyIterator(ValueFactory& value_factory,
+                             const Storage& storage)
+      : value_factory_(value_factory),
+        current_(storage.begin()),
+        end_(storage.end()) {}
+
+  bool HasNext() override { return current_ != end_; }
+
+  absl::StatusOr<Handle<Value>> Next() override {
+    if (ABSL_PREDICT_FALSE(current_ == end_)) {
+      return absl::FailedPreconditionError(
+          "MapValue::Iterator::Next() called when "
+          "MapValue::Iterator::HasNext() returns false");
+    }
+    const auto& key = (current_++)->first;
+    if constexpr (std::is_same_v<std::decay_t<decltype(key)>,
+                                 Handle<Value>>) {
+      return key;
+    } else {
+      return ValueTraits<K>::Wrap(value_factory_, key);
+    }
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  typename Storage::const_iterator current_;
+  const typename Storage::const_iterator end_;
+};
+
+template <typename K, typename Storage>
+absl::StatusOr<absl::Nonnull<std::unique_ptr<MapValue::Iterator>>>
+NewMapValueStorageKeyIterator(ValueFactory& value_factory,
+                              const Storage& storage) {
+  return std::make_unique<MapValueStorageKeyIterator<K, Storage>>(
+      value_factory, storage);
+}
+
 // For MapValueBuilder we use a linked hash map to preserve insertion order.
 // This mimics protobuf and ensures some reproducibility, making testing easier.
 
@@ -366,6 +410,11 @@ class DynamicMapValue final : public AbstractMapValue {
     return std::move(keys).Build();
   }
 
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return NewMapValueStorageKeyIterator<Value>(value_factory, storage_);
+  }
+
   NativeTypeId GetNativeTypeId() const override {
     return NativeTypeId::For<DynamicMapValue>();
   }
@@ -374,6 +423,79 @@ class DynamicMapValue final : public AbstractMapValue {
   storage_type storage_;
 };
 
+// Implementation used by MapValueBuilder<Value, Value> for maps with at most
+// kSmallMapMaxSize entries, such as most map literals. Entries are stored in
+// insertion order in a single array and looked up by linear scan, which for
+// a handful of entries is cheaper to build and probe than a hash table.
+class SmallMapValue final : public AbstractMapValue {
+ public:
+  using storage_type =
+      std::vector<std::pair<Handle<Value>, Handle<Value>>,
+                  Allocator<std::pair<Handle<Value>, Handle<Value>>>>;
+
+  static constexpr size_t kSmallMapMaxSize = 8;
+
+  SmallMapValue(Handle<MapType> type, storage_type storage)
+      : AbstractMapValue(std::move(type)), storage_(std::move(storage)) {
+    ABSL_ASSERT(storage_.size() <= kSmallMapMaxSize);
+  }
+
+  std::string DebugString() const override {
+    return ComposeMapValueDebugString(
+        storage_,
+        [](const Handle<Value>& value) { return value->DebugString(); },
+        [](const Handle<Value>& value) { return value->DebugString(); });
+  }
+
+  size_t Size() const override { return storage_.size(); }
+
+  bool IsEmpty() const override { return storage_.empty(); }
+
+  absl::StatusOr<std::pair<Handle<Value>, bool>> FindImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    auto existing = Find(key);
+    if (existing == storage_.end()) {
+      return std::make_pair(Handle<Value>(), false);
+    }
+    return std::make_pair(existing->second, true);
+  }
+
+  absl::StatusOr<Handle<Value>> HasImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    return value_factory.CreateBoolValue(Find(key) != storage_.end());
+  }
+
+  absl::StatusOr<Handle<ListValue>> ListKeys(
+      ValueFactory& value_factory) const override {
+    ListValueBuilder<Value> keys(value_factory, type()->key());
+    keys.Reserve(Size());
+    for (const auto& current : storage_) {
+      CEL_RETURN_IF_ERROR(keys.Add(current.first));
+    }
+    return std::move(keys).Build();
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return NewMapValueStorageKeyIterator<Value>(value_factory, storage_);
+  }
+
+  NativeTypeId GetNativeTypeId() const override {
+    return NativeTypeId::For<SmallMapValue>();
+  }
+
+ private:
+  storage_type::const_iterator Find(const Handle<Value>& key) const {
+    return std::find_if(storage_.begin(), storage_.end(),
+                        [&key](const auto& entry) {
+                          return MapKeyEqualer<Handle<Value>>{}(entry.first,
+                                                                key);
+                        });
+  }
+
+  storage_type storage_;
+};
+
 // Implementation used by MapValueBuilder when either the key, value, or both
 // are represented as some C++ primitive.
 template <typename K, typename V>
@@ -419,6 +541,11 @@ class StaticMapValue<K, void> final : public AbstractMapValue {
     return std::move(keys).Build();
   }
 
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return NewMapValueStorageKeyIterator<K>(value_factory, storage_);
+  }
+
   NativeTypeId GetNativeTypeId() const override {
     return NativeTypeId::For<StaticMapValue<K, void>>();
   }
@@ -480,6 +607,11 @@ class StaticMapValue<void, V> final : public AbstractMapValue {
     return std::move(keys).Build();
   }
 
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return NewMapValueStorageKeyIterator<Value>(value_factory, storage_);
+  }
+
   NativeTypeId GetNativeTypeId() const override {
     return NativeTypeId::For<StaticMapValue<void, V>>();
   }
@@ -548,6 +680,11 @@ class StaticMapValue final : public AbstractMapValue {
     return std::move(keys).Build();
   }
 
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return NewMapValueStorageKeyIterator<K>(value_factory, storage_);
+  }
+
   NativeTypeId GetNativeTypeId() const override {
     return NativeTypeId::For<StaticMapValue<K, V>>();
   }
@@ -898,6 +1035,10 @@ class MapValueBuilderImpl<Value, V, void, UV>
 };
 
 // Specialization for key type and value type being Value itself.
+//
+// Entries are kept in an array until there are more than
+// SmallMapValue::kSmallMapMaxSize of them, at which point they are moved to a
+// hash map. Small maps are built as SmallMapValue.
 template <>
 class MapValueBuilderImpl<Value, Value, void, void>
     : public MapValueBuilderInterface {
@@ -906,6 +1047,8 @@ class MapValueBuilderImpl<Value, Value, void, void>
                       Handle<Type> key, Handle<Type> value)
       : MapValueBuilderInterface(value_factory),
         type_(std::make_pair(std::move(key), std::move(value))),
+        small_storage_(Allocator<std::pair<Handle<Value>, Handle<Value>>>{
+            value_factory.GetMemoryManager()}),
         storage_(Allocator<std::pair<const Handle<Value>, Handle<Value>>>{
             value_factory.GetMemoryManager()}) {}
 
@@ -913,10 +1056,18 @@ class MapValueBuilderImpl<Value, Value, void, void>
                       Handle<MapType> type)
       : MapValueBuilderInterface(value_factory),
         type_(std::move(type)),
+        small_storage_(Allocator<std::pair<Handle<Value>, Handle<Value>>>{
+            value_factory.GetMemoryManager()}),
         storage_(Allocator<std::pair<const Handle<Value>, Handle<Value>>>{
             value_factory.GetMemoryManager()}) {}
 
   std::string DebugString() const override {
+    if (small_) {
+      return ComposeMapValueDebugString(
+          small_storage_,
+          [](const Handle<Value>& value) { return value->DebugString(); },
+          [](const Handle<Value>& value) { return value->DebugString(); });
+    }
     return ComposeMapValueDebugString(
         storage_,
         [](const Handle<Value>& value) { return value->DebugString(); },
@@ -927,6 +1078,20 @@ class MapValueBuilderImpl<Value, Value, void, void>
     CEL_RETURN_IF_ERROR(CheckMapKeyAndValue(ComposableMapTypeKey(type_),
                                             ComposableMapTypeValue(type_), *key,
                                             *value));
+    if (small_) {
+      for (const auto& entry : small_storage_) {
+        if (ABSL_PREDICT_FALSE(
+                MapKeyEqualer<Handle<Value>>{}(entry.first, key))) {
+          return DuplicateKeyError();
+        }
+      }
+      if (small_storage_.size() < SmallMapValue::kSmallMapMaxSize) {
+        small_storage_.push_back(
+            std::make_pair(std::move(key), std::move(value)));
+        return absl::OkStatus();
+      }
+      Promote(small_storage_.size() + 1);
+    }
     if (ABSL_PREDICT_TRUE(
             storage_.insert(std::make_pair(std::move(key), std::move(value)))
                 .second)) {
@@ -935,21 +1100,52 @@ class MapValueBuilderImpl<Value, Value, void, void>
     return DuplicateKeyError();
   }
 
-  size_t Size() const override { return storage_.size(); }
+  size_t Size() const override {
+    return small_ ? small_storage_.size() : storage_.size();
+  }
 
-  bool IsEmpty() const override { return storage_.empty(); }
+  bool IsEmpty() const override {
+    return small_ ? small_storage_.empty() : storage_.empty();
+  }
 
-  void Reserve(size_t size) override { storage_.reserve(size); }
+  void Reserve(size_t size) override {
+    if (small_ && size <= SmallMapValue::kSmallMapMaxSize) {
+      small_storage_.reserve(size);
+      return;
+    }
+    if (small_) {
+      Promote(size);
+    }
+    storage_.reserve(size);
+  }
 
   absl::StatusOr<Handle<MapValue>> Build() && override {
     CEL_ASSIGN_OR_RETURN(auto type,
                          ComposeMapType(value_factory(), std::move(type_)));
+    if (small_) {
+      return value_factory().template CreateMapValue<SmallMapValue>(
+          std::move(type), std::move(small_storage_));
+    }
     return value_factory().template CreateMapValue<DynamicMapValue>(
         std::move(type), std::move(storage_));
   }
 
  private:
+  // Moves the entries to the hash map.
+  void Promote(size_t size) {
+    storage_.reserve(size);
+    for (auto& entry : small_storage_) {
+      storage_.insert(
+          std::make_pair(std::move(entry.first), std::move(entry.second)));
+    }
+    small_storage_.clear();
+    small_storage_.shrink_to_fit();
+    small_ = false;
+  }
+
   ComposableMapType<Type, Type> type_;
+  bool small_ = true;
+  SmallMapValue::storage_type small_storage_;
   absl::flat_hash_map<Handle<Value>, Handle<Value>, MapKeyHasher<Handle<Value>>,
                       MapKeyEqualer<Handle<Value>>,
                       Allocator<std::pair<const Handle<Value>, Handle<Value>>>>
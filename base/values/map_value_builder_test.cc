@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/time/time.h"
@@ -300,6 +301,62 @@ TEST(MapValueBuilder, GenericGeneric) {
               AnyOfArray(MakeListDebugStringFor("\"\"", "\"foo\"", "\"bar\"")));
 }
 
+TEST(MapValueBuilder, GenericGenericPromotesToHashMap) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  auto map_builder = MapValueBuilder<Value, Value>(
+      value_factory, type_factory.GetDynType(), type_factory.GetDynType());
+  constexpr int64_t kSize = 2 * base_internal::SmallMapValue::kSmallMapMaxSize;
+  for (int64_t i = 0; i < kSize; ++i) {
+    ASSERT_THAT(map_builder.Put(value_factory.CreateIntValue(i),
+                                value_factory.CreateUintValue(i)),
+                IsOk());
+    EXPECT_THAT(map_builder.Put(value_factory.CreateIntValue(i),
+                                value_factory.CreateUintValue(i)),
+                StatusIs(absl::StatusCode::kAlreadyExists));
+  }
+  EXPECT_EQ(map_builder.Size(), kSize);
+  ASSERT_OK_AND_ASSIGN(auto map, std::move(map_builder).Build());
+  EXPECT_EQ(map->Size(), kSize);
+  for (int64_t i = 0; i < kSize; ++i) {
+    ASSERT_OK_AND_ASSIGN(
+        auto entry, map->Get(value_factory, value_factory.CreateIntValue(i)));
+    ASSERT_TRUE(entry->Is<UintValue>());
+    EXPECT_EQ(entry.As<UintValue>()->NativeValue(), i);
+  }
+  ASSERT_OK_AND_ASSIGN(
+      auto has, map->Has(value_factory, value_factory.CreateIntValue(kSize)));
+  EXPECT_FALSE(has->As<BoolValue>().NativeValue());
+}
+
+TEST(MapValueBuilder, StringKeysOfDifferentRepresentations) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  auto map_builder = MapValueBuilder<Value, Value>(
+      value_factory, type_factory.GetDynType(), type_factory.GetDynType());
+  constexpr int64_t kSize = 2 * base_internal::SmallMapValue::kSmallMapMaxSize;
+  for (int64_t i = 0; i < kSize; ++i) {
+    ASSERT_OK_AND_ASSIGN(auto key, value_factory.CreateStringValue(
+                                       absl::StrCat("key", i)));
+    ASSERT_THAT(map_builder.Put(key, value_factory.CreateIntValue(i)), IsOk());
+  }
+  ASSERT_OK_AND_ASSIGN(auto map, std::move(map_builder).Build());
+  for (int64_t i = 0; i < kSize; ++i) {
+    std::string key = absl::StrCat("key", i);
+    ASSERT_OK_AND_ASSIGN(auto cord_key,
+                         value_factory.CreateStringValue(absl::Cord(key)));
+    ASSERT_OK_AND_ASSIGN(auto view_key,
+                         value_factory.CreateUnownedStringValue(key));
+    ASSERT_OK_AND_ASSIGN(auto heap_key, value_factory.CreateStringValue(key));
+    for (const auto& lookup : {cord_key, view_key, heap_key, heap_key}) {
+      ASSERT_OK_AND_ASSIGN(auto entry, map->Get(value_factory, lookup));
+      EXPECT_EQ(entry.As<IntValue>()->NativeValue(), i);
+    }
+  }
+}
+
 TEST(MapValueBuilder, UnspecializedSpecialized) {
   TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
@@ -14,6 +14,8 @@
 
 #include "base/values/string_value.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
@@ -27,6 +29,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
+#include "absl/strings/match.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/variant.h"
@@ -91,6 +94,10 @@ struct EmptyVisitor final {
 };
 
 bool EqualsImpl(absl::string_view lhs, absl::string_view rhs) {
+  if (lhs.data() == rhs.data()) {
+    // Same storage, e.g. interned constants (see cel::ConstantPool).
+    return lhs.size() == rhs.size();
+  }
   return lhs == rhs;
 }
 
@@ -197,6 +204,66 @@ struct MatchesVisitor final {
   }
 };
 
+struct StartsWithVisitor final {
+  absl::string_view prefix;
+
+  bool operator()(absl::string_view value) const {
+    return absl::StartsWith(value, prefix);
+  }
+
+  bool operator()(const absl::Cord& value) const {
+    return value.StartsWith(prefix);
+  }
+};
+
+struct EndsWithVisitor final {
+  absl::string_view suffix;
+
+  bool operator()(absl::string_view value) const {
+    return absl::EndsWith(value, suffix);
+  }
+
+  bool operator()(const absl::Cord& value) const {
+    return value.EndsWith(suffix);
+  }
+};
+
+struct ContainsVisitor final {
+  absl::string_view substr;
+
+  bool operator()(absl::string_view value) const {
+    return absl::StrContains(value, substr);
+  }
+
+  bool operator()(const absl::Cord& value) const {
+    if (auto flat = value.TryFlat(); flat.has_value()) {
+      return absl::StrContains(*flat, substr);
+    }
+    if (substr.empty()) {
+      return true;
+    }
+    // Search each chunk, and the seam between consecutive chunks using the
+    // last `substr.size() - 1` bytes seen before it.
+    const size_t overlap = substr.size() - 1;
+    std::string seam;
+    for (absl::string_view chunk : value.Chunks()) {
+      if (absl::StrContains(chunk, substr)) {
+        return true;
+      }
+      seam.append(chunk.data(), std::min(chunk.size(), overlap));
+      if (absl::StrContains(seam, substr)) {
+        return true;
+      }
+      if (chunk.size() >= overlap) {
+        seam.assign(chunk.data() + chunk.size() - overlap, overlap);
+      } else if (seam.size() > overlap) {
+        seam.erase(0, seam.size() - overlap);
+      }
+    }
+    return false;
+  }
+};
+
 class HashValueVisitor final {
  public:
   explicit HashValueVisitor(absl::HashState state) : state_(std::move(state)) {}
@@ -216,7 +283,23 @@ class HashValueVisitor final {
 }  // namespace
 
 size_t StringValue::Size() const {
-  return absl::visit(StringValueSizeVisitor{}, rep());
+  switch (base_internal::Metadata::Locality(*this)) {
+    case base_internal::DataLocality::kReferenceCounted:
+      ABSL_FALLTHROUGH_INTENDED;
+    case base_internal::DataLocality::kArenaAllocated: {
+      const auto& heap =
+          static_cast<const base_internal::StringStringValue&>(*this);
+      // As for `hash_`, racing threads compute the same count.
+      size_t count = heap.code_point_count_.load(std::memory_order_relaxed);
+      if (count == 0) {
+        count = internal::Utf8CodePointCount(heap.value_) + 1;
+        heap.code_point_count_.store(count, std::memory_order_relaxed);
+      }
+      return count - 1;
+    }
+    default:
+      return absl::visit(StringValueSizeVisitor{}, rep());
+  }
 }
 
 bool StringValue::IsEmpty() const { return absl::visit(EmptyVisitor{}, rep()); }
@@ -255,6 +338,33 @@ bool StringValue::Matches(const RE2& re) const {
   return absl::visit(MatchesVisitor{re}, rep());
 }
 
+bool StringValue::StartsWith(absl::string_view prefix) const {
+  return absl::visit(StartsWithVisitor{prefix}, rep());
+}
+
+bool StringValue::StartsWith(const StringValue& prefix) const {
+  std::string scratch;
+  return StartsWith(prefix.Flat(scratch));
+}
+
+bool StringValue::EndsWith(absl::string_view suffix) const {
+  return absl::visit(EndsWithVisitor{suffix}, rep());
+}
+
+bool StringValue::EndsWith(const StringValue& suffix) const {
+  std::string scratch;
+  return EndsWith(suffix.Flat(scratch));
+}
+
+bool StringValue::Contains(absl::string_view substr) const {
+  return absl::visit(ContainsVisitor{substr}, rep());
+}
+
+bool StringValue::Contains(const StringValue& substr) const {
+  std::string scratch;
+  return Contains(substr.Flat(scratch));
+}
+
 std::string StringValue::ToString() const {
   return absl::visit(ToStringVisitor{}, rep());
 }
@@ -335,6 +445,40 @@ void StringValue::HashValue(absl::HashState state) const {
       rep());
 }
 
+namespace {
+
+struct HashVisitor {
+  size_t operator()(absl::string_view value) const {
+    return absl::HashOf(value);
+  }
+
+  size_t operator()(const absl::Cord& value) const {
+    return absl::HashOf(value);
+  }
+};
+
+}  // namespace
+
+size_t StringValue::Hash() const {
+  switch (base_internal::Metadata::Locality(*this)) {
+    case base_internal::DataLocality::kReferenceCounted:
+      ABSL_FALLTHROUGH_INTENDED;
+    case base_internal::DataLocality::kArenaAllocated: {
+      const auto& heap =
+          static_cast<const base_internal::StringStringValue&>(*this);
+      // Racing threads compute the same hash, so relaxed ordering suffices.
+      size_t hash = heap.hash_.load(std::memory_order_relaxed);
+      if (hash == 0) {
+        hash = absl::HashOf(absl::string_view(heap.value_));
+        heap.hash_.store(hash, std::memory_order_relaxed);
+      }
+      return hash;
+    }
+    default:
+      return absl::visit(HashVisitor{}, rep());
+  }
+}
+
 base_internal::StringValueRep StringValue::rep() const {
   switch (base_internal::Metadata::Locality(*this)) {
     case base_internal::DataLocality::kNull:
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_VALUES_STRING_VALUE_H_
 #define THIRD_PARTY_CEL_CPP_BASE_VALUES_STRING_VALUE_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -89,6 +90,8 @@ class StringValue : public Value,
   absl::StatusOr<Handle<Value>> Equals(ValueFactory& value_factory,
                                        const Value& other) const;
 
+  // Returns the number of code points. The count of heap allocated strings is
+  // computed once and cached, so repeated `size()` calls do not rescan them.
   size_t Size() const;
 
   bool IsEmpty() const;
@@ -103,12 +106,27 @@ class StringValue : public Value,
 
   bool Matches(const RE2& re) const;
 
+  // Substring tests, as used by the standard `startsWith`, `endsWith` and
+  // `contains` functions. Cord backed strings are searched chunk by chunk
+  // without being flattened.
+  bool StartsWith(absl::string_view prefix) const;
+  bool StartsWith(const StringValue& prefix) const;
+  bool EndsWith(absl::string_view suffix) const;
+  bool EndsWith(const StringValue& suffix) const;
+  bool Contains(absl::string_view substr) const;
+  bool Contains(const StringValue& substr) const;
+
   std::string ToString() const;
 
   absl::Cord ToCord() const;
 
   void HashValue(absl::HashState state) const;
 
+  // Returns `absl::HashOf` of the string contents. The hash of heap allocated
+  // strings, such as constants, is computed once and cached so that repeated
+  // map lookups with the same key do not rehash it.
+  size_t Hash() const;
+
   // Visit the underlying value representation. It must accept `const
   // absl::Cord&` and `absl::string_view`.
   template <typename Visitor>
@@ -252,6 +270,10 @@ class StringStringValue final : public StringValue, public HeapData {
   explicit StringStringValue(std::string value);
 
   std::string value_;
+  // Cached result of `Hash()`, or zero if not yet computed.
+  mutable std::atomic<size_t> hash_ = 0;
+  // Cached result of `Size()` plus one, or zero if not yet computed.
+  mutable std::atomic<size_t> code_point_count_ = 0;
 };
 
 }  // namespace base_internal
@@ -29,6 +29,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "base/handle.h"
@@ -112,9 +113,10 @@ absl::StatusOr<Handle<Value>> StructValue::GetFieldByNumber(
 
 absl::StatusOr<QualifyResult> StructValue::Qualify(
     ValueFactory& value_factory, absl::Span<const SelectQualifier> qualifiers,
-    bool presence_test) const {
+    bool presence_test, bool unbox_null_wrapper_types) const {
   return CEL_INTERNAL_STRUCT_VALUE_DISPATCH(Qualify, value_factory, qualifiers,
-                                            presence_test);
+                                            presence_test,
+                                            unbox_null_wrapper_types);
 }
 
 absl::StatusOr<bool> StructValue::HasFieldByName(TypeManager& type_manager,
@@ -347,9 +349,9 @@ absl::StatusOr<Handle<Value>> LegacyStructValue::GetFieldByNumber(
 
 absl::StatusOr<QualifyResult> LegacyStructValue::Qualify(
     ValueFactory& value_factory, absl::Span<const SelectQualifier> qualifiers,
-    bool presence_test) const {
+    bool presence_test, bool unbox_null_wrapper_types) const {
   return MessageValueQualify(msg_, type_info_, value_factory, qualifiers,
-                             presence_test);
+                             presence_test, unbox_null_wrapper_types);
 }
 
 absl::StatusOr<bool> LegacyStructValue::HasFieldByName(
@@ -362,6 +364,24 @@ absl::StatusOr<bool> LegacyStructValue::HasFieldByNumber(
   return MessageValueHasFieldByNumber(msg_, type_info_, number);
 }
 
+const void* LegacyStructValue::FindFieldHint(absl::string_view name) const {
+  return MessageValueFindFieldHint(msg_, type_info_, name);
+}
+
+// Legacy hints are field descriptors, which are checked against the
+// descriptor of the message, so name is not needed to verify them.
+absl::StatusOr<absl::optional<Handle<Value>>> LegacyStructValue::GetFieldByHint(
+    ValueFactory& value_factory, absl::string_view name, const void* hint,
+    bool unbox_null_wrapper_types) const {
+  return MessageValueGetFieldByHint(msg_, type_info_, value_factory, hint,
+                                    unbox_null_wrapper_types);
+}
+
+absl::StatusOr<absl::optional<bool>> LegacyStructValue::HasFieldByHint(
+    absl::string_view name, const void* hint) const {
+  return MessageValueHasFieldByHint(msg_, type_info_, hint);
+}
+
 absl::StatusOr<Handle<Value>> LegacyStructValue::GetWrappedFieldByName(
     ValueFactory& value_factory, absl::string_view name) const {
   return MessageValueGetFieldByName(msg_, type_info_, value_factory, name,
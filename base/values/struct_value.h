@@ -30,6 +30,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "base/attribute.h"
@@ -51,6 +52,10 @@ class SelectStep;
 
 namespace cel {
 
+namespace extensions::select_optimization_internal {
+struct StructValueAccess;
+}
+
 namespace interop_internal {
 struct LegacyStructValueAccess;
 }
@@ -112,16 +117,19 @@ class StructValue : public Value,
   absl::StatusOr<Handle<Value>> GetFieldByNumber(ValueFactory& value_factory,
                                                  int64_t number) const;
 
-  // Apply a series of qualifications (representing field traversals) to the
-  // given struct.
+  // Apply a series of qualifications (representing field traversals, map
+  // lookups and list indexing) to the given struct.
+  //
+  // `unbox_null_wrapper_types` controls whether an unset wrapper typed field
+  // selected last evaluates to null or to the wrapped type's default value.
   //
   // absl::StatusCode::kUnimplemented has special meaning: if returned the
   // evaluator will attempt to apply the operation using the standard Get/Has
   // operations.
   absl::StatusOr<QualifyResult> Qualify(
       ValueFactory& value_factory,
-      absl::Span<const SelectQualifier> select_qualifiers,
-      bool presence_test) const;
+      absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+      bool unbox_null_wrapper_types) const;
 
   absl::StatusOr<bool> HasField(TypeManager& type_manager, FieldId field) const;
 
@@ -175,6 +183,7 @@ class StructValue : public Value,
   friend class base_internal::LegacyStructValue;
   friend class base_internal::AbstractStructValue;
   friend class google::api::expr::runtime::SelectStep;
+  friend struct extensions::select_optimization_internal::StructValueAccess;
 
   StructValue() = default;
 
@@ -228,10 +237,20 @@ ABSL_ATTRIBUTE_WEAK absl::StatusOr<Handle<Value>> MessageValueGetFieldByNumber(
     int64_t number, bool unbox_null_wrapper_types);
 ABSL_ATTRIBUTE_WEAK absl::StatusOr<QualifyResult> MessageValueQualify(
     uintptr_t msg, uintptr_t type_info, ValueFactory& value_factory,
-    absl::Span<const SelectQualifier> qualifiers, bool presence_test);
+    absl::Span<const SelectQualifier> qualifiers, bool presence_test,
+    bool unbox_null_wrapper_types);
 ABSL_ATTRIBUTE_WEAK absl::StatusOr<Handle<Value>> MessageValueGetFieldByName(
     uintptr_t msg, uintptr_t type_info, ValueFactory& value_factory,
     absl::string_view name, bool unbox_null_wrapper_types);
+ABSL_ATTRIBUTE_WEAK const void* MessageValueFindFieldHint(
+    uintptr_t msg, uintptr_t type_info, absl::string_view name);
+ABSL_ATTRIBUTE_WEAK absl::StatusOr<absl::optional<Handle<Value>>>
+MessageValueGetFieldByHint(uintptr_t msg, uintptr_t type_info,
+                           ValueFactory& value_factory, const void* hint,
+                           bool unbox_null_wrapper_types);
+ABSL_ATTRIBUTE_WEAK absl::StatusOr<absl::optional<bool>>
+MessageValueHasFieldByHint(uintptr_t msg, uintptr_t type_info,
+                           const void* hint);
 
 class LegacyStructValue final : public StructValue, public InlineData {
  public:
@@ -266,8 +285,8 @@ class LegacyStructValue final : public StructValue, public InlineData {
 
   absl::StatusOr<QualifyResult> Qualify(
       ValueFactory& value_factory,
-      absl::Span<const SelectQualifier> select_qualifiers,
-      bool presence_test) const;
+      absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+      bool unbox_null_wrapper_types) const;
 
   absl::StatusOr<bool> HasFieldByName(TypeManager& type_manager,
                                       absl::string_view name) const;
@@ -275,6 +294,24 @@ class LegacyStructValue final : public StructValue, public InlineData {
   absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
                                         int64_t number) const;
 
+  // Returns a hint identifying the field `name` on the type of this value,
+  // or nullptr if there is no such field or the type does not support hints.
+  // Hints let repeated accesses to the same field, such as by a select step,
+  // skip looking it up by name.
+  const void* FindFieldHint(absl::string_view name) const;
+
+  // Returns the field `name` identified by hint, which FindFieldHint returned
+  // for `name`, or absl::nullopt if hint does not apply to the type of this
+  // value.
+  absl::StatusOr<absl::optional<Handle<Value>>> GetFieldByHint(
+      ValueFactory& value_factory, absl::string_view name, const void* hint,
+      bool unbox_null_wrapper_types) const;
+
+  // Returns whether the field `name` identified by hint is set, or
+  // absl::nullopt if hint does not apply to the type of this value.
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(absl::string_view name,
+                                                      const void* hint) const;
+
   absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
   NewFieldIterator(ValueFactory& value_factory) const
       ABSL_ATTRIBUTE_LIFETIME_BOUND;
@@ -361,8 +398,8 @@ class AbstractStructValue : public StructValue,
 
   virtual absl::StatusOr<QualifyResult> Qualify(
       ValueFactory& value_factory,
-      absl::Span<const SelectQualifier> select_qualifiers,
-      bool presence_test) const {
+      absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+      bool unbox_null_wrapper_types) const {
     return absl::UnimplementedError("Qualify not supported.");
   }
 
@@ -372,6 +409,30 @@ class AbstractStructValue : public StructValue,
   virtual absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
                                                 int64_t number) const = 0;
 
+  // Field hints, see LegacyStructValue::FindFieldHint. By default hints are
+  // not supported.
+  //
+  // Callers may pass hints returned by other implementations, so
+  // GetFieldByHint and HasFieldByHint must recognize their own hints without
+  // dereferencing them, e.g. by comparing addresses. An address alone is not
+  // enough: a hint cached for a destroyed type may point into a new type
+  // allocated at the same address, so they also check that the hinted field
+  // is `name`, the field the hint was found for.
+  virtual const void* FindFieldHint(absl::string_view name) const {
+    return nullptr;
+  }
+
+  virtual absl::StatusOr<absl::optional<Handle<Value>>> GetFieldByHint(
+      ValueFactory& value_factory, absl::string_view name, const void* hint,
+      bool unbox_null_wrapper_types) const {
+    return absl::nullopt;
+  }
+
+  virtual absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      absl::string_view name, const void* hint) const {
+    return absl::nullopt;
+  }
+
   virtual absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
   NewFieldIterator(ValueFactory& value_factory) const
       ABSL_ATTRIBUTE_LIFETIME_BOUND = 0;
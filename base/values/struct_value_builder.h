@@ -15,6 +15,10 @@
 #ifndef THIRD_PARTY_CEL_CPP_BASE_VALUES_STRUCT_VALUE_BUILDER_H_
 #define THIRD_PARTY_CEL_CPP_BASE_VALUES_STRUCT_VALUE_BUILDER_H_
 
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "base/values/struct_value.h"
 
@@ -32,6 +36,16 @@ class StructValueBuilderInterface {
   virtual absl::Status SetFieldByNumber(int64_t number,
                                         Handle<Value> value) = 0;
 
+  // Sets the field identified by hint, as returned in StructType::Field, to
+  // value. Callers resolve the field once, such as when planning, so that
+  // setting it skips looking it up by name or number. Returns false without
+  // setting anything if hint does not apply to the type being built, in which
+  // case callers fall back to SetField. By default hints are not supported.
+  virtual absl::StatusOr<bool> SetFieldByHint(const void* hint,
+                                              const Handle<Value>& value) {
+    return false;
+  }
+
   virtual absl::StatusOr<Handle<StructValue>> Build() && = 0;
 };
 
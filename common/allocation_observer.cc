@@ -0,0 +1,102 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/allocation_observer.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "common/memory.h"
+
+namespace cel {
+
+absl::string_view AllocationCategoryName(AllocationCategory category) {
+  switch (category) {
+    case AllocationCategory::kString:
+      return "string";
+    case AllocationCategory::kBytes:
+      return "bytes";
+    case AllocationCategory::kList:
+      return "list";
+    case AllocationCategory::kMap:
+      return "map";
+    case AllocationCategory::kStruct:
+      return "struct";
+    case AllocationCategory::kError:
+      return "error";
+    case AllocationCategory::kType:
+      return "type";
+    case AllocationCategory::kOther:
+    default:
+      return "other";
+  }
+}
+
+int64_t AllocationRecorder::count() const {
+  int64_t count = 0;
+  for (const Stats& stats : stats_) {
+    count += stats.count;
+  }
+  return count;
+}
+
+int64_t AllocationRecorder::bytes() const {
+  int64_t bytes = 0;
+  for (const Stats& stats : stats_) {
+    bytes += stats.bytes;
+  }
+  return bytes;
+}
+
+ScopedAllocationObserver::ScopedAllocationObserver(
+    MemoryManagerRef memory_manager, AllocationObserver& observer)
+    : memory_manager_(memory_manager),
+      observer_(observer),
+      previous_(common_internal::current_allocation_observer) {
+  common_internal::current_allocation_observer = this;
+}
+
+ScopedAllocationObserver::~ScopedAllocationObserver() {
+  ABSL_DCHECK_EQ(common_internal::current_allocation_observer, this)
+      << "ScopedAllocationObserver destroyed out of order";
+  common_internal::current_allocation_observer = previous_;
+}
+
+namespace common_internal {
+
+ABSL_CONST_INIT thread_local ScopedAllocationObserver*
+    current_allocation_observer = nullptr;
+
+void AllocationObservers::Notify(MemoryManagerRef memory_manager,
+                                 AllocationCategory category, size_t size) {
+  bool reference_counting = memory_manager.vpointer_ == nullptr;
+  for (ScopedAllocationObserver* scope = current_allocation_observer;
+       scope != nullptr; scope = scope->previous_) {
+    const MemoryManagerRef& observed = scope->memory_manager_;
+    bool same = reference_counting
+                    ? observed.vpointer_ == nullptr
+                    : observed.vpointer_ == memory_manager.vpointer_ &&
+                          observed.pointer_ == memory_manager.pointer_;
+    if (same) {
+      scope->observer_.OnAllocation(category, size);
+    }
+  }
+}
+
+}  // namespace common_internal
+
+}  // namespace cel
@@ -0,0 +1,142 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_COMMON_ALLOCATION_OBSERVER_H_
+#define THIRD_PARTY_CEL_CPP_COMMON_ALLOCATION_OBSERVER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/attributes.h"
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "common/memory.h"
+
+namespace cel {
+
+// What an observed allocation is for.
+enum class AllocationCategory {
+  kOther = 0,
+  kString,
+  kBytes,
+  kList,
+  kMap,
+  kStruct,
+  kError,
+  kType,
+};
+
+inline constexpr size_t kAllocationCategoryCount =
+    static_cast<size_t>(AllocationCategory::kType) + 1;
+
+absl::string_view AllocationCategoryName(AllocationCategory category);
+
+// Receives the allocations made through a memory manager, see
+// `ScopedAllocationObserver`.
+//
+// Only the allocation of values and types created through the `base/`
+// factories is observed, e.g. by the evaluator. Memory they own indirectly
+// (e.g. the characters of a large string) is not included in the size.
+class AllocationObserver {
+ public:
+  virtual ~AllocationObserver() = default;
+
+  virtual void OnAllocation(AllocationCategory category, size_t size) = 0;
+};
+
+// `AllocationObserver` counting the allocations and bytes of each category.
+//
+// `count()` is monotonic, so it can serve as the allocation counter of
+// `EvaluationProfile` to attribute allocations to expression ids.
+class AllocationRecorder final : public AllocationObserver {
+ public:
+  struct Stats {
+    int64_t count = 0;
+    int64_t bytes = 0;
+  };
+
+  void OnAllocation(AllocationCategory category, size_t size) override {
+    Stats& stats = stats_[static_cast<size_t>(category)];
+    ++stats.count;
+    stats.bytes += static_cast<int64_t>(size);
+  }
+
+  const Stats& stats(AllocationCategory category) const {
+    return stats_[static_cast<size_t>(category)];
+  }
+
+  // Allocations of all categories.
+  int64_t count() const;
+
+  // Bytes of all categories.
+  int64_t bytes() const;
+
+  void Clear() { stats_ = {}; }
+
+ private:
+  std::array<Stats, kAllocationCategoryCount> stats_;
+};
+
+// Reports the allocations made through `memory_manager` on the current thread
+// to `observer` while in scope. Scopes nest; allocations are reported to
+// every enclosing scope observing the same memory manager.
+//
+// All reference counting memory managers are the same memory manager.
+//
+// When no observer is installed on a thread, allocations only pay for
+// reading a thread local.
+class ScopedAllocationObserver final {
+ public:
+  ScopedAllocationObserver(
+      MemoryManagerRef memory_manager,
+      AllocationObserver& observer ABSL_ATTRIBUTE_LIFETIME_BOUND);
+
+  ScopedAllocationObserver(const ScopedAllocationObserver&) = delete;
+  ScopedAllocationObserver& operator=(const ScopedAllocationObserver&) =
+      delete;
+
+  ~ScopedAllocationObserver();
+
+ private:
+  friend class common_internal::AllocationObservers;
+
+  MemoryManagerRef memory_manager_;
+  AllocationObserver& observer_;
+  ScopedAllocationObserver* previous_;
+};
+
+namespace common_internal {
+
+// The innermost `ScopedAllocationObserver` of the current thread.
+ABSL_CONST_INIT extern thread_local ScopedAllocationObserver*
+    current_allocation_observer;
+
+class AllocationObservers final {
+ public:
+  static bool Enabled() {
+    return ABSL_PREDICT_FALSE(current_allocation_observer != nullptr);
+  }
+
+  // Reports an allocation made through `memory_manager` to the observers of
+  // the current thread.
+  static void Notify(MemoryManagerRef memory_manager,
+                     AllocationCategory category, size_t size);
+};
+
+}  // namespace common_internal
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_COMMON_ALLOCATION_OBSERVER_H_
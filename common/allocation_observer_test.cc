@@ -0,0 +1,95 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/allocation_observer.h"
+
+#include <memory>
+
+#include "common/memory.h"
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+using common_internal::AllocationObservers;
+
+TEST(AllocationRecorder, CountsByCategory) {
+  AllocationRecorder recorder;
+  recorder.OnAllocation(AllocationCategory::kString, 32);
+  recorder.OnAllocation(AllocationCategory::kString, 16);
+  recorder.OnAllocation(AllocationCategory::kList, 8);
+  EXPECT_EQ(recorder.stats(AllocationCategory::kString).count, 2);
+  EXPECT_EQ(recorder.stats(AllocationCategory::kString).bytes, 48);
+  EXPECT_EQ(recorder.stats(AllocationCategory::kList).count, 1);
+  EXPECT_EQ(recorder.stats(AllocationCategory::kMap).count, 0);
+  EXPECT_EQ(recorder.count(), 3);
+  EXPECT_EQ(recorder.bytes(), 56);
+  recorder.Clear();
+  EXPECT_EQ(recorder.count(), 0);
+}
+
+TEST(ScopedAllocationObserver, Disabled) {
+  EXPECT_FALSE(AllocationObservers::Enabled());
+  AllocationRecorder recorder;
+  {
+    ScopedAllocationObserver scope(MemoryManagerRef::ReferenceCounting(),
+                                   recorder);
+    EXPECT_TRUE(AllocationObservers::Enabled());
+  }
+  EXPECT_FALSE(AllocationObservers::Enabled());
+}
+
+TEST(ScopedAllocationObserver, ObservesOnlyItsMemoryManager) {
+  auto pooling = NewThreadCompatiblePoolingMemoryManager();
+  auto other_pooling = NewThreadCompatiblePoolingMemoryManager();
+  AllocationRecorder pooling_recorder;
+  AllocationRecorder reference_counting_recorder;
+  ScopedAllocationObserver pooling_scope(*pooling, pooling_recorder);
+  ScopedAllocationObserver reference_counting_scope(
+      MemoryManagerRef::ReferenceCounting(), reference_counting_recorder);
+
+  AllocationObservers::Notify(*pooling, AllocationCategory::kMap, 8);
+  AllocationObservers::Notify(*other_pooling, AllocationCategory::kMap, 8);
+  AllocationObservers::Notify(MemoryManagerRef::ReferenceCounting(),
+                              AllocationCategory::kError, 8);
+  AllocationObservers::Notify(
+      MemoryManagerRef::ThreadConfinedReferenceCounting(),
+      AllocationCategory::kError, 8);
+
+  EXPECT_EQ(pooling_recorder.count(), 1);
+  EXPECT_EQ(pooling_recorder.stats(AllocationCategory::kMap).count, 1);
+  EXPECT_EQ(reference_counting_recorder.count(), 2);
+  EXPECT_EQ(reference_counting_recorder.stats(AllocationCategory::kError).count,
+            2);
+}
+
+TEST(ScopedAllocationObserver, Nested) {
+  AllocationRecorder outer;
+  AllocationRecorder inner;
+  ScopedAllocationObserver outer_scope(MemoryManagerRef::ReferenceCounting(),
+                                       outer);
+  {
+    ScopedAllocationObserver inner_scope(MemoryManagerRef::ReferenceCounting(),
+                                         inner);
+    AllocationObservers::Notify(MemoryManagerRef::ReferenceCounting(),
+                                AllocationCategory::kStruct, 8);
+  }
+  AllocationObservers::Notify(MemoryManagerRef::ReferenceCounting(),
+                              AllocationCategory::kStruct, 8);
+  EXPECT_EQ(outer.count(), 2);
+  EXPECT_EQ(inner.count(), 1);
+}
+
+}  // namespace
+}  // namespace cel
@@ -21,14 +21,17 @@
 #define THIRD_PARTY_CEL_CPP_COMMON_INTERNAL_REFERENCE_COUNT_H_
 
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <type_traits>
 #include <utility>
 
 #include "absl/base/attributes.h"
 #include "absl/base/nullability.h"
 #include "absl/log/absl_check.h"
+#include "common/internal/size_class_allocator.h"
 
 namespace cel::common_internal {
 
@@ -82,6 +85,12 @@ inline absl::Nullable<ReferenceCount*> GetReferenceCountForThat(
   return static_cast<ReferenceCount*>(that.refcount);
 }
 
+// Marks a newly created reference count as only ever being accessed by one
+// thread at a time. Its strong reference count is then updated with plain loads
+// and stores instead of atomic read-modify-write operations. Must be called
+// before the reference count is shared.
+void SetThreadConfinedRef(ReferenceCount& refcount) noexcept;
+
 void StrongRef(const ReferenceCount& refcount) noexcept;
 
 void StrongRef(absl::Nullable<const ReferenceCount*> refcount) noexcept;
@@ -130,7 +139,25 @@ class ReferenceCount {
 
   virtual ~ReferenceCount() = default;
 
+  // Reference counts are small, short lived and allocated frequently, so they
+  // are allocated through the size class allocator.
+  static void* operator new(size_t size) { return SizeClassAllocate(size); }
+
+  static void* operator new(size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+  }
+
+  static void operator delete(void* ptr, size_t size) noexcept {
+    SizeClassDeallocate(ptr, size);
+  }
+
+  static void operator delete(void* ptr, size_t,
+                              std::align_val_t alignment) noexcept {
+    ::operator delete(ptr, alignment);
+  }
+
  private:
+  friend void SetThreadConfinedRef(ReferenceCount& refcount) noexcept;
   friend void StrongRef(const ReferenceCount& refcount) noexcept;
   friend void StrongUnref(const ReferenceCount& refcount) noexcept;
   friend bool StrengthenRef(const ReferenceCount& refcount) noexcept;
@@ -141,6 +168,11 @@ class ReferenceCount {
 
   virtual void Finalize() const noexcept = 0;
 
+  // Set in `strong_refcount_` by `SetThreadConfinedRef()`, the remaining bits
+  // are the count.
+  static constexpr int32_t kThreadConfinedBit = int32_t{1} << 30;
+  static constexpr int32_t kCountMask = kThreadConfinedBit - 1;
+
   mutable std::atomic<int32_t> strong_refcount_ = 1;
   mutable std::atomic<int32_t> weak_refcount_ = 1;
 };
@@ -187,10 +219,22 @@ std::pair<absl::Nonnull<T*>, absl::Nonnull<ReferenceCount*>> MakeReferenceCount(
                         static_cast<ReferenceCount*>(refcount));
 }
 
+inline void SetThreadConfinedRef(ReferenceCount& refcount) noexcept {
+  ABSL_DCHECK_EQ(refcount.strong_refcount_.load(std::memory_order_relaxed), 1);
+  refcount.strong_refcount_.store(1 | ReferenceCount::kThreadConfinedBit,
+                                  std::memory_order_relaxed);
+}
+
 inline void StrongRef(const ReferenceCount& refcount) noexcept {
-  const auto count =
-      refcount.strong_refcount_.fetch_add(1, std::memory_order_relaxed);
-  ABSL_DCHECK_GT(count, 0);
+  auto count = refcount.strong_refcount_.load(std::memory_order_relaxed);
+  if ((count & ReferenceCount::kThreadConfinedBit) != 0) {
+    refcount.strong_refcount_.store(count + 1, std::memory_order_relaxed);
+  } else {
+    count = refcount.strong_refcount_.fetch_add(1, std::memory_order_relaxed);
+  }
+  ABSL_DCHECK_GT(count & ReferenceCount::kCountMask, 0);
+  ABSL_DCHECK_LT(count & ReferenceCount::kCountMask,
+                 ReferenceCount::kCountMask);
 }
 
 inline void StrongRef(absl::Nullable<const ReferenceCount*> refcount) noexcept {
@@ -200,8 +244,13 @@ inline void StrongRef(absl::Nullable<const ReferenceCount*> refcount) noexcept {
 }
 
 inline void StrongUnref(const ReferenceCount& refcount) noexcept {
-  const auto count =
-      refcount.strong_refcount_.fetch_sub(1, std::memory_order_acq_rel);
+  auto count = refcount.strong_refcount_.load(std::memory_order_relaxed);
+  if ((count & ReferenceCount::kThreadConfinedBit) != 0) {
+    refcount.strong_refcount_.store(count - 1, std::memory_order_relaxed);
+    count &= ReferenceCount::kCountMask;
+  } else {
+    count = refcount.strong_refcount_.fetch_sub(1, std::memory_order_acq_rel);
+  }
   ABSL_DCHECK_GT(count, 0);
   if (count == 1) {
     const_cast<ReferenceCount&>(refcount).Finalize();
@@ -220,7 +269,7 @@ inline bool StrengthenRef(const ReferenceCount& refcount) noexcept {
   auto count = refcount.strong_refcount_.load(std::memory_order_relaxed);
   while (true) {
     ABSL_DCHECK_GE(count, 0);
-    if (count == 0) {
+    if ((count & ReferenceCount::kCountMask) == 0) {
       return false;
     }
     if (refcount.strong_refcount_.compare_exchange_weak(
@@ -264,7 +313,8 @@ inline void WeakUnref(absl::Nullable<const ReferenceCount*> refcount) noexcept {
 }
 
 inline bool IsUniqueRef(const ReferenceCount& refcount) noexcept {
-  const auto count = refcount.strong_refcount_.load(std::memory_order_acquire);
+  const auto count = refcount.strong_refcount_.load(std::memory_order_acquire) &
+                     ReferenceCount::kCountMask;
   ABSL_DCHECK_GT(count, 0);
   return count == 1;
 }
@@ -275,7 +325,8 @@ inline bool IsUniqueRef(
 }
 
 inline bool IsExpiredRef(const ReferenceCount& refcount) noexcept {
-  const auto count = refcount.strong_refcount_.load(std::memory_order_acquire);
+  const auto count = refcount.strong_refcount_.load(std::memory_order_acquire) &
+                     ReferenceCount::kCountMask;
   ABSL_DCHECK_GE(count, 0);
   return count == 0;
 }
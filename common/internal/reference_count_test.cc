@@ -74,5 +74,28 @@ TEST(ReferenceCount, Weak) {
   WeakUnref(refcount);
 }
 
+TEST(ReferenceCount, ThreadConfined) {
+  bool destructed = false;
+  Object* object;
+  ReferenceCount* refcount;
+  std::tie(object, refcount) = MakeReferenceCount<Subobject>(destructed);
+  SetThreadConfinedRef(*refcount);
+  EXPECT_TRUE(IsUniqueRef(refcount));
+  StrongRef(refcount);
+  EXPECT_FALSE(IsUniqueRef(refcount));
+  WeakRef(refcount);
+  StrongUnref(refcount);
+  EXPECT_TRUE(IsUniqueRef(refcount));
+  EXPECT_FALSE(IsExpiredRef(refcount));
+  ASSERT_TRUE(StrengthenRef(refcount));
+  StrongUnref(refcount);
+  EXPECT_FALSE(destructed);
+  StrongUnref(refcount);
+  EXPECT_TRUE(destructed);
+  EXPECT_TRUE(IsExpiredRef(refcount));
+  ASSERT_FALSE(StrengthenRef(refcount));
+  WeakUnref(refcount);
+}
+
 }  // namespace
 }  // namespace cel::common_internal
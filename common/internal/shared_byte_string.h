@@ -16,12 +16,12 @@
 #define THIRD_PARTY_CEL_CPP_COMMON_INTERNAL_SHARED_BYTE_STRING_H_
 
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <type_traits>
 #include <utility>
 
 #include "absl/base/attributes.h"
-#include "absl/base/casts.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/string_view.h"
@@ -39,13 +39,15 @@ constexpr bool IsStringLiteral(absl::string_view string);
 struct ABSL_ATTRIBUTE_PACKED SharedByteStringHeader final {
   // True if the content is `absl::Cord`.
   bool is_cord : 1;
+  // True if the content is stored inline. Only used when `is_cord` is `false`.
+  bool is_inline : 1;
   // Only used when `is_cord` is `false`.
-  size_t size : sizeof(size_t) * 8 - 1;
+  size_t size : sizeof(size_t) * 8 - 2;
 
   SharedByteStringHeader(bool is_cord, size_t size)
-      : is_cord(is_cord), size(size) {
-    // Ensure size does not occupy the most significant bit.
-    ABSL_DCHECK_GE(absl::bit_cast<std::make_signed_t<size_t>>(size), 0);
+      : is_cord(is_cord), is_inline(false), size(size) {
+    // Ensure size does not occupy the two most significant bits.
+    ABSL_DCHECK_EQ(size >> (sizeof(size_t) * 8 - 2), 0);
   }
 };
 
@@ -59,9 +61,13 @@ class SharedByteString;
 class ABSL_ATTRIBUTE_TRIVIAL_ABI SharedByteStringView;
 
 // `SharedByteString` is a compact wrapper around either an `absl::Cord` or
-// `absl::string_view` with `const ReferenceCount*`.
+// `absl::string_view` with `const ReferenceCount*`. Owned strings of up to
+// `kInlineCapacity` bytes are instead stored inline, so they are compared and
+// hashed as `absl::string_view` and copied without touching a reference count.
 class SharedByteString final {
  public:
+  static constexpr size_t kInlineCapacity = 2 * sizeof(void*);
+
   SharedByteString() noexcept : SharedByteString(absl::string_view()) {}
 
   explicit SharedByteString(absl::string_view string_view) noexcept
@@ -85,6 +91,10 @@ class SharedByteString final {
   }
 
   explicit SharedByteString(absl::Cord cord) noexcept : header_(true, 0) {
+    if (cord.size() <= kInlineCapacity) {
+      SetInline(cord);
+      return;
+    }
     ::new (static_cast<void*>(cord_ptr())) absl::Cord(std::move(cord));
   }
 
@@ -95,9 +105,8 @@ class SharedByteString final {
     if (header_.is_cord) {
       ::new (static_cast<void*>(cord_ptr())) absl::Cord(*other.cord_ptr());
     } else {
-      content_.string.data = other.content_.string.data;
-      content_.string.refcount = other.content_.string.refcount;
-      (StrongRef)(content_.string.refcount);
+      content_ = other.content_;
+      (StrongRef)(refcount());
     }
   }
 
@@ -106,10 +115,10 @@ class SharedByteString final {
       ::new (static_cast<void*>(cord_ptr()))
           absl::Cord(std::move(*other.cord_ptr()));
     } else {
-      content_.string.data = other.content_.string.data;
-      content_.string.refcount = other.content_.string.refcount;
+      content_ = other.content_;
       other.content_.string.data = "";
       other.content_.string.refcount = nullptr;
+      other.header_.is_inline = false;
       other.header_.size = 0;
     }
   }
@@ -118,7 +127,7 @@ class SharedByteString final {
     if (header_.is_cord) {
       cord_ptr()->~Cord();
     } else {
-      (StrongUnref)(content_.string.refcount);
+      (StrongUnref)(refcount());
     }
   }
 
@@ -141,8 +150,7 @@ class SharedByteString final {
     if (header_.is_cord) {
       return std::forward<Visitor>(visitor)(*cord_ptr());
     } else {
-      return std::forward<Visitor>(visitor)(
-          absl::string_view(content_.string.data, header_.size));
+      return std::forward<Visitor>(visitor)(string_view());
     }
   }
 
@@ -163,9 +171,8 @@ class SharedByteString final {
         // absl::Cord
         SwapMixed(other, *this);
       } else {
-        // absl::string_view
-        swap(content_.string.data, other.content_.string.data);
-        swap(content_.string.refcount, other.content_.string.refcount);
+        // absl::string_view or inline
+        swap(content_, other.content_);
       }
     }
     swap(header_, other.header_);
@@ -201,7 +208,7 @@ class SharedByteString final {
   absl::Cord ToCord() const {
     return Visit(internal::Overloaded{
         [this](absl::string_view string) -> absl::Cord {
-          const auto* refcount = content_.string.refcount;
+          const auto* refcount = this->refcount();
           if (refcount != nullptr) {
             (StrongRef)(*refcount);
             return absl::MakeCordFromExternal(
@@ -217,9 +224,7 @@ class SharedByteString final {
     if (byte_string.header_.is_cord) {
       return H::combine(std::move(state), *byte_string.cord_ptr());
     } else {
-      return H::combine(std::move(state),
-                        absl::string_view(byte_string.content_.string.data,
-                                          byte_string.header_.size));
+      return H::combine(std::move(state), byte_string.string_view());
     }
   }
 
@@ -229,16 +234,13 @@ class SharedByteString final {
       if (rhs.header_.is_cord) {
         return *lhs.cord_ptr() == *rhs.cord_ptr();
       } else {
-        return *lhs.cord_ptr() ==
-               absl::string_view(rhs.content_.string.data, rhs.header_.size);
+        return *lhs.cord_ptr() == rhs.string_view();
       }
     } else {
       if (rhs.header_.is_cord) {
-        return absl::string_view(lhs.content_.string.data, lhs.header_.size) ==
-               *rhs.cord_ptr();
+        return lhs.string_view() == *rhs.cord_ptr();
       } else {
-        return absl::string_view(lhs.content_.string.data, lhs.header_.size) ==
-               absl::string_view(rhs.content_.string.data, rhs.header_.size);
+        return lhs.string_view() == rhs.string_view();
       }
     }
   }
@@ -249,16 +251,13 @@ class SharedByteString final {
       if (rhs.header_.is_cord) {
         return *lhs.cord_ptr() < *rhs.cord_ptr();
       } else {
-        return *lhs.cord_ptr() <
-               absl::string_view(rhs.content_.string.data, rhs.header_.size);
+        return *lhs.cord_ptr() < rhs.string_view();
       }
     } else {
       if (rhs.header_.is_cord) {
-        return absl::string_view(lhs.content_.string.data, lhs.header_.size) <
-               *rhs.cord_ptr();
+        return lhs.string_view() < *rhs.cord_ptr();
       } else {
-        return absl::string_view(lhs.content_.string.data, lhs.header_.size) <
-               absl::string_view(rhs.content_.string.data, rhs.header_.size);
+        return lhs.string_view() < rhs.string_view();
       }
     }
   }
@@ -268,13 +267,42 @@ class SharedByteString final {
 
   static void SwapMixed(SharedByteString& cord,
                         SharedByteString& string) noexcept {
-    const auto* string_data = string.content_.string.data;
-    const auto* string_refcount = string.content_.string.refcount;
+    const auto string_content = string.content_;
     ::new (static_cast<void*>(string.cord_ptr()))
         absl::Cord(std::move(*cord.cord_ptr()));
     cord.cord_ptr()->~Cord();
-    cord.content_.string.data = string_data;
-    cord.content_.string.refcount = string_refcount;
+    cord.content_ = string_content;
+  }
+
+  // Copies `string` into the inline storage. The caller must have checked
+  // that it fits and must not be holding a cord.
+  template <typename String>
+  void SetInline(const String& string) noexcept {
+    ABSL_DCHECK_LE(string.size(), kInlineCapacity);
+    header_.is_cord = false;
+    header_.is_inline = true;
+    header_.size = string.size();
+    if constexpr (std::is_same_v<String, absl::Cord>) {
+      char* out = content_.inline_data;
+      for (absl::string_view chunk : string.Chunks()) {
+        std::memcpy(out, chunk.data(), chunk.size());
+        out += chunk.size();
+      }
+    } else {
+      std::memcpy(content_.inline_data, string.data(), string.size());
+    }
+  }
+
+  // Only valid when `is_cord` is `false`.
+  absl::string_view string_view() const noexcept {
+    return absl::string_view(
+        header_.is_inline ? content_.inline_data : content_.string.data,
+        header_.size);
+  }
+
+  // Only valid when `is_cord` is `false`.
+  const ReferenceCount* refcount() const noexcept {
+    return header_.is_inline ? nullptr : content_.string.refcount;
   }
 
   absl::Cord* cord_ptr() noexcept {
@@ -291,6 +319,7 @@ class SharedByteString final {
       const char* data;
       const ReferenceCount* refcount;
     } string;
+    char inline_data[kInlineCapacity];
     alignas(absl::Cord) char cord[sizeof(absl::Cord)];
   } content_;
 };
@@ -335,8 +364,11 @@ class ABSL_ATTRIBUTE_TRIVIAL_ABI SharedByteStringView final {
     if (header_.is_cord) {
       content_.cord = other.cord_ptr();
     } else {
-      content_.string.data = other.content_.string.data;
-      content_.string.refcount = other.content_.string.refcount;
+      // Views never store their content inline, they refer to the inline
+      // storage of `other` instead.
+      header_.is_inline = false;
+      content_.string.data = other.string_view().data();
+      content_.string.refcount = other.refcount();
     }
   }
 
@@ -475,11 +507,16 @@ inline SharedByteString::SharedByteString(SharedByteStringView other) noexcept
   } else {
     if (other.content_.string.refcount == nullptr) {
       // Unfortunately since we cannot guarantee lifetimes when using arenas or
-      // without a reference count, we are forced to transform this into a cord.
-      header_.is_cord = true;
-      header_.size = 0;
-      ::new (static_cast<void*>(cord_ptr())) absl::Cord(
-          absl::string_view(other.content_.string.data, other.header_.size));
+      // without a reference count, we are forced to copy. Small strings are
+      // copied inline, larger ones are transformed into a cord.
+      absl::string_view string(other.content_.string.data, other.header_.size);
+      if (string.size() <= kInlineCapacity) {
+        SetInline(string);
+      } else {
+        header_.is_cord = true;
+        header_.size = 0;
+        ::new (static_cast<void*>(cord_ptr())) absl::Cord(string);
+      }
     } else {
       content_.string.data = other.content_.string.data;
       content_.string.refcount = other.content_.string.refcount;
@@ -93,6 +93,34 @@ TEST(SharedByteString, Cord) {
   EXPECT_THAT(byte_string.ToCord(), Eq("foo"));
 }
 
+TEST(SharedByteString, Inline) {
+  SharedByteString byte_string1(absl::Cord("foo"));
+  std::string scratch;
+  absl::string_view string = byte_string1.ToString(scratch);
+  EXPECT_THAT(string, Eq("foo"));
+  // Small strings are stored inside of the byte string itself.
+  EXPECT_GE(static_cast<const void*>(string.data()),
+            static_cast<const void*>(&byte_string1));
+  EXPECT_LT(static_cast<const void*>(string.data()),
+            static_cast<const void*>(&byte_string1 + 1));
+
+  SharedByteString byte_string2(byte_string1);
+  SharedByteString byte_string3(std::move(byte_string1));
+  EXPECT_THAT(byte_string2.ToString(), Eq("foo"));
+  EXPECT_THAT(byte_string3.ToString(), Eq("foo"));
+  EXPECT_THAT(SharedByteStringView(byte_string3).ToString(), Eq("foo"));
+  EXPECT_EQ(byte_string2, SharedByteString(absl::string_view("foo")));
+  EXPECT_EQ(absl::HashOf(byte_string2), absl::HashOf(absl::Cord("foo")));
+
+  std::string large(SharedByteString::kInlineCapacity + 1, 'x');
+  SharedByteString byte_string4((absl::Cord(large)));
+  EXPECT_THAT(byte_string4.ToCord(), Eq(large));
+  EXPECT_LT(byte_string3, byte_string4);
+  byte_string3.swap(byte_string4);
+  EXPECT_THAT(byte_string3.ToString(), Eq(large));
+  EXPECT_THAT(byte_string4.ToString(), Eq("foo"));
+}
+
 TEST(SharedByteString, CopyConstruct) {
   SharedByteString byte_string1(absl::string_view("foo"));
   SharedByteString byte_string2(std::string("bar"));
@@ -0,0 +1,238 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/internal/size_class_allocator.h"
+
+#include <array>
+#include <cstddef>
+#include <new>  // IWYU pragma: keep
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/config.h"  // IWYU pragma: keep
+#include "absl/base/nullability.h"
+#include "absl/base/optimization.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/log/absl_check.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/no_destructor.h"
+
+namespace cel::common_internal {
+
+namespace {
+
+// Size classes are multiples of the default new alignment, so every block is
+// suitably aligned.
+constexpr size_t kSizeClassGranularity = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+constexpr size_t kNumSizeClasses =
+    kMaxSizeClassAllocation / kSizeClassGranularity;
+
+static_assert(kMaxSizeClassAllocation % kSizeClassGranularity == 0);
+
+// Number of blocks moved between a thread and the shared pool at once.
+constexpr size_t kBatchSize = 32;
+// Once a thread holds more blocks than this for a size class, it returns a
+// batch to the shared pool.
+constexpr size_t kMaxThreadBlocks = 2 * kBatchSize;
+// Maximum number of batches held by the shared pool per size class. Excess
+// batches are returned to the global allocator.
+constexpr size_t kMaxSharedBatches = 64;
+
+size_t SizeClass(size_t size) {
+  ABSL_DCHECK_GT(size, 0);
+  return (size - 1) / kSizeClassGranularity;
+}
+
+size_t SizeClassBytes(size_t size_class) {
+  return (size_class + 1) * kSizeClassGranularity;
+}
+
+void* GlobalAllocate(size_t size) { return ::operator new(size); }
+
+void GlobalDeallocate(void* ptr, size_t size) noexcept {
+#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
+  ::operator delete(ptr, size);
+#else
+  static_cast<void>(size);
+  ::operator delete(ptr);
+#endif
+}
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+static_assert(sizeof(FreeBlock) <= kSizeClassGranularity);
+
+void DeallocateList(FreeBlock* head, size_t size_class) noexcept {
+  while (head != nullptr) {
+    FreeBlock* next = head->next;
+    GlobalDeallocate(head, SizeClassBytes(size_class));
+    head = next;
+  }
+}
+
+// Pool of free batches of one size class, shared by all threads.
+class SharedFreeList final {
+ public:
+  // Takes ownership of a list of exactly `kBatchSize` blocks. Returns false,
+  // leaving ownership with the caller, if the pool is full.
+  bool Push(FreeBlock* batch) {
+    absl::MutexLock lock(&mutex_);
+    if (batches_.size() >= kMaxSharedBatches) {
+      return false;
+    }
+    batches_.push_back(batch);
+    return true;
+  }
+
+  // Returns a list of exactly `kBatchSize` blocks, or nullptr if the pool is
+  // empty.
+  FreeBlock* Pop() {
+    absl::MutexLock lock(&mutex_);
+    if (batches_.empty()) {
+      return nullptr;
+    }
+    FreeBlock* batch = batches_.back();
+    batches_.pop_back();
+    return batch;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<FreeBlock*> batches_ ABSL_GUARDED_BY(mutex_);
+};
+
+SharedFreeList& GetSharedFreeList(size_t size_class) {
+  static internal::NoDestructor<std::array<SharedFreeList, kNumSizeClasses>>
+      free_lists;
+  return (*free_lists)[size_class];
+}
+
+// Trivially destructible, so it can be inspected while other thread locals
+// are being destroyed.
+ABSL_CONST_INIT thread_local bool thread_cache_destroyed = false;
+
+class ThreadCache final {
+ public:
+  ThreadCache() = default;
+  ThreadCache(const ThreadCache&) = delete;
+  ThreadCache& operator=(const ThreadCache&) = delete;
+
+  ~ThreadCache() {
+    thread_cache_destroyed = true;
+    for (size_t size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+      FreeList& list = lists_[size_class];
+      while (list.length >= kBatchSize) {
+        ReleaseBatch(size_class);
+      }
+      DeallocateList(list.head, size_class);
+    }
+  }
+
+  void* Allocate(size_t size_class) {
+    FreeList& list = lists_[size_class];
+    if (list.head == nullptr) {
+      list.head = GetSharedFreeList(size_class).Pop();
+      if (list.head == nullptr) {
+        return GlobalAllocate(SizeClassBytes(size_class));
+      }
+      list.length = kBatchSize;
+    }
+    FreeBlock* block = list.head;
+    list.head = block->next;
+    --list.length;
+    return block;
+  }
+
+  void Deallocate(void* ptr, size_t size_class) noexcept {
+    FreeList& list = lists_[size_class];
+    list.head = ::new (ptr) FreeBlock{list.head};
+    ++list.length;
+    if (ABSL_PREDICT_FALSE(list.length > kMaxThreadBlocks)) {
+      ReleaseBatch(size_class);
+    }
+  }
+
+ private:
+  struct FreeList {
+    FreeBlock* head = nullptr;
+    size_t length = 0;
+  };
+
+  // Moves the first `kBatchSize` blocks of the list to the shared pool, or to
+  // the global allocator if the shared pool is full.
+  void ReleaseBatch(size_t size_class) noexcept {
+    FreeList& list = lists_[size_class];
+    FreeBlock* batch = list.head;
+    FreeBlock* last = batch;
+    for (size_t i = 1; i < kBatchSize; ++i) {
+      last = last->next;
+    }
+    list.head = last->next;
+    list.length -= kBatchSize;
+    last->next = nullptr;
+    if (!GetSharedFreeList(size_class).Push(batch)) {
+      DeallocateList(batch, size_class);
+    }
+  }
+
+  std::array<FreeList, kNumSizeClasses> lists_;
+};
+
+absl::Nullable<ThreadCache*> GetThreadCache() {
+  if (ABSL_PREDICT_FALSE(thread_cache_destroyed)) {
+    return nullptr;
+  }
+  thread_local ThreadCache cache;
+  return &cache;
+}
+
+}  // namespace
+
+absl::Nonnull<void*> SizeClassAllocate(size_t size) {
+  ABSL_DCHECK_GT(size, 0);
+#ifdef ABSL_HAVE_ADDRESS_SANITIZER
+  return GlobalAllocate(size);
+#else
+  if (size > kMaxSizeClassAllocation) {
+    return GlobalAllocate(size);
+  }
+  const size_t size_class = SizeClass(size);
+  if (auto* cache = GetThreadCache(); ABSL_PREDICT_TRUE(cache != nullptr)) {
+    return cache->Allocate(size_class);
+  }
+  return GlobalAllocate(SizeClassBytes(size_class));
+#endif
+}
+
+void SizeClassDeallocate(absl::Nonnull<void*> ptr, size_t size) noexcept {
+  ABSL_DCHECK_GT(size, 0);
+#ifdef ABSL_HAVE_ADDRESS_SANITIZER
+  GlobalDeallocate(ptr, size);
+#else
+  if (size > kMaxSizeClassAllocation) {
+    GlobalDeallocate(ptr, size);
+    return;
+  }
+  const size_t size_class = SizeClass(size);
+  if (auto* cache = GetThreadCache(); ABSL_PREDICT_TRUE(cache != nullptr)) {
+    cache->Deallocate(ptr, size_class);
+    return;
+  }
+  GlobalDeallocate(ptr, SizeClassBytes(size_class));
+#endif
+}
+
+}  // namespace cel::common_internal
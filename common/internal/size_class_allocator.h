@@ -0,0 +1,48 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This header contains a small object allocator used for reference counted
+// memory. Freed blocks of up to `kMaxSizeClassAllocation` bytes are kept in
+// per-thread free lists, grouped by size class, and reused by later
+// allocations of the same size class. A thread which frees more blocks than it
+// allocates, e.g. the consumer of values created on another thread, hands them
+// to a shared pool in batches, from which threads with empty free lists refill
+// theirs.
+//
+// With AddressSanitizer all allocations go to the global allocator, so that
+// use-after-free is still detected.
+
+#ifndef THIRD_PARTY_CEL_CPP_COMMON_INTERNAL_SIZE_CLASS_ALLOCATOR_H_
+#define THIRD_PARTY_CEL_CPP_COMMON_INTERNAL_SIZE_CLASS_ALLOCATOR_H_
+
+#include <cstddef>
+
+#include "absl/base/nullability.h"
+
+namespace cel::common_internal {
+
+// Allocations larger than this are forwarded to the global allocator.
+inline constexpr size_t kMaxSizeClassAllocation = 256;
+
+// Allocates `size` bytes, aligned to `__STDCPP_DEFAULT_NEW_ALIGNMENT__`. `size`
+// must be greater than zero.
+absl::Nonnull<void*> SizeClassAllocate(size_t size);
+
+// Deallocates memory returned by `SizeClassAllocate(size)`. The memory may be
+// deallocated on any thread.
+void SizeClassDeallocate(absl::Nonnull<void*> ptr, size_t size) noexcept;
+
+}  // namespace cel::common_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_COMMON_INTERNAL_SIZE_CLASS_ALLOCATOR_H_
@@ -0,0 +1,78 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/internal/size_class_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/config.h"
+#include "internal/testing.h"
+
+namespace cel::common_internal {
+namespace {
+
+TEST(SizeClassAllocator, AllocatesAlignedWritableMemory) {
+  for (size_t size : {size_t{1}, size_t{8}, size_t{17}, size_t{64},
+                      kMaxSizeClassAllocation, kMaxSizeClassAllocation + 1,
+                      size_t{4096}}) {
+    void* ptr = SizeClassAllocate(size);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) %
+                  __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+              0);
+    std::memset(ptr, 0xab, size);
+    SizeClassDeallocate(ptr, size);
+  }
+}
+
+TEST(SizeClassAllocator, ReusesFreedBlocks) {
+  void* first = SizeClassAllocate(24);
+  SizeClassDeallocate(first, 24);
+  // Sizes in the same size class share blocks.
+  void* second = SizeClassAllocate(32);
+#ifndef ABSL_HAVE_ADDRESS_SANITIZER
+  EXPECT_EQ(first, second);
+#endif
+  SizeClassDeallocate(second, 32);
+}
+
+TEST(SizeClassAllocator, CrossThreadDeallocation) {
+  constexpr size_t kBlocks = 1000;
+  std::vector<void*> blocks;
+  for (size_t i = 0; i < kBlocks; ++i) {
+    blocks.push_back(SizeClassAllocate(48));
+    std::memset(blocks.back(), static_cast<int>(i), 48);
+  }
+  std::thread consumer([&blocks]() {
+    for (void* block : blocks) {
+      SizeClassDeallocate(block, 48);
+    }
+  });
+  consumer.join();
+  // Blocks handed back by the consumer thread can be reused here.
+  for (size_t i = 0; i < kBlocks; ++i) {
+    blocks[i] = SizeClassAllocate(48);
+    std::memset(blocks[i], static_cast<int>(i), 48);
+  }
+  for (void* block : blocks) {
+    SizeClassDeallocate(block, 48);
+  }
+}
+
+}  // namespace
+}  // namespace cel::common_internal
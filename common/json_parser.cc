@@ -0,0 +1,332 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/json_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "common/json.h"
+#include "common/value.h"
+#include "common/value_factory.h"
+#include "internal/status_macros.h"
+#include "internal/utf8.h"
+
+namespace cel {
+
+namespace {
+
+constexpr int kMaxJsonDepth = 256;
+
+class JsonParser final {
+ public:
+  explicit JsonParser(absl::string_view text) : text_(text) {}
+
+  absl::StatusOr<Json> Parse() {
+    SkipWhitespace();
+    CEL_ASSIGN_OR_RETURN(auto json, ParseValue(0));
+    SkipWhitespace();
+    if (pos_ != text_.size()) {
+      return Error("unexpected trailing characters");
+    }
+    return json;
+  }
+
+ private:
+  absl::Status Error(absl::string_view message) const {
+    return absl::InvalidArgumentError(
+        absl::StrCat("malformed JSON at offset ", pos_, ": ", message));
+  }
+
+  void SkipWhitespace() {
+    while (pos_ < text_.size()) {
+      char c = text_[pos_];
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        break;
+      }
+      ++pos_;
+    }
+  }
+
+  bool Consume(char c) {
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool ConsumeLiteral(absl::string_view literal) {
+    if (absl::StartsWith(text_.substr(pos_), literal)) {
+      pos_ += literal.size();
+      return true;
+    }
+    return false;
+  }
+
+  absl::StatusOr<Json> ParseValue(int depth) {
+    if (ABSL_PREDICT_FALSE(pos_ == text_.size())) {
+      return Error("unexpected end of input");
+    }
+    switch (text_[pos_]) {
+      case '{':
+        return ParseObject(depth + 1);
+      case '[':
+        return ParseArray(depth + 1);
+      case '"': {
+        CEL_ASSIGN_OR_RETURN(auto string, ParseString());
+        return JsonString(std::move(string));
+      }
+      case 't':
+        if (ConsumeLiteral("true")) {
+          return JsonBool(true);
+        }
+        break;
+      case 'f':
+        if (ConsumeLiteral("false")) {
+          return JsonBool(false);
+        }
+        break;
+      case 'n':
+        if (ConsumeLiteral("null")) {
+          return kJsonNull;
+        }
+        break;
+      default:
+        return ParseNumber();
+    }
+    return Error("invalid literal");
+  }
+
+  absl::StatusOr<Json> ParseObject(int depth) {
+    if (ABSL_PREDICT_FALSE(depth > kMaxJsonDepth)) {
+      return Error("maximum nesting depth exceeded");
+    }
+    ++pos_;  // '{'
+    JsonObjectBuilder builder;
+    SkipWhitespace();
+    if (Consume('}')) {
+      return std::move(builder).Build();
+    }
+    while (true) {
+      SkipWhitespace();
+      if (ABSL_PREDICT_FALSE(pos_ == text_.size() || text_[pos_] != '"')) {
+        return Error("expected object key");
+      }
+      CEL_ASSIGN_OR_RETURN(auto key, ParseString());
+      SkipWhitespace();
+      if (ABSL_PREDICT_FALSE(!Consume(':'))) {
+        return Error("expected ':'");
+      }
+      SkipWhitespace();
+      CEL_ASSIGN_OR_RETURN(auto value, ParseValue(depth));
+      builder.insert_or_assign(JsonString(std::move(key)), std::move(value));
+      SkipWhitespace();
+      if (Consume(',')) {
+        continue;
+      }
+      if (Consume('}')) {
+        return std::move(builder).Build();
+      }
+      return Error("expected ',' or '}'");
+    }
+  }
+
+  absl::StatusOr<Json> ParseArray(int depth) {
+    if (ABSL_PREDICT_FALSE(depth > kMaxJsonDepth)) {
+      return Error("maximum nesting depth exceeded");
+    }
+    ++pos_;  // '['
+    JsonArrayBuilder builder;
+    SkipWhitespace();
+    if (Consume(']')) {
+      return std::move(builder).Build();
+    }
+    while (true) {
+      SkipWhitespace();
+      CEL_ASSIGN_OR_RETURN(auto value, ParseValue(depth));
+      builder.push_back(std::move(value));
+      SkipWhitespace();
+      if (Consume(',')) {
+        continue;
+      }
+      if (Consume(']')) {
+        return std::move(builder).Build();
+      }
+      return Error("expected ',' or ']'");
+    }
+  }
+
+  absl::StatusOr<uint32_t> ParseHex4() {
+    if (ABSL_PREDICT_FALSE(text_.size() - pos_ < 4)) {
+      return Error("truncated unicode escape");
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      char c = text_[pos_++];
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= static_cast<uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        value |= static_cast<uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        value |= static_cast<uint32_t>(c - 'A' + 10);
+      } else {
+        return Error("invalid unicode escape");
+      }
+    }
+    return value;
+  }
+
+  // Parses a string starting at the opening quote. Runs of characters which
+  // need no unescaping are located with `find_first_of` and copied at once.
+  absl::StatusOr<std::string> ParseString() {
+    ++pos_;  // '"'
+    std::string result;
+    while (true) {
+      size_t end = text_.find_first_of("\"\\", pos_);
+      if (ABSL_PREDICT_FALSE(end == absl::string_view::npos)) {
+        return Error("unterminated string");
+      }
+      absl::string_view run = text_.substr(pos_, end - pos_);
+      for (char c : run) {
+        if (ABSL_PREDICT_FALSE(static_cast<unsigned char>(c) < 0x20)) {
+          return Error("unescaped control character in string");
+        }
+      }
+      if (ABSL_PREDICT_FALSE(!internal::Utf8IsValid(run))) {
+        return Error("invalid UTF-8 in string");
+      }
+      result.append(run.data(), run.size());
+      pos_ = end + 1;
+      if (text_[end] == '"') {
+        return result;
+      }
+      if (ABSL_PREDICT_FALSE(pos_ == text_.size())) {
+        return Error("unterminated string");
+      }
+      char escape = text_[pos_++];
+      switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+          result.push_back(escape);
+          break;
+        case 'b':
+          result.push_back('\b');
+          break;
+        case 'f':
+          result.push_back('\f');
+          break;
+        case 'n':
+          result.push_back('\n');
+          break;
+        case 'r':
+          result.push_back('\r');
+          break;
+        case 't':
+          result.push_back('\t');
+          break;
+        case 'u': {
+          CEL_ASSIGN_OR_RETURN(uint32_t code_point, ParseHex4());
+          if (code_point >= 0xd800 && code_point <= 0xdbff) {
+            // High surrogate, which must be followed by a low surrogate.
+            if (!ConsumeLiteral("\\u")) {
+              return Error("unpaired surrogate");
+            }
+            CEL_ASSIGN_OR_RETURN(uint32_t low, ParseHex4());
+            if (low < 0xdc00 || low > 0xdfff) {
+              return Error("unpaired surrogate");
+            }
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                         (low - 0xdc00);
+          } else if (code_point >= 0xdc00 && code_point <= 0xdfff) {
+            return Error("unpaired surrogate");
+          }
+          internal::Utf8Encode(result, static_cast<char32_t>(code_point));
+          break;
+        }
+        default:
+          return Error("invalid escape");
+      }
+    }
+  }
+
+  absl::StatusOr<Json> ParseNumber() {
+    size_t start = pos_;
+    Consume('-');
+    if (Consume('0')) {
+      // Leading zeros are not allowed.
+    } else if (pos_ < text_.size() && absl::ascii_isdigit(text_[pos_])) {
+      SkipDigits();
+    } else {
+      return Error("invalid number");
+    }
+    if (Consume('.')) {
+      if (!SkipDigits()) {
+        return Error("invalid number");
+      }
+    }
+    if (Consume('e') || Consume('E')) {
+      if (!Consume('+')) {
+        Consume('-');
+      }
+      if (!SkipDigits()) {
+        return Error("invalid number");
+      }
+    }
+    double value;
+    if (ABSL_PREDICT_FALSE(
+            !absl::SimpleAtod(text_.substr(start, pos_ - start), &value))) {
+      return Error("invalid number");
+    }
+    return JsonNumber(value);
+  }
+
+  // Skips a run of digits, returning false if there were none.
+  bool SkipDigits() {
+    size_t start = pos_;
+    while (pos_ < text_.size() && absl::ascii_isdigit(text_[pos_])) {
+      ++pos_;
+    }
+    return pos_ != start;
+  }
+
+  const absl::string_view text_;
+  size_t pos_ = 0;
+};
+
+}  // namespace
+
+absl::StatusOr<Json> ParseJson(absl::string_view text) {
+  return JsonParser(text).Parse();
+}
+
+absl::StatusOr<Value> ParseJsonToValue(ValueFactory& value_factory,
+                                       absl::string_view text) {
+  CEL_ASSIGN_OR_RETURN(auto json, ParseJson(text));
+  return value_factory.CreateValueFromJson(std::move(json));
+}
+
+}  // namespace cel
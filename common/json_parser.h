@@ -0,0 +1,41 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_COMMON_JSON_PARSER_H_
+#define THIRD_PARTY_CEL_CPP_COMMON_JSON_PARSER_H_
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "common/json.h"
+#include "common/value.h"
+#include "common/value_factory.h"
+
+namespace cel {
+
+// Parses the JSON text `text` (RFC 8259) into `Json`. Numbers are parsed as
+// doubles, strings must be valid UTF-8, and later duplicate object keys
+// replace earlier ones. Nesting is limited to 256 levels. Malformed input
+// results in `absl::StatusCode::kInvalidArgument`.
+absl::StatusOr<Json> ParseJson(absl::string_view text);
+
+// Parses the JSON text `text` into a CEL value, without going through
+// `google.protobuf.Struct`. Lists and maps are views of the parsed document
+// and only convert the entries which are accessed, so binding a large JSON
+// context and selecting a few fields avoids converting the rest.
+absl::StatusOr<Value> ParseJsonToValue(ValueFactory& value_factory,
+                                       absl::string_view text);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_COMMON_JSON_PARSER_H_
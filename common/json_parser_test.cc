@@ -0,0 +1,142 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/json_parser.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "common/casting.h"
+#include "common/json.h"
+#include "common/json_writer.h"
+#include "common/memory.h"
+#include "common/value.h"
+#include "common/value_testing.h"
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+using cel::internal::IsOkAndHolds;
+using cel::internal::StatusIs;
+using testing::Eq;
+
+TEST(ParseJson, Scalars) {
+  EXPECT_THAT(ParseJson("null"), IsOkAndHolds(Eq(Json(kJsonNull))));
+  EXPECT_THAT(ParseJson(" true "), IsOkAndHolds(Eq(Json(JsonBool(true)))));
+  EXPECT_THAT(ParseJson("false"), IsOkAndHolds(Eq(Json(JsonBool(false)))));
+  EXPECT_THAT(ParseJson("-1.5e2"), IsOkAndHolds(Eq(Json(JsonNumber(-150)))));
+  EXPECT_THAT(ParseJson("0"), IsOkAndHolds(Eq(Json(JsonNumber(0)))));
+  EXPECT_THAT(ParseJson("\"foo\""),
+              IsOkAndHolds(Eq(Json(JsonString("foo")))));
+}
+
+TEST(ParseJson, Escapes) {
+  EXPECT_THAT(ParseJson(R"json("a\"b\\c\/d\n\t\u0041")json"),
+              IsOkAndHolds(Eq(Json(JsonString("a\"b\\c/d\n\tA")))));
+  EXPECT_THAT(ParseJson(R"json("\u00e9\ud83d\ude00")json"),
+              IsOkAndHolds(Eq(Json(JsonString("\xc3\xa9\xf0\x9f\x98\x80")))));
+  EXPECT_THAT(ParseJson("\"\xc3\xa9\""),
+              IsOkAndHolds(Eq(Json(JsonString("\xc3\xa9")))));
+}
+
+TEST(ParseJson, Containers) {
+  ASSERT_OK_AND_ASSIGN(
+      auto json,
+      ParseJson(R"json({"a": [1, {"b": null}], "c": {}, "d": []})json"));
+  JsonObjectBuilder inner;
+  inner.insert_or_assign(JsonString("b"), kJsonNull);
+  JsonArrayBuilder array;
+  array.push_back(JsonNumber(1));
+  array.push_back(std::move(inner).Build());
+  JsonObjectBuilder expected;
+  expected.insert_or_assign(JsonString("a"), std::move(array).Build());
+  expected.insert_or_assign(JsonString("c"), JsonObject());
+  expected.insert_or_assign(JsonString("d"), JsonArray());
+  EXPECT_EQ(json, Json(std::move(expected).Build()));
+}
+
+TEST(ParseJson, DuplicateKeys) {
+  ASSERT_OK_AND_ASSIGN(auto json, ParseJson(R"json({"a": 1, "a": 2})json"));
+  std::string output;
+  AppendJson(json, output);
+  EXPECT_EQ(output, R"json({"a":2})json");
+}
+
+TEST(ParseJson, Errors) {
+  for (const char* text :
+       {"", "nul", "01", "1.", "-", "1e", "+1", "[1,]", "[1 2]", "{\"a\" 1}",
+        "{1: 2}", "{\"a\": 1,}", "\"abc", "\"\\x\"", "\"\\u12\"",
+        "\"\\ud800\"", "\"\\udc00\"", "\"\x01\"", "\"\xff\"", "1 2",
+        "[\"a\"", "NaN"}) {
+    EXPECT_THAT(ParseJson(text),
+                StatusIs(absl::StatusCode::kInvalidArgument))
+        << text;
+  }
+}
+
+TEST(ParseJson, Depth) {
+  std::string nested = absl::StrCat(std::string(256, '['),
+                                    std::string(256, ']'));
+  EXPECT_OK(ParseJson(nested));
+  nested = absl::StrCat(std::string(257, '['), std::string(257, ']'));
+  EXPECT_THAT(ParseJson(nested),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+class ParseJsonToValueTest
+    : public common_internal::ThreadCompatibleValueTest<> {};
+
+TEST_P(ParseJsonToValueTest, Map) {
+  ASSERT_OK_AND_ASSIGN(
+      auto value,
+      ParseJsonToValue(value_manager(),
+                       R"json({"name": "cel", "tags": ["a", "b"]})json"));
+  ASSERT_TRUE(InstanceOf<MapValue>(value));
+  auto map = Cast<MapValue>(value);
+  EXPECT_EQ(map.Size(), 2);
+
+  Value scratch;
+  ASSERT_OK_AND_ASSIGN(
+      auto name, map.Get(value_manager(), StringValueView("name"), scratch));
+  ASSERT_TRUE(InstanceOf<StringValueView>(name));
+  EXPECT_EQ(Cast<StringValueView>(name).NativeString(), "cel");
+
+  ASSERT_OK_AND_ASSIGN(
+      auto tags, map.Get(value_manager(), StringValueView("tags"), scratch));
+  ASSERT_TRUE(InstanceOf<ListValueView>(tags));
+  EXPECT_EQ(Cast<ListValueView>(tags).Size(), 2);
+}
+
+TEST_P(ParseJsonToValueTest, Scalar) {
+  ASSERT_OK_AND_ASSIGN(auto value, ParseJsonToValue(value_manager(), "1.5"));
+  ASSERT_TRUE(InstanceOf<DoubleValue>(value));
+  EXPECT_EQ(Cast<DoubleValue>(value).NativeValue(), 1.5);
+}
+
+TEST_P(ParseJsonToValueTest, Error) {
+  EXPECT_THAT(ParseJsonToValue(value_manager(), "{"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParseJsonToValueTest, ParseJsonToValueTest,
+    ::testing::Combine(::testing::Values(MemoryManagement::kPooling,
+                                         MemoryManagement::kReferenceCounting)),
+    ParseJsonToValueTest::ToString);
+
+}  // namespace
+}  // namespace cel
@@ -0,0 +1,320 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/json_writer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/variant.h"
+#include "common/casting.h"
+#include "common/json.h"
+#include "common/type.h"
+#include "common/type_kind.h"
+#include "common/value.h"
+#include "common/value_kind.h"
+#include "common/value_manager.h"
+#include "internal/overloaded.h"
+#include "internal/status_macros.h"
+#include "internal/time.h"
+
+namespace cel {
+
+namespace {
+
+constexpr char kHexDigits[] = "0123456789abcdef";
+
+void AppendEscapedChunk(absl::string_view value, std::string& output) {
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        output.append("\\\"");
+        break;
+      case '\\':
+        output.append("\\\\");
+        break;
+      case '\b':
+        output.append("\\b");
+        break;
+      case '\f':
+        output.append("\\f");
+        break;
+      case '\n':
+        output.append("\\n");
+        break;
+      case '\r':
+        output.append("\\r");
+        break;
+      case '\t':
+        output.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          output.append("\\u00");
+          output.push_back(kHexDigits[(c >> 4) & 0xf]);
+          output.push_back(kHexDigits[c & 0xf]);
+        } else {
+          output.push_back(c);
+        }
+        break;
+    }
+  }
+}
+
+void AppendQuoted(absl::string_view value, std::string& output) {
+  output.push_back('"');
+  AppendEscapedChunk(value, output);
+  output.push_back('"');
+}
+
+void AppendQuoted(const absl::Cord& value, std::string& output) {
+  output.push_back('"');
+  for (absl::string_view chunk : value.Chunks()) {
+    AppendEscapedChunk(chunk, output);
+  }
+  output.push_back('"');
+}
+
+void AppendNumber(double value, std::string& output) {
+  if (std::isnan(value)) {
+    output.append("\"NaN\"");
+    return;
+  }
+  if (std::isinf(value)) {
+    output.append(value > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+    return;
+  }
+  // Use the shortest of the usual precisions which round trips.
+  std::string formatted = absl::StrFormat("%.15g", value);
+  double parsed;
+  if (!absl::SimpleAtod(formatted, &parsed) || parsed != value) {
+    formatted = absl::StrFormat("%.17g", value);
+  }
+  output.append(formatted);
+}
+
+void AppendInt(int64_t value, std::string& output) {
+  if (value < kJsonMinInt || value > kJsonMaxInt) {
+    output.push_back('"');
+    absl::StrAppend(&output, value);
+    output.push_back('"');
+    return;
+  }
+  absl::StrAppend(&output, value);
+}
+
+void AppendUint(uint64_t value, std::string& output) {
+  if (value > kJsonMaxUint) {
+    output.push_back('"');
+    absl::StrAppend(&output, value);
+    output.push_back('"');
+    return;
+  }
+  absl::StrAppend(&output, value);
+}
+
+template <typename Bytes>
+void AppendBase64(const Bytes& value, std::string& output) {
+  output.push_back('"');
+  if constexpr (std::is_same_v<Bytes, absl::Cord>) {
+    if (auto flat = value.TryFlat(); flat.has_value()) {
+      output.append(absl::Base64Escape(*flat));
+    } else {
+      output.append(absl::Base64Escape(static_cast<std::string>(value)));
+    }
+  } else {
+    output.append(absl::Base64Escape(value));
+  }
+  output.push_back('"');
+}
+
+// Returns the object key `key` converts to, following `ConvertToJsonObject`.
+absl::StatusOr<std::string> MapKeyString(ValueView key) {
+  switch (key.kind()) {
+    case ValueKind::kString:
+      return Cast<StringValueView>(key).NativeString();
+    case ValueKind::kBool:
+      return Cast<BoolValueView>(key).NativeValue() ? std::string("true")
+                                                    : std::string("false");
+    case ValueKind::kInt:
+      return absl::StrCat(Cast<IntValueView>(key).NativeValue());
+    case ValueKind::kUint:
+      return absl::StrCat(Cast<UintValueView>(key).NativeValue());
+    default:
+      return absl::FailedPreconditionError(absl::StrCat(
+          "cannot convert map key of type ", key.GetTypeName(), " to JSON"));
+  }
+}
+
+absl::Status AppendList(ValueManager& value_manager, ListValueView value,
+                        std::string& output) {
+  output.push_back('[');
+  bool first = true;
+  CEL_RETURN_IF_ERROR(value.ForEach(
+      value_manager, [&](ValueView element) -> absl::StatusOr<bool> {
+        if (!first) {
+          output.push_back(',');
+        }
+        first = false;
+        CEL_RETURN_IF_ERROR(AppendJsonValue(value_manager, element, output));
+        return true;
+      }));
+  output.push_back(']');
+  return absl::OkStatus();
+}
+
+absl::Status AppendMap(ValueManager& value_manager, MapValueView value,
+                       std::string& output) {
+  // Keys of different kinds can convert to the same string, which
+  // `ConvertToJsonObject` rejects. That is only possible when the key type is
+  // dyn, so only then are the keys tracked.
+  const bool check_duplicates =
+      value.GetType(value_manager).key().kind() == TypeKind::kDyn;
+  absl::flat_hash_set<std::string> keys;
+  output.push_back('{');
+  bool first = true;
+  CEL_RETURN_IF_ERROR(value.ForEach(
+      value_manager,
+      [&](ValueView key, ValueView element) -> absl::StatusOr<bool> {
+        if (!first) {
+          output.push_back(',');
+        }
+        first = false;
+        if (key.kind() == ValueKind::kString && !check_duplicates) {
+          Cast<StringValueView>(key).NativeValue(
+              [&output](const auto& string) { AppendQuoted(string, output); });
+        } else {
+          CEL_ASSIGN_OR_RETURN(auto key_string, MapKeyString(key));
+          AppendQuoted(key_string, output);
+          if (check_duplicates &&
+              !keys.insert(std::move(key_string)).second) {
+            return absl::FailedPreconditionError(
+                "cannot convert map with duplicate keys to JSON");
+          }
+        }
+        output.push_back(':');
+        CEL_RETURN_IF_ERROR(AppendJsonValue(value_manager, element, output));
+        return true;
+      }));
+  output.push_back('}');
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::Status AppendJsonValue(ValueManager& value_manager, ValueView value,
+                             std::string& output) {
+  switch (value.kind()) {
+    case ValueKind::kNull:
+      output.append("null");
+      return absl::OkStatus();
+    case ValueKind::kBool:
+      output.append(Cast<BoolValueView>(value).NativeValue() ? "true"
+                                                             : "false");
+      return absl::OkStatus();
+    case ValueKind::kInt:
+      AppendInt(Cast<IntValueView>(value).NativeValue(), output);
+      return absl::OkStatus();
+    case ValueKind::kUint:
+      AppendUint(Cast<UintValueView>(value).NativeValue(), output);
+      return absl::OkStatus();
+    case ValueKind::kDouble:
+      AppendNumber(Cast<DoubleValueView>(value).NativeValue(), output);
+      return absl::OkStatus();
+    case ValueKind::kString:
+      Cast<StringValueView>(value).NativeValue(
+          [&output](const auto& string) { AppendQuoted(string, output); });
+      return absl::OkStatus();
+    case ValueKind::kBytes:
+      Cast<BytesValueView>(value).NativeValue(
+          [&output](const auto& bytes) { AppendBase64(bytes, output); });
+      return absl::OkStatus();
+    case ValueKind::kDuration: {
+      CEL_ASSIGN_OR_RETURN(auto json,
+                           internal::EncodeDurationToJson(
+                               Cast<DurationValueView>(value).NativeValue()));
+      AppendQuoted(json, output);
+      return absl::OkStatus();
+    }
+    case ValueKind::kTimestamp: {
+      CEL_ASSIGN_OR_RETURN(auto json,
+                           internal::EncodeTimestampToJson(
+                               Cast<TimestampValueView>(value).NativeValue()));
+      AppendQuoted(json, output);
+      return absl::OkStatus();
+    }
+    case ValueKind::kList:
+      return AppendList(value_manager, Cast<ListValueView>(value), output);
+    case ValueKind::kMap:
+      return AppendMap(value_manager, Cast<MapValueView>(value), output);
+    default: {
+      CEL_ASSIGN_OR_RETURN(auto json, value.ConvertToJson());
+      AppendJson(json, output);
+      return absl::OkStatus();
+    }
+  }
+}
+
+void AppendJson(const Json& json, std::string& output) {
+  absl::visit(internal::Overloaded{
+                  [&output](JsonNull) { output.append("null"); },
+                  [&output](JsonBool value) {
+                    output.append(value ? "true" : "false");
+                  },
+                  [&output](JsonNumber value) { AppendNumber(value, output); },
+                  [&output](const JsonString& value) {
+                    AppendQuoted(value, output);
+                  },
+                  [&output](const JsonArray& value) {
+                    output.push_back('[');
+                    bool first = true;
+                    for (const auto& element : value) {
+                      if (!first) {
+                        output.push_back(',');
+                      }
+                      first = false;
+                      AppendJson(element, output);
+                    }
+                    output.push_back(']');
+                  },
+                  [&output](const JsonObject& value) {
+                    output.push_back('{');
+                    bool first = true;
+                    for (const auto& entry : value) {
+                      if (!first) {
+                        output.push_back(',');
+                      }
+                      first = false;
+                      AppendQuoted(entry.first, output);
+                      output.push_back(':');
+                      AppendJson(entry.second, output);
+                    }
+                    output.push_back('}');
+                  }},
+              json);
+}
+
+}  // namespace cel
@@ -0,0 +1,49 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_COMMON_JSON_WRITER_H_
+#define THIRD_PARTY_CEL_CPP_COMMON_JSON_WRITER_H_
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "common/json.h"
+#include "common/value.h"
+#include "common/value_manager.h"
+
+namespace cel {
+
+// Appends the JSON text of `value` to `output`. Lists and maps are walked
+// and written element by element, rather than first being converted to a
+// `Json` tree with `ConvertToJson`, so large results are written with no
+// intermediate copy.
+//
+// The conversion matches `ConvertToJson`: integers outside of
+// [`kJsonMinInt`, `kJsonMaxInt`] and unsigned integers above `kJsonMaxUint`
+// are written as strings, bytes are base64 encoded, and durations and
+// timestamps use their protobuf JSON string form. Map keys must be strings,
+// booleans or integers. Non-finite doubles are written as the strings "NaN",
+// "Infinity" and "-Infinity". Other values, such as structs, are converted
+// with `ConvertToJson`.
+//
+// On error, `output` may contain a partial document.
+absl::Status AppendJsonValue(ValueManager& value_manager, ValueView value,
+                             std::string& output);
+
+// Appends the JSON text of `json` to `output`.
+void AppendJson(const Json& json, std::string& output);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_COMMON_JSON_WRITER_H_
@@ -0,0 +1,120 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/json_writer.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/time/time.h"
+#include "common/json.h"
+#include "common/memory.h"
+#include "common/type.h"
+#include "common/value.h"
+#include "common/value_testing.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+using cel::internal::IsOkAndHolds;
+using cel::internal::StatusIs;
+
+class JsonWriterTest : public common_internal::ThreadCompatibleValueTest<> {
+ public:
+  absl::StatusOr<std::string> Write(ValueView value) {
+    std::string output;
+    CEL_RETURN_IF_ERROR(AppendJsonValue(value_manager(), value, output));
+    return output;
+  }
+};
+
+TEST_P(JsonWriterTest, Scalars) {
+  EXPECT_THAT(Write(NullValueView()), IsOkAndHolds("null"));
+  EXPECT_THAT(Write(BoolValueView(true)), IsOkAndHolds("true"));
+  EXPECT_THAT(Write(IntValueView(-42)), IsOkAndHolds("-42"));
+  EXPECT_THAT(Write(IntValueView(kJsonMaxInt + 1)),
+              IsOkAndHolds("\"9007199254740992\""));
+  EXPECT_THAT(Write(UintValueView(kJsonMaxUint)),
+              IsOkAndHolds("9007199254740991"));
+  EXPECT_THAT(Write(UintValueView(std::numeric_limits<uint64_t>::max())),
+              IsOkAndHolds("\"18446744073709551615\""));
+  EXPECT_THAT(Write(DoubleValueView(0.1)), IsOkAndHolds("0.1"));
+  EXPECT_THAT(Write(DoubleValueView(1.0 / 3)),
+              IsOkAndHolds("0.33333333333333331"));
+  EXPECT_THAT(Write(DoubleValueView(std::numeric_limits<double>::infinity())),
+              IsOkAndHolds("\"Infinity\""));
+  EXPECT_THAT(Write(StringValue("a\"b\\c\n\x01")),
+              IsOkAndHolds("\"a\\\"b\\\\c\\n\\u0001\""));
+  EXPECT_THAT(Write(StringValue(absl::Cord("foo"))), IsOkAndHolds("\"foo\""));
+  EXPECT_THAT(Write(BytesValue("foo")), IsOkAndHolds("\"Zm9v\""));
+  EXPECT_THAT(Write(DurationValueView(absl::Seconds(3))),
+              IsOkAndHolds("\"3s\""));
+  EXPECT_THAT(Write(TimestampValueView(absl::UnixEpoch())),
+              IsOkAndHolds("\"1970-01-01T00:00:00Z\""));
+}
+
+TEST_P(JsonWriterTest, Containers) {
+  ASSERT_OK_AND_ASSIGN(auto list_builder,
+                       value_manager().NewListValueBuilder(
+                           type_factory().CreateListType(DynTypeView())));
+  ASSERT_OK(list_builder->Add(IntValue(1)));
+  ASSERT_OK(list_builder->Add(StringValue("two")));
+  ASSERT_OK(list_builder->Add(NullValue()));
+  auto list = std::move(*list_builder).Build();
+
+  ASSERT_OK_AND_ASSIGN(
+      auto map_builder,
+      value_manager().NewMapValueBuilder(type_factory().CreateMapType(
+          IntTypeView(), DynTypeView())));
+  ASSERT_OK(map_builder->Put(IntValue(7), list));
+  auto map = std::move(*map_builder).Build();
+
+  EXPECT_THAT(Write(map), IsOkAndHolds("{\"7\":[1,\"two\",null]}"));
+
+  // The output matches writing the `Json` tree.
+  ASSERT_OK_AND_ASSIGN(auto json, Value(map).ConvertToJson());
+  std::string expected;
+  AppendJson(json, expected);
+  EXPECT_THAT(Write(map), IsOkAndHolds(expected));
+}
+
+TEST_P(JsonWriterTest, DuplicateKeys) {
+  ASSERT_OK_AND_ASSIGN(auto builder, value_manager().NewMapValueBuilder(
+                                         type_factory().GetDynDynMapType()));
+  ASSERT_OK(builder->Put(IntValue(1), BoolValue(true)));
+  ASSERT_OK(builder->Put(StringValue("1"), BoolValue(false)));
+  auto map = std::move(*builder).Build();
+  EXPECT_THAT(Write(map), StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST_P(JsonWriterTest, Unsupported) {
+  EXPECT_THAT(Write(ErrorValueView()),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    JsonWriterTest, JsonWriterTest,
+    ::testing::Combine(::testing::Values(MemoryManagement::kPooling,
+                                         MemoryManagement::kReferenceCounting)),
+    JsonWriterTest::ToString);
+
+}  // namespace
+}  // namespace cel
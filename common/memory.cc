@@ -24,6 +24,7 @@
 #include <new>  // IWYU pragma: keep
 #include <ostream>
 
+#include "common/internal/size_class_allocator.h"
 #include "common/native_type.h"
 #include "internal/no_destructor.h"
 
@@ -116,48 +117,6 @@ T* AlignUp(T* pointer, size_t align) {
       AlignUp(reinterpret_cast<uintptr_t>(pointer), align));
 }
 
-struct CleanupAction final {
-  void* pointer;
-  void (*destruct)(void*);
-};
-
-struct Region final {
-  static Region* Create(size_t size, Region* prev) {
-    return ::new (::operator new(size + sizeof(Region))) Region(size, prev);
-  }
-
-  const size_t size;
-  Region* const prev;
-
-  Region(size_t size, Region* prev) noexcept : size(size), prev(prev) {
-    ASAN_POISON_MEMORY_REGION(reinterpret_cast<void*>(begin()), size);
-  }
-
-  uintptr_t begin() const noexcept {
-    return reinterpret_cast<uintptr_t>(this) + sizeof(Region);
-  }
-
-  uintptr_t end() const noexcept { return begin() + size; }
-
-  bool Contains(uintptr_t address) const noexcept {
-    return address >= begin() && address < end();
-  }
-
-  void Destroy() noexcept {
-    ASAN_UNPOISON_MEMORY_REGION(reinterpret_cast<void*>(begin()), size);
-    void* const address = this;
-#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
-    const auto total_size = size + sizeof(Region);
-#endif
-    this->~Region();
-#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
-    ::operator delete(address, total_size);
-#else
-    ::operator delete(address);
-#endif
-  }
-};
-
 ABSL_ATTRIBUTE_NORETURN void ThrowStdBadAlloc() {
 #ifdef ABSL_HAVE_EXCEPTIONS
   throw std::bad_alloc();
@@ -174,125 +133,53 @@ bool IsAlignmentTooLarge(size_t alignment) { return alignment > GetPageSize(); }
 
 class ThreadCompatiblePoolingMemoryManager final : public PoolingMemoryManager {
  public:
-  ~ThreadCompatiblePoolingMemoryManager() override {
-    while (!cleanup_actions_.empty()) {
-      auto cleanup_action = cleanup_actions_.front();
-      cleanup_actions_.pop_front();
-      (*cleanup_action.destruct)(cleanup_action.pointer);
-    }
-    auto* last = last_;
-    while (last != nullptr) {
-      auto* prev = last->prev;
-      last->Destroy();
-      last = prev;
-    }
-  }
+  explicit ThreadCompatiblePoolingMemoryManager(
+      const PoolingArenaOptions& options)
+      : arena_(options) {}
 
  private:
-  size_t CalculateRegionSize(size_t min_capacity) const {
-    if (min_capacity <= min_region_size_) {
-      return min_region_size_;
-    }
-    if (min_capacity >= max_region_size_) {
-      return min_capacity;
-    }
-    size_t capacity = min_region_size_;
-    while (capacity < min_capacity) {
-      capacity *= 2;
-    }
-    return capacity;
-  }
-
   absl::Nonnull<void*> AllocateImpl(size_t size, size_t align) override {
-    ABSL_DCHECK_NE(size, 0);
-    ABSL_DCHECK(absl::has_single_bit(align));
-    if (ABSL_PREDICT_FALSE(IsSizeTooLarge(size))) {
-      ThrowStdBadAlloc();
-    }
-    if (ABSL_PREDICT_FALSE(IsAlignmentTooLarge(align))) {
-      ThrowStdBadAlloc();
-    }
-    ABSL_ATTRIBUTE_UNUSED auto prev = prev_;
-    prev_ = next_;
-#ifdef ABSL_HAVE_EXCEPTIONS
-    try {
-#endif
-      if (ABSL_PREDICT_FALSE(next_ == 0)) {
-        // Allocate first region.
-        ABSL_DCHECK(first_ == nullptr);
-        ABSL_DCHECK(last_ == nullptr);
-        const size_t capacity =
-            CalculateRegionSize(AlignUp(size + sizeof(Region), align));
-        first_ = last_ = Region::Create(capacity - sizeof(Region), nullptr);
-        prev_ = next_ = last_->begin();
-      }
-      uintptr_t address = AlignUp(next_, align);
-      if (ABSL_PREDICT_FALSE(address < next_ || address >= last_->end() ||
-                             last_->end() - address < size)) {
-        // Allocate new region.
-        const size_t capacity =
-            CalculateRegionSize(AlignUp(size + sizeof(Region), align));
-        min_region_size_ = std::min(min_region_size_ * 2, max_region_size_);
-        last_ = Region::Create(capacity - sizeof(Region), last_);
-        address = AlignUp(last_->begin(), align);
-      }
-      void* pointer = reinterpret_cast<void*>(address);
-      ABSL_DCHECK(IsAligned(pointer, align));
-      next_ = address + size;
-      ASAN_UNPOISON_MEMORY_REGION(reinterpret_cast<void*>(address), size);
-      return pointer;
-#ifdef ABSL_HAVE_EXCEPTIONS
-    } catch (...) {
-      prev_ = prev;
-      throw;
-    }
-#endif
+    return arena_.Allocate(size, align);
   }
 
   bool DeallocateImpl(absl::Nonnull<void*> pointer, size_t size,
                       size_t align) noexcept override {
-    ABSL_DCHECK(absl::has_single_bit(align));
-    ABSL_DCHECK_NE(size, 0);
-    ABSL_DCHECK(IsAligned(pointer, align));
-    ABSL_DCHECK(!IsSizeTooLarge(size));
-    ABSL_DCHECK(!IsAlignmentTooLarge(align));
-    auto address = reinterpret_cast<uintptr_t>(pointer);
-    ABSL_DCHECK(address != 0);
-    if (next_ == 0 || prev_ == 0 || next_ == prev_ || address + size != next_) {
-      return false;
-    }
-    if (!last_->Contains(prev_)) {
-      auto* second_to_last = ABSL_DIE_IF_NULL(last_->prev);  // Crash OK
-      ABSL_CHECK(second_to_last->Contains(prev_));           // Crash OK
-      last_->Destroy();
-      last_ = second_to_last;
-    }
-    next_ = prev_;
-    ASAN_POISON_MEMORY_REGION(reinterpret_cast<void*>(next_),
-                              last_->end() - next_);
-    return true;
+    return arena_.Deallocate(pointer, size, align);
   }
 
   void OwnCustomDestructorImpl(
       void* object, absl::Nonnull<void (*)(void*)> destruct) override {
-    ABSL_DCHECK(object != nullptr);
-    ABSL_DCHECK(destruct != nullptr);
-    cleanup_actions_.push_back(CleanupAction{object, destruct});
+    arena_.OwnCustomDestructor(object, destruct);
   }
 
   NativeTypeId GetNativeTypeId() const noexcept override {
     return NativeTypeId::For<ThreadCompatiblePoolingMemoryManager>();
   }
 
-  uintptr_t next_ = 0;
-  uintptr_t prev_ = 0;
-  Region* last_ = nullptr;
-  std::deque<CleanupAction> cleanup_actions_;
-  Region* first_ = nullptr;
-  // Currently we use the same constants that protobuf does for their arena. We
-  // could allow these to be tunable.
-  size_t min_region_size_ = 256;
-  const size_t max_region_size_ = 32768;
+  PoolingArena arena_;
+};
+
+absl::Nonnull<void*> PoolingArenaAllocate(absl::Nonnull<void*> arena,
+                                          size_t size, size_t align) {
+  return static_cast<PoolingArena*>(arena)->Allocate(size, align);
+}
+
+bool PoolingArenaDeallocate(absl::Nonnull<void*> arena,
+                            absl::Nonnull<void*> pointer, size_t size,
+                            size_t align) noexcept {
+  return static_cast<PoolingArena*>(arena)->Deallocate(pointer, size, align);
+}
+
+void PoolingArenaOwnCustomDestructor(absl::Nonnull<void*> arena, void* object,
+                                     absl::Nonnull<void (*)(void*)> destruct) {
+  static_cast<PoolingArena*>(arena)->OwnCustomDestructor(object, destruct);
+}
+
+const PoolingMemoryManagerVirtualTable kPoolingArenaVirtualTable = {
+    NativeTypeId::For<PoolingArena>(),
+    &PoolingArenaAllocate,
+    &PoolingArenaDeallocate,
+    &PoolingArenaOwnCustomDestructor,
 };
 
 class UnreachablePoolingMemoryManager final : public PoolingMemoryManager {
@@ -383,7 +270,7 @@ absl::Nonnull<void*> ReferenceCountingMemoryManager::Allocate(
     return nullptr;
   }
   if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-    return ::operator new(size);
+    return common_internal::SizeClassAllocate(size);
   }
   return ::operator new(size, static_cast<std::align_val_t>(alignment));
 }
@@ -398,11 +285,7 @@ bool ReferenceCountingMemoryManager::Deallocate(void* ptr, size_t size,
   }
   ABSL_DCHECK_GT(size, 0);
   if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
-#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
-    ::operator delete(ptr, size);
-#else
-    ::operator delete(ptr);
-#endif
+    common_internal::SizeClassDeallocate(ptr, size);
   } else {
 #if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
     ::operator delete(ptr, size, static_cast<std::align_val_t>(alignment));
@@ -415,7 +298,231 @@ bool ReferenceCountingMemoryManager::Deallocate(void* ptr, size_t size,
 
 absl::Nonnull<std::unique_ptr<PoolingMemoryManager>>
 NewThreadCompatiblePoolingMemoryManager() {
-  return std::make_unique<ThreadCompatiblePoolingMemoryManager>();
+  return NewThreadCompatiblePoolingMemoryManager(PoolingArenaOptions());
+}
+
+absl::Nonnull<std::unique_ptr<PoolingMemoryManager>>
+NewThreadCompatiblePoolingMemoryManager(const PoolingArenaOptions& options) {
+  return std::make_unique<ThreadCompatiblePoolingMemoryManager>(options);
+}
+
+struct PoolingArena::Region final {
+  static Region* Create(size_t size, Region* prev) {
+    return ::new (::operator new(size + sizeof(Region)))
+        Region(size, prev, /*owned=*/true);
+  }
+
+  const size_t size;
+  Region* prev;
+  // False for the caller provided initial block.
+  const bool owned;
+
+  Region(size_t size, Region* prev, bool owned) noexcept
+      : size(size), prev(prev), owned(owned) {
+    ASAN_POISON_MEMORY_REGION(reinterpret_cast<void*>(begin()), size);
+  }
+
+  uintptr_t begin() const noexcept {
+    return reinterpret_cast<uintptr_t>(this) + sizeof(Region);
+  }
+
+  uintptr_t end() const noexcept { return begin() + size; }
+
+  bool Contains(uintptr_t address) const noexcept {
+    return address >= begin() && address < end();
+  }
+
+  void Destroy() noexcept {
+    ASAN_UNPOISON_MEMORY_REGION(reinterpret_cast<void*>(begin()), size);
+    if (!owned) {
+      this->~Region();
+      return;
+    }
+    void* const address = this;
+#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
+    const auto total_size = size + sizeof(Region);
+#endif
+    this->~Region();
+#if defined(__cpp_sized_deallocation) && __cpp_sized_deallocation >= 201309L
+    ::operator delete(address, total_size);
+#else
+    ::operator delete(address);
+#endif
+  }
+};
+
+PoolingArena::PoolingArena(const PoolingArenaOptions& options)
+    : min_region_size_(options.min_block_size),
+      max_region_size_(options.max_block_size) {
+  if (options.initial_block == nullptr) {
+    return;
+  }
+  const auto address = reinterpret_cast<uintptr_t>(options.initial_block);
+  const uintptr_t begin = AlignUp(address, alignof(Region));
+  const uintptr_t end = address + options.initial_block_size;
+  if (begin >= end || end - begin <= sizeof(Region)) {
+    // Too small to be of any use.
+    return;
+  }
+  first_ = last_ = ::new (reinterpret_cast<void*>(begin))
+      Region(end - begin - sizeof(Region), nullptr, /*owned=*/false);
+  prev_ = next_ = last_->begin();
+}
+
+PoolingArena::~PoolingArena() {
+  RunCleanupActions();
+  auto* last = last_;
+  while (last != nullptr) {
+    auto* prev = last->prev;
+    last->Destroy();
+    last = prev;
+  }
+}
+
+MemoryManagerRef PoolingArena::memory_manager() {
+  return MemoryManagerRef::Pooling(kPoolingArenaVirtualTable, *this);
+}
+
+void PoolingArena::RunCleanupActions() noexcept {
+  while (!cleanup_actions_.empty()) {
+    auto cleanup_action = cleanup_actions_.front();
+    cleanup_actions_.pop_front();
+    (*cleanup_action.destruct)(cleanup_action.pointer);
+  }
+}
+
+void PoolingArena::Reset() {
+  RunCleanupActions();
+  if (last_ == nullptr) {
+    return;
+  }
+  const size_t space_used = SpaceUsed();
+  // Regions grow in size, so the last region is usually the largest.
+  Region* kept = first_->owned ? last_ : first_;
+  auto* last = last_;
+  while (last != nullptr) {
+    auto* prev = last->prev;
+    if (last != kept) {
+      last->Destroy();
+    }
+    last = prev;
+  }
+  if (kept->owned && kept->size < space_used) {
+    // Replace the kept region with one that fits the high-water mark, so the
+    // next use of the arena does not have to grow it again.
+    kept->Destroy();
+    kept = Region::Create(
+        CalculateRegionSize(space_used + sizeof(Region)) - sizeof(Region),
+        nullptr);
+  }
+  kept->prev = nullptr;
+  first_ = last_ = kept;
+  prev_ = next_ = kept->begin();
+  ASAN_POISON_MEMORY_REGION(reinterpret_cast<void*>(kept->begin()),
+                            kept->size);
+}
+
+size_t PoolingArena::SpaceUsed() const {
+  if (last_ == nullptr) {
+    return 0;
+  }
+  size_t space_used = next_ - last_->begin();
+  for (const Region* region = last_->prev; region != nullptr;
+       region = region->prev) {
+    space_used += region->size;
+  }
+  return space_used;
+}
+
+size_t PoolingArena::CalculateRegionSize(size_t min_capacity) const {
+  if (min_capacity <= min_region_size_) {
+    return min_region_size_;
+  }
+  if (min_capacity >= max_region_size_) {
+    return min_capacity;
+  }
+  size_t capacity = min_region_size_;
+  while (capacity < min_capacity) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+absl::Nonnull<void*> PoolingArena::Allocate(size_t size, size_t align) {
+  ABSL_DCHECK_NE(size, 0);
+  ABSL_DCHECK(absl::has_single_bit(align));
+  if (ABSL_PREDICT_FALSE(IsSizeTooLarge(size))) {
+    ThrowStdBadAlloc();
+  }
+  if (ABSL_PREDICT_FALSE(IsAlignmentTooLarge(align))) {
+    ThrowStdBadAlloc();
+  }
+  ABSL_ATTRIBUTE_UNUSED auto prev = prev_;
+  prev_ = next_;
+#ifdef ABSL_HAVE_EXCEPTIONS
+  try {
+#endif
+    if (ABSL_PREDICT_FALSE(next_ == 0)) {
+      // Allocate first region.
+      ABSL_DCHECK(first_ == nullptr);
+      ABSL_DCHECK(last_ == nullptr);
+      const size_t capacity =
+          CalculateRegionSize(AlignUp(size + sizeof(Region), align));
+      first_ = last_ = Region::Create(capacity - sizeof(Region), nullptr);
+      prev_ = next_ = last_->begin();
+    }
+    uintptr_t address = AlignUp(next_, align);
+    if (ABSL_PREDICT_FALSE(address < next_ || address >= last_->end() ||
+                           last_->end() - address < size)) {
+      // Allocate new region.
+      const size_t capacity =
+          CalculateRegionSize(AlignUp(size + sizeof(Region), align));
+      min_region_size_ = std::min(min_region_size_ * 2, max_region_size_);
+      last_ = Region::Create(capacity - sizeof(Region), last_);
+      address = AlignUp(last_->begin(), align);
+    }
+    void* pointer = reinterpret_cast<void*>(address);
+    ABSL_DCHECK(IsAligned(pointer, align));
+    next_ = address + size;
+    ASAN_UNPOISON_MEMORY_REGION(reinterpret_cast<void*>(address), size);
+    return pointer;
+#ifdef ABSL_HAVE_EXCEPTIONS
+  } catch (...) {
+    prev_ = prev;
+    throw;
+  }
+#endif
+}
+
+bool PoolingArena::Deallocate(absl::Nonnull<void*> pointer, size_t size,
+                              size_t align) noexcept {
+  ABSL_DCHECK(absl::has_single_bit(align));
+  ABSL_DCHECK_NE(size, 0);
+  ABSL_DCHECK(IsAligned(pointer, align));
+  ABSL_DCHECK(!IsSizeTooLarge(size));
+  ABSL_DCHECK(!IsAlignmentTooLarge(align));
+  auto address = reinterpret_cast<uintptr_t>(pointer);
+  ABSL_DCHECK(address != 0);
+  if (next_ == 0 || prev_ == 0 || next_ == prev_ || address + size != next_) {
+    return false;
+  }
+  if (!last_->Contains(prev_)) {
+    auto* second_to_last = ABSL_DIE_IF_NULL(last_->prev);  // Crash OK
+    ABSL_CHECK(second_to_last->Contains(prev_));           // Crash OK
+    last_->Destroy();
+    last_ = second_to_last;
+  }
+  next_ = prev_;
+  ASAN_POISON_MEMORY_REGION(reinterpret_cast<void*>(next_),
+                            last_->end() - next_);
+  return true;
+}
+
+void PoolingArena::OwnCustomDestructor(
+    void* object, absl::Nonnull<void (*)(void*)> destruct) {
+  ABSL_DCHECK(object != nullptr);
+  ABSL_DCHECK(destruct != nullptr);
+  cleanup_actions_.push_back(CleanupAction{object, destruct});
 }
 
 absl::Nonnull<PoolingMemoryManager*>
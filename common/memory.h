@@ -16,6 +16,8 @@
 #define THIRD_PARTY_CEL_CPP_COMMON_MEMORY_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <ostream>
 #include <type_traits>
@@ -73,6 +75,10 @@ template <typename T>
 struct HandleFactory;
 }  // namespace base_internal
 
+namespace common_internal {
+class AllocationObservers;
+}  // namespace common_internal
+
 // `Shared` points to an object allocated in memory which is managed by a
 // `MemoryManager`. The pointed to object is valid so long as the managing
 // `MemoryManager` is alive and one or more valid `Shared` exist pointing to the
@@ -456,12 +462,16 @@ class ReferenceCountingMemoryManager final {
 
  private:
   template <typename T, typename... Args>
-  static ABSL_MUST_USE_RESULT Shared<T> MakeShared(Args&&... args) {
+  static ABSL_MUST_USE_RESULT Shared<T> MakeShared(bool thread_confined,
+                                                   Args&&... args) {
     using U = std::remove_const_t<T>;
     U* ptr;
     common_internal::ReferenceCount* refcount;
     std::tie(ptr, refcount) =
         common_internal::MakeReferenceCount<U>(std::forward<Args>(args)...);
+    if (thread_confined) {
+      common_internal::SetThreadConfinedRef(*refcount);
+    }
     return Shared<T>(common_internal::kAdoptRef, static_cast<T*>(ptr),
                      refcount);
   }
@@ -623,10 +633,17 @@ struct CastTraits<To, From,
                   EnableIfSubsumptionCastable<To, From, PoolingMemoryManager>>
     : SubsumptionCastTraits<To, From> {};
 
+struct PoolingArenaOptions;
+
 // Creates a new `PoolingMemoryManager` which is thread-compatible.
 absl::Nonnull<std::unique_ptr<PoolingMemoryManager>>
 NewThreadCompatiblePoolingMemoryManager();
 
+// Creates a new `PoolingMemoryManager` which is thread-compatible, backed by a
+// `PoolingArena` with the given options.
+absl::Nonnull<std::unique_ptr<PoolingMemoryManager>>
+NewThreadCompatiblePoolingMemoryManager(const PoolingArenaOptions& options);
+
 // `PoolingMemoryManagerVirtualTable` describes an implementation of
 // `PoolingMemoryManager` without inheriting from it. This allows adapting
 // other implementations to the `PoolingMemoryManager` interface without having
@@ -777,7 +794,7 @@ class ABSL_ATTRIBUTE_TRIVIAL_ABI MemoryManager final {
   ABSL_MUST_USE_RESULT Shared<T> MakeShared(Args&&... args) {
     if (pointer_ == nullptr) {
       return ReferenceCountingMemoryManager::MakeShared<T>(
-          std::forward<Args>(args)...);
+          /*thread_confined=*/false, std::forward<Args>(args)...);
     } else {
       return pointer_->MakeShared<T>(std::forward<Args>(args)...);
     }
@@ -951,6 +968,20 @@ class ABSL_ATTRIBUTE_TRIVIAL_ABI MemoryManagerRef final {
     return memory_manager;
   }
 
+  // Returns a reference counting `MemoryManagerRef` whose reference counts are
+  // updated without atomic read-modify-write operations. Every `Shared` created
+  // through it, and every copy of one, must only be used by one thread at a
+  // time, e.g. values created by a `ThreadCompatibleValueManager` for an
+  // evaluation which is confined to a single thread.
+  ABSL_MUST_USE_RESULT static MemoryManagerRef
+  ThreadConfinedReferenceCounting() {
+    MemoryManagerRef memory_manager(
+        nullptr, const_cast<char*>(&kThreadConfinedReferenceCountingTag));
+    ABSL_ASSUME(memory_manager.vpointer_ == nullptr &&
+                memory_manager.pointer_ != nullptr);
+    return memory_manager;
+  }
+
   template <typename T>
   ABSL_MUST_USE_RESULT static MemoryManagerRef Pooling(
       const PoolingMemoryManagerVirtualTable& vtable
@@ -992,10 +1023,16 @@ class ABSL_ATTRIBUTE_TRIVIAL_ABI MemoryManagerRef final {
                                 : MemoryManagement::kPooling;
   }
 
+  // Returns `true` if this was returned by `ThreadConfinedReferenceCounting()`.
+  bool thread_confined() const noexcept {
+    return vpointer_ == nullptr && pointer_ != nullptr;
+  }
+
   template <typename T, typename... Args>
   ABSL_MUST_USE_RESULT Shared<T> MakeShared(Args&&... args) {
     if (vpointer_ == nullptr) {
       return ReferenceCountingMemoryManager::MakeShared<T>(
+          /*thread_confined=*/pointer_ != nullptr,
           std::forward<Args>(args)...);
     } else if (pointer_ == nullptr) {
       return static_cast<PoolingMemoryManager*>(vpointer_)->MakeShared<T>(
@@ -1102,10 +1139,17 @@ class ABSL_ATTRIBUTE_TRIVIAL_ABI MemoryManagerRef final {
   friend class Allocator;
   template <typename T>
   friend struct base_internal::HandleFactory;
+  friend class common_internal::AllocationObservers;
 
   explicit MemoryManagerRef(void* vpointer, void* pointer)
       : vpointer_(vpointer), pointer_(pointer) {}
 
+  // Only its address is used, as `pointer_` of thread confined reference
+  // counting memory managers.
+  static inline const char kThreadConfinedReferenceCountingTag = 0;
+
+  // For reference counting, `vpointer_` is `nullptr` and `pointer_` is either
+  // `nullptr` or `&kThreadConfinedReferenceCountingTag`.
   void* vpointer_;
   void* pointer_;
 };
@@ -1193,6 +1237,82 @@ struct CastTraits<To, From,
                                                   absl::remove_cvref_t<From>>>>
     : CompositionCastTraits<To, From> {};
 
+struct PoolingArenaOptions final {
+  // Caller owned memory used as the first block of the arena, e.g. a buffer on
+  // the stack. It must outlive the arena. Ignored if `nullptr`.
+  absl::Nullable<void*> initial_block = nullptr;
+  size_t initial_block_size = 0;
+  // Size of the first block allocated by the arena. Each further block is
+  // twice the size of the previous one, up to `max_block_size`.
+  size_t min_block_size = 256;
+  size_t max_block_size = 32768;
+};
+
+// `PoolingArena` is a bump-pointer arena implementing pooling memory
+// management without depending on `google::protobuf::Arena`. Destructors are
+// only registered for objects which are not trivially destructible.
+//
+// This class is thread-compatible.
+class PoolingArena final {
+ public:
+  PoolingArena() : PoolingArena(PoolingArenaOptions()) {}
+
+  explicit PoolingArena(const PoolingArenaOptions& options);
+
+  PoolingArena(const PoolingArena&) = delete;
+  PoolingArena(PoolingArena&&) = delete;
+  PoolingArena& operator=(const PoolingArena&) = delete;
+  PoolingArena& operator=(PoolingArena&&) = delete;
+
+  ~PoolingArena();
+
+  // Returns a `MemoryManagerRef` allocating from this arena.
+  MemoryManagerRef memory_manager() ABSL_ATTRIBUTE_LIFETIME_BOUND;
+
+  // Runs the registered destructors and releases all memory except for one
+  // block, which is reused by subsequent allocations: the initial block if one
+  // was provided, otherwise a block large enough for everything allocated
+  // since the previous reset. This makes the arena cheap to reuse across
+  // evaluations, as after the first few a single block holds the high-water
+  // mark. Nothing previously allocated from the arena may be used afterwards.
+  void Reset();
+
+  // Returns the number of bytes handed out since construction or the last
+  // call to `Reset()`, including alignment padding and the unused tail of
+  // exhausted blocks.
+  size_t SpaceUsed() const;
+
+  absl::Nonnull<void*> Allocate(size_t size, size_t align);
+
+  // Only the most recent allocation can be deallocated, returns `false`
+  // otherwise.
+  bool Deallocate(absl::Nonnull<void*> pointer, size_t size,
+                  size_t align) noexcept;
+
+  void OwnCustomDestructor(void* object,
+                           absl::Nonnull<void (*)(void*)> destruct);
+
+ private:
+  struct Region;
+
+  struct CleanupAction final {
+    void* pointer;
+    void (*destruct)(void*);
+  };
+
+  size_t CalculateRegionSize(size_t min_capacity) const;
+
+  void RunCleanupActions() noexcept;
+
+  uintptr_t next_ = 0;
+  uintptr_t prev_ = 0;
+  Region* last_ = nullptr;
+  std::deque<CleanupAction> cleanup_actions_;
+  Region* first_ = nullptr;
+  size_t min_region_size_;
+  const size_t max_region_size_;
+};
+
 }  // namespace cel
 
 #endif  // THIRD_PARTY_CEL_CPP_COMMON_MEMORY_H_
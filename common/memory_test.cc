@@ -162,6 +162,45 @@ TEST(RegionalMemoryManager, SkippableDestructor) {
   EXPECT_FALSE(deleted);
 }
 
+TEST(PoolingArena, MemoryManagement) {
+  PoolingArena arena;
+  EXPECT_EQ(arena.memory_manager().memory_management(),
+            MemoryManagement::kPooling);
+}
+
+TEST(PoolingArena, InitialBlock) {
+  alignas(std::max_align_t) char block[1024];
+  PoolingArenaOptions options;
+  options.initial_block = block;
+  options.initial_block_size = sizeof(block);
+  PoolingArena arena(options);
+  for (int i = 0; i < 2; ++i) {
+    void* ptr = arena.Allocate(64, alignof(std::max_align_t));
+    EXPECT_GE(static_cast<char*>(ptr), block);
+    EXPECT_LT(static_cast<char*>(ptr), block + sizeof(block));
+    EXPECT_TRUE(arena.Deallocate(ptr, 64, alignof(std::max_align_t)));
+    arena.Reset();
+  }
+}
+
+TEST(PoolingArena, ResetRunsDestructors) {
+  PoolingArena arena;
+  bool deleted = false;
+  {
+    auto shared = arena.memory_manager().MakeShared<std::string>(
+        "a string which is too long for the small string optimization");
+    static_cast<void>(shared);
+  }
+  arena.OwnCustomDestructor(&deleted, [](void* object) {
+    *static_cast<bool*>(object) = true;
+  });
+  EXPECT_FALSE(deleted);
+  arena.Reset();
+  EXPECT_TRUE(deleted);
+  // The arena remains usable after a reset.
+  EXPECT_THAT(arena.Allocate(16, 8), NotNull());
+}
+
 class MemoryManagerTest : public TestWithParam<MemoryManagement> {
  public:
   void SetUp() override {
@@ -242,6 +281,28 @@ class Subobject : public Object {
   using Object::Object;
 };
 
+TEST(MemoryManagerRef, ThreadConfinedReferenceCounting) {
+  MemoryManagerRef memory_manager =
+      MemoryManagerRef::ThreadConfinedReferenceCounting();
+  EXPECT_EQ(memory_manager.memory_management(),
+            MemoryManagement::kReferenceCounting);
+  EXPECT_TRUE(memory_manager.thread_confined());
+  EXPECT_FALSE(MemoryManagerRef::ReferenceCounting().thread_confined());
+  EXPECT_EQ(NativeTypeId::Of(memory_manager),
+            NativeTypeId::For<ReferenceCountingMemoryManager>());
+
+  bool deleted = false;
+  {
+    auto shared = memory_manager.MakeShared<Object>(deleted);
+    {
+      auto copy = shared;
+      EXPECT_EQ(copy.operator->(), shared.operator->());
+    }
+    EXPECT_FALSE(deleted);
+  }
+  EXPECT_TRUE(deleted);
+}
+
 TEST_P(MemoryManagerTest, Shared) {
   bool deleted = false;
   {
@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/base/casts.h"
 #include "absl/base/optimization.h"
 #include "absl/container/inlined_vector.h"
@@ -168,10 +169,15 @@ class SourceImpl : public Source {
 
   absl::string_view description() const final { return description_; }
 
-  absl::Span<const SourcePosition> line_offsets() const final {
+  absl::Span<const SourcePosition> line_offsets() const override {
     return absl::MakeConstSpan(line_offsets_);
   }
 
+ protected:
+  // For implementations computing line offsets on demand.
+  explicit SourceImpl(std::string description)
+      : description_(std::move(description)) {}
+
  private:
   const std::string description_;
   const absl::InlinedVector<SourcePosition, 1> line_offsets_;
@@ -243,6 +249,38 @@ class SupplementalPlaneSource final : public SourceImpl {
   const std::vector<char32_t> text_;
 };
 
+class ContentlessSource final : public SourceImpl {
+ public:
+  ContentlessSource(std::string description,
+                    absl::InlinedVector<SourcePosition, 1> line_offsets)
+      : SourceImpl(std::move(description), std::move(line_offsets)) {}
+
+  ContentView content() const override { return EmptyContentView(); }
+};
+
+// Keeps the text as UTF-8, which is the most compact of the representations,
+// and computes line offsets and, unless the text is ASCII, code points only
+// when asked for.
+class CompactSource final : public SourceImpl {
+ public:
+  CompactSource(std::string description, std::string text, bool ascii)
+      : SourceImpl(std::move(description)),
+        text_(std::move(text)),
+        ascii_(ascii) {}
+
+  ContentView content() const override;
+
+  absl::Span<const SourcePosition> line_offsets() const override;
+
+ private:
+  const std::string text_;
+  const bool ascii_;
+  mutable absl::once_flag decode_once_;
+  mutable SourcePtr decoded_;
+  mutable absl::once_flag line_offsets_once_;
+  mutable std::vector<SourcePosition> line_offsets_;
+};
+
 template <typename T>
 struct SourceTextTraits;
 
@@ -471,6 +509,37 @@ supplemental:
       std::move(description), std::move(line_offsets), std::move(data32));
 }
 
+CompactSource::ContentView CompactSource::content() const {
+  if (ascii_) {
+    return MakeContentView(absl::MakeConstSpan(text_.data(), text_.size()));
+  }
+  absl::call_once(decode_once_, [this]() {
+    // The text was validated on construction.
+    auto decoded = NewSourceImpl(std::string(), absl::string_view(text_),
+                                 text_.size());
+    ABSL_CHECK_OK(decoded);  // Crash OK
+    decoded_ = *std::move(decoded);
+  });
+  return decoded_->content();
+}
+
+absl::Span<const SourcePosition> CompactSource::line_offsets() const {
+  absl::call_once(line_offsets_once_, [this]() {
+    SourcePosition offset = 0;
+    absl::string_view remaining = text_;
+    while (!remaining.empty()) {
+      if (remaining.front() == '\n') {
+        line_offsets_.push_back(offset + 1);
+      }
+      remaining.remove_prefix(
+          ascii_ ? 1 : internal::Utf8Decode(remaining).second);
+      ++offset;
+    }
+    line_offsets_.push_back(offset + 1);
+  });
+  return absl::MakeConstSpan(line_offsets_);
+}
+
 }  // namespace
 
 }  // namespace common_internal
@@ -555,4 +624,28 @@ absl::StatusOr<SourcePtr> NewSource(const absl::Cord& content,
                                         content.size());
 }
 
+absl::StatusOr<SourcePtr> NewCompactSource(absl::string_view content,
+                                           std::string description) {
+  if (ABSL_PREDICT_FALSE(
+          content.size() >
+          static_cast<size_t>(std::numeric_limits<int32_t>::max()))) {
+    return absl::InvalidArgumentError("expression larger than 2GiB limit");
+  }
+  auto [code_points, valid] = internal::Utf8Validate(content);
+  if (ABSL_PREDICT_FALSE(!valid)) {
+    return absl::InvalidArgumentError("cannot parse malformed UTF-8 input");
+  }
+  return std::make_unique<common_internal::CompactSource>(
+      std::move(description), std::string(content),
+      code_points == content.size());
+}
+
+SourcePtr NewContentlessSource(const Source& source) {
+  auto line_offsets = source.line_offsets();
+  return std::make_unique<common_internal::ContentlessSource>(
+      std::string(source.description()),
+      absl::InlinedVector<SourcePosition, 1>(line_offsets.begin(),
+                                             line_offsets.end()));
+}
+
 }  // namespace cel
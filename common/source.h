@@ -178,6 +178,18 @@ absl::StatusOr<SourcePtr> NewSource(absl::string_view content,
 absl::StatusOr<SourcePtr> NewSource(const absl::Cord& content,
                                     std::string description = {});
 
+// Like `NewSource`, but keeps `content` encoded as UTF-8 and computes the line
+// offsets on first use. Expressions which are not ASCII are decoded on the
+// first call to `content()`. Prefer this for sources which are retained but
+// rarely looked at, e.g. to report errors.
+absl::StatusOr<SourcePtr> NewCompactSource(absl::string_view content,
+                                           std::string description = {});
+
+// Returns a copy of `source` without its content, which only keeps the
+// description and line offsets needed to map positions to locations.
+// `Snippet()` always returns an empty `absl::optional`.
+SourcePtr NewContentlessSource(const Source& source);
+
 }  // namespace cel
 
 #endif  // THIRD_PARTY_CEL_CPP_COMMON_SOURCE_H_
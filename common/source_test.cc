@@ -14,6 +14,7 @@
 
 #include "common/source.h"
 
+#include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/types/optional.h"
 #include "internal/testing.h"
@@ -21,7 +22,9 @@
 namespace cel {
 namespace {
 
+using ::cel::internal::StatusIs;
 using testing::ElementsAre;
+using testing::ElementsAreArray;
 using testing::Eq;
 using testing::Optional;
 
@@ -162,5 +165,51 @@ TEST(CordSource, SnippetMulti) {
   EXPECT_THAT(source->Snippet(6), Eq(absl::nullopt));
 }
 
+TEST(CompactSource, Content) {
+  ASSERT_OK_AND_ASSIGN(
+      auto source, NewCompactSource("c.d &&\n\t b.c.arg(10) &&\n\t test(10)",
+                                    "offset-test"));
+
+  EXPECT_THAT(source->description(), Eq("offset-test"));
+  EXPECT_THAT(source->content().ToString(),
+              Eq("c.d &&\n\t b.c.arg(10) &&\n\t test(10)"));
+  EXPECT_THAT(source->line_offsets(), ElementsAre(7, 24, 35));
+  EXPECT_THAT(source->Snippet(2), Optional(Eq("\t b.c.arg(10) &&")));
+}
+
+TEST(CompactSource, NonAsciiContent) {
+  ASSERT_OK_AND_ASSIGN(auto source,
+                       NewCompactSource("'\xf0\x9f\x98\x80' +\n'\xc3\xa9'"));
+  ASSERT_OK_AND_ASSIGN(auto expected,
+                       NewSource("'\xf0\x9f\x98\x80' +\n'\xc3\xa9'"));
+
+  EXPECT_THAT(source->line_offsets(),
+              ElementsAreArray(expected->line_offsets()));
+  EXPECT_EQ(source->content().size(), expected->content().size());
+  EXPECT_EQ(source->content().at(1), expected->content().at(1));
+  EXPECT_THAT(source->Snippet(2), Optional(Eq("'\xc3\xa9'")));
+  EXPECT_THAT(source->GetLocation(7),
+              Optional(Eq(SourceLocation{int32_t{2}, int32_t{1}})));
+}
+
+TEST(CompactSource, MalformedUtf8) {
+  EXPECT_THAT(NewCompactSource("\xff"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(ContentlessSource, PositionAndLocation) {
+  ASSERT_OK_AND_ASSIGN(
+      auto original,
+      NewSource("c.d &&\n\t b.c.arg(10) &&\n\t test(10)", "offset-test"));
+  SourcePtr source = NewContentlessSource(*original);
+
+  EXPECT_THAT(source->description(), Eq("offset-test"));
+  EXPECT_TRUE(source->content().empty());
+  EXPECT_THAT(source->line_offsets(), ElementsAre(7, 24, 35));
+  EXPECT_THAT(source->GetLocation(9),
+              Optional(Eq(SourceLocation{int32_t{2}, int32_t{2}})));
+  EXPECT_THAT(source->Snippet(1), Eq(absl::nullopt));
+}
+
 }  // namespace
 }  // namespace cel
@@ -0,0 +1,157 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// IWYU pragma: private
+
+#ifndef THIRD_PARTY_CEL_CPP_COMMON_TYPES_READ_MOSTLY_CACHE_MAP_H_
+#define THIRD_PARTY_CEL_CPP_COMMON_TYPES_READ_MOSTLY_CACHE_MAP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace cel::common_internal {
+
+// Insert-only hash map whose lookups never lock, for caches which are filled
+// once and then read by many threads, such as the parameterized types of a
+// thread-safe type manager.
+//
+// Entries live in an open addressing table of atomic pointers to immutable
+// nodes. Writers are serialized by a mutex and publish each node with a
+// release store, so a reader either sees a complete entry or an empty slot.
+// When the table grows, the new one is published as a whole and the old one
+// is kept alive, as readers may still be probing it, until the map is
+// destroyed. Nodes are never moved or freed before then either, which is why
+// keys may view into their values.
+//
+// A lookup which misses because it raced with an insertion is answered again
+// by `Insert`, which looks up the key under the mutex first.
+template <typename Key, typename Value, typename Hash, typename Eq>
+class ReadMostlyCacheMap final {
+ public:
+  ReadMostlyCacheMap() {
+    auto table = std::make_unique<Table>(kInitialCapacity);
+    table_.store(table.get(), std::memory_order_relaxed);
+    tables_.push_back(std::move(table));
+  }
+
+  ReadMostlyCacheMap(const ReadMostlyCacheMap&) = delete;
+  ReadMostlyCacheMap& operator=(const ReadMostlyCacheMap&) = delete;
+
+  // Returns the value cached for `key`, or nullptr. `K` may be any type
+  // supported by `Hash` and `Eq`. Never locks.
+  template <typename K>
+  const Value* Find(const K& key) const {
+    return FindIn(*table_.load(std::memory_order_acquire), key);
+  }
+
+  // Caches `value` under `key`, unless a value is cached already, and returns
+  // the cached value.
+  const Value& Insert(Key key, Value value) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    const Table* table = table_.load(std::memory_order_relaxed);
+    if (const Value* cached = FindIn(*table, key); cached != nullptr) {
+      return *cached;
+    }
+    // Keep the load factor at or below one half, so probes stay short.
+    if ((nodes_.size() + 1) * 2 > table->capacity()) {
+      table = Grow(table->capacity() * 2);
+    }
+    const Node& node = nodes_.emplace_back(std::move(key), std::move(value));
+    Place(*table, &node, std::memory_order_release);
+    return node.value;
+  }
+
+ private:
+  static constexpr size_t kInitialCapacity = 16;
+
+  struct Node final {
+    Node(Key key, Value value) : key(std::move(key)), value(std::move(value)) {}
+
+    const Key key;
+    const Value value;
+  };
+
+  class Table final {
+   public:
+    // `capacity` must be a power of two.
+    explicit Table(size_t capacity)
+        : mask_(capacity - 1),
+          slots_(std::make_unique<std::atomic<const Node*>[]>(capacity)) {}
+
+    size_t capacity() const { return mask_ + 1; }
+
+    size_t Next(size_t index) const { return (index + 1) & mask_; }
+
+    size_t Start(size_t hash) const { return hash & mask_; }
+
+    std::atomic<const Node*>& slot(size_t index) const {
+      return slots_[index];
+    }
+
+   private:
+    const size_t mask_;
+    const std::unique_ptr<std::atomic<const Node*>[]> slots_;
+  };
+
+  template <typename K>
+  static const Value* FindIn(const Table& table, const K& key) {
+    for (size_t index = table.Start(Hash{}(key));; index = table.Next(index)) {
+      const Node* node = table.slot(index).load(std::memory_order_acquire);
+      if (node == nullptr) {
+        return nullptr;
+      }
+      if (Eq{}(node->key, key)) {
+        return &node->value;
+      }
+    }
+  }
+
+  static void Place(const Table& table, const Node* node,
+                    std::memory_order order) {
+    size_t index = table.Start(Hash{}(node->key));
+    while (table.slot(index).load(std::memory_order_relaxed) != nullptr) {
+      index = table.Next(index);
+    }
+    table.slot(index).store(node, order);
+  }
+
+  const Table* Grow(size_t capacity) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    auto table = std::make_unique<Table>(capacity);
+    // The table is not visible to readers until it is published below.
+    for (const Node& node : nodes_) {
+      Place(*table, &node, std::memory_order_relaxed);
+    }
+    table_.store(table.get(), std::memory_order_release);
+    tables_.push_back(std::move(table));
+    return tables_.back().get();
+  }
+
+  std::atomic<const Table*> table_;
+  absl::Mutex mutex_;
+  // Owns the current table and those readers may still be probing.
+  std::vector<std::unique_ptr<Table>> tables_ ABSL_GUARDED_BY(mutex_);
+  // Owns the entries. std::deque never moves its elements on insertion.
+  std::deque<Node> nodes_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel::common_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_COMMON_TYPES_READ_MOSTLY_CACHE_MAP_H_
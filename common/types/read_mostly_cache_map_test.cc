@@ -0,0 +1,88 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common/types/read_mostly_cache_map.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "internal/testing.h"
+
+namespace cel::common_internal {
+namespace {
+
+using testing::Eq;
+using testing::IsNull;
+using testing::Pointee;
+
+using IntCacheMap =
+    ReadMostlyCacheMap<int, std::string, absl::Hash<int>, std::equal_to<int>>;
+
+TEST(ReadMostlyCacheMap, FindMissing) {
+  IntCacheMap map;
+  EXPECT_THAT(map.Find(1), IsNull());
+}
+
+TEST(ReadMostlyCacheMap, InsertKeepsFirstValue) {
+  IntCacheMap map;
+  EXPECT_THAT(map.Insert(1, "one"), Eq("one"));
+  EXPECT_THAT(map.Insert(1, "uno"), Eq("one"));
+  EXPECT_THAT(map.Find(1), Pointee(Eq("one")));
+}
+
+TEST(ReadMostlyCacheMap, Grows) {
+  IntCacheMap map;
+  std::vector<const std::string*> values;
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(&map.Insert(i, std::to_string(i)));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    // Entries do not move when the table grows.
+    EXPECT_THAT(map.Find(i), Eq(values[i]));
+    EXPECT_THAT(map.Find(i), Pointee(Eq(std::to_string(i))));
+  }
+  EXPECT_THAT(map.Find(1000), IsNull());
+}
+
+TEST(ReadMostlyCacheMap, ConcurrentInsertAndFind) {
+  constexpr int kThreads = 8;
+  constexpr int kKeys = 512;
+  IntCacheMap map;
+  std::vector<std::thread> threads;
+  threads.reserve(kThreads);
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&map, t]() {
+      for (int i = 0; i < kKeys; ++i) {
+        int key = (i * 7 + t) % kKeys;
+        const std::string* value = map.Find(key);
+        if (value == nullptr) {
+          value = &map.Insert(key, std::to_string(key));
+        }
+        EXPECT_THAT(*value, Eq(std::to_string(key)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int i = 0; i < kKeys; ++i) {
+    EXPECT_THAT(map.Find(i), Pointee(Eq(std::to_string(i))));
+  }
+}
+
+}  // namespace
+}  // namespace cel::common_internal
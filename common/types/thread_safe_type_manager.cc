@@ -17,7 +17,6 @@
 #include <utility>
 
 #include "absl/strings/string_view.h"
-#include "absl/synchronization/mutex.h"
 #include "common/sized_input_view.h"
 #include "common/type.h"
 #include "common/types/type_cache.h"
@@ -25,44 +24,31 @@
 namespace cel::common_internal {
 
 ListType ThreadSafeTypeManager::CreateListTypeImpl(TypeView element) {
-  {
-    absl::ReaderMutexLock lock(&list_types_mutex_);
-    if (auto list_type = list_types_.find(element);
-        list_type != list_types_.end()) {
-      return list_type->second;
-    }
+  if (const ListType* list_type = list_types_.Find(element);
+      list_type != nullptr) {
+    return *list_type;
   }
   ListType list_type(GetMemoryManager(), Type(element));
-  absl::WriterMutexLock lock(&list_types_mutex_);
-  return list_types_.insert({list_type.element(), list_type}).first->second;
+  return list_types_.Insert(list_type.element(), list_type);
 }
 
 MapType ThreadSafeTypeManager::CreateMapTypeImpl(TypeView key, TypeView value) {
-  {
-    absl::ReaderMutexLock lock(&map_types_mutex_);
-    if (auto map_type = map_types_.find(std::make_pair(key, value));
-        map_type != map_types_.end()) {
-      return map_type->second;
-    }
+  if (const MapType* map_type = map_types_.Find(std::make_pair(key, value));
+      map_type != nullptr) {
+    return *map_type;
   }
   MapType map_type(GetMemoryManager(), Type(key), Type(value));
-  absl::WriterMutexLock lock(&map_types_mutex_);
-  return map_types_
-      .insert({std::make_pair(map_type.key(), map_type.value()), map_type})
-      .first->second;
+  return map_types_.Insert(std::make_pair(map_type.key(), map_type.value()),
+                           map_type);
 }
 
 StructType ThreadSafeTypeManager::CreateStructTypeImpl(absl::string_view name) {
-  {
-    absl::ReaderMutexLock lock(&struct_types_mutex_);
-    if (auto struct_type = struct_types_.find(name);
-        struct_type != struct_types_.end()) {
-      return struct_type->second;
-    }
+  if (const StructType* struct_type = struct_types_.Find(name);
+      struct_type != nullptr) {
+    return *struct_type;
   }
   StructType struct_type(GetMemoryManager(), name);
-  absl::WriterMutexLock lock(&struct_types_mutex_);
-  return struct_types_.insert({struct_type.name(), struct_type}).first->second;
+  return struct_types_.Insert(struct_type.name(), struct_type);
 }
 
 OpaqueType ThreadSafeTypeManager::CreateOpaqueTypeImpl(
@@ -72,21 +58,16 @@ OpaqueType ThreadSafeTypeManager::CreateOpaqueTypeImpl(
       opaque_type.has_value()) {
     return OpaqueType(*opaque_type);
   }
-  {
-    absl::ReaderMutexLock lock(&opaque_types_mutex_);
-    if (auto opaque_type = opaque_types_.find(
-            OpaqueTypeKeyView{.name = name, .parameters = parameters});
-        opaque_type != opaque_types_.end()) {
-      return opaque_type->second;
-    }
+  if (const OpaqueType* opaque_type = opaque_types_.Find(
+          OpaqueTypeKeyView{.name = name, .parameters = parameters});
+      opaque_type != nullptr) {
+    return *opaque_type;
   }
   OpaqueType opaque_type(GetMemoryManager(), name, parameters);
-  absl::WriterMutexLock lock(&opaque_types_mutex_);
-  return opaque_types_
-      .insert({OpaqueTypeKey{.name = opaque_type.name(),
-                             .parameters = opaque_type.parameters()},
-               opaque_type})
-      .first->second;
+  return opaque_types_.Insert(
+      OpaqueTypeKey{.name = opaque_type.name(),
+                    .parameters = opaque_type.parameters()},
+      opaque_type);
 }
 
 }  // namespace cel::common_internal
@@ -17,16 +17,17 @@
 #ifndef THIRD_PARTY_CEL_CPP_COMMON_TYPES_THREAD_SAFE_TYPE_MANAGER_H_
 #define THIRD_PARTY_CEL_CPP_COMMON_TYPES_THREAD_SAFE_TYPE_MANAGER_H_
 
+#include <functional>
 #include <utility>
 
-#include "absl/base/thread_annotations.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/string_view.h"
-#include "absl/synchronization/mutex.h"
 #include "common/memory.h"
 #include "common/sized_input_view.h"
 #include "common/type.h"
 #include "common/type_introspector.h"
 #include "common/type_manager.h"
+#include "common/types/read_mostly_cache_map.h"
 #include "common/types/type_cache.h"
 
 namespace cel::common_internal {
@@ -55,16 +56,29 @@ class ThreadSafeTypeManager : public virtual TypeManager {
   OpaqueType CreateOpaqueTypeImpl(
       absl::string_view name, const SizedInputView<TypeView>& parameters) final;
 
+  // Parameterized types are created on first use and then looked up by every
+  // evaluation that needs them, so lookups must not contend.
+  using ListTypeCache =
+      ReadMostlyCacheMap<TypeView, ListType, absl::Hash<TypeView>,
+                         std::equal_to<TypeView>>;
+  using MapTypeCache =
+      ReadMostlyCacheMap<std::pair<TypeView, TypeView>, MapType,
+                         absl::Hash<std::pair<TypeView, TypeView>>,
+                         std::equal_to<std::pair<TypeView, TypeView>>>;
+  using StructTypeCache =
+      ReadMostlyCacheMap<absl::string_view, StructType,
+                         absl::Hash<absl::string_view>,
+                         std::equal_to<absl::string_view>>;
+  using OpaqueTypeCache =
+      ReadMostlyCacheMap<OpaqueTypeKey, OpaqueType, OpaqueTypeKeyHash,
+                         OpaqueTypeKeyEqualTo>;
+
   MemoryManagerRef memory_manager_;
   Shared<TypeIntrospector> type_introspector_;
-  absl::Mutex list_types_mutex_;
-  ListTypeCacheMap list_types_ ABSL_GUARDED_BY(list_types_mutex_);
-  absl::Mutex map_types_mutex_;
-  MapTypeCacheMap map_types_ ABSL_GUARDED_BY(map_types_mutex_);
-  absl::Mutex struct_types_mutex_;
-  StructTypeCacheMap struct_types_ ABSL_GUARDED_BY(struct_types_mutex_);
-  absl::Mutex opaque_types_mutex_;
-  OpaqueTypeCacheMap opaque_types_ ABSL_GUARDED_BY(opaque_types_mutex_);
+  ListTypeCache list_types_;
+  MapTypeCache map_types_;
+  StructTypeCache struct_types_;
+  OpaqueTypeCache opaque_types_;
 };
 
 }  // namespace cel::common_internal
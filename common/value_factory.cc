@@ -357,4 +357,8 @@ OptionalValueView ValueFactory::GetZeroDynOptionalValue() {
   return ProcessLocalValueCache::Get()->GetEmptyDynOptionalValue();
 }
 
+StringValue ValueFactory::CreateInternedStringValue(absl::string_view value) {
+  return ProcessLocalValueCache::Get()->GetInternedStringValue(value);
+}
+
 }  // namespace cel
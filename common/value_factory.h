@@ -131,6 +131,12 @@ class ValueFactory : public virtual TypeFactory {
         absl::MakeCordFromExternal(value, std::forward<Releaser>(releaser)));
   }
 
+  // Returns a `StringValue` for `value` backed by a process wide intern table,
+  // which is cheaper to create and copy repeatedly than `CreateStringValue`.
+  // Interned strings are never released, so this should only be used for
+  // strings from a bounded set, e.g. field names.
+  StringValue CreateInternedStringValue(absl::string_view value);
+
   StringValue CreateUncheckedStringValue(const char* value) {
     return StringValue(value);
   }
@@ -333,6 +333,20 @@ TEST_P(ValueFactoryTest, OptionalType) {
             ProcessLocalTypeCache::Get()->GetDynOptionalType());
 }
 
+TEST_P(ValueFactoryTest, InternedStringValue) {
+  const std::string name = "a_field_name_longer_than_inline_capacity";
+  auto value = value_factory().CreateInternedStringValue(name);
+  EXPECT_EQ(value.NativeString(), name);
+  auto other = value_factory().CreateInternedStringValue(name);
+  // Both refer to the same interned storage, not to a copy.
+  std::string scratch;
+  EXPECT_EQ(value.NativeString(scratch).data(),
+            other.NativeString(scratch).data());
+  EXPECT_NE(value.NativeString(scratch).data(), name.data());
+  EXPECT_EQ(value_factory().CreateInternedStringValue("short").NativeString(),
+            "short");
+}
+
 INSTANTIATE_TEST_SUITE_P(
     ValueFactoryTest, ValueFactoryTest,
     ::testing::Combine(::testing::Values(MemoryManagement::kPooling,
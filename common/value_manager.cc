@@ -16,6 +16,7 @@
 
 #include <utility>
 
+#include "absl/log/absl_check.h"
 #include "common/memory.h"
 #include "common/type_reflector.h"
 #include "common/values/thread_compatible_value_manager.h"
@@ -32,6 +33,9 @@ Shared<ValueManager> NewThreadCompatibleValueManager(
 
 Shared<ValueManager> NewThreadSafeValueManager(
     MemoryManagerRef memory_manager, Shared<TypeReflector> type_reflector) {
+  ABSL_DCHECK(!memory_manager.thread_confined())
+      << "thread confined reference counting requires a thread compatible "
+         "value manager";
   return memory_manager.MakeShared<common_internal::ThreadSafeValueManager>(
       memory_manager, std::move(type_reflector));
 }
@@ -0,0 +1,87 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how value managers scale with the number of threads using them:
+// one thread safe manager shared by every thread, or one thread compatible
+// manager per thread.
+
+#include "absl/types/optional.h"
+#include "common/memory.h"
+#include "common/type.h"
+#include "common/type_reflector.h"
+#include "common/value.h"
+#include "common/value_manager.h"
+#include "internal/benchmark.h"
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+enum class Sharing {
+  // One ThreadSafeValueManager shared by all of the threads.
+  kShared = 0,
+  // One ThreadCompatibleValueManager per thread.
+  kPerThread = 1,
+};
+
+// Only set while a kShared benchmark runs.
+absl::optional<Shared<ValueManager>> shared_value_manager;
+
+// Creates the types and values typical of an evaluation: parameterized types,
+// which are interned by the manager, their empty values and strings.
+void CreateValues(ValueManager& value_manager) {
+  ListType list_type = value_manager.CreateListType(IntTypeView());
+  benchmark::DoNotOptimize(value_manager.CreateZeroListValue(list_type));
+  MapType map_type =
+      value_manager.CreateMapType(StringTypeView(), DynTypeView());
+  benchmark::DoNotOptimize(value_manager.CreateZeroMapValue(map_type));
+  benchmark::DoNotOptimize(value_manager.GetZeroDynListValue());
+  benchmark::DoNotOptimize(
+      value_manager.CreateStringValue("a string too long to be inlined"));
+}
+
+void BM_ValueManager(benchmark::State& state) {
+  auto sharing = static_cast<Sharing>(state.range(0));
+  MemoryManagerRef memory_manager = MemoryManagerRef::ReferenceCounting();
+
+  absl::optional<Shared<ValueManager>> thread_value_manager;
+  if (sharing == Sharing::kPerThread) {
+    thread_value_manager = NewThreadCompatibleValueManager(
+        memory_manager, NewThreadCompatibleTypeReflector(memory_manager));
+  } else if (state.thread_index() == 0) {
+    // The other threads wait for the first iteration to start, so the
+    // manager is set before any of them uses it.
+    shared_value_manager = NewThreadSafeValueManager(
+        memory_manager, NewThreadSafeTypeReflector(memory_manager));
+  }
+
+  for (auto _ : state) {
+    CreateValues(sharing == Sharing::kShared ? **shared_value_manager
+                                             : **thread_value_manager);
+  }
+
+  if (sharing == Sharing::kShared && state.thread_index() == 0) {
+    shared_value_manager.reset();
+  }
+}
+
+BENCHMARK(BM_ValueManager)
+    ->ArgName("per_thread")
+    ->Arg(static_cast<int>(Sharing::kShared))
+    ->Arg(static_cast<int>(Sharing::kPerThread))
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace cel
@@ -55,7 +55,7 @@ class BytesValue final {
   explicit BytesValue(absl::Cord value) noexcept : value_(std::move(value)) {}
 
   explicit BytesValue(absl::string_view value) noexcept
-      : value_(absl::Cord(value)) {}
+      : value_(common_internal::SharedByteStringView(value)) {}
 
   template <typename T, typename = std::enable_if_t<std::is_same_v<
                             absl::remove_cvref_t<T>, std::string>>>
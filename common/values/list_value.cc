@@ -24,10 +24,23 @@ namespace cel {
 
 namespace common_internal {
 
-absl::StatusOr<ValueView> ListValueEqual(ValueManager& value_manager,
-                                         ListValueView lhs, ListValueView rhs,
-                                         Value& scratch) {
-  if (Is(lhs, rhs)) {
+namespace {
+
+// Whether `lhs` and `rhs` are the same list, which then needs no element by
+// element comparison.
+bool IsSameList(ListValueView lhs, ListValueView rhs) { return Is(lhs, rhs); }
+
+bool IsSameList(const ParsedListValueInterface& lhs, ListValueView rhs) {
+  auto parsed_rhs = As<ParsedListValueView>(rhs);
+  return parsed_rhs.has_value() && parsed_rhs->operator->() == &lhs;
+}
+
+template <typename LhsList>
+absl::StatusOr<ValueView> ListValueEqualImpl(ValueManager& value_manager,
+                                             const LhsList& lhs,
+                                             ListValueView rhs,
+                                             Value& scratch) {
+  if (IsSameList(lhs, rhs)) {
     return BoolValueView{true};
   }
   const auto lhs_size = lhs.Size();
@@ -43,7 +56,7 @@ absl::StatusOr<ValueView> ListValueEqual(ValueManager& value_manager,
     ABSL_CHECK(lhs_iterator->HasNext());  // Crash OK
     ABSL_CHECK(rhs_iterator->HasNext());  // Crash OK
     CEL_ASSIGN_OR_RETURN(auto lhs_element, lhs_iterator->Next(lhs_scratch));
-    CEL_ASSIGN_OR_RETURN(auto rhs_element, rhs_iterator->Next(lhs_scratch));
+    CEL_ASSIGN_OR_RETURN(auto rhs_element, rhs_iterator->Next(rhs_scratch));
     CEL_ASSIGN_OR_RETURN(
         auto result, lhs_element.Equal(value_manager, rhs_element, scratch));
     if (auto bool_value = As<BoolValueView>(result);
@@ -56,33 +69,18 @@ absl::StatusOr<ValueView> ListValueEqual(ValueManager& value_manager,
   return BoolValueView{true};
 }
 
+}  // namespace
+
+absl::StatusOr<ValueView> ListValueEqual(ValueManager& value_manager,
+                                         ListValueView lhs, ListValueView rhs,
+                                         Value& scratch) {
+  return ListValueEqualImpl(value_manager, lhs, rhs, scratch);
+}
+
 absl::StatusOr<ValueView> ListValueEqual(ValueManager& value_manager,
                                          const ParsedListValueInterface& lhs,
                                          ListValueView rhs, Value& scratch) {
-  const auto lhs_size = lhs.Size();
-  const auto rhs_size = rhs.Size();
-  if (lhs_size != rhs_size) {
-    return BoolValueView{false};
-  }
-  CEL_ASSIGN_OR_RETURN(auto lhs_iterator, lhs.NewIterator(value_manager));
-  CEL_ASSIGN_OR_RETURN(auto rhs_iterator, rhs.NewIterator(value_manager));
-  Value lhs_scratch;
-  Value rhs_scratch;
-  for (size_t index = 0; index < lhs_size; ++index) {
-    ABSL_CHECK(lhs_iterator->HasNext());  // Crash OK
-    ABSL_CHECK(rhs_iterator->HasNext());  // Crash OK
-    CEL_ASSIGN_OR_RETURN(auto lhs_element, lhs_iterator->Next(lhs_scratch));
-    CEL_ASSIGN_OR_RETURN(auto rhs_element, rhs_iterator->Next(lhs_scratch));
-    CEL_ASSIGN_OR_RETURN(
-        auto result, lhs_element.Equal(value_manager, rhs_element, scratch));
-    if (auto bool_value = As<BoolValueView>(result);
-        bool_value.has_value() && !bool_value->NativeValue()) {
-      return result;
-    }
-  }
-  ABSL_DCHECK(!lhs_iterator->HasNext());
-  ABSL_DCHECK(!rhs_iterator->HasNext());
-  return BoolValueView{true};
+  return ListValueEqualImpl(value_manager, lhs, rhs, scratch);
 }
 
 }  // namespace common_internal
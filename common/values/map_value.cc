@@ -16,7 +16,6 @@
 #include <tuple>
 
 #include "absl/base/attributes.h"
-#include "absl/log/absl_check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
@@ -38,77 +37,68 @@ absl::Status InvalidMapKeyTypeError(ValueKind kind) {
 
 namespace common_internal {
 
-absl::StatusOr<ValueView> MapValueEqual(ValueManager& value_manager,
-                                        MapValueView lhs, MapValueView rhs,
-                                        Value& scratch) {
-  if (Is(lhs, rhs)) {
+namespace {
+
+// Whether `lhs` and `rhs` are the same map, which then needs no entry by entry
+// comparison.
+bool IsSameMap(MapValueView lhs, MapValueView rhs) { return Is(lhs, rhs); }
+
+bool IsSameMap(const ParsedMapValueInterface& lhs, MapValueView rhs) {
+  auto parsed_rhs = As<ParsedMapValueView>(rhs);
+  return parsed_rhs.has_value() && parsed_rhs->operator->() == &lhs;
+}
+
+// Visits the entries of `lhs` once, looking each key up in `rhs`, rather than
+// iterating the keys of `lhs` and looking each of them up in `lhs` again.
+template <typename LhsMap>
+absl::StatusOr<ValueView> MapValueEqualImpl(ValueManager& value_manager,
+                                            const LhsMap& lhs,
+                                            MapValueView rhs, Value& scratch) {
+  if (IsSameMap(lhs, rhs)) {
     return BoolValueView{true};
   }
-  const auto lhs_size = lhs.Size();
-  const auto rhs_size = rhs.Size();
-  if (lhs_size != rhs_size) {
+  if (lhs.Size() != rhs.Size()) {
     return BoolValueView{false};
   }
-  CEL_ASSIGN_OR_RETURN(auto lhs_iterator, lhs.NewIterator(value_manager));
-  Value lhs_key_scratch;
+  ValueView result = BoolValueView{true};
   Value rhs_value_scratch;
-  ValueView rhs_value;
-  Value lhs_value_scratch;
-  for (size_t index = 0; index < lhs_size; ++index) {
-    ABSL_CHECK(lhs_iterator->HasNext());  // Crash OK
-    CEL_ASSIGN_OR_RETURN(auto lhs_key, lhs_iterator->Next(lhs_key_scratch));
-    bool rhs_value_found;
-    CEL_ASSIGN_OR_RETURN(std::tie(rhs_value, rhs_value_found),
-                         rhs.Find(value_manager, lhs_key, rhs_value_scratch));
-    if (!rhs_value_found) {
-      return BoolValueView{false};
-    }
-    CEL_ASSIGN_OR_RETURN(auto lhs_value,
-                         lhs.Get(value_manager, lhs_key, lhs_value_scratch));
-    CEL_ASSIGN_OR_RETURN(auto result,
-                         lhs_value.Equal(value_manager, rhs_value, scratch));
-    if (auto bool_value = As<BoolValueView>(result);
-        bool_value.has_value() && !bool_value->NativeValue()) {
-      return result;
-    }
-  }
-  ABSL_DCHECK(!lhs_iterator->HasNext());
-  return BoolValueView{true};
+  CEL_RETURN_IF_ERROR(lhs.ForEach(
+      value_manager,
+      [&value_manager, &scratch, &rhs, &rhs_value_scratch, &result](
+          ValueView lhs_key, ValueView lhs_value) -> absl::StatusOr<bool> {
+        ValueView rhs_value;
+        bool rhs_value_found;
+        CEL_ASSIGN_OR_RETURN(
+            std::tie(rhs_value, rhs_value_found),
+            rhs.Find(value_manager, lhs_key, rhs_value_scratch));
+        if (!rhs_value_found) {
+          result = BoolValueView{false};
+          return false;
+        }
+        CEL_ASSIGN_OR_RETURN(
+            auto equal, lhs_value.Equal(value_manager, rhs_value, scratch));
+        if (auto bool_value = As<BoolValueView>(equal);
+            bool_value.has_value() && !bool_value->NativeValue()) {
+          result = equal;
+          return false;
+        }
+        return true;
+      }));
+  return result;
+}
+
+}  // namespace
+
+absl::StatusOr<ValueView> MapValueEqual(ValueManager& value_manager,
+                                        MapValueView lhs, MapValueView rhs,
+                                        Value& scratch) {
+  return MapValueEqualImpl(value_manager, lhs, rhs, scratch);
 }
 
 absl::StatusOr<ValueView> MapValueEqual(ValueManager& value_manager,
                                         const ParsedMapValueInterface& lhs,
                                         MapValueView rhs, Value& scratch) {
-  const auto lhs_size = lhs.Size();
-  const auto rhs_size = rhs.Size();
-  if (lhs_size != rhs_size) {
-    return BoolValueView{false};
-  }
-  CEL_ASSIGN_OR_RETURN(auto lhs_iterator, lhs.NewIterator(value_manager));
-  Value lhs_key_scratch;
-  Value rhs_value_scratch;
-  ValueView rhs_value;
-  Value lhs_value_scratch;
-  for (size_t index = 0; index < lhs_size; ++index) {
-    ABSL_CHECK(lhs_iterator->HasNext());  // Crash OK
-    CEL_ASSIGN_OR_RETURN(auto lhs_key, lhs_iterator->Next(lhs_key_scratch));
-    bool rhs_value_found;
-    CEL_ASSIGN_OR_RETURN(std::tie(rhs_value, rhs_value_found),
-                         rhs.Find(value_manager, lhs_key, rhs_value_scratch));
-    if (!rhs_value_found) {
-      return BoolValueView{false};
-    }
-    CEL_ASSIGN_OR_RETURN(auto lhs_value,
-                         lhs.Get(value_manager, lhs_key, lhs_value_scratch));
-    CEL_ASSIGN_OR_RETURN(auto result,
-                         lhs_value.Equal(value_manager, rhs_value, scratch));
-    if (auto bool_value = As<BoolValueView>(result);
-        bool_value.has_value() && !bool_value->NativeValue()) {
-      return result;
-    }
-  }
-  ABSL_DCHECK(!lhs_iterator->HasNext());
-  return BoolValueView{true};
+  return MapValueEqualImpl(value_manager, lhs, rhs, scratch);
 }
 
 }  // namespace common_internal
@@ -22,6 +22,7 @@
 #include "common/native_type.h"
 #include "common/type.h"
 #include "common/value.h"
+#include "common/values/value_cache.h"
 
 namespace cel {
 
@@ -62,12 +63,28 @@ std::string OptionalValueInterface::DebugString() const {
   return "optional.none()";
 }
 
-OptionalValue OptionalValue::Of(MemoryManagerRef memory_manager,
-                                cel::Value value) {
+namespace common_internal {
+
+OptionalValue MakeFullOptionalValue(MemoryManagerRef memory_manager,
+                                    cel::Value value) {
   return OptionalValue(
       memory_manager.MakeShared<FullOptionalValue>(std::move(value)));
 }
 
+}  // namespace common_internal
+
+OptionalValue OptionalValue::Of(MemoryManagerRef memory_manager,
+                                cel::Value value) {
+  if (auto cached =
+          common_internal::ProcessLocalValueCache::Get()->GetFullOptionalValue(
+              value);
+      cached.has_value()) {
+    return OptionalValue(*cached);
+  }
+  return common_internal::MakeFullOptionalValue(memory_manager,
+                                                std::move(value));
+}
+
 absl::StatusOr<ValueView> OptionalValueInterface::Equal(
     ValueManager& value_manager, ValueView other, cel::Value& scratch) const {
   if (auto other_value = As<OptionalValueView>(other);
@@ -127,6 +127,22 @@ TEST_P(OptionalValueTest, Value) {
   EXPECT_EQ(Cast<IntValueView>(element), IntValue());
 }
 
+TEST_P(OptionalValueTest, CachedScalars) {
+  Value scratch;
+  auto value = OptionalOf(BoolValue(true));
+  EXPECT_EQ(&*value, &*OptionalOf(BoolValue(true)));
+  EXPECT_NE(&*value, &*OptionalOf(BoolValue(false)));
+  EXPECT_EQ(Cast<BoolValueView>(value.Value(scratch)), BoolValue(true));
+  EXPECT_EQ(value.GetType(type_manager()),
+            type_manager().CreateOptionalType(BoolType()));
+  EXPECT_EQ(&*OptionalOf(NullValue()), &*OptionalOf(NullValue()));
+  EXPECT_EQ(&*OptionalOf(IntValue(0)), &*OptionalOf(IntValue(0)));
+  EXPECT_EQ(&*OptionalOf(UintValue(0)), &*OptionalOf(UintValue(0)));
+  value = OptionalOf(IntValue(1));
+  EXPECT_NE(&*value, &*OptionalOf(IntValue(1)));
+  EXPECT_EQ(Cast<IntValueView>(value.Value(scratch)), IntValue(1));
+}
+
 INSTANTIATE_TEST_SUITE_P(
     OptionalValueTest, OptionalValueTest,
     ::testing::Values(MemoryManagement::kPooling,
@@ -46,6 +46,10 @@ class StringValue;
 class StringValueView;
 class TypeManager;
 
+namespace common_internal {
+class ProcessLocalValueCache;
+}  // namespace common_internal
+
 // `StringValue` represents values of the primitive `string` type.
 class StringValue final {
  public:
@@ -56,7 +60,7 @@ class StringValue final {
   explicit StringValue(absl::Cord value) noexcept : value_(std::move(value)) {}
 
   explicit StringValue(absl::string_view value) noexcept
-      : value_(absl::Cord(value)) {}
+      : value_(common_internal::SharedByteStringView(value)) {}
 
   template <typename T, typename = std::enable_if_t<std::is_same_v<
                             absl::remove_cvref_t<T>, std::string>>>
@@ -164,6 +168,10 @@ class StringValue final {
 
  private:
   friend class StringValueView;
+  friend class common_internal::ProcessLocalValueCache;
+
+  explicit StringValue(common_internal::SharedByteString value) noexcept
+      : value_(std::move(value)) {}
 
   common_internal::SharedByteString value_;
 };
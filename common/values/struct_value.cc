@@ -13,9 +13,7 @@
 // limitations under the License.
 
 #include <cstddef>
-#include <string>
 
-#include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "common/casting.h"
@@ -24,89 +22,72 @@
 
 namespace cel::common_internal {
 
-absl::StatusOr<ValueView> StructValueEqual(ValueManager& value_manager,
-                                           StructValueView lhs,
-                                           StructValueView rhs,
-                                           Value& scratch) {
+namespace {
+
+// Compares the fields of `lhs` with those of `rhs` one by one, looking each
+// field of `lhs` up in `rhs` by name, without copying the fields of either.
+template <typename LhsStruct>
+absl::StatusOr<ValueView> StructValueEqualImpl(ValueManager& value_manager,
+                                               const LhsStruct& lhs,
+                                               StructValueView rhs,
+                                               Value& scratch) {
   if (lhs.GetTypeName() != rhs.GetTypeName()) {
     return BoolValueView{false};
   }
-  absl::flat_hash_map<std::string, Value> lhs_fields;
-  CEL_RETURN_IF_ERROR(lhs.ForEachField(
-      value_manager,
-      [&lhs_fields](absl::string_view name,
-                    ValueView lhs_value) -> absl::StatusOr<bool> {
-        lhs_fields.insert_or_assign(std::string(name), Value(lhs_value));
-        return true;
-      }));
   bool equal = true;
-  size_t rhs_fields_count = 0;
-  CEL_RETURN_IF_ERROR(rhs.ForEachField(
+  size_t lhs_fields_count = 0;
+  Value rhs_scratch;
+  CEL_RETURN_IF_ERROR(lhs.ForEachField(
       value_manager,
-      [&value_manager, &scratch, &lhs_fields, &equal, &rhs_fields_count](
-          absl::string_view name, ValueView rhs_value) -> absl::StatusOr<bool> {
-        auto lhs_field = lhs_fields.find(name);
-        if (lhs_field == lhs_fields.end()) {
+      [&value_manager, &scratch, &rhs, &rhs_scratch, &equal,
+       &lhs_fields_count](absl::string_view name,
+                          ValueView lhs_value) -> absl::StatusOr<bool> {
+        CEL_ASSIGN_OR_RETURN(auto rhs_has_field, rhs.HasFieldByName(name));
+        if (!rhs_has_field) {
           equal = false;
           return false;
         }
         CEL_ASSIGN_OR_RETURN(
-            auto result,
-            lhs_field->second.Equal(value_manager, rhs_value, scratch));
+            auto rhs_value,
+            rhs.GetFieldByName(value_manager, name, rhs_scratch));
+        CEL_ASSIGN_OR_RETURN(
+            auto result, lhs_value.Equal(value_manager, rhs_value, scratch));
         if (auto bool_value = As<BoolValueView>(result);
             bool_value.has_value() && !bool_value->NativeValue()) {
           equal = false;
           return false;
         }
-        ++rhs_fields_count;
+        ++lhs_fields_count;
         return true;
       }));
-  if (!equal || rhs_fields_count != lhs_fields.size()) {
+  if (!equal) {
     return BoolValueView{false};
   }
-  return BoolValueView{true};
+  // Every field set in `lhs` is set in `rhs`, so both have the same fields if
+  // they have the same number of them.
+  size_t rhs_fields_count = 0;
+  CEL_RETURN_IF_ERROR(rhs.ForEachField(
+      value_manager,
+      [lhs_fields_count, &rhs_fields_count](
+          absl::string_view, ValueView) -> absl::StatusOr<bool> {
+        return ++rhs_fields_count <= lhs_fields_count;
+      }));
+  return BoolValueView{rhs_fields_count == lhs_fields_count};
+}
+
+}  // namespace
+
+absl::StatusOr<ValueView> StructValueEqual(ValueManager& value_manager,
+                                           StructValueView lhs,
+                                           StructValueView rhs,
+                                           Value& scratch) {
+  return StructValueEqualImpl(value_manager, lhs, rhs, scratch);
 }
 
 absl::StatusOr<ValueView> StructValueEqual(
     ValueManager& value_manager, const ParsedStructValueInterface& lhs,
     StructValueView rhs, Value& scratch) {
-  if (lhs.GetTypeName() != rhs.GetTypeName()) {
-    return BoolValueView{false};
-  }
-  absl::flat_hash_map<std::string, Value> lhs_fields;
-  CEL_RETURN_IF_ERROR(lhs.ForEachField(
-      value_manager,
-      [&lhs_fields](absl::string_view name,
-                    ValueView lhs_value) -> absl::StatusOr<bool> {
-        lhs_fields.insert_or_assign(std::string(name), Value(lhs_value));
-        return true;
-      }));
-  bool equal = true;
-  size_t rhs_fields_count = 0;
-  CEL_RETURN_IF_ERROR(rhs.ForEachField(
-      value_manager,
-      [&value_manager, &scratch, &lhs_fields, &equal, &rhs_fields_count](
-          absl::string_view name, ValueView rhs_value) -> absl::StatusOr<bool> {
-        auto lhs_field = lhs_fields.find(name);
-        if (lhs_field == lhs_fields.end()) {
-          equal = false;
-          return false;
-        }
-        CEL_ASSIGN_OR_RETURN(
-            auto result,
-            lhs_field->second.Equal(value_manager, rhs_value, scratch));
-        if (auto bool_value = As<BoolValueView>(result);
-            bool_value.has_value() && !bool_value->NativeValue()) {
-          equal = false;
-          return false;
-        }
-        ++rhs_fields_count;
-        return true;
-      }));
-  if (!equal || rhs_fields_count != lhs_fields.size()) {
-    return BoolValueView{false};
-  }
-  return BoolValueView{true};
+  return StructValueEqualImpl(value_manager, lhs, rhs, scratch);
 }
 
 }  // namespace cel::common_internal
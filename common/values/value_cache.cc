@@ -18,11 +18,17 @@
 
 #include "absl/log/absl_check.h"
 #include "absl/status/status.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "common/casting.h"
+#include "common/internal/shared_byte_string.h"
 #include "common/memory.h"
 #include "common/type.h"
 #include "common/types/type_cache.h"
 #include "common/value.h"
+#include "common/value_kind.h"
 #include "internal/no_destructor.h"
 
 namespace cel::common_internal {
@@ -93,6 +99,53 @@ OptionalValueView ProcessLocalValueCache::GetEmptyDynOptionalValue() const {
   return *dyn_optional_value_;
 }
 
+absl::optional<OptionalValueView> ProcessLocalValueCache::GetFullOptionalValue(
+    ValueView value) const {
+  switch (value.kind()) {
+    case ValueKind::kNull:
+      return *null_optional_value_;
+    case ValueKind::kBool:
+      if (Cast<BoolValueView>(value).NativeValue()) {
+        return *true_optional_value_;
+      }
+      return *false_optional_value_;
+    case ValueKind::kInt:
+      if (Cast<IntValueView>(value).NativeValue() == 0) {
+        return *int_zero_optional_value_;
+      }
+      break;
+    case ValueKind::kUint:
+      if (Cast<UintValueView>(value).NativeValue() == 0) {
+        return *uint_zero_optional_value_;
+      }
+      break;
+    default:
+      break;
+  }
+  return absl::nullopt;
+}
+
+StringValue ProcessLocalValueCache::GetInternedStringValue(
+    absl::string_view value) const {
+  if (value.size() <= SharedByteString::kInlineCapacity) {
+    // Stored inline, there is nothing to share.
+    return StringValue(SharedByteString(absl::Cord(value)));
+  }
+  absl::string_view interned;
+  {
+    absl::ReaderMutexLock lock(&interned_strings_mutex_);
+    if (auto it = interned_strings_.find(value);
+        it != interned_strings_.end()) {
+      interned = *it;
+    }
+  }
+  if (interned.data() == nullptr) {
+    absl::MutexLock lock(&interned_strings_mutex_);
+    interned = *interned_strings_.emplace(value).first;
+  }
+  return StringValue(SharedByteString(interned));
+}
+
 ProcessLocalValueCache::ProcessLocalValueCache()
     : default_error_value_(absl::UnknownError("unknown error")) {
   MemoryManagerRef memory_manager = MemoryManagerRef::Unmanaged();
@@ -144,6 +197,14 @@ ProcessLocalValueCache::ProcessLocalValueCache()
   dyn_optional_value_ =
       GetEmptyOptionalValue(ProcessLocalTypeCache::Get()->GetDynOptionalType());
   ABSL_DCHECK(dyn_optional_value_.has_value());
+  null_optional_value_ = MakeFullOptionalValue(memory_manager, NullValue());
+  false_optional_value_ =
+      MakeFullOptionalValue(memory_manager, BoolValue(false));
+  true_optional_value_ = MakeFullOptionalValue(memory_manager, BoolValue(true));
+  int_zero_optional_value_ =
+      MakeFullOptionalValue(memory_manager, IntValue(0));
+  uint_zero_optional_value_ =
+      MakeFullOptionalValue(memory_manager, UintValue(0));
 }
 
 }  // namespace cel::common_internal
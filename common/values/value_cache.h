@@ -26,8 +26,11 @@
 #include "absl/base/nullability.h"
 #include "absl/base/optimization.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "common/json.h"
 #include "common/native_type.h"
@@ -68,6 +71,19 @@ class ProcessLocalValueCache final {
 
   OptionalValueView GetEmptyDynOptionalValue() const;
 
+  // Returns the cached `optional.of(value)`, which exists for `null`, the
+  // booleans and the zero `int` and `uint` values. These are the most common
+  // payloads of optional field selections, and returning them does not
+  // allocate.
+  absl::optional<OptionalValueView> GetFullOptionalValue(
+      ValueView value) const;
+
+  // Returns a `StringValue` for `value` whose contents are owned by the cache.
+  // Copying it never allocates nor touches a reference count. Strings are kept
+  // for the lifetime of the process, so this must only be used for strings
+  // from a bounded set, such as field names.
+  StringValue GetInternedStringValue(absl::string_view value) const;
+
  private:
   friend class internal::NoDestructor<ProcessLocalValueCache>;
 
@@ -81,8 +97,23 @@ class ProcessLocalValueCache final {
   absl::optional<ParsedMapValueView> dyn_dyn_map_value_;
   absl::optional<ParsedMapValueView> string_dyn_map_value_;
   absl::optional<OptionalValueView> dyn_optional_value_;
+  absl::optional<OptionalValue> null_optional_value_;
+  absl::optional<OptionalValue> false_optional_value_;
+  absl::optional<OptionalValue> true_optional_value_;
+  absl::optional<OptionalValue> int_zero_optional_value_;
+  absl::optional<OptionalValue> uint_zero_optional_value_;
+  mutable absl::Mutex interned_strings_mutex_;
+  // Values returned by GetInternedStringValue point into these strings. A
+  // node_hash_set never relocates its elements, which matters for names short
+  // enough to live in the inline buffer of std::string.
+  mutable absl::node_hash_set<std::string> interned_strings_
+      ABSL_GUARDED_BY(interned_strings_mutex_);
 };
 
+// Creates `optional.of(value)` without consulting `ProcessLocalValueCache`.
+OptionalValue MakeFullOptionalValue(MemoryManagerRef memory_manager,
+                                    Value value);
+
 class EmptyListValue final : public ParsedListValueInterface {
  public:
   explicit EmptyListValue(ListType type) : type_(std::move(type)) {}
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "google/api/expr/conformance/v1alpha1/conformance_service.pb.h"
 #include "google/api/expr/v1alpha1/syntax.pb.h"
@@ -20,7 +24,10 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_expr_builder_factory.h"
@@ -45,6 +52,13 @@ ABSL_FLAG(
 ABSL_FLAG(bool, arena, false,
           "Use arena memory manager (default: global heap ref-counted). Only "
           "affects the modern implementation");
+ABSL_FLAG(int, benchmark_iterations, 0,
+          "If positive, evaluate each eval request this many more times and "
+          "report the latency and allocations of each test on exit, so that "
+          "the conformance suite can be run as a benchmark");
+ABSL_FLAG(std::string, benchmark_report, "",
+          "File to write the benchmark report to, as CSV (default: a table "
+          "on stderr)");
 
 namespace google::api::expr::runtime {
 
@@ -64,6 +78,9 @@ class ConformanceServiceInterface {
 
   virtual absl::Status Eval(const conformance::v1alpha1::EvalRequest& request,
                             conformance::v1alpha1::EvalResponse& response) = 0;
+
+  // Bytes allocated by the last call to Eval, if known.
+  virtual int64_t LastEvalAllocatedBytes() const { return 0; }
 };
 
 // Return a normalized raw expr for evaluation.
@@ -209,15 +226,21 @@ class LegacyConformanceServiceImpl : public ConformanceServiceInterface {
       auto* result_value = response.mutable_result()->mutable_value();
       (*result_value).MergeFrom(export_value);
     }
+    last_eval_allocated_bytes_ = arena.SpaceAllocated();
     return absl::OkStatus();
   }
 
+  int64_t LastEvalAllocatedBytes() const override {
+    return last_eval_allocated_bytes_;
+  }
+
  private:
   explicit LegacyConformanceServiceImpl(
       std::unique_ptr<CelExpressionBuilder> builder)
       : builder_(std::move(builder)) {}
 
   std::unique_ptr<CelExpressionBuilder> builder_;
+  int64_t last_eval_allocated_bytes_ = 0;
 };
 
 class PipeCodec {
@@ -242,6 +265,92 @@ class PipeCodec {
   }
 };
 
+// Latency and allocations of repeated evaluations of the conformance tests,
+// keyed by the source of the expression (the driver doesn't send test
+// names; each eval request follows the parse request of its source).
+class ConformanceBenchmark {
+ public:
+  ConformanceBenchmark(int iterations, std::string implementation)
+      : iterations_(iterations), implementation_(std::move(implementation)) {}
+
+  // Evaluates request iterations times, recording the results for source.
+  void Run(ConformanceServiceInterface& service, absl::string_view source,
+           const conformance::v1alpha1::EvalRequest& request) {
+    std::vector<absl::Duration> latencies;
+    latencies.reserve(iterations_);
+    int64_t allocated_bytes = 0;
+    for (int i = 0; i < iterations_; ++i) {
+      conformance::v1alpha1::EvalResponse response;
+      absl::Time start = absl::Now();
+      if (!service.Eval(request, response).ok()) {
+        return;
+      }
+      latencies.push_back(absl::Now() - start);
+      allocated_bytes += service.LastEvalAllocatedBytes();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    Result& result = results_.emplace_back();
+    result.source = std::string(source);
+    result.median = latencies[latencies.size() / 2];
+    result.p99 = latencies[latencies.size() * 99 / 100];
+    result.allocated_bytes = allocated_bytes / iterations_;
+  }
+
+  void Report() const {
+    std::string path = absl::GetFlag(FLAGS_benchmark_report);
+    if (!path.empty()) {
+      std::ofstream out(path);
+      out << "implementation,source,median_ns,p99_ns,allocated_bytes\n";
+      for (const Result& result : results_) {
+        out << implementation_ << ",\"" << Escape(result.source) << "\","
+            << absl::ToInt64Nanoseconds(result.median) << ","
+            << absl::ToInt64Nanoseconds(result.p99) << ","
+            << result.allocated_bytes << "\n";
+      }
+      return;
+    }
+    absl::Duration total;
+    for (const Result& result : results_) {
+      std::cerr << absl::StrCat(
+                       absl::ToInt64Nanoseconds(result.median), "ns median\t",
+                       absl::ToInt64Nanoseconds(result.p99), "ns p99\t",
+                       result.allocated_bytes, "B\t", result.source)
+                << std::endl;
+      total += result.median;
+    }
+    std::cerr << implementation_ << ": " << results_.size() << " tests, "
+              << iterations_ << " iterations each, total median "
+              << absl::FormatDuration(total) << std::endl;
+  }
+
+ private:
+  struct Result {
+    std::string source;
+    absl::Duration median;
+    absl::Duration p99;
+    int64_t allocated_bytes;
+  };
+
+  // Quotes for CSV, and keeps each record on one line.
+  static std::string Escape(absl::string_view source) {
+    std::string escaped;
+    for (char c : source) {
+      if (c == '"') {
+        escaped += "\"\"";
+      } else if (c == '\n') {
+        escaped += ' ';
+      } else {
+        escaped += c;
+      }
+    }
+    return escaped;
+  }
+
+  const int iterations_;
+  const std::string implementation_;
+  std::vector<Result> results_;
+};
+
 int RunServer(bool optimize, bool modern, bool arena) {
   absl::StatusOr<std::unique_ptr<ConformanceServiceInterface>> service_or;
   service_or = LegacyConformanceServiceImpl::Create(optimize);
@@ -254,6 +363,15 @@ int RunServer(bool optimize, bool modern, bool arena) {
 
   auto conformance_service = std::move(service_or).value();
 
+  std::unique_ptr<ConformanceBenchmark> benchmark;
+  if (int iterations = absl::GetFlag(FLAGS_benchmark_iterations);
+      iterations > 0) {
+    benchmark = std::make_unique<ConformanceBenchmark>(
+        iterations, optimize ? "legacy_opt" : "legacy");
+  }
+  // The source of the last parse request, naming the following evaluation.
+  std::string source;
+
   PipeCodec pipe_codec;
   // Implementation of a simple pipe protocol:
   // INPUT LINE 1: parse/check/eval
@@ -270,6 +388,7 @@ int RunServer(bool optimize, bool modern, bool arena) {
         std::cerr << "Failed to decode ParseRequest: " << std::endl;
       }
       conformance_service->Parse(request, response);
+      source = request.cel_source();
       auto status = pipe_codec.Encode(response, &output);
       if (!status.ok()) {
         std::cerr << "Failed to encode ParseResponse: " << status.ToString()
@@ -282,6 +401,9 @@ int RunServer(bool optimize, bool modern, bool arena) {
         std::cerr << "Failed to decode EvalRequest" << std::endl;
       }
       auto status = conformance_service->Eval(request, response);
+      if (benchmark != nullptr && status.ok()) {
+        benchmark->Run(*conformance_service, source, request);
+      }
       if (!status.ok()) {
         std::cerr << status.ToString() << std::endl;
         auto* issue = response.add_issues();
@@ -304,6 +426,9 @@ int RunServer(bool optimize, bool modern, bool arena) {
                   << std::endl;
       }
     } else if (cmd.empty()) {
+      if (benchmark != nullptr) {
+        benchmark->Report();
+      }
       return 0;
     } else {
       std::cerr << "Unexpected command: " << cmd << std::endl;
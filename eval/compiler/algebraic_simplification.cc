@@ -0,0 +1,420 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/algebraic_simplification.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/resolver.h"
+#include "eval/compiler/subexpression_analysis.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::PrimitiveType;
+
+// Estimated relative costs of evaluating calls, used to order the clauses of
+// logical chains.
+constexpr size_t kBuiltinCallCost = 1;
+constexpr size_t kSearchCallCost = 5;
+constexpr size_t kRegexMatchCost = 25;
+constexpr size_t kExtensionCallCost = 10;
+constexpr size_t kComprehensionCost = 100;
+
+bool IsCallTo(const Expr& expr, absl::string_view function, size_t arg_count) {
+  return expr.has_call_expr() && !expr.call_expr().has_target() &&
+         expr.call_expr().function() == function &&
+         expr.call_expr().args().size() == arg_count;
+}
+
+bool IsBoolConstant(const Expr& expr, bool value) {
+  return expr.has_const_expr() && expr.const_expr().has_bool_value() &&
+         expr.const_expr().bool_value() == value;
+}
+
+bool IsEmptyLiteral(const Expr& expr) {
+  if (expr.has_list_expr()) {
+    return expr.list_expr().elements().empty();
+  }
+  return expr.has_struct_expr() && expr.struct_expr().message_name().empty() &&
+         expr.struct_expr().entries().empty();
+}
+
+// Whether `expr` is `size(literal)` or `literal.size()` for an empty list or
+// map literal.
+bool IsSizeOfEmptyLiteral(const Expr& expr) {
+  if (!expr.has_call_expr() ||
+      expr.call_expr().function() != cel::builtin::kSize) {
+    return false;
+  }
+  const Call& call = expr.call_expr();
+  if (call.has_target()) {
+    return call.args().empty() && IsEmptyLiteral(call.target());
+  }
+  return call.args().size() == 1 && IsEmptyLiteral(call.args()[0]);
+}
+
+// Functions whose standard overloads only return bools.
+bool IsBoolFunction(absl::string_view function) {
+  return function == cel::builtin::kAnd || function == cel::builtin::kOr ||
+         function == cel::builtin::kNot ||
+         function == cel::builtin::kNotStrictlyFalse ||
+         function == cel::builtin::kEqual ||
+         function == cel::builtin::kInequal ||
+         function == cel::builtin::kLess ||
+         function == cel::builtin::kLessOrEqual ||
+         function == cel::builtin::kGreater ||
+         function == cel::builtin::kGreaterOrEqual ||
+         function == cel::builtin::kIn ||
+         function == cel::builtin::kInDeprecated ||
+         function == cel::builtin::kInFunction;
+}
+
+size_t CallCost(absl::string_view function) {
+  if (function == cel::builtin::kRegexMatch) {
+    return kRegexMatchCost;
+  }
+  if (function == cel::builtin::kStringContains ||
+      function == cel::builtin::kStringStartsWith ||
+      function == cel::builtin::kStringEndsWith ||
+      function == cel::builtin::kIn ||
+      function == cel::builtin::kInDeprecated ||
+      function == cel::builtin::kInFunction) {
+    return kSearchCallCost;
+  }
+  if (IsPureBuiltin(function)) {
+    return kBuiltinCallCost;
+  }
+  return kExtensionCallCost;
+}
+
+class AlgebraicSimplifier {
+ public:
+  AlgebraicSimplifier(const Resolver& resolver, AstImpl& ast)
+      : resolver_(resolver), ast_(ast) {}
+
+  void Run() { Simplify(ast_.root_expr()); }
+
+ private:
+  void Simplify(Expr& expr) {
+    bool is_comprehension = expr.has_comprehension_expr();
+    if (is_comprehension) {
+      accumulators_.push_back(expr.comprehension_expr().accu_var());
+    }
+    ForEachChild(expr, [this](Expr& child) { Simplify(child); });
+    if (is_comprehension) {
+      accumulators_.pop_back();
+    }
+    while (SimplifyNode(expr)) {
+    }
+  }
+
+  // Applies one rewrite to `expr`, whose children are already simplified.
+  // Returns whether `expr` changed.
+  bool SimplifyNode(Expr& expr) {
+    if (!expr.has_call_expr()) {
+      return false;
+    }
+    Call& call = expr.mutable_call_expr();
+    if (IsCallTo(expr, cel::builtin::kAnd, 2)) {
+      return SimplifyChain(expr, cel::builtin::kAnd);
+    }
+    if (IsCallTo(expr, cel::builtin::kOr, 2)) {
+      return SimplifyChain(expr, cel::builtin::kOr);
+    }
+    if (IsCallTo(expr, cel::builtin::kNot, 1) &&
+        IsCallTo(call.args()[0], cel::builtin::kNot, 1) &&
+        ProducesBool(call.args()[0].call_expr().args()[0])) {
+      Replace(expr, std::move(call.mutable_args()[0]
+                                  .mutable_call_expr()
+                                  .mutable_args()[0]));
+      return true;
+    }
+    if (IsCallTo(expr, cel::builtin::kTernary, 3)) {
+      return SimplifyTernary(expr);
+    }
+    if (IsSizeOfEmptyLiteral(expr)) {
+      Constant zero;
+      zero.set_int64_value(0);
+      Replace(expr, Expr(expr.id(), std::move(zero)));
+      return true;
+    }
+    return false;
+  }
+
+  bool SimplifyTernary(Expr& expr) {
+    std::vector<Expr>& args = expr.mutable_call_expr().mutable_args();
+    if (MentionsAccumulator(args[1]) || MentionsAccumulator(args[2])) {
+      // Keep the shapes of macro loop steps, e.g. of filter().
+      return false;
+    }
+    if (IsBoolConstant(args[0], true)) {
+      Replace(expr, std::move(args[1]));
+      return true;
+    }
+    if (IsBoolConstant(args[0], false)) {
+      Replace(expr, std::move(args[2]));
+      return true;
+    }
+    if (CannotFail(args[0]) && StructurallyEqual(ast_, args[1], args[2])) {
+      Replace(expr, std::move(args[1]));
+      return true;
+    }
+    return false;
+  }
+
+  // Simplifies the chain of `function` (`&&` or `||`) calls rooted at
+  // `expr`.
+  bool SimplifyChain(Expr& expr, absl::string_view function) {
+    const bool absorbing = function == cel::builtin::kOr;
+    std::vector<Expr*> clauses;
+    std::vector<int64_t> ids;
+    FlattenChain(expr, function, clauses, ids);
+
+    std::vector<bool> relocatable;
+    relocatable.reserve(clauses.size());
+    for (Expr* clause : clauses) {
+      relocatable.push_back(IsRelocatable(*clause));
+    }
+
+    // `x && false` is false, whatever `x` evaluates to.
+    if (absl::c_any_of(clauses,
+                       [absorbing](const Expr* clause) {
+                         return IsBoolConstant(*clause, absorbing);
+                       }) &&
+        absl::c_all_of(relocatable, [](bool value) { return value; })) {
+      Constant constant;
+      constant.set_bool_value(absorbing);
+      Replace(expr, Expr(expr.id(), std::move(constant)));
+      return true;
+    }
+
+    // Drop identities and repeated clauses. Clauses which are not relocatable
+    // are kept, as are clauses which are equal to one of them.
+    struct Clause {
+      Expr* expr;
+      bool relocatable;
+      size_t cost;
+    };
+    std::vector<Clause> kept;
+    for (size_t i = 0; i < clauses.size(); ++i) {
+      Expr* clause = clauses[i];
+      if (IsBoolConstant(*clause, !absorbing)) {
+        continue;
+      }
+      if (relocatable[i] &&
+          absl::c_any_of(kept, [this, clause](const Clause& other) {
+            return other.relocatable &&
+                   StructurallyEqual(ast_, *other.expr, *clause);
+          })) {
+        continue;
+      }
+      kept.push_back({clause, relocatable[i], EstimateCost(*clause)});
+    }
+    if (kept.empty()) {
+      Constant constant;
+      constant.set_bool_value(!absorbing);
+      Replace(expr, Expr(expr.id(), std::move(constant)));
+      return true;
+    }
+    if (kept.size() == 1) {
+      if (!ProducesBool(*kept[0].expr)) {
+        // `x && true` is an error if `x` is not a bool.
+        return false;
+      }
+      Replace(expr, std::move(*kept[0].expr));
+      return true;
+    }
+
+    // Order the clauses between those that are not relocatable by cost.
+    for (auto begin = kept.begin(); begin != kept.end();) {
+      auto end = std::find_if(begin, kept.end(), [](const Clause& clause) {
+        return !clause.relocatable;
+      });
+      std::stable_sort(begin, end, [](const Clause& lhs, const Clause& rhs) {
+        return lhs.cost < rhs.cost;
+      });
+      begin = end == kept.end() ? end : end + 1;
+    }
+
+    if (kept.size() == clauses.size() &&
+        absl::c_equal(kept, clauses,
+                      [](const Clause& clause, const Expr* original) {
+                        return clause.expr == original;
+                      })) {
+      return false;
+    }
+
+    // Rebuild the chain as a left-leaning tree, reusing the ids of the
+    // original calls so that their references stay valid.
+    std::vector<Expr> operands;
+    operands.reserve(kept.size());
+    for (const Clause& clause : kept) {
+      operands.push_back(std::move(*clause.expr));
+    }
+    Expr chain = std::move(operands[0]);
+    for (size_t i = 1; i < operands.size(); ++i) {
+      std::vector<Expr> args;
+      args.push_back(std::move(chain));
+      args.push_back(std::move(operands[i]));
+      chain = Expr(ids[operands.size() - 1 - i],
+                   Call(nullptr, std::string(function), std::move(args)));
+    }
+    for (size_t i = operands.size() - 1; i < ids.size(); ++i) {
+      ast_.reference_map().erase(ids[i]);
+    }
+    expr = std::move(chain);
+    return true;
+  }
+
+  void FlattenChain(Expr& expr, absl::string_view function,
+                    std::vector<Expr*>& clauses, std::vector<int64_t>& ids) {
+    if (!IsCallTo(expr, function, 2)) {
+      clauses.push_back(&expr);
+      return;
+    }
+    ids.push_back(expr.id());
+    for (Expr& arg : expr.mutable_call_expr().mutable_args()) {
+      FlattenChain(arg, function, clauses, ids);
+    }
+  }
+
+  // Replaces `expr` with `replacement`, which may be one of its descendants.
+  void Replace(Expr& expr, Expr replacement) {
+    if (replacement.id() != expr.id() || !replacement.has_call_expr()) {
+      ast_.reference_map().erase(expr.id());
+    }
+    expr = std::move(replacement);
+  }
+
+  // Whether `expr` evaluates to a bool, an error or an unknown.
+  bool ProducesBool(const Expr& expr) const {
+    if (expr.has_const_expr()) {
+      return expr.const_expr().has_bool_value();
+    }
+    if (expr.has_select_expr() && expr.select_expr().test_only()) {
+      return true;
+    }
+    if (expr.has_call_expr() && !expr.call_expr().has_target() &&
+        IsBoolFunction(expr.call_expr().function())) {
+      return true;
+    }
+    if (!ast_.IsChecked()) {
+      return false;
+    }
+    auto type = ast_.type_map().find(expr.id());
+    return type != ast_.type_map().end() && type->second.has_primitive() &&
+           type->second.primitive() == PrimitiveType::kBool;
+  }
+
+  // Whether `expr` evaluates to a bool, and never to an error or unknown.
+  bool CannotFail(const Expr& expr) const {
+    if (expr.has_const_expr()) {
+      return expr.const_expr().has_bool_value();
+    }
+    if (IsCallTo(expr, cel::builtin::kAnd, 2) ||
+        IsCallTo(expr, cel::builtin::kOr, 2) ||
+        IsCallTo(expr, cel::builtin::kNot, 1)) {
+      return absl::c_all_of(
+          expr.call_expr().args(),
+          [this](const Expr& arg) { return CannotFail(arg); });
+    }
+    return false;
+  }
+
+  // Whether evaluating `expr` has no effect besides its result, so it may be
+  // evaluated earlier than it used to be, or not at all.
+  bool IsRelocatable(Expr& expr) const {
+    if (expr.has_comprehension_expr()) {
+      return false;
+    }
+    if (expr.has_ident_expr() &&
+        absl::c_linear_search(accumulators_, expr.ident_expr().name())) {
+      return false;
+    }
+    if (expr.has_call_expr() && !IsPureCall(resolver_, expr)) {
+      return false;
+    }
+    bool relocatable = true;
+    ForEachChild(expr, [this, &relocatable](Expr& child) {
+      relocatable = relocatable && IsRelocatable(child);
+    });
+    return relocatable;
+  }
+
+  bool MentionsAccumulator(Expr& expr) const {
+    if (expr.has_ident_expr()) {
+      return absl::c_linear_search(accumulators_, expr.ident_expr().name());
+    }
+    bool mentions = false;
+    ForEachChild(expr, [this, &mentions](Expr& child) {
+      mentions = mentions || MentionsAccumulator(child);
+    });
+    return mentions;
+  }
+
+  size_t EstimateCost(Expr& expr) const {
+    size_t cost = 0;
+    if (expr.has_call_expr()) {
+      cost = CallCost(expr.call_expr().function());
+    } else if (expr.has_comprehension_expr()) {
+      cost = kComprehensionCost;
+    } else if (!expr.has_const_expr()) {
+      cost = 1;
+    }
+    ForEachChild(expr,
+                 [this, &cost](Expr& child) { cost += EstimateCost(child); });
+    return cost;
+  }
+
+  const Resolver& resolver_;
+  AstImpl& ast_;
+  // Accumulator variables of the comprehensions enclosing the current node.
+  std::vector<std::string> accumulators_;
+};
+
+class AlgebraicSimplificationTransform : public AstTransform {
+ public:
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    AlgebraicSimplifier(context.resolver(), ast).Run();
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<AstTransform> CreateAlgebraicSimplificationTransform() {
+  return std::make_unique<AlgebraicSimplificationTransform>();
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,52 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_ALGEBRAIC_SIMPLIFICATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_ALGEBRAIC_SIMPLIFICATION_H_
+
+#include <memory>
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new AST transform that removes redundant logic from expressions.
+//
+// The transform rewrites, bottom-up:
+//  - `x && true`, `x || false` and `!!x` to `x`, if `x` always evaluates to a
+//    bool, error or unknown, i.e. it is typed bool by the checker or is a
+//    logical, relational or `has()` expression.
+//  - `x && false` and `x || true` to the constant, if no other clause has
+//    side effects or contains a comprehension.
+//  - `true ? a : b` to `a`, `false ? a : b` to `b`, and `c ? a : a` to `a`
+//    if `c` cannot evaluate to an error or unknown.
+//  - `size([])` and `size({})` to `0`.
+//  - repeated side-effect-free clauses of `&&` and `||` chains to their first
+//    occurrence.
+//
+// Clauses of `&&` and `||` chains are also reordered by estimated cost, so
+// cheap clauses run first and may short-circuit expensive ones. The logical
+// operators are commutative in CEL, so this does not change the result,
+// except that when several clauses evaluate to errors a different one of
+// them may be reported. Only side-effect-free clauses without comprehensions
+// are moved, so a clause that used to be skipped cannot abort the
+// evaluation, e.g. by exceeding the comprehension iteration limit, or call
+// an impure function. Comprehension accumulators are never moved, and
+// conditionals whose branches refer to them are left as they are, so the
+// macro shapes the planner recognizes are preserved.
+std::unique_ptr<AstTransform> CreateAlgebraicSimplificationTransform();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_ALGEBRAIC_SIMPLIFICATION_H_
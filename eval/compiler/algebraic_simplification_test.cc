@@ -0,0 +1,261 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/algebraic_simplification.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/kind.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_function.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Expr;
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+// Renders calls, identifiers and constants, e.g. `_&&_(x, true)`.
+std::string Describe(const Expr& expr) {
+  if (expr.has_const_expr()) {
+    if (expr.const_expr().has_bool_value()) {
+      return expr.const_expr().bool_value() ? "true" : "false";
+    }
+    if (expr.const_expr().has_int64_value()) {
+      return absl::StrCat(expr.const_expr().int64_value());
+    }
+    if (expr.const_expr().has_string_value()) {
+      return absl::StrCat("'", expr.const_expr().string_value(), "'");
+    }
+  }
+  if (expr.has_ident_expr()) {
+    return expr.ident_expr().name();
+  }
+  if (expr.has_call_expr()) {
+    std::vector<std::string> operands;
+    if (expr.call_expr().has_target()) {
+      operands.push_back(Describe(expr.call_expr().target()));
+    }
+    for (const Expr& arg : expr.call_expr().args()) {
+      operands.push_back(Describe(arg));
+    }
+    return absl::StrCat(expr.call_expr().function(), "(",
+                        absl::StrJoin(operands, ", "), ")");
+  }
+  return "?";
+}
+
+// Records the expression left by the transforms that run before it.
+class RecordingTransform : public AstTransform {
+ public:
+  explicit RecordingTransform(std::string* description)
+      : description_(description) {}
+
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    *description_ = Describe(ast.root_expr());
+    return absl::OkStatus();
+  }
+
+ private:
+  std::string* description_;
+};
+
+// Returns its argument plus one and counts invocations.
+class CountingIncrement : public CelFunction {
+ public:
+  CountingIncrement(absl::string_view name, bool is_pure, int* calls)
+      : CelFunction(CelFunctionDescriptor(std::string(name),
+                                          /*receiver_style=*/false,
+                                          {cel::Kind::kInt64},
+                                          /*is_strict=*/true, is_pure)),
+        calls_(calls) {}
+
+  absl::Status Evaluate(absl::Span<const CelValue> arguments,
+                        CelValue* result,
+                        google::protobuf::Arena* arena) const override {
+    ++*calls_;
+    *result = CelValue::CreateInt64(arguments[0].Int64OrDie() + 1);
+    return absl::OkStatus();
+  }
+
+ private:
+  int* calls_;
+};
+
+class AlgebraicSimplificationTest : public testing::Test {
+ public:
+  void SetUp() override {
+    activation_.InsertValue("x", CelValue::CreateInt64(1));
+  }
+
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr) {
+    CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options_));
+    CEL_RETURN_IF_ERROR(
+        RegisterBuiltinFunctions(builder.GetRegistry(), options_));
+    CEL_RETURN_IF_ERROR(builder.GetRegistry()->Register(
+        std::make_unique<CountingIncrement>("pure_inc", /*is_pure=*/true,
+                                            &pure_calls_)));
+    CEL_RETURN_IF_ERROR(builder.GetRegistry()->Register(
+        std::make_unique<CountingIncrement>("inc", /*is_pure=*/false,
+                                            &impure_calls_)));
+    builder.flat_expr_builder().AddAstTransform(
+        CreateAlgebraicSimplificationTransform());
+    builder.flat_expr_builder().AddAstTransform(
+        std::make_unique<RecordingTransform>(&simplified_));
+
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<CelExpression> plan,
+                         builder.CreateExpression(&parsed_expr_.expr(),
+                                                  &parsed_expr_.source_info()));
+    return plan->Evaluate(activation_, &arena_);
+  }
+
+ protected:
+  InterpreterOptions options_;
+  exprpb::ParsedExpr parsed_expr_;
+  Activation activation_;
+  google::protobuf::Arena arena_;
+  std::string simplified_;
+  int pure_calls_ = 0;
+  int impure_calls_ = 0;
+};
+
+TEST_F(AlgebraicSimplificationTest, RemovesIdentities) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("x > 0 && true"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(simplified_, Eq("_>_(x, 0)"));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("false || !!(x > 0)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(simplified_, Eq("_>_(x, 0)"));
+}
+
+TEST_F(AlgebraicSimplificationTest, KeepsIdentitiesOfNonBoolOperands) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("x && true"));
+  EXPECT_TRUE(result.IsError());
+  EXPECT_THAT(simplified_, Eq("_&&_(x, true)"));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("!!x"));
+  EXPECT_TRUE(result.IsError());
+  EXPECT_THAT(simplified_, Eq("!_(!_(x))"));
+}
+
+TEST_F(AlgebraicSimplificationTest, FoldsAbsorbingClauses) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("pure_inc(x) > 0 && x > 0 && false"));
+  EXPECT_THAT(result, test::IsCelBool(false));
+  EXPECT_THAT(simplified_, Eq("false"));
+  EXPECT_EQ(pure_calls_, 0);
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("x > 0 || true"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(simplified_, Eq("true"));
+}
+
+TEST_F(AlgebraicSimplificationTest, KeepsImpureClauses) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("inc(x) > 0 && false"));
+  EXPECT_THAT(result, test::IsCelBool(false));
+  EXPECT_EQ(impure_calls_, 1);
+}
+
+TEST_F(AlgebraicSimplificationTest, SizeOfEmptyLiterals) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("size([]) + [].size() + size({})"));
+  EXPECT_THAT(result, test::IsCelInt64(0));
+  EXPECT_THAT(simplified_, Eq("_+_(_+_(0, 0), 0)"));
+}
+
+TEST_F(AlgebraicSimplificationTest, Conditionals) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("x > 0 && false ? 1 : x"));
+  EXPECT_THAT(result, test::IsCelInt64(1));
+  EXPECT_THAT(simplified_, Eq("x"));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("(true || x > 0) ? 2 : 2"));
+  EXPECT_THAT(result, test::IsCelInt64(2));
+  EXPECT_THAT(simplified_, Eq("2"));
+
+  // The condition may be an error, which is the result then.
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("x > 0 ? 2 : 2"));
+  EXPECT_THAT(result, test::IsCelInt64(2));
+  EXPECT_THAT(simplified_, Eq("_?_:_(_>_(x, 0), 2, 2)"));
+}
+
+TEST_F(AlgebraicSimplificationTest, RemovesRepeatedClauses) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("x > 0 && pure_inc(x) > 1 && x > 0 && pure_inc(x) > 1"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(simplified_, Eq("_&&_(_>_(x, 0), _>_(pure_inc(x), 1))"));
+  EXPECT_EQ(pure_calls_, 1);
+}
+
+TEST_F(AlgebraicSimplificationTest, OrdersClausesByCost) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("'abc'.matches('b+') || pure_inc(x) > 5 || x > 0"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(simplified_,
+              Eq("_||_(_||_(_>_(x, 0), _>_(pure_inc(x), 5)), "
+                 "matches('abc', 'b+'))"));
+  EXPECT_EQ(pure_calls_, 0);
+}
+
+TEST_F(AlgebraicSimplificationTest, DoesNotMoveClausesAcrossImpureCalls) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("pure_inc(x) > 5 && inc(x) > 5 && x > 5"));
+  EXPECT_THAT(result, test::IsCelBool(false));
+  EXPECT_THAT(simplified_,
+              Eq("_&&_(_&&_(_>_(pure_inc(x), 5), _>_(inc(x), 5)), "
+                 "_>_(x, 5))"));
+}
+
+TEST_F(AlgebraicSimplificationTest, PreservesMacros) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2, 3].filter(i, true).size() == 3 && "
+               "[1, 2, 3].exists(i, i > 2 || false) && "
+               "[1, 2, 3].all(i, true && i > 0)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,48 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/ast_matchers.h"
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/expr.h"
+
+namespace google::api::expr::runtime {
+
+const cel::ast_internal::Call* AsGlobalCall(const cel::ast_internal::Expr& expr,
+                                            absl::string_view function,
+                                            size_t arg_count) {
+  if (!expr.has_call_expr()) {
+    return nullptr;
+  }
+  const cel::ast_internal::Call& call = expr.call_expr();
+  if (call.has_target() || call.function() != function ||
+      call.args().size() != arg_count) {
+    return nullptr;
+  }
+  return &call;
+}
+
+cel::ast_internal::Call* AsGlobalCall(cel::ast_internal::Expr& expr,
+                                      absl::string_view function,
+                                      size_t arg_count) {
+  if (AsGlobalCall(static_cast<const cel::ast_internal::Expr&>(expr), function,
+                   arg_count) == nullptr) {
+    return nullptr;
+  }
+  return &expr.mutable_call_expr();
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,36 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_AST_MATCHERS_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_AST_MATCHERS_H_
+
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/expr.h"
+
+namespace google::api::expr::runtime {
+
+// Returns the call if expr is a global call to function with arg_count
+// arguments, otherwise null.
+const cel::ast_internal::Call* AsGlobalCall(const cel::ast_internal::Expr& expr,
+                                            absl::string_view function,
+                                            size_t arg_count);
+cel::ast_internal::Call* AsGlobalCall(cel::ast_internal::Expr& expr,
+                                      absl::string_view function,
+                                      size_t arg_count);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_AST_MATCHERS_H_
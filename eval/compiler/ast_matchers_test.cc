@@ -0,0 +1,59 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/ast_matchers.h"
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/expr.h"
+#include "internal/testing.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::ast_internal::Expr;
+
+Expr MakeCall(absl::string_view function, int arg_count) {
+  Expr expr;
+  auto& call = expr.mutable_call_expr();
+  call.set_function(std::string(function));
+  for (int i = 0; i < arg_count; ++i) {
+    call.mutable_args().emplace_back().mutable_const_expr().set_int64_value(i);
+  }
+  return expr;
+}
+
+TEST(AsGlobalCallTest, MatchesFunctionAndArgCount) {
+  Expr expr = MakeCall("_+_", 2);
+  const Expr& const_expr = expr;
+
+  EXPECT_EQ(AsGlobalCall(const_expr, "_+_", 2), &expr.call_expr());
+  EXPECT_EQ(AsGlobalCall(expr, "_+_", 2), &expr.call_expr());
+  EXPECT_EQ(AsGlobalCall(const_expr, "_-_", 2), nullptr);
+  EXPECT_EQ(AsGlobalCall(const_expr, "_+_", 3), nullptr);
+}
+
+TEST(AsGlobalCallTest, RejectsReceiverCallsAndOtherExprs) {
+  Expr expr = MakeCall("size", 0);
+  expr.mutable_call_expr().mutable_target().mutable_ident_expr().set_name("x");
+  EXPECT_EQ(AsGlobalCall(expr, "size", 0), nullptr);
+
+  Expr ident;
+  ident.mutable_ident_expr().set_name("size");
+  EXPECT_EQ(AsGlobalCall(ident, "size", 0), nullptr);
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
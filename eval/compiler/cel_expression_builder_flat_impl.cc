@@ -16,6 +16,9 @@
 
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -26,12 +29,16 @@
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
 #include "base/ast.h"
+#include "eval/compiler/planner_phase.h"
 #include "eval/eval/cel_expression_flat_impl.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/public/cel_expression.h"
 #include "extensions/protobuf/ast_converters.h"
 #include "internal/status_macros.h"
+#include "runtime/planner_stats.h"
 #include "runtime/runtime_issue.h"
 
 namespace google::api::expr::runtime {
@@ -46,11 +53,22 @@ absl::StatusOr<std::unique_ptr<CelExpression>>
 CelExpressionBuilderFlatImpl::CreateExpression(
     const Expr* expr, const SourceInfo* source_info,
     std::vector<absl::Status>* warnings) const {
+  return CreateExpression(expr, source_info, warnings, /*stats=*/nullptr);
+}
+
+absl::StatusOr<std::unique_ptr<CelExpression>>
+CelExpressionBuilderFlatImpl::CreateExpression(
+    const Expr* expr, const SourceInfo* source_info,
+    std::vector<absl::Status>* warnings, cel::PlannerStats* stats) const {
   ABSL_ASSERT(expr != nullptr);
-  CEL_ASSIGN_OR_RETURN(
-      std::unique_ptr<Ast> converted_ast,
-      cel::extensions::CreateAstFromParsedExpr(*expr, source_info));
-  return CreateExpressionImpl(std::move(converted_ast), warnings);
+  std::unique_ptr<Ast> converted_ast;
+  {
+    ScopedPlannerPhase phase(stats, &cel::PlannerStats::ast_conversion);
+    CEL_ASSIGN_OR_RETURN(
+        converted_ast,
+        cel::extensions::CreateAstFromParsedExpr(*expr, source_info));
+  }
+  return CreateExpressionImpl(std::move(converted_ast), warnings, stats);
 }
 
 absl::StatusOr<std::unique_ptr<CelExpression>>
@@ -64,12 +82,22 @@ absl::StatusOr<std::unique_ptr<CelExpression>>
 CelExpressionBuilderFlatImpl::CreateExpression(
     const CheckedExpr* checked_expr,
     std::vector<absl::Status>* warnings) const {
-  ABSL_ASSERT(checked_expr != nullptr);
-  CEL_ASSIGN_OR_RETURN(
-      std::unique_ptr<Ast> converted_ast,
-      cel::extensions::CreateAstFromCheckedExpr(*checked_expr));
+  return CreateExpression(checked_expr, warnings, /*stats=*/nullptr);
+}
 
-  return CreateExpressionImpl(std::move(converted_ast), warnings);
+absl::StatusOr<std::unique_ptr<CelExpression>>
+CelExpressionBuilderFlatImpl::CreateExpression(
+    const CheckedExpr* checked_expr, std::vector<absl::Status>* warnings,
+    cel::PlannerStats* stats) const {
+  ABSL_ASSERT(checked_expr != nullptr);
+  std::unique_ptr<Ast> converted_ast;
+  {
+    ScopedPlannerPhase phase(stats, &cel::PlannerStats::ast_conversion);
+    CEL_ASSIGN_OR_RETURN(
+        converted_ast,
+        cel::extensions::CreateAstForPlanningFromCheckedExpr(*checked_expr));
+  }
+  return CreateExpressionImpl(std::move(converted_ast), warnings, stats);
 }
 
 absl::StatusOr<std::unique_ptr<CelExpression>>
@@ -78,16 +106,51 @@ CelExpressionBuilderFlatImpl::CreateExpression(
   return CreateExpression(checked_expr, /*warnings=*/nullptr);
 }
 
+std::vector<absl::StatusOr<std::unique_ptr<CelExpression>>>
+CelExpressionBuilderFlatImpl::CreateExpressions(
+    absl::Span<const CheckedExpr> checked_exprs, Scheduler schedule,
+    int max_parallelism) const {
+  std::vector<absl::StatusOr<std::unique_ptr<CelExpression>>> results(
+      checked_exprs.size());
+  // Planning an expression is coarse grained, so workers claim one
+  // expression at a time. Workers write disjoint results.
+  std::atomic<size_t> next{0};
+  auto run_worker = [&]() {
+    for (size_t i = next.fetch_add(1, std::memory_order_relaxed);
+         i < checked_exprs.size();
+         i = next.fetch_add(1, std::memory_order_relaxed)) {
+      results[i] = CreateExpression(&checked_exprs[i]);
+    }
+  };
+
+  size_t workers = std::min(
+      static_cast<size_t>(std::max(max_parallelism, 1)), checked_exprs.size());
+  if (workers > 1) {
+    absl::BlockingCounter pending(static_cast<int>(workers - 1));
+    for (size_t i = 1; i < workers; ++i) {
+      schedule([&run_worker, &pending]() {
+        run_worker();
+        pending.DecrementCount();
+      });
+    }
+    run_worker();
+    pending.Wait();
+  } else {
+    run_worker();
+  }
+  return results;
+}
+
 absl::StatusOr<std::unique_ptr<CelExpression>>
 CelExpressionBuilderFlatImpl::CreateExpressionImpl(
-    std::unique_ptr<Ast> converted_ast,
-    std::vector<absl::Status>* warnings) const {
+    std::unique_ptr<Ast> converted_ast, std::vector<absl::Status>* warnings,
+    cel::PlannerStats* stats) const {
   std::vector<RuntimeIssue> issues;
   auto* issues_ptr = (warnings != nullptr) ? &issues : nullptr;
 
   CEL_ASSIGN_OR_RETURN(FlatExpression impl,
                        flat_expr_builder_.CreateExpressionImpl(
-                           std::move(converted_ast), issues_ptr));
+                           std::move(converted_ast), issues_ptr, stats));
 
   if (issues_ptr != nullptr) {
     for (const auto& issue : issues) {
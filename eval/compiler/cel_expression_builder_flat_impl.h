@@ -24,11 +24,15 @@
 
 #include "google/api/expr/v1alpha1/checked.pb.h"
 #include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "base/ast.h"
 #include "eval/compiler/flat_expr_builder.h"
 #include "eval/public/cel_expression.h"
+#include "runtime/planner_stats.h"
 #include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
@@ -61,6 +65,33 @@ class CelExpressionBuilderFlatImpl : public CelExpressionBuilder {
       const google::api::expr::v1alpha1::CheckedExpr* checked_expr,
       std::vector<absl::Status>* warnings) const override;
 
+  // As above, adding the time and allocations of each planning phase to stats
+  // (see cel::PlannerStats).
+  absl::StatusOr<std::unique_ptr<CelExpression>> CreateExpression(
+      const google::api::expr::v1alpha1::Expr* expr,
+      const google::api::expr::v1alpha1::SourceInfo* source_info,
+      std::vector<absl::Status>* warnings, cel::PlannerStats* stats) const;
+
+  absl::StatusOr<std::unique_ptr<CelExpression>> CreateExpression(
+      const google::api::expr::v1alpha1::CheckedExpr* checked_expr,
+      std::vector<absl::Status>* warnings, cel::PlannerStats* stats) const;
+
+  // Schedules a task on a caller owned executor. Every scheduled task must
+  // eventually run; CreateExpressions blocks until all of them complete.
+  using Scheduler = absl::FunctionRef<void(absl::AnyInvocable<void()>)>;
+
+  // Plans each of checked_exprs, spreading them across up to max_parallelism
+  // workers started with schedule. The calling thread participates as one
+  // worker.
+  //
+  // Returns one result per expression, in order. Errors are reported per
+  // expression and do not stop planning of the others. Functions and types
+  // must not be registered while this runs.
+  std::vector<absl::StatusOr<std::unique_ptr<CelExpression>>>
+  CreateExpressions(
+      absl::Span<const google::api::expr::v1alpha1::CheckedExpr> checked_exprs,
+      Scheduler schedule, int max_parallelism = 8) const;
+
   FlatExprBuilder& flat_expr_builder() { return flat_expr_builder_; }
 
   void set_container(std::string container) override {
@@ -71,7 +102,7 @@ class CelExpressionBuilderFlatImpl : public CelExpressionBuilder {
  private:
   absl::StatusOr<std::unique_ptr<CelExpression>> CreateExpressionImpl(
       std::unique_ptr<cel::Ast> converted_ast,
-      std::vector<absl::Status>* warnings) const;
+      std::vector<absl::Status>* warnings, cel::PlannerStats* stats) const;
 
   FlatExprBuilder flat_expr_builder_;
 };
@@ -18,16 +18,24 @@
 // flat_expr_builder_test.cc for additional tests.
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
 
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
 #include <vector>
 
 #include "google/api/expr/v1alpha1/checked.pb.h"
 #include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/testing/matchers.h"
 #include "internal/testing.h"
 #include "parser/parser.h"
+#include "runtime/planner_stats.h"
 #include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
@@ -134,6 +142,82 @@ TEST(CelExpressionBuilderFlatImplTest, CheckedExprWithWarnings) {
                           StatusIs(_, HasSubstr("No matching overloads"))));
 }
 
+TEST(CelExpressionBuilderFlatImplTest, CreateExpressions) {
+  std::vector<CheckedExpr> checked_exprs;
+  for (int i = 0; i < 20; ++i) {
+    // Every fifth expression calls an unknown function and fails to plan.
+    ASSERT_OK_AND_ASSIGN(
+        ParsedExpr parsed_expr,
+        Parse(i % 5 == 4 ? "unknown(1)" : absl::StrCat(i, " + ", i)));
+    CheckedExpr& checked_expr = checked_exprs.emplace_back();
+    checked_expr.mutable_expr()->Swap(parsed_expr.mutable_expr());
+    checked_expr.mutable_source_info()->Swap(parsed_expr.mutable_source_info());
+  }
+
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+
+  std::vector<std::thread> threads;
+  auto results = builder.CreateExpressions(
+      checked_exprs,
+      [&threads](absl::AnyInvocable<void()> task) {
+        threads.emplace_back(std::move(task));
+      },
+      /*max_parallelism=*/4);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(threads.size(), 3);
+
+  ASSERT_EQ(results.size(), checked_exprs.size());
+  Activation activation;
+  google::protobuf::Arena arena;
+  for (int i = 0; i < 20; ++i) {
+    if (i % 5 == 4) {
+      EXPECT_THAT(results[i], StatusIs(absl::StatusCode::kInvalidArgument,
+                                       HasSubstr("No overloads")));
+      continue;
+    }
+    ASSERT_OK(results[i]);
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         (*results[i])->Evaluate(activation, &arena));
+    EXPECT_THAT(result, test::IsCelInt64(2 * i));
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplTest, PlannerStats) {
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, Parse("1 + 2"));
+
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+
+  int64_t allocations = 0;
+  cel::PlannerStats stats;
+  stats.allocation_counter = [&allocations]() { return ++allocations; };
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      builder.CreateExpression(&parsed_expr.expr(), &parsed_expr.source_info(),
+                               /*warnings=*/nullptr, &stats));
+
+  EXPECT_EQ(stats.program_steps, 3);
+  EXPECT_GT(stats.program_bytes, 0);
+  // The counter is sampled once more at the end of each phase.
+  EXPECT_EQ(stats.ast_conversion.allocations, 1);
+  EXPECT_EQ(stats.ast_transforms.allocations, 1);
+  EXPECT_EQ(stats.finalization.allocations, 1);
+  EXPECT_GE(stats.flattening.wall_time, absl::ZeroDuration());
+  EXPECT_GE(stats.total_wall_time(), stats.flattening.wall_time);
+
+  // Phases accumulate across expressions, the footprint is replaced.
+  ASSERT_OK_AND_ASSIGN(ParsedExpr constant_expr, Parse("1"));
+  ASSERT_OK_AND_ASSIGN(plan, builder.CreateExpression(
+                                 &constant_expr.expr(),
+                                 &constant_expr.source_info(),
+                                 /*warnings=*/nullptr, &stats));
+  EXPECT_EQ(stats.program_steps, 1);
+  EXPECT_EQ(stats.ast_conversion.allocations, 2);
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
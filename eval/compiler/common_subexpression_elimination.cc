@@ -0,0 +1,257 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/common_subexpression_elimination.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/resolver.h"
+#include "eval/compiler/subexpression_analysis.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Comprehension;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::CreateList;
+using ::cel::ast_internal::CreateStruct;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Ident;
+using ::cel::ast_internal::Reference;
+using ::cel::ast_internal::Select;
+
+constexpr char kUnusedIterVar[] = "#unused";
+
+// Prefix of the variables introduced for extracted subexpressions. Not a
+// valid CEL identifier, so it cannot collide with user variables.
+constexpr char kBindVarPrefix[] = "@cse:";
+
+// Upper bound on the number of subexpressions extracted from one expression.
+constexpr size_t kMaxBindings = 64;
+
+size_t HashConstant(const Constant& constant) {
+  size_t kind = constant.constant_kind().index();
+  if (constant.has_string_value()) {
+    return absl::HashOf(kind, constant.string_value());
+  }
+  if (constant.has_int64_value()) {
+    return absl::HashOf(kind, constant.int64_value());
+  }
+  return absl::HashOf(kind);
+}
+
+class CommonSubexpressionEliminator {
+ public:
+  CommonSubexpressionEliminator(const Resolver& resolver, AstImpl& ast)
+      : resolver_(resolver), ast_(ast) {}
+
+  void Run() {
+    CollectNames(ast_.root_expr());
+
+    std::vector<std::pair<std::string, std::unique_ptr<Expr>>> bindings;
+    while (bindings.size() < kMaxBindings) {
+      info_.clear();
+      candidates_.clear();
+      Analyze(ast_.root_expr(), /*parent=*/nullptr);
+      for (const auto& binding : bindings) {
+        Analyze(*binding.second, /*parent=*/nullptr);
+      }
+
+      std::vector<Expr*> occurrences = FindLargestRepeatedSubexpression();
+      if (occurrences.empty()) {
+        break;
+      }
+
+      std::string name = absl::StrCat(kBindVarPrefix, bindings.size());
+      auto definition = std::make_unique<Expr>(std::move(*occurrences[0]));
+      for (Expr* occurrence : occurrences) {
+        *occurrence = Expr(next_id_++, Ident(name));
+      }
+      bindings.push_back({std::move(name), std::move(definition)});
+    }
+
+    // Definitions extracted later may be referenced by earlier ones (but not
+    // the other way around), so they are bound in the outer scopes.
+    for (auto& binding : bindings) {
+      Constant loop_condition;
+      loop_condition.set_bool_value(false);
+      Comprehension bind(
+          kUnusedIterVar, std::make_unique<Expr>(next_id_++, CreateList()),
+          binding.first, std::move(binding.second),
+          std::make_unique<Expr>(next_id_++, std::move(loop_condition)),
+          std::make_unique<Expr>(next_id_++, Ident(binding.first)),
+          std::make_unique<Expr>(std::move(ast_.root_expr())));
+      ast_.root_expr() = Expr(next_id_++, std::move(bind));
+    }
+  }
+
+ private:
+  struct NodeInfo {
+    size_t hash = 0;
+    size_t size = 1;
+    // Whether the subtree may be evaluated once and shared by all of its
+    // occurrences.
+    bool shareable = false;
+  };
+
+  void CollectNames(Expr& expr) {
+    next_id_ = std::max(next_id_, expr.id() + 1);
+    if (expr.has_comprehension_expr()) {
+      comprehension_vars_.insert(expr.comprehension_expr().iter_var());
+      comprehension_vars_.insert(expr.comprehension_expr().accu_var());
+    }
+    ForEachChild(expr, [this](Expr& child) { CollectNames(child); });
+  }
+
+  // Computes the info for expr and its subtrees and records the subtrees that
+  // are candidates for extraction, in post-order.
+  NodeInfo Analyze(Expr& expr, const Expr* parent) {
+    NodeInfo info;
+    bool children_shareable = true;
+    std::vector<size_t> child_hashes;
+    ForEachChild(expr, [&](Expr& child) {
+      NodeInfo child_info = Analyze(child, &expr);
+      info.size += child_info.size;
+      children_shareable = children_shareable && child_info.shareable;
+      child_hashes.push_back(child_info.hash);
+    });
+
+    if (expr.has_const_expr()) {
+      info.shareable = true;
+      info.hash = HashConstant(expr.const_expr());
+    } else if (expr.has_ident_expr()) {
+      const std::string& name = expr.ident_expr().name();
+      info.shareable = !comprehension_vars_.contains(name) &&
+                       !absl::StartsWith(name, kBindVarPrefix);
+      info.hash = absl::HashOf(name);
+    } else if (expr.has_select_expr()) {
+      const Select& select = expr.select_expr();
+      info.shareable = children_shareable;
+      info.hash = absl::HashOf(select.field(), select.test_only());
+    } else if (expr.has_call_expr()) {
+      const Call& call = expr.call_expr();
+      info.shareable = children_shareable && IsPureCall(resolver_, expr);
+      info.hash = absl::HashOf(call.function(), call.has_target());
+    } else if (expr.has_list_expr()) {
+      info.shareable = children_shareable;
+      info.hash = absl::HashOf(expr.list_expr().optional_indices());
+    } else if (expr.has_struct_expr()) {
+      const CreateStruct& create_struct = expr.struct_expr();
+      info.shareable = children_shareable;
+      info.hash = absl::HashOf(create_struct.message_name(),
+                               create_struct.entries().size());
+    }
+    info.hash = absl::HashOf(expr.expr_kind().index(), info.hash, child_hashes);
+    if (const Reference* reference = ast_.GetReference(expr.id());
+        reference != nullptr) {
+      info.hash = absl::HashOf(info.hash, reference->name());
+    }
+
+    // Parts of a select chain are not extracted on their own, since the
+    // chain may be a qualified name that is only resolved as a whole.
+    if (info.shareable && info.size > 1 && parent != nullptr &&
+        !parent->has_select_expr()) {
+      candidates_.push_back(&expr);
+    }
+    info_[&expr] = info;
+    return info;
+  }
+
+  // Returns the occurrences of the largest candidate that occurs more than
+  // once, in program order, or an empty vector if there is none.
+  std::vector<Expr*> FindLargestRepeatedSubexpression() const {
+    absl::flat_hash_map<size_t, std::vector<std::vector<Expr*>>> classes;
+    std::vector<std::vector<Expr*>*> ordered_classes;
+    for (Expr* candidate : candidates_) {
+      std::vector<std::vector<Expr*>>& bucket =
+          classes[info_.at(candidate).hash];
+      auto it = absl::c_find_if(bucket, [&](const std::vector<Expr*>& cls) {
+        return StructurallyEqual(ast_, *cls.front(), *candidate);
+      });
+      if (it != bucket.end()) {
+        it->push_back(candidate);
+      } else {
+        bucket.push_back({candidate});
+      }
+    }
+
+    const std::vector<Expr*>* best = nullptr;
+    size_t best_size = 0;
+    for (Expr* candidate : candidates_) {
+      const NodeInfo& info = info_.at(candidate);
+      if (info.size <= best_size) {
+        continue;
+      }
+      for (const std::vector<Expr*>& cls : classes[info.hash]) {
+        if (cls.front() == candidate && cls.size() > 1) {
+          best = &cls;
+          best_size = info.size;
+        }
+      }
+    }
+    if (best == nullptr) {
+      return {};
+    }
+    return *best;
+  }
+
+  const Resolver& resolver_;
+  AstImpl& ast_;
+  absl::flat_hash_set<std::string> comprehension_vars_;
+  absl::flat_hash_map<const Expr*, NodeInfo> info_;
+  std::vector<Expr*> candidates_;
+  int64_t next_id_ = 1;
+};
+
+class CommonSubexpressionEliminationTransform : public AstTransform {
+ public:
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    // Extracted definitions are planned as cel.bind comprehensions and are
+    // only deferred to their first use with lazy initialization.
+    if (!context.options().enable_lazy_bind_initialization ||
+        !context.options().enable_comprehension) {
+      return absl::OkStatus();
+    }
+    CommonSubexpressionEliminator(context.resolver(), ast).Run();
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<AstTransform> CreateCommonSubexpressionEliminationTransform() {
+  return std::make_unique<CommonSubexpressionEliminationTransform>();
+}
+
+}  // namespace google::api::expr::runtime
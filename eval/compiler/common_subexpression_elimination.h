@@ -0,0 +1,44 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMMON_SUBEXPRESSION_ELIMINATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMMON_SUBEXPRESSION_ELIMINATION_H_
+
+#include <memory>
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new AST transform that evaluates repeated subexpressions once.
+//
+// Structurally identical subtrees (same literals, fields, functions and, for
+// checked expressions, the same references and overloads) that occur more than
+// once are moved into a cel.bind definition at the root of the expression, and
+// every occurrence is replaced with a reference to the bound variable.
+//
+// Only side-effect-free subtrees are extracted: selects, literals, list, map
+// and message construction, calls to standard operators, and calls whose
+// overloads are all marked pure (see cel::FunctionDescriptor::is_pure).
+// Subtrees that contain comprehensions or reference comprehension variables
+// are left in place.
+//
+// The definitions rely on lazy bind initialization, so a subexpression that
+// is only reached through an unevaluated branch is still never evaluated. The
+// transform has no effect when enable_lazy_bind_initialization is disabled.
+std::unique_ptr<AstTransform> CreateCommonSubexpressionEliminationTransform();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMMON_SUBEXPRESSION_ELIMINATION_H_
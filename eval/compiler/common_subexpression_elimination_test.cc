@@ -0,0 +1,182 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/common_subexpression_elimination.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/kind.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_function.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_map_impl.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+// Returns its argument plus one and counts invocations.
+class CountingIncrement : public CelFunction {
+ public:
+  CountingIncrement(absl::string_view name, bool is_pure, int* calls)
+      : CelFunction(CelFunctionDescriptor(std::string(name),
+                                          /*receiver_style=*/false,
+                                          {cel::Kind::kInt64},
+                                          /*is_strict=*/true, is_pure)),
+        calls_(calls) {}
+
+  absl::Status Evaluate(absl::Span<const CelValue> arguments,
+                        CelValue* result,
+                        google::protobuf::Arena* arena) const override {
+    ++*calls_;
+    *result = CelValue::CreateInt64(arguments[0].Int64OrDie() + 1);
+    return absl::OkStatus();
+  }
+
+ private:
+  int* calls_;
+};
+
+class CommonSubexpressionEliminationTest : public testing::Test {
+ public:
+  void SetUp() override {
+    std::vector<std::pair<CelValue, CelValue>> labels{
+        {CelValue::CreateStringView("env"),
+         CelValue::CreateStringView("staging")}};
+    ASSERT_OK_AND_ASSIGN(labels_,
+                         CreateContainerBackedMap(absl::MakeSpan(labels)));
+    activation_.InsertValue("labels", CelValue::CreateMap(labels_.get()));
+    activation_.InsertValue("x", CelValue::CreateInt64(1));
+  }
+
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr) {
+    CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options_));
+    CEL_RETURN_IF_ERROR(
+        RegisterBuiltinFunctions(builder.GetRegistry(), options_));
+    CEL_RETURN_IF_ERROR(builder.GetRegistry()->Register(
+        std::make_unique<CountingIncrement>("pure_inc", /*is_pure=*/true,
+                                            &pure_calls_)));
+    CEL_RETURN_IF_ERROR(builder.GetRegistry()->Register(
+        std::make_unique<CountingIncrement>("inc", /*is_pure=*/false,
+                                            &impure_calls_)));
+    builder.flat_expr_builder().AddAstTransform(
+        CreateCommonSubexpressionEliminationTransform());
+
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<CelExpression> plan,
+                         builder.CreateExpression(&parsed_expr_.expr(),
+                                                  &parsed_expr_.source_info()));
+    return plan->Evaluate(activation_, &arena_);
+  }
+
+ protected:
+  InterpreterOptions options_;
+  exprpb::ParsedExpr parsed_expr_;
+  std::unique_ptr<CelMap> labels_;
+  Activation activation_;
+  google::protobuf::Arena arena_;
+  int pure_calls_ = 0;
+  int impure_calls_ = 0;
+};
+
+TEST_F(CommonSubexpressionEliminationTest, RepeatedIndex) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("labels['env'] == 'prod' || labels['env'] == 'staging'"));
+
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(CommonSubexpressionEliminationTest, PureCallEvaluatedOnce) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("pure_inc(x) + pure_inc(x) == 2 * pure_inc(x)"));
+
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_EQ(pure_calls_, 1);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, ImpureCallNotShared) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("inc(x) + inc(x)"));
+
+  EXPECT_THAT(result, test::IsCelInt64(Eq(4)));
+  EXPECT_EQ(impure_calls_, 2);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, UnevaluatedBranchesStayLazy) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("(x > 10 && pure_inc(x) > 0) || (x > 20 && pure_inc(x) > 1)"));
+
+  EXPECT_THAT(result, test::IsCelBool(false));
+  EXPECT_EQ(pure_calls_, 0);
+
+  ASSERT_OK_AND_ASSIGN(
+      result, Evaluate("x > 0 ? pure_inc(x) + pure_inc(x) : pure_inc(x)"));
+
+  EXPECT_THAT(result, test::IsCelInt64(Eq(4)));
+  EXPECT_EQ(pure_calls_, 1);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, LoopInvariantSharedAcrossIterations) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2, 3].all(i, pure_inc(x) > 0 && pure_inc(x) < 10)"));
+
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_EQ(pure_calls_, 1);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, ComprehensionVariablesNotShared) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2].all(i, pure_inc(i) == pure_inc(i)) && "
+               "[3].exists(i, pure_inc(i) == 4)"));
+
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_EQ(pure_calls_, 5);
+}
+
+TEST_F(CommonSubexpressionEliminationTest, RequiresLazyBindInitialization) {
+  options_.enable_lazy_bind_initialization = false;
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("pure_inc(x) + pure_inc(x)"));
+
+  EXPECT_THAT(result, test::IsCelInt64(Eq(4)));
+  EXPECT_EQ(pure_calls_, 2);
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,487 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/comprehension_fusion.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "eval/compiler/ast_matchers.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/subexpression_analysis.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Comprehension;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Ident;
+
+enum class MacroKind { kAll, kExists, kExistsOne, kMap };
+
+// Loop body of a comprehension with the shape generated by one of the standard
+// macros, as matched by the planner for specialized comprehension steps.
+struct Macro {
+  MacroKind kind;
+  // The predicate of all, exists, exists_one and filter, or the filter of a
+  // map with three arguments. Null for other maps.
+  Expr* predicate = nullptr;
+  // The transform of a map, or the iteration variable for filter. Null for the
+  // quantifiers.
+  Expr* transform = nullptr;
+};
+
+// Calls f on each identifier in expr that refers to the variable name of the
+// enclosing scope, with the variables bound around it by the comprehensions
+// nested in expr.
+void ForEachFreeReference(
+    Expr& expr, absl::string_view name,
+    std::vector<absl::string_view>& binders,
+    absl::FunctionRef<void(Expr&, absl::Span<const absl::string_view>)> f) {
+  if (expr.has_ident_expr()) {
+    if (expr.ident_expr().name() == name) {
+      f(expr, binders);
+    }
+    return;
+  }
+  if (!expr.has_comprehension_expr()) {
+    ForEachChild(expr, [&](Expr& child) {
+      ForEachFreeReference(child, name, binders, f);
+    });
+    return;
+  }
+  Comprehension& comprehension = expr.mutable_comprehension_expr();
+  ForEachFreeReference(comprehension.mutable_iter_range(), name, binders, f);
+  ForEachFreeReference(comprehension.mutable_accu_init(), name, binders, f);
+  // The accumulator shadows name in the loop and the result, the iteration
+  // variable only in the loop.
+  if (comprehension.accu_var() == name) {
+    return;
+  }
+  binders.push_back(comprehension.accu_var());
+  ForEachFreeReference(comprehension.mutable_result(), name, binders, f);
+  if (comprehension.iter_var() != name) {
+    binders.push_back(comprehension.iter_var());
+    ForEachFreeReference(comprehension.mutable_loop_condition(), name,
+                         binders, f);
+    ForEachFreeReference(comprehension.mutable_loop_step(), name, binders, f);
+    binders.pop_back();
+  }
+  binders.pop_back();
+}
+
+void ForEachFreeReference(
+    Expr& expr, absl::string_view name,
+    absl::FunctionRef<void(Expr&, absl::Span<const absl::string_view>)> f) {
+  std::vector<absl::string_view> binders;
+  ForEachFreeReference(expr, name, binders, f);
+}
+
+bool References(Expr& expr, absl::string_view name) {
+  bool references = false;
+  ForEachFreeReference(
+      expr, name,
+      [&](Expr&, absl::Span<const absl::string_view>) { references = true; });
+  return references;
+}
+
+bool IsIdentNamed(const Expr& expr, absl::string_view name) {
+  return expr.has_ident_expr() && expr.ident_expr().name() == name;
+}
+
+bool IsBoolConstant(const Expr& expr, bool value) {
+  return expr.has_const_expr() && expr.const_expr().has_bool_value() &&
+         expr.const_expr().bool_value() == value;
+}
+
+bool IsIntConstant(const Expr& expr, int64_t value) {
+  return expr.has_const_expr() && expr.const_expr().has_int64_value() &&
+         expr.const_expr().int64_value() == value;
+}
+
+// Returns the transform if expr is `accu_var + [transform]`, otherwise null.
+Expr* MatchListAppend(Expr& expr, absl::string_view accu_var) {
+  Call* add = AsGlobalCall(expr, cel::builtin::kAdd, 2);
+  if (add == nullptr || !IsIdentNamed(add->args()[0], accu_var) ||
+      !add->args()[1].has_list_expr()) {
+    return nullptr;
+  }
+  auto& list = add->mutable_args()[1].mutable_list_expr();
+  if (list.elements().size() != 1 || !list.optional_indices().empty()) {
+    return nullptr;
+  }
+  return &list.mutable_elements()[0];
+}
+
+// Matches comprehensions with the shape generated by the standard macros (see
+// MatchMacroComprehension in the planner) whose loop body doesn't reference
+// the accumulator.
+absl::optional<Macro> MatchMacro(Comprehension& comprehension) {
+  absl::string_view accu_var = comprehension.accu_var();
+  if (comprehension.iter_var().empty() || accu_var.empty() ||
+      comprehension.iter_var() == accu_var) {
+    return absl::nullopt;
+  }
+  const Expr& accu_init = comprehension.accu_init();
+  Expr& loop_condition = comprehension.mutable_loop_condition();
+  Expr& loop_step = comprehension.mutable_loop_step();
+  const Expr& result = comprehension.result();
+
+  Macro macro;
+  if (IsBoolConstant(accu_init, true) || IsBoolConstant(accu_init, false)) {
+    bool is_exists = IsBoolConstant(accu_init, false);
+    Call* condition =
+        AsGlobalCall(loop_condition, cel::builtin::kNotStrictlyFalse, 1);
+    if (condition == nullptr) {
+      condition = AsGlobalCall(loop_condition,
+                               cel::builtin::kNotStrictlyFalseDeprecated, 1);
+    }
+    if (condition == nullptr) {
+      return absl::nullopt;
+    }
+    Expr* condition_arg = &condition->mutable_args()[0];
+    if (is_exists) {
+      Call* negation = AsGlobalCall(*condition_arg, cel::builtin::kNot, 1);
+      if (negation == nullptr) {
+        return absl::nullopt;
+      }
+      condition_arg = &negation->mutable_args()[0];
+    }
+    Call* step = AsGlobalCall(
+        loop_step, is_exists ? cel::builtin::kOr : cel::builtin::kAnd, 2);
+    if (!IsIdentNamed(*condition_arg, accu_var) || step == nullptr ||
+        !IsIdentNamed(step->args()[0], accu_var) ||
+        !IsIdentNamed(result, accu_var)) {
+      return absl::nullopt;
+    }
+    macro.kind = is_exists ? MacroKind::kExists : MacroKind::kAll;
+    macro.predicate = &step->mutable_args()[1];
+  } else if (IsIntConstant(accu_init, 0)) {
+    Call* step = AsGlobalCall(loop_step, cel::builtin::kTernary, 3);
+    if (!IsBoolConstant(loop_condition, true) || step == nullptr ||
+        !IsIdentNamed(step->args()[2], accu_var)) {
+      return absl::nullopt;
+    }
+    Call* increment = AsGlobalCall(step->mutable_args()[1], cel::builtin::kAdd,
+                                   2);
+    Call* equals = AsGlobalCall(comprehension.mutable_result(),
+                                cel::builtin::kEqual, 2);
+    if (increment == nullptr || !IsIdentNamed(increment->args()[0], accu_var) ||
+        !IsIntConstant(increment->args()[1], 1) || equals == nullptr ||
+        !IsIdentNamed(equals->args()[0], accu_var) ||
+        !IsIntConstant(equals->args()[1], 1)) {
+      return absl::nullopt;
+    }
+    macro.kind = MacroKind::kExistsOne;
+    macro.predicate = &step->mutable_args()[0];
+  } else if (accu_init.has_list_expr() &&
+             accu_init.list_expr().elements().empty()) {
+    if (!IsBoolConstant(loop_condition, true) ||
+        !IsIdentNamed(result, accu_var)) {
+      return absl::nullopt;
+    }
+    Expr* append = &loop_step;
+    if (Call* step = AsGlobalCall(loop_step, cel::builtin::kTernary, 3);
+        step != nullptr) {
+      if (!IsIdentNamed(step->args()[2], accu_var)) {
+        return absl::nullopt;
+      }
+      macro.predicate = &step->mutable_args()[0];
+      append = &step->mutable_args()[1];
+    }
+    macro.kind = MacroKind::kMap;
+    macro.transform = MatchListAppend(*append, accu_var);
+    if (macro.transform == nullptr) {
+      return absl::nullopt;
+    }
+  } else {
+    return absl::nullopt;
+  }
+
+  if ((macro.predicate != nullptr && References(*macro.predicate, accu_var)) ||
+      (macro.transform != nullptr && References(*macro.transform, accu_var))) {
+    return absl::nullopt;
+  }
+  return macro;
+}
+
+class ComprehensionFuser {
+ public:
+  explicit ComprehensionFuser(AstImpl& ast) : ast_(ast) {}
+
+  void Run() {
+    // Post-order, so that the ranges of a comprehension are fused before the
+    // comprehension itself and chains collapse into one comprehension.
+    std::vector<std::pair<Expr*, bool>> stack;
+    stack.push_back({&ast_.root_expr(), false});
+    while (!stack.empty()) {
+      auto [expr, children_done] = stack.back();
+      stack.pop_back();
+      if (!children_done) {
+        next_id_ = std::max(next_id_, expr->id() + 1);
+        stack.push_back({expr, true});
+        ForEachChild(*expr,
+                     [&](Expr& child) { stack.push_back({&child, false}); });
+      } else {
+        pending_.push_back(expr);
+      }
+    }
+    // New ids are only allocated once all of the existing ones are known.
+    for (Expr* expr : pending_) {
+      if (expr->has_comprehension_expr()) {
+        FuseComprehension(*expr);
+      } else if (expr->has_call_expr()) {
+        FuseSize(*expr);
+      }
+    }
+  }
+
+ private:
+  // Fuses the comprehension expr with its range, if the range is the result
+  // of a map or filter.
+  void FuseComprehension(Expr& expr) {
+    Comprehension& consumer = expr.mutable_comprehension_expr();
+    if (!consumer.mutable_iter_range().has_comprehension_expr()) {
+      return;
+    }
+    Comprehension& producer =
+        consumer.mutable_iter_range().mutable_comprehension_expr();
+    absl::optional<Macro> produced = MatchMacro(producer);
+    if (!produced.has_value() || produced->kind != MacroKind::kMap) {
+      return;
+    }
+    absl::optional<Macro> consumed = MatchMacro(consumer);
+    if (!consumed.has_value()) {
+      return;
+    }
+
+    const std::string& iter_var = producer.iter_var();
+    const std::string& accu_var = consumer.accu_var();
+    Expr& transform = *produced->transform;
+    // The predicate and transform of the producer are moved into the scope
+    // of the consumer's accumulator, and the loop body of the consumer into
+    // the scope of the producer's iteration variable.
+    if (iter_var == accu_var ||
+        (produced->predicate != nullptr &&
+         References(*produced->predicate, accu_var)) ||
+        References(transform, accu_var) ||
+        References(consumer.mutable_loop_condition(), iter_var) ||
+        References(consumer.mutable_loop_condition(), consumer.iter_var())) {
+      return;
+    }
+    std::vector<Expr*> bodies;
+    if (consumed->predicate != nullptr) {
+      bodies.push_back(consumed->predicate);
+    }
+    if (consumed->transform != nullptr) {
+      bodies.push_back(consumed->transform);
+    }
+    if (consumer.iter_var() != iter_var) {
+      for (Expr* body : bodies) {
+        if (References(*body, iter_var)) {
+          return;
+        }
+      }
+    }
+    if (!Substitute(bodies, consumer.iter_var(), transform)) {
+      return;
+    }
+
+    if (produced->predicate != nullptr) {
+      Expr predicate = std::move(*produced->predicate);
+      if (consumed->predicate != nullptr) {
+        // Elements filtered out by the producer don't affect the result of
+        // the quantifiers.
+        bool skipped = consumed->kind == MacroKind::kAll;
+        *consumed->predicate =
+            Conditional(std::move(predicate), std::move(*consumed->predicate),
+                        BoolConstant(skipped));
+      } else {
+        Expr step = std::move(consumer.mutable_loop_step());
+        consumer.mutable_loop_step() =
+            Conditional(std::move(predicate), std::move(step),
+                        Expr(next_id_++, Ident(accu_var)));
+      }
+    }
+    consumer.set_iter_var(iter_var);
+    consumer.set_iter_range(
+        std::make_unique<Expr>(std::move(producer.mutable_iter_range())));
+  }
+
+  // Counts the matching elements of a filter passed to size() instead of
+  // building the filtered list.
+  void FuseSize(Expr& expr) {
+    Call& call = expr.mutable_call_expr();
+    if (call.function() != cel::builtin::kSize) {
+      return;
+    }
+    Expr* range;
+    if (call.has_target() && call.args().empty()) {
+      range = &call.mutable_target();
+    } else if (!call.has_target() && call.args().size() == 1) {
+      range = &call.mutable_args()[0];
+    } else {
+      return;
+    }
+    if (!range->has_comprehension_expr()) {
+      return;
+    }
+    Comprehension& producer = range->mutable_comprehension_expr();
+    absl::optional<Macro> produced = MatchMacro(producer);
+    if (!produced.has_value() || produced->kind != MacroKind::kMap) {
+      return;
+    }
+
+    Expr& source = producer.mutable_iter_range();
+    if (produced->predicate == nullptr) {
+      // The size of a checked call was resolved for a list argument.
+      if (ast_.IsChecked()) {
+        auto type = ast_.type_map().find(source.id());
+        if (type == ast_.type_map().end() || !type->second.has_list_type()) {
+          return;
+        }
+      }
+      Expr list = std::move(source);
+      *range = std::move(list);
+      return;
+    }
+
+    std::string accu_var = producer.accu_var();
+    Constant one;
+    one.set_int64_value(1);
+    std::vector<Expr> increment_args;
+    increment_args.push_back(Expr(next_id_++, Ident(accu_var)));
+    increment_args.push_back(Expr(next_id_++, std::move(one)));
+    Expr increment(next_id_++, Call(nullptr, std::string(cel::builtin::kAdd),
+                                    std::move(increment_args)));
+    Constant zero;
+    zero.set_int64_value(0);
+    Comprehension count(
+        producer.iter_var(), std::make_unique<Expr>(std::move(source)),
+        accu_var, std::make_unique<Expr>(next_id_++, std::move(zero)),
+        std::make_unique<Expr>(BoolConstant(true)),
+        std::make_unique<Expr>(Conditional(std::move(*produced->predicate),
+                                           std::move(increment),
+                                           Expr(next_id_++, Ident(accu_var)))),
+        std::make_unique<Expr>(next_id_++, Ident(accu_var)));
+    // The expression is no longer a call to the overload it was resolved to.
+    ast_.reference_map().erase(expr.id());
+    expr.set_expr_kind(std::move(count));
+  }
+
+  // Substitutes value for the free references to var in bodies. Returns false
+  // without modifying anything if that could evaluate value more than once
+  // per element, or if a comprehension nested in bodies would capture a
+  // variable that value references.
+  bool Substitute(absl::Span<Expr* const> bodies, absl::string_view var,
+                  Expr& value) {
+    bool trivial = value.has_ident_expr() || value.has_const_expr();
+    if (IsIdentNamed(value, var)) {
+      return true;
+    }
+    std::vector<Expr*> references;
+    bool substitutable = true;
+    for (Expr* body : bodies) {
+      ForEachFreeReference(
+          *body, var,
+          [&](Expr& reference, absl::Span<const absl::string_view> binders) {
+            references.push_back(&reference);
+            if (trivial) {
+              substitutable =
+                  substitutable &&
+                  (!value.has_ident_expr() ||
+                   !absl::c_linear_search(binders, value.ident_expr().name()));
+            } else {
+              // Nested comprehensions may evaluate the reference repeatedly.
+              substitutable = substitutable && binders.empty();
+            }
+          });
+    }
+    if (!substitutable || (!trivial && references.size() > 1)) {
+      return false;
+    }
+    for (Expr* reference : references) {
+      if (!trivial) {
+        *reference = std::move(value);
+        break;
+      }
+      int64_t id = next_id_++;
+      *reference = value.has_ident_expr()
+                       ? Expr(id, Ident(value.ident_expr().name()))
+                       : Expr(id, Constant(value.const_expr()));
+      if (auto type = ast_.type_map().find(value.id());
+          type != ast_.type_map().end()) {
+        ast_.type_map().insert_or_assign(id, type->second);
+      }
+    }
+    return true;
+  }
+
+  Expr Conditional(Expr condition, Expr then, Expr otherwise) {
+    std::vector<Expr> args;
+    args.push_back(std::move(condition));
+    args.push_back(std::move(then));
+    args.push_back(std::move(otherwise));
+    return Expr(next_id_++, Call(nullptr, std::string(cel::builtin::kTernary),
+                                 std::move(args)));
+  }
+
+  Expr BoolConstant(bool value) {
+    Constant constant;
+    constant.set_bool_value(value);
+    return Expr(next_id_++, std::move(constant));
+  }
+
+  AstImpl& ast_;
+  std::vector<Expr*> pending_;
+  int64_t next_id_ = 1;
+};
+
+class ComprehensionFusionTransform : public AstTransform {
+ public:
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    if (!context.options().enable_comprehension) {
+      return absl::OkStatus();
+    }
+    ComprehensionFuser(ast).Run();
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<AstTransform> CreateComprehensionFusionTransform() {
+  return std::make_unique<ComprehensionFusionTransform>();
+}
+
+}  // namespace google::api::expr::runtime
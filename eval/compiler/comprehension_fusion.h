@@ -0,0 +1,49 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_FUSION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_FUSION_H_
+
+#include <memory>
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new AST transform that evaluates comprehensions over the result of
+// a map or filter in a single pass over the original range, without building
+// the intermediate list.
+//
+// The transform rewrites, bottom-up:
+//  - comprehensions generated by the all, exists, exists_one, map and filter
+//    macros whose range is the result of a map or filter, e.g.
+//    `l.filter(x, p).exists(y, q)` to `l.exists(x, p ? q[y := x] : false)`.
+//    Chains such as `l.filter(...).map(...).exists(...)` are fused into a
+//    single comprehension.
+//  - `size(l.filter(x, p))` to a comprehension counting the elements of `l`
+//    matching `p`, and `size(l.map(x, t))` to `size(l)`.
+//
+// The transform of an element is substituted for the iteration variable of
+// the consuming comprehension. Comprehensions are only fused if that neither
+// evaluates the transform more than once per element nor changes what the
+// variables of either comprehension refer to.
+//
+// Elements are only transformed when they are consumed, so errors of
+// elements that are never consumed, e.g. after exists found a match, are not
+// reported.
+std::unique_ptr<AstTransform> CreateComprehensionFusionTransform();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_FUSION_H_
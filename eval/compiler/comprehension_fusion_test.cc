@@ -0,0 +1,215 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/comprehension_fusion.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Expr;
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+// Renders the ranges of comprehensions, calls, list literals, identifiers and
+// int constants, e.g. `fold(fold([1, 2]))`.
+std::string Describe(const Expr& expr) {
+  if (expr.has_const_expr() && expr.const_expr().has_int64_value()) {
+    return absl::StrCat(expr.const_expr().int64_value());
+  }
+  if (expr.has_ident_expr()) {
+    return expr.ident_expr().name();
+  }
+  if (expr.has_list_expr()) {
+    std::vector<std::string> elements;
+    for (const Expr& element : expr.list_expr().elements()) {
+      elements.push_back(Describe(element));
+    }
+    return absl::StrCat("[", absl::StrJoin(elements, ", "), "]");
+  }
+  if (expr.has_call_expr()) {
+    std::vector<std::string> operands;
+    if (expr.call_expr().has_target()) {
+      operands.push_back(Describe(expr.call_expr().target()));
+    }
+    for (const Expr& arg : expr.call_expr().args()) {
+      operands.push_back(Describe(arg));
+    }
+    return absl::StrCat(expr.call_expr().function(), "(",
+                        absl::StrJoin(operands, ", "), ")");
+  }
+  if (expr.has_comprehension_expr()) {
+    return absl::StrCat("fold(",
+                        Describe(expr.comprehension_expr().iter_range()), ")");
+  }
+  return "?";
+}
+
+// Records the expression left by the transforms that run before it.
+class RecordingTransform : public AstTransform {
+ public:
+  explicit RecordingTransform(std::string* description)
+      : description_(description) {}
+
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    *description_ = Describe(ast.root_expr());
+    return absl::OkStatus();
+  }
+
+ private:
+  std::string* description_;
+};
+
+class ComprehensionFusionTest : public testing::Test {
+ public:
+  void SetUp() override {
+    activation_.InsertValue("x", CelValue::CreateInt64(4));
+  }
+
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr) {
+    CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options_));
+    CEL_RETURN_IF_ERROR(
+        RegisterBuiltinFunctions(builder.GetRegistry(), options_));
+    builder.flat_expr_builder().AddAstTransform(
+        CreateComprehensionFusionTransform());
+    builder.flat_expr_builder().AddAstTransform(
+        std::make_unique<RecordingTransform>(&fused_));
+
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<CelExpression> plan,
+                         builder.CreateExpression(&parsed_expr_.expr(),
+                                                  &parsed_expr_.source_info()));
+    return plan->Evaluate(activation_, &arena_);
+  }
+
+ protected:
+  InterpreterOptions options_;
+  exprpb::ParsedExpr parsed_expr_;
+  Activation activation_;
+  google::protobuf::Arena arena_;
+  std::string fused_;
+};
+
+TEST_F(ComprehensionFusionTest, FusesQuantifiers) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2, 3].filter(i, i > 1).exists(j, j == 3)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 2, 3])"));
+
+  ASSERT_OK_AND_ASSIGN(result,
+                       Evaluate("[1, 2, 3].filter(i, i > 1).all(j, j > 1)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 2, 3])"));
+
+  ASSERT_OK_AND_ASSIGN(
+      result, Evaluate("[1, 2, 3].map(i, i * 2).exists_one(j, j == 4)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 2, 3])"));
+}
+
+TEST_F(ComprehensionFusionTest, FusesChains) {
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2, 3, 4].filter(i, i % 2 == 0).map(j, j * 10)"
+               ".all(k, k > 10)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 2, 3, 4])"));
+
+  // The filter would evaluate the transform of the first map twice per
+  // element, but the second map is fused with it.
+  ASSERT_OK_AND_ASSIGN(
+      result,
+      Evaluate("[1, 2, 3, 4].map(i, i * 10).filter(j, j > 10)"
+               ".map(k, k + 1) == [21, 31, 41]"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("_==_(fold(fold([1, 2, 3, 4])), [21, 31, 41])"));
+}
+
+TEST_F(ComprehensionFusionTest, FusesSize) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("size([1, 2, 3].filter(i, i > 1))"));
+  EXPECT_THAT(result, test::IsCelInt64(2));
+  EXPECT_THAT(fused_, Eq("fold([1, 2, 3])"));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("[1, 2, 3].map(i, i * 2).size()"));
+  EXPECT_THAT(result, test::IsCelInt64(3));
+  EXPECT_THAT(fused_, Eq("size([1, 2, 3])"));
+}
+
+TEST_F(ComprehensionFusionTest, KeepsRepeatedTransforms) {
+  // Substituting the transform would evaluate it twice per element.
+  ASSERT_OK_AND_ASSIGN(
+      CelValue result,
+      Evaluate("[1, 2].map(i, i + 1).map(j, j * j) == [4, 9]"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("_==_(fold(fold([1, 2])), [4, 9])"));
+
+  ASSERT_OK_AND_ASSIGN(
+      result, Evaluate("[1, 2].map(i, i + 1).exists(j, [5].exists(k, k == j + "
+                       "3))"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold(fold([1, 2]))"));
+}
+
+TEST_F(ComprehensionFusionTest, KeepsCapturedVariables) {
+  // x refers to the variable, not the iteration variable of map.
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("[1, 2].map(x, x * 2).exists(j, j == x)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold(fold([1, 2]))"));
+
+  ASSERT_OK_AND_ASSIGN(result,
+                       Evaluate("[1, 2].filter(i, i > 1).exists(i, i == 2)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 2])"));
+}
+
+TEST_F(ComprehensionFusionTest, SkipsUnconsumedElements) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("[1, 0].map(i, 1 / i).exists(j, j == 1)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(fused_, Eq("fold([1, 0])"));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -15,15 +15,18 @@
 #include "eval/compiler/comprehension_vulnerability_check.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <memory>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/variant.h"
 #include "base/ast_internal/ast_impl.h"
 #include "base/ast_internal/expr.h"
 #include "base/builtins.h"
+#include "eval/compiler/ast_matchers.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
 
 namespace google::api::expr::runtime {
@@ -222,6 +225,73 @@ bool ComprehensionHasMemoryExhaustionVulnerability(
   return ComprehensionAccumulationReferences(loop_step, accu_var) >= 2;
 }
 
+// Returns whether the variable var_name of the enclosing scope is referenced
+// in expr. Unlike ComprehensionAccumulationReferences, any reference counts.
+bool ReferencesVariable(const cel::ast_internal::Expr& expr,
+                        absl::string_view var_name) {
+  struct Handler {
+    absl::string_view var_name;
+
+    bool operator()(const cel::ast_internal::Call& call) {
+      if (call.has_target() && ReferencesVariable(call.target(), var_name)) {
+        return true;
+      }
+      return absl::c_any_of(call.args(),
+                            [this](const cel::ast_internal::Expr& arg) {
+                              return ReferencesVariable(arg, var_name);
+                            });
+    }
+    bool operator()(const Comprehension& comprehension) {
+      if (ReferencesVariable(comprehension.iter_range(), var_name) ||
+          ReferencesVariable(comprehension.accu_init(), var_name)) {
+        return true;
+      }
+      // The nested accumulator shadows var_name in the loop and the result,
+      // the nested iteration variable only in the loop.
+      if (comprehension.accu_var() == var_name) {
+        return false;
+      }
+      if (ReferencesVariable(comprehension.result(), var_name)) {
+        return true;
+      }
+      if (comprehension.iter_var() == var_name) {
+        return false;
+      }
+      return ReferencesVariable(comprehension.loop_condition(), var_name) ||
+             ReferencesVariable(comprehension.loop_step(), var_name);
+    }
+    bool operator()(const cel::ast_internal::CreateList& list) {
+      return absl::c_any_of(list.elements(),
+                            [this](const cel::ast_internal::Expr& element) {
+                              return ReferencesVariable(element, var_name);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateStruct& create_struct) {
+      return absl::c_any_of(
+          create_struct.entries(),
+          [this](const cel::ast_internal::CreateStruct::Entry& entry) {
+            return (entry.has_map_key() &&
+                    ReferencesVariable(entry.map_key(), var_name)) ||
+                   (entry.has_value() &&
+                    ReferencesVariable(entry.value(), var_name));
+          });
+    }
+    bool operator()(const cel::ast_internal::Select& select) {
+      return ReferencesVariable(select.operand(), var_name);
+    }
+    bool operator()(const cel::ast_internal::Ident& ident) {
+      return ident.name() == var_name;
+    }
+    bool operator()(const cel::ast_internal::Constant&) { return false; }
+    bool operator()(absl::monostate) { return false; }
+  } handler{var_name};
+  return absl::visit(handler, expr.expr_kind());
+}
+
+bool IsIdent(const cel::ast_internal::Expr& expr, absl::string_view name) {
+  return expr.has_ident_expr() && expr.ident_expr().name() == name;
+}
+
 class ComprehensionVulnerabilityCheck : public ProgramOptimizer {
  public:
   absl::Status OnPreVisit(PlannerContext& context,
@@ -249,4 +319,29 @@ ProgramOptimizerFactory CreateComprehensionVulnerabilityCheck() {
   };
 }
 
+bool IsAppendOnlyListAccumulator(const Comprehension& comprehension) {
+  absl::string_view accu_var = comprehension.accu_var();
+  if (accu_var.empty() || !comprehension.accu_init().has_list_expr() ||
+      !IsIdent(comprehension.result(), accu_var) ||
+      ReferencesVariable(comprehension.loop_condition(), accu_var)) {
+    return false;
+  }
+
+  const cel::ast_internal::Expr* append = &comprehension.loop_step();
+  if (const cel::ast_internal::Call* ternary =
+          AsGlobalCall(*append, cel::builtin::kTernary, 3);
+      ternary != nullptr) {
+    if (ReferencesVariable(ternary->args()[0], accu_var) ||
+        !IsIdent(ternary->args()[2], accu_var)) {
+      return false;
+    }
+    append = &ternary->args()[1];
+  }
+  const cel::ast_internal::Call* add =
+      AsGlobalCall(*append, cel::builtin::kAdd, 2);
+  return add != nullptr && IsIdent(add->args()[0], accu_var) &&
+         add->args()[1].has_list_expr() &&
+         !ReferencesVariable(add->args()[1], accu_var);
+}
+
 }  // namespace google::api::expr::runtime
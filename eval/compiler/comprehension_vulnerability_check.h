@@ -16,6 +16,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_VULNERABILITY_CHECK_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_VULNERABILITY_CHECK_H_
 
+#include "base/ast_internal/expr.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
 
 namespace google::api::expr::runtime {
@@ -46,6 +47,22 @@ namespace google::api::expr::runtime {
 // resulting list sizes per iteration: 2, 4, 8, 16.
 ProgramOptimizerFactory CreateComprehensionVulnerabilityCheck();
 
+// Returns whether the accumulator of comprehension is only ever extended by
+// appending a list literal, so that it can be built in place without the
+// mutation being observable:
+//
+//   accu_init:  a list literal
+//   loop_step:  accu + [elems] or predicate ? accu + [elems] : accu
+//   result:     accu
+//
+// where the accumulator is referenced nowhere else, taking shadowing by
+// nested comprehensions into account. The accumulator is then never aliased
+// and never read before the result.
+//
+// Like the vulnerability check, this recursively traverses the AST.
+bool IsAppendOnlyListAccumulator(
+    const cel::ast_internal::Comprehension& comprehension);
+
 }  // namespace google::api::expr::runtime
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COMPREHENSION_VULNERABILITY_CHECK_H_
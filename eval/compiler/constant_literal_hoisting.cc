@@ -0,0 +1,215 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/constant_literal_hoisting.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/values/error_value.h"
+#include "base/values/list_value.h"
+#include "base/values/unknown_value.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/eval/const_value_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "internal/status_macros.h"
+#include "runtime/activation.h"
+#include "runtime/internal/indexed_list_value.h"
+
+namespace cel::runtime_internal {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Expr;
+
+using ::google::api::expr::runtime::EvaluationListener;
+using ::google::api::expr::runtime::ExecutionFrame;
+using ::google::api::expr::runtime::ExecutionPath;
+using ::google::api::expr::runtime::ExecutionPathView;
+using ::google::api::expr::runtime::FlatExpressionEvaluatorState;
+using ::google::api::expr::runtime::PlannerContext;
+using ::google::api::expr::runtime::ProgramOptimizer;
+using ::google::api::expr::runtime::ProgramOptimizerFactory;
+
+// Adds the operands of node which are probed for membership to operands.
+void AddMembershipOperands(const Expr& node,
+                           absl::flat_hash_set<const Expr*>& operands) {
+  if (!node.has_call_expr()) {
+    return;
+  }
+  const auto& call = node.call_expr();
+  if (call.args().size() != 2) {
+    return;
+  }
+  if (!call.has_target() && (call.function() == cel::builtin::kIn ||
+                             call.function() == cel::builtin::kInDeprecated ||
+                             call.function() == cel::builtin::kInFunction)) {
+    operands.insert(&call.args()[1]);
+    return;
+  }
+  // Functions from the sets extension, which may still be a receiver style
+  // call on the `sets` namespace if qualified identifiers are not rewritten.
+  absl::string_view function = call.function();
+  if (call.has_target()) {
+    if (!call.target().has_ident_expr() ||
+        call.target().ident_expr().name() != "sets") {
+      return;
+    }
+  } else if (!absl::ConsumePrefix(&function, "sets.")) {
+    return;
+  }
+  if (function == "contains" || function == "intersects" ||
+      function == "equivalent") {
+    operands.insert(&call.args()[0]);
+    operands.insert(&call.args()[1]);
+  }
+}
+
+class ConstantLiteralHoistingExtension : public ProgramOptimizer {
+ public:
+  explicit ConstantLiteralHoistingExtension(const TypeProvider& type_provider)
+      : state_(kDefaultStackLimit, kComprehensionSlotCount, type_provider,
+               MemoryManagerRef::ReferenceCounting()) {}
+
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override;
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override;
+
+ private:
+  enum class IsConst {
+    kConditional,
+    kNonConst,
+  };
+
+  static constexpr size_t kDefaultStackLimit = 8;
+  static constexpr size_t kComprehensionSlotCount = 0;
+
+  Activation empty_;
+  FlatExpressionEvaluatorState state_;
+
+  std::vector<IsConst> is_const_;
+  // Comprehension accumulator initializers may be appended to in place, so
+  // they are never shared between evaluations.
+  absl::flat_hash_set<const Expr*> accu_inits_;
+  // Lists probed for membership, i.e. right hand side operands of `in` and
+  // arguments of the sets extension functions.
+  absl::flat_hash_set<const Expr*> membership_operands_;
+};
+
+absl::Status ConstantLiteralHoistingExtension::OnPreVisit(
+    PlannerContext& context, const Expr& node) {
+  IsConst is_const = IsConst::kNonConst;
+  if (node.has_const_expr()) {
+    is_const = IsConst::kConditional;
+  } else if (node.has_list_expr()) {
+    // Empty lists are left alone to allow the comprehension list append
+    // optimization.
+    if (!node.list_expr().elements().empty() && !accu_inits_.contains(&node)) {
+      is_const = IsConst::kConditional;
+    }
+  } else if (node.has_struct_expr()) {
+    // Messages are not hoisted, as they may be mutated by message builders.
+    if (!node.struct_expr().entries().empty() &&
+        node.struct_expr().message_name().empty() &&
+        !accu_inits_.contains(&node)) {
+      is_const = IsConst::kConditional;
+    }
+  } else if (node.has_comprehension_expr()) {
+    accu_inits_.insert(&node.comprehension_expr().accu_init());
+  } else {
+    AddMembershipOperands(node, membership_operands_);
+  }
+  is_const_.push_back(is_const);
+  return absl::OkStatus();
+}
+
+absl::Status ConstantLiteralHoistingExtension::OnPostVisit(
+    PlannerContext& context, const Expr& node) {
+  if (is_const_.empty()) {
+    return absl::InternalError(
+        "ConstantLiteralHoistingExtension called out of order.");
+  }
+
+  IsConst is_const = is_const_.back();
+  is_const_.pop_back();
+
+  if (is_const == IsConst::kNonConst) {
+    // update parent
+    if (!is_const_.empty()) {
+      is_const_.back() = IsConst::kNonConst;
+    }
+    return absl::OkStatus();
+  }
+  if (node.has_const_expr()) {
+    // Already a single step.
+    return absl::OkStatus();
+  }
+  ExecutionPathView subplan = context.GetSubplan(node);
+  if (subplan.empty()) {
+    // This subexpression is already optimized out or suppressed.
+    return absl::OkStatus();
+  }
+
+  ExecutionFrame frame(subplan, empty_, context.options(), state_);
+  state_.Reset();
+  state_.value_stack().SetMaxSize(subplan.size());
+  auto result = frame.Evaluate(EvaluationListener());
+  // Invalid literals (e.g. maps with repeated keys) report their error at
+  // runtime.
+  if (!result.ok()) {
+    return absl::OkStatus();
+  }
+  Handle<Value> value = *std::move(result);
+  if (value->Is<ErrorValue>() || value->Is<UnknownValue>()) {
+    return absl::OkStatus();
+  }
+  if (value->Is<ListValue>() && membership_operands_.contains(&node)) {
+    CEL_ASSIGN_OR_RETURN(value, IndexedListValue::Create(
+                                    state_.value_factory(),
+                                    std::move(value).As<ListValue>()));
+  }
+
+  ExecutionPath new_plan;
+  CEL_ASSIGN_OR_RETURN(new_plan.emplace_back(),
+                       google::api::expr::runtime::CreateConstValueStep(
+                           std::move(value), node.id(), false));
+
+  return context.ReplaceSubplan(node, std::move(new_plan));
+}
+
+}  // namespace
+
+ProgramOptimizerFactory CreateConstantLiteralHoistingOptimizer() {
+  return [](PlannerContext& ctx, const AstImpl&)
+             -> absl::StatusOr<std::unique_ptr<ProgramOptimizer>> {
+    return std::make_unique<ConstantLiteralHoistingExtension>(
+        ctx.value_factory().type_provider());
+  };
+}
+
+}  // namespace cel::runtime_internal
@@ -0,0 +1,36 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_CONSTANT_LITERAL_HOISTING_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_CONSTANT_LITERAL_HOISTING_H_
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace cel::runtime_internal {
+
+// Create a new constant literal hoisting extension.
+// List and map literals whose elements are all constants (or constant
+// literals themselves) are built once at plan time and replaced by a single
+// constant step, so the literal is shared by all evaluations of the program.
+// Lists used as the right hand side of `in` or as arguments of the sets
+// extension functions are additionally indexed, see IndexedListValue.
+//
+// Unlike constant folding, no function calls are evaluated and the values are
+// reference counted, so no arena needs to outlive the program.
+google::api::expr::runtime::ProgramOptimizerFactory
+CreateConstantLiteralHoistingOptimizer();
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_CONSTANT_LITERAL_HOISTING_H_
@@ -0,0 +1,212 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/constant_literal_hoisting.h"
+
+#include <memory>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+MATCHER_P(ExpressionPlanSizeIs, size, "") {
+  const std::unique_ptr<CelExpression>& plan = arg;
+
+  const CelExpressionFlatImpl* impl =
+      dynamic_cast<CelExpressionFlatImpl*>(plan.get());
+
+  if (impl == nullptr) return false;
+  *result_listener << "got size " << impl->flat_expression().path().size();
+  return impl->flat_expression().path().size() == size;
+}
+
+class ConstantLiteralHoistingTest : public testing::Test {
+ public:
+  ConstantLiteralHoistingTest() : builder_(ConvertToRuntimeOptions(options_)) {}
+
+  void SetUp() override {
+    ASSERT_OK(RegisterBuiltinFunctions(builder_.GetRegistry(), options_));
+  }
+
+  absl::StatusOr<std::unique_ptr<CelExpression>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    return builder_.CreateExpression(&parsed_expr_.expr(),
+                                     &parsed_expr_.source_info());
+  }
+
+ protected:
+  InterpreterOptions options_;
+  CelExpressionBuilderFlatImpl builder_;
+  exprpb::ParsedExpr parsed_expr_;
+  google::protobuf::Arena arena_;
+};
+
+TEST_F(ConstantLiteralHoistingTest, ConstantList) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("[1, 2, [3, 4]]"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(1));
+
+  Activation activation;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+    ASSERT_TRUE(result.IsList());
+    ASSERT_EQ(result.ListOrDie()->size(), 3);
+    EXPECT_THAT((*result.ListOrDie())[1], test::IsCelInt64(Eq(2)));
+  }
+}
+
+TEST_F(ConstantLiteralHoistingTest, ConstantMap) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("{'a': [1, 2], 'b': {'c': 3}}.b.c"));
+
+  // Const map + select.
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelInt64(Eq(3)));
+}
+
+TEST_F(ConstantLiteralHoistingTest, NonConstantElement) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("[1, x, [2, 3]]"));
+
+  // Only the nested list is hoisted.
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(4));
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(5));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  ASSERT_TRUE(result.IsList());
+  EXPECT_THAT((*result.ListOrDie())[1], test::IsCelInt64(Eq(5)));
+}
+
+TEST_F(ConstantLiteralHoistingTest, InIndexedList) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      Plan("x in ['admin', 'editor', 'viewer', 'owner', 'auditor', "
+           "'billing', 'support', 'guest', 1, 2u]"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(3));
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateStringView("owner"));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  activation.InsertValue("x", CelValue::CreateStringView("root"));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(false));
+
+  activation.InsertValue("x", CelValue::CreateInt64(2));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  activation.InsertValue("x", CelValue::CreateDouble(1.0));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(ConstantLiteralHoistingTest, ComprehensionAccumulator) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("[1, 2, 3].map(i, i * 2)"));
+
+  Activation activation;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+    ASSERT_TRUE(result.IsList());
+    ASSERT_EQ(result.ListOrDie()->size(), 3);
+    EXPECT_THAT((*result.ListOrDie())[2], test::IsCelInt64(Eq(6)));
+  }
+}
+
+TEST_F(ConstantLiteralHoistingTest, InvalidLiteralFailsAtRuntime) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("{'a': 1, 'a': 2}"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(5));
+}
+
+TEST(ConstantLiteralHoistingHomogeneousTest, InIndexedList) {
+  InterpreterOptions options;
+  options.enable_heterogeneous_equality = false;
+  CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options));
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry(), options));
+
+  ASSERT_OK_AND_ASSIGN(exprpb::ParsedExpr parsed_expr,
+                       Parse("x in [1, 2, 3, 4, 5, 6, 7, 8, 9.5]"));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      builder.CreateExpression(&parsed_expr.expr(),
+                               &parsed_expr.source_info()));
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(3));
+
+  google::protobuf::Arena arena;
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(8));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  activation.InsertValue("x", CelValue::CreateDouble(9.5));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  // Numbers of different kinds are never equal under homogeneous equality.
+  activation.InsertValue("x", CelValue::CreateDouble(8.0));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelBool(false));
+
+  activation.InsertValue("x", CelValue::CreateUint64(8));
+  ASSERT_OK_AND_ASSIGN(result, plan->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelBool(false));
+}
+
+TEST(ConstantLiteralHoistingDisabledTest, NotHoisted) {
+  InterpreterOptions options;
+  options.enable_constant_literal_hoisting = false;
+  CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options));
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry(), options));
+
+  ASSERT_OK_AND_ASSIGN(exprpb::ParsedExpr parsed_expr, Parse("[1, 2, 3]"));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      builder.CreateExpression(&parsed_expr.expr(),
+                               &parsed_expr.source_info()));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(4));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,295 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/cost_estimation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "eval/compiler/subexpression_analysis.h"
+#include "runtime/cost_estimate.h"
+#include "re2/re2.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Expr;
+
+// Steps of one iteration of a comprehension besides its condition and step:
+// advancing the iterator and the jumps around the loop.
+constexpr uint64_t kIterationSteps = 3;
+
+uint64_t SaturatingAdd(uint64_t a, uint64_t b) {
+  return a > std::numeric_limits<uint64_t>::max() - b
+             ? std::numeric_limits<uint64_t>::max()
+             : a + b;
+}
+
+uint64_t SaturatingMul(uint64_t a, uint64_t b) {
+  if (a == 0 || b == 0) {
+    return 0;
+  }
+  return a > std::numeric_limits<uint64_t>::max() / b
+             ? std::numeric_limits<uint64_t>::max()
+             : a * b;
+}
+
+struct Cost {
+  uint64_t steps = 0;
+  uint64_t allocations = 0;
+
+  Cost& operator+=(const Cost& other) {
+    steps = SaturatingAdd(steps, other.steps);
+    allocations = SaturatingAdd(allocations, other.allocations);
+    return *this;
+  }
+
+  Cost operator*(uint64_t n) const {
+    return Cost{SaturatingMul(steps, n), SaturatingMul(allocations, n)};
+  }
+};
+
+// Whether calls to function return a value that doesn't need allocating
+// (e.g. a bool) or one of their arguments.
+bool IsNonAllocating(absl::string_view function) {
+  static constexpr absl::string_view kFunctions[] = {
+      cel::builtin::kAnd,
+      cel::builtin::kOr,
+      cel::builtin::kNot,
+      cel::builtin::kTernary,
+      cel::builtin::kNotStrictlyFalse,
+      cel::builtin::kNotStrictlyFalseDeprecated,
+      cel::builtin::kEqual,
+      cel::builtin::kInequal,
+      cel::builtin::kLess,
+      cel::builtin::kLessOrEqual,
+      cel::builtin::kGreater,
+      cel::builtin::kGreaterOrEqual,
+      cel::builtin::kIn,
+      cel::builtin::kInDeprecated,
+      cel::builtin::kInFunction,
+      cel::builtin::kIndex,
+      cel::builtin::kSize,
+      cel::builtin::kRegexMatch,
+      cel::builtin::kStringContains,
+      cel::builtin::kStringEndsWith,
+      cel::builtin::kStringStartsWith,
+  };
+  return std::find(std::begin(kFunctions), std::end(kFunctions), function) !=
+         std::end(kFunctions);
+}
+
+class CostEstimator {
+ public:
+  CostEstimator(const AstImpl& ast, const cel::CostEstimateOptions& options)
+      : ast_(ast), options_(options) {}
+
+  cel::CostEstimate Estimate() {
+    Cost cost = Visit(ast_.root_expr());
+    cel::CostEstimate estimate;
+    estimate.steps = cost.steps;
+    estimate.allocations = cost.allocations;
+    estimate.max_comprehension_depth = max_depth_;
+    return estimate;
+  }
+
+ private:
+  // A variable bound by an enclosing comprehension.
+  struct Variable {
+    absl::string_view name;
+    uint64_t size;
+    bool accumulator;
+  };
+
+  Cost Visit(const Expr& expr) {
+    if (expr.has_comprehension_expr()) {
+      return VisitComprehension(expr);
+    }
+    Cost cost{1, 0};
+    ForEachChild(expr, [&](const Expr& child) { cost += Visit(child); });
+    if (expr.has_list_expr() || expr.has_struct_expr()) {
+      cost.allocations = SaturatingAdd(cost.allocations, 1);
+    } else if (expr.has_call_expr()) {
+      cost += CallCost(expr);
+    }
+    return cost;
+  }
+
+  Cost VisitComprehension(const Expr& expr) {
+    const auto& comprehension = expr.comprehension_expr();
+    Cost cost{1, 1};
+    cost += Visit(comprehension.iter_range());
+    cost += Visit(comprehension.accu_init());
+
+    uint64_t iterations = Size(comprehension.iter_range());
+    uint64_t accu_size =
+        SaturatingAdd(Size(comprehension.accu_init()), iterations);
+    variables_.push_back(
+        Variable{comprehension.iter_var(), options_.default_size, false});
+    variables_.push_back(Variable{comprehension.accu_var(), accu_size, true});
+    ++depth_;
+    max_depth_ = std::max(max_depth_, depth_);
+
+    Cost iteration{kIterationSteps, 0};
+    iteration += Visit(comprehension.loop_condition());
+    iteration += Visit(comprehension.loop_step());
+    cost += iteration * iterations;
+    cost += Visit(comprehension.result());
+
+    --depth_;
+    variables_.pop_back();
+    variables_.pop_back();
+    return cost;
+  }
+
+  // The cost of a call beyond evaluating its arguments.
+  Cost CallCost(const Expr& expr) {
+    const auto& call = expr.call_expr();
+    absl::string_view function = call.function();
+    Cost cost{0, IsNonAllocating(function) ? 0u : 1u};
+
+    std::vector<const Expr*> args;
+    if (call.has_target()) {
+      args.push_back(&call.target());
+    }
+    for (const Expr& arg : call.args()) {
+      args.push_back(&arg);
+    }
+    if (args.size() != 2) {
+      return cost;
+    }
+
+    if (function == cel::builtin::kRegexMatch) {
+      cost.steps = SaturatingMul(RegexProgramSize(*args[1]), Size(*args[0]));
+    } else if (function == cel::builtin::kStringContains ||
+               function == cel::builtin::kStringStartsWith ||
+               function == cel::builtin::kStringEndsWith) {
+      cost.steps = Size(*args[0]);
+    } else if (function == cel::builtin::kIn ||
+               function == cel::builtin::kInDeprecated ||
+               function == cel::builtin::kInFunction) {
+      cost.steps = Size(*args[1]);
+    } else if (function == cel::builtin::kAdd) {
+      // Appending to the accumulator of a comprehension is done in place.
+      for (const Expr* arg : args) {
+        if (!IsAccumulator(*arg)) {
+          cost.steps = SaturatingAdd(cost.steps, Size(*arg));
+        }
+      }
+    }
+    return cost;
+  }
+
+  uint64_t RegexProgramSize(const Expr& pattern) {
+    if (!pattern.has_const_expr() ||
+        !pattern.const_expr().has_string_value()) {
+      return options_.default_size;
+    }
+    RE2 re(pattern.const_expr().string_value());
+    // Invalid patterns fail without matching.
+    return re.ok() ? re.ProgramSize() : 0;
+  }
+
+  bool IsAccumulator(const Expr& expr) {
+    const Variable* variable = FindVariable(expr);
+    return variable != nullptr && variable->accumulator;
+  }
+
+  const Variable* FindVariable(const Expr& expr) {
+    if (!expr.has_ident_expr()) {
+      return nullptr;
+    }
+    for (auto it = variables_.rbegin(); it != variables_.rend(); ++it) {
+      if (it->name == expr.ident_expr().name()) {
+        return &*it;
+      }
+    }
+    return nullptr;
+  }
+
+  // Estimated size of the value of expr: its elements, entries, characters
+  // or bytes.
+  uint64_t Size(const Expr& expr) {
+    if (expr.has_list_expr()) {
+      return expr.list_expr().elements().size();
+    }
+    if (expr.has_struct_expr()) {
+      return expr.struct_expr().entries().size();
+    }
+    if (expr.has_const_expr()) {
+      const auto& constant = expr.const_expr();
+      if (constant.has_string_value()) {
+        return constant.string_value().size();
+      }
+      if (constant.has_bytes_value()) {
+        return constant.bytes_value().size();
+      }
+      return 1;
+    }
+    if (const Variable* variable = FindVariable(expr); variable != nullptr) {
+      return variable->size;
+    }
+    if (expr.has_comprehension_expr()) {
+      // E.g. `map` and `filter` results are at most as large as their range.
+      const auto& comprehension = expr.comprehension_expr();
+      return SaturatingAdd(Size(comprehension.accu_init()),
+                           Size(comprehension.iter_range()));
+    }
+    if (expr.has_call_expr() &&
+        expr.call_expr().function() == cel::builtin::kAdd) {
+      uint64_t size = 0;
+      if (expr.call_expr().has_target()) {
+        size = Size(expr.call_expr().target());
+      }
+      for (const Expr& arg : expr.call_expr().args()) {
+        size = SaturatingAdd(size, Size(arg));
+      }
+      return size;
+    }
+    std::string path;
+    if (AppendAttributePath(ast_, expr, path)) {
+      if (auto hint = options_.size_hints.find(path);
+          hint != options_.size_hints.end()) {
+        return hint->second;
+      }
+    }
+    return options_.default_size;
+  }
+
+  const AstImpl& ast_;
+  const cel::CostEstimateOptions& options_;
+  std::vector<Variable> variables_;
+  int depth_ = 0;
+  int max_depth_ = 0;
+};
+
+}  // namespace
+
+cel::CostEstimate EstimateCost(const AstImpl& ast,
+                               const cel::CostEstimateOptions& options) {
+  return CostEstimator(ast, options).Estimate();
+}
+
+}  // namespace google::api::expr::runtime
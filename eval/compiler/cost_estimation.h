@@ -0,0 +1,37 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COST_ESTIMATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COST_ESTIMATION_H_
+
+#include "base/ast_internal/ast_impl.h"
+#include "runtime/cost_estimate.h"
+
+namespace google::api::expr::runtime {
+
+// Returns a static estimate of the cost of evaluating ast (see
+// cel::CostEstimate). plan_size is left unset.
+//
+// Every node counts as one step and every comprehension multiplies the cost
+// of its loop by the estimated size of its range: the number of elements of
+// a literal, the size hint of an attribute, or the size of the accumulator of
+// another comprehension (e.g. the result of `filter`). Calls whose cost
+// depends on their arguments (string search and concatenation, `in`, regular
+// expression matches) add the sizes of those arguments.
+cel::CostEstimate EstimateCost(const cel::ast_internal::AstImpl& ast,
+                               const cel::CostEstimateOptions& options);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_COST_ESTIMATION_H_
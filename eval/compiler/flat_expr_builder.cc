@@ -16,6 +16,8 @@
 
 #include "eval/compiler/flat_expr_builder.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstddef>
 #include <cstdint>
 #include <deque>
@@ -31,24 +33,35 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/node_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "base/ast.h"
 #include "base/ast_internal/ast_impl.h"
 #include "base/ast_internal/expr.h"
 #include "base/builtins.h"
+#include "base/kind.h"
 #include "base/memory.h"
 #include "base/type_factory.h"
 #include "base/type_provider.h"
 #include "base/value_factory.h"
+#include "eval/compiler/ast_matchers.h"
+#include "eval/compiler/comprehension_vulnerability_check.h"
+#include "eval/compiler/constant_literal_hoisting.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/planner_phase.h"
+#include "eval/compiler/profile_guided_ordering.h"
+#include "eval/compiler/referenced_attributes.h"
 #include "eval/compiler/resolver.h"
+#include "eval/eval/compact_program.h"
 #include "eval/eval/comprehension_step.h"
 #include "eval/eval/const_value_step.h"
 #include "eval/eval/container_access_step.h"
@@ -62,13 +75,19 @@
 #include "eval/eval/logic_step.h"
 #include "eval/eval/select_step.h"
 #include "eval/eval/shadowable_value_step.h"
+#include "eval/eval/step_arena.h"
 #include "eval/eval/ternary_step.h"
 #include "eval/public/ast_traverse_native.h"
+#include "eval/public/ast_visitor_native_base.h"
 #include "eval/public/ast_visitor_native.h"
 #include "eval/public/source_position_native.h"
 #include "internal/status_macros.h"
+#include "runtime/constant_pool.h"
+#include "runtime/evaluation_profile.h"
 #include "runtime/internal/issue_collector.h"
+#include "runtime/planner_stats.h"
 #include "runtime/runtime_issue.h"
+#include "runtime/runtime_metrics.h"
 #include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
@@ -176,6 +195,78 @@ class BinaryCondVisitor : public CondVisitor {
   bool short_circuiting_;
 };
 
+// Returns whether expr is a well-formed call to the binary logical operator
+// function, so that it can be planned as part of a chain of that operator.
+bool IsLogicalChainLink(const cel::ast_internal::Expr& expr,
+                        absl::string_view function) {
+  return expr.has_call_expr() && expr.call_expr().function() == function &&
+         !expr.call_expr().has_target() &&
+         expr.call_expr().args().size() == 2;
+}
+
+// Visitor managing chains of "&&" or "||" operations, e.g. a && b && c.
+//
+// Nested calls to the same operator are planned as a single n-ary operation.
+// Each operand is followed by a LogicalChainStep that merges it into the
+// result. With short-circuiting enabled, each step but the last jumps straight
+// to the end of the chain on the short-circuiting value:
+//   +-------------+------------------------+-----------------------+
+//   | PC          | Step                   | Stack                 |
+//   +-------------+------------------------+-----------------------+
+//   | i + 0       | <Arg1>                 | arg1                  |
+//   | i + 1       | ChainFirst i + 6       | r                     |
+//   | i + 2       | <Arg2>                 | r, arg2               |
+//   | i + 3       | ChainMerge i + 6       | r                     |
+//   | i + 4       | <Arg3>                 | r, arg3               |
+//   | i + 5       | ChainLast              | r                     |
+//   | i + 6       | <rest of program>      | r                     |
+//   +-------------+------------------------+-----------------------+
+//
+// Without short-circuiting, the step for the first operand is omitted.
+//
+// A visitor is created for every call in the chain. Visitors for the nested
+// calls forward their operands to the visitor for the outermost call.
+class LogicalChainCondVisitor : public CondVisitor {
+ public:
+  // Visitor for the outermost call of a chain.
+  LogicalChainCondVisitor(FlatExprVisitor* visitor, bool is_or,
+                          bool short_circuiting)
+      : visitor_(visitor),
+        is_or_(is_or),
+        short_circuiting_(short_circuiting),
+        root_(this) {}
+
+  // Visitor for a call nested in the chain of parent.
+  explicit LogicalChainCondVisitor(LogicalChainCondVisitor* parent)
+      : visitor_(parent->visitor_),
+        is_or_(parent->is_or_),
+        short_circuiting_(parent->short_circuiting_),
+        root_(parent->root_) {}
+
+  void PreVisit(const cel::ast_internal::Expr* expr) override;
+  void PostVisitArg(int arg_num, const cel::ast_internal::Expr* expr) override;
+  void PostVisit(const cel::ast_internal::Expr* expr) override;
+
+ private:
+  absl::string_view function() const {
+    return is_or_ ? cel::builtin::kOr : cel::builtin::kAnd;
+  }
+
+  // Adds the step following the next operand of the chain. Only called on the
+  // root.
+  void AddOperandStep();
+
+  FlatExprVisitor* visitor_;
+  const bool is_or_;
+  const bool short_circuiting_;
+  LogicalChainCondVisitor* root_;
+  // Bookkeeping for the whole chain, only used by the root.
+  int64_t expr_id_ = 0;
+  size_t operand_count_ = 0;
+  size_t planned_operands_ = 0;
+  std::vector<Jump> jumps_;
+};
+
 class TernaryCondVisitor : public CondVisitor {
  public:
   explicit TernaryCondVisitor(FlatExprVisitor* visitor) : visitor_(visitor) {}
@@ -247,6 +338,375 @@ bool IsOptimizableListAppend(
          call_expr->args()[0].ident_expr().name() == accu_var;
 }
 
+// Loop body of a comprehension with the shape generated by one of the standard
+// macros all, exists, exists_one, map and filter.
+struct MacroComprehension {
+  ComprehensionMacroKind kind;
+  // The predicate of all, exists, exists_one and filter, or the filter of a
+  // map with three arguments. Null for other maps.
+  const cel::ast_internal::Expr* predicate = nullptr;
+  // The transform of a map, or the iteration variable for filter. Null for the
+  // quantifiers.
+  const cel::ast_internal::Expr* transform = nullptr;
+  // Whether the loop body may be evaluated concurrently for different
+  // elements.
+  bool parallel = false;
+};
+
+// Returns whether name is referenced anywhere in expr, disregarding any
+// shadowing by nested comprehensions.
+bool ReferencesIdent(const cel::ast_internal::Expr& expr,
+                     absl::string_view name) {
+  struct Handler {
+    absl::string_view name;
+
+    bool operator()(const cel::ast_internal::Ident& ident) {
+      return ident.name() == name;
+    }
+    bool operator()(const cel::ast_internal::Select& select) {
+      return ReferencesIdent(select.operand(), name);
+    }
+    bool operator()(const cel::ast_internal::Call& call) {
+      if (call.has_target() && ReferencesIdent(call.target(), name)) {
+        return true;
+      }
+      return absl::c_any_of(call.args(),
+                            [this](const cel::ast_internal::Expr& arg) {
+                              return ReferencesIdent(arg, name);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateList& list) {
+      return absl::c_any_of(list.elements(),
+                            [this](const cel::ast_internal::Expr& element) {
+                              return ReferencesIdent(element, name);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateStruct& create_struct) {
+      for (const auto& entry : create_struct.entries()) {
+        if ((entry.has_map_key() && ReferencesIdent(entry.map_key(), name)) ||
+            (entry.has_value() && ReferencesIdent(entry.value(), name))) {
+          return true;
+        }
+      }
+      return false;
+    }
+    bool operator()(const cel::ast_internal::Comprehension& comprehension) {
+      return ReferencesIdent(comprehension.iter_range(), name) ||
+             ReferencesIdent(comprehension.accu_init(), name) ||
+             ReferencesIdent(comprehension.loop_condition(), name) ||
+             ReferencesIdent(comprehension.loop_step(), name) ||
+             ReferencesIdent(comprehension.result(), name);
+    }
+    bool operator()(const cel::ast_internal::Constant&) { return false; }
+    bool operator()(absl::monostate) { return false; }
+  } handler{name};
+  return absl::visit(handler, expr.expr_kind());
+}
+
+// Returns whether expr can be evaluated for different elements of a
+// comprehension at the same time: it only references iter_var, creates no
+// messages or nested comprehensions and only calls standard functions.
+bool IsParallelSafe(const cel::ast_internal::Expr& expr,
+                    absl::string_view iter_var) {
+  static const auto* const kParallelSafeFunctions =
+      new absl::flat_hash_set<absl::string_view>({
+          cel::builtin::kEqual,
+          cel::builtin::kInequal,
+          cel::builtin::kLess,
+          cel::builtin::kLessOrEqual,
+          cel::builtin::kGreater,
+          cel::builtin::kGreaterOrEqual,
+          cel::builtin::kAnd,
+          cel::builtin::kOr,
+          cel::builtin::kNot,
+          cel::builtin::kNotStrictlyFalse,
+          cel::builtin::kNotStrictlyFalseDeprecated,
+          cel::builtin::kAdd,
+          cel::builtin::kSubtract,
+          cel::builtin::kNeg,
+          cel::builtin::kMultiply,
+          cel::builtin::kDivide,
+          cel::builtin::kModulo,
+          cel::builtin::kRegexMatch,
+          cel::builtin::kStringContains,
+          cel::builtin::kStringEndsWith,
+          cel::builtin::kStringStartsWith,
+          cel::builtin::kIn,
+          cel::builtin::kInDeprecated,
+          cel::builtin::kInFunction,
+          cel::builtin::kIndex,
+          cel::builtin::kSize,
+          cel::builtin::kTernary,
+          cel::builtin::kDuration,
+          cel::builtin::kTimestamp,
+          cel::builtin::kFullYear,
+          cel::builtin::kMonth,
+          cel::builtin::kDayOfYear,
+          cel::builtin::kDayOfMonth,
+          cel::builtin::kDate,
+          cel::builtin::kDayOfWeek,
+          cel::builtin::kHours,
+          cel::builtin::kMinutes,
+          cel::builtin::kSeconds,
+          cel::builtin::kMilliseconds,
+          cel::builtin::kBytes,
+          cel::builtin::kDouble,
+          cel::builtin::kDyn,
+          cel::builtin::kInt,
+          cel::builtin::kString,
+          cel::builtin::kUint,
+      });
+
+  struct Handler {
+    absl::string_view iter_var;
+
+    bool operator()(const cel::ast_internal::Ident& ident) {
+      return ident.name() == iter_var;
+    }
+    bool operator()(const cel::ast_internal::Select& select) {
+      return IsParallelSafe(select.operand(), iter_var);
+    }
+    bool operator()(const cel::ast_internal::Call& call) {
+      if (!kParallelSafeFunctions->contains(call.function()) ||
+          (call.has_target() && !IsParallelSafe(call.target(), iter_var))) {
+        return false;
+      }
+      return absl::c_all_of(call.args(),
+                            [this](const cel::ast_internal::Expr& arg) {
+                              return IsParallelSafe(arg, iter_var);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateList& list) {
+      return absl::c_all_of(list.elements(),
+                            [this](const cel::ast_internal::Expr& element) {
+                              return IsParallelSafe(element, iter_var);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateStruct& create_struct) {
+      if (!create_struct.message_name().empty()) {
+        return false;
+      }
+      return absl::c_all_of(
+          create_struct.entries(),
+          [this](const cel::ast_internal::CreateStruct::Entry& entry) {
+            return entry.has_map_key() &&
+                   IsParallelSafe(entry.map_key(), iter_var) &&
+                   entry.has_value() && IsParallelSafe(entry.value(), iter_var);
+          });
+    }
+    bool operator()(const cel::ast_internal::Comprehension&) { return false; }
+    bool operator()(const cel::ast_internal::Constant&) { return true; }
+    bool operator()(absl::monostate) { return false; }
+  } handler{iter_var};
+  return absl::visit(handler, expr.expr_kind());
+}
+
+// Returns whether evaluating expr may produce an unknown value: it reads a
+// variable for which is_source returns true, or calls a function while
+// function_results is set (unknown function results are enabled). The
+// logical operators and the ternary only forward the unknowns of their
+// operands.
+bool MayProduceUnknowns(const cel::ast_internal::Expr& expr,
+                        absl::FunctionRef<bool(absl::string_view)> is_source,
+                        bool function_results) {
+  struct Handler {
+    absl::FunctionRef<bool(absl::string_view)> is_source;
+    bool function_results;
+
+    bool Recurse(const cel::ast_internal::Expr& expr) const {
+      return MayProduceUnknowns(expr, is_source, function_results);
+    }
+
+    bool operator()(const cel::ast_internal::Ident& ident) const {
+      return is_source(ident.name());
+    }
+    bool operator()(const cel::ast_internal::Select& select) const {
+      return Recurse(select.operand());
+    }
+    bool operator()(const cel::ast_internal::Call& call) const {
+      if (function_results && call.function() != cel::builtin::kAnd &&
+          call.function() != cel::builtin::kOr &&
+          call.function() != cel::builtin::kTernary) {
+        return true;
+      }
+      return (call.has_target() && Recurse(call.target())) ||
+             absl::c_any_of(call.args(),
+                            [this](const cel::ast_internal::Expr& arg) {
+                              return Recurse(arg);
+                            });
+    }
+    bool operator()(const cel::ast_internal::CreateList& list) const {
+      return absl::c_any_of(list.elements(),
+                            [this](const cel::ast_internal::Expr& element) {
+                              return Recurse(element);
+                            });
+    }
+    bool operator()(
+        const cel::ast_internal::CreateStruct& create_struct) const {
+      return absl::c_any_of(
+          create_struct.entries(),
+          [this](const cel::ast_internal::CreateStruct::Entry& entry) {
+            return (entry.has_map_key() && Recurse(entry.map_key())) ||
+                   (entry.has_value() && Recurse(entry.value()));
+          });
+    }
+    // The variables of the comprehension only hold values derived from its
+    // range and accumulator, which are checked here.
+    bool operator()(
+        const cel::ast_internal::Comprehension& comprehension) const {
+      return Recurse(comprehension.iter_range()) ||
+             Recurse(comprehension.accu_init()) ||
+             Recurse(comprehension.loop_condition()) ||
+             Recurse(comprehension.loop_step()) ||
+             Recurse(comprehension.result());
+    }
+    bool operator()(const cel::ast_internal::Constant&) const {
+      return false;
+    }
+    bool operator()(absl::monostate) const { return false; }
+  } handler{is_source, function_results};
+  return absl::visit(handler, expr.expr_kind());
+}
+
+bool IsIdentNamed(const cel::ast_internal::Expr& expr,
+                  absl::string_view name) {
+  return expr.has_ident_expr() && expr.ident_expr().name() == name;
+}
+
+bool IsBoolConstant(const cel::ast_internal::Expr& expr, bool value) {
+  return expr.has_const_expr() && expr.const_expr().has_bool_value() &&
+         expr.const_expr().bool_value() == value;
+}
+
+bool IsIntConstant(const cel::ast_internal::Expr& expr, int64_t value) {
+  return expr.has_const_expr() && expr.const_expr().has_int64_value() &&
+         expr.const_expr().int64_value() == value;
+}
+
+// Returns the transform if expr is `accu_var + [transform]`, otherwise null.
+const cel::ast_internal::Expr* MatchListAppend(
+    const cel::ast_internal::Expr& expr, absl::string_view accu_var) {
+  const cel::ast_internal::Call* add =
+      AsGlobalCall(expr, cel::builtin::kAdd, 2);
+  if (add == nullptr || !IsIdentNamed(add->args()[0], accu_var) ||
+      !add->args()[1].has_list_expr()) {
+    return nullptr;
+  }
+  const cel::ast_internal::CreateList& list = add->args()[1].list_expr();
+  if (list.elements().size() != 1 || !list.optional_indices().empty()) {
+    return nullptr;
+  }
+  return &list.elements()[0];
+}
+
+// Matches comprehensions with the shape generated by the standard macros:
+//
+//   all:        init true, condition @not_strictly_false(accu),
+//               step accu && predicate, result accu
+//   exists:     init false, condition @not_strictly_false(!accu),
+//               step accu || predicate, result accu
+//   exists_one: init 0, condition true,
+//               step predicate ? accu + 1 : accu, result accu == 1
+//   map:        init [], condition true,
+//               step accu + [transform] or
+//                    predicate ? accu + [transform] : accu, result accu
+//
+// Filter is a map with a predicate, where the transform is the iteration
+// variable. The loop body must not reference the accumulator, since the
+// specialized loops don't assign it to a slot.
+absl::optional<MacroComprehension> MatchMacroComprehension(
+    const cel::ast_internal::Comprehension& comprehension) {
+  absl::string_view accu_var = comprehension.accu_var();
+  const cel::ast_internal::Expr& accu_init = comprehension.accu_init();
+  const cel::ast_internal::Expr& loop_condition =
+      comprehension.loop_condition();
+  const cel::ast_internal::Expr& loop_step = comprehension.loop_step();
+  const cel::ast_internal::Expr& result = comprehension.result();
+
+  MacroComprehension macro;
+  if (IsBoolConstant(accu_init, true) || IsBoolConstant(accu_init, false)) {
+    bool is_exists = IsBoolConstant(accu_init, false);
+    const cel::ast_internal::Call* condition =
+        AsGlobalCall(loop_condition, cel::builtin::kNotStrictlyFalse, 1);
+    if (condition == nullptr) {
+      condition = AsGlobalCall(loop_condition,
+                               cel::builtin::kNotStrictlyFalseDeprecated, 1);
+    }
+    if (condition == nullptr) {
+      return absl::nullopt;
+    }
+    const cel::ast_internal::Expr* condition_arg = &condition->args()[0];
+    if (is_exists) {
+      const cel::ast_internal::Call* negation =
+          AsGlobalCall(*condition_arg, cel::builtin::kNot, 1);
+      if (negation == nullptr) {
+        return absl::nullopt;
+      }
+      condition_arg = &negation->args()[0];
+    }
+    const cel::ast_internal::Call* step = AsGlobalCall(
+        loop_step, is_exists ? cel::builtin::kOr : cel::builtin::kAnd, 2);
+    if (!IsIdentNamed(*condition_arg, accu_var) || step == nullptr ||
+        !IsIdentNamed(step->args()[0], accu_var) ||
+        !IsIdentNamed(result, accu_var)) {
+      return absl::nullopt;
+    }
+    macro.kind = is_exists ? ComprehensionMacroKind::kExists
+                           : ComprehensionMacroKind::kAll;
+    macro.predicate = &step->args()[1];
+  } else if (IsIntConstant(accu_init, 0)) {
+    const cel::ast_internal::Call* step =
+        AsGlobalCall(loop_step, cel::builtin::kTernary, 3);
+    if (!IsBoolConstant(loop_condition, true) || step == nullptr ||
+        !IsIdentNamed(step->args()[2], accu_var)) {
+      return absl::nullopt;
+    }
+    const cel::ast_internal::Call* increment =
+        AsGlobalCall(step->args()[1], cel::builtin::kAdd, 2);
+    const cel::ast_internal::Call* equals =
+        AsGlobalCall(result, cel::builtin::kEqual, 2);
+    if (increment == nullptr || !IsIdentNamed(increment->args()[0], accu_var) ||
+        !IsIntConstant(increment->args()[1], 1) || equals == nullptr ||
+        !IsIdentNamed(equals->args()[0], accu_var) ||
+        !IsIntConstant(equals->args()[1], 1)) {
+      return absl::nullopt;
+    }
+    macro.kind = ComprehensionMacroKind::kExistsOne;
+    macro.predicate = &step->args()[0];
+  } else if (accu_init.has_list_expr() &&
+             accu_init.list_expr().elements().empty()) {
+    if (!IsBoolConstant(loop_condition, true) ||
+        !IsIdentNamed(result, accu_var)) {
+      return absl::nullopt;
+    }
+    const cel::ast_internal::Expr* append = &loop_step;
+    if (const cel::ast_internal::Call* step =
+            AsGlobalCall(loop_step, cel::builtin::kTernary, 3);
+        step != nullptr) {
+      if (!IsIdentNamed(step->args()[2], accu_var)) {
+        return absl::nullopt;
+      }
+      macro.predicate = &step->args()[0];
+      append = &step->args()[1];
+    }
+    macro.kind = ComprehensionMacroKind::kMap;
+    macro.transform = MatchListAppend(*append, accu_var);
+    if (macro.transform == nullptr) {
+      return absl::nullopt;
+    }
+  } else {
+    return absl::nullopt;
+  }
+
+  if ((macro.predicate != nullptr &&
+       ReferencesIdent(*macro.predicate, accu_var)) ||
+      (macro.transform != nullptr &&
+       ReferencesIdent(*macro.transform, accu_var))) {
+    return absl::nullopt;
+  }
+  return macro;
+}
+
 bool IsBind(const cel::ast_internal::Comprehension* comprehension) {
   static constexpr absl::string_view kUnusedIterVar = "#unused";
 
@@ -257,26 +717,197 @@ bool IsBind(const cel::ast_internal::Comprehension* comprehension) {
          comprehension->iter_range().list_expr().elements().empty();
 }
 
+// Returns the kind of the runtime values of a checked type, if it has exactly
+// one. Dynamic, parameterized, wrapper and message types may be represented by
+// values of several kinds and are not mapped.
+absl::optional<cel::Kind> CheckedTypeToKind(
+    const cel::ast_internal::Type& type) {
+  if (type.has_null()) {
+    return cel::Kind::kNull;
+  }
+  if (type.has_primitive()) {
+    switch (type.primitive()) {
+      case cel::ast_internal::PrimitiveType::kBool:
+        return cel::Kind::kBool;
+      case cel::ast_internal::PrimitiveType::kInt64:
+        return cel::Kind::kInt;
+      case cel::ast_internal::PrimitiveType::kUint64:
+        return cel::Kind::kUint;
+      case cel::ast_internal::PrimitiveType::kDouble:
+        return cel::Kind::kDouble;
+      case cel::ast_internal::PrimitiveType::kString:
+        return cel::Kind::kString;
+      case cel::ast_internal::PrimitiveType::kBytes:
+        return cel::Kind::kBytes;
+      default:
+        return absl::nullopt;
+    }
+  }
+  if (type.has_well_known()) {
+    switch (type.well_known()) {
+      case cel::ast_internal::WellKnownType::kTimestamp:
+        return cel::Kind::kTimestamp;
+      case cel::ast_internal::WellKnownType::kDuration:
+        return cel::Kind::kDuration;
+      default:
+        return absl::nullopt;
+    }
+  }
+  if (type.has_list_type()) {
+    return cel::Kind::kList;
+  }
+  if (type.has_map_type()) {
+    return cel::Kind::kMap;
+  }
+  if (type.has_type()) {
+    return cel::Kind::kType;
+  }
+  return absl::nullopt;
+}
+
+// Number of values a comprehension keeps on the value stack while its loop
+// runs: the range, the iteration state and the accumulator.
+constexpr size_t kComprehensionStackOverhead = 3;
+
+// Computes the value stack depth of each node bottom-up during a traversal,
+// rather than recursively, so deeply nested expressions cannot overflow the
+// call stack.
+class StackDepthVisitor : public cel::ast_internal::AstVisitorBase {
+ public:
+  explicit StackDepthVisitor(bool flatten_add_chains)
+      : flatten_add_chains_(flatten_add_chains) {}
+
+  void PostVisitExpr(const cel::ast_internal::Expr* expr,
+                     const cel::ast_internal::SourcePosition*) override {
+    // The depths of the operands of expr are on top of depths_, in order.
+    struct Handler {
+      size_t operator()(const cel::ast_internal::Select& select) {
+        return select.has_operand() ? Pop(1)[0] : 1;
+      }
+      size_t operator()(const cel::ast_internal::Call& call) {
+        if (flatten_add_chains && !call.has_target() &&
+            call.function() == cel::builtin::kAdd && call.args().size() == 2) {
+          return AddChain();
+        }
+        return Operands(call.args().size() + (call.has_target() ? 1 : 0));
+      }
+      size_t operator()(const cel::ast_internal::CreateList& list) {
+        return Operands(list.elements().size());
+      }
+      size_t operator()(const cel::ast_internal::CreateStruct& create_struct) {
+        size_t count = 0;
+        for (const auto& entry : create_struct.entries()) {
+          count += (entry.has_map_key() ? 1 : 0) + (entry.has_value() ? 1 : 0);
+        }
+        return Operands(count);
+      }
+      size_t operator()(const cel::ast_internal::Comprehension& comprehension) {
+        // iter_range, accu_init, loop_condition, loop_step and result.
+        std::vector<size_t> children = Pop(5);
+        size_t depth = std::max<size_t>(
+            1, *std::max_element(children.begin(), children.end()));
+        depth += kComprehensionStackOverhead;
+        if (IsBind(&comprehension)) {
+          depth += children[1];
+        }
+        return depth;
+      }
+      size_t operator()(const cel::ast_internal::Ident&) { return 1; }
+      size_t operator()(const cel::ast_internal::Constant&) { return 1; }
+      size_t operator()(absl::monostate) { return 1; }
+
+      // Operands stay on the stack while the remaining ones are evaluated.
+      size_t Operands(size_t count) {
+        std::vector<size_t> operands = Pop(count);
+        size_t depth = 1;
+        for (size_t i = 0; i < operands.size(); ++i) {
+          depth = std::max(depth, i + operands[i]);
+        }
+        return depth;
+      }
+
+      // A left-nested chain of `_+_` calls may be planned as one step taking
+      // all of the operands of the chain (see CreateStringConcatStep), which
+      // then stay on the stack until the end of the chain.
+      size_t AddChain() {
+        size_t lhs_operands = std::max<size_t>(chain_operands.end()[-2], 1);
+        std::vector<size_t> operands = Pop(2);
+        result_chain_operands = lhs_operands + 1;
+        return std::max(operands[0], lhs_operands + operands[1]);
+      }
+
+      std::vector<size_t> Pop(size_t count) {
+        std::vector<size_t> top(depths.end() - count, depths.end());
+        depths.resize(depths.size() - count);
+        chain_operands.resize(chain_operands.size() - count);
+        return top;
+      }
+
+      std::vector<size_t>& depths;
+      // The number of operands of the chain of `_+_` calls ending at each
+      // node, or 0 for other nodes.
+      std::vector<size_t>& chain_operands;
+      bool flatten_add_chains;
+      size_t result_chain_operands = 0;
+    };
+    Handler handler{depths_, chain_operands_, flatten_add_chains_};
+    size_t depth = absl::visit(handler, expr->expr_kind());
+    depths_.push_back(depth);
+    chain_operands_.push_back(handler.result_chain_operands);
+  }
+
+  size_t depth() const { return depths_.empty() ? 1 : depths_.back(); }
+
+ private:
+  bool flatten_add_chains_;
+  std::vector<size_t> depths_;
+  std::vector<size_t> chain_operands_;
+};
+
+// Returns an upper bound on the value stack depth reached while evaluating
+// expr, relying on the planner leaving exactly one value on the stack per
+// planned node. Operands stay on the stack while the remaining operands are
+// evaluated. Lazily initialized bind definitions are evaluated at their use,
+// on top of whatever is already on the stack.
+//
+// Plan rewrites (constant folding, fused selects, register operands) only
+// remove intermediate values, so the bound also holds for optimized plans,
+// except for flattened chains of string concatenations, which are accounted
+// for if flatten_add_chains is set.
+size_t MaxStackDepth(const cel::ast_internal::Expr& expr,
+                     bool flatten_add_chains) {
+  StackDepthVisitor visitor(flatten_add_chains);
+  cel::ast_internal::AstTraverse(&expr, /*source_info=*/nullptr, &visitor);
+  return visitor.depth();
+}
+
 // Visitor for Comprehension expressions.
 class ComprehensionVisitor {
  public:
   explicit ComprehensionVisitor(FlatExprVisitor* visitor, bool short_circuiting,
                                 bool is_trivial, size_t iter_slot,
-                                size_t accu_slot)
+                                size_t accu_slot,
+                                absl::optional<MacroComprehension> macro)
       : visitor_(visitor),
         next_step_(nullptr),
         cond_step_(nullptr),
         short_circuiting_(short_circuiting),
         is_trivial_(is_trivial),
         accu_init_extracted_(false),
+        clear_slot_(true),
         iter_slot_(iter_slot),
-        accu_slot_(accu_slot) {}
+        accu_slot_(accu_slot),
+        macro_(macro),
+        macro_start_step_(nullptr),
+        macro_filter_step_(nullptr) {}
 
   void PreVisit(const cel::ast_internal::Expr* expr);
   void PostVisitArg(cel::ast_internal::ComprehensionArg arg_num,
                     const cel::ast_internal::Expr* comprehension_expr) {
     if (is_trivial_) {
       PostVisitArgTrivial(arg_num, comprehension_expr);
+    } else if (macro_.has_value()) {
+      PostVisitArgMacro(arg_num, comprehension_expr);
     } else {
       PostVisitArgDefault(arg_num, comprehension_expr);
     }
@@ -285,6 +916,10 @@ class ComprehensionVisitor {
 
   void MarkAccuInitExtracted() { accu_init_extracted_ = true; }
 
+  // Marks that the bind slot is dedicated and assigned at most once per
+  // evaluation, so it need not be cleared when the bind result is computed.
+  void MarkSlotClearUnneeded() { clear_slot_ = false; }
+
  private:
   void PostVisitArgTrivial(cel::ast_internal::ComprehensionArg arg_num,
                            const cel::ast_internal::Expr* comprehension_expr);
@@ -292,6 +927,14 @@ class ComprehensionVisitor {
   void PostVisitArgDefault(cel::ast_internal::ComprehensionArg arg_num,
                            const cel::ast_internal::Expr* comprehension_expr);
 
+  void PostVisitArgMacro(cel::ast_internal::ComprehensionArg arg_num,
+                         const cel::ast_internal::Expr* comprehension_expr);
+
+  // Replaces the steps planned for the loop step with the loop body of the
+  // macro.
+  absl::Status PlanMacroLoopBody(
+      const cel::ast_internal::Expr* comprehension_expr);
+
   FlatExprVisitor* visitor_;
   ComprehensionNextStep* next_step_;
   ComprehensionCondStep* cond_step_;
@@ -300,8 +943,14 @@ class ComprehensionVisitor {
   bool short_circuiting_;
   bool is_trivial_;
   bool accu_init_extracted_;
+  bool clear_slot_;
   size_t iter_slot_;
   size_t accu_slot_;
+  absl::optional<MacroComprehension> macro_;
+  ComprehensionMacroStartStep* macro_start_step_;
+  ComprehensionMacroFilterStep* macro_filter_step_;
+  int macro_start_step_pos_;
+  int macro_filter_step_pos_;
 };
 
 class FlatExprVisitor : public cel::ast_internal::AstVisitor {
@@ -311,11 +960,14 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
       std::vector<std::unique_ptr<ProgramOptimizer>> program_optimizers,
       const absl::flat_hash_map<int64_t, cel::ast_internal::Reference>&
           reference_map,
+      const absl::flat_hash_map<int64_t, cel::ast_internal::Type>& type_map,
       ExpressionTable& expression_table, ExecutionPath& path,
       ValueFactory& value_factory, IssueCollector& issue_collector,
       PlannerContext::ProgramTree& program_tree,
-      PlannerContext& extension_context)
+      PlannerContext& extension_context, cel::PlannerStats* stats)
       : resolver_(resolver),
+        reference_map_(reference_map),
+        type_map_(type_map),
         expression_table_(expression_table),
         execution_path_(path),
         value_factory_(value_factory),
@@ -326,7 +978,8 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
         program_optimizers_(std::move(program_optimizers)),
         issue_collector_(issue_collector),
         program_tree_(program_tree),
-        extension_context_(extension_context) {}
+        extension_context_(extension_context),
+        stats_(stats) {}
 
   void PreVisitExpr(const cel::ast_internal::Expr* expr,
                     const cel::ast_internal::SourcePosition*) override {
@@ -340,6 +993,9 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
         suppressed_branches_.find(expr) != suppressed_branches_.end()) {
       resume_from_suppressed_branch_ = expr;
     }
+    if (expr->has_struct_expr() && expr->struct_expr().message_name().empty()) {
+      PlanConstantMapKeys(expr);
+    }
     if (!ProgramStructureTrackingEnabled()) {
       return;
     }
@@ -351,6 +1007,8 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     }
     parent_expr_ = expr;
 
+    ScopedPlannerPhase phase(OptimizerStats(),
+                             &cel::PlannerStats::program_optimizers);
     for (const std::unique_ptr<ProgramOptimizer>& optimizer :
          program_optimizers_) {
       absl::Status status = optimizer->OnPreVisit(extension_context_, *expr);
@@ -375,6 +1033,8 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     info.range_len = GetCurrentIndex() - info.range_start;
     parent_expr_ = info.parent;
 
+    ScopedPlannerPhase phase(OptimizerStats(),
+                             &cel::PlannerStats::program_optimizers);
     for (const std::unique_ptr<ProgramOptimizer>& optimizer :
          program_optimizers_) {
       absl::Status status = optimizer->OnPostVisit(extension_context_, *expr);
@@ -398,12 +1058,41 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
       return;
     }
 
+    if (options_.constant_pool != nullptr) {
+      if (const auto* string_value =
+              absl::get_if<std::string>(&const_expr->constant_kind());
+          string_value != nullptr) {
+        absl::StatusOr<cel::Handle<cel::Value>> value =
+            value_factory_.CreateUnownedStringValue(
+                options_.constant_pool->InternString(*string_value));
+        if (!value.ok()) {
+          SetProgressStatusError(value.status());
+          return;
+        }
+        AddStep(CreateConstValueStep(*std::move(value), expr->id()));
+        return;
+      }
+      if (const auto* bytes_value =
+              absl::get_if<cel::ast_internal::Bytes>(
+                  &const_expr->constant_kind());
+          bytes_value != nullptr) {
+        AddStep(CreateConstValueStep(
+            value_factory_.CreateUnownedBytesValue(
+                options_.constant_pool->InternString(bytes_value->bytes)),
+            expr->id()));
+        return;
+      }
+    }
+
     AddStep(CreateConstValueStep(*const_expr, expr->id(), value_factory_));
   }
 
   struct SlotLookupResult {
     int slot;
     int subexpression;
+    // Index in the comprehension stack of the lazily initialized bind the
+    // slot belongs to, if any.
+    int lazy_bind = -1;
   };
 
   // Helper to lookup a variable mapped to a slot.
@@ -427,11 +1116,10 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
         if (record.accu_var_in_scope &&
             record.comprehension->accu_var() == path) {
           int slot = record.accu_slot;
-          int subexpression = -1;
-          if (record.should_lazy_eval) {
-            subexpression = record.subexpression;
+          if (record.should_lazy_eval && !record.init_inlined) {
+            return {slot, record.subexpression, i};
           }
-          return {slot, subexpression};
+          return {slot, -1};
         }
       }
     }
@@ -469,8 +1157,8 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
       Handle<Value> const_value =
           resolver_.FindConstant(qualified_path, select_expr->id());
       if (const_value) {
-        AddStep(CreateShadowableValueStep(
-            qualified_path, std::move(const_value), select_expr->id()));
+        AddConstantIdent(qualified_path, std::move(const_value),
+                         select_expr->id());
         resolved_select_expr_ = select_expr;
         namespace_stack_.clear();
         return;
@@ -481,8 +1169,7 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     // Attempt to resolve a simple identifier as an enum or type constant value.
     Handle<Value> const_value = resolver_.FindConstant(path, expr->id());
     if (const_value) {
-      AddStep(
-          CreateShadowableValueStep(path, std::move(const_value), expr->id()));
+      AddConstantIdent(path, std::move(const_value), expr->id());
       return;
     }
 
@@ -490,6 +1177,11 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     SlotLookupResult slot = LookupSlot(path);
 
     if (slot.subexpression >= 0) {
+      ComprehensionStackRecord& record = comprehension_stack_[slot.lazy_bind];
+      if (MaybeInlineBindInit(expr, record)) {
+        return;
+      }
+      record.lazy_init_planned = true;
       AddStep(
           CreateCheckLazyInitStep(slot.slot, slot.subexpression, expr->id()));
       AddStep(CreateAssignSlotStep(slot.slot));
@@ -499,7 +1191,9 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
       return;
     }
 
-    AddStep(CreateIdentStep(*ident_expr, expr->id()));
+    AddStep(CreateIdentStep(*ident_expr, expr->id(),
+                            IsUnknownAttributeRoot(ident_expr->name()),
+                            VariableSlot(ident_expr->name())));
   }
 
   void PreVisitSelect(const cel::ast_internal::Select* select_expr,
@@ -584,15 +1278,36 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
       return;
     }
 
+    // Without short-circuiting, all operands are evaluated so that their
+    // unknowns are collected. Operators whose operands cannot produce any can
+    // still jump over them.
+    const bool short_circuiting =
+        options_.short_circuiting ||
+        (options_.enable_selective_short_circuiting &&
+         (call_expr->function() == cel::builtin::kAnd ||
+          call_expr->function() == cel::builtin::kOr ||
+          call_expr->function() == cel::builtin::kTernary) &&
+         !MayProduceUnknowns(*expr));
     std::unique_ptr<CondVisitor> cond_visitor;
-    if (call_expr->function() == cel::builtin::kAnd) {
+    if (options_.enable_logical_chains &&
+        (call_expr->function() == cel::builtin::kAnd ||
+         call_expr->function() == cel::builtin::kOr)) {
+      LogicalChainCondVisitor* chain = FindLogicalChainParent(expr);
+      if (chain != nullptr) {
+        cond_visitor = std::make_unique<LogicalChainCondVisitor>(chain);
+      } else {
+        cond_visitor = std::make_unique<LogicalChainCondVisitor>(
+            this, call_expr->function() == cel::builtin::kOr,
+            short_circuiting);
+      }
+    } else if (call_expr->function() == cel::builtin::kAnd) {
       cond_visitor = std::make_unique<BinaryCondVisitor>(
-          this, /* cond_value= */ false, options_.short_circuiting);
+          this, /* cond_value= */ false, short_circuiting);
     } else if (call_expr->function() == cel::builtin::kOr) {
       cond_visitor = std::make_unique<BinaryCondVisitor>(
-          this, /* cond_value= */ true, options_.short_circuiting);
+          this, /* cond_value= */ true, short_circuiting);
     } else if (call_expr->function() == cel::builtin::kTernary) {
-      if (options_.short_circuiting) {
+      if (short_circuiting) {
         cond_visitor = std::make_unique<TernaryCondVisitor>(this);
       } else {
         cond_visitor = std::make_unique<ExhaustiveTernaryCondVisitor>(this);
@@ -624,7 +1339,14 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
 
     // Special case for "_[_]".
     if (call_expr->function() == cel::builtin::kIndex) {
-      AddStep(CreateContainerAccessStep(*call_expr, expr->id()));
+      absl::optional<cel::Kind> key_kind;
+      if (!call_expr->args().empty()) {
+        auto key_type = type_map_.find(call_expr->args().back().id());
+        if (key_type != type_map_.end()) {
+          key_kind = CheckedTypeToKind(key_type->second);
+        }
+      }
+      AddStep(CreateContainerAccessStep(*call_expr, expr->id(), key_kind));
       return;
     }
 
@@ -685,7 +1407,8 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
         return;
       }
     }
-    AddStep(CreateFunctionStep(*call_expr, expr->id(), std::move(overloads)));
+    AddStep(CreateFunctionStep(*call_expr, expr->id(), std::move(overloads),
+                               CheckedArgumentKinds(*call_expr, expr->id())));
   }
 
   void PreVisitComprehension(
@@ -719,25 +1442,57 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
 
     size_t iter_slot, accu_slot;
     bool is_bind = IsBind(comprehension);
+    // With lazy initialization, slots reserved in bind scopes are never
+    // reused. A bind outside of any loop is then entered at most once per
+    // evaluation and the frame starts with cleared slots, so the trailing
+    // clear is only needed to reset the slot for the next iteration.
+    bool clear_bind_slot =
+        !options_.enable_lazy_bind_initialization || InLoopScope();
     if (is_bind) {
       accu_slot = iter_slot = index_manager_.ReserveSlots(1);
     } else {
       iter_slot = index_manager_.ReserveSlots(2);
       accu_slot = iter_slot + 1;
     }
+    absl::optional<MacroComprehension> macro;
+    if (!is_bind && !PlanningSuppressed() &&
+        options_.enable_specialized_comprehensions &&
+        options_.short_circuiting) {
+      macro = MatchMacroComprehension(*comprehension);
+      if (macro.has_value() && options_.parallel_comprehension_threads > 1) {
+        macro->parallel =
+            (macro->predicate == nullptr ||
+             IsParallelSafe(*macro->predicate, comprehension->iter_var())) &&
+            (macro->transform == nullptr ||
+             IsParallelSafe(*macro->transform, comprehension->iter_var()));
+      }
+    }
+    bool is_optimizable_list_append =
+        IsOptimizableListAppend(comprehension,
+                                options_.enable_comprehension_list_append) ||
+        (options_.enable_verified_comprehension_list_append &&
+         options_.enable_list_concat &&
+         IsAppendOnlyListAccumulator(*comprehension) &&
+         !resolver_
+              .FindOverloads(cel::builtin::kRuntimeListAppend,
+                             /*receiver_style=*/false, ArgumentsMatcher(2))
+              .empty());
     comprehension_stack_.push_back(
         {expr, comprehension, iter_slot, accu_slot,
-         /*subexpression=*/-1,
-         IsOptimizableListAppend(comprehension,
-                                 options_.enable_comprehension_list_append),
-         is_bind,
+         /*subexpression=*/-1, is_optimizable_list_append, is_bind,
          /*.iter_var_in_scope=*/false,
          /*.accu_var_in_scope=*/false,
          /*.in_accu_init=*/false,
          /*.should_lazy_eval=*/is_bind &&
              options_.enable_lazy_bind_initialization,
+         /*.init_inlined=*/false,
+         /*.lazy_init_planned=*/false,
          std::make_unique<ComprehensionVisitor>(
-             this, options_.short_circuiting, is_bind, iter_slot, accu_slot)});
+             this, options_.short_circuiting, is_bind, iter_slot, accu_slot,
+             macro)});
+    if (is_bind && !clear_bind_slot) {
+      comprehension_stack_.back().visitor->MarkSlotClearUnneeded();
+    }
     comprehension_stack_.back().visitor->PreVisit(expr);
   }
 
@@ -897,6 +1652,13 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
         ValidateOrError(entry.has_map_key(), "Map entry missing key");
         ValidateOrError(entry.has_value(), "Map entry missing value");
       }
+      if (auto it = constant_map_keys_.find(expr);
+          it != constant_map_keys_.end()) {
+        AddStep(CreateCreateStructStepForConstantKeyMap(std::move(it->second),
+                                                        expr->id()));
+        constant_map_keys_.erase(it);
+        return;
+      }
       AddStep(CreateCreateStructStepForMap(*struct_expr, expr->id()));
       return;
     }
@@ -923,6 +1685,21 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
 
   cel::ValueFactory& value_factory() { return value_factory_; }
 
+  // Resolves the keys of a map creation at plan time if they are distinct
+  // constants. The key branches are then suppressed, so that only the values
+  // are evaluated.
+  void PlanConstantMapKeys(const cel::ast_internal::Expr* expr) {
+    const auto& struct_expr = expr->struct_expr();
+    auto keys = GetConstantMapKeys(struct_expr, value_factory_);
+    if (!keys.has_value()) {
+      return;
+    }
+    for (const auto& entry : struct_expr.entries()) {
+      SuppressBranch(&entry.map_key());
+    }
+    constant_map_keys_[expr] = *std::move(keys);
+  }
+
   // Mark a branch as suppressed. The visitor will continue as normal, but
   // any emitted program steps are ignored.
   //
@@ -964,10 +1741,42 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     return (latest.first == expr) ? latest.second.get() : nullptr;
   }
 
+  // Returns the chain visitor for the enclosing call if expr is a direct
+  // operand of a call to the same logical operator, otherwise null.
+  LogicalChainCondVisitor* FindLogicalChainParent(
+      const cel::ast_internal::Expr* expr) const {
+    if (cond_visitor_stack_.empty()) {
+      return nullptr;
+    }
+    const auto& latest = cond_visitor_stack_.top();
+    absl::string_view function = expr->call_expr().function();
+    if (!IsLogicalChainLink(*expr, function) ||
+        !IsLogicalChainLink(*latest.first, function)) {
+      return nullptr;
+    }
+    for (const cel::ast_internal::Expr& arg :
+         latest.first->call_expr().args()) {
+      if (&arg == expr) {
+        // Logical chains are enabled, so every call to the operator is
+        // managed by a LogicalChainCondVisitor.
+        return static_cast<LogicalChainCondVisitor*>(latest.second.get());
+      }
+    }
+    return nullptr;
+  }
+
+  PlannerContext& extension_context() { return extension_context_; }
+
   IndexManager& index_manager() { return index_manager_; }
 
   size_t slot_count() const { return index_manager_.max_slot_count(); }
 
+  // Names of the variables the program looks up in the activation, in slot
+  // order.
+  std::vector<std::string> ExtractVariableNames() {
+    return std::move(variable_names_);
+  }
+
   void AddOptimizer(std::unique_ptr<ProgramOptimizer> optimizer) {
     program_optimizers_.push_back(std::move(optimizer));
   }
@@ -1000,6 +1809,12 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     bool accu_var_in_scope;
     bool in_accu_init;
     bool should_lazy_eval;
+    // Set once the lazy initialization has been planned inline at the first
+    // use, so remaining uses read the slot directly.
+    bool init_inlined;
+    // Set once a use has been planned to initialize the slot by calling into
+    // the subexpression, which must then stay in place.
+    bool lazy_init_planned;
     std::unique_ptr<ComprehensionVisitor> visitor;
   };
 
@@ -1007,11 +1822,112 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     return resume_from_suppressed_branch_ != nullptr;
   }
 
+  // Plans an identifier resolved to an enum or type constant, which may still
+  // be shadowed by a variable unless the variables are declared.
+  void AddConstantIdent(absl::string_view name, Handle<Value> value,
+                        int64_t expr_id) {
+    if (options_.declared_variables.has_value() &&
+        !absl::c_linear_search(*options_.declared_variables, name)) {
+      AddStep(CreateConstValueStep(std::move(value), expr_id));
+      return;
+    }
+    AddStep(CreateShadowableValueStep(std::string(name), std::move(value),
+                                      expr_id, VariableSlot(name)));
+  }
+
+  // Returns the slot of the activation variable name, assigning the next slot
+  // the first time the variable is referenced.
+  size_t VariableSlot(absl::string_view name) {
+    auto [it, inserted] =
+        variable_slots_.try_emplace(name, variable_names_.size());
+    if (inserted) {
+      variable_names_.push_back(std::string(name));
+    }
+    return it->second;
+  }
+
+  // Returns whether unknown patterns may refer to the variable `name`. All
+  // variables may be referred to unless the roots were declared.
+  bool IsUnknownAttributeRoot(absl::string_view name) const {
+    return options_.unknown_attribute_roots.empty() ||
+           absl::c_linear_search(options_.unknown_attribute_roots, name);
+  }
+
+  // Returns whether evaluating expr may produce an unknown value. Unknowns
+  // come from variables that unknown patterns may refer to, from variables of
+  // the enclosing comprehensions, whose values may be derived from those, and
+  // from function calls if unknown function results are enabled.
+  bool MayProduceUnknowns(const cel::ast_internal::Expr& expr) const {
+    if (options_.unknown_processing ==
+        cel::UnknownProcessingOptions::kDisabled) {
+      return false;
+    }
+    return google::api::expr::runtime::MayProduceUnknowns(
+        expr,
+        [this](absl::string_view name) {
+          return IsUnknownAttributeRoot(name) ||
+                 absl::c_any_of(comprehension_stack_,
+                                [name](const ComprehensionStackRecord& record) {
+                                  return record.comprehension->iter_var() ==
+                                             name ||
+                                         record.comprehension->accu_var() ==
+                                             name;
+                                });
+        },
+        options_.unknown_processing ==
+            cel::UnknownProcessingOptions::kAttributeAndFunction);
+  }
+
+  // Returns the runtime kinds of the arguments (including the receiver) of a
+  // call the type checker resolved to a single overload, or an empty vector if
+  // the call is overloaded, or an argument type is unknown or does not map to
+  // a single runtime kind. Calls without a reference, e.g. in parsed-only
+  // expressions whose types were inferred, are treated as not overloaded: the
+  // arguments are still matched to a single registered overload.
+  std::vector<cel::Kind> CheckedArgumentKinds(
+      const cel::ast_internal::Call& call, int64_t expr_id) const {
+    auto reference = reference_map_.find(expr_id);
+    if (reference != reference_map_.end() &&
+        reference->second.overload_id().size() != 1) {
+      return {};
+    }
+    std::vector<cel::Kind> kinds;
+    kinds.reserve(call.args().size() + (call.has_target() ? 1 : 0));
+    auto add_kind = [&](const cel::ast_internal::Expr& arg) {
+      auto type = type_map_.find(arg.id());
+      if (type == type_map_.end()) {
+        return false;
+      }
+      absl::optional<cel::Kind> kind = CheckedTypeToKind(type->second);
+      if (!kind.has_value()) {
+        return false;
+      }
+      kinds.push_back(*kind);
+      return true;
+    };
+    if (call.has_target() && !add_kind(call.target())) {
+      return {};
+    }
+    for (const auto& arg : call.args()) {
+      if (!add_kind(arg)) {
+        return {};
+      }
+    }
+    return kinds;
+  }
+
   bool ProgramStructureTrackingEnabled() {
     return options_.enable_lazy_bind_initialization ||
+           options_.enable_specialized_comprehensions ||
            !program_optimizers_.empty();
   }
 
+  // The stats to record the program optimizers in, or null if there are none
+  // to avoid timing empty loops.
+  cel::PlannerStats* OptimizerStats() {
+    return program_optimizers_.empty() ? nullptr : stats_;
+  }
+
   bool InBindScope() {
     for (const auto& record : comprehension_stack_) {
       if (record.is_optimizable_bind) {
@@ -1021,6 +1937,84 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
     return false;
   }
 
+  // Returns whether any enclosing comprehension may evaluate its
+  // subexpressions more than once.
+  bool InLoopScope() {
+    for (const auto& record : comprehension_stack_) {
+      if (!record.is_optimizable_bind) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns whether child is only conditionally evaluated when parent is, or
+  // may be evaluated more than once.
+  static bool IsConditionalBranch(const cel::ast_internal::Expr& parent,
+                                  const cel::ast_internal::Expr* child) {
+    if (parent.has_call_expr()) {
+      const cel::ast_internal::Call& call = parent.call_expr();
+      if (call.function() == cel::builtin::kAnd ||
+          call.function() == cel::builtin::kOr ||
+          call.function() == cel::builtin::kTernary) {
+        return call.args().empty() || child != &call.args()[0];
+      }
+      return false;
+    }
+    if (parent.has_comprehension_expr()) {
+      const cel::ast_internal::Comprehension& comprehension =
+          parent.comprehension_expr();
+      if (IsBind(&comprehension)) {
+        // Lazily initialized definitions are evaluated in a subexpression.
+        return child == &comprehension.accu_init();
+      }
+      return child == &comprehension.loop_condition() ||
+             child == &comprehension.loop_step() ||
+             child == &comprehension.result();
+    }
+    return false;
+  }
+
+  // Plans the lazy initialization of a bind inline, if expr is the first use
+  // of the bound variable in program order and is evaluated unconditionally
+  // whenever the result of the bind is. That use then runs before any other,
+  // so the definition is evaluated in place into the slot without calling
+  // into a subexpression, and remaining uses read the slot directly. Once an
+  // earlier, conditional use has been planned to call into the subexpression,
+  // later uses keep doing so.
+  bool MaybeInlineBindInit(const cel::ast_internal::Expr* expr,
+                           ComprehensionStackRecord& record) {
+    if (PlanningSuppressed() || !progress_status_.ok() ||
+        record.lazy_init_planned || record.subexpression <= 0 ||
+        record.subexpression > static_cast<int>(expression_table_.size())) {
+      return false;
+    }
+    const cel::ast_internal::Expr* result =
+        &record.comprehension->result();
+    const cel::ast_internal::Expr* node = expr;
+    while (node != result) {
+      auto it = program_tree_.find(node);
+      if (it == program_tree_.end() || it->second.parent == nullptr) {
+        return false;
+      }
+      const cel::ast_internal::Expr* parent = it->second.parent;
+      if (IsConditionalBranch(*parent, node)) {
+        return false;
+      }
+      node = parent;
+    }
+
+    // off by one since mainline expression is handled separately.
+    ExecutionPath& init = expression_table_[record.subexpression - 1];
+    for (std::unique_ptr<const ExpressionStep>& step : init) {
+      execution_path_.push_back(std::move(step));
+    }
+    init.clear();
+    AddStep(CreateAssignSlotStep(record.accu_slot));
+    record.init_inlined = true;
+    return true;
+  }
+
   absl::Status MaybeExtractSubexpression(const cel::ast_internal::Expr* expr,
                                          ComprehensionStackRecord& record) {
     if (!record.should_lazy_eval) {
@@ -1042,6 +2036,9 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
   }
 
   const Resolver& resolver_;
+  const absl::flat_hash_map<int64_t, cel::ast_internal::Reference>&
+      reference_map_;
+  const absl::flat_hash_map<int64_t, cel::ast_internal::Type>& type_map_;
   ExpressionTable& expression_table_;
   ExecutionPath& execution_path_;
   ValueFactory& value_factory_;
@@ -1071,13 +2068,19 @@ class FlatExprVisitor : public cel::ast_internal::AstVisitor {
 
   std::vector<ComprehensionStackRecord> comprehension_stack_;
   absl::flat_hash_set<const cel::ast_internal::Expr*> suppressed_branches_;
+  absl::flat_hash_map<const cel::ast_internal::Expr*,
+                      std::vector<cel::Handle<cel::Value>>>
+      constant_map_keys_;
   const cel::ast_internal::Expr* resume_from_suppressed_branch_ = nullptr;
   std::vector<std::unique_ptr<ProgramOptimizer>> program_optimizers_;
   IssueCollector& issue_collector_;
 
   PlannerContext::ProgramTree& program_tree_;
   PlannerContext extension_context_;
+  cel::PlannerStats* stats_;
   IndexManager index_manager_;
+  std::vector<std::string> variable_names_;
+  absl::flat_hash_map<std::string, size_t> variable_slots_;
 };
 
 void BinaryCondVisitor::PreVisit(const cel::ast_internal::Expr* expr) {
@@ -1112,6 +2115,77 @@ void BinaryCondVisitor::PostVisit(const cel::ast_internal::Expr* expr) {
   }
 }
 
+void LogicalChainCondVisitor::PreVisit(const cel::ast_internal::Expr* expr) {
+  if (root_ != this) {
+    return;
+  }
+  if (!visitor_->ValidateOrError(IsLogicalChainLink(*expr, function()),
+                                 "Invalid argument count for a binary "
+                                 "function call.")) {
+    return;
+  }
+  expr_id_ = expr->id();
+  // Count the operands of the chain up front, so the steps for the first and
+  // last operands can be identified as they are planned.
+  std::vector<const cel::ast_internal::Expr*> pending = {expr};
+  while (!pending.empty()) {
+    const cel::ast_internal::Expr* link = pending.back();
+    pending.pop_back();
+    for (const cel::ast_internal::Expr& arg : link->call_expr().args()) {
+      if (IsLogicalChainLink(arg, function())) {
+        pending.push_back(&arg);
+      } else {
+        ++operand_count_;
+      }
+    }
+  }
+  jumps_.reserve(operand_count_ - 1);
+}
+
+void LogicalChainCondVisitor::PostVisitArg(int arg_num,
+                                           const cel::ast_internal::Expr* expr) {
+  // Nested calls in the chain report their own operands.
+  if (!IsLogicalChainLink(expr->call_expr().args()[arg_num], function())) {
+    root_->AddOperandStep();
+  }
+}
+
+void LogicalChainCondVisitor::PostVisit(const cel::ast_internal::Expr* expr) {
+  if (root_ != this) {
+    return;
+  }
+  if (!visitor_->ValidateOrError(planned_operands_ == operand_count_,
+                                 "Error configuring logical chain: planned ",
+                                 planned_operands_, " of ", operand_count_,
+                                 " operands")) {
+    return;
+  }
+  // Every short-circuiting jump exits the whole chain.
+  for (Jump& jump : jumps_) {
+    jump.set_target(visitor_->GetCurrentIndex());
+  }
+}
+
+void LogicalChainCondVisitor::AddOperandStep() {
+  bool first = planned_operands_ == 0;
+  bool last = ++planned_operands_ == operand_count_;
+  if (first && !short_circuiting_) {
+    // The first operand is the initial result.
+    return;
+  }
+  absl::optional<int> jump_offset;
+  if (short_circuiting_ && !last) {
+    // Placeholder, updated once the end of the chain is known.
+    jump_offset = 0;
+  }
+  auto step =
+      CreateLogicalChainStep(is_or_, first, last, jump_offset, expr_id_);
+  if (step.ok() && jump_offset.has_value()) {
+    jumps_.push_back(Jump(visitor_->GetCurrentIndex(), step->get()));
+  }
+  visitor_->AddStep(std::move(step));
+}
+
 void TernaryCondVisitor::PreVisit(const cel::ast_internal::Expr* expr) {
   visitor_->ValidateOrError(
       !expr->call_expr().has_target() && expr->call_expr().args().size() == 3,
@@ -1200,6 +2274,11 @@ void ComprehensionVisitor::PreVisit(const cel::ast_internal::Expr* expr) {
     visitor_->SuppressBranch(&expr->comprehension_expr().iter_range());
     visitor_->SuppressBranch(&expr->comprehension_expr().loop_condition());
     visitor_->SuppressBranch(&expr->comprehension_expr().loop_step());
+  } else if (macro_.has_value()) {
+    // The accumulator is managed by the macro loop steps.
+    visitor_->SuppressBranch(&expr->comprehension_expr().accu_init());
+    visitor_->SuppressBranch(&expr->comprehension_expr().loop_condition());
+    visitor_->SuppressBranch(&expr->comprehension_expr().result());
   }
 }
 
@@ -1251,6 +2330,95 @@ void ComprehensionVisitor::PostVisitArgDefault(
   }
 }
 
+void ComprehensionVisitor::PostVisitArgMacro(
+    cel::ast_internal::ComprehensionArg arg_num,
+    const cel::ast_internal::Expr* expr) {
+  switch (arg_num) {
+    case cel::ast_internal::ITER_RANGE: {
+      visitor_->AddStep(CreateComprehensionInitStep(expr->id()));
+      break;
+    }
+    case cel::ast_internal::ACCU_INIT: {
+      macro_start_step_pos_ = visitor_->GetCurrentIndex();
+      macro_start_step_ =
+          new ComprehensionMacroStartStep(macro_->kind, iter_slot_, expr->id());
+      visitor_->AddStep(std::unique_ptr<ExpressionStep>(macro_start_step_));
+      break;
+    }
+    case cel::ast_internal::LOOP_CONDITION: {
+      break;
+    }
+    case cel::ast_internal::LOOP_STEP: {
+      visitor_->SetProgressStatusError(PlanMacroLoopBody(expr));
+      break;
+    }
+    case cel::ast_internal::RESULT: {
+      int finish_step_pos = visitor_->GetCurrentIndex();
+      visitor_->AddStep(CreateComprehensionMacroFinishStep(
+          macro_->kind, iter_slot_, expr->id()));
+      macro_start_step_->set_finish_jump_offset(finish_step_pos -
+                                                macro_start_step_pos_ - 1);
+      macro_start_step_->set_error_jump_offset(finish_step_pos -
+                                               macro_start_step_pos_);
+      if (macro_filter_step_ != nullptr) {
+        macro_filter_step_->set_finish_jump_offset(
+            finish_step_pos - macro_filter_step_pos_ - 1);
+      }
+      break;
+    }
+  }
+}
+
+absl::Status ComprehensionVisitor::PlanMacroLoopBody(
+    const cel::ast_internal::Expr* expr) {
+  if (!visitor_->progress_status().ok()) {
+    return absl::OkStatus();
+  }
+  PlannerContext& context = visitor_->extension_context();
+  const int body_pos = macro_start_step_pos_ + 1;
+  ExecutionPath body;
+  int predicate_size = 0;
+  if (macro_->predicate != nullptr) {
+    CEL_ASSIGN_OR_RETURN(body, context.ExtractSubplan(*macro_->predicate));
+    predicate_size = body.size();
+    if (macro_->kind == ComprehensionMacroKind::kMap) {
+      macro_filter_step_pos_ = body_pos + body.size();
+      macro_filter_step_ =
+          new ComprehensionMacroFilterStep(iter_slot_, expr->id());
+      macro_filter_step_->set_jump_offset(body_pos - macro_filter_step_pos_ -
+                                          1);
+      body.push_back(std::unique_ptr<ExpressionStep>(macro_filter_step_));
+    }
+  }
+  const int transform_offset = body.size();
+  int transform_size = 0;
+  if (macro_->transform != nullptr) {
+    CEL_ASSIGN_OR_RETURN(ExecutionPath transform,
+                         context.ExtractSubplan(*macro_->transform));
+    transform_size = transform.size();
+    for (std::unique_ptr<const ExpressionStep>& step : transform) {
+      body.push_back(std::move(step));
+    }
+  }
+  if (macro_->parallel) {
+    macro_start_step_->set_parallel_body(predicate_size, transform_offset,
+                                         transform_size);
+  }
+  int next_step_pos = body_pos + body.size();
+  auto next_step = std::make_unique<ComprehensionMacroNextStep>(
+      macro_->kind, iter_slot_, expr->id());
+  next_step->set_jump_offset(body_pos - next_step_pos - 1);
+  body.push_back(std::move(next_step));
+
+  CEL_RETURN_IF_ERROR(context.ReplaceSubplan(
+      expr->comprehension_expr().loop_step(), std::move(body)));
+  if (visitor_->GetCurrentIndex() != next_step_pos + 1) {
+    return absl::InternalError(
+        "unexpected program layout for comprehension loop step");
+  }
+  return absl::OkStatus();
+}
+
 void ComprehensionVisitor::PostVisitArgTrivial(
     cel::ast_internal::ComprehensionArg arg_num,
     const cel::ast_internal::Expr* expr) {
@@ -1271,7 +2439,9 @@ void ComprehensionVisitor::PostVisitArgTrivial(
       break;
     }
     case cel::ast_internal::RESULT: {
-      visitor_->AddStep(CreateClearSlotStep(accu_slot_, expr->id()));
+      if (clear_slot_) {
+        visitor_->AddStep(CreateClearSlotStep(accu_slot_, expr->id()));
+      }
       break;
     }
   }
@@ -1305,7 +2475,18 @@ std::vector<ExecutionPathView> FlattenExpressionTable(
 }  // namespace
 
 absl::StatusOr<FlatExpression> FlatExprBuilder::CreateExpressionImpl(
-    std::unique_ptr<Ast> ast, std::vector<RuntimeIssue>* issues) const {
+    std::unique_ptr<Ast> ast, std::vector<RuntimeIssue>* issues,
+    cel::PlannerStats* stats, const cel::EvaluationProfile* profile,
+    absl::string_view metrics_label) const {
+  const auto planning_start = std::chrono::steady_clock::now();
+  // Declared first so that any steps discarded while planning are destroyed
+  // under the arena scope.
+  std::unique_ptr<StepArena> step_arena;
+  if (options_.enable_step_arena) {
+    step_arena = std::make_unique<StepArena>(options_.plan_allocator);
+  }
+  StepArena::Scope step_arena_scope(step_arena.get());
+
   ExecutionPath execution_path;
   ExpressionTable expression_table;
 
@@ -1336,24 +2517,56 @@ absl::StatusOr<FlatExpression> FlatExprBuilder::CreateExpressionImpl(
         absl::StrCat("Invalid expression container: '", container_, "'"));
   }
 
-  for (const std::unique_ptr<AstTransform>& transform : ast_transforms_) {
-    CEL_RETURN_IF_ERROR(transform->UpdateAst(extension_context, ast_impl));
+  {
+    ScopedPlannerPhase phase(stats, &cel::PlannerStats::ast_transforms);
+    for (const std::unique_ptr<AstTransform>& transform : ast_transforms_) {
+      CEL_RETURN_IF_ERROR(transform->UpdateAst(extension_context, ast_impl));
+    }
+    if (profile != nullptr) {
+      OrderClausesByProfile(resolver, *profile, ast_impl);
+    }
   }
 
   std::vector<std::unique_ptr<ProgramOptimizer>> optimizers;
-  for (const ProgramOptimizerFactory& optimizer_factory : program_optimizers_) {
-    CEL_ASSIGN_OR_RETURN(optimizers.emplace_back(),
-                         optimizer_factory(extension_context, ast_impl));
+  {
+    ScopedPlannerPhase phase(stats, &cel::PlannerStats::program_optimizers);
+    if (options_.enable_constant_literal_hoisting) {
+      CEL_ASSIGN_OR_RETURN(
+          optimizers.emplace_back(),
+          cel::runtime_internal::CreateConstantLiteralHoistingOptimizer()(
+              extension_context, ast_impl));
+    }
+    for (const ProgramOptimizerFactory& optimizer_factory :
+         program_optimizers_) {
+      CEL_ASSIGN_OR_RETURN(optimizers.emplace_back(),
+                           optimizer_factory(extension_context, ast_impl));
+    }
   }
 
   FlatExprVisitor visitor(resolver, options_, std::move(optimizers),
-                          ast_impl.reference_map(), expression_table,
-                          execution_path, value_factory, issue_collector,
-                          program_tree, extension_context);
+                          ast_impl.reference_map(), ast_impl.type_map(),
+                          expression_table, execution_path, value_factory,
+                          issue_collector, program_tree, extension_context,
+                          stats);
 
   cel::ast_internal::TraversalOptions opts;
   opts.use_comprehension_callbacks = true;
-  AstTraverse(&ast_impl.root_expr(), &ast_impl.source_info(), &visitor, opts);
+  // The optimizers run during the traversal record themselves, so their share
+  // is taken out of the flattening phase.
+  cel::PlannerStats::Phase optimizers_before;
+  if (stats != nullptr) {
+    optimizers_before = stats->program_optimizers;
+  }
+  {
+    ScopedPlannerPhase phase(stats, &cel::PlannerStats::flattening);
+    AstTraverse(&ast_impl.root_expr(), &ast_impl.source_info(), &visitor, opts);
+  }
+  if (stats != nullptr) {
+    stats->flattening.wall_time -=
+        stats->program_optimizers.wall_time - optimizers_before.wall_time;
+    stats->flattening.allocations -=
+        stats->program_optimizers.allocations - optimizers_before.allocations;
+  }
 
   if (!visitor.progress_status().ok()) {
     return visitor.progress_status();
@@ -1363,12 +2576,51 @@ absl::StatusOr<FlatExpression> FlatExprBuilder::CreateExpressionImpl(
     (*issues) = issue_collector.ExtractIssues();
   }
 
+  ScopedPlannerPhase finalization(stats, &cel::PlannerStats::finalization);
   std::vector<ExecutionPathView> subexpressions =
       FlattenExpressionTable(expression_table, execution_path);
 
-  return FlatExpression(std::move(execution_path), std::move(subexpressions),
-                        visitor.slot_count(),
-                        type_registry_.GetComposedTypeProvider(), options_);
+  std::vector<CompactProgram> compact_programs;
+  if (options_.enable_compact_dispatch) {
+    compact_programs = EncodeCompactPrograms(subexpressions);
+  }
+
+  FlatExpression flat_expression(
+      std::move(execution_path), std::move(subexpressions),
+      visitor.slot_count(), type_registry_.GetComposedTypeProvider(),
+      options_);
+  if (options_.enable_compact_dispatch) {
+    flat_expression.set_compact_programs(std::move(compact_programs));
+  }
+  if (step_arena != nullptr) {
+    flat_expression.set_step_arena(std::move(step_arena));
+  }
+  flat_expression.set_value_stack_size(MaxStackDepth(
+      ast_impl.root_expr(),
+      /*flatten_add_chains=*/options_.enable_standard_operator_steps));
+  flat_expression.set_variable_names(visitor.ExtractVariableNames());
+  flat_expression.set_referenced_attributes(CollectReferencedAttributes(
+      ast_impl.root_expr(), [&resolver](absl::string_view name, int64_t id) {
+        return static_cast<bool>(resolver.FindConstant(name, id));
+      }));
+  if (stats != nullptr) {
+    stats->program_steps = flat_expression.path().size();
+    stats->program_bytes = flat_expression.ResidentSize();
+  }
+  flat_expression.set_metrics_label(std::string(metrics_label));
+  if (options_.metrics_sink != nullptr) {
+    cel::PlanningMetrics metrics;
+    metrics.program_label = metrics_label;
+    metrics.wall_time =
+        absl::FromChrono(std::chrono::steady_clock::now() - planning_start);
+    metrics.program_steps = flat_expression.path().size();
+    if (const StepArena* arena = flat_expression.step_arena();
+        arena != nullptr) {
+      metrics.step_arena_bytes = arena->SpaceAllocated();
+    }
+    options_.metrics_sink->OnProgramPlanned(metrics);
+  }
+  return flat_expression;
 }
 
 }  // namespace google::api::expr::runtime
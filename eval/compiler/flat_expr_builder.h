@@ -23,11 +23,14 @@
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "base/ast.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/public/cel_type_registry.h"
+#include "runtime/evaluation_profile.h"
 #include "runtime/function_registry.h"
+#include "runtime/planner_stats.h"
 #include "runtime/runtime_issue.h"
 #include "runtime/runtime_options.h"
 #include "runtime/type_registry.h"
@@ -73,12 +76,24 @@ class FlatExprBuilder {
 
   // TODO(uncreated-issue/45): Add overload for cref AST. At the moment, all the users
   // can pass ownership of a freshly converted AST.
+  //
+  // If stats is not null, the time and allocations of each planning phase are
+  // added to it. If profile is not null, the clauses of logical chains are
+  // ordered by it after the AST transforms ran (see OrderClausesByProfile).
+  // The program and its planning are reported to the metrics sink of the
+  // options with metrics_label.
   absl::StatusOr<FlatExpression> CreateExpressionImpl(
-      std::unique_ptr<cel::Ast> ast,
-      std::vector<cel::RuntimeIssue>* issues) const;
+      std::unique_ptr<cel::Ast> ast, std::vector<cel::RuntimeIssue>* issues,
+      cel::PlannerStats* stats = nullptr,
+      const cel::EvaluationProfile* profile = nullptr,
+      absl::string_view metrics_label = "") const;
 
   const cel::RuntimeOptions& options() const { return options_; }
 
+  // Runtime extensions that register planner features set the option of the
+  // feature, so that the options reflect the features in use.
+  cel::RuntimeOptions& mutable_options() { return options_; }
+
  private:
   cel::RuntimeOptions options_;
   std::string container_;
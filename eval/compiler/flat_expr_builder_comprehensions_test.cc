@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <cstdint>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -22,11 +24,14 @@
 #include "google/protobuf/arena.h"
 #include "google/protobuf/text_format.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
 #include "eval/compiler/comprehension_vulnerability_check.h"
 #include "eval/compiler/flat_expr_builder.h"
+#include "eval/eval/cel_expression_flat_impl.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_attribute.h"
@@ -49,6 +54,7 @@ namespace google::api::expr::runtime {
 namespace {
 
 using ::google::api::expr::v1alpha1::CheckedExpr;
+using ::google::api::expr::v1alpha1::Expr;
 using ::google::api::expr::v1alpha1::ParsedExpr;
 using testing::HasSubstr;
 using cel::internal::StatusIs;
@@ -609,6 +615,410 @@ TEST(CelExpressionBuilderFlatImplComprehensionsTest, InvalidBindComprehension) {
           HasSubstr("Unexpected iter_var access in trivial comprehension")));
 }
 
+constexpr char kBindTemplate[] = R"pb(
+  comprehension_expr {
+    iter_var: "#unused"
+    iter_range { list_expr {} }
+    accu_var: "x"
+    accu_init {
+      call_expr {
+        function: "_+_"
+        args { ident_expr { name: "a" } }
+        args { const_expr { int64_value: 1 } }
+      }
+    }
+    loop_condition { const_expr { bool_value: false } }
+    loop_step { ident_expr { name: "x" } }
+    result { %s }
+  })pb";
+
+absl::StatusOr<std::unique_ptr<CelExpression>> PlanBind(
+    CelExpressionBuilder& builder, absl::string_view result, Expr& expr) {
+  if (!google::protobuf::TextFormat::ParseFromString(
+          absl::StrFormat(kBindTemplate, result), &expr)) {
+    return absl::InvalidArgumentError("invalid expr");
+  }
+  return builder.CreateExpression(&expr, nullptr);
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest, BindInitInlinedAtFirstUse) {
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  // cel.bind(x, a + 1, x * x)
+  Expr expr;
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, PlanBind(builder, R"pb(
+                         call_expr {
+                           function: "_*_"
+                           args { ident_expr { name: "x" } }
+                           args { ident_expr { name: "x" } }
+                         })pb",
+                                               expr));
+
+  // a, 1, +, assign slot, slot, *. No lazy initialization steps, and the slot
+  // is not cleared since the bind is evaluated at most once.
+  const auto& flat_expr =
+      dynamic_cast<const CelExpressionFlatImpl&>(*cel_expr).flat_expression();
+  EXPECT_THAT(flat_expr.path(), testing::SizeIs(6));
+
+  Activation activation;
+  activation.InsertValue("a", CelValue::CreateInt64(2));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelInt64(9));
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     BindInitInlinedAtDominatingUse) {
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  // cel.bind(x, a + 1, x > 0 && x < 10)
+  Expr expr;
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, PlanBind(builder, R"pb(
+                         call_expr {
+                           function: "_&&_"
+                           args {
+                             call_expr {
+                               function: "_>_"
+                               args { ident_expr { name: "x" } }
+                               args { const_expr { int64_value: 0 } }
+                             }
+                           }
+                           args {
+                             call_expr {
+                               function: "_<_"
+                               args { ident_expr { name: "x" } }
+                               args { const_expr { int64_value: 10 } }
+                             }
+                           }
+                         })pb",
+                                               expr));
+
+  google::protobuf::Arena arena;
+  for (int64_t a : {-5, 2, 20}) {
+    Activation activation;
+    activation.InsertValue("a", CelValue::CreateInt64(a));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    EXPECT_THAT(result, test::IsCelBool(a + 1 > 0 && a + 1 < 10));
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     BindInitLazyAtConditionalUse) {
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  // cel.bind(x, a + 1, b || x > 2 || x < 0)
+  Expr expr;
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, PlanBind(builder, R"pb(
+                         call_expr {
+                           function: "_||_"
+                           args { ident_expr { name: "b" } }
+                           args {
+                             call_expr {
+                               function: "_||_"
+                               args {
+                                 call_expr {
+                                   function: "_>_"
+                                   args { ident_expr { name: "x" } }
+                                   args { const_expr { int64_value: 2 } }
+                                 }
+                               }
+                               args {
+                                 call_expr {
+                                   function: "_<_"
+                                   args { ident_expr { name: "x" } }
+                                   args { const_expr { int64_value: 0 } }
+                                 }
+                               }
+                             }
+                           }
+                         })pb",
+                                               expr));
+
+  google::protobuf::Arena arena;
+  for (bool b : {false, true}) {
+    for (int64_t a : {-5, 0, 5}) {
+      Activation activation;
+      activation.InsertValue("a", CelValue::CreateInt64(a));
+      activation.InsertValue("b", CelValue::CreateBool(b));
+      ASSERT_OK_AND_ASSIGN(CelValue result,
+                           cel_expr->Evaluate(activation, &arena));
+      EXPECT_THAT(result, test::IsCelBool(b || a + 1 > 2 || a + 1 < 0));
+    }
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     BindInitNotInlinedAfterConditionalUse) {
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  // cel.bind(x, a + 1, (b ? x : 0) + x)
+  Expr expr;
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, PlanBind(builder, R"pb(
+                         call_expr {
+                           function: "_+_"
+                           args {
+                             call_expr {
+                               function: "_?_:_"
+                               args { ident_expr { name: "b" } }
+                               args { ident_expr { name: "x" } }
+                               args { const_expr { int64_value: 0 } }
+                             }
+                           }
+                           args { ident_expr { name: "x" } }
+                         })pb",
+                                               expr));
+
+  google::protobuf::Arena arena;
+  for (bool b : {false, true}) {
+    Activation activation;
+    activation.InsertValue("a", CelValue::CreateInt64(2));
+    activation.InsertValue("b", CelValue::CreateBool(b));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    EXPECT_THAT(result, test::IsCelInt64(b ? 6 : 3));
+  }
+}
+
+absl::StatusOr<std::unique_ptr<CelExpression>> PlanMacro(
+    absl::string_view expression, const cel::RuntimeOptions& options) {
+  auto builder = std::make_unique<CelExpressionBuilderFlatImpl>(options);
+  CEL_RETURN_IF_ERROR(RegisterBuiltinFunctions(builder->GetRegistry()));
+  CEL_ASSIGN_OR_RETURN(auto parsed_expr, parser::Parse(expression));
+  return builder->CreateExpression(&parsed_expr.expr(),
+                                   &parsed_expr.source_info());
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     SpecializedMacrosMatchGenericPlan) {
+  for (absl::string_view expression : {
+           "[1, 2, 3].all(x, x > 0)",
+           "[1, 2, 3].all(x, x > 1)",
+           "[0, 1].all(x, 1 / x > 0)",
+           "[1, 0].all(x, x > 0 && 1 / x > 0)",
+           "[1, 'a', 2].all(x, x == 1)",
+           "[].all(x, x > 0)",
+           "[1, 2, 3].exists(x, x == 2)",
+           "[1, 2, 3].exists(x, x == 4)",
+           "[0, 1].exists(x, 1 / x > 0)",
+           "[1, 0, 1].exists_one(x, x == 1)",
+           "[1, 0, 2].exists_one(x, x == 1)",
+           "[1, 2, 3].map(x, x * 2)",
+           "[1, 2, 3].map(x, x > 1, x * 2)",
+           "[0, 1].map(x, 1 / x)",
+           "[1, 2, 3].filter(x, x > 1)",
+           "[1, 2, 3].map(x, [1, 2].filter(y, y != x))",
+           "a.all(x, x > 0)",
+           "a.map(x, x * 2)",
+           "1.all(x, x > 0)",
+       }) {
+    SCOPED_TRACE(expression);
+    cel::RuntimeOptions options;
+    ASSERT_OK_AND_ASSIGN(auto generic, PlanMacro(expression, options));
+    options.enable_specialized_comprehensions = true;
+    ASSERT_OK_AND_ASSIGN(auto specialized, PlanMacro(expression, options));
+
+    Activation activation;
+    ContainerBackedListImpl list({CelValue::CreateInt64(3),
+                                  CelValue::CreateInt64(-1)});
+    activation.InsertValue("a", CelValue::CreateList(&list));
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue expected,
+                         generic->Evaluate(activation, &arena));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         specialized->Evaluate(activation, &arena));
+    EXPECT_EQ(result.DebugString(), expected.DebugString());
+    EXPECT_LT(dynamic_cast<const CelExpressionFlatImpl&>(*specialized)
+                  .flat_expression()
+                  .path()
+                  .size(),
+              dynamic_cast<const CelExpressionFlatImpl&>(*generic)
+                  .flat_expression()
+                  .path()
+                  .size());
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     SpecializedMacrosRespectIterationLimit) {
+  cel::RuntimeOptions options;
+  options.enable_specialized_comprehensions = true;
+  options.comprehension_max_iterations = 2;
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  ASSERT_OK_AND_ASSIGN(auto parsed_expr,
+                       parser::Parse("[1, 2, 3].map(x, x * 2)"));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder.CreateExpression(&parsed_expr.expr(),
+                                                &parsed_expr.source_info()));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  EXPECT_THAT(cel_expr->Evaluate(activation, &arena),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Iteration budget exceeded")));
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     ParallelMacrosMatchSequentialEvaluation) {
+  std::vector<CelValue> elements;
+  for (int64_t i = 0; i < 1000; ++i) {
+    elements.push_back(CelValue::CreateInt64(i % 7 == 3 ? 0 : i));
+  }
+  ContainerBackedListImpl list(elements);
+  elements.push_back(CelValue::CreateBool(true));
+  ContainerBackedListImpl mixed_list(elements);
+
+  for (absl::string_view expression : {
+           "a.all(x, x >= 0)",
+           "a.all(x, x < 500)",
+           "a.all(x, 100 / x > 0)",
+           "a.exists(x, x == 999)",
+           "a.exists(x, x > 10 && 100 / x == 0)",
+           "a.exists(x, 1000 / x == 0)",
+           "a.exists_one(x, x == 500)",
+           "a.exists_one(x, x == 0)",
+           "a.map(x, x * 2)",
+           "a.map(x, 1000 / x)",
+           "a.map(x, x % 2 == 0, [x, x + 1])",
+           "a.filter(x, x % 3 == 0)",
+           "b.all(x, x < 2000)",
+           "b.map(x, x + 1)",
+           "b.filter(x, x > 500)",
+       }) {
+    SCOPED_TRACE(expression);
+    cel::RuntimeOptions options;
+    options.enable_specialized_comprehensions = true;
+    options.comprehension_max_iterations = 0;
+    ASSERT_OK_AND_ASSIGN(auto sequential, PlanMacro(expression, options));
+    options.parallel_comprehension_threads = 4;
+    options.parallel_comprehension_min_size = 100;
+    ASSERT_OK_AND_ASSIGN(auto parallel, PlanMacro(expression, options));
+
+    Activation activation;
+    activation.InsertValue("a", CelValue::CreateList(&list));
+    activation.InsertValue("b", CelValue::CreateList(&mixed_list));
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue expected,
+                         sequential->Evaluate(activation, &arena));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         parallel->Evaluate(activation, &arena));
+    EXPECT_EQ(result.DebugString(), expected.DebugString());
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     ParallelMacrosRespectIterationLimit) {
+  std::vector<CelValue> elements(1000, CelValue::CreateInt64(1));
+  ContainerBackedListImpl list(elements);
+  cel::RuntimeOptions options;
+  options.enable_specialized_comprehensions = true;
+  options.parallel_comprehension_threads = 4;
+  options.parallel_comprehension_min_size = 100;
+
+  for (int max_iterations : {1000, 1001, 1002}) {
+    options.comprehension_max_iterations = max_iterations;
+    ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                         PlanMacro("a.map(x, x).size() + a.map(x, x).size()",
+                                   options));
+    Activation activation;
+    activation.InsertValue("a", CelValue::CreateList(&list));
+    google::protobuf::Arena arena;
+    // Each loop takes an iteration per element and one to end the loop.
+    EXPECT_THAT(cel_expr->Evaluate(activation, &arena),
+                StatusIs(absl::StatusCode::kInternal,
+                         HasSubstr("Iteration budget exceeded")));
+  }
+
+  options.comprehension_max_iterations = 2003;
+  ASSERT_OK_AND_ASSIGN(
+      auto cel_expr,
+      PlanMacro("a.map(x, x).size() + a.map(x, x).size()", options));
+  Activation activation;
+  activation.InsertValue("a", CelValue::CreateList(&list));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelInt64(2000));
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     VerifiedListAppendEnabledByDefault) {
+  for (absl::string_view expression : {
+           "[1, 2, 3].map(x, x * 2)",
+           "[1, 2, 3].map(x, x > 1, x * 2)",
+           "[1, 2, 3].filter(x, x > 1)",
+           "[1, 2].map(x, [3, 4].map(y, x * y))",
+           "[1, 2].map(x, [1, 2].filter(y, y != x)).size()",
+       }) {
+    SCOPED_TRACE(expression);
+    cel::RuntimeOptions options;
+    options.enable_verified_comprehension_list_append = false;
+    ASSERT_OK_AND_ASSIGN(auto concat, PlanMacro(expression, options));
+    options.enable_verified_comprehension_list_append = true;
+    ASSERT_OK_AND_ASSIGN(auto append, PlanMacro(expression, options));
+
+    Activation activation;
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue expected,
+                         concat->Evaluate(activation, &arena));
+    ASSERT_OK_AND_ASSIGN(CelValue result, append->Evaluate(activation, &arena));
+    EXPECT_EQ(result.DebugString(), expected.DebugString());
+  }
+}
+
+TEST(CelExpressionBuilderFlatImplComprehensionsTest,
+     VerifiedListAppendSkipsAliasedAccumulator) {
+  // [0, 0, 0].map(x, ...) hand-rolled to append the accumulator size, which
+  // must observe the list built so far.
+  Expr expr;
+  ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(
+      R"pb(
+        comprehension_expr {
+          iter_var: "x"
+          iter_range {
+            list_expr {
+              elements { const_expr { int64_value: 0 } }
+              elements { const_expr { int64_value: 0 } }
+              elements { const_expr { int64_value: 0 } }
+            }
+          }
+          accu_var: "accu"
+          accu_init { list_expr {} }
+          loop_condition { const_expr { bool_value: true } }
+          loop_step {
+            call_expr {
+              function: "_+_"
+              args { ident_expr { name: "accu" } }
+              args {
+                list_expr {
+                  elements {
+                    call_expr {
+                      function: "size"
+                      args { ident_expr { name: "accu" } }
+                    }
+                  }
+                }
+              }
+            }
+          }
+          result { ident_expr { name: "accu" } }
+        })pb",
+      &expr));
+  cel::RuntimeOptions options;
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, builder.CreateExpression(&expr, nullptr));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsList());
+  ASSERT_THAT(*result.ListOrDie(), testing::SizeIs(3));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT((*result.ListOrDie())[i], test::IsCelInt64(i));
+  }
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
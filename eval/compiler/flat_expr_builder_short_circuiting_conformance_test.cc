@@ -1,9 +1,12 @@
 // A collection of tests that confirm that short-circuit and non-short-circuit
 // produce expressions with the same outputs.
 #include <memory>
+#include <string>
+#include <tuple>
 
 #include "google/protobuf/text_format.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
@@ -94,12 +97,15 @@ void BuildAndEval(CelExpressionBuilder* builder, const Expr& expr,
   *result = *value;
 }
 
-class ShortCircuitingTest : public testing::TestWithParam<bool> {
+// Parameterized on short-circuiting and logical chains being enabled.
+class ShortCircuitingTest
+    : public testing::TestWithParam<std::tuple<bool, bool>> {
  public:
   std::unique_ptr<CelExpressionBuilder> GetBuilder(
       bool enable_unknowns = false) {
     cel::RuntimeOptions options;
-    options.short_circuiting = GetParam();
+    options.short_circuiting = std::get<0>(GetParam());
+    options.enable_logical_chains = std::get<1>(GetParam());
     if (enable_unknowns) {
       options.unknown_processing =
           cel::UnknownProcessingOptions::kAttributeAndFunction;
@@ -455,16 +461,16 @@ TEST_P(ShortCircuitingTest, TernaryUnknownAndErrorHandling) {
   EXPECT_EQ(attrs.begin()->variable_name(), "cond");
 }
 
-const char* TestName(testing::TestParamInfo<bool> info) {
-  if (info.param) {
-    return "short_circuit_enabled";
-  } else {
-    return "short_circuit_disabled";
-  }
+std::string TestName(testing::TestParamInfo<std::tuple<bool, bool>> info) {
+  return absl::StrCat(
+      std::get<0>(info.param) ? "short_circuit_enabled"
+                              : "short_circuit_disabled",
+      std::get<1>(info.param) ? "_logical_chains" : "");
 }
 
 INSTANTIATE_TEST_SUITE_P(Test, ShortCircuitingTest,
-                         testing::Values(false, true), &TestName);
+                         testing::Combine(testing::Bool(), testing::Bool()),
+                         &TestName);
 
 }  // namespace
 
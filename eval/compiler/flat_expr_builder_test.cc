@@ -40,6 +40,7 @@
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
 #include "eval/compiler/constant_folding.h"
 #include "eval/compiler/qualified_reference_resolver.h"
+#include "eval/eval/cel_expression_flat_impl.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_attribute.h"
@@ -65,6 +66,7 @@
 #include "internal/status_macros.h"
 #include "internal/testing.h"
 #include "parser/parser.h"
+#include "runtime/constant_pool.h"
 #include "runtime/runtime_options.h"
 #include "proto/test/v1/proto3/test_all_types.pb.h"
 #include "google/protobuf/descriptor.h"
@@ -174,6 +176,70 @@ TEST(FlatExprBuilderTest, SimpleEndToEnd) {
   EXPECT_THAT(result.StringOrDie().value(), Eq("prefixtest"));
 }
 
+TEST(FlatExprBuilderTest, StepArena) {
+  Expr expr;
+  SourceInfo source_info;
+  auto call_expr = expr.mutable_call_expr();
+  call_expr->set_function("concat");
+  call_expr->add_args()->mutable_const_expr()->set_string_value("prefix");
+  call_expr->add_args()->mutable_ident_expr()->set_name("value");
+
+  cel::RuntimeOptions options;
+  options.enable_step_arena = true;
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(
+      builder.GetRegistry()->Register(std::make_unique<ConcatFunction>()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder.CreateExpression(&expr, &source_info));
+
+  const auto& flat_expr =
+      dynamic_cast<const CelExpressionFlatImpl&>(*cel_expr).flat_expression();
+  EXPECT_TRUE(flat_expr.has_step_arena());
+  EXPECT_GT(flat_expr.ResidentSize(), 0);
+
+  std::string variable = "test";
+  Activation activation;
+  activation.InsertValue("value", CelValue::CreateString(&variable));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsString());
+  EXPECT_THAT(result.StringOrDie().value(), Eq("prefixtest"));
+}
+
+TEST(FlatExprBuilderTest, ConstantPool) {
+  Expr expr;
+  SourceInfo source_info;
+  auto call_expr = expr.mutable_call_expr();
+  call_expr->set_function("concat");
+  call_expr->add_args()->mutable_const_expr()->set_string_value("prefix");
+  call_expr->add_args()->mutable_ident_expr()->set_name("value");
+
+  cel::RuntimeOptions options;
+  options.constant_pool = std::make_shared<cel::ConstantPool>();
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(
+      builder.GetRegistry()->Register(std::make_unique<ConcatFunction>()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr1,
+                       builder.CreateExpression(&expr, &source_info));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr2,
+                       builder.CreateExpression(&expr, &source_info));
+  // Both programs share the interned literal.
+  EXPECT_EQ(options.constant_pool->size(), 1);
+  // Programs keep the pool alive.
+  options.constant_pool.reset();
+
+  std::string variable = "test";
+  Activation activation;
+  activation.InsertValue("value", CelValue::CreateString(&variable));
+  google::protobuf::Arena arena;
+  for (const auto* cel_expr : {cel_expr1.get(), cel_expr2.get()}) {
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    ASSERT_TRUE(result.IsString());
+    EXPECT_THAT(result.StringOrDie().value(), Eq("prefixtest"));
+  }
+}
+
 TEST(FlatExprBuilderTest, ExprUnset) {
   Expr expr;
   SourceInfo source_info;
@@ -398,6 +464,87 @@ TEST(FlatExprBuilderTest, Shortcircuiting) {
   }
 }
 
+TEST(FlatExprBuilderTest, SelectiveShortcircuiting) {
+  ASSERT_OK_AND_ASSIGN(
+      ParsedExpr expr,
+      parser::Parse("(known || recorder1()) && (unknown || recorder2())"));
+
+  cel::RuntimeOptions options;
+  options.short_circuiting = false;
+  options.enable_selective_short_circuiting = true;
+  options.unknown_processing = cel::UnknownProcessingOptions::kAttributeOnly;
+  options.unknown_attribute_roots = {"unknown"};
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+
+  int count1 = 0;
+  int count2 = 0;
+  ASSERT_OK(builder.GetRegistry()->Register(
+      std::make_unique<RecorderFunction>("recorder1", &count1)));
+  ASSERT_OK(builder.GetRegistry()->Register(
+      std::make_unique<RecorderFunction>("recorder2", &count2)));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder.CreateExpression(&expr.expr(),
+                                                &expr.source_info()));
+
+  Activation activation;
+  activation.InsertValue("known", CelValue::CreateBool(true));
+  activation.InsertValue("unknown", CelValue::CreateBool(true));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_TRUE(result.BoolOrDie());
+
+  // Only the operand that may produce unknowns is evaluated exhaustively.
+  EXPECT_THAT(count1, Eq(0));
+  EXPECT_THAT(count2, Eq(1));
+}
+
+TEST(FlatExprBuilderTest, LogicalChains) {
+  // ((((x0 && x1) && x2) && x3) && x4)
+  Expr expr;
+  Expr* operand = &expr;
+  for (int i = 4; i > 0; --i) {
+    auto* call_expr = operand->mutable_call_expr();
+    call_expr->set_function(builtin::kAnd);
+    operand = call_expr->add_args();
+    call_expr->add_args()->mutable_ident_expr()->set_name(
+        absl::StrFormat("x%d", i));
+  }
+  operand->mutable_ident_expr()->set_name("x0");
+  SourceInfo source_info;
+
+  for (bool short_circuiting : {false, true}) {
+    cel::RuntimeOptions options;
+    options.short_circuiting = short_circuiting;
+    options.enable_logical_chains = true;
+    CelExpressionBuilderFlatImpl builder(options);
+    ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+    ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                         builder.CreateExpression(&expr, &source_info));
+
+    // One step per operand, plus one per operand after the first for merging
+    // it into the result.
+    const auto& flat_expr =
+        dynamic_cast<const CelExpressionFlatImpl&>(*cel_expr)
+            .flat_expression();
+    EXPECT_THAT(flat_expr.path(), SizeIs(short_circuiting ? 10 : 9));
+
+    for (int false_operand = -1; false_operand < 5; ++false_operand) {
+      Activation activation;
+      for (int i = 0; i < 5; ++i) {
+        activation.InsertValue(absl::StrFormat("x%d", i),
+                               CelValue::CreateBool(i != false_operand));
+      }
+      google::protobuf::Arena arena;
+      ASSERT_OK_AND_ASSIGN(CelValue result,
+                           cel_expr->Evaluate(activation, &arena));
+      ASSERT_TRUE(result.IsBool());
+      EXPECT_THAT(result.BoolOrDie(), Eq(false_operand == -1));
+    }
+  }
+}
+
 TEST(FlatExprBuilderTest, ShortcircuitingComprehension) {
   Expr expr;
   SourceInfo source_info;
@@ -654,6 +801,41 @@ TEST(FlatExprBuilderTest, MapComprehension) {
   EXPECT_TRUE(result.BoolOrDie());
 }
 
+TEST(FlatExprBuilderTest, MapWithConstantKeys) {
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr,
+                       parser::Parse("{'a': x, 'b': x + 1, 1: x}"));
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, builder.CreateExpression(
+                                          &expr.expr(), &expr.source_info()));
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(1));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsMap());
+  const CelMap* cel_map = result.MapOrDie();
+  EXPECT_EQ(cel_map->size(), 3);
+  auto lookup = (*cel_map)[CelValue::CreateStringView("b")];
+  ASSERT_TRUE(lookup.has_value());
+  EXPECT_THAT(*lookup, test::IsCelInt64(2));
+}
+
+TEST(FlatExprBuilderTest, MapWithDuplicateConstantKeys) {
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse("{'a': 1, 'a': 2}"));
+  CelExpressionBuilderFlatImpl builder;
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr, builder.CreateExpression(
+                                          &expr.expr(), &expr.source_info()));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsError());
+  EXPECT_THAT(*result.ErrorOrDie(),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+}
+
 TEST(FlatExprBuilderTest, InvalidContainer) {
   Expr expr;
   SourceInfo source_info;
@@ -1443,6 +1625,37 @@ TEST(FlatExprBuilderTest, SimpleEnumIdentTest) {
   EXPECT_THAT(result.Int64OrDie(), Eq(TestMessage::TEST_ENUM_1));
 }
 
+TEST(FlatExprBuilderTest, DeclaredVariablesDoNotShadowEnums) {
+  Expr expr;
+  SourceInfo source_info;
+  constexpr char enum_name[] =
+      "google.api.expr.runtime.TestMessage.TestEnum.TEST_ENUM_1";
+  expr.mutable_ident_expr()->set_name(enum_name);
+
+  google::protobuf::Arena arena;
+  Activation activation;
+  activation.InsertValue(enum_name, CelValue::CreateInt64(42));
+
+  cel::RuntimeOptions options;
+  options.declared_variables = std::vector<std::string>{"x"};
+  CelExpressionBuilderFlatImpl builder(options);
+  builder.GetTypeRegistry()->Register(TestMessage::TestEnum_descriptor());
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder.CreateExpression(&expr, &source_info));
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelInt64(TestMessage::TEST_ENUM_1));
+
+  // A declared variable still shadows the constant.
+  options.declared_variables->push_back(enum_name);
+  CelExpressionBuilderFlatImpl shadowing_builder(options);
+  shadowing_builder.GetTypeRegistry()->Register(
+      TestMessage::TestEnum_descriptor());
+  ASSERT_OK_AND_ASSIGN(cel_expr,
+                       shadowing_builder.CreateExpression(&expr, &source_info));
+  ASSERT_OK_AND_ASSIGN(result, cel_expr->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelInt64(42));
+}
+
 TEST(FlatExprBuilderTest, ContainerStringFormat) {
   Expr expr;
   SourceInfo source_info;
@@ -2410,6 +2623,119 @@ TEST(UpdatedConstantFolding, FoldsLists) {
   EXPECT_THAT(result, test::IsCelList(SizeIs(12)));
 }
 
+struct CompactDispatchTestCase {
+  std::string expr;
+  test::CelValueMatcher matcher;
+};
+
+class CompactDispatchTest
+    : public ::testing::TestWithParam<CompactDispatchTestCase> {};
+
+TEST_P(CompactDispatchTest, MatchesDefaultLoop) {
+  const CompactDispatchTestCase& p = GetParam();
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse(p.expr));
+
+  for (bool short_circuiting : {true, false}) {
+    InterpreterOptions options;
+    options.short_circuiting = short_circuiting;
+    options.enable_compact_dispatch = true;
+    auto builder = CreateCelExpressionBuilder(options);
+    ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry(), options));
+
+    ASSERT_OK_AND_ASSIGN(auto plan, builder->CreateExpression(
+                                        &expr.expr(), &expr.source_info()));
+    const auto* impl = dynamic_cast<const CelExpressionFlatImpl*>(plan.get());
+    ASSERT_NE(impl, nullptr);
+    EXPECT_TRUE(impl->flat_expression().has_compact_programs());
+
+    Activation activation;
+    activation.InsertValue("x", CelValue::CreateInt64(3));
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena));
+    EXPECT_THAT(result, p.matcher);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Exprs, CompactDispatchTest,
+    ::testing::ValuesIn(std::vector<CompactDispatchTestCase>{
+        {"1 + 2 + x", test::IsCelInt64(6)},
+        {"x > 2 && x < 4", test::IsCelBool(true)},
+        {"x < 2 || x == 3", test::IsCelBool(true)},
+        {"x > 2 ? 'a' : 'b'", test::IsCelString("a")},
+        {"x < 2 ? 'a' : 'b'", test::IsCelString("b")},
+        {"[1, 2, 3].exists(i, i == x)", test::IsCelBool(true)},
+        {"[1, 2, 3].map(i, i * x)", test::IsCelList(SizeIs(3))},
+        {"x / 0 > 1 || true", test::IsCelBool(true)},
+    }));
+
+TEST(FlatExprBuilderTest, ValueStackSizedToMaxDepth) {
+  struct TestCase {
+    std::string expr;
+    size_t max_depth;
+  };
+  for (const TestCase& test_case : std::vector<TestCase>{
+           {"1 + 2 + 3 + x", 2},
+           {"[x, [x, x]]", 3},
+           {"x > 2 && [1, 2].exists(i, i == x)", 7},
+       }) {
+    ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse(test_case.expr));
+    InterpreterOptions options;
+    auto builder = CreateCelExpressionBuilder(options);
+    ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry(), options));
+    ASSERT_OK_AND_ASSIGN(auto plan, builder->CreateExpression(
+                                        &expr.expr(), &expr.source_info()));
+
+    const auto* impl = dynamic_cast<const CelExpressionFlatImpl*>(plan.get());
+    ASSERT_NE(impl, nullptr);
+    EXPECT_EQ(impl->flat_expression().value_stack_size(), test_case.max_depth)
+        << test_case.expr;
+    EXPECT_LT(impl->flat_expression().value_stack_size(),
+              impl->flat_expression().path().size())
+        << test_case.expr;
+
+    Activation activation;
+    activation.InsertValue("x", CelValue::CreateInt64(2));
+    google::protobuf::Arena arena;
+    EXPECT_OK(plan->Evaluate(activation, &arena)) << test_case.expr;
+  }
+}
+
+TEST(FlatExprBuilderTest, PlansDeeplyNestedExpressions) {
+  // Deeper than the parser allows, e.g. for generated expressions.
+  constexpr int kDepth = 10000;
+  Expr expr;
+  SourceInfo source_info;
+  int64_t next_id = 1;
+  Expr* lhs = &expr;
+  for (int i = 0; i < kDepth; ++i) {
+    lhs->set_id(next_id++);
+    auto* call = lhs->mutable_call_expr();
+    call->set_function(builtin::kOr);
+    lhs = call->add_args();
+    Expr* rhs = call->add_args();
+    rhs->set_id(next_id++);
+    rhs->mutable_const_expr()->set_bool_value(false);
+  }
+  lhs->set_id(next_id++);
+  lhs->mutable_ident_expr()->set_name("x");
+
+  InterpreterOptions options;
+  auto builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry(), options));
+  ASSERT_OK_AND_ASSIGN(auto plan,
+                       builder->CreateExpression(&expr, &source_info));
+  const auto* impl = dynamic_cast<const CelExpressionFlatImpl*>(plan.get());
+  ASSERT_NE(impl, nullptr);
+  EXPECT_EQ(impl->flat_expression().value_stack_size(), 2);
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateBool(true));
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
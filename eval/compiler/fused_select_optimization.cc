@@ -0,0 +1,261 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/fused_select_optimization.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/list_value.h"
+#include "common/native_type.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/eval/compiler_constant_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/function_step.h"
+#include "eval/eval/fused_select_step.h"
+#include "eval/eval/select_step.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "runtime/runtime_options.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using cel::NativeTypeId;
+using cel::ast_internal::AstImpl;
+using cel::ast_internal::Call;
+using cel::ast_internal::Expr;
+using cel::internal::down_cast;
+
+using SelectChain = std::vector<std::unique_ptr<const SelectStep>>;
+
+// A run of select steps at the end of the plan for an expression.
+struct ChainInfo {
+  // Innermost operand of the chain, planned normally.
+  const Expr* base;
+  size_t num_selects;
+};
+
+bool IsSelectStep(const ExpressionStep& step) {
+  return step.GetNativeTypeId() == NativeTypeId::For<SelectStep>();
+}
+
+// Follows nested select expressions from node as long as each one is planned
+// as its operand followed by a single SelectStep.
+ChainInfo GetChain(PlannerContext& context, const Expr& node) {
+  ChainInfo info{&node, 0};
+  while (info.base->has_select_expr()) {
+    const Expr& operand = info.base->select_expr().operand();
+    ExecutionPathView plan = context.GetSubplan(*info.base);
+    if (plan.empty() || !IsSelectStep(*plan.back()) ||
+        plan.size() != context.GetSubplan(operand).size() + 1) {
+      break;
+    }
+    info.base = &operand;
+    ++info.num_selects;
+  }
+  return info;
+}
+
+// Moves the trailing num_selects steps of plan into a chain.
+SelectChain TakeSelects(ExecutionPath& plan, size_t num_selects) {
+  SelectChain selects;
+  selects.reserve(num_selects);
+  for (size_t i = plan.size() - num_selects; i < plan.size(); ++i) {
+    selects.push_back(absl::WrapUnique(
+        down_cast<const SelectStep*>(plan[i].release())));
+  }
+  plan.resize(plan.size() - num_selects);
+  return selects;
+}
+
+const CompilerConstantStep* AsConstant(PlannerContext& context,
+                                       const Expr& expr) {
+  ExecutionPathView plan = context.GetSubplan(expr);
+  if (plan.size() != 1 || plan[0]->GetNativeTypeId() !=
+                              NativeTypeId::For<CompilerConstantStep>()) {
+    return nullptr;
+  }
+  return &down_cast<const CompilerConstantStep&>(*plan[0]);
+}
+
+bool IsFusableCall(const Expr& node) {
+  if (!node.has_call_expr() || node.call_expr().has_target() ||
+      node.call_expr().args().size() != 2) {
+    return false;
+  }
+  const std::string& function = node.call_expr().function();
+  return function == cel::builtin::kEqual ||
+         function == cel::builtin::kInequal || function == cel::builtin::kIn;
+}
+
+class FusedSelectOptimization : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    // Selects nested in a larger chain or used as a comparison operand are
+    // fused by the parent.
+    if (node.has_select_expr() &&
+        node.select_expr().operand().has_select_expr()) {
+      deferred_.insert(&node.select_expr().operand());
+    } else if (IsFusableCall(node)) {
+      for (const Expr& arg : node.call_expr().args()) {
+        if (arg.has_select_expr()) {
+          deferred_.insert(&arg);
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    if (node.has_select_expr()) {
+      if (deferred_.contains(&node)) {
+        return absl::OkStatus();
+      }
+      return FuseChain(context, node);
+    }
+    if (!IsFusableCall(node)) {
+      return absl::OkStatus();
+    }
+    CEL_ASSIGN_OR_RETURN(bool fused, FuseCall(context, node));
+    if (fused) {
+      return absl::OkStatus();
+    }
+    for (const Expr& arg : node.call_expr().args()) {
+      if (arg.has_select_expr()) {
+        CEL_RETURN_IF_ERROR(FuseChain(context, arg));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::Status FuseChain(PlannerContext& context, const Expr& node) {
+    ChainInfo chain = GetChain(context, node);
+    if (chain.num_selects < 2) {
+      return absl::OkStatus();
+    }
+    CEL_ASSIGN_OR_RETURN(ExecutionPath plan, context.ExtractSubplan(node));
+    SelectChain selects = TakeSelects(plan, chain.num_selects);
+    CEL_ASSIGN_OR_RETURN(plan.emplace_back(),
+                         CreateSelectChainStep(std::move(selects), node.id()));
+    return context.ReplaceSubplan(node, std::move(plan));
+  }
+
+  absl::StatusOr<bool> FuseCall(PlannerContext& context, const Expr& node) {
+    const Call& call_expr = node.call_expr();
+    const Expr& lhs = call_expr.args()[0];
+    const Expr& rhs = call_expr.args()[1];
+    bool is_in = call_expr.function() == cel::builtin::kIn;
+
+    ExecutionPathView call_plan = context.GetSubplan(node);
+    if (call_plan.empty() || !IsEagerFunctionStep(*call_plan.back())) {
+      return false;
+    }
+
+    const CompilerConstantStep* constant = AsConstant(context, rhs);
+    bool constant_is_lhs = false;
+    if (constant == nullptr && !is_in) {
+      constant = AsConstant(context, lhs);
+      constant_is_lhs = true;
+    }
+    if (constant == nullptr ||
+        (is_in && !constant->value()->Is<cel::ListValue>())) {
+      return false;
+    }
+    cel::Handle<cel::Value> constant_value = constant->value();
+
+    const Expr& operand = constant_is_lhs ? rhs : lhs;
+    ChainInfo chain = GetChain(context, operand);
+    size_t operand_size = context.GetSubplan(operand).size();
+    if (operand_size == 0 || call_plan.size() != operand_size + 2) {
+      return false;
+    }
+
+    CEL_ASSIGN_OR_RETURN(ExecutionPath plan, context.ExtractSubplan(node));
+    std::unique_ptr<const ExpressionStep> function_step =
+        std::move(plan.back());
+    plan.pop_back();
+    // Drop the constant.
+    if (constant_is_lhs) {
+      plan.erase(plan.begin());
+    } else {
+      plan.pop_back();
+    }
+    SelectChain selects = TakeSelects(plan, chain.num_selects);
+
+    if (is_in) {
+      cel::Handle<cel::ListValue> list =
+          std::move(constant_value).As<cel::ListValue>();
+      CEL_ASSIGN_OR_RETURN(
+          plan.emplace_back(),
+          CreateInConstantListStep(std::move(selects), std::move(list),
+                                   std::move(function_step),
+                                   context.value_factory(), node.id()));
+    } else {
+      CEL_ASSIGN_OR_RETURN(
+          plan.emplace_back(),
+          CreateSelectCompareConstantStep(
+              std::move(selects), std::move(constant_value), constant_is_lhs,
+              /*negate=*/call_expr.function() == cel::builtin::kInequal,
+              std::move(function_step), node.id()));
+    }
+    CEL_RETURN_IF_ERROR(context.ReplaceSubplan(node, std::move(plan)));
+    return true;
+  }
+
+  absl::flat_hash_set<const Expr*> deferred_;
+};
+
+// Optimizer used when the rewrite doesn't apply for the configured options.
+class NoopOptimization : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace
+
+ProgramOptimizerFactory CreateFusedSelectOptimizer() {
+  return [](PlannerContext& context, const AstImpl& ast)
+             -> absl::StatusOr<std::unique_ptr<ProgramOptimizer>> {
+    const cel::RuntimeOptions& options = context.options();
+    if (options.unknown_processing !=
+            cel::UnknownProcessingOptions::kDisabled ||
+        options.enable_missing_attribute_errors) {
+      return std::make_unique<NoopOptimization>();
+    }
+    return std::make_unique<FusedSelectOptimization>();
+  };
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,37 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_FUSED_SELECT_OPTIMIZATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_FUSED_SELECT_OPTIMIZATION_H_
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new extension for the FlatExprBuilder that fuses common select
+// shapes into single steps (see eval/eval/fused_select_step.h):
+//
+//   - `a.b.c` and `has(a.b.c)`: one step applies the whole select chain.
+//   - `a.b.c == <const>` and `a.b.c != <const>`: the chain and the comparison
+//     are evaluated in one step without materializing the constant.
+//   - `a.b.c in <const list>`: membership is tested with a hash set built at
+//     plan time. List literals are only recognized once constant folded.
+//
+// The rewrite is skipped when unknown processing or missing attribute errors
+// are enabled, since those require per-select attribute tracking.
+ProgramOptimizerFactory CreateFusedSelectOptimizer();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_FUSED_SELECT_OPTIMIZATION_H_
@@ -0,0 +1,173 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/fused_select_optimization.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/memory.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/compiler/constant_folding.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_map_impl.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+MATCHER_P(ExpressionPlanSizeIs, size, "") {
+  const std::unique_ptr<CelExpression>& plan = arg;
+
+  const CelExpressionFlatImpl* impl =
+      dynamic_cast<CelExpressionFlatImpl*>(plan.get());
+
+  if (impl == nullptr) return false;
+  *result_listener << "got size " << impl->flat_expression().path().size();
+  return impl->flat_expression().path().size() == size;
+}
+
+class FusedSelectOptimizationTest : public testing::Test {
+ public:
+  FusedSelectOptimizationTest()
+      : builder_(ConvertToRuntimeOptions(options_)) {}
+
+  void SetUp() override {
+    ASSERT_OK(RegisterBuiltinFunctions(builder_.GetRegistry(), options_));
+    builder_.flat_expr_builder().AddProgramOptimizer(
+        cel::runtime_internal::CreateConstantFoldingOptimizer(
+            cel::MemoryManagerRef::ReferenceCounting()));
+    builder_.flat_expr_builder().AddProgramOptimizer(
+        CreateFusedSelectOptimizer());
+
+    // a = {"b": {"c": "admin"}}
+    std::vector<std::pair<CelValue, CelValue>> inner{
+        {CelValue::CreateStringView("c"), CelValue::CreateStringView("admin")}};
+    ASSERT_OK_AND_ASSIGN(inner_,
+                         CreateContainerBackedMap(absl::MakeSpan(inner)));
+    std::vector<std::pair<CelValue, CelValue>> outer{
+        {CelValue::CreateStringView("b"), CelValue::CreateMap(inner_.get())}};
+    ASSERT_OK_AND_ASSIGN(outer_,
+                         CreateContainerBackedMap(absl::MakeSpan(outer)));
+    activation_.InsertValue("a", CelValue::CreateMap(outer_.get()));
+  }
+
+  absl::StatusOr<std::unique_ptr<CelExpression>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    return builder_.CreateExpression(&parsed_expr_.expr(),
+                                     &parsed_expr_.source_info());
+  }
+
+ protected:
+  InterpreterOptions options_;
+  CelExpressionBuilderFlatImpl builder_;
+  exprpb::ParsedExpr parsed_expr_;
+  std::unique_ptr<CelMap> inner_;
+  std::unique_ptr<CelMap> outer_;
+  Activation activation_;
+  google::protobuf::Arena arena_;
+};
+
+TEST_F(FusedSelectOptimizationTest, SelectChain) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan, Plan("a.b.c"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelString(Eq("admin")));
+}
+
+TEST_F(FusedSelectOptimizationTest, PresenceTest) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("has(a.b.c)"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(FusedSelectOptimizationTest, CompareConstant) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("a.b.c == 'admin'"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(FusedSelectOptimizationTest, CompareConstantLhs) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("'admin' != a.b.c"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(false));
+}
+
+TEST_F(FusedSelectOptimizationTest, InConstantList) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("a.b.c in ['user', 'admin']"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(FusedSelectOptimizationTest, NonConstantOperandKeepsChain) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("a.b.c == a.b.c"));
+
+  // Both operands are fused to ident + select chain, the call is not.
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(5));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation_, &arena_));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(FusedSelectOptimizationTest, DisabledWithUnknowns) {
+  InterpreterOptions options;
+  options.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+  CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options));
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry(), options));
+  builder.flat_expr_builder().AddProgramOptimizer(CreateFusedSelectOptimizer());
+
+  ASSERT_OK_AND_ASSIGN(exprpb::ParsedExpr parsed_expr,
+                       Parse("a.b.c == 'admin'"));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      builder.CreateExpression(&parsed_expr.expr(),
+                               &parsed_expr.source_info()));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(5));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,64 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PLANNER_PHASE_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PLANNER_PHASE_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+
+#include "absl/time/time.h"
+#include "runtime/planner_stats.h"
+
+namespace google::api::expr::runtime {
+
+// Adds the wall time and allocations of its scope to a phase of stats. Does
+// nothing if stats is null.
+class ScopedPlannerPhase {
+ public:
+  ScopedPlannerPhase(cel::PlannerStats* stats,
+                     cel::PlannerStats::Phase cel::PlannerStats::*phase)
+      : stats_(stats), phase_(phase) {
+    if (stats_ != nullptr) {
+      allocations_ = CountAllocations();
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ScopedPlannerPhase(const ScopedPlannerPhase&) = delete;
+  ScopedPlannerPhase& operator=(const ScopedPlannerPhase&) = delete;
+
+  ~ScopedPlannerPhase() {
+    if (stats_ != nullptr) {
+      cel::PlannerStats::Phase& phase = stats_->*phase_;
+      phase.wall_time +=
+          absl::FromChrono(std::chrono::steady_clock::now() - start_);
+      phase.allocations += CountAllocations() - allocations_;
+    }
+  }
+
+ private:
+  int64_t CountAllocations() const {
+    return stats_->allocation_counter ? stats_->allocation_counter() : 0;
+  }
+
+  cel::PlannerStats* stats_;
+  cel::PlannerStats::Phase cel::PlannerStats::*phase_;
+  int64_t allocations_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PLANNER_PHASE_H_
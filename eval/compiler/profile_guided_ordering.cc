@@ -0,0 +1,244 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/profile_guided_ordering.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "eval/compiler/resolver.h"
+#include "eval/compiler/subexpression_analysis.h"
+#include "runtime/evaluation_profile.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::EvaluationProfile;
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Expr;
+
+bool IsChainCall(const Expr& expr, absl::string_view function) {
+  return expr.has_call_expr() && !expr.call_expr().has_target() &&
+         expr.call_expr().function() == function &&
+         expr.call_expr().args().size() == 2;
+}
+
+class ProfileGuidedOrdering {
+ public:
+  ProfileGuidedOrdering(const Resolver& resolver,
+                        const EvaluationProfile& profile)
+      : resolver_(resolver), profile_(profile) {}
+
+  void Order(Expr& expr) {
+    if (IsChainCall(expr, cel::builtin::kAnd)) {
+      OrderChain(expr, cel::builtin::kAnd);
+      return;
+    }
+    if (IsChainCall(expr, cel::builtin::kOr)) {
+      OrderChain(expr, cel::builtin::kOr);
+      return;
+    }
+    bool is_comprehension = expr.has_comprehension_expr();
+    if (is_comprehension) {
+      accumulators_.push_back(expr.comprehension_expr().accu_var());
+    }
+    ForEachChild(expr, [this](Expr& child) { Order(child); });
+    if (is_comprehension) {
+      accumulators_.pop_back();
+    }
+  }
+
+ private:
+  struct Clause {
+    Expr* expr;
+    // Whether the clause may be moved.
+    bool movable;
+    // Number of times the clause was evaluated.
+    int64_t count;
+    double rank;
+  };
+
+  void OrderChain(Expr& expr, absl::string_view function) {
+    std::vector<Expr*> exprs;
+    std::vector<int64_t> ids;
+    FlattenChain(expr, function, exprs, ids);
+    for (Expr* clause : exprs) {
+      Order(*clause);
+    }
+    if (absl::c_any_of(exprs, [this](Expr* clause) {
+          return MentionsAccumulator(*clause);
+        })) {
+      return;
+    }
+
+    std::vector<Clause> clauses;
+    clauses.reserve(exprs.size());
+    for (Expr* clause : exprs) {
+      auto stats = profile_.stats().find(clause->id());
+      bool profiled =
+          stats != profile_.stats().end() && stats->second.count > 0;
+      clauses.push_back({clause, profiled && IsRelocatable(*clause),
+                         profiled ? stats->second.count : 0, 0});
+    }
+
+    // The share of evaluations each clause decided. The next clause only
+    // runs if this one did not decide the chain.
+    std::vector<double> decisiveness(clauses.size(), 0);
+    double observed_decisiveness = 0;
+    int observed_clauses = 0;
+    for (size_t i = 0; i + 1 < clauses.size(); ++i) {
+      if (clauses[i].count == 0) {
+        continue;
+      }
+      decisiveness[i] =
+          std::clamp(1.0 - static_cast<double>(clauses[i + 1].count) /
+                               static_cast<double>(clauses[i].count),
+                     0.0, 1.0);
+      observed_decisiveness += decisiveness[i];
+      ++observed_clauses;
+    }
+    if (observed_clauses == 0) {
+      return;
+    }
+    // The last clause is assumed to be as decisive as the others on average.
+    decisiveness.back() = observed_decisiveness / observed_clauses;
+
+    for (size_t i = 0; i < clauses.size(); ++i) {
+      Clause& clause = clauses[i];
+      if (!clause.movable) {
+        continue;
+      }
+      double cost =
+          absl::ToDoubleNanoseconds(SubtreeWallTime(*clause.expr)) /
+          static_cast<double>(clause.count);
+      clause.rank = decisiveness[i] > 0
+                        ? cost / decisiveness[i]
+                        : std::numeric_limits<double>::infinity();
+    }
+
+    // Order the clauses between those that may not be moved by rank.
+    std::vector<Clause> ordered = clauses;
+    for (auto begin = ordered.begin(); begin != ordered.end();) {
+      auto end = std::find_if(begin, ordered.end(), [](const Clause& clause) {
+        return !clause.movable;
+      });
+      std::stable_sort(begin, end, [](const Clause& lhs, const Clause& rhs) {
+        return lhs.rank < rhs.rank;
+      });
+      begin = end == ordered.end() ? end : end + 1;
+    }
+    if (absl::c_equal(ordered, clauses,
+                      [](const Clause& lhs, const Clause& rhs) {
+                        return lhs.expr == rhs.expr;
+                      })) {
+      return;
+    }
+
+    // Rebuild the chain as a left-leaning tree, reusing the ids of the
+    // original calls.
+    std::vector<Expr> operands;
+    operands.reserve(ordered.size());
+    for (const Clause& clause : ordered) {
+      operands.push_back(std::move(*clause.expr));
+    }
+    Expr chain = std::move(operands[0]);
+    for (size_t i = 1; i < operands.size(); ++i) {
+      std::vector<Expr> args;
+      args.push_back(std::move(chain));
+      args.push_back(std::move(operands[i]));
+      chain = Expr(ids[operands.size() - 1 - i],
+                   Call(nullptr, std::string(function), std::move(args)));
+    }
+    expr = std::move(chain);
+  }
+
+  void FlattenChain(Expr& expr, absl::string_view function,
+                    std::vector<Expr*>& clauses, std::vector<int64_t>& ids) {
+    if (!IsChainCall(expr, function)) {
+      clauses.push_back(&expr);
+      return;
+    }
+    ids.push_back(expr.id());
+    for (Expr& arg : expr.mutable_call_expr().mutable_args()) {
+      FlattenChain(arg, function, clauses, ids);
+    }
+  }
+
+  // Total wall time of the steps planned for expr and its subexpressions.
+  absl::Duration SubtreeWallTime(const Expr& expr) const {
+    absl::Duration wall_time = absl::ZeroDuration();
+    auto stats = profile_.stats().find(expr.id());
+    if (stats != profile_.stats().end()) {
+      wall_time += stats->second.wall_time;
+    }
+    ForEachChild(expr, [this, &wall_time](const Expr& child) {
+      wall_time += SubtreeWallTime(child);
+    });
+    return wall_time;
+  }
+
+  // Whether evaluating `expr` has no effect besides its result, so it may be
+  // evaluated earlier than it used to be, or not at all.
+  bool IsRelocatable(const Expr& expr) const {
+    if (expr.has_comprehension_expr()) {
+      return false;
+    }
+    if (expr.has_call_expr() && !IsPureCall(resolver_, expr)) {
+      return false;
+    }
+    bool relocatable = true;
+    ForEachChild(expr, [this, &relocatable](const Expr& child) {
+      relocatable = relocatable && IsRelocatable(child);
+    });
+    return relocatable;
+  }
+
+  bool MentionsAccumulator(const Expr& expr) const {
+    if (expr.has_ident_expr()) {
+      return absl::c_linear_search(accumulators_, expr.ident_expr().name());
+    }
+    bool mentions = false;
+    ForEachChild(expr, [this, &mentions](const Expr& child) {
+      mentions = mentions || MentionsAccumulator(child);
+    });
+    return mentions;
+  }
+
+  const Resolver& resolver_;
+  const EvaluationProfile& profile_;
+  // Accumulator variables of the comprehensions enclosing the current node.
+  std::vector<std::string> accumulators_;
+};
+
+}  // namespace
+
+void OrderClausesByProfile(const Resolver& resolver,
+                           const EvaluationProfile& profile, AstImpl& ast) {
+  ProfileGuidedOrdering(resolver, profile).Order(ast.root_expr());
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,49 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROFILE_GUIDED_ORDERING_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROFILE_GUIDED_ORDERING_H_
+
+#include "base/ast_internal/ast_impl.h"
+#include "eval/compiler/resolver.h"
+#include "runtime/evaluation_profile.h"
+
+namespace google::api::expr::runtime {
+
+// Reorders the clauses of the `&&` and `||` chains of ast by the statistics
+// profile collected while evaluating the same expression before (see
+// cel::TraceableProgram::Profile). The expression ids of the profile must be
+// those of ast.
+//
+// Each clause is ranked by its measured wall time per evaluation divided by
+// how often evaluating it short-circuited the rest of the chain, and clauses
+// run in ascending rank: cheap clauses that usually decide the chain come
+// first. How often the last clause of a chain decides it cannot be observed,
+// it is assumed to be the average of the other clauses.
+//
+// As for the algebraic simplification, only clauses without side effects or
+// comprehensions are moved, and chains referring to comprehension
+// accumulators are left as they are. Clauses the profile has no statistics
+// for, e.g. because they were never reached, are not moved either. The
+// logical operators are commutative in CEL, so this does not change the
+// result, except that when several clauses evaluate to errors a different one
+// of them may be reported. Expression ids are preserved, so profiles of the
+// reordered program remain valid for ast.
+void OrderClausesByProfile(const Resolver& resolver,
+                           const cel::EvaluationProfile& profile,
+                           cel::ast_internal::AstImpl& ast);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROFILE_GUIDED_ORDERING_H_
@@ -0,0 +1,177 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/profile_guided_ordering.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/value_factory.h"
+#include "eval/compiler/resolver.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/evaluation_profile.h"
+#include "runtime/function_registry.h"
+#include "runtime/type_registry.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::EvaluationProfile;
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Expr;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+
+// Renders identifiers and calls, e.g. `_&&_(a, b)`.
+std::string Describe(const Expr& expr) {
+  if (expr.has_ident_expr()) {
+    return expr.ident_expr().name();
+  }
+  if (expr.has_call_expr()) {
+    std::vector<std::string> operands;
+    for (const Expr& arg : expr.call_expr().args()) {
+      operands.push_back(Describe(arg));
+    }
+    return absl::StrCat(expr.call_expr().function(), "(",
+                        absl::StrJoin(operands, ", "), ")");
+  }
+  return "?";
+}
+
+absl::StatusOr<std::unique_ptr<cel::Ast>> ParseFromCel(
+    absl::string_view expression) {
+  CEL_ASSIGN_OR_RETURN(ParsedExpr expr, Parse(expression));
+  return cel::extensions::CreateAstFromParsedExpr(expr);
+}
+
+// Returns the identifier named name in expr.
+const Expr* FindIdent(const Expr& expr, absl::string_view name) {
+  if (expr.has_ident_expr() && expr.ident_expr().name() == name) {
+    return &expr;
+  }
+  if (expr.has_call_expr()) {
+    for (const Expr& arg : expr.call_expr().args()) {
+      if (const Expr* found = FindIdent(arg, name); found != nullptr) {
+        return found;
+      }
+    }
+  }
+  return nullptr;
+}
+
+class ProfileGuidedOrderingTest : public testing::Test {
+ public:
+  ProfileGuidedOrderingTest()
+      : type_factory_(cel::MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, type_registry_.GetComposedTypeProvider()),
+        value_factory_(type_manager_),
+        resolver_("", function_registry_, type_registry_, value_factory_,
+                  type_registry_.resolveable_enums()) {}
+
+ protected:
+  // Records `count` evaluations of expr_id taking `wall_time` each.
+  void Record(int64_t expr_id, int count, absl::Duration wall_time) {
+    for (int i = 0; i < count; ++i) {
+      profile_.Record(expr_id, wall_time, 0);
+    }
+  }
+
+  void Record(const AstImpl& ast, absl::string_view ident, int count,
+              absl::Duration wall_time) {
+    const Expr* expr = FindIdent(ast.root_expr(), ident);
+    ASSERT_NE(expr, nullptr);
+    Record(expr->id(), count, wall_time);
+  }
+
+  cel::FunctionRegistry function_registry_;
+  cel::TypeRegistry type_registry_;
+  cel::TypeFactory type_factory_;
+  cel::TypeManager type_manager_;
+  cel::ValueFactory value_factory_;
+  Resolver resolver_;
+  EvaluationProfile profile_;
+};
+
+TEST_F(ProfileGuidedOrderingTest, CheapDecisiveClausesRunFirst) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<cel::Ast> ast,
+                       ParseFromCel("a && b && c"));
+  AstImpl& ast_impl = AstImpl::CastFromPublicAst(*ast);
+  int64_t root_id = ast_impl.root_expr().id();
+  // a is expensive and rarely false, c is cheap and as decisive as b.
+  Record(ast_impl, "a", 10, absl::Microseconds(10));
+  Record(ast_impl, "b", 9, absl::Microseconds(1));
+  Record(ast_impl, "c", 3, absl::Nanoseconds(10));
+
+  OrderClausesByProfile(resolver_, profile_, ast_impl);
+
+  EXPECT_EQ(Describe(ast_impl.root_expr()), "_&&_(_&&_(c, b), a)");
+  EXPECT_EQ(ast_impl.root_expr().id(), root_id);
+}
+
+TEST_F(ProfileGuidedOrderingTest, ClausesWithSideEffectsAreBarriers) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<cel::Ast> ast,
+                       ParseFromCel("a || f(b) || c"));
+  AstImpl& ast_impl = AstImpl::CastFromPublicAst(*ast);
+  Record(ast_impl, "a", 10, absl::Microseconds(10));
+  Record(ast_impl, "b", 9, absl::Microseconds(1));
+  Record(ast_impl.root_expr().call_expr().args()[0].call_expr().args()[1].id(),
+         9, absl::Microseconds(1));
+  Record(ast_impl, "c", 3, absl::Nanoseconds(10));
+
+  OrderClausesByProfile(resolver_, profile_, ast_impl);
+
+  // f is not registered, so it might have side effects.
+  EXPECT_EQ(Describe(ast_impl.root_expr()), "_||_(_||_(a, f(b)), c)");
+}
+
+TEST_F(ProfileGuidedOrderingTest, UnprofiledClausesAreNotMoved) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<cel::Ast> ast,
+                       ParseFromCel("a && b"));
+  AstImpl& ast_impl = AstImpl::CastFromPublicAst(*ast);
+  Record(ast_impl, "a", 10, absl::Microseconds(10));
+
+  OrderClausesByProfile(resolver_, profile_, ast_impl);
+
+  EXPECT_EQ(Describe(ast_impl.root_expr()), "_&&_(a, b)");
+}
+
+TEST_F(ProfileGuidedOrderingTest, EmptyProfileKeepsOrder) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<cel::Ast> ast,
+                       ParseFromCel("a && b || c && d"));
+  AstImpl& ast_impl = AstImpl::CastFromPublicAst(*ast);
+
+  OrderClausesByProfile(resolver_, profile_, ast_impl);
+
+  EXPECT_EQ(Describe(ast_impl.root_expr()), "_||_(_&&_(a, b), _&&_(c, d))");
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,206 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/program_set_optimization.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/handle.h"
+#include "base/types/list_type.h"
+#include "base/value.h"
+#include "base/values/list_value_builder.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/subexpression_analysis.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
+#include "internal/status_macros.h"
+#include "runtime/internal/mutable_list_impl.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::Handle;
+using ::cel::ListValueBuilderInterface;
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::CheckedExpr;
+using ::cel::ast_internal::CreateList;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::SourceInfo;
+using ::cel::runtime_internal::DynListType;
+
+// Calls f for expr and all of its descendants, including the entries of
+// struct and map literals.
+template <typename F>
+void ForEachId(Expr& expr, F& f) {
+  expr.set_id(f(expr.id()));
+  if (expr.has_struct_expr()) {
+    for (auto& entry : expr.mutable_struct_expr().mutable_entries()) {
+      entry.set_id(f(entry.id()));
+    }
+  }
+  ForEachChild(expr, [&f](Expr& child) { ForEachId(child, f); });
+}
+
+// Pushes a list of the top list_size values, whatever their kind.
+class CollectProgramSetStep : public ExpressionStepBase {
+ public:
+  explicit CollectProgramSetStep(int list_size)
+      : ExpressionStepBase(kProgramSetListId, /*comes_from_ast=*/false),
+        list_size_(list_size) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(list_size_)) {
+      return absl::InternalError("CollectProgramSetStep: stack underflow");
+    }
+    CEL_ASSIGN_OR_RETURN(
+        absl::Nonnull<std::unique_ptr<ListValueBuilderInterface>> builder,
+        DynListType()->NewValueBuilder(frame->value_factory()));
+    builder->Reserve(list_size_);
+    for (const auto& value : frame->value_stack().GetSpan(list_size_)) {
+      CEL_RETURN_IF_ERROR(builder->Add(value));
+    }
+    CEL_ASSIGN_OR_RETURN(Handle<cel::Value> result,
+                         std::move(*builder).Build());
+    frame->value_stack().Pop(list_size_);
+    frame->value_stack().Push(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  int list_size_;
+};
+
+class ProgramSetOptimizer : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    if (node.id() != kProgramSetListId || !node.has_list_expr() ||
+        node.list_expr().elements().empty()) {
+      return absl::OkStatus();
+    }
+    const std::vector<Expr>& elements = node.list_expr().elements();
+    size_t sentinel_size = context.GetSubplan(elements.back()).size();
+    CEL_ASSIGN_OR_RETURN(ExecutionPath plan, context.ExtractSubplan(node));
+    if (plan.size() < sentinel_size + 1) {
+      return absl::InternalError("unexpected program set plan");
+    }
+    // Drop the list creation and the sentinel.
+    plan.resize(plan.size() - sentinel_size - 1);
+    plan.push_back(
+        std::make_unique<CollectProgramSetStep>(elements.size() - 1));
+    return context.ReplaceSubplan(node, std::move(plan));
+  }
+};
+
+}  // namespace
+
+absl::StatusOr<AstImpl> MergeProgramSet(
+    absl::Span<const AstImpl* const> asts) {
+  bool is_checked = true;
+  int64_t next_id = 1;
+  std::vector<Expr> elements;
+  elements.reserve(asts.size() + 1);
+  SourceInfo source_info;
+  absl::flat_hash_map<int64_t, cel::ast_internal::Reference> reference_map;
+  absl::flat_hash_map<int64_t, cel::ast_internal::Type> type_map;
+
+  for (const AstImpl* ast : asts) {
+    is_checked = is_checked && ast->IsChecked();
+    Expr expr = ast->root_expr().DeepCopy();
+    int64_t min_id = std::numeric_limits<int64_t>::max();
+    int64_t max_id = std::numeric_limits<int64_t>::min();
+    auto find_range = [&](int64_t id) {
+      min_id = std::min(min_id, id);
+      max_id = std::max(max_id, id);
+      return id;
+    };
+    ForEachId(expr, find_range);
+    std::vector<std::pair<int64_t, Expr>> macro_calls;
+    macro_calls.reserve(ast->source_info().macro_calls().size());
+    for (const auto& macro_call : ast->source_info().macro_calls()) {
+      find_range(macro_call.first);
+      macro_calls.push_back({macro_call.first, macro_call.second.DeepCopy()});
+      ForEachId(macro_calls.back().second, find_range);
+    }
+    if (min_id < 0) {
+      return absl::InvalidArgumentError(
+          "program set expressions must not use negative ids");
+    }
+
+    int64_t offset = next_id - min_id;
+    auto shift = [offset](int64_t id) { return id + offset; };
+    ForEachId(expr, shift);
+    elements.push_back(std::move(expr));
+    for (auto& macro_call : macro_calls) {
+      ForEachId(macro_call.second, shift);
+      source_info.mutable_macro_calls().insert(
+          {macro_call.first + offset, std::move(macro_call.second)});
+    }
+    // Positions are kept for diagnostics, but refer to the source of each
+    // expression.
+    for (const auto& position : ast->source_info().positions()) {
+      source_info.mutable_positions().insert(
+          {position.first + offset, position.second});
+    }
+    for (const auto& reference : ast->reference_map()) {
+      reference_map.insert({reference.first + offset, reference.second});
+    }
+    for (const auto& type : ast->type_map()) {
+      type_map.insert({type.first + offset, type.second});
+    }
+    next_id = max_id + offset + 1;
+  }
+  elements.push_back(Expr(next_id, CreateList()));
+
+  CreateList list;
+  list.set_elements(std::move(elements));
+  Expr root(kProgramSetListId, std::move(list));
+  if (is_checked) {
+    CheckedExpr checked_expr;
+    checked_expr.set_expr(std::move(root));
+    checked_expr.set_source_info(std::move(source_info));
+    checked_expr.set_reference_map(std::move(reference_map));
+    checked_expr.set_type_map(std::move(type_map));
+    return AstImpl(std::move(checked_expr));
+  }
+  AstImpl merged(std::move(root), std::move(source_info));
+  merged.reference_map() = std::move(reference_map);
+  return merged;
+}
+
+ProgramOptimizerFactory CreateProgramSetOptimizer() {
+  return [](PlannerContext&, const AstImpl&)
+             -> absl::StatusOr<std::unique_ptr<ProgramOptimizer>> {
+    return std::make_unique<ProgramSetOptimizer>();
+  };
+}
+
+}  // namespace google::api::expr::runtime
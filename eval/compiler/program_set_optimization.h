@@ -0,0 +1,52 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROGRAM_SET_OPTIMIZATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROGRAM_SET_OPTIMIZATION_H_
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/ast_internal/ast_impl.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Id of the list literal holding the expressions of a program set. Parsed and
+// checked expressions never use negative ids.
+inline constexpr int64_t kProgramSetListId = -1;
+
+// Merge asts into a single expression, `[ast_0, ..., ast_n-1, []]`, for
+// planning them as one program.
+//
+// The ids of each expression (and of its references, types and source
+// positions) are offset so that they don't collide with the others. The
+// trailing empty list only keeps the constant folder from folding the list,
+// which would turn the error of one expression into the result of all; the
+// program set optimizer drops it from the plan.
+//
+// The result is a checked AST if all of asts are checked.
+absl::StatusOr<cel::ast_internal::AstImpl> MergeProgramSet(
+    absl::Span<const cel::ast_internal::AstImpl* const> asts);
+
+// Create a new extension for the FlatExprBuilder that plans the list of a
+// merged program set (see MergeProgramSet) as a step that collects the value
+// of each expression as is: an error or unknown result of one expression
+// doesn't replace the results of the others, as it does for list literals.
+ProgramOptimizerFactory CreateProgramSetOptimizer();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_PROGRAM_SET_OPTIMIZATION_H_
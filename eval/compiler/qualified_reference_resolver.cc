@@ -31,7 +31,6 @@
 #include "base/ast_internal/ast_impl.h"
 #include "base/ast_internal/expr.h"
 #include "base/builtins.h"
-#include "base/kind.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
 #include "eval/compiler/resolver.h"
 #include "eval/public/ast_rewrite_native.h"
@@ -59,12 +58,8 @@ bool IsSpecialFunction(absl::string_view function_name) {
 }
 
 bool OverloadExists(const Resolver& resolver, absl::string_view name,
-                    const std::vector<cel::Kind>& arguments_matcher,
-                    bool receiver_style = false) {
-  return !resolver.FindOverloads(name, receiver_style, arguments_matcher)
-              .empty() ||
-         !resolver.FindLazyOverloads(name, receiver_style, arguments_matcher)
-              .empty();
+                    int argument_count, bool receiver_style = false) {
+  return resolver.HasOverloads(name, receiver_style, argument_count);
 }
 
 // Return the qualified name of the most qualified matching overload, or
@@ -75,11 +70,10 @@ absl::optional<std::string> BestOverloadMatch(const Resolver& resolver,
   if (IsSpecialFunction(base_name)) {
     return std::string(base_name);
   }
-  auto arguments_matcher = ArgumentsMatcher(argument_count);
   // Check from most qualified to least qualified for a matching overload.
   auto names = resolver.FullyQualifiedNames(base_name);
   for (auto name = names.begin(); name != names.end(); ++name) {
-    if (OverloadExists(resolver, *name, arguments_matcher)) {
+    if (OverloadExists(resolver, *name, argument_count)) {
       if (base_name[0] == '.') {
         // Preserve leading '.' to prevent re-resolving at plan time.
         return std::string(base_name);
@@ -202,8 +196,7 @@ class ReferenceResolver : public cel::ast_internal::AstRewriterBase {
     // For parity, if we didn't rewrite the receiver call style function,
     // check that an overload is provided in the builder.
     if (call_expr.has_target() &&
-        !OverloadExists(resolver_, call_expr.function(),
-                        ArgumentsMatcher(arg_num + 1),
+        !OverloadExists(resolver_, call_expr.function(), arg_num + 1,
                         /* receiver_style= */ true)) {
       UpdateStatus(issues_.AddIssue(RuntimeIssue::CreateWarning(
           absl::InvalidArgumentError(
@@ -0,0 +1,212 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/referenced_attributes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/ast_internal/expr.h"
+#include "base/attribute.h"
+#include "base/builtins.h"
+#include "runtime/referenced_attribute.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::Attribute;
+using ::cel::AttributeQualifier;
+using ::cel::ReferencedAttribute;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+
+// Returns the qualifier for a constant index, if the constant can be one.
+absl::optional<AttributeQualifier> IndexQualifier(const Constant& constant) {
+  if (constant.has_string_value()) {
+    return AttributeQualifier::OfString(constant.string_value());
+  }
+  if (constant.has_int64_value()) {
+    return AttributeQualifier::OfInt(constant.int64_value());
+  }
+  if (constant.has_uint64_value()) {
+    return AttributeQualifier::OfUint(constant.uint64_value());
+  }
+  if (constant.has_bool_value()) {
+    return AttributeQualifier::OfBool(constant.bool_value());
+  }
+  return absl::nullopt;
+}
+
+bool IsIndex(const Expr& expr) {
+  return expr.has_call_expr() &&
+         expr.call_expr().function() == cel::builtin::kIndex &&
+         !expr.call_expr().has_target() && expr.call_expr().args().size() == 2;
+}
+
+class ReferencedAttributeCollector {
+ public:
+  explicit ReferencedAttributeCollector(
+      absl::FunctionRef<bool(absl::string_view, int64_t)> is_constant)
+      : is_constant_(is_constant) {}
+
+  void Visit(const Expr& expr, bool conditional) {
+    if (expr.has_ident_expr() || expr.has_select_expr() || IsIndex(expr)) {
+      if (VisitAttribute(expr, conditional)) {
+        return;
+      }
+    }
+    if (expr.has_select_expr()) {
+      Visit(expr.select_expr().operand(), conditional);
+    } else if (expr.has_call_expr()) {
+      VisitCall(expr.call_expr(), conditional);
+    } else if (expr.has_list_expr()) {
+      for (const auto& element : expr.list_expr().elements()) {
+        Visit(element, conditional);
+      }
+    } else if (expr.has_struct_expr()) {
+      for (const auto& entry : expr.struct_expr().entries()) {
+        if (entry.has_map_key()) {
+          Visit(entry.map_key(), conditional);
+        }
+        if (entry.has_value()) {
+          Visit(entry.value(), conditional);
+        }
+      }
+    } else if (expr.has_comprehension_expr()) {
+      const auto& comprehension = expr.comprehension_expr();
+      Visit(comprehension.iter_range(), conditional);
+      Visit(comprehension.accu_init(), conditional);
+      scope_.push_back(comprehension.accu_var());
+      scope_.push_back(comprehension.iter_var());
+      // The body is skipped for empty ranges, and may stop early.
+      Visit(comprehension.loop_condition(), true);
+      Visit(comprehension.loop_step(), true);
+      scope_.pop_back();
+      Visit(comprehension.result(), conditional);
+      scope_.pop_back();
+    }
+  }
+
+  std::vector<ReferencedAttribute> Release() && {
+    return std::move(attributes_);
+  }
+
+ private:
+  void VisitCall(const cel::ast_internal::Call& call, bool conditional) {
+    if (call.has_target()) {
+      Visit(call.target(), conditional);
+    }
+    const auto& args = call.args();
+    // Operands that evaluation may skip depending on the first argument.
+    bool branches = (call.function() == cel::builtin::kAnd ||
+                     call.function() == cel::builtin::kOr) &&
+                    args.size() == 2;
+    branches |= call.function() == cel::builtin::kTernary && args.size() == 3;
+    for (size_t i = 0; i < args.size(); ++i) {
+      Visit(args[i], conditional || (branches && i > 0));
+    }
+  }
+
+  // Records the attribute expr refers to, if it is a path of selections and
+  // constant indexes from a variable. Operands of non-constant indexes are
+  // visited. Returns false if expr is not such a path.
+  bool VisitAttribute(const Expr& expr, bool conditional) {
+    std::vector<const Expr*> path;
+    const Expr* current = &expr;
+    while (true) {
+      if (current->has_select_expr()) {
+        path.push_back(current);
+        current = &current->select_expr().operand();
+      } else if (IsIndex(*current) &&
+                 current->call_expr().args()[1].has_const_expr() &&
+                 IndexQualifier(current->call_expr().args()[1].const_expr())
+                     .has_value()) {
+        path.push_back(current);
+        current = &current->call_expr().args()[0];
+      } else {
+        break;
+      }
+    }
+    if (!current->has_ident_expr()) {
+      return false;
+    }
+    const std::string& name = current->ident_expr().name();
+    if (absl::c_linear_search(scope_, name)) {
+      // Comprehension variables are not attributes of the activation.
+      return true;
+    }
+
+    // Qualified names may resolve to constants, e.g. enum values.
+    std::string qualified_name = name;
+    if (is_constant_(qualified_name, current->id())) {
+      return true;
+    }
+    std::vector<AttributeQualifier> qualifiers;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      const Expr& step = **it;
+      if (step.has_select_expr()) {
+        const std::string& field = step.select_expr().field();
+        if (qualifiers.empty()) {
+          absl::StrAppend(&qualified_name, ".", field);
+          if (is_constant_(qualified_name, step.id())) {
+            return true;
+          }
+        }
+        qualifiers.push_back(AttributeQualifier::OfString(field));
+      } else {
+        qualifiers.push_back(
+            *IndexQualifier(step.call_expr().args()[1].const_expr()));
+      }
+    }
+    Add(Attribute(name, std::move(qualifiers)), conditional);
+    return true;
+  }
+
+  void Add(Attribute attribute, bool conditional) {
+    for (auto& referenced : attributes_) {
+      if (referenced.attribute == attribute) {
+        referenced.conditional &= conditional;
+        return;
+      }
+    }
+    attributes_.push_back(
+        ReferencedAttribute{std::move(attribute), conditional});
+  }
+
+  absl::FunctionRef<bool(absl::string_view, int64_t)> is_constant_;
+  // Comprehension variables in scope.
+  std::vector<std::string> scope_;
+  std::vector<ReferencedAttribute> attributes_;
+};
+
+}  // namespace
+
+std::vector<ReferencedAttribute> CollectReferencedAttributes(
+    const Expr& root,
+    absl::FunctionRef<bool(absl::string_view, int64_t)> is_constant) {
+  ReferencedAttributeCollector collector(is_constant);
+  collector.Visit(root, /*conditional=*/false);
+  return std::move(collector).Release();
+}
+
+}  // namespace google::api::expr::runtime
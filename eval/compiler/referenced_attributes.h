@@ -0,0 +1,44 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REFERENCED_ATTRIBUTES_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REFERENCED_ATTRIBUTES_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/expr.h"
+#include "runtime/referenced_attribute.h"
+
+namespace google::api::expr::runtime {
+
+// Returns the attributes of the activation that evaluating the expression may
+// read, in order of first reference.
+//
+// Each identifier that is not a comprehension variable is extended with the
+// field selections and constant indexes applied to it, and listed once. If it
+// is referenced both conditionally and unconditionally, it is unconditional.
+//
+// is_constant(name, expr_id) should return true if the identifier or
+// qualified name refers to a constant (e.g. an enum value or type) rather
+// than a variable; such references are skipped.
+std::vector<cel::ReferencedAttribute> CollectReferencedAttributes(
+    const cel::ast_internal::Expr& root,
+    absl::FunctionRef<bool(absl::string_view, int64_t)> is_constant);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REFERENCED_ATTRIBUTES_H_
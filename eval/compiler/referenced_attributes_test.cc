@@ -0,0 +1,96 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/referenced_attributes.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/referenced_attribute.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using cel::internal::IsOkAndHolds;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+// Formats the referenced attributes as "path" or "path?" if conditional.
+absl::StatusOr<std::vector<std::string>> Collect(absl::string_view expression) {
+  CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expression));
+  CEL_ASSIGN_OR_RETURN(std::unique_ptr<cel::Ast> ast,
+                       CreateAstFromParsedExpr(parsed_expr));
+  std::vector<cel::ReferencedAttribute> attributes =
+      CollectReferencedAttributes(
+          AstImpl::CastFromPublicAst(*ast).root_expr(),
+          [](absl::string_view name, int64_t) {
+            return name == "pkg.Enum.VALUE";
+          });
+  std::vector<std::string> result;
+  for (const auto& referenced : attributes) {
+    CEL_ASSIGN_OR_RETURN(std::string path, referenced.attribute.AsString());
+    result.push_back(absl::StrCat(path, referenced.conditional ? "?" : ""));
+  }
+  return result;
+}
+
+TEST(ReferencedAttributesTest, Paths) {
+  EXPECT_THAT(Collect("request.auth.claims['group'] == 'admin' && size(x)"),
+              IsOkAndHolds(ElementsAre("request.auth.claims.group", "x?")));
+  EXPECT_THAT(Collect("a.b[0][true] + a.c[1u]"),
+              IsOkAndHolds(ElementsAre("a.b[0][true]", "a.c[1]")));
+}
+
+TEST(ReferencedAttributesTest, NonConstantIndex) {
+  EXPECT_THAT(Collect("a.b[c.d].e"),
+              IsOkAndHolds(ElementsAre("a.b", "c.d")));
+}
+
+TEST(ReferencedAttributesTest, Constants) {
+  EXPECT_THAT(Collect("pkg.Enum.VALUE == 1 ? 'a' : 'b'"),
+              IsOkAndHolds(IsEmpty()));
+}
+
+TEST(ReferencedAttributesTest, Conditional) {
+  EXPECT_THAT(Collect("a || b"), IsOkAndHolds(ElementsAre("a", "b?")));
+  EXPECT_THAT(Collect("a ? b : c"),
+              IsOkAndHolds(ElementsAre("a", "b?", "c?")));
+  // Referenced unconditionally as well.
+  EXPECT_THAT(Collect("(a && b) || b"), IsOkAndHolds(ElementsAre("a", "b")));
+}
+
+TEST(ReferencedAttributesTest, Comprehensions) {
+  EXPECT_THAT(Collect("items.exists(i, i.id == request.id)"),
+              IsOkAndHolds(ElementsAre("items", "request.id?")));
+  EXPECT_THAT(Collect("[1, 2].map(x, x + y).size() > z"),
+              IsOkAndHolds(ElementsAre("y?", "z")));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
@@ -27,14 +28,20 @@
 #include "base/ast_internal/ast_impl.h"
 #include "base/ast_internal/expr.h"
 #include "base/builtins.h"
+#include "base/kind.h"
 #include "base/values/string_value.h"
 #include "common/native_type.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/resolver.h"
 #include "eval/eval/compiler_constant_step.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/regex_match_step.h"
 #include "internal/casts.h"
+#include "internal/regex_pool.h"
 #include "internal/status_macros.h"
+#include "re2/re2.h"
+#include "re2/set.h"
+#include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
 namespace {
@@ -48,6 +55,38 @@ using cel::internal::down_cast;
 
 using ReferenceMap = absl::flat_hash_map<int64_t, Reference>;
 
+using RegexStepFactory = absl::StatusOr<std::unique_ptr<ExpressionStep>> (*)(
+    std::shared_ptr<const RE2>, std::unique_ptr<const ExpressionStep>,
+    int64_t);
+
+// Functions of the regex extension, see extensions/regex_functions.h. Their
+// pattern is always the second argument.
+struct RegexExtensionFunction {
+  absl::string_view name;
+  size_t arity;
+  RegexStepFactory create_step;
+};
+
+constexpr RegexExtensionFunction kRegexExtensionFunctions[] = {
+    {"re.extract", 3, &CreateRegexExtractStep},
+    {"re.capture", 2, &CreateRegexCaptureStep},
+    {"re.captureN", 2, &CreateRegexCaptureNStep},
+};
+
+const RegexExtensionFunction* FindRegexExtensionFunction(const Expr& expr) {
+  if (!expr.has_call_expr() || expr.call_expr().has_target()) {
+    return nullptr;
+  }
+  const auto& call_expr = expr.call_expr();
+  for (const auto& function : kRegexExtensionFunctions) {
+    if (call_expr.function() == function.name &&
+        call_expr.args().size() == function.arity) {
+      return &function;
+    }
+  }
+  return nullptr;
+}
+
 bool IsFunctionOverload(const Expr& expr, absl::string_view function,
                         absl::string_view overload, size_t arity,
                         const ReferenceMap& reference_map) {
@@ -78,16 +117,39 @@ bool IsFunctionOverload(const Expr& expr, absl::string_view function,
   return false;
 }
 
+absl::optional<std::string> GetConstantString(PlannerContext& context,
+                                              const Expr& expr) {
+  if (expr.has_const_expr() && expr.const_expr().has_string_value()) {
+    return expr.const_expr().string_value();
+  }
+
+  ExecutionPathView re_plan = context.GetSubplan(expr);
+  if (re_plan.size() == 1 && re_plan[0]->GetNativeTypeId() ==
+                                 NativeTypeId::For<CompilerConstantStep>()) {
+    const auto& constant = down_cast<const CompilerConstantStep&>(*re_plan[0]);
+    if (constant.value()->Is<cel::StringValue>()) {
+      return constant.value()->As<cel::StringValue>().ToString();
+    }
+  }
+
+  return absl::nullopt;
+}
+
 // Abstraction for deduplicating regular expressions over the course of a single
 // create expression call. Should not be used during evaluation. Uses
 // std::shared_ptr and std::weak_ptr.
 class RegexProgramBuilder final {
  public:
-  explicit RegexProgramBuilder(int max_program_size)
-      : max_program_size_(max_program_size) {}
+  // If pool is set, programs are deduplicated with all of its other users
+  // instead.
+  RegexProgramBuilder(int max_program_size, cel::internal::RegexPool* pool)
+      : max_program_size_(max_program_size), pool_(pool) {}
 
   absl::StatusOr<std::shared_ptr<const RE2>> BuildRegexProgram(
       std::string pattern) {
+    if (pool_ != nullptr) {
+      return CheckProgram(pool_->Get(pattern));
+    }
     auto existing = programs_.find(pattern);
     if (existing != programs_.end()) {
       if (auto program = existing->second.lock(); program) {
@@ -95,7 +157,15 @@ class RegexProgramBuilder final {
       }
       programs_.erase(existing);
     }
-    auto program = std::make_shared<RE2>(pattern);
+    CEL_ASSIGN_OR_RETURN(auto program,
+                         CheckProgram(std::make_shared<RE2>(pattern)));
+    programs_.insert({std::move(pattern), program});
+    return program;
+  }
+
+ private:
+  absl::StatusOr<std::shared_ptr<const RE2>> CheckProgram(
+      std::shared_ptr<const RE2> program) const {
     if (max_program_size_ > 0 && program->ProgramSize() > max_program_size_) {
       return absl::InvalidArgumentError("exceeded RE2 max program size");
     }
@@ -103,27 +173,33 @@ class RegexProgramBuilder final {
       return absl::InvalidArgumentError(
           "invalid_argument unsupported RE2 pattern for matches");
     }
-    programs_.insert({std::move(pattern), program});
     return program;
   }
 
- private:
   const int max_program_size_;
+  cel::internal::RegexPool* const pool_;
   absl::flat_hash_map<std::string, std::weak_ptr<const RE2>> programs_;
 };
 
 class RegexPrecompilationOptimization : public ProgramOptimizer {
  public:
-  explicit RegexPrecompilationOptimization(const ReferenceMap& reference_map,
-                                           int regex_max_program_size)
+  RegexPrecompilationOptimization(const ReferenceMap& reference_map,
+                                  int regex_max_program_size,
+                                  cel::internal::RegexPool* pool)
       : reference_map_(reference_map),
-        regex_program_builder_(regex_max_program_size) {}
+        regex_program_builder_(regex_max_program_size, pool) {}
 
   absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
     return absl::OkStatus();
   }
 
   absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    if (const RegexExtensionFunction* function =
+            FindRegexExtensionFunction(node);
+        function != nullptr) {
+      return PrecompileExtensionFunction(context, node, *function);
+    }
+
     // Check that this is the correct matches overload instead of a user defined
     // overload.
     if (!IsFunctionOverload(node, cel::builtin::kRegexMatch, "matches_string",
@@ -160,36 +236,345 @@ class RegexPrecompilationOptimization : public ProgramOptimizer {
   }
 
  private:
-  absl::optional<std::string> GetConstantString(
-      PlannerContext& context, const cel::ast_internal::Expr& expr) const {
-    if (expr.has_const_expr() && expr.const_expr().has_string_value()) {
-      return expr.const_expr().string_value();
-    }
-
-    ExecutionPathView re_plan = context.GetSubplan(expr);
-    if (re_plan.size() == 1 && re_plan[0]->GetNativeTypeId() ==
-                                   NativeTypeId::For<CompilerConstantStep>()) {
-      const auto& constant =
-          down_cast<const CompilerConstantStep&>(*re_plan[0]);
-      if (constant.value()->Is<cel::StringValue>()) {
-        return constant.value()->As<cel::StringValue>().ToString();
-      }
+  // Replaces the function step of a call to the regex extension with a
+  // constant pattern by one using the precompiled pattern. The arguments are
+  // planned as before, and the function step is kept as the fallback for
+  // arguments that are not strings. Unlike for matches, patterns that fail to
+  // compile leave the call as is, so it evaluates to an error as without
+  // precompilation.
+  absl::Status PrecompileExtensionFunction(
+      PlannerContext& context, const Expr& node,
+      const RegexExtensionFunction& function) {
+    const Call& call_expr = node.call_expr();
+    std::vector<cel::Kind> kinds(function.arity, cel::Kind::kString);
+    if (context.resolver()
+            .FindOverloads(function.name, /*receiver_style=*/false, kinds,
+                           node.id())
+            .empty()) {
+      // Not registered, or only lazily; leave the error or binding alone.
+      return absl::OkStatus();
+    }
+
+    absl::optional<std::string> pattern =
+        GetConstantString(context, call_expr.args()[1]);
+    if (!pattern.has_value()) {
+      return absl::OkStatus();
+    }
+
+    // The plan of the call must be the plans of its arguments followed by the
+    // function step, otherwise it was already rewritten.
+    ExecutionPathView plan = context.GetSubplan(node);
+    size_t args_plan_size = 0;
+    for (const auto& arg : call_expr.args()) {
+      args_plan_size += context.GetSubplan(arg).size();
+    }
+    if (plan.empty() || plan.size() != args_plan_size + 1) {
+      return absl::OkStatus();
+    }
+
+    auto program =
+        regex_program_builder_.BuildRegexProgram(*std::move(pattern));
+    if (!program.ok()) {
+      return absl::OkStatus();
     }
 
-    return absl::nullopt;
+    CEL_ASSIGN_OR_RETURN(ExecutionPath new_plan, context.ExtractSubplan(node));
+    std::unique_ptr<const ExpressionStep> function_step =
+        std::move(new_plan.back());
+    CEL_ASSIGN_OR_RETURN(new_plan.back(),
+                         function.create_step(*std::move(program),
+                                              std::move(function_step),
+                                              node.id()));
+    return context.ReplaceSubplan(node, std::move(new_plan));
   }
 
   const ReferenceMap& reference_map_;
   RegexProgramBuilder regex_program_builder_;
 };
 
+bool IsLogicalOr(const Expr& expr) {
+  return expr.has_call_expr() && !expr.call_expr().has_target() &&
+         expr.call_expr().function() == cel::builtin::kOr &&
+         expr.call_expr().args().size() == 2;
+}
+
+bool IsIdent(const Expr& expr, absl::string_view name) {
+  return expr.has_ident_expr() && expr.ident_expr().name() == name;
+}
+
+// Subjects of matches which are merged are limited to identifiers and field
+// selections on them, which are cheap to compare and evaluate.
+bool IsSimpleSubject(const Expr& expr) {
+  const Expr* e = &expr;
+  while (e->has_select_expr() && !e->select_expr().test_only()) {
+    e = &e->select_expr().operand();
+  }
+  return e->has_ident_expr();
+}
+
+// Returns the identifier at the root of a simple subject.
+absl::string_view SubjectRoot(const Expr& expr) {
+  const Expr* e = &expr;
+  while (e->has_select_expr()) {
+    e = &e->select_expr().operand();
+  }
+  return e->ident_expr().name();
+}
+
+bool SameSubject(const Expr& lhs, const Expr& rhs) {
+  const Expr* l = &lhs;
+  const Expr* r = &rhs;
+  while (l->has_select_expr() && r->has_select_expr()) {
+    if (l->select_expr().field() != r->select_expr().field() ||
+        l->select_expr().test_only() || r->select_expr().test_only()) {
+      return false;
+    }
+    l = &l->select_expr().operand();
+    r = &r->select_expr().operand();
+  }
+  return l->has_ident_expr() && r->has_ident_expr() &&
+         l->ident_expr().name() == r->ident_expr().name();
+}
+
+// Merges disjunctions of matches on the same subject with constant patterns,
+// `s.matches('a') || s.matches('b') || ...`, and exists() over a list of
+// constant patterns, `['a', 'b'].exists(p, s.matches(p))`, into one RE2::Set.
+// The subject is then evaluated once and scanned once for all patterns.
+//
+// The rewrite is applied to the outermost disjunction, so every matches call
+// in it must qualify. Patterns which do not compile, or exceed the maximum
+// program size, leave the expression as is. Unknown processing disables the
+// optimization, since the function steps also check the subject for partially
+// unknown attributes.
+class RegexSetOptimization : public ProgramOptimizer {
+ public:
+  RegexSetOptimization(const ReferenceMap& reference_map,
+                       int regex_max_program_size)
+      : reference_map_(reference_map),
+        regex_max_program_size_(regex_max_program_size) {}
+
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    ancestors_.push_back(&node);
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    ancestors_.pop_back();
+    if (context.options().unknown_processing !=
+        cel::UnknownProcessingOptions::kDisabled) {
+      return absl::OkStatus();
+    }
+    if (IsLogicalOr(node)) {
+      if (!ancestors_.empty() && IsLogicalOr(*ancestors_.back())) {
+        // Handled with the enclosing disjunction.
+        return absl::OkStatus();
+      }
+      return OptimizeDisjunction(context, node);
+    }
+    if (node.has_comprehension_expr()) {
+      return OptimizeExists(context, node);
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // Returns the subject of a call to matches with a simple subject, or
+  // nullptr.
+  const Expr* MatchesSubject(const Expr& expr) const {
+    if (!IsFunctionOverload(expr, cel::builtin::kRegexMatch, "matches_string",
+                            2, reference_map_)) {
+      return nullptr;
+    }
+    const Call& call_expr = expr.call_expr();
+    const Expr& subject =
+        call_expr.has_target() ? call_expr.target() : call_expr.args().front();
+    return IsSimpleSubject(subject) ? &subject : nullptr;
+  }
+
+  absl::Status OptimizeDisjunction(PlannerContext& context, const Expr& node) {
+    // The disjunction is flattened left to right. The path to the leftmost
+    // term is kept to check that its plan is still tracked.
+    std::vector<const Expr*> path;
+    const Expr* first = &node;
+    while (IsLogicalOr(*first)) {
+      path.push_back(first);
+      first = &first->call_expr().args().front();
+    }
+    const Expr* subject = MatchesSubject(*first);
+    if (subject == nullptr) {
+      return absl::OkStatus();
+    }
+
+    std::vector<std::string> patterns;
+    std::vector<const Expr*> stack = {&node};
+    while (!stack.empty()) {
+      const Expr* expr = stack.back();
+      stack.pop_back();
+      if (IsLogicalOr(*expr)) {
+        stack.push_back(&expr->call_expr().args()[1]);
+        stack.push_back(&expr->call_expr().args()[0]);
+        continue;
+      }
+      const Expr* term_subject = MatchesSubject(*expr);
+      if (term_subject == nullptr || !SameSubject(*subject, *term_subject)) {
+        return absl::OkStatus();
+      }
+      absl::optional<std::string> pattern =
+          GetConstantString(context, expr->call_expr().args().back());
+      if (!pattern.has_value()) {
+        return absl::OkStatus();
+      }
+      patterns.push_back(*std::move(pattern));
+    }
+
+    // Rewriting a node stops tracking its children, so this also ensures
+    // that the plans of the leftmost term and its subject are current.
+    path.push_back(first);
+    for (const Expr* expr : path) {
+      if (context.GetSubplan(*expr).empty()) {
+        return absl::OkStatus();
+      }
+    }
+    return ReplaceWithSetMatch(context, node, *first, *subject, patterns);
+  }
+
+  // Matches the expansion of the exists() macro, whose loop stops once the
+  // accumulator is true.
+  absl::Status OptimizeExists(PlannerContext& context, const Expr& node) {
+    const auto& comprehension = node.comprehension_expr();
+    const std::string& iter_var = comprehension.iter_var();
+    const std::string& accu_var = comprehension.accu_var();
+    if (!comprehension.iter_range().has_list_expr() ||
+        !comprehension.accu_init().has_const_expr() ||
+        !comprehension.accu_init().const_expr().has_bool_value() ||
+        comprehension.accu_init().const_expr().bool_value() ||
+        !IsIdent(comprehension.result(), accu_var) ||
+        !IsExistsCondition(comprehension.loop_condition(), accu_var)) {
+      return absl::OkStatus();
+    }
+    const Expr& step = comprehension.loop_step();
+    if (!IsLogicalOr(step) ||
+        !IsIdent(step.call_expr().args()[0], accu_var)) {
+      return absl::OkStatus();
+    }
+    const Expr& predicate = step.call_expr().args()[1];
+    const Expr* subject = MatchesSubject(predicate);
+    if (subject == nullptr ||
+        !IsIdent(predicate.call_expr().args().back(), iter_var) ||
+        SubjectRoot(*subject) == iter_var ||
+        SubjectRoot(*subject) == accu_var) {
+      return absl::OkStatus();
+    }
+
+    std::vector<std::string> patterns;
+    const auto& elements = comprehension.iter_range().list_expr().elements();
+    for (const auto& element : elements) {
+      if (!element.has_const_expr() ||
+          !element.const_expr().has_string_value()) {
+        return absl::OkStatus();
+      }
+      patterns.push_back(element.const_expr().string_value());
+    }
+    if (patterns.empty() || context.GetSubplan(step).empty() ||
+        context.GetSubplan(predicate).empty()) {
+      return absl::OkStatus();
+    }
+    return ReplaceWithSetMatch(context, node, predicate, *subject, patterns);
+  }
+
+  static bool IsExistsCondition(const Expr& expr,
+                                absl::string_view accu_var) {
+    if (!expr.has_call_expr() || expr.call_expr().args().size() != 1 ||
+        (expr.call_expr().function() != cel::builtin::kNotStrictlyFalse &&
+         expr.call_expr().function() !=
+             cel::builtin::kNotStrictlyFalseDeprecated)) {
+      return false;
+    }
+    const Expr& arg = expr.call_expr().args()[0];
+    return arg.has_call_expr() &&
+           arg.call_expr().function() == cel::builtin::kNot &&
+           arg.call_expr().args().size() == 1 &&
+           IsIdent(arg.call_expr().args()[0], accu_var);
+  }
+
+  // Replaces the plan of node with the plan of subject, taken from the call
+  // to matches which contains it, and a step matching all patterns.
+  absl::Status ReplaceWithSetMatch(PlannerContext& context, const Expr& node,
+                                   const Expr& matches, const Expr& subject,
+                                   const std::vector<std::string>& patterns) {
+    // The regex precompilation replaces the plan of matches with the plan of
+    // its subject followed by the match step, and no longer tracks the
+    // subject.
+    bool precompiled = false;
+    if (context.GetSubplan(subject).empty()) {
+      ExecutionPathView plan = context.GetSubplan(matches);
+      if (plan.empty() || !IsRegexMatchStep(*plan.back())) {
+        return absl::OkStatus();
+      }
+      precompiled = true;
+    }
+
+    std::shared_ptr<const RE2::Set> set = BuildRegexSet(patterns);
+    if (set == nullptr) {
+      return absl::OkStatus();
+    }
+
+    ExecutionPath new_plan;
+    if (precompiled) {
+      CEL_ASSIGN_OR_RETURN(new_plan, context.ExtractSubplan(matches));
+      new_plan.pop_back();
+    } else {
+      CEL_ASSIGN_OR_RETURN(new_plan, context.ExtractSubplan(subject));
+    }
+    CEL_ASSIGN_OR_RETURN(new_plan.emplace_back(),
+                         CreateRegexSetMatchStep(std::move(set), node.id()));
+    return context.ReplaceSubplan(node, std::move(new_plan));
+  }
+
+  std::shared_ptr<const RE2::Set> BuildRegexSet(
+      const std::vector<std::string>& patterns) const {
+    auto set = std::make_shared<RE2::Set>(RE2::Options(), RE2::UNANCHORED);
+    for (const auto& pattern : patterns) {
+      if (regex_max_program_size_ > 0) {
+        RE2 program(pattern);
+        if (!program.ok() ||
+            program.ProgramSize() > regex_max_program_size_) {
+          return nullptr;
+        }
+      }
+      if (set->Add(pattern, /*error=*/nullptr) < 0) {
+        return nullptr;
+      }
+    }
+    if (!set->Compile()) {
+      return nullptr;
+    }
+    return set;
+  }
+
+  const ReferenceMap& reference_map_;
+  const int regex_max_program_size_;
+  std::vector<const Expr*> ancestors_;
+};
+
 }  // namespace
 
 ProgramOptimizerFactory CreateRegexPrecompilationExtension(
     int regex_max_program_size) {
   return [=](PlannerContext& context, const AstImpl& ast) {
     return std::make_unique<RegexPrecompilationOptimization>(
-        ast.reference_map(), regex_max_program_size);
+        ast.reference_map(), regex_max_program_size,
+        context.options().enable_shared_regex_pool
+            ? &cel::internal::RegexPool::Shared()
+            : nullptr);
+  };
+}
+
+ProgramOptimizerFactory CreateRegexSetExtension(int regex_max_program_size) {
+  return [=](PlannerContext& context, const AstImpl& ast) {
+    return std::make_unique<RegexSetOptimization>(ast.reference_map(),
+                                                  regex_max_program_size);
   };
 }
+
 }  // namespace google::api::expr::runtime
@@ -24,6 +24,11 @@ namespace google::api::expr::runtime {
 ProgramOptimizerFactory CreateRegexPrecompilationExtension(
     int regex_max_program_size);
 
+// Create a new extension for the FlatExprBuilder that matches disjunctions of
+// 'matches' calls on the same subject with constant patterns, and exists()
+// over a list of constant patterns, with a single RE2::Set.
+ProgramOptimizerFactory CreateRegexSetExtension(int regex_max_program_size);
+
 }  // namespace google::api::expr::runtime
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REGEX_PRECOMPILATION_OPTIMIZATION_H_
@@ -17,6 +17,9 @@
 #include <memory>
 #include <utility>
 
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
 #include "google/api/expr/v1alpha1/checked.pb.h"
 #include "google/api/expr/v1alpha1/syntax.pb.h"
 #include "base/ast_internal/ast_impl.h"
@@ -31,8 +34,12 @@
 #include "eval/compiler/flat_expr_builder_extensions.h"
 #include "eval/eval/cel_expression_flat_impl.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
 #include "internal/testing.h"
 #include "parser/parser.h"
 #include "runtime/internal/issue_collector.h"
@@ -43,9 +50,11 @@ namespace google::api::expr::runtime {
 namespace {
 
 using ::cel::RuntimeIssue;
+using ::cel::internal::IsOkAndHolds;
 using ::cel::ast_internal::CheckedExpr;
 using ::cel::runtime_internal::IssueCollector;
 using ::google::api::expr::parser::Parse;
+using ::testing::Not;
 
 namespace exprpb = google::api::expr::v1alpha1;
 
@@ -232,5 +241,70 @@ TEST_F(RegexConstFoldInteropTest, WrongTypeNotOptimized) {
   EXPECT_THAT(plan, ExpressionPlanSizeIs(3)) << expr.DebugString();
 }
 
+class RegexSetExtensionTest : public RegexPrecompilationExtensionTest {
+ public:
+  RegexSetExtensionTest() : RegexPrecompilationExtensionTest() {
+    builder_.flat_expr_builder().AddProgramOptimizer(
+        CreateRegexPrecompilationExtension(options_.regex_max_program_size));
+    builder_.flat_expr_builder().AddProgramOptimizer(
+        CreateRegexSetExtension(options_.regex_max_program_size));
+  }
+
+  absl::StatusOr<std::unique_ptr<CelExpression>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    return builder_.CreateExpression(&parsed_expr_.expr(),
+                                     &parsed_expr_.source_info());
+  }
+
+  absl::StatusOr<CelValue> Evaluate(const CelExpression& plan,
+                                    absl::string_view input) {
+    Activation activation;
+    activation.InsertValue("input", CelValue::CreateStringView(input));
+    return plan.Evaluate(activation, &arena_);
+  }
+
+ protected:
+  exprpb::ParsedExpr parsed_expr_;
+  google::protobuf::Arena arena_;
+};
+
+TEST_F(RegexSetExtensionTest, Disjunction) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      Plan("input.matches('^a+$') || input.matches('b[0-9]') || "
+           "input.matches('c')"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  EXPECT_THAT(Evaluate(*plan, "aaa"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate(*plan, "xb1"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate(*plan, "aab"), IsOkAndHolds(test::IsCelBool(false)));
+}
+
+TEST_F(RegexSetExtensionTest, Exists) {
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      Plan("['^a+$', 'b[0-9]'].exists(p, input.matches(p))"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(2));
+  EXPECT_THAT(Evaluate(*plan, "aaa"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate(*plan, "xb1"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate(*plan, "aab"), IsOkAndHolds(test::IsCelBool(false)));
+}
+
+TEST_F(RegexSetExtensionTest, DifferentSubjectsNotOptimized) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("input.matches('a') || other.matches('b')"));
+
+  EXPECT_THAT(plan, Not(ExpressionPlanSizeIs(2)));
+}
+
+TEST_F(RegexSetExtensionTest, OtherTermsNotOptimized) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("input.matches('a') || input == 'b'"));
+
+  EXPECT_THAT(plan, Not(ExpressionPlanSizeIs(2)));
+  EXPECT_THAT(Evaluate(*plan, "b"), IsOkAndHolds(test::IsCelBool(true)));
+}
+
 }  // namespace
 }  // namespace google::api::expr::runtime
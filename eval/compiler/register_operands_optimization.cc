@@ -0,0 +1,140 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/register_operands_optimization.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "common/native_type.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/eval/compiler_constant_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/function_step.h"
+#include "eval/eval/ident_step.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "runtime/runtime_options.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using cel::NativeTypeId;
+using cel::ast_internal::AstImpl;
+using cel::ast_internal::Call;
+using cel::ast_internal::Expr;
+using cel::internal::down_cast;
+
+// Returns the operand for a subexpression planned as a single constant or
+// comprehension slot step, or nullopt if the argument needs to be evaluated.
+absl::optional<FunctionOperand> GetOperand(PlannerContext& context,
+                                           const Expr& expr) {
+  ExecutionPathView plan = context.GetSubplan(expr);
+  if (plan.size() != 1) {
+    return absl::nullopt;
+  }
+  const ExpressionStep& step = *plan[0];
+  if (step.GetNativeTypeId() == NativeTypeId::For<CompilerConstantStep>()) {
+    return FunctionOperand{
+        down_cast<const CompilerConstantStep&>(step).value()};
+  }
+  if (step.GetNativeTypeId() == NativeTypeId::For<SlotStep>()) {
+    const auto& slot_step = down_cast<const SlotStep&>(step);
+    return FunctionOperand{
+        FunctionOperand::Slot{slot_step.slot_index(), slot_step.name()}};
+  }
+  return absl::nullopt;
+}
+
+class RegisterOperandsOptimization : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    if (!node.has_call_expr()) {
+      return absl::OkStatus();
+    }
+    const Call& call_expr = node.call_expr();
+
+    std::vector<const Expr*> args;
+    args.reserve(call_expr.args().size() + 1);
+    if (call_expr.has_target()) {
+      args.push_back(&call_expr.target());
+    }
+    for (const Expr& arg : call_expr.args()) {
+      args.push_back(&arg);
+    }
+
+    // Expect exactly one step per argument followed by the call.
+    ExecutionPathView plan = context.GetSubplan(node);
+    if (plan.size() != args.size() + 1 || !IsEagerFunctionStep(*plan.back())) {
+      return absl::OkStatus();
+    }
+
+    std::vector<FunctionOperand> operands;
+    operands.reserve(args.size());
+    for (const Expr* arg : args) {
+      absl::optional<FunctionOperand> operand = GetOperand(context, *arg);
+      if (!operand.has_value()) {
+        return absl::OkStatus();
+      }
+      operands.push_back(std::move(operand).value());
+    }
+
+    CEL_ASSIGN_OR_RETURN(ExecutionPath subplan, context.ExtractSubplan(node));
+    ExecutionPath new_plan;
+    CEL_ASSIGN_OR_RETURN(new_plan.emplace_back(),
+                         CreateRegisterOperandFunctionStep(
+                             std::move(subplan.back()), std::move(operands)));
+
+    return context.ReplaceSubplan(node, std::move(new_plan));
+  }
+};
+
+// Optimizer used when the rewrite doesn't apply for the configured options.
+class NoopOptimization : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace
+
+ProgramOptimizerFactory CreateRegisterOperandsOptimizer() {
+  return [](PlannerContext& context, const AstImpl& ast)
+             -> absl::StatusOr<std::unique_ptr<ProgramOptimizer>> {
+    const cel::RuntimeOptions& options = context.options();
+    if (options.unknown_processing !=
+            cel::UnknownProcessingOptions::kDisabled ||
+        options.enable_missing_attribute_errors) {
+      return std::make_unique<NoopOptimization>();
+    }
+    return std::make_unique<RegisterOperandsOptimization>();
+  };
+}
+
+}  // namespace google::api::expr::runtime
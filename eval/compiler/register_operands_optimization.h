@@ -0,0 +1,33 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REGISTER_OPERANDS_OPTIMIZATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REGISTER_OPERANDS_OPTIMIZATION_H_
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new extension for the FlatExprBuilder that rewrites eagerly bound
+// function calls whose arguments are all constants or comprehension variables
+// into a single step that reads the arguments in place, instead of pushing
+// each argument to the value stack and popping them for the call.
+//
+// The rewrite is skipped when unknown processing or missing attribute errors
+// are enabled, since those require per-argument attribute tracking.
+ProgramOptimizerFactory CreateRegisterOperandsOptimizer();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_REGISTER_OPERANDS_OPTIMIZATION_H_
@@ -0,0 +1,128 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/register_operands_optimization.h"
+
+#include <memory>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+MATCHER_P(ExpressionPlanSizeIs, size, "") {
+  const std::unique_ptr<CelExpression>& plan = arg;
+
+  const CelExpressionFlatImpl* impl =
+      dynamic_cast<CelExpressionFlatImpl*>(plan.get());
+
+  if (impl == nullptr) return false;
+  *result_listener << "got size " << impl->flat_expression().path().size();
+  return impl->flat_expression().path().size() == size;
+}
+
+class RegisterOperandsOptimizationTest : public testing::Test {
+ public:
+  RegisterOperandsOptimizationTest() : builder_(ConvertToRuntimeOptions(options_)) {}
+
+  void SetUp() override {
+    ASSERT_OK(RegisterBuiltinFunctions(builder_.GetRegistry(), options_));
+    builder_.flat_expr_builder().AddProgramOptimizer(
+        CreateRegisterOperandsOptimizer());
+  }
+
+  absl::StatusOr<std::unique_ptr<CelExpression>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    return builder_.CreateExpression(&parsed_expr_.expr(),
+                                     &parsed_expr_.source_info());
+  }
+
+ protected:
+  InterpreterOptions options_;
+  CelExpressionBuilderFlatImpl builder_;
+  exprpb::ParsedExpr parsed_expr_;
+  google::protobuf::Arena arena_;
+};
+
+TEST_F(RegisterOperandsOptimizationTest, ConstantOperands) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan, Plan("1 + 2"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(1));
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelInt64(Eq(3)));
+}
+
+TEST_F(RegisterOperandsOptimizationTest, DoesNotOptimizeIdentOperand) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan, Plan("x + 2"));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(3));
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  EXPECT_THAT(result, test::IsCelInt64(Eq(3)));
+}
+
+TEST_F(RegisterOperandsOptimizationTest, ComprehensionVariableOperands) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<CelExpression> plan,
+                       Plan("[1, 2, 3].map(i, i * 2)"));
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(CelValue result, plan->Evaluate(activation, &arena_));
+  ASSERT_TRUE(result.IsList());
+  ASSERT_EQ(result.ListOrDie()->size(), 3);
+  EXPECT_THAT((*result.ListOrDie())[0], test::IsCelInt64(Eq(2)));
+  EXPECT_THAT((*result.ListOrDie())[2], test::IsCelInt64(Eq(6)));
+}
+
+TEST_F(RegisterOperandsOptimizationTest, DisabledWithUnknowns) {
+  InterpreterOptions options;
+  options.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+  CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options));
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry(), options));
+  builder.flat_expr_builder().AddProgramOptimizer(
+      CreateRegisterOperandsOptimizer());
+
+  ASSERT_OK_AND_ASSIGN(exprpb::ParsedExpr parsed_expr, Parse("1 + 2"));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CelExpression> plan,
+      builder.CreateExpression(&parsed_expr.expr(),
+                               &parsed_expr.source_info()));
+
+  EXPECT_THAT(plan, ExpressionPlanSizeIs(3));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -14,6 +14,7 @@
 
 #include "eval/compiler/resolver.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -22,6 +23,7 @@
 
 #include "absl/base/nullability.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -52,14 +54,14 @@ Resolver::Resolver(
         resolveable_enums,
     bool resolve_qualified_type_identifiers)
     : namespace_prefixes_(),
-      enum_value_map_(),
       function_registry_(function_registry),
       value_factory_(value_factory),
       resolveable_enums_(resolveable_enums),
       resolve_qualified_type_identifiers_(resolve_qualified_type_identifiers) {
   // The constructor for the registry determines the set of possible namespace
-  // prefixes which may appear within the given expression container, and also
-  // eagerly maps possible enum names to enum values.
+  // prefixes which may appear within the given expression container. Enum
+  // values are resolved when referenced, as most expressions reference few
+  // of the registered enums.
 
   auto container_elements = absl::StrSplit(container, '.');
   std::string prefix = "";
@@ -72,25 +74,34 @@ Resolver::Resolver(
     absl::StrAppend(&prefix, elem, ".");
     namespace_prefixes_.insert(namespace_prefixes_.begin(), prefix);
   }
+  max_prefix_size_ = prefix.size();
+}
 
+template <typename F>
+bool Resolver::ForEachQualifiedName(absl::string_view name, F f) const {
+  // Handle the case where the name contains a leading '.' indicating it is
+  // already fully-qualified.
+  if (absl::ConsumePrefix(&name, ".")) {
+    return f(name);
+  }
+  // namespace prefixes is guaranteed to contain at least empty string, so f
+  // is always called at least once.
+  std::string buffer;
+  buffer.reserve(max_prefix_size_ + name.size());
   for (const auto& prefix : namespace_prefixes_) {
-    for (auto iter = resolveable_enums_.begin();
-         iter != resolveable_enums_.end(); ++iter) {
-      absl::string_view enum_name = iter->first;
-      if (!absl::StartsWith(enum_name, prefix)) {
-        continue;
-      }
-
-      auto remainder = absl::StripPrefix(enum_name, prefix);
-      const auto& enum_type = iter->second;
-
-      for (const auto& enumerator : enum_type.enumerators) {
-        auto key = absl::StrCat(remainder, !remainder.empty() ? "." : "",
-                                enumerator.name);
-        enum_value_map_[key] = value_factory.CreateIntValue(enumerator.number);
+    if (prefix.empty()) {
+      if (f(name)) {
+        return true;
       }
+      continue;
+    }
+    buffer.assign(prefix);
+    buffer.append(name.data(), name.size());
+    if (f(absl::string_view(buffer))) {
+      return true;
     }
   }
+  return false;
 }
 
 std::vector<std::string> Resolver::FullyQualifiedNames(absl::string_view name,
@@ -99,31 +110,51 @@ std::vector<std::string> Resolver::FullyQualifiedNames(absl::string_view name,
   // and handle the case where this id is in the reference map as either a
   // function name or identifier name.
   std::vector<std::string> names;
-  // Handle the case where the name contains a leading '.' indicating it is
-  // already fully-qualified.
-  if (absl::StartsWith(name, ".")) {
-    std::string fully_qualified_name = std::string(name.substr(1));
-    names.push_back(fully_qualified_name);
-    return names;
-  }
-
-  // namespace prefixes is guaranteed to contain at least empty string, so this
-  // function will always produce at least one result.
-  for (const auto& prefix : namespace_prefixes_) {
-    std::string fully_qualified_name = absl::StrCat(prefix, name);
-    names.push_back(fully_qualified_name);
-  }
+  ForEachQualifiedName(name, [&](absl::string_view qualified_name) {
+    names.push_back(std::string(qualified_name));
+    return false;
+  });
   return names;
 }
 
 Handle<Value> Resolver::FindConstant(absl::string_view name,
                                      int64_t expr_id) const {
-  auto names = FullyQualifiedNames(name, expr_id);
-  for (const auto& name : names) {
+  // Planning looks up every identifier and select path, which repeat a lot
+  // within an expression.
+  if (auto it = constants_.find(name); it != constants_.end()) {
+    return it->second;
+  }
+  Handle<Value> constant = ResolveConstant(name);
+  constants_.insert({std::string(name), constant});
+  return constant;
+}
+
+absl::optional<int64_t> Resolver::FindEnumValue(
+    absl::string_view qualified_name) const {
+  size_t dot = qualified_name.rfind('.');
+  if (dot == absl::string_view::npos) {
+    return absl::nullopt;
+  }
+  auto enum_type = resolveable_enums_.find(qualified_name.substr(0, dot));
+  if (enum_type == resolveable_enums_.end()) {
+    return absl::nullopt;
+  }
+  absl::string_view enumerator_name = qualified_name.substr(dot + 1);
+  for (const auto& enumerator : enum_type->second.enumerators) {
+    if (enumerator.name == enumerator_name) {
+      return enumerator.number;
+    }
+  }
+  return absl::nullopt;
+}
+
+Handle<Value> Resolver::ResolveConstant(absl::string_view name) const {
+  Handle<Value> constant;
+  ForEachQualifiedName(name, [&](absl::string_view name) {
     // Attempt to resolve the fully qualified name to a known enum.
-    auto enum_entry = enum_value_map_.find(name);
-    if (enum_entry != enum_value_map_.end()) {
-      return enum_entry->second;
+    if (auto enum_value = FindEnumValue(name); enum_value.has_value()) {
+      constant = value_factory_.CreateIntValue(*enum_value);
+      return true;
     }
     // Conditionally resolve fully qualified names as type values if the option
     // to do so is configured in the expression builder. If the type name is
@@ -131,12 +162,13 @@ Handle<Value> Resolver::FindConstant(absl::string_view name,
     if (resolve_qualified_type_identifiers_ || !absl::StrContains(name, ".")) {
       auto type_value = value_factory_.type_manager().ResolveType(name);
       if (type_value.ok() && type_value->has_value()) {
-        return value_factory_.CreateTypeValue(**type_value);
+        constant = value_factory_.CreateTypeValue(**type_value);
+        return true;
       }
     }
-  }
-
-  return Handle<Value>();
+    return false;
+  });
+  return constant;
 }
 
 std::vector<cel::FunctionOverloadReference> Resolver::FindOverloads(
@@ -145,18 +177,15 @@ std::vector<cel::FunctionOverloadReference> Resolver::FindOverloads(
   // Resolve the fully qualified names and then search the function registry
   // for possible matches.
   std::vector<cel::FunctionOverloadReference> funcs;
-  auto names = FullyQualifiedNames(name, expr_id);
-  for (auto it = names.begin(); it != names.end(); it++) {
+  ForEachQualifiedName(name, [&](absl::string_view name) {
     // Only one set of overloads is returned along the namespace hierarchy as
     // the function name resolution follows the same behavior as variable name
     // resolution, meaning the most specific definition wins. This is different
     // from how C++ namespaces work, as they will accumulate the overload set
     // over the namespace hierarchy.
-    funcs = function_registry_.FindStaticOverloads(*it, receiver_style, types);
-    if (!funcs.empty()) {
-      return funcs;
-    }
-  }
+    funcs = function_registry_.FindStaticOverloads(name, receiver_style, types);
+    return !funcs.empty();
+  });
   return funcs;
 }
 
@@ -166,27 +195,44 @@ std::vector<cel::FunctionRegistry::LazyOverload> Resolver::FindLazyOverloads(
   // Resolve the fully qualified names and then search the function registry
   // for possible matches.
   std::vector<cel::FunctionRegistry::LazyOverload> funcs;
-  auto names = FullyQualifiedNames(name, expr_id);
-  for (const auto& name : names) {
+  ForEachQualifiedName(name, [&](absl::string_view name) {
     funcs = function_registry_.FindLazyOverloads(name, receiver_style, types);
-    if (!funcs.empty()) {
-      return funcs;
-    }
-  }
+    return !funcs.empty();
+  });
   return funcs;
 }
 
+bool Resolver::HasOverloads(absl::string_view name, bool receiver_style,
+                            size_t argument_count) const {
+  return ForEachQualifiedName(name, [&](absl::string_view name) {
+    return !function_registry_
+                .FindStaticOverloadsByArity(name, receiver_style,
+                                            argument_count)
+                .empty() ||
+           !function_registry_
+                .FindLazyOverloadsByArity(name, receiver_style, argument_count)
+                .empty();
+  });
+}
+
 absl::StatusOr<absl::optional<std::pair<std::string, cel::Handle<cel::Type>>>>
 Resolver::FindType(absl::string_view name, int64_t expr_id) const {
-  auto names = FullyQualifiedNames(name, expr_id);
-  for (auto& name : names) {
-    CEL_ASSIGN_OR_RETURN(auto maybe_type,
-                         value_factory_.type_manager().ResolveType(name));
-    if (maybe_type.has_value()) {
-      return std::make_pair(std::move(name), std::move(*maybe_type));
+  absl::Status status;
+  absl::optional<std::pair<std::string, cel::Handle<cel::Type>>> result;
+  ForEachQualifiedName(name, [&](absl::string_view name) {
+    auto maybe_type = value_factory_.type_manager().ResolveType(name);
+    if (!maybe_type.ok()) {
+      status = std::move(maybe_type).status();
+      return true;
     }
-  }
-  return absl::nullopt;
+    if (maybe_type->has_value()) {
+      result.emplace(std::string(name), std::move(**maybe_type));
+      return true;
+    }
+    return false;
+  });
+  CEL_RETURN_IF_ERROR(status);
+  return result;
 }
 
 }  // namespace google::api::expr::runtime
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_RESOLVER_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_RESOLVER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <utility>
@@ -42,6 +43,9 @@ namespace google::api::expr::runtime {
 //
 // TODO(issues/105): refactor the Resolver to consider CheckedExpr metadata
 // for reference resolution.
+//
+// Constant lookups are memoized, so a Resolver must not be used by several
+// threads at once. It is meant to live for the planning of one expression.
 class Resolver {
  public:
   Resolver(
@@ -89,14 +93,35 @@ class Resolver {
       absl::string_view name, bool receiver_style,
       const std::vector<cel::Kind>& types, int64_t expr_id = -1) const;
 
+  // HasOverloads returns true if FindOverloads or FindLazyOverloads would find
+  // an overload taking argument_count arguments of any kind. Unlike them, it
+  // does not copy the overloads found.
+  bool HasOverloads(absl::string_view name, bool receiver_style,
+                    size_t argument_count) const;
+
   // FullyQualifiedNames returns the set of fully qualified names which may be
   // derived from the base_name within the specified expression container.
   std::vector<std::string> FullyQualifiedNames(absl::string_view base_name,
                                                int64_t expr_id = -1) const;
 
  private:
+  // Calls f with each of the FullyQualifiedNames of name, most qualified
+  // first, until it returns true. Returns whether it did. Names are built in
+  // one buffer, and unqualified names are not copied.
+  template <typename F>
+  bool ForEachQualifiedName(absl::string_view name, F f) const;
+
+  cel::Handle<cel::Value> ResolveConstant(absl::string_view name) const;
+
+  // Returns the number of the enum value with the fully qualified name
+  // `qualified_name`, if one is registered.
+  absl::optional<int64_t> FindEnumValue(absl::string_view qualified_name) const;
+
   std::vector<std::string> namespace_prefixes_;
-  absl::flat_hash_map<std::string, cel::Handle<cel::Value>> enum_value_map_;
+  size_t max_prefix_size_ = 0;
+  // FindConstant results by name, including misses.
+  mutable absl::flat_hash_map<std::string, cel::Handle<cel::Value>>
+      constants_;
   const cel::FunctionRegistry& function_registry_;
   cel::ValueFactory& value_factory_;
   const absl::flat_hash_map<std::string, cel::TypeRegistry::Enumeration>&
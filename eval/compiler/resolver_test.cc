@@ -129,6 +129,40 @@ TEST_F(ResolverTest, TestFindConstantEnum) {
   EXPECT_THAT(enum_value.As<IntValue>()->NativeValue(), Eq(2L));
 }
 
+TEST_F(ResolverTest, TestFindConstantEnumInEnumContainer) {
+  CelFunctionRegistry func_registry;
+  type_registry_.Register(TestMessage::TestEnum_descriptor());
+
+  Resolver resolver("google.api.expr.runtime.TestMessage.TestEnum",
+                    func_registry.InternalGetRegistry(),
+                    type_registry_.InternalGetModernRegistry(), value_factory_,
+                    type_registry_.resolveable_enums());
+
+  auto enum_value = resolver.FindConstant("TEST_ENUM_2", -1);
+  ASSERT_TRUE(enum_value);
+  EXPECT_THAT(enum_value.As<IntValue>()->NativeValue(), Eq(2L));
+  EXPECT_FALSE(resolver.FindConstant("TestEnum", -1));
+  EXPECT_FALSE(resolver.FindConstant("TestEnum.", -1));
+}
+
+TEST_F(ResolverTest, TestFindConstantRepeated) {
+  CelFunctionRegistry func_registry;
+  type_registry_.Register(TestMessage::TestEnum_descriptor());
+
+  Resolver resolver("google.api.expr.runtime.TestMessage",
+                    func_registry.InternalGetRegistry(),
+                    type_registry_.InternalGetModernRegistry(), value_factory_,
+                    type_registry_.resolveable_enums());
+
+  for (int i = 0; i < 2; ++i) {
+    auto enum_value = resolver.FindConstant("TestEnum.TEST_ENUM_1", -1);
+    ASSERT_TRUE(enum_value);
+    EXPECT_THAT(enum_value.As<IntValue>()->NativeValue(), Eq(1L));
+
+    EXPECT_FALSE(resolver.FindConstant("TestEnum.UNKNOWN", -1));
+  }
+}
+
 TEST_F(ResolverTest, TestFindConstantUnqualifiedType) {
   CelFunctionRegistry func_registry;
   Resolver resolver("cel", func_registry.InternalGetRegistry(),
@@ -268,6 +302,25 @@ TEST_F(ResolverTest, TestFindLazyOverloads) {
   EXPECT_THAT(overloads.size(), Eq(1));
 }
 
+TEST_F(ResolverTest, TestHasOverloads) {
+  CelFunctionRegistry func_registry;
+  ASSERT_OK(
+      func_registry.Register(std::make_unique<FakeFunction>("fake_func")));
+  ASSERT_OK(func_registry.RegisterLazyFunction(
+      CelFunctionDescriptor{"cel.fake_lazy_func", false, {}}));
+
+  Resolver resolver("cel", func_registry.InternalGetRegistry(),
+                    type_registry_.InternalGetModernRegistry(), value_factory_,
+                    type_registry_.resolveable_enums());
+
+  EXPECT_TRUE(resolver.HasOverloads("fake_func", false, 0));
+  EXPECT_TRUE(resolver.HasOverloads("fake_lazy_func", false, 0));
+  EXPECT_TRUE(resolver.HasOverloads(".cel.fake_lazy_func", false, 0));
+  EXPECT_FALSE(resolver.HasOverloads(".fake_lazy_func", false, 0));
+  EXPECT_FALSE(resolver.HasOverloads("fake_func", true, 0));
+  EXPECT_FALSE(resolver.HasOverloads("fake_func", false, 1));
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
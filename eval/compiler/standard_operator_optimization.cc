@@ -0,0 +1,412 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/standard_operator_optimization.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/int_value.h"
+#include "base/values/string_value.h"
+#include "base/values/uint_value.h"
+#include "common/native_type.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/eval/compiler_constant_step.h"
+#include "eval/eval/const_value_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/function_step.h"
+#include "eval/eval/standard_operator_step.h"
+#include "eval/eval/string_match_step.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "internal/time.h"
+#include "runtime/internal/convert_constant.h"
+#include "runtime/internal/number_format.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using cel::ast_internal::AstImpl;
+using cel::ast_internal::Call;
+using cel::ast_internal::Expr;
+using cel::internal::down_cast;
+
+absl::optional<std::string> GetConstantString(PlannerContext& context,
+                                              const Expr& expr) {
+  if (expr.has_const_expr() && expr.const_expr().has_string_value()) {
+    return expr.const_expr().string_value();
+  }
+  ExecutionPathView plan = context.GetSubplan(expr);
+  if (plan.size() == 1 && plan[0]->GetNativeTypeId() ==
+                              cel::NativeTypeId::For<CompilerConstantStep>()) {
+    const auto& constant = down_cast<const CompilerConstantStep&>(*plan[0]);
+    if (constant.value()->Is<cel::StringValue>()) {
+      return constant.value()->As<cel::StringValue>().ToString();
+    }
+  }
+  return absl::nullopt;
+}
+
+// Returns the value of expr if it is an int, uint or double constant.
+absl::optional<cel::Handle<cel::Value>> GetConstantNumber(
+    PlannerContext& context, const Expr& expr) {
+  cel::Handle<cel::Value> value;
+  if (expr.has_const_expr()) {
+    absl::StatusOr<cel::Handle<cel::Value>> converted =
+        cel::runtime_internal::ConvertConstant(expr.const_expr(),
+                                               context.value_factory());
+    if (!converted.ok()) {
+      return absl::nullopt;
+    }
+    value = *std::move(converted);
+  } else {
+    ExecutionPathView plan = context.GetSubplan(expr);
+    if (plan.size() != 1 ||
+        plan[0]->GetNativeTypeId() !=
+            cel::NativeTypeId::For<CompilerConstantStep>()) {
+      return absl::nullopt;
+    }
+    value = down_cast<const CompilerConstantStep&>(*plan[0]).value();
+  }
+  if (value->Is<cel::IntValue>() || value->Is<cel::UintValue>() ||
+      value->Is<cel::DoubleValue>()) {
+    return value;
+  }
+  return absl::nullopt;
+}
+
+class StandardOperatorOptimization : public ProgramOptimizer {
+ public:
+  absl::Status OnPreVisit(PlannerContext& context, const Expr& node) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OnPostVisit(PlannerContext& context, const Expr& node) override {
+    if (!node.has_call_expr()) {
+      return absl::OkStatus();
+    }
+    const Call& call_expr = node.call_expr();
+    size_t num_args =
+        call_expr.args().size() + (call_expr.has_target() ? 1 : 0);
+    if (absl::optional<StringMatchKind> kind =
+            GetStringMatchKind(call_expr.function());
+        kind.has_value() && num_args == 2) {
+      return LowerStringMatch(context, node, *kind);
+    }
+    if ((call_expr.function() == cel::builtin::kTimestamp ||
+         call_expr.function() == cel::builtin::kDuration) &&
+        num_args == 1 && !call_expr.has_target()) {
+      return FoldTimeConversion(context, node);
+    }
+    if ((call_expr.function() == cel::builtin::kString ||
+         call_expr.function() == cel::builtin::kInt ||
+         call_expr.function() == cel::builtin::kUint ||
+         call_expr.function() == cel::builtin::kDouble) &&
+        num_args == 1 && !call_expr.has_target()) {
+      return FoldNumberConversion(context, node);
+    }
+    absl::optional<StandardOperator> op =
+        GetStandardOperator(call_expr.function(), num_args);
+    if (!op.has_value()) {
+      return absl::OkStatus();
+    }
+    // Lazily bound calls may resolve to different overloads per activation.
+    ExecutionPathView plan = context.GetSubplan(node);
+    if (plan.empty() || !IsEagerFunctionStep(*plan.back())) {
+      return absl::OkStatus();
+    }
+
+    std::vector<cel::Kind> kinds;
+    for (cel::Kind kind : StandardOperatorKinds(*op)) {
+      std::vector<std::vector<cel::Kind>> overloads =
+          StandardOperatorOverloads(*op, kind);
+      if (absl::c_all_of(overloads, [&](const std::vector<cel::Kind>& args) {
+            return !context.resolver()
+                        .FindOverloads(call_expr.function(),
+                                       call_expr.has_target(), args, node.id())
+                        .empty();
+          })) {
+        kinds.push_back(kind);
+      }
+    }
+    bool mixed_numeric = HasMixedNumericOverloads(context, call_expr, *op,
+                                                  node.id());
+    if (kinds.empty() && !mixed_numeric) {
+      return absl::OkStatus();
+    }
+
+    // The size of the plan of a string concatenation on the left, which is
+    // merged into this call.
+    size_t lhs_chain_size = 0;
+    if (*op == StandardOperator::kAdd && !call_expr.has_target()) {
+      ExecutionPathView lhs_plan = context.GetSubplan(call_expr.args()[0]);
+      if (!lhs_plan.empty() && IsStringAddStep(*lhs_plan.back())) {
+        lhs_chain_size = lhs_plan.size();
+      }
+    }
+
+    CEL_ASSIGN_OR_RETURN(ExecutionPath subplan, context.ExtractSubplan(node));
+    std::unique_ptr<const ExpressionStep> function_step =
+        std::move(subplan.back());
+    CEL_ASSIGN_OR_RETURN(
+        subplan.back(),
+        CreateStandardOperatorStep(*op, kinds, mixed_numeric,
+                                   std::move(function_step), node.id()));
+    if (lhs_chain_size != 0 && IsStringAddStep(*subplan.back())) {
+      return FlattenStringConcat(context, node, std::move(subplan),
+                                 lhs_chain_size);
+    }
+    return context.ReplaceSubplan(node, std::move(subplan));
+  }
+
+ private:
+  // Returns true if op is a comparison with an overload for every pair of
+  // different numeric kinds, i.e. the heterogeneous comparison overloads or
+  // the generic heterogeneous equality overload are registered.
+  static bool HasMixedNumericOverloads(PlannerContext& context,
+                                       const Call& call_expr,
+                                       StandardOperator op, int64_t expr_id) {
+    switch (op) {
+      case StandardOperator::kLess:
+      case StandardOperator::kLessOrEqual:
+      case StandardOperator::kGreater:
+      case StandardOperator::kGreaterOrEqual:
+      case StandardOperator::kEqual:
+      case StandardOperator::kInequal:
+        break;
+      default:
+        return false;
+    }
+    constexpr cel::Kind kNumericKinds[] = {cel::Kind::kInt, cel::Kind::kUint,
+                                           cel::Kind::kDouble};
+    for (cel::Kind lhs : kNumericKinds) {
+      for (cel::Kind rhs : kNumericKinds) {
+        if (lhs != rhs &&
+            context.resolver()
+                .FindOverloads(call_expr.function(), call_expr.has_target(),
+                               {lhs, rhs}, expr_id)
+                .empty()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Plans `a + b + c` as a single step concatenating the values of a, b and c.
+  // subplan is the plan of the outer call, starting with the lhs_chain_size
+  // steps of the inner one.
+  static absl::Status FlattenStringConcat(PlannerContext& context,
+                                          const Expr& node,
+                                          ExecutionPath subplan,
+                                          size_t lhs_chain_size) {
+    std::unique_ptr<const ExpressionStep> lhs_step =
+        std::move(subplan[lhs_chain_size - 1]);
+    std::unique_ptr<const ExpressionStep> add_step = std::move(subplan.back());
+    subplan.pop_back();
+    subplan.erase(subplan.begin() + (lhs_chain_size - 1));
+    CEL_ASSIGN_OR_RETURN(
+        subplan.emplace_back(),
+        CreateStringConcatStep(std::move(lhs_step), std::move(add_step),
+                               node.id()));
+    return context.ReplaceSubplan(node, std::move(subplan));
+  }
+
+  // Plans `startsWith`, `endsWith` and `contains` calls with a constant
+  // argument as a comparison against that literal.
+  absl::Status LowerStringMatch(PlannerContext& context, const Expr& node,
+                                StringMatchKind kind) {
+    const Call& call_expr = node.call_expr();
+    ExecutionPathView plan = context.GetSubplan(node);
+    if (plan.empty() || !IsEagerFunctionStep(*plan.back())) {
+      return absl::OkStatus();
+    }
+    absl::optional<std::string> literal =
+        GetConstantString(context, call_expr.args().back());
+    if (!literal.has_value()) {
+      return absl::OkStatus();
+    }
+    if (context.resolver()
+            .FindOverloads(call_expr.function(), call_expr.has_target(),
+                           {cel::Kind::kString, cel::Kind::kString}, node.id())
+            .empty()) {
+      return absl::OkStatus();
+    }
+
+    CEL_ASSIGN_OR_RETURN(ExecutionPath subplan, context.ExtractSubplan(node));
+    std::unique_ptr<const ExpressionStep> function_step =
+        std::move(subplan.back());
+    CEL_ASSIGN_OR_RETURN(
+        subplan.back(),
+        CreateStringMatchStep(kind, std::move(literal).value(),
+                              std::move(function_step), node.id()));
+    return context.ReplaceSubplan(node, std::move(subplan));
+  }
+
+  // Plans `timestamp` and `duration` conversions of a constant string as the
+  // converted constant, independently of the general constant folding option.
+  // Inputs that fail to convert are left to report the error at runtime.
+  absl::Status FoldTimeConversion(PlannerContext& context, const Expr& node) {
+    const Call& call_expr = node.call_expr();
+    ExecutionPathView plan = context.GetSubplan(node);
+    if (plan.empty() || !IsEagerFunctionStep(*plan.back())) {
+      return absl::OkStatus();
+    }
+    absl::optional<std::string> literal =
+        GetConstantString(context, call_expr.args().front());
+    if (!literal.has_value()) {
+      return absl::OkStatus();
+    }
+    if (context.resolver()
+            .FindOverloads(call_expr.function(), /*receiver_style=*/false,
+                           {cel::Kind::kString}, node.id())
+            .empty()) {
+      return absl::OkStatus();
+    }
+
+    cel::ValueFactory& value_factory = context.value_factory();
+    cel::Handle<cel::Value> value;
+    if (call_expr.function() == cel::builtin::kTimestamp) {
+      absl::Time timestamp;
+      if (!cel::internal::ParseRfc3339Time(*literal, &timestamp,
+                                           /*err=*/nullptr)) {
+        return absl::OkStatus();
+      }
+      if (context.options().enable_timestamp_duration_overflow_errors &&
+          !cel::internal::ValidateTimestamp(timestamp).ok()) {
+        return absl::OkStatus();
+      }
+      value = value_factory.CreateUncheckedTimestampValue(timestamp);
+    } else {
+      absl::Duration duration;
+      if (!absl::ParseDuration(*literal, &duration)) {
+        return absl::OkStatus();
+      }
+      absl::StatusOr<cel::Handle<cel::DurationValue>> duration_value =
+          value_factory.CreateDurationValue(duration);
+      if (!duration_value.ok()) {
+        return absl::OkStatus();
+      }
+      value = *std::move(duration_value);
+    }
+
+    ExecutionPath folded;
+    CEL_ASSIGN_OR_RETURN(folded.emplace_back(),
+                         CreateConstValueStep(std::move(value), node.id()));
+    return context.ReplaceSubplan(node, std::move(folded));
+  }
+
+  // Plans `string` conversions of a constant number, and `int`, `uint` and
+  // `double` conversions of a constant string, as the converted constant. As
+  // for FoldTimeConversion, inputs that fail to convert are left to report the
+  // error at runtime.
+  absl::Status FoldNumberConversion(PlannerContext& context, const Expr& node) {
+    const Call& call_expr = node.call_expr();
+    ExecutionPathView plan = context.GetSubplan(node);
+    if (plan.empty() || !IsEagerFunctionStep(*plan.back())) {
+      return absl::OkStatus();
+    }
+
+    cel::ValueFactory& value_factory = context.value_factory();
+    const Expr& arg = call_expr.args().front();
+    cel::Kind arg_kind;
+    cel::Handle<cel::Value> value;
+    if (call_expr.function() == cel::builtin::kString) {
+      absl::optional<cel::Handle<cel::Value>> number =
+          GetConstantNumber(context, arg);
+      if (!number.has_value()) {
+        return absl::OkStatus();
+      }
+      if ((*number)->Is<cel::IntValue>()) {
+        arg_kind = cel::Kind::kInt;
+        value = cel::runtime_internal::FormatNumber(
+            value_factory, (*number)->As<cel::IntValue>().NativeValue());
+      } else if ((*number)->Is<cel::UintValue>()) {
+        arg_kind = cel::Kind::kUint;
+        value = cel::runtime_internal::FormatNumber(
+            value_factory, (*number)->As<cel::UintValue>().NativeValue());
+      } else {
+        arg_kind = cel::Kind::kDouble;
+        value = cel::runtime_internal::FormatNumber(
+            value_factory, (*number)->As<cel::DoubleValue>().NativeValue());
+      }
+    } else {
+      absl::optional<std::string> literal = GetConstantString(context, arg);
+      if (!literal.has_value()) {
+        return absl::OkStatus();
+      }
+      arg_kind = cel::Kind::kString;
+      if (call_expr.function() == cel::builtin::kInt) {
+        int64_t result;
+        if (!absl::SimpleAtoi(*literal, &result)) {
+          return absl::OkStatus();
+        }
+        value = value_factory.CreateIntValue(result);
+      } else if (call_expr.function() == cel::builtin::kUint) {
+        uint64_t result;
+        if (!absl::SimpleAtoi(*literal, &result)) {
+          return absl::OkStatus();
+        }
+        value = value_factory.CreateUintValue(result);
+      } else {
+        double result;
+        if (!absl::SimpleAtod(*literal, &result)) {
+          return absl::OkStatus();
+        }
+        value = value_factory.CreateDoubleValue(result);
+      }
+    }
+    if (context.resolver()
+            .FindOverloads(call_expr.function(), /*receiver_style=*/false,
+                           {arg_kind}, node.id())
+            .empty()) {
+      return absl::OkStatus();
+    }
+
+    ExecutionPath folded;
+    CEL_ASSIGN_OR_RETURN(folded.emplace_back(),
+                         CreateConstValueStep(std::move(value), node.id()));
+    return context.ReplaceSubplan(node, std::move(folded));
+  }
+};
+
+}  // namespace
+
+ProgramOptimizerFactory CreateStandardOperatorOptimizer() {
+  return [](PlannerContext& context, const AstImpl& ast)
+             -> absl::StatusOr<std::unique_ptr<ProgramOptimizer>> {
+    return std::make_unique<StandardOperatorOptimization>();
+  };
+}
+
+}  // namespace google::api::expr::runtime
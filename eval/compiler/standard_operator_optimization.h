@@ -0,0 +1,46 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_STANDARD_OPERATOR_OPTIMIZATION_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_STANDARD_OPERATOR_OPTIMIZATION_H_
+
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Create a new extension for the FlatExprBuilder that replaces eagerly bound
+// calls to standard operators (`_+_`, `_<_`, `_==_`, `!_`, `size`, ...) with
+// type-specialized steps (see eval/eval/standard_operator_step.h).
+//
+// A fast path is planned for each argument kind the operator has a registered
+// overload for. Calls with mixed, error or unknown arguments fall back to the
+// original function step. `_[_]` already has a dedicated step and is not
+// affected.
+//
+// Calls to `startsWith`, `endsWith` and `contains` with a constant string
+// argument are likewise planned as a comparison against that literal (see
+// eval/eval/string_match_step.h).
+//
+// `timestamp()` and `duration()` conversions of a constant string are parsed
+// while planning and replaced with the resulting constant. Strings which fail
+// to parse are left to report their error at evaluation time.
+//
+// Likewise, `string()` conversions of a constant number and `int()`, `uint()`
+// and `double()` conversions of a constant string are planned as the
+// converted constant.
+ProgramOptimizerFactory CreateStandardOperatorOptimizer();
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_STANDARD_OPERATOR_OPTIMIZATION_H_
@@ -0,0 +1,290 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/standard_operator_optimization.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_list_impl.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::internal::IsOkAndHolds;
+using ::cel::internal::StatusIs;
+using ::google::api::expr::parser::Parse;
+using testing::Eq;
+using testing::HasSubstr;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+constexpr absl::Time kTime = absl::FromUnixSeconds(1700000000);
+
+class StandardOperatorOptimizationTest : public testing::Test {
+ public:
+  void SetUp() override {
+    activation_.InsertValue("i", CelValue::CreateInt64(
+                                     std::numeric_limits<int64_t>::max()));
+    activation_.InsertValue("u", CelValue::CreateUint64(7));
+    activation_.InsertValue("d", CelValue::CreateDouble(0.5));
+    activation_.InsertValue("s", CelValue::CreateStringView("ab"));
+    activation_.InsertValue("l", CelValue::CreateList(&list_));
+    activation_.InsertValue("t", CelValue::CreateTimestamp(kTime));
+    activation_.InsertValue("p", CelValue::CreateDuration(absl::Hours(1)));
+  }
+
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr) {
+    if (builder_ == nullptr) {
+      builder_ = std::make_unique<CelExpressionBuilderFlatImpl>(
+          ConvertToRuntimeOptions(options_));
+      CEL_RETURN_IF_ERROR(
+          RegisterBuiltinFunctions(builder_->GetRegistry(), options_));
+      builder_->flat_expr_builder().AddProgramOptimizer(
+          CreateStandardOperatorOptimizer());
+    }
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(
+        plan_, builder_->CreateExpression(&parsed_expr_.expr(),
+                                          &parsed_expr_.source_info()));
+    return plan_->Evaluate(activation_, &arena_);
+  }
+
+  // Returns the plan of the last evaluated expression.
+  const ExecutionPath& PlanPath() const {
+    return dynamic_cast<const CelExpressionFlatImpl&>(*plan_)
+        .flat_expression()
+        .path();
+  }
+
+ protected:
+  InterpreterOptions options_;
+  std::unique_ptr<CelExpressionBuilderFlatImpl> builder_;
+  exprpb::ParsedExpr parsed_expr_;
+  std::unique_ptr<CelExpression> plan_;
+  ContainerBackedListImpl list_{std::vector<CelValue>{
+      CelValue::CreateInt64(1), CelValue::CreateInt64(2)}};
+  Activation activation_;
+  google::protobuf::Arena arena_;
+};
+
+TEST_F(StandardOperatorOptimizationTest, Arithmetic) {
+  EXPECT_THAT(Evaluate("(i - 10) / 2 % 3 * -1"),
+              IsOkAndHolds(test::IsCelInt64(-1)));
+  EXPECT_THAT(Evaluate("u * 2u - 4u"), IsOkAndHolds(test::IsCelUint64(10)));
+  EXPECT_THAT(Evaluate("d / 0.0 > d"), IsOkAndHolds(test::IsCelBool(true)));
+}
+
+TEST_F(StandardOperatorOptimizationTest, ArithmeticErrors) {
+  EXPECT_THAT(Evaluate("i + 1"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kOutOfRange))));
+  EXPECT_THAT(Evaluate("u - 8u"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kOutOfRange))));
+  EXPECT_THAT(Evaluate("u / 0u"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kInvalidArgument))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, StringsAndContainers) {
+  EXPECT_THAT(Evaluate("s + 'c'"), IsOkAndHolds(test::IsCelString(Eq("abc"))));
+  EXPECT_THAT(Evaluate("s < 'b' && s != 'a' && !(s == 'b')"),
+              IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate("size(s) + s.size() + size(l) + size({1: 2})"),
+              IsOkAndHolds(test::IsCelInt64(7)));
+}
+
+TEST_F(StandardOperatorOptimizationTest, StringConcatChains) {
+  // Sizes the value stack for the operands of the flattened chains.
+  options_.enable_standard_operator_steps = true;
+
+  EXPECT_THAT(Evaluate("s + '-' + s + '-' + s"),
+              IsOkAndHolds(test::IsCelString(Eq("ab-ab-ab"))));
+  const auto& impl = dynamic_cast<const CelExpressionFlatImpl&>(*plan_);
+  EXPECT_THAT(impl.flat_expression().path(), testing::SizeIs(6));
+  EXPECT_EQ(impl.flat_expression().value_stack_size(), 5);
+
+  EXPECT_THAT(Evaluate("s + (s + s) + s"),
+              IsOkAndHolds(test::IsCelString(Eq("abababab"))));
+
+  // Other operands are combined by the overloads of each call in turn.
+  EXPECT_THAT(Evaluate("s + s + i"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+  EXPECT_THAT(Evaluate("s + i + s"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+  EXPECT_THAT(Evaluate("l + [3] + [4]"),
+              IsOkAndHolds(test::IsCelList(testing::SizeIs(4))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, ConstantSubstrings) {
+  EXPECT_THAT(Evaluate("s.startsWith('a') && s.endsWith('b') && "
+                       "s.contains('ab') && !s.contains('ba')"),
+              IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate("startsWith(s, 'b') || endsWith(s, 'a')"),
+              IsOkAndHolds(test::IsCelBool(false)));
+  EXPECT_THAT(Evaluate("s.contains(s)"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate("i.startsWith('a')"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, ConstantTimeConversions) {
+  EXPECT_THAT(Evaluate("timestamp('2023-05-06T07:08:09.5+01:00')"),
+              IsOkAndHolds(test::IsCelTimestamp(
+                  absl::FromUnixSeconds(1683353289) +
+                  absl::Milliseconds(500))));
+  EXPECT_THAT(dynamic_cast<const CelExpressionFlatImpl&>(*plan_)
+                  .flat_expression()
+                  .path(),
+              testing::SizeIs(1));
+
+  EXPECT_THAT(Evaluate("duration('1h30m')"),
+              IsOkAndHolds(test::IsCelDuration(absl::Minutes(90))));
+  EXPECT_THAT(dynamic_cast<const CelExpressionFlatImpl&>(*plan_)
+                  .flat_expression()
+                  .path(),
+              testing::SizeIs(1));
+
+  // Invalid inputs report the error at evaluation.
+  EXPECT_THAT(Evaluate("timestamp('2023-02-29T00:00:00Z')"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("conversion failed")))));
+  EXPECT_THAT(Evaluate("duration('1x')"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("conversion failed")))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, ConstantNumberConversions) {
+  EXPECT_THAT(Evaluate("string(-123)"),
+              IsOkAndHolds(test::IsCelString("-123")));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+  EXPECT_THAT(Evaluate("string(18446744073709551615u)"),
+              IsOkAndHolds(test::IsCelString("18446744073709551615")));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+  EXPECT_THAT(Evaluate("string(1.5)"), IsOkAndHolds(test::IsCelString("1.5")));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+  EXPECT_THAT(Evaluate("int('-42')"), IsOkAndHolds(test::IsCelInt64(-42)));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+  EXPECT_THAT(Evaluate("uint('42')"), IsOkAndHolds(test::IsCelUint64(42)));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+  EXPECT_THAT(Evaluate("double('2.5e3')"),
+              IsOkAndHolds(test::IsCelDouble(2500.0)));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(1));
+
+  // Invalid inputs report the error at evaluation.
+  EXPECT_THAT(Evaluate("int('x')"),
+              IsOkAndHolds(test::IsCelError(StatusIs(testing::_))));
+  EXPECT_THAT(Evaluate("uint('-1')"),
+              IsOkAndHolds(test::IsCelError(StatusIs(testing::_))));
+  EXPECT_THAT(Evaluate("double('')"),
+              IsOkAndHolds(test::IsCelError(StatusIs(testing::_))));
+
+  // Arguments that are not constant are converted at evaluation.
+  EXPECT_THAT(Evaluate("string(u)"), IsOkAndHolds(test::IsCelString("7")));
+  EXPECT_THAT(PlanPath(), testing::SizeIs(2));
+}
+
+TEST_F(StandardOperatorOptimizationTest, MixedArgumentsUseOverloads) {
+  EXPECT_THAT(Evaluate("[1] + l"),
+              IsOkAndHolds(test::IsCelList(testing::SizeIs(3))));
+  EXPECT_THAT(Evaluate("u == 7"), IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate("d + 1"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, MixedNumericComparisons) {
+  EXPECT_THAT(Evaluate("u < 7.5 && u >= 7 && d < u && i > d && 7.0 == u && "
+                       "i != d && i > 18446744073709551615.0 == false && "
+                       "u <= 7 && 8 > u && -1 < u && d != 0"),
+              IsOkAndHolds(test::IsCelBool(true)));
+  EXPECT_THAT(Evaluate("d / 0.0 > u && -d / 0.0 < i"),
+              IsOkAndHolds(test::IsCelBool(true)));
+  // NaN is unordered and unequal.
+  EXPECT_THAT(Evaluate("0.0 / 0.0 < u || 0.0 / 0.0 >= u || 0.0 / 0.0 == 1"),
+              IsOkAndHolds(test::IsCelBool(false)));
+  EXPECT_THAT(Evaluate("0.0 / 0.0 != 1"), IsOkAndHolds(test::IsCelBool(true)));
+}
+
+TEST_F(StandardOperatorOptimizationTest, MixedNumericRequiresOverloads) {
+  options_.enable_heterogeneous_equality = false;
+
+  EXPECT_THAT(Evaluate("u < 7.5"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+  EXPECT_THAT(Evaluate("u < 8u"), IsOkAndHolds(test::IsCelBool(true)));
+}
+
+TEST_F(StandardOperatorOptimizationTest, TimeArithmetic) {
+  EXPECT_THAT(Evaluate("t - duration('24h')"),
+              IsOkAndHolds(test::IsCelTimestamp(kTime - absl::Hours(24))));
+  EXPECT_THAT(Evaluate("t - duration('24h') < t && t + p > t && p + t == t + p "
+                       "&& t - t == duration('0s') && p - p < p && "
+                       "p + p == duration('2h') && p >= duration('60m')"),
+              IsOkAndHolds(test::IsCelBool(true)));
+
+  // Combinations without a standard overload are passed on.
+  EXPECT_THAT(Evaluate("t + t"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+  EXPECT_THAT(Evaluate("p - t"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, TimeArithmeticErrors) {
+  options_.enable_timestamp_duration_overflow_errors = true;
+
+  EXPECT_THAT(Evaluate("t + duration('87600000h')"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kOutOfRange))));
+  EXPECT_THAT(Evaluate("t - timestamp('0001-01-01T00:00:00Z')"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kOutOfRange))));
+  EXPECT_THAT(Evaluate("t - duration('24h')"),
+              IsOkAndHolds(test::IsCelTimestamp(kTime - absl::Hours(24))));
+}
+
+TEST_F(StandardOperatorOptimizationTest, OnlyRegisteredKinds) {
+  options_.enable_string_concat = false;
+
+  EXPECT_THAT(Evaluate("s + 'c'"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(testing::_, HasSubstr("No matching")))));
+  EXPECT_THAT(Evaluate("1 + 2"), IsOkAndHolds(test::IsCelInt64(3)));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
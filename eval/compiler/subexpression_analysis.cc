@@ -0,0 +1,293 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/subexpression_analysis.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/kind.h"
+#include "eval/compiler/resolver.h"
+#include "runtime/function_overload_reference.h"
+#include "runtime/function_registry.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Comprehension;
+using ::cel::ast_internal::CreateStruct;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Reference;
+using ::cel::ast_internal::Select;
+
+bool ReferencesEqual(const AstImpl& ast, const Expr& lhs, const Expr& rhs) {
+  const Reference* lhs_reference = ast.GetReference(lhs.id());
+  const Reference* rhs_reference = ast.GetReference(rhs.id());
+  if (lhs_reference == nullptr || rhs_reference == nullptr) {
+    return lhs_reference == rhs_reference;
+  }
+  return *lhs_reference == *rhs_reference;
+}
+
+bool ElementsEqual(const AstImpl& ast, const std::vector<Expr>& lhs,
+                   const std::vector<Expr>& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (!StructurallyEqual(ast, lhs[i], rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void ForEachChild(Expr& expr, absl::FunctionRef<void(Expr&)> f) {
+  if (expr.has_select_expr()) {
+    Select& select = expr.mutable_select_expr();
+    if (select.has_operand()) {
+      f(select.mutable_operand());
+    }
+  } else if (expr.has_call_expr()) {
+    Call& call = expr.mutable_call_expr();
+    if (call.has_target()) {
+      f(call.mutable_target());
+    }
+    for (Expr& arg : call.mutable_args()) {
+      f(arg);
+    }
+  } else if (expr.has_list_expr()) {
+    for (Expr& element : expr.mutable_list_expr().mutable_elements()) {
+      f(element);
+    }
+  } else if (expr.has_struct_expr()) {
+    for (CreateStruct::Entry& entry :
+         expr.mutable_struct_expr().mutable_entries()) {
+      if (entry.has_map_key()) {
+        f(entry.mutable_map_key());
+      }
+      if (entry.has_value()) {
+        f(entry.mutable_value());
+      }
+    }
+  } else if (expr.has_comprehension_expr()) {
+    Comprehension& comprehension = expr.mutable_comprehension_expr();
+    if (comprehension.has_iter_range()) {
+      f(comprehension.mutable_iter_range());
+    }
+    if (comprehension.has_accu_init()) {
+      f(comprehension.mutable_accu_init());
+    }
+    if (comprehension.has_loop_condition()) {
+      f(comprehension.mutable_loop_condition());
+    }
+    if (comprehension.has_loop_step()) {
+      f(comprehension.mutable_loop_step());
+    }
+    if (comprehension.has_result()) {
+      f(comprehension.mutable_result());
+    }
+  }
+}
+
+void ForEachChild(const Expr& expr, absl::FunctionRef<void(const Expr&)> f) {
+  // The mutable overload only reads children that are present, so it doesn't
+  // modify expr.
+  ForEachChild(const_cast<Expr&>(expr), [&f](Expr& child) { f(child); });
+}
+
+bool IsPureBuiltin(absl::string_view function) {
+  static const auto* const kPureBuiltins =
+      new absl::flat_hash_set<absl::string_view>({
+          cel::builtin::kEqual,
+          cel::builtin::kInequal,
+          cel::builtin::kLess,
+          cel::builtin::kLessOrEqual,
+          cel::builtin::kGreater,
+          cel::builtin::kGreaterOrEqual,
+          cel::builtin::kAnd,
+          cel::builtin::kOr,
+          cel::builtin::kNot,
+          cel::builtin::kAdd,
+          cel::builtin::kSubtract,
+          cel::builtin::kNeg,
+          cel::builtin::kMultiply,
+          cel::builtin::kDivide,
+          cel::builtin::kModulo,
+          cel::builtin::kRegexMatch,
+          cel::builtin::kStringContains,
+          cel::builtin::kStringEndsWith,
+          cel::builtin::kStringStartsWith,
+          cel::builtin::kIn,
+          cel::builtin::kInDeprecated,
+          cel::builtin::kInFunction,
+          cel::builtin::kIndex,
+          cel::builtin::kSize,
+          cel::builtin::kTernary,
+          cel::builtin::kDuration,
+          cel::builtin::kTimestamp,
+          cel::builtin::kFullYear,
+          cel::builtin::kMonth,
+          cel::builtin::kDayOfYear,
+          cel::builtin::kDayOfMonth,
+          cel::builtin::kDate,
+          cel::builtin::kDayOfWeek,
+          cel::builtin::kHours,
+          cel::builtin::kMinutes,
+          cel::builtin::kSeconds,
+          cel::builtin::kMilliseconds,
+          cel::builtin::kBytes,
+          cel::builtin::kDouble,
+          cel::builtin::kDyn,
+          cel::builtin::kInt,
+          cel::builtin::kString,
+          cel::builtin::kType,
+          cel::builtin::kUint,
+      });
+  return kPureBuiltins->contains(function);
+}
+
+bool IsPureCall(const Resolver& resolver, const Expr& expr) {
+  const Call& call = expr.call_expr();
+  if (IsPureBuiltin(call.function())) {
+    return true;
+  }
+  bool receiver_style = call.has_target();
+  std::vector<cel::Kind> arguments(
+      call.args().size() + (receiver_style ? 1 : 0), cel::Kind::kAny);
+  std::vector<cel::FunctionOverloadReference> overloads =
+      resolver.FindOverloads(call.function(), receiver_style, arguments,
+                             expr.id());
+  std::vector<cel::FunctionRegistry::LazyOverload> lazy_overloads =
+      resolver.FindLazyOverloads(call.function(), receiver_style, arguments,
+                                 expr.id());
+  if (overloads.empty() && lazy_overloads.empty()) {
+    return false;
+  }
+  return absl::c_all_of(overloads,
+                        [](const cel::FunctionOverloadReference& overload) {
+                          return overload.descriptor.is_pure();
+                        }) &&
+         absl::c_all_of(
+             lazy_overloads,
+             [](const cel::FunctionRegistry::LazyOverload& overload) {
+               return overload.descriptor.is_pure();
+             });
+}
+
+bool StructurallyEqual(const AstImpl& ast, const Expr& lhs, const Expr& rhs) {
+  if (lhs.expr_kind().index() != rhs.expr_kind().index() ||
+      !ReferencesEqual(ast, lhs, rhs)) {
+    return false;
+  }
+  if (lhs.has_const_expr()) {
+    return lhs.const_expr() == rhs.const_expr();
+  }
+  if (lhs.has_ident_expr()) {
+    return lhs.ident_expr().name() == rhs.ident_expr().name();
+  }
+  if (lhs.has_select_expr()) {
+    const Select& lhs_select = lhs.select_expr();
+    const Select& rhs_select = rhs.select_expr();
+    return lhs_select.field() == rhs_select.field() &&
+           lhs_select.test_only() == rhs_select.test_only() &&
+           StructurallyEqual(ast, lhs_select.operand(), rhs_select.operand());
+  }
+  if (lhs.has_call_expr()) {
+    const Call& lhs_call = lhs.call_expr();
+    const Call& rhs_call = rhs.call_expr();
+    if (lhs_call.function() != rhs_call.function() ||
+        lhs_call.has_target() != rhs_call.has_target() ||
+        (lhs_call.has_target() &&
+         !StructurallyEqual(ast, lhs_call.target(), rhs_call.target()))) {
+      return false;
+    }
+    return ElementsEqual(ast, lhs_call.args(), rhs_call.args());
+  }
+  if (lhs.has_list_expr()) {
+    return lhs.list_expr().optional_indices() ==
+               rhs.list_expr().optional_indices() &&
+           ElementsEqual(ast, lhs.list_expr().elements(),
+                         rhs.list_expr().elements());
+  }
+  if (lhs.has_struct_expr()) {
+    const CreateStruct& lhs_struct = lhs.struct_expr();
+    const CreateStruct& rhs_struct = rhs.struct_expr();
+    if (lhs_struct.message_name() != rhs_struct.message_name() ||
+        lhs_struct.entries().size() != rhs_struct.entries().size()) {
+      return false;
+    }
+    for (size_t i = 0; i < lhs_struct.entries().size(); ++i) {
+      const CreateStruct::Entry& lhs_entry = lhs_struct.entries()[i];
+      const CreateStruct::Entry& rhs_entry = rhs_struct.entries()[i];
+      if (lhs_entry.optional_entry() != rhs_entry.optional_entry() ||
+          lhs_entry.has_field_key() != rhs_entry.has_field_key() ||
+          lhs_entry.has_map_key() != rhs_entry.has_map_key() ||
+          lhs_entry.has_value() != rhs_entry.has_value()) {
+        return false;
+      }
+      if ((lhs_entry.has_field_key() &&
+           lhs_entry.field_key() != rhs_entry.field_key()) ||
+          (lhs_entry.has_map_key() &&
+           !StructurallyEqual(ast, lhs_entry.map_key(),
+                              rhs_entry.map_key())) ||
+          (lhs_entry.has_value() &&
+           !StructurallyEqual(ast, lhs_entry.value(), rhs_entry.value()))) {
+        return false;
+      }
+    }
+    return true;
+  }
+  // Comprehensions bind variables and never compare equal.
+  return false;
+}
+
+bool AppendAttributePath(const AstImpl& ast, const Expr& expr,
+                         std::string& path) {
+  if (const Reference* reference = ast.GetReference(expr.id());
+      reference != nullptr) {
+    if (reference->has_value() || reference->name().empty() ||
+        !(expr.has_ident_expr() || expr.has_select_expr())) {
+      return false;
+    }
+    absl::StrAppend(&path, reference->name());
+    return true;
+  }
+  if (expr.has_ident_expr()) {
+    absl::StrAppend(&path, expr.ident_expr().name());
+    return true;
+  }
+  if (expr.has_select_expr() && !expr.select_expr().test_only() &&
+      AppendAttributePath(ast, expr.select_expr().operand(), path)) {
+    absl::StrAppend(&path, ".", expr.select_expr().field());
+    return true;
+  }
+  return false;
+}
+
+}  // namespace google::api::expr::runtime
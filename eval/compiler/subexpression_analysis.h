@@ -0,0 +1,61 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Helpers shared by the AST transforms that rewrite subexpressions.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_SUBEXPRESSION_ANALYSIS_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_SUBEXPRESSION_ANALYSIS_H_
+
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "eval/compiler/resolver.h"
+
+namespace google::api::expr::runtime {
+
+// Calls `f` on each direct child of `expr`, in evaluation order.
+void ForEachChild(cel::ast_internal::Expr& expr,
+                  absl::FunctionRef<void(cel::ast_internal::Expr&)> f);
+void ForEachChild(const cel::ast_internal::Expr& expr,
+                  absl::FunctionRef<void(const cel::ast_internal::Expr&)> f);
+
+// Whether `function` is a standard library function without side effects.
+bool IsPureBuiltin(absl::string_view function);
+
+// Whether the call `expr` has no side effects: it calls a pure builtin, or
+// all of the overloads registered for it are marked pure (see
+// cel::FunctionDescriptor::is_pure).
+bool IsPureCall(const Resolver& resolver, const cel::ast_internal::Expr& expr);
+
+// Structural equality of two subexpressions of `ast`, ignoring expression
+// ids. For checked expressions the references of both sides must match too.
+// Comprehensions bind variables and never compare equal.
+bool StructurallyEqual(const cel::ast_internal::AstImpl& ast,
+                       const cel::ast_internal::Expr& lhs,
+                       const cel::ast_internal::Expr& rhs);
+
+// Appends the path of `expr` to `path` (e.g. "request.method") if it is a
+// variable or a chain of field selections from one. For checked expressions,
+// the name the variable was resolved to is used; enum constants are not
+// attributes.
+bool AppendAttributePath(const cel::ast_internal::AstImpl& ast,
+                         const cel::ast_internal::Expr& expr,
+                         std::string& path);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_SUBEXPRESSION_ANALYSIS_H_
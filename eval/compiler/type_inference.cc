@@ -0,0 +1,513 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/type_inference.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/type.h"
+#include "base/type_manager.h"
+#include "base/types/list_type.h"
+#include "base/types/map_type.h"
+#include "base/types/struct_type.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/resolver.h"
+#include "eval/public/ast_traverse_native.h"
+#include "eval/public/ast_visitor_native_base.h"
+#include "eval/public/source_position_native.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Comprehension;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::ComprehensionArg;
+using ::cel::ast_internal::CreateList;
+using ::cel::ast_internal::CreateStruct;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Ident;
+using ::cel::ast_internal::ListType;
+using ::cel::ast_internal::MapType;
+using ::cel::ast_internal::MessageType;
+using ::cel::ast_internal::NullValue;
+using ::cel::ast_internal::PrimitiveType;
+using ::cel::ast_internal::Select;
+using ::cel::ast_internal::SourcePosition;
+using ::cel::ast_internal::Type;
+using ::cel::ast_internal::WellKnownType;
+
+bool IsPrimitive(const Type& type, PrimitiveType primitive) {
+  return type.has_primitive() && type.primitive() == primitive;
+}
+
+bool IsWellKnown(const Type& type, WellKnownType well_known) {
+  return type.has_well_known() && type.well_known() == well_known;
+}
+
+Type MakeListType(Type element) {
+  return Type(ListType(std::make_unique<Type>(std::move(element))));
+}
+
+Type MakeMapType(Type key, Type value) {
+  return Type(MapType(std::make_unique<Type>(std::move(key)),
+                      std::make_unique<Type>(std::move(value))));
+}
+
+// Returns the AST representation of a runtime type, or nullopt if its values
+// do not have a single runtime kind, e.g. for wrappers which may be null.
+absl::optional<Type> FromRuntimeType(const cel::Type& type) {
+  switch (type.kind()) {
+    case cel::TypeKind::kNullType:
+      return Type(NullValue::kNullValue);
+    case cel::TypeKind::kBool:
+      return Type(PrimitiveType::kBool);
+    case cel::TypeKind::kInt:
+      return Type(PrimitiveType::kInt64);
+    case cel::TypeKind::kUint:
+      return Type(PrimitiveType::kUint64);
+    case cel::TypeKind::kDouble:
+      return Type(PrimitiveType::kDouble);
+    case cel::TypeKind::kString:
+      return Type(PrimitiveType::kString);
+    case cel::TypeKind::kBytes:
+      return Type(PrimitiveType::kBytes);
+    case cel::TypeKind::kDuration:
+      return Type(WellKnownType::kDuration);
+    case cel::TypeKind::kTimestamp:
+      return Type(WellKnownType::kTimestamp);
+    case cel::TypeKind::kList:
+      return MakeListType(
+          FromRuntimeType(*cel::ListType::Cast(type).element())
+              .value_or(Type()));
+    case cel::TypeKind::kMap: {
+      const auto& map_type = cel::MapType::Cast(type);
+      return MakeMapType(FromRuntimeType(*map_type.key()).value_or(Type()),
+                         FromRuntimeType(*map_type.value()).value_or(Type()));
+    }
+    case cel::TypeKind::kStruct:
+      return Type(
+          MessageType(std::string(cel::StructType::Cast(type).name())));
+    default:
+      return absl::nullopt;
+  }
+}
+
+// Returns the common type of types, or dyn if they differ or are unknown.
+Type CommonType(const std::vector<absl::optional<Type>>& types) {
+  if (types.empty() || !types.front().has_value()) {
+    return Type();
+  }
+  for (const auto& type : types) {
+    if (!type.has_value() || !(*type == *types.front())) {
+      return Type();
+    }
+  }
+  return *types.front();
+}
+
+bool IsBoolFunction(absl::string_view function) {
+  return function == cel::builtin::kAnd || function == cel::builtin::kOr ||
+         function == cel::builtin::kNot ||
+         function == cel::builtin::kNotStrictlyFalse ||
+         function == cel::builtin::kNotStrictlyFalseDeprecated ||
+         function == cel::builtin::kEqual ||
+         function == cel::builtin::kInequal ||
+         function == cel::builtin::kLess ||
+         function == cel::builtin::kLessOrEqual ||
+         function == cel::builtin::kGreater ||
+         function == cel::builtin::kGreaterOrEqual ||
+         function == cel::builtin::kIn ||
+         function == cel::builtin::kInDeprecated ||
+         function == cel::builtin::kInFunction ||
+         function == cel::builtin::kRegexMatch ||
+         function == cel::builtin::kStringContains ||
+         function == cel::builtin::kStringEndsWith ||
+         function == cel::builtin::kStringStartsWith;
+}
+
+// Returns the result type of the conversion function, if it is one.
+absl::optional<Type> ConversionType(absl::string_view function) {
+  if (function == cel::builtin::kInt) {
+    return Type(PrimitiveType::kInt64);
+  }
+  if (function == cel::builtin::kUint) {
+    return Type(PrimitiveType::kUint64);
+  }
+  if (function == cel::builtin::kDouble) {
+    return Type(PrimitiveType::kDouble);
+  }
+  if (function == cel::builtin::kString) {
+    return Type(PrimitiveType::kString);
+  }
+  if (function == cel::builtin::kBytes) {
+    return Type(PrimitiveType::kBytes);
+  }
+  if (function == cel::builtin::kDuration) {
+    return Type(WellKnownType::kDuration);
+  }
+  if (function == cel::builtin::kTimestamp) {
+    return Type(WellKnownType::kTimestamp);
+  }
+  return absl::nullopt;
+}
+
+// Returns the result type of the standard arithmetic operator function
+// applied to operands of types lhs and rhs.
+absl::optional<Type> ArithmeticType(absl::string_view function,
+                                    const Type& lhs, const Type& rhs) {
+  bool is_add = function == cel::builtin::kAdd;
+  bool is_subtract = function == cel::builtin::kSubtract;
+  if (lhs.has_primitive() && lhs == rhs) {
+    switch (lhs.primitive()) {
+      case PrimitiveType::kInt64:
+      case PrimitiveType::kUint64:
+        return lhs;
+      case PrimitiveType::kDouble:
+        if (function != cel::builtin::kModulo) {
+          return lhs;
+        }
+        return absl::nullopt;
+      case PrimitiveType::kString:
+      case PrimitiveType::kBytes:
+        if (is_add) {
+          return lhs;
+        }
+        return absl::nullopt;
+      default:
+        return absl::nullopt;
+    }
+  }
+  if (is_add && lhs.has_list_type() && rhs.has_list_type()) {
+    return lhs == rhs ? lhs : MakeListType(Type());
+  }
+  bool lhs_timestamp = IsWellKnown(lhs, WellKnownType::kTimestamp);
+  bool rhs_timestamp = IsWellKnown(rhs, WellKnownType::kTimestamp);
+  bool lhs_duration = IsWellKnown(lhs, WellKnownType::kDuration);
+  bool rhs_duration = IsWellKnown(rhs, WellKnownType::kDuration);
+  if ((is_add || is_subtract) && lhs_duration && rhs_duration) {
+    return lhs;
+  }
+  if (is_add && ((lhs_timestamp && rhs_duration) ||
+                 (lhs_duration && rhs_timestamp))) {
+    return Type(WellKnownType::kTimestamp);
+  }
+  if (is_subtract && lhs_timestamp) {
+    if (rhs_duration) {
+      return lhs;
+    }
+    if (rhs_timestamp) {
+      return Type(WellKnownType::kDuration);
+    }
+  }
+  return absl::nullopt;
+}
+
+// Infers the types of the subexpressions of an AST bottom-up, recording the
+// ones that are not dyn in the type map.
+class TypeInferrer : public cel::ast_internal::AstVisitorBase {
+ public:
+  TypeInferrer(const InferredVariableTypes& variable_types,
+               PlannerContext& context, AstImpl& ast)
+      : variable_types_(variable_types), context_(context), ast_(ast) {}
+
+  void PostVisitConst(const Constant* constant, const Expr* expr,
+                      const SourcePosition*) override {
+    Record(*expr, ConstantType(*constant));
+  }
+
+  void PostVisitIdent(const Ident* ident, const Expr* expr,
+                      const SourcePosition*) override {
+    Record(*expr, VariableType(ident->name()));
+  }
+
+  void PostVisitSelect(const Select* select, const Expr* expr,
+                       const SourcePosition*) override {
+    Record(*expr, SelectType(*select));
+  }
+
+  void PostVisitCall(const Call* call, const Expr* expr,
+                     const SourcePosition*) override {
+    Record(*expr, CallType(*call));
+  }
+
+  void PostVisitCreateList(const CreateList* list, const Expr* expr,
+                           const SourcePosition*) override {
+    std::vector<absl::optional<Type>> elements;
+    for (const Expr& element : list->elements()) {
+      elements.push_back(Get(element));
+    }
+    Record(*expr, MakeListType(CommonType(elements)));
+  }
+
+  void PostVisitCreateStruct(const CreateStruct* create_struct,
+                             const Expr* expr,
+                             const SourcePosition*) override {
+    Record(*expr, MessageOrMapType(*create_struct, expr->id()));
+  }
+
+  void PostVisitComprehensionSubexpression(
+      const Expr* subexpr, const Comprehension* comprehension,
+      ComprehensionArg comprehension_arg, const SourcePosition*) override {
+    switch (comprehension_arg) {
+      case cel::ast_internal::ACCU_INIT: {
+        // The loop condition and step see both variables, the result only
+        // the accumulator.
+        absl::optional<Type> range = Get(comprehension->iter_range());
+        absl::optional<Type> iter_type;
+        if (range.has_value() && range->has_list_type()) {
+          iter_type = range->list_type().elem_type();
+        } else if (range.has_value() && range->has_map_type()) {
+          iter_type = range->map_type().key_type();
+        }
+        scopes_.push_back({comprehension->accu_var(), Get(*subexpr)});
+        scopes_.push_back({comprehension->iter_var(), std::move(iter_type)});
+        break;
+      }
+      case cel::ast_internal::LOOP_STEP:
+      case cel::ast_internal::RESULT:
+        scopes_.pop_back();
+        break;
+      default:
+        break;
+    }
+  }
+
+  void PostVisitComprehension(const Comprehension* comprehension,
+                              const Expr* expr,
+                              const SourcePosition*) override {
+    Record(*expr, Get(comprehension->result()));
+  }
+
+ private:
+  void Record(const Expr& expr, absl::optional<Type> type) {
+    if (type.has_value() && !type->has_dyn()) {
+      ast_.type_map().insert_or_assign(expr.id(), *std::move(type));
+    }
+  }
+
+  // Returns the type recorded for expr, if any.
+  absl::optional<Type> Get(const Expr& expr) const {
+    auto it = ast_.type_map().find(expr.id());
+    if (it == ast_.type_map().end()) {
+      return absl::nullopt;
+    }
+    return it->second;
+  }
+
+  static absl::optional<Type> ConstantType(const Constant& constant) {
+    if (constant.has_null_value()) {
+      return Type(NullValue::kNullValue);
+    }
+    if (constant.has_bool_value()) {
+      return Type(PrimitiveType::kBool);
+    }
+    if (constant.has_int64_value()) {
+      return Type(PrimitiveType::kInt64);
+    }
+    if (constant.has_uint64_value()) {
+      return Type(PrimitiveType::kUint64);
+    }
+    if (constant.has_double_value()) {
+      return Type(PrimitiveType::kDouble);
+    }
+    if (constant.has_string_value()) {
+      return Type(PrimitiveType::kString);
+    }
+    if (constant.has_bytes_value()) {
+      return Type(PrimitiveType::kBytes);
+    }
+    if (constant.has_duration_value()) {
+      return Type(WellKnownType::kDuration);
+    }
+    if (constant.has_time_value()) {
+      return Type(WellKnownType::kTimestamp);
+    }
+    return absl::nullopt;
+  }
+
+  absl::optional<Type> VariableType(absl::string_view name) const {
+    // Comprehension variables shadow the declared ones, innermost first.
+    for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+      if (it->first == name) {
+        return it->second;
+      }
+    }
+    auto it = variable_types_.find(name);
+    if (it == variable_types_.end()) {
+      return absl::nullopt;
+    }
+    return it->second;
+  }
+
+  absl::optional<Type> SelectType(const Select& select) {
+    if (select.test_only()) {
+      return Type(PrimitiveType::kBool);
+    }
+    absl::optional<Type> operand = Get(select.operand());
+    if (!operand.has_value()) {
+      return absl::nullopt;
+    }
+    if (operand->has_map_type() &&
+        IsPrimitive(operand->map_type().key_type(), PrimitiveType::kString)) {
+      return operand->map_type().value_type();
+    }
+    if (operand->has_message_type()) {
+      return FieldType(operand->message_type().type(), select.field());
+    }
+    return absl::nullopt;
+  }
+
+  // Returns the type of the field of the message type according to the type
+  // provider of the runtime.
+  absl::optional<Type> FieldType(absl::string_view message_name,
+                                 absl::string_view field_name) {
+    cel::TypeManager& type_manager = context_.value_factory().type_manager();
+    auto type = type_manager.ResolveType(message_name);
+    if (!type.ok() || !type->has_value() ||
+        !(**type)->Is<cel::StructType>()) {
+      return absl::nullopt;
+    }
+    auto field = (**type)->As<cel::StructType>().FindField(
+        type_manager, cel::base_internal::FieldIdFactory::Make(field_name));
+    if (!field.ok() || !field->has_value()) {
+      return absl::nullopt;
+    }
+    return FromRuntimeType(*(*field)->type);
+  }
+
+  absl::optional<Type> MessageOrMapType(const CreateStruct& create_struct,
+                                        int64_t expr_id) {
+    if (create_struct.message_name().empty()) {
+      std::vector<absl::optional<Type>> keys;
+      std::vector<absl::optional<Type>> values;
+      for (const auto& entry : create_struct.entries()) {
+        keys.push_back(Get(entry.map_key()));
+        values.push_back(Get(entry.value()));
+      }
+      // Optional entries do not change the type of the map.
+      return MakeMapType(CommonType(keys), CommonType(values));
+    }
+    auto type =
+        context_.resolver().FindType(create_struct.message_name(), expr_id);
+    if (!type.ok() || !type->has_value() ||
+        !(*type)->second->Is<cel::StructType>()) {
+      return absl::nullopt;
+    }
+    return FromRuntimeType(*(*type)->second);
+  }
+
+  absl::optional<Type> CallType(const Call& call) const {
+    std::vector<absl::optional<Type>> args;
+    if (call.has_target()) {
+      args.push_back(Get(call.target()));
+    }
+    for (const Expr& arg : call.args()) {
+      args.push_back(Get(arg));
+    }
+
+    absl::string_view function = call.function();
+    if (IsBoolFunction(function)) {
+      return Type(PrimitiveType::kBool);
+    }
+    if (function == cel::builtin::kSize && args.size() == 1) {
+      return Type(PrimitiveType::kInt64);
+    }
+    if (!call.has_target() && args.size() == 1) {
+      absl::optional<Type> conversion = ConversionType(function);
+      if (conversion.has_value()) {
+        return conversion;
+      }
+    }
+    if (function == cel::builtin::kNeg && args.size() == 1 &&
+        args[0].has_value() &&
+        (IsPrimitive(*args[0], PrimitiveType::kInt64) ||
+         IsPrimitive(*args[0], PrimitiveType::kDouble))) {
+      return args[0];
+    }
+    if (function == cel::builtin::kTernary && args.size() == 3) {
+      return CommonType({args[1], args[2]});
+    }
+    if (args.size() != 2 || !args[0].has_value() || !args[1].has_value()) {
+      return absl::nullopt;
+    }
+    if (function == cel::builtin::kIndex) {
+      if (args[0]->has_list_type() &&
+          IsPrimitive(*args[1], PrimitiveType::kInt64)) {
+        return args[0]->list_type().elem_type();
+      }
+      if (args[0]->has_map_type()) {
+        return args[0]->map_type().value_type();
+      }
+      return absl::nullopt;
+    }
+    if (function == cel::builtin::kAdd ||
+        function == cel::builtin::kSubtract ||
+        function == cel::builtin::kMultiply ||
+        function == cel::builtin::kDivide ||
+        function == cel::builtin::kModulo) {
+      return ArithmeticType(function, *args[0], *args[1]);
+    }
+    return absl::nullopt;
+  }
+
+  const InferredVariableTypes& variable_types_;
+  PlannerContext& context_;
+  AstImpl& ast_;
+  // Comprehension variables in scope and their types, if known.
+  std::vector<std::pair<std::string, absl::optional<Type>>> scopes_;
+};
+
+class TypeInferenceTransform : public AstTransform {
+ public:
+  explicit TypeInferenceTransform(InferredVariableTypes variable_types)
+      : variable_types_(std::move(variable_types)) {}
+
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    if (ast.IsChecked() || !ast.type_map().empty()) {
+      return absl::OkStatus();
+    }
+    TypeInferrer inferrer(variable_types_, context, ast);
+    cel::ast_internal::TraversalOptions options;
+    options.use_comprehension_callbacks = true;
+    cel::ast_internal::AstTraverse(&ast.root_expr(), &ast.source_info(),
+                                   &inferrer, options);
+    return absl::OkStatus();
+  }
+
+ private:
+  InferredVariableTypes variable_types_;
+};
+
+}  // namespace
+
+std::unique_ptr<AstTransform> CreateTypeInferenceTransform(
+    InferredVariableTypes variable_types) {
+  return std::make_unique<TypeInferenceTransform>(std::move(variable_types));
+}
+
+}  // namespace google::api::expr::runtime
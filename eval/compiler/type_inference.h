@@ -0,0 +1,57 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_COMPILER_TYPE_INFERENCE_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_COMPILER_TYPE_INFERENCE_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "base/ast_internal/expr.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+
+namespace google::api::expr::runtime {
+
+// Types of the variables of parsed-only expressions, by the name they are
+// referred to with.
+using InferredVariableTypes =
+    absl::flat_hash_map<std::string, cel::ast_internal::Type>;
+
+// Create a new AST transform that records the types of the subexpressions of
+// parsed-only expressions it can infer in the AST type map, so the planner
+// can bind calls to the single overload matching the argument kinds and
+// specialize container accesses as it does for checked expressions.
+//
+// Types are inferred bottom-up from:
+//  - literals, and list and map literals;
+//  - the given variable types, unless shadowed by a comprehension variable;
+//  - message literals and selected fields, using the type provider of the
+//    runtime;
+//  - the standard operators: arithmetic on operands of the same type,
+//    logical and relational operators, `size`, indexing, conversions and
+//    the conditional operator.
+//
+// Types that are not inferred are left out of the type map. Expressions that
+// were type-checked already are left as they are.
+//
+// The inferred types are only used as hints: steps relying on them check the
+// kinds of their operands at evaluation time, and fall back to the generic
+// evaluation if a variable has a different type than declared.
+std::unique_ptr<AstTransform> CreateTypeInferenceTransform(
+    InferredVariableTypes variable_types);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_COMPILER_TYPE_INFERENCE_H_
@@ -0,0 +1,230 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/compiler/type_inference.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_map_impl.h"
+#include "eval/public/structs/protobuf_descriptor_type_provider.h"
+#include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "proto/test/v1/proto3/test_all_types.pb.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::ListType;
+using ::cel::ast_internal::MapType;
+using ::cel::ast_internal::MessageType;
+using ::cel::ast_internal::PrimitiveType;
+using ::cel::ast_internal::Type;
+using ::cel::ast_internal::WellKnownType;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::test::v1::proto3::TestAllTypes;
+using testing::Eq;
+using testing::Optional;
+
+namespace exprpb = google::api::expr::v1alpha1;
+
+constexpr absl::string_view kTestAllTypes =
+    "google.api.expr.test.v1.proto3.TestAllTypes";
+
+// Records the type inferred for the root of the expression, if any.
+class RecordingTransform : public AstTransform {
+ public:
+  explicit RecordingTransform(absl::optional<Type>* root_type)
+      : root_type_(root_type) {}
+
+  absl::Status UpdateAst(PlannerContext& context,
+                         AstImpl& ast) const override {
+    auto it = ast.type_map().find(ast.root_expr().id());
+    if (it == ast.type_map().end()) {
+      root_type_->reset();
+    } else {
+      *root_type_ = it->second;
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::optional<Type>* root_type_;
+};
+
+Type ListOf(Type element) {
+  return Type(ListType(std::make_unique<Type>(std::move(element))));
+}
+
+Type MapOf(Type key, Type value) {
+  return Type(MapType(std::make_unique<Type>(std::move(key)),
+                      std::make_unique<Type>(std::move(value))));
+}
+
+class TypeInferenceTest : public testing::Test {
+ public:
+  void SetUp() override {
+    google::protobuf::LinkMessageReflection<TestAllTypes>();
+    variable_types_["x"] = Type(PrimitiveType::kInt64);
+    variable_types_["m"] = MapOf(Type(PrimitiveType::kString),
+                                 Type(PrimitiveType::kInt64));
+    activation_.InsertValue("x", CelValue::CreateInt64(1));
+  }
+
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr) {
+    CelExpressionBuilderFlatImpl builder(ConvertToRuntimeOptions(options_));
+    CEL_RETURN_IF_ERROR(
+        RegisterBuiltinFunctions(builder.GetRegistry(), options_));
+    builder.GetTypeRegistry()->RegisterTypeProvider(
+        std::make_unique<ProtobufDescriptorProvider>(
+            google::protobuf::DescriptorPool::generated_pool(),
+            google::protobuf::MessageFactory::generated_factory()));
+    builder.set_container("google.api.expr.test.v1.proto3");
+    builder.flat_expr_builder().AddAstTransform(
+        CreateTypeInferenceTransform(variable_types_));
+    builder.flat_expr_builder().AddAstTransform(
+        std::make_unique<RecordingTransform>(&root_type_));
+
+    CEL_ASSIGN_OR_RETURN(parsed_expr_, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<CelExpression> plan,
+                         builder.CreateExpression(&parsed_expr_.expr(),
+                                                  &parsed_expr_.source_info()));
+    return plan->Evaluate(activation_, &arena_);
+  }
+
+ protected:
+  InterpreterOptions options_;
+  InferredVariableTypes variable_types_;
+  exprpb::ParsedExpr parsed_expr_;
+  Activation activation_;
+  google::protobuf::Arena arena_;
+  absl::optional<Type> root_type_;
+};
+
+TEST_F(TypeInferenceTest, InfersLiteralsAndOperators) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("1 + 2 * 3"));
+  EXPECT_THAT(result, test::IsCelInt64(7));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kInt64))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("'a' + 'b'"));
+  EXPECT_THAT(result, test::IsCelString("ab"));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kString))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("{'a': 1.5}['a'] / 2.0"));
+  EXPECT_THAT(result, test::IsCelDouble(0.75));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kDouble))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("[1, 2] + [3]"));
+  EXPECT_THAT(root_type_, Optional(Eq(ListOf(Type(PrimitiveType::kInt64)))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("size('abc') > 2 ? 'yes' : 'no'"));
+  EXPECT_THAT(result, test::IsCelString("yes"));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kString))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("timestamp('2023-01-01T00:00:00Z') - "
+                                        "timestamp('2022-01-01T00:00:00Z')"));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(WellKnownType::kDuration))));
+}
+
+TEST_F(TypeInferenceTest, LeavesUnknownTypesOut) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("[1, 'a'][0]"));
+  EXPECT_THAT(result, test::IsCelInt64(1));
+  EXPECT_EQ(root_type_, absl::nullopt);
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("1 + 1u"));
+  EXPECT_TRUE(result.IsError());
+  EXPECT_EQ(root_type_, absl::nullopt);
+}
+
+TEST_F(TypeInferenceTest, InfersVariables) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("x + 1"));
+  EXPECT_THAT(result, test::IsCelInt64(2));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kInt64))));
+}
+
+TEST_F(TypeInferenceTest, ComprehensionVariablesShadowDeclaredOnes) {
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       Evaluate("[1.5].map(x, x + 1.0)[0]"));
+  EXPECT_THAT(result, test::IsCelDouble(2.5));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("[1.5, 'a'].exists(x, x == 'a')"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kBool))));
+}
+
+TEST_F(TypeInferenceTest, VariablesOfOtherTypesAreStillEvaluated) {
+  activation_.InsertValue("x", CelValue::CreateDouble(1.5));
+  // Planned as an int addition, which falls back to the double one.
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("x + x"));
+  EXPECT_THAT(result, test::IsCelDouble(3.0));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kInt64))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("x + 1"));
+  EXPECT_TRUE(result.IsError());
+}
+
+TEST_F(TypeInferenceTest, InfersSelects) {
+  std::vector<std::pair<CelValue, CelValue>> entries = {
+      {CelValue::CreateStringView("a"), CelValue::CreateInt64(2)}};
+  ASSERT_OK_AND_ASSIGN(auto m, CreateContainerBackedMap(absl::MakeSpan(
+                                   entries)));
+  activation_.InsertValue("m", CelValue::CreateMap(m.get()));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("m.a * 3"));
+  EXPECT_THAT(result, test::IsCelInt64(6));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kInt64))));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("has(m.a)"));
+  EXPECT_THAT(result, test::IsCelBool(true));
+  EXPECT_THAT(root_type_, Optional(Eq(Type(PrimitiveType::kBool))));
+}
+
+TEST_F(TypeInferenceTest, InfersMessageTypes) {
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("TestAllTypes{}"));
+  EXPECT_THAT(root_type_,
+              Optional(Eq(Type(MessageType(std::string(kTestAllTypes))))));
+
+  // The field types are those reported by the type provider, which are dyn
+  // for protobuf messages of the legacy type registry.
+  ASSERT_OK_AND_ASSIGN(result,
+                       Evaluate("TestAllTypes{single_int64: 2}.single_int64 "
+                                "* 3"));
+  EXPECT_THAT(result, test::IsCelInt64(6));
+  EXPECT_EQ(root_type_, absl::nullopt);
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,144 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/attribute_pattern_trie.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::AttributePattern;
+using ::cel::AttributeQualifier;
+using ::cel::AttributeQualifierPattern;
+
+template <typename Node>
+Node& GetOrCreate(std::unique_ptr<Node>& child) {
+  if (child == nullptr) {
+    child = std::make_unique<Node>();
+  }
+  return *child;
+}
+
+template <typename Map, typename Key>
+const typename Map::mapped_type::element_type* Find(const Map& children,
+                                                    const Key& key) {
+  auto it = children.find(key);
+  return it == children.end() ? nullptr : it->second.get();
+}
+
+}  // namespace
+
+AttributePatternTrie::AttributePatternTrie(
+    absl::Span<const AttributePattern> patterns) {
+  for (const auto& pattern : patterns) {
+    Insert(GetOrCreate(variables_[std::string(pattern.variable())]),
+           pattern.qualifier_path());
+  }
+}
+
+void AttributePatternTrie::Insert(
+    Node& node, absl::Span<const AttributeQualifierPattern> path) {
+  if (path.empty()) {
+    node.terminal = true;
+    return;
+  }
+  node.has_descendants = true;
+  const auto& qualifier = path.front().qualifier();
+  Node* child = nullptr;
+  if (!qualifier.has_value()) {
+    child = &GetOrCreate(node.wildcard_child);
+  } else if (auto key = qualifier->GetInt64Key(); key.has_value()) {
+    child = &GetOrCreate(node.int_children[*key]);
+  } else if (auto key = qualifier->GetUint64Key(); key.has_value()) {
+    child = &GetOrCreate(node.uint_children[*key]);
+  } else if (auto key = qualifier->GetStringKey(); key.has_value()) {
+    child = &GetOrCreate(node.string_children[std::string(*key)]);
+  } else if (auto key = qualifier->GetBoolKey(); key.has_value()) {
+    child = &GetOrCreate(node.bool_children[*key ? 1 : 0]);
+  } else {
+    // Qualifiers of unsupported types never match, so nothing past this point
+    // can. The pattern still partially matches this node's attribute.
+    return;
+  }
+  Insert(*child, path.subspan(1));
+}
+
+AttributePattern::MatchType AttributePatternTrie::Match(
+    const cel::Attribute& attribute) const {
+  absl::InlinedVector<const AttributeQualifier*, 8> path;
+  path.reserve(attribute.qualifier_path().size());
+  for (const auto& qualifier : attribute.qualifier_path()) {
+    path.push_back(&qualifier);
+  }
+  return Match(attribute.variable_name(), path);
+}
+
+AttributePattern::MatchType AttributePatternTrie::Match(
+    absl::string_view variable_name,
+    absl::Span<const AttributeQualifier* const> qualifier_path) const {
+  const Node* root = Find(variables_, variable_name);
+  if (root == nullptr) {
+    return AttributePattern::MatchType::NONE;
+  }
+  return Match(*root, qualifier_path);
+}
+
+AttributePattern::MatchType AttributePatternTrie::Match(
+    const Node& node, absl::Span<const AttributeQualifier* const> path) {
+  if (node.terminal) {
+    return AttributePattern::MatchType::FULL;
+  }
+  if (path.empty()) {
+    return node.has_descendants ? AttributePattern::MatchType::PARTIAL
+                                : AttributePattern::MatchType::NONE;
+  }
+  const AttributeQualifier& qualifier = *path.front();
+  const Node* child = nullptr;
+  if (auto key = qualifier.GetInt64Key(); key.has_value()) {
+    child = Find(node.int_children, *key);
+  } else if (auto key = qualifier.GetUint64Key(); key.has_value()) {
+    child = Find(node.uint_children, *key);
+  } else if (auto key = qualifier.GetStringKey(); key.has_value()) {
+    child = Find(node.string_children, *key);
+  } else if (auto key = qualifier.GetBoolKey(); key.has_value()) {
+    child = node.bool_children[*key ? 1 : 0].get();
+  }
+  const Node* const candidates[] = {child, node.wildcard_child.get()};
+  AttributePattern::MatchType result = AttributePattern::MatchType::NONE;
+  for (const Node* next : candidates) {
+    if (next == nullptr) {
+      continue;
+    }
+    switch (Match(*next, path.subspan(1))) {
+      case AttributePattern::MatchType::FULL:
+        return AttributePattern::MatchType::FULL;
+      case AttributePattern::MatchType::PARTIAL:
+        result = AttributePattern::MatchType::PARTIAL;
+        break;
+      case AttributePattern::MatchType::NONE:
+        break;
+    }
+  }
+  return result;
+}
+
+}  // namespace google::api::expr::runtime
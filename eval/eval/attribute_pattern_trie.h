@@ -0,0 +1,82 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_ATTRIBUTE_PATTERN_TRIE_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_ATTRIBUTE_PATTERN_TRIE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+
+namespace google::api::expr::runtime {
+
+// A set of attribute patterns compiled into a trie keyed by variable name and
+// qualifiers, with separate edges for wildcard qualifiers.
+//
+// Matching an attribute against the trie gives the same result as taking the
+// closest `cel::AttributePattern::IsMatch` result over all of the patterns,
+// but only visits the patterns sharing a prefix with the attribute, rather
+// than every pattern.
+class AttributePatternTrie final {
+ public:
+  explicit AttributePatternTrie(
+      absl::Span<const cel::AttributePattern> patterns);
+
+  AttributePatternTrie(const AttributePatternTrie&) = delete;
+  AttributePatternTrie& operator=(const AttributePatternTrie&) = delete;
+  AttributePatternTrie(AttributePatternTrie&&) = default;
+  AttributePatternTrie& operator=(AttributePatternTrie&&) = default;
+
+  // Returns FULL if any pattern matches the attribute itself, otherwise
+  // PARTIAL if any pattern matches an attribute nested within it, otherwise
+  // NONE.
+  cel::AttributePattern::MatchType Match(
+      const cel::Attribute& attribute) const;
+
+  // As above, for the attribute with the given variable name and qualifiers.
+  cel::AttributePattern::MatchType Match(
+      absl::string_view variable_name,
+      absl::Span<const cel::AttributeQualifier* const> qualifier_path) const;
+
+ private:
+  struct Node final {
+    // Set if a pattern ends at this node.
+    bool terminal = false;
+    // Set if a pattern continues past this node.
+    bool has_descendants = false;
+    absl::flat_hash_map<int64_t, std::unique_ptr<Node>> int_children;
+    absl::flat_hash_map<uint64_t, std::unique_ptr<Node>> uint_children;
+    absl::flat_hash_map<std::string, std::unique_ptr<Node>> string_children;
+    std::unique_ptr<Node> bool_children[2];
+    std::unique_ptr<Node> wildcard_child;
+  };
+
+  static void Insert(Node& node,
+                     absl::Span<const cel::AttributeQualifierPattern> path);
+
+  static cel::AttributePattern::MatchType Match(
+      const Node& node,
+      absl::Span<const cel::AttributeQualifier* const> path);
+
+  absl::flat_hash_map<std::string, std::unique_ptr<Node>> variables_;
+};
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_ATTRIBUTE_PATTERN_TRIE_H_
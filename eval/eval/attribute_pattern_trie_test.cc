@@ -0,0 +1,155 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/attribute_pattern_trie.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "base/attribute.h"
+#include "internal/testing.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::Attribute;
+using ::cel::AttributePattern;
+using ::cel::AttributeQualifier;
+using ::cel::AttributeQualifierPattern;
+
+using MatchType = AttributePattern::MatchType;
+
+MatchType ScanPatterns(const std::vector<AttributePattern>& patterns,
+                       const Attribute& attribute) {
+  MatchType result = MatchType::NONE;
+  for (const auto& pattern : patterns) {
+    MatchType match = pattern.IsMatch(attribute);
+    if (match == MatchType::FULL) {
+      return match;
+    }
+    if (match == MatchType::PARTIAL) {
+      result = match;
+    }
+  }
+  return result;
+}
+
+TEST(AttributePatternTrie, Empty) {
+  AttributePatternTrie trie({});
+  EXPECT_EQ(trie.Match(Attribute("a")), MatchType::NONE);
+}
+
+TEST(AttributePatternTrie, FullAndPartial) {
+  std::vector<AttributePattern> patterns = {
+      AttributePattern("a", {AttributeQualifierPattern::OfString("b"),
+                             AttributeQualifierPattern::OfInt(1)}),
+      AttributePattern("c", {}),
+  };
+  AttributePatternTrie trie(patterns);
+
+  EXPECT_EQ(trie.Match(Attribute("a")), MatchType::PARTIAL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b")})),
+            MatchType::PARTIAL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b"),
+                                       AttributeQualifier::OfInt(1)})),
+            MatchType::FULL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b"),
+                                       AttributeQualifier::OfInt(1),
+                                       AttributeQualifier::OfBool(true)})),
+            MatchType::FULL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b"),
+                                       AttributeQualifier::OfUint(1)})),
+            MatchType::NONE);
+  EXPECT_EQ(trie.Match(Attribute("c", {AttributeQualifier::OfString("d")})),
+            MatchType::FULL);
+  EXPECT_EQ(trie.Match(Attribute("d")), MatchType::NONE);
+}
+
+TEST(AttributePatternTrie, Wildcards) {
+  std::vector<AttributePattern> patterns = {
+      AttributePattern("a", {AttributeQualifierPattern::CreateWildcard(),
+                             AttributeQualifierPattern::OfString("x")}),
+      AttributePattern("a", {AttributeQualifierPattern::OfString("b"),
+                             AttributeQualifierPattern::OfString("y"),
+                             AttributeQualifierPattern::OfString("z")}),
+  };
+  AttributePatternTrie trie(patterns);
+
+  // Matched through the wildcard edge.
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b"),
+                                       AttributeQualifier::OfString("x")})),
+            MatchType::FULL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfInt(3),
+                                       AttributeQualifier::OfString("x")})),
+            MatchType::FULL);
+  // Matched through the literal edge.
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfString("b"),
+                                       AttributeQualifier::OfString("y")})),
+            MatchType::PARTIAL);
+  EXPECT_EQ(trie.Match(Attribute("a", {AttributeQualifier::OfInt(3),
+                                       AttributeQualifier::OfString("y")})),
+            MatchType::NONE);
+}
+
+TEST(AttributePatternTrie, MatchesPatternScan) {
+  std::vector<AttributeQualifierPattern> qualifier_patterns = {
+      AttributeQualifierPattern::CreateWildcard(),
+      AttributeQualifierPattern::OfString("s"),
+      AttributeQualifierPattern::OfInt(1),
+      AttributeQualifierPattern::OfUint(1),
+      AttributeQualifierPattern::OfBool(true),
+      AttributeQualifierPattern(AttributeQualifier()),
+  };
+  std::vector<AttributeQualifier> qualifiers = {
+      AttributeQualifier::OfString("s"), AttributeQualifier::OfString("t"),
+      AttributeQualifier::OfInt(1),      AttributeQualifier::OfUint(1),
+      AttributeQualifier::OfBool(true),  AttributeQualifier::OfBool(false),
+      AttributeQualifier(),
+  };
+
+  std::vector<AttributePattern> patterns;
+  for (const auto& first : qualifier_patterns) {
+    patterns.push_back(AttributePattern("v", {first}));
+    for (const auto& second : qualifier_patterns) {
+      patterns.push_back(AttributePattern("w", {first, second}));
+    }
+  }
+
+  std::vector<Attribute> attributes = {Attribute("v"), Attribute("w")};
+  for (const auto& first : qualifiers) {
+    for (const auto& second : qualifiers) {
+      attributes.push_back(Attribute("w", {first, second}));
+    }
+  }
+
+  // Check each pattern alone, and growing sets of patterns, against every
+  // attribute.
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    std::vector<AttributePattern> single = {patterns[i]};
+    std::vector<AttributePattern> prefix(patterns.begin(),
+                                         patterns.begin() + i + 1);
+    AttributePatternTrie single_trie(single);
+    AttributePatternTrie prefix_trie(prefix);
+    for (size_t j = 0; j < attributes.size(); ++j) {
+      const Attribute& attribute = attributes[j];
+      EXPECT_EQ(single_trie.Match(attribute), ScanPatterns(single, attribute))
+          << "pattern " << i << " attribute " << j;
+      EXPECT_EQ(prefix_trie.Match(attribute), ScanPatterns(prefix, attribute))
+          << "patterns 0.." << i << " attribute " << j;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -1,28 +1,83 @@
 #include "eval/eval/attribute_trail.h"
 
-#include <algorithm>
-#include <iterator>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "base/attribute.h"
 
 namespace google::api::expr::runtime {
 
+struct AttributeTrail::Node final {
+  // Set for the trail a path starts from.
+  absl::optional<cel::Attribute> root;
+  // Set for steps, along with the qualifier appended by the step.
+  std::shared_ptr<const Node> parent;
+  cel::AttributeQualifier qualifier;
+  // Number of qualifiers in the path, including those of the root.
+  size_t size = 0;
+};
+
+AttributeTrail::AttributeTrail(std::string variable_name)
+    : AttributeTrail(cel::Attribute(std::move(variable_name))) {}
+
+AttributeTrail::AttributeTrail(cel::Attribute attribute) {
+  auto node = std::make_shared<Node>();
+  node->size = attribute.qualifier_path().size();
+  node->root.emplace(std::move(attribute));
+  node_ = std::move(node);
+}
+
 // Creates AttributeTrail with attribute path incremented by "qualifier".
 AttributeTrail AttributeTrail::Step(cel::AttributeQualifier qualifier) const {
   // Cannot continue void trail
   if (empty()) return AttributeTrail();
 
+  auto node = std::make_shared<Node>();
+  node->parent = node_;
+  node->qualifier = std::move(qualifier);
+  node->size = node_->size + 1;
+  return AttributeTrail(std::shared_ptr<const Node>(std::move(node)));
+}
+
+cel::Attribute AttributeTrail::attribute() const {
+  if (node_->root.has_value()) {
+    return *node_->root;
+  }
+  QualifierPathView path = QualifierPath();
   std::vector<cel::AttributeQualifier> qualifiers;
-  qualifiers.reserve(attribute_->qualifier_path().size() + 1);
-  std::copy_n(attribute_->qualifier_path().begin(),
-              attribute_->qualifier_path().size(),
-              std::back_inserter(qualifiers));
-  qualifiers.push_back(std::move(qualifier));
-  return AttributeTrail(cel::Attribute(std::string(attribute_->variable_name()),
-                                       std::move(qualifiers)));
+  qualifiers.reserve(path.size());
+  for (const cel::AttributeQualifier* qualifier : path) {
+    qualifiers.push_back(*qualifier);
+  }
+  return cel::Attribute(std::string(variable_name()), std::move(qualifiers));
+}
+
+absl::string_view AttributeTrail::variable_name() const {
+  const Node* node = node_.get();
+  while (!node->root.has_value()) {
+    node = node->parent.get();
+  }
+  return node->root->variable_name();
+}
+
+AttributeTrail::QualifierPathView AttributeTrail::QualifierPath() const {
+  QualifierPathView path(node_->size);
+  const Node* node = node_.get();
+  size_t index = node->size;
+  while (!node->root.has_value()) {
+    path[--index] = &node->qualifier;
+    node = node->parent.get();
+  }
+  // The remaining slots are the qualifiers of the root attribute.
+  for (size_t i = 0; i < index; ++i) {
+    path[i] = &node->root->qualifier_path()[i];
+  }
+  return path;
 }
 
 }  // namespace google::api::expr::runtime
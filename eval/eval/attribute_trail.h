@@ -1,11 +1,13 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_ATTRIBUTE_TRAIL_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_ATTRIBUTE_TRAIL_H_
 
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
 
-#include "absl/types/optional.h"
-#include "absl/utility/utility.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/strings/string_view.h"
 #include "base/attribute.h"
 
 namespace google::api::expr::runtime {
@@ -13,21 +15,26 @@ namespace google::api::expr::runtime {
 // AttributeTrail reflects current attribute path.
 // It is functionally similar to cel::Attribute, yet intended to have better
 // complexity on attribute path increment operations.
-// TODO(issues/41) Current AttributeTrail implementation is equivalent to
-// cel::Attribute - improve it.
 // Intended to be used in conjunction with cel::Value, describing the attribute
 // value originated from.
 // Empty AttributeTrail denotes object with attribute path not defined
 // or supported.
+//
+// The path is persistent: each step holds its qualifier and shares the trail
+// it was taken from, so Step is constant time regardless of the path length.
+// The full cel::Attribute is only built when requested, which is usually
+// only when an unknown or missing attribute is reported.
 class AttributeTrail {
  public:
-  AttributeTrail() : attribute_(absl::nullopt) {}
+  // Qualifiers of the path, in order, as returned by QualifierPath.
+  using QualifierPathView = absl::InlinedVector<const cel::AttributeQualifier*,
+                                                8>;
 
-  explicit AttributeTrail(std::string variable_name)
-      : attribute_(absl::in_place, std::move(variable_name)) {}
+  AttributeTrail() = default;
 
-  explicit AttributeTrail(cel::Attribute attribute)
-      : attribute_(std::move(attribute)) {}
+  explicit AttributeTrail(std::string variable_name);
+
+  explicit AttributeTrail(cel::Attribute attribute);
 
   AttributeTrail(const AttributeTrail&) = default;
   AttributeTrail& operator=(const AttributeTrail&) = default;
@@ -43,12 +50,25 @@ class AttributeTrail {
   }
 
   // Returns CelAttribute that corresponds to content of AttributeTrail.
-  const cel::Attribute& attribute() const { return attribute_.value(); }
+  // Builds the attribute unless no steps were taken from it.
+  cel::Attribute attribute() const;
+
+  // Returns the variable name of the attribute.
+  absl::string_view variable_name() const;
+
+  // Returns the qualifiers of the attribute without copying them. They are
+  // owned by this trail.
+  QualifierPathView QualifierPath() const;
 
-  bool empty() const { return !attribute_.has_value(); }
+  bool empty() const { return node_ == nullptr; }
 
  private:
-  absl::optional<cel::Attribute> attribute_;
+  struct Node;
+
+  explicit AttributeTrail(std::shared_ptr<const Node> node)
+      : node_(std::move(node)) {}
+
+  std::shared_ptr<const Node> node_;
 };
 
 }  // namespace google::api::expr::runtime
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "base/attribute.h"
 #include "eval/public/cel_attribute.h"
 #include "eval/public/cel_value.h"
 #include "internal/testing.h"
@@ -28,4 +29,49 @@ TEST(AttributeTrailTest, AttributeTrailStep) {
             CelAttribute("ident", {CreateCelAttributeQualifier(step_value)}));
 }
 
+TEST(AttributeTrailTest, AttributeTrailStepsShareParent) {
+  AttributeTrail root(cel::Attribute(
+      "ident", {cel::AttributeQualifier::OfString("a"),
+                cel::AttributeQualifier::OfInt(1)}));
+  AttributeTrail parent = root.Step(cel::AttributeQualifier::OfString("b"));
+  AttributeTrail left = parent.Step(cel::AttributeQualifier::OfBool(true));
+  AttributeTrail right = parent.Step(cel::AttributeQualifier::OfUint(2));
+
+  EXPECT_EQ(left.variable_name(), "ident");
+  EXPECT_EQ(left.attribute(),
+            cel::Attribute("ident", {cel::AttributeQualifier::OfString("a"),
+                                     cel::AttributeQualifier::OfInt(1),
+                                     cel::AttributeQualifier::OfString("b"),
+                                     cel::AttributeQualifier::OfBool(true)}));
+  EXPECT_EQ(right.attribute(),
+            cel::Attribute("ident", {cel::AttributeQualifier::OfString("a"),
+                                     cel::AttributeQualifier::OfInt(1),
+                                     cel::AttributeQualifier::OfString("b"),
+                                     cel::AttributeQualifier::OfUint(2)}));
+
+  AttributeTrail::QualifierPathView left_path = left.QualifierPath();
+  AttributeTrail::QualifierPathView right_path = right.QualifierPath();
+  ASSERT_EQ(left_path.size(), 4);
+  ASSERT_EQ(right_path.size(), 4);
+  EXPECT_EQ(*left_path[0], cel::AttributeQualifier::OfString("a"));
+  EXPECT_EQ(*left_path[3], cel::AttributeQualifier::OfBool(true));
+  EXPECT_EQ(*right_path[3], cel::AttributeQualifier::OfUint(2));
+  // Both steps refer to the qualifiers of the shared parent, not copies.
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(left_path[i], right_path[i]);
+  }
+}
+
+TEST(AttributeTrailTest, AttributeTrailDeepPath) {
+  AttributeTrail trail("ident");
+  for (int i = 0; i < 1000; ++i) {
+    trail = trail.Step(cel::AttributeQualifier::OfInt(i));
+  }
+  cel::Attribute attribute = trail.attribute();
+  ASSERT_EQ(attribute.qualifier_path().size(), 1000);
+  EXPECT_EQ(attribute.qualifier_path()[0], cel::AttributeQualifier::OfInt(0));
+  EXPECT_EQ(attribute.qualifier_path()[999],
+            cel::AttributeQualifier::OfInt(999));
+}
+
 }  // namespace google::api::expr::runtime
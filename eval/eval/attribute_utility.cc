@@ -1,12 +1,18 @@
 #include "eval/eval/attribute_utility.h"
 
+#include <cstddef>
 #include <utility>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
 #include "base/attribute_set.h"
 #include "base/handle.h"
 #include "base/internal/unknown_set.h"
 #include "base/values/error_value.h"
 #include "base/values/unknown_value.h"
+#include "eval/eval/attribute_pattern_trie.h"
 #include "eval/internal/errors.h"
 
 namespace google::api::expr::runtime {
@@ -17,22 +23,68 @@ using ::cel::Handle;
 using ::cel::UnknownValue;
 using ::cel::base_internal::UnknownSet;
 
+namespace {
+
+// Equivalent to cel::AttributePattern::IsMatch, for an attribute trail.
+cel::AttributePattern::MatchType MatchPattern(
+    const cel::AttributePattern& pattern, absl::string_view variable_name,
+    absl::Span<const cel::AttributeQualifier* const> qualifier_path) {
+  if (pattern.variable() != variable_name) {
+    return cel::AttributePattern::MatchType::NONE;
+  }
+  auto result = cel::AttributePattern::MatchType::FULL;
+  size_t max_index = pattern.qualifier_path().size();
+  if (max_index > qualifier_path.size()) {
+    max_index = qualifier_path.size();
+    result = cel::AttributePattern::MatchType::PARTIAL;
+  }
+  for (size_t i = 0; i < max_index; i++) {
+    if (!pattern.qualifier_path()[i].IsMatch(*qualifier_path[i])) {
+      return cel::AttributePattern::MatchType::NONE;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+cel::AttributePattern::MatchType AttributeUtility::Match(
+    absl::Span<const cel::AttributePattern> patterns,
+    absl::optional<AttributePatternTrie>& trie, const AttributeTrail& trail) {
+  // Matches against the trail's path, so no attribute is built unless one is
+  // reported.
+  absl::string_view variable_name = trail.variable_name();
+  AttributeTrail::QualifierPathView qualifier_path = trail.QualifierPath();
+  if (patterns.size() >= kMinPatternsForTrie) {
+    if (!trie.has_value()) {
+      trie.emplace(patterns);
+    }
+    return trie->Match(variable_name, qualifier_path);
+  }
+  auto result = cel::AttributePattern::MatchType::NONE;
+  for (const auto& pattern : patterns) {
+    auto current_match = MatchPattern(pattern, variable_name, qualifier_path);
+    if (current_match == cel::AttributePattern::MatchType::FULL) {
+      return current_match;
+    }
+    if (current_match == cel::AttributePattern::MatchType::PARTIAL) {
+      result = current_match;
+    }
+  }
+  return result;
+}
+
 bool AttributeUtility::CheckForMissingAttribute(
     const AttributeTrail& trail) const {
   if (trail.empty()) {
     return false;
   }
 
-  for (const auto& pattern : missing_attribute_patterns_) {
-    // (b/161297249) Preserving existing behavior for now, will add a streamz
-    // for partial match, follow up with tightening up which fields are exposed
-    // to the condition (w/ ajay and jim)
-    if (pattern.IsMatch(trail.attribute()) ==
-        cel::AttributePattern::MatchType::FULL) {
-      return true;
-    }
-  }
-  return false;
+  // (b/161297249) Preserving existing behavior for now, will add a streamz
+  // for partial match, follow up with tightening up which fields are exposed
+  // to the condition (w/ ajay and jim)
+  return Match(missing_attribute_patterns_, missing_attribute_trie_, trail) ==
+         cel::AttributePattern::MatchType::FULL;
 }
 
 // Checks whether particular corresponds to any patterns that define unknowns.
@@ -41,15 +93,9 @@ bool AttributeUtility::CheckForUnknown(const AttributeTrail& trail,
   if (trail.empty()) {
     return false;
   }
-  for (const auto& pattern : unknown_patterns_) {
-    auto current_match = pattern.IsMatch(trail.attribute());
-    if (current_match == cel::AttributePattern::MatchType::FULL ||
-        (use_partial &&
-         current_match == cel::AttributePattern::MatchType::PARTIAL)) {
-      return true;
-    }
-  }
-  return false;
+  auto match = Match(unknown_patterns_, unknown_trie_, trail);
+  return match == cel::AttributePattern::MatchType::FULL ||
+         (use_partial && match == cel::AttributePattern::MatchType::PARTIAL);
 }
 
 // Creates merged UnknownAttributeSet.
@@ -1,6 +1,9 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_UNKNOWNS_UTILITY_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_UNKNOWNS_UTILITY_H_
 
+#include <cstddef>
+
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "base/attribute_set.h"
 #include "base/function_descriptor.h"
@@ -8,6 +11,7 @@
 #include "base/handle.h"
 #include "base/value.h"
 #include "base/value_factory.h"
+#include "eval/eval/attribute_pattern_trie.h"
 #include "eval/eval/attribute_trail.h"
 
 namespace google::api::expr::runtime {
@@ -72,8 +76,18 @@ class AttributeUtility {
       absl::Span<const cel::Handle<cel::Value>> args) const;
 
  private:
+  // Pattern sets at least this large are compiled into a trie on first use,
+  // rather than scanned for every check.
+  static constexpr size_t kMinPatternsForTrie = 8;
+
+  static cel::AttributePattern::MatchType Match(
+      absl::Span<const cel::AttributePattern> patterns,
+      absl::optional<AttributePatternTrie>& trie, const AttributeTrail& trail);
+
   absl::Span<const cel::AttributePattern> unknown_patterns_;
   absl::Span<const cel::AttributePattern> missing_attribute_patterns_;
+  mutable absl::optional<AttributePatternTrie> unknown_trie_;
+  mutable absl::optional<AttributePatternTrie> missing_attribute_trie_;
   cel::ValueFactory& value_factory_;
 };
 
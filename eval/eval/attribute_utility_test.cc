@@ -77,6 +77,36 @@ TEST_F(AttributeUtilityTest, UnknownsUtilityCheckUnknowns) {
   }
 }
 
+TEST_F(AttributeUtilityTest, UnknownsUtilityCheckUnknownsManyPatterns) {
+  // Enough patterns for the utility to compile them into a trie.
+  std::vector<CelAttributePattern> unknown_patterns;
+  for (int i = 0; i < 16; ++i) {
+    unknown_patterns.push_back(CelAttributePattern(
+        "unknown0",
+        {CreateCelAttributeQualifierPattern(CelValue::CreateInt64(i))}));
+  }
+  unknown_patterns.push_back(CelAttributePattern("unknown1", {}));
+
+  std::vector<CelAttributePattern> missing_attribute_patterns;
+
+  AttributeUtility utility(unknown_patterns, missing_attribute_patterns,
+                           value_factory_);
+  AttributeTrail unknown_trail0("unknown0");
+
+  EXPECT_FALSE(utility.CheckForUnknown(unknown_trail0, false));
+  EXPECT_TRUE(utility.CheckForUnknown(unknown_trail0, true));
+  EXPECT_TRUE(utility.CheckForUnknown(
+      unknown_trail0.Step(
+          CreateCelAttributeQualifier(CelValue::CreateInt64(15))),
+      false));
+  EXPECT_FALSE(utility.CheckForUnknown(
+      unknown_trail0.Step(
+          CreateCelAttributeQualifier(CelValue::CreateInt64(16))),
+      true));
+  EXPECT_TRUE(utility.CheckForUnknown(AttributeTrail("unknown1"), false));
+  EXPECT_FALSE(utility.CheckForUnknown(AttributeTrail("unknown2"), true));
+}
+
 TEST_F(AttributeUtilityTest, UnknownsUtilityMergeUnknownsFromValues) {
   std::vector<CelAttributePattern> unknown_patterns;
 
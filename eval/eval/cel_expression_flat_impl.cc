@@ -16,12 +16,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
 
 #include "absl/status/status.h"
 #include "base/value.h"
 #include "base/value_factory.h"
 #include "base/values/opaque_value.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/evaluator_state_pool.h"
 #include "eval/internal/adapter_activation_impl.h"
 #include "eval/internal/interop.h"
 #include "eval/public/cel_expression.h"
@@ -35,20 +37,20 @@ namespace {
 using ::cel::Handle;
 using ::cel::Value;
 using ::cel::ValueFactory;
-using ::cel::extensions::ProtoMemoryManagerArena;
 using ::cel::extensions::ProtoMemoryManagerRef;
 
-EvaluationListener AdaptListener(const CelEvaluationListener& listener) {
+// The evaluation's memory manager is backed by arena.
+EvaluationListener AdaptListener(const CelEvaluationListener& listener,
+                                 google::protobuf::Arena* arena) {
   if (!listener) return nullptr;
-  return [&](int64_t expr_id, const Handle<Value>& value,
-             ValueFactory& factory) -> absl::Status {
+  return [&listener, arena](int64_t expr_id, const Handle<Value>& value,
+                            ValueFactory&) -> absl::Status {
     if (value->Is<cel::OpaqueValue>()) {
       // Opaque types are used to implement some optimized operations.
       // These aren't representable as legacy values and shouldn't be
       // inspectable by clients.
       return absl::OkStatus();
     }
-    google::protobuf::Arena* arena = ProtoMemoryManagerArena(factory.GetMemoryManager());
     CelValue legacy_value =
         cel::interop_internal::ModernValueToLegacyValueOrDie(arena, value);
     return listener(expr_id, legacy_value, arena);
@@ -61,21 +63,41 @@ CelExpressionFlatEvaluationState::CelExpressionFlatEvaluationState(
     : arena_(arena),
       state_(expression.MakeEvaluatorState(ProtoMemoryManagerRef(arena_))) {}
 
+absl::StatusOr<CelValue> CelExpressionFlatImpl::TraceImpl(
+    const BaseActivation& activation, google::protobuf::Arena* arena,
+    FlatExpressionEvaluatorState& state, CelEvaluationListener callback) const {
+  // Variables are looked up on the evaluation's arena directly.
+  cel::interop_internal::AdapterActivationImpl modern_activation(activation,
+                                                                 arena);
+  // Modern lists and maps passed to legacy functions or the listener are
+  // wrapped once per evaluation.
+  cel::interop_internal::InteropCache interop_cache(arena);
+  cel::interop_internal::InteropCache::Scope interop_scope(&interop_cache);
+
+  CEL_ASSIGN_OR_RETURN(
+      cel::Handle<cel::Value> value,
+      flat_expression_.EvaluateWithCallback(
+          modern_activation, AdaptListener(callback, arena), state));
+
+  return cel::interop_internal::ModernValueToLegacyValueOrDie(arena, value);
+}
+
 absl::StatusOr<CelValue> CelExpressionFlatImpl::Trace(
     const BaseActivation& activation, CelEvaluationState* _state,
     CelEvaluationListener callback) const {
   auto state =
       ::cel::internal::down_cast<CelExpressionFlatEvaluationState*>(_state);
   state->state().Reset();
-  cel::interop_internal::AdapterActivationImpl modern_activation(activation);
-
-  CEL_ASSIGN_OR_RETURN(
-      cel::Handle<cel::Value> value,
-      flat_expression_.EvaluateWithCallback(
-          modern_activation, AdaptListener(callback), state->state()));
+  return TraceImpl(activation, state->arena(), state->state(),
+                   std::move(callback));
+}
 
-  return cel::interop_internal::ModernValueToLegacyValueOrDie(state->arena(),
-                                                              value);
+absl::StatusOr<CelValue> CelExpressionFlatImpl::Trace(
+    const BaseActivation& activation, google::protobuf::Arena* arena,
+    CelEvaluationListener callback) const {
+  FlatExpressionEvaluatorStatePool::Lease lease =
+      state_pool_->Acquire(flat_expression_, ProtoMemoryManagerRef(arena));
+  return TraceImpl(activation, arena, lease.state(), std::move(callback));
 }
 
 std::unique_ptr<CelEvaluationState> CelExpressionFlatImpl::InitializeState(
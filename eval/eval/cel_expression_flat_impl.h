@@ -19,6 +19,7 @@
 #include <utility>
 
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/evaluator_state_pool.h"
 #include "eval/public/cel_expression.h"
 #include "extensions/protobuf/memory_manager.h"
 
@@ -45,7 +46,8 @@ class CelExpressionFlatEvaluationState : public CelEvaluationState {
 class CelExpressionFlatImpl : public CelExpression {
  public:
   explicit CelExpressionFlatImpl(FlatExpression flat_expression)
-      : flat_expression_(std::move(flat_expression)) {}
+      : flat_expression_(std::move(flat_expression)),
+        state_pool_(std::make_unique<FlatExpressionEvaluatorStatePool>()) {}
 
   // Move-only
   CelExpressionFlatImpl(const CelExpressionFlatImpl&) = delete;
@@ -57,18 +59,18 @@ class CelExpressionFlatImpl : public CelExpression {
   std::unique_ptr<CelEvaluationState> InitializeState(
       google::protobuf::Arena* arena) const override;
 
+  // Evaluates using an evaluator state borrowed from a per-expression pool,
+  // so repeated calls do not allocate evaluator state.
   absl::StatusOr<CelValue> Evaluate(const BaseActivation& activation,
                                     google::protobuf::Arena* arena) const override {
-    return Evaluate(activation, InitializeState(arena).get());
+    return Trace(activation, arena, CelEvaluationListener());
   }
 
   absl::StatusOr<CelValue> Evaluate(const BaseActivation& activation,
                                     CelEvaluationState* state) const override;
-  absl::StatusOr<CelValue> Trace(
-      const BaseActivation& activation, google::protobuf::Arena* arena,
-      CelEvaluationListener callback) const override {
-    return Trace(activation, InitializeState(arena).get(), callback);
-  }
+  absl::StatusOr<CelValue> Trace(const BaseActivation& activation,
+                                 google::protobuf::Arena* arena,
+                                 CelEvaluationListener callback) const override;
 
   absl::StatusOr<CelValue> Trace(const BaseActivation& activation,
                                  CelEvaluationState* state,
@@ -77,8 +79,20 @@ class CelExpressionFlatImpl : public CelExpression {
   // Exposed for inspection in tests.
   const FlatExpression& flat_expression() const { return flat_expression_; }
 
+  // Exposed for inspection in tests.
+  const FlatExpressionEvaluatorStatePool& state_pool() const {
+    return *state_pool_;
+  }
+
  private:
+  absl::StatusOr<CelValue> TraceImpl(const BaseActivation& activation,
+                                     google::protobuf::Arena* arena,
+                                     FlatExpressionEvaluatorState& state,
+                                     CelEvaluationListener callback) const;
+
   FlatExpression flat_expression_;
+  // Held by pointer so the expression stays movable.
+  std::unique_ptr<FlatExpressionEvaluatorStatePool> state_pool_;
 };
 
 }  // namespace google::api::expr::runtime
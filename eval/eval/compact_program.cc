@@ -0,0 +1,102 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/compact_program.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "common/native_type.h"
+#include "eval/eval/compiler_constant_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/jump_step.h"
+#include "internal/casts.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::NativeTypeId;
+
+// Returns the validated offset or nullopt if the jump cannot be inlined.
+absl::optional<int32_t> InlineJumpOffset(const JumpStepBase& step,
+                                         size_t index, size_t program_size) {
+  const absl::optional<int>& offset = step.jump_offset();
+  if (!offset.has_value()) {
+    return absl::nullopt;
+  }
+  int64_t target = static_cast<int64_t>(index) + 1 + *offset;
+  if (target < 0 || target > static_cast<int64_t>(program_size)) {
+    return absl::nullopt;
+  }
+  return static_cast<int32_t>(*offset);
+}
+
+CompactStep EncodeStep(const ExpressionStep& step, size_t index,
+                       size_t program_size) {
+  CompactStep encoded;
+  encoded.step = &step;
+  encoded.expr_id = step.id();
+  encoded.comes_from_ast = step.ComesFromAst();
+
+  NativeTypeId type_id = step.GetNativeTypeId();
+  if (type_id == NativeTypeId::For<CompilerConstantStep>()) {
+    encoded.opcode = CompactOpcode::kConstant;
+    encoded.constant =
+        &cel::internal::down_cast<const CompilerConstantStep&>(step).value();
+  } else if (type_id == NativeTypeId::For<JumpStep>()) {
+    const auto& jump = cel::internal::down_cast<const JumpStep&>(step);
+    absl::optional<int32_t> offset = InlineJumpOffset(jump, index, program_size);
+    if (offset.has_value()) {
+      encoded.opcode = CompactOpcode::kJump;
+      encoded.jump_offset = *offset;
+    }
+  } else if (type_id == NativeTypeId::For<CondJumpStep>()) {
+    const auto& jump = cel::internal::down_cast<const CondJumpStep&>(step);
+    absl::optional<int32_t> offset = InlineJumpOffset(jump, index, program_size);
+    if (offset.has_value()) {
+      encoded.opcode = CompactOpcode::kCondJump;
+      encoded.jump_offset = *offset;
+      encoded.jump_condition = jump.jump_condition();
+      encoded.leave_on_stack = jump.leave_on_stack();
+    }
+  }
+  return encoded;
+}
+
+}  // namespace
+
+CompactProgram EncodeCompactProgram(ExecutionPathView path) {
+  CompactProgram program;
+  program.reserve(path.size());
+  for (size_t i = 0; i < path.size(); ++i) {
+    program.push_back(EncodeStep(*path[i], i, path.size()));
+  }
+  return program;
+}
+
+std::vector<CompactProgram> EncodeCompactPrograms(
+    absl::Span<const ExecutionPathView> subexpressions) {
+  std::vector<CompactProgram> programs;
+  programs.reserve(subexpressions.size());
+  for (ExecutionPathView subexpression : subexpressions) {
+    programs.push_back(EncodeCompactProgram(subexpression));
+  }
+  return programs;
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,40 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_COMPACT_PROGRAM_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_COMPACT_PROGRAM_H_
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "eval/eval/evaluator_core.h"
+
+namespace google::api::expr::runtime {
+
+// Encodes a planned program into the tagged representation run by the
+// ExecutionFrame compact dispatch loop.
+//
+// Constants and jumps are lowered to inline opcodes. Any other step
+// (including extension steps) is kept as a virtual dispatch fallback. Jumps
+// with an unset or out of range offset also fall back so the step reports the
+// error as it would in the default loop.
+CompactProgram EncodeCompactProgram(ExecutionPathView path);
+
+// Encodes each subexpression of a flattened program.
+std::vector<CompactProgram> EncodeCompactPrograms(
+    absl::Span<const ExecutionPathView> subexpressions);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_COMPACT_PROGRAM_H_
@@ -0,0 +1,191 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "eval/eval/compact_program.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/handle.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "eval/eval/const_value_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/jump_step.h"
+#include "extensions/protobuf/memory_manager.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "runtime/activation.h"
+#include "runtime/runtime_options.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::extensions::ProtoMemoryManagerRef;
+using testing::ElementsAre;
+using testing::Field;
+using testing::HasSubstr;
+using cel::internal::StatusIs;
+
+class CompactProgramTest : public testing::Test {
+ public:
+  CompactProgramTest()
+      : type_factory_(ProtoMemoryManagerRef(&arena_)),
+        type_manager_(type_factory_, cel::TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+ protected:
+  std::unique_ptr<ExpressionStep> Const(int64_t value,
+                                        int64_t expr_id = -1) {
+    return CreateConstValueStep(value_factory_.CreateIntValue(value), expr_id)
+        .value();
+  }
+
+  std::unique_ptr<ExpressionStep> ConstBool(bool value) {
+    return CreateConstValueStep(value_factory_.CreateBoolValue(value), -1)
+        .value();
+  }
+
+  google::protobuf::Arena arena_;
+  cel::TypeFactory type_factory_;
+  cel::TypeManager type_manager_;
+  cel::ValueFactory value_factory_;
+  cel::Activation empty_activation_;
+};
+
+// Step without a dedicated opcode.
+class PlusOneStep : public ExpressionStep {
+ public:
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    int64_t value =
+        frame->value_stack().Peek()->As<cel::IntValue>().NativeValue();
+    frame->value_stack().PopAndPush(
+        frame->value_factory().CreateIntValue(value + 1));
+    return absl::OkStatus();
+  }
+
+  int64_t id() const override { return 0; }
+
+  bool ComesFromAst() const override { return true; }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId();
+  }
+};
+
+TEST_F(CompactProgramTest, EncodesOpcodes) {
+  ExecutionPath path;
+  path.push_back(Const(1, 10));
+  path.push_back(std::move(CreateJumpStep(1, -1)).value());
+  path.push_back(std::move(CreateCondJumpStep(true, false, 0, -1)).value());
+  path.push_back(std::make_unique<PlusOneStep>());
+  path.push_back(std::move(CreateJumpStep(absl::nullopt, -1)).value());
+  path.push_back(std::move(CreateJumpStep(100, -1)).value());
+
+  CompactProgram program = EncodeCompactProgram(path);
+
+  EXPECT_THAT(program,
+              ElementsAre(Field(&CompactStep::opcode, CompactOpcode::kConstant),
+                          Field(&CompactStep::opcode, CompactOpcode::kJump),
+                          Field(&CompactStep::opcode, CompactOpcode::kCondJump),
+                          Field(&CompactStep::opcode, CompactOpcode::kVirtual),
+                          // Unset offset.
+                          Field(&CompactStep::opcode, CompactOpcode::kVirtual),
+                          // Out of range.
+                          Field(&CompactStep::opcode, CompactOpcode::kVirtual)));
+  EXPECT_EQ(program[0].expr_id, 10);
+  EXPECT_TRUE(program[0].comes_from_ast);
+  EXPECT_EQ(program[2].jump_condition, true);
+  EXPECT_EQ(program[2].leave_on_stack, false);
+  for (size_t i = 0; i < path.size(); ++i) {
+    EXPECT_EQ(program[i].step, path[i].get());
+  }
+}
+
+TEST_F(CompactProgramTest, EvaluatesBranches) {
+  for (bool condition : {true, false}) {
+    ExecutionPath path;
+    // condition ? 1 + 1 : 2 + 1
+    path.push_back(ConstBool(condition));
+    path.push_back(std::move(CreateCondJumpStep(false, false, 2, -1)).value());
+    path.push_back(Const(1));
+    path.push_back(std::move(CreateJumpStep(1, -1)).value());
+    path.push_back(Const(2));
+    path.push_back(std::make_unique<PlusOneStep>());
+
+    FlatExpression expr(std::move(path), /*comprehension_slots_size=*/0,
+                        cel::TypeProvider::Builtin(), cel::RuntimeOptions{});
+    expr.set_compact_programs(EncodeCompactPrograms({expr.path()}));
+    ASSERT_TRUE(expr.has_compact_programs());
+
+    FlatExpressionEvaluatorState state =
+        expr.MakeEvaluatorState(ProtoMemoryManagerRef(&arena_));
+    ASSERT_OK_AND_ASSIGN(
+        cel::Handle<cel::Value> result,
+        expr.EvaluateWithCallback(empty_activation_, EvaluationListener(),
+                                  state));
+
+    ASSERT_TRUE(result->Is<cel::IntValue>());
+    EXPECT_EQ(result->As<cel::IntValue>().NativeValue(), condition ? 2 : 3);
+  }
+}
+
+TEST_F(CompactProgramTest, OutOfRangeJumpReportsError) {
+  ExecutionPath path;
+  path.push_back(Const(1));
+  path.push_back(std::move(CreateJumpStep(100, -1)).value());
+
+  FlatExpression expr(std::move(path), /*comprehension_slots_size=*/0,
+                      cel::TypeProvider::Builtin(), cel::RuntimeOptions{});
+  expr.set_compact_programs(EncodeCompactPrograms({expr.path()}));
+
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(ProtoMemoryManagerRef(&arena_));
+  EXPECT_THAT(
+      expr.EvaluateWithCallback(empty_activation_, EvaluationListener(), state),
+      StatusIs(absl::StatusCode::kInternal,
+               HasSubstr("Jump address out of range")));
+}
+
+TEST_F(CompactProgramTest, ListenerCalledForAstSteps) {
+  ExecutionPath path;
+  path.push_back(Const(1, 1));
+  path.push_back(std::make_unique<PlusOneStep>());
+
+  FlatExpression expr(std::move(path), /*comprehension_slots_size=*/0,
+                      cel::TypeProvider::Builtin(), cel::RuntimeOptions{});
+  expr.set_compact_programs(EncodeCompactPrograms({expr.path()}));
+
+  std::vector<int64_t> ids;
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(ProtoMemoryManagerRef(&arena_));
+  ASSERT_OK(expr.EvaluateWithCallback(
+      empty_activation_,
+      [&](int64_t id, const cel::Handle<cel::Value>&, cel::ValueFactory&) {
+        ids.push_back(id);
+        return absl::OkStatus();
+      },
+      state));
+
+  EXPECT_THAT(ids, ElementsAre(1, 0));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
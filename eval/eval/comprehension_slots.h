@@ -20,7 +20,6 @@
 #include <vector>
 
 #include "absl/base/macros.h"
-#include "absl/types/optional.h"
 #include "base/handle.h"
 #include "base/value.h"
 #include "eval/eval/attribute_trail.h"
@@ -41,7 +40,8 @@ class ComprehensionSlots {
     AttributeTrail attribute;
   };
 
-  explicit ComprehensionSlots(size_t size) : size_(size), slots_(size) {}
+  explicit ComprehensionSlots(size_t size)
+      : slots_(size), present_(size, false), used_(0) {}
 
   // Move only
   ComprehensionSlots(const ComprehensionSlots&) = delete;
@@ -53,36 +53,69 @@ class ComprehensionSlots {
   // If not set, returns nullptr.
   Slot* Get(size_t index) {
     ABSL_ASSERT(index >= 0 && index < slots_.size());
-    auto& slot = slots_[index];
-    if (!slot.has_value()) return nullptr;
-    return &slot.value();
+    if (!present_[index]) return nullptr;
+    return &slots_[index];
   }
 
+  // Clears all slots. Only the prefix of slots written since the last reset
+  // is touched and capacity is retained, so this does not allocate.
   void Reset() {
-    slots_.clear();
-    slots_.resize(size_);
+    for (size_t i = 0; i < used_; ++i) {
+      ClearSlot(i);
+    }
+    used_ = 0;
   }
 
   void ClearSlot(size_t index) {
     ABSL_ASSERT(index >= 0 && index < slots_.size());
-    slots_[index] = absl::nullopt;
+    Slot& slot = slots_[index];
+    // Release the value (and attribute) so that nothing outlives the
+    // evaluation that produced it.
+    slot.value = cel::Handle<cel::Value>();
+    if (!slot.attribute.empty()) {
+      slot.attribute = AttributeTrail();
+    }
+    present_[index] = false;
   }
 
+  // Sets the value of a slot without an attribute. This is the fast path
+  // for evaluation without attribute tracking: the slot is updated in place
+  // and no AttributeTrail is constructed unless one needs to be cleared.
   void Set(size_t index, cel::Handle<cel::Value> value) {
-    Set(index, std::move(value), AttributeTrail());
+    ABSL_ASSERT(index >= 0 && index < slots_.size());
+    Slot& slot = slots_[index];
+    slot.value = std::move(value);
+    if (!slot.attribute.empty()) {
+      slot.attribute = AttributeTrail();
+    }
+    MarkPresent(index);
   }
 
   void Set(size_t index, cel::Handle<cel::Value> value,
            AttributeTrail attribute) {
     ABSL_ASSERT(index >= 0 && index < slots_.size());
-    slots_[index] = Slot{std::move(value), std::move(attribute)};
+    Slot& slot = slots_[index];
+    slot.value = std::move(value);
+    slot.attribute = std::move(attribute);
+    MarkPresent(index);
   }
 
   size_t size() const { return slots_.size(); }
 
  private:
-  size_t size_;
-  std::vector<absl::optional<Slot>> slots_;
+  void MarkPresent(size_t index) {
+    present_[index] = true;
+    if (index >= used_) {
+      used_ = index + 1;
+    }
+  }
+
+  // Slots are stored flat; whether a slot is set is tracked separately so
+  // that updating a slot does not reconstruct it.
+  std::vector<Slot> slots_;
+  std::vector<bool> present_;
+  // One past the highest slot index set since the last Reset.
+  size_t used_;
 };
 
 }  // namespace google::api::expr::runtime
@@ -87,4 +87,31 @@ TEST(ComprehensionSlots, Basic) {
   EXPECT_TRUE(slot3 == nullptr);
 }
 
+TEST(ComprehensionSlots, SetWithoutAttributeClearsAttribute) {
+  TypeFactory tf(MemoryManagerRef::ReferenceCounting());
+  TypeManager tm(tf, TypeProvider::Builtin());
+  ValueFactory factory(tm);
+
+  ComprehensionSlots slots(2);
+
+  slots.Set(1, factory.CreateUncheckedStringValue("abcd"),
+            AttributeTrail(Attribute("fake_attr")));
+  ASSERT_TRUE(slots.Get(1) != nullptr);
+  EXPECT_FALSE(slots.Get(1)->attribute.empty());
+  EXPECT_EQ(slots.Get(0), nullptr);
+
+  slots.Set(1, factory.CreateUncheckedStringValue("efgh"));
+  auto* slot1 = slots.Get(1);
+  ASSERT_TRUE(slot1 != nullptr);
+  EXPECT_TRUE(slot1->attribute.empty());
+  EXPECT_THAT(slot1->value, Truly([](const Handle<Value>& v) {
+                return v->Is<StringValue>() &&
+                       v->As<StringValue>().ToString() == "efgh";
+              }))
+      << "value is 'efgh'";
+
+  slots.Reset();
+  EXPECT_EQ(slots.Get(1), nullptr);
+}
+
 }  // namespace google::api::expr::runtime
@@ -1,15 +1,25 @@
 #include "eval/eval/comprehension_step.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "base/attribute.h"
+#include "base/builtins.h"
 #include "base/kind.h"
+#include "base/memory.h"
+#include "base/type_provider.h"
+#include "base/types/list_type.h"
 #include "base/value.h"
 #include "base/values/bool_value.h"
 #include "base/values/error_value.h"
@@ -21,8 +31,12 @@
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/expression_step_base.h"
 #include "eval/internal/errors.h"
+#include "extensions/protobuf/memory_manager.h"
 #include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/internal/map_keys_list_value.h"
 #include "runtime/internal/mutable_list_impl.h"
+#include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
 namespace {
@@ -30,8 +44,11 @@ namespace {
 using ::cel::Handle;
 using ::cel::UnknownValue;
 using ::cel::Value;
-using ::cel::runtime_internal::CreateNoMatchingOverloadError;
+using ::cel::runtime_internal::ControlFlowContext;
+using ::cel::runtime_internal::DynListType;
+using ::cel::runtime_internal::MutableListType;
 using ::cel::runtime_internal::MutableListValue;
+using ::cel::runtime_internal::NoMatchingOverloadError;
 
 class ComprehensionFinish : public ExpressionStepBase {
  public:
@@ -56,8 +73,7 @@ absl::Status ComprehensionFinish::Evaluate(ExecutionFrame* frame) const {
   }
   Handle<Value> result = frame->value_stack().Peek();
   frame->value_stack().Pop(3);
-  if (frame->enable_comprehension_list_append() &&
-      result->Is<MutableListValue>()) {
+  if (result->Is<MutableListValue>()) {
     // We assume this is 'owned' by the evaluator stack so const cast is safe
     // here.
     // Convert the buildable list to an actual cel::ListValue.
@@ -95,9 +111,12 @@ absl::Status ComprehensionInitStep::ProjectKeys(ExecutionFrame* frame) const {
     }
   }
 
+  // Keys are streamed from the map rather than copied into a list.
   CEL_ASSIGN_OR_RETURN(
-      auto list_keys, frame->value_stack().Peek().As<cel::MapValue>()->ListKeys(
-                          frame->value_factory()));
+      auto list_keys,
+      cel::runtime_internal::MapKeysListValue::Create(
+          frame->value_factory(),
+          frame->value_stack().Peek().As<cel::MapValue>()));
   frame->value_stack().PopAndPush(std::move(list_keys));
   return absl::OkStatus();
 }
@@ -117,7 +136,7 @@ absl::Status ComprehensionInitStep::Evaluate(ExecutionFrame* frame) const {
   if (!range->Is<cel::ListValue>() && !range->Is<cel::ErrorValue>() &&
       !range->Is<cel::UnknownValue>()) {
     frame->value_stack().PopAndPush(frame->value_factory().CreateErrorValue(
-        CreateNoMatchingOverloadError("<iter_range>")));
+        *NoMatchingOverloadError(ControlFlowContext::kIterRange)));
   }
 
   // Initialize current index.
@@ -127,6 +146,331 @@ absl::Status ComprehensionInitStep::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
+
+// Positions of the loop state on the stack during the evaluation of a macro
+// loop.
+enum {
+  kMacroIterRange,
+  kMacroCurrentIndex,
+  kMacroAccu,
+  kMacroBody,
+};
+
+constexpr size_t kMacroLoopStateSize = 3;
+
+// Binds the element after the current index to the iteration variable, then
+// replaces the index and the accumulator of the loop state.
+//
+// Returns false once the range is exhausted, in which case the iteration
+// variable is cleared instead.
+absl::StatusOr<bool> AdvanceMacroLoop(ExecutionFrame* frame, size_t iter_slot,
+                                      Handle<Value> accu) {
+  CEL_RETURN_IF_ERROR(frame->IncrementIterations());
+  auto state = frame->value_stack().GetSpan(kMacroLoopStateSize);
+  const auto& iter_range = state[kMacroIterRange].As<cel::ListValue>();
+  int64_t index =
+      state[kMacroCurrentIndex].As<cel::IntValue>()->NativeValue() + 1;
+  bool has_next = index < static_cast<int64_t>(iter_range->Size());
+  if (has_next) {
+    CEL_ASSIGN_OR_RETURN(auto element,
+                         iter_range->Get(frame->value_factory(),
+                                         static_cast<size_t>(index)));
+    if (frame->enable_unknowns()) {
+      frame->comprehension_slots().Set(
+          iter_slot, std::move(element),
+          frame->value_stack()
+              .GetAttributeSpan(kMacroLoopStateSize)[kMacroIterRange]
+              .Step(cel::AttributeQualifier::OfInt(index)));
+    } else {
+      frame->comprehension_slots().Set(iter_slot, std::move(element));
+    }
+  } else {
+    frame->comprehension_slots().ClearSlot(iter_slot);
+  }
+  frame->value_stack().Pop(2);
+  frame->value_stack().Push(frame->value_factory().CreateIntValue(index));
+  frame->value_stack().Push(std::move(accu));
+  return has_next;
+}
+
+// Returns the result of `accu && predicate` (`accu || predicate` for exists)
+// for the accumulator of all (exists). The accumulator is never the
+// short-circuiting bool, since the loop stops as soon as it is.
+Handle<Value> MergeQuantifierPredicate(ExecutionFrame* frame,
+                                       const Handle<Value>& accu,
+                                       const Handle<Value>& predicate,
+                                       bool is_or) {
+  if (predicate->Is<cel::BoolValue>()) {
+    return predicate.As<cel::BoolValue>()->NativeValue() == is_or ? predicate
+                                                                  : accu;
+  }
+  bool is_unknown =
+      frame->enable_unknowns() && predicate->Is<cel::UnknownValue>();
+  if (accu->Is<cel::BoolValue>()) {
+    if (is_unknown || predicate->Is<cel::ErrorValue>()) {
+      return predicate;
+    }
+    return frame->value_factory().CreateErrorValue(
+        *NoMatchingOverloadError(is_or ? ControlFlowContext::kLogicalOr
+                                       : ControlFlowContext::kLogicalAnd));
+  }
+  // As for the logical operators, unknowns take precedence over errors.
+  if (is_unknown) {
+    if (accu->Is<cel::UnknownValue>()) {
+      const Handle<Value> args[] = {accu, predicate};
+      absl::optional<Handle<UnknownValue>> unknown_set =
+          frame->attribute_utility().MergeUnknowns(args);
+      if (unknown_set.has_value()) {
+        return *std::move(unknown_set);
+      }
+    }
+    return predicate;
+  }
+  return accu;
+}
+
+// Returns the result of `predicate ? <next> : accu` for a predicate that does
+// not hold, following the short-circuiting conditional.
+Handle<Value> MergeFalsePredicate(ExecutionFrame* frame,
+                                  const Handle<Value>& accu,
+                                  const Handle<Value>& predicate) {
+  if (predicate->Is<cel::BoolValue>()) {
+    return accu;
+  }
+  if (predicate->Is<cel::ErrorValue>() || predicate->Is<cel::UnknownValue>()) {
+    return predicate;
+  }
+  return frame->value_factory().CreateErrorValue(
+      *NoMatchingOverloadError(ControlFlowContext::kJumpCondition));
+}
+
+// Returns the result of `predicate ? accu + 1 : accu` for the accumulator of
+// exists_one.
+Handle<Value> CountPredicate(ExecutionFrame* frame, const Handle<Value>& accu,
+                             const Handle<Value>& predicate) {
+  if (predicate->Is<cel::BoolValue>() &&
+      predicate.As<cel::BoolValue>()->NativeValue()) {
+    if (!accu->Is<cel::IntValue>()) {
+      // Errors and unknowns are forwarded by the addition.
+      return accu;
+    }
+    return frame->value_factory().CreateIntValue(
+        accu.As<cel::IntValue>()->NativeValue() + 1);
+  }
+  return MergeFalsePredicate(frame, accu, predicate);
+}
+
+// Returns the result of `accu + [transform]` for the accumulator of map,
+// appending to the accumulator in place if it is still a list.
+absl::StatusOr<Handle<Value>> AppendTransform(
+    ExecutionFrame* frame, const Handle<Value>& accu,
+    const Handle<Value>& transform, const AttributeTrail& transform_trail) {
+  if (accu->Is<cel::ErrorValue>()) {
+    return accu;
+  }
+  if (transform->Is<cel::ErrorValue>()) {
+    return transform;
+  }
+  if (frame->enable_unknowns()) {
+    absl::optional<Handle<UnknownValue>> unknown_set =
+        frame->attribute_utility().IdentifyAndMergeUnknowns(
+            absl::MakeConstSpan(&transform, 1),
+            absl::MakeConstSpan(&transform_trail, 1),
+            /*use_partial=*/true);
+    if (unknown_set.has_value() || accu->Is<cel::UnknownValue>()) {
+      if (!unknown_set.has_value()) {
+        return accu;
+      }
+      if (!accu->Is<cel::UnknownValue>()) {
+        return *std::move(unknown_set);
+      }
+      const Handle<Value> args[] = {accu, *std::move(unknown_set)};
+      return *frame->attribute_utility().MergeUnknowns(args);
+    }
+  }
+  if (!accu->Is<MutableListValue>()) {
+    return absl::InternalError(
+        absl::StrCat("ComprehensionMacroNextStep: want list accumulator, got ",
+                     accu->DebugString()));
+  }
+  // The accumulator is owned by the loop state, so mutating it is safe.
+  CEL_RETURN_IF_ERROR(
+      const_cast<MutableListValue&>(accu->As<MutableListValue>())
+          .Append(transform));
+  return accu;
+}
+
+// Returns whether the predicate of all (exists) decides the result.
+bool IsDecidingPredicate(const Handle<Value>& predicate, bool is_or) {
+  return predicate->Is<cel::BoolValue>() &&
+         predicate.As<cel::BoolValue>()->NativeValue() == is_or;
+}
+
+// Returns whether values can be allocated from memory_manager on multiple
+// threads at once.
+bool IsThreadSafe(cel::MemoryManagerRef memory_manager) {
+  return memory_manager.memory_management() ==
+             cel::MemoryManagement::kReferenceCounting ||
+         cel::extensions::ProtoMemoryManagerArena(memory_manager) != nullptr;
+}
+
+// Shared, read-only description of a macro loop that is evaluated in chunks
+// on multiple threads.
+struct ParallelMacroLoop {
+  ComprehensionMacroKind kind;
+  size_t iter_slot;
+  const cel::ListValue& iter_range;
+  // Only set if unknowns are enabled.
+  AttributeTrail iter_range_trail;
+  ExecutionPathView predicate;
+  ExecutionPathView transform;
+  const cel::ActivationInterface& activation;
+  absl::Span<const Handle<Value>> bound_variables;
+  const cel::RuntimeOptions& options;
+  const cel::TypeProvider& type_provider;
+  cel::MemoryManagerRef memory_manager;
+  bool enable_unknowns;
+  bool enable_attribute_tracking;
+};
+
+// Result of the loop body for a single element.
+struct MacroBodyResult {
+  Handle<Value> value;
+  AttributeTrail trail;
+  // Whether value is the result of the transform. Otherwise it is the result
+  // of the predicate.
+  bool is_transform = false;
+};
+
+// A contiguous range of elements evaluated on the same thread.
+struct MacroChunk {
+  size_t begin = 0;
+  size_t end = 0;
+  // Body results in element order. Stops after the first deciding element of
+  // all and exists, or before the element that failed with status.
+  std::vector<MacroBodyResult> results;
+  absl::Status status;
+};
+
+// Evaluates body in frame and moves its result into result.
+absl::Status EvaluateMacroBody(ExecutionFrame& frame, MacroBodyResult& result) {
+  CEL_RETURN_IF_ERROR(frame.EvaluateInPlace());
+  result.value = frame.value_stack().Peek();
+  result.trail = frame.value_stack().PeekAttribute();
+  frame.value_stack().Pop(1);
+  return absl::OkStatus();
+}
+
+// Evaluates the loop body for the elements of chunk, with its own value
+// stack, slots and value factory. Elements after deciding_index, the lowest
+// index of a deciding element found by any chunk so far, are skipped.
+void EvaluateMacroChunk(const ParallelMacroLoop& loop, MacroChunk& chunk,
+                        std::atomic<size_t>& deciding_index) {
+  FlatExpressionEvaluatorState state(
+      loop.predicate.size() + loop.transform.size(), loop.iter_slot + 1,
+      loop.type_provider, loop.memory_manager, loop.enable_attribute_tracking);
+  ExecutionFrame predicate_frame(loop.predicate, loop.activation, loop.options,
+                                 state);
+  ExecutionFrame transform_frame(loop.transform, loop.activation, loop.options,
+                                 state);
+  predicate_frame.set_bound_variables(loop.bound_variables);
+  transform_frame.set_bound_variables(loop.bound_variables);
+  const bool is_quantifier = loop.kind == ComprehensionMacroKind::kAll ||
+                             loop.kind == ComprehensionMacroKind::kExists;
+  const bool is_or = loop.kind == ComprehensionMacroKind::kExists;
+
+  chunk.results.reserve(chunk.end - chunk.begin);
+  for (size_t index = chunk.begin; index < chunk.end; ++index) {
+    if (is_quantifier &&
+        index > deciding_index.load(std::memory_order_relaxed)) {
+      break;
+    }
+    absl::StatusOr<Handle<Value>> element =
+        loop.iter_range.Get(state.value_factory(), index);
+    if (!element.ok()) {
+      chunk.status = element.status();
+      return;
+    }
+    if (loop.enable_unknowns) {
+      state.comprehension_slots().Set(
+          loop.iter_slot, *std::move(element),
+          loop.iter_range_trail.Step(cel::AttributeQualifier::OfInt(index)));
+    } else {
+      state.comprehension_slots().Set(loop.iter_slot, *std::move(element));
+    }
+
+    MacroBodyResult result;
+    if (!loop.predicate.empty()) {
+      chunk.status = EvaluateMacroBody(predicate_frame, result);
+    }
+    if (chunk.status.ok() && loop.kind == ComprehensionMacroKind::kMap &&
+        (loop.predicate.empty() ||
+         IsDecidingPredicate(result.value, /*is_or=*/true))) {
+      result.is_transform = true;
+      chunk.status = EvaluateMacroBody(transform_frame, result);
+    }
+    if (!chunk.status.ok()) {
+      return;
+    }
+    bool deciding = is_quantifier && IsDecidingPredicate(result.value, is_or);
+    chunk.results.push_back(std::move(result));
+    if (deciding) {
+      size_t current = deciding_index.load(std::memory_order_relaxed);
+      while (index < current &&
+             !deciding_index.compare_exchange_weak(current, index,
+                                                   std::memory_order_relaxed)) {
+      }
+      break;
+    }
+  }
+}
+
+class ComprehensionMacroFinish : public ExpressionStepBase {
+ public:
+  ComprehensionMacroFinish(ComprehensionMacroKind kind, size_t iter_slot,
+                           int64_t expr_id)
+      : ExpressionStepBase(expr_id), kind_(kind), iter_slot_(iter_slot) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  ComprehensionMacroKind kind_;
+  size_t iter_slot_;
+};
+
+// Stack changes of ComprehensionMacroFinish.
+//
+// Stack size before: 3.
+// Stack size after: 1.
+absl::Status ComprehensionMacroFinish::Evaluate(ExecutionFrame* frame) const {
+  if (!frame->value_stack().HasEnough(kMacroLoopStateSize)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+  Handle<Value> result = frame->value_stack().Peek();
+  frame->value_stack().Pop(kMacroLoopStateSize);
+  switch (kind_) {
+    case ComprehensionMacroKind::kAll:
+    case ComprehensionMacroKind::kExists:
+      break;
+    case ComprehensionMacroKind::kExistsOne:
+      if (result->Is<cel::IntValue>()) {
+        result = frame->value_factory().CreateBoolValue(
+            result.As<cel::IntValue>()->NativeValue() == 1);
+      }
+      break;
+    case ComprehensionMacroKind::kMap:
+      if (result->Is<MutableListValue>()) {
+        MutableListValue& list_value =
+            const_cast<MutableListValue&>(result->As<MutableListValue>());
+        CEL_ASSIGN_OR_RETURN(result, std::move(list_value).Build());
+      }
+      break;
+  }
+  frame->value_stack().Push(std::move(result));
+  frame->comprehension_slots().ClearSlot(iter_slot_);
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 // Stack variables during comprehension evaluation:
@@ -198,7 +542,7 @@ absl::Status ComprehensionNextStep::Evaluate(ExecutionFrame* frame) const {
       frame->value_stack().Push(std::move(iter_range));
     } else {
       frame->value_stack().Push(frame->value_factory().CreateErrorValue(
-          CreateNoMatchingOverloadError("<iter_range>")));
+          *NoMatchingOverloadError(ControlFlowContext::kIterRange)));
     }
     return frame->JumpTo(error_jump_offset_);
   }
@@ -244,8 +588,12 @@ absl::Status ComprehensionNextStep::Evaluate(ExecutionFrame* frame) const {
                                            static_cast<size_t>(current_index)));
   frame->value_stack().PopAndPush(
       frame->value_factory().CreateIntValue(current_index));
-  frame->comprehension_slots().Set(iter_slot_, std::move(current_value),
-                                   std::move(iter_trail));
+  if (frame->enable_unknowns()) {
+    frame->comprehension_slots().Set(iter_slot_, std::move(current_value),
+                                     std::move(iter_trail));
+  } else {
+    frame->comprehension_slots().Set(iter_slot_, std::move(current_value));
+  }
   return absl::OkStatus();
 }
 
@@ -287,7 +635,7 @@ absl::Status ComprehensionCondStep::Evaluate(ExecutionFrame* frame) const {
       frame->value_stack().Push(std::move(loop_condition_value));
     } else {
       frame->value_stack().Push(frame->value_factory().CreateErrorValue(
-          CreateNoMatchingOverloadError("<loop_condition>")));
+          *NoMatchingOverloadError(ControlFlowContext::kLoopCondition)));
     }
     // The error jump skips the ComprehensionFinish clean-up step, so we
     // need to update the iteration variable stack here.
@@ -304,6 +652,289 @@ absl::Status ComprehensionCondStep::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
+ComprehensionMacroStartStep::ComprehensionMacroStartStep(
+    ComprehensionMacroKind kind, size_t iter_slot, int64_t expr_id)
+    : ExpressionStepBase(expr_id, false),
+      kind_(kind),
+      iter_slot_(iter_slot),
+      list_type_(DynListType()),
+      mutable_list_type_(MutableListType::Get()) {}
+
+void ComprehensionMacroStartStep::set_finish_jump_offset(int offset) {
+  finish_jump_offset_ = offset;
+}
+
+void ComprehensionMacroStartStep::set_error_jump_offset(int offset) {
+  error_jump_offset_ = offset;
+}
+
+void ComprehensionMacroStartStep::set_parallel_body(int predicate_size,
+                                                    int transform_offset,
+                                                    int transform_size) {
+  parallel_ = true;
+  predicate_size_ = predicate_size;
+  transform_offset_ = transform_offset;
+  transform_size_ = transform_size;
+}
+
+// Stack changes of ComprehensionMacroStartStep.
+//
+// Stack size before: 2.
+// Stack size after: 3.
+// Stack size on error: 1.
+absl::Status ComprehensionMacroStartStep::Evaluate(
+    ExecutionFrame* frame) const {
+  if (!frame->value_stack().HasEnough(2)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+  const auto& iter_range = frame->value_stack().GetSpan(2)[kMacroIterRange];
+  if (!iter_range->Is<cel::ListValue>()) {
+    Handle<Value> result = iter_range;
+    if (!result->Is<cel::ErrorValue>() && !result->Is<cel::UnknownValue>()) {
+      result = frame->value_factory().CreateErrorValue(
+          *NoMatchingOverloadError(ControlFlowContext::kIterRange));
+    }
+    frame->value_stack().Pop(2);
+    frame->value_stack().Push(std::move(result));
+    return frame->JumpTo(error_jump_offset_);
+  }
+
+  Handle<Value> accu;
+  switch (kind_) {
+    case ComprehensionMacroKind::kAll:
+      accu = frame->value_factory().CreateBoolValue(true);
+      break;
+    case ComprehensionMacroKind::kExists:
+      accu = frame->value_factory().CreateBoolValue(false);
+      break;
+    case ComprehensionMacroKind::kExistsOne:
+      accu = frame->value_factory().CreateIntValue(0);
+      break;
+    case ComprehensionMacroKind::kMap: {
+      CEL_ASSIGN_OR_RETURN(auto builder,
+                           list_type_->NewValueBuilder(frame->value_factory()));
+      CEL_ASSIGN_OR_RETURN(
+          accu, frame->value_factory().CreateOpaqueValue<MutableListValue>(
+                    mutable_list_type_, std::move(builder)));
+      break;
+    }
+  }
+
+  if (parallel_) {
+    const cel::RuntimeOptions& options = frame->options();
+    Handle<cel::ListValue> list = iter_range.As<cel::ListValue>();
+    int64_t size = static_cast<int64_t>(list->Size());
+    // The loop needs one iteration to bind each element and one to find that
+    // the range is exhausted.
+    if (options.parallel_comprehension_threads > 1 &&
+        size >= options.parallel_comprehension_min_size &&
+        frame->supports_concurrent_evaluation() &&
+        frame->HasIterationBudget(size + 1) &&
+        IsThreadSafe(frame->memory_manager())) {
+      return EvaluateParallel(frame, list, std::move(accu));
+    }
+  }
+
+  frame->value_stack().Push(accu);
+
+  CEL_ASSIGN_OR_RETURN(bool has_next,
+                       AdvanceMacroLoop(frame, iter_slot_, std::move(accu)));
+  if (!has_next) {
+    return frame->JumpTo(finish_jump_offset_);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ComprehensionMacroStartStep::EvaluateParallel(
+    ExecutionFrame* frame, const Handle<cel::ListValue>& iter_range,
+    Handle<Value> accu) const {
+  ExecutionPathView body = frame->remaining_path();
+  ParallelMacroLoop loop{
+      kind_,
+      iter_slot_,
+      *iter_range,
+      AttributeTrail(),
+      body.subspan(0, predicate_size_),
+      body.subspan(transform_offset_, transform_size_),
+      frame->modern_activation(),
+      frame->bound_variables(),
+      frame->options(),
+      frame->type_manager().type_provider(),
+      frame->memory_manager(),
+      frame->enable_unknowns(),
+      frame->enable_attribute_tracking()};
+  if (loop.enable_unknowns) {
+    loop.iter_range_trail =
+        frame->value_stack().GetAttributeSpan(2)[kMacroIterRange];
+  }
+
+  size_t size = iter_range->Size();
+  // Ranges streaming their elements, such as the keys of a map, keep a cursor
+  // bound to the value factory of the first access. Make that the factory of
+  // the frame, which outlives the per-chunk factories, so the chunks
+  // themselves never create a cursor.
+  if (size > 0) {
+    CEL_RETURN_IF_ERROR(iter_range->Get(frame->value_factory(), 0).status());
+  }
+  size_t chunk_count = std::min(
+      static_cast<size_t>(frame->options().parallel_comprehension_threads),
+      size);
+  std::vector<MacroChunk> chunks(chunk_count);
+  for (size_t i = 0; i < chunk_count; ++i) {
+    chunks[i].begin = size * i / chunk_count;
+    chunks[i].end = size * (i + 1) / chunk_count;
+  }
+  std::atomic<size_t> deciding_index(size);
+  {
+    std::vector<std::thread> threads;
+    threads.reserve(chunk_count > 0 ? chunk_count - 1 : 0);
+    for (size_t i = 1; i < chunk_count; ++i) {
+      threads.emplace_back([&loop, &chunks, &deciding_index, i]() {
+        EvaluateMacroChunk(loop, chunks[i], deciding_index);
+      });
+    }
+    if (chunk_count > 0) {
+      EvaluateMacroChunk(loop, chunks[0], deciding_index);
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Merge the results in range order, as the sequential loop would.
+  const bool is_or = kind_ == ComprehensionMacroKind::kExists;
+  int64_t iterations = 1;
+  bool decided = false;
+  for (const MacroChunk& chunk : chunks) {
+    for (const MacroBodyResult& result : chunk.results) {
+      ++iterations;
+      switch (kind_) {
+        case ComprehensionMacroKind::kAll:
+        case ComprehensionMacroKind::kExists:
+          accu = MergeQuantifierPredicate(frame, accu, result.value, is_or);
+          decided = IsDecidingPredicate(accu, is_or);
+          break;
+        case ComprehensionMacroKind::kExistsOne:
+          accu = CountPredicate(frame, accu, result.value);
+          break;
+        case ComprehensionMacroKind::kMap:
+          if (result.is_transform) {
+            CEL_ASSIGN_OR_RETURN(accu, AppendTransform(frame, accu,
+                                                       result.value,
+                                                       result.trail));
+          } else {
+            accu = MergeFalsePredicate(frame, accu, result.value);
+          }
+          break;
+      }
+      if (decided) {
+        break;
+      }
+    }
+    if (decided) {
+      break;
+    }
+    CEL_RETURN_IF_ERROR(chunk.status);
+  }
+
+  frame->ChargeIterations(iterations);
+  frame->value_stack().Push(std::move(accu));
+  return frame->JumpTo(finish_jump_offset_);
+}
+
+ComprehensionMacroFilterStep::ComprehensionMacroFilterStep(size_t iter_slot,
+                                                           int64_t expr_id)
+    : ExpressionStepBase(expr_id, false), iter_slot_(iter_slot) {}
+
+void ComprehensionMacroFilterStep::set_jump_offset(int offset) {
+  jump_offset_ = offset;
+}
+
+void ComprehensionMacroFilterStep::set_finish_jump_offset(int offset) {
+  finish_jump_offset_ = offset;
+}
+
+// Stack changes of ComprehensionMacroFilterStep.
+//
+// Stack size before: 4.
+// Stack size after: 3.
+absl::Status ComprehensionMacroFilterStep::Evaluate(
+    ExecutionFrame* frame) const {
+  if (!frame->value_stack().HasEnough(kMacroLoopStateSize + 1)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+  auto state = frame->value_stack().GetSpan(kMacroLoopStateSize + 1);
+  const auto& predicate = state[kMacroBody];
+  if (predicate->Is<cel::BoolValue>() &&
+      predicate.As<cel::BoolValue>()->NativeValue()) {
+    frame->value_stack().Pop(1);
+    return absl::OkStatus();
+  }
+  Handle<Value> accu = MergeFalsePredicate(frame, state[kMacroAccu], predicate);
+  frame->value_stack().Pop(1);
+  CEL_ASSIGN_OR_RETURN(bool has_next,
+                       AdvanceMacroLoop(frame, iter_slot_, std::move(accu)));
+  return frame->JumpTo(has_next ? jump_offset_ : finish_jump_offset_);
+}
+
+ComprehensionMacroNextStep::ComprehensionMacroNextStep(
+    ComprehensionMacroKind kind, size_t iter_slot, int64_t expr_id)
+    : ExpressionStepBase(expr_id, false), kind_(kind), iter_slot_(iter_slot) {}
+
+void ComprehensionMacroNextStep::set_jump_offset(int offset) {
+  jump_offset_ = offset;
+}
+
+// Stack changes of ComprehensionMacroNextStep.
+//
+// Stack size before: 4.
+// Stack size after: 3.
+absl::Status ComprehensionMacroNextStep::Evaluate(ExecutionFrame* frame) const {
+  if (!frame->value_stack().HasEnough(kMacroLoopStateSize + 1)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+  auto state = frame->value_stack().GetSpan(kMacroLoopStateSize + 1);
+  Handle<Value> accu;
+  bool decided = false;
+  switch (kind_) {
+    case ComprehensionMacroKind::kAll:
+    case ComprehensionMacroKind::kExists: {
+      bool is_or = kind_ == ComprehensionMacroKind::kExists;
+      accu = MergeQuantifierPredicate(frame, state[kMacroAccu],
+                                      state[kMacroBody], is_or);
+      decided = accu->Is<cel::BoolValue>() &&
+                accu.As<cel::BoolValue>()->NativeValue() == is_or;
+      break;
+    }
+    case ComprehensionMacroKind::kExistsOne:
+      accu = CountPredicate(frame, state[kMacroAccu], state[kMacroBody]);
+      break;
+    case ComprehensionMacroKind::kMap: {
+      CEL_ASSIGN_OR_RETURN(
+          accu, AppendTransform(frame, state[kMacroAccu], state[kMacroBody],
+                                frame->value_stack().PeekAttribute()));
+      break;
+    }
+  }
+  frame->value_stack().Pop(1);
+
+  if (decided) {
+    // Account for the iteration that the general loop starts before checking
+    // the loop condition.
+    CEL_RETURN_IF_ERROR(frame->IncrementIterations());
+    frame->comprehension_slots().ClearSlot(iter_slot_);
+    frame->value_stack().PopAndPush(std::move(accu));
+    return absl::OkStatus();
+  }
+
+  CEL_ASSIGN_OR_RETURN(bool has_next,
+                       AdvanceMacroLoop(frame, iter_slot_, std::move(accu)));
+  if (has_next) {
+    return frame->JumpTo(jump_offset_);
+  }
+  return absl::OkStatus();
+}
+
 std::unique_ptr<ExpressionStep> CreateComprehensionFinishStep(size_t accu_slot,
                                                               int64_t expr_id) {
   return std::make_unique<ComprehensionFinish>(accu_slot, expr_id);
@@ -313,4 +944,9 @@ std::unique_ptr<ExpressionStep> CreateComprehensionInitStep(int64_t expr_id) {
   return std::make_unique<ComprehensionInitStep>(expr_id);
 }
 
+std::unique_ptr<ExpressionStep> CreateComprehensionMacroFinishStep(
+    ComprehensionMacroKind kind, size_t iter_slot, int64_t expr_id) {
+  return std::make_unique<ComprehensionMacroFinish>(kind, iter_slot, expr_id);
+}
+
 }  // namespace google::api::expr::runtime
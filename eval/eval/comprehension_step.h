@@ -6,8 +6,13 @@
 #include <memory>
 
 #include "absl/status/status.h"
+#include "base/handle.h"
+#include "base/types/list_type.h"
+#include "base/value.h"
+#include "base/values/list_value.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/expression_step_base.h"
+#include "runtime/internal/mutable_list_impl.h"
 
 namespace google::api::expr::runtime {
 
@@ -55,6 +60,131 @@ std::unique_ptr<ExpressionStep> CreateComprehensionFinishStep(size_t accu_slot,
 // context for the comprehension.
 std::unique_ptr<ExpressionStep> CreateComprehensionInitStep(int64_t expr_id);
 
+// Standard macros whose comprehensions can be evaluated by a dedicated loop.
+enum class ComprehensionMacroKind {
+  // range.all(x, predicate)
+  kAll,
+  // range.exists(x, predicate)
+  kExists,
+  // range.exists_one(x, predicate)
+  kExistsOne,
+  // range.map(x, transform), range.map(x, predicate, transform) and
+  // range.filter(x, predicate)
+  kMap,
+};
+
+// Stack variables during the evaluation of a macro loop:
+// 0. iter_range (list)
+// 1. current index in iter_range (int64_t)
+// 2. accumulator
+//
+//  instruction                    stack size
+//  0. iter_range                  (dep) 0 -> 1
+//  1. ComprehensionInit                 1 -> 2
+//  2. ComprehensionMacroStartStep       2 -> 3
+//  3. predicate                   (dep) 3 -> 4   (optional for map)
+//  4. ComprehensionMacroFilterStep      4 -> 3   (map with predicate only)
+//  5. transform                   (dep) 3 -> 4   (map only)
+//  6. ComprehensionMacroNextStep        4 -> 3
+//  7. ComprehensionMacroFinish          3 -> 1
+//
+// The accumulator is never visible to the loop body, so the planner must only
+// use these steps if the body does not reference the accumulator variable.
+
+// Pushes the initial accumulator and binds the first element of the range.
+//
+// Jumps to the finish step if the range is empty, or past it with the range
+// value as the result if the range is an error, unknown or not a list.
+//
+// If the loop body is marked as safe for concurrent evaluation, ranges of at
+// least RuntimeOptions::parallel_comprehension_min_size elements are split
+// into chunks that are evaluated on separate threads, each with its own value
+// stack, slots and value factory. The body results are then merged in range
+// order and the step jumps to the finish step.
+class ComprehensionMacroStartStep : public ExpressionStepBase {
+ public:
+  ComprehensionMacroStartStep(ComprehensionMacroKind kind, size_t iter_slot,
+                              int64_t expr_id);
+
+  void set_finish_jump_offset(int offset);
+  void set_error_jump_offset(int offset);
+
+  // Marks the loop body as safe for concurrent evaluation. The body starts
+  // with the step following this one: the predicate is its first
+  // predicate_size steps, and the transform its transform_size steps starting
+  // at transform_offset. Either size is zero if the macro has no predicate or
+  // transform.
+  //
+  // The planner must only mark bodies that reference no variables other than
+  // the iteration variable and don't contain comprehensions.
+  void set_parallel_body(int predicate_size, int transform_offset,
+                         int transform_size);
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  // Evaluates the whole loop over iter_range on multiple threads, leaving
+  // the loop state expected by the finish step on the stack.
+  absl::Status EvaluateParallel(ExecutionFrame* frame,
+                                const cel::Handle<cel::ListValue>& iter_range,
+                                cel::Handle<cel::Value> accu) const;
+
+  ComprehensionMacroKind kind_;
+  size_t iter_slot_;
+  // Types of the accumulator of map, resolved while planning.
+  cel::Handle<cel::ListType> list_type_;
+  cel::Handle<cel::runtime_internal::MutableListType> mutable_list_type_;
+  int finish_jump_offset_;
+  int error_jump_offset_;
+  bool parallel_ = false;
+  int predicate_size_ = 0;
+  int transform_offset_ = 0;
+  int transform_size_ = 0;
+};
+
+// Filters the elements of a map with a predicate.
+//
+// If the predicate holds, continues to the transform. Otherwise, merges the
+// predicate into the accumulator if it is not false, then binds the next
+// element and jumps back to the loop body, or jumps to the finish step.
+class ComprehensionMacroFilterStep : public ExpressionStepBase {
+ public:
+  ComprehensionMacroFilterStep(size_t iter_slot, int64_t expr_id);
+
+  void set_jump_offset(int offset);
+  void set_finish_jump_offset(int offset);
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  size_t iter_slot_;
+  int jump_offset_;
+  int finish_jump_offset_;
+};
+
+// Merges the value of the loop body into the accumulator, then binds the next
+// element and jumps back to the loop body. Falls through to the finish step
+// once the range is exhausted, or once all or exists are decided.
+class ComprehensionMacroNextStep : public ExpressionStepBase {
+ public:
+  ComprehensionMacroNextStep(ComprehensionMacroKind kind, size_t iter_slot,
+                             int64_t expr_id);
+
+  void set_jump_offset(int offset);
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  ComprehensionMacroKind kind_;
+  size_t iter_slot_;
+  int jump_offset_;
+};
+
+// Creates the step that replaces the loop state on the stack with the result
+// of the macro.
+std::unique_ptr<ExpressionStep> CreateComprehensionMacroFinishStep(
+    ComprehensionMacroKind kind, size_t iter_slot, int64_t expr_id);
+
 }  // namespace google::api::expr::runtime
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_COMPREHENSION_STEP_H_
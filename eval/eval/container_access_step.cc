@@ -2,11 +2,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <tuple>
 #include <utility>
 
+#include "absl/base/optimization.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "base/attribute.h"
 #include "base/kind.h"
@@ -44,11 +47,21 @@ using ::cel::runtime_internal::CreateNoSuchKeyError;
 
 inline constexpr int kNumContainerAccessArguments = 2;
 
+// The kind of the key of an index operation, when known at plan time.
+enum class KeyKind { kDynamic, kString, kInt };
+
 // ContainerAccessStep performs message field access specified by Expr::Select
 // message.
+//
+// Steps for a key of known kind skip the numeric normalization of the key
+// before looking it up. Keys of another kind, which a checked expression
+// shouldn't produce, take the generic path.
+template <KeyKind kKeyKind>
 class ContainerAccessStep : public ExpressionStepBase {
  public:
-  explicit ContainerAccessStep(int64_t expr_id) : ExpressionStepBase(expr_id) {}
+  ContainerAccessStep(int64_t expr_id,
+                      absl::optional<AttributeQualifier> key_qualifier)
+      : ExpressionStepBase(expr_id), key_qualifier_(std::move(key_qualifier)) {}
 
   absl::Status Evaluate(ExecutionFrame* frame) const override;
 
@@ -65,6 +78,9 @@ class ContainerAccessStep : public ExpressionStepBase {
   absl::StatusOr<Handle<Value>> LookupInList(const Handle<ListValue>& cel_list,
                                              const Handle<Value>& key,
                                              ExecutionFrame* frame) const;
+
+  // Qualifier for the attribute trail when the key is a constant.
+  absl::optional<AttributeQualifier> key_qualifier_;
 };
 
 absl::optional<Number> CelNumberFromValue(const Handle<Value>& value) {
@@ -110,9 +126,9 @@ AttributeQualifier AttributeQualifierFromValue(const Handle<Value>& v) {
   }
 }
 
-absl::StatusOr<Handle<Value>> ContainerAccessStep::LookupInMap(
+absl::StatusOr<Handle<Value>> LookupInMapGeneric(
     const Handle<MapValue>& cel_map, const Handle<Value>& key,
-    ExecutionFrame* frame) const {
+    ExecutionFrame* frame) {
   if (frame->enable_heterogeneous_numeric_lookups()) {
     // Double isn't a supported key type but may be convertible to an integer.
     absl::optional<Number> number = CelNumberFromValue(key);
@@ -164,9 +180,18 @@ absl::StatusOr<Handle<Value>> ContainerAccessStep::LookupInMap(
   return cel_map->Get(frame->value_factory(), key);
 }
 
-absl::StatusOr<Handle<Value>> ContainerAccessStep::LookupInList(
+absl::StatusOr<Handle<Value>> LookupIndex(const Handle<ListValue>& cel_list,
+                                          int64_t idx, ExecutionFrame* frame) {
+  if (idx < 0 || idx >= cel_list->Size()) {
+    return absl::UnknownError(
+        absl::StrCat("Index error: index=", idx, " size=", cel_list->Size()));
+  }
+  return cel_list->Get(frame->value_factory(), idx);
+}
+
+absl::StatusOr<Handle<Value>> LookupInListGeneric(
     const Handle<ListValue>& cel_list, const Handle<Value>& key,
-    ExecutionFrame* frame) const {
+    ExecutionFrame* frame) {
   absl::optional<int64_t> maybe_idx;
   if (frame->enable_heterogeneous_numeric_lookups()) {
     auto number = CelNumberFromValue(key);
@@ -178,12 +203,7 @@ absl::StatusOr<Handle<Value>> ContainerAccessStep::LookupInList(
   }
 
   if (maybe_idx.has_value()) {
-    int64_t idx = *maybe_idx;
-    if (idx < 0 || idx >= cel_list->Size()) {
-      return absl::UnknownError(
-          absl::StrCat("Index error: index=", idx, " size=", cel_list->Size()));
-    }
-    return cel_list->Get(frame->value_factory(), idx);
+    return LookupIndex(cel_list, *maybe_idx, frame);
   }
 
   return absl::UnknownError(
@@ -191,8 +211,66 @@ absl::StatusOr<Handle<Value>> ContainerAccessStep::LookupInList(
                    cel::KindToString(ValueKindToKind(key->kind()))));
 }
 
-ContainerAccessStep::LookupResult ContainerAccessStep::PerformLookup(
+// Looks up an int key in a map, trying it as a uint next under
+// heterogeneous lookups like LookupInMapGeneric.
+absl::StatusOr<Handle<Value>> LookupIntInMap(const Handle<MapValue>& cel_map,
+                                             const Handle<Value>& key,
+                                             ExecutionFrame* frame) {
+  if (!frame->enable_heterogeneous_numeric_lookups()) {
+    return cel_map->Get(frame->value_factory(), key);
+  }
+  Handle<Value> value;
+  bool ok;
+  CEL_ASSIGN_OR_RETURN(std::tie(value, ok),
+                       cel_map->Find(frame->value_factory(), key));
+  if (ok) {
+    return value;
+  }
+  int64_t int_key = key.As<IntValue>()->NativeValue();
+  if (int_key >= 0) {
+    CEL_ASSIGN_OR_RETURN(
+        std::tie(value, ok),
+        cel_map->Find(frame->value_factory(),
+                      frame->value_factory().CreateUintValue(int_key)));
+    if (ok) {
+      return value;
+    }
+  }
+  return frame->value_factory().CreateErrorValue(
+      CreateNoSuchKeyError(key->DebugString()));
+}
+
+template <KeyKind kKeyKind>
+absl::StatusOr<Handle<Value>> ContainerAccessStep<kKeyKind>::LookupInMap(
+    const Handle<MapValue>& cel_map, const Handle<Value>& key,
     ExecutionFrame* frame) const {
+  if constexpr (kKeyKind == KeyKind::kString) {
+    if (ABSL_PREDICT_TRUE(key->Is<StringValue>())) {
+      return cel_map->Get(frame->value_factory(), key);
+    }
+  } else if constexpr (kKeyKind == KeyKind::kInt) {
+    if (ABSL_PREDICT_TRUE(key->Is<IntValue>())) {
+      return LookupIntInMap(cel_map, key, frame);
+    }
+  }
+  return LookupInMapGeneric(cel_map, key, frame);
+}
+
+template <KeyKind kKeyKind>
+absl::StatusOr<Handle<Value>> ContainerAccessStep<kKeyKind>::LookupInList(
+    const Handle<ListValue>& cel_list, const Handle<Value>& key,
+    ExecutionFrame* frame) const {
+  if constexpr (kKeyKind == KeyKind::kInt) {
+    if (ABSL_PREDICT_TRUE(key->Is<IntValue>())) {
+      return LookupIndex(cel_list, key.As<IntValue>()->NativeValue(), frame);
+    }
+  }
+  return LookupInListGeneric(cel_list, key, frame);
+}
+
+template <KeyKind kKeyKind>
+typename ContainerAccessStep<kKeyKind>::LookupResult
+ContainerAccessStep<kKeyKind>::PerformLookup(ExecutionFrame* frame) const {
   auto input_args = frame->value_stack().GetSpan(kNumContainerAccessArguments);
   AttributeTrail trail;
 
@@ -211,7 +289,9 @@ ContainerAccessStep::LookupResult ContainerAccessStep::PerformLookup(
     absl::Span<const AttributeTrail> input_attrs =
         frame->value_stack().GetAttributeSpan(kNumContainerAccessArguments);
     const auto& container_trail = input_attrs[0];
-    trail = container_trail.Step(AttributeQualifierFromValue(key));
+    trail = container_trail.Step(key_qualifier_.has_value()
+                                     ? *key_qualifier_
+                                     : AttributeQualifierFromValue(key));
 
     if (frame->attribute_utility().CheckForUnknown(trail,
                                                    /*use_partial=*/false)) {
@@ -256,7 +336,9 @@ ContainerAccessStep::LookupResult ContainerAccessStep::PerformLookup(
   }
 }
 
-absl::Status ContainerAccessStep::Evaluate(ExecutionFrame* frame) const {
+template <KeyKind kKeyKind>
+absl::Status ContainerAccessStep<kKeyKind>::Evaluate(
+    ExecutionFrame* frame) const {
   if (!frame->value_stack().HasEnough(kNumContainerAccessArguments)) {
     return absl::Status(
         absl::StatusCode::kInternal,
@@ -273,13 +355,36 @@ absl::Status ContainerAccessStep::Evaluate(ExecutionFrame* frame) const {
 
 // Factory method for Select - based Execution step
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateContainerAccessStep(
-    const cel::ast_internal::Call& call, int64_t expr_id) {
+    const cel::ast_internal::Call& call, int64_t expr_id,
+    absl::optional<cel::Kind> key_kind) {
   int arg_count = call.args().size() + (call.has_target() ? 1 : 0);
   if (arg_count != kNumContainerAccessArguments) {
     return absl::InvalidArgumentError(absl::StrCat(
         "Invalid argument count for index operation: ", arg_count));
   }
-  return std::make_unique<ContainerAccessStep>(expr_id);
+  // The key is the last argument, whether or not the call is receiver style.
+  const cel::ast_internal::Expr& key = call.args().back();
+  if (key.has_const_expr()) {
+    const cel::ast_internal::Constant& constant = key.const_expr();
+    if (constant.has_string_value()) {
+      return std::make_unique<ContainerAccessStep<KeyKind::kString>>(
+          expr_id, AttributeQualifier::OfString(constant.string_value()));
+    }
+    if (constant.has_int64_value()) {
+      return std::make_unique<ContainerAccessStep<KeyKind::kInt>>(
+          expr_id, AttributeQualifier::OfInt(constant.int64_value()));
+    }
+  }
+  if (key_kind == cel::Kind::kString) {
+    return std::make_unique<ContainerAccessStep<KeyKind::kString>>(
+        expr_id, absl::nullopt);
+  }
+  if (key_kind == cel::Kind::kInt) {
+    return std::make_unique<ContainerAccessStep<KeyKind::kInt>>(
+        expr_id, absl::nullopt);
+  }
+  return std::make_unique<ContainerAccessStep<KeyKind::kDynamic>>(
+      expr_id, absl::nullopt);
 }
 
 }  // namespace google::api::expr::runtime
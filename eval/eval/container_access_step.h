@@ -5,14 +5,20 @@
 #include <memory>
 
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "base/ast_internal/expr.h"
+#include "base/kind.h"
 #include "eval/eval/evaluator_core.h"
 
 namespace google::api::expr::runtime {
 
 // Factory method for Select - based Execution step
+//
+// The step is specialized for constant string and int keys, and for keys of
+// key_kind, the kind of the key in a checked expression if known.
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateContainerAccessStep(
-    const cel::ast_internal::Call& call, int64_t expr_id);
+    const cel::ast_internal::Call& call, int64_t expr_id,
+    absl::optional<cel::Kind> key_kind = absl::nullopt);
 
 }  // namespace google::api::expr::runtime
 
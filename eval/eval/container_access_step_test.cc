@@ -10,6 +10,8 @@
 #include "google/protobuf/struct.pb.h"
 #include "google/protobuf/arena.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "base/builtins.h"
 #include "base/type_provider.h"
 #include "eval/eval/cel_expression_flat_impl.h"
@@ -25,6 +27,7 @@
 #include "eval/public/containers/container_backed_map_impl.h"
 #include "eval/public/structs/cel_proto_wrapper.h"
 #include "eval/public/testing/matchers.h"
+#include "internal/status_macros.h"
 #include "internal/testing.h"
 #include "parser/parser.h"
 
@@ -40,6 +43,7 @@ using ::google::protobuf::Struct;
 using testing::_;
 using testing::AllOf;
 using testing::HasSubstr;
+using cel::internal::IsOkAndHolds;
 using cel::internal::StatusIs;
 
 using TestParamType = std::tuple<bool, bool>;
@@ -614,6 +618,74 @@ TEST_F(ContainerAccessHeterogeneousLookupsDisabledTest, StringKeyUnaffected) {
   EXPECT_THAT(result, test::IsCelInt64(3));
 }
 
+class ContainerAccessConstantKeyTest : public testing::Test {
+ public:
+  ContainerAccessConstantKeyTest() {
+    options_.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+    builder_ = CreateCelExpressionBuilder(options_);
+  }
+
+ protected:
+  absl::StatusOr<CelValue> Evaluate(absl::string_view expr_string) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr expr, parser::Parse(expr_string));
+    CEL_ASSIGN_OR_RETURN(auto cel_expr, builder_->CreateExpression(
+                                            &expr.expr(), &expr.source_info()));
+    return cel_expr->Evaluate(activation_, &arena_);
+  }
+
+  InterpreterOptions options_;
+  std::unique_ptr<CelExpressionBuilder> builder_;
+  google::protobuf::Arena arena_;
+  Activation activation_;
+};
+
+TEST_F(ContainerAccessConstantKeyTest, StringKey) {
+  Struct cel_struct;
+  (*cel_struct.mutable_fields())["testkey0"].set_string_value("value0");
+  activation_.InsertValue("container",
+                          CelProtoWrapper::CreateMessage(&cel_struct, &arena_));
+
+  EXPECT_THAT(Evaluate("container['testkey0']"),
+              IsOkAndHolds(test::IsCelString("value0")));
+  EXPECT_THAT(Evaluate("container['testkey1']"),
+              IsOkAndHolds(test::IsCelError(_)));
+
+  activation_.set_unknown_attribute_patterns({CelAttributePattern(
+      "container", {CreateCelAttributeQualifierPattern(
+                       CelValue::CreateStringView("testkey0"))})});
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("container['testkey0']"));
+  EXPECT_TRUE(result.IsUnknownSet());
+}
+
+TEST_F(ContainerAccessConstantKeyTest, IntKey) {
+  EXPECT_THAT(Evaluate("[1, 2, 3][2]"), IsOkAndHolds(test::IsCelInt64(3)));
+  EXPECT_THAT(Evaluate("[1, 2, 3][3]"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kUnknown,
+                           HasSubstr("Index error: index=3 size=3")))));
+  EXPECT_THAT(Evaluate("{1: 2}[1]"), IsOkAndHolds(test::IsCelInt64(2)));
+  EXPECT_THAT(Evaluate("{1: 2}[2]"), IsOkAndHolds(test::IsCelError(_)));
+
+  activation_.set_unknown_attribute_patterns({CelAttributePattern(
+      "container",
+      {CreateCelAttributeQualifierPattern(CelValue::CreateInt64(1))})});
+  ContainerBackedListImpl cel_list(
+      {CelValue::CreateInt64(1), CelValue::CreateInt64(2)});
+  activation_.InsertValue("container", CelValue::CreateList(&cel_list));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Evaluate("container[0]"));
+  EXPECT_THAT(result, test::IsCelInt64(1));
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("container[1]"));
+  EXPECT_TRUE(result.IsUnknownSet());
+}
+
+TEST_F(ContainerAccessConstantKeyTest, KeyOfOtherContainerKind) {
+  EXPECT_THAT(Evaluate("[1, 2, 3]['1']"),
+              IsOkAndHolds(test::IsCelError(
+                  StatusIs(absl::StatusCode::kUnknown,
+                           HasSubstr("expected integer type, got string")))));
+  EXPECT_THAT(Evaluate("{'1': 2}[1]"), IsOkAndHolds(test::IsCelError(_)));
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
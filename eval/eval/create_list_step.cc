@@ -25,6 +25,7 @@ using ::cel::Handle;
 using ::cel::ListType;
 using ::cel::ListValueBuilderInterface;
 using ::cel::UnknownValue;
+using ::cel::runtime_internal::DynListType;
 using ::cel::runtime_internal::MutableListType;
 using ::cel::runtime_internal::MutableListValue;
 
@@ -33,13 +34,19 @@ class CreateListStep : public ExpressionStepBase {
   CreateListStep(int64_t expr_id, int list_size, bool immutable)
       : ExpressionStepBase(expr_id),
         list_size_(list_size),
-        immutable_(immutable) {}
+        immutable_(immutable),
+        list_type_(DynListType()),
+        mutable_list_type_(MutableListType::Get()) {}
 
   absl::Status Evaluate(ExecutionFrame* frame) const override;
 
  private:
   int list_size_;
   bool immutable_;
+  // Resolved while planning, so evaluation does not go through the type
+  // factory.
+  Handle<ListType> list_type_;
+  Handle<MutableListType> mutable_list_type_;
 };
 
 absl::Status CreateListStep::Evaluate(ExecutionFrame* frame) const {
@@ -77,15 +84,11 @@ absl::Status CreateListStep::Evaluate(ExecutionFrame* frame) const {
     }
   }
 
-  auto& type_factory = frame->value_factory().type_factory();
   // TODO(uncreated-issue/50): add option for checking lists have homogenous element
   // types and use a more specific list type.
-  CEL_ASSIGN_OR_RETURN(Handle<ListType> type,
-                       type_factory.CreateListType(type_factory.GetDynType()));
-
   CEL_ASSIGN_OR_RETURN(
       absl::Nonnull<std::unique_ptr<ListValueBuilderInterface>> builder,
-      type->NewValueBuilder(frame->value_factory()));
+      list_type_->NewValueBuilder(frame->value_factory()));
 
   builder->Reserve(args.size());
   for (const auto& arg : args) {
@@ -95,11 +98,9 @@ absl::Status CreateListStep::Evaluate(ExecutionFrame* frame) const {
   if (immutable_) {
     CEL_ASSIGN_OR_RETURN(result, std::move(*builder).Build());
   } else {
-    CEL_ASSIGN_OR_RETURN(auto opaque_type,
-                         type_factory.CreateOpaqueType<MutableListType>());
     CEL_ASSIGN_OR_RETURN(
         result, frame->value_factory().CreateOpaqueValue<MutableListValue>(
-                    std::move(opaque_type), std::move(builder)));
+                    mutable_list_type_, std::move(builder)));
   }
   frame->value_stack().Pop(list_size_);
   frame->value_stack().Push(std::move(result));
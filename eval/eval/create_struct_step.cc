@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/cord.h"
@@ -43,6 +44,7 @@
 #include "internal/overflow.h"
 #include "internal/overloaded.h"
 #include "internal/status_macros.h"
+#include "runtime/internal/convert_constant.h"
 
 namespace google::api::expr::runtime {
 
@@ -66,6 +68,7 @@ using ::cel::UintValue;
 using ::cel::UnknownValue;
 using ::cel::Value;
 using ::cel::ValueFactory;
+using ::cel::runtime_internal::ConvertConstant;
 
 class WellKnownTypeValueBuilder;
 
@@ -808,11 +811,19 @@ WellKnownTypes::WellKnownTypes() {
 // consider just using a view.
 using StructFieldId = absl::variant<std::string, int64_t>;
 
+// A field of the struct being created, resolved when planning.
+struct StructEntry {
+  StructFieldId id;
+  // Hint passed to StructValueBuilderInterface::SetFieldByHint, so that
+  // setting the field skips looking it up. May be nullptr.
+  const void* hint;
+};
+
 // `CreateStruct` implementation for message/struct.
 class CreateStructStepForStruct final : public ExpressionStepBase {
  public:
   CreateStructStepForStruct(int64_t expr_id, Handle<StructType> type,
-                            std::vector<StructFieldId> entries)
+                            std::vector<StructEntry> entries)
       : ExpressionStepBase(expr_id),
         type_(std::move(type)),
         entries_(std::move(entries)) {}
@@ -823,10 +834,10 @@ class CreateStructStepForStruct final : public ExpressionStepBase {
   absl::StatusOr<Handle<Value>> DoEvaluate(ExecutionFrame* frame) const;
 
   static absl::Status SetField(StructValueBuilderInterface& builder,
-                               const StructFieldId& id, Handle<Value> value);
+                               const StructEntry& entry, Handle<Value> value);
 
   Handle<StructType> type_;
-  std::vector<StructFieldId> entries_;
+  std::vector<StructEntry> entries_;
 };
 
 // `CreateStruct` implementation for well known types.
@@ -861,6 +872,22 @@ class CreateStructStepForMap final : public ExpressionStepBase {
   size_t entry_count_;
 };
 
+// `CreateStruct` implementation for map with distinct constant keys, which
+// are created at plan time. Only the values are evaluated.
+class CreateStructStepForConstantKeyMap final : public ExpressionStepBase {
+ public:
+  CreateStructStepForConstantKeyMap(int64_t expr_id,
+                                    std::vector<Handle<Value>> keys)
+      : ExpressionStepBase(expr_id), keys_(std::move(keys)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  absl::StatusOr<Handle<Value>> DoEvaluate(ExecutionFrame* frame) const;
+
+  std::vector<Handle<Value>> keys_;
+};
+
 absl::StatusOr<Handle<Value>> CreateStructStepForStruct::DoEvaluate(
     ExecutionFrame* frame) const {
   int entries_size = entries_.size();
@@ -888,8 +915,14 @@ absl::StatusOr<Handle<Value>> CreateStructStepForStruct::DoEvaluate(
 }
 
 absl::Status CreateStructStepForStruct::SetField(
-    StructValueBuilderInterface& builder, const StructFieldId& id,
+    StructValueBuilderInterface& builder, const StructEntry& entry,
     Handle<Value> value) {
+  if (entry.hint != nullptr) {
+    CEL_ASSIGN_OR_RETURN(bool set, builder.SetFieldByHint(entry.hint, value));
+    if (set) {
+      return absl::OkStatus();
+    }
+  }
   return absl::visit(
       cel::internal::Overloaded{
           [&builder, &value](absl::string_view name) mutable -> absl::Status {
@@ -898,7 +931,7 @@ absl::Status CreateStructStepForStruct::SetField(
           [&builder, &value](int64_t number) mutable -> absl::Status {
             return builder.SetFieldByNumber(number, std::move(value));
           }},
-      id);
+      entry.id);
 }
 
 absl::Status CreateStructStepForStruct::Evaluate(ExecutionFrame* frame) const {
@@ -982,6 +1015,7 @@ absl::StatusOr<Handle<Value>> CreateStructStepForMap::DoEvaluate(
   cel::MapValueBuilder<Value, Value> map_builder(
       frame->value_factory(), frame->type_factory().GetDynType(),
       frame->type_factory().GetDynType());
+  map_builder.Reserve(entry_count_);
 
   for (size_t i = 0; i < entry_count_; i += 1) {
     int map_key_index = 2 * i;
@@ -1010,6 +1044,50 @@ absl::Status CreateStructStepForMap::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
+absl::StatusOr<Handle<Value>> CreateStructStepForConstantKeyMap::DoEvaluate(
+    ExecutionFrame* frame) const {
+  auto values = frame->value_stack().GetSpan(keys_.size());
+
+  if (frame->enable_unknowns()) {
+    absl::optional<Handle<UnknownValue>> unknown_set =
+        frame->attribute_utility().IdentifyAndMergeUnknowns(
+            values, frame->value_stack().GetAttributeSpan(values.size()),
+            true);
+    if (unknown_set.has_value()) {
+      return *unknown_set;
+    }
+  }
+
+  cel::MapValueBuilder<Value, Value> map_builder(
+      frame->value_factory(), frame->type_factory().GetDynType(),
+      frame->type_factory().GetDynType());
+  map_builder.Reserve(keys_.size());
+
+  for (size_t i = 0; i < keys_.size(); i += 1) {
+    auto key_status = map_builder.Put(keys_[i], values[i]);
+    if (!key_status.ok()) {
+      return frame->value_factory().CreateErrorValue(key_status);
+    }
+  }
+
+  return std::move(map_builder).Build();
+}
+
+absl::Status CreateStructStepForConstantKeyMap::Evaluate(
+    ExecutionFrame* frame) const {
+  if (frame->value_stack().size() < keys_.size()) {
+    return absl::InternalError(
+        "CreateStructStepForConstantKeyMap: stack underflow");
+  }
+
+  CEL_ASSIGN_OR_RETURN(auto result, DoEvaluate(frame));
+
+  frame->value_stack().Pop(keys_.size());
+  frame->value_stack().Push(std::move(result));
+
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForStruct(
@@ -1019,7 +1097,7 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForStruct(
   // The resolved type should either be a struct or one of the well known types.
   if ((type)->Is<StructType>()) {
     // We resolved to a struct type. Use it.
-    std::vector<StructFieldId> entries;
+    std::vector<StructEntry> entries;
     entries.reserve(create_struct_expr.entries().size());
     for (const auto& entry : create_struct_expr.entries()) {
       CEL_ASSIGN_OR_RETURN(auto field, type.As<StructType>()->FindFieldByName(
@@ -1030,9 +1108,10 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForStruct(
             "' not found in '", create_struct_expr.message_name(), "'"));
       }
       if (field->number != 0) {
-        entries.push_back(field->number);
+        entries.push_back(StructEntry{field->number, field->hint});
       } else {
-        entries.emplace_back(std::string(field->name));
+        entries.push_back(
+            StructEntry{std::string(field->name), field->hint});
       }
     }
     return std::make_unique<CreateStructStepForStruct>(
@@ -1071,4 +1150,45 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForMap(
       expr_id, create_struct_expr.entries().size());
 }
 
+absl::optional<std::vector<Handle<Value>>> GetConstantMapKeys(
+    const cel::ast_internal::CreateStruct& create_struct_expr,
+    ValueFactory& value_factory) {
+  const auto& entries = create_struct_expr.entries();
+  if (entries.empty()) {
+    return absl::nullopt;
+  }
+  std::vector<Handle<Value>> keys;
+  keys.reserve(entries.size());
+  absl::flat_hash_set<Handle<Value>,
+                      cel::base_internal::MapKeyHasher<Handle<Value>>,
+                      cel::base_internal::MapKeyEqualer<Handle<Value>>>
+      seen;
+  seen.reserve(entries.size());
+  for (const auto& entry : entries) {
+    if (!entry.has_map_key() || !entry.map_key().has_const_expr()) {
+      return absl::nullopt;
+    }
+    const auto& constant = entry.map_key().const_expr();
+    if (!constant.has_bool_value() && !constant.has_int64_value() &&
+        !constant.has_uint64_value() && !constant.has_string_value()) {
+      return absl::nullopt;
+    }
+    auto key = ConvertConstant(constant, value_factory);
+    // Duplicate keys are left to CreateStructStepForMap, which reports them
+    // when the map is created.
+    if (!key.ok() || !seen.insert(*key).second) {
+      return absl::nullopt;
+    }
+    keys.push_back(*std::move(key));
+  }
+  return keys;
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>>
+CreateCreateStructStepForConstantKeyMap(std::vector<Handle<Value>> keys,
+                                        int64_t expr_id) {
+  return std::make_unique<CreateStructStepForConstantKeyMap>(expr_id,
+                                                             std::move(keys));
+}
+
 }  // namespace google::api::expr::runtime
@@ -3,13 +3,17 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "base/ast_internal/expr.h"
 #include "base/handle.h"
 #include "base/type.h"
 #include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
 #include "eval/eval/evaluator_core.h"
 
 namespace google::api::expr::runtime {
@@ -25,6 +29,20 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForStruct(
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateCreateStructStepForMap(
     const cel::ast_internal::CreateStruct& create_struct_expr, int64_t expr_id);
 
+// Returns the keys of a map creation if they are all constants that are valid
+// map keys and no two of them are equal, or nullopt otherwise. The keys are
+// created with value_factory.
+absl::optional<std::vector<cel::Handle<cel::Value>>> GetConstantMapKeys(
+    const cel::ast_internal::CreateStruct& create_struct_expr,
+    cel::ValueFactory& value_factory);
+
+// Creates an `ExpressionStep` which performs `CreateStruct` for a map with the
+// keys returned by GetConstantMapKeys. Only the values are expected on the
+// stack, in the order of the keys.
+absl::StatusOr<std::unique_ptr<ExpressionStep>>
+CreateCreateStructStepForConstantKeyMap(
+    std::vector<cel::Handle<cel::Value>> keys, int64_t expr_id);
+
 }  // namespace google::api::expr::runtime
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_CREATE_STRUCT_STEP_H_
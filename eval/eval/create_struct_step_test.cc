@@ -11,6 +11,8 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "base/ast_internal/expr.h"
+#include "base/type_factory.h"
 #include "base/type_manager.h"
 #include "base/type_provider.h"
 #include "base/value_factory.h"
@@ -778,6 +780,95 @@ TEST_P(CreateCreateStructStepTest, TestCreateStringMap) {
   EXPECT_EQ(lookup1->Int64OrDie(), 1);
 }
 
+TEST(CreateCreateStructStepTest, GetConstantMapKeys) {
+  Arena arena;
+  cel::TypeFactory type_factory(ProtoMemoryManagerRef(&arena));
+  cel::TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  cel::ValueFactory value_factory(type_manager);
+
+  cel::ast_internal::CreateStruct create_struct;
+  auto& string_entry = create_struct.mutable_entries().emplace_back();
+  string_entry.mutable_map_key().mutable_const_expr().set_string_value("a");
+  auto& int_entry = create_struct.mutable_entries().emplace_back();
+  int_entry.mutable_map_key().mutable_const_expr().set_int64_value(1);
+  auto& uint_entry = create_struct.mutable_entries().emplace_back();
+  uint_entry.mutable_map_key().mutable_const_expr().set_uint64_value(1);
+
+  auto keys = GetConstantMapKeys(create_struct, value_factory);
+  ASSERT_TRUE(keys.has_value());
+  ASSERT_EQ(keys->size(), 3);
+  EXPECT_EQ((*keys)[0]->DebugString(), "\"a\"");
+  EXPECT_EQ((*keys)[1]->DebugString(), "1");
+  EXPECT_EQ((*keys)[2]->DebugString(), "1u");
+
+  // Duplicate keys are reported when the map is created.
+  auto& duplicate_entry = create_struct.mutable_entries().emplace_back();
+  duplicate_entry.mutable_map_key().mutable_const_expr().set_int64_value(1);
+  EXPECT_FALSE(GetConstantMapKeys(create_struct, value_factory).has_value());
+
+  create_struct.mutable_entries().pop_back();
+  auto& double_entry = create_struct.mutable_entries().emplace_back();
+  double_entry.mutable_map_key().mutable_const_expr().set_double_value(1.0);
+  EXPECT_FALSE(GetConstantMapKeys(create_struct, value_factory).has_value());
+
+  create_struct.mutable_entries().pop_back();
+  auto& ident_entry = create_struct.mutable_entries().emplace_back();
+  ident_entry.mutable_map_key().mutable_ident_expr().set_name("key");
+  EXPECT_FALSE(GetConstantMapKeys(create_struct, value_factory).has_value());
+}
+
+// Test that a map with constant keys is created from the values alone.
+TEST_P(CreateCreateStructStepTest, TestCreateConstantKeyMap) {
+  Arena arena;
+  cel::TypeFactory type_factory(ProtoMemoryManagerRef(&arena));
+  cel::TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  cel::ValueFactory value_factory(type_manager);
+
+  Expr expr;
+  auto& create_struct = expr.mutable_struct_expr();
+  std::vector<Expr> value_exprs(2);
+  ExecutionPath path;
+  for (int i = 0; i < 2; ++i) {
+    auto& entry = create_struct.mutable_entries().emplace_back();
+    entry.mutable_map_key().mutable_const_expr().set_string_value(
+        absl::StrCat("key", i));
+    auto& value_ident = value_exprs[i].mutable_ident_expr();
+    value_ident.set_name(absl::StrCat("value", i));
+    ASSERT_OK_AND_ASSIGN(auto step,
+                         CreateIdentStep(value_ident, value_exprs[i].id()));
+    path.push_back(std::move(step));
+  }
+  auto keys = GetConstantMapKeys(create_struct, value_factory);
+  ASSERT_TRUE(keys.has_value());
+  ASSERT_OK_AND_ASSIGN(
+      auto step,
+      CreateCreateStructStepForConstantKeyMap(*std::move(keys), expr.id()));
+  path.push_back(std::move(step));
+
+  cel::RuntimeOptions options;
+  if (GetParam()) {
+    options.unknown_processing = cel::UnknownProcessingOptions::kAttributeOnly;
+  }
+  CelExpressionFlatImpl cel_expr(
+      FlatExpression(std::move(path), /*comprehension_slot_count=*/0,
+                     TypeProvider::Builtin(), options));
+  Activation activation;
+  activation.InsertValue("value0", CelValue::CreateInt64(0));
+  activation.InsertValue("value1", CelValue::CreateInt64(1));
+
+  ASSERT_OK_AND_ASSIGN(CelValue result, cel_expr.Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsMap());
+  const CelMap* cel_map = result.MapOrDie();
+  ASSERT_EQ(cel_map->size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    std::string key = absl::StrCat("key", i);
+    auto lookup = cel_map->Get(&arena, CelValue::CreateString(&key));
+    ASSERT_TRUE(lookup.has_value());
+    ASSERT_TRUE(lookup->IsInt64());
+    EXPECT_EQ(lookup->Int64OrDie(), i);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(CombinedCreateStructTest, CreateCreateStructStepTest,
                          testing::Bool());
 
@@ -14,48 +14,195 @@
 
 #include "eval/eval/evaluator_core.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
-#include "absl/types/optional.h"
+#include "absl/time/time.h"
 #include "absl/utility/utility.h"
 #include "base/handle.h"
 #include "base/memory.h"
 #include "base/type_provider.h"
 #include "base/value.h"
 #include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/error_value.h"
+#include "base/values/unknown_value.h"
+#include "eval/eval/step_arena.h"
 #include "internal/status_macros.h"
 #include "runtime/activation_interface.h"
+#include "runtime/runtime_metrics.h"
 
 namespace google::api::expr::runtime {
 
+namespace {
+
+// Mirrors ExecutionFrame::enable_attribute_tracking.
+bool TracksAttributes(const cel::RuntimeOptions& options) {
+  return options.unknown_processing !=
+             cel::UnknownProcessingOptions::kDisabled ||
+         options.enable_missing_attribute_errors;
+}
+
+// Gathers the statistics of one evaluation with state for the metrics sink of
+// options, if any. Must be created after the state is reset for the
+// evaluation.
+class EvaluationMetricsScope final {
+ public:
+  EvaluationMetricsScope(const cel::RuntimeOptions& options,
+                         absl::string_view program_label,
+                         FlatExpressionEvaluatorState& state)
+      : sink_(options.metrics_sink.get()),
+        program_label_(program_label),
+        state_(state) {
+    if (ABSL_PREDICT_TRUE(sink_ == nullptr)) {
+      return;
+    }
+    type_cache_misses_ = state_.type_manager().cache_misses();
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Reports the evaluation, which produced result, to the sink.
+  void Report(const absl::StatusOr<cel::Handle<cel::Value>>& result) {
+    if (ABSL_PREDICT_TRUE(sink_ == nullptr)) {
+      return;
+    }
+    cel::EvaluationMetrics metrics;
+    metrics.wall_time =
+        absl::FromChrono(std::chrono::steady_clock::now() - start_);
+    metrics.program_label = program_label_;
+    if (!result.ok()) {
+      metrics.outcome = cel::EvaluationOutcome::kFailure;
+    } else if ((*result)->Is<cel::ErrorValue>()) {
+      metrics.outcome = cel::EvaluationOutcome::kError;
+    } else if ((*result)->Is<cel::UnknownValue>()) {
+      metrics.outcome = cel::EvaluationOutcome::kUnknown;
+    }
+    metrics.comprehension_iterations = state_.comprehension_iterations();
+    // The arena is reset before each evaluation.
+    metrics.allocated_bytes = static_cast<int64_t>(state_.arena_space_used());
+    metrics.type_cache_misses =
+        state_.type_manager().cache_misses() - type_cache_misses_;
+    sink_->OnEvaluation(metrics);
+  }
+
+ private:
+  cel::RuntimeMetricsSink* const sink_;
+  const absl::string_view program_label_;
+  FlatExpressionEvaluatorState& state_;
+  std::chrono::steady_clock::time_point start_;
+  int64_t type_cache_misses_ = 0;
+};
+
+}  // namespace
+
+void* ExpressionStep::operator new(size_t size) {
+  StepArena* arena = StepArena::Current();
+  if (arena != nullptr) {
+    return arena->Allocate(size);
+  }
+  return ::operator new(size);
+}
+
+void ExpressionStep::operator delete(void* ptr, size_t size) {
+  StepArena* arena = StepArena::Current();
+  if (arena != nullptr && arena->Contains(ptr)) {
+    // Released with the arena.
+    return;
+  }
+  ::operator delete(ptr);
+}
+
 FlatExpressionEvaluatorState::FlatExpressionEvaluatorState(
     size_t value_stack_size, size_t comprehension_slot_count,
     const cel::TypeProvider& type_provider,
-    cel::MemoryManagerRef memory_manager)
-    : value_stack_(value_stack_size),
+    cel::MemoryManagerRef memory_manager, bool track_attributes)
+    : value_stack_(value_stack_size, track_attributes),
       comprehension_slots_(comprehension_slot_count),
+      type_provider_(&type_provider),
       managed_value_factory_(absl::in_place, type_provider, memory_manager),
       value_factory_(&managed_value_factory_->get()) {}
 
 FlatExpressionEvaluatorState::FlatExpressionEvaluatorState(
     size_t value_stack_size, size_t comprehension_slot_count,
-    cel::ValueFactory& value_factory)
-    : value_stack_(value_stack_size),
+    cel::ValueFactory& value_factory, bool track_attributes)
+    : value_stack_(value_stack_size, track_attributes),
       comprehension_slots_(comprehension_slot_count),
+      type_provider_(nullptr),
       managed_value_factory_(absl::nullopt),
       value_factory_(&value_factory) {}
 
+FlatExpressionEvaluatorState::FlatExpressionEvaluatorState(
+    size_t value_stack_size, size_t comprehension_slot_count,
+    const cel::TypeProvider& type_provider,
+    const cel::PoolingArenaOptions& arena_options, bool track_attributes)
+    : value_stack_(value_stack_size, track_attributes),
+      comprehension_slots_(comprehension_slot_count),
+      arena_(std::make_unique<cel::PoolingArena>(arena_options)),
+      type_provider_(&type_provider),
+      managed_value_factory_(absl::in_place, type_provider,
+                             arena_->memory_manager()),
+      value_factory_(&managed_value_factory_->get()) {}
+
 void FlatExpressionEvaluatorState::Reset() {
   value_stack_.Clear();
   comprehension_slots_.Reset();
+  comprehension_iterations_ = 0;
+  if (arena_ != nullptr) {
+    ResetArena();
+  }
+}
+
+void FlatExpressionEvaluatorState::ResetArena() {
+  const size_t space_used = arena_->SpaceUsed();
+  if (space_used == 0) {
+    // Nothing was allocated since the last reset, e.g. a state released to a
+    // pool and reset again when acquired.
+    return;
+  }
+  ++arena_stats_.evaluations;
+  arena_stats_.peak_bytes = std::max(arena_stats_.peak_bytes, space_used);
+  arena_stats_.total_bytes += space_used;
+  // The type caches of the value factory may be allocated from the arena.
+  managed_value_factory_.reset();
+  arena_->Reset();
+  managed_value_factory_.emplace(*type_provider_, arena_->memory_manager());
+  value_factory_ = &managed_value_factory_->get();
+}
+
+void FlatExpressionEvaluatorState::Reset(cel::MemoryManagerRef memory_manager) {
+  ABSL_DCHECK(type_provider_ != nullptr);
+  ABSL_DCHECK(arena_ == nullptr);
+  Reset();
+  managed_value_factory_.emplace(*type_provider_, memory_manager);
+  value_factory_ = &managed_value_factory_->get();
+}
+
+void FlatExpressionEvaluatorState::Reset(cel::ValueFactory& value_factory) {
+  ABSL_DCHECK(arena_ == nullptr);
+  Reset();
+  managed_value_factory_.reset();
+  value_factory_ = &value_factory;
+}
+
+void FlatExpressionEvaluatorState::Release() {
+  Reset();
+  if (arena_ != nullptr) {
+    return;
+  }
+  managed_value_factory_.reset();
+  value_factory_ = nullptr;
 }
 
 const ExpressionStep* ExecutionFrame::Next() {
@@ -63,11 +210,7 @@ const ExpressionStep* ExecutionFrame::Next() {
 
   if (pc_ < end_pos) return execution_path_[pc_++].get();
   if (pc_ == end_pos && !call_stack_.empty()) {
-    pc_ = call_stack_.back().return_pc;
-    execution_path_ = call_stack_.back().return_expression;
-    ABSL_DCHECK_EQ(value_stack().size(),
-                   call_stack_.back().expected_stack_size);
-    call_stack_.pop_back();
+    ReturnFromCall();
     return Next();
   }
   if (pc_ > end_pos) {
@@ -76,29 +219,301 @@ const ExpressionStep* ExecutionFrame::Next() {
   return nullptr;
 }
 
+void ExecutionFrame::ReturnFromCall() {
+  pc_ = call_stack_.back().return_pc;
+  execution_path_ = call_stack_.back().return_expression;
+  compact_path_ = call_stack_.back().return_compact_expression;
+  ABSL_DCHECK_EQ(value_stack().size(), call_stack_.back().expected_stack_size);
+  call_stack_.pop_back();
+}
+
+void ExecutionFrame::StartBudget() {
+  budget_steps_ = 0;
+  budget_window_ = 0;
+  budget_countdown_ = 1;
+  arena_space_used_at_start_ = state_.arena_space_used();
+  if (options_.evaluation_deadline != absl::InfiniteDuration()) {
+    deadline_ = std::chrono::steady_clock::now() +
+                absl::ToChronoNanoseconds(options_.evaluation_deadline);
+  }
+}
+
+absl::Status ExecutionFrame::CheckBudget() {
+  // Called before executing the next step, so budget_steps_ is the number of
+  // steps already executed.
+  budget_steps_ += budget_window_;
+  budget_window_ = 0;
+  if (options_.max_evaluation_steps > 0 &&
+      budget_steps_ >= options_.max_evaluation_steps) {
+    return absl::ResourceExhaustedError(
+        absl::StrCat("Evaluation step budget exceeded: ",
+                     options_.max_evaluation_steps));
+  }
+  if (options_.max_evaluation_cost > 0 &&
+      budget_steps_ + 1 + cost_iterations_ + function_cost_ >
+          options_.max_evaluation_cost) {
+    return absl::ResourceExhaustedError(absl::StrCat(
+        "Evaluation cost budget exceeded: ", options_.max_evaluation_cost));
+  }
+  if (options_.evaluation_deadline != absl::InfiniteDuration() &&
+      std::chrono::steady_clock::now() >= deadline_) {
+    return absl::DeadlineExceededError("Evaluation deadline exceeded");
+  }
+  CEL_RETURN_IF_ERROR(CheckMemoryQuota());
+
+  // Schedule the next check. Checking at the step just past the budget keeps
+  // the step limit exact regardless of the check interval.
+  int64_t window = std::max(options_.evaluation_budget_check_interval, 1);
+  if (options_.max_evaluation_steps > 0) {
+    window = std::min(window, options_.max_evaluation_steps - budget_steps_);
+  }
+  if (options_.max_evaluation_cost > 0) {
+    window = std::min(window, options_.max_evaluation_cost - budget_steps_ -
+                                  cost_iterations_ - function_cost_);
+  }
+  budget_window_ = window;
+  budget_countdown_ = window;
+  return absl::OkStatus();
+}
+
+absl::Status ExecutionFrame::CheckMemoryQuota() const {
+  const int64_t quota = state_.memory_quota();
+  if (quota <= 0) {
+    return absl::OkStatus();
+  }
+  // Quotas can only be set on states that own an arena.
+  const int64_t used = static_cast<int64_t>(state_.arena_space_used() -
+                                            arena_space_used_at_start_);
+  if (used > quota) {
+    return absl::ResourceExhaustedError(
+        absl::StrCat("Evaluation memory quota exceeded: ", quota, " bytes"));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ExecutionFrame::CheckCost() {
+  if (options_.max_evaluation_cost <= 0) {
+    return absl::OkStatus();
+  }
+  int64_t remaining = options_.max_evaluation_cost - cost_total();
+  if (remaining < 0) {
+    return absl::ResourceExhaustedError(absl::StrCat(
+        "Evaluation cost budget exceeded: ", options_.max_evaluation_cost));
+  }
+  // The budget is checked once the countdown reaches zero. Shrinking the
+  // window by as much as the countdown keeps charged_steps() unchanged.
+  remaining = std::max<int64_t>(remaining, 1);
+  if (remaining < budget_countdown_) {
+    int64_t shift = budget_countdown_ - remaining;
+    budget_window_ -= shift;
+    budget_countdown_ -= shift;
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::Evaluate(
     EvaluationListener listener) {
+  has_listener_ = static_cast<bool>(listener) || trace_recorder_ != nullptr;
+  if (budget_enabled()) {
+    StartBudget();
+    absl::StatusOr<cel::Handle<cel::Value>> result =
+        EvaluateLoop</*kEnforceBudget=*/true>(listener);
+    if (result.ok()) {
+      // Allocations of the last steps are not covered by a budget check.
+      CEL_RETURN_IF_ERROR(CheckMemoryQuota());
+    }
+    return result;
+  }
+  return EvaluateLoop</*kEnforceBudget=*/false>(listener);
+}
+
+template <bool kEnforceBudget>
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::EvaluateLoop(
+    EvaluationListener& listener) {
+  // Tracing is compiled into a separate loop so that untraced evaluation
+  // does not pay for the listener checks.
+  if (!compact_subexpressions_.empty()) {
+    if (has_listener_) {
+      return EvaluateCompact<kEnforceBudget, /*kTrace=*/true>(listener);
+    }
+    return EvaluateCompact<kEnforceBudget, /*kTrace=*/false>(listener);
+  }
+  if (has_listener_) {
+    return EvaluateSteps<kEnforceBudget, /*kTrace=*/true>(listener);
+  }
+  return EvaluateSteps<kEnforceBudget, /*kTrace=*/false>(listener);
+}
+
+absl::Status ExecutionFrame::NotifyListener(EvaluationListener& listener,
+                                            int64_t expr_id) {
+  if (!options_.trace_expr_ids.empty() &&
+      !absl::c_binary_search(options_.trace_expr_ids, expr_id)) {
+    return absl::OkStatus();
+  }
+  if (value_stack().empty()) {
+    ABSL_LOG(ERROR) << "Stack is empty after a ExpressionStep.Evaluate. "
+                       "Try to disable short-circuiting.";
+    return absl::OkStatus();
+  }
+  if (trace_recorder_ != nullptr) {
+    trace_recorder_->Append(expr_id, *value_stack().Peek());
+    return absl::OkStatus();
+  }
+  return listener(expr_id, value_stack().Peek(), value_factory());
+}
+
+template <bool kEnforceBudget, bool kTrace>
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::EvaluateSteps(
+    EvaluationListener& listener) {
   size_t initial_stack_size = value_stack().size();
   const ExpressionStep* expr;
 
   while ((expr = Next()) != nullptr) {
+    if constexpr (kEnforceBudget) {
+      CEL_RETURN_IF_ERROR(ChargeStep());
+    }
     CEL_RETURN_IF_ERROR(expr->Evaluate(this));
 
-    if (!listener ||
-        // This step was added during compilation (e.g. Int64ConstImpl).
-        !expr->ComesFromAst()) {
-      continue;
+    // Steps added during compilation (e.g. Int64ConstImpl) are not traced.
+    if constexpr (kTrace) {
+      if (expr->ComesFromAst()) {
+        CEL_RETURN_IF_ERROR(NotifyListener(listener, expr->id()));
+      }
     }
+  }
+
+  return PopResult(initial_stack_size);
+}
+
+template <bool kEnforceBudget, bool kTrace>
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::EvaluateCompact(
+    EvaluationListener& listener) {
+  size_t initial_stack_size = value_stack().size();
+
+  while (true) {
+    if (pc_ >= compact_path_.size()) {
+      if (pc_ == compact_path_.size() && !call_stack_.empty()) {
+        ReturnFromCall();
+        continue;
+      }
+      if (pc_ > compact_path_.size()) {
+        ABSL_LOG(ERROR)
+            << "Attempting to step beyond the end of execution path.";
+      }
+      break;
+    }
+
+    if constexpr (kEnforceBudget) {
+      CEL_RETURN_IF_ERROR(ChargeStep());
+    }
+    const CompactStep& step = compact_path_[pc_++];
+    switch (step.opcode) {
+      case CompactOpcode::kConstant:
+        value_stack().Push(*step.constant);
+        break;
+      case CompactOpcode::kJump:
+        // Offsets are range checked when the program is encoded.
+        pc_ = static_cast<size_t>(static_cast<int64_t>(pc_) +
+                                  step.jump_offset);
+        break;
+      case CompactOpcode::kCondJump: {
+        if (!value_stack().HasEnough(1)) {
+          return absl::Status(absl::StatusCode::kInternal,
+                              "Value stack underflow");
+        }
+        const cel::Handle<cel::Value>& top = value_stack().Peek();
+        bool jump = top->Is<cel::BoolValue>() &&
+                    top.As<cel::BoolValue>()->NativeValue() ==
+                        step.jump_condition;
+        if (!step.leave_on_stack) {
+          value_stack().Pop(1);
+        }
+        if (jump) {
+          pc_ = static_cast<size_t>(static_cast<int64_t>(pc_) +
+                                    step.jump_offset);
+        }
+        break;
+      }
+      case CompactOpcode::kVirtual:
+        CEL_RETURN_IF_ERROR(step.step->Evaluate(this));
+        break;
+    }
+
+    if constexpr (kTrace) {
+      if (step.comes_from_ast) {
+        CEL_RETURN_IF_ERROR(NotifyListener(listener, step.expr_id));
+      }
+    }
+  }
+
+  return PopResult(initial_stack_size);
+}
+
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::Profile(
+    cel::EvaluationProfile& profile) {
+  profiling_ = true;
+  const bool enforce_budget = budget_enabled();
+  if (enforce_budget) {
+    StartBudget();
+  }
+  const bool count_allocations = profile.has_allocation_counter();
+  size_t initial_stack_size = value_stack().size();
+  const ExpressionStep* expr;
 
-    if (value_stack().empty()) {
-      ABSL_LOG(ERROR) << "Stack is empty after a ExpressionStep.Evaluate. "
-                         "Try to disable short-circuiting.";
-      continue;
+  while ((expr = Next()) != nullptr) {
+    if (enforce_budget) {
+      CEL_RETURN_IF_ERROR(ChargeStep());
+    }
+    int64_t allocations = count_allocations ? profile.CountAllocations() : 0;
+    auto start = std::chrono::steady_clock::now();
+    absl::Status status = expr->Evaluate(this);
+    auto end = std::chrono::steady_clock::now();
+    if (count_allocations) {
+      allocations = profile.CountAllocations() - allocations;
     }
-    CEL_RETURN_IF_ERROR(
-        listener(expr->id(), value_stack().Peek(), value_factory()));
+    profile.Record(expr->id(), absl::FromChrono(end - start), allocations);
+    CEL_RETURN_IF_ERROR(status);
+  }
+  CEL_RETURN_IF_ERROR(CheckMemoryQuota());
+
+  return PopResult(initial_stack_size);
+}
+
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::EvaluateWithCost(
+    cel::EvaluationCost& cost) {
+  cost_ = &cost;
+  const bool count_allocations = static_cast<bool>(cost.allocation_counter);
+  int64_t allocated_bytes =
+      count_allocations ? cost.allocation_counter() : 0;
+  absl::StatusOr<cel::Handle<cel::Value>> result =
+      Evaluate(EvaluationListener());
+  cost.steps += charged_steps();
+  cost.iterations += cost_iterations_;
+  cost.function_cost += function_cost_;
+  if (count_allocations) {
+    cost.allocated_bytes += cost.allocation_counter() - allocated_bytes;
+  }
+  cost_ = nullptr;
+  return result;
+}
+
+absl::Status ExecutionFrame::EvaluateInPlace() {
+  pc_ = 0UL;
+  size_t initial_stack_size = value_stack().size();
+  const ExpressionStep* expr;
+  while ((expr = Next()) != nullptr) {
+    CEL_RETURN_IF_ERROR(expr->Evaluate(this));
   }
+  if (value_stack().size() != initial_stack_size + 1) {
+    return absl::InternalError(absl::StrCat(
+        "Stack error during evaluation: expected=", initial_stack_size + 1,
+        ", actual=", value_stack().size()));
+  }
+  return absl::OkStatus();
+}
 
+absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::PopResult(
+    size_t initial_stack_size) {
   size_t final_stack_size = value_stack().size();
   if (final_stack_size != initial_stack_size + 1 || final_stack_size == 0) {
     return absl::InternalError(absl::StrCat(
@@ -112,14 +527,56 @@ absl::StatusOr<cel::Handle<cel::Value>> ExecutionFrame::Evaluate(
 
 FlatExpressionEvaluatorState FlatExpression::MakeEvaluatorState(
     cel::MemoryManagerRef manager) const {
-  return FlatExpressionEvaluatorState(path_.size(), comprehension_slots_size_,
-                                      type_provider_, manager);
+  return FlatExpressionEvaluatorState(value_stack_size_,
+                                      comprehension_slots_size_, type_provider_,
+                                      manager, TracksAttributes(options_));
 }
 
 FlatExpressionEvaluatorState FlatExpression::MakeEvaluatorState(
     cel::ValueFactory& value_factory) const {
-  return FlatExpressionEvaluatorState(path_.size(), comprehension_slots_size_,
-                                      value_factory);
+  return FlatExpressionEvaluatorState(value_stack_size_,
+                                      comprehension_slots_size_, value_factory,
+                                      TracksAttributes(options_));
+}
+
+FlatExpressionEvaluatorState FlatExpression::MakeEvaluatorState(
+    const cel::PoolingArenaOptions& arena_options) const {
+  return FlatExpressionEvaluatorState(value_stack_size_,
+                                      comprehension_slots_size_, type_provider_,
+                                      arena_options, TracksAttributes(options_));
+}
+
+FlatExpression::~FlatExpression() {
+  // Arena allocated steps must be destroyed under a scope for their arena.
+  StepArena::Scope scope(step_arena_.get());
+  path_.clear();
+}
+
+size_t FlatExpression::ResidentSize() const {
+  size_t size = sizeof(*this);
+  size += path_.capacity() * sizeof(ExecutionPath::value_type);
+  size += subexpressions_.capacity() * sizeof(ExecutionPathView);
+  size += compact_programs_.capacity() * sizeof(CompactProgram);
+  for (const CompactProgram& program : compact_programs_) {
+    size += program.capacity() * sizeof(CompactStep);
+  }
+  size += compact_subexpressions_.capacity() * sizeof(CompactProgramView);
+  size += variable_names_.capacity() * sizeof(std::string);
+  if (step_arena_ != nullptr) {
+    size += sizeof(StepArena) + step_arena_->SpaceAllocated();
+  }
+  return size;
+}
+
+void FlatExpression::set_compact_programs(
+    std::vector<CompactProgram> compact_programs) {
+  ABSL_DCHECK_EQ(compact_programs.size(), subexpressions_.size());
+  compact_programs_ = std::move(compact_programs);
+  compact_subexpressions_.clear();
+  compact_subexpressions_.reserve(compact_programs_.size());
+  for (const CompactProgram& program : compact_programs_) {
+    compact_subexpressions_.push_back(program);
+  }
 }
 
 absl::StatusOr<cel::Handle<cel::Value>> FlatExpression::EvaluateWithCallback(
@@ -127,9 +584,110 @@ absl::StatusOr<cel::Handle<cel::Value>> FlatExpression::EvaluateWithCallback(
     FlatExpressionEvaluatorState& state) const {
   state.Reset();
 
+  if (listener && !trace_sampler_.Sample()) {
+    listener = nullptr;
+  }
+
+  EvaluationMetricsScope metrics(options_, metrics_label_, state);
+  absl::StatusOr<cel::Handle<cel::Value>> result;
+  if (!compact_subexpressions_.empty()) {
+    ExecutionFrame frame(subexpressions_, compact_subexpressions_, activation,
+                         options_, state);
+    frame.BindVariables(variable_names_);
+    result = frame.Evaluate(std::move(listener));
+  } else {
+    ExecutionFrame frame(subexpressions_, activation, options_, state);
+    frame.BindVariables(variable_names_);
+    result = frame.Evaluate(std::move(listener));
+  }
+  metrics.Report(result);
+  return result;
+}
+
+absl::StatusOr<cel::Handle<cel::Value>> FlatExpression::Record(
+    const cel::ActivationInterface& activation, cel::TraceRecorder& recorder,
+    FlatExpressionEvaluatorState& state) const {
+  state.Reset();
+
+  EvaluationMetricsScope metrics(options_, metrics_label_, state);
+  absl::StatusOr<cel::Handle<cel::Value>> result;
+  if (!compact_subexpressions_.empty()) {
+    ExecutionFrame frame(subexpressions_, compact_subexpressions_, activation,
+                         options_, state);
+    frame.BindVariables(variable_names_);
+    frame.set_trace_recorder(&recorder);
+    result = frame.Evaluate(EvaluationListener());
+  } else {
+    ExecutionFrame frame(subexpressions_, activation, options_, state);
+    frame.BindVariables(variable_names_);
+    frame.set_trace_recorder(&recorder);
+    result = frame.Evaluate(EvaluationListener());
+  }
+  metrics.Report(result);
+  return result;
+}
+
+absl::StatusOr<cel::Handle<cel::Value>> FlatExpression::Profile(
+    const cel::ActivationInterface& activation,
+    cel::EvaluationProfile& profile,
+    FlatExpressionEvaluatorState& state) const {
+  state.Reset();
+  EvaluationMetricsScope metrics(options_, metrics_label_, state);
   ExecutionFrame frame(subexpressions_, activation, options_, state);
+  frame.BindVariables(variable_names_);
+  absl::StatusOr<cel::Handle<cel::Value>> result = frame.Profile(profile);
+  metrics.Report(result);
+  return result;
+}
 
-  return frame.Evaluate(std::move(listener));
+absl::StatusOr<cel::Handle<cel::Value>> FlatExpression::EvaluateWithCost(
+    const cel::ActivationInterface& activation, cel::EvaluationCost& cost,
+    FlatExpressionEvaluatorState& state) const {
+  state.Reset();
+
+  EvaluationMetricsScope metrics(options_, metrics_label_, state);
+  absl::StatusOr<cel::Handle<cel::Value>> result;
+  if (!compact_subexpressions_.empty()) {
+    ExecutionFrame frame(subexpressions_, compact_subexpressions_, activation,
+                         options_, state);
+    frame.BindVariables(variable_names_);
+    result = frame.EvaluateWithCost(cost);
+  } else {
+    ExecutionFrame frame(subexpressions_, activation, options_, state);
+    frame.BindVariables(variable_names_);
+    result = frame.EvaluateWithCost(cost);
+  }
+  metrics.Report(result);
+  return result;
+}
+
+absl::StatusOr<std::vector<cel::Handle<cel::Value>>>
+FlatExpression::EvaluateBatch(
+    absl::Span<const cel::ActivationInterface* const> activations,
+    FlatExpressionEvaluatorState& state) const {
+  std::vector<cel::Handle<cel::Value>> results;
+  results.reserve(activations.size());
+  const bool compact = !compact_subexpressions_.empty();
+  for (const cel::ActivationInterface* activation : activations) {
+    ABSL_DCHECK(activation != nullptr);
+    state.Reset();
+    EvaluationMetricsScope metrics(options_, metrics_label_, state);
+    absl::StatusOr<cel::Handle<cel::Value>> result;
+    if (compact) {
+      ExecutionFrame frame(subexpressions_, compact_subexpressions_,
+                           *activation, options_, state);
+      frame.BindVariables(variable_names_);
+      result = frame.Evaluate(EvaluationListener());
+    } else {
+      ExecutionFrame frame(subexpressions_, *activation, options_, state);
+      frame.BindVariables(variable_names_);
+      result = frame.Evaluate(EvaluationListener());
+    }
+    metrics.Report(result);
+    CEL_RETURN_IF_ERROR(result.status());
+    results.push_back(*std::move(result));
+  }
+  return results;
 }
 
 }  // namespace google::api::expr::runtime
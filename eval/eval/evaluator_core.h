@@ -15,18 +15,27 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_EVALUATOR_CORE_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_EVALUATOR_CORE_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <new>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
+#include "absl/base/optimization.h"
+#include "absl/container/inlined_vector.h"
 #include "absl/log/absl_check.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "base/handle.h"
 #include "base/memory.h"
@@ -39,10 +48,15 @@
 #include "eval/eval/attribute_utility.h"
 #include "eval/eval/comprehension_slots.h"
 #include "eval/eval/evaluator_stack.h"
+#include "eval/eval/step_arena.h"
 #include "runtime/activation_interface.h"
+#include "runtime/evaluation_cost.h"
+#include "runtime/evaluation_profile.h"
 #include "runtime/managed_value_factory.h"
+#include "runtime/referenced_attribute.h"
 #include "runtime/runtime.h"
 #include "runtime/runtime_options.h"
+#include "runtime/trace_recorder.h"
 
 namespace google::api::expr::runtime {
 
@@ -80,27 +94,179 @@ class ExpressionStep {
   // the planning phase. This should only be overridden by special cases, and
   // callers must not make any assumptions about the default case.
   virtual cel::NativeTypeId GetNativeTypeId() const = 0;
+
+  // Steps created while a StepArena::Scope is active on the current thread
+  // are allocated from that arena and must be destroyed under a scope for the
+  // same arena. Deleting an arena allocated step only runs its destructor.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
+  // Over-aligned steps are always heap allocated.
+  static void* operator new(size_t size, std::align_val_t alignment) {
+    return ::operator new(size, alignment);
+  }
+  static void operator delete(void* ptr, size_t size,
+                              std::align_val_t alignment) {
+    ::operator delete(ptr, alignment);
+  }
 };
 
 using ExecutionPath = std::vector<std::unique_ptr<const ExpressionStep>>;
 using ExecutionPathView =
     absl::Span<const std::unique_ptr<const ExpressionStep>>;
 
+// Opcodes for steps that the ExecutionFrame can run inline when evaluating a
+// compact program. Steps without a dedicated opcode are dispatched through
+// ExpressionStep::Evaluate.
+enum class CompactOpcode : uint8_t {
+  kVirtual,
+  kConstant,
+  kJump,
+  kCondJump,
+};
+
+// Tagged representation of a single program step used by the compact dispatch
+// loop.
+//
+// A compact program parallels the ExecutionPath it was encoded from, so jumps
+// and subexpression calls share the same program counter. The backing steps
+// must outlive the compact program.
+struct CompactStep {
+  CompactOpcode opcode = CompactOpcode::kVirtual;
+  bool comes_from_ast = false;
+  // kCondJump: the boolean value that triggers the jump.
+  bool jump_condition = false;
+  // kCondJump: whether the tested value is left on the stack.
+  bool leave_on_stack = false;
+  // kJump, kCondJump: relative offset, range checked when encoded.
+  int32_t jump_offset = 0;
+  int64_t expr_id = 0;
+  // kConstant: the value to push, owned by the backing step.
+  const cel::Handle<cel::Value>* constant = nullptr;
+  // The backing step, evaluated for kVirtual.
+  const ExpressionStep* step = nullptr;
+};
+
+using CompactProgram = std::vector<CompactStep>;
+using CompactProgramView = absl::Span<const CompactStep>;
+
+// Memory usage of the arena owned by an evaluator state, sampled each time the
+// arena is reset, i.e. once per evaluation.
+struct EvaluatorArenaStats {
+  // Number of evaluations sampled.
+  size_t evaluations = 0;
+  // Largest number of arena bytes used by a single evaluation.
+  size_t peak_bytes = 0;
+  // Sum of arena bytes used by all sampled evaluations.
+  size_t total_bytes = 0;
+
+  size_t average_bytes() const {
+    return evaluations == 0 ? 0 : total_bytes / evaluations;
+  }
+
+  void Merge(const EvaluatorArenaStats& other) {
+    evaluations += other.evaluations;
+    peak_bytes = std::max(peak_bytes, other.peak_bytes);
+    total_bytes += other.total_bytes;
+  }
+};
+
 // Class that wraps the state that needs to be allocated for expression
 // evaluation. This can be reused to save on allocations.
 class FlatExpressionEvaluatorState {
  public:
+  // If track_attributes is false, the value stack does not keep attribute
+  // trails. It must only be used with options that disable both unknown
+  // processing and missing attribute errors.
   FlatExpressionEvaluatorState(size_t value_stack_size,
                                size_t comprehension_slot_count,
                                const cel::TypeProvider& type_provider,
-                               cel::MemoryManagerRef memory_manager);
+                               cel::MemoryManagerRef memory_manager,
+                               bool track_attributes = true);
 
   FlatExpressionEvaluatorState(size_t value_stack_size,
                                size_t comprehension_slot_count,
-                               cel::ValueFactory& value_factory);
+                               cel::ValueFactory& value_factory,
+                               bool track_attributes = true);
+
+  // Creates a state that owns a pooling arena, which backs its value factory
+  // for every evaluation. The arena is reset in place by Reset() and
+  // Release(), keeping a single block sized to the high-water mark, so
+  // repeated evaluations do not allocate a new arena each time. Values
+  // produced by an evaluation are only valid until the state is next reset.
+  FlatExpressionEvaluatorState(size_t value_stack_size,
+                               size_t comprehension_slot_count,
+                               const cel::TypeProvider& type_provider,
+                               const cel::PoolingArenaOptions& arena_options,
+                               bool track_attributes = true);
 
+  // Clears the value stack and comprehension slots. For states that own an
+  // arena, also resets the arena and samples its usage.
   void Reset();
 
+  // Resets the state and rebinds its value factory to memory_manager so that
+  // the state can be reused across evaluations with different arenas.
+  //
+  // Only valid for states that own their value factory, i.e. states created
+  // with a TypeProvider, but not an arena. Does not allocate.
+  void Reset(cel::MemoryManagerRef memory_manager);
+
+  // Resets the state and rebinds it to an externally owned value factory.
+  // value_factory must outlive the evaluation. Does not allocate.
+  //
+  // Not valid for states that own an arena.
+  void Reset(cel::ValueFactory& value_factory);
+
+  // Drops all references to values and to the bound memory manager. The
+  // state must be rebound with Reset(memory_manager) before reuse.
+  //
+  // States that own an arena stay bound to it and are only reset.
+  void Release();
+
+  bool owns_arena() const { return arena_ != nullptr; }
+
+  // Returns and clears the arena usage sampled since the last call. Always
+  // empty for states that do not own an arena.
+  EvaluatorArenaStats TakeArenaStats() {
+    return std::exchange(arena_stats_, EvaluatorArenaStats());
+  }
+
+  // Limits the bytes each evaluation with this state may allocate from its
+  // owned arena. Everything allocated from the arena counts, including list
+  // and map storage and string contents. Evaluations allocating more fail
+  // with kResourceExhausted. Zero, the default, disables the limit. The limit
+  // is kept across resets.
+  //
+  // Only states that own an arena can measure their allocations, so setting a
+  // quota on other states fails with kFailedPrecondition.
+  //
+  // The quota is checked together with the step budget (see
+  // RuntimeOptions::evaluation_budget_check_interval) and once more at the
+  // end of the evaluation. The steps between two checks may therefore exceed
+  // it before the evaluation fails.
+  absl::Status set_memory_quota(int64_t bytes) {
+    if (bytes > 0 && !owns_arena()) {
+      return absl::FailedPreconditionError(
+          "memory quotas require an evaluator state that owns its arena");
+    }
+    memory_quota_ = bytes;
+    return absl::OkStatus();
+  }
+
+  int64_t memory_quota() const { return memory_quota_; }
+
+  // Returns the bytes allocated from the owned arena since it was last reset,
+  // or zero for states that do not own an arena.
+  size_t arena_space_used() const {
+    return arena_ != nullptr ? arena_->SpaceUsed() : 0;
+  }
+
+  // Adds count to the comprehension iterations of the current evaluation.
+  void CountIterations(int64_t count) { comprehension_iterations_ += count; }
+
+  // Returns the comprehension iterations counted since the last reset.
+  int64_t comprehension_iterations() const { return comprehension_iterations_; }
+
   EvaluatorStack& value_stack() { return value_stack_; }
 
   ComprehensionSlots& comprehension_slots() { return comprehension_slots_; }
@@ -116,10 +282,20 @@ class FlatExpressionEvaluatorState {
   cel::ValueFactory& value_factory() { return *value_factory_; }
 
  private:
+  void ResetArena();
+
   EvaluatorStack value_stack_;
   ComprehensionSlots comprehension_slots_;
+  // Only set for states that own an arena. Declared before the value factory,
+  // which allocates from it.
+  std::unique_ptr<cel::PoolingArena> arena_;
+  EvaluatorArenaStats arena_stats_;
+  // Only set for states that own their value factory.
+  const cel::TypeProvider* type_provider_;
   absl::optional<cel::ManagedValueFactory> managed_value_factory_;
   cel::ValueFactory* value_factory_;
+  int64_t memory_quota_ = 0;
+  int64_t comprehension_iterations_ = 0;
 };
 
 // ExecutionFrame manages the context needed for expression evaluation.
@@ -165,12 +341,49 @@ class ExecutionFrame {
     ABSL_DCHECK(!subexpressions.empty());
   }
 
+  // Evaluates using the compact dispatch loop. compact_subexpressions must
+  // parallel subexpressions.
+  ExecutionFrame(absl::Span<const ExecutionPathView> subexpressions,
+                 absl::Span<const CompactProgramView> compact_subexpressions,
+                 const cel::ActivationInterface& activation,
+                 const cel::RuntimeOptions& options,
+                 FlatExpressionEvaluatorState& state)
+      : ExecutionFrame(subexpressions, activation, options, state) {
+    ABSL_DCHECK_EQ(subexpressions.size(), compact_subexpressions.size());
+    compact_subexpressions_ = compact_subexpressions;
+    compact_path_ = compact_subexpressions[0];
+  }
+
   // Returns next expression to evaluate.
   const ExpressionStep* Next();
 
   // Evaluate the execution frame to completion.
   absl::StatusOr<cel::Handle<cel::Value>> Evaluate(EvaluationListener listener);
 
+  // Appends the values the listener would be called with to recorder instead.
+  // Must be set before evaluation starts.
+  void set_trace_recorder(cel::TraceRecorder* recorder) {
+    trace_recorder_ = recorder;
+  }
+
+  // Evaluate the execution frame to completion, recording the execution count,
+  // wall time and allocations of each step in profile under the step's
+  // expression id. Always uses the step loop, not the compact program.
+  absl::StatusOr<cel::Handle<cel::Value>> Profile(
+      cel::EvaluationProfile& profile);
+
+  // Evaluate the execution frame to completion, adding its steps, iterations,
+  // function costs and allocations to cost, including when evaluation fails.
+  absl::StatusOr<cel::Handle<cel::Value>> EvaluateWithCost(
+      cel::EvaluationCost& cost);
+
+  // Evaluates the execution path from its start, leaving the result and its
+  // attribute trail on top of the value stack. Does not call listeners or
+  // enforce the step budget.
+  //
+  // Intended for evaluating parts of a program in a separate frame.
+  absl::Status EvaluateInPlace();
+
   // Intended for use in builtin shortcutting operations.
   //
   // Offset applies after normal pc increment. For example, JumpTo(0) is a
@@ -203,9 +416,19 @@ class ExecutionFrame {
     ABSL_DCHECK_GE(return_pc, 0);
     ABSL_DCHECK_LE(return_pc, static_cast<int>(execution_path_.size()));
     call_stack_.push_back(SubFrame{static_cast<size_t>(return_pc),
-                                   value_stack().size() + 1, execution_path_});
+                                   value_stack().size() + 1, execution_path_,
+                                   compact_path_});
     pc_ = 0UL;
     execution_path_ = subexpression;
+    if (!compact_subexpressions_.empty()) {
+      compact_path_ = compact_subexpressions_[subexpression_index];
+    }
+  }
+
+  // Returns the steps of the current execution path that follow the step being
+  // evaluated.
+  ExecutionPathView remaining_path() const {
+    return execution_path_.subspan(pc_);
   }
 
   EvaluatorStack& value_stack() { return state_.value_stack(); }
@@ -241,6 +464,15 @@ class ExecutionFrame {
     return options_.enable_comprehension_list_append;
   }
 
+  // Returns true if steps may evaluate parts of the program in other frames
+  // on other threads without changing observable behavior, i.e. if there is
+  // no listener, profile, step budget or deadline to account for.
+  bool supports_concurrent_evaluation() const {
+    return !has_listener_ && !profiling_ && !budget_enabled();
+  }
+
+  const cel::RuntimeOptions& options() const { return options_; }
+
   cel::MemoryManagerRef memory_manager() { return state_.memory_manager(); }
 
   cel::TypeFactory& type_factory() { return state_.type_factory(); }
@@ -258,9 +490,45 @@ class ExecutionFrame {
     return activation_;
   }
 
+  // Reads variables by slot if the activation binds them in the order of
+  // variable_names. Called once, before evaluation starts.
+  void BindVariables(absl::Span<const std::string> variable_names) {
+    if (!variable_names.empty()) {
+      bound_variables_ = activation_.GetBoundVariables(variable_names);
+    }
+  }
+
+  // Reads variables from values, indexed by slot. Used for frames evaluating
+  // part of the program of another frame.
+  void set_bound_variables(absl::Span<const cel::Handle<cel::Value>> values) {
+    bound_variables_ = values;
+  }
+
+  absl::Span<const cel::Handle<cel::Value>> bound_variables() const {
+    return bound_variables_;
+  }
+
+  // Returns the value of the variable in slot, or nullptr if the activation
+  // does not bind variables by slot or the variable is unbound, in which
+  // case it should be looked up by name.
+  const cel::Handle<cel::Value>* FindBoundVariable(size_t slot) const {
+    if (slot < bound_variables_.size() && bound_variables_[slot]) {
+      return &bound_variables_[slot];
+    }
+    return nullptr;
+  }
+
   // Increment iterations and return an error if the iteration budget is
   // exceeded
   absl::Status IncrementIterations() {
+    state_.CountIterations(1);
+    if (ABSL_PREDICT_FALSE(tracks_cost())) {
+      ++cost_iterations_;
+      absl::Status status = CheckCost();
+      if (!status.ok()) {
+        return status;
+      }
+    }
     if (max_iterations_ == 0) {
       return absl::OkStatus();
     }
@@ -272,13 +540,112 @@ class ExecutionFrame {
     return absl::OkStatus();
   }
 
+  // Returns true if count more iterations can be charged without exceeding
+  // the iteration budget.
+  bool HasIterationBudget(int64_t count) const {
+    return max_iterations_ == 0 || iterations_ + count < max_iterations_;
+  }
+
+  // Charges count iterations that were evaluated outside of this frame. The
+  // caller must check HasIterationBudget first.
+  void ChargeIterations(int64_t count) {
+    state_.CountIterations(count);
+    if (max_iterations_ != 0) {
+      iterations_ += count;
+    }
+    if (tracks_cost()) {
+      cost_iterations_ += count;
+    }
+  }
+
+  // Charges the cost of a function call (see cel::FunctionDescriptor::cost)
+  // and returns an error if the cost budget is exceeded.
+  absl::Status ChargeFunction(int64_t cost) {
+    if (ABSL_PREDICT_TRUE(!tracks_cost())) {
+      return absl::OkStatus();
+    }
+    function_cost_ += cost;
+    return CheckCost();
+  }
+
  private:
   struct SubFrame {
     size_t return_pc;
     size_t expected_stack_size;
     ExecutionPathView return_expression;
+    CompactProgramView return_compact_expression;
   };
 
+  // Restores the caller's position after a subexpression completes.
+  void ReturnFromCall();
+
+  // Selects the evaluation loop for the program encoding and listener.
+  template <bool kEnforceBudget>
+  absl::StatusOr<cel::Handle<cel::Value>> EvaluateLoop(
+      EvaluationListener& listener);
+
+  // Evaluation loop over execution steps. The budget checks are compiled out
+  // unless kEnforceBudget is set, the listener calls unless kTrace is set.
+  template <bool kEnforceBudget, bool kTrace>
+  absl::StatusOr<cel::Handle<cel::Value>> EvaluateSteps(
+      EvaluationListener& listener);
+
+  // Evaluation loop for compact programs.
+  template <bool kEnforceBudget, bool kTrace>
+  absl::StatusOr<cel::Handle<cel::Value>> EvaluateCompact(
+      EvaluationListener& listener);
+
+  // Calls the listener with the top of the value stack for the AST node
+  // expr_id, unless the node is filtered out by trace_expr_ids.
+  absl::Status NotifyListener(EvaluationListener& listener, int64_t expr_id);
+
+  // Returns true if a step budget, deadline or memory quota is configured,
+  // or steps are counted towards the evaluation cost.
+  bool budget_enabled() const {
+    return options_.max_evaluation_steps > 0 ||
+           options_.evaluation_deadline != absl::InfiniteDuration() ||
+           state_.memory_quota() > 0 || tracks_cost();
+  }
+
+  // Returns true if the cost of the evaluation is limited or reported.
+  bool tracks_cost() const {
+    return cost_ != nullptr || options_.max_evaluation_cost > 0;
+  }
+
+  // Number of steps charged since StartBudget.
+  int64_t charged_steps() const {
+    return budget_steps_ + budget_window_ - budget_countdown_ + 1;
+  }
+
+  int64_t cost_total() const {
+    return charged_steps() + cost_iterations_ + function_cost_;
+  }
+
+  // Returns kResourceExhausted if the cost budget is exceeded. Otherwise
+  // brings the next budget check forward to where the budget would run out.
+  absl::Status CheckCost();
+
+  // Starts the step budget, deadline and memory quota for this evaluation.
+  void StartBudget();
+
+  // Returns kResourceExhausted if the memory quota is exceeded.
+  absl::Status CheckMemoryQuota() const;
+
+  // Called once the countdown for the current check window reaches zero.
+  // Returns kResourceExhausted or kDeadlineExceeded if the budget is spent.
+  absl::Status CheckBudget();
+
+  // Advances the countdown by one step. Returns non-ok if the budget is spent.
+  absl::Status ChargeStep() {
+    if (ABSL_PREDICT_TRUE(--budget_countdown_ > 0)) {
+      return absl::OkStatus();
+    }
+    return CheckBudget();
+  }
+
+  // Checks the final stack state and pops the result.
+  absl::StatusOr<cel::Handle<cel::Value>> PopResult(size_t initial_stack_size);
+
   size_t pc_;  // pc_ - Program Counter. Current position on execution path.
   ExecutionPathView execution_path_;
   const cel::ActivationInterface& activation_;
@@ -287,8 +654,56 @@ class ExecutionFrame {
   AttributeUtility attribute_utility_;
   const int max_iterations_;
   int iterations_;
+  bool has_listener_ = false;
+  bool profiling_ = false;
+  cel::TraceRecorder* trace_recorder_ = nullptr;
   absl::Span<const ExecutionPathView> subexpressions_;
-  std::vector<SubFrame> call_stack_;
+  CompactProgramView compact_path_;
+  absl::Span<const CompactProgramView> compact_subexpressions_;
+  // Empty unless the activation binds variables by slot.
+  absl::Span<const cel::Handle<cel::Value>> bound_variables_;
+  // Lazy subexpressions only nest as deep as the binds in the expression, so
+  // calls rarely spill to the heap.
+  absl::InlinedVector<SubFrame, 4> call_stack_;
+  // Step budget and deadline state, only used if budget_enabled().
+  int64_t budget_steps_ = 0;
+  int64_t budget_window_ = 0;
+  // Starts at one so that no steps are charged before StartBudget.
+  int64_t budget_countdown_ = 1;
+  std::chrono::steady_clock::time_point deadline_;
+  // Memory quota state, set by StartBudget and only used if the state has a
+  // memory quota.
+  size_t arena_space_used_at_start_ = 0;
+  // Cost state, only used if tracks_cost(). Steps are counted by the budget.
+  cel::EvaluationCost* cost_ = nullptr;
+  int64_t cost_iterations_ = 0;
+  int64_t function_cost_ = 0;
+};
+
+// Decides which evaluations started with a listener are traced: one in every
+// interval evaluations. Thread-safe.
+class TraceSampler {
+ public:
+  explicit TraceSampler(int64_t interval) : interval_(interval) {}
+
+  TraceSampler(TraceSampler&& other)
+      : interval_(other.interval_),
+        count_(other.count_.load(std::memory_order_relaxed)) {}
+  TraceSampler& operator=(TraceSampler&&) = delete;
+
+  // Returns true if the next evaluation should be traced.
+  bool Sample() {
+    if (interval_ <= 1) {
+      return true;
+    }
+    return count_.fetch_add(1, std::memory_order_relaxed) %
+               static_cast<uint64_t>(interval_) ==
+           0;
+  }
+
+ private:
+  int64_t interval_;
+  std::atomic<uint64_t> count_{0};
 };
 
 // A flattened representation of the input CEL AST.
@@ -303,8 +718,12 @@ class FlatExpression {
       : path_(std::move(path)),
         subexpressions_({path_}),
         comprehension_slots_size_(comprehension_slots_size),
+        value_stack_size_(path_.size()),
         type_provider_(type_provider),
-        options_(options) {}
+        options_(options),
+        trace_sampler_(options.trace_sample_interval) {
+    absl::c_sort(options_.trace_expr_ids);
+  }
 
   FlatExpression(ExecutionPath path,
                  std::vector<ExecutionPathView> subexpressions,
@@ -314,19 +733,28 @@ class FlatExpression {
       : path_(std::move(path)),
         subexpressions_(std::move(subexpressions)),
         comprehension_slots_size_(comprehension_slots_size),
+        value_stack_size_(path_.size()),
         type_provider_(type_provider),
-        options_(options) {}
+        options_(options),
+        trace_sampler_(options.trace_sample_interval) {
+    absl::c_sort(options_.trace_expr_ids);
+  }
 
   // Move-only
   FlatExpression(FlatExpression&&) = default;
   FlatExpression& operator=(FlatExpression&&) = delete;
 
+  ~FlatExpression();
+
   // Create new evaluator state instance with the configured options and type
   // provider.
   FlatExpressionEvaluatorState MakeEvaluatorState(
       cel::MemoryManagerRef memory_manager) const;
   FlatExpressionEvaluatorState MakeEvaluatorState(
       cel::ValueFactory& value_factory) const;
+  // Create new evaluator state instance which owns a pooling arena.
+  FlatExpressionEvaluatorState MakeEvaluatorState(
+      const cel::PoolingArenaOptions& arena_options) const;
 
   // Evaluate the expression.
   //
@@ -336,18 +764,134 @@ class FlatExpression {
   // If the listener is not empty, it will be called after each evaluation step
   // that correlates to an AST node. The value passed to the will be the top of
   // the evaluation stack, corresponding to the result of the subexpression.
+  //
+  // Tracing is subject to the trace_sample_interval and trace_expr_ids
+  // runtime options. Evaluations that are not sampled do not call the
+  // listener and run the untraced evaluation loop.
   absl::StatusOr<cel::Handle<cel::Value>> EvaluateWithCallback(
       const cel::ActivationInterface& activation, EvaluationListener listener,
       FlatExpressionEvaluatorState& state) const;
 
+  // Evaluate the expression, appending the values a listener would be called
+  // with to recorder. Not subject to the trace_sample_interval runtime option.
+  absl::StatusOr<cel::Handle<cel::Value>> Record(
+      const cel::ActivationInterface& activation, cel::TraceRecorder& recorder,
+      FlatExpressionEvaluatorState& state) const;
+
+  // Evaluate the expression, adding per expression statistics to profile.
+  //
+  // Profiled evaluation ignores listeners and the compact program, and
+  // evaluates comprehensions on the calling thread only.
+  absl::StatusOr<cel::Handle<cel::Value>> Profile(
+      const cel::ActivationInterface& activation,
+      cel::EvaluationProfile& profile,
+      FlatExpressionEvaluatorState& state) const;
+
+  // Evaluate the expression, adding its actual cost to cost (see
+  // cel::EvaluationCost). The cost is recorded even if evaluation fails.
+  absl::StatusOr<cel::Handle<cel::Value>> EvaluateWithCost(
+      const cel::ActivationInterface& activation, cel::EvaluationCost& cost,
+      FlatExpressionEvaluatorState& state) const;
+
+  // Evaluate the expression once per activation, reusing state between rows.
+  //
+  // Results are returned in activation order. A non-ok status from any row
+  // stops the batch and is returned; recoverable errors are represented as
+  // cel::ErrorValue results as for EvaluateWithCallback.
+  absl::StatusOr<std::vector<cel::Handle<cel::Value>>> EvaluateBatch(
+      absl::Span<const cel::ActivationInterface* const> activations,
+      FlatExpressionEvaluatorState& state) const;
+
   const ExecutionPath& path() const { return path_; }
 
+  // Installs a compact encoding of the program, with one entry per
+  // subexpression. When present, evaluation uses the compact dispatch loop.
+  //
+  // Only intended for use by the planner.
+  void set_compact_programs(std::vector<CompactProgram> compact_programs);
+
+  bool has_compact_programs() const { return !compact_programs_.empty(); }
+
+  // Transfers ownership of the arena the steps in path were allocated from.
+  //
+  // Only intended for use by the planner.
+  void set_step_arena(std::unique_ptr<StepArena> step_arena) {
+    step_arena_ = std::move(step_arena);
+  }
+
+  bool has_step_arena() const { return step_arena_ != nullptr; }
+
+  // Null unless the steps were allocated from an arena.
+  const StepArena* step_arena() const { return step_arena_.get(); }
+
+  // Sets the capacity of the value stack of states made for this expression.
+  // Defaults to the number of steps in path.
+  //
+  // Only intended for use by the planner, which computes the maximum stack
+  // depth of the program.
+  void set_value_stack_size(size_t value_stack_size) {
+    value_stack_size_ = value_stack_size;
+  }
+
+  size_t value_stack_size() const { return value_stack_size_; }
+
+  // Sets the names of the variables looked up by the program, in slot order.
+  //
+  // Only intended for use by the planner.
+  void set_variable_names(std::vector<std::string> variable_names) {
+    variable_names_ = std::move(variable_names);
+  }
+
+  const std::vector<std::string>& variable_names() const {
+    return variable_names_;
+  }
+
+  // Sets the attributes of the activation the program may read.
+  //
+  // Only intended for use by the planner.
+  void set_referenced_attributes(
+      std::vector<cel::ReferencedAttribute> referenced_attributes) {
+    referenced_attributes_ = std::move(referenced_attributes);
+  }
+
+  const std::vector<cel::ReferencedAttribute>& referenced_attributes() const {
+    return referenced_attributes_;
+  }
+
+  // Sets the label evaluations of the program are reported with to the
+  // metrics sink of the runtime options (see cel::RuntimeMetricsSink).
+  //
+  // Only intended for use by the planner.
+  void set_metrics_label(std::string metrics_label) {
+    metrics_label_ = std::move(metrics_label);
+  }
+
+  const std::string& metrics_label() const { return metrics_label_; }
+
+  // Returns the approximate number of bytes held by the compiled program: the
+  // expression itself, its step and program tables and the step arena.
+  //
+  // Steps are only accounted for when allocated from a step arena. Heap
+  // allocated steps and memory owned indirectly by steps (e.g. constant values
+  // or strings) are not included.
+  size_t ResidentSize() const;
+
  private:
+  // Declared before path_ so that it outlives the steps it backs.
+  std::unique_ptr<StepArena> step_arena_;
   ExecutionPath path_;
   std::vector<ExecutionPathView> subexpressions_;
+  std::vector<CompactProgram> compact_programs_;
+  std::vector<CompactProgramView> compact_subexpressions_;
   size_t comprehension_slots_size_;
+  size_t value_stack_size_;
+  std::vector<std::string> variable_names_;
+  std::vector<cel::ReferencedAttribute> referenced_attributes_;
+  std::string metrics_label_;
   const cel::TypeProvider& type_provider_;
+  // trace_expr_ids is kept sorted.
   cel::RuntimeOptions options_;
+  mutable TraceSampler trace_sampler_;
 };
 
 }  // namespace google::api::expr::runtime
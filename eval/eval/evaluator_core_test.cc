@@ -1,17 +1,28 @@
 #include "eval/eval/evaluator_core.h"
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
 #include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "common/memory.h"
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
 #include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/eval/step_arena.h"
 #include "eval/internal/interop.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_value.h"
 #include "extensions/protobuf/memory_manager.h"
+#include "internal/status_macros.h"
 #include "internal/testing.h"
 #include "runtime/activation.h"
 #include "runtime/runtime_options.h"
@@ -26,6 +37,7 @@ using ::google::api::expr::v1alpha1::Expr;
 using ::google::api::expr::runtime::RegisterBuiltinFunctions;
 using testing::_;
 using testing::Eq;
+using cel::internal::StatusIs;
 
 // Fake expression implementation
 // Pushes int64_t(0) on top of value stack.
@@ -67,6 +79,52 @@ class FakeIncrementExpressionStep : public ExpressionStep {
   }
 };
 
+// Fake expression implementation
+// Pushes the value of variable "x" on top of value stack.
+class FakeIdentExpressionStep : public ExpressionStep {
+ public:
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    CEL_ASSIGN_OR_RETURN(auto value,
+                         frame->modern_activation().FindVariable(
+                             frame->value_factory(), "x"));
+    if (!value.has_value()) {
+      return absl::NotFoundError("x");
+    }
+    frame->value_stack().Push(*std::move(value));
+    return absl::OkStatus();
+  }
+
+  int64_t id() const override { return 0; }
+
+  bool ComesFromAst() const override { return true; }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId();
+  }
+};
+
+// Fake expression implementation
+// Replaces the top of the value stack, if any, with a heap allocated string.
+class FakeAllocatingExpressionStep : public ExpressionStep {
+ public:
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().empty()) {
+      frame->value_stack().Pop(1);
+    }
+    frame->value_stack().Push(frame->value_factory().CreateUncheckedStringValue(
+        std::string("a string long enough to be allocated")));
+    return absl::OkStatus();
+  }
+
+  int64_t id() const override { return 0; }
+
+  bool ComesFromAst() const override { return true; }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId();
+  }
+};
+
 TEST(EvaluatorCoreTest, ExecutionFrameNext) {
   ExecutionPath path;
   google::protobuf::Arena arena;
@@ -119,6 +177,235 @@ TEST(EvaluatorCoreTest, SimpleEvaluatorTest) {
   EXPECT_THAT(value.Int64OrDie(), Eq(2));
 }
 
+TEST(EvaluatorCoreTest, EvaluateBatch) {
+  ExecutionPath path;
+  path.push_back(std::make_unique<FakeIdentExpressionStep>());
+  path.push_back(std::make_unique<FakeIncrementExpressionStep>());
+
+  FlatExpression expr(std::move(path), 0, cel::TypeProvider::Builtin(),
+                      cel::RuntimeOptions{});
+
+  google::protobuf::Arena arena;
+  std::vector<cel::Activation> activations(3);
+  std::vector<const cel::ActivationInterface*> batch;
+  for (size_t i = 0; i < activations.size(); ++i) {
+    activations[i].InsertOrAssignValue("x", CreateIntValue(i * 10));
+    batch.push_back(&activations[i]);
+  }
+
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(ProtoMemoryManagerRef(&arena));
+  ASSERT_OK_AND_ASSIGN(auto results, expr.EvaluateBatch(batch, state));
+
+  ASSERT_EQ(results.size(), 3);
+  for (size_t i = 0; i < results.size(); ++i) {
+    ASSERT_TRUE(results[i]->Is<IntValue>());
+    EXPECT_EQ(results[i]->As<IntValue>().NativeValue(), i * 10 + 1);
+  }
+}
+
+TEST(EvaluatorCoreTest, EvaluateBatchStopsOnError) {
+  ExecutionPath path;
+  path.push_back(std::make_unique<FakeIdentExpressionStep>());
+
+  FlatExpression expr(std::move(path), 0, cel::TypeProvider::Builtin(),
+                      cel::RuntimeOptions{});
+
+  google::protobuf::Arena arena;
+  cel::Activation with_x;
+  with_x.InsertOrAssignValue("x", CreateIntValue(1));
+  cel::Activation without_x;
+  std::vector<const cel::ActivationInterface*> batch = {&with_x, &without_x};
+
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(ProtoMemoryManagerRef(&arena));
+  EXPECT_THAT(expr.EvaluateBatch(batch, state),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+ExecutionPath MakeIncrementPath(int increments) {
+  ExecutionPath path;
+  path.push_back(std::make_unique<FakeConstExpressionStep>());
+  for (int i = 0; i < increments; ++i) {
+    path.push_back(std::make_unique<FakeIncrementExpressionStep>());
+  }
+  return path;
+}
+
+TEST(EvaluatorCoreTest, StepBudget) {
+  cel::RuntimeOptions options;
+  options.max_evaluation_steps = 5;
+  options.evaluation_budget_check_interval = 2;
+
+  Activation activation;
+  google::protobuf::Arena arena;
+
+  CelExpressionFlatImpl within_budget(FlatExpression(
+      MakeIncrementPath(4), 0, cel::TypeProvider::Builtin(), options));
+  ASSERT_OK_AND_ASSIGN(CelValue value,
+                       within_budget.Evaluate(activation, &arena));
+  EXPECT_THAT(value.Int64OrDie(), Eq(4));
+
+  CelExpressionFlatImpl over_budget(FlatExpression(
+      MakeIncrementPath(5), 0, cel::TypeProvider::Builtin(), options));
+  EXPECT_THAT(over_budget.Evaluate(activation, &arena),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+TEST(EvaluatorCoreTest, CostBudget) {
+  cel::RuntimeOptions options;
+  options.max_evaluation_cost = 5;
+  options.evaluation_budget_check_interval = 2;
+
+  Activation activation;
+  google::protobuf::Arena arena;
+
+  CelExpressionFlatImpl within_budget(FlatExpression(
+      MakeIncrementPath(4), 0, cel::TypeProvider::Builtin(), options));
+  ASSERT_OK_AND_ASSIGN(CelValue value,
+                       within_budget.Evaluate(activation, &arena));
+  EXPECT_THAT(value.Int64OrDie(), Eq(4));
+
+  CelExpressionFlatImpl over_budget(FlatExpression(
+      MakeIncrementPath(5), 0, cel::TypeProvider::Builtin(), options));
+  EXPECT_THAT(over_budget.Evaluate(activation, &arena),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+TEST(EvaluatorCoreTest, EvaluationDeadline) {
+  cel::RuntimeOptions options;
+  options.evaluation_deadline = absl::ZeroDuration();
+
+  CelExpressionFlatImpl impl(FlatExpression(
+      MakeIncrementPath(2), 0, cel::TypeProvider::Builtin(), options));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  EXPECT_THAT(impl.Evaluate(activation, &arena),
+              StatusIs(absl::StatusCode::kDeadlineExceeded));
+
+  options.evaluation_deadline = absl::Hours(1);
+  CelExpressionFlatImpl generous(FlatExpression(
+      MakeIncrementPath(2), 0, cel::TypeProvider::Builtin(), options));
+  ASSERT_OK_AND_ASSIGN(CelValue value, generous.Evaluate(activation, &arena));
+  EXPECT_THAT(value.Int64OrDie(), Eq(2));
+}
+
+ExecutionPath MakeAllocatingPath(int allocations) {
+  ExecutionPath path;
+  for (int i = 0; i < allocations; ++i) {
+    path.push_back(std::make_unique<FakeAllocatingExpressionStep>());
+  }
+  return path;
+}
+
+// Builds a list of 10000 ints, whose storage is owned by the list value.
+class FakeListBuildingExpressionStep : public ExpressionStep {
+ public:
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    cel::ValueFactory& value_factory = frame->value_factory();
+    cel::ListValueBuilder<cel::Value> builder(
+        value_factory, value_factory.type_factory().GetDynType());
+    for (int64_t i = 0; i < 10000; ++i) {
+      CEL_RETURN_IF_ERROR(builder.Add(value_factory.CreateIntValue(i)));
+    }
+    CEL_ASSIGN_OR_RETURN(auto list, std::move(builder).Build());
+    frame->value_stack().Push(std::move(list));
+    return absl::OkStatus();
+  }
+
+  int64_t id() const override { return 0; }
+
+  bool ComesFromAst() const override { return true; }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId();
+  }
+};
+
+ExecutionPath MakeListBuildingPath() {
+  ExecutionPath path;
+  path.push_back(std::make_unique<FakeListBuildingExpressionStep>());
+  return path;
+}
+
+TEST(EvaluatorCoreTest, MemoryQuotaRequiresOwnedArena) {
+  FlatExpression expr(MakeListBuildingPath(), 0, cel::TypeProvider::Builtin(),
+                      cel::RuntimeOptions());
+  cel::Activation activation;
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(cel::MemoryManagerRef::ReferenceCounting());
+  // The list storage is allocated outside of any arena, so a quota could not
+  // account for it.
+  EXPECT_THAT(state.set_memory_quota(1000),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_EQ(state.memory_quota(), 0);
+  ASSERT_OK_AND_ASSIGN(
+      auto list,
+      expr.EvaluateWithCallback(activation, EvaluationListener(), state));
+  EXPECT_EQ(list->As<cel::ListValue>().Size(), 10000);
+
+  ASSERT_OK(state.set_memory_quota(0));
+}
+
+TEST(EvaluatorCoreTest, MemoryQuotaOwnedArena) {
+  FlatExpression expr(MakeAllocatingPath(100), 0, cel::TypeProvider::Builtin(),
+                      cel::RuntimeOptions());
+  cel::Activation activation;
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(cel::PoolingArenaOptions());
+  ASSERT_OK(state.set_memory_quota(1000));
+  EXPECT_THAT(
+      expr.EvaluateWithCallback(activation, EvaluationListener(), state),
+      StatusIs(absl::StatusCode::kResourceExhausted));
+
+  // The arena is reset by the next evaluation, which is measured on its own.
+  ASSERT_OK(state.set_memory_quota(1000000));
+  ASSERT_OK(expr.EvaluateWithCallback(activation, EvaluationListener(), state));
+  ASSERT_OK(expr.EvaluateWithCallback(activation, EvaluationListener(), state));
+}
+
+TEST(EvaluatorCoreTest, MemoryQuotaCountsListStorage) {
+  FlatExpression expr(MakeListBuildingPath(), 0, cel::TypeProvider::Builtin(),
+                      cel::RuntimeOptions());
+  cel::Activation activation;
+  FlatExpressionEvaluatorState state =
+      expr.MakeEvaluatorState(cel::PoolingArenaOptions());
+  // A single step allocating the list is caught by the final check.
+  ASSERT_OK(state.set_memory_quota(10000));
+  EXPECT_THAT(
+      expr.EvaluateWithCallback(activation, EvaluationListener(), state),
+      StatusIs(absl::StatusCode::kResourceExhausted));
+
+  ASSERT_OK(state.set_memory_quota(10000000));
+  ASSERT_OK(expr.EvaluateWithCallback(activation, EvaluationListener(), state));
+}
+
+TEST(EvaluatorCoreTest, StepArena) {
+  auto step_arena = std::make_unique<StepArena>();
+  ExecutionPath path;
+  {
+    StepArena::Scope scope(step_arena.get());
+    path = MakeIncrementPath(3);
+  }
+  for (const auto& step : path) {
+    EXPECT_TRUE(step_arena->Contains(step.get()));
+  }
+  size_t space_allocated = step_arena->SpaceAllocated();
+
+  FlatExpression expression(std::move(path), 0, cel::TypeProvider::Builtin(),
+                            cel::RuntimeOptions());
+  expression.set_step_arena(std::move(step_arena));
+  EXPECT_TRUE(expression.has_step_arena());
+  EXPECT_GT(expression.ResidentSize(), space_allocated);
+
+  CelExpressionFlatImpl impl(std::move(expression));
+  Activation activation;
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+  EXPECT_THAT(value.Int64OrDie(), Eq(3));
+}
+
 class MockTraceCallback {
  public:
   MOCK_METHOD(void, Call,
@@ -220,4 +507,79 @@ TEST(EvaluatorCoreTest, TraceTest) {
   ASSERT_OK(eval_status);
 }
 
+// 1 + 2, with ids 1 for the call and 2 and 3 for the arguments.
+Expr MakeAddExpr() {
+  Expr expr;
+  expr.set_id(1);
+  auto add_call = expr.mutable_call_expr();
+  add_call->set_function("_+_");
+  auto lhs = add_call->add_args();
+  lhs->set_id(2);
+  lhs->mutable_const_expr()->set_int64_value(1);
+  auto rhs = add_call->add_args();
+  rhs->set_id(3);
+  rhs->mutable_const_expr()->set_int64_value(2);
+  return expr;
+}
+
+TEST(EvaluatorCoreTest, TraceSampleInterval) {
+  Expr expr = MakeAddExpr();
+  google::api::expr::v1alpha1::SourceInfo source_info;
+
+  cel::RuntimeOptions options;
+  options.trace_sample_interval = 3;
+  CelExpressionBuilderFlatImpl builder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder.CreateExpression(&expr, &source_info));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  MockTraceCallback callback;
+  // Only the first and fourth of six evaluations are traced.
+  EXPECT_CALL(callback, Call(1, _, &arena)).Times(2);
+  EXPECT_CALL(callback, Call(2, _, &arena)).Times(2);
+  EXPECT_CALL(callback, Call(3, _, &arena)).Times(2);
+
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_OK_AND_ASSIGN(
+        CelValue value,
+        cel_expr->Trace(activation, &arena,
+                        [&](int64_t expr_id, const CelValue& value,
+                            google::protobuf::Arena* arena) {
+                          callback.Call(expr_id, value, arena);
+                          return absl::OkStatus();
+                        }));
+    EXPECT_THAT(value.Int64OrDie(), Eq(3));
+  }
+}
+
+TEST(EvaluatorCoreTest, TraceExprIdFilter) {
+  Expr expr = MakeAddExpr();
+  google::api::expr::v1alpha1::SourceInfo source_info;
+
+  cel::RuntimeOptions options;
+  options.trace_expr_ids = {3, 1};
+  for (bool compact : {false, true}) {
+    options.enable_compact_dispatch = compact;
+    CelExpressionBuilderFlatImpl builder(options);
+    ASSERT_OK(RegisterBuiltinFunctions(builder.GetRegistry()));
+    ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                         builder.CreateExpression(&expr, &source_info));
+
+    Activation activation;
+    google::protobuf::Arena arena;
+    MockTraceCallback callback;
+    EXPECT_CALL(callback, Call(1, _, &arena));
+    EXPECT_CALL(callback, Call(3, _, &arena));
+
+    ASSERT_OK(cel_expr->Trace(activation, &arena,
+                              [&](int64_t expr_id, const CelValue& value,
+                                  google::protobuf::Arena* arena) {
+                                callback.Call(expr_id, value, arena);
+                                return absl::OkStatus();
+                              }));
+  }
+}
+
 }  // namespace google::api::expr::runtime
@@ -1,11 +1,23 @@
 #include "eval/eval/evaluator_stack.h"
 
+#include "absl/log/absl_log.h"
+#include "internal/no_destructor.h"
+
 namespace google::api::expr::runtime {
 
 void EvaluatorStack::Clear() {
-  stack_.clear();
-  attribute_stack_.clear();
-  current_size_ = 0;
+  Pop(current_size_);
+}
+
+const AttributeTrail& EvaluatorStack::EmptyAttributeTrail() {
+  static const cel::internal::NoDestructor<AttributeTrail> kEmpty;
+  return *kEmpty;
+}
+
+void EvaluatorStack::Grow() {
+  ABSL_DLOG(ERROR) << "Pushing past the planned EvaluatorStack size: "
+                   << max_size_;
+  Reserve(stack_.empty() ? 1 : stack_.size() * 2);
 }
 
 }  // namespace google::api::expr::runtime
@@ -5,7 +5,8 @@
 #include <utility>
 #include <vector>
 
-#include "absl/log/absl_log.h"
+#include "absl/base/optimization.h"
+#include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 #include "base/handle.h"
 #include "base/value.h"
@@ -14,12 +15,26 @@
 namespace google::api::expr::runtime {
 
 // CelValue stack.
-// Implementation is based on vector to allow passing parameters from
-// stack as Span<>.
+// Values and attribute trails are kept in parallel, fixed-capacity arrays
+// sized at plan time so that push and pop only move the top index. Values
+// are passed to steps from the stack as Span<>.
+//
+// The planner bounds the stack depth of each program, and steps check that
+// the stack holds their operands before accessing them, so the accessors only
+// validate their preconditions in debug builds.
+//
+// The attribute lane is only allocated when attribute tracking is enabled.
+// Without it, attributes passed to Push are dropped and PeekAttribute returns
+// an empty trail.
 class EvaluatorStack {
  public:
   explicit EvaluatorStack(size_t max_size)
-      : max_size_(max_size), current_size_(0) {
+      : EvaluatorStack(max_size, /*track_attributes=*/true) {}
+
+  EvaluatorStack(size_t max_size, bool track_attributes)
+      : max_size_(max_size),
+        current_size_(0),
+        track_attributes_(track_attributes) {
     Reserve(max_size);
   }
 
@@ -32,8 +47,13 @@ class EvaluatorStack {
   // Returns true if stack is empty.
   bool empty() const { return current_size_ == 0; }
 
+  // Returns true if the stack keeps an attribute trail per value.
+  bool tracks_attributes() const { return track_attributes_; }
+
   // Attributes stack size.
-  size_t attribute_size() const { return current_size_; }
+  size_t attribute_size() const {
+    return track_attributes_ ? current_size_ : 0;
+  }
 
   // Check that stack has enough elements.
   bool HasEnough(size_t size) const { return current_size_ >= size; }
@@ -45,18 +65,19 @@ class EvaluatorStack {
   // Checking that stack has enough elements is caller's responsibility.
   // Please note that calls to Push may invalidate returned Span object.
   absl::Span<const cel::Handle<cel::Value>> GetSpan(size_t size) const {
-    if (!HasEnough(size)) {
-      ABSL_LOG(ERROR) << "Requested span size (" << size
-                      << ") exceeds current stack size: " << current_size_;
-    }
+    ABSL_DCHECK(HasEnough(size))
+        << "Requested span size (" << size
+        << ") exceeds current stack size: " << current_size_;
     return absl::Span<const cel::Handle<cel::Value>>(
         stack_.data() + current_size_ - size, size);
   }
 
   // Gets the last size attribute trails of the stack.
   // Checking that stack has enough elements is caller's responsibility.
+  // Only valid if the stack tracks attributes.
   // Please note that calls to Push may invalidate returned Span object.
   absl::Span<const AttributeTrail> GetAttributeSpan(size_t size) const {
+    ABSL_DCHECK(track_attributes_);
     return absl::Span<const AttributeTrail>(
         attribute_stack_.data() + current_size_ - size, size);
   }
@@ -64,17 +85,16 @@ class EvaluatorStack {
   // Peeks the last element of the stack.
   // Checking that stack is not empty is caller's responsibility.
   const cel::Handle<cel::Value>& Peek() const {
-    if (empty()) {
-      ABSL_LOG(ERROR) << "Peeking on empty EvaluatorStack";
-    }
+    ABSL_DCHECK(!empty()) << "Peeking on empty EvaluatorStack";
     return stack_[current_size_ - 1];
   }
 
   // Peeks the last element of the attribute stack.
   // Checking that stack is not empty is caller's responsibility.
   const AttributeTrail& PeekAttribute() const {
-    if (empty()) {
-      ABSL_LOG(ERROR) << "Peeking on empty EvaluatorStack";
+    ABSL_DCHECK(!empty()) << "Peeking on empty EvaluatorStack";
+    if (!track_attributes_) {
+      return EmptyAttributeTrail();
     }
     return attribute_stack_[current_size_ - 1];
   }
@@ -82,46 +102,59 @@ class EvaluatorStack {
   // Clears the last size elements of the stack.
   // Checking that stack has enough elements is caller's responsibility.
   void Pop(size_t size) {
-    if (!HasEnough(size)) {
-      ABSL_LOG(ERROR) << "Trying to pop more elements (" << size
-                      << ") than the current stack size: " << current_size_;
+    ABSL_DCHECK(HasEnough(size))
+        << "Trying to pop more elements (" << size
+        << ") than the current stack size: " << current_size_;
+    const size_t new_size = current_size_ - size;
+    for (size_t i = new_size; i < current_size_; ++i) {
+      stack_[i] = cel::Handle<cel::Value>();
     }
-    while (size > 0) {
-      stack_.pop_back();
-      attribute_stack_.pop_back();
-      current_size_--;
-      size--;
+    if (track_attributes_) {
+      for (size_t i = new_size; i < current_size_; ++i) {
+        attribute_stack_[i] = AttributeTrail();
+      }
     }
+    current_size_ = new_size;
   }
 
   // Put element on the top of the stack.
   void Push(cel::Handle<cel::Value> value) {
-    Push(std::move(value), AttributeTrail());
+    if (ABSL_PREDICT_FALSE(current_size_ >= stack_.size())) {
+      Grow();
+    }
+    stack_[current_size_] = std::move(value);
+    current_size_++;
   }
 
   void Push(cel::Handle<cel::Value> value, AttributeTrail attribute) {
-    if (current_size_ >= max_size()) {
-      ABSL_LOG(ERROR) << "No room to push more elements on to EvaluatorStack";
+    if (ABSL_PREDICT_FALSE(current_size_ >= stack_.size())) {
+      Grow();
+    }
+    stack_[current_size_] = std::move(value);
+    if (track_attributes_) {
+      attribute_stack_[current_size_] = std::move(attribute);
     }
-    stack_.push_back(std::move(value));
-    attribute_stack_.push_back(std::move(attribute));
     current_size_++;
   }
 
   // Replace element on the top of the stack.
   // Checking that stack is not empty is caller's responsibility.
   void PopAndPush(cel::Handle<cel::Value> value) {
-    PopAndPush(std::move(value), AttributeTrail());
+    ABSL_DCHECK(!empty()) << "Cannot PopAndPush on empty stack.";
+    stack_[current_size_ - 1] = std::move(value);
+    if (track_attributes_) {
+      attribute_stack_[current_size_ - 1] = AttributeTrail();
+    }
   }
 
   // Replace element on the top of the stack.
   // Checking that stack is not empty is caller's responsibility.
   void PopAndPush(cel::Handle<cel::Value> value, AttributeTrail attribute) {
-    if (empty()) {
-      ABSL_LOG(ERROR) << "Cannot PopAndPush on empty stack.";
-    }
+    ABSL_DCHECK(!empty()) << "Cannot PopAndPush on empty stack.";
     stack_[current_size_ - 1] = std::move(value);
-    attribute_stack_[current_size_ - 1] = std::move(attribute);
+    if (track_attributes_) {
+      attribute_stack_[current_size_ - 1] = std::move(attribute);
+    }
   }
 
   // Update the max size of the stack and update capacity if needed.
@@ -131,16 +164,27 @@ class EvaluatorStack {
   }
 
  private:
-  // Preallocate stack.
+  static const AttributeTrail& EmptyAttributeTrail();
+
+  // Preallocate stack. Capacity never shrinks so that live elements are
+  // preserved.
   void Reserve(size_t size) {
-    stack_.reserve(size);
-    attribute_stack_.reserve(size);
+    if (size > stack_.size()) {
+      stack_.resize(size);
+      if (track_attributes_) {
+        attribute_stack_.resize(size);
+      }
+    }
   }
 
+  // Slow path for a push past the planned max size.
+  void Grow();
+
   std::vector<cel::Handle<cel::Value>> stack_;
   std::vector<AttributeTrail> attribute_stack_;
   size_t max_size_;
   size_t current_size_;
+  bool track_attributes_;
 };
 
 }  // namespace google::api::expr::runtime
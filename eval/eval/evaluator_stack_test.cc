@@ -92,6 +92,48 @@ TEST(EvaluatorStackTest, Clear) {
   ASSERT_TRUE(stack.empty());
 }
 
+TEST(EvaluatorStackTest, WithoutAttributeTracking) {
+  google::protobuf::Arena arena;
+  auto manager = ProtoMemoryManagerRef(&arena);
+  TypeFactory type_factory(manager);
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  EvaluatorStack stack(10, /*track_attributes=*/false);
+  ASSERT_FALSE(stack.tracks_attributes());
+
+  stack.Push(value_factory.CreateIntValue(1));
+  stack.Push(value_factory.CreateIntValue(2), AttributeTrail("name"));
+  ASSERT_EQ(stack.size(), 2);
+  ASSERT_EQ(stack.attribute_size(), 0);
+  ASSERT_EQ(stack.Peek().As<cel::IntValue>()->NativeValue(), 2);
+  ASSERT_TRUE(stack.PeekAttribute().empty());
+
+  stack.PopAndPush(value_factory.CreateIntValue(3), AttributeTrail("name"));
+  ASSERT_EQ(stack.Peek().As<cel::IntValue>()->NativeValue(), 3);
+  ASSERT_TRUE(stack.PeekAttribute().empty());
+
+  stack.Pop(2);
+  ASSERT_TRUE(stack.empty());
+}
+
+TEST(EvaluatorStackTest, PushPastMaxSize) {
+  google::protobuf::Arena arena;
+  auto manager = ProtoMemoryManagerRef(&arena);
+  TypeFactory type_factory(manager);
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  EvaluatorStack stack(1);
+
+  stack.Push(value_factory.CreateIntValue(1));
+  stack.Push(value_factory.CreateIntValue(2), AttributeTrail("name"));
+  ASSERT_EQ(stack.size(), 2);
+  ASSERT_EQ(stack.attribute_size(), 2);
+  ASSERT_EQ(stack.PeekAttribute().attribute(), cel::Attribute("name", {}));
+
+  stack.Pop(1);
+  ASSERT_EQ(stack.Peek().As<cel::IntValue>()->NativeValue(), 1);
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
@@ -0,0 +1,106 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/evaluator_state_pool.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/log/absl_check.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "base/memory.h"
+#include "base/value_factory.h"
+#include "eval/eval/evaluator_core.h"
+
+namespace google::api::expr::runtime {
+
+FlatExpressionEvaluatorStatePool::Lease
+FlatExpressionEvaluatorStatePool::Acquire(
+    const FlatExpression& expression, cel::MemoryManagerRef memory_manager) {
+  std::unique_ptr<FlatExpressionEvaluatorState> state = Pop();
+  if (state == nullptr) {
+    state = absl::WrapUnique(new FlatExpressionEvaluatorState(
+        expression.MakeEvaluatorState(memory_manager)));
+  } else {
+    state->Reset(memory_manager);
+  }
+  return Lease(this, std::move(state));
+}
+
+FlatExpressionEvaluatorStatePool::Lease
+FlatExpressionEvaluatorStatePool::Acquire(const FlatExpression& expression,
+                                          cel::ValueFactory& value_factory) {
+  std::unique_ptr<FlatExpressionEvaluatorState> state = Pop();
+  if (state == nullptr) {
+    state = absl::WrapUnique(new FlatExpressionEvaluatorState(
+        expression.MakeEvaluatorState(value_factory)));
+  } else {
+    state->Reset(value_factory);
+  }
+  return Lease(this, std::move(state));
+}
+
+FlatExpressionEvaluatorStatePool::Lease
+FlatExpressionEvaluatorStatePool::Acquire(
+    const FlatExpression& expression,
+    const cel::PoolingArenaOptions& arena_options) {
+  std::unique_ptr<FlatExpressionEvaluatorState> state = Pop();
+  if (state == nullptr) {
+    state = absl::WrapUnique(new FlatExpressionEvaluatorState(
+        expression.MakeEvaluatorState(arena_options)));
+  }
+  // Released states have already been reset.
+  ABSL_DCHECK(state->owns_arena());
+  return Lease(this, std::move(state));
+}
+
+size_t FlatExpressionEvaluatorStatePool::idle_size() const {
+  absl::MutexLock lock(&mutex_);
+  return idle_.size();
+}
+
+EvaluatorArenaStats FlatExpressionEvaluatorStatePool::arena_stats() const {
+  absl::MutexLock lock(&mutex_);
+  return arena_stats_;
+}
+
+std::unique_ptr<FlatExpressionEvaluatorState>
+FlatExpressionEvaluatorStatePool::Pop() {
+  absl::MutexLock lock(&mutex_);
+  if (idle_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<FlatExpressionEvaluatorState> state = std::move(idle_.back());
+  idle_.pop_back();
+  return state;
+}
+
+void FlatExpressionEvaluatorStatePool::Release(
+    std::unique_ptr<FlatExpressionEvaluatorState> state) {
+  state->Release();
+  const EvaluatorArenaStats arena_stats = state->TakeArenaStats();
+  {
+    absl::MutexLock lock(&mutex_);
+    arena_stats_.Merge(arena_stats);
+    if (idle_.size() < max_idle_) {
+      idle_.push_back(std::move(state));
+      return;
+    }
+  }
+  // Destroyed outside of the lock.
+  state.reset();
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,125 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_EVALUATOR_STATE_POOL_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_EVALUATOR_STATE_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "base/memory.h"
+#include "base/value_factory.h"
+#include "eval/eval/evaluator_core.h"
+
+namespace google::api::expr::runtime {
+
+// Thread-safe free list of evaluator states for a single FlatExpression.
+//
+// Acquiring a state reuses a previously released one when available, so a
+// steady stream of evaluations does not allocate the value stack or
+// comprehension slots. States are reset and unbound from their memory
+// manager or value factory when released, so no values outlive the
+// evaluation that produced them. States that own an arena keep it, and only
+// reset it in place. At most max_idle states are kept idle, so a burst of
+// concurrent evaluations does not pin its states for the pool's lifetime.
+//
+// A pool must only be used with the expression it was first used with, and
+// all leases must be returned before the pool is destroyed.
+class FlatExpressionEvaluatorStatePool {
+ public:
+  // Move-only handle to a pooled state. Returns the state to the pool on
+  // destruction.
+  class Lease {
+   public:
+    Lease(Lease&& other) noexcept
+        : pool_(other.pool_), state_(std::move(other.state_)) {
+      other.pool_ = nullptr;
+    }
+    Lease& operator=(Lease&&) = delete;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    ~Lease() {
+      if (pool_ != nullptr && state_ != nullptr) {
+        pool_->Release(std::move(state_));
+      }
+    }
+
+    FlatExpressionEvaluatorState& state() { return *state_; }
+
+   private:
+    friend class FlatExpressionEvaluatorStatePool;
+
+    Lease(FlatExpressionEvaluatorStatePool* pool,
+          std::unique_ptr<FlatExpressionEvaluatorState> state)
+        : pool_(pool), state_(std::move(state)) {}
+
+    FlatExpressionEvaluatorStatePool* pool_;
+    std::unique_ptr<FlatExpressionEvaluatorState> state_;
+  };
+
+  static constexpr size_t kDefaultMaxIdle = 64;
+
+  // States released while max_idle states are idle are destroyed.
+  explicit FlatExpressionEvaluatorStatePool(size_t max_idle = kDefaultMaxIdle)
+      : max_idle_(max_idle) {}
+
+  FlatExpressionEvaluatorStatePool(const FlatExpressionEvaluatorStatePool&) =
+      delete;
+  FlatExpressionEvaluatorStatePool& operator=(
+      const FlatExpressionEvaluatorStatePool&) = delete;
+
+  // Returns a state for expression that owns a value factory bound to
+  // memory_manager.
+  Lease Acquire(const FlatExpression& expression,
+                cel::MemoryManagerRef memory_manager);
+
+  // Returns a state for expression that uses the caller provided
+  // value_factory. A pool must not mix this with the MemoryManagerRef
+  // overload.
+  Lease Acquire(const FlatExpression& expression,
+                cel::ValueFactory& value_factory);
+
+  // Returns a state for expression that owns a pooling arena, created with
+  // arena_options if no idle state is available. The arena is reset when the
+  // lease is returned, so values produced with the state must not outlive the
+  // lease. A pool must not mix this with the other overloads.
+  Lease Acquire(const FlatExpression& expression,
+                const cel::PoolingArenaOptions& arena_options);
+
+  // Number of idle states. Exposed for testing.
+  size_t idle_size() const;
+
+  // Arena usage of all evaluations with states that own an arena, sampled
+  // when their leases were returned. Useful for sizing the initial block.
+  EvaluatorArenaStats arena_stats() const;
+
+ private:
+  std::unique_ptr<FlatExpressionEvaluatorState> Pop();
+  void Release(std::unique_ptr<FlatExpressionEvaluatorState> state);
+
+  const size_t max_idle_;
+  mutable absl::Mutex mutex_;
+  std::vector<std::unique_ptr<FlatExpressionEvaluatorState>> idle_
+      ABSL_GUARDED_BY(mutex_);
+  EvaluatorArenaStats arena_stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_EVALUATOR_STATE_POOL_H_
@@ -0,0 +1,165 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/evaluator_state_pool.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/handle.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "eval/eval/const_value_step.h"
+#include "eval/eval/evaluator_core.h"
+#include "extensions/protobuf/memory_manager.h"
+#include "internal/testing.h"
+#include "runtime/activation.h"
+#include "runtime/runtime_options.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::extensions::ProtoMemoryManagerRef;
+
+FlatExpression MakeConstExpression() {
+  google::protobuf::Arena arena;
+  cel::TypeFactory type_factory(ProtoMemoryManagerRef(&arena));
+  cel::TypeManager type_manager(type_factory, cel::TypeProvider::Builtin());
+  cel::ValueFactory value_factory(type_manager);
+
+  ExecutionPath path;
+  path.push_back(
+      CreateConstValueStep(value_factory.CreateIntValue(42), -1).value());
+  return FlatExpression(std::move(path), /*comprehension_slots_size=*/0,
+                        cel::TypeProvider::Builtin(), cel::RuntimeOptions{});
+}
+
+TEST(FlatExpressionEvaluatorStatePoolTest, ReusesReleasedStates) {
+  FlatExpression expr = MakeConstExpression();
+  FlatExpressionEvaluatorStatePool pool;
+  cel::Activation activation;
+
+  const FlatExpressionEvaluatorState* first = nullptr;
+  for (int i = 0; i < 3; ++i) {
+    google::protobuf::Arena arena;
+    FlatExpressionEvaluatorStatePool::Lease lease =
+        pool.Acquire(expr, ProtoMemoryManagerRef(&arena));
+    if (first == nullptr) {
+      first = &lease.state();
+    } else {
+      EXPECT_EQ(&lease.state(), first);
+    }
+    EXPECT_EQ(pool.idle_size(), 0);
+
+    ASSERT_OK_AND_ASSIGN(cel::Handle<cel::Value> value,
+                         expr.EvaluateWithCallback(activation, nullptr,
+                                                   lease.state()));
+    ASSERT_TRUE(value->Is<cel::IntValue>());
+    EXPECT_EQ(value->As<cel::IntValue>().NativeValue(), 42);
+  }
+  EXPECT_EQ(pool.idle_size(), 1);
+}
+
+TEST(FlatExpressionEvaluatorStatePoolTest, ConcurrentLeasesUseDistinctStates) {
+  FlatExpression expr = MakeConstExpression();
+  FlatExpressionEvaluatorStatePool pool;
+  google::protobuf::Arena arena;
+
+  {
+    FlatExpressionEvaluatorStatePool::Lease lease1 =
+        pool.Acquire(expr, ProtoMemoryManagerRef(&arena));
+    FlatExpressionEvaluatorStatePool::Lease lease2 =
+        pool.Acquire(expr, ProtoMemoryManagerRef(&arena));
+    EXPECT_NE(&lease1.state(), &lease2.state());
+  }
+  EXPECT_EQ(pool.idle_size(), 2);
+}
+
+TEST(FlatExpressionEvaluatorStatePoolTest, IdleStatesAreBounded) {
+  FlatExpression expr = MakeConstExpression();
+  FlatExpressionEvaluatorStatePool pool(/*max_idle=*/2);
+  google::protobuf::Arena arena;
+
+  {
+    std::vector<FlatExpressionEvaluatorStatePool::Lease> leases;
+    for (int i = 0; i < 5; ++i) {
+      leases.push_back(pool.Acquire(expr, ProtoMemoryManagerRef(&arena)));
+    }
+  }
+  EXPECT_EQ(pool.idle_size(), 2);
+
+  FlatExpressionEvaluatorStatePool::Lease lease1 =
+      pool.Acquire(expr, ProtoMemoryManagerRef(&arena));
+  EXPECT_EQ(pool.idle_size(), 1);
+}
+
+TEST(FlatExpressionEvaluatorStatePoolTest, ExternalValueFactory) {
+  FlatExpression expr = MakeConstExpression();
+  FlatExpressionEvaluatorStatePool pool;
+  cel::Activation activation;
+
+  for (int i = 0; i < 2; ++i) {
+    google::protobuf::Arena arena;
+    cel::TypeFactory type_factory(ProtoMemoryManagerRef(&arena));
+    cel::TypeManager type_manager(type_factory, cel::TypeProvider::Builtin());
+    cel::ValueFactory value_factory(type_manager);
+    FlatExpressionEvaluatorStatePool::Lease lease =
+        pool.Acquire(expr, value_factory);
+    EXPECT_EQ(&lease.state().value_factory(), &value_factory);
+
+    ASSERT_OK_AND_ASSIGN(cel::Handle<cel::Value> value,
+                         expr.EvaluateWithCallback(activation, nullptr,
+                                                   lease.state()));
+    EXPECT_EQ(value->As<cel::IntValue>().NativeValue(), 42);
+  }
+  EXPECT_EQ(pool.idle_size(), 1);
+}
+
+TEST(FlatExpressionEvaluatorStatePoolTest, OwnedArena) {
+  FlatExpression expr = MakeConstExpression();
+  FlatExpressionEvaluatorStatePool pool;
+  cel::Activation activation;
+
+  for (int i = 0; i < 3; ++i) {
+    FlatExpressionEvaluatorStatePool::Lease lease =
+        pool.Acquire(expr, cel::PoolingArenaOptions());
+    EXPECT_TRUE(lease.state().owns_arena());
+    EXPECT_EQ(lease.state().memory_manager().memory_management(),
+              cel::MemoryManagement::kPooling);
+
+    ASSERT_OK_AND_ASSIGN(cel::Handle<cel::Value> value,
+                         expr.EvaluateWithCallback(activation, nullptr,
+                                                   lease.state()));
+    EXPECT_EQ(value->As<cel::IntValue>().NativeValue(), 42);
+    // A constant expression may not allocate, so use the arena directly.
+    EXPECT_THAT(lease.state().memory_manager().Allocate(128, 8),
+                testing::NotNull());
+  }
+  EXPECT_EQ(pool.idle_size(), 1);
+
+  EvaluatorArenaStats stats = pool.arena_stats();
+  EXPECT_EQ(stats.evaluations, 3);
+  EXPECT_GE(stats.peak_bytes, 128);
+  EXPECT_GE(stats.peak_bytes, stats.average_bytes());
+  EXPECT_GE(stats.average_bytes(), 128);
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -1,6 +1,8 @@
 #include "eval/eval/function_step.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -10,9 +12,12 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "absl/types/variant.h"
 #include "base/function.h"
 #include "base/function_descriptor.h"
 #include "base/handle.h"
@@ -20,14 +25,19 @@
 #include "base/value.h"
 #include "base/values/error_value.h"
 #include "base/values/unknown_value.h"
+#include "common/native_type.h"
 #include "eval/eval/attribute_trail.h"
+#include "eval/eval/comprehension_slots.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/expression_step_base.h"
 #include "eval/internal/errors.h"
+#include "internal/casts.h"
 #include "internal/status_macros.h"
 #include "runtime/activation_interface.h"
 #include "runtime/function_overload_reference.h"
 #include "runtime/function_provider.h"
+#include "runtime/function_result_cache.h"
+#include "runtime/function_result_store.h"
 #include "runtime/function_registry.h"
 
 namespace google::api::expr::runtime {
@@ -40,6 +50,10 @@ using ::cel::UnknownValue;
 using ::cel::Value;
 using ::cel::ValueKindToKind;
 
+// Argument buffer for the uncommon cases where arguments cannot be passed
+// to the function directly from the value stack.
+using FunctionArguments = absl::InlinedVector<cel::Handle<cel::Value>, 4>;
+
 // Determine if the overload should be considered. Overloads that can consume
 // errors or unknown sets must be allowed as a non-strict function.
 bool ShouldAcceptOverload(const cel::FunctionDescriptor& descriptor,
@@ -72,29 +86,135 @@ bool ArgumentKindsMatch(const cel::FunctionDescriptor& descriptor,
   return true;
 }
 
+// Returns true if descriptor accepts arguments of exactly the given kinds.
+bool ParameterKindsMatch(const cel::FunctionDescriptor& descriptor,
+                         absl::Span<const cel::Kind> kinds) {
+  if (descriptor.types().size() != kinds.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < kinds.size(); i++) {
+    cel::Kind param_kind = descriptor.types()[i];
+    if (kinds[i] != param_kind && param_kind != cel::Kind::kAny) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the arguments have exactly the given kinds.
+bool ArgumentKindsEqual(absl::Span<const cel::Kind> kinds,
+                        absl::Span<const cel::Handle<cel::Value>> arguments) {
+  if (kinds.size() != arguments.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < kinds.size(); i++) {
+    if (ValueKindToKind(arguments[i]->kind()) != kinds[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Per call site cache mapping argument kind tuples to the index of the only
+// overload (or lazy provider) accepting them, so that repeated evaluations
+// with the same argument kinds skip the linear overload scan.
+//
+// Each entry packs the argument kinds and the overload index into a single
+// word, so lookups are lock-free and a racing insert can only replace one
+// valid entry with another. Steps are shared by all evaluations of a
+// FlatExpression, so the cache is updated from multiple threads.
+class OverloadInlineCache {
+ public:
+  OverloadInlineCache() {
+    for (auto& entry : entries_) {
+      entry.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  OverloadInlineCache(const OverloadInlineCache&) = delete;
+  OverloadInlineCache& operator=(const OverloadInlineCache&) = delete;
+
+  // Returns the cached overload index for the argument kinds, if any.
+  absl::optional<size_t> Lookup(
+      absl::Span<const cel::Handle<cel::Value>> arguments) const {
+    absl::optional<uint64_t> key = MakeKey(arguments);
+    if (!key.has_value()) {
+      return absl::nullopt;
+    }
+    for (const auto& entry : entries_) {
+      uint64_t packed = entry.load(std::memory_order_relaxed);
+      if (packed != 0 && (packed >> kIndexBits) == *key) {
+        return (packed & kIndexMask) - 1;
+      }
+    }
+    return absl::nullopt;
+  }
+
+  // Records that the overload at index is the only one accepting the argument
+  // kinds.
+  void Insert(absl::Span<const cel::Handle<cel::Value>> arguments,
+              size_t index) const {
+    absl::optional<uint64_t> key = MakeKey(arguments);
+    if (!key.has_value() || index + 1 > kIndexMask) {
+      return;
+    }
+    size_t slot =
+        next_slot_.fetch_add(1, std::memory_order_relaxed) % kEntryCount;
+    entries_[slot].store((*key << kIndexBits) | (index + 1),
+                         std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kEntryCount = 4;
+  static constexpr int kIndexBits = 8;
+  static constexpr uint64_t kIndexMask = (uint64_t{1} << kIndexBits) - 1;
+  static constexpr int kKindBits = 6;
+  static constexpr size_t kMaxArguments = (64 - kIndexBits) / kKindBits;
+
+  static absl::optional<uint64_t> MakeKey(
+      absl::Span<const cel::Handle<cel::Value>> arguments) {
+    if (arguments.size() > kMaxArguments) {
+      return absl::nullopt;
+    }
+    uint64_t key = 0;
+    for (const auto& arg : arguments) {
+      key = (key << kKindBits) |
+            static_cast<uint64_t>(ValueKindToKind(arg->kind()));
+    }
+    return key;
+  }
+
+  mutable std::array<std::atomic<uint64_t>, kEntryCount> entries_;
+  mutable std::atomic<size_t> next_slot_{0};
+};
+
 // Convert partially unknown arguments to unknowns before passing to the
-// function.
-// TODO(issues/52): See if this can be refactored to remove the eager
-// arguments copy.
+// function. Arguments are only copied into unknowns_args when at least one of
+// them is partially unknown; otherwise the caller keeps using the spans over
+// the value stack.
 // Argument and attribute spans are expected to be equal length.
-std::vector<cel::Handle<cel::Value>> CheckForPartialUnknowns(
-    ExecutionFrame* frame, absl::Span<const cel::Handle<cel::Value>> args,
-    absl::Span<const AttributeTrail> attrs) {
-  std::vector<cel::Handle<cel::Value>> result;
-  result.reserve(args.size());
+// Returns true if unknowns_args holds the converted arguments.
+bool CheckForPartialUnknowns(ExecutionFrame* frame,
+                             absl::Span<const cel::Handle<cel::Value>> args,
+                             absl::Span<const AttributeTrail> attrs,
+                             FunctionArguments& unknowns_args) {
+  bool converted = false;
   for (size_t i = 0; i < args.size(); i++) {
     const AttributeTrail& trail = attrs.subspan(i, 1)[0];
 
-    if (frame->attribute_utility().CheckForUnknown(trail,
-                                                   /*use_partial=*/true)) {
-      result.push_back(
-          frame->attribute_utility().CreateUnknownSet(trail.attribute()));
-    } else {
-      result.push_back(args.at(i));
+    if (!frame->attribute_utility().CheckForUnknown(trail,
+                                                    /*use_partial=*/true)) {
+      continue;
     }
+    if (!converted) {
+      unknowns_args.assign(args.begin(), args.end());
+      converted = true;
+    }
+    unknowns_args[i] =
+        frame->attribute_utility().CreateUnknownSet(trail.attribute());
   }
 
-  return result;
+  return converted;
 }
 
 bool IsUnknownFunctionResultError(const Handle<Value>& result) {
@@ -150,6 +270,15 @@ class AbstractFunctionStep : public ExpressionStepBase {
   // cel::ErrorValue.
   absl::StatusOr<Handle<Value>> DoEvaluate(ExecutionFrame* frame) const;
 
+  // Resolves and invokes the function for already gathered arguments.
+  //
+  // Arguments are expected to have partial unknowns converted already.
+  absl::StatusOr<Handle<Value>> EvaluateWithArgs(
+      ExecutionFrame* frame,
+      absl::Span<const cel::Handle<cel::Value>> input_args) const;
+
+  size_t num_arguments() const { return num_arguments_; }
+
   virtual absl::StatusOr<ResolveResult> ResolveFunction(
       absl::Span<const cel::Handle<cel::Value>> args,
       const ExecutionFrame* frame) const = 0;
@@ -164,15 +293,23 @@ absl::StatusOr<Handle<Value>> AbstractFunctionStep::DoEvaluate(
   // Create Span object that contains input arguments to the function.
   auto input_args = frame->value_stack().GetSpan(num_arguments_);
 
-  std::vector<cel::Handle<cel::Value>> unknowns_args;
+  FunctionArguments unknowns_args;
   // Preprocess args. If an argument is partially unknown, convert it to an
   // unknown attribute set.
   if (frame->enable_unknowns()) {
     auto input_attrs = frame->value_stack().GetAttributeSpan(num_arguments_);
-    unknowns_args = CheckForPartialUnknowns(frame, input_args, input_attrs);
-    input_args = absl::MakeConstSpan(unknowns_args);
+    if (CheckForPartialUnknowns(frame, input_args, input_attrs,
+                                unknowns_args)) {
+      input_args = absl::MakeConstSpan(unknowns_args);
+    }
   }
 
+  return EvaluateWithArgs(frame, input_args);
+}
+
+absl::StatusOr<Handle<Value>> AbstractFunctionStep::EvaluateWithArgs(
+    ExecutionFrame* frame,
+    absl::Span<const cel::Handle<cel::Value>> input_args) const {
   // Derived class resolves to a single function overload or none.
   CEL_ASSIGN_OR_RETURN(ResolveResult matched_function,
                        ResolveFunction(input_args, frame));
@@ -180,6 +317,47 @@ absl::StatusOr<Handle<Value>> AbstractFunctionStep::DoEvaluate(
   // Overload found and is allowed to consume the arguments.
   if (matched_function.has_value() &&
       ShouldAcceptOverload(matched_function->descriptor, input_args)) {
+    // Calls resolved in an earlier phase of a multi-phase evaluation are not
+    // made again.
+    cel::FunctionResultStore* store =
+        frame->enable_unknown_function_results()
+            ? frame->modern_activation().GetFunctionResultStore()
+            : nullptr;
+    absl::optional<std::string> store_key;
+    if (store != nullptr) {
+      store_key = cel::FunctionResultStore::MakeKey(
+          matched_function->descriptor, id(), input_args);
+    }
+    if (store_key.has_value()) {
+      CEL_ASSIGN_OR_RETURN(auto stored,
+                           store->Lookup(*store_key, frame->value_factory()));
+      if (stored.has_value()) {
+        return *std::move(stored);
+      }
+    }
+
+    // Calls with unknown or error arguments are never cached, since the key
+    // cannot represent them.
+    cel::FunctionResultCache* cache =
+        frame->options().function_result_cache.get();
+    absl::optional<std::string> cache_key;
+    if (cache != nullptr && matched_function->descriptor.is_pure()) {
+      cache_key = cel::FunctionResultCache::MakeKey(
+          matched_function->descriptor, input_args);
+    }
+    if (cache_key.has_value()) {
+      CEL_ASSIGN_OR_RETURN(auto cached,
+                           cache->Lookup(*cache_key, frame->value_factory()));
+      if (cached.has_value()) {
+        return *std::move(cached);
+      }
+    }
+
+    // Charged before the call, so that the cost budget also bounds the
+    // functions that are called.
+    CEL_RETURN_IF_ERROR(
+        frame->ChargeFunction(matched_function->descriptor.cost()));
+
     FunctionEvaluationContext context(frame->value_factory());
 
     CEL_ASSIGN_OR_RETURN(
@@ -191,6 +369,13 @@ absl::StatusOr<Handle<Value>> AbstractFunctionStep::DoEvaluate(
       return frame->attribute_utility().CreateUnknownSet(
           matched_function->descriptor, id(), input_args);
     }
+    if (store_key.has_value()) {
+      store->Insert(*store_key, result);
+    }
+    if (cache_key.has_value()) {
+      // Error and unknown results are not cacheable and are skipped.
+      cache->Insert(*std::move(cache_key), result);
+    }
     return result;
   }
 
@@ -253,20 +438,51 @@ class EagerFunctionStep : public AbstractFunctionStep {
       : AbstractFunctionStep(name, num_args, expr_id),
         overloads_(std::move(overloads)) {}
 
+  // Binds the step to overloads[bound_overload], used whenever the arguments
+  // have exactly bound_kinds. Only one overload may accept those kinds.
+  EagerFunctionStep(std::vector<cel::FunctionOverloadReference> overloads,
+                    size_t bound_overload, std::vector<cel::Kind> bound_kinds,
+                    const std::string& name, size_t num_args, int64_t expr_id)
+      : AbstractFunctionStep(name, num_args, expr_id),
+        overloads_(std::move(overloads)),
+        bound_overload_(bound_overload),
+        bound_kinds_(std::move(bound_kinds)) {}
+
   absl::StatusOr<ResolveResult> ResolveFunction(
       absl::Span<const cel::Handle<cel::Value>> input_args,
       const ExecutionFrame* frame) const override;
 
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<EagerFunctionStep>();
+  }
+
  private:
   std::vector<cel::FunctionOverloadReference> overloads_;
+  absl::optional<size_t> bound_overload_;
+  std::vector<cel::Kind> bound_kinds_;
+  OverloadInlineCache inline_cache_;
 };
 
 absl::StatusOr<ResolveResult> EagerFunctionStep::ResolveFunction(
     absl::Span<const cel::Handle<cel::Value>> input_args,
     const ExecutionFrame* frame) const {
+  // Arguments of the expected kinds match exactly the bound overload, so the
+  // search below would find the same one.
+  if (bound_overload_.has_value() &&
+      ArgumentKindsEqual(bound_kinds_, input_args)) {
+    return overloads_[*bound_overload_];
+  }
+
+  if (absl::optional<size_t> cached = inline_cache_.Lookup(input_args);
+      cached.has_value()) {
+    return overloads_[*cached];
+  }
+
   ResolveResult result = absl::nullopt;
+  size_t result_index = 0;
 
-  for (const auto& overload : overloads_) {
+  for (size_t i = 0; i < overloads_.size(); ++i) {
+    const auto& overload = overloads_[i];
     if (ArgumentKindsMatch(overload.descriptor, input_args)) {
       // More than one overload matches our arguments.
       if (result.has_value()) {
@@ -275,8 +491,12 @@ absl::StatusOr<ResolveResult> EagerFunctionStep::ResolveFunction(
       }
 
       result.emplace(overload);
+      result_index = i;
     }
   }
+  if (result.has_value()) {
+    inline_cache_.Insert(input_args, result_index);
+  }
   return result;
 }
 
@@ -299,6 +519,7 @@ class LazyFunctionStep : public AbstractFunctionStep {
  private:
   bool receiver_style_;
   std::vector<cel::FunctionRegistry::LazyOverload> providers_;
+  OverloadInlineCache inline_cache_;
 };
 
 absl::StatusOr<ResolveResult> LazyFunctionStep::ResolveFunction(
@@ -316,13 +537,32 @@ absl::StatusOr<ResolveResult> LazyFunctionStep::ResolveFunction(
   cel::FunctionDescriptor matcher{name_, receiver_style_, arg_types};
 
   const cel::ActivationInterface& activation = frame->modern_activation();
-  for (auto provider : providers_) {
+
+  // Providers may return a different function per activation, so only the
+  // kind check selecting the provider is cached.
+  if (absl::optional<size_t> cached = inline_cache_.Lookup(input_args);
+      cached.has_value()) {
+    CEL_ASSIGN_OR_RETURN(
+        auto overload,
+        providers_[*cached].provider.GetFunction(matcher, activation));
+    if (overload.has_value()) {
+      result.emplace(overload.value());
+    }
+    return result;
+  }
+
+  absl::optional<size_t> candidate;
+  size_t candidate_count = 0;
+  for (size_t i = 0; i < providers_.size(); ++i) {
+    const auto& provider = providers_[i];
     // The LazyFunctionStep has so far only resolved by function shape, check
     // that the runtime argument kinds agree with the specific descriptor for
     // the provider candidates.
     if (!ArgumentKindsMatch(provider.descriptor, input_args)) {
       continue;
     }
+    candidate = i;
+    ++candidate_count;
 
     CEL_ASSIGN_OR_RETURN(auto overload,
                          provider.provider.GetFunction(matcher, activation));
@@ -336,12 +576,93 @@ absl::StatusOr<ResolveResult> LazyFunctionStep::ResolveFunction(
       result.emplace(overload.value());
     }
   }
+  if (candidate_count == 1) {
+    inline_cache_.Insert(input_args, *candidate);
+  }
 
   return result;
 }
 
+// Function step that reads its arguments directly from compiler constants and
+// comprehension slots instead of popping them from the value stack.
+class RegisterOperandFunctionStep : public ExpressionStepBase {
+ public:
+  RegisterOperandFunctionStep(
+      std::unique_ptr<const AbstractFunctionStep> function_step,
+      std::vector<FunctionOperand> operands)
+      : ExpressionStepBase(function_step->id()),
+        function_step_(std::move(function_step)),
+        operands_(std::move(operands)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+ private:
+  std::unique_ptr<const AbstractFunctionStep> function_step_;
+  std::vector<FunctionOperand> operands_;
+};
+
+absl::Status RegisterOperandFunctionStep::Evaluate(
+    ExecutionFrame* frame) const {
+  FunctionArguments args;
+  args.reserve(operands_.size());
+  for (const FunctionOperand& operand : operands_) {
+    if (const auto* slot = absl::get_if<FunctionOperand::Slot>(&operand.value);
+        slot != nullptr) {
+      const ComprehensionSlots::Slot* value =
+          frame->comprehension_slots().Get(slot->index);
+      if (value == nullptr) {
+        return absl::InternalError(absl::StrCat(
+            "Comprehension variable accessed out of scope: ", slot->name));
+      }
+      args.push_back(value->value);
+      continue;
+    }
+    args.push_back(absl::get<Handle<Value>>(operand.value));
+  }
+
+  CEL_ASSIGN_OR_RETURN(
+      auto result,
+      function_step_->EvaluateWithArgs(frame, absl::MakeConstSpan(args)));
+
+  frame->value_stack().Push(std::move(result));
+  return absl::OkStatus();
+}
+
 }  // namespace
 
+bool IsEagerFunctionStep(const ExpressionStep& step) {
+  return step.GetNativeTypeId() == cel::NativeTypeId::For<EagerFunctionStep>();
+}
+
+absl::StatusOr<Handle<Value>> InvokeEagerFunctionStep(
+    const ExpressionStep& step, ExecutionFrame* frame,
+    absl::Span<const Handle<Value>> args) {
+  if (!IsEagerFunctionStep(step)) {
+    return absl::InternalError("expected an eagerly bound function step");
+  }
+  return cel::internal::down_cast<const AbstractFunctionStep&>(step)
+      .EvaluateWithArgs(frame, args);
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>>
+CreateRegisterOperandFunctionStep(
+    std::unique_ptr<const ExpressionStep> function_step,
+    std::vector<FunctionOperand> operands) {
+  if (function_step == nullptr || !IsEagerFunctionStep(*function_step)) {
+    return absl::InvalidArgumentError(
+        "register operands require an eagerly bound function step");
+  }
+  auto eager_step = absl::WrapUnique(
+      cel::internal::down_cast<const AbstractFunctionStep*>(
+          function_step.release()));
+  if (eager_step->num_arguments() != operands.size()) {
+    return absl::InvalidArgumentError(
+        "register operand count does not match function arity");
+  }
+  return std::make_unique<RegisterOperandFunctionStep>(std::move(eager_step),
+                                                       std::move(operands));
+}
+
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateFunctionStep(
     const cel::ast_internal::Call& call_expr, int64_t expr_id,
     std::vector<cel::FunctionRegistry::LazyOverload> lazy_overloads) {
@@ -354,10 +675,36 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateFunctionStep(
 
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateFunctionStep(
     const cel::ast_internal::Call& call_expr, int64_t expr_id,
-    std::vector<cel::FunctionOverloadReference> overloads) {
+    std::vector<cel::FunctionOverloadReference> overloads,
+    absl::Span<const cel::Kind> expected_argument_kinds) {
   bool receiver_style = call_expr.has_target();
   size_t num_args = call_expr.args().size() + (receiver_style ? 1 : 0);
   const std::string& name = call_expr.function();
+
+  if (!expected_argument_kinds.empty() &&
+      expected_argument_kinds.size() == num_args) {
+    absl::optional<size_t> bound_overload;
+    for (size_t i = 0; i < overloads.size(); ++i) {
+      if (!ParameterKindsMatch(overloads[i].descriptor,
+                               expected_argument_kinds)) {
+        continue;
+      }
+      if (bound_overload.has_value()) {
+        // Ambiguous, leave the resolution to evaluation time.
+        bound_overload.reset();
+        break;
+      }
+      bound_overload = i;
+    }
+    if (bound_overload.has_value()) {
+      return std::make_unique<EagerFunctionStep>(
+          std::move(overloads), *bound_overload,
+          std::vector<cel::Kind>(expected_argument_kinds.begin(),
+                                 expected_argument_kinds.end()),
+          name, num_args, expr_id);
+    }
+  }
+
   return std::make_unique<EagerFunctionStep>(std::move(overloads), name,
                                              num_args, expr_id);
 }
@@ -1,12 +1,19 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_FUNCTION_STEP_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_FUNCTION_STEP_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
 #include "base/ast_internal/expr.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
 #include "eval/eval/evaluator_core.h"
 #include "runtime/function_registry.h"
 
@@ -21,9 +28,50 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateFunctionStep(
 // Factory method for Call-based execution step where the function has been
 // statically resolved from a set of eagerly functions configured in the
 // CelFunctionRegistry.
+//
+// If expected_argument_kinds is not empty and exactly one of the overloads
+// accepts arguments of those kinds, the step is bound to that overload: calls
+// whose arguments have exactly the expected kinds invoke it directly, and
+// only other calls search the overloads.
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateFunctionStep(
     const cel::ast_internal::Call& call, int64_t expr_id,
-    std::vector<cel::FunctionOverloadReference> overloads);
+    std::vector<cel::FunctionOverloadReference> overloads,
+    absl::Span<const cel::Kind> expected_argument_kinds = {});
+
+// Operand for a function step that is read in place rather than from the
+// value stack: either a compile time constant or a comprehension slot.
+struct FunctionOperand {
+  struct Slot {
+    size_t index;
+    // Variable name, used for error reporting.
+    std::string name;
+  };
+
+  absl::variant<cel::Handle<cel::Value>, Slot> value;
+};
+
+// Returns true if step is a function step created with statically resolved
+// overloads.
+bool IsEagerFunctionStep(const ExpressionStep& step);
+
+// Resolves and invokes the overloads bound to an eager function step (see
+// IsEagerFunctionStep) with already evaluated arguments, without touching the
+// value stack. Used by fused steps as the generic fallback.
+absl::StatusOr<cel::Handle<cel::Value>> InvokeEagerFunctionStep(
+    const ExpressionStep& step, ExecutionFrame* frame,
+    absl::Span<const cel::Handle<cel::Value>> args);
+
+// Factory method for a function step that reads its arguments from the given
+// operands instead of the value stack. function_step must be an eager function
+// step (see IsEagerFunctionStep) with arity matching operands.
+//
+// Operands are read as-is: unknown and missing attribute checks are not
+// applied to comprehension slots, so this should only be used when those
+// features are disabled.
+absl::StatusOr<std::unique_ptr<ExpressionStep>>
+CreateRegisterOperandFunctionStep(
+    std::unique_ptr<const ExpressionStep> function_step,
+    std::vector<FunctionOperand> operands);
 
 }  // namespace google::api::expr::runtime
 
@@ -1,6 +1,7 @@
 #include "eval/eval/function_step.h"
 
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,6 +27,7 @@
 #include "eval/testutil/test_message.pb.h"
 #include "internal/status_macros.h"
 #include "internal/testing.h"
+#include "runtime/function_result_cache.h"
 #include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
@@ -962,5 +964,287 @@ TEST(FunctionStepStrictnessTest, IfFunctionNonStrictAndGivenUnknownInvokesIt) {
   ASSERT_THAT(value, test::IsCelInt64(Eq(0)));
 }
 
+TEST(RegisterOperandFunctionStepTest, ConstantOperands) {
+  CelFunctionRegistry registry;
+  AddDefaults(registry);
+
+  ExecutionPath path;
+  Call add_call = AddFunction::MakeCall();
+  ASSERT_OK_AND_ASSIGN(auto add_step, MakeTestFunctionStep(add_call, registry));
+  ASSERT_TRUE(IsEagerFunctionStep(*add_step));
+
+  std::vector<FunctionOperand> operands;
+  operands.push_back(FunctionOperand{cel::interop_internal::CreateIntValue(2)});
+  operands.push_back(FunctionOperand{cel::interop_internal::CreateIntValue(3)});
+  ASSERT_OK_AND_ASSIGN(auto step, CreateRegisterOperandFunctionStep(
+                                      std::move(add_step), std::move(operands)));
+  path.push_back(std::move(step));
+
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(),
+                                            cel::RuntimeOptions{}));
+  Activation activation;
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+  EXPECT_THAT(value, test::IsCelInt64(Eq(5)));
+}
+
+TEST(RegisterOperandFunctionStepTest, UnsetSlotOperand) {
+  CelFunctionRegistry registry;
+  AddDefaults(registry);
+
+  ExecutionPath path;
+  Call add_call = AddFunction::MakeCall();
+  ASSERT_OK_AND_ASSIGN(auto add_step, MakeTestFunctionStep(add_call, registry));
+
+  std::vector<FunctionOperand> operands;
+  operands.push_back(FunctionOperand{cel::interop_internal::CreateIntValue(2)});
+  operands.push_back(FunctionOperand{FunctionOperand::Slot{0, "x"}});
+  ASSERT_OK_AND_ASSIGN(auto step, CreateRegisterOperandFunctionStep(
+                                      std::move(add_step), std::move(operands)));
+  path.push_back(std::move(step));
+
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/1,
+                                            TypeProvider::Builtin(),
+                                            cel::RuntimeOptions{}));
+  Activation activation;
+  google::protobuf::Arena arena;
+  EXPECT_THAT(impl.Evaluate(activation, &arena),
+              StatusIs(absl::StatusCode::kInternal,
+                       testing::HasSubstr("out of scope: x")));
+}
+
+TEST(RegisterOperandFunctionStepTest, RejectsMismatchedArity) {
+  CelFunctionRegistry registry;
+  AddDefaults(registry);
+
+  Call add_call = AddFunction::MakeCall();
+  ASSERT_OK_AND_ASSIGN(auto add_step, MakeTestFunctionStep(add_call, registry));
+
+  std::vector<FunctionOperand> operands;
+  operands.push_back(FunctionOperand{cel::interop_internal::CreateIntValue(2)});
+  EXPECT_THAT(CreateRegisterOperandFunctionStep(std::move(add_step),
+                                                std::move(operands)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+// Pure function Square(int) that counts its invocations.
+class CountingSquareFunction : public CelFunction {
+ public:
+  explicit CountingSquareFunction(int* calls)
+      : CelFunction(CelFunctionDescriptor{"Square",
+                                          false,
+                                          {CelValue::Type::kInt64},
+                                          /*is_strict=*/true,
+                                          /*is_pure=*/true}),
+        calls_(calls) {}
+
+  absl::Status Evaluate(absl::Span<const CelValue> args, CelValue* result,
+                        google::protobuf::Arena* arena) const override {
+    ++*calls_;
+    int64_t arg = args[0].Int64OrDie();
+    *result = CelValue::CreateInt64(arg * arg);
+    return absl::OkStatus();
+  }
+
+ private:
+  int* calls_;
+};
+
+TEST(FunctionStepResultCacheTest, PureFunctionResultsAreReused) {
+  int calls = 0;
+  CelFunctionRegistry registry;
+  AddDefaults(registry);
+  ASSERT_OK(registry.Register(std::make_unique<CountingSquareFunction>(&calls)));
+
+  Call square_call;
+  square_call.set_function("Square");
+  square_call.mutable_args().emplace_back();
+
+  ExecutionPath path;
+  ASSERT_OK_AND_ASSIGN(
+      auto step0, MakeTestFunctionStep(ConstFunction::MakeCall("Const3"),
+                                       registry));
+  ASSERT_OK_AND_ASSIGN(auto step1, MakeTestFunctionStep(square_call, registry));
+  path.push_back(std::move(step0));
+  path.push_back(std::move(step1));
+
+  cel::RuntimeOptions options;
+  options.function_result_cache =
+      std::make_shared<cel::FunctionResultCache>(/*capacity=*/16);
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(), options));
+
+  Activation activation;
+  for (int i = 0; i < 3; ++i) {
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+    EXPECT_THAT(value, test::IsCelInt64(9));
+  }
+  EXPECT_EQ(calls, 1);
+
+  // Const3 is not pure, so only Square consults the cache.
+  cel::FunctionResultCache::Stats stats =
+      options.function_result_cache->GetStats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 2);
+}
+
+TEST(FunctionStepResultCacheTest, UnknownArgumentsAreNotCached) {
+  int calls = 0;
+  CelFunctionRegistry registry;
+  AddDefaults(registry);
+  ASSERT_OK(registry.Register(std::make_unique<CountingSquareFunction>(&calls)));
+
+  Call square_call;
+  square_call.set_function("Square");
+  square_call.mutable_args().emplace_back();
+
+  ExecutionPath path;
+  ASSERT_OK_AND_ASSIGN(
+      auto step0, MakeTestFunctionStep(ConstFunction::MakeCall("ConstUnknown"),
+                                       registry));
+  ASSERT_OK_AND_ASSIGN(auto step1, MakeTestFunctionStep(square_call, registry));
+  path.push_back(std::move(step0));
+  path.push_back(std::move(step1));
+
+  cel::RuntimeOptions options;
+  options.unknown_processing = cel::UnknownProcessingOptions::kAttributeOnly;
+  options.function_result_cache =
+      std::make_shared<cel::FunctionResultCache>(/*capacity=*/16);
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(), options));
+
+  Activation activation;
+  google::protobuf::Arena arena;
+  ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+  EXPECT_TRUE(value.IsUnknownSet());
+  EXPECT_EQ(calls, 0);
+  cel::FunctionResultCache::Stats stats =
+      options.function_result_cache->GetStats();
+  EXPECT_EQ(stats.hits + stats.misses, 0);
+}
+
+// Describe(x) overload that returns the name of the kind it accepts.
+class DescribeFunction : public CelFunction {
+ public:
+  DescribeFunction(CelValue::Type type, absl::string_view kind_name)
+      : CelFunction(CelFunctionDescriptor{"Describe", false, {type}}),
+        kind_name_(kind_name) {}
+
+  absl::Status Evaluate(absl::Span<const CelValue> args, CelValue* result,
+                        google::protobuf::Arena* arena) const override {
+    *result = CelValue::CreateStringView(kind_name_);
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::string_view kind_name_;
+};
+
+TEST(FunctionStepBoundOverloadTest, FallsBackWhenKindsDiffer) {
+  CelFunctionRegistry registry;
+  ASSERT_OK(registry.Register(
+      std::make_unique<DescribeFunction>(CelValue::Type::kInt64, "int")));
+  ASSERT_OK(registry.Register(
+      std::make_unique<DescribeFunction>(CelValue::Type::kDouble, "double")));
+
+  Ident ident;
+  ident.set_name("x");
+  Call call;
+  call.set_function("Describe");
+  call.mutable_args().emplace_back();
+
+  ExecutionPath path;
+  ASSERT_OK_AND_ASSIGN(auto step0, CreateIdentStep(ident, GetExprId()));
+  const cel::Kind kExpectedKinds[] = {cel::Kind::kInt64};
+  ASSERT_OK_AND_ASSIGN(
+      auto step1,
+      CreateFunctionStep(call, GetExprId(),
+                         registry.FindStaticOverloads("Describe", false,
+                                                      ArgumentMatcher(call)),
+                         kExpectedKinds));
+  path.push_back(std::move(step0));
+  path.push_back(std::move(step1));
+
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(),
+                                            cel::RuntimeOptions{}));
+
+  google::protobuf::Arena arena;
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(1));
+  ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+  EXPECT_THAT(value, test::IsCelString("int"));
+
+  // The checker's expectation can be wrong for dynamic inputs; the step then
+  // resolves the overload as usual.
+  activation.RemoveValueEntry("x");
+  activation.InsertValue("x", CelValue::CreateDouble(1.5));
+  ASSERT_OK_AND_ASSIGN(value, impl.Evaluate(activation, &arena));
+  EXPECT_THAT(value, test::IsCelString("double"));
+
+  activation.RemoveValueEntry("x");
+  activation.InsertValue("x", CelValue::CreateBool(true));
+  ASSERT_OK_AND_ASSIGN(value, impl.Evaluate(activation, &arena));
+  ASSERT_TRUE(value.IsError());
+  EXPECT_THAT(*value.ErrorOrDie(),
+              StatusIs(absl::StatusCode::kUnknown,
+                       testing::HasSubstr("Describe(bool)")));
+}
+
+TEST(FunctionStepInlineCacheTest, AlternatingArgumentKinds) {
+  CelFunctionRegistry registry;
+  ASSERT_OK(registry.Register(
+      std::make_unique<DescribeFunction>(CelValue::Type::kInt64, "int")));
+  ASSERT_OK(registry.Register(
+      std::make_unique<DescribeFunction>(CelValue::Type::kDouble, "double")));
+  ASSERT_OK(registry.Register(
+      std::make_unique<DescribeFunction>(CelValue::Type::kString, "string")));
+
+  Ident ident;
+  ident.set_name("x");
+  Call call;
+  call.set_function("Describe");
+  call.mutable_args().emplace_back();
+
+  ExecutionPath path;
+  ASSERT_OK_AND_ASSIGN(auto step0, CreateIdentStep(ident, GetExprId()));
+  ASSERT_OK_AND_ASSIGN(auto step1, MakeTestFunctionStep(call, registry));
+  path.push_back(std::move(step0));
+  path.push_back(std::move(step1));
+
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(),
+                                            cel::RuntimeOptions{}));
+
+  google::protobuf::Arena arena;
+  const std::pair<CelValue, absl::string_view> kCases[] = {
+      {CelValue::CreateInt64(1), "int"},
+      {CelValue::CreateDouble(1.5), "double"},
+      {CelValue::CreateStringView("a"), "string"},
+  };
+  // More rounds than the cache has entries, so entries are also replaced.
+  for (int round = 0; round < 3; ++round) {
+    for (const auto& [arg, expected] : kCases) {
+      Activation activation;
+      activation.InsertValue("x", arg);
+      ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+      EXPECT_THAT(value, test::IsCelString(expected));
+    }
+  }
+
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateBool(true));
+  ASSERT_OK_AND_ASSIGN(CelValue value, impl.Evaluate(activation, &arena));
+  EXPECT_TRUE(value.IsError());
+}
+
 }  // namespace
 }  // namespace google::api::expr::runtime
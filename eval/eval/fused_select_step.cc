@@ -0,0 +1,311 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/fused_select_step.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/error_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/string_value.h"
+#include "base/values/uint_value.h"
+#include "base/values/unknown_value.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
+#include "eval/eval/function_step.h"
+#include "eval/eval/select_step.h"
+#include "internal/status_macros.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::BoolValue;
+using ::cel::ErrorValue;
+using ::cel::Handle;
+using ::cel::IntValue;
+using ::cel::ListValue;
+using ::cel::StringValue;
+using ::cel::UintValue;
+using ::cel::UnknownValue;
+using ::cel::Value;
+using ::cel::ValueKind;
+
+using SelectChain = std::vector<std::unique_ptr<const SelectStep>>;
+
+// Applies the selects in order, stopping at the first unknown or error.
+absl::StatusOr<Handle<Value>> ApplySelects(const SelectChain& selects,
+                                           Handle<Value> value,
+                                           cel::ValueFactory& value_factory) {
+  for (const auto& select : selects) {
+    if (value->Is<UnknownValue>() || value->Is<ErrorValue>()) {
+      break;
+    }
+    CEL_ASSIGN_OR_RETURN(value, select->SelectValue(value, value_factory));
+  }
+  return value;
+}
+
+// Compares values of the same primitive kind. Returns nullopt if the kinds
+// differ or aren't handled inline.
+absl::optional<bool> PrimitiveEquals(const Handle<Value>& lhs,
+                                     const Handle<Value>& rhs) {
+  if (lhs->kind() != rhs->kind()) {
+    return absl::nullopt;
+  }
+  switch (lhs->kind()) {
+    case ValueKind::kBool:
+      return lhs.As<BoolValue>()->NativeValue() ==
+             rhs.As<BoolValue>()->NativeValue();
+    case ValueKind::kInt:
+      return lhs.As<IntValue>()->NativeValue() ==
+             rhs.As<IntValue>()->NativeValue();
+    case ValueKind::kUint:
+      return lhs.As<UintValue>()->NativeValue() ==
+             rhs.As<UintValue>()->NativeValue();
+    case ValueKind::kString:
+      return lhs.As<StringValue>()->Equals(*rhs.As<StringValue>());
+    default:
+      return absl::nullopt;
+  }
+}
+
+class SelectChainStep : public ExpressionStepBase {
+ public:
+  SelectChainStep(SelectChain selects, int64_t expr_id)
+      : ExpressionStepBase(expr_id), selects_(std::move(selects)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(1)) {
+      return absl::Status(absl::StatusCode::kInternal,
+                          "No arguments supplied for Select-type expression");
+    }
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         ApplySelects(selects_, frame->value_stack().Peek(),
+                                      frame->value_factory()));
+    frame->value_stack().PopAndPush(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  SelectChain selects_;
+};
+
+class SelectCompareConstantStep : public ExpressionStepBase {
+ public:
+  SelectCompareConstantStep(SelectChain selects, Handle<Value> constant,
+                            bool constant_is_lhs, bool negate,
+                            std::unique_ptr<const ExpressionStep> function_step,
+                            int64_t expr_id)
+      : ExpressionStepBase(expr_id),
+        selects_(std::move(selects)),
+        constant_(std::move(constant)),
+        constant_is_lhs_(constant_is_lhs),
+        negate_(negate),
+        function_step_(std::move(function_step)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(1)) {
+      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+    }
+    CEL_ASSIGN_OR_RETURN(Handle<Value> operand,
+                         ApplySelects(selects_, frame->value_stack().Peek(),
+                                      frame->value_factory()));
+
+    absl::optional<bool> equal = PrimitiveEquals(operand, constant_);
+    if (equal.has_value()) {
+      frame->value_stack().PopAndPush(
+          frame->value_factory().CreateBoolValue(*equal != negate_));
+      return absl::OkStatus();
+    }
+
+    Handle<Value> args[2];
+    args[constant_is_lhs_ ? 0 : 1] = constant_;
+    args[constant_is_lhs_ ? 1 : 0] = std::move(operand);
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         InvokeEagerFunctionStep(*function_step_, frame,
+                                                 absl::MakeConstSpan(args)));
+    frame->value_stack().PopAndPush(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  SelectChain selects_;
+  Handle<Value> constant_;
+  bool constant_is_lhs_;
+  bool negate_;
+  std::unique_ptr<const ExpressionStep> function_step_;
+};
+
+class InConstantListStep : public ExpressionStepBase {
+ public:
+  InConstantListStep(SelectChain selects, Handle<ListValue> list,
+                     ValueKind element_kind,
+                     absl::flat_hash_set<std::string> string_elements,
+                     absl::flat_hash_set<int64_t> int_elements,
+                     std::unique_ptr<const ExpressionStep> function_step,
+                     int64_t expr_id)
+      : ExpressionStepBase(expr_id),
+        selects_(std::move(selects)),
+        list_(std::move(list)),
+        element_kind_(element_kind),
+        string_elements_(std::move(string_elements)),
+        int_elements_(std::move(int_elements)),
+        function_step_(std::move(function_step)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(1)) {
+      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+    }
+    CEL_ASSIGN_OR_RETURN(Handle<Value> operand,
+                         ApplySelects(selects_, frame->value_stack().Peek(),
+                                      frame->value_factory()));
+
+    absl::optional<bool> contains = Contains(operand);
+    if (contains.has_value()) {
+      frame->value_stack().PopAndPush(
+          frame->value_factory().CreateBoolValue(*contains));
+      return absl::OkStatus();
+    }
+
+    Handle<Value> args[2] = {std::move(operand), list_};
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         InvokeEagerFunctionStep(*function_step_, frame,
+                                                 absl::MakeConstSpan(args)));
+    frame->value_stack().PopAndPush(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  absl::optional<bool> Contains(const Handle<Value>& operand) const {
+    if (operand->kind() != element_kind_) {
+      return absl::nullopt;
+    }
+    switch (element_kind_) {
+      case ValueKind::kInt:
+        return int_elements_.contains(operand.As<IntValue>()->NativeValue());
+      case ValueKind::kString:
+        return operand.As<StringValue>()->Visit(
+            [this](const auto& value) { return ContainsString(value); });
+      default:
+        return absl::nullopt;
+    }
+  }
+
+  bool ContainsString(absl::string_view value) const {
+    return string_elements_.contains(value);
+  }
+
+  bool ContainsString(const absl::Cord& value) const {
+    if (absl::optional<absl::string_view> flat = value.TryFlat();
+        flat.has_value()) {
+      return string_elements_.contains(*flat);
+    }
+    return string_elements_.contains(std::string(value));
+  }
+
+  SelectChain selects_;
+  Handle<ListValue> list_;
+  // Kind shared by all list elements, or kError if the fast path is disabled.
+  ValueKind element_kind_;
+  absl::flat_hash_set<std::string> string_elements_;
+  absl::flat_hash_set<int64_t> int_elements_;
+  std::unique_ptr<const ExpressionStep> function_step_;
+};
+
+absl::Status CheckFunctionStep(const ExpressionStep* function_step) {
+  if (function_step == nullptr || !IsEagerFunctionStep(*function_step)) {
+    return absl::InvalidArgumentError(
+        "fused select steps require an eagerly bound function step");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateSelectChainStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects, int64_t expr_id) {
+  for (size_t i = 0; i + 1 < selects.size(); ++i) {
+    if (selects[i]->test_field_presence()) {
+      return absl::InvalidArgumentError(
+          "only the last select in a chain may be a presence test");
+    }
+  }
+  return std::make_unique<SelectChainStep>(std::move(selects), expr_id);
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateSelectCompareConstantStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects,
+    Handle<Value> constant, bool constant_is_lhs, bool negate,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  CEL_RETURN_IF_ERROR(CheckFunctionStep(function_step.get()));
+  return std::make_unique<SelectCompareConstantStep>(
+      std::move(selects), std::move(constant), constant_is_lhs, negate,
+      std::move(function_step), expr_id);
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateInConstantListStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects,
+    Handle<ListValue> list, std::unique_ptr<const ExpressionStep> function_step,
+    cel::ValueFactory& value_factory, int64_t expr_id) {
+  CEL_RETURN_IF_ERROR(CheckFunctionStep(function_step.get()));
+
+  ValueKind element_kind = ValueKind::kError;
+  absl::flat_hash_set<std::string> string_elements;
+  absl::flat_hash_set<int64_t> int_elements;
+  for (size_t i = 0; i < list->Size(); ++i) {
+    CEL_ASSIGN_OR_RETURN(Handle<Value> element, list->Get(value_factory, i));
+    ValueKind kind = element->kind();
+    if (i == 0 && (kind == ValueKind::kString || kind == ValueKind::kInt)) {
+      element_kind = kind;
+    }
+    if (kind != element_kind) {
+      element_kind = ValueKind::kError;
+      break;
+    }
+    if (kind == ValueKind::kString) {
+      string_elements.insert(element.As<StringValue>()->ToString());
+    } else {
+      int_elements.insert(element.As<IntValue>()->NativeValue());
+    }
+  }
+  if (element_kind == ValueKind::kError) {
+    string_elements.clear();
+    int_elements.clear();
+  }
+
+  return std::make_unique<InConstantListStep>(
+      std::move(selects), std::move(list), element_kind,
+      std::move(string_elements), std::move(int_elements),
+      std::move(function_step), expr_id);
+}
+
+}  // namespace google::api::expr::runtime
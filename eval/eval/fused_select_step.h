@@ -0,0 +1,72 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Fused execution steps for common select + comparison shapes.
+//
+// Each step consumes the operand at the top of the value stack, applies a
+// chain of selects to it without pushing the intermediate values and then
+// (optionally) compares the result to a plan time constant. None of the steps
+// track attributes, so they must only be used when unknown processing and
+// missing attribute errors are disabled.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_FUSED_SELECT_STEP_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_FUSED_SELECT_STEP_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/select_step.h"
+
+namespace google::api::expr::runtime {
+
+// Factory method for a step applying a chain of selects (e.g. `a.b.c` or
+// `has(a.b.c)`) in order to the top of the stack. The last select may be a
+// presence test.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateSelectChainStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects, int64_t expr_id);
+
+// Factory method for a step implementing `<selects> == constant` or
+// `<selects> != constant` for the operand at the top of the stack.
+//
+// Comparisons between values of the same primitive kind (bool, int, uint,
+// string) are evaluated inline. Other comparisons are passed to the eagerly
+// bound function_step with the arguments in their original order.
+// selects may be empty.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateSelectCompareConstantStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects,
+    cel::Handle<cel::Value> constant, bool constant_is_lhs, bool negate,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
+// Factory method for a step implementing `<selects> in list` for the operand at
+// the top of the stack and a constant list.
+//
+// If the list elements are all strings or all ints, membership for an operand
+// of the same kind is tested with a hash set built at plan time. Other cases
+// are passed to the eagerly bound function_step. selects may be empty.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateInConstantListStep(
+    std::vector<std::unique_ptr<const SelectStep>> selects,
+    cel::Handle<cel::ListValue> list,
+    std::unique_ptr<const ExpressionStep> function_step,
+    cel::ValueFactory& value_factory, int64_t expr_id);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_FUSED_SELECT_STEP_H_
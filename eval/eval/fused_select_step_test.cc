@@ -0,0 +1,214 @@
+#include "eval/eval/fused_select_step.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/ast_internal/expr.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/function_step.h"
+#include "eval/eval/ident_step.h"
+#include "eval/eval/select_step.h"
+#include "eval/internal/interop.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_function_registry.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_list_impl.h"
+#include "eval/public/containers/container_backed_map_impl.h"
+#include "eval/public/testing/matchers.h"
+#include "extensions/protobuf/memory_manager.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "runtime/runtime_options.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::cel::TypeProvider;
+using ::cel::ast_internal::Call;
+using ::cel::ast_internal::Expr;
+using ::cel::extensions::ProtoMemoryManagerRef;
+using ::cel::interop_internal::CreateIntValue;
+using ::cel::interop_internal::CreateLegacyListValue;
+using ::cel::interop_internal::CreateStringValueFromView;
+using testing::Eq;
+
+using SelectChain = std::vector<std::unique_ptr<const SelectStep>>;
+
+class FusedSelectStepTest : public testing::Test {
+ public:
+  FusedSelectStepTest()
+      : type_factory_(ProtoMemoryManagerRef(&arena_)),
+        type_manager_(type_factory_, cel::TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  void SetUp() override {
+    ASSERT_OK(RegisterBuiltinFunctions(&registry_, InterpreterOptions()));
+
+    // target = {"b": {"c": "admin"}}
+    std::vector<std::pair<CelValue, CelValue>> inner{
+        {CelValue::CreateStringView("c"), CelValue::CreateStringView("admin")}};
+    ASSERT_OK_AND_ASSIGN(inner_,
+                         CreateContainerBackedMap(absl::MakeSpan(inner)));
+    std::vector<std::pair<CelValue, CelValue>> outer{
+        {CelValue::CreateStringView("b"), CelValue::CreateMap(inner_.get())}};
+    ASSERT_OK_AND_ASSIGN(outer_,
+                         CreateContainerBackedMap(absl::MakeSpan(outer)));
+  }
+
+ protected:
+  std::unique_ptr<const SelectStep> MakeSelect(absl::string_view field,
+                                               bool test_only = false) {
+    cel::ast_internal::Select select;
+    select.set_field(std::string(field));
+    select.set_test_only(test_only);
+    auto step = CreateSelectStep(select, /*expr_id=*/-1, "",
+                                 /*enable_wrapper_type_null_unboxing=*/false,
+                                 value_factory_);
+    return absl::WrapUnique(cel::internal::down_cast<const SelectStep*>(
+        std::move(step).value().release()));
+  }
+
+  SelectChain MakeChain(std::vector<absl::string_view> fields,
+                        bool test_only = false) {
+    SelectChain chain;
+    for (size_t i = 0; i < fields.size(); ++i) {
+      chain.push_back(
+          MakeSelect(fields[i], test_only && i + 1 == fields.size()));
+    }
+    return chain;
+  }
+
+  std::unique_ptr<const ExpressionStep> MakeFunction(absl::string_view name) {
+    Call call;
+    call.set_function(std::string(name));
+    call.mutable_args().emplace_back();
+    call.mutable_args().emplace_back();
+    auto step = CreateFunctionStep(
+        call, /*expr_id=*/-1,
+        registry_.FindStaticOverloads(
+            name, false, {CelValue::Type::kAny, CelValue::Type::kAny}));
+    return std::move(step).value();
+  }
+
+  absl::StatusOr<CelValue> Run(std::unique_ptr<ExpressionStep> fused) {
+    cel::ast_internal::Ident ident;
+    ident.set_name("target");
+    ExecutionPath path;
+    CEL_ASSIGN_OR_RETURN(path.emplace_back(), CreateIdentStep(ident, -1));
+    path.push_back(std::move(fused));
+
+    CelExpressionFlatImpl cel_expr(
+        FlatExpression(std::move(path), /*comprehension_slot_count=*/0,
+                       TypeProvider::Builtin(), cel::RuntimeOptions{}));
+    Activation activation;
+    activation.InsertValue("target", CelValue::CreateMap(outer_.get()));
+    return cel_expr.Evaluate(activation, &arena_);
+  }
+
+  google::protobuf::Arena arena_;
+  cel::TypeFactory type_factory_;
+  cel::TypeManager type_manager_;
+  cel::ValueFactory value_factory_;
+  CelFunctionRegistry registry_;
+  std::unique_ptr<CelMap> inner_;
+  std::unique_ptr<CelMap> outer_;
+};
+
+TEST_F(FusedSelectStepTest, SelectChain) {
+  ASSERT_OK_AND_ASSIGN(auto step,
+                       CreateSelectChainStep(MakeChain({"b", "c"}), -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelString(Eq("admin")));
+}
+
+TEST_F(FusedSelectStepTest, SelectChainPresenceTest) {
+  ASSERT_OK_AND_ASSIGN(auto step, CreateSelectChainStep(
+                                      MakeChain({"b", "c"}, true), -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  ASSERT_OK_AND_ASSIGN(step, CreateSelectChainStep(
+                                 MakeChain({"b", "d"}, true), -1));
+  ASSERT_OK_AND_ASSIGN(result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(false));
+}
+
+TEST_F(FusedSelectStepTest, SelectChainPropagatesErrors) {
+  ASSERT_OK_AND_ASSIGN(auto step,
+                       CreateSelectChainStep(MakeChain({"x", "c"}), -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_TRUE(result.IsError());
+}
+
+TEST_F(FusedSelectStepTest, SelectChainRejectsInnerPresenceTest) {
+  SelectChain chain;
+  chain.push_back(MakeSelect("b", /*test_only=*/true));
+  chain.push_back(MakeSelect("c"));
+  EXPECT_THAT(CreateSelectChainStep(std::move(chain), -1),
+              cel::internal::StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(FusedSelectStepTest, CompareConstant) {
+  ASSERT_OK_AND_ASSIGN(
+      auto step, CreateSelectCompareConstantStep(
+                     MakeChain({"b", "c"}), CreateStringValueFromView("admin"),
+                     /*constant_is_lhs=*/false, /*negate=*/false,
+                     MakeFunction("_==_"), -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  ASSERT_OK_AND_ASSIGN(
+      step, CreateSelectCompareConstantStep(
+                MakeChain({"b", "c"}), CreateStringValueFromView("admin"),
+                /*constant_is_lhs=*/true, /*negate=*/true,
+                MakeFunction("_!=_"), -1));
+  ASSERT_OK_AND_ASSIGN(result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(false));
+}
+
+TEST_F(FusedSelectStepTest, CompareConstantFallsBackToFunction) {
+  ASSERT_OK_AND_ASSIGN(
+      auto step, CreateSelectCompareConstantStep(
+                     MakeChain({"b", "c"}), CreateIntValue(1),
+                     /*constant_is_lhs=*/false, /*negate=*/true,
+                     MakeFunction("_!=_"), -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(true));
+}
+
+TEST_F(FusedSelectStepTest, InConstantList) {
+  ContainerBackedListImpl strings({CelValue::CreateStringView("user"),
+                                   CelValue::CreateStringView("admin")});
+  ASSERT_OK_AND_ASSIGN(
+      auto step,
+      CreateInConstantListStep(MakeChain({"b", "c"}),
+                               CreateLegacyListValue(&strings),
+                               MakeFunction("@in"), value_factory_, -1));
+  ASSERT_OK_AND_ASSIGN(CelValue result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(true));
+
+  ContainerBackedListImpl ints(
+      {CelValue::CreateInt64(1), CelValue::CreateInt64(2)});
+  ASSERT_OK_AND_ASSIGN(
+      step, CreateInConstantListStep(MakeChain({"b", "c"}),
+                                     CreateLegacyListValue(&ints),
+                                     MakeFunction("@in"), value_factory_, -1));
+  ASSERT_OK_AND_ASSIGN(result, Run(std::move(step)));
+  EXPECT_THAT(result, test::IsCelBool(false));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
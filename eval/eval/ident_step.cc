@@ -27,8 +27,12 @@ using ::cel::runtime_internal::CreateMissingAttributeError;
 
 class IdentStep : public ExpressionStepBase {
  public:
-  IdentStep(absl::string_view name, int64_t expr_id)
-      : ExpressionStepBase(expr_id), name_(name) {}
+  IdentStep(absl::string_view name, int64_t expr_id, bool unknown_root,
+            size_t variable_slot)
+      : ExpressionStepBase(expr_id),
+        name_(name),
+        unknown_root_(unknown_root),
+        variable_slot_(variable_slot) {}
 
   absl::Status Evaluate(ExecutionFrame* frame) const override;
 
@@ -41,14 +45,18 @@ class IdentStep : public ExpressionStepBase {
   absl::StatusOr<IdentResult> DoEvaluate(ExecutionFrame* frame) const;
 
   std::string name_;
+  // Whether unknown patterns may refer to the variable.
+  bool unknown_root_;
+  size_t variable_slot_;
 };
 
 absl::StatusOr<IdentStep::IdentResult> IdentStep::DoEvaluate(
     ExecutionFrame* frame) const {
   IdentResult result;
   // Populate trails if either MissingAttributeError or UnknownPattern
-  // is enabled.
-  if (frame->enable_missing_attribute_errors() || frame->enable_unknowns()) {
+  // is enabled. Without a trail, steps on the value skip attribute tracking.
+  if (frame->enable_missing_attribute_errors() ||
+      (frame->enable_unknowns() && unknown_root_)) {
     result.trail = AttributeTrail(name_);
   }
 
@@ -59,7 +67,7 @@ absl::StatusOr<IdentStep::IdentResult> IdentStep::DoEvaluate(
     return result;
   }
 
-  if (frame->enable_unknowns()) {
+  if (frame->enable_unknowns() && unknown_root_) {
     if (frame->attribute_utility().CheckForUnknown(result.trail, false)) {
       auto unknown_set =
           frame->attribute_utility().CreateUnknownSet(result.trail.attribute());
@@ -68,6 +76,12 @@ absl::StatusOr<IdentStep::IdentResult> IdentStep::DoEvaluate(
     }
   }
 
+  if (const Handle<Value>* value = frame->FindBoundVariable(variable_slot_);
+      value != nullptr) {
+    result.value = *value;
+    return result;
+  }
+
   CEL_ASSIGN_OR_RETURN(auto value, frame->modern_activation().FindVariable(
                                        frame->value_factory(), name_));
 
@@ -90,18 +104,7 @@ absl::Status IdentStep::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
-class SlotStep : public ExpressionStepBase {
- public:
-  SlotStep(absl::string_view name, size_t slot_index, int64_t expr_id)
-      : ExpressionStepBase(expr_id), name_(name), slot_index_(slot_index) {}
-
-  absl::Status Evaluate(ExecutionFrame* frame) const override;
-
- private:
-  std::string name_;
-
-  size_t slot_index_;
-};
+}  // namespace
 
 absl::Status SlotStep::Evaluate(ExecutionFrame* frame) const {
   const ComprehensionSlots::Slot* slot =
@@ -135,11 +138,11 @@ absl::Status SlotStep::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
-}  // namespace
-
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateIdentStep(
-    const cel::ast_internal::Ident& ident_expr, int64_t expr_id) {
-  return std::make_unique<IdentStep>(ident_expr.name(), expr_id);
+    const cel::ast_internal::Ident& ident_expr, int64_t expr_id,
+    bool unknown_root, size_t variable_slot) {
+  return std::make_unique<IdentStep>(ident_expr.name(), expr_id, unknown_root,
+                                     variable_slot);
 }
 
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateIdentStepForSlot(
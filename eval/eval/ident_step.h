@@ -1,18 +1,59 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_IDENT_STEP_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_IDENT_STEP_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "base/ast_internal/expr.h"
+#include "common/native_type.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
 
 namespace google::api::expr::runtime {
 
+// Step that pushes the value of a comprehension variable assigned to a slot.
+//
+// Exposed so planner extensions can inspect the slot index.
+class SlotStep : public ExpressionStepBase {
+ public:
+  SlotStep(absl::string_view name, size_t slot_index, int64_t expr_id)
+      : ExpressionStepBase(expr_id), name_(name), slot_index_(slot_index) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<SlotStep>();
+  }
+
+  const std::string& name() const { return name_; }
+
+  size_t slot_index() const { return slot_index_; }
+
+ private:
+  std::string name_;
+
+  size_t slot_index_;
+};
+
+// Marks an ident step that always looks up its variable by name.
+inline constexpr size_t kNoVariableSlot = static_cast<size_t>(-1);
+
 // Factory method for Ident - based Execution step
+//
+// If unknown_root is false, unknown patterns never refer to the variable, so
+// the step does not start an attribute trail for unknown processing.
+//
+// variable_slot is the position of the variable in the program's variable
+// names. If the activation binds variables by slot, the step reads the value
+// from the slot rather than looking it up by name.
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateIdentStep(
-    const cel::ast_internal::Ident& ident, int64_t expr_id);
+    const cel::ast_internal::Ident& ident, int64_t expr_id,
+    bool unknown_root = true, size_t variable_slot = kNoVariableSlot);
 
 // Factory method for identifier that has been assigned to a slot.
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateIdentStepForSlot(
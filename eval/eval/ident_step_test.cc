@@ -197,6 +197,39 @@ TEST(IdentStepTest, TestIdentStepUnknownAttribute) {
   ASSERT_TRUE(result.IsUnknownSet());
 }
 
+TEST(IdentStepTest, TestIdentStepUndeclaredUnknownRoot) {
+  Expr expr;
+  auto& ident_expr = expr.mutable_ident_expr();
+  ident_expr.set_name("name0");
+
+  ASSERT_OK_AND_ASSIGN(auto step,
+                       CreateIdentStep(ident_expr, expr.id(),
+                                       /*unknown_root=*/false));
+
+  ExecutionPath path;
+  path.push_back(std::move(step));
+
+  cel::RuntimeOptions options;
+  options.unknown_processing = cel::UnknownProcessingOptions::kAttributeOnly;
+  CelExpressionFlatImpl impl(FlatExpression(std::move(path),
+                                            /*comprehension_slot_count=*/0,
+                                            TypeProvider::Builtin(), options));
+
+  Activation activation;
+  Arena arena;
+  std::string value("test");
+
+  activation.InsertValue("name0", CelValue::CreateString(&value));
+  std::vector<CelAttributePattern> unknown_patterns;
+  unknown_patterns.push_back(CelAttributePattern("name0", {}));
+  activation.set_unknown_attribute_patterns(unknown_patterns);
+
+  // The variable is not a declared unknown root, so patterns are not checked.
+  ASSERT_OK_AND_ASSIGN(CelValue result, impl.Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsString());
+  EXPECT_THAT(result.StringOrDie().value(), Eq("test"));
+}
+
 }  // namespace
 
 }  // namespace google::api::expr::runtime
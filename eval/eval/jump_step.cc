@@ -20,52 +20,8 @@ using ::cel::ErrorValue;
 using ::cel::Handle;
 using ::cel::UnknownValue;
 using ::cel::Value;
-using ::cel::runtime_internal::CreateNoMatchingOverloadError;
-
-class JumpStep : public JumpStepBase {
- public:
-  // Constructs FunctionStep that uses overloads specified.
-  JumpStep(absl::optional<int> jump_offset, int64_t expr_id)
-      : JumpStepBase(jump_offset, expr_id) {}
-
-  absl::Status Evaluate(ExecutionFrame* frame) const override {
-    return Jump(frame);
-  }
-};
-
-class CondJumpStep : public JumpStepBase {
- public:
-  // Constructs FunctionStep that uses overloads specified.
-  CondJumpStep(bool jump_condition, bool leave_on_stack,
-               absl::optional<int> jump_offset, int64_t expr_id)
-      : JumpStepBase(jump_offset, expr_id),
-        jump_condition_(jump_condition),
-        leave_on_stack_(leave_on_stack) {}
-
-  absl::Status Evaluate(ExecutionFrame* frame) const override {
-    // Peek the top value
-    if (!frame->value_stack().HasEnough(1)) {
-      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
-    }
-
-    Handle<Value> value = frame->value_stack().Peek();
-
-    if (!leave_on_stack_) {
-      frame->value_stack().Pop(1);
-    }
-
-    if (value->Is<BoolValue>() &&
-        jump_condition_ == value.As<BoolValue>()->NativeValue()) {
-      return Jump(frame);
-    }
-
-    return absl::OkStatus();
-  }
-
- private:
-  const bool jump_condition_;
-  const bool leave_on_stack_;
-};
+using ::cel::runtime_internal::ControlFlowContext;
+using ::cel::runtime_internal::NoMatchingOverloadError;
 
 class BoolCheckJumpStep : public JumpStepBase {
  public:
@@ -96,7 +52,7 @@ class BoolCheckJumpStep : public JumpStepBase {
 
     // Neither bool, error, nor unknown set.
     Handle<Value> error_value = frame->value_factory().CreateErrorValue(
-        CreateNoMatchingOverloadError("<jump_condition>"));
+        *NoMatchingOverloadError(ControlFlowContext::kJumpCondition));
 
     frame->value_stack().PopAndPush(std::move(error_value));
     return Jump(frame);
@@ -107,6 +63,26 @@ class BoolCheckJumpStep : public JumpStepBase {
 
 }  // namespace
 
+absl::Status CondJumpStep::Evaluate(ExecutionFrame* frame) const {
+  // Peek the top value
+  if (!frame->value_stack().HasEnough(1)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+
+  Handle<Value> value = frame->value_stack().Peek();
+
+  if (!leave_on_stack_) {
+    frame->value_stack().Pop(1);
+  }
+
+  if (value->Is<BoolValue>() &&
+      jump_condition_ == value.As<BoolValue>()->NativeValue()) {
+    return Jump(frame);
+  }
+
+  return absl::OkStatus();
+}
+
 // Factory method for Conditional Jump step.
 // Conditional Jump requires a boolean value to sit on the stack.
 // It is compared to jump_condition, and if matched, jump is performed.
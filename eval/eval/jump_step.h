@@ -6,6 +6,7 @@
 #include "google/api/expr/v1alpha1/syntax.pb.h"
 #include "absl/status/statusor.h"
 #include "absl/types/optional.h"
+#include "common/native_type.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/expression_step_base.h"
 
@@ -13,11 +14,15 @@ namespace google::api::expr::runtime {
 
 class JumpStepBase : public ExpressionStepBase {
  public:
-  JumpStepBase(absl::optional<int> jump_offset, int64_t expr_id)
-      : ExpressionStepBase(expr_id, false), jump_offset_(jump_offset) {}
+  JumpStepBase(absl::optional<int> jump_offset, int64_t expr_id,
+               bool comes_from_ast = false)
+      : ExpressionStepBase(expr_id, comes_from_ast),
+        jump_offset_(jump_offset) {}
 
   void set_jump_offset(int offset) { jump_offset_ = offset; }
 
+  const absl::optional<int>& jump_offset() const { return jump_offset_; }
+
   absl::Status Jump(ExecutionFrame* frame) const {
     if (!jump_offset_.has_value()) {
       return absl::Status(absl::StatusCode::kInternal, "Jump offset not set");
@@ -29,6 +34,49 @@ class JumpStepBase : public ExpressionStepBase {
   absl::optional<int> jump_offset_;
 };
 
+// Unconditional jump.
+//
+// Overrides NativeTypeId to allow the planner to inspect the jump.
+class JumpStep : public JumpStepBase {
+ public:
+  JumpStep(absl::optional<int> jump_offset, int64_t expr_id)
+      : JumpStepBase(jump_offset, expr_id) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    return Jump(frame);
+  }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<JumpStep>();
+  }
+};
+
+// Jump taken if the top of the stack is a bool matching jump_condition.
+//
+// Overrides NativeTypeId to allow the planner to inspect the jump.
+class CondJumpStep : public JumpStepBase {
+ public:
+  CondJumpStep(bool jump_condition, bool leave_on_stack,
+               absl::optional<int> jump_offset, int64_t expr_id)
+      : JumpStepBase(jump_offset, expr_id),
+        jump_condition_(jump_condition),
+        leave_on_stack_(leave_on_stack) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<CondJumpStep>();
+  }
+
+  bool jump_condition() const { return jump_condition_; }
+
+  bool leave_on_stack() const { return leave_on_stack_; }
+
+ private:
+  const bool jump_condition_;
+  const bool leave_on_stack_;
+};
+
 // Factory method for Jump step.
 absl::StatusOr<std::unique_ptr<JumpStepBase>> CreateJumpStep(
     absl::optional<int> jump_offset, int64_t expr_id);
@@ -6,13 +6,16 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "base/builtins.h"
 #include "base/handle.h"
 #include "base/value.h"
 #include "base/values/bool_value.h"
+#include "base/values/error_value.h"
 #include "base/values/unknown_value.h"
 #include "eval/eval/expression_step_base.h"
+#include "eval/eval/jump_step.h"
 #include "eval/internal/errors.h"
 
 namespace google::api::expr::runtime {
@@ -22,7 +25,8 @@ namespace {
 using ::cel::BoolValue;
 using ::cel::Handle;
 using ::cel::Value;
-using ::cel::runtime_internal::CreateNoMatchingOverloadError;
+using ::cel::runtime_internal::ControlFlowContext;
+using ::cel::runtime_internal::NoMatchingOverloadError;
 
 class LogicalOpStep : public ExpressionStepBase {
  public:
@@ -84,8 +88,9 @@ class LogicalOpStep : public ExpressionStepBase {
 
     // Fallback.
     return frame->value_factory().CreateErrorValue(
-        CreateNoMatchingOverloadError(
-            (op_type_ == OpType::OR) ? cel::builtin::kOr : cel::builtin::kAnd));
+        *NoMatchingOverloadError((op_type_ == OpType::OR)
+                                     ? ControlFlowContext::kLogicalOr
+                                     : ControlFlowContext::kLogicalAnd));
   }
 
   const OpType op_type_;
@@ -107,8 +112,81 @@ absl::Status LogicalOpStep::Evaluate(ExecutionFrame* frame) const {
   return absl::OkStatus();
 }
 
+// Precedence of an operand value when merging it into the result of a logical
+// chain. Higher ranks replace lower ones.
+enum class ChainRank {
+  kIdentity,
+  kNonBool,
+  kError,
+  kUnknown,
+  kShortCircuit,
+};
+
+ChainRank GetChainRank(const ExecutionFrame& frame, const Handle<Value>& value,
+                       bool shortcircuit) {
+  if (value->Is<BoolValue>()) {
+    return value.As<BoolValue>()->NativeValue() == shortcircuit
+               ? ChainRank::kShortCircuit
+               : ChainRank::kIdentity;
+  }
+  if (value->Is<cel::ErrorValue>()) {
+    return ChainRank::kError;
+  }
+  if (frame.enable_unknowns() && value->Is<cel::UnknownValue>()) {
+    return ChainRank::kUnknown;
+  }
+  return ChainRank::kNonBool;
+}
+
 }  // namespace
 
+absl::Status LogicalChainStep::Evaluate(ExecutionFrame* frame) const {
+  if (!frame->value_stack().HasEnough(first_ ? 1 : 2)) {
+    return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+  }
+
+  if (first_) {
+    // The operand is the accumulated result.
+    if (jump_offset().has_value() &&
+        GetChainRank(*frame, frame->value_stack().Peek(), is_or_) ==
+            ChainRank::kShortCircuit) {
+      return Jump(frame);
+    }
+    return absl::OkStatus();
+  }
+
+  auto args = frame->value_stack().GetSpan(2);
+  ChainRank result_rank = GetChainRank(*frame, args[0], is_or_);
+  ChainRank operand_rank = GetChainRank(*frame, args[1], is_or_);
+
+  if (operand_rank > result_rank) {
+    Handle<Value> operand = args[1];
+    frame->value_stack().Pop(1);
+    frame->value_stack().PopAndPush(std::move(operand));
+    result_rank = operand_rank;
+    if (result_rank == ChainRank::kShortCircuit && jump_offset().has_value()) {
+      return Jump(frame);
+    }
+  } else if (result_rank == ChainRank::kUnknown &&
+             operand_rank == ChainRank::kUnknown) {
+    absl::optional<Handle<cel::UnknownValue>> unknown_set =
+        frame->attribute_utility().MergeUnknowns(args);
+    frame->value_stack().Pop(1);
+    if (unknown_set.has_value()) {
+      frame->value_stack().PopAndPush(std::move(unknown_set).value());
+    }
+  } else {
+    frame->value_stack().Pop(1);
+  }
+
+  if (last_ && result_rank == ChainRank::kNonBool) {
+    frame->value_stack().PopAndPush(frame->value_factory().CreateErrorValue(
+        *NoMatchingOverloadError(is_or_ ? ControlFlowContext::kLogicalOr
+                                        : ControlFlowContext::kLogicalAnd)));
+  }
+  return absl::OkStatus();
+}
+
 // Factory method for "And" Execution step
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateAndStep(int64_t expr_id) {
   return std::make_unique<LogicalOpStep>(LogicalOpStep::OpType::AND, expr_id);
@@ -119,4 +197,11 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateOrStep(int64_t expr_id) {
   return std::make_unique<LogicalOpStep>(LogicalOpStep::OpType::OR, expr_id);
 }
 
+absl::StatusOr<std::unique_ptr<JumpStepBase>> CreateLogicalChainStep(
+    bool is_or, bool first, bool last, absl::optional<int> jump_offset,
+    int64_t expr_id) {
+  return std::make_unique<LogicalChainStep>(is_or, first, last, jump_offset,
+                                            expr_id);
+}
+
 }  // namespace google::api::expr::runtime
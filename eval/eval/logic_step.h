@@ -4,8 +4,12 @@
 #include <cstdint>
 #include <memory>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "common/native_type.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/jump_step.h"
 
 namespace google::api::expr::runtime {
 
@@ -15,6 +19,54 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateAndStep(int64_t expr_id);
 // Factory method for "Or" Execution step
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateOrStep(int64_t expr_id);
 
+// Step for one operand of an n-ary "And" or "Or" chain, e.g. a && b && c.
+//
+// The value of the first operand becomes the accumulated result of the chain.
+// Each later operand is merged into it and popped, so a chain never holds more
+// than two values on the stack. An operand equal to the short-circuiting value
+// (false for "And", true for "Or") becomes the result, and if a jump offset is
+// set evaluation continues at the end of the chain.
+//
+// Otherwise unknowns take precedence over errors, errors over non-bool values
+// and non-bool values over the identity value. Unknowns are merged, and the
+// first error or non-bool value is kept. The step for the last operand reports
+// the result of the chain and replaces a non-bool value with a no matching
+// overload error.
+//
+// Overrides NativeTypeId to allow the planner to inspect the step.
+class LogicalChainStep : public JumpStepBase {
+ public:
+  LogicalChainStep(bool is_or, bool first, bool last,
+                   absl::optional<int> jump_offset, int64_t expr_id)
+      : JumpStepBase(jump_offset, expr_id, /*comes_from_ast=*/last),
+        is_or_(is_or),
+        first_(first),
+        last_(last) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<LogicalChainStep>();
+  }
+
+  bool is_or() const { return is_or_; }
+
+  bool first() const { return first_; }
+
+  bool last() const { return last_; }
+
+ private:
+  const bool is_or_;
+  const bool first_;
+  const bool last_;
+};
+
+// Factory method for a step evaluated after an operand of an n-ary "And" or
+// "Or" chain. See LogicalChainStep.
+absl::StatusOr<std::unique_ptr<JumpStepBase>> CreateLogicalChainStep(
+    bool is_or, bool first, bool last, absl::optional<int> jump_offset,
+    int64_t expr_id);
+
 }  // namespace google::api::expr::runtime
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_LOGIC_STEP_H_
@@ -1,12 +1,18 @@
 #include "eval/eval/logic_step.h"
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
 #include "base/type_provider.h"
 #include "eval/eval/cel_expression_flat_impl.h"
 #include "eval/eval/evaluator_core.h"
 #include "eval/eval/ident_step.h"
+#include "eval/eval/jump_step.h"
 #include "eval/public/activation.h"
 #include "eval/public/unknown_attribute_set.h"
 #include "eval/public/unknown_set.h"
@@ -308,6 +314,158 @@ TEST_F(LogicStepTest, TestOrLogicUnknownHandling) {
 }
 
 INSTANTIATE_TEST_SUITE_P(LogicStepTest, LogicStepTest, testing::Bool());
+
+// Parameterized on short-circuiting.
+class LogicalChainStepTest : public testing::TestWithParam<bool> {
+ public:
+  absl::Status EvaluateChain(const std::vector<CelValue>& args, bool is_or,
+                             CelValue* result, bool enable_unknown = false) {
+    bool short_circuiting = GetParam();
+    ExecutionPath path;
+    std::vector<std::pair<int, JumpStepBase*>> jumps;
+    Activation activation;
+    std::vector<std::string> names;
+    names.reserve(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+      names.push_back(absl::StrCat("name", i));
+      activation.InsertValue(names.back(), args[i]);
+
+      Expr expr;
+      expr.mutable_ident_expr().set_name(names.back());
+      CEL_ASSIGN_OR_RETURN(auto ident_step,
+                           CreateIdentStep(expr.ident_expr(), expr.id()));
+      path.push_back(std::move(ident_step));
+
+      bool first = i == 0;
+      bool last = i + 1 == args.size();
+      if (first && !short_circuiting) {
+        continue;
+      }
+      absl::optional<int> jump_offset;
+      if (short_circuiting && !last) {
+        jump_offset = 0;
+      }
+      CEL_ASSIGN_OR_RETURN(
+          auto step,
+          CreateLogicalChainStep(is_or, first, last, jump_offset, /*expr_id=*/1));
+      if (jump_offset.has_value()) {
+        jumps.push_back({static_cast<int>(path.size()), step.get()});
+      }
+      path.push_back(std::move(step));
+    }
+    for (const auto& [index, jump] : jumps) {
+      jump->set_jump_offset(static_cast<int>(path.size()) - index - 1);
+    }
+
+    cel::RuntimeOptions options;
+    if (enable_unknown) {
+      options.unknown_processing =
+          cel::UnknownProcessingOptions::kAttributeOnly;
+    }
+    CelExpressionFlatImpl impl(
+        FlatExpression(std::move(path), /*comprehension_slot_count=*/0,
+                       TypeProvider::Builtin(), options));
+    CEL_ASSIGN_OR_RETURN(*result, impl.Evaluate(activation, &arena_));
+    return absl::OkStatus();
+  }
+
+ private:
+  Arena arena_;
+};
+
+TEST_P(LogicalChainStepTest, AndChain) {
+  CelValue t = CelValue::CreateBool(true);
+  CelValue f = CelValue::CreateBool(false);
+  CelValue result;
+
+  ASSERT_OK(EvaluateChain({t, t, t, t}, false, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_TRUE(result.BoolOrDie());
+
+  ASSERT_OK(EvaluateChain({t, t, f, t}, false, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_FALSE(result.BoolOrDie());
+
+  ASSERT_OK(EvaluateChain({f, t, t}, false, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_FALSE(result.BoolOrDie());
+}
+
+TEST_P(LogicalChainStepTest, OrChain) {
+  CelValue t = CelValue::CreateBool(true);
+  CelValue f = CelValue::CreateBool(false);
+  CelValue result;
+
+  ASSERT_OK(EvaluateChain({f, f, f, f}, true, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_FALSE(result.BoolOrDie());
+
+  ASSERT_OK(EvaluateChain({f, f, t, f}, true, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_TRUE(result.BoolOrDie());
+
+  ASSERT_OK(EvaluateChain({f, f, t}, true, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_TRUE(result.BoolOrDie());
+}
+
+TEST_P(LogicalChainStepTest, ErrorHandling) {
+  CelValue t = CelValue::CreateBool(true);
+  CelValue f = CelValue::CreateBool(false);
+  CelError error0 = absl::CancelledError("error0");
+  CelError error1 = absl::CancelledError("error1");
+  CelValue error_value0 = CelValue::CreateError(&error0);
+  CelValue error_value1 = CelValue::CreateError(&error1);
+  CelValue result;
+
+  // The short-circuiting value hides errors.
+  ASSERT_OK(EvaluateChain({t, error_value0, f, error_value1}, false, &result));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_FALSE(result.BoolOrDie());
+
+  // Otherwise the first error is reported.
+  ASSERT_OK(EvaluateChain({t, error_value0, t, error_value1}, false, &result));
+  ASSERT_TRUE(result.IsError());
+  EXPECT_THAT(*result.ErrorOrDie(), Eq(error0));
+
+  // Errors take precedence over values of the wrong type.
+  ASSERT_OK(EvaluateChain({CelValue::CreateInt64(1), f, error_value1}, true,
+                          &result));
+  ASSERT_TRUE(result.IsError());
+  EXPECT_THAT(*result.ErrorOrDie(), Eq(error1));
+
+  ASSERT_OK(
+      EvaluateChain({f, CelValue::CreateInt64(1), f}, true, &result));
+  ASSERT_TRUE(result.IsError());
+  EXPECT_THAT(result.ErrorOrDie()->code(), Eq(absl::StatusCode::kUnknown));
+}
+
+TEST_P(LogicalChainStepTest, UnknownHandling) {
+  CelValue t = CelValue::CreateBool(true);
+  CelValue f = CelValue::CreateBool(false);
+  CelError error = absl::CancelledError("error");
+  CelValue error_value = CelValue::CreateError(&error);
+  UnknownSet unknown_set0(UnknownAttributeSet({CelAttribute("name0", {})}));
+  UnknownSet unknown_set2(UnknownAttributeSet({CelAttribute("name2", {})}));
+  CelValue unknown_value0 = CelValue::CreateUnknownSet(&unknown_set0);
+  CelValue unknown_value2 = CelValue::CreateUnknownSet(&unknown_set2);
+  CelValue result;
+
+  // Unknowns are merged and take precedence over errors.
+  ASSERT_OK(EvaluateChain({unknown_value0, error_value, unknown_value2, t},
+                          false, &result, /*enable_unknown=*/true));
+  ASSERT_TRUE(result.IsUnknownSet());
+  EXPECT_THAT(result.UnknownSetOrDie()->unknown_attributes().size(), Eq(2));
+
+  // The short-circuiting value hides unknowns.
+  ASSERT_OK(EvaluateChain({unknown_value0, t, unknown_value2}, true, &result,
+                          /*enable_unknown=*/true));
+  ASSERT_TRUE(result.IsBool());
+  EXPECT_TRUE(result.BoolOrDie());
+}
+
+INSTANTIATE_TEST_SUITE_P(LogicalChainStepTest, LogicalChainStepTest,
+                         testing::Bool());
 }  // namespace
 
 }  // namespace google::api::expr::runtime
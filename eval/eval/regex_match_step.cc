@@ -14,18 +14,40 @@
 
 #include "eval/eval/regex_match_step.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/error_value.h"
+#include "base/values/map_value_builder.h"
 #include "base/values/string_value.h"
+#include "base/values/unknown_value.h"
+#include "common/native_type.h"
 #include "eval/eval/expression_step_base.h"
+#include "eval/eval/string_match_step.h"
+#include "internal/status_macros.h"
 #include "re2/re2.h"
+#include "re2/set.h"
+#include "runtime/internal/errors.h"
 
 namespace google::api::expr::runtime {
 
 namespace {
 
+using ::cel::Handle;
+using ::cel::StringValue;
+using ::cel::Value;
+
 inline constexpr int kNumRegexMatchArguments = 1;
 inline constexpr size_t kRegexMatchStepSubject = 0;
 
@@ -33,7 +55,8 @@ class RegexMatchStep final : public ExpressionStepBase {
  public:
   RegexMatchStep(int64_t expr_id, std::shared_ptr<const RE2> re2)
       : ExpressionStepBase(expr_id, /*comes_from_ast=*/true),
-        re2_(std::move(re2)) {}
+        re2_(std::move(re2)),
+        literal_(ReduceRegexToLiteral(*re2_)) {}
 
   absl::Status Evaluate(ExecutionFrame* frame) const override {
     if (!frame->value_stack().HasEnough(kNumRegexMatchArguments)) {
@@ -48,14 +71,176 @@ class RegexMatchStep final : public ExpressionStepBase {
                           "First argument for regular "
                           "expression match must be a string");
     }
-    bool match = subject.As<cel::StringValue>()->Matches(*re2_);
+    const auto& string_subject = *subject.As<cel::StringValue>();
+    bool match = literal_.has_value()
+                     ? MatchesLiteral(literal_->first, string_subject,
+                                      literal_->second)
+                     : string_subject.Matches(*re2_);
     frame->value_stack().Pop(kNumRegexMatchArguments);
     frame->value_stack().Push(frame->value_factory().CreateBoolValue(match));
     return absl::OkStatus();
   }
 
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<RegexMatchStep>();
+  }
+
  private:
   const std::shared_ptr<const RE2> re2_;
+  // Set if the pattern is a plain, possibly anchored, string, which is
+  // cheaper to compare against than to run the regex.
+  const absl::optional<std::pair<StringMatchKind, std::string>> literal_;
+};
+
+class RegexSetMatchStep final : public ExpressionStepBase {
+ public:
+  RegexSetMatchStep(int64_t expr_id, std::shared_ptr<const RE2::Set> set)
+      : ExpressionStepBase(expr_id, /*comes_from_ast=*/true),
+        set_(std::move(set)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(kNumRegexMatchArguments)) {
+      return absl::Status(absl::StatusCode::kInternal,
+                          "Insufficient arguments supplied for regular "
+                          "expression match");
+    }
+    const Handle<Value>& subject = frame->value_stack().Peek();
+    if (subject->Is<cel::ErrorValue>() || subject->Is<cel::UnknownValue>()) {
+      return absl::OkStatus();
+    }
+    Handle<Value> result;
+    if (subject->Is<StringValue>()) {
+      result = frame->value_factory().CreateBoolValue(
+          set_->Match(subject.As<StringValue>()->ToString(), nullptr));
+    } else {
+      result = frame->value_factory().CreateErrorValue(
+          cel::runtime_internal::CreateNoMatchingOverloadError(
+              cel::builtin::kRegexMatch));
+    }
+    frame->value_stack().Pop(kNumRegexMatchArguments);
+    frame->value_stack().Push(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  const std::shared_ptr<const RE2::Set> set_;
+};
+
+// Implements the functions of the regex extension with a precompiled pattern,
+// matching the results and errors of extensions/regex_functions.cc.
+class RegexExtensionStep final : public ExpressionStepBase {
+ public:
+  enum class Function { kExtract, kCapture, kCaptureN };
+
+  RegexExtensionStep(int64_t expr_id, Function function,
+                     std::shared_ptr<const RE2> re2,
+                     std::unique_ptr<const ExpressionStep> function_step)
+      : ExpressionStepBase(expr_id, /*comes_from_ast=*/true),
+        function_(function),
+        re2_(std::move(re2)),
+        function_step_(std::move(function_step)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    // Unknown arguments, including attributes marked unknown, are handled by
+    // the function step.
+    if (frame->enable_unknowns()) {
+      return function_step_->Evaluate(frame);
+    }
+    const size_t num_arguments = function_ == Function::kExtract ? 3 : 2;
+    if (!frame->value_stack().HasEnough(num_arguments)) {
+      return absl::Status(absl::StatusCode::kInternal,
+                          "Insufficient arguments supplied for regular "
+                          "expression function");
+    }
+    auto args = frame->value_stack().GetSpan(num_arguments);
+    for (const auto& arg : args) {
+      if (!arg->Is<StringValue>()) {
+        return function_step_->Evaluate(frame);
+      }
+    }
+    std::string target = args[0].As<StringValue>()->ToString();
+    Handle<Value> result;
+    switch (function_) {
+      case Function::kExtract:
+        result = Extract(frame, target, args[2].As<StringValue>()->ToString());
+        break;
+      case Function::kCapture:
+        result = Capture(frame, target);
+        break;
+      case Function::kCaptureN:
+        CEL_ASSIGN_OR_RETURN(result, CaptureN(frame, target));
+        break;
+    }
+    frame->value_stack().Pop(num_arguments);
+    frame->value_stack().Push(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  Handle<Value> Extract(ExecutionFrame* frame, const std::string& target,
+                        const std::string& rewrite) const {
+    std::string output;
+    if (!RE2::Extract(target, *re2_, rewrite, &output)) {
+      return frame->value_factory().CreateErrorValue(
+          absl::InvalidArgumentError(
+              "Unable to extract string for the given regex"));
+    }
+    return frame->value_factory().CreateUncheckedStringValue(
+        std::move(output));
+  }
+
+  Handle<Value> Capture(ExecutionFrame* frame,
+                        const std::string& target) const {
+    std::string output;
+    if (!RE2::FullMatch(target, *re2_, &output)) {
+      return frame->value_factory().CreateErrorValue(
+          absl::InvalidArgumentError(
+              "Unable to capture groups for the given regex"));
+    }
+    return frame->value_factory().CreateUncheckedStringValue(
+        std::move(output));
+  }
+
+  absl::StatusOr<Handle<Value>> CaptureN(ExecutionFrame* frame,
+                                         const std::string& target) const {
+    const int capturing_groups_count = re2_->NumberOfCapturingGroups();
+    if (capturing_groups_count <= 0) {
+      return frame->value_factory().CreateErrorValue(
+          absl::InvalidArgumentError(
+              "Capturing groups were not found in the given regex."));
+    }
+    std::vector<std::string> captured_strings(capturing_groups_count);
+    std::vector<RE2::Arg> captured_string_addresses(capturing_groups_count);
+    std::vector<RE2::Arg*> argv(capturing_groups_count);
+    for (int j = 0; j < capturing_groups_count; j++) {
+      captured_string_addresses[j] = &captured_strings[j];
+      argv[j] = &captured_string_addresses[j];
+    }
+    if (!RE2::FullMatchN(target, *re2_, argv.data(), capturing_groups_count)) {
+      return frame->value_factory().CreateErrorValue(
+          absl::InvalidArgumentError(
+              "Unable to capture groups for the given regex"));
+    }
+    const auto& named_capturing_groups_map = re2_->CapturingGroupNames();
+    cel::MapValueBuilder<StringValue, StringValue> map_builder(
+        frame->value_factory(), frame->type_factory().GetStringType(),
+        frame->type_factory().GetStringType());
+    for (int index = 1; index <= capturing_groups_count; index++) {
+      auto it = named_capturing_groups_map.find(index);
+      std::string name = it != named_capturing_groups_map.end()
+                             ? it->second
+                             : std::to_string(index);
+      CEL_RETURN_IF_ERROR(map_builder.Put(
+          frame->value_factory().CreateUncheckedStringValue(std::move(name)),
+          frame->value_factory().CreateUncheckedStringValue(
+              std::move(captured_strings[index - 1]))));
+    }
+    return std::move(map_builder).Build();
+  }
+
+  const Function function_;
+  const std::shared_ptr<const RE2> re2_;
+  const std::unique_ptr<const ExpressionStep> function_step_;
 };
 
 }  // namespace
@@ -65,4 +250,37 @@ absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexMatchStep(
   return std::make_unique<RegexMatchStep>(expr_id, std::move(re2));
 }
 
+bool IsRegexMatchStep(const ExpressionStep& step) {
+  return step.GetNativeTypeId() == cel::NativeTypeId::For<RegexMatchStep>();
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexSetMatchStep(
+    std::shared_ptr<const RE2::Set> set, int64_t expr_id) {
+  return std::make_unique<RegexSetMatchStep>(expr_id, std::move(set));
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexExtractStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  return std::make_unique<RegexExtensionStep>(
+      expr_id, RegexExtensionStep::Function::kExtract, std::move(re2),
+      std::move(function_step));
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexCaptureStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  return std::make_unique<RegexExtensionStep>(
+      expr_id, RegexExtensionStep::Function::kCapture, std::move(re2),
+      std::move(function_step));
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexCaptureNStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  return std::make_unique<RegexExtensionStep>(
+      expr_id, RegexExtensionStep::Function::kCaptureN, std::move(re2),
+      std::move(function_step));
+}
+
 }  // namespace google::api::expr::runtime
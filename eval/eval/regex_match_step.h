@@ -20,12 +20,39 @@
 #include "absl/status/statusor.h"
 #include "eval/eval/evaluator_core.h"
 #include "re2/re2.h"
+#include "re2/set.h"
 
 namespace google::api::expr::runtime {
 
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexMatchStep(
     std::shared_ptr<const RE2> re2, int64_t expr_id);
 
+// Returns whether `step` was created by CreateRegexMatchStep.
+bool IsRegexMatchStep(const ExpressionStep& step);
+
+// Creates a step that is true if the string on top of the stack matches any
+// pattern of `set`, which must be compiled and unanchored. Errors and unknowns
+// are passed through, as a disjunction of matches on the same subject would.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexSetMatchStep(
+    std::shared_ptr<const RE2::Set> set, int64_t expr_id);
+
+// Steps for the functions of the regex extension (see
+// extensions/regex_functions.h) with a precompiled pattern. The pattern
+// argument is still evaluated, but not compiled again. If any argument is not a
+// string, or unknowns are enabled, the step delegates to `function_step`, the
+// step originally planned for the call, so the semantics are unchanged.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexExtractStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexCaptureStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateRegexCaptureNStep(
+    std::shared_ptr<const RE2> re2,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
 }
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_REGEX_MATCH_STEP_H_
@@ -14,11 +14,17 @@
 
 #include "eval/eval/regex_match_step.h"
 
+#include <string>
+#include <vector>
+
 #include "google/api/expr/v1alpha1/checked.pb.h"
 #include "google/api/expr/v1alpha1/syntax.pb.h"
 #include "google/protobuf/arena.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "eval/eval/string_match_step.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_expr_builder_factory.h"
@@ -33,6 +39,8 @@ using google::api::expr::v1alpha1::CheckedExpr;
 using google::api::expr::v1alpha1::Reference;
 using testing::Eq;
 using testing::HasSubstr;
+using testing::Optional;
+using testing::Pair;
 using cel::internal::StatusIs;
 
 Reference MakeMatchesStringOverload() {
@@ -99,5 +107,57 @@ TEST(RegexMatchStep, PrecompiledInvalidProgramTooLarge) {
                        Eq("exceeded RE2 max program size")));
 }
 
+TEST(RegexMatchStep, PrecompiledLiteralPatterns) {
+  struct TestCase {
+    std::string pattern;
+    bool matches;
+  };
+  const std::vector<TestCase> test_cases = {
+      {"^hello", true},         {"^world", false},
+      {"world!$", true},        {"hello$", false},
+      {"^hello world!$", true}, {"^hello$", false},
+      {"o w", true},            {"o\\\\.w", false},
+      {"d\\\\!$", true},        {"^h.llo", true},
+  };
+  InterpreterOptions options;
+  options.enable_regex_precompilation = true;
+  auto expr_builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(expr_builder->GetRegistry(), options));
+  for (const auto& test_case : test_cases) {
+    google::protobuf::Arena arena;
+    Activation activation;
+    ASSERT_OK_AND_ASSIGN(auto parsed_expr,
+                         parser::Parse(absl::StrCat("foo.matches('",
+                                                    test_case.pattern, "')")));
+    CheckedExpr checked_expr;
+    *checked_expr.mutable_expr() = parsed_expr.expr();
+    *checked_expr.mutable_source_info() = parsed_expr.source_info();
+    checked_expr.mutable_reference_map()->insert(
+        {checked_expr.expr().id(), MakeMatchesStringOverload()});
+    ASSERT_OK_AND_ASSIGN(auto expr,
+                         expr_builder->CreateExpression(&checked_expr));
+    activation.InsertValue("foo", CelValue::CreateStringView("hello world!"));
+    ASSERT_OK_AND_ASSIGN(auto result, expr->Evaluate(activation, &arena));
+    ASSERT_TRUE(result.IsBool()) << test_case.pattern;
+    EXPECT_EQ(result.BoolOrDie(), test_case.matches) << test_case.pattern;
+  }
+}
+
+TEST(RegexMatchStep, ReduceRegexToLiteral) {
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("^foo")),
+              Optional(Pair(StringMatchKind::kStartsWith, "foo")));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("foo$")),
+              Optional(Pair(StringMatchKind::kEndsWith, "foo")));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("^foo$")),
+              Optional(Pair(StringMatchKind::kEquals, "foo")));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("a\\.b\\$")),
+              Optional(Pair(StringMatchKind::kContains, "a.b$")));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("a.b")), Eq(absl::nullopt));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("\\d")), Eq(absl::nullopt));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("(?i)foo")), Eq(absl::nullopt));
+  EXPECT_THAT(ReduceRegexToLiteral(RE2("foo", RE2::Latin1)),
+              Eq(absl::nullopt));
+}
+
 }  // namespace
 }  // namespace google::api::expr::runtime
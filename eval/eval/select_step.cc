@@ -1,5 +1,6 @@
 #include "eval/eval/select_step.h"
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -10,6 +11,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "base/handle.h"
 #include "base/kind.h"
 #include "base/types/wrapper_type.h"
@@ -40,6 +42,8 @@ using ::cel::StructValue;
 using ::cel::UnknownValue;
 using ::cel::Value;
 using ::cel::ValueKind;
+using ::cel::base_internal::AbstractStructValue;
+using ::cel::base_internal::LegacyStructValue;
 using ::cel::runtime_internal::CreateMissingAttributeError;
 using ::cel::runtime_internal::CreateNoSuchKeyError;
 
@@ -108,40 +112,130 @@ Handle<Value> TestOnlySelect(const Handle<MapValue>& map,
 
 }  // namespace
 
-// SelectStep performs message field access specified by Expr::Select
-// message.
-class SelectStep : public ExpressionStepBase {
- public:
-  SelectStep(Handle<StringValue> value, bool test_field_presence,
-             int64_t expr_id, absl::string_view select_path,
-             bool enable_wrapper_type_null_unboxing)
-      : ExpressionStepBase(expr_id),
-        field_value_(std::move(value)),
-        field_(field_value_->ToString()),
-        test_field_presence_(test_field_presence),
-        select_path_(select_path),
-        unboxing_option_(enable_wrapper_type_null_unboxing
-                             ? ProtoWrapperTypeOptions::kUnsetNull
-                             : ProtoWrapperTypeOptions::kUnsetProtoDefault) {}
-
-  absl::Status Evaluate(ExecutionFrame* frame) const override;
-
- private:
-  absl::StatusOr<Handle<Value>> CreateValueFromField(
-      const Handle<StructValue>& msg, ExecutionFrame* frame) const;
-  cel::Handle<StringValue> field_value_;
-  std::string field_;
-  bool test_field_presence_;
-  std::string select_path_;
-  ProtoWrapperTypeOptions unboxing_option_;
-};
+SelectStep::SelectStep(Handle<StringValue> value, bool test_field_presence,
+                       int64_t expr_id, absl::string_view select_path,
+                       bool enable_wrapper_type_null_unboxing)
+    : ExpressionStepBase(expr_id),
+      field_value_(std::move(value)),
+      field_(field_value_->ToString()),
+      no_such_key_error_(CreateNoSuchKeyError(*field_value_)),
+      test_field_presence_(test_field_presence),
+      select_path_(select_path),
+      unboxing_option_(enable_wrapper_type_null_unboxing
+                           ? ProtoWrapperTypeOptions::kUnsetNull
+                           : ProtoWrapperTypeOptions::kUnsetProtoDefault) {}
+
+template <typename StructValueT>
+absl::StatusOr<absl::optional<Handle<Value>>> SelectStep::SelectByHint(
+    const StructValueT& msg, std::atomic<const void*>& field_hint,
+    cel::ValueFactory& value_factory) const {
+  bool unbox_null_wrapper_types =
+      unboxing_option_ != ProtoWrapperTypeOptions::kUnsetProtoDefault;
+  if (const void* hint = field_hint.load(std::memory_order_relaxed);
+      hint != nullptr) {
+    CEL_ASSIGN_OR_RETURN(
+        auto result,
+        msg.GetFieldByHint(value_factory, field_, hint,
+                           unbox_null_wrapper_types));
+    if (result.has_value()) {
+      return result;
+    }
+  }
+  const void* hint = msg.FindFieldHint(field_);
+  if (hint == nullptr) {
+    return absl::nullopt;
+  }
+  field_hint.store(hint, std::memory_order_relaxed);
+  return msg.GetFieldByHint(value_factory, field_, hint,
+                            unbox_null_wrapper_types);
+}
+
+template <typename StructValueT>
+absl::StatusOr<absl::optional<bool>> SelectStep::TestByHint(
+    const StructValueT& msg, std::atomic<const void*>& field_hint) const {
+  if (const void* hint = field_hint.load(std::memory_order_relaxed);
+      hint != nullptr) {
+    CEL_ASSIGN_OR_RETURN(auto result, msg.HasFieldByHint(field_, hint));
+    if (result.has_value()) {
+      return result;
+    }
+  }
+  const void* hint = msg.FindFieldHint(field_);
+  if (hint == nullptr) {
+    return absl::nullopt;
+  }
+  field_hint.store(hint, std::memory_order_relaxed);
+  return msg.HasFieldByHint(field_, hint);
+}
 
 absl::StatusOr<Handle<Value>> SelectStep::CreateValueFromField(
-    const Handle<StructValue>& msg, ExecutionFrame* frame) const {
+    const Handle<StructValue>& msg, cel::ValueFactory& value_factory) const {
+  absl::optional<Handle<Value>> result;
+  if (msg->Is<LegacyStructValue>()) {
+    CEL_ASSIGN_OR_RETURN(result, SelectByHint(LegacyStructValue::Cast(*msg),
+                                              field_hint_, value_factory));
+  } else {
+    CEL_ASSIGN_OR_RETURN(result, SelectByHint(AbstractStructValue::Cast(*msg),
+                                              abstract_field_hint_,
+                                              value_factory));
+  }
+  if (result.has_value()) {
+    return std::move(*result);
+  }
   if (unboxing_option_ == ProtoWrapperTypeOptions::kUnsetProtoDefault) {
-    return msg->GetWrappedFieldByName(frame->value_factory(), field_);
+    return msg->GetWrappedFieldByName(value_factory, field_);
   } else {
-    return msg->GetFieldByName(frame->value_factory(), field_);
+    return msg->GetFieldByName(value_factory, field_);
+  }
+}
+
+absl::StatusOr<Handle<Value>> SelectStep::SelectValue(
+    const Handle<Value>& arg, cel::ValueFactory& value_factory) const {
+  if (arg->Is<NullValue>()) {
+    return value_factory.CreateErrorValue(
+        cel::runtime_internal::CreateError("Message is NULL"));
+  }
+
+  // Handle test only Select.
+  if (test_field_presence_) {
+    switch (arg->kind()) {
+      case ValueKind::kMap:
+        return TestOnlySelect(arg.As<MapValue>(), field_value_, value_factory);
+      case ValueKind::kMessage: {
+        absl::StatusOr<absl::optional<bool>> presence =
+            arg->Is<LegacyStructValue>()
+                ? TestByHint(LegacyStructValue::Cast(*arg), field_hint_)
+                : TestByHint(AbstractStructValue::Cast(*arg),
+                             abstract_field_hint_);
+        if (!presence.ok()) {
+          return value_factory.CreateErrorValue(std::move(presence).status());
+        }
+        if (presence->has_value()) {
+          return value_factory.CreateBoolValue(**presence);
+        }
+        return TestOnlySelect(arg.As<StructValue>(), field_, value_factory);
+      }
+      default:
+        return value_factory.CreateErrorValue(InvalidSelectTargetError());
+    }
+  }
+
+  // Normal select path.
+  // Select steps can be applied to either maps or messages
+  switch (arg->kind()) {
+    case ValueKind::kStruct:
+      return CreateValueFromField(arg.As<StructValue>(), value_factory);
+    case ValueKind::kMap: {
+      CEL_ASSIGN_OR_RETURN(
+          auto entry, arg.As<MapValue>()->Find(value_factory, field_value_));
+      // An absent entry may still carry an error or unknown for the lookup.
+      if (entry.second || entry.first) {
+        return std::move(entry.first);
+      }
+      return value_factory.CreateErrorValue(no_such_key_error_);
+    }
+    default:
+      return value_factory.CreateErrorValue(InvalidSelectTargetError());
   }
 }
 
@@ -159,6 +253,18 @@ absl::Status SelectStep::Evaluate(ExecutionFrame* frame) const {
     return absl::OkStatus();
   }
 
+  // Fast path for the common case of selecting a field of a message when no
+  // attribute is tracked: go straight to the cached field hint, skipping the
+  // attribute trail and the dispatch on the kind of the operand.
+  if (!test_field_presence_ && !frame->enable_unknowns() &&
+      !frame->enable_missing_attribute_errors() && arg->Is<StructValue>()) {
+    CEL_ASSIGN_OR_RETURN(
+        Handle<Value> result,
+        CreateValueFromField(arg.As<StructValue>(), frame->value_factory()));
+    frame->value_stack().PopAndPush(std::move(result));
+    return absl::OkStatus();
+  }
+
   AttributeTrail result_trail;
 
   // Handle unknown resolution.
@@ -189,46 +295,14 @@ absl::Status SelectStep::Evaluate(ExecutionFrame* frame) const {
     return absl::OkStatus();
   }
 
-  // Handle test only Select.
+  CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                       SelectValue(arg, frame->value_factory()));
   if (test_field_presence_) {
-    switch (arg->kind()) {
-      case ValueKind::kMap:
-        frame->value_stack().PopAndPush(TestOnlySelect(
-            arg.As<MapValue>(), field_value_, frame->value_factory()));
-        return absl::OkStatus();
-      case ValueKind::kMessage:
-        frame->value_stack().PopAndPush(TestOnlySelect(
-            arg.As<StructValue>(), field_, frame->value_factory()));
-        return absl::OkStatus();
-      default:
-        // Control flow should have returned earlier.
-        return InvalidSelectTargetError();
-    }
-  }
-
-  // Normal select path.
-  // Select steps can be applied to either maps or messages
-  switch (arg->kind()) {
-    case ValueKind::kStruct: {
-      CEL_ASSIGN_OR_RETURN(Handle<Value> result,
-                           CreateValueFromField(arg.As<StructValue>(), frame));
-      frame->value_stack().PopAndPush(std::move(result),
-                                      std::move(result_trail));
-
-      return absl::OkStatus();
-    }
-    case ValueKind::kMap: {
-      const auto& cel_map = arg.As<MapValue>();
-      CEL_ASSIGN_OR_RETURN(auto result,
-                           cel_map->Get(frame->value_factory(), field_value_));
-      frame->value_stack().PopAndPush(std::move(result),
-                                      std::move(result_trail));
-      return absl::OkStatus();
-    }
-    default:
-      // Control flow should have returned earlier.
-      return InvalidSelectTargetError();
+    frame->value_stack().PopAndPush(std::move(result));
+  } else {
+    frame->value_stack().PopAndPush(std::move(result), std::move(result_trail));
   }
+  return absl::OkStatus();
 }
 
 // Factory method for Select - based Execution step
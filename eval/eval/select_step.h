@@ -1,17 +1,94 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_SELECT_STEP_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_SELECT_STEP_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <string>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "base/ast_internal/expr.h"
+#include "base/handle.h"
+#include "base/value.h"
 #include "base/value_factory.h"
+#include "base/values/string_value.h"
+#include "base/values/struct_value.h"
+#include "common/native_type.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
+#include "runtime/runtime_options.h"
 
 namespace google::api::expr::runtime {
 
+// SelectStep performs message field access specified by Expr::Select
+// message.
+//
+// Exposed so planner extensions can fuse chains of selects.
+class SelectStep : public ExpressionStepBase {
+ public:
+  SelectStep(cel::Handle<cel::StringValue> value, bool test_field_presence,
+             int64_t expr_id, absl::string_view select_path,
+             bool enable_wrapper_type_null_unboxing);
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override;
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<SelectStep>();
+  }
+
+  // Applies the select (or presence test) to arg without attribute
+  // tracking. Unknown and error operands must be handled by the caller.
+  //
+  // Non-ok status is returned for unrecoverable errors, evaluation errors
+  // are returned as a cel::ErrorValue.
+  absl::StatusOr<cel::Handle<cel::Value>> SelectValue(
+      const cel::Handle<cel::Value>& arg,
+      cel::ValueFactory& value_factory) const;
+
+  const std::string& field() const { return field_; }
+
+  bool test_field_presence() const { return test_field_presence_; }
+
+ private:
+  absl::StatusOr<cel::Handle<cel::Value>> CreateValueFromField(
+      const cel::Handle<cel::StructValue>& msg,
+      cel::ValueFactory& value_factory) const;
+
+  // Selects the field from a legacy or abstract struct value using the
+  // cached field hint, resolving it first if the cache is empty or for a
+  // different type. Returns absl::nullopt if the value does not support
+  // hints.
+  template <typename StructValueT>
+  absl::StatusOr<absl::optional<cel::Handle<cel::Value>>> SelectByHint(
+      const StructValueT& msg, std::atomic<const void*>& field_hint,
+      cel::ValueFactory& value_factory) const;
+
+  // Presence test counterpart of SelectByHint.
+  template <typename StructValueT>
+  absl::StatusOr<absl::optional<bool>> TestByHint(
+      const StructValueT& msg, std::atomic<const void*>& field_hint) const;
+
+  cel::Handle<cel::StringValue> field_value_;
+  std::string field_;
+  // Error for selecting a missing map key, formatted when the step is planned
+  // so that selects absorbed by `||` or `&&` do not format one per evaluation.
+  absl::Status no_such_key_error_;
+  bool test_field_presence_;
+  std::string select_path_;
+  cel::ProtoWrapperTypeOptions unboxing_option_;
+  // Field hint for the last message type selected from, see
+  // cel::base_internal::LegacyStructValue::FindFieldHint. Shared by concurrent
+  // evaluations, which resolve equal hints for equal types.
+  mutable std::atomic<const void*> field_hint_ = nullptr;
+  // Field hint for the last abstract struct type selected from, see
+  // cel::base_internal::AbstractStructValue::FindFieldHint. Kept apart from
+  // field_hint_ as legacy hints are dereferenced when checked.
+  mutable std::atomic<const void*> abstract_field_hint_ = nullptr;
+};
+
 // Factory method for Select - based Execution step
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateSelectStep(
     const cel::ast_internal::Select& select_expr, int64_t expr_id,
@@ -354,6 +354,58 @@ TEST_P(SelectStepConformanceTest, FieldIsNotPresentInProtoTest) {
   EXPECT_THAT(result.ErrorOrDie()->code(), Eq(absl::StatusCode::kNotFound));
 }
 
+TEST_F(SelectStepTest, ReusedAcrossMessageTypes) {
+  // The step caches the resolved field for the last message type selected
+  // from, so it must revalidate it against each message.
+  ExecutionPath path;
+  Expr expr;
+  auto& select = expr.mutable_select_expr();
+  select.set_field("string_value");
+  Expr& expr0 = select.mutable_operand();
+  auto& ident = expr0.mutable_ident_expr();
+  ident.set_name("target");
+  ASSERT_OK_AND_ASSIGN(auto step0, CreateIdentStep(ident, expr0.id()));
+  ASSERT_OK_AND_ASSIGN(
+      auto step1, CreateSelectStep(select, expr.id(), "",
+                                   /*enable_wrapper_type_null_unboxing=*/false,
+                                   value_factory_));
+  path.push_back(std::move(step0));
+  path.push_back(std::move(step1));
+  CelExpressionFlatImpl cel_expr(
+      FlatExpression(std::move(path), /*comprehension_slot_count=*/0,
+                     TypeProvider::Builtin(), cel::RuntimeOptions{}));
+
+  TestMessage first;
+  first.set_string_value("first");
+  TestMessage second;
+  second.set_string_value("second");
+  TestExtensions other;
+  other.set_name("other");
+  for (int i = 0; i < 2; ++i) {
+    Activation activation;
+    activation.InsertValue("target",
+                           CelProtoWrapper::CreateMessage(&first, &arena_));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr.Evaluate(activation, &arena_));
+    ASSERT_TRUE(result.IsString());
+    EXPECT_EQ(result.StringOrDie().value(), "first");
+
+    activation.RemoveValueEntry("target");
+    activation.InsertValue("target",
+                           CelProtoWrapper::CreateMessage(&second, &arena_));
+    ASSERT_OK_AND_ASSIGN(result, cel_expr.Evaluate(activation, &arena_));
+    ASSERT_TRUE(result.IsString());
+    EXPECT_EQ(result.StringOrDie().value(), "second");
+
+    activation.RemoveValueEntry("target");
+    activation.InsertValue("target",
+                           CelProtoWrapper::CreateMessage(&other, &arena_));
+    ASSERT_OK_AND_ASSIGN(result, cel_expr.Evaluate(activation, &arena_));
+    ASSERT_TRUE(result.IsError());
+    EXPECT_THAT(result.ErrorOrDie()->code(), Eq(absl::StatusCode::kNotFound));
+  }
+}
+
 TEST_P(SelectStepConformanceTest, FieldIsNotSetTest) {
   TestMessage message;
   RunExpressionOptions options;
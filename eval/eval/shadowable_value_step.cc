@@ -1,5 +1,6 @@
 #include "eval/eval/shadowable_value_step.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -15,19 +16,27 @@ namespace {
 class ShadowableValueStep : public ExpressionStepBase {
  public:
   ShadowableValueStep(std::string identifier, cel::Handle<cel::Value> value,
-                      int64_t expr_id)
+                      int64_t expr_id, size_t variable_slot)
       : ExpressionStepBase(expr_id),
         identifier_(std::move(identifier)),
-        value_(std::move(value)) {}
+        value_(std::move(value)),
+        variable_slot_(variable_slot) {}
 
   absl::Status Evaluate(ExecutionFrame* frame) const override;
 
  private:
   std::string identifier_;
   cel::Handle<cel::Value> value_;
+  size_t variable_slot_;
 };
 
 absl::Status ShadowableValueStep::Evaluate(ExecutionFrame* frame) const {
+  if (const cel::Handle<cel::Value>* var =
+          frame->FindBoundVariable(variable_slot_);
+      var != nullptr) {
+    frame->value_stack().Push(*var);
+    return absl::OkStatus();
+  }
   CEL_ASSIGN_OR_RETURN(auto var, frame->modern_activation().FindVariable(
                                      frame->value_factory(), identifier_));
   if (var.has_value()) {
@@ -41,9 +50,10 @@ absl::Status ShadowableValueStep::Evaluate(ExecutionFrame* frame) const {
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateShadowableValueStep(
-    std::string identifier, cel::Handle<cel::Value> value, int64_t expr_id) {
-  return absl::make_unique<ShadowableValueStep>(std::move(identifier),
-                                                std::move(value), expr_id);
+    std::string identifier, cel::Handle<cel::Value> value, int64_t expr_id,
+    size_t variable_slot) {
+  return absl::make_unique<ShadowableValueStep>(
+      std::move(identifier), std::move(value), expr_id, variable_slot);
 }
 
 }  // namespace google::api::expr::runtime
@@ -1,6 +1,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_SHADOWABLE_VALUE_STEP_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_EVAL_SHADOWABLE_VALUE_STEP_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -9,14 +10,20 @@
 #include "base/handle.h"
 #include "base/value.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/ident_step.h"
 
 namespace google::api::expr::runtime {
 
 // Create an identifier resolution step with a default value that may be
 // shadowed by an identifier of the same name within the runtime-provided
 // Activation.
+//
+// variable_slot is the position of the identifier in the program's variable
+// names. If the activation binds variables by slot, a bound variable is read
+// from the slot rather than looked up by name.
 absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateShadowableValueStep(
-    std::string identifier, cel::Handle<cel::Value> value, int64_t expr_id);
+    std::string identifier, cel::Handle<cel::Value> value, int64_t expr_id,
+    size_t variable_slot = kNoVariableSlot);
 
 }  // namespace google::api::expr::runtime
 
@@ -0,0 +1,781 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/standard_operator_step.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/map_value.h"
+#include "base/values/string_value.h"
+#include "base/values/timestamp_value.h"
+#include "base/values/uint_value.h"
+#include "common/native_type.h"
+#include "eval/eval/attribute_trail.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
+#include "internal/casts.h"
+#include "internal/number.h"
+#include "internal/overflow.h"
+#include "internal/status_macros.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::BoolValue;
+using ::cel::DoubleValue;
+using ::cel::DurationValue;
+using ::cel::Handle;
+using ::cel::IntValue;
+using ::cel::Kind;
+using ::cel::ListValue;
+using ::cel::MapValue;
+using ::cel::StringValue;
+using ::cel::TimestampValue;
+using ::cel::UintValue;
+using ::cel::Value;
+using ::cel::ValueFactory;
+using ::cel::ValueKindToKind;
+using ::cel::internal::CompareNumeric;
+using ::cel::internal::ComparisonResult;
+
+constexpr Kind kArithmeticKinds[] = {Kind::kInt, Kind::kUint, Kind::kDouble};
+constexpr Kind kAddKinds[] = {Kind::kInt,      Kind::kUint,
+                              Kind::kDouble,   Kind::kString,
+                              Kind::kDuration, Kind::kTimestamp};
+constexpr Kind kSubtractKinds[] = {Kind::kInt, Kind::kUint, Kind::kDouble,
+                                   Kind::kDuration, Kind::kTimestamp};
+constexpr Kind kModuloKinds[] = {Kind::kInt, Kind::kUint};
+constexpr Kind kNegateKinds[] = {Kind::kInt, Kind::kDouble};
+constexpr Kind kNotKinds[] = {Kind::kBool};
+constexpr Kind kOrderingKinds[] = {Kind::kInt,      Kind::kUint,
+                                   Kind::kDouble,   Kind::kString,
+                                   Kind::kDuration, Kind::kTimestamp};
+constexpr Kind kEqualityKinds[] = {Kind::kBool,     Kind::kInt,
+                                   Kind::kUint,     Kind::kDouble,
+                                   Kind::kString,   Kind::kDuration,
+                                   Kind::kTimestamp};
+constexpr Kind kSizeKinds[] = {Kind::kString, Kind::kList, Kind::kMap};
+
+uint64_t KindBit(Kind kind) { return uint64_t{1} << static_cast<int>(kind); }
+
+Handle<Value> FromChecked(ValueFactory& value_factory,
+                          absl::StatusOr<int64_t> result) {
+  if (!result.ok()) {
+    return value_factory.CreateErrorValue(std::move(result).status());
+  }
+  return value_factory.CreateIntValue(*result);
+}
+
+Handle<Value> FromChecked(ValueFactory& value_factory,
+                          absl::StatusOr<uint64_t> result) {
+  if (!result.ok()) {
+    return value_factory.CreateErrorValue(std::move(result).status());
+  }
+  return value_factory.CreateUintValue(*result);
+}
+
+Handle<Value> FromNative(ValueFactory& value_factory, int64_t value) {
+  return value_factory.CreateIntValue(value);
+}
+
+Handle<Value> FromNative(ValueFactory& value_factory, uint64_t value) {
+  return value_factory.CreateUintValue(value);
+}
+
+// Applies an arithmetic operator to two values of the same numeric kind T.
+template <typename T>
+Handle<Value> Arithmetic(StandardOperator op, ValueFactory& value_factory,
+                         T lhs, T rhs) {
+  if constexpr (std::is_same_v<T, double>) {
+    switch (op) {
+      case StandardOperator::kAdd:
+        return value_factory.CreateDoubleValue(lhs + rhs);
+      case StandardOperator::kSubtract:
+        return value_factory.CreateDoubleValue(lhs - rhs);
+      case StandardOperator::kMultiply:
+        return value_factory.CreateDoubleValue(lhs * rhs);
+      default:
+        // Division by zero results in +/- inf.
+        return value_factory.CreateDoubleValue(lhs / rhs);
+    }
+  } else {
+    // Overflow is reported by the flag returning variants, so the status for
+    // the error is only built once an operation overflows.
+    T result;
+    switch (op) {
+      case StandardOperator::kAdd:
+        if (ABSL_PREDICT_TRUE(cel::internal::TryAdd(lhs, rhs, &result))) {
+          return FromNative(value_factory, result);
+        }
+        return FromChecked(value_factory, cel::internal::CheckedAdd(lhs, rhs));
+      case StandardOperator::kSubtract:
+        if (ABSL_PREDICT_TRUE(cel::internal::TrySub(lhs, rhs, &result))) {
+          return FromNative(value_factory, result);
+        }
+        return FromChecked(value_factory, cel::internal::CheckedSub(lhs, rhs));
+      case StandardOperator::kMultiply:
+        if (ABSL_PREDICT_TRUE(cel::internal::TryMul(lhs, rhs, &result))) {
+          return FromNative(value_factory, result);
+        }
+        return FromChecked(value_factory, cel::internal::CheckedMul(lhs, rhs));
+      case StandardOperator::kDivide:
+        return FromChecked(value_factory, cel::internal::CheckedDiv(lhs, rhs));
+      default:
+        return FromChecked(value_factory, cel::internal::CheckedMod(lhs, rhs));
+    }
+  }
+}
+
+// Applies an ordering or equality operator given the three way comparison of
+// the operands. Only used for operands that are totally ordered.
+bool Compare(StandardOperator op, int cmp) {
+  switch (op) {
+    case StandardOperator::kLess:
+      return cmp < 0;
+    case StandardOperator::kLessOrEqual:
+      return cmp <= 0;
+    case StandardOperator::kGreater:
+      return cmp > 0;
+    case StandardOperator::kGreaterOrEqual:
+      return cmp >= 0;
+    case StandardOperator::kEqual:
+      return cmp == 0;
+    default:
+      return cmp != 0;
+  }
+}
+
+template <typename T>
+bool CompareNumbers(StandardOperator op, T lhs, T rhs) {
+  // Not reduced to a three way comparison, so that NaN compares as in the
+  // standard overloads.
+  switch (op) {
+    case StandardOperator::kLess:
+      return lhs < rhs;
+    case StandardOperator::kLessOrEqual:
+      return lhs <= rhs;
+    case StandardOperator::kGreater:
+      return lhs > rhs;
+    case StandardOperator::kGreaterOrEqual:
+      return lhs >= rhs;
+    case StandardOperator::kEqual:
+      return lhs == rhs;
+    default:
+      return lhs != rhs;
+  }
+}
+
+bool IsComparison(StandardOperator op) {
+  switch (op) {
+    case StandardOperator::kLess:
+    case StandardOperator::kLessOrEqual:
+    case StandardOperator::kGreater:
+    case StandardOperator::kGreaterOrEqual:
+    case StandardOperator::kEqual:
+    case StandardOperator::kInequal:
+      return true;
+    default:
+      return false;
+  }
+}
+
+template <typename T, typename V>
+Handle<Value> BinaryNumeric(StandardOperator op, ValueFactory& value_factory,
+                            const Handle<Value>& lhs,
+                            const Handle<Value>& rhs) {
+  T lhs_value = lhs.As<V>()->NativeValue();
+  T rhs_value = rhs.As<V>()->NativeValue();
+  if (IsComparison(op)) {
+    return value_factory.CreateBoolValue(
+        CompareNumbers(op, lhs_value, rhs_value));
+  }
+  return Arithmetic<T>(op, value_factory, lhs_value, rhs_value);
+}
+
+bool IsNumeric(Kind kind) {
+  return kind == Kind::kInt || kind == Kind::kUint || kind == Kind::kDouble;
+}
+
+// Returns true for numbers of two different kinds.
+bool IsMixedNumeric(Kind lhs, Kind rhs) {
+  return lhs != rhs && IsNumeric(lhs) && IsNumeric(rhs);
+}
+
+template <typename T>
+ComparisonResult CompareNumericTo(T lhs, const Handle<Value>& rhs) {
+  switch (rhs->kind()) {
+    case cel::ValueKind::kInt:
+      return CompareNumeric(lhs, rhs.As<IntValue>()->NativeValue());
+    case cel::ValueKind::kUint:
+      return CompareNumeric(lhs, rhs.As<UintValue>()->NativeValue());
+    default:
+      return CompareNumeric(lhs, rhs.As<DoubleValue>()->NativeValue());
+  }
+}
+
+// Applies an ordering or equality operator to numbers of any kinds, with the
+// semantics of the heterogeneous comparison and equality overloads: numbers
+// compare on a single number line, and NaN is unordered and unequal.
+bool CompareMixedNumbers(StandardOperator op, const Handle<Value>& lhs,
+                         const Handle<Value>& rhs) {
+  ComparisonResult cmp;
+  switch (lhs->kind()) {
+    case cel::ValueKind::kInt:
+      cmp = CompareNumericTo(lhs.As<IntValue>()->NativeValue(), rhs);
+      break;
+    case cel::ValueKind::kUint:
+      cmp = CompareNumericTo(lhs.As<UintValue>()->NativeValue(), rhs);
+      break;
+    default:
+      cmp = CompareNumericTo(lhs.As<DoubleValue>()->NativeValue(), rhs);
+      break;
+  }
+  switch (op) {
+    case StandardOperator::kLess:
+      return cmp == ComparisonResult::kLesser;
+    case StandardOperator::kLessOrEqual:
+      return cmp == ComparisonResult::kLesser ||
+             cmp == ComparisonResult::kEqual;
+    case StandardOperator::kGreater:
+      return cmp == ComparisonResult::kGreater;
+    case StandardOperator::kGreaterOrEqual:
+      return cmp == ComparisonResult::kGreater ||
+             cmp == ComparisonResult::kEqual;
+    case StandardOperator::kEqual:
+      return cmp == ComparisonResult::kEqual;
+    default:
+      return cmp != ComparisonResult::kEqual;
+  }
+}
+
+// Time arithmetic with the semantics of the standard overloads: if
+// overflow_errors (RuntimeOptions::enable_timestamp_duration_overflow_errors)
+// is set, results out of range are errors, otherwise they aren't checked. The
+// status for the error is only built once an operation overflows.
+Handle<Value> AddTime(ValueFactory& value_factory, bool overflow_errors,
+                      absl::Time lhs, absl::Duration rhs) {
+  absl::Time result;
+  if (!overflow_errors) {
+    return value_factory.CreateUncheckedTimestampValue(lhs + rhs);
+  }
+  if (ABSL_PREDICT_TRUE(cel::internal::TryAdd(lhs, rhs, &result))) {
+    return value_factory.CreateUncheckedTimestampValue(result);
+  }
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedAdd(lhs, rhs).status());
+}
+
+Handle<Value> SubtractTime(ValueFactory& value_factory, bool overflow_errors,
+                           absl::Time lhs, absl::Duration rhs) {
+  absl::Time result;
+  if (!overflow_errors) {
+    return value_factory.CreateUncheckedTimestampValue(lhs - rhs);
+  }
+  if (ABSL_PREDICT_TRUE(cel::internal::TrySub(lhs, rhs, &result))) {
+    return value_factory.CreateUncheckedTimestampValue(result);
+  }
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedSub(lhs, rhs).status());
+}
+
+Handle<Value> SubtractTimes(ValueFactory& value_factory, bool overflow_errors,
+                            absl::Time lhs, absl::Time rhs) {
+  absl::Duration result;
+  if (!overflow_errors) {
+    return value_factory.CreateUncheckedDurationValue(lhs - rhs);
+  }
+  if (ABSL_PREDICT_TRUE(cel::internal::TrySub(lhs, rhs, &result))) {
+    return value_factory.CreateUncheckedDurationValue(result);
+  }
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedSub(lhs, rhs).status());
+}
+
+Handle<Value> DurationArithmetic(StandardOperator op,
+                                 ValueFactory& value_factory,
+                                 bool overflow_errors, absl::Duration lhs,
+                                 absl::Duration rhs) {
+  absl::Duration result;
+  if (!overflow_errors) {
+    return value_factory.CreateUncheckedDurationValue(
+        op == StandardOperator::kAdd ? lhs + rhs : lhs - rhs);
+  }
+  if (op == StandardOperator::kAdd) {
+    if (ABSL_PREDICT_TRUE(cel::internal::TryAdd(lhs, rhs, &result))) {
+      return value_factory.CreateUncheckedDurationValue(result);
+    }
+    return value_factory.CreateErrorValue(
+        cel::internal::CheckedAdd(lhs, rhs).status());
+  }
+  if (ABSL_PREDICT_TRUE(cel::internal::TrySub(lhs, rhs, &result))) {
+    return value_factory.CreateUncheckedDurationValue(result);
+  }
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedSub(lhs, rhs).status());
+}
+
+// Applies an operator to two durations or two timestamps. Timestamps are only
+// subtracted.
+template <typename T, typename V>
+Handle<Value> BinaryTime(StandardOperator op, ValueFactory& value_factory,
+                         bool overflow_errors, const Handle<Value>& lhs,
+                         const Handle<Value>& rhs) {
+  T lhs_value = lhs.As<V>()->NativeValue();
+  T rhs_value = rhs.As<V>()->NativeValue();
+  if (IsComparison(op)) {
+    return value_factory.CreateBoolValue(
+        CompareNumbers(op, lhs_value, rhs_value));
+  }
+  if constexpr (std::is_same_v<T, absl::Time>) {
+    return SubtractTimes(value_factory, overflow_errors, lhs_value, rhs_value);
+  } else {
+    return DurationArithmetic(op, value_factory, overflow_errors, lhs_value,
+                              rhs_value);
+  }
+}
+
+// Returns true if lhs op rhs adds a duration to a timestamp or subtracts one
+// from it.
+bool IsMixedTime(StandardOperator op, Kind lhs, Kind rhs) {
+  if (lhs == Kind::kTimestamp && rhs == Kind::kDuration) {
+    return op == StandardOperator::kAdd || op == StandardOperator::kSubtract;
+  }
+  return lhs == Kind::kDuration && rhs == Kind::kTimestamp &&
+         op == StandardOperator::kAdd;
+}
+
+Handle<Value> MixedTime(StandardOperator op, ValueFactory& value_factory,
+                        bool overflow_errors, const Handle<Value>& lhs,
+                        const Handle<Value>& rhs) {
+  if (lhs->Is<DurationValue>()) {
+    return AddTime(value_factory, overflow_errors,
+                   rhs.As<TimestampValue>()->NativeValue(),
+                   lhs.As<DurationValue>()->NativeValue());
+  }
+  absl::Time timestamp = lhs.As<TimestampValue>()->NativeValue();
+  absl::Duration duration = rhs.As<DurationValue>()->NativeValue();
+  if (op == StandardOperator::kAdd) {
+    return AddTime(value_factory, overflow_errors, timestamp, duration);
+  }
+  return SubtractTime(value_factory, overflow_errors, timestamp, duration);
+}
+
+Handle<Value> BinaryString(StandardOperator op, ValueFactory& value_factory,
+                           const Handle<Value>& lhs,
+                           const Handle<Value>& rhs) {
+  const StringValue& lhs_value = *lhs.As<StringValue>();
+  const StringValue& rhs_value = *rhs.As<StringValue>();
+  switch (op) {
+    case StandardOperator::kAdd:
+      return value_factory.CreateUncheckedStringValue(
+          absl::StrCat(lhs_value.ToString(), rhs_value.ToString()));
+    case StandardOperator::kEqual:
+      return value_factory.CreateBoolValue(lhs_value.Equals(rhs_value));
+    case StandardOperator::kInequal:
+      return value_factory.CreateBoolValue(!lhs_value.Equals(rhs_value));
+    default:
+      return value_factory.CreateBoolValue(
+          Compare(op, lhs_value.Compare(rhs_value)));
+  }
+}
+
+class StandardOperatorStep : public ExpressionStepBase {
+ public:
+  StandardOperatorStep(StandardOperator op, uint64_t kinds,
+                       bool mixed_numeric,
+                       std::unique_ptr<const ExpressionStep> function_step,
+                       int64_t expr_id)
+      : ExpressionStepBase(expr_id),
+        op_(op),
+        arity_(StandardOperatorArity(op)),
+        kinds_(kinds),
+        same_kinds_(op == StandardOperator::kAdd
+                        ? kinds & ~KindBit(Kind::kTimestamp)
+                        : kinds),
+        mixed_numeric_(mixed_numeric),
+        mixed_time_((op == StandardOperator::kAdd ||
+                     op == StandardOperator::kSubtract) &&
+                    (kinds & KindBit(Kind::kTimestamp))),
+        function_step_(std::move(function_step)) {}
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<StandardOperatorStep>();
+  }
+
+  bool IsStringAdd() const {
+    return op_ == StandardOperator::kAdd && (kinds_ & KindBit(Kind::kString));
+  }
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(arity_)) {
+      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+    }
+    absl::Span<const Handle<Value>> args =
+        frame->value_stack().GetSpan(arity_);
+    Kind kind = ValueKindToKind(args[0]->kind());
+    Handle<Value> result;
+    if (ABSL_PREDICT_FALSE((same_kinds_ & KindBit(kind)) == 0 ||
+                           (arity_ == 2 && args[1]->kind() != kind))) {
+      if (mixed_time_ &&
+          IsMixedTime(op_, kind, ValueKindToKind(args[1]->kind()))) {
+        result = MixedTime(
+            op_, frame->value_factory(),
+            frame->options().enable_timestamp_duration_overflow_errors,
+            args[0], args[1]);
+      } else if (mixed_numeric_ &&
+                 IsMixedNumeric(kind, ValueKindToKind(args[1]->kind()))) {
+        result = frame->value_factory().CreateBoolValue(
+            CompareMixedNumbers(op_, args[0], args[1]));
+      } else {
+        return function_step_->Evaluate(frame);
+      }
+    } else {
+      result = Apply(kind, args, *frame);
+    }
+    frame->value_stack().Pop(arity_);
+    frame->value_stack().Push(std::move(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  Handle<Value> Apply(Kind kind, absl::Span<const Handle<Value>> args,
+                      ExecutionFrame& frame) const {
+    ValueFactory& value_factory = frame.value_factory();
+    if (arity_ == 1) {
+      return ApplyUnary(kind, args[0], value_factory);
+    }
+    switch (kind) {
+      case Kind::kBool:
+        return value_factory.CreateBoolValue(
+            CompareNumbers(op_, args[0].As<BoolValue>()->NativeValue(),
+                           args[1].As<BoolValue>()->NativeValue()));
+      case Kind::kInt:
+        return BinaryNumeric<int64_t, IntValue>(op_, value_factory, args[0],
+                                                args[1]);
+      case Kind::kUint:
+        return BinaryNumeric<uint64_t, UintValue>(op_, value_factory, args[0],
+                                                  args[1]);
+      case Kind::kDouble:
+        return BinaryNumeric<double, DoubleValue>(op_, value_factory, args[0],
+                                                  args[1]);
+      case Kind::kDuration:
+        return BinaryTime<absl::Duration, DurationValue>(
+            op_, value_factory,
+            frame.options().enable_timestamp_duration_overflow_errors,
+            args[0], args[1]);
+      case Kind::kTimestamp:
+        return BinaryTime<absl::Time, TimestampValue>(
+            op_, value_factory,
+            frame.options().enable_timestamp_duration_overflow_errors,
+            args[0], args[1]);
+      default:
+        return BinaryString(op_, value_factory, args[0], args[1]);
+    }
+  }
+
+  Handle<Value> ApplyUnary(Kind kind, const Handle<Value>& arg,
+                           ValueFactory& value_factory) const {
+    switch (op_) {
+      case StandardOperator::kNot:
+        return value_factory.CreateBoolValue(
+            !arg.As<BoolValue>()->NativeValue());
+      case StandardOperator::kNegate:
+        if (kind == Kind::kInt) {
+          int64_t value = arg.As<IntValue>()->NativeValue();
+          int64_t result;
+          if (ABSL_PREDICT_TRUE(cel::internal::TryNegation(value, &result))) {
+            return value_factory.CreateIntValue(result);
+          }
+          return FromChecked(value_factory,
+                             cel::internal::CheckedNegation(value));
+        }
+        return value_factory.CreateDoubleValue(
+            -arg.As<DoubleValue>()->NativeValue());
+      default:
+        switch (kind) {
+          case Kind::kString:
+            return value_factory.CreateIntValue(arg.As<StringValue>()->Size());
+          case Kind::kList:
+            return value_factory.CreateIntValue(arg.As<ListValue>()->Size());
+          default:
+            return value_factory.CreateIntValue(arg.As<MapValue>()->Size());
+        }
+    }
+  }
+
+  StandardOperator op_;
+  size_t arity_;
+  // Bit set of the cel::Kind values with a fast path.
+  uint64_t kinds_;
+  // Bit set of the kinds with a fast path for arguments of that kind alone.
+  // Only excludes timestamps for addition.
+  uint64_t same_kinds_;
+  // Whether comparisons of numbers of different kinds have a fast path.
+  bool mixed_numeric_;
+  // Whether adding a duration to a timestamp or subtracting one from it has a
+  // fast path.
+  bool mixed_time_;
+  std::unique_ptr<const ExpressionStep> function_step_;
+};
+
+class StringConcatStep : public ExpressionStepBase {
+ public:
+  StringConcatStep(size_t operands, std::unique_ptr<const ExpressionStep> lhs,
+                   std::unique_ptr<const ExpressionStep> add, int64_t expr_id)
+      : ExpressionStepBase(expr_id),
+        operands_(operands),
+        lhs_(std::move(lhs)),
+        add_(std::move(add)) {}
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<StringConcatStep>();
+  }
+
+  size_t operands() const { return operands_; }
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(operands_)) {
+      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+    }
+    absl::Span<const Handle<Value>> args =
+        frame->value_stack().GetSpan(operands_);
+    if (ABSL_PREDICT_TRUE(absl::c_all_of(args, [](const Handle<Value>& arg) {
+          return arg->Is<StringValue>();
+        }))) {
+      size_t size = 0;
+      for (const Handle<Value>& arg : args) {
+        size += arg.As<StringValue>()->Visit(ByteSize{});
+      }
+      std::string result;
+      result.reserve(size);
+      for (const Handle<Value>& arg : args) {
+        arg.As<StringValue>()->Visit(AppendTo{result});
+      }
+      frame->value_stack().Pop(operands_);
+      frame->value_stack().Push(
+          frame->value_factory().CreateUncheckedStringValue(std::move(result)));
+      return absl::OkStatus();
+    }
+
+    // Evaluate the chain of calls as planned originally, so errors, unknowns
+    // and overloads for other kinds are handled the same way.
+    Handle<Value> last = frame->value_stack().Peek();
+    AttributeTrail last_attribute = frame->value_stack().PeekAttribute();
+    frame->value_stack().Pop(1);
+    CEL_RETURN_IF_ERROR(lhs_->Evaluate(frame));
+    frame->value_stack().Push(std::move(last), std::move(last_attribute));
+    return add_->Evaluate(frame);
+  }
+
+ private:
+  struct ByteSize {
+    size_t operator()(absl::string_view value) const { return value.size(); }
+    size_t operator()(const absl::Cord& value) const { return value.size(); }
+  };
+
+  struct AppendTo {
+    void operator()(absl::string_view value) const {
+      out.append(value.data(), value.size());
+    }
+    void operator()(const absl::Cord& value) const {
+      for (absl::string_view chunk : value.Chunks()) {
+        out.append(chunk.data(), chunk.size());
+      }
+    }
+
+    std::string& out;
+  };
+
+  // The number of operands of the chain, including the last one.
+  size_t operands_;
+  // Combines all of the operands but the last one.
+  std::unique_ptr<const ExpressionStep> lhs_;
+  // Combines the result of lhs_ with the last operand.
+  std::unique_ptr<const ExpressionStep> add_;
+};
+
+// Returns the number of operands of a string concatenation step, or 0 if step
+// isn't one.
+size_t StringAddOperands(const ExpressionStep& step) {
+  if (step.GetNativeTypeId() ==
+      cel::NativeTypeId::For<StandardOperatorStep>()) {
+    return cel::internal::down_cast<const StandardOperatorStep&>(step)
+                   .IsStringAdd()
+               ? 2
+               : 0;
+  }
+  if (step.GetNativeTypeId() == cel::NativeTypeId::For<StringConcatStep>()) {
+    return cel::internal::down_cast<const StringConcatStep&>(step).operands();
+  }
+  return 0;
+}
+
+}  // namespace
+
+absl::optional<StandardOperator> GetStandardOperator(absl::string_view function,
+                                                     size_t num_args) {
+  if (num_args == 1) {
+    if (function == cel::builtin::kNeg) return StandardOperator::kNegate;
+    if (function == cel::builtin::kNot) return StandardOperator::kNot;
+    if (function == cel::builtin::kSize) return StandardOperator::kSize;
+    return absl::nullopt;
+  }
+  if (num_args != 2) {
+    return absl::nullopt;
+  }
+  if (function == cel::builtin::kAdd) return StandardOperator::kAdd;
+  if (function == cel::builtin::kSubtract) return StandardOperator::kSubtract;
+  if (function == cel::builtin::kMultiply) return StandardOperator::kMultiply;
+  if (function == cel::builtin::kDivide) return StandardOperator::kDivide;
+  if (function == cel::builtin::kModulo) return StandardOperator::kModulo;
+  if (function == cel::builtin::kLess) return StandardOperator::kLess;
+  if (function == cel::builtin::kLessOrEqual) {
+    return StandardOperator::kLessOrEqual;
+  }
+  if (function == cel::builtin::kGreater) return StandardOperator::kGreater;
+  if (function == cel::builtin::kGreaterOrEqual) {
+    return StandardOperator::kGreaterOrEqual;
+  }
+  if (function == cel::builtin::kEqual) return StandardOperator::kEqual;
+  if (function == cel::builtin::kInequal) return StandardOperator::kInequal;
+  return absl::nullopt;
+}
+
+size_t StandardOperatorArity(StandardOperator op) {
+  switch (op) {
+    case StandardOperator::kNegate:
+    case StandardOperator::kNot:
+    case StandardOperator::kSize:
+      return 1;
+    default:
+      return 2;
+  }
+}
+
+absl::Span<const Kind> StandardOperatorKinds(StandardOperator op) {
+  switch (op) {
+    case StandardOperator::kAdd:
+      return kAddKinds;
+    case StandardOperator::kSubtract:
+      return kSubtractKinds;
+    case StandardOperator::kMultiply:
+    case StandardOperator::kDivide:
+      return kArithmeticKinds;
+    case StandardOperator::kModulo:
+      return kModuloKinds;
+    case StandardOperator::kNegate:
+      return kNegateKinds;
+    case StandardOperator::kNot:
+      return kNotKinds;
+    case StandardOperator::kLess:
+    case StandardOperator::kLessOrEqual:
+    case StandardOperator::kGreater:
+    case StandardOperator::kGreaterOrEqual:
+      return kOrderingKinds;
+    case StandardOperator::kEqual:
+    case StandardOperator::kInequal:
+      return kEqualityKinds;
+    case StandardOperator::kSize:
+      return kSizeKinds;
+  }
+  return {};
+}
+
+std::vector<std::vector<Kind>> StandardOperatorOverloads(StandardOperator op,
+                                                        Kind kind) {
+  if (kind == Kind::kTimestamp) {
+    if (op == StandardOperator::kAdd) {
+      return {{Kind::kTimestamp, Kind::kDuration},
+              {Kind::kDuration, Kind::kTimestamp}};
+    }
+    if (op == StandardOperator::kSubtract) {
+      return {{Kind::kTimestamp, Kind::kDuration},
+              {Kind::kTimestamp, Kind::kTimestamp}};
+    }
+  }
+  return {std::vector<Kind>(StandardOperatorArity(op), kind)};
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStandardOperatorStep(
+    StandardOperator op, absl::Span<const Kind> kinds, bool mixed_numeric,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  if (function_step == nullptr) {
+    return absl::InvalidArgumentError(
+        "standard operator step requires a function step");
+  }
+  uint64_t kind_bits = 0;
+  for (Kind kind : kinds) {
+    if (!absl::c_linear_search(StandardOperatorKinds(op), kind)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("no fast path for argument kind ",
+                       cel::KindToString(kind)));
+    }
+    kind_bits |= KindBit(kind);
+  }
+  if (mixed_numeric && !IsComparison(op)) {
+    return absl::InvalidArgumentError(
+        "mixed numeric fast path requires a comparison");
+  }
+  return std::make_unique<StandardOperatorStep>(
+      op, kind_bits, mixed_numeric, std::move(function_step), expr_id);
+}
+
+bool IsStringAddStep(const ExpressionStep& step) {
+  return StringAddOperands(step) != 0;
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStringConcatStep(
+    std::unique_ptr<const ExpressionStep> lhs_step,
+    std::unique_ptr<const ExpressionStep> add_step, int64_t expr_id) {
+  if (lhs_step == nullptr || add_step == nullptr) {
+    return absl::InvalidArgumentError(
+        "string concatenation step requires the steps of the chain");
+  }
+  size_t lhs_operands = StringAddOperands(*lhs_step);
+  if (lhs_operands == 0) {
+    return absl::InvalidArgumentError(
+        "string concatenation step requires a string addition step");
+  }
+  return std::make_unique<StringConcatStep>(
+      lhs_operands + 1, std::move(lhs_step), std::move(add_step), expr_id);
+}
+
+}  // namespace google::api::expr::runtime
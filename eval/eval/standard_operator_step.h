@@ -0,0 +1,109 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Execution steps for calls to standard operators with type-specialized fast
+// paths, e.g. an int + int step that checks for overflow inline instead of
+// resolving and invoking a function adapter.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_STANDARD_OPERATOR_STEP_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_STANDARD_OPERATOR_STEP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/kind.h"
+#include "eval/eval/evaluator_core.h"
+
+namespace google::api::expr::runtime {
+
+enum class StandardOperator {
+  kAdd,
+  kSubtract,
+  kMultiply,
+  kDivide,
+  kModulo,
+  kNegate,
+  kNot,
+  kLess,
+  kLessOrEqual,
+  kGreater,
+  kGreaterOrEqual,
+  kEqual,
+  kInequal,
+  kSize,
+};
+
+// Returns the operator implemented by calls to function with num_args
+// arguments (including the receiver), or nullopt if the call has no fast
+// path.
+absl::optional<StandardOperator> GetStandardOperator(absl::string_view function,
+                                                     size_t num_args);
+
+// Returns the number of arguments of op.
+size_t StandardOperatorArity(StandardOperator op);
+
+// Returns the argument kinds op has a fast path for. All arguments of a fast
+// path call have the same kind, except that the fast path for timestamps of
+// kAdd and kSubtract also adds durations to timestamps or subtracts them.
+absl::Span<const cel::Kind> StandardOperatorKinds(StandardOperator op);
+
+// Returns the argument kinds of the overloads implemented by the fast path of
+// op for kind, one of StandardOperatorKinds(op). The fast path must only be
+// enabled if all of them are registered.
+std::vector<std::vector<cel::Kind>> StandardOperatorOverloads(
+    StandardOperator op, cel::Kind kind);
+
+// Factory method for a step implementing op for the arguments at the top of
+// the stack.
+//
+// Calls whose arguments all have one of the given kinds (a subset of
+// StandardOperatorKinds(op)) are evaluated inline with the semantics of the
+// standard overload. Durations and timestamps honor
+// RuntimeOptions::enable_timestamp_duration_overflow_errors as the standard
+// overloads do. If mixed_numeric is set, which requires op to be a
+// comparison, so are comparisons between int, uint and double arguments of
+// different kinds, with the semantics of the heterogeneous overloads. Other
+// calls, including calls with error or unknown arguments, are passed on to
+// the eagerly bound function_step.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStandardOperatorStep(
+    StandardOperator op, absl::Span<const cel::Kind> kinds, bool mixed_numeric,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
+// Returns true if step concatenates strings: it was created for kAdd with a
+// string fast path, or by CreateStringConcatStep.
+bool IsStringAddStep(const ExpressionStep& step);
+
+// Factory method for a step evaluating a left-nested chain of `_+_` calls,
+// e.g. `a + b + c`, with all of the operands of the chain at the top of the
+// stack.
+//
+// lhs_step is the step for the chain without its last call (see
+// IsStringAddStep), and add_step the step for the last call. If all operands
+// are strings, they are concatenated into a single buffer, without
+// intermediate values. Otherwise the last operand is set aside while lhs_step
+// combines the others, and add_step then combines the results, exactly as
+// the calls of the chain would have been evaluated one by one.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStringConcatStep(
+    std::unique_ptr<const ExpressionStep> lhs_step,
+    std::unique_ptr<const ExpressionStep> add_step, int64_t expr_id);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_STANDARD_OPERATOR_STEP_H_
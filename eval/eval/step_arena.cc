@@ -0,0 +1,95 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/step_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+// Most programs are a handful of steps, so start small and grow
+// geometrically to bound the unused tail of the last block.
+constexpr size_t kInitialBlockSize = 256;
+constexpr size_t kMaxBlockSize = 16 * 1024;
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+thread_local StepArena* current_arena = nullptr;
+
+size_t AlignUp(size_t n) { return (n + kAlignment - 1) & ~(kAlignment - 1); }
+
+}  // namespace
+
+StepArena::Scope::Scope(StepArena* arena) : previous_(current_arena) {
+  current_arena = arena;
+}
+
+StepArena::Scope::~Scope() { current_arena = previous_; }
+
+StepArena* StepArena::Current() { return current_arena; }
+
+StepArena::~StepArena() {
+  for (const Block& block : blocks_) {
+    if (allocator_ != nullptr) {
+      allocator_->Deallocate(block.data, block.size);
+    } else {
+      delete[] block.data;
+    }
+  }
+}
+
+void* StepArena::Allocate(size_t size) {
+  size = AlignUp(std::max<size_t>(size, 1));
+  if (blocks_.empty() || blocks_.back().size - offset_ < size) {
+    AddBlock(size);
+  }
+  void* ptr = blocks_.back().data + offset_;
+  offset_ += size;
+  space_used_ += size;
+  return ptr;
+}
+
+bool StepArena::Contains(const void* ptr) const {
+  // Compare through std::less, which gives a total order across unrelated
+  // allocations.
+  std::less<const void*> less;
+  for (const Block& block : blocks_) {
+    const char* begin = block.data;
+    if (!less(ptr, begin) && less(ptr, begin + block.size)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void StepArena::AddBlock(size_t min_size) {
+  size_t size =
+      blocks_.empty()
+          ? kInitialBlockSize
+          : std::min(kMaxBlockSize, blocks_.back().size * 2);
+  size = std::max(size, min_size);
+  // operator new[] for char only guarantees default new alignment, which is
+  // at least alignof(std::max_align_t), as do plan allocators.
+  char* data = allocator_ != nullptr
+                   ? static_cast<char*>(allocator_->Allocate(size))
+                   : new char[size];
+  blocks_.push_back(Block{data, size});
+  space_allocated_ += size;
+  offset_ = 0;
+}
+
+}  // namespace google::api::expr::runtime
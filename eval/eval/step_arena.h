@@ -0,0 +1,98 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_STEP_ARENA_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_STEP_ARENA_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "runtime/plan_allocator.h"
+
+namespace google::api::expr::runtime {
+
+// Bump allocator for the expression steps of a single FlatExpression.
+//
+// Steps are allocated in planning order, which closely follows execution
+// order, and released together when the arena is destroyed. Individual
+// deallocations are ignored. Blocks come from the heap or, if given, from a
+// cel::PlanAllocator, e.g. one backed by huge pages.
+//
+// An arena is not thread-safe. Allocation is only expected while planning, on
+// the planning thread.
+class StepArena {
+ public:
+  // Makes arena the allocation target for ExpressionStep instances created on
+  // the current thread for the lifetime of the scope. A null arena restores
+  // the default heap allocation. Scopes nest.
+  class Scope {
+   public:
+    explicit Scope(StepArena* arena);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    StepArena* previous_;
+  };
+
+  // Returns the arena of the innermost active scope on this thread or null.
+  static StepArena* Current();
+
+  StepArena() = default;
+
+  explicit StepArena(std::shared_ptr<cel::PlanAllocator> allocator)
+      : allocator_(std::move(allocator)) {}
+
+  ~StepArena();
+
+  StepArena(const StepArena&) = delete;
+  StepArena& operator=(const StepArena&) = delete;
+
+  // Returns storage for size bytes aligned to alignof(std::max_align_t).
+  void* Allocate(size_t size);
+
+  // Returns whether ptr points into storage owned by this arena.
+  bool Contains(const void* ptr) const;
+
+  // Total bytes reserved from the heap or the allocator, including unused
+  // block tails.
+  size_t SpaceAllocated() const { return space_allocated_; }
+
+  // Total bytes handed out by Allocate, including alignment padding.
+  size_t SpaceUsed() const { return space_used_; }
+
+ private:
+  struct Block {
+    char* data;
+    size_t size;
+  };
+
+  void AddBlock(size_t min_size);
+
+  // Kept alive until the blocks are returned to it.
+  std::shared_ptr<cel::PlanAllocator> allocator_;
+  std::vector<Block> blocks_;
+  // Offset of the next free byte in the last block.
+  size_t offset_ = 0;
+  size_t space_allocated_ = 0;
+  size_t space_used_ = 0;
+};
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_STEP_ARENA_H_
@@ -0,0 +1,138 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/step_arena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "common/native_type.h"
+#include "eval/eval/evaluator_core.h"
+#include "internal/testing.h"
+#include "runtime/plan_allocator.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using testing::Eq;
+using testing::Ge;
+using testing::IsNull;
+
+class CountingStep : public ExpressionStep {
+ public:
+  explicit CountingStep(int* destroyed) : destroyed_(destroyed) {}
+  ~CountingStep() override { ++*destroyed_; }
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    return absl::OkStatus();
+  }
+
+  int64_t id() const override { return 0; }
+
+  bool ComesFromAst() const override { return false; }
+
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId();
+  }
+
+ private:
+  int* destroyed_;
+};
+
+TEST(StepArenaTest, AllocatesAligned) {
+  StepArena arena;
+  EXPECT_THAT(arena.SpaceAllocated(), Eq(0));
+
+  void* a = arena.Allocate(3);
+  void* b = arena.Allocate(24);
+  EXPECT_THAT(reinterpret_cast<uintptr_t>(a) % alignof(std::max_align_t),
+              Eq(0));
+  EXPECT_THAT(reinterpret_cast<uintptr_t>(b) % alignof(std::max_align_t),
+              Eq(0));
+  EXPECT_TRUE(arena.Contains(a));
+  EXPECT_TRUE(arena.Contains(b));
+  EXPECT_THAT(arena.SpaceUsed(), Ge(27));
+  EXPECT_THAT(arena.SpaceAllocated(), Ge(arena.SpaceUsed()));
+
+  int on_stack = 0;
+  EXPECT_FALSE(arena.Contains(&on_stack));
+}
+
+TEST(StepArenaTest, GrowsForLargeAllocations) {
+  StepArena arena;
+  void* small = arena.Allocate(8);
+  void* large = arena.Allocate(64 * 1024);
+  EXPECT_TRUE(arena.Contains(small));
+  EXPECT_TRUE(arena.Contains(large));
+  EXPECT_TRUE(arena.Contains(static_cast<char*>(large) + 64 * 1024 - 1));
+  EXPECT_THAT(arena.SpaceAllocated(), Ge(64 * 1024 + 8));
+}
+
+TEST(StepArenaTest, ScopesNest) {
+  StepArena outer;
+  StepArena inner;
+  EXPECT_THAT(StepArena::Current(), IsNull());
+  {
+    StepArena::Scope outer_scope(&outer);
+    EXPECT_THAT(StepArena::Current(), Eq(&outer));
+    {
+      StepArena::Scope inner_scope(&inner);
+      EXPECT_THAT(StepArena::Current(), Eq(&inner));
+      StepArena::Scope heap_scope(nullptr);
+      EXPECT_THAT(StepArena::Current(), IsNull());
+    }
+    EXPECT_THAT(StepArena::Current(), Eq(&outer));
+  }
+  EXPECT_THAT(StepArena::Current(), IsNull());
+}
+
+TEST(StepArenaTest, StepsAllocatedFromCurrentArena) {
+  int destroyed = 0;
+  StepArena arena;
+  StepArena::Scope scope(&arena);
+
+  auto arena_step = std::make_unique<CountingStep>(&destroyed);
+  EXPECT_TRUE(arena.Contains(arena_step.get()));
+  arena_step.reset();
+  EXPECT_THAT(destroyed, Eq(1));
+
+  std::unique_ptr<CountingStep> heap_step;
+  {
+    StepArena::Scope heap_scope(nullptr);
+    heap_step = std::make_unique<CountingStep>(&destroyed);
+  }
+  EXPECT_FALSE(arena.Contains(heap_step.get()));
+  // Heap steps may be destroyed under any scope.
+  heap_step.reset();
+  EXPECT_THAT(destroyed, Eq(2));
+}
+
+TEST(StepArenaTest, BlocksFromPlanAllocator) {
+  auto allocator = std::make_shared<cel::HugePageAllocator>();
+  {
+    StepArena arena(allocator);
+    void* small = arena.Allocate(8);
+    void* large = arena.Allocate(1024 * 1024);
+    EXPECT_TRUE(arena.Contains(small));
+    EXPECT_TRUE(arena.Contains(large));
+    EXPECT_THAT(allocator->GetStats().allocated_bytes,
+                Eq(arena.SpaceAllocated()));
+  }
+  EXPECT_THAT(allocator->GetStats().allocated_bytes, Eq(0));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,190 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/eval/string_match_step.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/string_value.h"
+#include "eval/eval/evaluator_core.h"
+#include "eval/eval/expression_step_base.h"
+#include "re2/re2.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::cel::Handle;
+using ::cel::StringValue;
+using ::cel::Value;
+
+constexpr size_t kStringMatchArity = 2;
+
+bool IsRegexMetacharacter(char c) {
+  switch (c) {
+    case '\\':
+    case '.':
+    case '*':
+    case '+':
+    case '?':
+    case '|':
+    case '(':
+    case ')':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '^':
+    case '$':
+      return true;
+    default:
+      return false;
+  }
+}
+
+class StringMatchStep final : public ExpressionStepBase {
+ public:
+  StringMatchStep(StringMatchKind kind, std::string literal,
+                  std::unique_ptr<const ExpressionStep> function_step,
+                  int64_t expr_id)
+      : ExpressionStepBase(expr_id),
+        kind_(kind),
+        literal_(std::move(literal)),
+        function_step_(std::move(function_step)) {}
+
+  absl::Status Evaluate(ExecutionFrame* frame) const override {
+    if (!frame->value_stack().HasEnough(kStringMatchArity)) {
+      return absl::Status(absl::StatusCode::kInternal, "Value stack underflow");
+    }
+    auto args = frame->value_stack().GetSpan(kStringMatchArity);
+    if (!args[0]->Is<StringValue>() || !args[1]->Is<StringValue>()) {
+      return function_step_->Evaluate(frame);
+    }
+    bool result = MatchesLiteral(kind_, *args[0].As<StringValue>(), literal_);
+    frame->value_stack().Pop(kStringMatchArity);
+    frame->value_stack().Push(frame->value_factory().CreateBoolValue(result));
+    return absl::OkStatus();
+  }
+
+ private:
+  const StringMatchKind kind_;
+  const std::string literal_;
+  const std::unique_ptr<const ExpressionStep> function_step_;
+};
+
+}  // namespace
+
+absl::optional<StringMatchKind> GetStringMatchKind(absl::string_view function) {
+  if (function == cel::builtin::kStringStartsWith) {
+    return StringMatchKind::kStartsWith;
+  }
+  if (function == cel::builtin::kStringEndsWith) {
+    return StringMatchKind::kEndsWith;
+  }
+  if (function == cel::builtin::kStringContains) {
+    return StringMatchKind::kContains;
+  }
+  return absl::nullopt;
+}
+
+bool MatchesLiteral(StringMatchKind kind, const StringValue& subject,
+                    absl::string_view literal) {
+  switch (kind) {
+    case StringMatchKind::kStartsWith:
+      return subject.StartsWith(literal);
+    case StringMatchKind::kEndsWith:
+      return subject.EndsWith(literal);
+    case StringMatchKind::kContains:
+      return subject.Contains(literal);
+    case StringMatchKind::kEquals:
+      return subject.Equals(literal);
+  }
+  return false;
+}
+
+absl::optional<std::pair<StringMatchKind, std::string>> ReduceRegexToLiteral(
+    const RE2& re2) {
+  const RE2::Options& options = re2.options();
+  // Other options change what the anchors or the characters of the pattern
+  // match.
+  if (!re2.ok() || !options.case_sensitive() || options.never_nl() ||
+      options.encoding() != RE2::Options::EncodingUTF8 ||
+      (options.posix_syntax() && !options.one_line())) {
+    return absl::nullopt;
+  }
+  absl::string_view pattern = re2.pattern();
+  if (options.literal()) {
+    return std::make_pair(StringMatchKind::kContains, std::string(pattern));
+  }
+
+  bool anchored_start = false;
+  if (!pattern.empty() && pattern.front() == '^') {
+    anchored_start = true;
+    pattern.remove_prefix(1);
+  }
+  bool anchored_end = false;
+  std::string literal;
+  literal.reserve(pattern.size());
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    char c = pattern[i];
+    if (c == '$' && i + 1 == pattern.size()) {
+      anchored_end = true;
+      break;
+    }
+    if (c == '\\') {
+      // Only escaped punctuation stands for itself, e.g. `\.`, but not `\d`.
+      if (++i == pattern.size() ||
+          !absl::ascii_ispunct(static_cast<unsigned char>(pattern[i]))) {
+        return absl::nullopt;
+      }
+      literal.push_back(pattern[i]);
+      continue;
+    }
+    if (IsRegexMetacharacter(c)) {
+      return absl::nullopt;
+    }
+    literal.push_back(c);
+  }
+
+  StringMatchKind kind = StringMatchKind::kContains;
+  if (anchored_start && anchored_end) {
+    kind = StringMatchKind::kEquals;
+  } else if (anchored_start) {
+    kind = StringMatchKind::kStartsWith;
+  } else if (anchored_end) {
+    kind = StringMatchKind::kEndsWith;
+  }
+  return std::make_pair(kind, std::move(literal));
+}
+
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStringMatchStep(
+    StringMatchKind kind, std::string literal,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id) {
+  return std::make_unique<StringMatchStep>(kind, std::move(literal),
+                                           std::move(function_step), expr_id);
+}
+
+}  // namespace google::api::expr::runtime
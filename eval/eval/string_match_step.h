@@ -0,0 +1,72 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Execution steps comparing strings against a literal known when the
+// expression is planned, for calls to `startsWith`, `endsWith` and `contains`
+// with a constant argument and for regular expressions that reduce to a
+// literal.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_EVAL_STRING_MATCH_STEP_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_EVAL_STRING_MATCH_STEP_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/values/string_value.h"
+#include "eval/eval/evaluator_core.h"
+#include "re2/re2.h"
+
+namespace google::api::expr::runtime {
+
+enum class StringMatchKind {
+  kStartsWith,
+  kEndsWith,
+  kContains,
+  kEquals,
+};
+
+// Returns the comparison implemented by the standard string function
+// `function`, or nullopt if it is not `startsWith`, `endsWith` or `contains`.
+absl::optional<StringMatchKind> GetStringMatchKind(absl::string_view function);
+
+// Returns whether `subject` compares as `kind` with `literal`.
+bool MatchesLiteral(StringMatchKind kind, const cel::StringValue& subject,
+                    absl::string_view literal);
+
+// Returns the comparison equivalent to a partial match of `re2`, if its
+// pattern is a plain string optionally anchored by `^` and `$`. For example
+// `^foo` reduces to {kStartsWith, "foo"} and `a\.b` to {kContains, "a.b"}.
+absl::optional<std::pair<StringMatchKind, std::string>> ReduceRegexToLiteral(
+    const RE2& re2);
+
+// Factory method for a step replacing the eagerly bound function_step of a
+// call to `startsWith`, `endsWith` or `contains` whose argument is the
+// constant `literal`. The receiver and the argument are still expected on the
+// stack.
+//
+// String receivers are compared inline, without flattening cord backed
+// strings. Other calls, including calls with error or unknown arguments, are
+// passed on to function_step.
+absl::StatusOr<std::unique_ptr<ExpressionStep>> CreateStringMatchStep(
+    StringMatchKind kind, std::string literal,
+    std::unique_ptr<const ExpressionStep> function_step, int64_t expr_id);
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_EVAL_STRING_MATCH_STEP_H_
@@ -18,8 +18,8 @@ namespace google::api::expr::runtime {
 
 namespace {
 
-using ::cel::builtin::kTernary;
-using ::cel::runtime_internal::CreateNoMatchingOverloadError;
+using ::cel::runtime_internal::ControlFlowContext;
+using ::cel::runtime_internal::NoMatchingOverloadError;
 
 inline constexpr size_t kTernaryStepCondition = 0;
 inline constexpr size_t kTernaryStepTrue = 1;
@@ -62,7 +62,7 @@ absl::Status TernaryStep::Evaluate(ExecutionFrame* frame) const {
   cel::Handle<cel::Value> result;
   if (!condition->Is<cel::BoolValue>()) {
     result = frame->value_factory().CreateErrorValue(
-        CreateNoMatchingOverloadError(kTernary));
+        *NoMatchingOverloadError(ControlFlowContext::kTernary));
   } else if (condition.As<cel::BoolValue>()->NativeValue()) {
     result = args[kTernaryStepTrue];
   } else {
@@ -35,7 +35,10 @@ AdapterActivationImpl::FindVariable(ValueFactory& value_factory,
   // This implementation should only be used during interop, when we can
   // always assume the memory manager is backed by a protobuf arena.
   google::protobuf::Arena* arena =
-      extensions::ProtoMemoryManagerArena(value_factory.GetMemoryManager());
+      arena_ != nullptr
+          ? arena_
+          : extensions::ProtoMemoryManagerArena(
+                value_factory.GetMemoryManager());
 
   absl::optional<google::api::expr::runtime::CelValue> legacy_value =
       legacy_activation_.FindValue(name, arena);
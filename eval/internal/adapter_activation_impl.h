@@ -26,6 +26,7 @@
 #include "base/value.h"
 #include "base/value_factory.h"
 #include "eval/public/base_activation.h"
+#include "google/protobuf/arena.h"
 #include "runtime/activation_interface.h"
 #include "runtime/function_overload_reference.h"
 
@@ -40,6 +41,13 @@ class AdapterActivationImpl : public ActivationInterface {
       const google::api::expr::runtime::BaseActivation& legacy_activation)
       : legacy_activation_(legacy_activation) {}
 
+  // As above, for evaluations whose memory manager is backed by arena, which
+  // is then used for the legacy lookups without querying the value factory.
+  AdapterActivationImpl(
+      const google::api::expr::runtime::BaseActivation& legacy_activation,
+      google::protobuf::Arena* arena)
+      : legacy_activation_(legacy_activation), arena_(arena) {}
+
   absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
       ValueFactory& value_factory, absl::string_view name) const override;
 
@@ -50,8 +58,14 @@ class AdapterActivationImpl : public ActivationInterface {
 
   absl::Span<const cel::AttributePattern> GetMissingAttributes() const override;
 
+  FunctionResultStore* GetFunctionResultStore() const override {
+    return legacy_activation_.function_result_store();
+  }
+
  private:
   const google::api::expr::runtime::BaseActivation& legacy_activation_;
+  // Null if the arena is taken from the value factory of each lookup.
+  google::protobuf::Arena* const arena_ = nullptr;
 };
 
 }  // namespace cel::interop_internal
@@ -21,6 +21,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/attributes.h"
 #include "absl/base/nullability.h"
 #include "absl/status/status.h"
@@ -54,6 +55,7 @@
 #include "eval/internal/errors.h"
 #include "eval/public/cel_options.h"
 #include "eval/public/cel_value.h"
+#include "eval/public/containers/internal_field_backed_list_impl.h"
 #include "eval/public/message_wrapper.h"
 #include "eval/public/structs/legacy_type_adapter.h"
 #include "eval/public/structs/legacy_type_info_apis.h"
@@ -128,6 +130,19 @@ class LegacyAbstractStructValueBuilder final
         number, arg, value_factory_.GetMemoryManager(), builder_);
   }
 
+  absl::StatusOr<bool> SetFieldByHint(const void* hint,
+                                      const Handle<Value>& value) override {
+    if (hint == nullptr) {
+      return false;
+    }
+    CEL_ASSIGN_OR_RETURN(auto arg,
+                         ToLegacyValue(ProtoMemoryManagerArena(
+                                           value_factory_.GetMemoryManager()),
+                                       value, true));
+    return mutation_.SetFieldByHint(
+        hint, arg, value_factory_.GetMemoryManager(), builder_);
+  }
+
   absl::StatusOr<cel::Handle<cel::StructValue>> Build() && override {
     CEL_ASSIGN_OR_RETURN(auto legacy, mutation_.AdaptFromWellKnownType(
                                           value_factory_.GetMemoryManager(),
@@ -335,7 +350,8 @@ absl::StatusOr<Handle<Value>> LegacyStructGetFieldImpl(
 
 absl::StatusOr<QualifyResult> LegacyStructQualifyImpl(
     const MessageWrapper& wrapper, absl::Span<const cel::SelectQualifier> path,
-    bool presence_test, MemoryManagerRef memory_manager) {
+    bool presence_test, bool unbox_null_wrapper_types,
+    MemoryManagerRef memory_manager) {
   if (path.empty()) {
     return absl::InvalidArgumentError("invalid select qualifier path.");
   }
@@ -361,7 +377,11 @@ absl::StatusOr<QualifyResult> LegacyStructQualifyImpl(
 
   CEL_ASSIGN_OR_RETURN(
       LegacyTypeAccessApis::LegacyQualifyResult legacy_result,
-      access_api->Qualify(path, wrapper, presence_test, memory_manager));
+      access_api->Qualify(path, wrapper, presence_test,
+                          unbox_null_wrapper_types
+                              ? ProtoWrapperTypeOptions::kUnsetNull
+                              : ProtoWrapperTypeOptions::kUnsetProtoDefault,
+                          memory_manager));
 
   QualifyResult result;
   result.qualifier_count = legacy_result.qualifier_count;
@@ -401,7 +421,8 @@ LegacyAbstractStructType::FindFieldByName(TypeManager& type_manager,
                                ? StructType::MakeFieldId(maybe_field->number)
                                : StructType::MakeFieldId(maybe_field->name),
                            maybe_field->name, maybe_field->number,
-                           type_manager.type_factory().GetDynType());
+                           type_manager.type_factory().GetDynType(),
+                           maybe_field->hint);
 }
 
 absl::StatusOr<absl::optional<StructType::Field>>
@@ -634,8 +655,36 @@ struct StringValueToLegacyVisitor final {
   }
 };
 
+ABSL_CONST_INIT thread_local InteropCache* current_interop_cache = nullptr;
+
+// Returns the legacy wrapper of a modern list or map, reusing the wrapper
+// created earlier in the evaluation if there is one.
+template <typename F>
+CelValue WrapForLegacy(google::protobuf::Arena* arena, const Handle<Value>& value,
+                       F wrap) {
+  InteropCache* cache = current_interop_cache;
+  if (cache == nullptr || cache->arena() != arena) {
+    return wrap();
+  }
+  if (const CelValue* cached = cache->Find(&*value); cached != nullptr) {
+    return *cached;
+  }
+  CelValue legacy_value = wrap();
+  cache->Insert(&*value, legacy_value);
+  return legacy_value;
+}
+
 }  // namespace
 
+InteropCache::Scope::Scope(InteropCache* cache)
+    : previous_(current_interop_cache) {
+  current_interop_cache = cache;
+}
+
+InteropCache::Scope::~Scope() { current_interop_cache = previous_; }
+
+InteropCache* InteropCache::Current() { return current_interop_cache; }
+
 struct ErrorValueAccess final {
   static const absl::Status* value_ptr(const ErrorValue& value) {
     return value.value_ptr_;
@@ -709,8 +758,10 @@ absl::StatusOr<CelValue> ToLegacyValue(google::protobuf::Arena* arena,
         return CelValue::CreateList(reinterpret_cast<const CelList*>(
             value.As<base_internal::LegacyListValue>()->value()));
       }
-      return CelValue::CreateList(google::protobuf::Arena::Create<LegacyCelList>(
-          arena, value.As<ListValue>(), arena));
+      return WrapForLegacy(arena, value, [&]() {
+        return CelValue::CreateList(google::protobuf::Arena::Create<LegacyCelList>(
+            arena, value.As<ListValue>(), arena));
+      });
     }
     case ValueKind::kMap: {
       if (value->Is<base_internal::LegacyMapValue>()) {
@@ -718,8 +769,10 @@ absl::StatusOr<CelValue> ToLegacyValue(google::protobuf::Arena* arena,
         return CelValue::CreateMap(reinterpret_cast<const CelMap*>(
             value.As<base_internal::LegacyMapValue>()->value()));
       }
-      return CelValue::CreateMap(google::protobuf::Arena::Create<LegacyCelMap>(
-          arena, value.As<MapValue>(), arena));
+      return WrapForLegacy(arena, value, [&]() {
+        return CelValue::CreateMap(google::protobuf::Arena::Create<LegacyCelMap>(
+            arena, value.As<MapValue>(), arena));
+      });
     }
     case ValueKind::kStruct: {
       if (value->Is<base_internal::LegacyStructValue>()) {
@@ -861,6 +914,7 @@ namespace cel::base_internal {
 
 namespace {
 
+using ::cel::interop_internal::CelListAccess;
 using ::cel::interop_internal::FromLegacyValue;
 using ::cel::interop_internal::LegacyStructValueAccess;
 using ::cel::interop_internal::MessageWrapperAccess;
@@ -871,6 +925,32 @@ using ::google::api::expr::runtime::CelValue;
 using MessageWrapper = ::google::api::expr::runtime::CelValue::MessageWrapper;
 using ::google::api::expr::runtime::LegacyTypeAccessApis;
 using ::google::api::expr::runtime::LegacyTypeInfoApis;
+using ::google::api::expr::runtime::internal::FieldBackedListImpl;
+
+// Membership test for lists backed by repeated int64 or string fields, which
+// scans the field storage without creating a CelValue per element. Returns
+// absl::nullopt if the list is not such a list or `value` is not of the
+// element type.
+absl::optional<bool> FieldBackedListContains(const CelList& list,
+                                             const CelValue& value) {
+  if (CelListAccess::TypeId(list) != NativeTypeId::For<FieldBackedListImpl>()) {
+    return absl::nullopt;
+  }
+  const auto& field_list = static_cast<const FieldBackedListImpl&>(list);
+  if (auto values = field_list.int64_values();
+      values.has_value() && value.IsInt64()) {
+    return absl::c_linear_search(*values, value.Int64OrDie());
+  }
+  if (const auto* values = field_list.string_values();
+      values != nullptr && value.IsString()) {
+    return absl::c_linear_search(*values, value.StringOrDie().value());
+  }
+  if (const auto* values = field_list.bytes_values();
+      values != nullptr && value.IsBytes()) {
+    return absl::c_linear_search(*values, value.BytesOrDie().value());
+  }
+  return absl::nullopt;
+}
 
 }  // namespace
 
@@ -978,13 +1058,65 @@ absl::StatusOr<Handle<Value>> MessageValueGetFieldByName(
       value_factory.GetMemoryManager());
 }
 
+const void* MessageValueFindFieldHint(uintptr_t msg, uintptr_t type_info,
+                                      absl::string_view name) {
+  auto wrapper = MessageWrapperAccess::Make(msg, type_info);
+  const LegacyTypeAccessApis* access_api =
+      wrapper.legacy_type_info()->GetAccessApis(wrapper);
+  if (access_api == nullptr) {
+    return nullptr;
+  }
+  return access_api->FindFieldHint(name, wrapper);
+}
+
+absl::StatusOr<absl::optional<Handle<Value>>> MessageValueGetFieldByHint(
+    uintptr_t msg, uintptr_t type_info, ValueFactory& value_factory,
+    const void* hint, bool unbox_null_wrapper_types) {
+  auto wrapper = MessageWrapperAccess::Make(msg, type_info);
+  const LegacyTypeAccessApis* access_api =
+      wrapper.legacy_type_info()->GetAccessApis(wrapper);
+  if (access_api == nullptr) {
+    return absl::nullopt;
+  }
+  CEL_ASSIGN_OR_RETURN(
+      auto legacy_value,
+      access_api->GetFieldByHint(
+          hint, wrapper,
+          unbox_null_wrapper_types
+              ? ProtoWrapperTypeOptions::kUnsetNull
+              : ProtoWrapperTypeOptions::kUnsetProtoDefault,
+          value_factory.GetMemoryManager()));
+  if (!legacy_value.has_value()) {
+    return absl::nullopt;
+  }
+  CEL_ASSIGN_OR_RETURN(
+      auto value,
+      FromLegacyValue(extensions::ProtoMemoryManagerArena(
+                          value_factory.GetMemoryManager()),
+                      *legacy_value));
+  return value;
+}
+
+absl::StatusOr<absl::optional<bool>> MessageValueHasFieldByHint(
+    uintptr_t msg, uintptr_t type_info, const void* hint) {
+  auto wrapper = MessageWrapperAccess::Make(msg, type_info);
+  const LegacyTypeAccessApis* access_api =
+      wrapper.legacy_type_info()->GetAccessApis(wrapper);
+  if (access_api == nullptr) {
+    return absl::nullopt;
+  }
+  return access_api->HasFieldByHint(hint, wrapper);
+}
+
 absl::StatusOr<QualifyResult> MessageValueQualify(
     uintptr_t msg, uintptr_t type_info, ValueFactory& value_factory,
-    absl::Span<const SelectQualifier> qualifiers, bool presence_test) {
+    absl::Span<const SelectQualifier> qualifiers, bool presence_test,
+    bool unbox_null_wrapper_types) {
   auto wrapper = MessageWrapperAccess::Make(msg, type_info);
 
   return interop_internal::LegacyStructQualifyImpl(
-      wrapper, qualifiers, presence_test, value_factory.GetMemoryManager());
+      wrapper, qualifiers, presence_test, unbox_null_wrapper_types,
+      value_factory.GetMemoryManager());
 }
 
 absl::StatusOr<Handle<Value>> LegacyListValueGet(uintptr_t impl,
@@ -1006,6 +1138,11 @@ absl::StatusOr<Handle<Value>> LegacyListValueContains(
   CEL_ASSIGN_OR_RETURN(auto legacy_value, ToLegacyValue(arena, other));
   const auto* list = reinterpret_cast<const CelList*>(impl);
 
+  if (absl::optional<bool> found = FieldBackedListContains(*list, legacy_value);
+      found.has_value()) {
+    return value_factory.CreateBoolValue(*found);
+  }
+
   for (int i = 0; i < list->size(); i++) {
     CelValue element = list->Get(arena, i);
     absl::optional<bool> equal =
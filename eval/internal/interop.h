@@ -22,6 +22,7 @@
 
 #include "google/protobuf/arena.h"
 #include "absl/base/nullability.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/die_if_null.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -150,6 +151,62 @@ absl::StatusOr<Handle<Value>> FromLegacyValue(
 absl::StatusOr<google::api::expr::runtime::CelValue> ToLegacyValue(
     google::protobuf::Arena* arena, const Handle<Value>& value, bool unchecked = false);
 
+// Identity cache of the legacy wrappers created by ToLegacyValue for modern
+// lists and maps during a single evaluation. Without it, each time the same
+// list or map crosses into the legacy API, e.g. as the argument of a
+// CelFunction called in a comprehension, a new wrapper is allocated.
+//
+// A cache is bound to the arena of the evaluation and installed for the
+// current thread by an InteropCache::Scope. Lists, maps and messages which are
+// already legacy backed are converted without allocating and never cached.
+// Wrappers keep their list or map alive until the arena is destroyed, so the
+// address of a cached value is not reused while the cache is in scope.
+class InteropCache final {
+ public:
+  // Makes cache the cache used by ToLegacyValue on the current thread for the
+  // lifetime of the scope. Scopes nest.
+  class Scope final {
+   public:
+    explicit Scope(InteropCache* cache);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    InteropCache* previous_;
+  };
+
+  // Returns the cache of the innermost active scope on this thread or null.
+  static InteropCache* Current();
+
+  explicit InteropCache(google::protobuf::Arena* arena) : arena_(arena) {}
+
+  InteropCache(const InteropCache&) = delete;
+  InteropCache& operator=(const InteropCache&) = delete;
+
+  google::protobuf::Arena* arena() const { return arena_; }
+
+  // Returns the legacy value previously created for the modern value at
+  // address, or nullptr.
+  const google::api::expr::runtime::CelValue* Find(const Value* value) const {
+    auto it = wrappers_.find(value);
+    return it != wrappers_.end() ? &it->second : nullptr;
+  }
+
+  void Insert(const Value* value,
+              const google::api::expr::runtime::CelValue& legacy_value) {
+    wrappers_.insert_or_assign(value, legacy_value);
+  }
+
+  size_t size() const { return wrappers_.size(); }
+
+ private:
+  google::protobuf::Arena* const arena_;
+  absl::flat_hash_map<const Value*, google::api::expr::runtime::CelValue>
+      wrappers_;
+};
+
 Handle<NullValue> CreateNullValue();
 
 Handle<BoolValue> CreateBoolValue(bool value);
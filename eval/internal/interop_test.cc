@@ -24,6 +24,7 @@
 #include "google/protobuf/empty.pb.h"
 #include "absl/status/status.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
 #include "base/memory.h"
 #include "base/testing/value_matchers.h"
@@ -38,6 +39,7 @@
 #include "eval/public/cel_value.h"
 #include "eval/public/containers/container_backed_list_impl.h"
 #include "eval/public/containers/container_backed_map_impl.h"
+#include "eval/public/containers/field_backed_list_impl.h"
 #include "eval/public/message_wrapper.h"
 #include "eval/public/structs/cel_proto_wrapper.h"
 #include "eval/public/structs/legacy_type_info_apis.h"
@@ -57,6 +59,7 @@ using ::cel_testing::ValueOf;
 using ::google::api::expr::runtime::CelProtoWrapper;
 using ::google::api::expr::runtime::CelValue;
 using ::google::api::expr::runtime::ContainerBackedListImpl;
+using ::google::api::expr::runtime::FieldBackedListImpl;
 using ::google::api::expr::runtime::LegacyTypeInfoApis;
 using ::google::api::expr::runtime::MessageWrapper;
 using ::google::api::expr::runtime::TestMessage;
@@ -430,6 +433,52 @@ TEST(ValueInterop, ListFromLegacy) {
   EXPECT_EQ(element.As<IntValue>()->NativeValue(), 0);
 }
 
+TEST(ValueInterop, FieldBackedListContains) {
+  google::protobuf::Arena arena;
+  auto memory_manager = ProtoMemoryManagerRef(&arena);
+  TypeFactory type_factory(memory_manager);
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  TestMessage message;
+  message.add_int64_list(1);
+  message.add_int64_list(2);
+  message.add_string_list("foo");
+  auto field_list = [&](absl::string_view name) {
+    return CelValue::CreateList(
+        google::protobuf::Arena::Create<FieldBackedListImpl>(
+            &arena, &message,
+            TestMessage::descriptor()->FindFieldByName(std::string(name)),
+            &arena));
+  };
+  auto is_bool = [](bool expected) {
+    return Truly([expected](const Handle<Value>& value) {
+      return value->Is<BoolValue>() &&
+             value->As<BoolValue>().NativeValue() == expected;
+    });
+  };
+
+  ASSERT_OK_AND_ASSIGN(auto int64_list,
+                       FromLegacyValue(&arena, field_list("int64_list")));
+  const auto& ints = int64_list->As<ListValue>();
+  EXPECT_THAT(ints.Contains(value_factory, value_factory.CreateIntValue(2)),
+              IsOkAndHolds(is_bool(true)));
+  EXPECT_THAT(ints.Contains(value_factory, value_factory.CreateIntValue(3)),
+              IsOkAndHolds(is_bool(false)));
+  // Other numeric types use heterogeneous equality.
+  EXPECT_THAT(ints.Contains(value_factory, value_factory.CreateUintValue(2)),
+              IsOkAndHolds(is_bool(true)));
+
+  ASSERT_OK_AND_ASSIGN(auto string_list,
+                       FromLegacyValue(&arena, field_list("string_list")));
+  const auto& strings = string_list->As<ListValue>();
+  ASSERT_OK_AND_ASSIGN(auto foo, value_factory.CreateStringValue("foo"));
+  ASSERT_OK_AND_ASSIGN(auto bar, value_factory.CreateStringValue("bar"));
+  EXPECT_THAT(strings.Contains(value_factory, foo),
+              IsOkAndHolds(is_bool(true)));
+  EXPECT_THAT(strings.Contains(value_factory, bar),
+              IsOkAndHolds(is_bool(false)));
+}
+
 class TestListValue final : public CEL_LIST_VALUE_CLASS {
  public:
   explicit TestListValue(const Handle<ListType>& type,
@@ -496,6 +545,44 @@ TEST(ValueInterop, ModernListRoundtrip) {
   EXPECT_EQ(&*value, &*modern_value);
 }
 
+TEST(ValueInterop, InteropCacheReusesWrappers) {
+  google::protobuf::Arena arena;
+  auto memory_manager = ProtoMemoryManagerRef(&arena);
+  TypeFactory type_factory(memory_manager);
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  ASSERT_OK_AND_ASSIGN(auto type,
+                       value_factory.type_factory().CreateListType(
+                           value_factory.type_factory().GetIntType()));
+  ASSERT_OK_AND_ASSIGN(auto value, value_factory.CreateListValue<TestListValue>(
+                                       type, std::vector<int64_t>{0}));
+  ASSERT_OK_AND_ASSIGN(auto other, value_factory.CreateListValue<TestListValue>(
+                                       type, std::vector<int64_t>{1}));
+
+  ASSERT_OK_AND_ASSIGN(auto first, ToLegacyValue(&arena, value));
+  ASSERT_OK_AND_ASSIGN(auto second, ToLegacyValue(&arena, value));
+  EXPECT_NE(first.ListOrDie(), second.ListOrDie());
+
+  InteropCache cache(&arena);
+  {
+    InteropCache::Scope scope(&cache);
+    EXPECT_EQ(InteropCache::Current(), &cache);
+    ASSERT_OK_AND_ASSIGN(first, ToLegacyValue(&arena, value));
+    ASSERT_OK_AND_ASSIGN(second, ToLegacyValue(&arena, value));
+    EXPECT_EQ(first.ListOrDie(), second.ListOrDie());
+    ASSERT_OK_AND_ASSIGN(second, ToLegacyValue(&arena, other));
+    EXPECT_NE(first.ListOrDie(), second.ListOrDie());
+    EXPECT_EQ(cache.size(), 2);
+
+    // Wrappers for other arenas are not cached.
+    google::protobuf::Arena other_arena;
+    ASSERT_OK_AND_ASSIGN(second, ToLegacyValue(&other_arena, value));
+    EXPECT_NE(first.ListOrDie(), second.ListOrDie());
+    EXPECT_EQ(cache.size(), 2);
+  }
+  EXPECT_EQ(InteropCache::Current(), nullptr);
+}
+
 TEST(ValueInterop, LegacyListRoundtrip) {
   google::protobuf::Arena arena;
   auto memory_manager = ProtoMemoryManagerRef(&arena);
@@ -92,6 +92,17 @@ class Activation : public BaseActivation {
     return unknown_attribute_patterns_;
   }
 
+  // Sets the store that results of function calls are read from and recorded
+  // in, when unknown function results are enabled. store must outlive
+  // evaluations using the activation.
+  void set_function_result_store(cel::FunctionResultStore* store) {
+    function_result_store_ = store;
+  }
+
+  cel::FunctionResultStore* function_result_store() const override {
+    return function_result_store_;
+  }
+
  private:
   class ValueEntry {
    public:
@@ -132,6 +143,7 @@ class Activation : public BaseActivation {
 
   std::vector<CelAttributePattern> missing_attribute_patterns_;
   std::vector<CelAttributePattern> unknown_attribute_patterns_;
+  cel::FunctionResultStore* function_result_store_ = nullptr;
 };
 
 }  // namespace google::api::expr::runtime
@@ -1,6 +1,16 @@
 #include "eval/public/activation_bind_helper.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 #include "eval/public/containers/field_access.h"
 #include "eval/public/containers/field_backed_list_impl.h"
 #include "eval/public/containers/field_backed_map_impl.h"
@@ -33,6 +43,33 @@ absl::Status CreateValueFromField(const google::protobuf::Message* msg,
   }
 }
 
+using FieldTable =
+    absl::flat_hash_map<absl::string_view, const FieldDescriptor*>;
+
+// Returns the field table of a generated message type. Generated descriptors
+// are never destroyed, so tables are kept for the lifetime of the process.
+const FieldTable* GetGeneratedFieldTable(const Descriptor* descriptor) {
+  static absl::Mutex* mutex = new absl::Mutex();
+  static auto* tables =
+      new absl::flat_hash_map<const Descriptor*, std::unique_ptr<FieldTable>>();
+  {
+    absl::ReaderMutexLock lock(mutex);
+    auto it = tables->find(descriptor);
+    if (it != tables->end()) {
+      return it->second.get();
+    }
+  }
+  auto table = std::make_unique<FieldTable>();
+  table->reserve(descriptor->field_count());
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field_desc = descriptor->field(i);
+    table->insert({field_desc->name(), field_desc});
+  }
+  absl::MutexLock lock(mutex);
+  return tables->try_emplace(descriptor, std::move(table))
+      .first->second.get();
+}
+
 }  // namespace
 
 absl::Status BindProtoToActivation(const Message* message, Arena* arena,
@@ -70,6 +107,45 @@ absl::Status BindProtoToActivation(const Message* message, Arena* arena,
   return absl::OkStatus();
 }
 
+ProtoMessageActivation::ProtoMessageActivation(const Message* message,
+                                               ProtoUnsetFieldOptions options)
+    : message_(message), options_(options), fields_(nullptr) {
+  const Descriptor* desc = message->GetDescriptor();
+  if (desc->file()->pool() == google::protobuf::DescriptorPool::generated_pool()) {
+    fields_ = GetGeneratedFieldTable(desc);
+  }
+}
+
+const FieldDescriptor* ProtoMessageActivation::FindField(
+    absl::string_view name) const {
+  if (fields_ != nullptr) {
+    auto it = fields_->find(name);
+    return it == fields_->end() ? nullptr : it->second;
+  }
+  return message_->GetDescriptor()->FindFieldByName(std::string(name));
+}
+
+absl::optional<CelValue> ProtoMessageActivation::FindValue(
+    absl::string_view name, Arena* arena) const {
+  const FieldDescriptor* field_desc = FindField(name);
+  if (field_desc == nullptr) {
+    return absl::nullopt;
+  }
+
+  if (options_ == ProtoUnsetFieldOptions::kSkip &&
+      !field_desc->is_repeated() &&
+      !message_->GetReflection()->HasField(*message_, field_desc)) {
+    return absl::nullopt;
+  }
+
+  CelValue value;
+  auto status = CreateValueFromField(message_, field_desc, arena, &value);
+  if (!status.ok()) {
+    return CreateErrorValue(arena, status);
+  }
+  return value;
+}
+
 }  // namespace runtime
 }  // namespace expr
 }  // namespace api
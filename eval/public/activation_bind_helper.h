@@ -1,7 +1,18 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_ACTIVATION_BIND_HELPER_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_ACTIVATION_BIND_HELPER_H_
 
+#include <vector>
+
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "eval/public/activation.h"
+#include "eval/public/base_activation.h"
+#include "eval/public/cel_function.h"
+#include "eval/public/cel_value.h"
 
 namespace google {
 namespace api {
@@ -52,6 +63,41 @@ absl::Status BindProtoToActivation(
     Activation* activation,
     ProtoUnsetFieldOptions options = ProtoUnsetFieldOptions::kSkip);
 
+// Activation which interprets a protobuf Message as a namespace, as
+// BindProtoToActivation does, but creates the value of a field only when the
+// field is looked up. Evaluating an expression that refers to a few fields of
+// a wide message does not pay for the others.
+//
+// Field names are resolved through a table cached per message type for
+// generated messages, and through the descriptor otherwise. The activation
+// provides no functions or attribute patterns.
+//
+// |message| must outlive the activation, and must not be modified while it
+// is used for evaluation. The arena passed to FindValue must not be null.
+class ProtoMessageActivation : public BaseActivation {
+ public:
+  explicit ProtoMessageActivation(
+      const google::protobuf::Message* message,
+      ProtoUnsetFieldOptions options = ProtoUnsetFieldOptions::kSkip);
+
+  std::vector<const CelFunction*> FindFunctionOverloads(
+      absl::string_view name) const override {
+    return {};
+  }
+
+  absl::optional<CelValue> FindValue(absl::string_view name,
+                                     google::protobuf::Arena* arena) const override;
+
+ private:
+  const google::protobuf::FieldDescriptor* FindField(absl::string_view name) const;
+
+  const google::protobuf::Message* message_;
+  ProtoUnsetFieldOptions options_;
+  // Only set for generated messages.
+  const absl::flat_hash_map<absl::string_view,
+                            const google::protobuf::FieldDescriptor*>* fields_;
+};
+
 }  // namespace runtime
 }  // namespace expr
 }  // namespace api
@@ -138,6 +138,73 @@ TEST(ActivationBindHelperTest, RejectsNullArena) {
                 "arena must not be null for BindProtoToActivation."));
 }
 
+TEST(ProtoMessageActivationTest, FindsFields) {
+  TestMessage message;
+  message.set_int32_value(42);
+  message.add_string_list("a");
+
+  google::protobuf::Arena arena;
+
+  ProtoMessageActivation activation(&message);
+
+  auto result = activation.FindValue("int32_value", &arena);
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->IsInt64());
+  EXPECT_EQ(result->Int64OrDie(), 42);
+
+  result = activation.FindValue("string_list", &arena);
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->IsList());
+  EXPECT_EQ(result->ListOrDie()->size(), 1);
+
+  EXPECT_FALSE(activation.FindValue("no_such_field", &arena).has_value());
+}
+
+TEST(ProtoMessageActivationTest, SkipUnsetFields) {
+  TestMessage message;
+
+  google::protobuf::Arena arena;
+
+  ProtoMessageActivation activation(&message);
+
+  EXPECT_FALSE(activation.FindValue("int32_value", &arena).has_value());
+  EXPECT_FALSE(activation.FindValue("message_value", &arena).has_value());
+
+  // Unset repeated fields are bound to empty lists.
+  auto result = activation.FindValue("int32_list", &arena);
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->IsList());
+  EXPECT_EQ(result->ListOrDie()->size(), 0);
+}
+
+TEST(ProtoMessageActivationTest, BindDefaultFields) {
+  TestMessage message;
+
+  google::protobuf::Arena arena;
+
+  ProtoMessageActivation activation(&message,
+                                    ProtoUnsetFieldOptions::kBindDefault);
+
+  auto result = activation.FindValue("int32_value", &arena);
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->IsInt64());
+  EXPECT_EQ(result->Int64OrDie(), 0);
+}
+
+TEST(ProtoMessageActivationTest, ReflectsMessageAtLookup) {
+  TestMessage message;
+
+  google::protobuf::Arena arena;
+
+  ProtoMessageActivation activation(&message);
+  message.set_bool_value(true);
+
+  auto result = activation.FindValue("bool_value", &arena);
+  ASSERT_TRUE(result.has_value());
+  ASSERT_TRUE(result->IsBool());
+  EXPECT_TRUE(result->BoolOrDie());
+}
+
 }  // namespace
 
 }  // namespace runtime
@@ -33,6 +33,14 @@ class AstVisitorBase : public AstVisitor {
 
   ~AstVisitorBase() override {}
 
+  // Expr node handler method. Called for all Expr nodes.
+  // Is invoked before child Expr nodes being processed.
+  void PreVisitExpr(const Expr*, const SourcePosition*) override {}
+
+  // Expr node handler method. Called for all Expr nodes.
+  // Is invoked after child Expr nodes are processed.
+  void PostVisitExpr(const Expr*, const SourcePosition*) override {}
+
   // Const node handler.
   // Invoked after child nodes are processed.
   void PostVisitConst(const Constant*, const Expr*,
@@ -43,6 +51,11 @@ class AstVisitorBase : public AstVisitor {
   void PostVisitIdent(const Ident*, const Expr*,
                       const SourcePosition*) override {}
 
+  // Select node handler
+  // Invoked before child nodes are processed.
+  void PreVisitSelect(const Select*, const Expr*,
+                      const SourcePosition*) override {}
+
   // Select node handler
   // Invoked after child nodes are processed.
   void PostVisitSelect(const Select*, const Expr*,
@@ -10,6 +10,10 @@
 #include "eval/public/cel_function.h"
 #include "eval/public/cel_value.h"
 
+namespace cel {
+class FunctionResultStore;
+}  // namespace cel
+
 namespace google::api::expr::runtime {
 
 // Base class for an activation.
@@ -53,6 +57,12 @@ class BaseActivation {
     return *empty;
   }
 
+  // Return the store of function results carried between the phases of a
+  // multi-phase evaluation, or nullptr. See cel::FunctionResultStore.
+  virtual cel::FunctionResultStore* function_result_store() const {
+    return nullptr;
+  }
+
   virtual ~BaseActivation() = default;
 };
 
@@ -1,8 +1,8 @@
 #include "eval/public/cel_function.h"
 
 #include <cstddef>
-#include <vector>
 
+#include "absl/container/inlined_vector.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
 #include "base/function.h"
@@ -62,7 +62,7 @@ absl::StatusOr<Handle<Value>> CelFunction::Invoke(
     absl::Span<const Handle<Value>> arguments) const {
   google::protobuf::Arena* arena =
       ProtoMemoryManagerArena(context.value_factory().GetMemoryManager());
-  std::vector<CelValue> legacy_args;
+  absl::InlinedVector<CelValue, 4> legacy_args;
   legacy_args.reserve(arguments.size());
 
   // Users shouldn't be able to create expressions that call registered
@@ -37,7 +37,36 @@ cel::RuntimeOptions ConvertToRuntimeOptions(const InterpreterOptions& options) {
                              options.enable_qualified_type_identifiers,
                              options.enable_heterogeneous_equality,
                              options.enable_empty_wrapper_null_unboxing,
-                             options.enable_lazy_bind_initialization};
+                             options.enable_lazy_bind_initialization,
+                             options.enable_compact_dispatch,
+                             options.enable_register_operands,
+                             options.enable_fused_selects,
+                             options.max_evaluation_steps,
+                             options.evaluation_deadline,
+                             options.evaluation_budget_check_interval,
+                             options.enable_step_arena,
+                             options.enable_logical_chains,
+                             options.enable_specialized_comprehensions,
+                             options.parallel_comprehension_threads,
+                             options.parallel_comprehension_min_size,
+                             options.enable_verified_comprehension_list_append,
+                             options.trace_sample_interval,
+                             options.trace_expr_ids,
+                             options.function_result_cache,
+                             options.enable_common_subexpression_elimination,
+                             options.enable_standard_operator_steps,
+                             options.constant_pool,
+                             options.enable_constant_literal_hoisting,
+                             options.unknown_attribute_roots,
+                             options.enable_algebraic_simplification,
+                             options.max_evaluation_cost,
+                             options.declared_variables,
+                             options.enable_comprehension_fusion,
+                             options.enable_shared_regex_pool,
+                             options.metrics_sink,
+                             options.enable_numa_replication,
+                             options.enable_selective_short_circuiting,
+                             options.plan_allocator};
 }
 
 }  // namespace google::api::expr::runtime
@@ -17,7 +17,14 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CEL_OPTIONS_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CEL_OPTIONS_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "absl/base/attributes.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "runtime/runtime_options.h"
 #include "google/protobuf/arena.h"
 
@@ -64,7 +71,8 @@ struct InterpreterOptions {
   int comprehension_max_iterations = 10000;
 
   // Enable list append within comprehensions. Note, this option is not safe
-  // with hand-rolled ASTs.
+  // with hand-rolled ASTs. See enable_verified_comprehension_list_append for
+  // a safe alternative.
   bool enable_comprehension_list_append = false;
 
   // Enable RE2 match() overload.
@@ -132,7 +140,9 @@ struct InterpreterOptions {
   // Enabling this option causes constant regular expressions to be compiled
   // ahead-of-time and re-used for each invocation to `matches`. A side effect
   // of this is that invalid regular expressions will result in errors when
-  // building an expression.
+  // building an expression. Disjunctions of `matches` calls on the same
+  // subject with constant patterns, and `exists` over a list of constant
+  // patterns, are matched with a single RE2::Set, scanning the subject once.
   //
   // It is recommended that this option be enabled in conjunction with
   // enable_constant_folding.
@@ -146,17 +156,14 @@ struct InterpreterOptions {
   // Enable select optimization, replacing long select chains with a single
   // operation.
   //
-  // This assumes that the type information at check time agrees with the
-  // configured types at runtime.
+  // Chains of field selections, constant map keys and constant list indexes
+  // rooted on a message are traversed in one step. Requires a checked
+  // expression: the type information at check time is assumed to agree with
+  // the configured types at runtime.
   //
   // Important: The select optimization follows spec behavior for traversals.
-  //  - `enable_empty_wrapper_null_unboxing` is ignored and optimized traversals
-  //    always operates as though it is `true`.
   //  - `enable_heterogeneous_equality` is ignored and optimized traversals
   //    always operate as though it is `true`.
-  //
-  // Note: implementation in progress -- please consult the CEL team before
-  // enabling in an existing environment.
   bool enable_select_optimization = false;
 
   // Enable lazy cel.bind alias initialization.
@@ -170,6 +177,228 @@ struct InterpreterOptions {
   // for consistent behavior for CEL compiler optimized expressions that extract
   // subexpressions to cel.bind calls.
   bool enable_lazy_bind_initialization = true;
+
+  // Enable the compact dispatch loop.
+  //
+  // When enabled, the planner additionally encodes the program as a contiguous
+  // array of tagged opcodes. Constants and jumps are executed inline by the
+  // evaluator, other steps are dispatched through the ExpressionStep
+  // interface.
+  bool enable_compact_dispatch = false;
+
+  // Enable register operands for function calls.
+  //
+  // When enabled, eagerly bound function calls whose arguments are all
+  // constants or comprehension variables read their arguments in place
+  // instead of through the value stack. Has no effect when unknown processing
+  // or missing attribute errors are enabled.
+  bool enable_register_operands = false;
+
+  // Enable fused select steps.
+  //
+  // When enabled, chains of field selections, and comparisons of a selected
+  // value against a constant or constant list, are planned as single steps
+  // that don't push intermediate values. Has no effect when unknown processing
+  // or missing attribute errors are enabled.
+  bool enable_fused_selects = false;
+
+  // Maximum number of execution steps for a single evaluation. Zero means
+  // unlimited.
+  //
+  // Exceeding the budget fails the evaluation with a kResourceExhausted
+  // status. Unlike comprehension_max_iterations, this bounds the total work
+  // done by the expression.
+  int64_t max_evaluation_steps = 0;
+
+  // Maximum duration of a single evaluation, measured on a monotonic clock
+  // from the start of the evaluation. Infinite means no deadline.
+  //
+  // Exceeding the deadline fails the evaluation with a kDeadlineExceeded
+  // status.
+  absl::Duration evaluation_deadline = absl::InfiniteDuration();
+
+  // Number of execution steps between checks of max_evaluation_steps and
+  // evaluation_deadline. Larger values make the checks cheaper but less
+  // precise for the deadline. The step budget is always enforced exactly.
+  int evaluation_budget_check_interval = 64;
+
+  // Allocate the steps of each planned expression from a per-expression
+  // arena.
+  //
+  // Steps are laid out contiguously in planning order and released together
+  // with the expression, which reduces the per-expression memory overhead and
+  // improves locality during evaluation.
+  bool enable_step_arena = false;
+
+  // Plan chains of "&&" or "||" calls as a single n-ary operation.
+  //
+  // Each operand is merged into the result as it is evaluated, and with
+  // short-circuiting enabled the first short-circuiting operand exits the
+  // whole chain. Errors are reported in operand order, independent of how the
+  // chain is nested.
+  bool enable_logical_chains = false;
+
+  // Plan comprehensions with the shape generated by the standard all, exists,
+  // exists_one, map and filter macros as dedicated loops.
+  //
+  // The loop body is reduced to the predicate or transform of the macro, the
+  // accumulator is updated natively, all and exists stop at the first
+  // deciding element, and map and filter build the result list in place.
+  // Only applies when short_circuiting is enabled.
+  bool enable_specialized_comprehensions = false;
+
+  // Number of threads used to evaluate a specialized comprehension (see
+  // enable_specialized_comprehensions) over a large list. 0 or 1 keeps
+  // evaluation sequential.
+  //
+  // Only applies to loops whose body references no variable other than the
+  // iteration variable, creates no messages or nested comprehensions and only
+  // calls standard functions. Functions registered under the standard names
+  // must be thread-safe. Results are merged in list order, so errors and
+  // unknowns are the same as for sequential evaluation. Loops are evaluated
+  // sequentially when a step budget, deadline or listener is in use, or when
+  // the memory manager is not thread-safe.
+  int parallel_comprehension_threads = 0;
+
+  // Minimum number of list elements for a comprehension to be evaluated on
+  // multiple threads.
+  int64_t parallel_comprehension_min_size = 100000;
+
+  // Build the result list of map and filter style comprehensions in place.
+  //
+  // Unlike enable_comprehension_list_append, this only applies to
+  // comprehensions for which the planner proves that the accumulator is never
+  // aliased or read before the result (see IsAppendOnlyListAccumulator), so
+  // it is safe with hand-rolled ASTs. Appending an element then takes
+  // amortized constant time instead of copying the accumulator. Requires
+  // enable_list_concat.
+  bool enable_verified_comprehension_list_append = true;
+
+  // Trace only one in every trace_sample_interval evaluations that are
+  // started with a listener. Evaluations that are not sampled run as if no
+  // listener was provided. Values less than 2 trace every evaluation.
+  int64_t trace_sample_interval = 1;
+
+  // If not empty, the listener is only called for steps of the listed
+  // expression ids.
+  std::vector<int64_t> trace_expr_ids;
+
+  // If set, results of calls to pure functions (see
+  // cel::FunctionDescriptor::is_pure) are cached in and reused from this
+  // cache, across evaluations and programs sharing it. Calls with unknown or
+  // error arguments or results are not cached. The cache also reports hit
+  // rates through FunctionResultCache::GetStats.
+  std::shared_ptr<cel::FunctionResultCache> function_result_cache;
+
+  // Evaluate repeated subexpressions once.
+  //
+  // When enabled, structurally identical side-effect-free subexpressions that
+  // occur more than once are extracted into cel.bind definitions and shared
+  // by all occurrences. Requires enable_lazy_bind_initialization, so
+  // subexpressions in unevaluated branches are still not evaluated.
+  bool enable_common_subexpression_elimination = false;
+
+  // Plan calls to standard operators as type-specialized steps.
+  //
+  // When enabled, eagerly bound calls to arithmetic, comparison, equality,
+  // logical not and size operators evaluate arguments of a single primitive
+  // kind (e.g. int + int, string < string, size(list)) inline, instead of
+  // resolving and invoking the function adapter. Calls with other arguments
+  // use the registered overloads. A fast path is only planned if an overload
+  // for its argument kinds is registered, and registered overloads for those
+  // kinds are assumed to have the standard semantics.
+  bool enable_standard_operator_steps = false;
+
+  // If set, string and bytes literals are interned in this pool when
+  // programs are planned. Programs referencing the same literal then share
+  // one copy of it, and comparing equal interned values is cheap. The pool
+  // may be shared by several runtimes, e.g. for the whole process.
+  std::shared_ptr<cel::ConstantPool> constant_pool;
+
+  // Build list and map literals whose elements are all constants once, when
+  // the program is planned, and share them between evaluations. Constant
+  // lists used with `in` are indexed for faster membership tests.
+  bool enable_constant_literal_hoisting = true;
+
+  // Variables that unknown attribute patterns may refer to.
+  //
+  // If not empty, only identifiers of these variables start attribute trails
+  // for unknown processing. Selects, indexes and calls on other variables
+  // then skip attribute tracking, and unknown patterns rooted at other
+  // variables never match. Trails are still tracked for all variables if
+  // enable_missing_attribute_errors is set.
+  std::vector<std::string> unknown_attribute_roots;
+
+  // Remove redundant logic before planning.
+  //
+  // When enabled, identities and absorbing constants of logical operators,
+  // double negations, conditionals with constant or identical branches and
+  // sizes of empty literals are simplified, repeated clauses of logical chains
+  // are removed, and the side-effect-free clauses of logical chains are
+  // reordered so the cheapest ones are evaluated first. When several clauses
+  // of a chain evaluate to errors, a different one of them may be reported.
+  bool enable_algebraic_simplification = false;
+
+  // Maximum cost of a single evaluation. Zero means unlimited.
+  //
+  // The cost is the sum of the execution steps, the comprehension iterations
+  // and the cost of each function call (see cel::FunctionDescriptor::cost),
+  // so one limit bounds the work of loops, steps and expensive extension
+  // functions alike. Exceeding it fails the evaluation with a
+  // kResourceExhausted status. The cost of an evaluation can be read with
+  // TraceableProgram::EvaluateWithCost.
+  int64_t max_evaluation_cost = 0;
+
+  // The names of all the variables activations may provide, if known when
+  // programs are planned.
+  //
+  // If set, enum and type constants whose names are not declared here can't
+  // be shadowed by a variable, so they are planned as constants instead of
+  // being looked up in the activation on every evaluation. Activations must
+  // not provide other variables; if they do, the constants are not shadowed.
+  absl::optional<std::vector<std::string>> declared_variables;
+
+  // Fuse comprehensions over the results of map and filter.
+  //
+  // When enabled, all, exists, exists_one, map and filter over the result of
+  // a map or filter, and size() of such a result, are evaluated in a single
+  // pass over the original range, without building the intermediate list.
+  // Elements are only transformed when they are consumed, so errors of
+  // elements that are never consumed, e.g. after exists found a match, are
+  // not reported.
+  bool enable_comprehension_fusion = false;
+
+  // Share the regular expressions precompiled by regex precompilation with
+  // all runtimes of the process that enable this option too.
+  //
+  // A pattern is compiled once while any plan uses it, instead of once per
+  // plan, which saves memory and planning time when many runtimes or tenants
+  // use the same patterns. The memory held by the shared programs can be
+  // read with GetSharedRegexPoolStats.
+  bool enable_shared_regex_pool = false;
+
+  // If set, the statistics of every evaluation and of planning each program
+  // are reported to this sink, e.g. the outcome, wall time, comprehension
+  // iterations and allocations of evaluations. The sink may be shared by
+  // several runtimes. See cel::RuntimeMetricsCounters for a sink that
+  // accumulates totals.
+  std::shared_ptr<cel::RuntimeMetricsSink> metrics_sink;
+
+  // If true and the host has more than one NUMA node, programs are planned
+  // once per node in node-local memory, and evaluations use the replica of
+  // the node they run on. Only applies to programs created by cel::Runtime;
+  // CelExpressionBuilder plans a single copy.
+  bool enable_numa_replication = false;
+
+  // Only applies when short_circuiting is disabled. If true, logical
+  // operators and ternaries whose operands cannot produce unknown values
+  // (see unknown_attribute_roots) are still planned with jumps.
+  bool enable_selective_short_circuiting = false;
+
+  // If set, the step arenas of planned expressions (see enable_step_arena)
+  // reserve their blocks from this allocator instead of the heap, e.g. a
+  // cel::HugePageAllocator.
+  std::shared_ptr<cel::PlanAllocator> plan_allocator;
 };
 // LINT.ThenChange(//depot/google3/runtime/runtime_options.h)
 
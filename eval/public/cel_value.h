@@ -48,6 +48,10 @@ struct CelListAccess;
 struct CelMapAccess;
 }  // namespace cel::interop_internal
 
+namespace google::api::expr::runtime::internal {
+struct ProtoJsonContainerAccess;
+}  // namespace google::api::expr::runtime::internal
+
 namespace google::api::expr::runtime {
 
 using CelError = absl::Status;
@@ -555,6 +559,7 @@ class CelList {
 
  private:
   friend struct cel::interop_internal::CelListAccess;
+  friend struct internal::ProtoJsonContainerAccess;
 
   virtual cel::NativeTypeId GetNativeTypeId() const {
     return cel::NativeTypeId();
@@ -633,6 +638,7 @@ class CelMap {
 
  private:
   friend struct cel::interop_internal::CelMapAccess;
+  friend struct internal::ProtoJsonContainerAccess;
 
   virtual cel::NativeTypeId GetNativeTypeId() const {
     return cel::NativeTypeId();
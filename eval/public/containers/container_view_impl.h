@@ -0,0 +1,174 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CONTAINERS_CONTAINER_VIEW_IMPL_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CONTAINERS_CONTAINER_VIEW_IMPL_H_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "eval/public/cel_value.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+
+namespace container_view_internal {
+
+template <typename T>
+inline constexpr bool kAlwaysFalse = false;
+
+// Converts an element of a host container to a CelValue. Strings are
+// referenced rather than copied.
+template <typename T>
+CelValue ToCelValue(const T& value) {
+  if constexpr (std::is_same_v<T, CelValue>) {
+    return value;
+  } else if constexpr (std::is_same_v<T, bool>) {
+    return CelValue::CreateBool(value);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return CelValue::CreateDouble(static_cast<double>(value));
+  } else if constexpr (std::is_enum_v<T> || std::is_signed_v<T>) {
+    return CelValue::CreateInt64(static_cast<int64_t>(value));
+  } else if constexpr (std::is_unsigned_v<T>) {
+    return CelValue::CreateUint64(static_cast<uint64_t>(value));
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return CelValue::CreateString(&value);
+  } else if constexpr (std::is_same_v<T, absl::string_view>) {
+    return CelValue::CreateStringView(value);
+  } else if constexpr (std::is_same_v<T, absl::Duration>) {
+    return CelValue::CreateDuration(value);
+  } else if constexpr (std::is_same_v<T, absl::Time>) {
+    return CelValue::CreateTimestamp(value);
+  } else {
+    static_assert(kAlwaysFalse<T>, "unsupported element type");
+  }
+}
+
+}  // namespace container_view_internal
+
+// CelList implementation viewing a host container, converting elements on
+// access instead of copying them into CelValues up front. The container must
+// outlive the list and must not be modified while the list is in use.
+//
+// Elements may be bool, integral, enum or floating point values, std::string,
+// absl::string_view, absl::Duration, absl::Time or CelValue.
+template <typename T>
+class ContainerViewList final : public CelList {
+ public:
+  explicit ContainerViewList(absl::Span<const T> values) : values_(values) {}
+
+  int size() const override { return values_.size(); }
+
+  CelValue operator[](int index) const override {
+    return container_view_internal::ToCelValue(values_[index]);
+  }
+
+ private:
+  const absl::Span<const T> values_;
+};
+
+// CelMap implementation viewing a host map keyed by strings, looking up keys
+// in the map itself. The same requirements as for ContainerViewList apply to
+// the map and its values. Lookups of keys other than strings find nothing,
+// as for CelMapBuilder.
+template <typename T>
+class ContainerViewMap final : public CelMap {
+ public:
+  explicit ContainerViewMap(const absl::flat_hash_map<std::string, T>* values)
+      : values_(*values) {}
+
+  int size() const override { return values_.size(); }
+
+  absl::optional<CelValue> operator[](CelValue key) const override {
+    if (!key.IsString()) {
+      return absl::nullopt;
+    }
+    auto it = values_.find(key.StringOrDie().value());
+    if (it == values_.end()) {
+      return absl::nullopt;
+    }
+    return container_view_internal::ToCelValue(it->second);
+  }
+
+  absl::StatusOr<bool> Has(const CelValue& key) const override {
+    return key.IsString() && values_.contains(key.StringOrDie().value());
+  }
+
+  // The keys are listed on first use, as most maps are only looked up.
+  absl::StatusOr<const CelList*> ListKeys() const override {
+    absl::call_once(keys_once_, [this]() {
+      keys_.reserve(values_.size());
+      for (const auto& entry : values_) {
+        keys_.push_back(CelValue::CreateString(&entry.first));
+      }
+    });
+    return &key_list_;
+  }
+
+ private:
+  class KeyList final : public CelList {
+   public:
+    explicit KeyList(const std::vector<CelValue>* keys) : keys_(*keys) {}
+
+    int size() const override { return keys_.size(); }
+
+    CelValue operator[](int index) const override { return keys_[index]; }
+
+   private:
+    const std::vector<CelValue>& keys_;
+  };
+
+  const absl::flat_hash_map<std::string, T>& values_;
+  mutable absl::once_flag keys_once_;
+  mutable std::vector<CelValue> keys_;
+  const KeyList key_list_{&keys_};
+};
+
+// Returns a list value viewing `values`, allocated on `arena`. Typically the
+// arena of the evaluation the activation is used for, so that the view lives
+// as long as the activation's other values.
+template <typename T>
+CelValue CreateContainerViewList(google::protobuf::Arena* arena,
+                                 absl::Span<const T> values) {
+  return CelValue::CreateList(
+      google::protobuf::Arena::Create<ContainerViewList<T>>(arena, values));
+}
+
+template <typename T>
+CelValue CreateContainerViewList(google::protobuf::Arena* arena,
+                                 const std::vector<T>* values) {
+  return CreateContainerViewList(arena, absl::MakeConstSpan(*values));
+}
+
+// Returns a map value viewing `values`, allocated on `arena`.
+template <typename T>
+CelValue CreateContainerViewMap(
+    google::protobuf::Arena* arena,
+    const absl::flat_hash_map<std::string, T>* values) {
+  return CelValue::CreateMap(
+      google::protobuf::Arena::Create<ContainerViewMap<T>>(arena, values));
+}
+
+}  // namespace google::api::expr::runtime
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CONTAINERS_CONTAINER_VIEW_IMPL_H_
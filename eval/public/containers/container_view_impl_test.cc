@@ -0,0 +1,106 @@
+#include "eval/public/containers/container_view_impl.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "eval/public/cel_value.h"
+#include "google/protobuf/arena.h"
+#include "internal/testing.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using testing::Eq;
+using testing::UnorderedElementsAre;
+using cel::internal::IsOkAndHolds;
+
+TEST(ContainerViewListTest, ViewsInts) {
+  google::protobuf::Arena arena;
+  std::vector<int64_t> values = {1, 2, 3};
+  CelValue list = CreateContainerViewList(&arena, &values);
+  ASSERT_TRUE(list.IsList());
+  EXPECT_THAT(list.ListOrDie()->size(), Eq(3));
+  EXPECT_THAT((*list.ListOrDie())[1].Int64OrDie(), Eq(2));
+
+  // Elements are read from the container on access.
+  values[1] = 5;
+  EXPECT_THAT((*list.ListOrDie())[1].Int64OrDie(), Eq(5));
+}
+
+TEST(ContainerViewListTest, ReferencesStrings) {
+  google::protobuf::Arena arena;
+  std::vector<std::string> values = {"a", "b"};
+  CelValue list = CreateContainerViewList(&arena, &values);
+  CelValue element = (*list.ListOrDie())[0];
+  ASSERT_TRUE(element.IsString());
+  EXPECT_THAT(element.StringOrDie().value(), Eq("a"));
+  EXPECT_THAT(element.StringOrDie().value().data(), Eq(values[0].data()));
+}
+
+TEST(ContainerViewListTest, ConvertsElements) {
+  google::protobuf::Arena arena;
+  const uint32_t uints[] = {7};
+  EXPECT_THAT(
+      (*CreateContainerViewList(&arena, absl::MakeConstSpan(uints))
+            .ListOrDie())[0]
+          .Uint64OrDie(),
+      Eq(7));
+  const double doubles[] = {0.5};
+  EXPECT_THAT(
+      (*CreateContainerViewList(&arena, absl::MakeConstSpan(doubles))
+            .ListOrDie())[0]
+          .DoubleOrDie(),
+      Eq(0.5));
+  const absl::Duration durations[] = {absl::Seconds(2)};
+  EXPECT_THAT(
+      (*CreateContainerViewList(&arena, absl::MakeConstSpan(durations))
+            .ListOrDie())[0]
+          .DurationOrDie(),
+      Eq(absl::Seconds(2)));
+}
+
+TEST(ContainerViewMapTest, LooksUpHostMap) {
+  google::protobuf::Arena arena;
+  absl::flat_hash_map<std::string, int64_t> values = {{"a", 1}, {"b", 2}};
+  CelValue map = CreateContainerViewMap(&arena, &values);
+  ASSERT_TRUE(map.IsMap());
+  const CelMap& cel_map = *map.MapOrDie();
+  EXPECT_THAT(cel_map.size(), Eq(2));
+
+  std::string key = "b";
+  auto lookup = cel_map[CelValue::CreateString(&key)];
+  ASSERT_TRUE(lookup.has_value());
+  EXPECT_THAT(lookup->Int64OrDie(), Eq(2));
+  EXPECT_THAT(cel_map.Has(CelValue::CreateString(&key)), IsOkAndHolds(true));
+
+  key = "c";
+  EXPECT_FALSE(cel_map[CelValue::CreateString(&key)].has_value());
+  EXPECT_THAT(cel_map.Has(CelValue::CreateString(&key)), IsOkAndHolds(false));
+  EXPECT_FALSE(cel_map[CelValue::CreateInt64(1)].has_value());
+  EXPECT_THAT(cel_map.Has(CelValue::CreateInt64(1)), IsOkAndHolds(false));
+}
+
+TEST(ContainerViewMapTest, ListsKeys) {
+  google::protobuf::Arena arena;
+  absl::flat_hash_map<std::string, std::string> values = {{"a", "x"},
+                                                          {"b", "y"}};
+  CelValue map = CreateContainerViewMap(&arena, &values);
+  ASSERT_OK_AND_ASSIGN(const CelList* keys, map.MapOrDie()->ListKeys());
+  ASSERT_THAT(keys->size(), Eq(2));
+  std::vector<std::string> key_strings;
+  for (int i = 0; i < keys->size(); ++i) {
+    key_strings.push_back(std::string((*keys)[i].StringOrDie().value()));
+  }
+  EXPECT_THAT(key_strings, UnorderedElementsAre("a", "b"));
+  ASSERT_OK_AND_ASSIGN(const CelList* same_keys, map.MapOrDie()->ListKeys());
+  EXPECT_THAT(same_keys, Eq(keys));
+}
+
+}  // namespace
+
+}  // namespace google::api::expr::runtime
@@ -14,16 +14,144 @@
 
 #include "eval/public/containers/internal_field_backed_list_impl.h"
 
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/base/prefetch.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/structs/field_access_impl.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_field.h"
 
 namespace google::api::expr::runtime::internal {
 
+using ::google::protobuf::FieldDescriptor;
+
+namespace {
+
+// How many elements ahead of the one being read a repeated message field is
+// prefetched. Comprehensions read the elements in order and spend enough time
+// on each one for the next few messages to arrive in cache.
+constexpr int kMessagePrefetchDistance = 4;
+
+// The only uses of the deprecated Reflection::GetRepeatedField and
+// GetRepeatedPtrField in this list.
+//
+// Their replacement, GetRepeatedFieldRef, reads every element through a
+// virtual accessor and does not expose the contiguous storage that the typed
+// fast paths of the list, e.g. int64_values(), hand out. The callers check
+// that the element type matches the cpp_type of field, and the storage is
+// only read while the message is alive, as for any list backed by it. The
+// helpers are not templates, so the accessors are instantiated within the
+// suppression.
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#endif
+
+const google::protobuf::RepeatedField<int64_t>& RepeatedInt64Storage(
+    const google::protobuf::Reflection& reflection,
+    const google::protobuf::Message& message, const FieldDescriptor* field) {
+  return reflection.GetRepeatedField<int64_t>(message, field);
+}
+
+const google::protobuf::RepeatedPtrField<std::string>& RepeatedStringStorage(
+    const google::protobuf::Reflection& reflection,
+    const google::protobuf::Message& message, const FieldDescriptor* field) {
+  return reflection.GetRepeatedPtrField<std::string>(message, field);
+}
+
+const google::protobuf::RepeatedPtrField<google::protobuf::Message>&
+RepeatedMessageStorage(const google::protobuf::Reflection& reflection,
+                       const google::protobuf::Message& message,
+                       const FieldDescriptor* field) {
+  return reflection.GetRepeatedPtrField<google::protobuf::Message>(message,
+                                                                   field);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+
+}  // namespace
+
+FieldBackedListImpl::FieldBackedListImpl(
+    const google::protobuf::Message* message,
+    const google::protobuf::FieldDescriptor* descriptor,
+    ProtobufValueFactory factory, google::protobuf::Arena* arena)
+    : message_(message),
+      descriptor_(descriptor),
+      reflection_(message_->GetReflection()),
+      factory_(std::move(factory)),
+      arena_(arena) {
+  switch (descriptor_->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT64:
+      int64_values_ =
+          &RepeatedInt64Storage(*reflection_, *message_, descriptor_);
+      break;
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (descriptor_->options().ctype() ==
+          google::protobuf::FieldOptions::STRING) {
+        const auto* values =
+            &RepeatedStringStorage(*reflection_, *message_, descriptor_);
+        if (descriptor_->type() == FieldDescriptor::TYPE_BYTES) {
+          bytes_values_ = values;
+        } else {
+          string_values_ = values;
+        }
+      }
+      break;
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      message_values_ =
+          &RepeatedMessageStorage(*reflection_, *message_, descriptor_);
+      break;
+    default:
+      break;
+  }
+}
+
 int FieldBackedListImpl::size() const {
+  if (int64_values_ != nullptr) {
+    return int64_values_->size();
+  }
+  if (string_values_ != nullptr) {
+    return string_values_->size();
+  }
+  if (bytes_values_ != nullptr) {
+    return bytes_values_->size();
+  }
+  if (message_values_ != nullptr) {
+    return message_values_->size();
+  }
   return reflection_->FieldSize(*message_, descriptor_);
 }
 
 CelValue FieldBackedListImpl::operator[](int index) const {
+  if (int64_values_ != nullptr) {
+    return CelValue::CreateInt64(int64_values_->Get(index));
+  }
+  if (string_values_ != nullptr) {
+    return CelValue::CreateString(&string_values_->Get(index));
+  }
+  if (bytes_values_ != nullptr) {
+    return CelValue::CreateBytes(&bytes_values_->Get(index));
+  }
+  if (message_values_ != nullptr) {
+    // Each element is a separate allocation, so iterating over a large field
+    // misses cache on every message. The pointers themselves are contiguous.
+    if (int ahead = index + kMessagePrefetchDistance;
+        ahead < message_values_->size()) {
+      absl::PrefetchToLocalCache(&message_values_->Get(ahead));
+    }
+  }
   auto result = CreateValueFromRepeatedField(message_, descriptor_, index,
                                              factory_, arena_);
   if (!result.ok()) {
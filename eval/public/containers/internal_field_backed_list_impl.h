@@ -15,10 +15,18 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CONTAINERS_INTERNAL_FIELD_BACKED_LIST_IMPL_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_CONTAINERS_INTERNAL_FIELD_BACKED_LIST_IMPL_H_
 
+#include <cstdint>
+#include <string>
 #include <utility>
 
+#include "absl/base/nullability.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "common/native_type.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/structs/protobuf_value_factory.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/repeated_field.h"
 
 namespace google::api::expr::runtime::internal {
 
@@ -33,12 +41,8 @@ class FieldBackedListImpl : public CelList {
   // descriptor FieldDescriptor for the field
   FieldBackedListImpl(const google::protobuf::Message* message,
                       const google::protobuf::FieldDescriptor* descriptor,
-                      ProtobufValueFactory factory, google::protobuf::Arena* arena)
-      : message_(message),
-        descriptor_(descriptor),
-        reflection_(message_->GetReflection()),
-        factory_(std::move(factory)),
-        arena_(arena) {}
+                      ProtobufValueFactory factory,
+                      google::protobuf::Arena* arena);
 
   // List size.
   int size() const override;
@@ -46,12 +50,56 @@ class FieldBackedListImpl : public CelList {
   // List element access operator.
   CelValue operator[](int index) const override;
 
+  // Returns the elements of a repeated 64-bit signed integer field, without
+  // copying, or nullopt for fields of other types.
+  absl::optional<absl::Span<const int64_t>> int64_values() const {
+    if (int64_values_ == nullptr) {
+      return absl::nullopt;
+    }
+    return absl::MakeConstSpan(*int64_values_);
+  }
+
+  // Returns the elements of a repeated string field, without copying, or null
+  // for fields of other types and fields stored as cords.
+  absl::Nullable<const google::protobuf::RepeatedPtrField<std::string>*>
+  string_values() const {
+    return string_values_;
+  }
+
+  // As `string_values()`, for repeated bytes fields.
+  absl::Nullable<const google::protobuf::RepeatedPtrField<std::string>*>
+  bytes_values() const {
+    return bytes_values_;
+  }
+
+  // As `string_values()`, for repeated message fields.
+  absl::Nullable<
+      const google::protobuf::RepeatedPtrField<google::protobuf::Message>*>
+  message_values() const {
+    return message_values_;
+  }
+
  private:
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<FieldBackedListImpl>();
+  }
+
   const google::protobuf::Message* message_;
   const google::protobuf::FieldDescriptor* descriptor_;
   const google::protobuf::Reflection* reflection_;
   ProtobufValueFactory factory_;
   google::protobuf::Arena* arena_;
+  // At most one of these is set, depending on the field type. Elements of
+  // these fields are read directly rather than through reflection.
+  const google::protobuf::RepeatedField<int64_t>* int64_values_ = nullptr;
+  const google::protobuf::RepeatedPtrField<std::string>* string_values_ =
+      nullptr;
+  const google::protobuf::RepeatedPtrField<std::string>* bytes_values_ =
+      nullptr;
+  // Elements of repeated message fields are still converted through
+  // reflection, but are prefetched ahead of sequential access.
+  const google::protobuf::RepeatedPtrField<google::protobuf::Message>*
+      message_values_ = nullptr;
 };
 
 }  // namespace google::api::expr::runtime::internal
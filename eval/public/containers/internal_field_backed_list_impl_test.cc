@@ -124,6 +124,43 @@ TEST(FieldBackedListImplTest, Int64DatatypeTest) {
   EXPECT_EQ((*cel_list)[1].Int64OrDie(), 2);
 }
 
+TEST(FieldBackedListImplTest, TypedViews) {
+  TestMessage message;
+  message.add_int64_list(1);
+  message.add_string_list("a");
+  message.add_bytes_list("b");
+  message.add_int32_list(2);
+
+  google::protobuf::Arena arena;
+
+  auto int64_list = CreateList(&message, "int64_list", &arena);
+  auto* int64_impl = static_cast<FieldBackedListImpl*>(int64_list.get());
+  ASSERT_TRUE(int64_impl->int64_values().has_value());
+  EXPECT_EQ(int64_impl->int64_values()->data(), message.int64_list().data());
+  EXPECT_EQ(int64_impl->string_values(), nullptr);
+
+  auto string_list = CreateList(&message, "string_list", &arena);
+  auto* string_impl = static_cast<FieldBackedListImpl*>(string_list.get());
+  EXPECT_EQ(string_impl->string_values(), &message.string_list());
+  EXPECT_EQ(string_impl->bytes_values(), nullptr);
+  EXPECT_EQ((*string_list)[0].StringOrDie().value().data(),
+            message.string_list(0).data());
+
+  auto bytes_list = CreateList(&message, "bytes_list", &arena);
+  auto* bytes_impl = static_cast<FieldBackedListImpl*>(bytes_list.get());
+  EXPECT_EQ(bytes_impl->bytes_values(), &message.bytes_list());
+  EXPECT_EQ((*bytes_list)[0].BytesOrDie().value(), "b");
+
+  // Other types are read through reflection.
+  auto int32_list = CreateList(&message, "int32_list", &arena);
+  auto* int32_impl = static_cast<FieldBackedListImpl*>(int32_list.get());
+  EXPECT_FALSE(int32_impl->int64_values().has_value());
+  EXPECT_EQ(int32_impl->string_values(), nullptr);
+  auto cord_list = CreateList(&message, "cord_list", &arena);
+  EXPECT_EQ(static_cast<FieldBackedListImpl*>(cord_list.get())->string_values(),
+            nullptr);
+}
+
 TEST(FieldBackedListImplTest, Uint32DatatypeTest) {
   TestMessage message;
   message.add_uint32_list(1);
@@ -233,6 +270,29 @@ TEST(FieldBackedListImplTest, MessageDatatypeTest) {
   EXPECT_THAT(*msg2, EqualsProto(*((*cel_list)[1].MessageOrDie())));
 }
 
+TEST(FieldBackedListImplTest, MessageListReadInOrder) {
+  TestMessage message;
+  for (int i = 0; i < 10; ++i) {
+    message.add_message_list()->set_int64_value(i);
+  }
+
+  google::protobuf::Arena arena;
+
+  auto cel_list = CreateList(&message, "message_list", &arena);
+  auto* impl = static_cast<FieldBackedListImpl*>(cel_list.get());
+  ASSERT_NE(impl->message_values(), nullptr);
+  EXPECT_EQ(impl->message_values()->size(), 10);
+
+  // Elements near the end are read without prefetching past the field.
+  ASSERT_EQ(cel_list->size(), 10);
+  for (int i = 0; i < 10; ++i) {
+    const auto* element =
+        static_cast<const TestMessage*>((*cel_list)[i].MessageOrDie());
+    EXPECT_EQ(element, &message.message_list(i));
+    EXPECT_EQ(element->int64_value(), i);
+  }
+}
+
 TEST(FieldBackedListImplTest, EnumDatatypeTest) {
   TestMessage message;
 
@@ -26,12 +26,18 @@
 #include "base/kind.h"
 #include "base/memory.h"
 #include "eval/compiler/cel_expression_builder_flat_impl.h"
+#include "eval/compiler/algebraic_simplification.h"
+#include "eval/compiler/common_subexpression_elimination.h"
+#include "eval/compiler/comprehension_fusion.h"
 #include "eval/compiler/comprehension_vulnerability_check.h"
 #include "eval/compiler/constant_folding.h"
 #include "eval/compiler/flat_expr_builder.h"
 #include "eval/compiler/flat_expr_builder_extensions.h"
+#include "eval/compiler/fused_select_optimization.h"
 #include "eval/compiler/qualified_reference_resolver.h"
 #include "eval/compiler/regex_precompilation_optimization.h"
+#include "eval/compiler/register_operands_optimization.h"
+#include "eval/compiler/standard_operator_optimization.h"
 #include "eval/public/cel_expression.h"
 #include "eval/public/cel_function.h"
 #include "eval/public/cel_options.h"
@@ -84,6 +90,19 @@ std::unique_ptr<CelExpressionBuilder> CreatePortableExprBuilder(
           ? ReferenceResolverOption::kAlways
           : ReferenceResolverOption::kCheckedOnly));
 
+  if (options.enable_algebraic_simplification) {
+    flat_expr_builder.AddAstTransform(CreateAlgebraicSimplificationTransform());
+  }
+
+  if (options.enable_comprehension_fusion) {
+    flat_expr_builder.AddAstTransform(CreateComprehensionFusionTransform());
+  }
+
+  if (options.enable_common_subexpression_elimination) {
+    flat_expr_builder.AddAstTransform(
+        CreateCommonSubexpressionEliminationTransform());
+  }
+
   if (options.enable_comprehension_vulnerability_check) {
     builder->flat_expr_builder().AddProgramOptimizer(
         CreateComprehensionVulnerabilityCheck());
@@ -98,6 +117,22 @@ std::unique_ptr<CelExpressionBuilder> CreatePortableExprBuilder(
   if (options.enable_regex_precompilation) {
     flat_expr_builder.AddProgramOptimizer(
         CreateRegexPrecompilationExtension(options.regex_max_program_size));
+    flat_expr_builder.AddProgramOptimizer(
+        CreateRegexSetExtension(options.regex_max_program_size));
+  }
+
+  if (options.enable_register_operands) {
+    flat_expr_builder.AddProgramOptimizer(CreateRegisterOperandsOptimizer());
+  }
+
+  if (options.enable_fused_selects) {
+    flat_expr_builder.AddProgramOptimizer(CreateFusedSelectOptimizer());
+  }
+
+  // Runs after the other call rewrites, so it only lowers calls they leave as
+  // plain function steps.
+  if (options.enable_standard_operator_steps) {
+    flat_expr_builder.AddProgramOptimizer(CreateStandardOperatorOptimizer());
   }
 
   if (options.enable_select_optimization) {
@@ -14,12 +14,14 @@
 
 #include "eval/public/string_extension_func_registrar.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <string_view>
+#include <utility>
 #include <vector>
 
-#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
 #include "eval/public/cel_function_adapter.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/containers/container_backed_list_impl.h"
@@ -35,28 +37,36 @@ CelValue SplitWithLimit(Arena* arena, const CelValue::StringHolder value,
                         const CelValue::StringHolder delimiter, int64_t limit) {
   // As per specifications[1]. return empty list in case limit is set to 0.
   // 1. https://pkg.go.dev/github.com/google/cel-go/ext#Strings
-  std::vector<std::string> string_split = {};
+  //
+  // `value` may be a temporary, e.g. a constant dropped by constant folding,
+  // so it is copied to the arena once and the elements are views of the copy.
+  std::vector<CelValue> cel_list;
+  if (limit == 0) {
+    return CelValue::CreateList(
+        Arena::Create<ContainerBackedListImpl>(arena, std::move(cel_list)));
+  }
+  absl::string_view source =
+      *Arena::Create<std::string>(arena, value.value().data(),
+                                  value.value().size());
   if (limit < 0) {
     // perform regular split operation in case of limit < 0
-    string_split = absl::StrSplit(value.value(), delimiter.value());
+    for (absl::string_view substring :
+         absl::StrSplit(source, delimiter.value())) {
+      cel_list.push_back(CelValue::CreateStringView(substring));
+    }
   } else if (limit > 0) {
     // The absl::MaxSplits generate at max limit + 1 number of elements where as
     // it is suppose to return limit nunmber of elements as per
     // specifications[1].
     // To resolve the inconsistency passing limit-1 as input to absl::MaxSplits
     // 1. https://pkg.go.dev/github.com/google/cel-go/ext#Strings
-    string_split = absl::StrSplit(
-        value.value(), absl::MaxSplits(delimiter.value(), limit - 1));
+    for (absl::string_view substring : absl::StrSplit(
+             source, absl::MaxSplits(delimiter.value(), limit - 1))) {
+      cel_list.push_back(CelValue::CreateStringView(substring));
+    }
   }
-  std::vector<CelValue> cel_list;
-  cel_list.reserve(string_split.size());
-  for (const std::string& substring : string_split) {
-    cel_list.push_back(
-        CelValue::CreateString(Arena::Create<std::string>(arena, substring)));
-  }
-  auto result = CelValue::CreateList(
-      Arena::Create<ContainerBackedListImpl>(arena, cel_list));
-  return result;
+  return CelValue::CreateList(
+      Arena::Create<ContainerBackedListImpl>(arena, std::move(cel_list)));
 }
 
 CelValue Split(Arena* arena, CelValue::StringHolder value,
@@ -67,13 +77,23 @@ CelValue Split(Arena* arena, CelValue::StringHolder value,
 CelValue::StringHolder JoinWithSeparator(Arena* arena, const CelValue& value,
                                          absl::string_view separator) {
   const CelList* cel_list = value.ListOrDie();
-  std::vector<std::string_view> string_list;
-  string_list.reserve(cel_list->size());
-  for (int i = 0; i < cel_list->size(); i++) {
+  const int size = cel_list->size();
+  std::vector<absl::string_view> string_list;
+  string_list.reserve(size);
+  size_t result_size = size > 0 ? separator.size() * (size - 1) : 0;
+  for (int i = 0; i < size; i++) {
     string_list.push_back(cel_list->Get(arena, i).StringOrDie().value());
+    result_size += string_list.back().size();
+  }
+  // Build the result in place, with a single allocation.
+  auto* result = Arena::Create<std::string>(arena);
+  result->reserve(result_size);
+  for (int i = 0; i < size; i++) {
+    if (i > 0) {
+      result->append(separator.data(), separator.size());
+    }
+    result->append(string_list[i].data(), string_list[i].size());
   }
-  auto result =
-      Arena::Create<std::string>(arena, absl::StrJoin(string_list, separator));
   return CelValue::StringHolder(result);
 }
 
@@ -15,6 +15,7 @@
 #include "eval/public/string_extension_func_registrar.h"
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -133,6 +134,27 @@ TEST_F(StringExtensionTest, TestStringSplit) {
   }
 }
 
+TEST_F(StringExtensionTest, TestStringSplitOutlivesSource) {
+  Arena arena;
+  CelValue result;
+  auto value = std::make_unique<std::string>("This!!Is!!Test");
+  std::string delimiter = "!!";
+  std::vector<std::string> expected = {"This", "Is", "Test"};
+
+  ASSERT_NO_FATAL_FAILURE(
+      PerformSplitStringTest(&arena, value.get(), &delimiter, &result));
+  // Overwrite and release the source, as constant folding does with the
+  // constant argument.
+  value->assign(value->size(), 'x');
+  value.reset();
+  ASSERT_EQ(result.type(), CelValue::Type::kList);
+  EXPECT_EQ(result.ListOrDie()->size(), 3);
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(result.ListOrDie()->Get(&arena, i).StringOrDie().value(),
+              expected[i]);
+  }
+}
+
 TEST_F(StringExtensionTest, TestStringSplitEmptyDelimiter) {
   Arena arena;
   CelValue result;
@@ -29,8 +29,10 @@
 #include "google/protobuf/message.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/strip.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
@@ -72,6 +74,18 @@ constexpr int64_t kMaxIntJSON = (1ll << 53) - 1;
 // kMinIntJSON is defined as the Number.MIN_SAFE_INTEGER value per EcmaScript 6.
 constexpr int64_t kMinIntJSON = -kMaxIntJSON;
 
+// google.protobuf.BytesValue stores its value as either std::string or
+// absl::Cord, depending on the protobuf build. Strings are referenced without
+// copying, cords are flattened into the arena.
+CelValue CreateBytesFromWrapperValue(const std::string& value, Arena*) {
+  return CelValue::CreateBytes(&value);
+}
+
+CelValue CreateBytesFromWrapperValue(const absl::Cord& value, Arena* arena) {
+  return CelValue::CreateBytes(
+      Arena::Create<std::string>(arena, static_cast<std::string>(value)));
+}
+
 // Supported well known types.
 typedef enum {
   kUnknown,
@@ -93,28 +107,35 @@ typedef enum {
 } WellKnownType;
 
 // GetWellKnownType translates a string type name into a WellKnowType.
+//
+// Dispatches on the name within the google.protobuf package, so the names of
+// other messages are rejected without hashing them.
 WellKnownType GetWellKnownType(absl::string_view type_name) {
-  static auto* well_known_types_map =
-      new absl::flat_hash_map<std::string, WellKnownType>(
-          {{"google.protobuf.BoolValue", kBoolValue},
-           {"google.protobuf.DoubleValue", kDoubleValue},
-           {"google.protobuf.FloatValue", kFloatValue},
-           {"google.protobuf.Int32Value", kInt32Value},
-           {"google.protobuf.Int64Value", kInt64Value},
-           {"google.protobuf.UInt32Value", kUInt32Value},
-           {"google.protobuf.UInt64Value", kUInt64Value},
-           {"google.protobuf.Duration", kDuration},
-           {"google.protobuf.Timestamp", kTimestamp},
-           {"google.protobuf.Struct", kStruct},
-           {"google.protobuf.ListValue", kListValue},
-           {"google.protobuf.Value", kValue},
-           {"google.protobuf.StringValue", kStringValue},
-           {"google.protobuf.BytesValue", kBytesValue},
-           {"google.protobuf.Any", kAny}});
-  if (!well_known_types_map->contains(type_name)) {
+  static const auto* well_known_types_map =
+      new absl::flat_hash_map<absl::string_view, WellKnownType>(
+          {{"BoolValue", kBoolValue},
+           {"DoubleValue", kDoubleValue},
+           {"FloatValue", kFloatValue},
+           {"Int32Value", kInt32Value},
+           {"Int64Value", kInt64Value},
+           {"UInt32Value", kUInt32Value},
+           {"UInt64Value", kUInt64Value},
+           {"Duration", kDuration},
+           {"Timestamp", kTimestamp},
+           {"Struct", kStruct},
+           {"ListValue", kListValue},
+           {"Value", kValue},
+           {"StringValue", kStringValue},
+           {"BytesValue", kBytesValue},
+           {"Any", kAny}});
+  if (!absl::ConsumePrefix(&type_name, "google.protobuf.")) {
     return kUnknown;
   }
-  return well_known_types_map->at(type_name);
+  auto it = well_known_types_map->find(type_name);
+  if (it == well_known_types_map->end()) {
+    return kUnknown;
+  }
+  return it->second;
 }
 
 // IsJSONSafe indicates whether the int is safely representable as a floating
@@ -218,6 +239,23 @@ class DynamicMap : public CelMap {
   const LegacyTypeProvider* type_provider_;
   const DynamicMapKeyList key_list_;
 };
+
+// Unpacks a well known type whose CelValue does not reference the message,
+// i.e. wrappers of scalars, Duration and Timestamp, into a local rather than
+// into a message allocated on the arena.
+template <typename T>
+CelValue UnpackScalar(const Any& any_value, absl::string_view type_name,
+                      const LegacyTypeProvider* type_provider, Arena* arena) {
+  T nested_message;
+  if (!any_value.UnpackTo(&nested_message)) {
+    // Failed to unpack.
+    // TODO(issues/25) What error code?
+    return CreateErrorValue(
+        arena, absl::StrCat("Failed to unpack Any into ", type_name));
+  }
+  return CreateCelValue(nested_message, type_provider, arena);
+}
+
 }  // namespace
 
 CelValue CreateCelValue(const Duration& duration,
@@ -252,90 +290,36 @@ CelValue CreateCelValue(const Any& any_value,
     return CreateErrorValue(arena, "Malformed type_url string");
   }
 
-  std::string full_name = std::string(type_url.substr(pos + 1));
+  absl::string_view full_name = absl::string_view(type_url).substr(pos + 1);
   WellKnownType type = GetWellKnownType(full_name);
   switch (type) {
-    case kDoubleValue: {
-      DoubleValue* nested_message = Arena::CreateMessage<DoubleValue>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into DoubleValue");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kFloatValue: {
-      FloatValue* nested_message = Arena::CreateMessage<FloatValue>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into FloatValue");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kInt32Value: {
-      Int32Value* nested_message = Arena::CreateMessage<Int32Value>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into Int32Value");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kInt64Value: {
-      Int64Value* nested_message = Arena::CreateMessage<Int64Value>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into Int64Value");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kUInt32Value: {
-      UInt32Value* nested_message = Arena::CreateMessage<UInt32Value>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into UInt32Value");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kUInt64Value: {
-      UInt64Value* nested_message = Arena::CreateMessage<UInt64Value>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into UInt64Value");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kBoolValue: {
-      BoolValue* nested_message = Arena::CreateMessage<BoolValue>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into BoolValue");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kTimestamp: {
-      Timestamp* nested_message = Arena::CreateMessage<Timestamp>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into Timestamp");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
-    case kDuration: {
-      Duration* nested_message = Arena::CreateMessage<Duration>(arena);
-      if (!any_value.UnpackTo(nested_message)) {
-        // Failed to unpack.
-        // TODO(issues/25) What error code?
-        return CreateErrorValue(arena, "Failed to unpack Any into Duration");
-      }
-      return CreateCelValue(*nested_message, type_provider, arena);
-    } break;
+    case kDoubleValue:
+      return UnpackScalar<DoubleValue>(any_value, "DoubleValue", type_provider,
+                                       arena);
+    case kFloatValue:
+      return UnpackScalar<FloatValue>(any_value, "FloatValue", type_provider,
+                                      arena);
+    case kInt32Value:
+      return UnpackScalar<Int32Value>(any_value, "Int32Value", type_provider,
+                                      arena);
+    case kInt64Value:
+      return UnpackScalar<Int64Value>(any_value, "Int64Value", type_provider,
+                                      arena);
+    case kUInt32Value:
+      return UnpackScalar<UInt32Value>(any_value, "UInt32Value", type_provider,
+                                       arena);
+    case kUInt64Value:
+      return UnpackScalar<UInt64Value>(any_value, "UInt64Value", type_provider,
+                                       arena);
+    case kBoolValue:
+      return UnpackScalar<BoolValue>(any_value, "BoolValue", type_provider,
+                                     arena);
+    case kTimestamp:
+      return UnpackScalar<Timestamp>(any_value, "Timestamp", type_provider,
+                                     arena);
+    case kDuration:
+      return UnpackScalar<Duration>(any_value, "Duration", type_provider,
+                                    arena);
     case kStringValue: {
       StringValue* nested_message = Arena::CreateMessage<StringValue>(arena);
       if (!any_value.UnpackTo(nested_message)) {
@@ -399,21 +383,22 @@ CelValue CreateCelValue(const Any& any_value,
           type_provider->ProvideLegacyAnyPackingApis(full_name);
       if (!any_apis.has_value()) {
         return CreateErrorValue(
-            arena, "Failed to get AnyPackingApis for " + full_name);
+            arena,
+            absl::StrCat("Failed to get AnyPackingApis for ", full_name));
       }
       std::optional<const LegacyTypeInfoApis*> type_info =
           type_provider->ProvideLegacyTypeInfo(full_name);
       if (!type_info.has_value()) {
-        return CreateErrorValue(arena,
-                                "Failed to get TypeInfo for " + full_name);
+        return CreateErrorValue(
+            arena, absl::StrCat("Failed to get TypeInfo for ", full_name));
       }
       absl::StatusOr<google::protobuf::MessageLite*> nested_message =
           (*any_apis)->Unpack(any_value, arena);
       if (!nested_message.ok()) {
         // Failed to unpack.
         // TODO(issues/25) What error code?
-        return CreateErrorValue(arena,
-                                "Failed to unpack Any into " + full_name);
+        return CreateErrorValue(
+            arena, absl::StrCat("Failed to unpack Any into ", full_name));
       }
       return CelValue::CreateMessageWrapper(
           CelValue::MessageWrapper(*nested_message, *type_info));
@@ -514,9 +499,7 @@ CelValue CreateCelValue(const StringValue& wrapper,
 
 CelValue CreateCelValue(const BytesValue& wrapper,
                         const LegacyTypeProvider* type_provider, Arena* arena) {
-  // BytesValue stores value as Cord
-  return CelValue::CreateBytes(
-      Arena::Create<std::string>(arena, std::string(wrapper.value())));
+  return CreateBytesFromWrapperValue(wrapper.value(), arena);
 }
 
 CelValue CreateCelValue(const Value& value,
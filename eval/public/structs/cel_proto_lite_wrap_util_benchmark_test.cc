@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures unwrapping well known types with the lite runtime utilities,
+// directly and packed in google.protobuf.Any.
+
+#include <memory>
+
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/duration.pb.h"
+#include "google/protobuf/timestamp.pb.h"
+#include "google/protobuf/wrappers.pb.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/message_lite.h"
+#include "absl/strings/str_cat.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/structs/cel_proto_lite_wrap_util.h"
+#include "eval/testutil/test_message.pb.h"
+#include "internal/benchmark.h"
+#include "internal/testing.h"
+
+namespace google::api::expr::runtime::internal {
+namespace {
+
+enum class Message {
+  kInt64Value = 0,
+  kDuration = 1,
+  kTimestamp = 2,
+  kStringValue = 3,
+};
+
+std::unique_ptr<google::protobuf::MessageLite> NewMessage(Message message) {
+  switch (message) {
+    case Message::kInt64Value: {
+      auto value = std::make_unique<google::protobuf::Int64Value>();
+      value->set_value(42);
+      return value;
+    }
+    case Message::kDuration: {
+      auto value = std::make_unique<google::protobuf::Duration>();
+      value->set_seconds(3);
+      return value;
+    }
+    case Message::kTimestamp: {
+      auto value = std::make_unique<google::protobuf::Timestamp>();
+      value->set_seconds(1700000000);
+      return value;
+    }
+    case Message::kStringValue: {
+      auto value = std::make_unique<google::protobuf::StringValue>();
+      value->set_value("a string too long to be inlined");
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+void BM_UnwrapFromWellKnownType(benchmark::State& state) {
+  auto message = NewMessage(static_cast<Message>(state.range(0)));
+  google::protobuf::Arena arena;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        UnwrapFromWellKnownType(message.get(), nullptr, &arena));
+  }
+}
+
+BENCHMARK(BM_UnwrapFromWellKnownType)
+    ->ArgName("message")
+    ->Arg(static_cast<int>(Message::kInt64Value))
+    ->Arg(static_cast<int>(Message::kDuration))
+    ->Arg(static_cast<int>(Message::kTimestamp))
+    ->Arg(static_cast<int>(Message::kStringValue));
+
+// Messages other than the well known types are rejected by name.
+void BM_UnwrapFromWellKnownTypeNotWellKnown(benchmark::State& state) {
+  TestMessage message;
+  google::protobuf::Arena arena;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        UnwrapFromWellKnownType(&message, nullptr, &arena));
+  }
+}
+
+BENCHMARK(BM_UnwrapFromWellKnownTypeNotWellKnown);
+
+void BM_UnpackAny(benchmark::State& state) {
+  auto message = NewMessage(static_cast<Message>(state.range(0)));
+  google::protobuf::Any any;
+  any.set_type_url(
+      absl::StrCat("type.googleapis.com/", message->GetTypeName()));
+  any.set_value(message->SerializeAsString());
+  for (auto _ : state) {
+    // Messages unpacked onto the arena are released every iteration.
+    google::protobuf::Arena arena;
+    benchmark::DoNotOptimize(CreateCelValue(any, nullptr, &arena));
+  }
+}
+
+BENCHMARK(BM_UnpackAny)
+    ->ArgName("message")
+    ->Arg(static_cast<int>(Message::kInt64Value))
+    ->Arg(static_cast<int>(Message::kDuration))
+    ->Arg(static_cast<int>(Message::kTimestamp))
+    ->Arg(static_cast<int>(Message::kStringValue));
+
+}  // namespace
+}  // namespace google::api::expr::runtime::internal
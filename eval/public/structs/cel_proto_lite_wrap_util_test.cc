@@ -663,6 +663,32 @@ TEST_F(CelProtoWrapperTest, UnwrapInvalidAny) {
   ASSERT_TRUE(CreateCelValue(any, type_provider(), arena()).IsError());
 }
 
+TEST_F(CelProtoWrapperTest, UnwrapAnyOfScalars) {
+  Duration duration;
+  duration.set_seconds(10);
+  Any any;
+  any.PackFrom(duration);
+  CelValue value = CreateCelValue(any, type_provider(), arena());
+  ASSERT_TRUE(value.IsDuration());
+  EXPECT_EQ(value.DurationOrDie(), absl::Seconds(10));
+
+  Timestamp timestamp;
+  timestamp.set_seconds(1615852799);
+  any.PackFrom(timestamp);
+  value = CreateCelValue(any, type_provider(), arena());
+  ASSERT_TRUE(value.IsTimestamp());
+  EXPECT_EQ(value.TimestampOrDie(), absl::FromUnixSeconds(1615852799));
+
+  // A payload not matching the type is reported with the type's name.
+  any.set_type_url("type.googleapis.com/google.protobuf.Int64Value");
+  any.set_value("\xff");
+  value = CreateCelValue(any, type_provider(), arena());
+  ASSERT_TRUE(value.IsError());
+  EXPECT_THAT(*value.ErrorOrDie(),
+              StatusIs(absl::StatusCode::kUnknown,
+                       testing::HasSubstr("Int64Value")));
+}
+
 TEST_F(CelProtoWrapperTest, UnwrapAnyWithMissingTypeProvider) {
   TestMessage test_message;
   test_message.set_string_value("test");
@@ -32,15 +32,18 @@
 #include "absl/base/attributes.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
+#include "absl/strings/cord.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
+#include "common/native_type.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/structs/protobuf_value_factory.h"
 #include "eval/testutil/test_message.pb.h"
+#include "internal/any_type_cache.h"
 #include "internal/overflow.h"
 #include "internal/proto_time_encoding.h"
 #include "google/protobuf/descriptor.h"
@@ -71,6 +74,7 @@ using google::protobuf::Value;
 using google::protobuf::Arena;
 using google::protobuf::Descriptor;
 using google::protobuf::DescriptorPool;
+using google::protobuf::FieldDescriptor;
 using google::protobuf::Message;
 using google::protobuf::MessageFactory;
 
@@ -80,6 +84,18 @@ constexpr int64_t kMaxIntJSON = (1ll << 53) - 1;
 // kMinIntJSON is defined as the Number.MIN_SAFE_INTEGER value per EcmaScript 6.
 constexpr int64_t kMinIntJSON = -kMaxIntJSON;
 
+// google.protobuf.BytesValue stores its value as either std::string or
+// absl::Cord, depending on the protobuf build. Strings are referenced without
+// copying, cords are flattened into the arena.
+CelValue CreateBytesFromWrapperValue(const std::string& value, Arena*) {
+  return CelValue::CreateBytes(&value);
+}
+
+CelValue CreateBytesFromWrapperValue(const absl::Cord& value, Arena* arena) {
+  return CelValue::CreateBytes(
+      Arena::Create<std::string>(arena, static_cast<std::string>(value)));
+}
+
 // Forward declaration for google.protobuf.Value
 google::protobuf::Message* MessageFromValue(const CelValue& value, Value* json,
                                   google::protobuf::Arena* arena);
@@ -108,7 +124,13 @@ class DynamicList : public CelList {
   // List size
   int size() const override { return values_->values_size(); }
 
+  const ListValue* values() const { return values_; }
+
  private:
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<DynamicList>();
+  }
+
   Arena* arena_;
   ProtobufValueFactory factory_;
   const ListValue* values_;
@@ -131,7 +153,7 @@ class DynamicMap : public CelMap {
           "Invalid map key type: '", CelValue::TypeName(key.type()), "'"));
     }
 
-    return values_->fields().contains(std::string(str_key.value()));
+    return values_->fields().contains(str_key.value());
   }
 
   absl::optional<CelValue> operator[](CelValue key) const override;
@@ -142,6 +164,8 @@ class DynamicMap : public CelMap {
     return &key_list_;
   }
 
+  const Struct* values() const { return values_; }
+
  private:
   // List of keys in Struct.fields map.
   // It utilizes lazy initialization, to avoid performance penalties.
@@ -179,12 +203,196 @@ class DynamicMap : public CelMap {
     mutable bool initialized_;
   };
 
+  cel::NativeTypeId GetNativeTypeId() const override {
+    return cel::NativeTypeId::For<DynamicMap>();
+  }
+
   Arena* arena_;
   ProtobufValueFactory factory_;
   const Struct* values_;
   const DynamicMapKeyList key_list_;
 };
 
+// Returns the value of a string field without copying it, unless reflection
+// cannot reference the field in place.
+const std::string* StringFieldReference(const Message& message,
+                                        const FieldDescriptor* field,
+                                        Arena* arena) {
+  std::string scratch;
+  const std::string& value =
+      message.GetReflection()->GetStringReference(message, field, &scratch);
+  if (&value != &scratch) {
+    return &value;
+  }
+  return Arena::Create<std::string>(arena, std::move(scratch));
+}
+
+CelValue ValueFromJsonMessage(const Message& message, Arena* arena);
+
+// List implementation viewing a google.protobuf.ListValue which is not of the
+// generated type, e.g. a dynamic message, through reflection.
+class ReflectionListValueList : public CelList {
+ public:
+  ReflectionListValueList(const Message* values, Arena* arena)
+      : arena_(arena),
+        values_(values),
+        values_field_(values->GetDescriptor()->FindFieldByNumber(
+            ListValue::kValuesFieldNumber)) {}
+
+  CelValue operator[](int index) const override {
+    return ValueFromJsonMessage(
+        values_->GetReflection()->GetRepeatedMessage(*values_, values_field_,
+                                                     index),
+        arena_);
+  }
+
+  int size() const override {
+    return values_->GetReflection()->FieldSize(*values_, values_field_);
+  }
+
+ private:
+  Arena* arena_;
+  const Message* values_;
+  const FieldDescriptor* values_field_;
+};
+
+// Map implementation viewing a google.protobuf.Struct which is not of the
+// generated type, e.g. a dynamic message, through reflection. Reflection only
+// exposes the entries of map fields as a list, so an index of the entries by
+// key is built on the first lookup.
+class ReflectionStructMap : public CelMap {
+ public:
+  ReflectionStructMap(const Message* values, Arena* arena)
+      : arena_(arena),
+        values_(values),
+        fields_field_(values->GetDescriptor()->FindFieldByNumber(
+            Struct::kFieldsFieldNumber)),
+        key_list_(this) {}
+
+  absl::StatusOr<bool> Has(const CelValue& key) const override {
+    CelValue::StringHolder str_key;
+    if (!key.GetValue(&str_key)) {
+      // Not a string key.
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Invalid map key type: '", CelValue::TypeName(key.type()), "'"));
+    }
+    return Find(str_key.value()) != nullptr;
+  }
+
+  absl::optional<CelValue> operator[](CelValue key) const override {
+    CelValue::StringHolder str_key;
+    if (!key.GetValue(&str_key)) {
+      // Not a string key.
+      return CreateErrorValue(
+          arena_, absl::InvalidArgumentError(
+                      absl::StrCat("Invalid map key type: '",
+                                   CelValue::TypeName(key.type()), "'")));
+    }
+    const Message* value = Find(str_key.value());
+    if (value == nullptr) {
+      return absl::nullopt;
+    }
+    return ValueFromJsonMessage(*value, arena_);
+  }
+
+  int size() const override {
+    return values_->GetReflection()->FieldSize(*values_, fields_field_);
+  }
+
+  absl::StatusOr<const CelList*> ListKeys() const override {
+    return &key_list_;
+  }
+
+ private:
+  class KeyList : public CelList {
+   public:
+    explicit KeyList(const ReflectionStructMap* map) : map_(map) {}
+
+    CelValue operator[](int index) const override {
+      map_->BuildIndex();
+      return map_->keys_[index];
+    }
+
+    int size() const override { return map_->size(); }
+
+   private:
+    const ReflectionStructMap* map_;
+  };
+
+  const Message* Find(absl::string_view key) const {
+    BuildIndex();
+    auto it = index_.find(key);
+    return it != index_.end() ? it->second : nullptr;
+  }
+
+  void BuildIndex() const {
+    absl::MutexLock lock(&mutex_);
+    if (indexed_) {
+      return;
+    }
+    const auto* reflection = values_->GetReflection();
+    const auto* key_field = fields_field_->message_type()->map_key();
+    const auto* value_field = fields_field_->message_type()->map_value();
+    int size = reflection->FieldSize(*values_, fields_field_);
+    index_.reserve(size);
+    keys_.reserve(size);
+    for (int i = 0; i < size; ++i) {
+      const Message& entry =
+          reflection->GetRepeatedMessage(*values_, fields_field_, i);
+      const std::string* key = StringFieldReference(entry, key_field, arena_);
+      index_[*key] = &entry.GetReflection()->GetMessage(entry, value_field);
+      keys_.push_back(CelValue::CreateString(key));
+    }
+    indexed_ = true;
+  }
+
+  Arena* arena_;
+  const Message* values_;
+  const FieldDescriptor* fields_field_;
+  const KeyList key_list_;
+  mutable absl::Mutex mutex_;
+  // The index and keys are not modified once built.
+  mutable absl::flat_hash_map<absl::string_view, const Message*> index_;
+  mutable std::vector<CelValue> keys_;
+  mutable bool indexed_ = false;
+};
+
+// Converts a google.protobuf.Value, ListValue or Struct message which is not of
+// the generated type, viewing lists and maps in place.
+CelValue ValueFromJsonMessage(const Message& message, Arena* arena) {
+  switch (message.GetDescriptor()->well_known_type()) {
+    case Descriptor::WELLKNOWNTYPE_LISTVALUE:
+      return CelValue::CreateList(
+          Arena::Create<ReflectionListValueList>(arena, &message, arena));
+    case Descriptor::WELLKNOWNTYPE_STRUCT:
+      return CelValue::CreateMap(
+          Arena::Create<ReflectionStructMap>(arena, &message, arena));
+    default:
+      break;
+  }
+  const auto* reflection = message.GetReflection();
+  const FieldDescriptor* kind = reflection->GetOneofFieldDescriptor(
+      message, message.GetDescriptor()->oneof_decl(0));
+  if (kind == nullptr) {
+    return CelValue::CreateNull();
+  }
+  switch (kind->number()) {
+    case Value::kNumberValueFieldNumber:
+      return CelValue::CreateDouble(reflection->GetDouble(message, kind));
+    case Value::kStringValueFieldNumber:
+      return CelValue::CreateString(
+          StringFieldReference(message, kind, arena));
+    case Value::kBoolValueFieldNumber:
+      return CelValue::CreateBool(reflection->GetBool(message, kind));
+    case Value::kStructValueFieldNumber:
+    case Value::kListValueFieldNumber:
+      return ValueFromJsonMessage(reflection->GetMessage(message, kind),
+                                  arena);
+    default:
+      return CelValue::CreateNull();
+  }
+}
+
 // ValueFactory provides ValueFromMessage(....) function family.
 // Functions of this family create CelValue object from specific subtypes of
 // protobuf message.
@@ -228,33 +436,18 @@ class ValueFactory {
   CelValue ValueFromMessage(const Any* any_value,
                             const DescriptorPool* descriptor_pool,
                             MessageFactory* message_factory) {
-    auto type_url = any_value->type_url();
-    auto pos = type_url.find_last_of('/');
-    if (pos == absl::string_view::npos) {
-      // TODO(issues/25) What error code?
-      // Malformed type_url
-      return CreateErrorValue(arena_, "Malformed type_url string");
-    }
-
-    std::string full_name = std::string(type_url.substr(pos + 1));
-    const Descriptor* nested_descriptor =
-        descriptor_pool->FindMessageTypeByName(full_name);
-
-    if (nested_descriptor == nullptr) {
-      // Descriptor not found for the type
-      // TODO(issues/25) What error code?
-      return CreateErrorValue(arena_, "Descriptor not found");
-    }
-
-    const Message* prototype = message_factory->GetPrototype(nested_descriptor);
-    if (prototype == nullptr) {
-      // Failed to obtain prototype for the descriptor
+    auto entry = cel::internal::AnyTypeCache::Resolve(
+        descriptor_pool, message_factory, any_value->type_url());
+    if (!entry.ok()) {
       // TODO(issues/25) What error code?
-      return CreateErrorValue(arena_, "Prototype not found");
+      return CreateErrorValue(arena_, entry.status().message());
     }
+    const Message* prototype = entry->prototype;
 
+    // The type url was already matched against the descriptor, so the payload
+    // is parsed directly rather than through `Any::UnpackTo`.
     Message* nested_message = prototype->New(arena_);
-    if (!any_value->UnpackTo(nested_message)) {
+    if (!nested_message->ParseFromString(any_value->value())) {
       // Failed to unpack.
       // TODO(issues/25) What error code?
       return CreateErrorValue(arena_, "Failed to unpack Any into message");
@@ -300,9 +493,7 @@ class ValueFactory {
   }
 
   CelValue ValueFromMessage(const BytesValue* wrapper) {
-    // BytesValue stores value as Cord
-    return CelValue::CreateBytes(
-        Arena::Create<std::string>(arena_, std::string(wrapper->value())));
+    return CreateBytesFromWrapperValue(wrapper->value(), arena_);
   }
 
   CelValue ValueFromMessage(const Value* value) {
@@ -370,6 +561,20 @@ class ValueFromMessageMaker {
         .ValueFromMessage(message);
   }
 
+  // google.protobuf.Value, ListValue and Struct messages which are not of the
+  // generated types are viewed through reflection instead of being copied,
+  // since JSON-like messages are often large and only partially accessed.
+  template <class MessageType>
+  static CelValue CreateJsonTypeValue(const google::protobuf::Message* msg,
+                                      const ProtobufValueFactory& factory,
+                                      Arena* arena) {
+    if (google::protobuf::DynamicCastToGenerated<const MessageType>(msg) !=
+        nullptr) {
+      return CreateWellknownTypeValue<MessageType>(msg, factory, arena);
+    }
+    return ValueFromJsonMessage(*msg, arena);
+  }
+
   static absl::optional<CelValue> CreateValue(
       const google::protobuf::Message* message, const ProtobufValueFactory& factory,
       Arena* arena) {
@@ -399,11 +604,11 @@ class ValueFromMessageMaker {
       case google::protobuf::Descriptor::WELLKNOWNTYPE_TIMESTAMP:
         return CreateWellknownTypeValue<Timestamp>(message, factory, arena);
       case google::protobuf::Descriptor::WELLKNOWNTYPE_VALUE:
-        return CreateWellknownTypeValue<Value>(message, factory, arena);
+        return CreateJsonTypeValue<Value>(message, factory, arena);
       case google::protobuf::Descriptor::WELLKNOWNTYPE_LISTVALUE:
-        return CreateWellknownTypeValue<ListValue>(message, factory, arena);
+        return CreateJsonTypeValue<ListValue>(message, factory, arena);
       case google::protobuf::Descriptor::WELLKNOWNTYPE_STRUCT:
-        return CreateWellknownTypeValue<Struct>(message, factory, arena);
+        return CreateJsonTypeValue<Struct>(message, factory, arena);
       // WELLKNOWNTYPE_FIELDMASK has no special CelValue type
       default:
         return absl::nullopt;
@@ -429,7 +634,7 @@ absl::optional<CelValue> DynamicMap::operator[](CelValue key) const {
                                         CelValue::TypeName(key.type()), "'")));
   }
 
-  auto it = values_->fields().find(std::string(str_key.value()));
+  auto it = values_->fields().find(str_key.value());
   if (it == values_->fields().end()) {
     return absl::nullopt;
   }
@@ -587,6 +792,11 @@ google::protobuf::Message* MessageFromValue(const CelValue& value, ListValue* js
     return nullptr;
   }
   const CelList& list = *value.ListOrDie();
+  if (const ListValue* backing = GetBackingListValue(list);
+      backing != nullptr) {
+    json_list->CopyFrom(*backing);
+    return json_list;
+  }
   for (int i = 0; i < list.size(); i++) {
     auto e = list.Get(arena, i);
     Value* elem = json_list->add_values();
@@ -604,6 +814,10 @@ google::protobuf::Message* MessageFromValue(const CelValue& value, Struct* json_
     return nullptr;
   }
   const CelMap& map = *value.MapOrDie();
+  if (const Struct* backing = GetBackingStruct(map); backing != nullptr) {
+    json_struct->CopyFrom(*backing);
+    return json_struct;
+  }
   absl::StatusOr<const CelList*> keys_or = map.ListKeys(arena);
   if (!keys_or.ok()) {
     // If map doesn't support listing keys, it can't pack into a Struct value.
@@ -625,13 +839,12 @@ google::protobuf::Message* MessageFromValue(const CelValue& value, Struct* json_
     if (!v.has_value()) {
       return nullptr;
     }
-    Value field_value;
-    auto result = MessageFromValue(*v, &field_value, arena);
+    // Built in place, rather than copied into the map.
+    auto result = MessageFromValue(*v, &(*fields)[std::string(key)], arena);
     // If the value is not a valid JSON type, abort the conversion.
     if (result == nullptr) {
       return nullptr;
     }
-    (*fields)[std::string(key)] = field_value;
   }
   return json_struct;
 }
@@ -941,8 +1154,54 @@ CelValue UnwrapMessageToValue(const google::protobuf::Message* value,
   return factory(value);
 }
 
+struct ProtoJsonContainerAccess final {
+  static cel::NativeTypeId TypeId(const CelList& list) {
+    return list.GetNativeTypeId();
+  }
+
+  static cel::NativeTypeId TypeId(const CelMap& map) {
+    return map.GetNativeTypeId();
+  }
+};
+
+const ListValue* GetBackingListValue(const CelList& list) {
+  if (ProtoJsonContainerAccess::TypeId(list) !=
+      cel::NativeTypeId::For<DynamicList>()) {
+    return nullptr;
+  }
+  return static_cast<const DynamicList&>(list).values();
+}
+
+const Struct* GetBackingStruct(const CelMap& map) {
+  if (ProtoJsonContainerAccess::TypeId(map) !=
+      cel::NativeTypeId::For<DynamicMap>()) {
+    return nullptr;
+  }
+  return static_cast<const DynamicMap&>(map).values();
+}
+
 const google::protobuf::Message* MaybeWrapValueToMessage(
     const google::protobuf::Descriptor* descriptor, const CelValue& value, Arena* arena) {
+  // Lists and maps read from a message already have the representation of the
+  // target, which is handed through rather than copied.
+  if (descriptor->well_known_type() ==
+          google::protobuf::Descriptor::WELLKNOWNTYPE_LISTVALUE &&
+      value.IsList()) {
+    if (const ListValue* backing = GetBackingListValue(*value.ListOrDie());
+        backing != nullptr &&
+        backing->GetDescriptor()->full_name() == descriptor->full_name()) {
+      return backing;
+    }
+  }
+  if (descriptor->well_known_type() ==
+          google::protobuf::Descriptor::WELLKNOWNTYPE_STRUCT &&
+      value.IsMap()) {
+    if (const Struct* backing = GetBackingStruct(*value.MapOrDie());
+        backing != nullptr &&
+        backing->GetDescriptor()->full_name() == descriptor->full_name()) {
+      return backing;
+    }
+  }
   google::protobuf::Message* msg =
       MessageFromValueMaker::MaybeWrapMessage(descriptor, value, arena);
   return msg;
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_CEL_PROTO_WRAP_UTIL_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_CEL_PROTO_WRAP_UTIL_H_
 
+#include "google/protobuf/struct.pb.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/structs/protobuf_value_factory.h"
 
@@ -39,6 +40,13 @@ const google::protobuf::Message* MaybeWrapValueToMessage(
     const google::protobuf::Descriptor* descriptor, const CelValue& value,
     google::protobuf::Arena* arena);
 
+// Returns the message viewed by `list` or `map` if it was created by
+// UnwrapMessageToValue for a google.protobuf.ListValue or
+// google.protobuf.Struct, and null otherwise. Such values can be exported by
+// copying the message, rather than element by element.
+const google::protobuf::ListValue* GetBackingListValue(const CelList& list);
+const google::protobuf::Struct* GetBackingStruct(const CelMap& map);
+
 }  // namespace google::api::expr::runtime::internal
 
 #endif  // THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_CEL_PROTO_WRAP_UTIL_H_
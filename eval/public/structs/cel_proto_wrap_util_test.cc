@@ -49,6 +49,7 @@ namespace google::api::expr::runtime::internal {
 namespace {
 
 using testing::Eq;
+using testing::UnorderedElementsAre;
 using testing::UnorderedPointwise;
 
 using google::protobuf::Duration;
@@ -346,6 +347,68 @@ TEST_F(CelProtoWrapperTest, UnwrapDynamicStruct) {
   }
 }
 
+TEST_F(CelProtoWrapperTest, UnwrapDynamicStructIsView) {
+  Struct struct_msg;
+  const std::string kField = "field";
+  (*struct_msg.mutable_fields())[kField].set_string_value("value");
+  (*struct_msg.mutable_fields())["list"]
+      .mutable_list_value()
+      ->add_values()
+      ->set_bool_value(true);
+  auto dynamic_struct = ReflectedCopy(struct_msg);
+  CelValue value = UnwrapMessageToValue(dynamic_struct.get(),
+                                        &ProtobufValueFactoryImpl, arena());
+  ASSERT_TRUE(value.IsMap());
+  const CelMap* cel_map = value.MapOrDie();
+  EXPECT_EQ(cel_map->size(), 2);
+
+  auto lookup = (*cel_map)[CelValue::CreateString(&kField)];
+  ASSERT_TRUE(lookup.has_value() && lookup->IsString());
+  EXPECT_EQ(lookup->StringOrDie().value(), "value");
+
+  auto list = (*cel_map)[CelValue::CreateStringView("list")];
+  ASSERT_TRUE(list.has_value() && list->IsList());
+  ASSERT_EQ(list->ListOrDie()->size(), 1);
+  EXPECT_TRUE((*list->ListOrDie())[0].BoolOrDie());
+
+  EXPECT_FALSE((*cel_map)[CelValue::CreateStringView("missing")].has_value());
+  ASSERT_OK_AND_ASSIGN(bool has, cel_map->Has(CelValue::CreateString(&kField)));
+  EXPECT_TRUE(has);
+
+  ASSERT_OK_AND_ASSIGN(const CelList* keys, cel_map->ListKeys());
+  ASSERT_EQ(keys->size(), 2);
+  std::vector<std::string> key_names;
+  for (int i = 0; i < keys->size(); ++i) {
+    key_names.push_back(std::string((*keys)[i].StringOrDie().value()));
+  }
+  EXPECT_THAT(key_names, UnorderedElementsAre("field", "list"));
+}
+
+TEST_F(CelProtoWrapperTest, WrapUnwrappedStructIsNotCopied) {
+  Struct struct_msg;
+  (*struct_msg.mutable_fields())["list"]
+      .mutable_list_value()
+      ->add_values()
+      ->set_number_value(1);
+  CelValue value =
+      UnwrapMessageToValue(&struct_msg, &ProtobufValueFactoryImpl, arena());
+  ASSERT_TRUE(value.IsMap());
+  EXPECT_EQ(GetBackingStruct(*value.MapOrDie()), &struct_msg);
+  EXPECT_EQ(MaybeWrapValueToMessage(Struct::descriptor(), value, arena()),
+            &struct_msg);
+
+  auto list = (*value.MapOrDie())[CelValue::CreateStringView("list")];
+  ASSERT_TRUE(list.has_value() && list->IsList());
+  const ListValue* list_msg = &struct_msg.fields().at("list").list_value();
+  EXPECT_EQ(GetBackingListValue(*list->ListOrDie()), list_msg);
+  EXPECT_EQ(MaybeWrapValueToMessage(ListValue::descriptor(), *list, arena()),
+            list_msg);
+
+  // Values built by expressions are not backed by a message.
+  ContainerBackedListImpl cel_list({CelValue::CreateInt64(1)});
+  EXPECT_EQ(GetBackingListValue(cel_list), nullptr);
+}
+
 TEST_F(CelProtoWrapperTest, UnwrapDynamicValueStruct) {
   const std::string kField1 = "field1";
   const std::string kField2 = "field2";
@@ -0,0 +1,180 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/public/structs/compiled_field_accessors.h"
+
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "eval/public/cel_value.h"
+#include "internal/no_destructor.h"
+#include "internal/status_macros.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+namespace google::api::expr::runtime {
+
+namespace {
+
+using ::google::protobuf::Descriptor;
+using ::google::protobuf::FieldDescriptor;
+
+absl::Status ValidateAccessor(const CompiledFieldAccessor& accessor,
+                              const FieldDescriptor*& field) {
+  if (accessor.getter == nullptr) {
+    return absl::InvalidArgumentError("compiled field getter is null");
+  }
+  if (accessor.prototype->GetDescriptor() != accessor.descriptor) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("prototype is not a ", accessor.descriptor->full_name()));
+  }
+  field = accessor.descriptor->FindFieldByName(accessor.field_name);
+  if (field == nullptr) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("no_such_field : ", accessor.descriptor->full_name(), ".",
+                     accessor.field_name));
+  }
+  if (field->is_repeated()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "compiled getters are not supported for repeated field ",
+        field->full_name()));
+  }
+  if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+      field->message_type()->well_known_type() !=
+          Descriptor::WELLKNOWNTYPE_UNSPECIFIED) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "compiled getters are not supported for well known type field ",
+        field->full_name()));
+  }
+  if (accessor.presence != nullptr && !field->has_presence()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "compiled presence tests are not supported for field without "
+        "explicit presence ",
+        field->full_name()));
+  }
+  return absl::OkStatus();
+}
+
+// Returns whether value, read from a field without explicit presence, differs
+// from the default value.
+bool IsNonDefault(const CelValue& value) {
+  switch (value.type()) {
+    case CelValue::Type::kBool:
+      return value.BoolOrDie();
+    case CelValue::Type::kInt64:
+      return value.Int64OrDie() != 0;
+    case CelValue::Type::kUint64:
+      return value.Uint64OrDie() != 0;
+    case CelValue::Type::kDouble:
+      // Negative zero is present, as with reflection.
+      return std::signbit(value.DoubleOrDie()) || value.DoubleOrDie() != 0;
+    case CelValue::Type::kString:
+      return !value.StringOrDie().value().empty();
+    case CelValue::Type::kBytes:
+      return !value.BytesOrDie().value().empty();
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+CompiledFieldAccessorRegistry& CompiledFieldAccessorRegistry::Global() {
+  static cel::internal::NoDestructor<CompiledFieldAccessorRegistry> registry;
+  return *registry;
+}
+
+absl::Status CompiledFieldAccessorRegistry::Register(
+    const CompiledFieldAccessor& accessor) {
+  return Register(absl::MakeConstSpan(&accessor, 1));
+}
+
+absl::Status CompiledFieldAccessorRegistry::Register(
+    absl::Span<const CompiledFieldAccessor> accessors) {
+  // Validate everything first, so a failed registration changes nothing.
+  std::vector<std::pair<const FieldDescriptor*, Entry>> entries;
+  entries.reserve(accessors.size());
+  for (const auto& accessor : accessors) {
+    const FieldDescriptor* field = nullptr;
+    CEL_RETURN_IF_ERROR(ValidateAccessor(accessor, field));
+    entries.push_back(
+        {field, Entry{accessor.prototype->GetReflection(), accessor.getter,
+                      accessor.presence}});
+  }
+  absl::MutexLock lock(&mutex_);
+  for (auto& entry : entries) {
+    entries_.insert_or_assign(entry.first, entry.second);
+  }
+  empty_.store(entries_.empty(), std::memory_order_release);
+  return absl::OkStatus();
+}
+
+const CompiledFieldAccessorRegistry::Entry*
+CompiledFieldAccessorRegistry::FindEntry(
+    const google::protobuf::Message& message,
+    const FieldDescriptor* field) const {
+  auto it = entries_.find(field);
+  if (it == entries_.end() ||
+      it->second.reflection != message.GetReflection()) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
+CompiledFieldGetter CompiledFieldAccessorRegistry::Find(
+    const google::protobuf::Message& message,
+    const FieldDescriptor* field) const {
+  if (empty_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  absl::ReaderMutexLock lock(&mutex_);
+  const Entry* entry = FindEntry(message, field);
+  return entry != nullptr ? entry->getter : nullptr;
+}
+
+absl::optional<bool> CompiledFieldAccessorRegistry::TestPresence(
+    const google::protobuf::Message& message,
+    const FieldDescriptor* field) const {
+  if (empty_.load(std::memory_order_acquire)) {
+    return absl::nullopt;
+  }
+  CompiledFieldGetter getter;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    const Entry* entry = FindEntry(message, field);
+    if (entry == nullptr) {
+      return absl::nullopt;
+    }
+    if (field->has_presence()) {
+      if (entry->presence == nullptr) {
+        return absl::nullopt;
+      }
+      return entry->presence(message);
+    }
+    getter = entry->getter;
+  }
+  // Fields without explicit presence are never messages, so the getter needs
+  // neither the message factory nor the arena.
+  return IsNonDefault(getter(message, field, /*factory=*/nullptr,
+                             /*arena=*/nullptr));
+}
+
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,208 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_COMPILED_FIELD_ACCESSORS_H_
+#define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_COMPILED_FIELD_ACCESSORS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/structs/protobuf_value_factory.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+namespace google::api::expr::runtime {
+
+// Reads a singular field of a generated message with the compiled accessor,
+// rather than through `google::protobuf::Reflection`. `message` is guaranteed
+// to be an instance of the generated type the getter was registered for.
+using CompiledFieldGetter = CelValue (*)(
+    const google::protobuf::Message& message,
+    const google::protobuf::FieldDescriptor* field,
+    internal::ProtobufValueFactory factory, google::protobuf::Arena* arena);
+
+// Tests the presence of a field with explicit presence with the generated
+// hazzer, which reads the has-bit (or the message pointer) directly.
+using CompiledFieldPresence =
+    bool (*)(const google::protobuf::Message& message);
+
+// A compiled getter and the generated message field it reads. Usually created
+// with `CEL_COMPILED_FIELD_ACCESSOR`.
+struct CompiledFieldAccessor final {
+  absl::Nonnull<const google::protobuf::Descriptor*> descriptor;
+  // The default instance of the generated type, identifying its reflection.
+  absl::Nonnull<const google::protobuf::Message*> prototype;
+  std::string field_name;
+  CompiledFieldGetter getter;
+  // Optional hazzer for fields with explicit presence, usually set with
+  // `CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE`. The presence of fields
+  // without explicit presence is read with the getter.
+  CompiledFieldPresence presence = nullptr;
+};
+
+// Registry of compiled getters for the fields of hot message types linked
+// into the binary. `ProtoMessageTypeAdapter` prefers a registered getter over
+// reflection when reading a field, which avoids the reflection dispatch on
+// the field type and the offset lookups for every field read.
+//
+// Only singular fields which are not extensions and whose type is not a
+// well known type may be registered, as the others need the conversions
+// implemented by the reflection path. Getters are only used for messages of
+// the generated type, so dynamic messages of the same type fall back to
+// reflection.
+//
+// `has()` tests of registered fields are answered from the generated code as
+// well: with the registered hazzer for fields with explicit presence, and by
+// comparing the value read by the getter with the default otherwise.
+//
+// Registration is expected at startup. Lookups take a shared lock, and are
+// skipped entirely while nothing is registered.
+class CompiledFieldAccessorRegistry final {
+ public:
+  // Returns the registry consulted by `ProtoMessageTypeAdapter`.
+  static CompiledFieldAccessorRegistry& Global();
+
+  CompiledFieldAccessorRegistry() = default;
+
+  CompiledFieldAccessorRegistry(const CompiledFieldAccessorRegistry&) = delete;
+  CompiledFieldAccessorRegistry& operator=(
+      const CompiledFieldAccessorRegistry&) = delete;
+
+  // Registers `accessor`, replacing any getter previously registered for the
+  // same field. Returns `absl::StatusCode::kInvalidArgument` if the field
+  // does not exist or cannot have a compiled getter.
+  absl::Status Register(const CompiledFieldAccessor& accessor)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  absl::Status Register(absl::Span<const CompiledFieldAccessor> accessors)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the getter registered for `field` if `message` is an instance of
+  // the generated type it was registered for, otherwise null.
+  absl::Nullable<CompiledFieldGetter> Find(
+      const google::protobuf::Message& message,
+      absl::Nonnull<const google::protobuf::FieldDescriptor*> field) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns whether `field` is present in `message`, following the proto
+  // presence rules, if `message` is an instance of the generated type the
+  // field was registered for and its presence can be tested without
+  // reflection. Otherwise returns nullopt.
+  absl::optional<bool> TestPresence(
+      const google::protobuf::Message& message,
+      absl::Nonnull<const google::protobuf::FieldDescriptor*> field) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry final {
+    const google::protobuf::Reflection* reflection;
+    CompiledFieldGetter getter;
+    CompiledFieldPresence presence;
+  };
+
+  absl::Nullable<const Entry*> FindEntry(
+      const google::protobuf::Message& message,
+      absl::Nonnull<const google::protobuf::FieldDescriptor*> field) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  std::atomic<bool> empty_ = true;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<const google::protobuf::FieldDescriptor*, Entry> entries_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+namespace internal {
+
+template <typename T>
+inline constexpr bool kAlwaysFalse = false;
+
+template <typename MessageType, auto Getter>
+CelValue CompiledFieldGetterImpl(const google::protobuf::Message& message,
+                                 const google::protobuf::FieldDescriptor* field,
+                                 ProtobufValueFactory factory,
+                                 google::protobuf::Arena* arena) {
+  const auto& typed = static_cast<const MessageType&>(message);
+  const auto& value = (typed.*Getter)();
+  using T = std::decay_t<decltype(value)>;
+  if constexpr (std::is_same_v<T, bool>) {
+    return CelValue::CreateBool(value);
+  } else if constexpr (std::is_same_v<T, int32_t> ||
+                       std::is_same_v<T, int64_t> || std::is_enum_v<T>) {
+    return CelValue::CreateInt64(static_cast<int64_t>(value));
+  } else if constexpr (std::is_same_v<T, uint32_t> ||
+                       std::is_same_v<T, uint64_t>) {
+    return CelValue::CreateUint64(static_cast<uint64_t>(value));
+  } else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) {
+    return CelValue::CreateDouble(static_cast<double>(value));
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return field->type() == google::protobuf::FieldDescriptor::TYPE_BYTES
+               ? CelValue::CreateBytes(&value)
+               : CelValue::CreateString(&value);
+  } else if constexpr (std::is_base_of_v<google::protobuf::Message, T>) {
+    return factory(&value);
+  } else {
+    static_assert(kAlwaysFalse<T>, "unsupported field type");
+  }
+}
+
+template <typename MessageType, auto Hazzer>
+bool CompiledFieldPresenceImpl(const google::protobuf::Message& message) {
+  return (static_cast<const MessageType&>(message).*Hazzer)();
+}
+
+}  // namespace internal
+
+}  // namespace google::api::expr::runtime
+
+// Creates a `CompiledFieldAccessor` for the field `field_name` of the
+// generated message `message_type`, reading it with the generated getter of
+// the same name. For example:
+//
+//   CompiledFieldAccessorRegistry::Global().Register({
+//       CEL_COMPILED_FIELD_ACCESSOR(RequestContext, a),
+//       CEL_COMPILED_FIELD_ACCESSOR(RequestContext::A, b),
+//   });
+#define CEL_COMPILED_FIELD_ACCESSOR(message_type, field_name)          \
+  ::google::api::expr::runtime::CompiledFieldAccessor {                 \
+    message_type::descriptor(), &message_type::default_instance(),      \
+        #field_name,                                                    \
+        &::google::api::expr::runtime::internal::CompiledFieldGetterImpl< \
+            message_type, &message_type::field_name>                    \
+  }
+
+// Like `CEL_COMPILED_FIELD_ACCESSOR`, additionally testing the presence of the
+// field with the generated `has_` method. Only valid for fields with explicit
+// presence, e.g. message fields, proto3 `optional` fields and proto2 fields.
+#define CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE(message_type, field_name) \
+  ::google::api::expr::runtime::CompiledFieldAccessor {                     \
+    message_type::descriptor(), &message_type::default_instance(),          \
+        #field_name,                                                        \
+        &::google::api::expr::runtime::internal::CompiledFieldGetterImpl<    \
+            message_type, &message_type::field_name>,                       \
+        &::google::api::expr::runtime::internal::CompiledFieldPresenceImpl<  \
+            message_type, &message_type::has_##field_name>                  \
+  }
+
+#endif  // THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_COMPILED_FIELD_ACCESSORS_H_
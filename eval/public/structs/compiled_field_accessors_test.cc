@@ -0,0 +1,206 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval/public/structs/compiled_field_accessors.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/message_wrapper.h"
+#include "eval/public/testing/matchers.h"
+#include "eval/testutil/test_message.pb.h"
+#include "internal/testing.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/message.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using cel::internal::StatusIs;
+using testing::Eq;
+using testing::IsNull;
+using testing::NotNull;
+using testing::Optional;
+
+CelValue MessageValue(const google::protobuf::Message* message) {
+  return CelValue::CreateMessageWrapper(MessageWrapper(message, nullptr));
+}
+
+const google::protobuf::FieldDescriptor* Field(absl::string_view name) {
+  return TestMessage::descriptor()->FindFieldByName(std::string(name));
+}
+
+CelValue Get(const CompiledFieldAccessorRegistry& registry,
+             const google::protobuf::Message& message, absl::string_view name,
+             google::protobuf::Arena* arena) {
+  CompiledFieldGetter getter = registry.Find(message, Field(name));
+  EXPECT_THAT(getter, NotNull()) << name;
+  return getter(message, Field(name), &MessageValue, arena);
+}
+
+TEST(CompiledFieldAccessorRegistry, Scalars) {
+  google::protobuf::Arena arena;
+  CompiledFieldAccessorRegistry registry;
+  ASSERT_OK(registry.Register({
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int32_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, uint64_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, double_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, bool_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, enum_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, string_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, bytes_value),
+  }));
+
+  TestMessage message;
+  message.set_int32_value(-1);
+  message.set_uint64_value(2);
+  message.set_double_value(1.5);
+  message.set_bool_value(true);
+  message.set_enum_value(TestMessage::TEST_ENUM_2);
+  message.set_string_value("foo");
+  message.set_bytes_value("bar");
+
+  EXPECT_THAT(Get(registry, message, "int32_value", &arena),
+              test::IsCelInt64(-1));
+  EXPECT_THAT(Get(registry, message, "uint64_value", &arena),
+              test::IsCelUint64(2));
+  EXPECT_THAT(Get(registry, message, "double_value", &arena),
+              test::IsCelDouble(1.5));
+  EXPECT_THAT(Get(registry, message, "bool_value", &arena),
+              test::IsCelBool(true));
+  EXPECT_THAT(Get(registry, message, "enum_value", &arena),
+              test::IsCelInt64(TestMessage::TEST_ENUM_2));
+  EXPECT_THAT(Get(registry, message, "string_value", &arena),
+              test::IsCelString("foo"));
+  EXPECT_THAT(Get(registry, message, "bytes_value", &arena),
+              test::IsCelBytes("bar"));
+}
+
+TEST(CompiledFieldAccessorRegistry, Message) {
+  google::protobuf::Arena arena;
+  CompiledFieldAccessorRegistry registry;
+  ASSERT_OK(registry.Register(
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, message_value)));
+
+  TestMessage message;
+  // Unset message fields read as the default instance, as with reflection.
+  CelValue value = Get(registry, message, "message_value", &arena);
+  ASSERT_TRUE(value.IsMessage());
+  EXPECT_EQ(value.MessageOrDie(), &TestMessage::default_instance());
+
+  message.mutable_message_value()->set_int64_value(3);
+  value = Get(registry, message, "message_value", &arena);
+  ASSERT_TRUE(value.IsMessage());
+  EXPECT_EQ(value.MessageOrDie(), &message.message_value());
+}
+
+TEST(CompiledFieldAccessorRegistry, Unregistered) {
+  CompiledFieldAccessorRegistry registry;
+  TestMessage message;
+  EXPECT_THAT(registry.Find(message, Field("int64_value")), IsNull());
+
+  ASSERT_OK(registry.Register(
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int32_value)));
+  EXPECT_THAT(registry.Find(message, Field("int64_value")), IsNull());
+}
+
+TEST(CompiledFieldAccessorRegistry, DynamicMessageUsesReflection) {
+  CompiledFieldAccessorRegistry registry;
+  ASSERT_OK(registry.Register(
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int64_value)));
+
+  google::protobuf::DynamicMessageFactory factory;
+  std::unique_ptr<google::protobuf::Message> message(
+      factory.GetPrototype(TestMessage::descriptor())->New());
+  EXPECT_THAT(registry.Find(*message, Field("int64_value")), IsNull());
+}
+
+TEST(CompiledFieldAccessorRegistry, RejectsUnsupportedFields) {
+  CompiledFieldAccessorRegistry registry;
+  // Getters of repeated fields do not compile, so reuse another getter.
+  CompiledFieldAccessor repeated =
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int64_value);
+  repeated.field_name = "int64_list";
+  EXPECT_THAT(registry.Register(repeated),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(registry.Register(
+                  CEL_COMPILED_FIELD_ACCESSOR(TestMessage, timestamp_value)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(registry.Register(CompiledFieldAccessor{
+                  TestMessage::descriptor(), &TestMessage::default_instance(),
+                  "no_such_field", repeated.getter}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // A failed registration registers none of the accessors.
+  EXPECT_THAT(registry.Register({
+                  CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int64_value),
+                  repeated,
+              }),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  TestMessage message;
+  EXPECT_THAT(registry.Find(message, Field("int64_value")), IsNull());
+}
+
+TEST(CompiledFieldAccessorRegistry, Presence) {
+  CompiledFieldAccessorRegistry registry;
+  ASSERT_OK(registry.Register({
+      CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE(TestMessage, message_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, int32_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, string_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, double_value),
+  }));
+
+  TestMessage message;
+  EXPECT_THAT(registry.TestPresence(message, Field("message_value")),
+              Optional(false));
+  EXPECT_THAT(registry.TestPresence(message, Field("int32_value")),
+              Optional(false));
+  EXPECT_THAT(registry.TestPresence(message, Field("string_value")),
+              Optional(false));
+  EXPECT_THAT(registry.TestPresence(message, Field("double_value")),
+              Optional(false));
+  EXPECT_THAT(registry.TestPresence(message, Field("int64_value")),
+              Eq(absl::nullopt));
+
+  message.mutable_message_value();
+  message.set_int32_value(1);
+  message.set_string_value("foo");
+  message.set_double_value(-0.0);
+  for (absl::string_view name :
+       {"message_value", "int32_value", "string_value", "double_value"}) {
+    EXPECT_THAT(registry.TestPresence(message, Field(name)), Optional(true))
+        << name;
+    // Agrees with reflection.
+    EXPECT_TRUE(message.GetReflection()->HasField(message, Field(name)))
+        << name;
+  }
+}
+
+TEST(CompiledFieldAccessorRegistry, RejectsPresenceOfImplicitFields) {
+  CompiledFieldAccessorRegistry registry;
+  CompiledFieldAccessor accessor =
+      CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE(TestMessage, message_value);
+  accessor.field_name = "int32_value";
+  EXPECT_THAT(registry.Register(accessor),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -24,6 +24,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "base/attribute.h"
 #include "base/memory.h"
@@ -70,6 +71,18 @@ class LegacyTypeMutationApis {
       CelValue::MessageWrapper::Builder& instance) const {
     return absl::UnimplementedError("SetFieldByNumber is not yet implemented");
   }
+
+  // Set the field identified by hint, as returned in
+  // LegacyTypeInfoApis::FieldDescription, on instance to value. Planners
+  // resolve the hint once, so that setting the field skips looking it up.
+  // Returns false without setting anything if hint does not apply to the type
+  // of instance.
+  virtual absl::StatusOr<bool> SetFieldByHint(
+      const void* hint, const CelValue& value,
+      cel::MemoryManagerRef memory_manager,
+      CelValue::MessageWrapper::Builder& instance) const {
+    return false;
+  }
 };
 
 // Interface for access apis.
@@ -98,6 +111,33 @@ class LegacyTypeAccessApis {
       ProtoWrapperTypeOptions unboxing_option,
       cel::MemoryManagerRef memory_manager) const = 0;
 
+  // Return an implementation-specific hint identifying field_name on the type
+  // of instance, or nullptr if there is no such field or hints are not
+  // supported. Callers which access the same field repeatedly, such as select
+  // steps, resolve the hint once and pass it to GetFieldByHint and
+  // HasFieldByHint to skip looking up the field by name.
+  virtual const void* FindFieldHint(
+      absl::string_view field_name,
+      const CelValue::MessageWrapper& instance) const {
+    return nullptr;
+  }
+
+  // Access the field identified by hint on instance. Returns absl::nullopt if
+  // hint does not apply to the type of instance.
+  virtual absl::StatusOr<absl::optional<CelValue>> GetFieldByHint(
+      const void* hint, const CelValue::MessageWrapper& instance,
+      ProtoWrapperTypeOptions unboxing_option,
+      cel::MemoryManagerRef memory_manager) const {
+    return absl::nullopt;
+  }
+
+  // Return whether the field identified by hint is set on instance, or
+  // absl::nullopt if hint does not apply to the type of instance.
+  virtual absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      const void* hint, const CelValue::MessageWrapper& instance) const {
+    return absl::nullopt;
+  }
+
   // Apply a series of select operations on the given instance.
   //
   // Each select qualifier may represent either a singular field access (
@@ -114,9 +154,12 @@ class LegacyTypeAccessApis {
   // - presence_test controls whether to treat the call as a 'has' call,
   // returning
   //   whether the leaf field is set to a non-default value.
+  // - unboxing_option controls the value of an unset wrapper typed leaf field,
+  //   as for GetField.
   virtual absl::StatusOr<LegacyQualifyResult> Qualify(
       absl::Span<const cel::SelectQualifier>,
       const CelValue::MessageWrapper& instance, bool presence_test,
+      ProtoWrapperTypeOptions unboxing_option,
       cel::MemoryManagerRef memory_manager) const {
     return absl::UnimplementedError("Qualify unsupported.");
   }
@@ -44,6 +44,9 @@ class LegacyTypeInfoApis {
   struct FieldDescription {
     int number;
     absl::string_view name;
+    // Implementation-specific hint identifying the field, which
+    // LegacyTypeMutationApis::SetFieldByHint accepts. May be nullptr.
+    const void* hint = nullptr;
   };
 
   virtual ~LegacyTypeInfoApis() = default;
@@ -14,6 +14,7 @@
 
 #include "eval/public/structs/proto_message_type_adapter.h"
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <string>
@@ -42,6 +43,7 @@
 #include "eval/public/containers/internal_field_backed_map_impl.h"
 #include "eval/public/message_wrapper.h"
 #include "eval/public/structs/cel_proto_wrap_util.h"
+#include "eval/public/structs/compiled_field_accessors.h"
 #include "eval/public/structs/field_access_impl.h"
 #include "eval/public/structs/legacy_type_adapter.h"
 #include "eval/public/structs/legacy_type_info_apis.h"
@@ -145,7 +147,14 @@ bool CelFieldIsPresent(const google::protobuf::Message* message,
     return reflection->FieldSize(*message, field_desc) != 0;
   }
 
-  // Standard proto presence test for non-repeated fields.
+  // Standard proto presence test for non-repeated fields, read from the
+  // generated code if the field has compiled accessors.
+  if (absl::optional<bool> present =
+          CompiledFieldAccessorRegistry::Global().TestPresence(*message,
+                                                               field_desc);
+      present.has_value()) {
+    return *present;
+  }
   return reflection->HasField(*message, field_desc);
 }
 
@@ -187,6 +196,12 @@ absl::StatusOr<CelValue> CreateCelValueFromField(
     return CelValue::CreateList(list);
   }
 
+  if (CompiledFieldGetter getter =
+          CompiledFieldAccessorRegistry::Global().Find(*message, field_desc);
+      getter != nullptr) {
+    return getter(*message, field_desc, &MessageCelValueFactory, arena);
+  }
+
   CEL_ASSIGN_OR_RETURN(
       CelValue result,
       internal::CreateValueFromSingleField(message, field_desc, unboxing_option,
@@ -217,6 +232,57 @@ absl::StatusOr<CelValue> GetFieldImpl(const google::protobuf::Message* message,
   return CreateCelValueFromField(message, field_desc, unboxing_option, arena);
 }
 
+// Shared implementation for FindFieldHint. The hint is the field descriptor,
+// whose containing type identifies the message type it applies to.
+const void* FindFieldHintImpl(const google::protobuf::Message* message,
+                              absl::string_view field_name) {
+  const Reflection* reflection = message->GetReflection();
+  if (reflection == nullptr) {
+    return nullptr;
+  }
+  const FieldDescriptor* field_desc =
+      message->GetDescriptor()->FindFieldByName(field_name);
+  if (field_desc == nullptr) {
+    field_desc = reflection->FindKnownExtensionByName(std::string(field_name));
+  }
+  return field_desc;
+}
+
+// Returns the field descriptor laundered through hint, or nullptr if it is not
+// a field of message.
+const FieldDescriptor* FieldFromHint(const google::protobuf::Message* message,
+                                     const void* hint) {
+  const auto* field_desc = static_cast<const FieldDescriptor*>(hint);
+  if (field_desc == nullptr ||
+      field_desc->containing_type() != message->GetDescriptor()) {
+    return nullptr;
+  }
+  return field_desc;
+}
+
+// Shared implementation for GetFieldByHint.
+absl::StatusOr<absl::optional<CelValue>> GetFieldByHintImpl(
+    const google::protobuf::Message* message, const void* hint,
+    ProtoWrapperTypeOptions unboxing_option,
+    cel::MemoryManagerRef memory_manager) {
+  const FieldDescriptor* field_desc = FieldFromHint(message, hint);
+  if (field_desc == nullptr) {
+    return absl::nullopt;
+  }
+  return CreateCelValueFromField(message, field_desc, unboxing_option,
+                                 ProtoMemoryManagerArena(memory_manager));
+}
+
+// Shared implementation for HasFieldByHint.
+absl::StatusOr<absl::optional<bool>> HasFieldByHintImpl(
+    const google::protobuf::Message* message, const void* hint) {
+  const FieldDescriptor* field_desc = FieldFromHint(message, hint);
+  if (field_desc == nullptr) {
+    return absl::nullopt;
+  }
+  return CelFieldIsPresent(message, field_desc, message->GetReflection());
+}
+
 const google::protobuf::FieldDescriptor* GetNormalizedFieldByNumber(
     const google::protobuf::Descriptor* descriptor, const google::protobuf::Reflection* reflection,
     int field_number) {
@@ -316,11 +382,13 @@ class QualifyState {
  public:
   QualifyState(absl::Nonnull<const Message*> message,
                absl::Nonnull<const Descriptor*> descriptor,
-               absl::Nonnull<const Reflection*> reflection)
+               absl::Nonnull<const Reflection*> reflection,
+               ProtoWrapperTypeOptions unboxing_option)
       : message_(message),
         descriptor_(descriptor),
         reflection_(reflection),
-        repeated_field_desc_(nullptr) {}
+        repeated_field_desc_(nullptr),
+        unboxing_option_(unboxing_option) {}
 
   QualifyState(const QualifyState&) = delete;
   QualifyState& operator=(const QualifyState&) = delete;
@@ -419,10 +487,9 @@ class QualifyState {
 
     if (field_desc->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
         IsUnsupportedQualifyType(*field_desc->message_type())) {
-      CEL_ASSIGN_OR_RETURN(
-          result_,
-          CreateCelValueFromField(message_, field_desc,
-                                  ProtoWrapperTypeOptions::kUnsetNull, arena));
+      CEL_ASSIGN_OR_RETURN(result_,
+                           CreateCelValueFromField(message_, field_desc,
+                                                   unboxing_option_, arena));
 
       return absl::OkStatus();
     }
@@ -559,8 +626,8 @@ class QualifyState {
     if (field_desc == nullptr) {
       return CreateNoSuchFieldError(arena, specifier.name);
     }
-    return CreateCelValueFromField(message_, field_desc,
-                                   ProtoWrapperTypeOptions::kUnsetNull, arena);
+    return CreateCelValueFromField(message_, field_desc, unboxing_option_,
+                                   arena);
   }
 
   absl::StatusOr<CelValue> ApplyLastQualifierGetList(
@@ -599,15 +666,18 @@ class QualifyState {
   absl::Nonnull<const Descriptor*> descriptor_;
   absl::Nonnull<const Reflection*> reflection_;
   absl::Nullable<const FieldDescriptor*> repeated_field_desc_;
+  ProtoWrapperTypeOptions unboxing_option_;
 };
 
 absl::StatusOr<LegacyQualifyResult> QualifyImpl(
     const google::protobuf::Message* message, const google::protobuf::Descriptor* descriptor,
     absl::Span<const cel::SelectQualifier> path, bool presence_test,
+    ProtoWrapperTypeOptions unboxing_option,
     cel::MemoryManagerRef memory_manager) {
   google::protobuf::Arena* arena = ProtoMemoryManagerArena(memory_manager);
   ABSL_DCHECK(descriptor == message->GetDescriptor());
-  QualifyState qualify_state(message, descriptor, message->GetReflection());
+  QualifyState qualify_state(message, descriptor, message->GetReflection(),
+                             unboxing_option);
 
   for (int i = 0; i < path.size() - 1; i++) {
     const auto& qualifier = path.at(i);
@@ -675,15 +745,44 @@ class DucktypedMessageAdapter : public LegacyTypeAccessApis,
                         unboxing_option, memory_manager);
   }
 
+  const void* FindFieldHint(
+      absl::string_view field_name,
+      const CelValue::MessageWrapper& instance) const override {
+    absl::StatusOr<const google::protobuf::Message*> message =
+        UnwrapMessage(instance, "FindFieldHint");
+    if (!message.ok()) {
+      return nullptr;
+    }
+    return FindFieldHintImpl(*message, field_name);
+  }
+
+  absl::StatusOr<absl::optional<CelValue>> GetFieldByHint(
+      const void* hint, const CelValue::MessageWrapper& instance,
+      ProtoWrapperTypeOptions unboxing_option,
+      cel::MemoryManagerRef memory_manager) const override {
+    CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
+                         UnwrapMessage(instance, "GetFieldByHint"));
+    return GetFieldByHintImpl(message, hint, unboxing_option, memory_manager);
+  }
+
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      const void* hint,
+      const CelValue::MessageWrapper& instance) const override {
+    CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
+                         UnwrapMessage(instance, "HasFieldByHint"));
+    return HasFieldByHintImpl(message, hint);
+  }
+
   absl::StatusOr<LegacyTypeAccessApis::LegacyQualifyResult> Qualify(
       absl::Span<const cel::SelectQualifier> qualifiers,
       const CelValue::MessageWrapper& instance, bool presence_test,
+      ProtoWrapperTypeOptions unboxing_option,
       cel::MemoryManagerRef memory_manager) const override {
     CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
                          UnwrapMessage(instance, "Qualify"));
 
     return QualifyImpl(message, message->GetDescriptor(), qualifiers,
-                       presence_test, memory_manager);
+                       presence_test, unboxing_option, memory_manager);
   }
 
   bool IsEqualTo(
@@ -832,11 +931,22 @@ ProtoMessageTypeAdapter::FindFieldByName(absl::string_view field_name) const {
       descriptor_->FindFieldByName(field_name);
 
   if (field_descriptor == nullptr) {
-    return absl::nullopt;
+    // Extensions are selected by their fully qualified name (see
+    // proto.getExt). Resolving them here lets planners address them by
+    // number, like regular fields, instead of by name on every access.
+    field_descriptor =
+        descriptor_->file()->pool()->FindExtensionByPrintableName(descriptor_,
+                                                                  field_name);
+    if (field_descriptor == nullptr) {
+      return absl::nullopt;
+    }
+    return LegacyTypeInfoApis::FieldDescription{
+        field_descriptor->number(),
+        field_descriptor->PrintableNameForExtension(), field_descriptor};
   }
 
-  return LegacyTypeInfoApis::FieldDescription{field_descriptor->number(),
-                                              field_descriptor->name()};
+  return LegacyTypeInfoApis::FieldDescription{
+      field_descriptor->number(), field_descriptor->name(), field_descriptor};
 }
 
 absl::Status ProtoMessageTypeAdapter::ValidateSetFieldOp(
@@ -859,7 +969,13 @@ ProtoMessageTypeAdapter::NewInstance(
 
   // This implementation requires arena-backed memory manager.
   google::protobuf::Arena* arena = ProtoMemoryManagerArena(memory_manager);
-  const Message* prototype = message_factory_->GetPrototype(descriptor_);
+  const Message* prototype = prototype_.load(std::memory_order_acquire);
+  if (prototype == nullptr) {
+    // Concurrent first uses may both resolve the prototype, which is harmless
+    // as the factory returns the same one.
+    prototype = message_factory_->GetPrototype(descriptor_);
+    prototype_.store(prototype, std::memory_order_release);
+  }
 
   Message* msg = (prototype != nullptr) ? prototype->New(arena) : nullptr;
 
@@ -892,16 +1008,45 @@ absl::StatusOr<CelValue> ProtoMessageTypeAdapter::GetField(
                       memory_manager);
 }
 
+const void* ProtoMessageTypeAdapter::FindFieldHint(
+    absl::string_view field_name,
+    const CelValue::MessageWrapper& instance) const {
+  absl::StatusOr<const google::protobuf::Message*> message =
+      UnwrapMessage(instance, "FindFieldHint");
+  if (!message.ok()) {
+    return nullptr;
+  }
+  return FindFieldHintImpl(*message, field_name);
+}
+
+absl::StatusOr<absl::optional<CelValue>>
+ProtoMessageTypeAdapter::GetFieldByHint(
+    const void* hint, const CelValue::MessageWrapper& instance,
+    ProtoWrapperTypeOptions unboxing_option,
+    cel::MemoryManagerRef memory_manager) const {
+  CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
+                       UnwrapMessage(instance, "GetFieldByHint"));
+  return GetFieldByHintImpl(message, hint, unboxing_option, memory_manager);
+}
+
+absl::StatusOr<absl::optional<bool>> ProtoMessageTypeAdapter::HasFieldByHint(
+    const void* hint, const CelValue::MessageWrapper& instance) const {
+  CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
+                       UnwrapMessage(instance, "HasFieldByHint"));
+  return HasFieldByHintImpl(message, hint);
+}
+
 absl::StatusOr<LegacyTypeAccessApis::LegacyQualifyResult>
 ProtoMessageTypeAdapter::Qualify(
     absl::Span<const cel::SelectQualifier> qualifiers,
     const CelValue::MessageWrapper& instance, bool presence_test,
+    ProtoWrapperTypeOptions unboxing_option,
     cel::MemoryManagerRef memory_manager) const {
   CEL_ASSIGN_OR_RETURN(const google::protobuf::Message* message,
                        UnwrapMessage(instance, "Qualify"));
 
   return QualifyImpl(message, descriptor_, qualifiers, presence_test,
-                     memory_manager);
+                     unboxing_option, memory_manager);
 }
 
 absl::Status ProtoMessageTypeAdapter::SetField(
@@ -1002,6 +1147,27 @@ absl::Status ProtoMessageTypeAdapter::SetFieldByNumber(
   return SetField(field_descriptor, value, arena, mutable_message);
 }
 
+absl::StatusOr<bool> ProtoMessageTypeAdapter::SetFieldByHint(
+    const void* hint, const CelValue& value,
+    cel::MemoryManagerRef memory_manager,
+    CelValue::MessageWrapper::Builder& instance) const {
+  // Assume proto arena implementation if this provider is used.
+  google::protobuf::Arena* arena =
+      cel::extensions::ProtoMemoryManagerArena(memory_manager);
+
+  CEL_ASSIGN_OR_RETURN(google::protobuf::Message * mutable_message,
+                       UnwrapMessage(instance, "SetField"));
+
+  const FieldDescriptor* field_descriptor =
+      FieldFromHint(mutable_message, hint);
+  if (field_descriptor == nullptr) {
+    return false;
+  }
+  CEL_RETURN_IF_ERROR(
+      SetField(field_descriptor, value, arena, mutable_message));
+  return true;
+}
+
 absl::StatusOr<CelValue> ProtoMessageTypeAdapter::AdaptFromWellKnownType(
     cel::MemoryManagerRef memory_manager,
     CelValue::MessageWrapper::Builder instance) const {
@@ -15,13 +15,16 @@
 #ifndef THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_PROTO_MESSAGE_TYPE_ADAPTER_H_
 #define THIRD_PARTY_CEL_CPP_EVAL_PUBLIC_STRUCTS_PROTO_MESSAGE_TYPE_ADAPTER_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "base/memory.h"
 #include "base/values/struct_value.h"
 #include "eval/public/cel_options.h"
@@ -77,6 +80,11 @@ class ProtoMessageTypeAdapter : public LegacyTypeInfoApis,
       cel::MemoryManagerRef memory_manager,
       CelValue::MessageWrapper::Builder& instance) const override;
 
+  absl::StatusOr<bool> SetFieldByHint(
+      const void* hint, const CelValue& value,
+      cel::MemoryManagerRef memory_manager,
+      CelValue::MessageWrapper::Builder& instance) const override;
+
   absl::StatusOr<CelValue> AdaptFromWellKnownType(
       cel::MemoryManagerRef memory_manager,
       CelValue::MessageWrapper::Builder instance) const override;
@@ -91,9 +99,23 @@ class ProtoMessageTypeAdapter : public LegacyTypeInfoApis,
       absl::string_view field_name,
       const CelValue::MessageWrapper& value) const override;
 
+  const void* FindFieldHint(
+      absl::string_view field_name,
+      const CelValue::MessageWrapper& instance) const override;
+
+  absl::StatusOr<absl::optional<CelValue>> GetFieldByHint(
+      const void* hint, const CelValue::MessageWrapper& instance,
+      ProtoWrapperTypeOptions unboxing_option,
+      cel::MemoryManagerRef memory_manager) const override;
+
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      const void* hint,
+      const CelValue::MessageWrapper& instance) const override;
+
   absl::StatusOr<LegacyTypeAccessApis::LegacyQualifyResult> Qualify(
       absl::Span<const cel::SelectQualifier> qualifiers,
       const CelValue::MessageWrapper& instance, bool presence_test,
+      ProtoWrapperTypeOptions unboxing_option,
       cel::MemoryManagerRef memory_manager) const override;
 
   bool IsEqualTo(const CelValue::MessageWrapper& instance,
@@ -113,6 +135,10 @@ class ProtoMessageTypeAdapter : public LegacyTypeInfoApis,
 
   google::protobuf::MessageFactory* message_factory_;
   const google::protobuf::Descriptor* descriptor_;
+  // Resolved on first use by NewInstance. Looking up the prototype takes a
+  // lock in the message factory, which a dynamic message factory holds while
+  // hashing the descriptor, so it is only done once per type.
+  mutable std::atomic<const google::protobuf::Message*> prototype_ = nullptr;
 };
 
 // Returns a TypeInfo provider representing an arbitrary message.
@@ -25,9 +25,11 @@
 #include "eval/public/containers/container_backed_list_impl.h"
 #include "eval/public/containers/container_backed_map_impl.h"
 #include "eval/public/message_wrapper.h"
+#include "eval/public/structs/compiled_field_accessors.h"
 #include "eval/public/structs/legacy_type_adapter.h"
 #include "eval/public/structs/legacy_type_info_apis.h"
 #include "eval/public/testing/matchers.h"
+#include "eval/testutil/test_extensions.pb.h"
 #include "eval/testutil/test_message.pb.h"
 #include "extensions/protobuf/memory_manager.h"
 #include "internal/proto_matchers.h"
@@ -35,6 +37,7 @@
 #include "runtime/runtime_options.h"
 #include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/message.h"
 
 namespace google::api::expr::runtime {
@@ -50,6 +53,7 @@ using testing::ElementsAre;
 using testing::Eq;
 using testing::Field;
 using testing::HasSubstr;
+using testing::NotNull;
 using testing::Optional;
 using testing::Truly;
 using cel::internal::IsOkAndHolds;
@@ -162,6 +166,33 @@ TEST_P(ProtoMessageTypeAccessorTest, GetFieldSingular) {
               IsOkAndHolds(test::IsCelInt64(10)));
 }
 
+TEST_P(ProtoMessageTypeAccessorTest, GetFieldCompiled) {
+  google::protobuf::Arena arena;
+  const LegacyTypeAccessApis& accessor = GetAccessApis();
+
+  auto manager = ProtoMemoryManagerRef(&arena);
+
+  // Registered getters produce the same values as reflection.
+  ASSERT_OK(CompiledFieldAccessorRegistry::Global().Register({
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, uint32_value),
+      CEL_COMPILED_FIELD_ACCESSOR(TestMessage, message_value),
+  }));
+
+  TestMessage example;
+  example.set_uint32_value(10);
+  example.mutable_message_value()->set_int64_value(20);
+
+  MessageWrapper value(&example, nullptr);
+
+  EXPECT_THAT(accessor.GetField("uint32_value", value,
+                                ProtoWrapperTypeOptions::kUnsetNull, manager),
+              IsOkAndHolds(test::IsCelUint64(10)));
+  EXPECT_THAT(accessor.GetField("message_value", value,
+                                ProtoWrapperTypeOptions::kUnsetNull, manager),
+              IsOkAndHolds(test::IsCelMessage(
+                  EqualsProto(example.message_value()))));
+}
+
 TEST_P(ProtoMessageTypeAccessorTest, GetFieldNoSuchField) {
   google::protobuf::Arena arena;
   const LegacyTypeAccessApis& accessor = GetAccessApis();
@@ -179,6 +210,40 @@ TEST_P(ProtoMessageTypeAccessorTest, GetFieldNoSuchField) {
                   absl::StatusCode::kNotFound, HasSubstr("unknown_field")))));
 }
 
+TEST_P(ProtoMessageTypeAccessorTest, FieldHints) {
+  google::protobuf::Arena arena;
+  const LegacyTypeAccessApis& accessor = GetAccessApis();
+
+  auto manager = ProtoMemoryManagerRef(&arena);
+
+  TestMessage example;
+  MessageWrapper value(&example, nullptr);
+
+  const void* hint = accessor.FindFieldHint("int64_value", value);
+  ASSERT_NE(hint, nullptr);
+  EXPECT_EQ(accessor.FindFieldHint("unknown_field", value), nullptr);
+
+  EXPECT_THAT(accessor.HasFieldByHint(hint, value),
+              IsOkAndHolds(Optional(false)));
+  example.set_int64_value(10);
+  EXPECT_THAT(accessor.HasFieldByHint(hint, value),
+              IsOkAndHolds(Optional(true)));
+  EXPECT_THAT(accessor.GetFieldByHint(hint, value,
+                                      ProtoWrapperTypeOptions::kUnsetNull,
+                                      manager),
+              IsOkAndHolds(Optional(test::IsCelInt64(10))));
+
+  // Hints do not apply to other message types.
+  Int64Value other;
+  MessageWrapper other_value(&other, nullptr);
+  EXPECT_THAT(accessor.GetFieldByHint(hint, other_value,
+                                      ProtoWrapperTypeOptions::kUnsetNull,
+                                      manager),
+              IsOkAndHolds(Eq(absl::nullopt)));
+  EXPECT_THAT(accessor.HasFieldByHint(hint, other_value),
+              IsOkAndHolds(Eq(absl::nullopt)));
+}
+
 TEST_P(ProtoMessageTypeAccessorTest, GetFieldNotAMessage) {
   google::protobuf::Arena arena;
   const LegacyTypeAccessApis& accessor = GetAccessApis();
@@ -441,6 +506,48 @@ TEST(ProtoMessageTypeAdapter, NewInstance) {
   EXPECT_EQ(result.message_ptr()->SerializeAsString(), "");
 }
 
+TEST(ProtoMessageTypeAdapter, NewInstanceDynamicMessage) {
+  google::protobuf::Arena arena;
+
+  google::protobuf::DescriptorPool pool;
+  google::protobuf::FileDescriptorProto faked_file;
+  faked_file.set_name("faked.proto");
+  faked_file.set_syntax("proto3");
+  faked_file.set_package("google.api.expr.runtime");
+  auto msg_descriptor = faked_file.add_message_type();
+  msg_descriptor->set_name("FakeMessage");
+  auto field = msg_descriptor->add_field();
+  field->set_name("int64_value");
+  field->set_number(1);
+  field->set_type(google::protobuf::FieldDescriptorProto::TYPE_INT64);
+  field->set_label(google::protobuf::FieldDescriptorProto::LABEL_OPTIONAL);
+  ASSERT_THAT(pool.BuildFile(faked_file), NotNull());
+
+  google::protobuf::DynamicMessageFactory factory(&pool);
+  ProtoMessageTypeAdapter adapter(
+      pool.FindMessageTypeByName("google.api.expr.runtime.FakeMessage"),
+      &factory);
+  auto manager = ProtoMemoryManagerRef(&arena);
+
+  // The prototype is resolved once and reused by later instances.
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_OK_AND_ASSIGN(CelValue::MessageWrapper::Builder value,
+                         adapter.NewInstance(manager));
+    ASSERT_OK(adapter.SetField("int64_value", CelValue::CreateInt64(i),
+                               manager, value));
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         adapter.AdaptFromWellKnownType(manager, value));
+    ASSERT_TRUE(result.IsMessage());
+    const google::protobuf::Message* message = result.MessageOrDie();
+    EXPECT_EQ(message->GetDescriptor()->full_name(),
+              "google.api.expr.runtime.FakeMessage");
+    EXPECT_EQ(message->GetReflection()->GetInt64(
+                  *message, message->GetDescriptor()->FindFieldByName(
+                                "int64_value")),
+              i);
+  }
+}
+
 TEST(ProtoMessageTypeAdapter, NewInstanceUnsupportedDescriptor) {
   google::protobuf::Arena arena;
 
@@ -524,6 +631,41 @@ TEST(ProtoMessageTypeAdapter, SetFieldRepeated) {
             message.SerializeAsString());
 }
 
+TEST(ProtoMessageTypeAdapter, SetFieldByHint) {
+  google::protobuf::Arena arena;
+  ProtoMessageTypeAdapter adapter(
+      google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(
+          "google.api.expr.runtime.TestMessage"),
+      google::protobuf::MessageFactory::generated_factory());
+  auto manager = ProtoMemoryManagerRef(&arena);
+
+  auto field = adapter.FindFieldByName("int64_value");
+  ASSERT_TRUE(field.has_value());
+  ASSERT_NE(field->hint, nullptr);
+
+  ASSERT_OK_AND_ASSIGN(CelValue::MessageWrapper::Builder value,
+                       adapter.NewInstance(manager));
+  EXPECT_THAT(adapter.SetFieldByHint(field->hint, CelValue::CreateInt64(10),
+                                     manager, value),
+              IsOkAndHolds(true));
+
+  TestMessage message;
+  message.set_int64_value(10);
+  EXPECT_EQ(value.message_ptr()->SerializeAsString(),
+            message.SerializeAsString());
+
+  // Hints of other types do not apply.
+  ProtoMessageTypeAdapter other_adapter(
+      google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(
+          "google.protobuf.Int64Value"),
+      google::protobuf::MessageFactory::generated_factory());
+  ASSERT_OK_AND_ASSIGN(CelValue::MessageWrapper::Builder other,
+                       other_adapter.NewInstance(manager));
+  EXPECT_THAT(other_adapter.SetFieldByHint(
+                  field->hint, CelValue::CreateInt64(10), manager, other),
+              IsOkAndHolds(false));
+}
+
 TEST(ProtoMessageTypeAdapter, SetFieldNotAField) {
   google::protobuf::Arena arena;
   ProtoMessageTypeAdapter adapter(
@@ -708,6 +850,29 @@ TEST(ProtoMesssageTypeAdapter, FindFieldFound) {
       << "expected field int64_value: 2";
 }
 
+TEST(ProtoMesssageTypeAdapter, FindFieldExtension) {
+  ProtoMessageTypeAdapter adapter(
+      google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(
+          "google.api.expr.runtime.TestExtensions"),
+      google::protobuf::MessageFactory::generated_factory());
+
+  EXPECT_THAT(
+      adapter.FindFieldByName("google.api.expr.runtime.int32_ext"),
+      Optional(Truly([](const LegacyTypeInfoApis::FieldDescription& desc) {
+        return desc.name == "google.api.expr.runtime.int32_ext" &&
+               desc.number == 101;
+      })));
+  EXPECT_THAT(
+      adapter.FindFieldByName(
+          "google.api.expr.runtime.TestMessageExtensions.enum_ext"),
+      Optional(Truly([](const LegacyTypeInfoApis::FieldDescription& desc) {
+        return desc.number == 104;
+      })));
+  // Unknown extension names are not resolved.
+  EXPECT_EQ(adapter.FindFieldByName("google.api.expr.runtime.int32_ext_foo"),
+            absl::nullopt);
+}
+
 TEST(ProtoMesssageTypeAdapter, FindFieldNotFound) {
   ProtoMessageTypeAdapter adapter(
       google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(
@@ -773,7 +938,8 @@ TEST(ProtoMesssageTypeAdapter, Qualify) {
       cel::FieldSpecifier{2, "int64_value"}};
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(42))));
 }
 
@@ -796,7 +962,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyDynamicFieldAccessUnsupported) {
       cel::FieldSpecifier{12, "message_value"},
       cel::AttributeQualifier::OfString("int64_value")};
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               StatusIs(absl::StatusCode::kUnimplemented));
 }
 
@@ -820,7 +987,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyNoSuchField) {
       cel::FieldSpecifier{99, "not_a_field"},
       cel::FieldSpecifier{2, "int64_value"}};
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kNotFound,
@@ -846,7 +1014,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyHasNoSuchField) {
       cel::FieldSpecifier{12, "message_value"},
       cel::FieldSpecifier{99, "not_a_field"}};
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/true, manager),
+                           /*presence_test=*/true,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kNotFound,
@@ -872,7 +1041,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyNoSuchFieldLeaf) {
       cel::FieldSpecifier{12, "message_value"},
       cel::FieldSpecifier{99, "not_a_field"}};
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kNotFound,
@@ -901,7 +1071,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalSupport) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(42))));
 }
 
@@ -926,7 +1097,8 @@ TEST(ProtoMesssageTypeAdapter, TypedFieldAccessOnMapUnsupported) {
       cel::FieldSpecifier{2, "value"}, cel::FieldSpecifier{2, "int64_value"}};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               StatusIs(absl::StatusCode::kUnimplemented));
 }
 
@@ -950,7 +1122,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalWrongKeyType) {
       cel::AttributeQualifier::OfInt(0), cel::FieldSpecifier{2, "int64_value"}};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(&LegacyQualifyResult::value,
                                  test::IsCelError(StatusIs(
                                      absl::StatusCode::kInvalidArgument,
@@ -977,7 +1150,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalHasWrongKeyType) {
       cel::AttributeQualifier::OfInt(0)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/true, manager),
+                           /*presence_test=*/true,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(&LegacyQualifyResult::value,
                                  test::IsCelError(StatusIs(
                                      absl::StatusCode::kUnknown,
@@ -1005,7 +1179,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalSupportNoSuchKey) {
       cel::FieldSpecifier{2, "int64_value"}};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kNotFound,
@@ -1033,7 +1208,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalInt32Key) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(42))));
 }
 
@@ -1057,7 +1233,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalIntOutOfRange) {
       cel::AttributeQualifier::OfInt(1LL << 32)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kOutOfRange,
@@ -1085,7 +1262,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalUint32Key) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelUint64(42))));
 }
 
@@ -1109,7 +1287,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalUintOutOfRange) {
       cel::AttributeQualifier::OfUint(1LL << 32)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value,
                   test::IsCelError(StatusIs(absl::StatusCode::kOutOfRange,
@@ -1138,10 +1317,12 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapTraversalUnexpectedFieldAccess) {
       cel::FieldSpecifier{0, "field_like_key"}};
 
   auto result = api->Qualify(qualfiers, wrapped,
-                             /*presence_test=*/false, manager);
+                             /*presence_test=*/false,
+                             ProtoWrapperTypeOptions::kUnsetNull, manager);
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               StatusIs(absl::StatusCode::kUnimplemented, _));
 }
 
@@ -1166,7 +1347,8 @@ TEST(ProtoMesssageTypeAdapter, UntypedQualifiersNotYetSupported) {
       cel::AttributeQualifier::OfString("int64_value")};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               StatusIs(absl::StatusCode::kUnimplemented, _));
 }
 
@@ -1195,7 +1377,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyRepeatedIndexWrongType) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value,
                          test::IsCelError(StatusIs(
                              absl::StatusCode::kUnknown,
@@ -1225,7 +1408,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyRepeatedTypeCheckError) {
       cel::AttributeQualifier::OfInt(1)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
 
               StatusIs(absl::StatusCode::kInternal,
                        HasSubstr("Unexpected qualify intermediate type")));
@@ -1255,7 +1439,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyRepeatedLeaf) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value,
                          test::IsCelList(ElementsAre(test::IsCelInt64(1),
                                                      test::IsCelInt64(2))))));
@@ -1285,7 +1470,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyRepeatedIndexLeaf) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(2))));
 }
 
@@ -1312,7 +1498,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyRepeatedIndexLeafOutOfBounds) {
       cel::AttributeQualifier::OfInt(2)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(&LegacyQualifyResult::value,
                                  test::IsCelError(StatusIs(
                                      absl::StatusCode::kInvalidArgument,
@@ -1343,7 +1530,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapLeaf) {
   };
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(
                   &LegacyQualifyResult::value, Truly([](const CelValue& v) {
                     return v.IsMap() && v.MapOrDie()->size() == 2;
@@ -1375,7 +1563,8 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapIndexLeaf) {
 
   EXPECT_THAT(
       api->Qualify(qualfiers, wrapped,
-                   /*presence_test=*/false, manager),
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
       IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(42))));
 }
 
@@ -1403,12 +1592,44 @@ TEST(ProtoMesssageTypeAdapter, QualifyMapIndexLeafWrongType) {
       cel::AttributeQualifier::OfInt(0)};
 
   EXPECT_THAT(api->Qualify(qualfiers, wrapped,
-                           /*presence_test=*/false, manager),
+                           /*presence_test=*/false,
+                           ProtoWrapperTypeOptions::kUnsetNull, manager),
               IsOkAndHolds(Field(&LegacyQualifyResult::value,
                                  test::IsCelError(StatusIs(
                                      absl::StatusCode::kInvalidArgument,
                                      HasSubstr("Invalid map key type"))))));
 }
 
+TEST(ProtoMesssageTypeAdapter, QualifyUnsetWrapperLeaf) {
+  google::protobuf::Arena arena;
+  ProtoMessageTypeAdapter adapter(
+      google::protobuf::DescriptorPool::generated_pool()->FindMessageTypeByName(
+          "google.api.expr.runtime.TestMessage"),
+      google::protobuf::MessageFactory::generated_factory());
+  auto manager = ProtoMemoryManagerRef(&arena);
+
+  TestMessage message;
+  message.mutable_message_value()->set_int64_value(42);
+  CelValue::MessageWrapper wrapped(&message, &adapter);
+
+  const LegacyTypeAccessApis* api = adapter.GetAccessApis(MessageWrapper());
+  ASSERT_NE(api, nullptr);
+
+  std::vector<cel::SelectQualifier> qualfiers{
+      cel::FieldSpecifier{12, "message_value"},
+      cel::FieldSpecifier{305, "int64_wrapper_value"}};
+
+  EXPECT_THAT(
+      api->Qualify(qualfiers, wrapped,
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetNull, manager),
+      IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelNull())));
+  EXPECT_THAT(
+      api->Qualify(qualfiers, wrapped,
+                   /*presence_test=*/false,
+                   ProtoWrapperTypeOptions::kUnsetProtoDefault, manager),
+      IsOkAndHolds(Field(&LegacyQualifyResult::value, test::IsCelInt64(0))));
+}
+
 }  // namespace
 }  // namespace google::api::expr::runtime
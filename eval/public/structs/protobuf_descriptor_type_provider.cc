@@ -15,14 +15,59 @@
 #include "eval/public/structs/protobuf_descriptor_type_provider.h"
 
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "eval/public/structs/proto_message_type_adapter.h"
 
 namespace google::api::expr::runtime {
 
+ProtobufDescriptorProvider::ProtobufDescriptorProvider(
+    const google::protobuf::DescriptorPool* pool,
+    google::protobuf::MessageFactory* factory,
+    absl::Span<const google::protobuf::FileDescriptor* const> files)
+    : descriptor_pool_(pool), message_factory_(factory) {
+  absl::flat_hash_set<const google::protobuf::FileDescriptor*> visited;
+  for (const auto* file : files) {
+    IndexFile(file, visited);
+  }
+}
+
+void ProtobufDescriptorProvider::IndexFile(
+    const google::protobuf::FileDescriptor* file,
+    absl::flat_hash_set<const google::protobuf::FileDescriptor*>& visited) {
+  if (!visited.insert(file).second) {
+    return;
+  }
+  for (int i = 0; i < file->dependency_count(); ++i) {
+    IndexFile(file->dependency(i), visited);
+  }
+  for (int i = 0; i < file->message_type_count(); ++i) {
+    IndexMessage(file->message_type(i));
+  }
+}
+
+void ProtobufDescriptorProvider::IndexMessage(
+    const google::protobuf::Descriptor* descriptor) {
+  for (int i = 0; i < descriptor->nested_type_count(); ++i) {
+    IndexMessage(descriptor->nested_type(i));
+  }
+  if (descriptor->options().map_entry()) {
+    return;
+  }
+  // Resolve by name, as the files may come from another pool.
+  auto adapter = CreateTypeAdapter(descriptor->full_name());
+  if (adapter != nullptr) {
+    type_index_.insert_or_assign(std::string(descriptor->full_name()),
+                                 std::move(adapter));
+  }
+}
+
 absl::optional<LegacyTypeAdapter> ProtobufDescriptorProvider::ProvideLegacyType(
     absl::string_view name) const {
   const ProtoMessageTypeAdapter* result = GetTypeAdapter(name);
@@ -53,6 +98,18 @@ ProtobufDescriptorProvider::CreateTypeAdapter(absl::string_view name) const {
 
 const ProtoMessageTypeAdapter* ProtobufDescriptorProvider::GetTypeAdapter(
     absl::string_view name) const {
+  if (auto it = type_index_.find(name); it != type_index_.end()) {
+    return it->second.get();
+  }
+  {
+    // Types are resolved once and then only looked up, so the common path only
+    // needs a shared lock.
+    absl::ReaderMutexLock lock(&mu_);
+    auto it = type_cache_.find(name);
+    if (it != type_cache_.end()) {
+      return it->second.get();
+    }
+  }
   absl::MutexLock lock(&mu_);
   auto it = type_cache_.find(name);
   if (it != type_cache_.end()) {
@@ -23,8 +23,10 @@
 #include "google/protobuf/message.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "eval/public/structs/legacy_type_provider.h"
 #include "eval/public/structs/proto_message_type_adapter.h"
 
@@ -38,6 +40,16 @@ class ProtobufDescriptorProvider : public LegacyTypeProvider {
                              google::protobuf::MessageFactory* factory)
       : descriptor_pool_(pool), message_factory_(factory) {}
 
+  // Eagerly creates the adapters of every message type, including nested
+  // types, defined in `files` and the files they transitively depend on. The
+  // types are looked up in `pool` by name. Lookups of these types read an
+  // immutable index and never lock, which avoids lock contention and the
+  // first use latency of the lazy cache. Other types are resolved lazily.
+  ProtobufDescriptorProvider(
+      const google::protobuf::DescriptorPool* pool,
+      google::protobuf::MessageFactory* factory,
+      absl::Span<const google::protobuf::FileDescriptor* const> files);
+
   absl::optional<LegacyTypeAdapter> ProvideLegacyType(
       absl::string_view name) const override;
 
@@ -52,8 +64,17 @@ class ProtobufDescriptorProvider : public LegacyTypeProvider {
 
   const ProtoMessageTypeAdapter* GetTypeAdapter(absl::string_view name) const;
 
+  void IndexFile(const google::protobuf::FileDescriptor* file,
+                 absl::flat_hash_set<const google::protobuf::FileDescriptor*>&
+                     visited);
+
+  void IndexMessage(const google::protobuf::Descriptor* descriptor);
+
   const google::protobuf::DescriptorPool* descriptor_pool_;
   google::protobuf::MessageFactory* message_factory_;
+  // Built by the constructor and immutable afterwards.
+  absl::flat_hash_map<std::string, std::unique_ptr<ProtoMessageTypeAdapter>>
+      type_index_;
   mutable absl::flat_hash_map<std::string,
                               std::unique_ptr<ProtoMessageTypeAdapter>>
       type_cache_ ABSL_GUARDED_BY(mu_);
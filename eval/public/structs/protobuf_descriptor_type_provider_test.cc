@@ -17,9 +17,11 @@
 #include <optional>
 
 #include "google/protobuf/wrappers.pb.h"
+#include "absl/strings/string_view.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/structs/legacy_type_info_apis.h"
 #include "eval/public/testing/matchers.h"
+#include "eval/testutil/test_message.pb.h"
 #include "extensions/protobuf/memory_manager.h"
 #include "internal/testing.h"
 
@@ -89,5 +91,29 @@ TEST(ProtobufDescriptorProvider, NotFound) {
   ASSERT_TRUE(type_info.has_value());
 }
 
+TEST(ProtobufDescriptorProvider, IndexedFiles) {
+  const google::protobuf::FileDescriptor* files[] = {
+      TestMessage::descriptor()->file()};
+  ProtobufDescriptorProvider provider(
+      google::protobuf::DescriptorPool::generated_pool(),
+      google::protobuf::MessageFactory::generated_factory(), files);
+
+  // Types from the files and their dependencies are indexed up front.
+  for (absl::string_view name :
+       {"google.api.expr.runtime.TestMessage", "google.protobuf.Timestamp",
+        "google.protobuf.Struct"}) {
+    auto type_adapter = provider.ProvideLegacyType(name);
+    ASSERT_TRUE(type_adapter.has_value()) << name;
+    auto type_info = provider.ProvideLegacyTypeInfo(name);
+    ASSERT_TRUE(type_info.has_value());
+    EXPECT_NE(*type_info, nullptr) << name;
+  }
+
+  // Other types are still resolved lazily.
+  EXPECT_TRUE(provider.ProvideLegacyType("google.protobuf.FileDescriptorProto")
+                  .has_value());
+  EXPECT_FALSE(provider.ProvideLegacyType("UnknownType").has_value());
+}
+
 }  // namespace
 }  // namespace google::api::expr::runtime
@@ -6,6 +6,7 @@
 #include "google/protobuf/util/time_util.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
+#include "eval/public/structs/cel_proto_wrap_util.h"
 #include "internal/proto_time_encoding.h"
 
 namespace google::api::expr::runtime {
@@ -110,6 +111,12 @@ absl::Status ExportAsProtoValue(const CelValue& in_value, Value* out_value,
     }
     case CelValue::Type::kList: {
       const CelList* cel_list = in_value.ListOrDie();
+      // Lists read from a message are copied as a whole.
+      if (const auto* backing = internal::GetBackingListValue(*cel_list);
+          backing != nullptr) {
+        out_value->mutable_list_value()->CopyFrom(*backing);
+        break;
+      }
       auto out_values = out_value->mutable_list_value();
       for (int i = 0; i < cel_list->size(); i++) {
         auto status = ExportAsProtoValue((*cel_list).Get(arena, i),
@@ -122,6 +129,11 @@ absl::Status ExportAsProtoValue(const CelValue& in_value, Value* out_value,
     }
     case CelValue::Type::kMap: {
       const CelMap* cel_map = in_value.MapOrDie();
+      if (const auto* backing = internal::GetBackingStruct(*cel_map);
+          backing != nullptr) {
+        out_value->mutable_struct_value()->CopyFrom(*backing);
+        break;
+      }
       CEL_ASSIGN_OR_RETURN(auto keys_list, cel_map->ListKeys(arena));
       auto out_values = out_value->mutable_struct_value()->mutable_fields();
       for (int i = 0; i < keys_list->size(); i++) {
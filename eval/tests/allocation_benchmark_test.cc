@@ -11,6 +11,12 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
 #include <string>
 #include <utility>
 
@@ -22,12 +28,15 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/node_hash_set.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/substitute.h"
+#include "absl/types/span.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_expr_builder_factory.h"
 #include "eval/public/cel_expression.h"
+#include "eval/public/cel_function.h"
 #include "eval/public/cel_options.h"
 #include "eval/public/cel_value.h"
 #include "eval/public/containers/container_backed_list_impl.h"
@@ -39,6 +48,23 @@
 #include "internal/testing.h"
 #include "parser/parser.h"
 
+// Count heap allocations made by this binary so benchmarks can report
+// allocations per evaluation.
+namespace {
+std::atomic<int64_t> heap_allocation_count{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (size == 0) size = 1;
+  if (void* ptr = std::malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
 namespace google::api::expr::runtime {
 namespace {
 
@@ -258,5 +284,104 @@ static void BM_AllocateList(benchmark::State& state) {
 }
 BENCHMARK(BM_AllocateList);
 
+// Scalar expressions evaluated against a reused arena. Evaluator state is
+// pooled per expression, so steady state evaluation is expected to report
+// zero allocs_per_eval.
+static void BM_ScalarNoAllocation(benchmark::State& state) {
+  static const char* const kExpressions[] = {
+      "1 + 2 == 3",
+      "x > 1 && y < 2",
+      "x == 3 ? y * 2 : y - 2",
+  };
+  google::protobuf::Arena arena;
+  std::string expr(kExpressions[state.range(0)]);
+  auto builder = CreateCelExpressionBuilder();
+  ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry()));
+
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, Parse(expr));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder->CreateExpression(&parsed_expr.expr(),
+                                                 &parsed_expr.source_info()));
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(3));
+  activation.InsertValue("y", CelValue::CreateInt64(1));
+
+  // Warm up the evaluator state pool.
+  ASSERT_OK(cel_expr->Evaluate(activation, &arena).status());
+
+  int64_t allocations = 0;
+  for (auto _ : state) {
+    int64_t before = heap_allocation_count.load(std::memory_order_relaxed);
+    absl::StatusOr<CelValue> result = cel_expr->Evaluate(activation, &arena);
+    allocations +=
+        heap_allocation_count.load(std::memory_order_relaxed) - before;
+    ASSERT_OK(result.status());
+    ASSERT_TRUE(result->IsBool() || result->IsInt64());
+  }
+  state.counters["allocs_per_eval"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ScalarNoAllocation)->DenseRange(0, 2);
+
+// Custom function sum4(int, int, int, int).
+class Sum4Function : public CelFunction {
+ public:
+  Sum4Function()
+      : CelFunction(CelFunctionDescriptor{
+            "sum4",
+            false,
+            {CelValue::Type::kInt64, CelValue::Type::kInt64,
+             CelValue::Type::kInt64, CelValue::Type::kInt64}}) {}
+
+  absl::Status Evaluate(absl::Span<const CelValue> args, CelValue* result,
+                        google::protobuf::Arena* arena) const override {
+    int64_t sum = 0;
+    for (const CelValue& arg : args) {
+      sum += arg.Int64OrDie();
+    }
+    *result = CelValue::CreateInt64(sum);
+    return absl::OkStatus();
+  }
+};
+
+// Calls a four argument custom function, with unknown processing disabled (0)
+// or enabled (1). Arguments are passed to the function straight from the
+// value stack, so steady state evaluation is expected to report zero
+// allocs_per_eval.
+static void BM_FunctionArgumentsNoAllocation(benchmark::State& state) {
+  google::protobuf::Arena arena;
+  InterpreterOptions options;
+  if (state.range(0) == 1) {
+    options.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+  }
+  auto builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry(), options));
+  ASSERT_OK(builder->GetRegistry()->Register(std::make_unique<Sum4Function>()));
+
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, Parse("sum4(x, y, x, y)"));
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder->CreateExpression(&parsed_expr.expr(),
+                                                 &parsed_expr.source_info()));
+  Activation activation;
+  activation.InsertValue("x", CelValue::CreateInt64(3));
+  activation.InsertValue("y", CelValue::CreateInt64(1));
+
+  // Warm up the evaluator state pool.
+  ASSERT_OK(cel_expr->Evaluate(activation, &arena).status());
+
+  int64_t allocations = 0;
+  for (auto _ : state) {
+    int64_t before = heap_allocation_count.load(std::memory_order_relaxed);
+    absl::StatusOr<CelValue> result = cel_expr->Evaluate(activation, &arena);
+    allocations +=
+        heap_allocation_count.load(std::memory_order_relaxed) - before;
+    ASSERT_OK(result.status());
+    ASSERT_TRUE(result->IsInt64());
+  }
+  state.counters["allocs_per_eval"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_FunctionArgumentsNoAllocation)->DenseRange(0, 1);
+
 }  // namespace
 }  // namespace google::api::expr::runtime
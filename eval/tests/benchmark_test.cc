@@ -13,6 +13,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/node_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/status/status.h"
 #include "absl/strings/match.h"
 #include "eval/public/activation.h"
 #include "eval/public/builtin_func_registrar.h"
@@ -23,6 +24,7 @@
 #include "eval/public/containers/container_backed_list_impl.h"
 #include "eval/public/containers/container_backed_map_impl.h"
 #include "eval/public/structs/cel_proto_wrapper.h"
+#include "eval/public/structs/compiled_field_accessors.h"
 #include "eval/tests/request_context.pb.h"
 #include "internal/status_macros.h"
 #include "internal/testing.h"
@@ -30,6 +32,7 @@
 #include "google/protobuf/arena.h"
 
 ABSL_FLAG(bool, enable_optimizations, false, "enable const folding opt");
+ABSL_FLAG(bool, enable_compact_dispatch, false, "enable compact dispatch loop");
 
 namespace google {
 namespace api {
@@ -50,6 +53,7 @@ InterpreterOptions GetOptions(google::protobuf::Arena& arena) {
     options.constant_arena = &arena;
     options.constant_folding = true;
   }
+  options.enable_compact_dispatch = absl::GetFlag(FLAGS_enable_compact_dispatch);
 
   return options;
 }
@@ -683,6 +687,90 @@ void BM_NestedProtoFieldReadDefaults(benchmark::State& state) {
 
 BENCHMARK(BM_NestedProtoFieldReadDefaults);
 
+// Same as BM_NestedProtoFieldRead, with compiled getters registered for the
+// selected fields. The registration is global, so this must run after the
+// benchmarks which measure the reflection path for the same fields.
+void BM_NestedProtoFieldReadCompiled(benchmark::State& state) {
+  static const absl::Status registered =
+      CompiledFieldAccessorRegistry::Global().Register({
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext, a),
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext::A, b),
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext::B, c),
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext::C, d),
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext::D, e),
+      });
+  ASSERT_OK(registered);
+
+  google::protobuf::Arena arena;
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, parser::Parse(R"cel(
+      !request.a.b.c.d.e
+   )cel"));
+  InterpreterOptions options = GetOptions(arena);
+  auto builder = CreateCelExpressionBuilder(options);
+  auto reg_status = RegisterBuiltinFunctions(builder->GetRegistry(), options);
+
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder->CreateExpression(&parsed_expr.expr(), nullptr));
+
+  RequestContext request;
+  request.mutable_a()->mutable_b()->mutable_c()->mutable_d()->set_e(false);
+  activation.InsertValue("request",
+                         CelProtoWrapper::CreateMessage(&request, &arena));
+
+  for (auto _ : state) {
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    ASSERT_TRUE(result.IsBool());
+    ASSERT_TRUE(result.BoolOrDie());
+  }
+}
+
+BENCHMARK(BM_NestedProtoFieldReadCompiled);
+
+// Same as BM_HasProto, with compiled accessors registered for the tested
+// fields, and a presence test of a nested message field. Must run after
+// BM_HasProto for the same reason as BM_NestedProtoFieldReadCompiled.
+void BM_HasProtoCompiled(benchmark::State& state) {
+  static const absl::Status registered =
+      CompiledFieldAccessorRegistry::Global().Register({
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext, ip),
+          CEL_COMPILED_FIELD_ACCESSOR(RequestContext, path),
+          CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE(RequestContext, a),
+          CEL_COMPILED_FIELD_ACCESSOR_WITH_PRESENCE(RequestContext::A, b),
+      });
+  ASSERT_OK(registered);
+
+  google::protobuf::Arena arena;
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(
+      ParsedExpr parsed_expr,
+      parser::Parse("has(request.path) && !has(request.ip) && "
+                    "has(request.a.b)"));
+  InterpreterOptions options = GetOptions(arena);
+  auto builder = CreateCelExpressionBuilder(options);
+  auto reg_status = RegisterBuiltinFunctions(builder->GetRegistry(), options);
+
+  ASSERT_OK_AND_ASSIGN(auto cel_expr,
+                       builder->CreateExpression(&parsed_expr.expr(), nullptr));
+
+  RequestContext request;
+  request.set_path(kPath);
+  request.set_token(kToken);
+  request.mutable_a()->mutable_b();
+  activation.InsertValue("request",
+                         CelProtoWrapper::CreateMessage(&request, &arena));
+
+  for (auto _ : state) {
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    ASSERT_TRUE(result.IsBool());
+    ASSERT_TRUE(result.BoolOrDie());
+  }
+}
+
+BENCHMARK(BM_HasProtoCompiled);
+
 void BM_ProtoStructAccess(benchmark::State& state) {
   google::protobuf::Arena arena;
   Activation activation;
@@ -23,6 +23,8 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/container/node_hash_set.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "eval/compiler/cel_expression_builder_flat_impl.h"
 #include "eval/public/builtin_func_registrar.h"
 #include "eval/public/cel_expr_builder_factory.h"
 #include "eval/public/cel_expression.h"
@@ -32,6 +34,7 @@
 #include "internal/status_macros.h"
 #include "internal/testing.h"
 #include "parser/parser.h"
+#include "runtime/planner_stats.h"
 
 namespace google::api::expr::runtime {
 
@@ -70,16 +73,18 @@ InterpreterOptions OptionsForParam(BenchmarkParam param, google::protobuf::Arena
   return options;
 }
 
-void BM_SymbolicPolicy(benchmark::State& state) {
-  auto param = static_cast<BenchmarkParam>(state.range(0));
-
-  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse(R"cel(
+constexpr char kSymbolicPolicy[] = R"cel(
    !(request.ip in ["10.0.1.4", "10.0.1.5", "10.0.1.6"]) &&
    ((request.path.startsWith("v1") && request.token in ["v1", "v2", "admin"]) ||
     (request.path.startsWith("v2") && request.token in ["v2", "admin"]) ||
     (request.path.startsWith("/admin") && request.token == "admin" &&
      request.ip in ["10.0.1.1",  "10.0.1.2", "10.0.1.3"])
-   ))cel"));
+   ))cel";
+
+void BM_SymbolicPolicy(benchmark::State& state) {
+  auto param = static_cast<BenchmarkParam>(state.range(0));
+
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse(kSymbolicPolicy));
 
   google::protobuf::Arena arena;
   InterpreterOptions options = OptionsForParam(param, arena);
@@ -100,6 +105,49 @@ BENCHMARK(BM_SymbolicPolicy)
     ->Arg(BenchmarkParam::kDefault)
     ->Arg(BenchmarkParam::kFoldConstants);
 
+// Reports the average time spent in each planning phase, in nanoseconds.
+void BM_SymbolicPolicyPhases(benchmark::State& state) {
+  auto param = static_cast<BenchmarkParam>(state.range(0));
+
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, parser::Parse(kSymbolicPolicy));
+
+  google::protobuf::Arena arena;
+  InterpreterOptions options = OptionsForParam(param, arena);
+
+  auto builder = CreateCelExpressionBuilder(options);
+  auto reg_status = RegisterBuiltinFunctions(builder->GetRegistry());
+  ASSERT_OK(reg_status);
+  const auto& flat_builder =
+      static_cast<const CelExpressionBuilderFlatImpl&>(*builder);
+
+  cel::PlannerStats stats;
+  for (auto _ : state) {
+    ASSERT_OK_AND_ASSIGN(
+        auto expression,
+        flat_builder.CreateExpression(&expr.expr(), &expr.source_info(),
+                                      /*warnings=*/nullptr, &stats));
+    arena.Reset();
+  }
+
+  auto report = [&state](const char* name,
+                         const cel::PlannerStats::Phase& phase) {
+    state.counters[name] =
+        benchmark::Counter(absl::ToDoubleNanoseconds(phase.wall_time),
+                           benchmark::Counter::kAvgIterations);
+  };
+  report("ast_conversion_ns", stats.ast_conversion);
+  report("ast_transforms_ns", stats.ast_transforms);
+  report("flattening_ns", stats.flattening);
+  report("program_optimizers_ns", stats.program_optimizers);
+  report("finalization_ns", stats.finalization);
+  state.counters["program_steps"] = stats.program_steps;
+  state.counters["program_bytes"] = stats.program_bytes;
+}
+
+BENCHMARK(BM_SymbolicPolicyPhases)
+    ->Arg(BenchmarkParam::kDefault)
+    ->Arg(BenchmarkParam::kFoldConstants);
+
 void BM_NestedComprehension(benchmark::State& state) {
   auto param = static_cast<BenchmarkParam>(state.range(0));
 
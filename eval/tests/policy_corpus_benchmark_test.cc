@@ -0,0 +1,280 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//       https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays a corpus of access policies against snapshots of request contexts
+// and reports tail latencies, allocations per evaluation and peak resident
+// memory, across thread counts.
+//
+// In single-shot mode every iteration evaluates one policy against one
+// request. In batch mode every iteration evaluates all of the policies
+// against one request, as a policy engine checking a request would.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "google/protobuf/text_format.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expr_builder_factory.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/structs/cel_proto_wrapper.h"
+#include "eval/tests/request_context.pb.h"
+#include "internal/benchmark.h"
+#include "internal/no_destructor.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+// Count heap allocations made by each thread so benchmarks can report
+// allocations per evaluation.
+namespace {
+thread_local int64_t thread_allocation_count = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+  ++thread_allocation_count;
+  if (size == 0) size = 1;
+  if (void* ptr = std::malloc(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using ::google::api::expr::parser::Parse;
+
+constexpr const char* kPolicies[] = {
+    R"cel(request.token == "admin" || request.path.startsWith("/public"))cel",
+    R"cel(
+      !(request.ip in ["10.0.1.4", "10.0.1.5", "10.0.1.6"]) &&
+      ((request.path.startsWith("v1") &&
+        request.token in ["v1", "v2", "admin"]) ||
+       (request.path.startsWith("v2") && request.token in ["v2", "admin"]) ||
+       (request.path.startsWith("/admin") && request.token == "admin" &&
+        request.ip in ["10.0.1.1",  "10.0.1.2", "10.0.1.3"])))cel",
+    R"cel(
+      "authorization" in request.headers &&
+      request.headers["authorization"].startsWith("Bearer "))cel",
+    R"cel(request.headers.exists(k, k.startsWith("x-debug")))cel",
+    R"cel(
+      request.headers.all(k, size(request.headers[k]) < 256) &&
+      size(request.path) < 1024)cel",
+    R"cel(request.path.matches("^/api/v[0-9]+/(users|groups)/[a-z0-9-]+$"))cel",
+    R"cel(request.a.b.c.d.e || request.ip.startsWith("192.168."))cel",
+    R"cel(
+      request.path.endsWith(".html") ? request.headers.size() == 0 :
+      request.token != "")cel",
+};
+
+// Snapshots of the request contexts the policies are evaluated against.
+constexpr const char* kRequests[] = {
+    R"pb(
+      ip: "10.0.1.2"
+      path: "/admin/edit"
+      token: "admin"
+      headers { key: "authorization" value: "Bearer abc" }
+    )pb",
+    R"pb(
+      ip: "192.168.0.7"
+      path: "/api/v1/users/jdoe"
+      token: "v1"
+      headers { key: "authorization" value: "Basic abc" }
+      headers { key: "accept" value: "application/json" }
+      headers { key: "x-debug-trace" value: "1" }
+    )pb",
+    R"pb(
+      ip: "10.0.1.5"
+      path: "/public/index.html"
+      a { b { c { d { e: true } } } }
+    )pb",
+    R"pb(
+      ip: "172.16.4.4" path: "v2/items" token: "v2"
+    )pb",
+};
+
+enum Mode : int64_t {
+  kSingleShot = 0,
+  kBatch = 1,
+};
+
+struct Corpus {
+  std::unique_ptr<CelExpressionBuilder> builder;
+  std::vector<std::unique_ptr<CelExpression>> policies;
+  std::vector<RequestContext> requests;
+};
+
+// The corpus is planned once and shared by all of the benchmark threads.
+const Corpus& GetCorpus() {
+  static const cel::internal::NoDestructor<Corpus> corpus([]() {
+    Corpus corpus;
+    InterpreterOptions options;
+    corpus.builder = CreateCelExpressionBuilder(options);
+    absl::Status status =
+        RegisterBuiltinFunctions(corpus.builder->GetRegistry(), options);
+    ABSL_CHECK(status.ok()) << status;
+    for (const char* policy : kPolicies) {
+      auto parsed_expr = Parse(policy);
+      ABSL_CHECK(parsed_expr.ok()) << parsed_expr.status();
+      auto expression = corpus.builder->CreateExpression(
+          &parsed_expr->expr(), &parsed_expr->source_info());
+      ABSL_CHECK(expression.ok()) << expression.status();
+      corpus.policies.push_back(*std::move(expression));
+    }
+    for (const char* request : kRequests) {
+      ABSL_CHECK(google::protobuf::TextFormat::ParseFromString(
+          request, &corpus.requests.emplace_back()));
+    }
+    return corpus;
+  }());
+  return *corpus;
+}
+
+// Returns the pth percentile of sorted.
+double Percentile(const std::vector<int64_t>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  return static_cast<double>(
+      sorted[static_cast<size_t>(p * (sorted.size() - 1))]);
+}
+
+// Latencies recorded by the threads of one benchmark run, merged so that
+// percentiles are over all evaluations rather than per thread.
+struct MergedLatencies {
+  absl::Mutex mutex;
+  std::vector<int64_t> latencies ABSL_GUARDED_BY(mutex);
+  int threads_done ABSL_GUARDED_BY(mutex) = 0;
+};
+
+MergedLatencies& GetMergedLatencies() {
+  static cel::internal::NoDestructor<MergedLatencies> merged;
+  return *merged;
+}
+
+int64_t PeakResidentBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // Reported in kilobytes on Linux.
+  return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+}
+
+void BM_PolicyCorpus(benchmark::State& state) {
+  auto mode = static_cast<Mode>(state.range(0));
+  const Corpus& corpus = GetCorpus();
+
+  google::protobuf::Arena arena;
+  std::vector<Activation> activations(corpus.requests.size());
+  for (size_t i = 0; i < corpus.requests.size(); ++i) {
+    activations[i].InsertValue(
+        "request", CelProtoWrapper::CreateMessage(&corpus.requests[i], &arena));
+  }
+
+  auto evaluate = [&](size_t policy, size_t request) {
+    google::protobuf::Arena evaluation_arena;
+    auto result = corpus.policies[policy]->Evaluate(activations[request],
+                                                    &evaluation_arena);
+    ASSERT_OK(result);
+    ASSERT_TRUE(result->IsBool()) << result->DebugString();
+  };
+
+  // Warm up the evaluator state pools.
+  for (size_t policy = 0; policy < corpus.policies.size(); ++policy) {
+    evaluate(policy, 0);
+  }
+
+  // Threads start at different offsets in the corpus.
+  size_t next = state.thread_index();
+  std::vector<int64_t> latencies;
+  latencies.reserve(state.max_iterations);
+  int64_t evaluations = 0;
+  int64_t allocations = 0;
+  for (auto _ : state) {
+    int64_t allocations_before = thread_allocation_count;
+    auto start = std::chrono::steady_clock::now();
+    if (mode == kBatch) {
+      size_t request = next++ % corpus.requests.size();
+      for (size_t policy = 0; policy < corpus.policies.size(); ++policy) {
+        evaluate(policy, request);
+      }
+      evaluations += corpus.policies.size();
+    } else {
+      size_t pair = next++;
+      evaluate(pair % corpus.policies.size(),
+               (pair / corpus.policies.size()) % corpus.requests.size());
+      ++evaluations;
+    }
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+    allocations += thread_allocation_count - allocations_before;
+  }
+
+  // The last thread to finish computes the percentiles of the samples of
+  // all threads and reports them; counters are summed across threads.
+  {
+    MergedLatencies& merged = GetMergedLatencies();
+    absl::MutexLock lock(&merged.mutex);
+    merged.latencies.insert(merged.latencies.end(), latencies.begin(),
+                            latencies.end());
+    if (++merged.threads_done == state.threads()) {
+      std::sort(merged.latencies.begin(), merged.latencies.end());
+      state.counters["p50_ns"] = Percentile(merged.latencies, 0.5);
+      state.counters["p99_ns"] = Percentile(merged.latencies, 0.99);
+      state.counters["p999_ns"] = Percentile(merged.latencies, 0.999);
+      // Reset for the next run, whose threads only start once all of this
+      // run's threads are done.
+      merged.latencies.clear();
+      merged.threads_done = 0;
+    }
+  }
+  state.counters["evals"] = static_cast<double>(evaluations);
+  state.counters["allocs_per_eval"] = benchmark::Counter(
+      static_cast<double>(allocations) / std::max<int64_t>(evaluations, 1),
+      benchmark::Counter::kAvgThreads);
+  if (state.thread_index() == 0) {
+    state.counters["peak_rss_bytes"] =
+        static_cast<double>(PeakResidentBytes());
+  }
+}
+
+BENCHMARK(BM_PolicyCorpus)
+    ->ArgName("batch")
+    ->Arg(kSingleShot)
+    ->Arg(kBatch)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace google::api::expr::runtime
@@ -0,0 +1,179 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//       https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how evaluation scales when many threads share one CelExpression,
+// its registries and type providers, and one activation. Contention (e.g. on
+// mutexes or reference counts) shows as time per iteration growing with the
+// number of threads.
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expr_builder_factory.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_list_impl.h"
+#include "eval/public/structs/cel_proto_wrapper.h"
+#include "eval/public/structs/protobuf_descriptor_type_provider.h"
+#include "eval/tests/request_context.pb.h"
+#include "internal/benchmark.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace google::api::expr::runtime {
+namespace {
+
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using ::google::api::expr::parser::Parse;
+
+constexpr const char* kExpressions[] = {
+    // Arithmetic and comparisons only.
+    "x * 3 + y > 10 && x - y < 5",
+    // Strings and lists.
+    "name.startsWith('adm') && name + '_suffix' in ['admin_suffix', 'other']",
+    // Comprehension over a shared list.
+    "items.exists(i, i == 42)",
+    // Message field access.
+    "request.path.startsWith('/admin') && request.a.b.c.d.e",
+    // Message creation, resolved by the descriptor type provider.
+    "google.api.expr.runtime.RequestContext{ip: name}.ip == name",
+};
+
+// State shared by all of the threads. Set by the first thread before the
+// iterations start and reset after they end.
+struct SharedState {
+  std::unique_ptr<CelExpressionBuilder> builder;
+  std::unique_ptr<CelExpression> expression;
+  google::protobuf::Arena arena;
+  RequestContext request;
+  std::unique_ptr<ContainerBackedListImpl> items;
+  Activation activation;
+};
+
+std::unique_ptr<SharedState> shared_state;
+
+void SetUpSharedState(const char* expression) {
+  auto state = std::make_unique<SharedState>();
+  InterpreterOptions options;
+  state->builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(state->builder->GetRegistry(), options));
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, Parse(expression));
+  ASSERT_OK_AND_ASSIGN(state->expression,
+                       state->builder->CreateExpression(
+                           &parsed_expr.expr(), &parsed_expr.source_info()));
+
+  std::vector<CelValue> items;
+  for (int i = 0; i < 64; ++i) {
+    items.push_back(CelValue::CreateInt64(i));
+  }
+  state->items = std::make_unique<ContainerBackedListImpl>(std::move(items));
+  state->request.set_path("/admin/edit");
+  state->request.mutable_a()->mutable_b()->mutable_c()->mutable_d()->set_e(
+      true);
+
+  state->activation.InsertValue("x", CelValue::CreateInt64(4));
+  state->activation.InsertValue("y", CelValue::CreateInt64(1));
+  state->activation.InsertValue("name", CelValue::CreateStringView("admin"));
+  state->activation.InsertValue("items",
+                                CelValue::CreateList(state->items.get()));
+  state->activation.InsertValue(
+      "request", CelProtoWrapper::CreateMessage(&state->request,
+                                                &state->arena));
+  shared_state = std::move(state);
+}
+
+void BM_SharedExpression(benchmark::State& state) {
+  if (state.thread_index() == 0) {
+    SetUpSharedState(kExpressions[state.range(0)]);
+  }
+
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         shared_state->expression->Evaluate(
+                             shared_state->activation, &arena));
+    ASSERT_TRUE(result.IsBool()) << result.DebugString();
+  }
+
+  if (state.thread_index() == 0) {
+    shared_state.reset();
+  }
+}
+
+BENCHMARK(BM_SharedExpression)
+    ->ArgName("expression")
+    ->DenseRange(0, std::size(kExpressions) - 1)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+enum class ProviderIndexing {
+  // Adapters are created on first lookup and cached under a mutex.
+  kLazy = 0,
+  // Adapters are created eagerly and looked up without locking.
+  kIndexed = 1,
+};
+
+std::unique_ptr<ProtobufDescriptorProvider> shared_provider;
+
+// Looks up message types by name in one ProtobufDescriptorProvider shared by
+// all of the threads, as the planner and CreateStruct steps do.
+void BM_DescriptorProviderLookup(benchmark::State& state) {
+  auto indexing = static_cast<ProviderIndexing>(state.range(0));
+  if (state.thread_index() == 0) {
+    const google::protobuf::FileDescriptor* files[] = {
+        RequestContext::descriptor()->file()};
+    shared_provider =
+        indexing == ProviderIndexing::kIndexed
+            ? std::make_unique<ProtobufDescriptorProvider>(
+                  google::protobuf::DescriptorPool::generated_pool(),
+                  google::protobuf::MessageFactory::generated_factory(), files)
+            : std::make_unique<ProtobufDescriptorProvider>(
+                  google::protobuf::DescriptorPool::generated_pool(),
+                  google::protobuf::MessageFactory::generated_factory());
+  }
+
+  const std::string names[] = {
+      std::string(RequestContext::descriptor()->full_name()),
+      std::string(RequestContext::A::descriptor()->full_name()),
+  };
+  for (auto _ : state) {
+    for (const std::string& name : names) {
+      benchmark::DoNotOptimize(shared_provider->ProvideLegacyTypeInfo(name));
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    shared_provider.reset();
+  }
+}
+
+BENCHMARK(BM_DescriptorProviderLookup)
+    ->ArgName("indexed")
+    ->Arg(static_cast<int>(ProviderIndexing::kLazy))
+    ->Arg(static_cast<int>(ProviderIndexing::kIndexed))
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace google::api::expr::runtime
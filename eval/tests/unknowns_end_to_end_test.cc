@@ -4,6 +4,7 @@
 // the unknowns is particular to the runtime.
 
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -144,9 +145,11 @@ class FunctionImpl : public CelFunction {
 // correctly.
 class UnknownsTest : public testing::Test {
  public:
-  void PrepareBuilder(UnknownProcessingOptions opts) {
+  void PrepareBuilder(UnknownProcessingOptions opts,
+                      std::vector<std::string> unknown_attribute_roots = {}) {
     InterpreterOptions options;
     options.unknown_processing = opts;
+    options.unknown_attribute_roots = std::move(unknown_attribute_roots);
     builder_ = CreateCelExpressionBuilder(options);
     ASSERT_OK(RegisterBuiltinFunctions(builder_->GetRegistry()));
     ASSERT_OK(
@@ -239,6 +242,30 @@ TEST_F(UnknownsTest, UnknownAttributesPruning) {
   EXPECT_TRUE(response.BoolOrDie());
 }
 
+TEST_F(UnknownsTest, UnknownAttributesUndeclaredRoot) {
+  PrepareBuilder(UnknownProcessingOptions::kAttributeOnly, {"var1"});
+  // Patterns for variables that are not declared roots are ignored.
+  activation_.set_unknown_attribute_patterns(
+      {CelAttributePattern("var1", {}), CelAttributePattern("var2", {})});
+  activation_.InsertValue("var2", CelValue::CreateInt64(3));
+  ASSERT_OK(activation_.InsertFunction(
+      std::make_unique<FunctionImpl>("F1", FunctionResponse::kTrue)));
+  ASSERT_OK(activation_.InsertFunction(
+      std::make_unique<FunctionImpl>("F2", FunctionResponse::kFalse)));
+
+  // var1 > 3 && F1('arg1') || var2 > 3 && F2('arg2')
+  auto plan = builder_->CreateExpression(&expr_, nullptr);
+  ASSERT_OK(plan);
+
+  auto maybe_response = plan.value()->Evaluate(activation_, &arena_);
+  ASSERT_OK(maybe_response);
+  CelValue response = maybe_response.value();
+
+  ASSERT_TRUE(response.IsUnknownSet());
+  EXPECT_THAT(response.UnknownSetOrDie()->unknown_attributes(),
+              ElementsAre(AttributeIs("var1")));
+}
+
 TEST_F(UnknownsTest, UnknownFunctionsWithoutOptionError) {
   PrepareBuilder(UnknownProcessingOptions::kAttributeOnly);
   activation_.InsertValue("var1", CelValue::CreateInt64(5));
@@ -417,9 +444,11 @@ constexpr char kListCompExistsExpr[] = R"pb(
 // to work correctly.
 class UnknownsCompTest : public testing::Test {
  public:
-  void PrepareBuilder(UnknownProcessingOptions opts) {
+  void PrepareBuilder(UnknownProcessingOptions opts,
+                      std::vector<std::string> unknown_attribute_roots = {}) {
     InterpreterOptions options;
     options.unknown_processing = opts;
+    options.unknown_attribute_roots = std::move(unknown_attribute_roots);
     builder_ = CreateCelExpressionBuilder(options);
     ASSERT_OK(RegisterBuiltinFunctions(builder_->GetRegistry()));
     ASSERT_OK(builder_->GetRegistry()->RegisterLazyFunction(
@@ -551,9 +580,11 @@ constexpr char kListCompCondExpr[] = R"pb(
 // Holds on to state needed for execution to work correctly.
 class UnknownsCompCondTest : public testing::Test {
  public:
-  void PrepareBuilder(UnknownProcessingOptions opts) {
+  void PrepareBuilder(UnknownProcessingOptions opts,
+                      std::vector<std::string> unknown_attribute_roots = {}) {
     InterpreterOptions options;
     options.unknown_processing = opts;
+    options.unknown_attribute_roots = std::move(unknown_attribute_roots);
     builder_ = CreateCelExpressionBuilder(options);
     ASSERT_OK(RegisterBuiltinFunctions(builder_->GetRegistry()));
     ASSERT_OK(builder_->GetRegistry()->RegisterLazyFunction(
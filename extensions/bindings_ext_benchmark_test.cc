@@ -138,6 +138,14 @@ const std::vector<BenchmarkCase>& BenchmarkCases() {
                   z)))
              )",
            IsCelString("abcdef")},
+          // Hand inlined equivalents of the cases above, as a baseline for the
+          // overhead of binding a variable.
+          {"simple_inlined", R"("ab")", IsCelString("ab")},
+          {"multiple_references_inlined", R"("ab" + "ab" + "ab" + "ab")",
+           IsCelString("abababab")},
+          {"nested_inlined", R"("ab" + "cd" + "ef")", IsCelString("abcdef")},
+          {"bind_inside_loop_inlined", R"([3, 2, 1].all(x, x * x < 16))",
+           IsCelBool(true)},
       });
 
   return *cases;
@@ -236,6 +244,19 @@ void BM_TwiceNestedDefinition(benchmark::State& state) {
   RunBenchmark(BenchmarkCases()[9], state);
 }
 
+void BM_SimpleInlined(benchmark::State& state) {
+  RunBenchmark(BenchmarkCases()[10], state);
+}
+void BM_MultipleReferencesInlined(benchmark::State& state) {
+  RunBenchmark(BenchmarkCases()[11], state);
+}
+void BM_NestedInlined(benchmark::State& state) {
+  RunBenchmark(BenchmarkCases()[12], state);
+}
+void BM_BindInsideLoopInlined(benchmark::State& state) {
+  RunBenchmark(BenchmarkCases()[13], state);
+}
+
 BENCHMARK(BM_Simple);
 BENCHMARK(BM_MultipleReferences);
 BENCHMARK(BM_Nested);
@@ -246,6 +267,10 @@ BENCHMARK(BM_BindLoopBind);
 BENCHMARK(BM_TernaryDependsOnBind);
 BENCHMARK(BM_TernaryDoesNotDependOnBind);
 BENCHMARK(BM_TwiceNestedDefinition);
+BENCHMARK(BM_SimpleInlined);
+BENCHMARK(BM_MultipleReferencesInlined);
+BENCHMARK(BM_NestedInlined);
+BENCHMARK(BM_BindInsideLoopInlined);
 
 INSTANTIATE_TEST_SUITE_P(BindingsBenchmarkTest, BindingsBenchmarkTest,
                          ::testing::ValuesIn(BenchmarkCases()));
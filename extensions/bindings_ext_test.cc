@@ -161,6 +161,8 @@ INSTANTIATE_TEST_SUITE_P(
                   ['a', 'b', 'c'].map(x, x + '_'),
                   [0, 1, 2].map(y, my_list[y] + string(y))) ==
               ['a_0', 'b_1', 'c_2'])"},
+             // Binds inside of a loop are re-initialized on each iteration.
+             {"[1, 2, 3].all(y, cel.bind(x, y * 2, y > 0 && x == y * 2))"},
              // Check scoping rules.
              {"cel.bind(x, 1, "
               "  cel.bind(x, x + 1, x)) == 2"},
@@ -0,0 +1,692 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/fixed_layout_struct.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+#include "internal/status_macros.h"
+#include "runtime/internal/errors.h"
+
+namespace cel::extensions {
+
+namespace {
+
+using ::cel::base_internal::FieldIdFactory;
+
+using ByteOrder = FixedLayoutSchema::ByteOrder;
+using FieldKind = FixedLayoutSchema::FieldKind;
+using LayoutField = FixedLayoutSchema::Field;
+
+// Returns the size of fields of `kind`, or 0 if it is not implied by the
+// kind.
+size_t ImpliedSize(FieldKind kind) {
+  switch (kind) {
+    case FieldKind::kBool:
+    case FieldKind::kInt8:
+    case FieldKind::kUint8:
+      return 1;
+    case FieldKind::kInt16:
+    case FieldKind::kUint16:
+      return 2;
+    case FieldKind::kInt32:
+    case FieldKind::kUint32:
+    case FieldKind::kFloat:
+      return 4;
+    case FieldKind::kInt64:
+    case FieldKind::kUint64:
+    case FieldKind::kDouble:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+bool IsSigned(FieldKind kind) {
+  return kind == FieldKind::kInt8 || kind == FieldKind::kInt16 ||
+         kind == FieldKind::kInt32 || kind == FieldKind::kInt64;
+}
+
+bool IsUnsigned(FieldKind kind) {
+  return kind == FieldKind::kUint8 || kind == FieldKind::kUint16 ||
+         kind == FieldKind::kUint32 || kind == FieldKind::kUint64;
+}
+
+// Reads the unsigned integer of `size` bytes at `data`.
+uint64_t LoadUnsigned(const char* data, size_t size, ByteOrder byte_order) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    size_t index = byte_order == ByteOrder::kBigEndian ? i : size - 1 - i;
+    value = (value << 8) | static_cast<uint8_t>(data[index]);
+  }
+  return value;
+}
+
+int64_t LoadSigned(const char* data, size_t size, ByteOrder byte_order) {
+  // Sign extends by shifting the value to the top bits and back.
+  const int shift = 64 - 8 * static_cast<int>(size);
+  return static_cast<int64_t>(LoadUnsigned(data, size, byte_order) << shift) >>
+         shift;
+}
+
+double LoadFloating(const char* data, size_t size, ByteOrder byte_order) {
+  uint64_t bits = LoadUnsigned(data, size, byte_order);
+  if (size == 4) {
+    auto narrow_bits = static_cast<uint32_t>(bits);
+    float value;
+    std::memcpy(&value, &narrow_bits, sizeof(value));
+    return value;
+  }
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+bool IsPresent(const LayoutField& field, absl::string_view record) {
+  return field.presence_mask == 0 ||
+         (static_cast<uint8_t>(record[field.presence_offset]) &
+          field.presence_mask) != 0;
+}
+
+absl::StatusOr<Handle<StructType>> SchemaType(TypeFactory& type_factory,
+                                              const FixedLayoutSchema& schema);
+
+absl::StatusOr<Handle<Type>> FieldType(TypeFactory& type_factory,
+                                       const LayoutField& field) {
+  if (IsSigned(field.kind)) {
+    return type_factory.GetIntType();
+  }
+  if (IsUnsigned(field.kind)) {
+    return type_factory.GetUintType();
+  }
+  switch (field.kind) {
+    case FieldKind::kBool:
+      return type_factory.GetBoolType();
+    case FieldKind::kFloat:
+    case FieldKind::kDouble:
+      return type_factory.GetDoubleType();
+    case FieldKind::kString:
+      return type_factory.GetStringType();
+    case FieldKind::kBytes:
+      return type_factory.GetBytesType();
+    case FieldKind::kStruct:
+      return SchemaType(type_factory, *field.schema);
+    default:
+      return type_factory.GetDynType();
+  }
+}
+
+class FixedLayoutStructType final : public CEL_STRUCT_TYPE_CLASS {
+ public:
+  explicit FixedLayoutStructType(const FixedLayoutSchema& schema)
+      : schema_(schema) {}
+
+  static absl::StatusOr<Field> MakeField(TypeFactory& type_factory,
+                                         const LayoutField& field) {
+    CEL_ASSIGN_OR_RETURN(auto type, FieldType(type_factory, field));
+    // The hint is the schema field, as for FixedLayoutStructValue.
+    return Field(FieldIdFactory::Make(field.name), field.name, field.number,
+                 std::move(type), &field);
+  }
+
+  absl::string_view name() const override { return schema_.name(); }
+
+  size_t field_count() const override { return schema_.fields().size(); }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByName(
+      TypeManager& type_manager, absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), *field);
+  }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByNumber(
+      TypeManager& type_manager, int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), *field);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(TypeManager& type_manager) const override;
+
+ private:
+  const FixedLayoutSchema& schema_;
+
+  CEL_DECLARE_STRUCT_TYPE(FixedLayoutStructType);
+};
+
+CEL_IMPLEMENT_STRUCT_TYPE(FixedLayoutStructType);
+
+class FixedLayoutStructTypeFieldIterator final
+    : public StructType::FieldIterator {
+ public:
+  FixedLayoutStructTypeFieldIterator(TypeManager& type_manager,
+                                     const FixedLayoutSchema& schema)
+      : type_manager_(type_manager), schema_(schema) {}
+
+  bool HasNext() override { return index_ < schema_.fields().size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= schema_.fields().size())) {
+      return absl::FailedPreconditionError(
+          "StructType::FieldIterator::Next() called when "
+          "StructType::FieldIterator::HasNext() returns false");
+    }
+    return FixedLayoutStructType::MakeField(type_manager_.type_factory(),
+                                            schema_.fields()[index_++]);
+  }
+
+ private:
+  TypeManager& type_manager_;
+  const FixedLayoutSchema& schema_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructType::FieldIterator>>>
+FixedLayoutStructType::NewFieldIterator(TypeManager& type_manager) const {
+  return std::make_unique<FixedLayoutStructTypeFieldIterator>(type_manager,
+                                                              schema_);
+}
+
+absl::StatusOr<Handle<StructType>> SchemaType(
+    TypeFactory& type_factory, const FixedLayoutSchema& schema) {
+  return type_factory.CreateStructType<FixedLayoutStructType>(schema);
+}
+
+absl::StatusOr<Handle<Value>> CreateRecordValue(
+    ValueFactory& value_factory, const FixedLayoutSchema& schema,
+    absl::string_view record);
+
+// Reads the field `field` of `record`, whose schema is `schema`.
+absl::StatusOr<Handle<Value>> ReadField(ValueFactory& value_factory,
+                                       const FixedLayoutSchema& schema,
+                                       const LayoutField& field,
+                                       absl::string_view record) {
+  const bool present = IsPresent(field, record);
+  const char* data = record.data() + field.offset;
+  if (IsSigned(field.kind)) {
+    return value_factory.CreateIntValue(
+        present ? LoadSigned(data, field.size, schema.byte_order()) : 0);
+  }
+  if (IsUnsigned(field.kind)) {
+    return value_factory.CreateUintValue(
+        present ? LoadUnsigned(data, field.size, schema.byte_order()) : 0);
+  }
+  switch (field.kind) {
+    case FieldKind::kBool:
+      return value_factory.CreateBoolValue(present && *data != 0);
+    case FieldKind::kFloat:
+    case FieldKind::kDouble:
+      return value_factory.CreateDoubleValue(
+          present ? LoadFloating(data, field.size, schema.byte_order()) : 0);
+    case FieldKind::kString: {
+      if (!present) {
+        return value_factory.GetStringValue();
+      }
+      absl::string_view value(data, field.size);
+      // Strip the padding.
+      return value_factory.CreateUnownedStringValue(
+          value.substr(0, value.find('\0')));
+    }
+    case FieldKind::kBytes:
+      if (!present) {
+        return value_factory.GetBytesValue();
+      }
+      return value_factory.CreateUnownedBytesValue(
+          absl::string_view(data, field.size));
+    case FieldKind::kStruct:
+      if (!present) {
+        return value_factory.GetNullValue();
+      }
+      return CreateRecordValue(value_factory, *field.schema,
+                               absl::string_view(data, field.schema->size()));
+    case FieldKind::kCustom:
+      if (!present) {
+        return value_factory.GetNullValue();
+      }
+      return field.accessor(value_factory, record);
+    default:
+      return absl::InternalError(
+          absl::StrCat("unexpected kind of field ", field.name));
+  }
+}
+
+class FixedLayoutStructValue final : public CEL_STRUCT_VALUE_CLASS {
+ public:
+  FixedLayoutStructValue(const Handle<StructType>& type,
+                         const FixedLayoutSchema& schema,
+                         absl::string_view record)
+      : CEL_STRUCT_VALUE_CLASS(type), schema_(schema), record_(record) {}
+
+  std::string DebugString() const override {
+    // Printing fields would require a value factory.
+    return absl::StrCat(schema_.name(), "{", field_count(), " fields}");
+  }
+
+  size_t field_count() const override {
+    return std::count_if(
+        schema_.fields().begin(), schema_.fields().end(),
+        [this](const LayoutField& field) { return IsPresent(field, record_); });
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByName(
+      ValueFactory& value_factory, absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return ReadField(value_factory, schema_, *field, record_);
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByNumber(
+      ValueFactory& value_factory, int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return ReadField(value_factory, schema_, *field, record_);
+  }
+
+  absl::StatusOr<QualifyResult> Qualify(
+      ValueFactory& value_factory,
+      absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+      bool unbox_null_wrapper_types) const override;
+
+  absl::StatusOr<bool> HasFieldByName(TypeManager& type_manager,
+                                      absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return IsPresent(*field, record_);
+  }
+
+  absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
+                                        int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return IsPresent(*field, record_);
+  }
+
+  // The hint is the schema field, which holds the offset of the field.
+  const void* FindFieldHint(absl::string_view name) const override {
+    return schema_.FindField(name);
+  }
+
+  absl::StatusOr<absl::optional<Handle<Value>>> GetFieldByHint(
+      ValueFactory& value_factory, absl::string_view name, const void* hint,
+      bool unbox_null_wrapper_types) const override {
+    const auto* field = schema_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return ReadField(value_factory, schema_, *field, record_);
+  }
+
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      absl::string_view name, const void* hint) const override {
+    const auto* field = schema_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return IsPresent(*field, record_);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(ValueFactory& value_factory) const override;
+
+  absl::string_view record() const { return record_; }
+
+ private:
+  const FixedLayoutSchema& schema_;
+  const absl::string_view record_;
+
+  CEL_DECLARE_STRUCT_VALUE(FixedLayoutStructValue);
+};
+
+CEL_IMPLEMENT_STRUCT_VALUE(FixedLayoutStructValue);
+
+// Resolves select paths through nested records by offset arithmetic, only
+// creating the value of the last field applied.
+absl::StatusOr<QualifyResult> FixedLayoutStructValue::Qualify(
+    ValueFactory& value_factory,
+    absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+    bool unbox_null_wrapper_types) const {
+  const FixedLayoutSchema* schema = &schema_;
+  absl::string_view record = record_;
+  for (size_t i = 0; i < select_qualifiers.size(); ++i) {
+    const auto* specifier =
+        absl::get_if<FieldSpecifier>(&select_qualifiers[i]);
+    if (specifier == nullptr) {
+      // Index and key qualifiers apply to lists and maps, which records do
+      // not hold. Let the caller apply them to the record selected so far.
+      if (i == 0) {
+        return absl::UnimplementedError(
+            "Qualify of a record by a key is not supported.");
+      }
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           CreateRecordValue(value_factory, *schema, record));
+      return QualifyResult{std::move(value), static_cast<int>(i)};
+    }
+    // Numbers come from the struct type, names from the expression. Prefer
+    // the number, which is cheaper to find.
+    const LayoutField* field = schema->FindFieldByNumber(specifier->number);
+    if (field == nullptr || field->name != specifier->name) {
+      field = schema->FindField(specifier->name);
+    }
+    if (field == nullptr) {
+      return QualifyResult{
+          value_factory.CreateErrorValue(
+              runtime_internal::CreateNoSuchFieldError(specifier->name)),
+          -1};
+    }
+    const bool last = i + 1 == select_qualifiers.size();
+    if (last && presence_test) {
+      return QualifyResult{
+          value_factory.CreateBoolValue(IsPresent(*field, record)), -1};
+    }
+    if (last || field->kind != FieldKind::kStruct ||
+        !IsPresent(*field, record)) {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           ReadField(value_factory, *schema, *field, record));
+      return QualifyResult{std::move(value),
+                           last ? -1 : static_cast<int>(i + 1)};
+    }
+    record = record.substr(field->offset, field->schema->size());
+    schema = field->schema.get();
+  }
+  // Unreachable unless there are no qualifiers.
+  return absl::InvalidArgumentError("Qualify requires qualifiers.");
+}
+
+class FixedLayoutStructValueFieldIterator final
+    : public StructValue::FieldIterator {
+ public:
+  FixedLayoutStructValueFieldIterator(ValueFactory& value_factory,
+                                      const FixedLayoutSchema& schema,
+                                      absl::string_view record,
+                                      std::vector<const LayoutField*> fields)
+      : value_factory_(value_factory),
+        schema_(schema),
+        record_(record),
+        fields_(std::move(fields)) {}
+
+  bool HasNext() override { return index_ < fields_.size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= fields_.size())) {
+      return absl::FailedPreconditionError(
+          "StructValue::FieldIterator::Next() called when "
+          "StructValue::FieldIterator::HasNext() returns false");
+    }
+    const auto* field = fields_[index_++];
+    CEL_ASSIGN_OR_RETURN(auto value,
+                         ReadField(value_factory_, schema_, *field, record_));
+    return Field(FieldIdFactory::Make(field->name), std::move(value));
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const FixedLayoutSchema& schema_;
+  const absl::string_view record_;
+  const std::vector<const LayoutField*> fields_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructValue::FieldIterator>>>
+FixedLayoutStructValue::NewFieldIterator(ValueFactory& value_factory) const {
+  std::vector<const LayoutField*> fields;
+  for (const auto& field : schema_.fields()) {
+    if (IsPresent(field, record_)) {
+      fields.push_back(&field);
+    }
+  }
+  return std::make_unique<FixedLayoutStructValueFieldIterator>(
+      value_factory, schema_, record_, std::move(fields));
+}
+
+absl::StatusOr<Handle<Value>> CreateRecordValue(
+    ValueFactory& value_factory, const FixedLayoutSchema& schema,
+    absl::string_view record) {
+  CEL_ASSIGN_OR_RETURN(auto type,
+                       SchemaType(value_factory.type_factory(), schema));
+  return value_factory.CreateStructValue<FixedLayoutStructValue>(
+      std::move(type), schema, record);
+}
+
+}  // namespace
+
+FixedLayoutSchema::FixedLayoutSchema(std::string name, size_t size,
+                                     ByteOrder byte_order,
+                                     std::vector<Field> fields)
+    : name_(std::move(name)),
+      size_(size),
+      byte_order_(byte_order),
+      fields_(std::move(fields)) {
+  fields_by_number_.reserve(fields_.size());
+  for (const auto& field : fields_) {
+    fields_by_number_.push_back(&field);
+  }
+  std::sort(fields_by_number_.begin(), fields_by_number_.end(),
+            [](const Field* lhs, const Field* rhs) {
+              return lhs->number < rhs->number;
+            });
+}
+
+const FixedLayoutSchema::Field* FixedLayoutSchema::FindField(
+    absl::string_view name) const {
+  auto it = std::lower_bound(fields_.begin(), fields_.end(), name,
+                             [](const Field& field, absl::string_view name) {
+                               return field.name < name;
+                             });
+  if (it == fields_.end() || it->name != name) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+const FixedLayoutSchema::Field* FixedLayoutSchema::FindFieldByNumber(
+    int64_t number) const {
+  auto it = std::lower_bound(fields_by_number_.begin(),
+                             fields_by_number_.end(), number,
+                             [](const Field* field, int64_t number) {
+                               return field->number < number;
+                             });
+  if (it == fields_by_number_.end() || (*it)->number != number) {
+    return nullptr;
+  }
+  return *it;
+}
+
+const FixedLayoutSchema::Field* FixedLayoutSchema::FieldForHint(
+    const void* hint, absl::string_view name) const {
+  // std::less orders unrelated pointers, unlike the built-in operators.
+  std::less<const void*> less;
+  const Field* begin = fields_.data();
+  const Field* end = begin + fields_.size();
+  if (less(hint, begin) || !less(hint, end)) {
+    return nullptr;
+  }
+  // A hint cached for a destroyed schema may point into the fields of this
+  // one, which reused its memory, so it must also be a whole field named
+  // `name`.
+  uintptr_t offset = reinterpret_cast<uintptr_t>(hint) -
+                     reinterpret_cast<uintptr_t>(begin);
+  if (offset % sizeof(Field) != 0) {
+    return nullptr;
+  }
+  const auto* field = static_cast<const Field*>(hint);
+  if (field->name != name) {
+    return nullptr;
+  }
+  return field;
+}
+
+absl::StatusOr<Handle<StructValue>> FixedLayoutSchema::NewStructValue(
+    ValueFactory& value_factory, absl::string_view record) const {
+  if (record.size() < size_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("record of ", name_, " is ", record.size(),
+                     " bytes, expected ", size_));
+  }
+  CEL_ASSIGN_OR_RETURN(auto value,
+                       CreateRecordValue(value_factory, *this,
+                                         record.substr(0, size_)));
+  return std::move(value).As<StructValue>();
+}
+
+FixedLayoutSchema::Field& FixedLayoutSchema::Builder::AddFieldImpl(
+    absl::string_view name, int64_t number, FieldKind kind) {
+  Field& field = fields_.emplace_back();
+  field.name = std::string(name);
+  field.number = number;
+  field.kind = kind;
+  return field;
+}
+
+FixedLayoutSchema::Builder& FixedLayoutSchema::Builder::AddField(
+    absl::string_view name, int64_t number, FieldKind kind, size_t offset,
+    size_t size) {
+  if (kind == FieldKind::kStruct || kind == FieldKind::kCustom) {
+    status_.Update(absl::InvalidArgumentError(absl::StrCat(
+        "field ", name, " of ", name_,
+        " must be added by AddStructField or AddCustomField")));
+    return *this;
+  }
+  if (size_t implied = ImpliedSize(kind); implied != 0) {
+    if (size != 0 && size != implied) {
+      status_.Update(absl::InvalidArgumentError(
+          absl::StrCat("field ", name, " of ", name_, " is ", implied,
+                       " bytes, not ", size)));
+    }
+    size = implied;
+  }
+  Field& field = AddFieldImpl(name, number, kind);
+  field.offset = offset;
+  field.size = size;
+  return *this;
+}
+
+FixedLayoutSchema::Builder& FixedLayoutSchema::Builder::AddStructField(
+    absl::string_view name, int64_t number, size_t offset,
+    std::shared_ptr<const FixedLayoutSchema> schema) {
+  if (schema == nullptr) {
+    status_.Update(absl::InvalidArgumentError(
+        absl::StrCat("field ", name, " of ", name_, " has no schema")));
+    return *this;
+  }
+  Field& field = AddFieldImpl(name, number, FieldKind::kStruct);
+  field.offset = offset;
+  field.size = schema->size();
+  field.schema = std::move(schema);
+  return *this;
+}
+
+FixedLayoutSchema::Builder& FixedLayoutSchema::Builder::AddCustomField(
+    absl::string_view name, int64_t number, Accessor accessor) {
+  if (accessor == nullptr) {
+    status_.Update(absl::InvalidArgumentError(
+        absl::StrCat("field ", name, " of ", name_, " has no accessor")));
+    return *this;
+  }
+  AddFieldImpl(name, number, FieldKind::kCustom).accessor =
+      std::move(accessor);
+  return *this;
+}
+
+FixedLayoutSchema::Builder& FixedLayoutSchema::Builder::SetPresenceBit(
+    absl::string_view name, size_t offset, uint8_t mask) {
+  auto it = std::find_if(fields_.begin(), fields_.end(),
+                         [name](const Field& field) {
+                           return field.name == name;
+                         });
+  if (it == fields_.end() || mask == 0 || offset >= size_) {
+    status_.Update(absl::InvalidArgumentError(absl::StrCat(
+        "invalid presence bit for field ", name, " of ", name_)));
+    return *this;
+  }
+  it->presence_offset = offset;
+  it->presence_mask = mask;
+  return *this;
+}
+
+absl::StatusOr<std::shared_ptr<const FixedLayoutSchema>>
+FixedLayoutSchema::Builder::Build() && {
+  CEL_RETURN_IF_ERROR(status_);
+  for (const auto& field : fields_) {
+    if (field.kind != FieldKind::kCustom &&
+        (field.offset > size_ || field.size > size_ - field.offset)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("field ", field.name, " of ", name_,
+                       " does not fit in ", size_, " bytes"));
+    }
+  }
+  std::sort(fields_.begin(), fields_.end(),
+            [](const Field& lhs, const Field& rhs) {
+              return lhs.name < rhs.name;
+            });
+  for (size_t i = 1; i < fields_.size(); ++i) {
+    if (fields_[i - 1].name == fields_[i].name) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "duplicate field ", fields_[i].name, " of ", name_));
+    }
+  }
+  // The constructor is private, so std::make_shared cannot call it.
+  std::shared_ptr<const FixedLayoutSchema> schema(new FixedLayoutSchema(
+      std::move(name_), size_, byte_order_, std::move(fields_)));
+  const auto& by_number = schema->fields_by_number_;
+  for (size_t i = 1; i < by_number.size(); ++i) {
+    if (by_number[i - 1]->number == by_number[i]->number) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("duplicate field number ", by_number[i]->number,
+                       " of ", schema->name()));
+    }
+  }
+  return schema;
+}
+
+}  // namespace cel::extensions
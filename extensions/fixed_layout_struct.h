@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EXTENSIONS_FIXED_LAYOUT_STRUCT_H_
+#define THIRD_PARTY_CEL_CPP_EXTENSIONS_FIXED_LAYOUT_STRUCT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+
+namespace cel::extensions {
+
+// Layout of fixed size binary records, such as protocol headers or in-house
+// records read from a network buffer, described by the offsets of their
+// fields. Struct values created from a schema read fields from the record
+// in place: selects and `has()` decode only the selected field, and select
+// paths through nested records, as planned by the select optimization, are
+// qualified without creating the intermediate struct values.
+//
+// Fields are either of a built-in encoding at a byte offset, or read by an
+// accessor supplied by the user for other encodings (e.g. bit fields or
+// fields whose offset depends on the record). Fields are always present,
+// unless they have a presence bit, as fixed layouts have room for all of
+// them.
+//
+// Schemas are immutable once built and are shared by every evaluation and
+// thread, typically next to the runtime builder.
+class FixedLayoutSchema final {
+ public:
+  class Builder;
+
+  enum class ByteOrder {
+    kLittleEndian,
+    kBigEndian,
+  };
+
+  enum class FieldKind {
+    kBool,
+    kInt8,
+    kInt16,
+    kInt32,
+    kInt64,
+    kUint8,
+    kUint16,
+    kUint32,
+    kUint64,
+    kFloat,
+    kDouble,
+    // Characters padded with NULs up to the size of the field. Must be valid
+    // UTF-8.
+    kString,
+    // Bytes filling the size of the field.
+    kBytes,
+    // A record of another schema, embedded at the offset of the field.
+    kStruct,
+    // A value returned by the accessor of the field, whose type is dyn.
+    kCustom,
+  };
+
+  // Reads a kCustom field from the record, which is at least `size()` bytes.
+  // Values referencing the record must not outlive it, as for the record
+  // passed to `NewStructValue`.
+  using Accessor = std::function<absl::StatusOr<Handle<Value>>(
+      ValueFactory& value_factory, absl::string_view record)>;
+
+  struct Field {
+    std::string name;
+    int64_t number;
+    FieldKind kind;
+    // Position of the field in the record, in bytes. Unused by kCustom.
+    size_t offset = 0;
+    size_t size = 0;
+    // The field is present if `record[presence_offset] & presence_mask`,
+    // or always when `presence_mask` is zero.
+    size_t presence_offset = 0;
+    uint8_t presence_mask = 0;
+    // The schema of kStruct fields.
+    std::shared_ptr<const FixedLayoutSchema> schema;
+    // The accessor of kCustom fields.
+    Accessor accessor;
+  };
+
+  FixedLayoutSchema(const FixedLayoutSchema&) = delete;
+  FixedLayoutSchema& operator=(const FixedLayoutSchema&) = delete;
+
+  // The name of the struct type of the records.
+  absl::string_view name() const { return name_; }
+
+  // The size of the records, in bytes.
+  size_t size() const { return size_; }
+
+  ByteOrder byte_order() const { return byte_order_; }
+
+  // Ordered by name.
+  const std::vector<Field>& fields() const { return fields_; }
+
+  // Returns the field `name` or `number`, or nullptr if there is no such
+  // field.
+  const Field* FindField(absl::string_view name) const;
+  const Field* FindFieldByNumber(int64_t number) const;
+
+  // Returns the field `name` if `hint` points to it among the fields of this
+  // schema, or nullptr. `hint` may be any pointer: it is only dereferenced
+  // once it is known to point to a field of this schema.
+  const Field* FieldForHint(const void* hint, absl::string_view name) const;
+
+  // Returns a struct value over `record`, without copying it. `record` must
+  // be at least `size()` bytes and outlive the returned value and every
+  // value derived from it, e.g. request data kept alive until evaluation
+  // results are discarded. The schema must outlive them too.
+  //
+  // Booleans and integers are bool, int or uint values, kFloat and kDouble
+  // fields are double values. kString and kBytes fields reference the
+  // record. Absent fields are the zero value of their kind, or null for
+  // kStruct and kCustom fields.
+  absl::StatusOr<Handle<StructValue>> NewStructValue(
+      ValueFactory& value_factory, absl::string_view record) const;
+
+ private:
+  FixedLayoutSchema(std::string name, size_t size, ByteOrder byte_order,
+                    std::vector<Field> fields);
+
+  const std::string name_;
+  const size_t size_;
+  const ByteOrder byte_order_;
+  const std::vector<Field> fields_;
+  // Ordered by number.
+  std::vector<const Field*> fields_by_number_;
+};
+
+// Builds a FixedLayoutSchema, validating that fields fit in the record and
+// that their names and numbers are unique. For example:
+//
+//   FixedLayoutSchema::Builder builder("acme.Header", /*size=*/16,
+//                                      ByteOrder::kBigEndian);
+//   builder.AddField("version", 1, FieldKind::kUint8, /*offset=*/0)
+//       .AddField("tenant", 2, FieldKind::kString, /*offset=*/4,
+//                 /*size=*/12)
+//       .SetPresenceBit("tenant", /*offset=*/1, /*mask=*/0x01);
+//   CEL_ASSIGN_OR_RETURN(auto schema, std::move(builder).Build());
+class FixedLayoutSchema::Builder final {
+ public:
+  Builder(std::string name, size_t size,
+          ByteOrder byte_order = ByteOrder::kLittleEndian)
+      : name_(std::move(name)), size_(size), byte_order_(byte_order) {}
+
+  // Adds a field of a built-in kind other than kStruct. `size` is required
+  // for kString and kBytes, and implied by the other kinds.
+  Builder& AddField(absl::string_view name, int64_t number, FieldKind kind,
+                    size_t offset, size_t size = 0);
+
+  // Adds a field holding a record of `schema` at `offset`.
+  Builder& AddStructField(absl::string_view name, int64_t number,
+                          size_t offset,
+                          std::shared_ptr<const FixedLayoutSchema> schema);
+
+  // Adds a field read by `accessor`.
+  Builder& AddCustomField(absl::string_view name, int64_t number,
+                          Accessor accessor);
+
+  // Makes the field `name` present only if `record[offset] & mask`.
+  Builder& SetPresenceBit(absl::string_view name, size_t offset,
+                          uint8_t mask);
+
+  absl::StatusOr<std::shared_ptr<const FixedLayoutSchema>> Build() &&;
+
+ private:
+  Field& AddFieldImpl(absl::string_view name, int64_t number, FieldKind kind);
+
+  std::string name_;
+  size_t size_;
+  ByteOrder byte_order_;
+  std::vector<Field> fields_;
+  // The first error, reported by Build.
+  absl::Status status_;
+};
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_EXTENSIONS_FIXED_LAYOUT_STRUCT_H_
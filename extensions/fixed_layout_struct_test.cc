@@ -0,0 +1,328 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/fixed_layout_struct.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/bytes_value.h"
+#include "base/values/double_value.h"
+#include "base/values/error_value.h"
+#include "base/values/int_value.h"
+#include "base/values/null_value.h"
+#include "base/values/string_value.h"
+#include "base/values/struct_value.h"
+#include "base/values/uint_value.h"
+#include "internal/testing.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::base_internal::AbstractStructValue;
+using ::cel::internal::IsOkAndHolds;
+using ::cel::internal::StatusIs;
+
+using ByteOrder = FixedLayoutSchema::ByteOrder;
+using FieldKind = FixedLayoutSchema::FieldKind;
+
+// acme.Header, in network byte order:
+//
+//   0: uint8 version
+//   1: uint8 flags, bit 0 set if tenant is present
+//   2: uint16 port
+//   4: int32 delta
+//   8: char tenant[8]
+//  16: acme.Address address
+//  24: double ratio
+//
+// acme.Address:
+//
+//   0: uint32 ip
+//   4: int16 zone
+//   6: bool secure
+constexpr char kRecord[] = {
+    // version, flags, port
+    '\x02', '\x01', '\x1f', '\x90',
+    // delta
+    '\xff', '\xff', '\xff', '\xfe',
+    // tenant
+    'a', 'c', 'm', 'e', '\0', '\0', '\0', '\0',
+    // address
+    '\x0a', '\x00', '\x00', '\x01', '\xff', '\xfd', '\x01', '\x00',
+    // ratio
+    '\x3f', '\xe0', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00'};
+
+class FixedLayoutStructTest : public testing::Test {
+ public:
+  FixedLayoutStructTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  void SetUp() override {
+    FixedLayoutSchema::Builder address("acme.Address", 8,
+                                       ByteOrder::kBigEndian);
+    address.AddField("ip", 1, FieldKind::kUint32, 0)
+        .AddField("zone", 2, FieldKind::kInt16, 4)
+        .AddField("secure", 3, FieldKind::kBool, 6);
+    ASSERT_OK_AND_ASSIGN(auto address_schema, std::move(address).Build());
+
+    FixedLayoutSchema::Builder header("acme.Header", sizeof(kRecord),
+                                      ByteOrder::kBigEndian);
+    header.AddField("version", 1, FieldKind::kUint8, 0)
+        .AddField("port", 2, FieldKind::kUint16, 2)
+        .AddField("delta", 3, FieldKind::kInt32, 4)
+        .AddField("tenant", 4, FieldKind::kString, 8, 8)
+        .SetPresenceBit("tenant", 1, 0x01)
+        .AddStructField("address", 5, 16, std::move(address_schema))
+        .AddField("ratio", 6, FieldKind::kDouble, 24)
+        .AddCustomField("reserved_flags", 7,
+                        [](ValueFactory& value_factory,
+                           absl::string_view record) -> Handle<Value> {
+                          return value_factory.CreateUintValue(
+                              static_cast<uint8_t>(record[1]) >> 1);
+                        });
+    ASSERT_OK_AND_ASSIGN(schema_, std::move(header).Build());
+  }
+
+  Handle<StructValue> NewValue(absl::string_view record) {
+    auto value = schema_->NewStructValue(value_factory_, record);
+    EXPECT_OK(value);
+    return *std::move(value);
+  }
+
+  Handle<Value> GetField(const Handle<StructValue>& value,
+                         absl::string_view name) {
+    auto field = value->GetFieldByName(value_factory_, name);
+    EXPECT_OK(field);
+    return *std::move(field);
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+  std::shared_ptr<const FixedLayoutSchema> schema_;
+};
+
+TEST_F(FixedLayoutStructTest, Fields) {
+  auto value = NewValue(absl::string_view(kRecord, sizeof(kRecord)));
+  EXPECT_EQ(value->type()->name(), "acme.Header");
+  EXPECT_EQ(GetField(value, "version")->As<UintValue>().NativeValue(), 2);
+  EXPECT_EQ(GetField(value, "port")->As<UintValue>().NativeValue(), 8080);
+  EXPECT_EQ(GetField(value, "delta")->As<IntValue>().NativeValue(), -2);
+  EXPECT_EQ(GetField(value, "tenant")->As<StringValue>().ToString(), "acme");
+  EXPECT_EQ(GetField(value, "ratio")->As<DoubleValue>().NativeValue(), 0.5);
+  EXPECT_EQ(GetField(value, "reserved_flags")->As<UintValue>().NativeValue(),
+            0);
+
+  auto address = GetField(value, "address").As<StructValue>();
+  EXPECT_EQ(address->type()->name(), "acme.Address");
+  EXPECT_EQ(GetField(address, "ip")->As<UintValue>().NativeValue(),
+            0x0a000001);
+  EXPECT_EQ(GetField(address, "zone")->As<IntValue>().NativeValue(), -3);
+  EXPECT_TRUE(GetField(address, "secure")->As<BoolValue>().NativeValue());
+
+  ASSERT_OK_AND_ASSIGN(auto port, value->GetFieldByNumber(value_factory_, 2));
+  EXPECT_EQ(port->As<UintValue>().NativeValue(), 8080);
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "unknown"),
+              StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_EQ(value->field_count(), 7);
+}
+
+TEST_F(FixedLayoutStructTest, LittleEndian) {
+  FixedLayoutSchema::Builder builder("acme.Counters", 6);
+  builder.AddField("count", 1, FieldKind::kUint32, 0)
+      .AddField("delta", 2, FieldKind::kInt16, 4);
+  ASSERT_OK_AND_ASSIGN(auto schema, std::move(builder).Build());
+  constexpr char kCounters[] = {'\x01', '\x02', '\x00', '\x00', '\xfe', '\xff'};
+  ASSERT_OK_AND_ASSIGN(auto value,
+                       schema->NewStructValue(
+                           value_factory_,
+                           absl::string_view(kCounters, sizeof(kCounters))));
+  EXPECT_EQ(GetField(value, "count")->As<UintValue>().NativeValue(), 0x0201);
+  EXPECT_EQ(GetField(value, "delta")->As<IntValue>().NativeValue(), -2);
+}
+
+TEST_F(FixedLayoutStructTest, PresenceBits) {
+  std::string record(kRecord, sizeof(kRecord));
+  auto value = NewValue(record);
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "tenant"),
+              IsOkAndHolds(true));
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "version"),
+              IsOkAndHolds(true));
+
+  record[1] = '\0';
+  value = NewValue(record);
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "tenant"),
+              IsOkAndHolds(false));
+  EXPECT_EQ(GetField(value, "tenant")->As<StringValue>().ToString(), "");
+  EXPECT_EQ(value->field_count(), 6);
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "unknown"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(FixedLayoutStructTest, FieldHints) {
+  auto value = NewValue(absl::string_view(kRecord, sizeof(kRecord)));
+  const auto& struct_value = AbstractStructValue::Cast(*value);
+  const void* hint = struct_value.FindFieldHint("port");
+  ASSERT_NE(hint, nullptr);
+  EXPECT_EQ(struct_value.FindFieldHint("unknown"), nullptr);
+
+  ASSERT_OK_AND_ASSIGN(auto field,
+                       value->type()->FindFieldByName(type_manager_, "port"));
+  ASSERT_TRUE(field.has_value());
+  EXPECT_EQ(field->hint, hint);
+  EXPECT_EQ(field->number, 2);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto selected,
+      struct_value.GetFieldByHint(value_factory_, "port", hint,
+                                  /*unbox_null_wrapper_types=*/false));
+  ASSERT_TRUE(selected.has_value());
+  EXPECT_EQ((*selected)->As<UintValue>().NativeValue(), 8080);
+  EXPECT_THAT(struct_value.HasFieldByHint("port", hint),
+              IsOkAndHolds(absl::optional<bool>(true)));
+
+  // A hint pointing to another field, e.g. one cached for a destroyed schema
+  // whose memory was reused, does not apply.
+  EXPECT_THAT(struct_value.GetFieldByHint(value_factory_, "other", hint, false),
+              IsOkAndHolds(absl::nullopt));
+  EXPECT_THAT(struct_value.HasFieldByHint("other", hint),
+              IsOkAndHolds(absl::nullopt));
+
+  // Hints of other schemas do not apply.
+  auto address = GetField(value, "address").As<StructValue>();
+  EXPECT_THAT(AbstractStructValue::Cast(*address).GetFieldByHint(
+                  value_factory_, "port", hint, false),
+              IsOkAndHolds(absl::nullopt));
+}
+
+TEST_F(FixedLayoutStructTest, Qualify) {
+  auto value = NewValue(absl::string_view(kRecord, sizeof(kRecord)));
+  std::vector<SelectQualifier> path = {FieldSpecifier{5, "address"},
+                                       FieldSpecifier{2, "zone"}};
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       value->Qualify(value_factory_, path,
+                                      /*presence_test=*/false,
+                                      /*unbox_null_wrapper_types=*/false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_EQ(result.value->As<IntValue>().NativeValue(), -3);
+
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path,
+                                              /*presence_test=*/true,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_TRUE(result.value->As<BoolValue>().NativeValue());
+
+  // Numbers which do not match the name are resolved by name.
+  path = {FieldSpecifier{1, "address"}, FieldSpecifier{0, "secure"}};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path, false,
+                                              false));
+  EXPECT_TRUE(result.value->As<BoolValue>().NativeValue());
+
+  path = {FieldSpecifier{5, "address"}, FieldSpecifier{9, "unknown"}};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path, false,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_THAT(result.value->As<ErrorValue>().NativeValue(),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(FixedLayoutStructTest, QualifyStopsAtOtherValues) {
+  auto value = NewValue(absl::string_view(kRecord, sizeof(kRecord)));
+  // Selecting from a string is left to the caller.
+  std::vector<SelectQualifier> path = {FieldSpecifier{4, "tenant"},
+                                       FieldSpecifier{1, "size"}};
+  ASSERT_OK_AND_ASSIGN(auto result, value->Qualify(value_factory_, path,
+                                                   false, false));
+  EXPECT_EQ(result.qualifier_count, 1);
+  EXPECT_EQ(result.value->As<StringValue>().ToString(), "acme");
+
+  path = {FieldSpecifier{5, "address"}, AttributeQualifier::OfString("ip")};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path, false,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, 1);
+  EXPECT_EQ(result.value->As<StructValue>().type()->name(), "acme.Address");
+
+  path = {AttributeQualifier::OfString("address")};
+  EXPECT_THAT(value->Qualify(value_factory_, path, false, false),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST_F(FixedLayoutStructTest, InvalidRecords) {
+  EXPECT_THAT(schema_->NewStructValue(value_factory_,
+                                      absl::string_view(kRecord, 16)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  std::string record(kRecord, sizeof(kRecord));
+  record[8] = '\xff';
+  auto value = NewValue(record);
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "tenant"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(FixedLayoutSchemaBuilder, Errors) {
+  {
+    FixedLayoutSchema::Builder builder("acme.Header", 4);
+    builder.AddField("port", 1, FieldKind::kUint32, 2);
+    EXPECT_THAT(std::move(builder).Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+  {
+    FixedLayoutSchema::Builder builder("acme.Header", 4);
+    builder.AddField("port", 1, FieldKind::kUint16, 0)
+        .AddField("port", 2, FieldKind::kUint16, 2);
+    EXPECT_THAT(std::move(builder).Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+  {
+    FixedLayoutSchema::Builder builder("acme.Header", 4);
+    builder.AddField("port", 1, FieldKind::kUint16, 0)
+        .AddField("length", 1, FieldKind::kUint16, 2);
+    EXPECT_THAT(std::move(builder).Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+  {
+    FixedLayoutSchema::Builder builder("acme.Header", 4);
+    builder.AddField("port", 1, FieldKind::kUint16, 0, 4);
+    EXPECT_THAT(std::move(builder).Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+  {
+    FixedLayoutSchema::Builder builder("acme.Header", 4);
+    builder.SetPresenceBit("port", 0, 0x01);
+    EXPECT_THAT(std::move(builder).Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument));
+  }
+}
+
+}  // namespace
+}  // namespace cel::extensions
@@ -0,0 +1,346 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/mapped_table.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/map_value.h"
+#include "base/values/string_value.h"
+#include "internal/overloaded.h"
+#include "internal/status_macros.h"
+#include "internal/utf8.h"
+
+namespace cel::extensions {
+
+namespace {
+
+constexpr absl::string_view kMagic = "CELMTBL1";
+constexpr size_t kHeaderSize = 24;
+constexpr size_t kEntrySize = 16;
+
+uint64_t LoadUint64(const char* data) {
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t LoadUint32(const char* data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+template <typename T>
+void StoreInt(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+absl::Status ErrnoToStatus(absl::string_view op, const std::string& path) {
+  return absl::ErrnoToStatus(errno, absl::StrCat(op, " ", path));
+}
+
+// Returns the value of a string key without copying it if it is flat.
+template <typename F>
+auto WithKey(const Handle<Value>& key, F f) {
+  return key->As<StringValue>().Visit(cel::internal::Overloaded{
+      [&f](absl::string_view key) { return f(key); },
+      [&f](const absl::Cord& key) {
+        if (auto flat = key.TryFlat(); flat.has_value()) {
+          return f(*flat);
+        }
+        return f(static_cast<std::string>(key));
+      }});
+}
+
+// Creates a string value referencing the mapped file, keeping the table alive
+// for as long as the value is.
+Handle<StringValue> CreateMappedString(
+    ValueFactory& value_factory, absl::string_view value,
+    const std::shared_ptr<const MappedTable>& table) {
+  // Table contents are validated when it is opened.
+  return value_factory.CreateUncheckedStringValue(
+      absl::MakeCordFromExternal(value, [table]() {}));
+}
+
+class MappedTableMapValueIterator final : public MapValue::Iterator {
+ public:
+  MappedTableMapValueIterator(ValueFactory& value_factory,
+                              std::shared_ptr<const MappedTable> table)
+      : value_factory_(value_factory), table_(std::move(table)) {}
+
+  bool HasNext() override { return index_ < table_->size(); }
+
+  absl::StatusOr<Handle<Value>> Next() override {
+    if (index_ >= table_->size()) {
+      return absl::FailedPreconditionError(
+          "MapValue::Iterator::Next() called when "
+          "MapValue::Iterator::HasNext() returns false");
+    }
+    return CreateMappedString(value_factory_, table_->key(index_++), table_);
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const std::shared_ptr<const MappedTable> table_;
+  size_t index_ = 0;
+};
+
+class MappedTableMapValue final : public CEL_MAP_VALUE_CLASS {
+ public:
+  MappedTableMapValue(const Handle<MapType>& type,
+                      std::shared_ptr<const MappedTable> table)
+      : CEL_MAP_VALUE_CLASS(type), table_(std::move(table)) {}
+
+  std::string DebugString() const override {
+    // Tables are typically too large to print in full.
+    return absl::StrCat("mapped_table(", table_->size(), " entries)");
+  }
+
+  size_t Size() const override { return table_->size(); }
+
+  absl::StatusOr<Handle<ListValue>> ListKeys(
+      ValueFactory& value_factory) const override {
+    ListValueBuilder<StringValue> keys(
+        value_factory, value_factory.type_factory().GetStringType());
+    keys.Reserve(table_->size());
+    for (size_t i = 0; i < table_->size(); ++i) {
+      CEL_RETURN_IF_ERROR(keys.Add(
+          CreateMappedString(value_factory, table_->key(i), table_)));
+    }
+    return std::move(keys).Build();
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory) const override {
+    return std::make_unique<MappedTableMapValueIterator>(value_factory, table_);
+  }
+
+ private:
+  absl::StatusOr<std::pair<Handle<Value>, bool>> FindImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    if (!key->Is<StringValue>()) {
+      return std::make_pair(Handle<Value>(), false);
+    }
+    auto value = WithKey(key, [this](absl::string_view key) {
+      return table_->Find(key);
+    });
+    if (!value.has_value()) {
+      return std::make_pair(Handle<Value>(), false);
+    }
+    return std::make_pair(
+        Handle<Value>(CreateMappedString(value_factory, *value, table_)),
+        true);
+  }
+
+  absl::StatusOr<Handle<Value>> HasImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    if (!key->Is<StringValue>()) {
+      return value_factory.CreateBoolValue(false);
+    }
+    return value_factory.CreateBoolValue(
+        WithKey(key, [this](absl::string_view key) {
+          return table_->Find(key).has_value();
+        }));
+  }
+
+  const std::shared_ptr<const MappedTable> table_;
+
+  CEL_DECLARE_MAP_VALUE(MappedTableMapValue);
+};
+
+CEL_IMPLEMENT_MAP_VALUE(MappedTableMapValue);
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<const MappedTable>> MappedTable::Open(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ErrnoToStatus("open", path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto status = ErrnoToStatus("fstat", path);
+    close(fd);
+    return status;
+  }
+  size_t data_size = static_cast<size_t>(st.st_size);
+  if (data_size < kHeaderSize) {
+    close(fd);
+    return absl::InvalidArgumentError(
+        absl::StrCat("mapped table is truncated: ", path));
+  }
+  void* data = mmap(nullptr, data_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    auto status = ErrnoToStatus("mmap", path);
+    close(fd);
+    return status;
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  const char* bytes = static_cast<const char*>(data);
+  size_t size = 0;
+  if (absl::string_view(bytes, kMagic.size()) == kMagic) {
+    size = static_cast<size_t>(LoadUint64(bytes + 8));
+  }
+  std::shared_ptr<const MappedTable> table(
+      new MappedTable(bytes, data_size, size));
+  if (absl::Status status = table->Validate(); !status.ok()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(status.message(), ": ", path));
+  }
+  return table;
+}
+
+absl::Status MappedTable::Write(
+    const std::string& path,
+    std::vector<std::pair<std::string, std::string>> entries) {
+  std::sort(entries.begin(), entries.end());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (i > 0 && entries[i - 1].first == entries[i].first) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("duplicate mapped table key: ", entries[i].first));
+    }
+    if (!cel::internal::Utf8IsValid(entries[i].first) ||
+        !cel::internal::Utf8IsValid(entries[i].second)) {
+      return absl::InvalidArgumentError(
+          "mapped table entries must be valid UTF-8");
+    }
+  }
+  std::string header(kMagic);
+  std::string index;
+  std::string heap;
+  for (const auto& entry : entries) {
+    StoreInt<uint64_t>(index, heap.size());
+    StoreInt<uint32_t>(index, entry.first.size());
+    StoreInt<uint32_t>(index, entry.second.size());
+    heap.append(entry.first);
+    heap.append(entry.second);
+  }
+  StoreInt<uint64_t>(header, entries.size());
+  StoreInt<uint64_t>(header, kHeaderSize + index.size());
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << header << index << heap;
+  out.close();
+  if (!out) {
+    return absl::InternalError(
+        absl::StrCat("failed to write mapped table: ", path));
+  }
+  return absl::OkStatus();
+}
+
+MappedTable::MappedTable(const char* data, size_t data_size, size_t size)
+    : data_(data), data_size_(data_size), size_(size) {}
+
+MappedTable::~MappedTable() {
+  munmap(const_cast<char*>(data_), data_size_);
+}
+
+absl::Status MappedTable::Validate() const {
+  if (absl::string_view(data_, kMagic.size()) != kMagic) {
+    return absl::InvalidArgumentError("not a mapped table");
+  }
+  uint64_t heap_offset = LoadUint64(data_ + 16);
+  if (size_ > (data_size_ - kHeaderSize) / kEntrySize ||
+      heap_offset != kHeaderSize + size_ * kEntrySize) {
+    return absl::InvalidArgumentError("mapped table index is truncated");
+  }
+  uint64_t heap_size = data_size_ - heap_offset;
+  for (size_t i = 0; i < size_; ++i) {
+    const char* entry = data_ + kHeaderSize + i * kEntrySize;
+    uint64_t offset = LoadUint64(entry);
+    uint64_t entry_size =
+        uint64_t{LoadUint32(entry + 8)} + LoadUint32(entry + 12);
+    if (offset > heap_size || entry_size > heap_size - offset) {
+      return absl::InvalidArgumentError("mapped table entry is out of bounds");
+    }
+    if (i > 0 && !(key(i - 1) < key(i))) {
+      return absl::InvalidArgumentError("mapped table keys are not sorted");
+    }
+    if (!cel::internal::Utf8IsValid(key(i)) ||
+        !cel::internal::Utf8IsValid(value(i))) {
+      return absl::InvalidArgumentError(
+          "mapped table entries must be valid UTF-8");
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::string_view MappedTable::key(size_t index) const {
+  const char* entry = data_ + kHeaderSize + index * kEntrySize;
+  const char* heap = data_ + kHeaderSize + size_ * kEntrySize;
+  return absl::string_view(heap + LoadUint64(entry), LoadUint32(entry + 8));
+}
+
+absl::string_view MappedTable::value(size_t index) const {
+  const char* entry = data_ + kHeaderSize + index * kEntrySize;
+  const char* heap = data_ + kHeaderSize + size_ * kEntrySize;
+  return absl::string_view(heap + LoadUint64(entry) + LoadUint32(entry + 8),
+                           LoadUint32(entry + 12));
+}
+
+absl::optional<absl::string_view> MappedTable::Find(
+    absl::string_view key) const {
+  size_t low = 0;
+  size_t high = size_;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (this->key(mid) < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < size_ && this->key(low) == key) {
+    return value(low);
+  }
+  return absl::nullopt;
+}
+
+absl::StatusOr<Handle<MapValue>> MappedTable::NewMapValue(
+    ValueFactory& value_factory) const {
+  CEL_ASSIGN_OR_RETURN(auto type,
+                       value_factory.type_factory().CreateMapType(
+                           value_factory.type_factory().GetStringType(),
+                           value_factory.type_factory().GetStringType()));
+  return value_factory.CreateMapValue<MappedTableMapValue>(type,
+                                                           shared_from_this());
+}
+
+}  // namespace cel::extensions
@@ -0,0 +1,93 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EXTENSIONS_MAPPED_TABLE_H_
+#define THIRD_PARTY_CEL_CPP_EXTENSIONS_MAPPED_TABLE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/value_factory.h"
+#include "base/values/map_value.h"
+
+namespace cel::extensions {
+
+// Read-only table of string keys to string values, backed by a memory-mapped
+// file. Lookups binary search the mapped index and never copy or parse the
+// file, so a table with millions of entries costs nothing per program and is
+// shared by every program and thread once opened, typically next to the
+// runtime builder.
+//
+// File layout, in host byte order:
+//
+//   header:  char magic[8] = "CELMTBL1"; uint64 count; uint64 heap_offset;
+//   index:   count entries of {uint64 key_offset; uint32 key_size;
+//            uint32 value_size;}, sorted by key bytes;
+//   heap:    at heap_offset, each key immediately followed by its value.
+//
+// Keys and values must be valid UTF-8. Use `MappedTable::Write` to produce
+// files, and replace rather than rewrite files which may be mapped.
+class MappedTable final : public std::enable_shared_from_this<MappedTable> {
+ public:
+  // Maps the table file at path, validating its layout and contents.
+  static absl::StatusOr<std::shared_ptr<const MappedTable>> Open(
+      const std::string& path);
+
+  // Writes entries to a new table file at path. Keys must be unique.
+  static absl::Status Write(
+      const std::string& path,
+      std::vector<std::pair<std::string, std::string>> entries);
+
+  MappedTable(const MappedTable&) = delete;
+  MappedTable& operator=(const MappedTable&) = delete;
+
+  ~MappedTable();
+
+  size_t size() const { return size_; }
+
+  // Returns the key and value of the entry at index, in key order.
+  absl::string_view key(size_t index) const;
+  absl::string_view value(size_t index) const;
+
+  // Returns the value for key, or absl::nullopt if there is none. The view
+  // is valid for the lifetime of the table.
+  absl::optional<absl::string_view> Find(absl::string_view key) const;
+
+  // Returns a `map(string, string)` over the table. Values returned by the
+  // map reference the mapped file and keep the table alive, so creating the
+  // map for each activation is cheap.
+  absl::StatusOr<Handle<MapValue>> NewMapValue(
+      ValueFactory& value_factory) const;
+
+ private:
+  MappedTable(const char* data, size_t data_size, size_t size);
+
+  absl::Status Validate() const;
+
+  const char* data_;
+  size_t data_size_;
+  size_t size_;
+};
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_EXTENSIONS_MAPPED_TABLE_H_
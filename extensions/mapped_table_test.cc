@@ -0,0 +1,181 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/mapped_table.h"
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "base/values/map_value.h"
+#include "base/values/string_value.h"
+#include "internal/testing.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::internal::StatusIs;
+using testing::Optional;
+
+constexpr int kSize = 1000;
+
+std::string TablePath(absl::string_view name) {
+  return absl::StrCat(testing::TempDir(), "/", name);
+}
+
+class MappedTableTest : public testing::Test {
+ public:
+  MappedTableTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  void SetUp() override {
+    std::vector<std::pair<std::string, std::string>> entries;
+    // Written out of order, the writer sorts them.
+    for (int i = kSize - 1; i >= 0; --i) {
+      entries.push_back(
+          std::make_pair(absl::StrCat("key", i), absl::StrCat("value", i)));
+    }
+    std::string path = TablePath("table");
+    ASSERT_OK(MappedTable::Write(path, std::move(entries)));
+    ASSERT_OK_AND_ASSIGN(table_, MappedTable::Open(path));
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+  std::shared_ptr<const MappedTable> table_;
+};
+
+TEST_F(MappedTableTest, Find) {
+  EXPECT_EQ(table_->size(), kSize);
+  for (int i = 0; i < kSize; ++i) {
+    EXPECT_THAT(table_->Find(absl::StrCat("key", i)),
+                Optional(absl::StrCat("value", i)));
+  }
+  EXPECT_EQ(table_->Find(""), absl::nullopt);
+  EXPECT_EQ(table_->Find("key"), absl::nullopt);
+  EXPECT_EQ(table_->Find("key1000"), absl::nullopt);
+  EXPECT_EQ(table_->Find("zzz"), absl::nullopt);
+}
+
+TEST_F(MappedTableTest, MapValue) {
+  ASSERT_OK_AND_ASSIGN(auto map, table_->NewMapValue(value_factory_));
+  EXPECT_EQ(map->Size(), kSize);
+  ASSERT_OK_AND_ASSIGN(auto key, value_factory_.CreateStringValue("key42"));
+  ASSERT_OK_AND_ASSIGN(auto found, map->Find(value_factory_, key));
+  ASSERT_TRUE(found.second);
+  EXPECT_EQ(found.first->As<StringValue>().ToString(), "value42");
+  ASSERT_OK_AND_ASSIGN(auto has, map->Has(value_factory_, key));
+  EXPECT_TRUE(has->As<BoolValue>().NativeValue());
+
+  ASSERT_OK_AND_ASSIGN(key, value_factory_.CreateStringValue("missing"));
+  ASSERT_OK_AND_ASSIGN(found, map->Find(value_factory_, key));
+  EXPECT_FALSE(found.second);
+  ASSERT_OK_AND_ASSIGN(has, map->Has(value_factory_, key));
+  EXPECT_FALSE(has->As<BoolValue>().NativeValue());
+
+  ASSERT_OK_AND_ASSIGN(has, map->Has(value_factory_,
+                                     value_factory_.CreateIntValue(42)));
+  EXPECT_FALSE(has->As<BoolValue>().NativeValue());
+}
+
+TEST_F(MappedTableTest, ValuesOutliveTable) {
+  ASSERT_OK_AND_ASSIGN(auto map, table_->NewMapValue(value_factory_));
+  ASSERT_OK_AND_ASSIGN(auto key, value_factory_.CreateStringValue("key7"));
+  ASSERT_OK_AND_ASSIGN(auto value, map->Get(value_factory_, key));
+  table_.reset();
+  map = Handle<MapValue>();
+  EXPECT_EQ(value->As<StringValue>().ToString(), "value7");
+}
+
+TEST_F(MappedTableTest, Iterator) {
+  ASSERT_OK_AND_ASSIGN(auto map, table_->NewMapValue(value_factory_));
+  ASSERT_OK_AND_ASSIGN(auto iterator, map->NewIterator(value_factory_));
+  int count = 0;
+  std::string previous;
+  while (iterator->HasNext()) {
+    ASSERT_OK_AND_ASSIGN(auto key, iterator->Next());
+    std::string current = key->As<StringValue>().ToString();
+    EXPECT_LT(previous, current);
+    previous = std::move(current);
+    ++count;
+  }
+  EXPECT_EQ(count, kSize);
+  EXPECT_THAT(iterator->Next(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  ASSERT_OK_AND_ASSIGN(auto keys, map->ListKeys(value_factory_));
+  EXPECT_EQ(keys->Size(), kSize);
+}
+
+TEST(MappedTable, DuplicateKeys) {
+  EXPECT_THAT(MappedTable::Write(TablePath("duplicate"),
+                                 {{"a", "1"}, {"b", "2"}, {"a", "3"}}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(MappedTable, Empty) {
+  std::string path = TablePath("empty");
+  ASSERT_OK(MappedTable::Write(path, {}));
+  ASSERT_OK_AND_ASSIGN(auto table, MappedTable::Open(path));
+  EXPECT_EQ(table->size(), 0);
+  EXPECT_EQ(table->Find("a"), absl::nullopt);
+}
+
+TEST(MappedTable, InvalidFiles) {
+  EXPECT_THAT(MappedTable::Open(TablePath("does_not_exist")),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  std::string path = TablePath("invalid");
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "not a mapped table, just some text";
+  }
+  EXPECT_THAT(MappedTable::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  // A valid table cut short inside its heap.
+  ASSERT_OK(MappedTable::Write(path, {{"key", "a long enough value"}}));
+  std::string contents;
+  {
+    std::ifstream in(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents.substr(0, contents.size() - 4);
+  }
+  EXPECT_THAT(MappedTable::Open(path),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace cel::extensions
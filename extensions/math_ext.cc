@@ -14,12 +14,22 @@
 
 #include "extensions/math_ext.h"
 
+#include <cstddef>
 #include <cstdint>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/uint_value.h"
+#include "eval/internal/interop.h"
 #include "eval/public/cel_function_registry.h"
 #include "eval/public/cel_number.h"
 #include "eval/public/cel_options.h"
@@ -32,6 +42,9 @@ namespace cel::extensions {
 
 namespace {
 
+using ::cel::base_internal::CompactListValue;
+using ::cel::base_internal::CompactScalar;
+using ::cel::base_internal::StaticListValue;
 using ::google::api::expr::runtime::CelFunctionRegistry;
 using ::google::api::expr::runtime::CelList;
 using ::google::api::expr::runtime::CelNumber;
@@ -88,11 +101,94 @@ CelValue Min(Arena *arena, T v1, U v2) {
   return MinValue(CelNumber(v1), CelNumber(v2));
 }
 
+// Returns the least of values, or the greatest if `greatest` is set. The
+// loop has no early exits or per element checks, so it is vectorized for
+// integers.
+template <typename T, typename Get>
+auto Extremum(absl::Span<const T> values, bool greatest, Get get) {
+  auto result = get(values[0]);
+  if (greatest) {
+    for (size_t i = 1; i < values.size(); ++i) {
+      auto value = get(values[i]);
+      result = value > result ? value : result;
+    }
+  } else {
+    for (size_t i = 1; i < values.size(); ++i) {
+      auto value = get(values[i]);
+      result = value < result ? value : result;
+    }
+  }
+  return result;
+}
+
+template <typename T>
+T Extremum(absl::Span<const T> values, bool greatest) {
+  return Extremum(values, greatest, [](T value) { return value; });
+}
+
+// Reduces non-empty lists whose elements are stored natively as numbers of a
+// single kind (see base/values/list_value_builder.h), e.g. list literals and
+// comprehension results, without creating a value per element. Returns
+// nullopt for other lists, which are reduced element by element.
+absl::optional<CelValue> PackedExtremum(const CelList *values, bool greatest) {
+  Handle<ListValue> handle = interop_internal::CreateLegacyListValue(values);
+  const ListValue &list = *handle;
+  if (list.Is<StaticListValue<IntValue>>()) {
+    return CelValue::CreateInt64(Extremum(
+        absl::MakeConstSpan(
+            list.As<StaticListValue<IntValue>>().NativeValues()),
+        greatest));
+  }
+  if (list.Is<StaticListValue<UintValue>>()) {
+    return CelValue::CreateUint64(Extremum(
+        absl::MakeConstSpan(
+            list.As<StaticListValue<UintValue>>().NativeValues()),
+        greatest));
+  }
+  if (list.Is<StaticListValue<DoubleValue>>()) {
+    return CelValue::CreateDouble(Extremum(
+        absl::MakeConstSpan(
+            list.As<StaticListValue<DoubleValue>>().NativeValues()),
+        greatest));
+  }
+  if (!list.Is<CompactListValue>()) {
+    return absl::nullopt;
+  }
+  absl::Span<const CompactScalar> scalars =
+      absl::MakeConstSpan(list.As<CompactListValue>().NativeValues());
+  const ValueKind kind = scalars[0].kind();
+  for (const CompactScalar &scalar : scalars) {
+    if (scalar.kind() != kind) {
+      return absl::nullopt;
+    }
+  }
+  switch (kind) {
+    case ValueKind::kInt:
+      return CelValue::CreateInt64(
+          Extremum(scalars, greatest,
+                   [](const CompactScalar &v) { return v.int_value(); }));
+    case ValueKind::kUint:
+      return CelValue::CreateUint64(
+          Extremum(scalars, greatest,
+                   [](const CompactScalar &v) { return v.uint_value(); }));
+    case ValueKind::kDouble:
+      return CelValue::CreateDouble(
+          Extremum(scalars, greatest,
+                   [](const CompactScalar &v) { return v.double_value(); }));
+    default:
+      return absl::nullopt;
+  }
+}
+
 CelValue MinList(Arena *arena, const CelList *values) {
   if (values->empty()) {
     return CreateErrorValue(arena, "math.@min argument must not be empty",
                             absl::StatusCode::kInvalidArgument);
   }
+  if (absl::optional<CelValue> min = PackedExtremum(values, false);
+      min.has_value()) {
+    return *min;
+  }
   CelValue value = values->Get(arena, 0);
   absl::StatusOr<CelNumber> current = ValueToNumber(value, kMathMin);
   if (!current.ok()) {
@@ -134,6 +230,10 @@ CelValue MaxList(Arena *arena, const CelList *values) {
     return CreateErrorValue(arena, "math.@max argument must not be empty",
                             absl::StatusCode::kInvalidArgument);
   }
+  if (absl::optional<CelValue> max = PackedExtremum(values, true);
+      max.has_value()) {
+    return *max;
+  }
   CelValue value = values->Get(arena, 0);
   absl::StatusOr<CelNumber> current = ValueToNumber(value, kMathMax);
   if (!current.ok()) {
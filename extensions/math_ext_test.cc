@@ -339,6 +339,9 @@ INSTANTIATE_TEST_SUITE_P(
         {"math.least(1u, dyn(42), dyn(0.0)) == 0u"},
         // math.least with a list literal.
         {"math.least([1u, 42u, 0u]) == 0u"},
+        {"math.least([3, -5, 2, -5, 7]) == -5"},
+        {"math.least([0.5, -2.5, 1.0]) == -2.5"},
+        {"math.least([2, 1.5, 3u]) == 1.5"},
         // math.least errors
         {
             "math.least()",
@@ -396,6 +399,9 @@ INSTANTIATE_TEST_SUITE_P(
         {"math.greatest(1u, dyn(0.0), 0u) == 1"},
         // math.greatest with a list literal
         {"math.greatest([1u, dyn(0.0), 0u]) == 1"},
+        {"math.greatest([3, -5, 2, 7, 7]) == 7"},
+        {"math.greatest([0.5, -2.5, 1.0]) == 1.0"},
+        {"math.greatest([2, 1.5, 3u]) == 3u"},
         // math.greatest errors
         {
             "math.greatest()",
@@ -0,0 +1,401 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/native_struct.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+#include "internal/status_macros.h"
+#include "runtime/internal/errors.h"
+
+namespace cel::extensions {
+
+namespace {
+
+using ::cel::base_internal::FieldIdFactory;
+
+class NativeStructType final : public CEL_STRUCT_TYPE_CLASS {
+ public:
+  explicit NativeStructType(const NativeStructSchema& schema)
+      : schema_(schema) {}
+
+  static absl::StatusOr<Field> MakeField(TypeFactory& type_factory,
+                                         const NativeStructSchema& schema,
+                                         const NativeStructField& field) {
+    CEL_ASSIGN_OR_RETURN(auto type, field.type(type_factory));
+    // The hint is the schema field, as for NativeStructValue.
+    return Field(FieldIdFactory::Make(field.name), field.name,
+                 schema.FieldNumber(field), std::move(type), &field);
+  }
+
+  absl::string_view name() const override { return schema_.name(); }
+
+  size_t field_count() const override { return schema_.fields().size(); }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByName(
+      TypeManager& type_manager, absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), schema_, *field);
+  }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByNumber(
+      TypeManager& type_manager, int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), schema_, *field);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(TypeManager& type_manager) const override;
+
+ private:
+  const NativeStructSchema& schema_;
+
+  CEL_DECLARE_STRUCT_TYPE(NativeStructType);
+};
+
+CEL_IMPLEMENT_STRUCT_TYPE(NativeStructType);
+
+class NativeStructTypeFieldIterator final : public StructType::FieldIterator {
+ public:
+  NativeStructTypeFieldIterator(TypeManager& type_manager,
+                                const NativeStructSchema& schema)
+      : type_manager_(type_manager), schema_(schema) {}
+
+  bool HasNext() override { return index_ < schema_.fields().size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= schema_.fields().size())) {
+      return absl::FailedPreconditionError(
+          "StructType::FieldIterator::Next() called when "
+          "StructType::FieldIterator::HasNext() returns false");
+    }
+    return NativeStructType::MakeField(type_manager_.type_factory(), schema_,
+                                       schema_.fields()[index_++]);
+  }
+
+ private:
+  TypeManager& type_manager_;
+  const NativeStructSchema& schema_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructType::FieldIterator>>>
+NativeStructType::NewFieldIterator(TypeManager& type_manager) const {
+  return std::make_unique<NativeStructTypeFieldIterator>(type_manager,
+                                                         schema_);
+}
+
+class NativeStructValue final : public CEL_STRUCT_VALUE_CLASS {
+ public:
+  NativeStructValue(const Handle<StructType>& type,
+                    const NativeStructSchema& schema, const void* object)
+      : CEL_STRUCT_VALUE_CLASS(type), schema_(schema), object_(object) {}
+
+  std::string DebugString() const override {
+    // Printing fields would require a value factory.
+    return absl::StrCat(schema_.name(), "{", field_count(), " fields}");
+  }
+
+  size_t field_count() const override {
+    return std::count_if(schema_.fields().begin(), schema_.fields().end(),
+                         [this](const NativeStructField& field) {
+                           return field.has(object_);
+                         });
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByName(
+      ValueFactory& value_factory, absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return field->get(value_factory, object_);
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByNumber(
+      ValueFactory& value_factory, int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return field->get(value_factory, object_);
+  }
+
+  absl::StatusOr<QualifyResult> Qualify(
+      ValueFactory& value_factory,
+      absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+      bool unbox_null_wrapper_types) const override;
+
+  absl::StatusOr<bool> HasFieldByName(TypeManager& type_manager,
+                                      absl::string_view name) const override {
+    const auto* field = schema_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return field->has(object_);
+  }
+
+  absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
+                                        int64_t number) const override {
+    const auto* field = schema_.FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return field->has(object_);
+  }
+
+  // The hint is the schema field, which holds the accessors of the member.
+  const void* FindFieldHint(absl::string_view name) const override {
+    return schema_.FindField(name);
+  }
+
+  absl::StatusOr<absl::optional<Handle<Value>>> GetFieldByHint(
+      ValueFactory& value_factory, absl::string_view name, const void* hint,
+      bool unbox_null_wrapper_types) const override {
+    const auto* field = schema_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return field->get(value_factory, object_);
+  }
+
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      absl::string_view name, const void* hint) const override {
+    const auto* field = schema_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return field->has(object_);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(ValueFactory& value_factory) const override;
+
+ private:
+  const NativeStructSchema& schema_;
+  const void* const object_;
+
+  CEL_DECLARE_STRUCT_VALUE(NativeStructValue);
+};
+
+CEL_IMPLEMENT_STRUCT_VALUE(NativeStructValue);
+
+// Resolves select paths through nested structs by following the members,
+// only creating the value of the last field applied.
+absl::StatusOr<QualifyResult> NativeStructValue::Qualify(
+    ValueFactory& value_factory,
+    absl::Span<const SelectQualifier> select_qualifiers, bool presence_test,
+    bool unbox_null_wrapper_types) const {
+  const NativeStructSchema* schema = &schema_;
+  const void* object = object_;
+  for (size_t i = 0; i < select_qualifiers.size(); ++i) {
+    const auto* specifier =
+        absl::get_if<FieldSpecifier>(&select_qualifiers[i]);
+    if (specifier == nullptr) {
+      // Index and key qualifiers apply to lists and maps, which native
+      // structs do not hold. Let the caller apply them to the struct selected
+      // so far.
+      if (i == 0) {
+        return absl::UnimplementedError(
+            "Qualify of a native struct by a key is not supported.");
+      }
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           native_struct_internal::CreateStructValue(
+                               value_factory, *schema, object));
+      return QualifyResult{std::move(value), static_cast<int>(i)};
+    }
+    // Numbers come from the struct type, names from the expression. Prefer
+    // the number, which is cheaper to find.
+    const NativeStructField* field =
+        schema->FindFieldByNumber(specifier->number);
+    if (field == nullptr || field->name != specifier->name) {
+      field = schema->FindField(specifier->name);
+    }
+    if (field == nullptr) {
+      return QualifyResult{
+          value_factory.CreateErrorValue(
+              runtime_internal::CreateNoSuchFieldError(specifier->name)),
+          -1};
+    }
+    const bool last = i + 1 == select_qualifiers.size();
+    if (last && presence_test) {
+      return QualifyResult{value_factory.CreateBoolValue(field->has(object)),
+                           -1};
+    }
+    const void* nested = field->nested_object == nullptr
+                             ? nullptr
+                             : field->nested_object(object);
+    if (last || nested == nullptr) {
+      CEL_ASSIGN_OR_RETURN(auto value, field->get(value_factory, object));
+      return QualifyResult{std::move(value),
+                           last ? -1 : static_cast<int>(i + 1)};
+    }
+    schema = &field->nested_schema();
+    object = nested;
+  }
+  // Unreachable unless there are no qualifiers.
+  return absl::InvalidArgumentError("Qualify requires qualifiers.");
+}
+
+class NativeStructValueFieldIterator final
+    : public StructValue::FieldIterator {
+ public:
+  NativeStructValueFieldIterator(ValueFactory& value_factory,
+                                 const void* object,
+                                 std::vector<const NativeStructField*> fields)
+      : value_factory_(value_factory),
+        object_(object),
+        fields_(std::move(fields)) {}
+
+  bool HasNext() override { return index_ < fields_.size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= fields_.size())) {
+      return absl::FailedPreconditionError(
+          "StructValue::FieldIterator::Next() called when "
+          "StructValue::FieldIterator::HasNext() returns false");
+    }
+    const auto* field = fields_[index_++];
+    CEL_ASSIGN_OR_RETURN(auto value, field->get(value_factory_, object_));
+    return Field(FieldIdFactory::Make(field->name), std::move(value));
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const void* const object_;
+  const std::vector<const NativeStructField*> fields_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructValue::FieldIterator>>>
+NativeStructValue::NewFieldIterator(ValueFactory& value_factory) const {
+  std::vector<const NativeStructField*> fields;
+  for (const auto& field : schema_.fields()) {
+    if (field.has(object_)) {
+      fields.push_back(&field);
+    }
+  }
+  return std::make_unique<NativeStructValueFieldIterator>(
+      value_factory, object_, std::move(fields));
+}
+
+}  // namespace
+
+NativeStructSchema::NativeStructSchema(
+    absl::string_view name, absl::Span<const NativeStructField> fields)
+    : name_(name), fields_(fields) {
+  fields_by_name_.reserve(fields_.size());
+  for (const auto& field : fields_) {
+    fields_by_name_.push_back(&field);
+  }
+  std::sort(fields_by_name_.begin(), fields_by_name_.end(),
+            [](const NativeStructField* lhs, const NativeStructField* rhs) {
+              return lhs->name < rhs->name;
+            });
+}
+
+const NativeStructField* NativeStructSchema::FindField(
+    absl::string_view name) const {
+  auto it = std::lower_bound(
+      fields_by_name_.begin(), fields_by_name_.end(), name,
+      [](const NativeStructField* field, absl::string_view name) {
+        return field->name < name;
+      });
+  if (it == fields_by_name_.end() || (*it)->name != name) {
+    return nullptr;
+  }
+  return *it;
+}
+
+const NativeStructField* NativeStructSchema::FindFieldByNumber(
+    int64_t number) const {
+  if (number < 1 || number > static_cast<int64_t>(fields_.size())) {
+    return nullptr;
+  }
+  return &fields_[number - 1];
+}
+
+const NativeStructField* NativeStructSchema::FieldForHint(
+    const void* hint, absl::string_view name) const {
+  // std::less orders unrelated pointers, unlike the built-in operators.
+  std::less<const void*> less;
+  const NativeStructField* begin = fields_.data();
+  const NativeStructField* end = begin + fields_.size();
+  if (less(hint, begin) || !less(hint, end)) {
+    return nullptr;
+  }
+  // A hint cached for a destroyed schema may point into the fields of this
+  // one, which reused its memory, so it must also be a whole field named
+  // `name`.
+  uintptr_t offset = reinterpret_cast<uintptr_t>(hint) -
+                     reinterpret_cast<uintptr_t>(begin);
+  if (offset % sizeof(NativeStructField) != 0) {
+    return nullptr;
+  }
+  const auto* field = static_cast<const NativeStructField*>(hint);
+  if (field->name != name) {
+    return nullptr;
+  }
+  return field;
+}
+
+absl::StatusOr<Handle<StructType>> NativeStructSchema::GetType(
+    TypeFactory& type_factory) const {
+  return type_factory.CreateStructType<NativeStructType>(*this);
+}
+
+namespace native_struct_internal {
+
+absl::StatusOr<Handle<StructValue>> CreateStructValue(
+    ValueFactory& value_factory, const NativeStructSchema& schema,
+    const void* object) {
+  CEL_ASSIGN_OR_RETURN(auto type, schema.GetType(value_factory.type_factory()));
+  return value_factory.CreateStructValue<NativeStructValue>(std::move(type),
+                                                            schema, object);
+}
+
+}  // namespace native_struct_internal
+
+}  // namespace cel::extensions
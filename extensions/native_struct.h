@@ -0,0 +1,341 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EXTENSIONS_NATIVE_STRUCT_H_
+#define THIRD_PARTY_CEL_CPP_EXTENSIONS_NATIVE_STRUCT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+
+namespace cel::extensions {
+
+class NativeStructSchema;
+
+// A member of a native C++ struct exposed as a field of a CEL struct. The
+// functions are instantiated for the member, so reading it is a direct
+// member access. Created by `CEL_NATIVE_STRUCT_FIELD`.
+struct NativeStructField final {
+  absl::string_view name;
+  absl::StatusOr<Handle<Type>> (*type)(TypeFactory& type_factory);
+  // Reads the member of `object`, an instance of the struct of the schema.
+  absl::StatusOr<Handle<Value>> (*get)(ValueFactory& value_factory,
+                                       const void* object);
+  bool (*has)(const void* object);
+  // For members holding a bound struct, by value or by pointer, the schema
+  // of the held struct and the held object, which is null if absent. Both
+  // are null for other members.
+  const NativeStructSchema& (*nested_schema)();
+  const void* (*nested_object)(const void* object);
+};
+
+// The fields of a native C++ struct, declared with `CEL_NATIVE_STRUCT`.
+// Struct values of a schema reference the object they were created for
+// without copying it: selects and `has()` read only the selected member, and
+// select paths through nested structs, as planned by the select
+// optimization, are qualified without creating the intermediate values.
+//
+// Supported members are bool, integral, enum and floating point members,
+// std::string and absl::string_view, absl::Duration and absl::Time, and
+// structs with their own binding, held by value, by raw pointer or by
+// std::unique_ptr or std::shared_ptr. String members are not copied either.
+//
+// Scalar members are present when they are not the zero value, as for
+// proto3 fields. Structs held by value are always present, and structs held
+// by pointer when the pointer is not null; absent ones read as null.
+class NativeStructSchema final {
+ public:
+  NativeStructSchema(absl::string_view name,
+                     absl::Span<const NativeStructField> fields);
+
+  NativeStructSchema(const NativeStructSchema&) = delete;
+  NativeStructSchema& operator=(const NativeStructSchema&) = delete;
+
+  // The name of the struct type.
+  absl::string_view name() const { return name_; }
+
+  // In declaration order. The number of a field is its position, starting
+  // at 1.
+  absl::Span<const NativeStructField> fields() const { return fields_; }
+
+  int64_t FieldNumber(const NativeStructField& field) const {
+    return &field - fields_.data() + 1;
+  }
+
+  // Returns the field `name` or `number`, or nullptr if there is no such
+  // field.
+  const NativeStructField* FindField(absl::string_view name) const;
+  const NativeStructField* FindFieldByNumber(int64_t number) const;
+
+  // Returns the field `name` if `hint` points to it among the fields of this
+  // schema, or nullptr. `hint` may be any pointer: it is only dereferenced
+  // once it is known to point to a field of this schema.
+  const NativeStructField* FieldForHint(const void* hint,
+                                        absl::string_view name) const;
+
+  absl::StatusOr<Handle<StructType>> GetType(TypeFactory& type_factory) const;
+
+ private:
+  const std::string name_;
+  const absl::Span<const NativeStructField> fields_;
+  // Ordered by name.
+  std::vector<const NativeStructField*> fields_by_name_;
+};
+
+namespace native_struct_internal {
+
+// Creates the struct value of `schema` over `object`, which must be an
+// instance of the struct of the schema.
+absl::StatusOr<Handle<StructValue>> CreateStructValue(
+    ValueFactory& value_factory, const NativeStructSchema& schema,
+    const void* object);
+
+// Whether `T` has a binding, declared by `CEL_NATIVE_STRUCT` in its
+// namespace.
+template <typename T, typename = void>
+struct IsBound : std::false_type {};
+
+template <typename T>
+struct IsBound<T, std::void_t<decltype(CelNativeStructSchema(
+                      static_cast<const T*>(nullptr)))>> : std::true_type {};
+
+template <typename T>
+const NativeStructSchema& SchemaOf() {
+  return CelNativeStructSchema(static_cast<const T*>(nullptr));
+}
+
+// The struct pointed to by the pointer types supported as members, or void.
+template <typename F>
+struct Pointee {
+  using type = void;
+};
+
+template <typename U>
+struct Pointee<U*> {
+  using type = std::remove_cv_t<U>;
+};
+
+template <typename U, typename D>
+struct Pointee<std::unique_ptr<U, D>> {
+  using type = std::remove_cv_t<U>;
+};
+
+template <typename U>
+struct Pointee<std::shared_ptr<U>> {
+  using type = std::remove_cv_t<U>;
+};
+
+template <typename F>
+inline constexpr bool kIsBoundPointer = IsBound<typename Pointee<F>::type>();
+
+template <typename F>
+inline constexpr bool kIsString = std::is_same_v<F, std::string> ||
+                                  std::is_same_v<F, absl::string_view>;
+
+template <typename F>
+inline constexpr bool kAlwaysFalse = false;
+
+template <typename M>
+struct MemberOf;
+
+template <typename T, typename F>
+struct MemberOf<F T::*> {
+  using type = std::remove_cv_t<F>;
+};
+
+template <typename T, auto Member>
+const auto& GetMember(const void* object) {
+  return static_cast<const T*>(object)->*Member;
+}
+
+template <typename F>
+absl::StatusOr<Handle<Type>> MemberType(TypeFactory& type_factory) {
+  if constexpr (std::is_same_v<F, bool>) {
+    return type_factory.GetBoolType();
+  } else if constexpr (std::is_floating_point_v<F>) {
+    return type_factory.GetDoubleType();
+  } else if constexpr (std::is_enum_v<F> || std::is_signed_v<F>) {
+    return type_factory.GetIntType();
+  } else if constexpr (std::is_unsigned_v<F>) {
+    return type_factory.GetUintType();
+  } else if constexpr (kIsString<F>) {
+    return type_factory.GetStringType();
+  } else if constexpr (std::is_same_v<F, absl::Duration>) {
+    return type_factory.GetDurationType();
+  } else if constexpr (std::is_same_v<F, absl::Time>) {
+    return type_factory.GetTimestampType();
+  } else if constexpr (IsBound<F>()) {
+    return SchemaOf<F>().GetType(type_factory);
+  } else if constexpr (kIsBoundPointer<F>) {
+    return SchemaOf<typename Pointee<F>::type>().GetType(type_factory);
+  } else {
+    static_assert(kAlwaysFalse<F>, "unsupported member type");
+  }
+}
+
+template <typename T, auto Member>
+absl::StatusOr<Handle<Type>> FieldType(TypeFactory& type_factory) {
+  return MemberType<typename MemberOf<decltype(Member)>::type>(type_factory);
+}
+
+template <typename T, auto Member>
+absl::StatusOr<Handle<Value>> GetField(ValueFactory& value_factory,
+                                       const void* object) {
+  const auto& value = GetMember<T, Member>(object);
+  using F = typename MemberOf<decltype(Member)>::type;
+  if constexpr (std::is_same_v<F, bool>) {
+    return value_factory.CreateBoolValue(value);
+  } else if constexpr (std::is_floating_point_v<F>) {
+    return value_factory.CreateDoubleValue(static_cast<double>(value));
+  } else if constexpr (std::is_enum_v<F> || std::is_signed_v<F>) {
+    return value_factory.CreateIntValue(static_cast<int64_t>(value));
+  } else if constexpr (std::is_unsigned_v<F>) {
+    return value_factory.CreateUintValue(static_cast<uint64_t>(value));
+  } else if constexpr (kIsString<F>) {
+    return value_factory.CreateUnownedStringValue(value);
+  } else if constexpr (std::is_same_v<F, absl::Duration>) {
+    return value_factory.CreateUncheckedDurationValue(value);
+  } else if constexpr (std::is_same_v<F, absl::Time>) {
+    return value_factory.CreateUncheckedTimestampValue(value);
+  } else if constexpr (IsBound<F>()) {
+    return CreateStructValue(value_factory, SchemaOf<F>(), &value);
+  } else if constexpr (kIsBoundPointer<F>) {
+    if (value == nullptr) {
+      return value_factory.GetNullValue();
+    }
+    return CreateStructValue(value_factory,
+                             SchemaOf<typename Pointee<F>::type>(),
+                             &*value);
+  } else {
+    static_assert(kAlwaysFalse<F>, "unsupported member type");
+  }
+}
+
+template <typename T, auto Member>
+bool HasField(const void* object) {
+  const auto& value = GetMember<T, Member>(object);
+  using F = typename MemberOf<decltype(Member)>::type;
+  if constexpr (kIsString<F>) {
+    return !value.empty();
+  } else if constexpr (std::is_same_v<F, absl::Duration>) {
+    return value != absl::ZeroDuration();
+  } else if constexpr (std::is_same_v<F, absl::Time>) {
+    return value != absl::UnixEpoch();
+  } else if constexpr (IsBound<F>()) {
+    return true;
+  } else if constexpr (kIsBoundPointer<F>) {
+    return value != nullptr;
+  } else {
+    return value != F{};
+  }
+}
+
+template <typename T, auto Member>
+const void* NestedObject(const void* object) {
+  const auto& value = GetMember<T, Member>(object);
+  using F = typename MemberOf<decltype(Member)>::type;
+  if constexpr (IsBound<F>()) {
+    return &value;
+  } else {
+    return value == nullptr ? nullptr : &*value;
+  }
+}
+
+template <typename T, auto Member>
+constexpr NativeStructField MakeField(absl::string_view name) {
+  using F = typename MemberOf<decltype(Member)>::type;
+  NativeStructField field{name,
+                          &FieldType<T, Member>,
+                          &GetField<T, Member>,
+                          &HasField<T, Member>,
+                          nullptr,
+                          nullptr};
+  if constexpr (IsBound<F>()) {
+    field.nested_schema = &SchemaOf<F>;
+    field.nested_object = &NestedObject<T, Member>;
+  } else if constexpr (kIsBoundPointer<F>) {
+    field.nested_schema = &SchemaOf<typename Pointee<F>::type>;
+    field.nested_object = &NestedObject<T, Member>;
+  }
+  return field;
+}
+
+}  // namespace native_struct_internal
+
+// Returns a struct value over `object`, whose type has a binding declared by
+// `CEL_NATIVE_STRUCT`, without copying it. `object` must outlive the returned
+// value and every value derived from it, e.g. request context kept alive
+// until evaluation results are discarded.
+template <typename T>
+absl::StatusOr<Handle<StructValue>> CreateNativeStructValue(
+    ValueFactory& value_factory, const T& object) {
+  static_assert(native_struct_internal::IsBound<T>(),
+                "T has no CEL_NATIVE_STRUCT binding");
+  return native_struct_internal::CreateStructValue(
+      value_factory, native_struct_internal::SchemaOf<T>(), &object);
+}
+
+}  // namespace cel::extensions
+
+// A field of `CEL_NATIVE_STRUCT` reading the member `member` of `type`.
+#define CEL_NATIVE_STRUCT_FIELD(type, member)                            \
+  ::cel::extensions::native_struct_internal::MakeField<type, &type::member>( \
+      #member)
+
+// Declares the binding of the native struct `type` as the CEL struct type
+// `name`, with the fields listed. Must be used in the namespace of `type`,
+// after the bindings of the structs it holds. For example:
+//
+//   struct Peer {
+//     std::string address;
+//     uint32_t port;
+//   };
+//   CEL_NATIVE_STRUCT(Peer, "acme.Peer",
+//                     CEL_NATIVE_STRUCT_FIELD(Peer, address),
+//                     CEL_NATIVE_STRUCT_FIELD(Peer, port));
+//
+//   struct Request {
+//     std::string path;
+//     const Peer* peer;
+//   };
+//   CEL_NATIVE_STRUCT(Request, "acme.Request",
+//                     CEL_NATIVE_STRUCT_FIELD(Request, path),
+//                     CEL_NATIVE_STRUCT_FIELD(Request, peer));
+//
+// The field table is a constant, and the schema is created on first use.
+#define CEL_NATIVE_STRUCT(type, name, ...)                                \
+  inline const ::cel::extensions::NativeStructSchema& CelNativeStructSchema( \
+      const type*) {                                                        \
+    static constexpr ::cel::extensions::NativeStructField kFields[] = {     \
+        __VA_ARGS__};                                                       \
+    static const ::cel::extensions::NativeStructSchema* const schema =     \
+        new ::cel::extensions::NativeStructSchema(name, kFields);           \
+    return *schema;                                                         \
+  }
+
+#endif  // THIRD_PARTY_CEL_CPP_EXTENSIONS_NATIVE_STRUCT_H_
@@ -0,0 +1,265 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/native_struct.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/error_value.h"
+#include "base/values/int_value.h"
+#include "base/values/null_value.h"
+#include "base/values/string_value.h"
+#include "base/values/struct_value.h"
+#include "base/values/uint_value.h"
+#include "internal/testing.h"
+
+namespace acme {
+
+enum class Protocol { kUnknown, kHttp, kGrpc };
+
+struct Peer {
+  std::string address;
+  uint32_t port = 0;
+  bool secure = false;
+};
+
+CEL_NATIVE_STRUCT(Peer, "acme.Peer", CEL_NATIVE_STRUCT_FIELD(Peer, address),
+                  CEL_NATIVE_STRUCT_FIELD(Peer, port),
+                  CEL_NATIVE_STRUCT_FIELD(Peer, secure));
+
+struct Request {
+  absl::string_view path;
+  int32_t attempt = 0;
+  Protocol protocol = Protocol::kUnknown;
+  double weight = 0;
+  absl::Duration timeout;
+  Peer origin;
+  std::unique_ptr<Peer> proxy;
+};
+
+CEL_NATIVE_STRUCT(Request, "acme.Request",
+                  CEL_NATIVE_STRUCT_FIELD(Request, path),
+                  CEL_NATIVE_STRUCT_FIELD(Request, attempt),
+                  CEL_NATIVE_STRUCT_FIELD(Request, protocol),
+                  CEL_NATIVE_STRUCT_FIELD(Request, weight),
+                  CEL_NATIVE_STRUCT_FIELD(Request, timeout),
+                  CEL_NATIVE_STRUCT_FIELD(Request, origin),
+                  CEL_NATIVE_STRUCT_FIELD(Request, proxy));
+
+}  // namespace acme
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::base_internal::AbstractStructValue;
+using ::cel::internal::IsOkAndHolds;
+using ::cel::internal::StatusIs;
+
+class NativeStructTest : public testing::Test {
+ public:
+  NativeStructTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {
+    request_.path = "/v1/items";
+    request_.attempt = -2;
+    request_.protocol = acme::Protocol::kGrpc;
+    request_.weight = 0.5;
+    request_.timeout = absl::Seconds(3);
+    request_.origin.address = "10.0.0.1";
+    request_.origin.port = 8080;
+  }
+
+  Handle<StructValue> NewValue() {
+    auto value = CreateNativeStructValue(value_factory_, request_);
+    EXPECT_OK(value);
+    return *std::move(value);
+  }
+
+  Handle<Value> GetField(const Handle<StructValue>& value,
+                         absl::string_view name) {
+    auto field = value->GetFieldByName(value_factory_, name);
+    EXPECT_OK(field);
+    return *std::move(field);
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+  acme::Request request_;
+};
+
+TEST_F(NativeStructTest, Fields) {
+  auto value = NewValue();
+  EXPECT_EQ(value->type()->name(), "acme.Request");
+  EXPECT_EQ(GetField(value, "path")->As<StringValue>().ToString(),
+            "/v1/items");
+  EXPECT_EQ(GetField(value, "attempt")->As<IntValue>().NativeValue(), -2);
+  EXPECT_EQ(GetField(value, "protocol")->As<IntValue>().NativeValue(), 2);
+  EXPECT_EQ(GetField(value, "weight")->As<DoubleValue>().NativeValue(), 0.5);
+  EXPECT_EQ(GetField(value, "timeout")->As<DurationValue>().NativeValue(),
+            absl::Seconds(3));
+  EXPECT_TRUE(GetField(value, "proxy")->Is<NullValue>());
+
+  auto origin = GetField(value, "origin").As<StructValue>();
+  EXPECT_EQ(origin->type()->name(), "acme.Peer");
+  EXPECT_EQ(GetField(origin, "address")->As<StringValue>().ToString(),
+            "10.0.0.1");
+  EXPECT_EQ(GetField(origin, "port")->As<UintValue>().NativeValue(), 8080);
+
+  ASSERT_OK_AND_ASSIGN(auto attempt,
+                       value->GetFieldByNumber(value_factory_, 2));
+  EXPECT_EQ(attempt->As<IntValue>().NativeValue(), -2);
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "unknown"),
+              StatusIs(absl::StatusCode::kNotFound));
+  // All but proxy.
+  EXPECT_EQ(value->field_count(), 6);
+}
+
+TEST_F(NativeStructTest, ReadsMembersInPlace) {
+  auto value = NewValue();
+  request_.attempt = 7;
+  request_.proxy = std::make_unique<acme::Peer>();
+  request_.proxy->port = 443;
+  EXPECT_EQ(GetField(value, "attempt")->As<IntValue>().NativeValue(), 7);
+  auto proxy = GetField(value, "proxy").As<StructValue>();
+  EXPECT_EQ(GetField(proxy, "port")->As<UintValue>().NativeValue(), 443);
+}
+
+TEST_F(NativeStructTest, Presence) {
+  auto value = NewValue();
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "attempt"),
+              IsOkAndHolds(true));
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "origin"),
+              IsOkAndHolds(true));
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "proxy"),
+              IsOkAndHolds(false));
+
+  request_.attempt = 0;
+  request_.path = "";
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "attempt"),
+              IsOkAndHolds(false));
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "path"),
+              IsOkAndHolds(false));
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "unknown"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(NativeStructTest, Type) {
+  auto value = NewValue();
+  ASSERT_OK_AND_ASSIGN(auto field,
+                       value->type()->FindFieldByName(type_manager_, "origin"));
+  ASSERT_TRUE(field.has_value());
+  EXPECT_EQ(field->number, 6);
+  EXPECT_EQ(field->type->name(), "acme.Peer");
+  ASSERT_OK_AND_ASSIGN(field,
+                       value->type()->FindFieldByNumber(type_manager_, 3));
+  ASSERT_TRUE(field.has_value());
+  EXPECT_EQ(field->name, "protocol");
+  EXPECT_EQ(field->type->name(), "int");
+}
+
+TEST_F(NativeStructTest, FieldHints) {
+  auto value = NewValue();
+  const auto& struct_value = AbstractStructValue::Cast(*value);
+  const void* hint = struct_value.FindFieldHint("weight");
+  ASSERT_NE(hint, nullptr);
+  EXPECT_EQ(struct_value.FindFieldHint("unknown"), nullptr);
+
+  ASSERT_OK_AND_ASSIGN(auto field,
+                       value->type()->FindFieldByName(type_manager_, "weight"));
+  ASSERT_TRUE(field.has_value());
+  EXPECT_EQ(field->hint, hint);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto selected,
+      struct_value.GetFieldByHint(value_factory_, "weight", hint,
+                                  /*unbox_null_wrapper_types=*/false));
+  ASSERT_TRUE(selected.has_value());
+  EXPECT_EQ((*selected)->As<DoubleValue>().NativeValue(), 0.5);
+  EXPECT_THAT(struct_value.HasFieldByHint("weight", hint),
+              IsOkAndHolds(absl::optional<bool>(true)));
+
+  // A hint pointing to another field, e.g. one cached for a destroyed schema
+  // whose memory was reused, does not apply.
+  EXPECT_THAT(struct_value.GetFieldByHint(value_factory_, "other", hint, false),
+              IsOkAndHolds(absl::nullopt));
+  EXPECT_THAT(struct_value.HasFieldByHint("other", hint),
+              IsOkAndHolds(absl::nullopt));
+
+  // Hints of other schemas do not apply.
+  auto origin = GetField(value, "origin").As<StructValue>();
+  EXPECT_THAT(AbstractStructValue::Cast(*origin).GetFieldByHint(
+                  value_factory_, "weight", hint, false),
+              IsOkAndHolds(absl::nullopt));
+}
+
+TEST_F(NativeStructTest, Qualify) {
+  auto value = NewValue();
+  std::vector<SelectQualifier> path = {FieldSpecifier{6, "origin"},
+                                       FieldSpecifier{2, "port"}};
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       value->Qualify(value_factory_, path,
+                                      /*presence_test=*/false,
+                                      /*unbox_null_wrapper_types=*/false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_EQ(result.value->As<UintValue>().NativeValue(), 8080);
+
+  path = {FieldSpecifier{6, "origin"}, FieldSpecifier{3, "secure"}};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path,
+                                              /*presence_test=*/true,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_FALSE(result.value->As<BoolValue>().NativeValue());
+
+  // Absent structs stop the path, for the caller to report the error.
+  path = {FieldSpecifier{7, "proxy"}, FieldSpecifier{2, "port"}};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path, false,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, 1);
+  EXPECT_TRUE(result.value->Is<NullValue>());
+
+  path = {FieldSpecifier{6, "origin"}, FieldSpecifier{9, "unknown"}};
+  ASSERT_OK_AND_ASSIGN(result, value->Qualify(value_factory_, path, false,
+                                              false));
+  EXPECT_EQ(result.qualifier_count, -1);
+  EXPECT_THAT(result.value->As<ErrorValue>().NativeValue(),
+              StatusIs(absl::StatusCode::kNotFound));
+
+  path = {AttributeQualifier::OfString("origin")};
+  EXPECT_THAT(value->Qualify(value_factory_, path, false, false),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+}  // namespace
+}  // namespace cel::extensions
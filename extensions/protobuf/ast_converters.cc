@@ -76,25 +76,77 @@ using ExprPb = google::api::expr::v1alpha1::Expr;
 using ParsedExprPb = google::api::expr::v1alpha1::ParsedExpr;
 using CheckedExprPb = google::api::expr::v1alpha1::CheckedExpr;
 
+// Returns a string field of the proto expression being converted. When the
+// conversion owns the proto, a non-empty string is moved out of it instead of
+// copied: the proto is not const, so casting the constness of the accessor
+// away is well defined. Empty strings are copied, as the accessors of unset
+// fields return protobuf's process-wide default instance, which must not be
+// modified.
+template <bool kOwned>
+std::string TakeString(const std::string& value) {
+  if constexpr (kOwned) {
+    if (!value.empty()) {
+      return std::move(const_cast<std::string&>(value));
+    }
+  }
+  return value;
+}
+
+template <bool kOwned>
+absl::StatusOr<Constant> ConvertConstantImpl(
+    const google::api::expr::v1alpha1::Constant& constant) {
+  switch (constant.constant_kind_case()) {
+    case google::api::expr::v1alpha1::Constant::kNullValue:
+      return Constant(NullValue::kNullValue);
+    case google::api::expr::v1alpha1::Constant::kBoolValue:
+      return Constant(constant.bool_value());
+    case google::api::expr::v1alpha1::Constant::kInt64Value:
+      return Constant(constant.int64_value());
+    case google::api::expr::v1alpha1::Constant::kUint64Value:
+      return Constant(constant.uint64_value());
+    case google::api::expr::v1alpha1::Constant::kDoubleValue:
+      return Constant(constant.double_value());
+    case google::api::expr::v1alpha1::Constant::kStringValue:
+      return Constant(TakeString<kOwned>(constant.string_value()));
+    case google::api::expr::v1alpha1::Constant::kBytesValue:
+      return Constant(Bytes{TakeString<kOwned>(constant.bytes_value())});
+    case google::api::expr::v1alpha1::Constant::kDurationValue:
+      return Constant(absl::Seconds(constant.duration_value().seconds()) +
+                      absl::Nanoseconds(constant.duration_value().nanos()));
+    case google::api::expr::v1alpha1::Constant::kTimestampValue:
+      return Constant(
+          absl::FromUnixSeconds(constant.timestamp_value().seconds()) +
+          absl::Nanoseconds(constant.timestamp_value().nanos()));
+    default:
+      return absl::InvalidArgumentError("Unsupported constant type");
+  }
+}
+
 struct ConversionStackEntry {
   absl::Nonnull<Expr*> expr;
 
   absl::Nonnull<const ExprPb*> proto_expr;
 };
 
-Ident ConvertIdent(const ExprPb::Ident& ident) { return Ident(ident.name()); }
+template <bool kOwned>
+Ident ConvertIdent(const ExprPb::Ident& ident) {
+  return Ident(TakeString<kOwned>(ident.name()));
+}
 
+template <bool kOwned>
 absl::StatusOr<Select> ConvertSelect(const ExprPb::Select& select,
                                      std::stack<ConversionStackEntry>& stack) {
-  Select value(std::make_unique<Expr>(), select.field(), select.test_only());
+  Select value(std::make_unique<Expr>(), TakeString<kOwned>(select.field()),
+               select.test_only());
   stack.push({&value.mutable_operand(), &select.operand()});
   return value;
 }
 
+template <bool kOwned>
 absl::StatusOr<Call> ConvertCall(const ExprPb::Call& call,
                                  std::stack<ConversionStackEntry>& stack) {
   Call ret_val;
-  ret_val.set_function(call.function());
+  ret_val.set_function(TakeString<kOwned>(call.function()));
   ret_val.set_args(std::vector<Expr>(call.args_size()));
   for (int i = 0; i < ret_val.args().size(); i++) {
     stack.push({&ret_val.mutable_args()[i], &call.args(i)});
@@ -120,12 +172,13 @@ absl::StatusOr<CreateList> ConvertCreateList(
   return ret_val;
 }
 
+template <bool kOwned>
 absl::StatusOr<CreateStruct::Entry::KeyKind> ConvertCreateStructEntryKey(
     const ExprPb::CreateStruct::Entry& entry,
     std::stack<ConversionStackEntry>& stack) {
   switch (entry.key_kind_case()) {
     case google::api::expr::v1alpha1::Expr_CreateStruct_Entry::kFieldKey:
-      return entry.field_key();
+      return TakeString<kOwned>(entry.field_key());
     case google::api::expr::v1alpha1::Expr_CreateStruct_Entry::kMapKey: {
       auto native_map_key = std::make_unique<Expr>();
       stack.push({native_map_key.get(), &entry.map_key()});
@@ -138,11 +191,12 @@ absl::StatusOr<CreateStruct::Entry::KeyKind> ConvertCreateStructEntryKey(
   }
 }
 
+template <bool kOwned>
 absl::StatusOr<CreateStruct::Entry> ConvertCreateStructEntry(
     const ExprPb::CreateStruct::Entry& entry,
     std::stack<ConversionStackEntry>& stack) {
   CEL_ASSIGN_OR_RETURN(auto native_key,
-                       ConvertCreateStructEntryKey(entry, stack));
+                       ConvertCreateStructEntryKey<kOwned>(entry, stack));
 
   if (!entry.has_value()) {
     return absl::InvalidArgumentError(
@@ -155,6 +209,7 @@ absl::StatusOr<CreateStruct::Entry> ConvertCreateStructEntry(
   return result;
 }
 
+template <bool kOwned>
 absl::StatusOr<CreateStruct> ConvertCreateStruct(
     const ExprPb::CreateStruct& create_struct,
     std::stack<ConversionStackEntry>& stack) {
@@ -162,12 +217,14 @@ absl::StatusOr<CreateStruct> ConvertCreateStruct(
   entries.reserve(create_struct.entries_size());
   for (const auto& entry : create_struct.entries()) {
     CEL_ASSIGN_OR_RETURN(auto native_entry,
-                         ConvertCreateStructEntry(entry, stack));
+                         ConvertCreateStructEntry<kOwned>(entry, stack));
     entries.push_back(std::move(native_entry));
   }
-  return CreateStruct(create_struct.message_name(), std::move(entries));
+  return CreateStruct(TakeString<kOwned>(create_struct.message_name()),
+                      std::move(entries));
 }
 
+template <bool kOwned>
 absl::StatusOr<Comprehension> ConvertComprehension(
     const google::api::expr::v1alpha1::Expr::Comprehension& comprehension,
     std::stack<ConversionStackEntry>& stack) {
@@ -177,13 +234,13 @@ absl::StatusOr<Comprehension> ConvertComprehension(
     return absl::InvalidArgumentError(
         "Invalid comprehension: 'accu_var' must not be empty");
   }
-  ret_val.set_accu_var(comprehension.accu_var());
+  ret_val.set_accu_var(TakeString<kOwned>(comprehension.accu_var()));
   // iter_var
   if (comprehension.iter_var().empty()) {
     return absl::InvalidArgumentError(
         "Invalid comprehension: 'iter_var' must not be empty");
   }
-  ret_val.set_iter_var(comprehension.iter_var());
+  ret_val.set_iter_var(TakeString<kOwned>(comprehension.iter_var()));
 
   // accu_init
   if (!comprehension.has_accu_init()) {
@@ -222,24 +279,25 @@ absl::StatusOr<Comprehension> ConvertComprehension(
   return ret_val;
 }
 
+template <bool kOwned>
 absl::StatusOr<Expr> ConvertExpr(const ExprPb& expr,
                                  std::stack<ConversionStackEntry>& stack) {
   switch (expr.expr_kind_case()) {
     case google::api::expr::v1alpha1::Expr::kConstExpr: {
       CEL_ASSIGN_OR_RETURN(auto native_const,
-                           ConvertConstant(expr.const_expr()));
+                           ConvertConstantImpl<kOwned>(expr.const_expr()));
       return Expr(expr.id(), std::move(native_const));
     }
     case google::api::expr::v1alpha1::Expr::kIdentExpr:
-      return Expr(expr.id(), ConvertIdent(expr.ident_expr()));
+      return Expr(expr.id(), ConvertIdent<kOwned>(expr.ident_expr()));
     case google::api::expr::v1alpha1::Expr::kSelectExpr: {
       CEL_ASSIGN_OR_RETURN(auto native_select,
-                           ConvertSelect(expr.select_expr(), stack));
+                           ConvertSelect<kOwned>(expr.select_expr(), stack));
       return Expr(expr.id(), std::move(native_select));
     }
     case google::api::expr::v1alpha1::Expr::kCallExpr: {
       CEL_ASSIGN_OR_RETURN(auto native_call,
-                           ConvertCall(expr.call_expr(), stack));
+                           ConvertCall<kOwned>(expr.call_expr(), stack));
 
       return Expr(expr.id(), std::move(native_call));
     }
@@ -250,14 +308,15 @@ absl::StatusOr<Expr> ConvertExpr(const ExprPb& expr,
       return Expr(expr.id(), std::move(native_list));
     }
     case google::api::expr::v1alpha1::Expr::kStructExpr: {
-      CEL_ASSIGN_OR_RETURN(auto native_struct,
-                           ConvertCreateStruct(expr.struct_expr(), stack));
+      CEL_ASSIGN_OR_RETURN(
+          auto native_struct,
+          ConvertCreateStruct<kOwned>(expr.struct_expr(), stack));
       return Expr(expr.id(), std::move(native_struct));
     }
     case google::api::expr::v1alpha1::Expr::kComprehensionExpr: {
       CEL_ASSIGN_OR_RETURN(
           auto native_comprehension,
-          ConvertComprehension(expr.comprehension_expr(), stack));
+          ConvertComprehension<kOwned>(expr.comprehension_expr(), stack));
       return Expr(expr.id(), std::move(native_comprehension));
     }
     default:
@@ -266,6 +325,7 @@ absl::StatusOr<Expr> ConvertExpr(const ExprPb& expr,
   }
 }
 
+template <bool kOwned>
 absl::StatusOr<Expr> ToNativeExprImpl(const ExprPb& proto_expr) {
   std::stack<ConversionStackEntry> conversion_stack;
   int iterations = 0;
@@ -275,7 +335,8 @@ absl::StatusOr<Expr> ToNativeExprImpl(const ExprPb& proto_expr) {
     ConversionStackEntry entry = conversion_stack.top();
     conversion_stack.pop();
     CEL_ASSIGN_OR_RETURN(*entry.expr,
-                         ConvertExpr(*entry.proto_expr, conversion_stack));
+                         ConvertExpr<kOwned>(*entry.proto_expr,
+                                             conversion_stack));
     ++iterations;
     if (iterations > kMaxIterations) {
       return absl::InternalError(
@@ -289,50 +350,32 @@ absl::StatusOr<Expr> ToNativeExprImpl(const ExprPb& proto_expr) {
 
 absl::StatusOr<Constant> ConvertConstant(
     const google::api::expr::v1alpha1::Constant& constant) {
-  switch (constant.constant_kind_case()) {
-    case google::api::expr::v1alpha1::Constant::kNullValue:
-      return Constant(NullValue::kNullValue);
-    case google::api::expr::v1alpha1::Constant::kBoolValue:
-      return Constant(constant.bool_value());
-    case google::api::expr::v1alpha1::Constant::kInt64Value:
-      return Constant(constant.int64_value());
-    case google::api::expr::v1alpha1::Constant::kUint64Value:
-      return Constant(constant.uint64_value());
-    case google::api::expr::v1alpha1::Constant::kDoubleValue:
-      return Constant(constant.double_value());
-    case google::api::expr::v1alpha1::Constant::kStringValue:
-      return Constant(constant.string_value());
-    case google::api::expr::v1alpha1::Constant::kBytesValue:
-      return Constant(Bytes{constant.bytes_value()});
-    case google::api::expr::v1alpha1::Constant::kDurationValue:
-      return Constant(absl::Seconds(constant.duration_value().seconds()) +
-                      absl::Nanoseconds(constant.duration_value().nanos()));
-    case google::api::expr::v1alpha1::Constant::kTimestampValue:
-      return Constant(
-          absl::FromUnixSeconds(constant.timestamp_value().seconds()) +
-          absl::Nanoseconds(constant.timestamp_value().nanos()));
-    default:
-      return absl::InvalidArgumentError("Unsupported constant type");
-  }
+  return ConvertConstantImpl</*kOwned=*/false>(constant);
 }
 
 absl::StatusOr<Expr> ConvertProtoExprToNative(
     const google::api::expr::v1alpha1::Expr& expr) {
-  return ToNativeExprImpl(expr);
+  return ToNativeExprImpl</*kOwned=*/false>(expr);
 }
 
-absl::StatusOr<SourceInfo> ConvertProtoSourceInfoToNative(
-    const google::api::expr::v1alpha1::SourceInfo& source_info) {
+namespace {
+
+template <bool kOwned>
+absl::StatusOr<SourceInfo> ToNativeSourceInfoImpl(
+    const google::api::expr::v1alpha1::SourceInfo& source_info,
+    bool convert_macro_calls = true) {
   absl::flat_hash_map<int64_t, Expr> macro_calls;
-  for (const auto& pair : source_info.macro_calls()) {
-    auto native_expr = ConvertProtoExprToNative(pair.second);
-    if (!native_expr.ok()) {
-      return native_expr.status();
+  if (convert_macro_calls) {
+    for (const auto& pair : source_info.macro_calls()) {
+      auto native_expr = ToNativeExprImpl<kOwned>(pair.second);
+      if (!native_expr.ok()) {
+        return native_expr.status();
+      }
+      macro_calls.emplace(pair.first, *(std::move(native_expr)));
     }
-    macro_calls.emplace(pair.first, *(std::move(native_expr)));
   }
   return SourceInfo(
-      source_info.syntax_version(), source_info.location(),
+      source_info.syntax_version(), TakeString<kOwned>(source_info.location()),
       std::vector<int32_t>(source_info.line_offsets().begin(),
                            source_info.line_offsets().end()),
       absl::flat_hash_map<int64_t, int32_t>(source_info.positions().begin(),
@@ -340,14 +383,15 @@ absl::StatusOr<SourceInfo> ConvertProtoSourceInfoToNative(
       std::move(macro_calls));
 }
 
-absl::StatusOr<ParsedExpr> ConvertProtoParsedExprToNative(
+template <bool kOwned>
+absl::StatusOr<ParsedExpr> ToNativeParsedExprImpl(
     const google::api::expr::v1alpha1::ParsedExpr& parsed_expr) {
-  auto native_expr = ConvertProtoExprToNative(parsed_expr.expr());
+  auto native_expr = ToNativeExprImpl<kOwned>(parsed_expr.expr());
   if (!native_expr.ok()) {
     return native_expr.status();
   }
   auto native_source_info =
-      ConvertProtoSourceInfoToNative(parsed_expr.source_info());
+      ToNativeSourceInfoImpl<kOwned>(parsed_expr.source_info());
   if (!native_source_info.ok()) {
     return native_source_info.status();
   }
@@ -355,6 +399,24 @@ absl::StatusOr<ParsedExpr> ConvertProtoParsedExprToNative(
                     *(std::move(native_source_info)));
 }
 
+}  // namespace
+
+absl::StatusOr<SourceInfo> ConvertProtoSourceInfoToNative(
+    const google::api::expr::v1alpha1::SourceInfo& source_info) {
+  return ToNativeSourceInfoImpl</*kOwned=*/false>(source_info);
+}
+
+absl::StatusOr<ParsedExpr> ConvertProtoParsedExprToNative(
+    const google::api::expr::v1alpha1::ParsedExpr& parsed_expr) {
+  return ToNativeParsedExprImpl</*kOwned=*/false>(parsed_expr);
+}
+
+absl::StatusOr<ParsedExpr> ConvertProtoParsedExprToNative(
+    google::api::expr::v1alpha1::ParsedExpr&& parsed_expr) {
+  google::api::expr::v1alpha1::ParsedExpr owned = std::move(parsed_expr);
+  return ToNativeParsedExprImpl</*kOwned=*/true>(owned);
+}
+
 absl::StatusOr<PrimitiveType> ToNative(
     google::api::expr::v1alpha1::Type::PrimitiveType primitive_type) {
   switch (primitive_type) {
@@ -545,8 +607,27 @@ absl::StatusOr<Reference> ConvertProtoReferenceToNative(
   return ret_val;
 }
 
-absl::StatusOr<CheckedExpr> ConvertProtoCheckedExprToNative(
-    const CheckedExprPb& checked_expr) {
+namespace {
+
+// Whether the planner reads types of the given kind, e.g. the message types
+// the select optimization and type inference look up fields on.
+bool IsPlannedType(const google::api::expr::v1alpha1::Type& type) {
+  switch (type.type_kind_case()) {
+    case google::api::expr::v1alpha1::Type::kMessageType:
+    case google::api::expr::v1alpha1::Type::kNull:
+    case google::api::expr::v1alpha1::Type::kPrimitive:
+    case google::api::expr::v1alpha1::Type::kWellKnown:
+    case google::api::expr::v1alpha1::Type::kListType:
+    case google::api::expr::v1alpha1::Type::kMapType:
+    case google::api::expr::v1alpha1::Type::kType:
+      return true;
+    default:
+      return false;
+  }
+}
+
+absl::StatusOr<CheckedExpr> ConvertProtoCheckedExprToNativeImpl(
+    const CheckedExprPb& checked_expr, bool for_planning) {
   CheckedExpr ret_val;
   for (const auto& pair : checked_expr.reference_map()) {
     auto native_reference = ConvertProtoReferenceToNative(pair.second);
@@ -557,14 +638,18 @@ absl::StatusOr<CheckedExpr> ConvertProtoCheckedExprToNative(
                                             *(std::move(native_reference)));
   }
   for (const auto& pair : checked_expr.type_map()) {
+    if (for_planning && !IsPlannedType(pair.second)) {
+      continue;
+    }
     auto native_type = ConvertProtoTypeToNative(pair.second);
     if (!native_type.ok()) {
       return native_type.status();
     }
     ret_val.mutable_type_map().emplace(pair.first, *(std::move(native_type)));
   }
-  auto native_source_info =
-      ConvertProtoSourceInfoToNative(checked_expr.source_info());
+  // Macro calls are only needed to unparse the expression.
+  auto native_source_info = ToNativeSourceInfoImpl</*kOwned=*/false>(
+      checked_expr.source_info(), /*convert_macro_calls=*/!for_planning);
   if (!native_source_info.ok()) {
     return native_source_info.status();
   }
@@ -578,6 +663,14 @@ absl::StatusOr<CheckedExpr> ConvertProtoCheckedExprToNative(
   return ret_val;
 }
 
+}  // namespace
+
+absl::StatusOr<CheckedExpr> ConvertProtoCheckedExprToNative(
+    const CheckedExprPb& checked_expr) {
+  return ConvertProtoCheckedExprToNativeImpl(checked_expr,
+                                             /*for_planning=*/false);
+}
+
 }  // namespace internal
 
 namespace {
@@ -970,6 +1063,14 @@ absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromParsedExpr(
   return std::make_unique<cel::ast_internal::AstImpl>(std::move(expr));
 }
 
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromParsedExpr(
+    ParsedExprPb&& parsed_expr) {
+  CEL_ASSIGN_OR_RETURN(
+      cel::ast_internal::ParsedExpr expr,
+      internal::ConvertProtoParsedExprToNative(std::move(parsed_expr)));
+  return std::make_unique<cel::ast_internal::AstImpl>(std::move(expr));
+}
+
 absl::StatusOr<ParsedExprPb> CreateParsedExprFromAst(const Ast& ast) {
   const auto& ast_impl = ast_internal::AstImpl::CastFromPublicAst(ast);
   ParsedExprPb parsed_expr;
@@ -988,6 +1089,14 @@ absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromCheckedExpr(
   return std::make_unique<cel::ast_internal::AstImpl>(std::move(expr));
 }
 
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstForPlanningFromCheckedExpr(
+    const CheckedExprPb& checked_expr) {
+  CEL_ASSIGN_OR_RETURN(cel::ast_internal::CheckedExpr expr,
+                       internal::ConvertProtoCheckedExprToNativeImpl(
+                           checked_expr, /*for_planning=*/true));
+  return std::make_unique<cel::ast_internal::AstImpl>(std::move(expr));
+}
+
 absl::StatusOr<google::api::expr::v1alpha1::CheckedExpr> CreateCheckedExprFromAst(
     const Ast& ast) {
   if (!ast.IsChecked()) {
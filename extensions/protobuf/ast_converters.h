@@ -33,6 +33,10 @@ absl::StatusOr<ast_internal::SourceInfo> ConvertProtoSourceInfoToNative(
     const google::api::expr::v1alpha1::SourceInfo& source_info);
 absl::StatusOr<ast_internal::ParsedExpr> ConvertProtoParsedExprToNative(
     const google::api::expr::v1alpha1::ParsedExpr& parsed_expr);
+// Overload consuming parsed_expr, whose strings are moved into the result
+// rather than copied.
+absl::StatusOr<ast_internal::ParsedExpr> ConvertProtoParsedExprToNative(
+    google::api::expr::v1alpha1::ParsedExpr&& parsed_expr);
 absl::StatusOr<ast_internal::Type> ConvertProtoTypeToNative(
     const google::api::expr::v1alpha1::Type& type);
 absl::StatusOr<ast_internal::Reference> ConvertProtoReferenceToNative(
@@ -54,6 +58,10 @@ absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromParsedExpr(
     const google::api::expr::v1alpha1::SourceInfo* source_info = nullptr);
 absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromParsedExpr(
     const google::api::expr::v1alpha1::ParsedExpr& parsed_expr);
+// Overload consuming parsed_expr, for callers that no longer need it (such as
+// right after parsing). Avoids copying its strings into the runtime AST.
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromParsedExpr(
+    google::api::expr::v1alpha1::ParsedExpr&& parsed_expr);
 
 absl::StatusOr<google::api::expr::v1alpha1::ParsedExpr> CreateParsedExprFromAst(
     const Ast& ast);
@@ -64,6 +72,14 @@ absl::StatusOr<google::api::expr::v1alpha1::ParsedExpr> CreateParsedExprFromAst(
 absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromCheckedExpr(
     const google::api::expr::v1alpha1::CheckedExpr& checked_expr);
 
+// Creates a runtime AST from a checked protobuf AST, for planning only.
+// Converts only what the planner reads: the macro calls, and the types the
+// planner never consults (dyn, wrappers, abstract and function types, ...),
+// are left out. The result can't be converted back to an equivalent checked
+// protobuf AST.
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstForPlanningFromCheckedExpr(
+    const google::api::expr::v1alpha1::CheckedExpr& checked_expr);
+
 absl::StatusOr<google::api::expr::v1alpha1::CheckedExpr> CreateCheckedExprFromAst(
     const Ast& ast);
 
@@ -455,6 +455,39 @@ TEST(AstConvertersTest, ParsedExprToNative) {
   ASSERT_EQ(native_source_info.macro_calls().at(1).ident_expr().name(), "name");
 }
 
+TEST(AstConvertersTest, ConsumedParsedExprWithUnsetStrings) {
+  // A map literal has no message name, the source info no location and the
+  // constant is empty: their accessors return the default empty string.
+  google::api::expr::v1alpha1::ParsedExpr parsed_expr;
+  ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(
+      R"pb(
+        expr {
+          struct_expr {
+            entries {
+              map_key { const_expr { string_value: "" } }
+              value { ident_expr { name: "name" } }
+            }
+          }
+        }
+      )pb",
+      &parsed_expr));
+
+  ASSERT_OK_AND_ASSIGN(auto native_parsed_expr,
+                       ConvertProtoParsedExprToNative(std::move(parsed_expr)));
+
+  const auto& create_struct = native_parsed_expr.expr().struct_expr();
+  EXPECT_EQ(create_struct.message_name(), "");
+  ASSERT_EQ(create_struct.entries().size(), 1);
+  EXPECT_EQ(create_struct.entries()[0].map_key().const_expr().string_value(),
+            "");
+  EXPECT_EQ(create_struct.entries()[0].value().ident_expr().name(), "name");
+  EXPECT_EQ(native_parsed_expr.source_info().location(), "");
+  // The shared default instances are untouched.
+  EXPECT_EQ(google::api::expr::v1alpha1::SourceInfo::default_instance()
+                .location(),
+            "");
+}
+
 TEST(AstConvertersTest, PrimitiveTypeUnspecifiedToNative) {
   google::api::expr::v1alpha1::Type type;
   type.set_primitive(google::api::expr::v1alpha1::Type::PRIMITIVE_TYPE_UNSPECIFIED);
@@ -870,6 +903,56 @@ TEST(AstConvertersTest, CheckedExprToAst) {
   ASSERT_TRUE(ast->IsChecked());
 }
 
+TEST(AstConvertersTest, CheckedExprToAstForPlanning) {
+  CheckedExprPb checked_expr;
+  ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(
+      R"pb(
+        reference_map {
+          key: 2
+          value { overload_id: "add_int64" }
+        }
+        type_map {
+          key: 1
+          value { message_type: "com.example.Message" }
+        }
+        type_map {
+          key: 2
+          value { primitive: INT64 }
+        }
+        type_map {
+          key: 3
+          value { dyn {} }
+        }
+        type_map {
+          key: 4
+          value { list_type { elem_type { wrapper: INT64 } } }
+        }
+        source_info {
+          positions { key: 2 value: 4 }
+          macro_calls {
+            key: 2
+            value { ident_expr { name: "name" } }
+          }
+        }
+        expr { id: 2 ident_expr { name: "expr" } }
+      )pb",
+      &checked_expr));
+
+  ASSERT_OK_AND_ASSIGN(auto ast,
+                       CreateAstForPlanningFromCheckedExpr(checked_expr));
+
+  ASSERT_TRUE(ast->IsChecked());
+  const auto& impl = ast_internal::AstImpl::CastFromPublicAst(*ast);
+  EXPECT_EQ(impl.root_expr().id(), 2);
+  EXPECT_THAT(impl.reference_map(), testing::SizeIs(1));
+  EXPECT_THAT(impl.type_map(), testing::SizeIs(3));
+  EXPECT_TRUE(impl.type_map().contains(1));
+  EXPECT_TRUE(impl.type_map().contains(2));
+  EXPECT_TRUE(impl.type_map().contains(4));
+  EXPECT_THAT(impl.source_info().positions(), testing::SizeIs(1));
+  EXPECT_THAT(impl.source_info().macro_calls(), testing::IsEmpty());
+}
+
 TEST(AstConvertersTest, AstToCheckedExprBasic) {
   ast_internal::Expr expr;
   expr.set_id(1);
@@ -1244,6 +1327,24 @@ TEST_P(ConversionRoundTripTest, ParsedExprCopyable) {
               IsOkAndHolds(EqualsProto(parsed_expr)));
 }
 
+TEST_P(ConversionRoundTripTest, ParsedExprMovable) {
+  ASSERT_OK_AND_ASSIGN(ParsedExprPb parsed_expr,
+                       Parse(GetParam().expr, "<input>", options_));
+
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> copied,
+                       CreateAstFromParsedExpr(parsed_expr));
+  ParsedExprPb moved_from = parsed_expr;
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> moved,
+                       CreateAstFromParsedExpr(std::move(moved_from)));
+
+  const auto& copied_impl = ast_internal::AstImpl::CastFromPublicAst(*copied);
+  const auto& moved_impl = ast_internal::AstImpl::CastFromPublicAst(*moved);
+  EXPECT_EQ(moved_impl.root_expr(), copied_impl.root_expr());
+  EXPECT_EQ(moved_impl.source_info(), copied_impl.source_info());
+  EXPECT_THAT(CreateParsedExprFromAst(*moved),
+              IsOkAndHolds(EqualsProto(parsed_expr)));
+}
+
 TEST_P(ConversionRoundTripTest, CheckedExprCopyable) {
   ASSERT_OK_AND_ASSIGN(ParsedExprPb parsed_expr,
                        Parse(GetParam().expr, "<input>", options_));
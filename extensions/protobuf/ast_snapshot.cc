@@ -0,0 +1,108 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/protobuf/ast_snapshot.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "google/api/expr/v1alpha1/checked.pb.h"
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+
+namespace cel::extensions {
+
+namespace {
+
+using ::google::api::expr::v1alpha1::CheckedExpr;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+
+constexpr absl::string_view kSnapshotMagic = "CELAST";
+
+// Bumped whenever the encoding of snapshots changes.
+constexpr char kSnapshotVersion = 1;
+
+// Kind of AST held by a snapshot, stored after the version.
+constexpr char kParsedAst = 'p';
+constexpr char kCheckedAst = 'c';
+
+constexpr size_t kSnapshotHeaderSize = kSnapshotMagic.size() + 2;
+
+}  // namespace
+
+absl::StatusOr<std::string> SerializeAstSnapshot(const Ast& ast) {
+  std::string snapshot(kSnapshotMagic);
+  snapshot.push_back(kSnapshotVersion);
+  if (ast.IsChecked()) {
+    CEL_ASSIGN_OR_RETURN(CheckedExpr checked_expr,
+                         CreateCheckedExprFromAst(ast));
+    snapshot.push_back(kCheckedAst);
+    if (!checked_expr.AppendToString(&snapshot)) {
+      return absl::InternalError("failed to serialize checked AST snapshot");
+    }
+  } else {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, CreateParsedExprFromAst(ast));
+    snapshot.push_back(kParsedAst);
+    if (!parsed_expr.AppendToString(&snapshot)) {
+      return absl::InternalError("failed to serialize parsed AST snapshot");
+    }
+  }
+  return snapshot;
+}
+
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromSnapshot(
+    absl::string_view snapshot) {
+  if (snapshot.size() < kSnapshotHeaderSize ||
+      !absl::StartsWith(snapshot, kSnapshotMagic)) {
+    return absl::InvalidArgumentError("not a CEL AST snapshot");
+  }
+  char version = snapshot[kSnapshotMagic.size()];
+  if (version != kSnapshotVersion) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("unsupported CEL AST snapshot version ",
+                     static_cast<int>(version), ", expected ",
+                     static_cast<int>(kSnapshotVersion)));
+  }
+  char kind = snapshot[kSnapshotMagic.size() + 1];
+  absl::string_view payload = snapshot.substr(kSnapshotHeaderSize);
+  switch (kind) {
+    case kCheckedAst: {
+      CheckedExpr checked_expr;
+      if (!checked_expr.ParseFromArray(payload.data(), payload.size())) {
+        return absl::InvalidArgumentError("malformed checked AST snapshot");
+      }
+      return CreateAstFromCheckedExpr(checked_expr);
+    }
+    case kParsedAst: {
+      ParsedExpr parsed_expr;
+      if (!parsed_expr.ParseFromArray(payload.data(), payload.size())) {
+        return absl::InvalidArgumentError("malformed parsed AST snapshot");
+      }
+      return CreateAstFromParsedExpr(std::move(parsed_expr));
+    }
+    default:
+      return absl::InvalidArgumentError("unknown CEL AST snapshot kind");
+  }
+}
+
+}  // namespace cel::extensions
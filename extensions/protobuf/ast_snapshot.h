@@ -0,0 +1,49 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_AST_SNAPSHOT_H_
+#define THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_AST_SNAPSHOT_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+
+namespace cel::extensions {
+
+// Snapshots of compiled expressions, for caching them across process
+// restarts.
+//
+// A snapshot holds the AST as it is handed to the planner: the checked AST
+// with its reference map (the resolved overload ids) and type map, or the
+// parsed AST. Creating a program from a snapshot skips parsing and type
+// checking; functions are bound against the runtime's registry by overload id
+// while planning, as for any checked AST.
+//
+// Snapshots start with a magic number and a format version, followed by the
+// AST in protobuf wire format, so they can be read straight from a memory
+// mapped file.
+absl::StatusOr<std::string> SerializeAstSnapshot(const Ast& ast);
+
+// Reads back a snapshot written by SerializeAstSnapshot. Returns an
+// InvalidArgument error if snapshot is not one, was written in another format
+// version or is truncated.
+absl::StatusOr<std::unique_ptr<Ast>> CreateAstFromSnapshot(
+    absl::string_view snapshot);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_AST_SNAPSHOT_H_
@@ -0,0 +1,119 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/protobuf/ast_snapshot.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "google/api/expr/v1alpha1/checked.pb.h"
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/proto_matchers.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::internal::test::EqualsProto;
+using ::google::api::expr::parser::Parse;
+using testing::HasSubstr;
+using cel::internal::IsOkAndHolds;
+using cel::internal::StatusIs;
+
+using CheckedExprPb = google::api::expr::v1alpha1::CheckedExpr;
+using ParsedExprPb = google::api::expr::v1alpha1::ParsedExpr;
+using TypePb = google::api::expr::v1alpha1::Type;
+
+TEST(AstSnapshotTest, ParsedAstRoundTrip) {
+  ASSERT_OK_AND_ASSIGN(ParsedExprPb parsed_expr,
+                       Parse("[1, 2].exists(x, x == y) && 'a' in z"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> ast,
+                       CreateAstFromParsedExpr(parsed_expr));
+
+  ASSERT_OK_AND_ASSIGN(std::string snapshot, SerializeAstSnapshot(*ast));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> restored,
+                       CreateAstFromSnapshot(snapshot));
+
+  EXPECT_FALSE(restored->IsChecked());
+  EXPECT_EQ(AstImpl::CastFromPublicAst(*restored).root_expr(),
+            AstImpl::CastFromPublicAst(*ast).root_expr());
+  EXPECT_THAT(CreateParsedExprFromAst(*restored),
+              IsOkAndHolds(EqualsProto(parsed_expr)));
+}
+
+TEST(AstSnapshotTest, CheckedAstRoundTrip) {
+  ASSERT_OK_AND_ASSIGN(ParsedExprPb parsed_expr, Parse("x == 1"));
+  CheckedExprPb checked_expr;
+  *checked_expr.mutable_expr() = parsed_expr.expr();
+  *checked_expr.mutable_source_info() = parsed_expr.source_info();
+  int64_t root_id = checked_expr.expr().id();
+  (*checked_expr.mutable_reference_map())[root_id].add_overload_id("equals");
+  (*checked_expr.mutable_type_map())[root_id].set_primitive(TypePb::BOOL);
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> ast,
+                       CreateAstFromCheckedExpr(checked_expr));
+
+  ASSERT_OK_AND_ASSIGN(std::string snapshot, SerializeAstSnapshot(*ast));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> restored,
+                       CreateAstFromSnapshot(snapshot));
+
+  EXPECT_TRUE(restored->IsChecked());
+  const auto& restored_impl = AstImpl::CastFromPublicAst(*restored);
+  const auto& impl = AstImpl::CastFromPublicAst(*ast);
+  EXPECT_EQ(restored_impl.root_expr(), impl.root_expr());
+  EXPECT_EQ(restored_impl.reference_map(), impl.reference_map());
+  EXPECT_EQ(restored_impl.type_map(), impl.type_map());
+  EXPECT_THAT(CreateCheckedExprFromAst(*restored),
+              IsOkAndHolds(EqualsProto(checked_expr)));
+}
+
+TEST(AstSnapshotTest, RejectsInvalidSnapshots) {
+  ASSERT_OK_AND_ASSIGN(ParsedExprPb parsed_expr, Parse("x"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Ast> ast,
+                       CreateAstFromParsedExpr(parsed_expr));
+  ASSERT_OK_AND_ASSIGN(std::string snapshot, SerializeAstSnapshot(*ast));
+
+  EXPECT_THAT(CreateAstFromSnapshot(""),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a CEL AST snapshot")));
+  EXPECT_THAT(CreateAstFromSnapshot(parsed_expr.SerializeAsString()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a CEL AST snapshot")));
+
+  std::string other_version = snapshot;
+  other_version[6] = 2;
+  EXPECT_THAT(CreateAstFromSnapshot(other_version),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unsupported CEL AST snapshot version 2")));
+
+  std::string other_kind = snapshot;
+  other_kind[7] = 'x';
+  EXPECT_THAT(CreateAstFromSnapshot(other_kind),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unknown CEL AST snapshot kind")));
+
+  std::string malformed = snapshot.substr(0, 8) + "\xff\xff\xff";
+  EXPECT_THAT(CreateAstFromSnapshot(malformed),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("malformed parsed AST snapshot")));
+}
+
+}  // namespace
+}  // namespace cel::extensions
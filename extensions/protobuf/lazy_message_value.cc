@@ -0,0 +1,847 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/protobuf/lazy_message_value.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/base/attributes.h"
+#include "absl/base/casts.h"
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/struct_value.h"
+#include "eval/public/ast_traverse.h"
+#include "eval/public/ast_visitor_base.h"
+#include "internal/any_type_cache.h"
+#include "internal/deserialize.h"
+#include "internal/proto_wire.h"
+#include "internal/status_macros.h"
+#include "runtime/internal/errors.h"
+#include "google/protobuf/descriptor.h"
+
+namespace cel::extensions {
+
+namespace {
+
+using ::cel::base_internal::FieldIdFactory;
+using ::cel::internal::ProtoWireType;
+using ::google::api::expr::v1alpha1::Expr;
+using ::google::api::expr::v1alpha1::SourceInfo;
+using ::google::protobuf::Descriptor;
+using ::google::protobuf::FieldDescriptor;
+
+absl::StatusOr<Handle<Type>> FieldType(TypeFactory& type_factory,
+                                       const FieldDescriptor* field);
+
+absl::StatusOr<Handle<Type>> FieldElementType(TypeFactory& type_factory,
+                                              const FieldDescriptor* field);
+
+absl::StatusOr<Handle<Value>> CreateMessageValue(
+    ValueFactory& value_factory, const Descriptor* descriptor,
+    absl::Cord data, absl::Span<const int> field_numbers = {});
+
+absl::Status MalformedFieldError(const FieldDescriptor* field) {
+  return absl::DataLossError(absl::StrCat(
+      "malformed value encountered decoding field ", field->full_name()));
+}
+
+// Returns the wire type of a single element of field.
+ProtoWireType ElementWireType(const FieldDescriptor* field) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_FIXED32:
+    case FieldDescriptor::TYPE_SFIXED32:
+    case FieldDescriptor::TYPE_FLOAT:
+      return ProtoWireType::kFixed32;
+    case FieldDescriptor::TYPE_FIXED64:
+    case FieldDescriptor::TYPE_SFIXED64:
+    case FieldDescriptor::TYPE_DOUBLE:
+      return ProtoWireType::kFixed64;
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+    case FieldDescriptor::TYPE_MESSAGE:
+      return ProtoWireType::kLengthDelimited;
+    case FieldDescriptor::TYPE_GROUP:
+      return ProtoWireType::kStartGroup;
+    default:
+      return ProtoWireType::kVarint;
+  }
+}
+
+// Decodes the bits of a single varint, fixed32 or fixed64 value at the start
+// of data, removing it from data.
+absl::StatusOr<uint64_t> DecodeBits(const FieldDescriptor* field,
+                                    ProtoWireType type, absl::Cord& data) {
+  switch (type) {
+    case ProtoWireType::kVarint:
+      if (auto result = cel::internal::VarintDecode<uint64_t>(data);
+          result.has_value()) {
+        data.RemovePrefix(result->size_bytes);
+        return result->value;
+      }
+      break;
+    case ProtoWireType::kFixed32:
+      if (auto result = cel::internal::Fixed32Decode<uint32_t>(data);
+          result.has_value()) {
+        data.RemovePrefix(4);
+        return *result;
+      }
+      break;
+    case ProtoWireType::kFixed64:
+      if (auto result = cel::internal::Fixed64Decode<uint64_t>(data);
+          result.has_value()) {
+        data.RemovePrefix(8);
+        return *result;
+      }
+      break;
+    default:
+      break;
+  }
+  return MalformedFieldError(field);
+}
+
+// Converts the decoded bits of a scalar field to its CEL value.
+Handle<Value> ScalarValue(ValueFactory& value_factory,
+                          const FieldDescriptor* field, uint64_t bits) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_ENUM:
+      return value_factory.CreateIntValue(static_cast<int32_t>(bits));
+    case FieldDescriptor::TYPE_SFIXED32:
+      return value_factory.CreateIntValue(
+          absl::bit_cast<int32_t>(static_cast<uint32_t>(bits)));
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      return value_factory.CreateIntValue(absl::bit_cast<int64_t>(bits));
+    case FieldDescriptor::TYPE_SINT32: {
+      uint32_t value = static_cast<uint32_t>(bits);
+      return value_factory.CreateIntValue(
+          absl::bit_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1)));
+    }
+    case FieldDescriptor::TYPE_SINT64:
+      return value_factory.CreateIntValue(
+          absl::bit_cast<int64_t>((bits >> 1) ^ (~(bits & 1) + 1)));
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_FIXED32:
+      return value_factory.CreateUintValue(static_cast<uint32_t>(bits));
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_FIXED64:
+      return value_factory.CreateUintValue(bits);
+    case FieldDescriptor::TYPE_FLOAT:
+      return value_factory.CreateDoubleValue(
+          absl::bit_cast<float>(static_cast<uint32_t>(bits)));
+    case FieldDescriptor::TYPE_DOUBLE:
+      return value_factory.CreateDoubleValue(absl::bit_cast<double>(bits));
+    case FieldDescriptor::TYPE_BOOL:
+      return value_factory.CreateBoolValue(bits != 0);
+    default:
+      // Length delimited fields are decoded by LengthDelimitedValue.
+      ABSL_UNREACHABLE();
+  }
+}
+
+// Converts the payload of a string, bytes or message field to its CEL value.
+absl::StatusOr<Handle<Value>> LengthDelimitedValue(ValueFactory& value_factory,
+                                                   const FieldDescriptor* field,
+                                                   absl::Cord data) {
+  switch (field->type()) {
+    case FieldDescriptor::TYPE_STRING:
+      return value_factory.CreateStringValue(std::move(data));
+    case FieldDescriptor::TYPE_BYTES:
+      return value_factory.CreateBytesValue(std::move(data));
+    case FieldDescriptor::TYPE_MESSAGE:
+      return CreateMessageValue(value_factory, field->message_type(),
+                                std::move(data));
+    default:
+      return MalformedFieldError(field);
+  }
+}
+
+// Returns the value of a singular field which is not encoded.
+absl::StatusOr<Handle<Value>> DefaultValue(ValueFactory& value_factory,
+                                           const FieldDescriptor* field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return value_factory.CreateIntValue(field->default_value_int32());
+    case FieldDescriptor::CPPTYPE_INT64:
+      return value_factory.CreateIntValue(field->default_value_int64());
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return value_factory.CreateUintValue(field->default_value_uint32());
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return value_factory.CreateUintValue(field->default_value_uint64());
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return value_factory.CreateDoubleValue(field->default_value_float());
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return value_factory.CreateDoubleValue(field->default_value_double());
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return value_factory.CreateBoolValue(field->default_value_bool());
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return value_factory.CreateIntValue(
+          field->default_value_enum()->number());
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (field->type() == FieldDescriptor::TYPE_BYTES) {
+        return value_factory.CreateBytesValue(field->default_value_string());
+      }
+      return value_factory.CreateStringValue(field->default_value_string());
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      switch (field->message_type()->well_known_type()) {
+        case Descriptor::WELLKNOWNTYPE_DOUBLEVALUE:
+        case Descriptor::WELLKNOWNTYPE_FLOATVALUE:
+        case Descriptor::WELLKNOWNTYPE_INT64VALUE:
+        case Descriptor::WELLKNOWNTYPE_UINT64VALUE:
+        case Descriptor::WELLKNOWNTYPE_INT32VALUE:
+        case Descriptor::WELLKNOWNTYPE_UINT32VALUE:
+        case Descriptor::WELLKNOWNTYPE_STRINGVALUE:
+        case Descriptor::WELLKNOWNTYPE_BYTESVALUE:
+        case Descriptor::WELLKNOWNTYPE_BOOLVALUE:
+        case Descriptor::WELLKNOWNTYPE_ANY:
+          // Unset wrapper and any fields are null.
+          return value_factory.GetNullValue();
+        default:
+          return CreateMessageValue(value_factory, field->message_type(),
+                                    absl::Cord());
+      }
+  }
+  return absl::InternalError(
+      absl::StrCat("unexpected field type decoding ", field->full_name()));
+}
+
+// Location of one encoded occurrence of a field within the message bytes. For
+// length delimited values, the range excludes the length.
+struct FieldOccurrence final {
+  ProtoWireType type;
+  size_t offset;
+  size_t size;
+};
+
+class LazyMessageType final : public CEL_STRUCT_TYPE_CLASS {
+ public:
+  explicit LazyMessageType(const Descriptor* descriptor)
+      : descriptor_(descriptor) {}
+
+  static absl::StatusOr<Field> MakeField(TypeFactory& type_factory,
+                                         const FieldDescriptor* field) {
+    CEL_ASSIGN_OR_RETURN(auto type, FieldType(type_factory, field));
+    return Field(FieldIdFactory::Make(field->number()), field->name(),
+                 field->number(), std::move(type), field);
+  }
+
+  absl::string_view name() const override { return descriptor_->full_name(); }
+
+  size_t field_count() const override { return descriptor_->field_count(); }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByName(
+      TypeManager& type_manager, absl::string_view name) const override {
+    const auto* field = descriptor_->FindFieldByName(std::string(name));
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), field);
+  }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByNumber(
+      TypeManager& type_manager, int64_t number) const override {
+    if (number < 1 || number > FieldDescriptor::kMaxNumber) {
+      return absl::nullopt;
+    }
+    const auto* field =
+        descriptor_->FindFieldByNumber(static_cast<int>(number));
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), field);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(TypeManager& type_manager) const override;
+
+ private:
+  const Descriptor* const descriptor_;
+
+  CEL_DECLARE_STRUCT_TYPE(LazyMessageType);
+};
+
+CEL_IMPLEMENT_STRUCT_TYPE(LazyMessageType);
+
+class LazyMessageTypeFieldIterator final : public StructType::FieldIterator {
+ public:
+  LazyMessageTypeFieldIterator(TypeManager& type_manager,
+                               const Descriptor* descriptor)
+      : type_manager_(type_manager), descriptor_(descriptor) {}
+
+  bool HasNext() override { return index_ < descriptor_->field_count(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= descriptor_->field_count())) {
+      return absl::FailedPreconditionError(
+          "StructType::FieldIterator::Next() called when "
+          "StructType::FieldIterator::HasNext() returns false");
+    }
+    return LazyMessageType::MakeField(type_manager_.type_factory(),
+                                      descriptor_->field(index_++));
+  }
+
+ private:
+  TypeManager& type_manager_;
+  const Descriptor* const descriptor_;
+  int index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructType::FieldIterator>>>
+LazyMessageType::NewFieldIterator(TypeManager& type_manager) const {
+  return std::make_unique<LazyMessageTypeFieldIterator>(type_manager,
+                                                        descriptor_);
+}
+
+class LazyMessageValue final : public CEL_STRUCT_VALUE_CLASS {
+ public:
+  LazyMessageValue(const Handle<StructType>& type, const Descriptor* descriptor,
+                   absl::Cord data, std::vector<int> field_numbers)
+      : CEL_STRUCT_VALUE_CLASS(type),
+        descriptor_(descriptor),
+        data_(std::move(data)),
+        field_numbers_(std::move(field_numbers)) {
+    std::sort(field_numbers_.begin(), field_numbers_.end());
+  }
+
+  std::string DebugString() const override {
+    // Decoding the message for printing would defeat the purpose.
+    return absl::StrCat(descriptor_->full_name(), "{", data_.size(),
+                        " bytes}");
+  }
+
+  size_t field_count() const override {
+    size_t count = 0;
+    for (int i = 0; i < descriptor_->field_count(); ++i) {
+      auto has = HasField(descriptor_->field(i));
+      if (has.ok() && *has) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByName(
+      ValueFactory& value_factory, absl::string_view name) const override {
+    const auto* field = descriptor_->FindFieldByName(std::string(name));
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return GetField(value_factory, field);
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByNumber(
+      ValueFactory& value_factory, int64_t number) const override {
+    const auto* field = FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return GetField(value_factory, field);
+  }
+
+  absl::StatusOr<bool> HasFieldByName(TypeManager& type_manager,
+                                      absl::string_view name) const override {
+    const auto* field = descriptor_->FindFieldByName(std::string(name));
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return HasField(field);
+  }
+
+  absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
+                                        int64_t number) const override {
+    const auto* field = FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return HasField(field);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(ValueFactory& value_factory) const override;
+
+  absl::StatusOr<Handle<Value>> GetField(ValueFactory& value_factory,
+                                         const FieldDescriptor* field) const;
+
+  absl::StatusOr<bool> HasField(const FieldDescriptor* field) const;
+
+ private:
+  const FieldDescriptor* FindFieldByNumber(int64_t number) const {
+    if (number < 1 || number > FieldDescriptor::kMaxNumber) {
+      return nullptr;
+    }
+    return descriptor_->FindFieldByNumber(static_cast<int>(number));
+  }
+
+  // Returns the occurrences of the field with the given number, scanning the
+  // message first if the field has not been recorded.
+  absl::StatusOr<std::vector<FieldOccurrence>> Find(int number) const;
+
+  // Records the occurrences of the fields in field_numbers, or of all fields
+  // if it is empty.
+  absl::Status Scan(absl::Span<const int> field_numbers) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::StatusOr<Handle<Value>> GetRepeatedField(
+      ValueFactory& value_factory, const FieldDescriptor* field,
+      const std::vector<FieldOccurrence>& occurrences) const;
+
+  absl::Cord Slice(const FieldOccurrence& occurrence) const {
+    return data_.Subcord(occurrence.offset, occurrence.size);
+  }
+
+  const Descriptor* const descriptor_;
+  const absl::Cord data_;
+  std::vector<int> field_numbers_;
+  mutable absl::Mutex mutex_;
+  mutable bool scanned_ ABSL_GUARDED_BY(mutex_) = false;
+  mutable bool scanned_all_ ABSL_GUARDED_BY(mutex_) = false;
+  mutable absl::flat_hash_map<int, std::vector<FieldOccurrence>> occurrences_
+      ABSL_GUARDED_BY(mutex_);
+
+  CEL_DECLARE_STRUCT_VALUE(LazyMessageValue);
+};
+
+CEL_IMPLEMENT_STRUCT_VALUE(LazyMessageValue);
+
+class LazyMessageValueFieldIterator final : public StructValue::FieldIterator {
+ public:
+  LazyMessageValueFieldIterator(ValueFactory& value_factory,
+                                const LazyMessageValue& value,
+                                std::vector<const FieldDescriptor*> fields)
+      : value_factory_(value_factory),
+        value_(value),
+        fields_(std::move(fields)) {}
+
+  bool HasNext() override { return index_ < fields_.size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= fields_.size())) {
+      return absl::FailedPreconditionError(
+          "StructValue::FieldIterator::Next() called when "
+          "StructValue::FieldIterator::HasNext() returns false");
+    }
+    const auto* field = fields_[index_++];
+    CEL_ASSIGN_OR_RETURN(auto value, value_.GetField(value_factory_, field));
+    return Field(FieldIdFactory::Make(field->number()), std::move(value));
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const LazyMessageValue& value_;
+  const std::vector<const FieldDescriptor*> fields_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructValue::FieldIterator>>>
+LazyMessageValue::NewFieldIterator(ValueFactory& value_factory) const {
+  std::vector<const FieldDescriptor*> fields;
+  for (int i = 0; i < descriptor_->field_count(); ++i) {
+    CEL_ASSIGN_OR_RETURN(bool has, HasField(descriptor_->field(i)));
+    if (has) {
+      fields.push_back(descriptor_->field(i));
+    }
+  }
+  return std::make_unique<LazyMessageValueFieldIterator>(value_factory, *this,
+                                                         std::move(fields));
+}
+
+absl::StatusOr<std::vector<FieldOccurrence>> LazyMessageValue::Find(
+    int number) const {
+  absl::MutexLock lock(&mutex_);
+  bool recorded =
+      scanned_all_ ||
+      (scanned_ && std::binary_search(field_numbers_.begin(),
+                                      field_numbers_.end(), number));
+  if (!recorded) {
+    // The first scan only records the fields the expression needs, if they
+    // are known. Any other field requires a full scan.
+    bool all = scanned_ || field_numbers_.empty() ||
+               !std::binary_search(field_numbers_.begin(),
+                                   field_numbers_.end(), number);
+    occurrences_.clear();
+    CEL_RETURN_IF_ERROR(Scan(all ? absl::Span<const int>()
+                                 : absl::MakeConstSpan(field_numbers_)));
+    scanned_ = true;
+    scanned_all_ = all;
+  }
+  // Copied, as a later full scan replaces the recorded occurrences.
+  if (auto it = occurrences_.find(number); it != occurrences_.end()) {
+    return it->second;
+  }
+  return std::vector<FieldOccurrence>();
+}
+
+absl::Status LazyMessageValue::Scan(absl::Span<const int> field_numbers) const {
+  absl::Cord rest = data_;
+  while (!rest.empty()) {
+    auto tag_value = cel::internal::VarintDecode<uint32_t>(rest);
+    if (ABSL_PREDICT_FALSE(!tag_value.has_value())) {
+      return absl::DataLossError(absl::StrCat(
+          "malformed tag encountered decoding ", descriptor_->full_name()));
+    }
+    auto tag = cel::internal::DecodeProtoWireTag(tag_value->value);
+    if (ABSL_PREDICT_FALSE(!tag.has_value())) {
+      return absl::DataLossError(absl::StrCat(
+          "invalid wire type or field number encountered decoding ",
+          descriptor_->full_name()));
+    }
+    rest.RemovePrefix(tag_value->size_bytes);
+    size_t offset = data_.size() - rest.size();
+    if (tag->type() == ProtoWireType::kLengthDelimited) {
+      auto length = cel::internal::VarintDecode<uint32_t>(rest);
+      if (ABSL_PREDICT_TRUE(length.has_value())) {
+        offset += length->size_bytes;
+      }
+    }
+    if (ABSL_PREDICT_FALSE(
+            !cel::internal::SkipLengthValue(rest, tag->type()))) {
+      return absl::DataLossError(
+          absl::StrCat("malformed length or value encountered decoding field ",
+                       tag->field_number(), " of ", descriptor_->full_name()));
+    }
+    int number = static_cast<int>(tag->field_number());
+    if (field_numbers.empty() ||
+        std::binary_search(field_numbers.begin(), field_numbers.end(),
+                           number)) {
+      occurrences_[number].push_back(FieldOccurrence{
+          tag->type(), offset, data_.size() - rest.size() - offset});
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<Handle<Value>> LazyMessageValue::GetField(
+    ValueFactory& value_factory, const FieldDescriptor* field) const {
+  if (field->is_map() || field->type() == FieldDescriptor::TYPE_GROUP) {
+    return absl::UnimplementedError(absl::StrCat(
+        "lazy access to field ", field->full_name(), " is not supported"));
+  }
+  CEL_ASSIGN_OR_RETURN(auto occurrences, Find(field->number()));
+  if (field->is_repeated()) {
+    return GetRepeatedField(value_factory, field, occurrences);
+  }
+  if (occurrences.empty()) {
+    return DefaultValue(value_factory, field);
+  }
+  ProtoWireType type = ElementWireType(field);
+  for (const auto& occurrence : occurrences) {
+    if (ABSL_PREDICT_FALSE(occurrence.type != type)) {
+      return MalformedFieldError(field);
+    }
+  }
+  if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    // Occurrences of a singular message field are merged, which is the same
+    // as parsing their concatenation.
+    absl::Cord data;
+    for (const auto& occurrence : occurrences) {
+      data.Append(Slice(occurrence));
+    }
+    return CreateMessageValue(value_factory, field->message_type(),
+                              std::move(data));
+  }
+  // Otherwise the last occurrence wins.
+  absl::Cord data = Slice(occurrences.back());
+  if (type == ProtoWireType::kLengthDelimited) {
+    return LengthDelimitedValue(value_factory, field, std::move(data));
+  }
+  CEL_ASSIGN_OR_RETURN(uint64_t bits, DecodeBits(field, type, data));
+  return ScalarValue(value_factory, field, bits);
+}
+
+absl::StatusOr<Handle<Value>> LazyMessageValue::GetRepeatedField(
+    ValueFactory& value_factory, const FieldDescriptor* field,
+    const std::vector<FieldOccurrence>& occurrences) const {
+  CEL_ASSIGN_OR_RETURN(auto element_type,
+                       FieldElementType(value_factory.type_factory(), field));
+  ListValueBuilder<Value> builder(value_factory, std::move(element_type));
+  ProtoWireType type = ElementWireType(field);
+  for (const auto& occurrence : occurrences) {
+    absl::Cord data = Slice(occurrence);
+    if (type == ProtoWireType::kLengthDelimited) {
+      if (ABSL_PREDICT_FALSE(occurrence.type != type)) {
+        return MalformedFieldError(field);
+      }
+      CEL_ASSIGN_OR_RETURN(auto element,
+                           LengthDelimitedValue(value_factory, field, data));
+      CEL_RETURN_IF_ERROR(builder.Add(std::move(element)));
+      continue;
+    }
+    if (occurrence.type == ProtoWireType::kLengthDelimited) {
+      // Packed, any number of elements.
+      while (!data.empty()) {
+        CEL_ASSIGN_OR_RETURN(uint64_t bits, DecodeBits(field, type, data));
+        CEL_RETURN_IF_ERROR(
+            builder.Add(ScalarValue(value_factory, field, bits)));
+      }
+      continue;
+    }
+    if (ABSL_PREDICT_FALSE(occurrence.type != type)) {
+      return MalformedFieldError(field);
+    }
+    CEL_ASSIGN_OR_RETURN(uint64_t bits, DecodeBits(field, type, data));
+    CEL_RETURN_IF_ERROR(builder.Add(ScalarValue(value_factory, field, bits)));
+  }
+  return std::move(builder).Build();
+}
+
+absl::StatusOr<bool> LazyMessageValue::HasField(
+    const FieldDescriptor* field) const {
+  CEL_ASSIGN_OR_RETURN(auto occurrences, Find(field->number()));
+  if (field->is_repeated()) {
+    // Packed fields may be encoded without elements.
+    return std::any_of(occurrences.begin(), occurrences.end(),
+                       [](const FieldOccurrence& occurrence) {
+                         return occurrence.size != 0 ||
+                                occurrence.type !=
+                                    ProtoWireType::kLengthDelimited;
+                       });
+  }
+  if (occurrences.empty() || field->has_presence()) {
+    return !occurrences.empty();
+  }
+  // Fields without presence are only set if they are not the default value,
+  // which encoders usually omit.
+  const auto& last = occurrences.back();
+  if (last.type == ProtoWireType::kLengthDelimited) {
+    return last.size != 0;
+  }
+  absl::Cord data = Slice(last);
+  CEL_ASSIGN_OR_RETURN(uint64_t bits, DecodeBits(field, last.type, data));
+  return bits != 0;
+}
+
+absl::StatusOr<Handle<Type>> FieldElementType(TypeFactory& type_factory,
+                                              const FieldDescriptor* field) {
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+    case FieldDescriptor::CPPTYPE_INT64:
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return type_factory.GetIntType();
+    case FieldDescriptor::CPPTYPE_UINT32:
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return type_factory.GetUintType();
+    case FieldDescriptor::CPPTYPE_FLOAT:
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return type_factory.GetDoubleType();
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return type_factory.GetBoolType();
+    case FieldDescriptor::CPPTYPE_STRING:
+      if (field->type() == FieldDescriptor::TYPE_BYTES) {
+        return type_factory.GetBytesType();
+      }
+      return type_factory.GetStringType();
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      switch (field->message_type()->well_known_type()) {
+        case Descriptor::WELLKNOWNTYPE_UNSPECIFIED:
+          return type_factory.CreateStructType<LazyMessageType>(
+              field->message_type());
+        case Descriptor::WELLKNOWNTYPE_TIMESTAMP:
+          return type_factory.GetTimestampType();
+        case Descriptor::WELLKNOWNTYPE_DURATION:
+          return type_factory.GetDurationType();
+        default:
+          return type_factory.GetDynType();
+      }
+  }
+  return type_factory.GetDynType();
+}
+
+absl::StatusOr<Handle<Type>> FieldType(TypeFactory& type_factory,
+                                       const FieldDescriptor* field) {
+  if (field->is_map()) {
+    CEL_ASSIGN_OR_RETURN(
+        auto key,
+        FieldElementType(type_factory, field->message_type()->map_key()));
+    CEL_ASSIGN_OR_RETURN(
+        auto value,
+        FieldElementType(type_factory, field->message_type()->map_value()));
+    return type_factory.CreateMapType(std::move(key), std::move(value));
+  }
+  CEL_ASSIGN_OR_RETURN(auto element, FieldElementType(type_factory, field));
+  if (field->is_repeated()) {
+    return type_factory.CreateListType(std::move(element));
+  }
+  return element;
+}
+
+absl::StatusOr<Handle<Value>> CreateMessageValue(
+    ValueFactory& value_factory, const Descriptor* descriptor,
+    absl::Cord data, absl::Span<const int> field_numbers) {
+  switch (descriptor->well_known_type()) {
+    case Descriptor::WELLKNOWNTYPE_UNSPECIFIED: {
+      CEL_ASSIGN_OR_RETURN(
+          auto type, value_factory.type_factory()
+                         .CreateStructType<LazyMessageType>(descriptor));
+      return value_factory.CreateStructValue<LazyMessageValue>(
+          std::move(type), descriptor, std::move(data),
+          std::vector<int>(field_numbers.begin(), field_numbers.end()));
+    }
+    case Descriptor::WELLKNOWNTYPE_TIMESTAMP: {
+      CEL_ASSIGN_OR_RETURN(auto time,
+                           cel::internal::DeserializeTimestamp(data));
+      return value_factory.CreateTimestampValue(time);
+    }
+    case Descriptor::WELLKNOWNTYPE_DURATION: {
+      CEL_ASSIGN_OR_RETURN(auto duration,
+                           cel::internal::DeserializeDuration(data));
+      return value_factory.CreateDurationValue(duration);
+    }
+    case Descriptor::WELLKNOWNTYPE_DOUBLEVALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeDoubleValue(data));
+      return value_factory.CreateDoubleValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_FLOATVALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeFloatValue(data));
+      return value_factory.CreateDoubleValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_INT64VALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeInt64Value(data));
+      return value_factory.CreateIntValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_UINT64VALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeUInt64Value(data));
+      return value_factory.CreateUintValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_INT32VALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeInt32Value(data));
+      return value_factory.CreateIntValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_UINT32VALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeUInt32Value(data));
+      return value_factory.CreateUintValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_STRINGVALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeStringValue(data));
+      return value_factory.CreateStringValue(std::move(value));
+    }
+    case Descriptor::WELLKNOWNTYPE_BYTESVALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeBytesValue(data));
+      return value_factory.CreateBytesValue(std::move(value));
+    }
+    case Descriptor::WELLKNOWNTYPE_BOOLVALUE: {
+      CEL_ASSIGN_OR_RETURN(auto value,
+                           cel::internal::DeserializeBoolValue(data));
+      return value_factory.CreateBoolValue(value);
+    }
+    case Descriptor::WELLKNOWNTYPE_ANY: {
+      // The payload is itself decoded lazily, so selecting one field of a
+      // large packed message only scans it.
+      CEL_ASSIGN_OR_RETURN(auto any, cel::internal::DeserializeAny(data));
+      CEL_ASSIGN_OR_RETURN(
+          auto entry,
+          cel::internal::AnyTypeCache::Resolve(descriptor->file()->pool(),
+                                               nullptr, any.type_url()));
+      return CreateMessageValue(value_factory, entry.descriptor,
+                                any.release_value());
+    }
+    default:
+      return absl::UnimplementedError(absl::StrCat(
+          "lazy access to ", descriptor->full_name(), " is not supported"));
+  }
+}
+
+// Collects the fields selected directly from a variable.
+class SelectedFieldsVisitor final
+    : public google::api::expr::runtime::AstVisitorBase {
+ public:
+  SelectedFieldsVisitor(absl::string_view variable,
+                        const Descriptor* descriptor)
+      : variable_(variable), descriptor_(descriptor) {}
+
+  void PostVisitSelect(const Expr::Select* select, const Expr*,
+                       const google::api::expr::runtime::SourcePosition*)
+      override {
+    if (!select->operand().has_ident_expr() ||
+        select->operand().ident_expr().name() != variable_) {
+      return;
+    }
+    if (const auto* field = descriptor_->FindFieldByName(select->field());
+        field != nullptr) {
+      field_numbers_.push_back(field->number());
+    }
+  }
+
+  std::vector<int> field_numbers() && {
+    std::sort(field_numbers_.begin(), field_numbers_.end());
+    field_numbers_.erase(
+        std::unique(field_numbers_.begin(), field_numbers_.end()),
+        field_numbers_.end());
+    return std::move(field_numbers_);
+  }
+
+ private:
+  const absl::string_view variable_;
+  const Descriptor* const descriptor_;
+  std::vector<int> field_numbers_;
+};
+
+}  // namespace
+
+absl::StatusOr<Handle<StructValue>> CreateLazyMessageValue(
+    ValueFactory& value_factory,
+    absl::Nonnull<const google::protobuf::Descriptor*> descriptor,
+    absl::Cord data, absl::Span<const int> field_numbers) {
+  if (descriptor->well_known_type() != Descriptor::WELLKNOWNTYPE_UNSPECIFIED) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "lazy message values of ", descriptor->full_name(),
+        " are not supported"));
+  }
+  CEL_ASSIGN_OR_RETURN(auto value,
+                       CreateMessageValue(value_factory, descriptor,
+                                          std::move(data), field_numbers));
+  return std::move(value).As<StructValue>();
+}
+
+std::vector<int> LazyMessageFieldNumbers(
+    const Expr& expr, absl::string_view variable,
+    absl::Nonnull<const google::protobuf::Descriptor*> descriptor) {
+  SelectedFieldsVisitor visitor(variable, descriptor);
+  SourceInfo source_info;
+  google::api::expr::runtime::AstTraverse(&expr, &source_info, &visitor);
+  return std::move(visitor).field_numbers();
+}
+
+}  // namespace cel::extensions
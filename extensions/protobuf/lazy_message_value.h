@@ -0,0 +1,64 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_LAZY_MESSAGE_VALUE_H_
+#define THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_LAZY_MESSAGE_VALUE_H_
+
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+#include "google/protobuf/descriptor.h"
+
+namespace cel::extensions {
+
+// Returns a message value of type `descriptor` over its serialized wire format
+// `data`, without parsing it. The bytes are scanned once, on the first field
+// access, recording where each field is encoded; fields are only decoded when
+// selected. Expressions which select a few fields of large messages avoid the
+// cost of parsing the whole message.
+//
+// If `field_numbers` is not empty, the first scan only records those fields.
+// Selecting any other field scans the message again in full.
+//
+// Singular and repeated scalar, string, bytes, enum and message fields are
+// supported, as are google.protobuf.Timestamp, google.protobuf.Duration, the
+// wrapper types and google.protobuf.Any. The payloads of Any fields are
+// resolved in the descriptor pool of `descriptor` and decoded lazily as well.
+// Selecting map fields and other well known types is unimplemented. `data`
+// is not validated upfront, malformed fields are reported when selected.
+// `descriptor` must outlive the returned value.
+absl::StatusOr<Handle<StructValue>> CreateLazyMessageValue(
+    ValueFactory& value_factory,
+    absl::Nonnull<const google::protobuf::Descriptor*> descriptor,
+    absl::Cord data, absl::Span<const int> field_numbers = {});
+
+// Returns the numbers of the fields of `descriptor` which `expr` selects or
+// tests from the variable `variable`, in ascending order. Pass the result to
+// `CreateLazyMessageValue` when binding `variable` so that a single scan of the
+// message finds every field the expression needs.
+std::vector<int> LazyMessageFieldNumbers(
+    const google::api::expr::v1alpha1::Expr& expr, absl::string_view variable,
+    absl::Nonnull<const google::protobuf::Descriptor*> descriptor);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_EXTENSIONS_PROTOBUF_LAZY_MESSAGE_VALUE_H_
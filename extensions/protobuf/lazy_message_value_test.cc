@@ -0,0 +1,286 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "extensions/protobuf/lazy_message_value.h"
+
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/cord.h"
+#include "absl/time/time.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "base/values/struct_value.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "proto/test/v1/proto3/test_all_types.pb.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::internal::StatusIs;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::test::v1::proto3::TestAllTypes;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+class LazyMessageValueTest : public testing::Test {
+ public:
+  LazyMessageValueTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+ protected:
+  Handle<StructValue> Lazy(const TestAllTypes& message,
+                           absl::Span<const int> field_numbers = {}) {
+    return CreateLazyMessageValue(value_factory_, TestAllTypes::descriptor(),
+                                  absl::Cord(message.SerializeAsString()),
+                                  field_numbers)
+        .value();
+  }
+
+  Handle<Value> Get(const Handle<StructValue>& value, absl::string_view name) {
+    return value->GetFieldByName(value_factory_, name).value();
+  }
+
+  bool Has(const Handle<StructValue>& value, absl::string_view name) {
+    return value->HasFieldByName(type_manager_, name).value();
+  }
+
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(LazyMessageValueTest, Scalars) {
+  TestAllTypes message;
+  message.set_single_int32(-32);
+  message.set_single_int64(-64);
+  message.set_single_uint32(32);
+  message.set_single_uint64(64);
+  message.set_single_sint32(-3);
+  message.set_single_sint64(-6);
+  message.set_single_fixed32(7);
+  message.set_single_sfixed64(-8);
+  message.set_single_float(1.5);
+  message.set_single_double(2.5);
+  message.set_single_bool(true);
+  message.set_single_string("foo");
+  message.set_single_bytes("bar");
+  message.set_standalone_enum(TestAllTypes::BAR);
+  auto value = Lazy(message);
+
+  EXPECT_EQ(value->type()->name(),
+            "google.api.expr.test.v1.proto3.TestAllTypes");
+  EXPECT_EQ(Get(value, "single_int32")->As<IntValue>().NativeValue(), -32);
+  EXPECT_EQ(Get(value, "single_int64")->As<IntValue>().NativeValue(), -64);
+  EXPECT_EQ(Get(value, "single_uint32")->As<UintValue>().NativeValue(), 32);
+  EXPECT_EQ(Get(value, "single_uint64")->As<UintValue>().NativeValue(), 64);
+  EXPECT_EQ(Get(value, "single_sint32")->As<IntValue>().NativeValue(), -3);
+  EXPECT_EQ(Get(value, "single_sint64")->As<IntValue>().NativeValue(), -6);
+  EXPECT_EQ(Get(value, "single_fixed32")->As<UintValue>().NativeValue(), 7);
+  EXPECT_EQ(Get(value, "single_sfixed64")->As<IntValue>().NativeValue(), -8);
+  EXPECT_EQ(Get(value, "single_float")->As<DoubleValue>().NativeValue(), 1.5);
+  EXPECT_EQ(Get(value, "single_double")->As<DoubleValue>().NativeValue(), 2.5);
+  EXPECT_TRUE(Get(value, "single_bool")->As<BoolValue>().NativeValue());
+  EXPECT_EQ(Get(value, "single_string")->As<StringValue>().ToString(), "foo");
+  EXPECT_EQ(Get(value, "single_bytes")->As<BytesValue>().ToString(), "bar");
+  EXPECT_EQ(Get(value, "standalone_enum")->As<IntValue>().NativeValue(),
+            TestAllTypes::BAR);
+
+  // Unset fields have their default values.
+  EXPECT_EQ(Get(value, "single_fixed64")->As<UintValue>().NativeValue(), 0);
+  EXPECT_FALSE(Has(value, "single_fixed64"));
+  EXPECT_TRUE(Has(value, "single_int32"));
+  EXPECT_EQ(value->field_count(), 14);
+
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "no_such_field"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(LazyMessageValueTest, Messages) {
+  TestAllTypes message;
+  message.mutable_single_nested_message()->set_bb(42);
+  message.mutable_single_timestamp()->set_seconds(100);
+  message.mutable_single_int64_wrapper()->set_value(7);
+  auto value = Lazy(message);
+
+  auto nested = Get(value, "single_nested_message");
+  ASSERT_TRUE(nested->Is<StructValue>());
+  EXPECT_EQ(Get(nested.As<StructValue>(), "bb")->As<IntValue>().NativeValue(),
+            42);
+  EXPECT_EQ(Get(value, "single_timestamp")->As<TimestampValue>().NativeValue(),
+            absl::FromUnixSeconds(100));
+  EXPECT_EQ(Get(value, "single_int64_wrapper")->As<IntValue>().NativeValue(),
+            7);
+  EXPECT_TRUE(Get(value, "single_int32_wrapper")->Is<NullValue>());
+
+  // Unset message fields are empty messages, but not present.
+  EXPECT_FALSE(Has(value, "standalone_message"));
+  auto empty = Get(value, "standalone_message");
+  ASSERT_TRUE(empty->Is<StructValue>());
+  EXPECT_EQ(empty.As<StructValue>()->field_count(), 0);
+}
+
+TEST_F(LazyMessageValueTest, Any) {
+  TestAllTypes payload;
+  payload.set_single_int64(42);
+  payload.set_single_string("foo");
+  TestAllTypes message;
+  message.mutable_single_any()->PackFrom(payload);
+  auto value = Lazy(message);
+
+  auto any = Get(value, "single_any");
+  ASSERT_TRUE(any->Is<StructValue>());
+  EXPECT_EQ(any->As<StructValue>().type()->name(),
+            "google.api.expr.test.v1.proto3.TestAllTypes");
+  EXPECT_EQ(Get(any.As<StructValue>(), "single_int64")
+                ->As<IntValue>()
+                .NativeValue(),
+            42);
+
+  // Unset any fields are null.
+  EXPECT_TRUE(Get(Lazy(TestAllTypes()), "single_any")->Is<NullValue>());
+
+  message.mutable_single_any()->set_type_url(
+      "type.googleapis.com/no.such.Message");
+  EXPECT_THAT(Lazy(message)->GetFieldByName(value_factory_, "single_any"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(LazyMessageValueTest, MergedOccurrences) {
+  TestAllTypes first;
+  first.set_single_int64(1);
+  first.mutable_single_nested_message()->set_bb(1);
+  TestAllTypes second;
+  second.set_single_int64(2);
+  second.add_repeated_int64(3);
+  // Concatenated messages are merged: the last scalar wins and message fields
+  // are merged.
+  auto value = CreateLazyMessageValue(
+                   value_factory_, TestAllTypes::descriptor(),
+                   absl::Cord(first.SerializeAsString() +
+                              second.SerializeAsString()))
+                   .value();
+  EXPECT_EQ(Get(value, "single_int64")->As<IntValue>().NativeValue(), 2);
+  EXPECT_EQ(Get(Get(value, "single_nested_message").As<StructValue>(), "bb")
+                ->As<IntValue>()
+                .NativeValue(),
+            1);
+  EXPECT_EQ(Get(value, "repeated_int64")->As<ListValue>().Size(), 1);
+}
+
+TEST_F(LazyMessageValueTest, Repeated) {
+  TestAllTypes message;
+  message.add_repeated_int64(1);
+  message.add_repeated_int64(-2);
+  message.add_repeated_string("a");
+  message.add_repeated_string("b");
+  message.add_repeated_nested_message()->set_bb(3);
+  auto value = Lazy(message);
+
+  // Packed.
+  auto ints = Get(value, "repeated_int64");
+  ASSERT_EQ(ints->As<ListValue>().Size(), 2);
+  EXPECT_EQ(ints->As<ListValue>()
+                .Get(value_factory_, 1)
+                .value()
+                ->As<IntValue>()
+                .NativeValue(),
+            -2);
+  // Unpacked.
+  auto strings = Get(value, "repeated_string");
+  ASSERT_EQ(strings->As<ListValue>().Size(), 2);
+  EXPECT_EQ(strings->As<ListValue>()
+                .Get(value_factory_, 0)
+                .value()
+                ->As<StringValue>()
+                .ToString(),
+            "a");
+  EXPECT_EQ(Get(value, "repeated_nested_message")->As<ListValue>().Size(), 1);
+
+  EXPECT_TRUE(Has(value, "repeated_int64"));
+  EXPECT_FALSE(Has(value, "repeated_int32"));
+  EXPECT_TRUE(Get(value, "repeated_int32")->As<ListValue>().IsEmpty());
+}
+
+TEST_F(LazyMessageValueTest, FieldNumbers) {
+  TestAllTypes message;
+  message.set_single_int64(1);
+  message.set_single_string("foo");
+  message.set_single_bool(true);
+  auto value = Lazy(message, {TestAllTypes::kSingleInt64FieldNumber,
+                              TestAllTypes::kSingleStringFieldNumber});
+  EXPECT_EQ(Get(value, "single_int64")->As<IntValue>().NativeValue(), 1);
+  EXPECT_EQ(Get(value, "single_string")->As<StringValue>().ToString(), "foo");
+  // Fields which were not requested are still found.
+  EXPECT_TRUE(Get(value, "single_bool")->As<BoolValue>().NativeValue());
+  EXPECT_EQ(Get(value, "single_int64")->As<IntValue>().NativeValue(), 1);
+}
+
+TEST_F(LazyMessageValueTest, Iterator) {
+  TestAllTypes message;
+  message.set_single_int64(1);
+  message.set_single_string("foo");
+  auto value = Lazy(message);
+  ASSERT_OK_AND_ASSIGN(auto iterator, value->NewFieldIterator(value_factory_));
+  int count = 0;
+  while (iterator->HasNext()) {
+    ASSERT_OK_AND_ASSIGN(auto field, iterator->Next());
+    EXPECT_FALSE(field.value->Is<ErrorValue>());
+    ++count;
+  }
+  EXPECT_EQ(count, 2);
+}
+
+TEST_F(LazyMessageValueTest, Unsupported) {
+  TestAllTypes message;
+  (*message.mutable_map_string_string())["a"] = "b";
+  auto value = Lazy(message);
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "map_string_string"),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+TEST_F(LazyMessageValueTest, Malformed) {
+  ASSERT_OK_AND_ASSIGN(
+      auto value,
+      CreateLazyMessageValue(value_factory_, TestAllTypes::descriptor(),
+                             absl::Cord("\x10\xff")));
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "single_int64"),
+              StatusIs(absl::StatusCode::kDataLoss));
+}
+
+TEST(LazyMessageFieldNumbers, Select) {
+  ASSERT_OK_AND_ASSIGN(
+      auto parsed,
+      Parse("msg.single_int64 > 1 && has(msg.single_string) && "
+            "other.single_bool && msg.single_int64 < 10 && msg.no_such_field"));
+  EXPECT_THAT(LazyMessageFieldNumbers(parsed.expr(), "msg",
+                                      TestAllTypes::descriptor()),
+              ElementsAre(TestAllTypes::kSingleInt64FieldNumber,
+                          TestAllTypes::kSingleStringFieldNumber));
+  EXPECT_THAT(LazyMessageFieldNumbers(parsed.expr(), "unused",
+                                      TestAllTypes::descriptor()),
+              IsEmpty());
+}
+
+}  // namespace
+}  // namespace cel::extensions
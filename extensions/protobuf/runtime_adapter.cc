@@ -30,7 +30,7 @@ absl::StatusOr<std::unique_ptr<TraceableProgram>>
 ProtobufRuntimeAdapter::CreateProgram(
     const Runtime& runtime, const google::api::expr::v1alpha1::CheckedExpr& expr,
     const Runtime::CreateProgramOptions options) {
-  CEL_ASSIGN_OR_RETURN(auto ast, CreateAstFromCheckedExpr(expr));
+  CEL_ASSIGN_OR_RETURN(auto ast, CreateAstForPlanningFromCheckedExpr(expr));
   return runtime.CreateTraceableProgram(std::move(ast), options);
 }
 
@@ -14,6 +14,7 @@
 
 #include "extensions/regex_functions.h"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,6 +27,7 @@
 #include "eval/public/cel_value.h"
 #include "eval/public/containers/container_backed_map_impl.h"
 #include "eval/public/portable_cel_function_adapter.h"
+#include "internal/regex_cache.h"
 #include "re2/re2.h"
 
 namespace cel::extensions {
@@ -40,12 +42,20 @@ using ::google::api::expr::runtime::PortableBinaryFunctionAdapter;
 using ::google::api::expr::runtime::PortableFunctionAdapter;
 using ::google::protobuf::Arena;
 
+// Number of dynamic patterns kept compiled per registry. Constant patterns are
+// compiled when planning if regex precompilation is enabled.
+constexpr size_t kRegexCacheCapacity = 256;
+
+using RegexCache = ::cel::internal::RegexCache;
+
 // Extract matched group values from the given target string and rewrite the
 // string
-CelValue ExtractString(Arena* arena, CelValue::StringHolder target,
+CelValue ExtractString(Arena* arena, RegexCache& cache,
+                       CelValue::StringHolder target,
                        CelValue::StringHolder regex,
                        CelValue::StringHolder rewrite) {
-  RE2 re2(regex.value());
+  std::shared_ptr<const RE2> program = cache.Get(regex.value());
+  const RE2& re2 = *program;
   if (!re2.ok()) {
     return CreateErrorValue(
         arena, absl::InvalidArgumentError("Given Regex is Invalid"));
@@ -63,9 +73,11 @@ CelValue ExtractString(Arena* arena, CelValue::StringHolder target,
 
 // Captures the first unnamed/named group value
 // NOTE: For capturing all the groups, use CaptureStringN instead
-CelValue CaptureString(Arena* arena, CelValue::StringHolder target,
+CelValue CaptureString(Arena* arena, RegexCache& cache,
+                       CelValue::StringHolder target,
                        CelValue::StringHolder regex) {
-  RE2 re2(regex.value());
+  std::shared_ptr<const RE2> program = cache.Get(regex.value());
+  const RE2& re2 = *program;
   if (!re2.ok()) {
     return CreateErrorValue(
         arena, absl::InvalidArgumentError("Given Regex is Invalid"));
@@ -87,9 +99,11 @@ CelValue CaptureString(Arena* arena, CelValue::StringHolder target,
 // value> pairs as follows:
 //   a. For a named group - <named_group_name, captured_string>
 //   b. For an unnamed group - <group_index, captured_string>
-CelValue CaptureStringN(Arena* arena, CelValue::StringHolder target,
+CelValue CaptureStringN(Arena* arena, RegexCache& cache,
+                        CelValue::StringHolder target,
                         CelValue::StringHolder regex) {
-  RE2 re2(regex.value());
+  std::shared_ptr<const RE2> program = cache.Get(regex.value());
+  const RE2& re2 = *program;
   if (!re2.ok()) {
     return CreateErrorValue(
         arena, absl::InvalidArgumentError("Given Regex is Invalid"));
@@ -137,16 +151,20 @@ CelValue CaptureStringN(Arena* arena, CelValue::StringHolder target,
 }
 
 absl::Status RegisterRegexFunctions(CelFunctionRegistry* registry) {
+  // Shared by the registered functions, and through them by every expression
+  // planned with this registry.
+  auto cache = std::make_shared<RegexCache>(kRegexCacheCapacity);
+
   // Register Regex Extract Function
   CEL_RETURN_IF_ERROR(
       (PortableFunctionAdapter<CelValue, CelValue::StringHolder,
                                CelValue::StringHolder, CelValue::StringHolder>::
            CreateAndRegister(
                kRegexExtract, /*receiver_type=*/false,
-               [](Arena* arena, CelValue::StringHolder target,
-                  CelValue::StringHolder regex,
-                  CelValue::StringHolder rewrite) -> CelValue {
-                 return ExtractString(arena, target, regex, rewrite);
+               [cache](Arena* arena, CelValue::StringHolder target,
+                       CelValue::StringHolder regex,
+                       CelValue::StringHolder rewrite) -> CelValue {
+                 return ExtractString(arena, *cache, target, regex, rewrite);
                },
                registry)));
 
@@ -155,9 +173,9 @@ absl::Status RegisterRegexFunctions(CelFunctionRegistry* registry) {
       PortableBinaryFunctionAdapter<CelValue, CelValue::StringHolder,
                                     CelValue::StringHolder>::
           Create(kRegexCapture, /*receiver_style=*/false,
-                 [](Arena* arena, CelValue::StringHolder target,
-                    CelValue::StringHolder regex) -> CelValue {
-                   return CaptureString(arena, target, regex);
+                 [cache](Arena* arena, CelValue::StringHolder target,
+                         CelValue::StringHolder regex) -> CelValue {
+                   return CaptureString(arena, *cache, target, regex);
                  })));
 
   // Register Regex CaptureN Function
@@ -165,9 +183,9 @@ absl::Status RegisterRegexFunctions(CelFunctionRegistry* registry) {
       PortableBinaryFunctionAdapter<CelValue, CelValue::StringHolder,
                                     CelValue::StringHolder>::
           Create(kRegexCaptureN, /*receiver_style=*/false,
-                 [](Arena* arena, CelValue::StringHolder target,
-                    CelValue::StringHolder regex) -> CelValue {
-                   return CaptureStringN(arena, target, regex);
+                 [cache](Arena* arena, CelValue::StringHolder target,
+                         CelValue::StringHolder regex) -> CelValue {
+                   return CaptureStringN(arena, *cache, target, regex);
                  }));
 }
 
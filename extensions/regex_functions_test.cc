@@ -40,6 +40,7 @@ using ::google::api::expr::runtime::CelValue;
 using cel::internal::StatusIs;
 using Builder = ::google::api::expr::runtime::CelExpressionBuilder;
 using ::google::api::expr::parser::Parse;
+using ::google::api::expr::runtime::test::IsCelBool;
 using ::google::api::expr::runtime::test::IsCelError;
 using ::google::api::expr::runtime::test::IsCelString;
 using cel::internal::IsOkAndHolds;
@@ -246,6 +247,48 @@ TEST_P(RegexFunctionsTest, RegexFunctionsTests) {
 INSTANTIATE_TEST_SUITE_P(RegexFunctionsTest, RegexFunctionsTest,
                          testing::ValuesIn(createParams()));
 
+// Constant patterns are compiled when planning, and the functions are
+// evaluated without the function step. The results must not change.
+class RegexFunctionsPrecompilationTest : public RegexFunctionsTest {
+ public:
+  RegexFunctionsPrecompilationTest() {
+    options_.enable_regex_precompilation = true;
+    builder_ = CreateCelExpressionBuilder(options_);
+  }
+};
+
+TEST_F(RegexFunctionsPrecompilationTest, ExtractAndCapture) {
+  auto status = TestCaptureStringInclusion(
+      (R"(re.extract('testuser@google.com', '(.*)@([^.]*)', '\\2!\\1') +
+          re.capture('foo', 'fo(o)'))"));
+  EXPECT_THAT(status, IsOkAndHolds(IsCelString("google!testusero")));
+}
+
+TEST_F(RegexFunctionsPrecompilationTest, CaptureN) {
+  auto status = TestCaptureStringInclusion(
+      (R"(re.captureN('testuser@testdomain', '(?P<user>.*)@([^.]*)') ==
+          {'user': 'testuser', '2': 'testdomain'})"));
+  EXPECT_THAT(status, IsOkAndHolds(IsCelBool(true)));
+}
+
+TEST_F(RegexFunctionsPrecompilationTest, NonStringArgumentFallsBack) {
+  auto status = TestCaptureStringInclusion((R"(re.capture(1, 'fo(o)'))"));
+  EXPECT_THAT(status.value(), IsCelError(testing::_));
+}
+
+TEST_P(RegexFunctionsPrecompilationTest, RegexFunctionsTests) {
+  const TestCase& test_case = GetParam();
+  auto status = TestCaptureStringInclusion(test_case.expr_string);
+  EXPECT_THAT(
+      status.value(),
+      IsCelError(StatusIs(absl::StatusCode::kInvalidArgument,
+                          testing::HasSubstr(test_case.expected_result))));
+}
+
+INSTANTIATE_TEST_SUITE_P(RegexFunctionsPrecompilationTest,
+                         RegexFunctionsPrecompilationTest,
+                         testing::ValuesIn(createParams()));
+
 }  // namespace
 
 }  // namespace cel::extensions
@@ -59,6 +59,21 @@
 #include "runtime/runtime_options.h"
 
 namespace cel::extensions {
+
+namespace select_optimization_internal {
+
+// Grants the fallback traversal access to the field accessor which doesn't
+// unbox unset wrapper typed fields to null.
+struct StructValueAccess {
+  static absl::StatusOr<Handle<Value>> GetWrappedFieldByName(
+      const StructValue& struct_value, ValueFactory& value_factory,
+      absl::string_view name) {
+    return struct_value.GetWrappedFieldByName(value_factory, name);
+  }
+};
+
+}  // namespace select_optimization_internal
+
 namespace {
 
 using ::cel::ast_internal::AstImpl;
@@ -69,6 +84,7 @@ using ::cel::ast_internal::Expr;
 using ::cel::ast_internal::ExprKind;
 using ::cel::ast_internal::Select;
 using ::cel::ast_internal::SourcePosition;
+using ::cel::extensions::select_optimization_internal::StructValueAccess;
 using ::google::api::expr::runtime::AttributeTrail;
 using ::google::api::expr::runtime::ExecutionFrame;
 using ::google::api::expr::runtime::ExpressionStepBase;
@@ -258,6 +274,7 @@ absl::StatusOr<Handle<Value>> MapKeyFromQualifier(
 
 absl::StatusOr<Handle<Value>> ApplyQualifier(const Value& operand,
                                              const SelectQualifier& qualifier,
+                                             bool unbox_null_wrapper_types,
                                              ValueFactory& value_factory) {
   return absl::visit(
       cel::internal::Overloaded{
@@ -268,6 +285,11 @@ absl::StatusOr<Handle<Value>> ApplyQualifier(const Value& operand,
                   cel::runtime_internal::CreateNoMatchingOverloadError(
                       "<select>"));
             }
+            if (!unbox_null_wrapper_types) {
+              return StructValueAccess::GetWrappedFieldByName(
+                  operand.As<StructValue>(), value_factory,
+                  field_specifier.name);
+            }
             return operand.As<StructValue>().GetFieldByName(
                 value_factory, field_specifier.name);
           },
@@ -295,14 +317,17 @@ absl::StatusOr<Handle<Value>> ApplyQualifier(const Value& operand,
 
 absl::StatusOr<Handle<Value>> FallbackSelect(
     const Value& root, absl::Span<const SelectQualifier> select_path,
-    bool presence_test, ValueFactory& value_factory) {
+    bool presence_test, bool unbox_null_wrapper_types,
+    ValueFactory& value_factory) {
   const Value* elem = &root;
   Handle<Value> result;
 
   for (const auto& instruction :
        select_path.subspan(0, select_path.size() - 1)) {
     CEL_ASSIGN_OR_RETURN(result,
-                         ApplyQualifier(*elem, instruction, value_factory));
+                         ApplyQualifier(*elem, instruction,
+                                        unbox_null_wrapper_types,
+                                        value_factory));
     if (result->Is<ErrorValue>()) {
       return result;
     }
@@ -341,7 +366,8 @@ absl::StatusOr<Handle<Value>> FallbackSelect(
         last_instruction);
   }
 
-  return ApplyQualifier(*elem, last_instruction, value_factory);
+  return ApplyQualifier(*elem, last_instruction, unbox_null_wrapper_types,
+                        value_factory);
 }
 
 absl::StatusOr<std::vector<SelectQualifier>> SelectInstructionsFromCall(
@@ -386,8 +412,8 @@ class RewriterImpl : public AstRewriterBase {
                       const SourcePosition*) override {
     const Expr& operand = select->operand();
     const std::string& field_name = select->field();
-    // Select optimization can generalize to lists and maps, but for now only
-    // support message traversal.
+    // Field selections on messages and maps. Chains through map keys and list
+    // indexes are collected from the index calls below.
     const ast_internal::Type& checker_type = ast_.GetType(operand.id());
 
     absl::optional<Handle<Type>> rt_type =
@@ -620,13 +646,10 @@ AttributeTrail OptimizedSelectStep::GetAttributeTrail(
   if (attr.empty()) {
     return AttributeTrail();
   }
-  std::vector<AttributeQualifier> qualifiers =
-      std::vector<AttributeQualifier>(attr.attribute().qualifier_path().begin(),
-                                      attr.attribute().qualifier_path().end());
-  qualifiers.reserve(qualifiers_.size() + qualifiers.size());
-  absl::c_copy(qualifiers_, std::back_inserter(qualifiers));
-  AttributeTrail result(Attribute(std::string(attr.attribute().variable_name()),
-                                  std::move(qualifiers)));
+  AttributeTrail result = attr;
+  for (const auto& qualifier : qualifiers_) {
+    result = result.Step(qualifier);
+  }
   return result;
 }
 
@@ -636,11 +659,13 @@ absl::StatusOr<Handle<Value>> OptimizedSelectStep::ApplySelect(
       (options_.force_fallback_implementation)
           ? absl::UnimplementedError("Forced fallback impl")
           : struct_value.Qualify(frame->value_factory(), select_path_,
-                                 presence_test_);
+                                 presence_test_,
+                                 enable_wrapper_type_null_unboxing_);
 
   if (!value_or.ok()) {
     if (value_or.status().code() == absl::StatusCode::kUnimplemented) {
       return FallbackSelect(struct_value, select_path_, presence_test_,
+                            enable_wrapper_type_null_unboxing_,
                             frame->value_factory());
     }
 
@@ -655,7 +680,8 @@ absl::StatusOr<Handle<Value>> OptimizedSelectStep::ApplySelect(
   return FallbackSelect(
       *value_or->value,
       absl::MakeConstSpan(select_path_).subspan(value_or->qualifier_count),
-      presence_test_, frame->value_factory());
+      presence_test_, enable_wrapper_type_null_unboxing_,
+      frame->value_factory());
 }
 
 absl::Status OptimizedSelectStep::Evaluate(ExecutionFrame* frame) const {
@@ -689,16 +715,19 @@ absl::Status OptimizedSelectStep::Evaluate(ExecutionFrame* frame) const {
     }
   }
 
-
-
-  if (!operand->Is<StructValue>()) {
-    return absl::InvalidArgumentError(
-        "Expected struct type for select optimization.");
+  Handle<Value> result;
+  if (operand->Is<StructValue>()) {
+    CEL_ASSIGN_OR_RETURN(result,
+                         ApplySelect(frame, operand->As<StructValue>()));
+  } else {
+    // The runtime value doesn't agree with the checked type. Report an error
+    // value as the unoptimized select would rather than failing the
+    // evaluation.
+    result = frame->value_factory().CreateErrorValue(
+        cel::runtime_internal::CreateNoMatchingOverloadError(
+            presence_test_ ? "has" : "<select>"));
   }
 
-  CEL_ASSIGN_OR_RETURN(Handle<Value> result,
-                       ApplySelect(frame, operand->As<StructValue>()));
-
   frame->value_stack().Pop(kStackInputs);
   frame->value_stack().Push(std::move(result), std::move(attribute_trail));
   return absl::OkStatus();
@@ -0,0 +1,219 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Checks that the select optimization applies to checked expressions planned
+// through the protobuf entry points.
+
+#include "extensions/select_optimization.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "google/api/expr/v1alpha1/checked.pb.h"
+#include "absl/log/absl_check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_provider.h"
+#include "eval/compiler/flat_expr_builder.h"
+#include "eval/eval/cel_expression_flat_impl.h"
+#include "eval/internal/interop.h"
+#include "eval/public/activation.h"
+#include "eval/public/cel_expr_builder_factory.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/structs/cel_proto_wrapper.h"
+#include "eval/public/structs/legacy_type_info_apis.h"
+#include "eval/public/structs/protobuf_descriptor_type_provider.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "proto/test/v1/proto2/test_all_types.pb.h"
+#include "runtime/cost_estimate.h"
+#include "runtime/internal/runtime_friend_access.h"
+#include "runtime/internal/runtime_impl.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/text_format.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::internal::down_cast;
+using ::cel::runtime_internal::RuntimeFriendAccess;
+using ::cel::runtime_internal::RuntimeImpl;
+using ::google::api::expr::v1alpha1::CheckedExpr;
+using ::google::api::expr::runtime::Activation;
+using ::google::api::expr::runtime::CelExpression;
+using ::google::api::expr::runtime::CelExpressionFlatImpl;
+using ::google::api::expr::runtime::CelProtoWrapper;
+using ::google::api::expr::runtime::CelValue;
+using ::google::api::expr::runtime::CreateCelExpressionBuilder;
+using ::google::api::expr::runtime::InterpreterOptions;
+using ::google::api::expr::runtime::LegacyTypeInfoApis;
+using ::google::api::expr::runtime::ProtobufDescriptorProvider;
+using ::google::api::expr::test::v1::proto2::NestedTestAllTypes;
+using ::google::protobuf::Arena;
+using ::google::protobuf::TextFormat;
+using testing::Lt;
+
+// msg.child.payload.single_int64, with msg a NestedTestAllTypes.
+constexpr absl::string_view kCheckedSelectExpr = R"pb(
+  reference_map: {
+    key: 1
+    value: { name: "msg" }
+  }
+  type_map: {
+    key: 1
+    value: { message_type: "google.api.expr.test.v1.proto2.NestedTestAllTypes" }
+  }
+  type_map: {
+    key: 2
+    value: { message_type: "google.api.expr.test.v1.proto2.NestedTestAllTypes" }
+  }
+  type_map: {
+    key: 3
+    value: { message_type: "google.api.expr.test.v1.proto2.TestAllTypes" }
+  }
+  type_map: {
+    key: 4
+    value: { primitive: INT64 }
+  }
+  expr: {
+    id: 4
+    select_expr: {
+      operand: {
+        id: 3
+        select_expr: {
+          operand: {
+            id: 2
+            select_expr: {
+              operand: {
+                id: 1
+                ident_expr: { name: "msg" }
+              }
+              field: "child"
+            }
+          }
+          field: "payload"
+        }
+      }
+      field: "single_int64"
+    }
+  })pb";
+
+CheckedExpr ParseCheckedSelectExpr() {
+  CheckedExpr checked_expr;
+  ABSL_CHECK(TextFormat::ParseFromString(kCheckedSelectExpr, &checked_expr));
+  return checked_expr;
+}
+
+size_t LegacyPlanSize(const CelExpression& expression) {
+  const auto* impl = dynamic_cast<const CelExpressionFlatImpl*>(&expression);
+  ABSL_CHECK(impl != nullptr);
+  return impl->flat_expression().path().size();
+}
+
+TEST(SelectOptimizationTest, CheckedExprThroughLegacyBuilder) {
+  CheckedExpr checked_expr = ParseCheckedSelectExpr();
+  InterpreterOptions options;
+  auto unoptimized_builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK_AND_ASSIGN(auto unoptimized,
+                       unoptimized_builder->CreateExpression(&checked_expr));
+  options.enable_select_optimization = true;
+  auto builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK_AND_ASSIGN(auto optimized,
+                       builder->CreateExpression(&checked_expr));
+
+  EXPECT_THAT(LegacyPlanSize(*optimized), Lt(LegacyPlanSize(*unoptimized)));
+
+  Arena arena;
+  NestedTestAllTypes msg;
+  msg.mutable_child()->mutable_payload()->set_single_int64(42);
+  Activation activation;
+  activation.InsertValue("msg", CelProtoWrapper::CreateMessage(&msg, &arena));
+  ASSERT_OK_AND_ASSIGN(CelValue result,
+                       optimized->Evaluate(activation, &arena));
+  ASSERT_TRUE(result.IsInt64());
+  EXPECT_EQ(result.Int64OrDie(), 42);
+}
+
+// Provides the generated message types to a cel::Runtime.
+class GeneratedMessageTypeProvider : public TypeProvider {
+ public:
+  GeneratedMessageTypeProvider()
+      : provider_(google::protobuf::DescriptorPool::generated_pool(),
+                  google::protobuf::MessageFactory::generated_factory()) {}
+
+  absl::StatusOr<absl::optional<Handle<Type>>> ProvideType(
+      TypeFactory& factory, absl::string_view name) const override {
+    absl::optional<const LegacyTypeInfoApis*> type_info =
+        provider_.ProvideLegacyTypeInfo(name);
+    if (!type_info.has_value() || *type_info == nullptr) {
+      return absl::nullopt;
+    }
+    return factory
+        .CreateStructType<interop_internal::LegacyAbstractStructType>(
+            **type_info);
+  }
+
+ private:
+  ProtobufDescriptorProvider provider_;
+};
+
+absl::StatusOr<size_t> RuntimePlanSize(bool enable_select_optimization) {
+  CEL_ASSIGN_OR_RETURN(RuntimeBuilder builder,
+                       CreateStandardRuntimeBuilder(RuntimeOptions()));
+  builder.type_registry().AddTypeProvider(
+      std::make_unique<GeneratedMessageTypeProvider>());
+  if (enable_select_optimization) {
+    auto& runtime_impl = down_cast<RuntimeImpl&>(
+        RuntimeFriendAccess::GetMutableRuntime(builder));
+    runtime_impl.expr_builder().AddAstTransform(
+        std::make_unique<SelectOptimizationAstUpdater>());
+    runtime_impl.expr_builder().AddProgramOptimizer(
+        CreateSelectOptimizationProgramOptimizer());
+  }
+  CEL_ASSIGN_OR_RETURN(auto runtime, std::move(builder).Build());
+
+  CostEstimate estimate;
+  Runtime::CreateProgramOptions options;
+  options.cost_estimate = &estimate;
+  CEL_RETURN_IF_ERROR(ProtobufRuntimeAdapter::CreateProgram(
+                          *runtime, ParseCheckedSelectExpr(), options)
+                          .status());
+  return estimate.plan_size;
+}
+
+TEST(SelectOptimizationTest, CheckedExprThroughRuntimeAdapter) {
+  ASSERT_OK_AND_ASSIGN(size_t unoptimized, RuntimePlanSize(false));
+  ASSERT_OK_AND_ASSIGN(size_t optimized, RuntimePlanSize(true));
+
+  EXPECT_THAT(optimized, Lt(unoptimized));
+}
+
+}  // namespace
+}  // namespace cel::extensions
@@ -14,8 +14,12 @@
 
 #include "extensions/sets_functions.h"
 
+#include <cstddef>
+#include <utility>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/optional.h"
 #include "base/function_adapter.h"
 #include "base/handle.h"
 #include "base/value_factory.h"
@@ -24,27 +28,75 @@
 #include "base/values/string_value.h"
 #include "internal/status_macros.h"
 #include "runtime/function_registry.h"
+#include "runtime/internal/indexed_list_value.h"
 #include "runtime/runtime_options.h"
 
 namespace cel::extensions {
 
 namespace {
 
+using ::cel::runtime_internal::IndexedListValue;
+using ::cel::runtime_internal::ListValueIndex;
+
+// Lists are hashed instead of scanned for each element of the other list if
+// both have at least this many elements.
+constexpr size_t kMinHashedSize = 16;
+
+// Membership test over a list, using an index when the list is already
+// indexed or is probed often enough to be worth indexing.
+class ListMembership {
+ public:
+  static absl::StatusOr<ListMembership> Create(ValueFactory& value_factory,
+                                               const ListValue& list,
+                                               size_t probes) {
+    ListMembership membership(list);
+    if (list.Is<IndexedListValue>()) {
+      membership.index_ = &list.As<IndexedListValue>().index();
+    } else if (list.Size() >= kMinHashedSize && probes >= kMinHashedSize) {
+      CEL_ASSIGN_OR_RETURN(membership.owned_index_,
+                           ListValueIndex::Build(value_factory, list));
+    }
+    return membership;
+  }
+
+  absl::StatusOr<bool> Contains(ValueFactory& value_factory,
+                                const Handle<Value>& value) const {
+    // ListValue::Contains uses heterogeneous equality.
+    if (index_ != nullptr) {
+      return index_->Contains(*value, /*heterogeneous=*/true);
+    }
+    if (owned_index_.has_value()) {
+      return owned_index_->Contains(*value, /*heterogeneous=*/true);
+    }
+    CEL_ASSIGN_OR_RETURN(auto contains, list_.Contains(value_factory, value));
+    // Treat CEL error as missing
+    return contains->Is<BoolValue>() && contains->As<BoolValue>().NativeValue();
+  }
+
+ private:
+  explicit ListMembership(const ListValue& list) : list_(list) {}
+
+  const ListValue& list_;
+  const ListValueIndex* index_ = nullptr;
+  absl::optional<ListValueIndex> owned_index_;
+};
+
 absl::StatusOr<Handle<Value>> SetsContains(ValueFactory& value_factory,
                                            const ListValue& list,
                                            const ListValue& sublist) {
+  CEL_ASSIGN_OR_RETURN(
+      auto membership,
+      ListMembership::Create(value_factory, list, sublist.Size()));
   CEL_ASSIGN_OR_RETURN(
       bool any_missing,
       sublist.AnyOf(
           value_factory,
-          [&list, &value_factory](
+          [&membership, &value_factory](
               const Handle<Value>& sublist_element) -> absl::StatusOr<bool> {
-            CEL_ASSIGN_OR_RETURN(auto contains,
-                                 list.Contains(value_factory, sublist_element));
-
-            // Treat CEL error as missing
-            return !contains->Is<BoolValue>() ||
-                   !contains->As<BoolValue>().NativeValue();
+            CEL_ASSIGN_OR_RETURN(
+                bool contains,
+                membership.Contains(value_factory, sublist_element));
+            return !contains;
           }));
   return value_factory.CreateBoolValue(!any_missing);
 }
@@ -52,18 +104,24 @@ absl::StatusOr<Handle<Value>> SetsContains(ValueFactory& value_factory,
 absl::StatusOr<Handle<Value>> SetsIntersects(ValueFactory& value_factory,
                                              const ListValue& list,
                                              const ListValue& sublist) {
+  // Intersection is symmetric, so probe the indexed list if there is one.
+  const ListValue* probed = &sublist;
+  const ListValue* scanned = &list;
+  if (list.Is<IndexedListValue>() && !sublist.Is<IndexedListValue>()) {
+    std::swap(probed, scanned);
+  }
+  CEL_ASSIGN_OR_RETURN(
+      auto membership,
+      ListMembership::Create(value_factory, *probed, scanned->Size()));
   CEL_ASSIGN_OR_RETURN(
       bool exists,
-      list.AnyOf(
+      scanned->AnyOf(
           value_factory,
-          [&value_factory, &sublist](
-              const Handle<Value>& list_element) -> absl::StatusOr<bool> {
-            CEL_ASSIGN_OR_RETURN(auto contains,
-                                 sublist.Contains(value_factory, list_element));
+          [&value_factory, &membership](
+              const Handle<Value>& element) -> absl::StatusOr<bool> {
             // Treat contains return CEL error as false for the sake of
             // intersecting.
-            return contains->Is<BoolValue>() &&
-                   contains->As<BoolValue>().NativeValue();
+            return membership.Contains(value_factory, element);
           }));
 
   return value_factory.CreateBoolValue(exists);
@@ -81,6 +139,27 @@ absl::StatusOr<Handle<Value>> SetsEquivalent(ValueFactory& value_factory,
   return SetsContains(value_factory, sublist, list);
 }
 
+// Returns list with a hash index over its elements, so that the result can
+// be probed by `in` and the other sets functions without scanning it. The
+// elements, their order and the size of the list are unchanged. Lists which
+// are small or hold elements that cannot be indexed are returned as is.
+absl::StatusOr<Handle<Value>> SetsOf(ValueFactory& value_factory,
+                                     const Handle<ListValue>& list) {
+  if (list->Is<IndexedListValue>()) {
+    return list;
+  }
+  return IndexedListValue::Create(value_factory, list);
+}
+
+absl::Status RegisterSetsOfFunction(FunctionRegistry& registry) {
+  return registry.Register(
+      UnaryFunctionAdapter<absl::StatusOr<Handle<Value>>,
+                           const Handle<ListValue>&>::
+          CreateDescriptor("sets.of", /*receiver_style=*/false),
+      UnaryFunctionAdapter<absl::StatusOr<Handle<Value>>,
+                           const Handle<ListValue>&>::WrapFunction(SetsOf));
+}
+
 absl::Status RegisterSetsContainsFunction(FunctionRegistry& registry) {
   return registry.Register(
       BinaryFunctionAdapter<
@@ -118,6 +197,7 @@ absl::Status RegisterSetsFunctions(FunctionRegistry& registry,
   CEL_RETURN_IF_ERROR(RegisterSetsContainsFunction(registry));
   CEL_RETURN_IF_ERROR(RegisterSetsIntersectsFunction(registry));
   CEL_RETURN_IF_ERROR(RegisterSetsEquivalentFunction(registry));
+  CEL_RETURN_IF_ERROR(RegisterSetsOfFunction(registry));
   return absl::OkStatus();
 }
 
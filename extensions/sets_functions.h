@@ -21,7 +21,9 @@
 
 namespace cel::extensions {
 
-// Register set functions.
+// Register set functions: sets.contains, sets.intersects, sets.equivalent
+// and sets.of, which returns its list argument indexed for repeated
+// membership tests.
 absl::Status RegisterSetsFunctions(FunctionRegistry& registry,
                                    const RuntimeOptions& options);
 
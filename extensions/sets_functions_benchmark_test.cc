@@ -339,7 +339,7 @@ template <typename Benchmark>
 void BenchArgs(Benchmark* bench) {
   for (ListImpl impl :
        {ListImpl::kLegacy, ListImpl::kWrappedModern, ListImpl::kRhsConstant}) {
-    for (int size : {1, 8, 32, 64, 256}) {
+    for (int size : {1, 8, 32, 64, 256, 1024, 4096}) {
       bench->ArgPair(ToNumber(impl), size);
     }
   }
@@ -159,6 +159,49 @@ INSTANTIATE_TEST_SUITE_P(
 
         {"sets.equivalent([{'foo': true, 'bar': false}], [{'bar': false, "
          "'foo': true}])"},
+
+        // Lists long enough to be hashed.
+        {"sets.contains([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15], [15u, 14.0, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0])"},
+        {"!sets.contains([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15], [15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0.5])"},
+        {"sets.contains([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, i * 100000), [0, 100000u, 200000.0, 300000, 400000, "
+         "500000, 600000, 700000, 800000, 900000, 1000000, 1100000, 1200000, "
+         "1300000, 1400000, 1500000])"},
+        {"sets.contains([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, string(i)), ['0', '1', '2', '3', '4', '5', '6', '7', "
+         "'8', '9', '10', '11', '12', '13', '14', '15'])"},
+        {"!sets.contains([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, i - 8), [-8, -7, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, "
+         "5, 6, 8u])"},
+        {"sets.intersects([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, i * 2), [1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, "
+         "27, 29, 30u])"},
+        {"!sets.intersects([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, i * 2), [1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, "
+         "27, 29, 31])"},
+        {"sets.equivalent([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15].map(i, double(i)), [15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, "
+         "3, 2, 1, 0])"},
+        {"sets.equivalent([0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, "
+         "15, [1]].map(i, i), [[1], 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, "
+         "3, 2, 1, 0])"},
+
+        // sets.of indexes a list without changing its value.
+        {"sets.of([1, 1, 2]) == [1, 1, 2]"},
+        {"sets.of([[1], 2, 3, 4, 5, 6, 7, 8]) == [[1], 2, 3, 4, 5, 6, 7, 8]"},
+        {"size(sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, 9].map(i, i % 5))) == 10"},
+        {"sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, 9].map(i, i * 3))[4] == 12"},
+        {"[3u, 6.0, 27].all(x, x in sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, "
+         "9].map(i, i * 3)))"},
+        {"!(28 in sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, 9].map(i, i * 3)))"},
+        {"sets.contains(sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, 9].map(i, "
+         "string(i))), ['9', '0'])"},
+        {"sets.intersects([10, 20u, 9.0], sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, "
+         "9].map(i, i)))"},
+        {"sets.equivalent(sets.of([0, 1, 2, 3, 4, 5, 6, 7, 8, 9].map(i, i)), "
+         "sets.of([9, 8, 7, 6, 5, 4, 3, 2, 1, 0].map(i, i)))"},
     }));
 
 }  // namespace
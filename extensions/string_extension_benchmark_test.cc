@@ -0,0 +1,122 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks for the split and join functions of the strings extension (see
+// eval/public/string_extension_func_registrar.h).
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expr_builder_factory.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_list_impl.h"
+#include "eval/public/string_extension_func_registrar.h"
+#include "internal/benchmark.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "google/protobuf/arena.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::runtime::Activation;
+using ::google::api::expr::runtime::CelValue;
+using ::google::api::expr::runtime::ContainerBackedListImpl;
+using ::google::api::expr::runtime::CreateCelExpressionBuilder;
+using ::google::api::expr::runtime::InterpreterOptions;
+using ::google::api::expr::runtime::RegisterBuiltinFunctions;
+using ::google::api::expr::runtime::RegisterStringExtensionFunctions;
+
+// Evaluates `expr` with `s` bound to `size` comma separated words and `l` to
+// the list of those words. The result must be a list of `expected_size`
+// elements or a string of `expected_size` bytes.
+void RunBenchmark(const std::string& expr, int size, int expected_size,
+                  benchmark::State& state) {
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr, Parse(expr));
+
+  InterpreterOptions options;
+  auto builder = CreateCelExpressionBuilder(options);
+  ASSERT_OK(RegisterBuiltinFunctions(builder->GetRegistry(), options));
+  ASSERT_OK(RegisterStringExtensionFunctions(builder->GetRegistry(), options));
+  ASSERT_OK_AND_ASSIGN(
+      auto cel_expr, builder->CreateExpression(&(parsed_expr.expr()), nullptr));
+
+  std::vector<std::string> words;
+  words.reserve(size);
+  for (int i = 0; i < size; i++) {
+    words.push_back(absl::StrCat("word", i % 10));
+  }
+  std::string joined = absl::StrJoin(words, ",");
+  std::vector<CelValue> elements;
+  elements.reserve(size);
+  for (const std::string& word : words) {
+    elements.push_back(CelValue::CreateString(&word));
+  }
+  ContainerBackedListImpl list(std::move(elements));
+
+  Activation activation;
+  activation.InsertValue("s", CelValue::CreateString(&joined));
+  activation.InsertValue("l", CelValue::CreateList(&list));
+
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    if (result.IsList()) {
+      ASSERT_EQ(result.ListOrDie()->size(), expected_size) << expr;
+    } else {
+      ASSERT_TRUE(result.IsString()) << expr;
+      ASSERT_EQ(result.StringOrDie().value().size(), expected_size) << expr;
+    }
+  }
+}
+
+void BM_Split(benchmark::State& state) {
+  int size = state.range(0);
+  RunBenchmark("s.split(',')", size, size, state);
+}
+
+void BM_SplitWithLimit(benchmark::State& state) {
+  int size = state.range(0);
+  RunBenchmark("s.split(',', 4)", size, size < 4 ? size : 4, state);
+}
+
+void BM_Join(benchmark::State& state) {
+  int size = state.range(0);
+  // Each word has 5 bytes.
+  RunBenchmark("l.join(',')", size, size * 6 - 1, state);
+}
+
+void BM_SplitJoin(benchmark::State& state) {
+  int size = state.range(0);
+  RunBenchmark("s.split(',').join(', ')", size, size * 7 - 2, state);
+}
+
+BENCHMARK(BM_Split)->Range(1, 4096);
+BENCHMARK(BM_SplitWithLimit)->Range(1, 4096);
+BENCHMARK(BM_Join)->Range(1, 4096);
+BENCHMARK(BM_SplitJoin)->Range(1, 4096);
+
+}  // namespace
+}  // namespace cel::extensions
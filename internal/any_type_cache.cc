@@ -0,0 +1,104 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/any_type_cache.h"
+
+#include <cstddef>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/no_destructor.h"
+#include "internal/status_macros.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+namespace cel::internal {
+
+namespace {
+
+using ::google::protobuf::Descriptor;
+using ::google::protobuf::DescriptorPool;
+using ::google::protobuf::Message;
+using ::google::protobuf::MessageFactory;
+
+// Returns the full name of the message type in type_url.
+absl::StatusOr<absl::string_view> TypeNameOf(absl::string_view type_url) {
+  auto pos = type_url.find_last_of('/');
+  if (pos == absl::string_view::npos) {
+    return absl::InvalidArgumentError("Malformed type_url string");
+  }
+  return type_url.substr(pos + 1);
+}
+
+absl::StatusOr<AnyTypeCache::Entry> ResolveName(const DescriptorPool* pool,
+                                                MessageFactory* factory,
+                                                absl::string_view type_name) {
+  const Descriptor* descriptor = pool->FindMessageTypeByName(type_name);
+  if (descriptor == nullptr) {
+    return absl::NotFoundError("Descriptor not found");
+  }
+  const Message* prototype = nullptr;
+  if (factory != nullptr) {
+    prototype = factory->GetPrototype(descriptor);
+    if (prototype == nullptr) {
+      return absl::NotFoundError("Prototype not found");
+    }
+  }
+  return AnyTypeCache::Entry{descriptor, prototype};
+}
+
+}  // namespace
+
+AnyTypeCache& AnyTypeCache::Generated() {
+  static NoDestructor<AnyTypeCache> cache(
+      DescriptorPool::generated_pool(), MessageFactory::generated_factory());
+  return *cache;
+}
+
+absl::StatusOr<AnyTypeCache::Entry> AnyTypeCache::Resolve(
+    const DescriptorPool* pool, MessageFactory* factory,
+    absl::string_view type_url) {
+  if (pool == DescriptorPool::generated_pool() &&
+      (factory == nullptr || factory == MessageFactory::generated_factory())) {
+    return Generated().Find(type_url);
+  }
+  CEL_ASSIGN_OR_RETURN(absl::string_view type_name, TypeNameOf(type_url));
+  return ResolveName(pool, factory, type_name);
+}
+
+absl::StatusOr<AnyTypeCache::Entry> AnyTypeCache::Find(
+    absl::string_view type_url) const {
+  CEL_ASSIGN_OR_RETURN(absl::string_view type_name, TypeNameOf(type_url));
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (auto it = entries_.find(type_name); it != entries_.end()) {
+      return it->second;
+    }
+  }
+  CEL_ASSIGN_OR_RETURN(auto entry, ResolveName(pool_, factory_, type_name));
+  absl::MutexLock lock(&mutex_);
+  // Keyed by the resolved descriptor's name rather than the caller provided
+  // text, so that entries are bounded by the message types of the pool.
+  return entries_.try_emplace(entry.descriptor->full_name(), entry)
+      .first->second;
+}
+
+size_t AnyTypeCache::size() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+}  // namespace cel::internal
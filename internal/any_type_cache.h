@@ -0,0 +1,88 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_INTERNAL_ANY_TYPE_CACHE_H_
+#define THIRD_PARTY_CEL_CPP_INTERNAL_ANY_TYPE_CACHE_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+namespace cel::internal {
+
+// Resolves the type urls of `google.protobuf.Any` messages to the descriptor
+// and prototype of the packed message. Resolutions are cached by message type
+// name, so unpacking the same type repeatedly skips the descriptor pool and
+// message factory lookups, each of which takes a lock and hashes the type
+// name.
+//
+// Lookups of cached types only take a shared lock. Only successful
+// resolutions are cached, under the full name of the resolved descriptor, so
+// the cache holds at most one entry per message type of the pool however many
+// distinct type urls, e.g. with arbitrary prefixes, are looked up.
+class AnyTypeCache final {
+ public:
+  struct Entry final {
+    absl::Nonnull<const google::protobuf::Descriptor*> descriptor;
+    // Null if the cache has no message factory.
+    absl::Nullable<const google::protobuf::Message*> prototype;
+  };
+
+  // Returns the process-wide cache over the generated descriptor pool and
+  // message factory.
+  static AnyTypeCache& Generated();
+
+  // Resolves `type_url` against `pool` and `factory`, through the generated
+  // cache when they are the generated ones. Other pools are resolved
+  // directly, as their lifetime is unknown. `factory` may be null when only
+  // the descriptor is needed.
+  static absl::StatusOr<Entry> Resolve(
+      absl::Nonnull<const google::protobuf::DescriptorPool*> pool,
+      absl::Nullable<google::protobuf::MessageFactory*> factory,
+      absl::string_view type_url);
+
+  // `pool` and `factory` must outlive the cache.
+  AnyTypeCache(absl::Nonnull<const google::protobuf::DescriptorPool*> pool,
+               absl::Nullable<google::protobuf::MessageFactory*> factory)
+      : pool_(pool), factory_(factory) {}
+
+  AnyTypeCache(const AnyTypeCache&) = delete;
+  AnyTypeCache& operator=(const AnyTypeCache&) = delete;
+
+  absl::StatusOr<Entry> Find(absl::string_view type_url) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of cached message types.
+  size_t size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  const google::protobuf::DescriptorPool* const pool_;
+  google::protobuf::MessageFactory* const factory_;
+  mutable absl::Mutex mutex_;
+  // By descriptor full name.
+  mutable absl::flat_hash_map<std::string, Entry> entries_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel::internal
+
+#endif  // THIRD_PARTY_CEL_CPP_INTERNAL_ANY_TYPE_CACHE_H_
@@ -0,0 +1,90 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/any_type_cache.h"
+
+#include "google/protobuf/duration.pb.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "internal/testing.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/message.h"
+
+namespace cel::internal {
+namespace {
+
+using testing::Eq;
+using testing::IsNull;
+
+constexpr absl::string_view kDurationUrl =
+    "type.googleapis.com/google.protobuf.Duration";
+
+TEST(AnyTypeCache, Generated) {
+  ASSERT_OK_AND_ASSIGN(auto entry,
+                       AnyTypeCache::Generated().Find(kDurationUrl));
+  EXPECT_THAT(entry.descriptor, Eq(google::protobuf::Duration::descriptor()));
+  EXPECT_THAT(entry.prototype,
+              Eq(&google::protobuf::Duration::default_instance()));
+
+  // Cached entries are returned on subsequent lookups.
+  ASSERT_OK_AND_ASSIGN(auto cached,
+                       AnyTypeCache::Generated().Find(kDurationUrl));
+  EXPECT_THAT(cached.descriptor, Eq(entry.descriptor));
+  EXPECT_THAT(cached.prototype, Eq(entry.prototype));
+}
+
+TEST(AnyTypeCache, OneEntryPerType) {
+  AnyTypeCache cache(google::protobuf::DescriptorPool::generated_pool(),
+                     google::protobuf::MessageFactory::generated_factory());
+  ASSERT_OK_AND_ASSIGN(auto entry, cache.Find(kDurationUrl));
+  ASSERT_OK_AND_ASSIGN(auto other_prefix,
+                       cache.Find("example.com/a/b/google.protobuf.Duration"));
+  EXPECT_THAT(other_prefix.descriptor, Eq(entry.descriptor));
+  EXPECT_THAT(cache.size(), Eq(1));
+
+  // Failed resolutions are not cached.
+  EXPECT_THAT(cache.Find("example.com/no.such.Message"),
+              StatusIs(absl::StatusCode::kNotFound));
+  EXPECT_THAT(cache.size(), Eq(1));
+}
+
+TEST(AnyTypeCache, Errors) {
+  EXPECT_THAT(AnyTypeCache::Generated().Find("google.protobuf.Duration"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      AnyTypeCache::Generated().Find("type.googleapis.com/no.such.Message"),
+      StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(AnyTypeCache, ResolveOtherPool) {
+  google::protobuf::DescriptorPool pool;
+  google::protobuf::FileDescriptorProto file;
+  google::protobuf::Duration::descriptor()->file()->CopyTo(&file);
+  ASSERT_TRUE(pool.BuildFile(file) != nullptr);
+  google::protobuf::DynamicMessageFactory factory(&pool);
+
+  ASSERT_OK_AND_ASSIGN(auto entry,
+                       AnyTypeCache::Resolve(&pool, &factory, kDurationUrl));
+  EXPECT_THAT(entry.descriptor->file()->pool(), Eq(&pool));
+  EXPECT_THAT(entry.prototype->GetDescriptor(), Eq(entry.descriptor));
+
+  ASSERT_OK_AND_ASSIGN(entry,
+                       AnyTypeCache::Resolve(&pool, nullptr, kDurationUrl));
+  EXPECT_THAT(entry.prototype, IsNull());
+}
+
+}  // namespace
+}  // namespace cel::internal
@@ -18,6 +18,7 @@
 #include <cmath>
 #include <cstdint>
 #include <limits>
+#include <type_traits>
 
 #include "absl/types/variant.h"
 
@@ -182,6 +183,21 @@ struct CompareVisitor {
   NumberVariant rhs;
 };
 
+// Compares two numbers whose types are known statically, with the same
+// semantics as comparing them as Number but without constructing and
+// visiting the variants.
+template <typename T, typename U>
+constexpr ComparisonResult CompareNumeric(T a, U b) {
+  if constexpr (std::is_same_v<T, double>) {
+    return DoubleCompareVisitor(a)(b);
+  } else if constexpr (std::is_same_v<T, uint64_t>) {
+    return UintCompareVisitor(a)(b);
+  } else {
+    static_assert(std::is_same_v<T, int64_t>);
+    return IntCompareVisitor(a)(b);
+  }
+}
+
 struct LosslessConvertibleToIntVisitor {
   constexpr bool operator()(double value) const {
     return value >= kDoubleToIntMin && value <= kMaxDoubleRepresentableAsInt &&
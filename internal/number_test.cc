@@ -63,5 +63,19 @@ TEST(Number, Conversions) {
   EXPECT_EQ(Number::FromDouble(1.0).AsInt(), 1);
 }
 
+TEST(CompareNumeric, Basic) {
+  EXPECT_EQ(CompareNumeric(1.1, int64_t{1}), ComparisonResult::kGreater);
+  EXPECT_EQ(CompareNumeric(uint64_t{1}, 1.1), ComparisonResult::kLesser);
+  EXPECT_EQ(CompareNumeric(int64_t{1}, uint64_t{1}), ComparisonResult::kEqual);
+  EXPECT_EQ(CompareNumeric(uint64_t{1}, int64_t{-1}),
+            ComparisonResult::kGreater);
+  EXPECT_EQ(CompareNumeric(int64_t{-1}, uint64_t{1}),
+            ComparisonResult::kLesser);
+  EXPECT_EQ(CompareNumeric(kInfinity, kUint64Max), ComparisonResult::kGreater);
+  EXPECT_EQ(CompareNumeric(kInt64Min, -kInfinity), ComparisonResult::kGreater);
+  EXPECT_EQ(CompareNumeric(kNan, int64_t{1}), ComparisonResult::kNanInequal);
+  EXPECT_EQ(CompareNumeric(uint64_t{1}, kNan), ComparisonResult::kNanInequal);
+}
+
 }  // namespace
 }  // namespace cel::internal
@@ -299,6 +299,91 @@ absl::StatusOr<absl::Duration> CheckedSub(absl::Time t1, absl::Time t2) {
   return absl::Nanoseconds(v);
 }
 
+bool TryAdd(absl::Duration x, absl::Duration y, absl::Duration* result) {
+  int64_t nanos;
+  if (!IsFinite(x) || !IsFinite(y) ||
+      !TryAdd(absl::ToInt64Nanoseconds(x), absl::ToInt64Nanoseconds(y),
+              &nanos)) {
+    return false;
+  }
+  *result = absl::Nanoseconds(nanos);
+  return true;
+}
+
+bool TrySub(absl::Duration x, absl::Duration y, absl::Duration* result) {
+  int64_t nanos;
+  if (!IsFinite(x) || !IsFinite(y) ||
+      !TrySub(absl::ToInt64Nanoseconds(x), absl::ToInt64Nanoseconds(y),
+              &nanos)) {
+    return false;
+  }
+  *result = absl::Nanoseconds(nanos);
+  return true;
+}
+
+// Mirrors CheckedAdd(absl::Time, absl::Duration) step by step.
+bool TryAdd(absl::Time t, absl::Duration d, absl::Time* result) {
+  if (!IsFinite(t) || !IsFinite(d)) {
+    return false;
+  }
+  const int64_t s1 = absl::ToUnixSeconds(t);
+  const int64_t ns1 = (t - absl::FromUnixSeconds(s1)) / absl::Nanoseconds(1);
+  const int64_t s2 = d / kOneSecondDuration;
+  const int64_t ns2 = absl::ToInt64Nanoseconds(d % kOneSecondDuration);
+
+  int64_t s;
+  if (!TryAdd(s1, s2, &s)) {
+    return false;
+  }
+  absl::Duration ns = absl::Nanoseconds(ns2 + ns1);
+  if (ns < absl::ZeroDuration() || ns >= kOneSecondDuration) {
+    if (!TryAdd(s, ns / kOneSecondDuration, &s)) {
+      return false;
+    }
+    ns -= (ns / kOneSecondDuration) * kOneSecondDuration;
+    if (ns < absl::ZeroDuration()) {
+      if (!TryAdd(s, int64_t{-1}, &s)) {
+        return false;
+      }
+      ns += kOneSecondDuration;
+    }
+  }
+  if (s < kMinUnixTime || s > kMaxUnixTime) {
+    return false;
+  }
+  *result = absl::FromUnixSeconds(s) + ns;
+  return true;
+}
+
+bool TrySub(absl::Time t, absl::Duration d, absl::Time* result) {
+  int64_t nanos;
+  if (!IsFinite(d) || !TryNegation(absl::ToInt64Nanoseconds(d), &nanos)) {
+    return false;
+  }
+  return TryAdd(t, absl::Nanoseconds(nanos), result);
+}
+
+// Mirrors CheckedSub(absl::Time, absl::Time) step by step.
+bool TrySub(absl::Time t1, absl::Time t2, absl::Duration* result) {
+  if (!IsFinite(t1) || !IsFinite(t2)) {
+    return false;
+  }
+  const int64_t s1 = absl::ToUnixSeconds(t1);
+  const int64_t ns1 = (t1 - absl::FromUnixSeconds(s1)) / absl::Nanoseconds(1);
+  const int64_t s2 = absl::ToUnixSeconds(t2);
+  const int64_t ns2 = (t2 - absl::FromUnixSeconds(s2)) / absl::Nanoseconds(1);
+
+  int64_t s;
+  int64_t scaled;
+  int64_t nanos;
+  if (!TrySub(s1, s2, &s) || !TryMul(s, kOneSecondNanos, &scaled) ||
+      !TryAdd(scaled, ns1 - ns2, &nanos)) {
+    return false;
+  }
+  *result = absl::Nanoseconds(nanos);
+  return true;
+}
+
 absl::StatusOr<int64_t> CheckedDoubleToInt64(double v) {
   CEL_RETURN_IF_ERROR(
       CheckRange(std::isfinite(v) && v < kDoubleToIntMax && v > kDoubleToIntMin,
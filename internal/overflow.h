@@ -17,6 +17,7 @@
 
 #include <cstdint>
 
+#include "absl/base/config.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 
@@ -75,6 +76,81 @@ absl::StatusOr<uint64_t> CheckedDiv(uint64_t x, uint64_t y);
 // absl::StatusCode::kInvalidArgumentError, e.g. 1 / 0.
 absl::StatusOr<uint64_t> CheckedMod(uint64_t x, uint64_t y);
 
+namespace overflow_internal {
+
+template <typename T>
+bool StoreChecked(absl::StatusOr<T> checked, T* result) {
+  if (!checked.ok()) {
+    return false;
+  }
+  *result = *checked;
+  return true;
+}
+
+}  // namespace overflow_internal
+
+// Counterparts of CheckedAdd, CheckedSub, CheckedMul and CheckedNegation which
+// report overflow with their return value, for evaluation paths where building
+// an absl::StatusOr on success costs more than the arithmetic itself. Each
+// stores the result in `*result` and returns true, or returns false on
+// overflow, leaving `*result` unspecified. Callers that need the error call
+// the Checked* function, only once overflow is detected.
+inline bool TryAdd(int64_t x, int64_t y, int64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_add_overflow)
+  return !__builtin_add_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedAdd(x, y), result);
+#endif
+}
+
+inline bool TrySub(int64_t x, int64_t y, int64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_sub_overflow)
+  return !__builtin_sub_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedSub(x, y), result);
+#endif
+}
+
+inline bool TryMul(int64_t x, int64_t y, int64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_mul_overflow)
+  return !__builtin_mul_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedMul(x, y), result);
+#endif
+}
+
+inline bool TryNegation(int64_t v, int64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_sub_overflow)
+  return !__builtin_sub_overflow(int64_t{0}, v, result);
+#else
+  return overflow_internal::StoreChecked(CheckedNegation(v), result);
+#endif
+}
+
+inline bool TryAdd(uint64_t x, uint64_t y, uint64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_add_overflow)
+  return !__builtin_add_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedAdd(x, y), result);
+#endif
+}
+
+inline bool TrySub(uint64_t x, uint64_t y, uint64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_sub_overflow)
+  return !__builtin_sub_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedSub(x, y), result);
+#endif
+}
+
+inline bool TryMul(uint64_t x, uint64_t y, uint64_t* result) {
+#if ABSL_HAVE_BUILTIN(__builtin_mul_overflow)
+  return !__builtin_mul_overflow(x, y, result);
+#else
+  return overflow_internal::StoreChecked(CheckedMul(x, y), result);
+#endif
+}
+
 // Add two durations together.
 // If overflow is detected, return an absl::StatusCode::kOutOfRangeError, e.g.
 //   duration(int64_t_max, "ns") + duration(int64_t_max, "ns")
@@ -119,6 +195,15 @@ absl::StatusOr<absl::Time> CheckedSub(absl::Time t, absl::Duration d);
 //   timestamp(unix_epoch_min) - timestamp(unix_epoch_max)
 absl::StatusOr<absl::Duration> CheckedSub(absl::Time t1, absl::Time t2);
 
+// Counterparts of the duration and timestamp Checked* functions above which
+// report overflow with their return value, as TryAdd and TrySub do for
+// integers.
+bool TryAdd(absl::Duration x, absl::Duration y, absl::Duration* result);
+bool TrySub(absl::Duration x, absl::Duration y, absl::Duration* result);
+bool TryAdd(absl::Time t, absl::Duration d, absl::Time* result);
+bool TrySub(absl::Time t, absl::Duration d, absl::Time* result);
+bool TrySub(absl::Time t1, absl::Time t2, absl::Duration* result);
+
 // Convert a double value to an int64_t if possible.
 // If the double exceeds the values representable in an int64_t the function
 // will return an absl::StatusCode::kOutOfRangeError.
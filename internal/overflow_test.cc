@@ -627,5 +627,110 @@ INSTANTIATE_TEST_SUITE_P(
     [](const testing::TestParamInfo<CheckedConvertUint64Uint32Test::ParamType>&
            info) { return info.param.test_name; });
 
+// Expects a flag returning variant to agree with its Checked* counterpart.
+template <typename T>
+void ExpectSameResult(bool ok, T result, const absl::StatusOr<T>& checked) {
+  ASSERT_EQ(ok, checked.ok());
+  if (ok) {
+    EXPECT_EQ(result, *checked);
+  }
+}
+
+template <typename T>
+void ExpectTryMatchesChecked(const std::vector<T>& values) {
+  for (T x : values) {
+    for (T y : values) {
+      SCOPED_TRACE(testing::Message() << x << ", " << y);
+      T result;
+      bool ok = TryAdd(x, y, &result);
+      ExpectSameResult(ok, result, CheckedAdd(x, y));
+      ok = TrySub(x, y, &result);
+      ExpectSameResult(ok, result, CheckedSub(x, y));
+      ok = TryMul(x, y, &result);
+      ExpectSameResult(ok, result, CheckedMul(x, y));
+    }
+  }
+}
+
+TEST(TryArithmetic, IntMatchesChecked) {
+  constexpr int64_t kMin = std::numeric_limits<int64_t>::lowest();
+  constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+  const std::vector<int64_t> values = {
+      kMin, kMin + 1, -3037000500, -2, -1, 0, 1, 2, 3037000500, kMax - 1, kMax};
+  ExpectTryMatchesChecked(values);
+  for (int64_t v : values) {
+    int64_t result;
+    bool ok = TryNegation(v, &result);
+    ExpectSameResult(ok, result, CheckedNegation(v));
+  }
+}
+
+TEST(TryArithmetic, UintMatchesChecked) {
+  constexpr uint64_t kMax = std::numeric_limits<uint64_t>::max();
+  ExpectTryMatchesChecked<uint64_t>(
+      {0, 1, 2, 4294967296, kMax / 2, kMax / 2 + 1, kMax - 1, kMax});
+}
+
+TEST(TryArithmetic, DurationMatchesChecked) {
+  const std::vector<absl::Duration> values = {
+      absl::InfiniteDuration(),
+      -absl::InfiniteDuration(),
+      absl::Nanoseconds(std::numeric_limits<int64_t>::lowest()),
+      absl::Nanoseconds(std::numeric_limits<int64_t>::max()),
+      absl::Hours(-24),
+      absl::Nanoseconds(-1),
+      absl::ZeroDuration(),
+      absl::Nanoseconds(1),
+      absl::Seconds(1) + absl::Nanoseconds(500000000),
+      absl::Hours(24)};
+  for (absl::Duration x : values) {
+    for (absl::Duration y : values) {
+      SCOPED_TRACE(testing::Message() << x << ", " << y);
+      absl::Duration result;
+      bool ok = TryAdd(x, y, &result);
+      ExpectSameResult(ok, result, CheckedAdd(x, y));
+      ok = TrySub(x, y, &result);
+      ExpectSameResult(ok, result, CheckedSub(x, y));
+    }
+  }
+}
+
+TEST(TryArithmetic, TimeMatchesChecked) {
+  const std::vector<absl::Time> times = {
+      absl::InfinitePast(),
+      absl::InfiniteFuture(),
+      absl::FromUnixSeconds(-62135596800),
+      absl::FromUnixSeconds(253402300799) + absl::Nanoseconds(999999999),
+      absl::UnixEpoch() - absl::Nanoseconds(1),
+      absl::UnixEpoch(),
+      absl::FromUnixSeconds(1700000000) + absl::Nanoseconds(750000000)};
+  const std::vector<absl::Duration> durations = {
+      absl::InfiniteDuration(),
+      absl::Nanoseconds(std::numeric_limits<int64_t>::lowest()),
+      absl::Nanoseconds(std::numeric_limits<int64_t>::max()),
+      absl::Hours(-24),
+      absl::Nanoseconds(-1),
+      absl::ZeroDuration(),
+      absl::Nanoseconds(1),
+      absl::Seconds(1) + absl::Nanoseconds(500000000),
+      absl::Hours(24)};
+  for (absl::Time t : times) {
+    for (absl::Duration d : durations) {
+      SCOPED_TRACE(testing::Message() << t << ", " << d);
+      absl::Time result;
+      bool ok = TryAdd(t, d, &result);
+      ExpectSameResult(ok, result, CheckedAdd(t, d));
+      ok = TrySub(t, d, &result);
+      ExpectSameResult(ok, result, CheckedSub(t, d));
+    }
+    for (absl::Time u : times) {
+      SCOPED_TRACE(testing::Message() << t << ", " << u);
+      absl::Duration result;
+      bool ok = TrySub(t, u, &result);
+      ExpectSameResult(ok, result, CheckedSub(t, u));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace cel::internal
@@ -0,0 +1,80 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/regex_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+
+RegexCache::RegexCache(size_t capacity, size_t shard_count)
+    : shard_capacity_((capacity + std::max<size_t>(shard_count, 1) - 1) /
+                      std::max<size_t>(shard_count, 1)),
+      shards_(std::max<size_t>(shard_count, 1)) {}
+
+RegexCache::Shard& RegexCache::ShardFor(absl::string_view pattern) {
+  return shards_[absl::HashOf(pattern) % shards_.size()];
+}
+
+std::shared_ptr<const RE2> RegexCache::Get(absl::string_view pattern) {
+  if (shard_capacity_ == 0) {
+    return std::make_shared<RE2>(pattern);
+  }
+  Shard& shard = ShardFor(pattern);
+  {
+    absl::MutexLock lock(&shard.mutex);
+    auto it = shard.index.find(pattern);
+    if (it != shard.index.end()) {
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return it->second->second;
+    }
+  }
+
+  auto program = std::make_shared<RE2>(pattern);
+
+  absl::MutexLock lock(&shard.mutex);
+  // Another evaluation may have compiled the same pattern meanwhile.
+  auto it = shard.index.find(pattern);
+  if (it != shard.index.end()) {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return it->second->second;
+  }
+  if (shard.lru.size() >= shard_capacity_) {
+    shard.index.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+  }
+  shard.lru.emplace_front(std::string(pattern), program);
+  shard.index.insert({shard.lru.front().first, shard.lru.begin()});
+  return program;
+}
+
+size_t RegexCache::size() const {
+  size_t size = 0;
+  for (const Shard& shard : shards_) {
+    absl::MutexLock lock(&shard.mutex);
+    size += shard.lru.size();
+  }
+  return size;
+}
+
+}  // namespace cel::internal
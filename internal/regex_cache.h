@@ -0,0 +1,78 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_CACHE_H_
+#define THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+
+// Bounded cache of compiled regular expressions, for patterns which are only
+// known during evaluation. Patterns are spread over independently locked
+// shards, each evicting its least recently used pattern when full, so
+// concurrent evaluations rarely contend.
+//
+// Patterns are compiled outside of the lock. Invalid patterns are cached as
+// well, so callers must check `RE2::ok()`.
+class RegexCache final {
+ public:
+  static constexpr size_t kDefaultShardCount = 16;
+
+  // `capacity` is the total number of patterns kept, rounded up to a
+  // multiple of `shard_count`. A capacity of zero disables caching.
+  explicit RegexCache(size_t capacity,
+                      size_t shard_count = kDefaultShardCount);
+
+  RegexCache(const RegexCache&) = delete;
+  RegexCache& operator=(const RegexCache&) = delete;
+
+  // Returns the compiled program for `pattern`, compiling it on a miss.
+  std::shared_ptr<const RE2> Get(absl::string_view pattern);
+
+  // Returns the number of patterns currently cached.
+  size_t size() const;
+
+ private:
+  struct Shard final {
+    using Entry = std::pair<std::string, std::shared_ptr<const RE2>>;
+
+    mutable absl::Mutex mutex;
+    // Most recently used first.
+    std::list<Entry> lru ABSL_GUARDED_BY(mutex);
+    // Keys view the strings in `lru`.
+    absl::flat_hash_map<absl::string_view, std::list<Entry>::iterator> index
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& ShardFor(absl::string_view pattern);
+
+  const size_t shard_capacity_;
+  std::vector<Shard> shards_;
+};
+
+}  // namespace cel::internal
+
+#endif  // THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_CACHE_H_
@@ -0,0 +1,75 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/regex_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "internal/testing.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+namespace {
+
+using testing::Eq;
+using testing::Ne;
+
+TEST(RegexCache, ReturnsCachedProgram) {
+  RegexCache cache(8);
+  std::shared_ptr<const RE2> program = cache.Get("a+b");
+  ASSERT_TRUE(program->ok());
+  EXPECT_TRUE(RE2::FullMatch("aab", *program));
+  EXPECT_THAT(cache.Get("a+b"), Eq(program));
+  EXPECT_THAT(cache.size(), Eq(1));
+}
+
+TEST(RegexCache, CachesInvalidPatterns) {
+  RegexCache cache(8);
+  std::shared_ptr<const RE2> program = cache.Get("(");
+  EXPECT_FALSE(program->ok());
+  EXPECT_THAT(cache.Get("("), Eq(program));
+}
+
+TEST(RegexCache, EvictsLeastRecentlyUsed) {
+  RegexCache cache(2, /*shard_count=*/1);
+  std::shared_ptr<const RE2> a = cache.Get("a");
+  std::shared_ptr<const RE2> b = cache.Get("b");
+  // Touch "a" so that "b" is evicted next.
+  EXPECT_THAT(cache.Get("a"), Eq(a));
+  cache.Get("c");
+  EXPECT_THAT(cache.size(), Eq(2));
+  EXPECT_THAT(cache.Get("a"), Eq(a));
+  EXPECT_THAT(cache.Get("b"), Ne(b));
+}
+
+TEST(RegexCache, BoundedAcrossShards) {
+  RegexCache cache(16, /*shard_count=*/4);
+  for (int i = 0; i < 100; ++i) {
+    cache.Get(absl::StrCat("x", i));
+  }
+  EXPECT_LE(cache.size(), 16);
+}
+
+TEST(RegexCache, ZeroCapacityDisablesCaching) {
+  RegexCache cache(0);
+  std::shared_ptr<const RE2> program = cache.Get("a");
+  EXPECT_TRUE(program->ok());
+  EXPECT_THAT(cache.Get("a"), Ne(program));
+  EXPECT_THAT(cache.size(), Eq(0));
+}
+
+}  // namespace
+}  // namespace cel::internal
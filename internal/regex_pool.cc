@@ -0,0 +1,94 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/regex_pool.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "internal/no_destructor.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+
+RegexPool& RegexPool::Shared() {
+  static NoDestructor<RegexPool> pool;
+  return *pool;
+}
+
+std::shared_ptr<const RE2> RegexPool::Get(absl::string_view pattern) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(pattern);
+    if (it != entries_.end()) {
+      if (std::shared_ptr<const RE2> program = it->second.program.lock();
+          program != nullptr) {
+        ++stats_.hits;
+        return program;
+      }
+    }
+  }
+
+  // Compiled outside of the lock, since that dominates the cost of a miss.
+  auto compiled = std::make_unique<RE2>(pattern);
+  if (!compiled->ok()) {
+    return compiled;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  Entry& entry = entries_[pattern];
+  // Another user may have compiled the same pattern meanwhile.
+  if (std::shared_ptr<const RE2> program = entry.program.lock();
+      program != nullptr) {
+    ++stats_.hits;
+    return program;
+  }
+  if (entry.raw == nullptr) {
+    // Otherwise the expired program is still accounted for until released.
+    ++stats_.patterns;
+    stats_.pattern_bytes += pattern.size();
+  }
+  ++stats_.misses;
+  stats_.program_size += compiled->ProgramSize();
+  std::shared_ptr<const RE2> program(compiled.release(), [this](const RE2* p) {
+    Release(p);
+    delete p;
+  });
+  entry.program = program;
+  entry.raw = program.get();
+  return program;
+}
+
+void RegexPool::Release(const RE2* program) {
+  absl::MutexLock lock(&mutex_);
+  stats_.program_size -= program->ProgramSize();
+  auto it = entries_.find(program->pattern());
+  if (it == entries_.end() || it->second.raw != program) {
+    // A new program was pooled for the pattern meanwhile, which now owns the
+    // entry.
+    return;
+  }
+  --stats_.patterns;
+  stats_.pattern_bytes -= it->first.size();
+  entries_.erase(it);
+}
+
+RegexPool::Stats RegexPool::stats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace cel::internal
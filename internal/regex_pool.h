@@ -0,0 +1,90 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_POOL_H_
+#define THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+
+// Deduplicates compiled regular expressions between all of their users, e.g.
+// the plans of many runtimes, without keeping them alive: a pattern is
+// compiled once while any user holds its program, and dropped with the last
+// one.
+//
+// Unlike RegexCache, the pool is meant for patterns known when planning, and
+// its size is bounded by the programs in use rather than by a capacity.
+//
+// Thread-safe. Programs must not outlive the pool, which is why the shared
+// pool is never destroyed.
+class RegexPool final {
+ public:
+  // Memory held by the programs in the pool.
+  struct Stats {
+    // Number of distinct patterns with a live program.
+    size_t patterns = 0;
+    // Sum of RE2::ProgramSize() of the live programs, a measure of their
+    // compiled size.
+    int64_t program_size = 0;
+    // Sum of the sizes of the live patterns, in bytes.
+    size_t pattern_bytes = 0;
+    // Requests served with a live program, and requests that compiled one.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  // Returns the process-wide pool.
+  static RegexPool& Shared();
+
+  RegexPool() = default;
+
+  RegexPool(const RegexPool&) = delete;
+  RegexPool& operator=(const RegexPool&) = delete;
+
+  // Returns the compiled program for pattern, compiling it if no live program
+  // exists. Invalid patterns are compiled on every request and not pooled, so
+  // callers must check `RE2::ok()`.
+  std::shared_ptr<const RE2> Get(absl::string_view pattern);
+
+  Stats stats() const;
+
+ private:
+  struct Entry {
+    std::weak_ptr<const RE2> program;
+    // Identifies the program the entry was created for, since a program may
+    // be released while a new one is pooled for the same pattern.
+    const RE2* raw = nullptr;
+  };
+
+  // Removes the entry of program, which is being destroyed.
+  void Release(const RE2* program);
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel::internal
+
+#endif  // THIRD_PARTY_CEL_CPP_INTERNAL_REGEX_POOL_H_
@@ -0,0 +1,74 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/regex_pool.h"
+
+#include <memory>
+
+#include "internal/testing.h"
+#include "re2/re2.h"
+
+namespace cel::internal {
+namespace {
+
+using testing::Eq;
+using testing::Ne;
+
+TEST(RegexPool, SharesLivePrograms) {
+  RegexPool pool;
+  std::shared_ptr<const RE2> program = pool.Get("a+b");
+  ASSERT_TRUE(program->ok());
+  EXPECT_TRUE(RE2::FullMatch("aab", *program));
+  EXPECT_THAT(pool.Get("a+b"), Eq(program));
+  EXPECT_THAT(pool.Get("a+c"), Ne(program));
+
+  RegexPool::Stats stats = pool.stats();
+  EXPECT_THAT(stats.hits, Eq(1));
+  EXPECT_THAT(stats.misses, Eq(2));
+  // The program for "a+c" was released already.
+  EXPECT_THAT(stats.patterns, Eq(1));
+  EXPECT_THAT(stats.pattern_bytes, Eq(3));
+  EXPECT_THAT(stats.program_size, Eq(program->ProgramSize()));
+}
+
+TEST(RegexPool, ReleasesUnusedPrograms) {
+  RegexPool pool;
+  std::shared_ptr<const RE2> program = pool.Get("a+b");
+  program.reset();
+  RegexPool::Stats stats = pool.stats();
+  EXPECT_THAT(stats.patterns, Eq(0));
+  EXPECT_THAT(stats.pattern_bytes, Eq(0));
+  EXPECT_THAT(stats.program_size, Eq(0));
+
+  program = pool.Get("a+b");
+  EXPECT_TRUE(program->ok());
+  EXPECT_THAT(pool.stats().misses, Eq(2));
+  EXPECT_THAT(pool.stats().patterns, Eq(1));
+}
+
+TEST(RegexPool, DoesNotPoolInvalidPatterns) {
+  RegexPool pool;
+  std::shared_ptr<const RE2> program = pool.Get("(");
+  EXPECT_FALSE(program->ok());
+  EXPECT_THAT(pool.Get("("), Ne(program));
+  EXPECT_THAT(pool.stats().patterns, Eq(0));
+}
+
+TEST(RegexPool, SharedPoolIsProcessWide) {
+  std::shared_ptr<const RE2> program = RegexPool::Shared().Get("shared.*");
+  EXPECT_THAT(RegexPool::Shared().Get("shared.*"), Eq(program));
+}
+
+}  // namespace
+}  // namespace cel::internal
@@ -16,6 +16,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include "absl/base/casts.h"
 #include "absl/log/absl_check.h"
@@ -370,29 +374,315 @@ absl::Status SerializeDoubleValue(double value, absl::Cord& serialized_value) {
   return absl::OkStatus();
 }
 
+namespace {
+
+// Writes the wire format into a contiguous buffer which was sized upfront
+// using the `Serialized*Size` functions, so no bounds checks or reallocations
+// are required.
+class FlatProtoWireWriter final {
+ public:
+  explicit FlatProtoWireWriter(char* buffer) : cursor_(buffer) {}
+
+  void WriteTag(ProtoWireTag tag) { WriteVarint(uint64_t{tag}); }
+
+  template <typename T>
+  std::enable_if_t<std::is_integral_v<T>> WriteVarint(T value) {
+    if constexpr (std::is_signed_v<T>) {
+      // Sign-extend to 64-bits, then encode.
+      cursor_ += VarintEncodeUnsafe(
+          static_cast<uint64_t>(static_cast<int64_t>(value)), cursor_);
+    } else {
+      cursor_ += VarintEncodeUnsafe(static_cast<uint64_t>(value), cursor_);
+    }
+  }
+
+  void WriteFixed32(float value) {
+    Fixed32EncodeUnsafe(absl::bit_cast<uint32_t>(value), cursor_);
+    cursor_ += 4;
+  }
+
+  void WriteFixed64(double value) {
+    Fixed64EncodeUnsafe(absl::bit_cast<uint64_t>(value), cursor_);
+    cursor_ += 8;
+  }
+
+  void WriteLengthDelimited(absl::string_view value) {
+    WriteVarint(value.size());
+    std::memcpy(cursor_, value.data(), value.size());
+    cursor_ += value.size();
+  }
+
+  void WriteLengthDelimited(const absl::Cord& value) {
+    WriteVarint(value.size());
+    for (absl::string_view chunk : value.Chunks()) {
+      std::memcpy(cursor_, chunk.data(), chunk.size());
+      cursor_ += chunk.size();
+    }
+  }
+
+  // Writes the length of a nested message, which the caller then writes.
+  void WriteLength(size_t size) { WriteVarint(size); }
+
+  const char* cursor() const { return cursor_; }
+
+ private:
+  char* cursor_;
+};
+
+// Grows `serialized_value` once by `size` and invokes `write` to fill the new
+// space.
+template <typename Write>
+void AppendFlat(size_t size, std::string& serialized_value, Write write) {
+  if (size == 0) {
+    return;
+  }
+  size_t offset = serialized_value.size();
+  serialized_value.resize(offset + size);
+  FlatProtoWireWriter writer(serialized_value.data() + offset);
+  write(writer);
+  ABSL_DCHECK_EQ(writer.cursor(),
+                 serialized_value.data() + serialized_value.size());
+}
+
+void WriteListValue(FlatProtoWireWriter& writer, const JsonArray& value);
+
+void WriteStruct(FlatProtoWireWriter& writer, const JsonObject& value);
+
+void WriteValue(FlatProtoWireWriter& writer, const Json& value) {
+  absl::visit(
+      internal::Overloaded{
+          [&writer](JsonNull) {
+            writer.WriteTag(ProtoWireTag(1, ProtoWireType::kVarint));
+            writer.WriteVarint(0);
+          },
+          [&writer](JsonBool value) {
+            writer.WriteTag(ProtoWireTag(4, ProtoWireType::kVarint));
+            writer.WriteVarint(value);
+          },
+          [&writer](JsonNumber value) {
+            writer.WriteTag(ProtoWireTag(2, ProtoWireType::kFixed64));
+            writer.WriteFixed64(value);
+          },
+          [&writer](const JsonString& value) {
+            writer.WriteTag(ProtoWireTag(3, ProtoWireType::kLengthDelimited));
+            writer.WriteLengthDelimited(value);
+          },
+          [&writer](const JsonArray& value) {
+            writer.WriteTag(ProtoWireTag(6, ProtoWireType::kLengthDelimited));
+            writer.WriteLength(SerializedListValueSize(value));
+            WriteListValue(writer, value);
+          },
+          [&writer](const JsonObject& value) {
+            writer.WriteTag(ProtoWireTag(5, ProtoWireType::kLengthDelimited));
+            writer.WriteLength(SerializedStructSize(value));
+            WriteStruct(writer, value);
+          }},
+      value);
+}
+
+void WriteListValue(FlatProtoWireWriter& writer, const JsonArray& value) {
+  for (const auto& element : value) {
+    writer.WriteTag(ProtoWireTag(1, ProtoWireType::kLengthDelimited));
+    writer.WriteLength(SerializedValueSize(element));
+    WriteValue(writer, element);
+  }
+}
+
+void WriteStruct(FlatProtoWireWriter& writer, const JsonObject& value) {
+  for (const auto& entry : value) {
+    writer.WriteTag(ProtoWireTag(1, ProtoWireType::kLengthDelimited));
+    writer.WriteLength(SerializedStructFieldSize(entry.first, entry.second));
+    writer.WriteTag(ProtoWireTag(1, ProtoWireType::kLengthDelimited));
+    writer.WriteLengthDelimited(entry.first);
+    writer.WriteTag(ProtoWireTag(2, ProtoWireType::kLengthDelimited));
+    writer.WriteLength(SerializedValueSize(entry.second));
+    WriteValue(writer, entry.second);
+  }
+}
+
+// Serializes JSON into a single flat buffer and appends it to the cord as
+// one chunk, rather than building a cord per nested message.
+template <typename Write>
+void AppendFlat(size_t size, absl::Cord& serialized_value, Write write) {
+  std::string flat;
+  AppendFlat(size, flat, std::move(write));
+  serialized_value.Append(std::move(flat));
+}
+
+template <typename Value>
+void WriteVarintValue(Value value, std::string& serialized_value) {
+  AppendFlat(SerializedVarintValueSize(value), serialized_value,
+             [value](FlatProtoWireWriter& writer) {
+               writer.WriteTag(ProtoWireTag(1, ProtoWireType::kVarint));
+               writer.WriteVarint(value);
+             });
+}
+
+template <typename Value>
+void WriteBytesValueOrStringValue(const Value& value,
+                                  std::string& serialized_value) {
+  AppendFlat(
+      SerializedBytesValueSizeOrStringValueSize(value), serialized_value,
+      [&value](FlatProtoWireWriter& writer) {
+        writer.WriteTag(ProtoWireTag(1, ProtoWireType::kLengthDelimited));
+        writer.WriteLengthDelimited(value);
+      });
+}
+
+void WriteDurationOrTimestamp(absl::Duration value,
+                              std::string& serialized_value) {
+  AppendFlat(SerializedDurationSizeOrTimestampSize(value), serialized_value,
+             [value](FlatProtoWireWriter& writer) mutable {
+               auto seconds =
+                   absl::IDivDuration(value, absl::Seconds(1), &value);
+               auto nanos = static_cast<int32_t>(
+                   absl::IDivDuration(value, absl::Nanoseconds(1), &value));
+               if (seconds != 0) {
+                 writer.WriteTag(ProtoWireTag(1, ProtoWireType::kVarint));
+                 writer.WriteVarint(seconds);
+               }
+               if (nanos != 0) {
+                 writer.WriteTag(ProtoWireTag(2, ProtoWireType::kVarint));
+                 writer.WriteVarint(nanos);
+               }
+             });
+}
+
+}  // namespace
+
 absl::Status SerializeValue(const Json& value, absl::Cord& serialized_value) {
-  size_t original_size = serialized_value.size();
-  CEL_RETURN_IF_ERROR(JsonToAnyValue(value, serialized_value));
-  ABSL_DCHECK_EQ(serialized_value.size() - original_size,
-                 SerializedValueSize(value));
+  AppendFlat(SerializedValueSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteValue(writer, value);
+             });
   return absl::OkStatus();
 }
 
 absl::Status SerializeListValue(const JsonArray& value,
                                 absl::Cord& serialized_value) {
-  size_t original_size = serialized_value.size();
-  CEL_RETURN_IF_ERROR(JsonArrayToAnyValue(value, serialized_value));
-  ABSL_DCHECK_EQ(serialized_value.size() - original_size,
-                 SerializedListValueSize(value));
+  AppendFlat(SerializedListValueSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteListValue(writer, value);
+             });
   return absl::OkStatus();
 }
 
 absl::Status SerializeStruct(const JsonObject& value,
                              absl::Cord& serialized_value) {
-  size_t original_size = serialized_value.size();
-  CEL_RETURN_IF_ERROR(JsonObjectToAnyValue(value, serialized_value));
-  ABSL_DCHECK_EQ(serialized_value.size() - original_size,
-                 SerializedStructSize(value));
+  AppendFlat(SerializedStructSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteStruct(writer, value);
+             });
+  return absl::OkStatus();
+}
+
+absl::Status SerializeDuration(absl::Duration value,
+                               std::string& serialized_value) {
+  WriteDurationOrTimestamp(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeTimestamp(absl::Time value,
+                                std::string& serialized_value) {
+  WriteDurationOrTimestamp(value - absl::UnixEpoch(), serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeBytesValue(const absl::Cord& value,
+                                 std::string& serialized_value) {
+  WriteBytesValueOrStringValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeBytesValue(absl::string_view value,
+                                 std::string& serialized_value) {
+  WriteBytesValueOrStringValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeStringValue(const absl::Cord& value,
+                                  std::string& serialized_value) {
+  WriteBytesValueOrStringValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeStringValue(absl::string_view value,
+                                  std::string& serialized_value) {
+  WriteBytesValueOrStringValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeBoolValue(bool value, std::string& serialized_value) {
+  WriteVarintValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeInt32Value(int32_t value,
+                                 std::string& serialized_value) {
+  WriteVarintValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeInt64Value(int64_t value,
+                                 std::string& serialized_value) {
+  WriteVarintValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeUInt32Value(uint32_t value,
+                                  std::string& serialized_value) {
+  WriteVarintValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeUInt64Value(uint64_t value,
+                                  std::string& serialized_value) {
+  WriteVarintValue(value, serialized_value);
+  return absl::OkStatus();
+}
+
+absl::Status SerializeFloatValue(float value, std::string& serialized_value) {
+  AppendFlat(SerializedFloatValueSize(value), serialized_value,
+             [value](FlatProtoWireWriter& writer) {
+               writer.WriteTag(ProtoWireTag(1, ProtoWireType::kFixed32));
+               writer.WriteFixed32(value);
+             });
+  return absl::OkStatus();
+}
+
+absl::Status SerializeDoubleValue(double value,
+                                  std::string& serialized_value) {
+  AppendFlat(SerializedDoubleValueSize(value), serialized_value,
+             [value](FlatProtoWireWriter& writer) {
+               writer.WriteTag(ProtoWireTag(1, ProtoWireType::kFixed64));
+               writer.WriteFixed64(value);
+             });
+  return absl::OkStatus();
+}
+
+absl::Status SerializeValue(const Json& value, std::string& serialized_value) {
+  AppendFlat(SerializedValueSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteValue(writer, value);
+             });
+  return absl::OkStatus();
+}
+
+absl::Status SerializeListValue(const JsonArray& value,
+                                std::string& serialized_value) {
+  AppendFlat(SerializedListValueSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteListValue(writer, value);
+             });
+  return absl::OkStatus();
+}
+
+absl::Status SerializeStruct(const JsonObject& value,
+                             std::string& serialized_value) {
+  AppendFlat(SerializedStructSize(value), serialized_value,
+             [&value](FlatProtoWireWriter& writer) {
+               WriteStruct(writer, value);
+             });
   return absl::OkStatus();
 }
 
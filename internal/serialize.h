@@ -17,6 +17,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
@@ -65,6 +66,56 @@ absl::Status SerializeListValue(const JsonArray& value,
 absl::Status SerializeStruct(const JsonObject& value,
                              absl::Cord& serialized_value);
 
+// Overloads of the above which append to a contiguous buffer. The serialized
+// size is computed upfront, so `serialized_value` grows at most once and the
+// encoding is written directly into it. Prefer these when the result is
+// consumed as a flat buffer, or when serializing nested JSON, which the
+// `absl::Cord` overloads otherwise build one chunk per message.
+
+absl::Status SerializeDuration(absl::Duration value,
+                               std::string& serialized_value);
+
+absl::Status SerializeTimestamp(absl::Time value,
+                                std::string& serialized_value);
+
+absl::Status SerializeBytesValue(const absl::Cord& value,
+                                 std::string& serialized_value);
+
+absl::Status SerializeBytesValue(absl::string_view value,
+                                 std::string& serialized_value);
+
+absl::Status SerializeStringValue(const absl::Cord& value,
+                                  std::string& serialized_value);
+
+absl::Status SerializeStringValue(absl::string_view value,
+                                  std::string& serialized_value);
+
+absl::Status SerializeBoolValue(bool value, std::string& serialized_value);
+
+absl::Status SerializeInt32Value(int32_t value,
+                                 std::string& serialized_value);
+
+absl::Status SerializeInt64Value(int64_t value,
+                                 std::string& serialized_value);
+
+absl::Status SerializeUInt32Value(uint32_t value,
+                                  std::string& serialized_value);
+
+absl::Status SerializeUInt64Value(uint64_t value,
+                                  std::string& serialized_value);
+
+absl::Status SerializeFloatValue(float value, std::string& serialized_value);
+
+absl::Status SerializeDoubleValue(double value, std::string& serialized_value);
+
+absl::Status SerializeValue(const Json& value, std::string& serialized_value);
+
+absl::Status SerializeListValue(const JsonArray& value,
+                                std::string& serialized_value);
+
+absl::Status SerializeStruct(const JsonObject& value,
+                             std::string& serialized_value);
+
 size_t SerializedDurationSize(absl::Duration value);
 
 size_t SerializedTimestampSize(absl::Time value);
@@ -0,0 +1,91 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "internal/serialize.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/cord.h"
+#include "absl/time/time.h"
+#include "common/json.h"
+#include "internal/deserialize.h"
+#include "internal/testing.h"
+
+namespace cel::internal {
+namespace {
+
+using testing::Eq;
+
+TEST(Serialize, FlatMatchesCord) {
+  absl::Cord cord;
+  std::string flat;
+  ASSERT_OK(SerializeDuration(absl::Seconds(3) + absl::Nanoseconds(5), cord));
+  ASSERT_OK(SerializeDuration(absl::Seconds(3) + absl::Nanoseconds(5), flat));
+  ASSERT_OK(SerializeTimestamp(absl::FromUnixSeconds(-7), cord));
+  ASSERT_OK(SerializeTimestamp(absl::FromUnixSeconds(-7), flat));
+  ASSERT_OK(SerializeStringValue("foo", cord));
+  ASSERT_OK(SerializeStringValue("foo", flat));
+  ASSERT_OK(SerializeBytesValue(absl::Cord("bar"), cord));
+  ASSERT_OK(SerializeBytesValue(absl::Cord("bar"), flat));
+  ASSERT_OK(SerializeBoolValue(true, cord));
+  ASSERT_OK(SerializeBoolValue(true, flat));
+  ASSERT_OK(SerializeInt32Value(-1, cord));
+  ASSERT_OK(SerializeInt32Value(-1, flat));
+  ASSERT_OK(SerializeInt64Value(-300, cord));
+  ASSERT_OK(SerializeInt64Value(-300, flat));
+  ASSERT_OK(SerializeUInt32Value(300, cord));
+  ASSERT_OK(SerializeUInt32Value(300, flat));
+  ASSERT_OK(SerializeUInt64Value(1, cord));
+  ASSERT_OK(SerializeUInt64Value(1, flat));
+  ASSERT_OK(SerializeFloatValue(1.5f, cord));
+  ASSERT_OK(SerializeFloatValue(1.5f, flat));
+  ASSERT_OK(SerializeDoubleValue(2.5, cord));
+  ASSERT_OK(SerializeDoubleValue(2.5, flat));
+  // Default values serialize to nothing.
+  ASSERT_OK(SerializeInt64Value(0, flat));
+  ASSERT_OK(SerializeStringValue("", flat));
+  EXPECT_THAT(flat, Eq(static_cast<std::string>(cord)));
+}
+
+TEST(Serialize, Json) {
+  JsonArrayBuilder array_builder;
+  array_builder.push_back(kJsonNull);
+  array_builder.push_back(true);
+  array_builder.push_back(1.0);
+  JsonObjectBuilder object_builder;
+  object_builder.insert_or_assign(JsonString("list"),
+                                  std::move(array_builder).Build());
+  object_builder.insert_or_assign(JsonString("string"), JsonString("foo"));
+  JsonObject object = std::move(object_builder).Build();
+
+  std::string flat;
+  ASSERT_OK(SerializeStruct(object, flat));
+  EXPECT_THAT(flat.size(), Eq(SerializedStructSize(object)));
+  ASSERT_OK_AND_ASSIGN(auto deserialized,
+                       DeserializeStruct(absl::Cord(flat)));
+  EXPECT_THAT(deserialized, Eq(object));
+
+  absl::Cord cord;
+  ASSERT_OK(SerializeStruct(object, cord));
+  EXPECT_THAT(static_cast<std::string>(cord), Eq(flat));
+
+  flat.clear();
+  ASSERT_OK(SerializeValue(Json(object), flat));
+  ASSERT_OK_AND_ASSIGN(auto value, DeserializeValue(absl::Cord(flat)));
+  EXPECT_THAT(value, Eq(Json(object)));
+}
+
+}  // namespace
+}  // namespace cel::internal
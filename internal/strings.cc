@@ -14,12 +14,12 @@
 
 #include "internal/strings.h"
 
+#include <cstring>
 #include <string>
 
 #include "absl/base/attributes.h"
 #include "absl/status/status.h"
 #include "absl/strings/ascii.h"
-#include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "internal/lexis.h"
@@ -41,6 +41,30 @@ constexpr int HexDigitToInt(char x) {
 
 constexpr bool IsOctalDigit(char x) { return x >= '0' && x <= '7'; }
 
+// Returns the first backslash or carriage return in [p, end), which
+// UnescapeInternal handles individually, or end. Everything before it is
+// copied verbatim.
+const char* FindUnescapeSpecial(const char* p, const char* end) {
+  const char* backslash =
+      static_cast<const char*>(std::memchr(p, '\\', end - p));
+  if (backslash == nullptr) {
+    backslash = end;
+  }
+  const char* carriage_return =
+      static_cast<const char*>(std::memchr(p, '\r', backslash - p));
+  return carriage_return != nullptr ? carriage_return : backslash;
+}
+
+// Returns true if EscapeInternal copies `c` verbatim regardless of its
+// neighbours.
+constexpr bool IsVerbatimEscapeByte(unsigned char c, bool escape_all_bytes) {
+  if (c >= 0x80) {
+    return escape_all_bytes;
+  }
+  return c >= 0x20 && c < 0x7f && c != '\\' && c != '\'' && c != '"' &&
+         c != '`';
+}
+
 // Returns true when following conditions are met:
 // - <closing_str> is a suffix of <source>.
 // - No other unescaped occurrence of <closing_str> inside <source> (apart from
@@ -58,6 +82,12 @@ bool CheckForClosingString(absl::string_view source,
   bool is_closed = false;
   while (p + closing_str.length() <= end) {
     if (*p != '\\') {
+      // Only the final position can close the string, so positions which
+      // cannot start <closing_str> need no further checks.
+      if (*p != closing_str.front()) {
+        p++;
+        continue;
+      }
       size_t cur_pos = p - source.data();
       bool is_closing =
           absl::StartsWith(absl::ClippedSubstr(source, cur_pos), closing_str);
@@ -138,7 +168,10 @@ bool UnescapeInternal(absl::string_view source, absl::string_view closing_str,
   while (p < end) {
     if (*p != '\\') {
       if (*p != '\r') {
-        dest->push_back(*p++);
+        // Copy the run up to the next escape or carriage return at once.
+        const char* run_end = FindUnescapeSpecial(p, end);
+        dest->append(p, run_end - p);
+        p = run_end;
       } else {
         // All types of newlines in different platforms i.e. '\r', '\n', '\r\n'
         // are replaced with '\n'.
@@ -442,13 +475,27 @@ bool UnescapeInternal(absl::string_view source, absl::string_view closing_str,
 std::string EscapeInternal(absl::string_view src, bool escape_all_bytes,
                            char escape_quote_char) {
   std::string dest;
-  // Worst case size is every byte has to be hex escaped, so 4 char for every
-  // byte.
-  dest.reserve(src.size() * 4);
+  // Typically few bytes need escaping, so reserve for the unescaped size and
+  // let the rare escapes grow the buffer.
+  dest.reserve(src.size());
   bool last_hex_escape = false;  // true if last output char was \xNN.
   const char* p = src.data();
   const char* end = p + src.size();
   for (; p < end; ++p) {
+    if (!last_hex_escape) {
+      // Copy the run of bytes which need no escaping at once.
+      const char* run_end = p;
+      while (run_end < end &&
+             IsVerbatimEscapeByte(static_cast<unsigned char>(*run_end),
+                                  escape_all_bytes)) {
+        ++run_end;
+      }
+      dest.append(p, run_end - p);
+      p = run_end;
+      if (p == end) {
+        break;
+      }
+    }
     unsigned char c = static_cast<unsigned char>(*p);
     bool is_hex_escape = false;
     switch (c) {
@@ -493,7 +540,6 @@ std::string EscapeInternal(absl::string_view src, bool escape_all_bytes,
     }
     last_hex_escape = is_hex_escape;
   }
-  dest.shrink_to_fit();
   return dest;
 }
 
@@ -554,13 +600,29 @@ std::string EscapeString(absl::string_view str) {
 std::string EscapeBytes(absl::string_view str, bool escape_all_bytes,
                         char escape_quote_char) {
   std::string escaped_bytes;
+  escaped_bytes.reserve(escape_all_bytes ? str.size() * 4 : str.size());
   const char* p = str.data();
   const char* end = p + str.size();
   for (; p < end; ++p) {
+    if (!escape_all_bytes) {
+      // Copy the run of bytes which need no escaping at once.
+      const char* run_end = p;
+      while (run_end < end &&
+             IsVerbatimEscapeByte(static_cast<unsigned char>(*run_end),
+                                  /*escape_all_bytes=*/false)) {
+        ++run_end;
+      }
+      escaped_bytes.append(p, run_end - p);
+      p = run_end;
+      if (p == end) {
+        break;
+      }
+    }
     unsigned char c = *p;
     if (escape_all_bytes || !absl::ascii_isprint(c)) {
       escaped_bytes += "\\x";
-      escaped_bytes += absl::BytesToHexString(absl::string_view(p, 1));
+      escaped_bytes += kHexTable[c / 16];
+      escaped_bytes += kHexTable[c % 16];
     } else {
       switch (c) {
         // Note that we only handle printable escape characters here.  All
@@ -21,6 +21,7 @@
 #include "absl/status/status.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "internal/testing.h"
 #include "internal/utf8.h"
@@ -655,6 +656,19 @@ TEST(StringsTest, TestNewlines) {
   ExpectParsedString("a\r\nb", {"'''a\\r\\nb'''"});
 }
 
+// Runs of characters without escapes are copied in bulk, so exercise escapes
+// and carriage returns between long runs.
+TEST(StringsTest, LongRuns) {
+  const std::string run(100, 'z');
+  ExpectParsedString(absl::StrCat(run, "\n", run, "\t", run),
+                     {absl::StrCat("'", run, "\\n", run, "\\t", run, "'"),
+                      absl::StrCat("'''", run, "\r", run, "\\t", run, "'''")});
+  EXPECT_EQ(FormatStringLiteral(absl::StrCat(run, "\"\x01", run)),
+            absl::StrCat("'", run, "\"\\x01", run, "'"));
+  EXPECT_EQ(FormatBytesLiteral(absl::StrCat(run, "\xff", run)),
+            absl::StrCat("b\"", run, "\\xff", run, "\""));
+}
+
 TEST(RawStringsTest, CompareRawAndRegularStringParsing) {
   ExpectParsedString("\\n",
                      {"r'\\n'", "r\"\\n\"", "r'''\\n'''", "r\"\"\"\\n\"\"\""});
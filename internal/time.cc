@@ -14,10 +14,12 @@
 
 #include "internal/time.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/time/time.h"
@@ -32,6 +34,117 @@ std::string RawFormatTimestamp(absl::Time timestamp) {
                           absl::UTCTimeZone());
 }
 
+bool ConsumeChar(absl::string_view& input, char c) {
+  if (input.empty() || input.front() != c) {
+    return false;
+  }
+  input.remove_prefix(1);
+  return true;
+}
+
+// Consumes exactly `n` decimal digits.
+bool ConsumeDigits(absl::string_view& input, int n, int* value) {
+  if (input.size() < static_cast<size_t>(n)) {
+    return false;
+  }
+  int result = 0;
+  for (int i = 0; i < n; ++i) {
+    if (!absl::ascii_isdigit(input[i])) {
+      return false;
+    }
+    result = result * 10 + (input[i] - '0');
+  }
+  input.remove_prefix(n);
+  *value = result;
+  return true;
+}
+
+int DaysInMonth(int year, int month) {
+  static constexpr int kDaysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                         31, 31, 30, 31, 30, 31};
+  if (month == 2 &&
+      (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+    return 29;
+  }
+  return kDaysInMonth[month - 1];
+}
+
+// Days from 1970-01-01 to the given proleptic Gregorian date.
+int64_t DaysFromCivil(int64_t year, int month, int day) {
+  year -= month <= 2 ? 1 : 0;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const int64_t year_of_era = year - era * 400;
+  const int64_t day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 -
+                             year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+// Decodes the fixed RFC 3339 layout. Returns false for anything else,
+// including out of range fields, leaving those to absl::ParseTime.
+bool ParseRfc3339FixedLayout(absl::string_view input, absl::Time* time) {
+  int year, month, day, hour, minute, second;
+  if (!ConsumeDigits(input, 4, &year) || !ConsumeChar(input, '-') ||
+      !ConsumeDigits(input, 2, &month) || !ConsumeChar(input, '-') ||
+      !ConsumeDigits(input, 2, &day) || !ConsumeChar(input, 'T') ||
+      !ConsumeDigits(input, 2, &hour) || !ConsumeChar(input, ':') ||
+      !ConsumeDigits(input, 2, &minute) || !ConsumeChar(input, ':') ||
+      !ConsumeDigits(input, 2, &second)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month) ||
+      hour > 23 || minute > 59 || second > 59) {
+    return false;
+  }
+
+  int64_t nanos = 0;
+  if (ConsumeChar(input, '.')) {
+    int digits = 0;
+    while (!input.empty() && absl::ascii_isdigit(input.front())) {
+      if (digits == 9) {
+        return false;
+      }
+      nanos = nanos * 10 + (input.front() - '0');
+      ++digits;
+      input.remove_prefix(1);
+    }
+    if (digits == 0) {
+      return false;
+    }
+    for (; digits < 9; ++digits) {
+      nanos *= 10;
+    }
+  }
+
+  int64_t offset_seconds = 0;
+  if (!ConsumeChar(input, 'Z')) {
+    int sign;
+    if (ConsumeChar(input, '+')) {
+      sign = 1;
+    } else if (ConsumeChar(input, '-')) {
+      sign = -1;
+    } else {
+      return false;
+    }
+    int offset_hours, offset_minutes;
+    if (!ConsumeDigits(input, 2, &offset_hours) || !ConsumeChar(input, ':') ||
+        !ConsumeDigits(input, 2, &offset_minutes) || offset_hours > 23 ||
+        offset_minutes > 59) {
+      return false;
+    }
+    offset_seconds = sign * (offset_hours * 3600 + offset_minutes * 60);
+  }
+  if (!input.empty()) {
+    return false;
+  }
+
+  int64_t seconds = DaysFromCivil(year, month, day) * 86400 + hour * 3600 +
+                    minute * 60 + second - offset_seconds;
+  *time = absl::FromUnixSeconds(seconds) + absl::Nanoseconds(nanos);
+  return true;
+}
+
 }  // namespace
 
 absl::Status ValidateDuration(absl::Duration duration) {
@@ -83,11 +196,19 @@ absl::Status ValidateTimestamp(absl::Time timestamp) {
   return absl::OkStatus();
 }
 
+bool ParseRfc3339Time(absl::string_view input, absl::Time* time,
+                      std::string* err) {
+  if (ParseRfc3339FixedLayout(input, time)) {
+    return true;
+  }
+  return absl::ParseTime(absl::RFC3339_full, input, absl::UTCTimeZone(), time,
+                         err);
+}
+
 absl::StatusOr<absl::Time> ParseTimestamp(absl::string_view input) {
   absl::Time timestamp;
   std::string err;
-  if (!absl::ParseTime(absl::RFC3339_full, input, absl::UTCTimeZone(),
-                       &timestamp, &err)) {
+  if (!ParseRfc3339Time(input, &timestamp, &err)) {
     return err.empty() ? absl::InvalidArgumentError(
                              "Failed to parse timestamp from string")
                        : absl::InvalidArgumentError(absl::StrCat(
@@ -73,6 +73,16 @@ absl::Status ValidateTimestamp(absl::Time timestamp);
 
 absl::StatusOr<absl::Time> ParseTimestamp(absl::string_view input);
 
+// Parses an RFC 3339 timestamp, accepting exactly the inputs accepted by
+// `absl::ParseTime(absl::RFC3339_full, ...)` in UTC. The common layout
+// `YYYY-MM-DDTHH:MM:SS[.fraction](Z|+HH:MM|-HH:MM)`, with at most nine
+// fractional digits, is decoded directly instead of interpreting the format
+// string. Unlike ParseTimestamp, the range is not validated.
+//
+// `err` may be null.
+bool ParseRfc3339Time(absl::string_view input, absl::Time* time,
+                      std::string* err);
+
 // Human-friendly format for timestamp provided to match DebugString.
 // Checks that the timestamp is in the supported range for CEL values.
 absl::StatusOr<std::string> FormatTimestamp(absl::Time timestamp);
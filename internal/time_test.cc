@@ -114,6 +114,36 @@ TEST(ParseTimestamp, Conformance) {
               StatusIs(absl::StatusCode::kInvalidArgument));
 }
 
+TEST(ParseRfc3339Time, MatchesAbslParseTime) {
+  for (const char* input : {
+           "2023-05-06T07:08:09Z",
+           "2023-05-06t07:08:09.5z",
+           "2023-05-06T07:08:09.123456789+05:30",
+           "2023-05-06T07:08:09.0000000001-08:00",
+           "2024-02-29T23:59:59Z",
+           "2023-02-29T00:00:00Z",
+           "2023-05-06T24:00:00Z",
+           "2023-05-06T07:08:60Z",
+           "2023-05-06T07:08:09",
+           "2023-05-06 07:08:09Z",
+           "2023-5-06T07:08:09Z",
+           "2023-05-06T07:08:09+0100",
+           "0001-01-01T00:00:00Z",
+           "9999-12-31T23:59:59.999999999Z",
+       }) {
+    absl::Time fast;
+    bool fast_ok = internal::ParseRfc3339Time(input, &fast, /*err=*/nullptr);
+    absl::Time expected;
+    bool expected_ok = absl::ParseTime(absl::RFC3339_full, input,
+                                       absl::UTCTimeZone(), &expected,
+                                       /*err=*/nullptr);
+    EXPECT_EQ(fast_ok, expected_ok) << input;
+    if (fast_ok && expected_ok) {
+      EXPECT_EQ(fast, expected) << input;
+    }
+  }
+}
+
 TEST(FormatTimestamp, Conformance) {
   std::string formatted;
   ASSERT_OK_AND_ASSIGN(formatted, internal::FormatTimestamp(MinTimestamp()));
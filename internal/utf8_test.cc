@@ -14,7 +14,9 @@
 
 #include "internal/utf8.h"
 
+#include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/cord.h"
@@ -161,6 +163,41 @@ TEST(Utf8Validate, Cord) {
   EXPECT_EQ(Utf8Validate(absl::Cord("a\xe2\x80")).first, 1);
 }
 
+// Exercises the ASCII fast path, which skips blocks of bytes, with a non-ASCII
+// sequence at every offset within and across blocks.
+TEST(Utf8, NonAsciiAtEveryOffset) {
+  for (size_t offset = 0; offset <= 40; ++offset) {
+    SCOPED_TRACE(offset);
+    std::string valid(48, 'a');
+    valid.insert(offset, "\xd0\x96");
+    std::string invalid(48, 'a');
+    invalid.insert(offset, "\xff");
+    for (const absl::Cord& cord :
+         {absl::Cord(valid), absl::MakeFragmentedCord(std::vector<std::string>{
+                                 valid.substr(0, 7), valid.substr(7, 19),
+                                 valid.substr(26)})}) {
+      EXPECT_TRUE(Utf8IsValid(cord));
+      EXPECT_EQ(Utf8CodePointCount(cord), 49);
+      EXPECT_EQ(Utf8Validate(cord), std::make_pair(size_t{49}, true));
+    }
+    EXPECT_TRUE(Utf8IsValid(valid));
+    EXPECT_EQ(Utf8CodePointCount(valid), 49);
+    EXPECT_EQ(Utf8Validate(valid), std::make_pair(size_t{49}, true));
+    for (const absl::Cord& cord :
+         {absl::Cord(invalid),
+          absl::MakeFragmentedCord(std::vector<std::string>{
+              invalid.substr(0, 7), invalid.substr(7, 19),
+              invalid.substr(26)})}) {
+      EXPECT_FALSE(Utf8IsValid(cord));
+      EXPECT_EQ(Utf8CodePointCount(cord), 49);
+      EXPECT_EQ(Utf8Validate(cord), std::make_pair(offset, false));
+    }
+    EXPECT_FALSE(Utf8IsValid(invalid));
+    EXPECT_EQ(Utf8CodePointCount(invalid), 49);
+    EXPECT_EQ(Utf8Validate(invalid), std::make_pair(offset, false));
+  }
+}
+
 struct Utf8EncodeTestCase final {
   char32_t code_point;
   absl::string_view code_units;
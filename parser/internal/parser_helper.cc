@@ -0,0 +1,105 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parser/internal/parser_helper.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/strings/str_format.h"
+#include "parser/macro.h"
+#include "parser/source_factory.h"
+
+namespace cel_parser_internal {
+
+using ::google::api::expr::parser::SourceFactory;
+using ::google::api::expr::v1alpha1::Expr;
+
+ExpressionBalancer::ExpressionBalancer(std::shared_ptr<SourceFactory> sf,
+                                       std::string function, Expr expr)
+    : sf_(std::move(sf)),
+      function_(std::move(function)),
+      terms_{std::move(expr)},
+      ops_{} {}
+
+void ExpressionBalancer::AddTerm(int64_t op, Expr term) {
+  terms_.push_back(std::move(term));
+  ops_.push_back(op);
+}
+
+Expr ExpressionBalancer::Balance() {
+  if (terms_.size() == 1) {
+    return std::move(terms_[0]);
+  }
+  return BalancedTree(0, ops_.size() - 1);
+}
+
+Expr ExpressionBalancer::BalancedTree(int lo, int hi) {
+  int mid = (lo + hi + 1) / 2;
+
+  Expr left;
+  if (mid == lo) {
+    left = std::move(terms_[mid]);
+  } else {
+    left = BalancedTree(lo, mid - 1);
+  }
+
+  Expr right;
+  if (mid == hi) {
+    right = std::move(terms_[mid + 1]);
+  } else {
+    right = BalancedTree(mid + 1, hi);
+  }
+  return sf_->NewGlobalCall(ops_[mid], function_,
+                            {std::move(left), std::move(right)});
+}
+
+bool ExpandMacro(const std::shared_ptr<SourceFactory>& sf,
+                 const std::map<std::string, cel::Macro>& macros,
+                 bool add_macro_calls, int64_t expr_id,
+                 const std::string& function, const Expr& target,
+                 const std::vector<Expr>& args, Expr* macro_expr) {
+  std::string macro_key = absl::StrFormat("%s:%d:%s", function, args.size(),
+                                          target.id() != 0 ? "true" : "false");
+  auto m = macros.find(macro_key);
+  if (m == macros.end()) {
+    std::string var_arg_macro_key = absl::StrFormat(
+        "%s:*:%s", function, target.id() != 0 ? "true" : "false");
+    m = macros.find(var_arg_macro_key);
+    if (m == macros.end()) {
+      return false;
+    }
+  }
+
+  Expr expr = m->second.Expand(sf, expr_id, target, args);
+  if (expr.expr_kind_case() != Expr::EXPR_KIND_NOT_SET) {
+    *macro_expr = std::move(expr);
+    if (add_macro_calls) {
+      // If the macro is nested, the full expression id is used as an argument
+      // id in the tree. Using this ID instead of expr_id allows argument id
+      // lookups in macro_calls when building the map and iterating
+      // the AST.
+      sf->AddMacroCall(macro_expr->id(), target, args, function);
+    }
+    return true;
+  }
+  return false;
+}
+
+}  // namespace cel_parser_internal
@@ -0,0 +1,84 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Helpers shared by the ANTLR parse tree visitor and the recursive descent
+// parser, so that both build the same expressions with the same ids.
+//
+// Based on code from //third_party/cel/go/parser/helper.go
+
+#ifndef THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_PARSER_HELPER_H_
+#define THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_PARSER_HELPER_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "parser/macro.h"
+#include "parser/source_factory.h"
+
+namespace cel_parser_internal {
+
+// balancer performs tree balancing on operators whose arguments are of equal
+// precedence.
+//
+// The purpose of the balancer is to ensure a compact serialization format for
+// the logical &&, || operators which have a tendency to create long DAGs which
+// are skewed in one direction. Since the operators are commutative re-ordering
+// the terms *must not* affect the evaluation result.
+class ExpressionBalancer final {
+ public:
+  ExpressionBalancer(
+      std::shared_ptr<google::api::expr::parser::SourceFactory> sf,
+      std::string function, google::api::expr::v1alpha1::Expr expr);
+
+  // addTerm adds an operation identifier and term to the set of terms to be
+  // balanced.
+  void AddTerm(int64_t op, google::api::expr::v1alpha1::Expr term);
+
+  // balance creates a balanced tree from the sub-terms and returns the final
+  // Expr value. The terms are moved into the tree, so it may only be called
+  // once.
+  google::api::expr::v1alpha1::Expr Balance();
+
+ private:
+  // balancedTree recursively balances the terms provided to a commutative
+  // operator.
+  google::api::expr::v1alpha1::Expr BalancedTree(int lo, int hi);
+
+ private:
+  std::shared_ptr<google::api::expr::parser::SourceFactory> sf_;
+  std::string function_;
+  std::vector<google::api::expr::v1alpha1::Expr> terms_;
+  std::vector<int64_t> ops_;
+};
+
+// Expands the macro in macros matching the call of function on target (or
+// Expr::default_instance() for a global call) with args. Returns false if no
+// macro matches or the matching macro declines to expand the call, otherwise
+// stores the expansion in macro_expr and, if add_macro_calls is set, records
+// the call in the source factory.
+bool ExpandMacro(
+    const std::shared_ptr<google::api::expr::parser::SourceFactory>& sf,
+    const std::map<std::string, cel::Macro>& macros, bool add_macro_calls,
+    int64_t expr_id, const std::string& function,
+    const google::api::expr::v1alpha1::Expr& target,
+    const std::vector<google::api::expr::v1alpha1::Expr>& args,
+    google::api::expr::v1alpha1::Expr* macro_expr);
+
+}  // namespace cel_parser_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_PARSER_HELPER_H_
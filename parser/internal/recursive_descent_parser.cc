@@ -0,0 +1,1269 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "parser/internal/recursive_descent_parser.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "google/protobuf/struct.pb.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "common/operators.h"
+#include "common/source.h"
+#include "internal/strings.h"
+#include "parser/internal/parser_helper.h"
+#include "parser/macro.h"
+#include "parser/options.h"
+#include "parser/source_factory.h"
+
+namespace cel_parser_internal {
+
+namespace {
+
+using ::cel::SourceContentView;
+using ::cel::SourcePosition;
+using ::google::api::expr::common::CelOperator;
+using ::google::api::expr::parser::SourceFactory;
+using ::google::api::expr::v1alpha1::Expr;
+
+// The tokens of the lexer rules in Cel.g4.
+enum class TokenKind {
+  kEof,
+  kIdentifier,
+  kNumInt,
+  kNumUint,
+  kNumFloat,
+  kString,
+  kBytes,
+  kTrue,
+  kFalse,
+  kNull,
+  kIn,
+  kEquals,
+  kNotEquals,
+  kLess,
+  kLessEquals,
+  kGreaterEquals,
+  kGreater,
+  kLogicalAnd,
+  kLogicalOr,
+  kLBracket,
+  kRBracket,
+  kLBrace,
+  kRBrace,
+  kLParen,
+  kRParen,
+  kDot,
+  kComma,
+  kMinus,
+  kExclam,
+  kQuestionMark,
+  kColon,
+  kPlus,
+  kStar,
+  kSlash,
+  kPercent,
+};
+
+// A token, positioned as the ANTLR lexer positions it.
+struct Token {
+  TokenKind kind;
+  // 1-based line of the first code point.
+  int32_t line;
+  // 0-based column of the first code point within its line.
+  int32_t col;
+  // Offsets of the first and last code points.
+  SourcePosition start;
+  SourcePosition stop;
+};
+
+constexpr char32_t kEndOfInput = 0xffffffff;
+
+bool IsDigit(char32_t c) { return c >= '0' && c <= '9'; }
+
+bool IsHexDigit(char32_t c) {
+  return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+bool IsLetter(char32_t c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool IsQuote(char32_t c) { return c == '"' || c == '\''; }
+
+// Splits content into tokens, skipping whitespace and comments. Where several
+// lexer rules match, the longest match is taken, as ANTLR does.
+class Lexer final {
+ public:
+  explicit Lexer(SourceContentView content)
+      : content_(content), size_(content.size()) {}
+
+  // Returns false if content contains a character sequence which is not a
+  // token. The last token is always kEof.
+  bool Tokenize(std::vector<Token>& tokens);
+
+ private:
+  char32_t Peek(SourcePosition offset = 0) const {
+    SourcePosition position = pos_ + offset;
+    return position < size_ ? content_.at(position) : kEndOfInput;
+  }
+
+  // Consumes count code points, counting lines as the ANTLR lexer does.
+  void Advance(SourcePosition count = 1) {
+    for (; count > 0; --count) {
+      if (content_.at(pos_) == '\n') {
+        ++line_;
+        line_start_ = pos_ + 1;
+      }
+      ++pos_;
+    }
+  }
+
+  bool LexToken(TokenKind& kind);
+  bool LexNumber(TokenKind& kind);
+  bool LexExponent();
+  void LexDigits();
+  bool LexString(bool raw);
+  bool LexEscape();
+
+  const SourceContentView content_;
+  const SourcePosition size_;
+  SourcePosition pos_ = 0;
+  int32_t line_ = 1;
+  SourcePosition line_start_ = 0;
+};
+
+bool Lexer::Tokenize(std::vector<Token>& tokens) {
+  for (char32_t c = Peek(); c != kEndOfInput; c = Peek()) {
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f') {
+      Advance();
+      continue;
+    }
+    if (c == '/' && Peek(1) == '/') {
+      while (Peek() != kEndOfInput && Peek() != '\n') {
+        Advance();
+      }
+      continue;
+    }
+    Token token;
+    token.line = line_;
+    token.col = pos_ - line_start_;
+    token.start = pos_;
+    if (!LexToken(token.kind)) {
+      return false;
+    }
+    token.stop = pos_ - 1;
+    tokens.push_back(token);
+  }
+  tokens.push_back(
+      Token{TokenKind::kEof, line_, pos_ - line_start_, pos_, pos_ - 1});
+  return true;
+}
+
+bool Lexer::LexToken(TokenKind& kind) {
+  char32_t c = Peek();
+  switch (c) {
+    case '=':
+      if (Peek(1) != '=') {
+        return false;
+      }
+      Advance(2);
+      kind = TokenKind::kEquals;
+      return true;
+    case '!':
+      if (Peek(1) == '=') {
+        Advance(2);
+        kind = TokenKind::kNotEquals;
+      } else {
+        Advance();
+        kind = TokenKind::kExclam;
+      }
+      return true;
+    case '<':
+      if (Peek(1) == '=') {
+        Advance(2);
+        kind = TokenKind::kLessEquals;
+      } else {
+        Advance();
+        kind = TokenKind::kLess;
+      }
+      return true;
+    case '>':
+      if (Peek(1) == '=') {
+        Advance(2);
+        kind = TokenKind::kGreaterEquals;
+      } else {
+        Advance();
+        kind = TokenKind::kGreater;
+      }
+      return true;
+    case '&':
+      if (Peek(1) != '&') {
+        return false;
+      }
+      Advance(2);
+      kind = TokenKind::kLogicalAnd;
+      return true;
+    case '|':
+      if (Peek(1) != '|') {
+        return false;
+      }
+      Advance(2);
+      kind = TokenKind::kLogicalOr;
+      return true;
+    case '[':
+      kind = TokenKind::kLBracket;
+      break;
+    case ']':
+      kind = TokenKind::kRBracket;
+      break;
+    case '{':
+      kind = TokenKind::kLBrace;
+      break;
+    case '}':
+      kind = TokenKind::kRBrace;
+      break;
+    case '(':
+      kind = TokenKind::kLParen;
+      break;
+    case ')':
+      kind = TokenKind::kRParen;
+      break;
+    case '.':
+      if (IsDigit(Peek(1))) {
+        return LexNumber(kind);
+      }
+      kind = TokenKind::kDot;
+      break;
+    case ',':
+      kind = TokenKind::kComma;
+      break;
+    case '-':
+      kind = TokenKind::kMinus;
+      break;
+    case '?':
+      kind = TokenKind::kQuestionMark;
+      break;
+    case ':':
+      kind = TokenKind::kColon;
+      break;
+    case '+':
+      kind = TokenKind::kPlus;
+      break;
+    case '*':
+      kind = TokenKind::kStar;
+      break;
+    case '/':
+      kind = TokenKind::kSlash;
+      break;
+    case '%':
+      kind = TokenKind::kPercent;
+      break;
+    case '"':
+    case '\'':
+      kind = TokenKind::kString;
+      return LexString(/*raw=*/false);
+    default:
+      if (IsDigit(c)) {
+        return LexNumber(kind);
+      }
+      if ((c == 'r' || c == 'R') && IsQuote(Peek(1))) {
+        Advance();
+        kind = TokenKind::kString;
+        return LexString(/*raw=*/true);
+      }
+      if (c == 'b' || c == 'B') {
+        if (IsQuote(Peek(1))) {
+          Advance();
+          kind = TokenKind::kBytes;
+          return LexString(/*raw=*/false);
+        }
+        if ((Peek(1) == 'r' || Peek(1) == 'R') && IsQuote(Peek(2))) {
+          Advance(2);
+          kind = TokenKind::kBytes;
+          return LexString(/*raw=*/true);
+        }
+      }
+      if (IsLetter(c) || c == '_') {
+        std::string text;
+        for (c = Peek(); IsLetter(c) || IsDigit(c) || c == '_'; c = Peek()) {
+          text.push_back(static_cast<char>(c));
+          Advance();
+        }
+        if (text == "in") {
+          kind = TokenKind::kIn;
+        } else if (text == "true") {
+          kind = TokenKind::kTrue;
+        } else if (text == "false") {
+          kind = TokenKind::kFalse;
+        } else if (text == "null") {
+          kind = TokenKind::kNull;
+        } else {
+          kind = TokenKind::kIdentifier;
+        }
+        return true;
+      }
+      return false;
+  }
+  Advance();
+  return true;
+}
+
+bool Lexer::LexNumber(TokenKind& kind) {
+  if (Peek() == '.') {
+    Advance();
+    LexDigits();
+    LexExponent();
+    kind = TokenKind::kNumFloat;
+    return true;
+  }
+  if (Peek() == '0' && Peek(1) == 'x' && IsHexDigit(Peek(2))) {
+    Advance(2);
+    while (IsHexDigit(Peek())) {
+      Advance();
+    }
+  } else {
+    LexDigits();
+    if (Peek() == '.' && IsDigit(Peek(1))) {
+      Advance();
+      LexDigits();
+      LexExponent();
+      kind = TokenKind::kNumFloat;
+      return true;
+    }
+    if (LexExponent()) {
+      kind = TokenKind::kNumFloat;
+      return true;
+    }
+  }
+  if (Peek() == 'u' || Peek() == 'U') {
+    Advance();
+    kind = TokenKind::kNumUint;
+  } else {
+    kind = TokenKind::kNumInt;
+  }
+  return true;
+}
+
+bool Lexer::LexExponent() {
+  if (Peek() != 'e' && Peek() != 'E') {
+    return false;
+  }
+  SourcePosition digits = Peek(1) == '+' || Peek(1) == '-' ? 2 : 1;
+  if (!IsDigit(Peek(digits))) {
+    return false;
+  }
+  Advance(digits);
+  LexDigits();
+  return true;
+}
+
+void Lexer::LexDigits() {
+  while (IsDigit(Peek())) {
+    Advance();
+  }
+}
+
+bool Lexer::LexString(bool raw) {
+  const char32_t quote = Peek();
+  if (Peek(1) == quote && Peek(2) == quote) {
+    Advance(3);
+    for (char32_t c = Peek(); c != kEndOfInput; c = Peek()) {
+      if (c == quote && Peek(1) == quote && Peek(2) == quote) {
+        Advance(3);
+        return true;
+      }
+      if (c == '\\' && !raw) {
+        if (!LexEscape()) {
+          return false;
+        }
+      } else {
+        Advance();
+      }
+    }
+    return false;
+  }
+  Advance();
+  for (char32_t c = Peek(); c != '\n' && c != '\r' && c != kEndOfInput;
+       c = Peek()) {
+    if (c == quote) {
+      Advance();
+      return true;
+    }
+    if (c == '\\' && !raw) {
+      if (!LexEscape()) {
+        return false;
+      }
+    } else {
+      Advance();
+    }
+  }
+  return false;
+}
+
+bool Lexer::LexEscape() {
+  SourcePosition hex_digits = 0;
+  switch (Peek(1)) {
+    case 'a':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+    case 'v':
+    case '"':
+    case '\'':
+    case '\\':
+    case '?':
+    case '`':
+      Advance(2);
+      return true;
+    case 'x':
+    case 'X':
+      hex_digits = 2;
+      break;
+    case 'u':
+      hex_digits = 4;
+      break;
+    case 'U':
+      hex_digits = 8;
+      break;
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+      if (Peek(2) < '0' || Peek(2) > '7' || Peek(3) < '0' || Peek(3) > '7') {
+        return false;
+      }
+      Advance(4);
+      return true;
+    default:
+      return false;
+  }
+  for (SourcePosition i = 0; i < hex_digits; ++i) {
+    if (!IsHexDigit(Peek(2 + i))) {
+      return false;
+    }
+  }
+  Advance(2 + hex_digits);
+  return true;
+}
+
+// Precedence of the binary operators of the relation and calc rules, or zero
+// for other tokens.
+int BinaryPrecedence(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kEquals:
+    case TokenKind::kNotEquals:
+    case TokenKind::kIn:
+    case TokenKind::kLess:
+    case TokenKind::kLessEquals:
+    case TokenKind::kGreaterEquals:
+    case TokenKind::kGreater:
+      return 1;
+    case TokenKind::kPlus:
+    case TokenKind::kMinus:
+      return 2;
+    case TokenKind::kStar:
+    case TokenKind::kSlash:
+    case TokenKind::kPercent:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+const char* BinaryOperator(TokenKind kind) {
+  switch (kind) {
+    case TokenKind::kEquals:
+      return CelOperator::EQUALS;
+    case TokenKind::kNotEquals:
+      return CelOperator::NOT_EQUALS;
+    case TokenKind::kIn:
+      return CelOperator::IN;
+    case TokenKind::kLess:
+      return CelOperator::LESS;
+    case TokenKind::kLessEquals:
+      return CelOperator::LESS_EQUALS;
+    case TokenKind::kGreaterEquals:
+      return CelOperator::GREATER_EQUALS;
+    case TokenKind::kGreater:
+      return CelOperator::GREATER;
+    case TokenKind::kPlus:
+      return CelOperator::ADD;
+    case TokenKind::kMinus:
+      return CelOperator::SUBTRACT;
+    case TokenKind::kStar:
+      return CelOperator::MULTIPLY;
+    case TokenKind::kSlash:
+      return CelOperator::DIVIDE;
+    case TokenKind::kPercent:
+    default:
+      return CelOperator::MODULO;
+  }
+}
+
+// Recursive descent parser for the grammar rules in Cel.g4, with precedence
+// climbing for the left-recursive relation and calc rules.
+//
+// Ids are assigned, and macros expanded, in the order the ANTLR parse tree
+// visitor does, so the resulting expressions are identical. Any error ends
+// parsing: the ANTLR parser is relied upon to report it.
+class Parser final {
+ public:
+  Parser(SourceContentView content, absl::string_view expression,
+         std::vector<Token> tokens, const std::vector<cel::Macro>& macros,
+         const cel::ParserOptions& options)
+      : content_(content),
+        tokens_(std::move(tokens)),
+        sf_(std::make_shared<SourceFactory>(expression)),
+        max_recursion_depth_(options.max_recursion_depth),
+        add_macro_calls_(options.add_macro_calls),
+        enable_optional_syntax_(options.enable_optional_syntax) {
+    for (const auto& m : macros) {
+      macros_.emplace(m.key(), m);
+    }
+  }
+
+  // Returns false if the tokens are not an expression.
+  bool Parse(Expr& expr);
+
+  const SourceFactory& source_factory() const { return *sf_; }
+
+ private:
+  struct Subexpr {
+    Expr expr;
+    // Number of nested frames the ANTLR parse tree visitor needs to visit the
+    // subexpression, which max_recursion_depth limits.
+    int height = 0;
+  };
+
+  const Token& Peek(size_t offset = 0) const {
+    return tokens_[std::min(pos_ + offset, tokens_.size() - 1)];
+  }
+
+  const Token& Next() {
+    const Token& token = Peek();
+    if (token.kind != TokenKind::kEof) {
+      ++pos_;
+    }
+    return token;
+  }
+
+  bool Consume(TokenKind kind) {
+    if (Peek().kind != kind) {
+      return false;
+    }
+    ++pos_;
+    return true;
+  }
+
+  int64_t Id(const Token& token) {
+    return sf_->Id(token.line, token.col, token.stop);
+  }
+
+  std::string Text(const Token& token) const {
+    return content_.ToString(token.start, token.stop + 1);
+  }
+
+  // expr
+  bool ParseExpr(Subexpr& out);
+  bool ParseConditional(Subexpr& out);
+  // conditionalOr and conditionalAnd
+  bool ParseConditionalOr(Subexpr& out);
+  bool ParseConditionalAnd(Subexpr& out);
+  // relation and calc
+  bool ParseBinary(int min_precedence, Subexpr& out);
+  // unary
+  bool ParseUnary(Subexpr& out);
+  // member
+  bool ParseMember(Subexpr& out);
+  bool ParseSelectOrCall(const Token& start, Subexpr& operand);
+  bool ParseIndex(Subexpr& operand);
+  // primary
+  bool ParsePrimary(Subexpr& out);
+  bool ParseIdentOrMessage(Subexpr& out);
+  bool ParseFieldInitializers(std::vector<Expr::CreateStruct::Entry>& entries,
+                              int& height);
+  bool ParseList(Subexpr& out);
+  bool ParseMap(Subexpr& out);
+  bool ParseArgs(std::vector<Expr>& args, int& height);
+  // literal
+  bool ParseNumber(const Token* sign, const Token& number, Subexpr& out);
+  bool ParseLiteral(Subexpr& out);
+
+  // Returns the index of the ':' ending the map key starting at the current
+  // token, or zero if there is none.
+  size_t FindMapKeyEnd() const;
+
+  // The arguments are moved into the call, so that building the AST copies no
+  // subexpressions and memory stays linear in its size.
+  Expr GlobalCallOrMacro(int64_t expr_id, const std::string& function,
+                         std::vector<Expr> args);
+  Expr ReceiverCallOrMacro(int64_t expr_id, const std::string& function,
+                           Expr target, std::vector<Expr> args);
+
+  const SourceContentView content_;
+  const std::vector<Token> tokens_;
+  size_t pos_ = 0;
+  std::shared_ptr<SourceFactory> sf_;
+  std::map<std::string, cel::Macro> macros_;
+  // Number of nested expr rules, which the ANTLR parser limits to
+  // max_recursion_depth.
+  int expr_depth_ = 0;
+  const int max_recursion_depth_;
+  const bool add_macro_calls_;
+  const bool enable_optional_syntax_;
+};
+
+bool Parser::Parse(Expr& expr) {
+  Subexpr root;
+  if (!ParseExpr(root) || Peek().kind != TokenKind::kEof) {
+    return false;
+  }
+  // Macros report invalid arguments as errors.
+  if (!sf_->errors().empty() || root.height > max_recursion_depth_) {
+    return false;
+  }
+  expr = std::move(root.expr);
+  return true;
+}
+
+bool Parser::ParseExpr(Subexpr& out) {
+  if (expr_depth_ >= max_recursion_depth_) {
+    return false;
+  }
+  ++expr_depth_;
+  bool parsed = ParseConditional(out);
+  --expr_depth_;
+  return parsed;
+}
+
+bool Parser::ParseConditional(Subexpr& out) {
+  if (!ParseConditionalOr(out)) {
+    return false;
+  }
+  if (Peek().kind != TokenKind::kQuestionMark) {
+    return true;
+  }
+  int64_t op_id = Id(Next());
+  Subexpr if_true;
+  Subexpr if_false;
+  if (!ParseConditionalOr(if_true) || !Consume(TokenKind::kColon) ||
+      !ParseExpr(if_false)) {
+    return false;
+  }
+  out.height =
+      1 + std::max({out.height, if_true.height, if_false.height});
+  out.expr = GlobalCallOrMacro(
+      op_id, CelOperator::CONDITIONAL,
+      {std::move(out.expr), std::move(if_true.expr), std::move(if_false.expr)});
+  return true;
+}
+
+bool Parser::ParseConditionalOr(Subexpr& out) {
+  if (!ParseConditionalAnd(out)) {
+    return false;
+  }
+  if (Peek().kind != TokenKind::kLogicalOr) {
+    return true;
+  }
+  ExpressionBalancer balancer(sf_, CelOperator::LOGICAL_OR,
+                              std::move(out.expr));
+  while (Peek().kind == TokenKind::kLogicalOr) {
+    const Token& op = Next();
+    Subexpr term;
+    if (!ParseConditionalAnd(term)) {
+      return false;
+    }
+    out.height = std::max(out.height, term.height);
+    balancer.AddTerm(Id(op), std::move(term.expr));
+  }
+  out.expr = balancer.Balance();
+  out.height += 1;
+  return true;
+}
+
+bool Parser::ParseConditionalAnd(Subexpr& out) {
+  if (!ParseBinary(1, out)) {
+    return false;
+  }
+  if (Peek().kind != TokenKind::kLogicalAnd) {
+    return true;
+  }
+  ExpressionBalancer balancer(sf_, CelOperator::LOGICAL_AND,
+                              std::move(out.expr));
+  while (Peek().kind == TokenKind::kLogicalAnd) {
+    const Token& op = Next();
+    Subexpr term;
+    if (!ParseBinary(1, term)) {
+      return false;
+    }
+    out.height = std::max(out.height, term.height);
+    balancer.AddTerm(Id(op), std::move(term.expr));
+  }
+  out.expr = balancer.Balance();
+  out.height += 1;
+  return true;
+}
+
+bool Parser::ParseBinary(int min_precedence, Subexpr& out) {
+  if (!ParseUnary(out)) {
+    return false;
+  }
+  for (;;) {
+    TokenKind kind = Peek().kind;
+    int precedence = BinaryPrecedence(kind);
+    if (precedence < min_precedence) {
+      return true;
+    }
+    int64_t op_id = Id(Next());
+    Subexpr rhs;
+    if (!ParseBinary(precedence + 1, rhs)) {
+      return false;
+    }
+    out.height = 1 + std::max(out.height, rhs.height);
+    out.expr = GlobalCallOrMacro(op_id, BinaryOperator(kind),
+                                 {std::move(out.expr), std::move(rhs.expr)});
+  }
+}
+
+bool Parser::ParseUnary(Subexpr& out) {
+  const Token& op = Peek();
+  if (op.kind != TokenKind::kExclam && op.kind != TokenKind::kMinus) {
+    return ParseMember(out);
+  }
+  size_t count = 1;
+  while (Peek(count).kind == op.kind) {
+    ++count;
+  }
+  if (op.kind == TokenKind::kMinus &&
+      (Peek(count).kind == TokenKind::kNumInt ||
+       Peek(count).kind == TokenKind::kNumFloat)) {
+    // A single minus sign is the sign of the literal. Repeated signs, or a
+    // signed literal with a member suffix, are ambiguous in the grammar and
+    // left to ANTLR.
+    TokenKind suffix = Peek(count + 1).kind;
+    if (count > 1 || suffix == TokenKind::kDot ||
+        suffix == TokenKind::kLBracket) {
+      return false;
+    }
+    return ParseMember(out);
+  }
+  pos_ += count;
+  int64_t op_id = count % 2 == 1 ? Id(op) : 0;
+  if (!ParseMember(out)) {
+    return false;
+  }
+  out.height += 1;
+  if (count % 2 == 1) {
+    out.expr = GlobalCallOrMacro(
+        op_id,
+        op.kind == TokenKind::kExclam ? CelOperator::LOGICAL_NOT
+                                      : CelOperator::NEGATE,
+        {std::move(out.expr)});
+  }
+  return true;
+}
+
+bool Parser::ParseMember(Subexpr& out) {
+  const Token& start = Peek();
+  if (!ParsePrimary(out)) {
+    return false;
+  }
+  for (;;) {
+    switch (Peek().kind) {
+      case TokenKind::kDot:
+        if (!ParseSelectOrCall(start, out)) {
+          return false;
+        }
+        break;
+      case TokenKind::kLBracket:
+        if (!ParseIndex(out)) {
+          return false;
+        }
+        break;
+      default:
+        return true;
+    }
+  }
+}
+
+bool Parser::ParseSelectOrCall(const Token& start, Subexpr& operand) {
+  const Token& op = Next();
+  bool optional = Consume(TokenKind::kQuestionMark);
+  const Token& id = Peek();
+  if (!Consume(TokenKind::kIdentifier)) {
+    return false;
+  }
+  std::string field = Text(id);
+  if (!optional && Peek().kind == TokenKind::kLParen) {
+    int64_t op_id = Id(Next());
+    std::vector<Expr> args;
+    if (!ParseArgs(args, operand.height)) {
+      return false;
+    }
+    operand.height += 1;
+    operand.expr = ReceiverCallOrMacro(op_id, field, std::move(operand.expr),
+                                       std::move(args));
+    return true;
+  }
+  Expr expr;
+  if (optional) {
+    if (!enable_optional_syntax_) {
+      return false;
+    }
+    int64_t op_id = Id(op);
+    // The field name is positioned at the start of the member expression.
+    Expr field_name = sf_->NewExpr(Id(start));
+    field_name.mutable_const_expr()->set_string_value(std::move(field));
+    expr = sf_->NewGlobalCall(op_id, std::string(CelOperator::OPT_SELECT),
+                              {std::move(operand.expr), std::move(field_name)});
+  } else {
+    expr = sf_->NewExpr(Id(op));
+    auto* select_expr = expr.mutable_select_expr();
+    *select_expr->mutable_operand() = std::move(operand.expr);
+    select_expr->set_field(std::move(field));
+  }
+  operand.expr = std::move(expr);
+  operand.height += 1;
+  return true;
+}
+
+bool Parser::ParseIndex(Subexpr& operand) {
+  int64_t op_id = Id(Next());
+  bool optional = Consume(TokenKind::kQuestionMark);
+  Subexpr index;
+  if (!ParseExpr(index) || !Consume(TokenKind::kRBracket) ||
+      (optional && !enable_optional_syntax_)) {
+    return false;
+  }
+  operand.height = 1 + std::max(operand.height, index.height);
+  operand.expr = GlobalCallOrMacro(
+      op_id,
+      optional ? std::string(CelOperator::OPT_INDEX) : CelOperator::INDEX,
+      {std::move(operand.expr), std::move(index.expr)});
+  return true;
+}
+
+bool Parser::ParsePrimary(Subexpr& out) {
+  const Token& token = Peek();
+  switch (token.kind) {
+    case TokenKind::kMinus: {
+      const Token& number = Peek(1);
+      if (number.kind != TokenKind::kNumInt &&
+          number.kind != TokenKind::kNumFloat) {
+        return false;
+      }
+      pos_ += 2;
+      return ParseNumber(&token, number, out);
+    }
+    case TokenKind::kNumInt:
+    case TokenKind::kNumUint:
+    case TokenKind::kNumFloat:
+      ++pos_;
+      return ParseNumber(nullptr, token, out);
+    case TokenKind::kString:
+    case TokenKind::kBytes:
+    case TokenKind::kTrue:
+    case TokenKind::kFalse:
+    case TokenKind::kNull:
+      return ParseLiteral(out);
+    case TokenKind::kDot:
+    case TokenKind::kIdentifier:
+      return ParseIdentOrMessage(out);
+    case TokenKind::kLParen:
+      ++pos_;
+      return ParseExpr(out) && Consume(TokenKind::kRParen);
+    case TokenKind::kLBracket:
+      return ParseList(out);
+    case TokenKind::kLBrace:
+      return ParseMap(out);
+    default:
+      return false;
+  }
+}
+
+bool Parser::ParseIdentOrMessage(Subexpr& out) {
+  bool leading_dot = Consume(TokenKind::kDot);
+  if (Peek().kind != TokenKind::kIdentifier) {
+    return false;
+  }
+  // A qualified name followed by '{' creates a message.
+  size_t last = 0;
+  while (Peek(last + 1).kind == TokenKind::kDot &&
+         Peek(last + 2).kind == TokenKind::kIdentifier) {
+    last += 2;
+  }
+  if (Peek(last + 1).kind == TokenKind::kLBrace) {
+    std::string name = leading_dot ? "." : "";
+    for (size_t i = 0; i <= last; i += 2) {
+      if (i != 0) {
+        name.push_back('.');
+      }
+      name.append(Text(Peek(i)));
+    }
+    const Token& brace = Peek(last + 1);
+    pos_ += last + 2;
+    int64_t obj_id = Id(brace);
+    std::vector<Expr::CreateStruct::Entry> entries;
+    out.height = 0;
+    if (!ParseFieldInitializers(entries, out.height)) {
+      return false;
+    }
+    out.expr = sf_->NewObject(obj_id, name, std::move(entries));
+    out.height += 1;
+    return true;
+  }
+
+  const Token& id = Next();
+  std::string name = Text(id);
+  if (sf_->IsReserved(name)) {
+    return false;
+  }
+  if (leading_dot) {
+    name.insert(0, ".");
+  }
+  if (Peek().kind == TokenKind::kLParen) {
+    int64_t op_id = Id(Next());
+    std::vector<Expr> args;
+    out.height = 0;
+    if (!ParseArgs(args, out.height)) {
+      return false;
+    }
+    out.expr = GlobalCallOrMacro(op_id, name, std::move(args));
+    out.height += 1;
+    return true;
+  }
+  out.expr = sf_->NewExpr(Id(id));
+  out.expr.mutable_ident_expr()->set_name(std::move(name));
+  out.height = 1;
+  return true;
+}
+
+bool Parser::ParseFieldInitializers(
+    std::vector<Expr::CreateStruct::Entry>& entries, int& height) {
+  if (Consume(TokenKind::kRBrace)) {
+    return true;
+  }
+  if (Consume(TokenKind::kComma)) {
+    return Consume(TokenKind::kRBrace);
+  }
+  for (;;) {
+    bool optional = Consume(TokenKind::kQuestionMark);
+    const Token& field = Peek();
+    if (!Consume(TokenKind::kIdentifier) || Peek().kind != TokenKind::kColon ||
+        (optional && !enable_optional_syntax_)) {
+      return false;
+    }
+    int64_t init_id = Id(Next());
+    Subexpr value;
+    if (!ParseExpr(value)) {
+      return false;
+    }
+    height = std::max(height, value.height);
+    entries.push_back(
+        sf_->NewObjectField(init_id, Text(field), std::move(value.expr),
+                            optional));
+    if (!Consume(TokenKind::kComma)) {
+      return Consume(TokenKind::kRBrace);
+    }
+    if (Consume(TokenKind::kRBrace)) {
+      return true;
+    }
+  }
+}
+
+bool Parser::ParseList(Subexpr& out) {
+  int64_t list_id = Id(Next());
+  std::vector<Expr> elements;
+  std::vector<int64_t> optional_indices;
+  out.height = 0;
+  if (Consume(TokenKind::kComma)) {
+    if (!Consume(TokenKind::kRBracket)) {
+      return false;
+    }
+  } else if (!Consume(TokenKind::kRBracket)) {
+    for (;;) {
+      bool optional = Consume(TokenKind::kQuestionMark);
+      if (optional && !enable_optional_syntax_) {
+        return false;
+      }
+      Subexpr element;
+      if (!ParseExpr(element)) {
+        return false;
+      }
+      if (optional) {
+        optional_indices.push_back(static_cast<int64_t>(elements.size()));
+      }
+      out.height = std::max(out.height, element.height);
+      elements.push_back(std::move(element.expr));
+      if (!Consume(TokenKind::kComma)) {
+        if (!Consume(TokenKind::kRBracket)) {
+          return false;
+        }
+        break;
+      }
+      if (Consume(TokenKind::kRBracket)) {
+        break;
+      }
+    }
+  }
+  out.expr = sf_->NewList(list_id, std::move(elements), optional_indices);
+  out.height += 1;
+  return true;
+}
+
+bool Parser::ParseMap(Subexpr& out) {
+  int64_t struct_id = Id(Next());
+  std::vector<Expr::CreateStruct::Entry> entries;
+  out.height = 0;
+  if (Consume(TokenKind::kComma)) {
+    if (!Consume(TokenKind::kRBrace)) {
+      return false;
+    }
+  } else if (!Consume(TokenKind::kRBrace)) {
+    for (;;) {
+      bool optional = Consume(TokenKind::kQuestionMark);
+      // The visitor assigns the id of the ':' before visiting the key.
+      size_t colon = FindMapKeyEnd();
+      if (colon == 0 || (optional && !enable_optional_syntax_)) {
+        return false;
+      }
+      int64_t col_id = Id(tokens_[colon]);
+      Subexpr key;
+      if (!ParseExpr(key) || pos_ != colon) {
+        return false;
+      }
+      ++pos_;
+      Subexpr value;
+      if (!ParseExpr(value)) {
+        return false;
+      }
+      out.height = std::max({out.height, key.height, value.height});
+      entries.push_back(sf_->NewMapEntry(col_id, std::move(key.expr),
+                                         std::move(value.expr), optional));
+      if (!Consume(TokenKind::kComma)) {
+        if (!Consume(TokenKind::kRBrace)) {
+          return false;
+        }
+        break;
+      }
+      if (Consume(TokenKind::kRBrace)) {
+        break;
+      }
+    }
+  }
+  out.expr = sf_->NewMap(struct_id, std::move(entries));
+  out.height += 1;
+  return true;
+}
+
+bool Parser::ParseArgs(std::vector<Expr>& args, int& height) {
+  if (Consume(TokenKind::kRParen)) {
+    return true;
+  }
+  for (;;) {
+    Subexpr arg;
+    if (!ParseExpr(arg)) {
+      return false;
+    }
+    height = std::max(height, arg.height);
+    args.push_back(std::move(arg.expr));
+    if (!Consume(TokenKind::kComma)) {
+      return Consume(TokenKind::kRParen);
+    }
+  }
+}
+
+bool Parser::ParseNumber(const Token* sign, const Token& number,
+                         Subexpr& out) {
+  std::string text = Text(number);
+  std::string value = sign != nullptr ? "-" + text : text;
+  bool hex = absl::StartsWith(text, "0x");
+  out.expr = Expr();
+  auto* const_expr = out.expr.mutable_const_expr();
+  switch (number.kind) {
+    case TokenKind::kNumInt: {
+      int64_t int_value;
+      if (!(hex ? absl::SimpleHexAtoi(value, &int_value)
+                : absl::SimpleAtoi(value, &int_value))) {
+        return false;
+      }
+      const_expr->set_int64_value(int_value);
+      break;
+    }
+    case TokenKind::kNumUint: {
+      // Trim the 'u' designator.
+      value.pop_back();
+      uint64_t uint_value;
+      if (!(hex ? absl::SimpleHexAtoi(value, &uint_value)
+                : absl::SimpleAtoi(value, &uint_value))) {
+        return false;
+      }
+      const_expr->set_uint64_value(uint_value);
+      break;
+    }
+    default: {
+      double double_value;
+      if (!absl::SimpleAtod(value, &double_value)) {
+        return false;
+      }
+      const_expr->set_double_value(double_value);
+      break;
+    }
+  }
+  out.expr.set_id(Id(sign != nullptr ? *sign : number));
+  out.height = 1;
+  return true;
+}
+
+bool Parser::ParseLiteral(Subexpr& out) {
+  const Token& token = Next();
+  out.expr = Expr();
+  auto* const_expr = out.expr.mutable_const_expr();
+  switch (token.kind) {
+    case TokenKind::kString: {
+      auto value = cel::internal::ParseStringLiteral(Text(token));
+      if (!value.ok()) {
+        return false;
+      }
+      const_expr->set_string_value(*std::move(value));
+      break;
+    }
+    case TokenKind::kBytes: {
+      auto value = cel::internal::ParseBytesLiteral(Text(token));
+      if (!value.ok()) {
+        return false;
+      }
+      const_expr->set_bytes_value(*std::move(value));
+      break;
+    }
+    case TokenKind::kTrue:
+      const_expr->set_bool_value(true);
+      break;
+    case TokenKind::kFalse:
+      const_expr->set_bool_value(false);
+      break;
+    default:
+      const_expr->set_null_value(::google::protobuf::NULL_VALUE);
+      break;
+  }
+  out.expr.set_id(Id(token));
+  out.height = 1;
+  return true;
+}
+
+size_t Parser::FindMapKeyEnd() const {
+  int depth = 0;
+  int conditionals = 0;
+  for (size_t i = pos_; i < tokens_.size(); ++i) {
+    switch (tokens_[i].kind) {
+      case TokenKind::kLParen:
+      case TokenKind::kLBracket:
+      case TokenKind::kLBrace:
+        ++depth;
+        break;
+      case TokenKind::kRParen:
+      case TokenKind::kRBracket:
+      case TokenKind::kRBrace:
+        if (depth == 0) {
+          return 0;
+        }
+        --depth;
+        break;
+      case TokenKind::kQuestionMark:
+        // Outside of brackets, '?' is either an optional select or starts a
+        // conditional.
+        if (depth == 0 && tokens_[i - 1].kind != TokenKind::kDot) {
+          ++conditionals;
+        }
+        break;
+      case TokenKind::kColon:
+        if (depth == 0) {
+          if (conditionals == 0) {
+            return i;
+          }
+          --conditionals;
+        }
+        break;
+      case TokenKind::kComma:
+        if (depth == 0) {
+          return 0;
+        }
+        break;
+      case TokenKind::kEof:
+        return 0;
+      default:
+        break;
+    }
+  }
+  return 0;
+}
+
+Expr Parser::GlobalCallOrMacro(int64_t expr_id, const std::string& function,
+                               std::vector<Expr> args) {
+  Expr macro_expr;
+  if (ExpandMacro(sf_, macros_, add_macro_calls_, expr_id, function,
+                  Expr::default_instance(), args, &macro_expr)) {
+    return macro_expr;
+  }
+  return sf_->NewGlobalCall(expr_id, function, std::move(args));
+}
+
+Expr Parser::ReceiverCallOrMacro(int64_t expr_id, const std::string& function,
+                                 Expr target, std::vector<Expr> args) {
+  Expr macro_expr;
+  if (ExpandMacro(sf_, macros_, add_macro_calls_, expr_id, function, target,
+                  args, &macro_expr)) {
+    return macro_expr;
+  }
+  return sf_->NewReceiverCall(expr_id, function, std::move(target),
+                              std::move(args));
+}
+
+}  // namespace
+
+absl::optional<RecursiveDescentParseResult> RecursiveDescentParse(
+    SourceContentView content, absl::string_view expression,
+    const std::vector<cel::Macro>& macros, const cel::ParserOptions& options) {
+  std::vector<Token> tokens;
+  if (!Lexer(content).Tokenize(tokens)) {
+    return absl::nullopt;
+  }
+  Parser parser(content, expression, std::move(tokens), macros, options);
+  Expr expr;
+  if (!parser.Parse(expr)) {
+    return absl::nullopt;
+  }
+  RecursiveDescentParseResult result{
+      google::api::expr::v1alpha1::ParsedExpr(),
+      parser.source_factory().enriched_source_info()};
+  *result.parsed_expr.mutable_expr() = std::move(expr);
+  *result.parsed_expr.mutable_source_info() =
+      parser.source_factory().source_info();
+  return result;
+}
+
+}  // namespace cel_parser_internal
@@ -0,0 +1,51 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_RECURSIVE_DESCENT_PARSER_H_
+#define THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_RECURSIVE_DESCENT_PARSER_H_
+
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "common/source.h"
+#include "parser/macro.h"
+#include "parser/options.h"
+#include "parser/source_factory.h"
+
+namespace cel_parser_internal {
+
+struct RecursiveDescentParseResult {
+  google::api::expr::v1alpha1::ParsedExpr parsed_expr;
+  google::api::expr::parser::EnrichedSourceInfo enriched_source_info;
+};
+
+// Parses expression, whose code points are content, with a hand-written lexer
+// and recursive descent parser implementing the grammar in Cel.g4. The result
+// is the same as that of the ANTLR generated parser: the same expression, ids,
+// positions and macro calls.
+//
+// Returns nullopt if the expression is not accepted. This includes every
+// expression the ANTLR parser rejects, including for exceeding the recursion
+// limits, and a few valid ones whose parse ANTLR decides by prediction (such
+// as repeated minus signs before a numeric literal). The caller is expected to
+// parse those with the ANTLR parser, which also reports the errors.
+absl::optional<RecursiveDescentParseResult> RecursiveDescentParse(
+    cel::SourceContentView content, absl::string_view expression,
+    const std::vector<cel::Macro>& macros, const cel::ParserOptions& options);
+
+}  // namespace cel_parser_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_PARSER_INTERNAL_RECURSIVE_DESCENT_PARSER_H_
@@ -220,13 +220,16 @@ Macro OptMapMacro() {
         auto condition = sf->NewLiteralBoolForMacro(macro_id, false);
         auto step = sf->NewIdentForMacro(macro_id, var_name);
         const auto& result = map_expr;
-        auto fold = sf->FoldForMacro(macro_id, "#unused", iter_range, var_name,
-                                     accu_init, condition, step, result);
-        call_args[1] =
-            sf->NewGlobalCallForMacro(macro_id, "optional.of", {fold});
+        std::vector<Expr> fold;
+        fold.push_back(sf->FoldForMacro(
+            macro_id, "#unused", std::move(iter_range), var_name,
+            std::move(accu_init), std::move(condition), std::move(step),
+            result));
+        call_args[1] = sf->NewGlobalCallForMacro(macro_id, "optional.of",
+                                                 std::move(fold));
         call_args[2] = sf->NewGlobalCallForMacro(macro_id, "optional.none", {});
         return sf->NewGlobalCallForMacro(macro_id, CelOperator::CONDITIONAL,
-                                         call_args);
+                                         std::move(call_args));
       },
       true);
   return macro.get();
@@ -258,12 +261,13 @@ Macro OptFlatMapMacro() {
         auto condition = sf->NewLiteralBoolForMacro(macro_id, false);
         auto step = sf->NewIdentForMacro(macro_id, var_name);
         const auto& result = map_expr;
-        call_args[1] =
-            sf->FoldForMacro(macro_id, "#unused", iter_range, var_name,
-                             accu_init, condition, step, result);
+        call_args[1] = sf->FoldForMacro(
+            macro_id, "#unused", std::move(iter_range), var_name,
+            std::move(accu_init), std::move(condition), std::move(step),
+            result);
         call_args[2] = sf->NewGlobalCallForMacro(macro_id, "optional.none", {});
         return sf->NewGlobalCallForMacro(macro_id, CelOperator::CONDITIONAL,
-                                         call_args);
+                                         std::move(call_args));
       },
       true);
   return macro.get();
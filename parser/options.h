@@ -47,6 +47,14 @@ struct ParserOptions final {
 
   // Enable support for optional syntax.
   bool enable_optional_syntax = false;
+
+  // Parse with the hand-written recursive descent parser rather than the ANTLR
+  // generated parser. The result is the same, but much cheaper to produce:
+  // no parse tree is built, so memory stays linear in the size of the AST,
+  // which matters for large generated expressions. Expressions it does not
+  // accept, which includes all invalid expressions, are parsed again by the
+  // ANTLR parser, which reports the errors.
+  bool enable_recursive_descent_parser = false;
 };
 
 }  // namespace cel
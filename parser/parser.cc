@@ -37,12 +37,16 @@
 #include "absl/types/optional.h"
 #include "antlr4-runtime.h"
 #include "common/operators.h"
+#include "base/ast.h"
 #include "common/source.h"
+#include "extensions/protobuf/ast_converters.h"
 #include "internal/status_macros.h"
 #include "internal/strings.h"
 #include "parser/internal/CelBaseVisitor.h"
 #include "parser/internal/CelLexer.h"
 #include "parser/internal/CelParser.h"
+#include "parser/internal/parser_helper.h"
+#include "parser/internal/recursive_descent_parser.h"
 #include "parser/macro.h"
 #include "parser/options.h"
 #include "parser/source_factory.h"
@@ -65,6 +69,8 @@ using ::antlr4::tree::TerminalNode;
 using ::cel_parser_internal::CelBaseVisitor;
 using ::cel_parser_internal::CelLexer;
 using ::cel_parser_internal::CelParser;
+using ::cel_parser_internal::ExpandMacro;
+using ::cel_parser_internal::ExpressionBalancer;
 using common::CelOperator;
 using common::ReverseLookupOperator;
 using ::google::api::expr::v1alpha1::Expr;
@@ -158,79 +164,6 @@ class ScopedIncrement final {
   int& recursion_depth_;
 };
 
-// balancer performs tree balancing on operators whose arguments are of equal
-// precedence.
-//
-// The purpose of the balancer is to ensure a compact serialization format for
-// the logical &&, || operators which have a tendency to create long DAGs which
-// are skewed in one direction. Since the operators are commutative re-ordering
-// the terms *must not* affect the evaluation result.
-//
-// Based on code from //third_party/cel/go/parser/helper.go
-class ExpressionBalancer final {
- public:
-  ExpressionBalancer(std::shared_ptr<SourceFactory> sf, std::string function,
-                     Expr expr);
-
-  // addTerm adds an operation identifier and term to the set of terms to be
-  // balanced.
-  void AddTerm(int64_t op, Expr term);
-
-  // balance creates a balanced tree from the sub-terms and returns the final
-  // Expr value.
-  Expr Balance();
-
- private:
-  // balancedTree recursively balances the terms provided to a commutative
-  // operator.
-  Expr BalancedTree(int lo, int hi);
-
- private:
-  std::shared_ptr<SourceFactory> sf_;
-  std::string function_;
-  std::vector<Expr> terms_;
-  std::vector<int64_t> ops_;
-};
-
-ExpressionBalancer::ExpressionBalancer(std::shared_ptr<SourceFactory> sf,
-                                       std::string function, Expr expr)
-    : sf_(std::move(sf)),
-      function_(std::move(function)),
-      terms_{std::move(expr)},
-      ops_{} {}
-
-void ExpressionBalancer::AddTerm(int64_t op, Expr term) {
-  terms_.push_back(std::move(term));
-  ops_.push_back(op);
-}
-
-Expr ExpressionBalancer::Balance() {
-  if (terms_.size() == 1) {
-    return terms_[0];
-  }
-  return BalancedTree(0, ops_.size() - 1);
-}
-
-Expr ExpressionBalancer::BalancedTree(int lo, int hi) {
-  int mid = (lo + hi + 1) / 2;
-
-  Expr left;
-  if (mid == lo) {
-    left = terms_[mid];
-  } else {
-    left = BalancedTree(lo, mid - 1);
-  }
-
-  Expr right;
-  if (mid == hi) {
-    right = terms_[mid + 1];
-  } else {
-    right = BalancedTree(mid + 1, hi);
-  }
-  return sf_->NewGlobalCall(ops_[mid], function_,
-                            {std::move(left), std::move(right)});
-}
-
 class ParserVisitor final : public CelBaseVisitor,
                             public antlr4::BaseErrorListener {
  public:
@@ -299,9 +232,6 @@ class ParserVisitor final : public CelBaseVisitor,
                          const std::vector<Expr>& args);
   Expr ReceiverCallOrMacro(int64_t expr_id, const std::string& function,
                            const Expr& target, const std::vector<Expr>& args);
-  bool ExpandMacro(int64_t expr_id, const std::string& function,
-                   const Expr& target, const std::vector<Expr>& args,
-                   Expr* macro_expr);
   std::string ExtractQualifiedName(antlr4::ParserRuleContext* ctx,
                                    const Expr* e);
   // Attempt to unnest parse context.
@@ -675,7 +605,7 @@ antlrcpp::Any ParserVisitor::visitCreateMessage(
   int64_t obj_id = sf_->Id(ctx->op);
   auto entries = std::any_cast<std::vector<Expr::CreateStruct::Entry>>(
       visitFieldInitializerList(ctx->entries));
-  return sf_->NewObject(obj_id, name, entries);
+  return sf_->NewObject(obj_id, name, std::move(entries));
 }
 
 antlrcpp::Any ParserVisitor::visitFieldInitializerList(
@@ -744,7 +674,7 @@ antlrcpp::Any ParserVisitor::visitCreateList(
   std::vector<Expr> elems;
   std::vector<int64_t> opts;
   std::tie(elems, opts) = visitList(ctx->elems);
-  return sf_->NewList(list_id, elems, opts);
+  return sf_->NewList(list_id, std::move(elems), opts);
 }
 
 std::pair<std::vector<Expr>, std::vector<int64_t>> ParserVisitor::visitList(
@@ -787,7 +717,7 @@ antlrcpp::Any ParserVisitor::visitCreateStruct(
     entries = std::any_cast<std::vector<Expr::CreateStruct::Entry>>(
         visitMapInitializerList(ctx->entries));
   }
-  return sf_->NewMap(struct_id, entries);
+  return sf_->NewMap(struct_id, std::move(entries));
 }
 
 antlrcpp::Any ParserVisitor::visitConstantLiteral(
@@ -830,7 +760,8 @@ antlrcpp::Any ParserVisitor::visitMapInitializerList(
     }
     key = std::any_cast<Expr>(visit(ctx->keys[i]->e));
     auto value = std::any_cast<Expr>(visit(ctx->values[i]));
-    res[i] = sf_->NewMapEntry(col_id, key, value, ctx->keys[i]->opt != nullptr);
+    res[i] = sf_->NewMapEntry(col_id, std::move(key), std::move(value),
+                              ctx->keys[i]->opt != nullptr);
   }
   return res;
 }
@@ -944,8 +875,8 @@ Expr ParserVisitor::GlobalCallOrMacro(int64_t expr_id,
                                       const std::string& function,
                                       const std::vector<Expr>& args) {
   Expr macro_expr;
-  if (ExpandMacro(expr_id, function, Expr::default_instance(), args,
-                  &macro_expr)) {
+  if (ExpandMacro(sf_, macros_, add_macro_calls_, expr_id, function,
+                  Expr::default_instance(), args, &macro_expr)) {
     return macro_expr;
   }
 
@@ -957,44 +888,14 @@ Expr ParserVisitor::ReceiverCallOrMacro(int64_t expr_id,
                                         const Expr& target,
                                         const std::vector<Expr>& args) {
   Expr macro_expr;
-  if (ExpandMacro(expr_id, function, target, args, &macro_expr)) {
+  if (ExpandMacro(sf_, macros_, add_macro_calls_, expr_id, function, target,
+                  args, &macro_expr)) {
     return macro_expr;
   }
 
   return sf_->NewReceiverCall(expr_id, function, target, args);
 }
 
-bool ParserVisitor::ExpandMacro(int64_t expr_id, const std::string& function,
-                                const Expr& target,
-                                const std::vector<Expr>& args,
-                                Expr* macro_expr) {
-  std::string macro_key = absl::StrFormat("%s:%d:%s", function, args.size(),
-                                          target.id() != 0 ? "true" : "false");
-  auto m = macros_.find(macro_key);
-  if (m == macros_.end()) {
-    std::string var_arg_macro_key = absl::StrFormat(
-        "%s:*:%s", function, target.id() != 0 ? "true" : "false");
-    m = macros_.find(var_arg_macro_key);
-    if (m == macros_.end()) {
-      return false;
-    }
-  }
-
-  Expr expr = m->second.Expand(sf_, expr_id, target, args);
-  if (expr.expr_kind_case() != Expr::EXPR_KIND_NOT_SET) {
-    *macro_expr = std::move(expr);
-    if (add_macro_calls_) {
-      // If the macro is nested, the full expression id is used as an argument
-      // id in the tree. Using this ID instead of expr_id allows argument id
-      // lookups in macro_calls when building the map and iterating
-      // the AST.
-      sf_->AddMacroCall(macro_expr->id(), target, args, function);
-    }
-    return true;
-  }
-  return false;
-}
-
 std::string ParserVisitor::ExtractQualifiedName(antlr4::ParserRuleContext* ctx,
                                                 const Expr* e) {
   if (!e) {
@@ -1147,7 +1048,16 @@ absl::StatusOr<ParsedExpr> ParseWithMacros(absl::string_view expression,
                                            const ParserOptions& options) {
   CEL_ASSIGN_OR_RETURN(auto verbose_parsed_expr,
                        EnrichedParse(expression, macros, description, options));
-  return verbose_parsed_expr.parsed_expr();
+  return std::move(verbose_parsed_expr).parsed_expr();
+}
+
+absl::StatusOr<std::unique_ptr<cel::Ast>> ParseToAst(
+    absl::string_view expression, const std::vector<Macro>& macros,
+    absl::string_view description, const ParserOptions& options) {
+  CEL_ASSIGN_OR_RETURN(
+      ParsedExpr parsed_expr,
+      ParseWithMacros(expression, macros, description, options));
+  return cel::extensions::CreateAstFromParsedExpr(std::move(parsed_expr));
 }
 
 absl::StatusOr<VerboseParsedExpr> EnrichedParse(
@@ -1162,6 +1072,14 @@ absl::StatusOr<VerboseParsedExpr> EnrichedParse(
           "expression size exceeds codepoint limit.", " input size: ",
           input.size(), ", limit: ", options.expression_size_codepoint_limit));
     }
+    if (options.enable_recursive_descent_parser) {
+      auto result = cel_parser_internal::RecursiveDescentParse(
+          source->content(), expression, macros, options);
+      if (result.has_value()) {
+        return VerboseParsedExpr(std::move(result->parsed_expr),
+                                 std::move(result->enriched_source_info));
+      }
+    }
     CelLexer lexer(&input);
     CommonTokenStream tokens(&lexer);
     CelParser parser(&tokens);
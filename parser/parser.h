@@ -15,9 +15,15 @@
 #ifndef THIRD_PARTY_CEL_CPP_PARSER_PARSER_H_
 #define THIRD_PARTY_CEL_CPP_PARSER_PARSER_H_
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "google/api/expr/v1alpha1/syntax.pb.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "base/ast.h"
 #include "parser/macro.h"
 #include "parser/options.h"
 #include "parser/source_factory.h"
@@ -31,9 +37,12 @@ class VerboseParsedExpr {
       : parsed_expr_(std::move(parsed_expr)),
         enriched_source_info_(std::move(enriched_source_info)) {}
 
-  const google::api::expr::v1alpha1::ParsedExpr& parsed_expr() const {
+  const google::api::expr::v1alpha1::ParsedExpr& parsed_expr() const& {
     return parsed_expr_;
   }
+  google::api::expr::v1alpha1::ParsedExpr parsed_expr() && {
+    return std::move(parsed_expr_);
+  }
   const EnrichedSourceInfo& enriched_source_info() const {
     return enriched_source_info_;
   }
@@ -57,6 +66,14 @@ absl::StatusOr<google::api::expr::v1alpha1::ParsedExpr> ParseWithMacros(
     absl::string_view description = "<input>",
     const ParserOptions& options = ParserOptions());
 
+// Parses expression into the native AST evaluated by the runtime. The parse
+// result is moved into the AST rather than copied, so this is cheaper than
+// parsing and then calling cel::extensions::CreateAstFromParsedExpr.
+absl::StatusOr<std::unique_ptr<cel::Ast>> ParseToAst(
+    absl::string_view expression, const std::vector<Macro>& macros,
+    absl::string_view description = "<input>",
+    const ParserOptions& options = ParserOptions());
+
 }  // namespace google::api::expr::parser
 
 #endif  // THIRD_PARTY_CEL_CPP_PARSER_PARSER_H_
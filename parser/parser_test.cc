@@ -15,6 +15,7 @@
 #include "parser/parser.h"
 
 #include <list>
+#include <memory>
 #include <string>
 #include <thread>
 #include <utility>
@@ -27,8 +28,13 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/types/optional.h"
+#include "base/ast.h"
+#include "common/source.h"
+#include "extensions/protobuf/ast_converters.h"
 #include "internal/benchmark.h"
+#include "internal/proto_matchers.h"
 #include "internal/testing.h"
+#include "parser/internal/recursive_descent_parser.h"
 #include "parser/macro.h"
 #include "parser/options.h"
 #include "parser/source_factory.h"
@@ -38,10 +44,14 @@ namespace google::api::expr::parser {
 
 namespace {
 
+using ::cel::internal::test::EqualsProto;
+using ::cel_parser_internal::RecursiveDescentParse;
 using ::google::api::expr::v1alpha1::Expr;
+using ::google::api::expr::v1alpha1::ParsedExpr;
 using testing::HasSubstr;
 using testing::Not;
 using cel::internal::IsOk;
+using cel::internal::IsOkAndHolds;
 
 struct TestInfo {
   TestInfo(const std::string& I, const std::string& P,
@@ -1414,6 +1424,40 @@ TEST_P(ExpressionTest, Parse) {
   }
 }
 
+TEST_P(ExpressionTest, RecursiveDescentParser) {
+  const TestInfo& test_info = GetParam();
+  ParserOptions options;
+  if (!test_info.M.empty()) {
+    options.add_macro_calls = true;
+  }
+  options.enable_optional_syntax = true;
+
+  std::vector<Macro> macros = Macro::AllMacros();
+  macros.push_back(cel::OptMapMacro());
+  macros.push_back(cel::OptFlatMapMacro());
+  auto expected = EnrichedParse(test_info.I, macros, "<input>", options);
+  options.enable_recursive_descent_parser = true;
+  auto result = EnrichedParse(test_info.I, macros, "<input>", options);
+
+  ASSERT_EQ(result.ok(), expected.ok());
+  if (!expected.ok()) {
+    EXPECT_EQ(result.status().message(), expected.status().message());
+  } else {
+    EXPECT_THAT(result->parsed_expr(), EqualsProto(expected->parsed_expr()));
+    EXPECT_EQ(
+        ConvertEnrichedSourceInfoToString(result->enriched_source_info()),
+        ConvertEnrichedSourceInfoToString(expected->enriched_source_info()));
+  }
+
+  // Only the expressions rejected by ANTLR fall back to it.
+  auto source = cel::NewSource(test_info.I, "<input>");
+  ASSERT_THAT(source, IsOk());
+  EXPECT_EQ(RecursiveDescentParse((*source)->content(), test_info.I, macros,
+                                  options)
+                .has_value(),
+            expected.ok());
+}
+
 TEST(ExpressionTest, TsanOom) {
   Parse(
       "[[a([[???[a[[??[a([[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[["
@@ -1434,6 +1478,25 @@ TEST(ExpressionTest, TsanOom) {
       .IgnoreError();
 }
 
+TEST(ExpressionTest, ParseToAst) {
+  ParserOptions options;
+  options.add_macro_calls = true;
+  const std::string expression = "[1, 2].exists(x, x == y) && 'a'.size() > 0";
+
+  ASSERT_OK_AND_ASSIGN(ParsedExpr parsed_expr,
+                       Parse(expression, "<input>", options));
+  ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<cel::Ast> ast,
+      ParseToAst(expression, Macro::AllMacros(), "<input>", options));
+  EXPECT_FALSE(ast->IsChecked());
+  EXPECT_THAT(cel::extensions::CreateParsedExprFromAst(*ast),
+              IsOkAndHolds(EqualsProto(parsed_expr)));
+
+  auto result = ParseToAst("1 +", Macro::AllMacros());
+  EXPECT_THAT(result, Not(IsOk()));
+  EXPECT_EQ(result.status().message(), Parse("1 +").status().message());
+}
+
 TEST(ExpressionTest, ErrorRecoveryLimits) {
   ParserOptions options;
   options.error_recovery_limit = 1;
@@ -1492,6 +1555,75 @@ TEST(ExpressionTest, RecursionDepthIgnoresParentheses) {
   EXPECT_THAT(result, IsOk());
 }
 
+TEST(ExpressionTest, RecursiveDescentParserRecursionDepth) {
+  ParserOptions options;
+  options.max_recursion_depth = 6;
+  std::vector<Macro> macros = Macro::AllMacros();
+
+  // The recursive descent parser accepts exactly the expressions within the
+  // visitor's recursion limit, see the tests above.
+  const std::string within_limit = "(((1 + 2 + 3 + 4 + (5 + 6))))";
+  auto source = cel::NewSource(within_limit, "");
+  ASSERT_THAT(source, IsOk());
+  EXPECT_TRUE(RecursiveDescentParse((*source)->content(), within_limit, macros,
+                                    options)
+                  .has_value());
+
+  const std::string too_deep = "1 + 2 + 3 + 4 + 5 + 6 + 7";
+  source = cel::NewSource(too_deep, "");
+  ASSERT_THAT(source, IsOk());
+  EXPECT_FALSE(
+      RecursiveDescentParse((*source)->content(), too_deep, macros, options)
+          .has_value());
+
+  options.max_recursion_depth = 16;
+  const std::string long_list = "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10]";
+  source = cel::NewSource(long_list, "");
+  ASSERT_THAT(source, IsOk());
+  EXPECT_TRUE(
+      RecursiveDescentParse((*source)->content(), long_list, macros, options)
+          .has_value());
+
+  options.enable_recursive_descent_parser = true;
+  options.max_recursion_depth = 6;
+  auto result = Parse(too_deep, "", options);
+  EXPECT_THAT(result, Not(IsOk()));
+  EXPECT_THAT(result.status().message(),
+              HasSubstr("Exceeded max recursion depth of 6 when parsing."));
+}
+
+TEST(ExpressionTest, RecursiveDescentParserLargeExpressions) {
+  ParserOptions options;
+  std::vector<Macro> macros = Macro::AllMacros();
+
+  std::vector<std::string> elements;
+  for (int i = 0; i < 20000; ++i) {
+    elements.push_back(absl::StrCat(i));
+  }
+  const std::string list =
+      absl::StrCat("[", absl::StrJoin(elements, ", "), "]");
+  auto source = cel::NewSource(list, "");
+  ASSERT_THAT(source, IsOk());
+  auto result =
+      RecursiveDescentParse((*source)->content(), list, macros, options);
+  ASSERT_TRUE(result.has_value());
+  const auto& list_expr = result->parsed_expr.expr().list_expr();
+  ASSERT_EQ(list_expr.elements_size(), 20000);
+  EXPECT_EQ(list_expr.elements(19999).const_expr().int64_value(), 19999);
+
+  // Logical operator chains are balanced, so they stay within the limit.
+  std::vector<std::string> terms;
+  for (int i = 0; i < 5000; ++i) {
+    terms.push_back(absl::StrCat("x", i));
+  }
+  const std::string chain = absl::StrJoin(terms, " || ");
+  source = cel::NewSource(chain, "");
+  ASSERT_THAT(source, IsOk());
+  result = RecursiveDescentParse((*source)->content(), chain, macros, options);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->parsed_expr.expr().call_expr().function(), "_||_");
+}
+
 std::string TestName(const testing::TestParamInfo<TestInfo>& test_info) {
   std::string name = absl::StrCat(test_info.index, "-", test_info.param.I);
   absl::c_replace_if(
@@ -19,6 +19,7 @@
 #include <limits>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/struct.pb.h"
 #include "absl/container/flat_hash_set.h"
@@ -46,6 +47,25 @@ const std::string& DefaultAccumulatorName() {
   return *kName;
 }
 
+// Collects the arguments of a new node. Unlike an initializer list, this moves
+// from temporaries. Construct it with braces: the arguments are then evaluated
+// in order, which keeps the macro ids in the expansion stable.
+class Exprs final {
+ public:
+  template <typename... Args>
+  Exprs(Args&&... args) {  // NOLINT(google-explicit-constructor)
+    exprs_.reserve(sizeof...(Args));
+    (exprs_.push_back(std::forward<Args>(args)), ...);
+  }
+
+  operator std::vector<Expr>() && {  // NOLINT(google-explicit-constructor)
+    return std::move(exprs_);
+  }
+
+ private:
+  std::vector<Expr> exprs_;
+};
+
 }  // namespace
 
 SourceFactory::SourceFactory(absl::string_view expression)
@@ -84,6 +104,10 @@ int64_t SourceFactory::Id(const SourceLocation& location) {
   return new_id;
 }
 
+int64_t SourceFactory::Id(int32_t line, int32_t col, int32_t offset_end) {
+  return Id(SourceLocation(line, col, offset_end, line_offsets_));
+}
+
 int64_t SourceFactory::NextMacroId(int64_t macro_id) {
   return Id(GetSourceLocation(macro_id));
 }
@@ -103,38 +127,42 @@ Expr SourceFactory::NewExpr(const antlr4::Token* token) {
 }
 
 Expr SourceFactory::NewGlobalCall(int64_t id, const std::string& function,
-                                  const std::vector<Expr>& args) {
+                                  std::vector<Expr> args) {
   Expr expr = NewExpr(id);
   auto call_expr = expr.mutable_call_expr();
   call_expr->set_function(function);
-  std::for_each(args.begin(), args.end(),
-                [&call_expr](const Expr& e) { *call_expr->add_args() = e; });
+  call_expr->mutable_args()->Reserve(args.size());
+  for (Expr& arg : args) {
+    *call_expr->add_args() = std::move(arg);
+  }
   return expr;
 }
 
 Expr SourceFactory::NewGlobalCallForMacro(int64_t macro_id,
                                           const std::string& function,
-                                          const std::vector<Expr>& args) {
-  return NewGlobalCall(NextMacroId(macro_id), function, args);
+                                          std::vector<Expr> args) {
+  return NewGlobalCall(NextMacroId(macro_id), function, std::move(args));
 }
 
 Expr SourceFactory::NewReceiverCall(int64_t id, const std::string& function,
-                                    const Expr& target,
-                                    const std::vector<Expr>& args) {
+                                    Expr target, std::vector<Expr> args) {
   Expr expr = NewExpr(id);
   auto call_expr = expr.mutable_call_expr();
   call_expr->set_function(function);
-  *call_expr->mutable_target() = target;
-  std::for_each(args.begin(), args.end(),
-                [&call_expr](const Expr& e) { *call_expr->add_args() = e; });
+  *call_expr->mutable_target() = std::move(target);
+  call_expr->mutable_args()->Reserve(args.size());
+  for (Expr& arg : args) {
+    *call_expr->add_args() = std::move(arg);
+  }
   return expr;
 }
 
 Expr SourceFactory::NewReceiverCallForMacro(int64_t macro_id,
                                             const std::string& function,
-                                            const Expr& target,
-                                            const std::vector<Expr>& args) {
-  return NewReceiverCall(NextMacroId(macro_id), function, target, args);
+                                            Expr target,
+                                            std::vector<Expr> args) {
+  return NewReceiverCall(NextMacroId(macro_id), function, std::move(target),
+                         std::move(args));
 }
 
 Expr SourceFactory::NewIdent(const antlr4::Token* token,
@@ -151,6 +179,10 @@ Expr SourceFactory::NewIdentForMacro(int64_t macro_id,
   return expr;
 }
 
+Expr SourceFactory::NewAccuIdentForMacro(int64_t macro_id) {
+  return NewIdentForMacro(macro_id, DefaultAccumulatorName());
+}
+
 Expr SourceFactory::NewSelect(
     ::cel_parser_internal::CelParser::SelectContext* ctx, Expr& operand,
     const std::string& field) {
@@ -183,61 +215,62 @@ Expr SourceFactory::NewPresenceTestForMacro(int64_t macro_id,
 
 Expr SourceFactory::NewObject(
     int64_t obj_id, const std::string& type_name,
-    const std::vector<Expr::CreateStruct::Entry>& entries) {
+    std::vector<Expr::CreateStruct::Entry> entries) {
   auto expr = NewExpr(obj_id);
   auto struct_expr = expr.mutable_struct_expr();
   struct_expr->set_message_name(type_name);
-  std::for_each(entries.begin(), entries.end(),
-                [struct_expr](const Expr::CreateStruct::Entry& e) {
-                  struct_expr->add_entries()->CopyFrom(e);
-                });
+  struct_expr->mutable_entries()->Reserve(entries.size());
+  for (Expr::CreateStruct::Entry& entry : entries) {
+    *struct_expr->add_entries() = std::move(entry);
+  }
   return expr;
 }
 
 Expr::CreateStruct::Entry SourceFactory::NewObjectField(
-    int64_t field_id, const std::string& field, const Expr& value,
-    bool optional) {
+    int64_t field_id, const std::string& field, Expr value, bool optional) {
   Expr::CreateStruct::Entry entry;
   entry.set_id(field_id);
   entry.set_field_key(field);
-  *entry.mutable_value() = value;
+  *entry.mutable_value() = std::move(value);
   entry.set_optional_entry(optional);
   return entry;
 }
 
 Expr SourceFactory::NewComprehension(int64_t id, const std::string& iter_var,
-                                     const Expr& iter_range,
+                                     Expr iter_range,
                                      const std::string& accu_var,
-                                     const Expr& accu_init,
-                                     const Expr& condition, const Expr& step,
-                                     const Expr& result) {
+                                     Expr accu_init, Expr condition, Expr step,
+                                     Expr result) {
   Expr expr = NewExpr(id);
   auto comp_expr = expr.mutable_comprehension_expr();
   comp_expr->set_iter_var(iter_var);
-  *comp_expr->mutable_iter_range() = iter_range;
+  *comp_expr->mutable_iter_range() = std::move(iter_range);
   comp_expr->set_accu_var(accu_var);
-  *comp_expr->mutable_accu_init() = accu_init;
-  *comp_expr->mutable_loop_condition() = condition;
-  *comp_expr->mutable_loop_step() = step;
-  *comp_expr->mutable_result() = result;
+  *comp_expr->mutable_accu_init() = std::move(accu_init);
+  *comp_expr->mutable_loop_condition() = std::move(condition);
+  *comp_expr->mutable_loop_step() = std::move(step);
+  *comp_expr->mutable_result() = std::move(result);
   return expr;
 }
 
 Expr SourceFactory::FoldForMacro(int64_t macro_id, const std::string& iter_var,
-                                 const Expr& iter_range,
-                                 const std::string& accu_var,
-                                 const Expr& accu_init, const Expr& condition,
-                                 const Expr& step, const Expr& result) {
-  return NewComprehension(NextMacroId(macro_id), iter_var, iter_range, accu_var,
-                          accu_init, condition, step, result);
+                                 Expr iter_range, const std::string& accu_var,
+                                 Expr accu_init, Expr condition, Expr step,
+                                 Expr result) {
+  return NewComprehension(NextMacroId(macro_id), iter_var,
+                          std::move(iter_range), accu_var,
+                          std::move(accu_init), std::move(condition),
+                          std::move(step), std::move(result));
 }
 
-Expr SourceFactory::NewList(int64_t list_id, const std::vector<Expr>& elems,
+Expr SourceFactory::NewList(int64_t list_id, std::vector<Expr> elems,
                             const std::vector<int64_t>& opts) {
   auto expr = NewExpr(list_id);
   auto list_expr = expr.mutable_list_expr();
-  std::for_each(elems.begin(), elems.end(),
-                [list_expr](const Expr& e) { *list_expr->add_elements() = e; });
+  list_expr->mutable_elements()->Reserve(elems.size());
+  for (Expr& elem : elems) {
+    *list_expr->add_elements() = std::move(elem);
+  }
   std::for_each(opts.begin(), opts.end(),
                 [list_expr](int64_t o) { list_expr->add_optional_indices(o); });
   return expr;
@@ -253,11 +286,7 @@ Expr SourceFactory::NewQuantifierExprForMacro(
     auto loc = GetSourceLocation(args[0].id());
     return ReportError(loc, "argument must be a simple name");
   }
-  std::string v = args[0].ident_expr().name();
-
-  auto accu_ident = [this, &macro_id]() {
-    return NewIdentForMacro(macro_id, DefaultAccumulatorName());
-  };
+  const std::string& v = args[0].ident_expr().name();
 
   Expr init;
   Expr condition;
@@ -266,42 +295,48 @@ Expr SourceFactory::NewQuantifierExprForMacro(
   switch (kind) {
     case QUANTIFIER_ALL:
       init = NewLiteralBoolForMacro(macro_id, true);
-      condition = NewGlobalCallForMacro(
-          macro_id, CelOperator::NOT_STRICTLY_FALSE, {accu_ident()});
-      step = NewGlobalCallForMacro(macro_id, CelOperator::LOGICAL_AND,
-                                   {accu_ident(), args[1]});
-      result = accu_ident();
+      condition =
+          NewGlobalCallForMacro(macro_id, CelOperator::NOT_STRICTLY_FALSE,
+                                Exprs{NewAccuIdentForMacro(macro_id)});
+      step = NewGlobalCallForMacro(
+          macro_id, CelOperator::LOGICAL_AND,
+          Exprs{NewAccuIdentForMacro(macro_id), args[1]});
+      result = NewAccuIdentForMacro(macro_id);
       break;
 
     case QUANTIFIER_EXISTS:
       init = NewLiteralBoolForMacro(macro_id, false);
       condition = NewGlobalCallForMacro(
           macro_id, CelOperator::NOT_STRICTLY_FALSE,
-          {NewGlobalCallForMacro(macro_id, CelOperator::LOGICAL_NOT,
-                                 {accu_ident()})});
-      step = NewGlobalCallForMacro(macro_id, CelOperator::LOGICAL_OR,
-                                   {accu_ident(), args[1]});
-      result = accu_ident();
+          Exprs{NewGlobalCallForMacro(macro_id, CelOperator::LOGICAL_NOT,
+                                      Exprs{NewAccuIdentForMacro(macro_id)})});
+      step = NewGlobalCallForMacro(
+          macro_id, CelOperator::LOGICAL_OR,
+          Exprs{NewAccuIdentForMacro(macro_id), args[1]});
+      result = NewAccuIdentForMacro(macro_id);
       break;
 
     case QUANTIFIER_EXISTS_ONE: {
-      Expr zero_expr = NewLiteralIntForMacro(macro_id, 0);
+      init = NewLiteralIntForMacro(macro_id, 0);
+      // The literal 1 appears twice in the expansion with the same id.
       Expr one_expr = NewLiteralIntForMacro(macro_id, 1);
-      init = zero_expr;
       condition = NewLiteralBoolForMacro(macro_id, true);
       step = NewGlobalCallForMacro(
           macro_id, CelOperator::CONDITIONAL,
-          {args[1],
-           NewGlobalCallForMacro(macro_id, CelOperator::ADD,
-                                 {accu_ident(), one_expr}),
-           accu_ident()});
-      result = NewGlobalCallForMacro(macro_id, CelOperator::EQUALS,
-                                     {accu_ident(), one_expr});
+          Exprs{args[1],
+                NewGlobalCallForMacro(
+                    macro_id, CelOperator::ADD,
+                    Exprs{NewAccuIdentForMacro(macro_id), one_expr}),
+                NewAccuIdentForMacro(macro_id)});
+      result = NewGlobalCallForMacro(
+          macro_id, CelOperator::EQUALS,
+          Exprs{NewAccuIdentForMacro(macro_id), std::move(one_expr)});
       break;
     }
   }
-  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(), init,
-                      condition, step, result);
+  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(),
+                      std::move(init), std::move(condition), std::move(step),
+                      std::move(result));
 }
 
 Expr SourceFactory::BuildArgForMacroCall(const Expr& expr) {
@@ -379,38 +414,37 @@ Expr SourceFactory::NewFilterExprForMacro(int64_t macro_id, const Expr& target,
     auto loc = GetSourceLocation(args[0].id());
     return ReportError(loc, "argument is not an identifier");
   }
-  std::string v = args[0].ident_expr().name();
+  const std::string& v = args[0].ident_expr().name();
 
   const Expr& filter = args[1];
 
-  auto accu_ident = [this, macro_id]() {
-    return NewIdentForMacro(macro_id, DefaultAccumulatorName());
-  };
-
   Expr init = NewListForMacro(macro_id, {});
   Expr condition = NewLiteralBoolForMacro(macro_id, true);
   Expr step = NewGlobalCallForMacro(
       macro_id, CelOperator::ADD,
-      {accu_ident(), NewListForMacro(macro_id, {args[0]})});
-  step = NewGlobalCallForMacro(macro_id, CelOperator::CONDITIONAL,
-                               {filter, step, accu_ident()});
-  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(), init,
-                      condition, step, accu_ident());
+      Exprs{NewAccuIdentForMacro(macro_id),
+            NewListForMacro(macro_id, Exprs{args[0]})});
+  step = NewGlobalCallForMacro(
+      macro_id, CelOperator::CONDITIONAL,
+      Exprs{filter, std::move(step), NewAccuIdentForMacro(macro_id)});
+  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(),
+                      std::move(init), std::move(condition), std::move(step),
+                      NewAccuIdentForMacro(macro_id));
 }
 
 Expr SourceFactory::NewListForMacro(int64_t macro_id,
-                                    const std::vector<Expr>& elems) {
-  return NewList(NextMacroId(macro_id), elems);
+                                    std::vector<Expr> elems) {
+  return NewList(NextMacroId(macro_id), std::move(elems));
 }
 
-Expr SourceFactory::NewMap(
-    int64_t map_id, const std::vector<Expr::CreateStruct::Entry>& entries) {
+Expr SourceFactory::NewMap(int64_t map_id,
+                           std::vector<Expr::CreateStruct::Entry> entries) {
   auto expr = NewExpr(map_id);
   auto struct_expr = expr.mutable_struct_expr();
-  std::for_each(entries.begin(), entries.end(),
-                [struct_expr](const Expr::CreateStruct::Entry& e) {
-                  struct_expr->add_entries()->CopyFrom(e);
-                });
+  struct_expr->mutable_entries()->Reserve(entries.size());
+  for (Expr::CreateStruct::Entry& entry : entries) {
+    *struct_expr->add_entries() = std::move(entry);
+  }
   return expr;
 }
 
@@ -423,44 +457,34 @@ Expr SourceFactory::NewMapForMacro(int64_t macro_id, const Expr& target,
     auto loc = GetSourceLocation(args[0].id());
     return ReportError(loc, "argument is not an identifier");
   }
-  std::string v = args[0].ident_expr().name();
-
-  Expr fn;
-  Expr filter;
-  bool has_filter = false;
-  if (args.size() == 3) {
-    filter = args[1];
-    has_filter = true;
-    fn = args[2];
-  } else {
-    fn = args[1];
-  }
+  const std::string& v = args[0].ident_expr().name();
 
-  auto accu_ident = [this, macro_id]() {
-    return NewIdentForMacro(macro_id, DefaultAccumulatorName());
-  };
+  const bool has_filter = args.size() == 3;
+  const Expr& fn = has_filter ? args[2] : args[1];
 
   Expr init = NewListForMacro(macro_id, {});
   Expr condition = NewLiteralBoolForMacro(macro_id, true);
-  Expr step =
-      NewGlobalCallForMacro(macro_id, CelOperator::ADD,
-                            {accu_ident(), NewListForMacro(macro_id, {fn})});
+  Expr step = NewGlobalCallForMacro(
+      macro_id, CelOperator::ADD,
+      Exprs{NewAccuIdentForMacro(macro_id),
+            NewListForMacro(macro_id, Exprs{fn})});
   if (has_filter) {
-    step = NewGlobalCallForMacro(macro_id, CelOperator::CONDITIONAL,
-                                 {filter, step, accu_ident()});
+    step = NewGlobalCallForMacro(
+        macro_id, CelOperator::CONDITIONAL,
+        Exprs{args[1], std::move(step), NewAccuIdentForMacro(macro_id)});
   }
-  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(), init,
-                      condition, step, accu_ident());
+  return FoldForMacro(macro_id, v, target, DefaultAccumulatorName(),
+                      std::move(init), std::move(condition), std::move(step),
+                      NewAccuIdentForMacro(macro_id));
 }
 
 Expr::CreateStruct::Entry SourceFactory::NewMapEntry(int64_t entry_id,
-                                                     const Expr& key,
-                                                     const Expr& value,
+                                                     Expr key, Expr value,
                                                      bool optional) {
   Expr::CreateStruct::Entry entry;
   entry.set_id(entry_id);
-  *entry.mutable_map_key() = key;
-  *entry.mutable_value() = value;
+  *entry.mutable_map_key() = std::move(key);
+  *entry.mutable_value() = std::move(value);
   entry.set_optional_entry(optional);
   return entry;
 }
@@ -86,6 +86,9 @@ class SourceFactory {
   int64_t Id(const antlr4::Token* token);
   int64_t Id(antlr4::ParserRuleContext* ctx);
   int64_t Id(const SourceLocation& location);
+  // Returns a new id for a token starting at 1-based line and 0-based col, and
+  // ending at offset_end, with columns and offsets counted in code points.
+  int64_t Id(int32_t line, int32_t col, int32_t offset_end);
 
   int64_t NextMacroId(int64_t macro_id);
 
@@ -97,14 +100,13 @@ class SourceFactory {
   Expr NewExpr(antlr4::ParserRuleContext* ctx);
   Expr NewExpr(const antlr4::Token* token);
   Expr NewGlobalCall(int64_t id, const std::string& function,
-                     const std::vector<Expr>& args);
+                     std::vector<Expr> args);
   Expr NewGlobalCallForMacro(int64_t macro_id, const std::string& function,
-                             const std::vector<Expr>& args);
-  Expr NewReceiverCall(int64_t id, const std::string& function,
-                       const Expr& target, const std::vector<Expr>& args);
+                             std::vector<Expr> args);
+  Expr NewReceiverCall(int64_t id, const std::string& function, Expr target,
+                       std::vector<Expr> args);
   Expr NewReceiverCallForMacro(int64_t macro_id, const std::string& function,
-                               const Expr& target,
-                               const std::vector<Expr>& args);
+                               Expr target, std::vector<Expr> args);
   Expr NewIdent(const antlr4::Token* token, const std::string& ident_name);
   Expr NewIdentForMacro(int64_t macro_id, const std::string& ident_name);
   Expr NewSelect(::cel_parser_internal::CelParser::SelectContext* ctx,
@@ -114,36 +116,35 @@ class SourceFactory {
   Expr NewPresenceTestForMacro(int64_t macro_id, const Expr& operand,
                                const std::string& field);
   Expr NewObject(int64_t obj_id, const std::string& type_name,
-                 const std::vector<Expr::CreateStruct::Entry>& entries);
+                 std::vector<Expr::CreateStruct::Entry> entries);
   Expr::CreateStruct::Entry NewObjectField(int64_t field_id,
                                            const std::string& field,
-                                           const Expr& value,
-                                           bool optional = false);
+                                           Expr value, bool optional = false);
   Expr NewComprehension(int64_t id, const std::string& iter_var,
-                        const Expr& iter_range, const std::string& accu_var,
-                        const Expr& accu_init, const Expr& condition,
-                        const Expr& step, const Expr& result);
+                        Expr iter_range, const std::string& accu_var,
+                        Expr accu_init, Expr condition, Expr step,
+                        Expr result);
 
+  // The macro helpers take the subexpressions of the new node by value and
+  // move them into place, so expansions built from temporaries copy nothing
+  // but the target and arguments of the macro call.
   Expr FoldForMacro(int64_t macro_id, const std::string& iter_var,
-                    const Expr& iter_range, const std::string& accu_var,
-                    const Expr& accu_init, const Expr& condition,
-                    const Expr& step, const Expr& result);
+                    Expr iter_range, const std::string& accu_var,
+                    Expr accu_init, Expr condition, Expr step, Expr result);
   Expr NewQuantifierExprForMacro(QuantifierKind kind, int64_t macro_id,
                                  const Expr& target,
                                  const std::vector<Expr>& args);
   Expr NewFilterExprForMacro(int64_t macro_id, const Expr& target,
                              const std::vector<Expr>& args);
 
-  Expr NewList(int64_t list_id, const std::vector<Expr>& elems,
+  Expr NewList(int64_t list_id, std::vector<Expr> elems,
                const std::vector<int64_t>& opts = {});
-  Expr NewListForMacro(int64_t macro_id, const std::vector<Expr>& elems);
-  Expr NewMap(int64_t map_id,
-              const std::vector<Expr::CreateStruct::Entry>& entries);
+  Expr NewListForMacro(int64_t macro_id, std::vector<Expr> elems);
+  Expr NewMap(int64_t map_id, std::vector<Expr::CreateStruct::Entry> entries);
   Expr NewMapForMacro(int64_t macro_id, const Expr& target,
                       const std::vector<Expr>& args);
-  Expr::CreateStruct::Entry NewMapEntry(int64_t entry_id, const Expr& key,
-                                        const Expr& value,
-                                        bool optional = false);
+  Expr::CreateStruct::Entry NewMapEntry(int64_t entry_id, Expr key,
+                                        Expr value, bool optional = false);
   Expr NewLiteralInt(antlr4::ParserRuleContext* ctx, int64_t value);
   Expr NewLiteralIntForMacro(int64_t macro_id, int64_t value);
   Expr NewLiteralUint(antlr4::ParserRuleContext* ctx, uint64_t value);
@@ -171,6 +172,9 @@ class SourceFactory {
                     const std::vector<Expr>& args, std::string function);
 
  private:
+  // Returns a reference to the accumulator of the standard comprehension
+  // macros, whose name is shared by all expansions.
+  Expr NewAccuIdentForMacro(int64_t macro_id);
   void CalcLineOffsets(absl::string_view expression);
   absl::optional<int32_t> FindLineOffset(int32_t line) const;
   std::string GetSourceLine(int32_t line, absl::string_view expression) const;
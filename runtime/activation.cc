@@ -14,6 +14,7 @@
 
 #include "runtime/activation.h"
 
+#include <atomic>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -38,25 +39,30 @@ absl::StatusOr<absl::optional<Handle<Value>>> Activation::FindVariable(
   }
 
   const ValueEntry& entry = iter->second;
-  if (entry.provider.has_value()) {
-    return ProvideValue(factory, name);
+  if (entry.provider != nullptr) {
+    ProvidedValue& provided_value = *entry.provider;
+    if (provided_value.provided.load(std::memory_order_acquire)) {
+      return provided_value.value;
+    }
+    return ProvideValue(factory, name, provided_value);
   }
   return entry.value;
 }
 
 absl::StatusOr<absl::optional<Handle<Value>>> Activation::ProvideValue(
-    ValueFactory& factory, absl::string_view name) const {
-  absl::MutexLock lock(&mutex_);
-  auto iter = values_.find(name);
-  ABSL_ASSERT(iter != values_.end());
-  ValueEntry& entry = iter->second;
-  if (entry.value) {
-    return entry.value;
+    ValueFactory& factory, absl::string_view name,
+    ProvidedValue& provided_value) {
+  absl::MutexLock lock(&provided_value.mutex);
+  if (provided_value.provided.load(std::memory_order_relaxed)) {
+    return provided_value.value;
   }
 
-  auto result = (*entry.provider)(factory, name);
+  // Errors and missing values are not cached, so the provider is called again
+  // on the next lookup.
+  auto result = provided_value.provider(factory, name);
   if (result.ok() && result->has_value()) {
-    entry.value = **result;
+    provided_value.value = **result;
+    provided_value.provided.store(true, std::memory_order_release);
   }
   return result;
 }
@@ -77,14 +83,16 @@ std::vector<FunctionOverloadReference> Activation::FindFunctionOverloads(
 
 bool Activation::InsertOrAssignValue(absl::string_view name,
                                      Handle<Value> value) {
-  return values_.insert_or_assign(name, {std::move(value), absl::nullopt})
+  return values_.insert_or_assign(name, ValueEntry{std::move(value), nullptr})
       .second;
 }
 
 bool Activation::InsertOrAssignValueProvider(absl::string_view name,
                                              ValueProvider provider) {
+  auto provided_value = std::make_unique<ProvidedValue>(std::move(provider));
   return values_
-      .insert_or_assign(name, ValueEntry{Handle<Value>(), std::move(provider)})
+      .insert_or_assign(name,
+                        ValueEntry{Handle<Value>(), std::move(provided_value)})
       .second;
 }
 
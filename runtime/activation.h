@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_ACTIVATION_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_ACTIVATION_H_
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
@@ -42,6 +43,11 @@ namespace cel {
 // Thread-compatible implementation of a CEL Activation.
 //
 // Values can either be provided eagerly or via a provider.
+//
+// Const methods may be called concurrently, e.g. to evaluate several programs
+// over one activation on different threads. Each provider is called at most
+// once at a time, and once it has provided a value, reading the variable does
+// not lock.
 class Activation final : public ActivationInterface {
  public:
   // Definition for value providers.
@@ -68,6 +74,10 @@ class Activation final : public ActivationInterface {
     return missing_patterns_;
   }
 
+  FunctionResultStore* GetFunctionResultStore() const override {
+    return function_result_store_;
+  }
+
   // Bind a value to a named variable.
   //
   // Returns false if the entry for name was overwritten.
@@ -88,17 +98,35 @@ class Activation final : public ActivationInterface {
     missing_patterns_ = std::move(patterns);
   }
 
+  // Sets the store of function results to read and record function results
+  // in. store must outlive evaluations using the activation.
+  void SetFunctionResultStore(FunctionResultStore* store) {
+    function_result_store_ = store;
+  }
+
   // Returns true if the function was inserted (no other registered function has
   // a matching descriptor).
   bool InsertFunction(const cel::FunctionDescriptor& descriptor,
                       std::unique_ptr<cel::Function> impl);
 
  private:
+  // State of a lazily provided value. Not movable, so held by pointer.
+  struct ProvidedValue {
+    explicit ProvidedValue(ValueProvider provider)
+        : provider(std::move(provider)) {}
+
+    ValueProvider provider;
+    // Serializes calls to the provider for this variable only.
+    absl::Mutex mutex;
+    // Written once, before provided is set.
+    Handle<Value> value;
+    std::atomic<bool> provided{false};
+  };
+
   struct ValueEntry {
-    // If provider is present, then access must be synchronized to maintain
-    // thread-compatible semantics for the lazily provided value.
     Handle<Value> value;
-    absl::optional<ValueProvider> provider;
+    // Set if the value is lazily provided, in which case value is unused.
+    std::unique_ptr<ProvidedValue> provider;
   };
 
   struct FunctionEntry {
@@ -106,18 +134,17 @@ class Activation final : public ActivationInterface {
     std::unique_ptr<cel::Function> implementation;
   };
 
-  // Internal getter for provided values.
-  // Assumes entry for name is present and is a provided value.
-  // Handles synchronization for caching the provided value.
-  absl::StatusOr<absl::optional<Handle<Value>>> ProvideValue(
-      ValueFactory& value_factory, absl::string_view name) const;
+  // Calls the provider of a variable that has not been provided yet, and
+  // caches the value if it is found.
+  static absl::StatusOr<absl::optional<Handle<Value>>> ProvideValue(
+      ValueFactory& value_factory, absl::string_view name,
+      ProvidedValue& provided_value);
 
-  // mutex_ used for safe caching of provided variables
-  mutable absl::Mutex mutex_;
-  mutable absl::flat_hash_map<std::string, ValueEntry> values_;
+  absl::flat_hash_map<std::string, ValueEntry> values_;
 
   std::vector<cel::AttributePattern> unknown_patterns_;
   std::vector<cel::AttributePattern> missing_patterns_;
+  FunctionResultStore* function_result_store_ = nullptr;
 
   absl::flat_hash_map<std::string, std::vector<FunctionEntry>> functions_;
 };
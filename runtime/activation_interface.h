@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_ACTIVATION_INTERFACE_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_ACTIVATION_INTERFACE_H_
 
+#include <string>
 #include <vector>
 
 #include "absl/status/statusor.h"
@@ -27,6 +28,8 @@
 
 namespace cel {
 
+class FunctionResultStore;
+
 // Interface for providing runtime with variable lookups.
 //
 // Clients should prefer to use one of the concrete implementations provided by
@@ -66,6 +69,24 @@ class ActivationInterface {
   // using this activation.
   virtual absl::Span<const cel::AttributePattern> GetMissingAttributes()
       const = 0;
+
+  // Return the values of variables bound by position, if the activation binds
+  // variables in the order of variable_names (see cel::BoundActivation).
+  // Unbound variables have empty handles.
+  //
+  // Called once per evaluation with the variable names of the program. If the
+  // returned span is empty, the program looks up variables by name.
+  virtual absl::Span<const Handle<Value>> GetBoundVariables(
+      absl::Span<const std::string> variable_names) const {
+    return {};
+  }
+
+  // Return the store of function results carried between the phases of a
+  // multi-phase evaluation, or nullptr. Only used if unknown function results
+  // are enabled. See cel::FunctionResultStore.
+  virtual FunctionResultStore* GetFunctionResultStore() const {
+    return nullptr;
+  }
 };
 
 }  // namespace cel
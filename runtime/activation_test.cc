@@ -14,7 +14,10 @@
 
 #include "runtime/activation.h"
 
+#include <atomic>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -161,6 +164,54 @@ TEST_F(ActivationTest, ProviderMemoized) {
   EXPECT_EQ(call_count, 1);
 }
 
+TEST_F(ActivationTest, ProviderMemoizedConcurrently) {
+  Activation activation;
+  std::atomic<int> call_count = 0;
+
+  EXPECT_TRUE(activation.InsertOrAssignValueProvider(
+      "var1", [&call_count](ValueFactory& factory, absl::string_view name) {
+        call_count++;
+        return factory.CreateIntValue(42);
+      }));
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < 100; ++j) {
+        EXPECT_THAT(activation.FindVariable(value_factory_, "var1"),
+                    IsOkAndHolds(Optional(IsIntValue(42))));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(call_count, 1);
+}
+
+TEST_F(ActivationTest, ProviderNotMemoizedOnError) {
+  Activation activation;
+  int call_count = 0;
+
+  EXPECT_TRUE(activation.InsertOrAssignValueProvider(
+      "var1",
+      [&call_count](ValueFactory& factory, absl::string_view name)
+          -> absl::StatusOr<absl::optional<Handle<Value>>> {
+        if (call_count++ == 0) {
+          return absl::InternalError("test");
+        }
+        return factory.CreateIntValue(42);
+      }));
+
+  EXPECT_THAT(activation.FindVariable(value_factory_, "var1"),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(activation.FindVariable(value_factory_, "var1"),
+              IsOkAndHolds(Optional(IsIntValue(42))));
+  EXPECT_THAT(activation.FindVariable(value_factory_, "var1"),
+              IsOkAndHolds(Optional(IsIntValue(42))));
+  EXPECT_EQ(call_count, 2);
+}
+
 TEST_F(ActivationTest, InsertProviderOverwrite) {
   Activation activation;
 
@@ -0,0 +1,34 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_ALGEBRAIC_SIMPLIFICATION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_ALGEBRAIC_SIMPLIFICATION_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable algebraic simplification in the runtime being built.
+//
+// Redundant logic, such as `x && true`, `!!x` or repeated clauses of logical
+// chains, is removed before programs are planned, and the side-effect-free
+// clauses of logical chains are reordered so the cheapest ones run first.
+// When several clauses of a chain evaluate to errors, a different one of them
+// may be reported.
+absl::Status EnableAlgebraicSimplification(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_ALGEBRAIC_SIMPLIFICATION_H_
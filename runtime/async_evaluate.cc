@@ -0,0 +1,226 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/async_evaluate.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/async_function.h"
+#include "runtime/function_overload_reference.h"
+#include "runtime/function_registry.h"
+#include "runtime/function_result_cache.h"
+#include "runtime/internal/errors.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace {
+
+// Async calls started during one EvaluateWithAsyncFunctions call, keyed by
+// FunctionResultCache::MakeKey.
+class AsyncCallTable {
+ public:
+  // Returns the result of a completed call. Only called on the evaluating
+  // thread.
+  const Handle<Value>* FindResult(const std::string& key) const {
+    auto it = results_.find(key);
+    return it == results_.end() ? nullptr : &it->second;
+  }
+
+  // Starts the call for key unless it was already started.
+  void Start(const std::string& key, const AsyncFunction& function,
+             absl::Span<const Handle<Value>> args) {
+    if (!started_.insert(key).second) {
+      return;
+    }
+    ++started_in_round_;
+    {
+      absl::MutexLock lock(&mutex_);
+      ++pending_;
+    }
+    // The callback may run synchronously, so the mutex is not held here.
+    function.InvokeAsync(
+        args, [this, key](AsyncFunction::ResultFactory result) {
+          absl::MutexLock lock(&mutex_);
+          completed_.push_back({key, std::move(result)});
+          --pending_;
+        });
+  }
+
+  // Waits for the calls started so far and creates their results. Returns
+  // the number of calls started since the previous call.
+  absl::StatusOr<int> FinishRound(ValueFactory& value_factory) {
+    std::vector<Completed> completed;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          +[](int* pending) { return *pending == 0; }, &pending_));
+      completed.swap(completed_);
+    }
+    for (auto& call : completed) {
+      CEL_ASSIGN_OR_RETURN(results_[call.key],
+                           std::move(call.result)(value_factory));
+    }
+    int started = started_in_round_;
+    started_in_round_ = 0;
+    return started;
+  }
+
+ private:
+  struct Completed {
+    std::string key;
+    AsyncFunction::ResultFactory result;
+  };
+
+  // Only accessed on the evaluating thread.
+  absl::flat_hash_set<std::string> started_;
+  absl::flat_hash_map<std::string, Handle<Value>> results_;
+  int started_in_round_ = 0;
+
+  absl::Mutex mutex_;
+  int pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<Completed> completed_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Function bound to one async overload for the duration of an
+// EvaluateWithAsyncFunctions call. Calls are keyed by the overload's
+// descriptor, so the adapters of distinct overloads share the call table.
+class AsyncFunctionAdapter : public Function {
+ public:
+  AsyncFunctionAdapter(const FunctionDescriptor& descriptor,
+                       const AsyncFunction& function, AsyncCallTable& calls)
+      : descriptor_(descriptor), function_(function), calls_(calls) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    absl::optional<std::string> key =
+        FunctionResultCache::MakeKey(descriptor_, args);
+    if (!key.has_value()) {
+      return context.value_factory().CreateErrorValue(
+          absl::InvalidArgumentError(
+              "unsupported argument type for async function"));
+    }
+    if (const Handle<Value>* result = calls_.FindResult(*key);
+        result != nullptr) {
+      return *result;
+    }
+    calls_.Start(*key, function_, args);
+    return context.value_factory().CreateErrorValue(
+        runtime_internal::CreateUnknownFunctionResultError(
+            "async function call pending"));
+  }
+
+ private:
+  const FunctionDescriptor& descriptor_;
+  const AsyncFunction& function_;
+  AsyncCallTable& calls_;
+};
+
+// Forwards to the caller's activation, adding the async overloads.
+class AsyncActivation : public ActivationInterface {
+ public:
+  AsyncActivation(const ActivationInterface& activation,
+                  const FunctionRegistry& registry, AsyncCallTable& calls)
+      : activation_(activation) {
+    for (const FunctionRegistry::AsyncOverload& overload :
+         registry.ListAsyncFunctions()) {
+      adapters_.push_back(std::make_unique<AsyncFunctionAdapter>(
+          overload.descriptor, overload.implementation, calls));
+      overloads_[overload.descriptor.name()].push_back(
+          {overload.descriptor, *adapters_.back()});
+    }
+  }
+
+  absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
+      ValueFactory& factory, absl::string_view name) const override {
+    return activation_.FindVariable(factory, name);
+  }
+
+  std::vector<FunctionOverloadReference> FindFunctionOverloads(
+      absl::string_view name) const override {
+    std::vector<FunctionOverloadReference> overloads =
+        activation_.FindFunctionOverloads(name);
+    if (auto it = overloads_.find(name); it != overloads_.end()) {
+      overloads.insert(overloads.end(), it->second.begin(), it->second.end());
+    }
+    return overloads;
+  }
+
+  absl::Span<const cel::AttributePattern> GetUnknownAttributes()
+      const override {
+    return activation_.GetUnknownAttributes();
+  }
+
+  absl::Span<const cel::AttributePattern> GetMissingAttributes()
+      const override {
+    return activation_.GetMissingAttributes();
+  }
+
+  FunctionResultStore* GetFunctionResultStore() const override {
+    return activation_.GetFunctionResultStore();
+  }
+
+ private:
+  const ActivationInterface& activation_;
+  std::vector<std::unique_ptr<AsyncFunctionAdapter>> adapters_;
+  absl::flat_hash_map<std::string, std::vector<FunctionOverloadReference>>
+      overloads_;
+};
+
+}  // namespace
+
+absl::StatusOr<Handle<Value>> EvaluateWithAsyncFunctions(
+    const Program& program, const FunctionRegistry& registry,
+    const ActivationInterface& activation, ValueFactory& value_factory,
+    const AsyncEvaluateOptions& options) {
+  AsyncCallTable calls;
+  AsyncActivation async_activation(activation, registry, calls);
+  for (int round = 0; round < options.max_rounds; ++round) {
+    absl::StatusOr<Handle<Value>> result =
+        program.Evaluate(async_activation, value_factory);
+    // Wait for outstanding calls even on failure, since their callbacks
+    // refer to the call table.
+    CEL_ASSIGN_OR_RETURN(int started, calls.FinishRound(value_factory));
+    if (!result.ok() || started == 0) {
+      return result;
+    }
+  }
+  return absl::ResourceExhaustedError(absl::StrCat(
+      "async evaluation did not finish within ", options.max_rounds,
+      " rounds"));
+}
+
+}  // namespace cel
@@ -0,0 +1,58 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_EVALUATE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_EVALUATE_H_
+
+#include "absl/status/statusor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/function_registry.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+struct AsyncEvaluateOptions {
+  // Upper bound on the number of times the program is evaluated. Each round
+  // after the first is only run once every call started by the previous round
+  // has completed.
+  int max_rounds = 16;
+};
+
+// Evaluate program, providing the async functions registered in registry.
+//
+// Async calls are issued as evaluation reaches them: a call whose result is
+// not available yet is started and evaluates to an unknown function result
+// (or an error, if unknown function results are disabled in the
+// RuntimeOptions), and evaluation continues with the rest of the expression.
+// Independent async calls are therefore in flight concurrently. Once the
+// round is done, the calling thread waits for the started calls and
+// evaluates the program again, this time with their results. Evaluation
+// finishes with the first round that starts no new calls.
+//
+// Results are keyed by the called overload and the argument values, so
+// async overloads may only take null, bool, int, uint, double, string, bytes,
+// duration or timestamp arguments; other calls evaluate to an error.
+//
+// registry must be the registry the program was planned with.
+absl::StatusOr<Handle<Value>> EvaluateWithAsyncFunctions(
+    const Program& program, const FunctionRegistry& registry,
+    const ActivationInterface& activation, ValueFactory& value_factory,
+    const AsyncEvaluateOptions& options = AsyncEvaluateOptions());
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_EVALUATE_H_
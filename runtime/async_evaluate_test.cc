@@ -0,0 +1,186 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/async_evaluate.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/error_value.h"
+#include "base/values/string_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/async_function.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::UnorderedElementsAre;
+using cel::internal::StatusIs;
+
+// lookup(string) -> string, completed on a separate thread with the argument
+// suffixed by "!".
+class AsyncLookup : public AsyncFunction {
+ public:
+  ~AsyncLookup() override {
+    absl::MutexLock lock(&mutex_);
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void InvokeAsync(absl::Span<const Handle<Value>> args,
+                   DoneCallback done) const override {
+    std::string key = args[0].As<StringValue>()->ToString();
+    absl::MutexLock lock(&mutex_);
+    started_.push_back(key);
+    threads_.emplace_back([key, done = std::move(done)]() mutable {
+      std::move(done)(
+          [key](ValueFactory& value_factory) -> absl::StatusOr<Handle<Value>> {
+            return value_factory.CreateStringValue(key + "!");
+          });
+    });
+  }
+
+  std::vector<std::string> started() const {
+    absl::MutexLock lock(&mutex_);
+    return started_;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  mutable std::vector<std::string> started_ ABSL_GUARDED_BY(mutex_);
+  mutable std::vector<std::thread> threads_ ABSL_GUARDED_BY(mutex_);
+};
+
+class AsyncEvaluateTest : public testing::TestWithParam<bool> {
+ public:
+  void SetUp() override {
+    RuntimeOptions options;
+    if (GetParam()) {
+      options.unknown_processing =
+          UnknownProcessingOptions::kAttributeAndFunction;
+    }
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    auto lookup = std::make_unique<AsyncLookup>();
+    lookup_ = lookup.get();
+    ASSERT_OK(builder.function_registry().RegisterAsyncFunction(
+        FunctionDescriptor("lookup", false, {Kind::kString}),
+        std::move(lookup)));
+    registry_ = &builder.function_registry();
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<std::unique_ptr<Program>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expr));
+    return ProtobufRuntimeAdapter::CreateProgram(*runtime_, parsed_expr);
+  }
+
+ protected:
+  std::unique_ptr<const Runtime> runtime_;
+  const FunctionRegistry* registry_;
+  AsyncLookup* lookup_;
+  Activation activation_;
+};
+
+TEST_P(AsyncEvaluateTest, IndependentCallsIssuedTogether) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("lookup('a') + lookup('b')"));
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       EvaluateWithAsyncFunctions(*program, *registry_,
+                                                  activation_,
+                                                  value_factory.get()));
+
+  ASSERT_TRUE(result->Is<StringValue>());
+  EXPECT_EQ(result.As<StringValue>()->ToString(), "a!b!");
+  EXPECT_THAT(lookup_->started(), UnorderedElementsAre("a", "b"));
+}
+
+TEST_P(AsyncEvaluateTest, DependentCallsAndDuplicates) {
+  ASSERT_OK_AND_ASSIGN(
+      auto program,
+      Plan("lookup(lookup('a')) == 'a!!' && lookup('a') == 'a!'"));
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       EvaluateWithAsyncFunctions(*program, *registry_,
+                                                  activation_,
+                                                  value_factory.get()));
+
+  ASSERT_TRUE(result->Is<BoolValue>());
+  EXPECT_TRUE(result.As<BoolValue>()->NativeValue());
+  EXPECT_THAT(lookup_->started(), UnorderedElementsAre("a", "a!"));
+}
+
+TEST_P(AsyncEvaluateTest, RoundLimit) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("lookup(lookup('a'))"));
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+
+  AsyncEvaluateOptions options;
+  options.max_rounds = 1;
+  EXPECT_THAT(EvaluateWithAsyncFunctions(*program, *registry_, activation_,
+                                         value_factory.get(), options),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+TEST_P(AsyncEvaluateTest, PlainEvaluationHasNoImplementation) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("lookup('a')"));
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation_, value_factory.get()));
+
+  EXPECT_TRUE(result->Is<ErrorValue>());
+  EXPECT_TRUE(lookup_->started().empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(UnknownFunctionResults, AsyncEvaluateTest,
+                         testing::Bool());
+
+}  // namespace
+}  // namespace cel
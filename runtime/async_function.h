@@ -0,0 +1,56 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_FUNCTION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_FUNCTION_H_
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+
+namespace cel {
+
+// Interface for extension functions whose result is produced asynchronously,
+// e.g. by a remote lookup.
+//
+// Async functions are registered with FunctionRegistry::RegisterAsyncFunction
+// and are only invoked when the program is evaluated with
+// EvaluateWithAsyncFunctions (see runtime/async_evaluate.h).
+class AsyncFunction {
+ public:
+  // Creates the result of a completed call. Invoked on the evaluating thread,
+  // so implementations must capture the result as plain C++ data rather than
+  // as values.
+  using ResultFactory =
+      absl::AnyInvocable<absl::StatusOr<Handle<Value>>(ValueFactory&) &&>;
+
+  // Completion callback for InvokeAsync. May be called from any thread.
+  using DoneCallback = absl::AnyInvocable<void(ResultFactory) &&>;
+
+  virtual ~AsyncFunction() = default;
+
+  // Starts the call and returns without waiting for it to complete. done must
+  // be called exactly once, possibly before InvokeAsync returns.
+  //
+  // args are only valid for the duration of the InvokeAsync call.
+  virtual void InvokeAsync(absl::Span<const Handle<Value>> args,
+                           DoneCallback done) const = 0;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_ASYNC_FUNCTION_H_
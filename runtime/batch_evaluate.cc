@@ -0,0 +1,240 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/batch_evaluate.h"
+
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/batch_function.h"
+#include "runtime/function_overload_reference.h"
+#include "runtime/function_registry.h"
+#include "runtime/function_result_cache.h"
+#include "runtime/internal/errors.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace {
+
+// Function bound to one batch overload for the duration of an
+// EvaluateBatchWithBatchFunctions call. It must outlive all passes, since it
+// holds the results of the deferred calls.
+class BatchFunctionAdapter : public Function {
+ public:
+  BatchFunctionAdapter(const FunctionDescriptor& descriptor,
+                       const Function& fallback,
+                       const BatchFunction& implementation)
+      : descriptor_(descriptor),
+        fallback_(fallback),
+        implementation_(implementation) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    absl::optional<std::string> key =
+        FunctionResultCache::MakeKey(descriptor_, args);
+    if (!key.has_value()) {
+      return fallback_.Invoke(context, args);
+    }
+    if (auto it = results_.find(*key); it != results_.end()) {
+      return it->second;
+    }
+    if (!deferring_) {
+      return fallback_.Invoke(context, args);
+    }
+    deferred_in_row_ = true;
+    if (pending_keys_.emplace(*key, pending_args_.size()).second) {
+      pending_args_.emplace_back(args.begin(), args.end());
+    }
+    return context.value_factory().CreateErrorValue(
+        runtime_internal::CreateUnknownFunctionResultError(
+            "batch function call pending"));
+  }
+
+  // Invokes the batch implementation for the calls recorded since the last
+  // flush.
+  absl::Status Flush(ValueFactory& value_factory) {
+    if (pending_args_.empty()) {
+      return absl::OkStatus();
+    }
+    std::vector<absl::Span<const Handle<Value>>> args(pending_args_.begin(),
+                                                      pending_args_.end());
+    std::vector<Handle<Value>> results(args.size());
+    FunctionEvaluationContext context(value_factory);
+    CEL_RETURN_IF_ERROR(
+        implementation_.InvokeBatch(context, args, absl::MakeSpan(results)));
+    for (auto& [key, index] : pending_keys_) {
+      results_[key] = std::move(results[index]);
+    }
+    pending_keys_.clear();
+    pending_args_.clear();
+    return absl::OkStatus();
+  }
+
+  void set_deferring(bool deferring) { deferring_ = deferring; }
+
+  // Returns whether a call was deferred since the last call and resets the
+  // flag.
+  bool TakeDeferredInRow() { return std::exchange(deferred_in_row_, false); }
+
+ private:
+  const FunctionDescriptor& descriptor_;
+  const Function& fallback_;
+  const BatchFunction& implementation_;
+
+  // Evaluation is single threaded, so the call bookkeeping is unsynchronized.
+  mutable bool deferring_ = true;
+  mutable bool deferred_in_row_ = false;
+  mutable absl::flat_hash_map<std::string, Handle<Value>> results_;
+  mutable absl::flat_hash_map<std::string, size_t> pending_keys_;
+  mutable std::vector<std::vector<Handle<Value>>> pending_args_;
+};
+
+// The batch adapters for a registry, shared by the activations of all rows.
+class BatchFunctions {
+ public:
+  explicit BatchFunctions(const FunctionRegistry& registry) {
+    for (const FunctionRegistry::BatchOverload& overload :
+         registry.ListBatchFunctions()) {
+      adapters_.push_back(std::make_unique<BatchFunctionAdapter>(
+          overload.descriptor, overload.fallback, overload.implementation));
+      overloads_[overload.descriptor.name()].push_back(
+          {overload.descriptor, *adapters_.back()});
+    }
+  }
+
+  const std::vector<FunctionOverloadReference>* Find(
+      absl::string_view name) const {
+    auto it = overloads_.find(name);
+    return it == overloads_.end() ? nullptr : &it->second;
+  }
+
+  void set_deferring(bool deferring) {
+    for (auto& adapter : adapters_) {
+      adapter->set_deferring(deferring);
+    }
+  }
+
+  bool TakeDeferredInRow() {
+    bool deferred = false;
+    for (auto& adapter : adapters_) {
+      deferred |= adapter->TakeDeferredInRow();
+    }
+    return deferred;
+  }
+
+  absl::Status Flush(ValueFactory& value_factory) {
+    for (auto& adapter : adapters_) {
+      CEL_RETURN_IF_ERROR(adapter->Flush(value_factory));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  std::vector<std::unique_ptr<BatchFunctionAdapter>> adapters_;
+  absl::flat_hash_map<std::string, std::vector<FunctionOverloadReference>>
+      overloads_;
+};
+
+// Forwards to one row's activation, adding the batch overloads.
+class BatchActivation : public ActivationInterface {
+ public:
+  BatchActivation(const ActivationInterface& activation,
+                  const BatchFunctions& functions)
+      : activation_(activation), functions_(functions) {}
+
+  absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
+      ValueFactory& factory, absl::string_view name) const override {
+    return activation_.FindVariable(factory, name);
+  }
+
+  std::vector<FunctionOverloadReference> FindFunctionOverloads(
+      absl::string_view name) const override {
+    std::vector<FunctionOverloadReference> overloads =
+        activation_.FindFunctionOverloads(name);
+    if (const auto* batch_overloads = functions_.Find(name);
+        batch_overloads != nullptr) {
+      overloads.insert(overloads.end(), batch_overloads->begin(),
+                       batch_overloads->end());
+    }
+    return overloads;
+  }
+
+  absl::Span<const cel::AttributePattern> GetUnknownAttributes()
+      const override {
+    return activation_.GetUnknownAttributes();
+  }
+
+  absl::Span<const cel::AttributePattern> GetMissingAttributes()
+      const override {
+    return activation_.GetMissingAttributes();
+  }
+
+  FunctionResultStore* GetFunctionResultStore() const override {
+    return activation_.GetFunctionResultStore();
+  }
+
+ private:
+  const ActivationInterface& activation_;
+  const BatchFunctions& functions_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::vector<Handle<Value>>> EvaluateBatchWithBatchFunctions(
+    const Program& program, const FunctionRegistry& registry,
+    absl::Span<const ActivationInterface* const> activations,
+    ValueFactory& value_factory, const BatchEvaluateOptions& options) {
+  BatchFunctions functions(registry);
+  std::vector<Handle<Value>> results(activations.size());
+  std::vector<size_t> rows(activations.size());
+  std::iota(rows.begin(), rows.end(), 0);
+
+  for (int round = 0; !rows.empty(); ++round) {
+    functions.set_deferring(round + 1 < options.max_rounds);
+    std::vector<size_t> deferred_rows;
+    for (size_t row : rows) {
+      BatchActivation activation(*activations[row], functions);
+      CEL_ASSIGN_OR_RETURN(results[row],
+                           program.Evaluate(activation, value_factory));
+      if (functions.TakeDeferredInRow()) {
+        deferred_rows.push_back(row);
+      }
+    }
+    CEL_RETURN_IF_ERROR(functions.Flush(value_factory));
+    rows = std::move(deferred_rows);
+  }
+  return results;
+}
+
+}  // namespace cel
@@ -0,0 +1,62 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_EVALUATE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_EVALUATE_H_
+
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/function_registry.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+struct BatchEvaluateOptions {
+  // Upper bound on the number of passes over the batch. Calls that are still
+  // reached in the last pass (e.g. a batch function applied to the result of
+  // another) use the fallback overload instead of being batched.
+  int max_rounds = 4;
+};
+
+// Evaluate program once per activation, calling the batch functions
+// registered in registry once per pass over the batch instead of once per
+// row.
+//
+// In each pass, a batch function call without a result is recorded and
+// evaluates to an unknown function result (or an error, if unknown function
+// results are disabled in the RuntimeOptions). After the pass, each batch
+// function is invoked once with the recorded calls of all rows, and the rows
+// that recorded calls are evaluated again. Identical calls are batched once.
+//
+// Results are keyed by the called overload and the argument values, so only
+// calls whose arguments are null, bool, int, uint, double, string, bytes,
+// duration or timestamp values are batched; other calls use the fallback.
+//
+// registry must be the registry the program was planned with. Results are
+// returned in activation order; a non-ok status stops the batch.
+absl::StatusOr<std::vector<Handle<Value>>> EvaluateBatchWithBatchFunctions(
+    const Program& program, const FunctionRegistry& registry,
+    absl::Span<const ActivationInterface* const> activations,
+    ValueFactory& value_factory,
+    const BatchEvaluateOptions& options = BatchEvaluateOptions());
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_EVALUATE_H_
@@ -0,0 +1,192 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/batch_evaluate.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/activation_interface.h"
+#include "runtime/batch_function.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::ElementsAre;
+
+// score(int) -> int computing 10 * x, one call at a time.
+class ScoreFunction : public Function {
+ public:
+  explicit ScoreFunction(int* calls) : calls_(calls) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    ++*calls_;
+    return context.value_factory().CreateIntValue(
+        10 * args[0].As<IntValue>()->NativeValue());
+  }
+
+ private:
+  int* calls_;
+};
+
+// Vectorized score(int) -> int, recording the size of each batch.
+class BatchScoreFunction : public BatchFunction {
+ public:
+  explicit BatchScoreFunction(std::vector<size_t>* batches)
+      : batches_(batches) {}
+
+  absl::Status InvokeBatch(
+      const FunctionEvaluationContext& context,
+      absl::Span<const absl::Span<const Handle<Value>>> args,
+      absl::Span<Handle<Value>> results) const override {
+    batches_->push_back(args.size());
+    for (size_t i = 0; i < args.size(); ++i) {
+      results[i] = context.value_factory().CreateIntValue(
+          10 * args[i][0].As<IntValue>()->NativeValue());
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  std::vector<size_t>* batches_;
+};
+
+class BatchEvaluateTest : public testing::TestWithParam<bool> {
+ public:
+  void SetUp() override {
+    RuntimeOptions options;
+    if (GetParam()) {
+      options.unknown_processing =
+          UnknownProcessingOptions::kAttributeAndFunction;
+    }
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    ASSERT_OK(builder.function_registry().RegisterBatchFunction(
+        FunctionDescriptor("score", false, {Kind::kInt}),
+        std::make_unique<ScoreFunction>(&fallback_calls_),
+        std::make_unique<BatchScoreFunction>(&batches_)));
+    registry_ = &builder.function_registry();
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+
+    for (int64_t x : {1, 2, 3}) {
+      activations_.emplace_back();
+      activations_.back().InsertOrAssignValue("x",
+                                              value_factory_.CreateIntValue(x));
+    }
+    for (const Activation& activation : activations_) {
+      activation_ptrs_.push_back(&activation);
+    }
+  }
+
+  absl::StatusOr<std::unique_ptr<Program>> Plan(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expr));
+    return ProtobufRuntimeAdapter::CreateProgram(*runtime_, parsed_expr);
+  }
+
+  std::vector<int64_t> AsInts(const std::vector<Handle<Value>>& values) {
+    std::vector<int64_t> ints;
+    for (const auto& value : values) {
+      ints.push_back(value->Is<IntValue>() ? value.As<IntValue>()->NativeValue()
+                                           : -1);
+    }
+    return ints;
+  }
+
+ protected:
+  std::unique_ptr<const Runtime> runtime_;
+  const FunctionRegistry* registry_;
+  int fallback_calls_ = 0;
+  std::vector<size_t> batches_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+  std::vector<Activation> activations_;
+  std::vector<const ActivationInterface*> activation_ptrs_;
+};
+
+TEST_P(BatchEvaluateTest, OneCallPerBatch) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("score(x) + score(x + 1)"));
+
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      EvaluateBatchWithBatchFunctions(*program, *registry_, activation_ptrs_,
+                                      value_factory_.get()));
+
+  EXPECT_THAT(AsInts(results), ElementsAre(30, 50, 70));
+  // score(1..4), with score(2) and score(3) shared between rows.
+  EXPECT_THAT(batches_, ElementsAre(4));
+  EXPECT_EQ(fallback_calls_, 0);
+}
+
+TEST_P(BatchEvaluateTest, NestedCallsUseFallbackInLastRound) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("score(score(x))"));
+
+  BatchEvaluateOptions options;
+  options.max_rounds = 2;
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      EvaluateBatchWithBatchFunctions(*program, *registry_, activation_ptrs_,
+                                      value_factory_.get(), options));
+
+  EXPECT_THAT(AsInts(results), ElementsAre(100, 200, 300));
+  EXPECT_THAT(batches_, ElementsAre(3));
+  EXPECT_EQ(fallback_calls_, 3);
+}
+
+TEST_P(BatchEvaluateTest, PlainEvaluationUsesFallback) {
+  ASSERT_OK_AND_ASSIGN(auto program, Plan("score(x)"));
+
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      program->EvaluateBatch(activation_ptrs_, value_factory_.get()));
+
+  EXPECT_THAT(AsInts(results), ElementsAre(10, 20, 30));
+  EXPECT_TRUE(batches_.empty());
+  EXPECT_EQ(fallback_calls_, 3);
+}
+
+INSTANTIATE_TEST_SUITE_P(UnknownFunctionResults, BatchEvaluateTest,
+                         testing::Bool());
+
+}  // namespace
+}  // namespace cel
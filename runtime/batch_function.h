@@ -0,0 +1,50 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_FUNCTION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_FUNCTION_H_
+
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "base/function.h"
+#include "base/handle.h"
+#include "base/value.h"
+
+namespace cel {
+
+// Vectorized implementation of an extension function, invoked once for the
+// calls collected from a whole batch of activations.
+//
+// Batch functions are registered with FunctionRegistry::RegisterBatchFunction
+// next to a regular fallback implementation and are only invoked when a batch
+// is evaluated with EvaluateBatchWithBatchFunctions (see
+// runtime/batch_evaluate.h).
+class BatchFunction {
+ public:
+  virtual ~BatchFunction() = default;
+
+  // Computes results[i] for the call with arguments args[i]. results has the
+  // same size as args.
+  //
+  // As with Function::Invoke, a non-ok status stops evaluation while an
+  // ErrorValue result is a recoverable error for that call only.
+  virtual absl::Status InvokeBatch(
+      const FunctionEvaluationContext& context,
+      absl::Span<const absl::Span<const Handle<Value>>> args,
+      absl::Span<Handle<Value>> results) const = 0;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_BATCH_FUNCTION_H_
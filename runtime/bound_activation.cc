@@ -0,0 +1,80 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/bound_activation.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+
+namespace cel {
+
+absl::StatusOr<absl::optional<Handle<Value>>> BoundActivation::FindVariable(
+    ValueFactory& factory, absl::string_view name) const {
+  absl::optional<size_t> slot = FindSlot(name);
+  if (!slot.has_value() || !values_[*slot]) {
+    return absl::nullopt;
+  }
+  return values_[*slot];
+}
+
+absl::Span<const Handle<Value>> BoundActivation::GetBoundVariables(
+    absl::Span<const std::string> variable_names) const {
+  // Usually the same span the activation was created with, otherwise the
+  // slots only apply if the names are in the same order.
+  if (variable_names.data() == variable_names_.data() &&
+      variable_names.size() == variable_names_.size()) {
+    return values_;
+  }
+  if (variable_names == variable_names_) {
+    return values_;
+  }
+  return {};
+}
+
+absl::optional<size_t> BoundActivation::FindSlot(
+    absl::string_view name) const {
+  auto it = std::find(variable_names_.begin(), variable_names_.end(), name);
+  if (it == variable_names_.end()) {
+    return absl::nullopt;
+  }
+  return static_cast<size_t>(it - variable_names_.begin());
+}
+
+bool BoundActivation::InsertOrAssignValue(absl::string_view name,
+                                          Handle<Value> value) {
+  absl::optional<size_t> slot = FindSlot(name);
+  if (!slot.has_value()) {
+    return false;
+  }
+  values_[*slot] = std::move(value);
+  return true;
+}
+
+void BoundActivation::Clear() {
+  for (Handle<Value>& value : values_) {
+    value = Handle<Value>();
+  }
+}
+
+}  // namespace cel
@@ -0,0 +1,117 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_BOUND_ACTIVATION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_BOUND_ACTIVATION_H_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/function_overload_reference.h"
+
+namespace cel {
+
+// Thread-compatible activation which binds the variables of a program by
+// position rather than by name.
+//
+// The activation is created for the variable names of a program (see
+// Program::GetVariableNames()), and values are assigned to slots in the same
+// order. Evaluating the program reads variables from their slot, without
+// hashing names or taking locks. Slots may be resolved once per program with
+// FindSlot and reused for every activation.
+//
+// Does not support context functions or lazily provided values.
+class BoundActivation final : public ActivationInterface {
+ public:
+  // variable_names must outlive the activation.
+  explicit BoundActivation(absl::Span<const std::string> variable_names)
+      : variable_names_(variable_names), values_(variable_names.size()) {}
+
+  // Implements ActivationInterface.
+  //
+  // Looks up the slot of name with a linear search, so is only intended for
+  // variables read by name, e.g. those that may shadow enum constants.
+  absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
+      ValueFactory& factory, absl::string_view name) const override;
+
+  std::vector<FunctionOverloadReference> FindFunctionOverloads(
+      absl::string_view name) const override {
+    return {};
+  }
+
+  absl::Span<const cel::AttributePattern> GetUnknownAttributes()
+      const override {
+    return unknown_patterns_;
+  }
+
+  absl::Span<const cel::AttributePattern> GetMissingAttributes()
+      const override {
+    return missing_patterns_;
+  }
+
+  absl::Span<const Handle<Value>> GetBoundVariables(
+      absl::Span<const std::string> variable_names) const override;
+
+  // Returns the slot of the variable name, or nullopt if the program does not
+  // refer to it.
+  absl::optional<size_t> FindSlot(absl::string_view name) const;
+
+  size_t size() const { return values_.size(); }
+
+  // Binds value to the variable in slot, which must be less than size().
+  void SetValue(size_t slot, Handle<Value> value) {
+    values_[slot] = std::move(value);
+  }
+
+  // Binds value to the variable name.
+  //
+  // Returns false if the program does not refer to name, in which case the
+  // value is ignored.
+  bool InsertOrAssignValue(absl::string_view name, Handle<Value> value);
+
+  // Unbinds all variables, keeping the unknown and missing patterns, so that
+  // the activation can be reused for another evaluation.
+  void Clear();
+
+  void SetUnknownPatterns(std::vector<cel::AttributePattern> patterns) {
+    unknown_patterns_ = std::move(patterns);
+  }
+
+  void SetMissingPatterns(std::vector<cel::AttributePattern> patterns) {
+    missing_patterns_ = std::move(patterns);
+  }
+
+ private:
+  absl::Span<const std::string> variable_names_;
+  // Parallel to variable_names_. Empty handles are unbound.
+  std::vector<Handle<Value>> values_;
+
+  std::vector<cel::AttributePattern> unknown_patterns_;
+  std::vector<cel::AttributePattern> missing_patterns_;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_BOUND_ACTIVATION_H_
@@ -0,0 +1,189 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/bound_activation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/values/error_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/unknown_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::Optional;
+using testing::UnorderedElementsAre;
+
+class BoundActivationTest : public testing::Test {
+ protected:
+  absl::StatusOr<std::unique_ptr<Program>> CreateProgram(
+      absl::string_view expression, RuntimeOptions options = {}) {
+    CEL_ASSIGN_OR_RETURN(auto builder, CreateStandardRuntimeBuilder(options));
+    CEL_ASSIGN_OR_RETURN(runtime_, std::move(builder).Build());
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expression));
+    return ProtobufRuntimeAdapter::CreateProgram(*runtime_, parsed_expr);
+  }
+
+  Handle<Value> Int(int64_t value) {
+    return value_factory_.get().CreateIntValue(value);
+  }
+
+  std::unique_ptr<const Runtime> runtime_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+TEST_F(BoundActivationTest, Slots) {
+  std::vector<std::string> names = {"x", "y"};
+  BoundActivation activation(names);
+
+  EXPECT_EQ(activation.size(), 2);
+  EXPECT_THAT(activation.FindSlot("y"), Optional(1));
+  EXPECT_EQ(activation.FindSlot("z"), absl::nullopt);
+
+  activation.SetValue(1, Int(2));
+  EXPECT_TRUE(activation.InsertOrAssignValue("x", Int(1)));
+  EXPECT_FALSE(activation.InsertOrAssignValue("z", Int(3)));
+
+  ASSERT_OK_AND_ASSIGN(auto x,
+                       activation.FindVariable(value_factory_.get(), "x"));
+  ASSERT_TRUE(x.has_value());
+  EXPECT_EQ((*x).As<IntValue>()->NativeValue(), 1);
+  EXPECT_EQ(activation.GetBoundVariables(names).size(), 2);
+  std::vector<std::string> reordered = {"y", "x"};
+  EXPECT_TRUE(activation.GetBoundVariables(reordered).empty());
+
+  activation.Clear();
+  ASSERT_OK_AND_ASSIGN(x, activation.FindVariable(value_factory_.get(), "x"));
+  EXPECT_FALSE(x.has_value());
+}
+
+TEST_F(BoundActivationTest, ProgramVariableNames) {
+  ASSERT_OK_AND_ASSIGN(
+      auto program, CreateProgram("x + y > x && [1, 2].all(i, i < z + x)"));
+
+  EXPECT_THAT(program->GetVariableNames(), UnorderedElementsAre("x", "y", "z"));
+}
+
+TEST_F(BoundActivationTest, Evaluate) {
+  ASSERT_OK_AND_ASSIGN(auto program,
+                       CreateProgram("[1, 2].map(i, i * x + y)"));
+  BoundActivation activation(program->GetVariableNames());
+  size_t x_slot = activation.FindSlot("x").value();
+  size_t y_slot = activation.FindSlot("y").value();
+
+  for (int64_t x : {1, 2, 3}) {
+    activation.SetValue(x_slot, Int(x));
+    activation.SetValue(y_slot, Int(10));
+    ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                         program->Evaluate(activation, value_factory_.get()));
+    ASSERT_TRUE(result->Is<ListValue>()) << result->DebugString();
+    EXPECT_EQ(result->DebugString(),
+              absl::StrCat("[", x + 10, ", ", 2 * x + 10, "]"));
+  }
+}
+
+TEST_F(BoundActivationTest, EvaluateWithCopiedNames) {
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("x - y"));
+  std::vector<std::string> names(program->GetVariableNames().begin(),
+                                 program->GetVariableNames().end());
+  BoundActivation activation(names);
+  activation.InsertOrAssignValue("x", Int(5));
+  activation.InsertOrAssignValue("y", Int(3));
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory_.get()));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 2);
+}
+
+TEST_F(BoundActivationTest, UnboundVariable) {
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("x + y"));
+  BoundActivation activation(program->GetVariableNames());
+  activation.InsertOrAssignValue("x", Int(1));
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory_.get()));
+  ASSERT_TRUE(result->Is<ErrorValue>());
+  EXPECT_THAT(result.As<ErrorValue>()->NativeValue().message(),
+              testing::HasSubstr("\"y\""));
+}
+
+TEST_F(BoundActivationTest, ShadowedTypeConstant) {
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("int"));
+  EXPECT_THAT(program->GetVariableNames(), UnorderedElementsAre("int"));
+  BoundActivation activation(program->GetVariableNames());
+  activation.InsertOrAssignValue("int", Int(5));
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory_.get()));
+  ASSERT_TRUE(result->Is<IntValue>()) << result->DebugString();
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 5);
+}
+
+TEST_F(BoundActivationTest, DeclaredVariablesDoNotShadowTypeConstants) {
+  RuntimeOptions options;
+  options.declared_variables = std::vector<std::string>{"x"};
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("[x, int]", options));
+  EXPECT_THAT(program->GetVariableNames(), UnorderedElementsAre("x"));
+  BoundActivation activation(program->GetVariableNames());
+  activation.InsertOrAssignValue("x", Int(5));
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory_.get()));
+  EXPECT_EQ(result->DebugString(), "[5, int]");
+}
+
+TEST_F(BoundActivationTest, UnknownPatterns) {
+  RuntimeOptions options;
+  options.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("x + y", options));
+  BoundActivation activation(program->GetVariableNames());
+  activation.InsertOrAssignValue("x", Int(1));
+  activation.InsertOrAssignValue("y", Int(2));
+  activation.SetUnknownPatterns({AttributePattern("y", {})});
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory_.get()));
+  EXPECT_TRUE(result->Is<UnknownValue>());
+}
+
+}  // namespace
+}  // namespace cel
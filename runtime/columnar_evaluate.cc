@@ -0,0 +1,1349 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/columnar_evaluate.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/attribute.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/map_value_builder.h"
+#include "base/values/string_value.h"
+#include "base/values/uint_value.h"
+#include "eval/compiler/subexpression_analysis.h"
+#include "internal/overflow.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/function_overload_reference.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+struct ColumnarProgram::Node {
+  enum class Kind {
+    // A variable or field path bound to a column, named by name.
+    kColumn,
+    // The constant of one row in constant.
+    kConstant,
+    // A call of function name with args, the target first. For `in`,
+    // constant holds the elements of the list.
+    kCall,
+    // A subexpression evaluated one row at a time with program.
+    kRowWise,
+  };
+
+  Kind kind;
+  std::string name;
+  std::unique_ptr<Column> constant;
+  std::vector<std::unique_ptr<Node>> args;
+  std::unique_ptr<Program> program;
+};
+
+
+namespace runtime_internal {
+
+// Appends rows to a column of a given type.
+class ColumnBuilder final {
+ public:
+  ColumnBuilder(Column::Type type, size_t size) : column_(type, 0, {}) {
+    column_.validity_.reserve(size);
+  }
+
+  Column::Type type() const { return column_.type(); }
+
+  void AppendNull() {
+    switch (column_.type()) {
+      case Column::Type::kBool:
+        column_.bools_.push_back(0);
+        break;
+      case Column::Type::kInt:
+        column_.ints_.push_back(0);
+        break;
+      case Column::Type::kUint:
+        column_.uints_.push_back(0);
+        break;
+      case Column::Type::kDouble:
+        column_.doubles_.push_back(0);
+        break;
+      case Column::Type::kString:
+        column_.string_offsets_.push_back(column_.string_data_.size());
+        break;
+    }
+    column_.validity_.push_back(0);
+  }
+
+  void AppendString(absl::string_view value) {
+    column_.string_data_.append(value.data(), value.size());
+    column_.string_offsets_.push_back(column_.string_data_.size());
+    column_.validity_.push_back(1);
+  }
+
+  // Appends row of column, which has the type of this column.
+  void AppendRow(const Column& column, size_t row) {
+    if (!column.IsValid(row)) {
+      AppendNull();
+      return;
+    }
+    switch (column_.type()) {
+      case Column::Type::kBool:
+        column_.bools_.push_back(column.bools_[row]);
+        break;
+      case Column::Type::kInt:
+        column_.ints_.push_back(column.ints_[row]);
+        break;
+      case Column::Type::kUint:
+        column_.uints_.push_back(column.uints_[row]);
+        break;
+      case Column::Type::kDouble:
+        column_.doubles_.push_back(column.doubles_[row]);
+        break;
+      case Column::Type::kString:
+        AppendString(column.string(row));
+        return;
+    }
+    column_.validity_.push_back(1);
+  }
+
+  // Appends value if it is of the type of this column, returning false and
+  // appending nothing otherwise.
+  bool AppendValue(const Handle<Value>& value) {
+    switch (column_.type()) {
+      case Column::Type::kBool:
+        if (!value->Is<BoolValue>()) {
+          return false;
+        }
+        column_.bools_.push_back(value->As<BoolValue>().NativeValue());
+        break;
+      case Column::Type::kInt:
+        if (!value->Is<IntValue>()) {
+          return false;
+        }
+        column_.ints_.push_back(value->As<IntValue>().NativeValue());
+        break;
+      case Column::Type::kUint:
+        if (!value->Is<UintValue>()) {
+          return false;
+        }
+        column_.uints_.push_back(value->As<UintValue>().NativeValue());
+        break;
+      case Column::Type::kDouble:
+        if (!value->Is<DoubleValue>()) {
+          return false;
+        }
+        column_.doubles_.push_back(value->As<DoubleValue>().NativeValue());
+        break;
+      case Column::Type::kString:
+        if (!value->Is<StringValue>()) {
+          return false;
+        }
+        AppendString(value->As<StringValue>().ToString());
+        return true;
+    }
+    column_.validity_.push_back(1);
+    return true;
+  }
+
+  Column Build() && {
+    column_.size_ = column_.validity_.size();
+    return std::move(column_);
+  }
+
+ private:
+  Column column_;
+};
+
+}  // namespace runtime_internal
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::CheckedExpr;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Reference;
+using ::cel::ast_internal::SourceInfo;
+using ::cel::runtime_internal::ColumnBuilder;
+using ::google::api::expr::runtime::AppendAttributePath;
+using ::google::api::expr::runtime::ForEachChild;
+
+absl::optional<Column::Type> ColumnTypeOf(const Value& value) {
+  switch (value.kind()) {
+    case ValueKind::kBool:
+      return Column::Type::kBool;
+    case ValueKind::kInt:
+      return Column::Type::kInt;
+    case ValueKind::kUint:
+      return Column::Type::kUint;
+    case ValueKind::kDouble:
+      return Column::Type::kDouble;
+    case ValueKind::kString:
+      return Column::Type::kString;
+    default:
+      return absl::nullopt;
+  }
+}
+
+// Returns a column of one row holding constant, or nullptr if constant has
+// no column type.
+std::unique_ptr<Column> ConstantColumn(const Constant& constant) {
+  if (constant.has_bool_value()) {
+    return std::make_unique<Column>(
+        Column::Bool({static_cast<uint8_t>(constant.bool_value())}));
+  }
+  if (constant.has_int64_value()) {
+    return std::make_unique<Column>(Column::Int({constant.int64_value()}));
+  }
+  if (constant.has_uint64_value()) {
+    return std::make_unique<Column>(Column::Uint({constant.uint64_value()}));
+  }
+  if (constant.has_double_value()) {
+    return std::make_unique<Column>(
+        Column::Double({constant.double_value()}));
+  }
+  if (constant.has_string_value()) {
+    return std::make_unique<Column>(
+        Column::String({constant.string_value()}));
+  }
+  return nullptr;
+}
+
+// Returns a column of the elements of a list of constants of one column
+// type, or nullptr if expr is not such a list.
+std::unique_ptr<Column> ConstantListColumn(const Expr& expr) {
+  if (!expr.has_list_expr() ||
+      !expr.list_expr().optional_indices().empty() ||
+      expr.list_expr().elements().empty()) {
+    return nullptr;
+  }
+  absl::optional<ColumnBuilder> builder;
+  for (const Expr& element : expr.list_expr().elements()) {
+    if (!element.has_const_expr()) {
+      return nullptr;
+    }
+    std::unique_ptr<Column> constant = ConstantColumn(element.const_expr());
+    if (constant == nullptr) {
+      return nullptr;
+    }
+    if (!builder.has_value()) {
+      builder.emplace(constant->type(), expr.list_expr().elements().size());
+    }
+    if (builder->type() != constant->type()) {
+      return nullptr;
+    }
+    builder->AppendRow(*constant, 0);
+  }
+  return std::make_unique<Column>(std::move(*builder).Build());
+}
+
+bool IsComparison(absl::string_view function) {
+  return function == builtin::kEqual || function == builtin::kInequal ||
+         function == builtin::kLess || function == builtin::kLessOrEqual ||
+         function == builtin::kGreater ||
+         function == builtin::kGreaterOrEqual;
+}
+
+bool IsArithmetic(absl::string_view function) {
+  return function == builtin::kAdd || function == builtin::kSubtract ||
+         function == builtin::kMultiply || function == builtin::kDivide ||
+         function == builtin::kModulo;
+}
+
+bool IsStringPredicate(absl::string_view function) {
+  return function == builtin::kStringStartsWith ||
+         function == builtin::kStringEndsWith ||
+         function == builtin::kStringContains;
+}
+
+// Whether call is one of the vectorized functions, other than `in`.
+bool IsVectorizedCall(const ast_internal::Call& call) {
+  absl::string_view function = call.function();
+  if (call.has_target()) {
+    return call.args().size() == 1 && IsStringPredicate(function);
+  }
+  switch (call.args().size()) {
+    case 1:
+      return function == builtin::kNot || function == builtin::kNeg;
+    case 2:
+      return function == builtin::kAnd || function == builtin::kOr ||
+             IsComparison(function) || IsArithmetic(function);
+    case 3:
+      return function == builtin::kTernary;
+    default:
+      return false;
+  }
+}
+
+void CollectReferences(const AstImpl& ast, Expr& expr,
+                       absl::flat_hash_map<int64_t, Reference>& references) {
+  if (const Reference* reference = ast.GetReference(expr.id());
+      reference != nullptr) {
+    references.insert({expr.id(), *reference});
+  }
+  ForEachChild(expr, [&](Expr& child) {
+    CollectReferences(ast, child, references);
+  });
+}
+
+// Creates an AST evaluating the subexpression expr of ast.
+std::unique_ptr<Ast> CreateSubexpressionAst(const AstImpl& ast,
+                                            const Expr& expr) {
+  Expr subexpression = expr.DeepCopy();
+  absl::flat_hash_map<int64_t, Reference> references;
+  CollectReferences(ast, subexpression, references);
+  if (ast.IsChecked()) {
+    CheckedExpr checked_expr;
+    checked_expr.set_expr(std::move(subexpression));
+    checked_expr.set_reference_map(std::move(references));
+    return std::make_unique<AstImpl>(std::move(checked_expr));
+  }
+  auto result =
+      std::make_unique<AstImpl>(std::move(subexpression), SourceInfo());
+  result->reference_map() = std::move(references);
+  return result;
+}
+
+// Activation of one row of a ColumnarActivation, for evaluating rows with a
+// program. Variables bound to columns are the value of the row. Variables
+// with fields bound to columns are maps from the field names to their
+// values, so that selecting the fields yields the values of the row.
+class RowActivation final : public ActivationInterface {
+ public:
+  void Add(absl::string_view path, const Column& column) {
+    PathNode* node = &root_;
+    for (absl::string_view name : absl::StrSplit(path, '.')) {
+      auto& field = node->fields[name];
+      if (field == nullptr) {
+        field = std::make_unique<PathNode>();
+      }
+      node = field.get();
+    }
+    node->column = &column;
+  }
+
+  void set_row(size_t row) { row_ = row; }
+
+  absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
+      ValueFactory& factory, absl::string_view name) const override {
+    const PathNode* node = &root_;
+    for (absl::string_view field : absl::StrSplit(name, '.')) {
+      auto it = node->fields.find(field);
+      if (it == node->fields.end()) {
+        return absl::nullopt;
+      }
+      node = it->second.get();
+    }
+    return NodeValue(factory, *node);
+  }
+
+  std::vector<FunctionOverloadReference> FindFunctionOverloads(
+      absl::string_view name) const override {
+    return {};
+  }
+
+  absl::Span<const AttributePattern> GetUnknownAttributes() const override {
+    return {};
+  }
+
+  absl::Span<const AttributePattern> GetMissingAttributes() const override {
+    return {};
+  }
+
+ private:
+  struct PathNode {
+    const Column* column = nullptr;
+    absl::flat_hash_map<std::string, std::unique_ptr<PathNode>> fields;
+  };
+
+  absl::StatusOr<Handle<Value>> NodeValue(ValueFactory& factory,
+                                          const PathNode& node) const {
+    if (node.column != nullptr) {
+      return node.column->GetValue(factory, row_);
+    }
+    MapValueBuilder<StringValue, Value> builder(
+        factory, factory.type_factory().GetStringType(),
+        factory.type_factory().GetDynType());
+    for (const auto& [name, field] : node.fields) {
+      CEL_ASSIGN_OR_RETURN(auto value, NodeValue(factory, *field));
+      CEL_RETURN_IF_ERROR(builder.Put(
+          factory.CreateUncheckedStringValue(name), std::move(value)));
+    }
+    CEL_ASSIGN_OR_RETURN(auto map, std::move(builder).Build());
+    return map;
+  }
+
+  PathNode root_;
+  size_t row_ = 0;
+};
+
+// A strided array: stride 0 repeats the first element for every row.
+template <typename T>
+struct Strided {
+  const T* data;
+  size_t stride;
+
+  T operator[](size_t i) const { return data[i * stride]; }
+};
+
+struct StridedStrings {
+  const Column* column;
+  size_t stride;
+
+  absl::string_view operator[](size_t i) const {
+    return column->string(i * stride);
+  }
+};
+
+enum class CompareOp {
+  kEqual,
+  kNotEqual,
+  kLess,
+  kLessEq,
+  kGreater,
+  kGreaterEq,
+};
+
+template <CompareOp kOp, typename T>
+bool Compare(const T& x, const T& y) {
+  switch (kOp) {
+    case CompareOp::kEqual:
+      return x == y;
+    case CompareOp::kNotEqual:
+      return x != y;
+    case CompareOp::kLess:
+      return x < y;
+    case CompareOp::kLessEq:
+      return x <= y;
+    case CompareOp::kGreater:
+      return x > y;
+    case CompareOp::kGreaterEq:
+      return x >= y;
+  }
+  return false;
+}
+
+CompareOp CompareOpOf(absl::string_view function) {
+  if (function == builtin::kEqual) {
+    return CompareOp::kEqual;
+  }
+  if (function == builtin::kInequal) {
+    return CompareOp::kNotEqual;
+  }
+  if (function == builtin::kLess) {
+    return CompareOp::kLess;
+  }
+  if (function == builtin::kLessOrEqual) {
+    return CompareOp::kLessEq;
+  }
+  if (function == builtin::kGreater) {
+    return CompareOp::kGreater;
+  }
+  return CompareOp::kGreaterEq;
+}
+
+Column MakeColumn(std::vector<uint8_t> values, std::vector<uint8_t> validity) {
+  return Column::Bool(std::move(values), std::move(validity));
+}
+
+Column MakeColumn(std::vector<int64_t> values, std::vector<uint8_t> validity) {
+  return Column::Int(std::move(values), std::move(validity));
+}
+
+Column MakeColumn(std::vector<uint64_t> values,
+                  std::vector<uint8_t> validity) {
+  return Column::Uint(std::move(values), std::move(validity));
+}
+
+Column MakeColumn(std::vector<double> values, std::vector<uint8_t> validity) {
+  return Column::Double(std::move(values), std::move(validity));
+}
+
+}  // namespace
+
+namespace runtime_internal {
+
+class ColumnarProgramBuilder final {
+ public:
+  static absl::StatusOr<std::unique_ptr<ColumnarProgram>> Create(
+      const Runtime& runtime, std::unique_ptr<Ast> ast) {
+    if (ast == nullptr) {
+      return absl::InvalidArgumentError("AST must not be null");
+    }
+    auto program = absl::WrapUnique(new ColumnarProgram());
+    ColumnarProgramBuilder builder(runtime, AstImpl::CastFromPublicAst(*ast));
+    CEL_ASSIGN_OR_RETURN(program->root_,
+                         builder.Compile(builder.ast_.root_expr()));
+    CEL_ASSIGN_OR_RETURN(program->program_,
+                         runtime.CreateProgram(std::move(ast)));
+    return program;
+  }
+
+ private:
+  using Node = ColumnarProgram::Node;
+
+  ColumnarProgramBuilder(const Runtime& runtime, const AstImpl& ast)
+      : runtime_(runtime), ast_(ast) {}
+
+  absl::StatusOr<std::unique_ptr<Node>> Compile(const Expr& expr) {
+    auto node = std::make_unique<Node>();
+    if (std::string path; AppendAttributePath(ast_, expr, path)) {
+      node->kind = Node::Kind::kColumn;
+      node->name = std::move(path);
+      return node;
+    }
+    if (expr.has_const_expr()) {
+      node->constant = ConstantColumn(expr.const_expr());
+      if (node->constant != nullptr) {
+        node->kind = Node::Kind::kConstant;
+        return node;
+      }
+    }
+    if (expr.has_call_expr()) {
+      const auto& call = expr.call_expr();
+      if (call.function() == builtin::kIn && !call.has_target() &&
+          call.args().size() == 2) {
+        node->constant = ConstantListColumn(call.args()[1]);
+        if (node->constant != nullptr) {
+          node->kind = Node::Kind::kCall;
+          node->name = call.function();
+          CEL_ASSIGN_OR_RETURN(node->args.emplace_back(),
+                               Compile(call.args()[0]));
+          return node;
+        }
+      } else if (IsVectorizedCall(call)) {
+        node->kind = Node::Kind::kCall;
+        node->name = call.function();
+        if (call.has_target()) {
+          CEL_ASSIGN_OR_RETURN(node->args.emplace_back(),
+                               Compile(call.target()));
+        }
+        for (const Expr& arg : call.args()) {
+          CEL_ASSIGN_OR_RETURN(node->args.emplace_back(), Compile(arg));
+        }
+        return node;
+      }
+    }
+    node->kind = Node::Kind::kRowWise;
+    node->constant = nullptr;
+    CEL_ASSIGN_OR_RETURN(node->program, runtime_.CreateProgram(
+                                            CreateSubexpressionAst(ast_,
+                                                                   expr)));
+    return node;
+  }
+
+  const Runtime& runtime_;
+  const AstImpl& ast_;
+};
+
+// Evaluates a ColumnarProgram over one activation.
+class ColumnarEvaluator final {
+ public:
+  ColumnarEvaluator(const ColumnarProgram& program,
+                    const ColumnarActivation& activation,
+                    ValueFactory& value_factory)
+      : program_(program),
+        activation_(activation),
+        value_factory_(value_factory),
+        size_(activation.size()) {
+    for (const auto& [path, column] : activation.columns_) {
+      row_activation_.Add(path, *column);
+    }
+  }
+
+  absl::StatusOr<ColumnarResult> Evaluate() {
+    ColumnarResult result;
+    absl::optional<Operand> root;
+    if (program_.root_->kind != Node::Kind::kRowWise) {
+      CEL_ASSIGN_OR_RETURN(root, Eval(*program_.root_));
+    }
+    if (!root.has_value()) {
+      std::vector<Handle<Value>> values;
+      values.reserve(size_);
+      for (size_t row = 0; row < size_; ++row) {
+        CEL_ASSIGN_OR_RETURN(values.emplace_back(),
+                             EvaluateRow(*program_.program_, row));
+      }
+      result.row_wise_rows = size_;
+      result.column = ColumnOfValues(values, &result.other_results);
+      return result;
+    }
+    result.vectorized = true;
+    const Column& column = *root->column;
+    if (column.validity().empty() && root->owned != nullptr &&
+        !root->broadcast) {
+      result.column = std::move(*root->owned);
+      return result;
+    }
+    // Complete the rows the kernels could not compute with the program.
+    ColumnBuilder builder(column.type(), size_);
+    for (size_t row = 0; row < size_; ++row) {
+      size_t column_row = row * root->stride();
+      if (column.IsValid(column_row)) {
+        builder.AppendRow(column, column_row);
+        continue;
+      }
+      ++result.row_wise_rows;
+      CEL_ASSIGN_OR_RETURN(auto value, EvaluateRow(*program_.program_, row));
+      if (!builder.AppendValue(value)) {
+        builder.AppendNull();
+        result.other_results.insert({row, std::move(value)});
+      }
+    }
+    result.column = std::move(builder).Build();
+    return result;
+  }
+
+  absl::StatusOr<std::vector<size_t>> Filter() {
+    std::vector<const Node*> clauses;
+    AppendClauses(*program_.root_, clauses);
+    std::vector<size_t> selection(size_);
+    for (size_t row = 0; row < size_; ++row) {
+      selection[row] = row;
+    }
+    // Rows whose result was decided by evaluating the program, because a
+    // clause could not be computed by the kernels.
+    std::vector<size_t> decided;
+    for (const Node* clause : clauses) {
+      if (selection.empty()) {
+        break;
+      }
+      selection_ = &selection;
+      size_ = selection.size();
+      absl::optional<Operand> result;
+      if (clause->kind != Node::Kind::kRowWise) {
+        CEL_ASSIGN_OR_RETURN(result, Eval(*clause));
+      }
+      if (!result.has_value() || result->type() != Column::Type::kBool) {
+        for (size_t row : selection) {
+          CEL_ASSIGN_OR_RETURN(bool selected, IsSelected(row));
+          if (selected) {
+            decided.push_back(row);
+          }
+        }
+        selection.clear();
+        break;
+      }
+      const Column& column = *result->column;
+      std::vector<size_t> survivors;
+      for (size_t i = 0; i < selection.size(); ++i) {
+        size_t column_row = i * result->stride();
+        if (column.IsValid(column_row)) {
+          if (column.bools()[column_row]) {
+            survivors.push_back(selection[i]);
+          }
+          continue;
+        }
+        CEL_ASSIGN_OR_RETURN(bool selected, IsSelected(selection[i]));
+        if (selected) {
+          decided.push_back(selection[i]);
+        }
+      }
+      selection = std::move(survivors);
+    }
+    if (!decided.empty()) {
+      selection.insert(selection.end(), decided.begin(), decided.end());
+      std::sort(selection.begin(), selection.end());
+    }
+    return selection;
+  }
+
+ private:
+  using Node = ColumnarProgram::Node;
+
+  // Appends the clauses of the conjunction node, in evaluation order.
+  static void AppendClauses(const Node& node,
+                            std::vector<const Node*>& clauses) {
+    if (node.kind == Node::Kind::kCall && node.name == builtin::kAnd) {
+      for (const auto& arg : node.args) {
+        AppendClauses(*arg, clauses);
+      }
+      return;
+    }
+    clauses.push_back(&node);
+  }
+
+  // Whether the whole expression is true for row.
+  absl::StatusOr<bool> IsSelected(size_t row) {
+    CEL_ASSIGN_OR_RETURN(auto value, EvaluateRow(*program_.program_, row));
+    return value->Is<BoolValue>() && value->As<BoolValue>().NativeValue();
+  }
+
+  // The row of the activation of row i of the operands.
+  size_t RowOf(size_t i) const {
+    return selection_ == nullptr ? i : (*selection_)[i];
+  }
+
+  // An operand of a kernel: a column with a row per row of the activation,
+  // or a constant broadcast to every row.
+  struct Operand {
+    const Column* column;
+    // Set for the results of kernels. Shared, as constants and the columns
+    // of the activation are not owned.
+    std::shared_ptr<Column> owned;
+    bool broadcast = false;
+
+    Column::Type type() const { return column->type(); }
+    size_t stride() const { return broadcast ? 0 : 1; }
+  };
+
+  static Operand Owned(Column column) {
+    auto owned = std::make_shared<Column>(std::move(column));
+    const Column* pointer = owned.get();
+    return Operand{pointer, std::move(owned)};
+  }
+
+  static Strided<uint8_t> ValidityOf(const Operand& operand) {
+    static constexpr uint8_t kValid = 1;
+    if (operand.column->validity().empty()) {
+      return Strided<uint8_t>{&kValid, 0};
+    }
+    return Strided<uint8_t>{operand.column->validity().data(),
+                            operand.stride()};
+  }
+
+  template <typename T>
+  static Strided<T> ValuesOf(const Operand& operand) {
+    const Column& column = *operand.column;
+    if constexpr (std::is_same_v<T, uint8_t>) {
+      return Strided<T>{column.bools().data(), operand.stride()};
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+      return Strided<T>{column.ints().data(), operand.stride()};
+    } else if constexpr (std::is_same_v<T, uint64_t>) {
+      return Strided<T>{column.uints().data(), operand.stride()};
+    } else {
+      return Strided<T>{column.doubles().data(), operand.stride()};
+    }
+  }
+
+  static StridedStrings StringsOf(const Operand& operand) {
+    return StridedStrings{operand.column, operand.stride()};
+  }
+
+  absl::StatusOr<Handle<Value>> EvaluateRow(const Program& program,
+                                            size_t row) {
+    row_activation_.set_row(row);
+    return program.Evaluate(row_activation_, value_factory_);
+  }
+
+  // Returns a column of the values of the column type of the first value
+  // which has one. Other values are null, and stored in other_results if it
+  // is not null.
+  Column ColumnOfValues(
+      absl::Span<const Handle<Value>> values,
+      absl::flat_hash_map<size_t, Handle<Value>>* other_results) {
+    Column::Type type = Column::Type::kBool;
+    for (const auto& value : values) {
+      if (auto value_type = ColumnTypeOf(*value); value_type.has_value()) {
+        type = *value_type;
+        break;
+      }
+    }
+    ColumnBuilder builder(type, values.size());
+    for (size_t row = 0; row < values.size(); ++row) {
+      if (!builder.AppendValue(values[row])) {
+        builder.AppendNull();
+        if (other_results != nullptr) {
+          other_results->insert({row, values[row]});
+        }
+      }
+    }
+    return std::move(builder).Build();
+  }
+
+  // Returns the column of node, or nullopt if its operands don't fit the
+  // kernels.
+  absl::StatusOr<absl::optional<Operand>> Eval(const Node& node) {
+    switch (node.kind) {
+      case Node::Kind::kColumn: {
+        const Column* column = activation_.Find(node.name);
+        if (column == nullptr) {
+          return absl::nullopt;
+        }
+        if (selection_ != nullptr) {
+          // Gather the selected rows, so that kernels run over them only.
+          ColumnBuilder builder(column->type(), size_);
+          for (size_t i = 0; i < size_; ++i) {
+            builder.AppendRow(*column, RowOf(i));
+          }
+          return Owned(std::move(builder).Build());
+        }
+        return Operand{column, nullptr};
+      }
+      case Node::Kind::kConstant:
+        return Operand{node.constant.get(), nullptr, /*broadcast=*/true};
+      case Node::Kind::kCall:
+        return EvalCall(node);
+      case Node::Kind::kRowWise: {
+        std::vector<Handle<Value>> values;
+        values.reserve(size_);
+        for (size_t row = 0; row < size_; ++row) {
+          CEL_ASSIGN_OR_RETURN(values.emplace_back(),
+                               EvaluateRow(*node.program, RowOf(row)));
+        }
+        return Owned(ColumnOfValues(values, nullptr));
+      }
+    }
+    return absl::nullopt;
+  }
+
+  absl::StatusOr<absl::optional<Operand>> EvalCall(const Node& node) {
+    std::vector<Operand> args;
+    args.reserve(node.args.size());
+    for (const auto& arg : node.args) {
+      CEL_ASSIGN_OR_RETURN(auto operand, Eval(*arg));
+      if (!operand.has_value()) {
+        return absl::nullopt;
+      }
+      args.push_back(*std::move(operand));
+    }
+    absl::string_view function = node.name;
+    if (function == builtin::kIn) {
+      return In(args[0], *node.constant);
+    }
+    if (function == builtin::kNot) {
+      return Not(args[0]);
+    }
+    if (function == builtin::kNeg) {
+      return Negate(args[0]);
+    }
+    if (function == builtin::kTernary) {
+      return Ternary(args[0], args[1], args[2]);
+    }
+    if (args[0].type() != args[1].type()) {
+      // CEL has no implicit conversions; heterogeneous comparisons are left
+      // to the program.
+      return absl::nullopt;
+    }
+    if (function == builtin::kAnd || function == builtin::kOr) {
+      return Logical(function == builtin::kAnd, args[0], args[1]);
+    }
+    if (IsComparison(function)) {
+      return Comparison(CompareOpOf(function), args[0], args[1]);
+    }
+    if (IsStringPredicate(function)) {
+      return StringPredicate(function, args[0], args[1]);
+    }
+    return Arithmetic(function, args[0], args[1]);
+  }
+
+  // Computes `f(a[i], b[i], &out[i])` for each row. Rows where either
+  // operand is null or f returns false are null.
+  template <typename R, typename A, typename B, typename F>
+  Operand Binary(const Operand& a, A a_values, const Operand& b, B b_values,
+                 F f) {
+    Strided<uint8_t> a_valid = ValidityOf(a);
+    Strided<uint8_t> b_valid = ValidityOf(b);
+    std::vector<R> out(size_);
+    std::vector<uint8_t> validity(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      bool ok = f(a_values[i], b_values[i], &out[i]);
+      validity[i] = a_valid[i] & b_valid[i] & static_cast<uint8_t>(ok);
+    }
+    return Owned(MakeColumn(std::move(out), std::move(validity)));
+  }
+
+  template <typename T>
+  Operand NativeBinary(const Operand& a, const Operand& b,
+                       bool (*f)(T, T, T*)) {
+    return Binary<T>(a, ValuesOf<T>(a), b, ValuesOf<T>(b), f);
+  }
+
+  template <CompareOp kOp>
+  absl::optional<Operand> ComparisonOf(const Operand& a, const Operand& b) {
+    auto compare = [](auto x, auto y, uint8_t* out) {
+      *out = Compare<kOp>(x, y);
+      return true;
+    };
+    switch (a.type()) {
+      case Column::Type::kBool:
+        return Binary<uint8_t>(a, ValuesOf<uint8_t>(a), b, ValuesOf<uint8_t>(b),
+                               compare);
+      case Column::Type::kInt:
+        return Binary<uint8_t>(a, ValuesOf<int64_t>(a), b, ValuesOf<int64_t>(b),
+                               compare);
+      case Column::Type::kUint:
+        return Binary<uint8_t>(a, ValuesOf<uint64_t>(a), b,
+                               ValuesOf<uint64_t>(b), compare);
+      case Column::Type::kDouble:
+        return Binary<uint8_t>(a, ValuesOf<double>(a), b, ValuesOf<double>(b),
+                               compare);
+      case Column::Type::kString:
+        return Binary<uint8_t>(a, StringsOf(a), b, StringsOf(b), compare);
+    }
+    return absl::nullopt;
+  }
+
+  absl::optional<Operand> Comparison(CompareOp op, const Operand& a,
+                                     const Operand& b) {
+    switch (op) {
+      case CompareOp::kEqual:
+        return ComparisonOf<CompareOp::kEqual>(a, b);
+      case CompareOp::kNotEqual:
+        return ComparisonOf<CompareOp::kNotEqual>(a, b);
+      case CompareOp::kLess:
+        return ComparisonOf<CompareOp::kLess>(a, b);
+      case CompareOp::kLessEq:
+        return ComparisonOf<CompareOp::kLessEq>(a, b);
+      case CompareOp::kGreater:
+        return ComparisonOf<CompareOp::kGreater>(a, b);
+      case CompareOp::kGreaterEq:
+        return ComparisonOf<CompareOp::kGreaterEq>(a, b);
+    }
+    return absl::nullopt;
+  }
+
+  absl::optional<Operand> Arithmetic(absl::string_view function,
+                                     const Operand& a, const Operand& b) {
+    switch (a.type()) {
+      case Column::Type::kInt:
+        return IntArithmetic(function, a, b);
+      case Column::Type::kUint:
+        return UintArithmetic(function, a, b);
+      case Column::Type::kDouble:
+        return DoubleArithmetic(function, a, b);
+      case Column::Type::kString:
+        if (function == builtin::kAdd) {
+          return Concatenate(a, b);
+        }
+        return absl::nullopt;
+      default:
+        return absl::nullopt;
+    }
+  }
+
+  absl::optional<Operand> IntArithmetic(absl::string_view function,
+                                        const Operand& a, const Operand& b) {
+    if (function == builtin::kAdd) {
+      return NativeBinary<int64_t>(a, b, &internal::TryAdd);
+    }
+    if (function == builtin::kSubtract) {
+      return NativeBinary<int64_t>(a, b, &internal::TrySub);
+    }
+    if (function == builtin::kMultiply) {
+      return NativeBinary<int64_t>(a, b, &internal::TryMul);
+    }
+    if (function == builtin::kDivide) {
+      return NativeBinary<int64_t>(a, b, [](int64_t x, int64_t y, int64_t* r) {
+        if (y == 0 || (x == std::numeric_limits<int64_t>::min() && y == -1)) {
+          return false;
+        }
+        *r = x / y;
+        return true;
+      });
+    }
+    return NativeBinary<int64_t>(a, b, [](int64_t x, int64_t y, int64_t* r) {
+      if (y == 0 || (x == std::numeric_limits<int64_t>::min() && y == -1)) {
+        return false;
+      }
+      *r = x % y;
+      return true;
+    });
+  }
+
+  absl::optional<Operand> UintArithmetic(absl::string_view function,
+                                         const Operand& a, const Operand& b) {
+    if (function == builtin::kAdd) {
+      return NativeBinary<uint64_t>(a, b, &internal::TryAdd);
+    }
+    if (function == builtin::kSubtract) {
+      return NativeBinary<uint64_t>(a, b, &internal::TrySub);
+    }
+    if (function == builtin::kMultiply) {
+      return NativeBinary<uint64_t>(a, b, &internal::TryMul);
+    }
+    if (function == builtin::kDivide) {
+      return NativeBinary<uint64_t>(a, b,
+                                    [](uint64_t x, uint64_t y, uint64_t* r) {
+                                      if (y == 0) {
+                                        return false;
+                                      }
+                                      *r = x / y;
+                                      return true;
+                                    });
+    }
+    return NativeBinary<uint64_t>(a, b,
+                                  [](uint64_t x, uint64_t y, uint64_t* r) {
+                                    if (y == 0) {
+                                      return false;
+                                    }
+                                    *r = x % y;
+                                    return true;
+                                  });
+  }
+
+  absl::optional<Operand> DoubleArithmetic(absl::string_view function,
+                                           const Operand& a,
+                                           const Operand& b) {
+    if (function == builtin::kAdd) {
+      return NativeBinary<double>(a, b, [](double x, double y, double* r) {
+        *r = x + y;
+        return true;
+      });
+    }
+    if (function == builtin::kSubtract) {
+      return NativeBinary<double>(a, b, [](double x, double y, double* r) {
+        *r = x - y;
+        return true;
+      });
+    }
+    if (function == builtin::kMultiply) {
+      return NativeBinary<double>(a, b, [](double x, double y, double* r) {
+        *r = x * y;
+        return true;
+      });
+    }
+    if (function == builtin::kDivide) {
+      return NativeBinary<double>(a, b, [](double x, double y, double* r) {
+        *r = x / y;
+        return true;
+      });
+    }
+    // There is no double modulo.
+    return absl::nullopt;
+  }
+
+  Operand Concatenate(const Operand& a, const Operand& b) {
+    StridedStrings a_values = StringsOf(a);
+    StridedStrings b_values = StringsOf(b);
+    Strided<uint8_t> a_valid = ValidityOf(a);
+    Strided<uint8_t> b_valid = ValidityOf(b);
+    ColumnBuilder builder(Column::Type::kString, size_);
+    std::string value;
+    for (size_t i = 0; i < size_; ++i) {
+      if (!(a_valid[i] & b_valid[i])) {
+        builder.AppendNull();
+        continue;
+      }
+      value.assign(a_values[i].data(), a_values[i].size());
+      value.append(b_values[i].data(), b_values[i].size());
+      builder.AppendString(value);
+    }
+    return Owned(std::move(builder).Build());
+  }
+
+  absl::optional<Operand> StringPredicate(absl::string_view function,
+                                          const Operand& a,
+                                          const Operand& b) {
+    if (a.type() != Column::Type::kString) {
+      return absl::nullopt;
+    }
+    if (function == builtin::kStringStartsWith) {
+      return Binary<uint8_t>(
+          a, StringsOf(a), b, StringsOf(b),
+          [](absl::string_view x, absl::string_view y, uint8_t* out) {
+            *out = absl::StartsWith(x, y);
+            return true;
+          });
+    }
+    if (function == builtin::kStringEndsWith) {
+      return Binary<uint8_t>(
+          a, StringsOf(a), b, StringsOf(b),
+          [](absl::string_view x, absl::string_view y, uint8_t* out) {
+            *out = absl::EndsWith(x, y);
+            return true;
+          });
+    }
+    return Binary<uint8_t>(
+        a, StringsOf(a), b, StringsOf(b),
+        [](absl::string_view x, absl::string_view y, uint8_t* out) {
+          *out = absl::StrContains(x, y);
+          return true;
+        });
+  }
+
+  // `a && b` or `a || b`. As in CEL, a null operand does not make the result
+  // null if the other operand decides it.
+  absl::optional<Operand> Logical(bool conjunction, const Operand& a,
+                                  const Operand& b) {
+    if (a.type() != Column::Type::kBool) {
+      return absl::nullopt;
+    }
+    Strided<uint8_t> a_values = ValuesOf<uint8_t>(a);
+    Strided<uint8_t> b_values = ValuesOf<uint8_t>(b);
+    Strided<uint8_t> a_valid = ValidityOf(a);
+    Strided<uint8_t> b_valid = ValidityOf(b);
+    // The value deciding the result on its own: false for &&, true for ||.
+    const uint8_t decisive = conjunction ? 0 : 1;
+    std::vector<uint8_t> out(size_);
+    std::vector<uint8_t> validity(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      uint8_t a_decides = a_valid[i] & (a_values[i] == decisive);
+      uint8_t b_decides = b_valid[i] & (b_values[i] == decisive);
+      uint8_t decided = a_decides | b_decides;
+      out[i] = decided ? decisive : static_cast<uint8_t>(1 - decisive);
+      validity[i] = decided | (a_valid[i] & b_valid[i]);
+    }
+    return Owned(Column::Bool(std::move(out), std::move(validity)));
+  }
+
+  absl::optional<Operand> Not(const Operand& a) {
+    if (a.type() != Column::Type::kBool) {
+      return absl::nullopt;
+    }
+    Strided<uint8_t> values = ValuesOf<uint8_t>(a);
+    Strided<uint8_t> valid = ValidityOf(a);
+    std::vector<uint8_t> out(size_);
+    std::vector<uint8_t> validity(size_);
+    for (size_t i = 0; i < size_; ++i) {
+      out[i] = values[i] ^ 1;
+      validity[i] = valid[i];
+    }
+    return Owned(Column::Bool(std::move(out), std::move(validity)));
+  }
+
+  absl::optional<Operand> Negate(const Operand& a) {
+    Strided<uint8_t> valid = ValidityOf(a);
+    std::vector<uint8_t> validity(size_);
+    if (a.type() == Column::Type::kInt) {
+      Strided<int64_t> values = ValuesOf<int64_t>(a);
+      std::vector<int64_t> out(size_);
+      for (size_t i = 0; i < size_; ++i) {
+        bool ok = internal::TryNegation(values[i], &out[i]);
+        validity[i] = valid[i] & static_cast<uint8_t>(ok);
+      }
+      return Owned(Column::Int(std::move(out), std::move(validity)));
+    }
+    if (a.type() == Column::Type::kDouble) {
+      Strided<double> values = ValuesOf<double>(a);
+      std::vector<double> out(size_);
+      for (size_t i = 0; i < size_; ++i) {
+        out[i] = -values[i];
+        validity[i] = valid[i];
+      }
+      return Owned(Column::Double(std::move(out), std::move(validity)));
+    }
+    return absl::nullopt;
+  }
+
+  absl::optional<Operand> Ternary(const Operand& condition,
+                                  const Operand& a, const Operand& b) {
+    if (condition.type() != Column::Type::kBool || a.type() != b.type()) {
+      return absl::nullopt;
+    }
+    Strided<uint8_t> conditions = ValuesOf<uint8_t>(condition);
+    Strided<uint8_t> condition_valid = ValidityOf(condition);
+    Strided<uint8_t> a_valid = ValidityOf(a);
+    Strided<uint8_t> b_valid = ValidityOf(b);
+    ColumnBuilder builder(a.type(), size_);
+    for (size_t i = 0; i < size_; ++i) {
+      const Operand& selected = conditions[i] ? a : b;
+      if (!condition_valid[i] || !(conditions[i] ? a_valid[i] : b_valid[i])) {
+        builder.AppendNull();
+        continue;
+      }
+      builder.AppendRow(*selected.column, i * selected.stride());
+    }
+    return Owned(std::move(builder).Build());
+  }
+
+  // `a in list`, where list is a column of constants.
+  absl::optional<Operand> In(const Operand& a, const Column& list) {
+    if (a.type() != list.type()) {
+      return absl::nullopt;
+    }
+    auto contains = [](auto values) {
+      return [values](auto x, auto, uint8_t* out) {
+        bool found = false;
+        for (auto value : values) {
+          found |= value == x;
+        }
+        *out = found;
+        return true;
+      };
+    };
+    // The second operand of Binary is unused.
+    const Operand& unused = a;
+    switch (a.type()) {
+      case Column::Type::kBool:
+        return Binary<uint8_t>(a, ValuesOf<uint8_t>(a), unused,
+                               ValuesOf<uint8_t>(a), contains(list.bools()));
+      case Column::Type::kInt:
+        return Binary<uint8_t>(a, ValuesOf<int64_t>(a), unused,
+                               ValuesOf<int64_t>(a), contains(list.ints()));
+      case Column::Type::kUint:
+        return Binary<uint8_t>(a, ValuesOf<uint64_t>(a), unused,
+                               ValuesOf<uint64_t>(a), contains(list.uints()));
+      case Column::Type::kDouble:
+        return Binary<uint8_t>(a, ValuesOf<double>(a), unused,
+                               ValuesOf<double>(a), contains(list.doubles()));
+      case Column::Type::kString: {
+        absl::flat_hash_set<absl::string_view> strings;
+        for (size_t i = 0; i < list.size(); ++i) {
+          strings.insert(list.string(i));
+        }
+        return Binary<uint8_t>(
+            a, StringsOf(a), unused, StringsOf(a),
+            [&strings](absl::string_view x, absl::string_view,
+                       uint8_t* out) {
+              *out = strings.contains(x);
+              return true;
+            });
+      }
+    }
+    return absl::nullopt;
+  }
+
+  const ColumnarProgram& program_;
+  const ColumnarActivation& activation_;
+  ValueFactory& value_factory_;
+  // The number of rows the operands have: those of the activation, or of
+  // selection_ if set.
+  size_t size_;
+  const std::vector<size_t>* selection_ = nullptr;
+  RowActivation row_activation_;
+};
+
+}  // namespace runtime_internal
+
+Column::Column(Type type, size_t size, std::vector<uint8_t> validity)
+    : type_(type), size_(size), validity_(std::move(validity)) {
+  if (type_ == Type::kString) {
+    string_offsets_.push_back(0);
+  }
+}
+
+Column Column::Bool(std::vector<uint8_t> values,
+                    std::vector<uint8_t> validity) {
+  Column column(Type::kBool, values.size(), std::move(validity));
+  column.bools_ = std::move(values);
+  return column;
+}
+
+Column Column::Int(std::vector<int64_t> values,
+                   std::vector<uint8_t> validity) {
+  Column column(Type::kInt, values.size(), std::move(validity));
+  column.ints_ = std::move(values);
+  return column;
+}
+
+Column Column::Uint(std::vector<uint64_t> values,
+                    std::vector<uint8_t> validity) {
+  Column column(Type::kUint, values.size(), std::move(validity));
+  column.uints_ = std::move(values);
+  return column;
+}
+
+Column Column::Double(std::vector<double> values,
+                      std::vector<uint8_t> validity) {
+  Column column(Type::kDouble, values.size(), std::move(validity));
+  column.doubles_ = std::move(values);
+  return column;
+}
+
+Column Column::String(absl::Span<const std::string> values,
+                      std::vector<uint8_t> validity) {
+  Column column(Type::kString, values.size(), std::move(validity));
+  column.string_offsets_.reserve(values.size() + 1);
+  for (const std::string& value : values) {
+    column.string_data_.append(value);
+    column.string_offsets_.push_back(column.string_data_.size());
+  }
+  return column;
+}
+
+absl::StatusOr<Handle<Value>> Column::GetValue(ValueFactory& value_factory,
+                                               size_t row) const {
+  if (!IsValid(row)) {
+    return value_factory.GetNullValue();
+  }
+  switch (type_) {
+    case Type::kBool:
+      return value_factory.CreateBoolValue(bools_[row] != 0);
+    case Type::kInt:
+      return value_factory.CreateIntValue(ints_[row]);
+    case Type::kUint:
+      return value_factory.CreateUintValue(uints_[row]);
+    case Type::kDouble:
+      return value_factory.CreateDoubleValue(doubles_[row]);
+    case Type::kString:
+      return value_factory.CreateStringValue(string(row));
+  }
+  return absl::InternalError("unexpected column type");
+}
+
+absl::Status ColumnarActivation::Bind(absl::string_view path,
+                                      Column column) {
+  if (column.size() != size_) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("column ", path, " has ", column.size(),
+                     " rows, expected ", size_));
+  }
+  for (const auto& [bound, unused] : columns_) {
+    if (absl::StartsWith(bound, absl::StrCat(path, ".")) ||
+        absl::StartsWith(path, absl::StrCat(bound, "."))) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "column ", path, " overlaps with the column ", bound));
+    }
+  }
+  columns_[path] = std::make_unique<const Column>(std::move(column));
+  return absl::OkStatus();
+}
+
+const Column* ColumnarActivation::Find(absl::string_view path) const {
+  auto it = columns_.find(path);
+  if (it == columns_.end()) {
+    return nullptr;
+  }
+  return it->second.get();
+}
+
+ColumnarProgram::ColumnarProgram() = default;
+
+ColumnarProgram::~ColumnarProgram() = default;
+
+absl::StatusOr<ColumnarResult> ColumnarProgram::Evaluate(
+    const ColumnarActivation& activation, ValueFactory& value_factory) const {
+  return runtime_internal::ColumnarEvaluator(*this, activation, value_factory)
+      .Evaluate();
+}
+
+absl::StatusOr<std::vector<size_t>> ColumnarProgram::Filter(
+    const ColumnarActivation& activation, ValueFactory& value_factory) const {
+  return runtime_internal::ColumnarEvaluator(*this, activation, value_factory)
+      .Filter();
+}
+
+absl::StatusOr<std::unique_ptr<ColumnarProgram>> CreateColumnarProgram(
+    const Runtime& runtime, std::unique_ptr<Ast> ast) {
+  return runtime_internal::ColumnarProgramBuilder::Create(runtime,
+                                                          std::move(ast));
+}
+
+}  // namespace cel
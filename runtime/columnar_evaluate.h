@@ -0,0 +1,223 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_COLUMNAR_EVALUATE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_COLUMNAR_EVALUATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace runtime_internal {
+class ColumnBuilder;
+class ColumnarProgramBuilder;
+class ColumnarEvaluator;
+}  // namespace runtime_internal
+
+// A column of values of one type, one per row, with a validity map: rows
+// that are not valid are null. Like Arrow arrays, except that bools and
+// validity take a byte per row instead of a bit, so that kernels over them
+// are plain loops.
+class Column final {
+ public:
+  enum class Type {
+    kBool,
+    kInt,
+    kUint,
+    kDouble,
+    kString,
+  };
+
+  // Creates a column of `values`. `validity` is either empty, if every row
+  // is valid, or has one entry per row which is zero for null rows.
+  static Column Bool(std::vector<uint8_t> values,
+                     std::vector<uint8_t> validity = {});
+  static Column Int(std::vector<int64_t> values,
+                    std::vector<uint8_t> validity = {});
+  static Column Uint(std::vector<uint64_t> values,
+                     std::vector<uint8_t> validity = {});
+  static Column Double(std::vector<double> values,
+                       std::vector<uint8_t> validity = {});
+  static Column String(absl::Span<const std::string> values,
+                       std::vector<uint8_t> validity = {});
+
+  Column(Column&&) = default;
+  Column& operator=(Column&&) = default;
+
+  Type type() const { return type_; }
+
+  size_t size() const { return size_; }
+
+  bool IsValid(size_t row) const {
+    return validity_.empty() || validity_[row] != 0;
+  }
+
+  // Empty if every row is valid.
+  absl::Span<const uint8_t> validity() const { return validity_; }
+
+  // The values of the rows, for columns of the respective type. The values
+  // of null rows are unspecified.
+  absl::Span<const uint8_t> bools() const { return bools_; }
+  absl::Span<const int64_t> ints() const { return ints_; }
+  absl::Span<const uint64_t> uints() const { return uints_; }
+  absl::Span<const double> doubles() const { return doubles_; }
+  absl::string_view string(size_t row) const {
+    return absl::string_view(string_data_).substr(
+        string_offsets_[row], string_offsets_[row + 1] - string_offsets_[row]);
+  }
+
+  // Returns the value of `row`, or null if it is not valid. Strings must be
+  // valid UTF-8.
+  absl::StatusOr<Handle<Value>> GetValue(ValueFactory& value_factory,
+                                         size_t row) const;
+
+ private:
+  friend class runtime_internal::ColumnBuilder;
+
+  Column(Type type, size_t size, std::vector<uint8_t> validity);
+
+  Type type_;
+  size_t size_;
+  std::vector<uint8_t> validity_;
+  std::vector<uint8_t> bools_;
+  std::vector<int64_t> ints_;
+  std::vector<uint64_t> uints_;
+  std::vector<double> doubles_;
+  // Strings are stored back to back, row i spanning
+  // [string_offsets_[i], string_offsets_[i + 1]).
+  std::string string_data_;
+  std::vector<size_t> string_offsets_;
+};
+
+// Binds variables, or field paths such as `request.size`, to columns of the
+// same number of rows.
+class ColumnarActivation final {
+ public:
+  explicit ColumnarActivation(size_t size) : size_(size) {}
+
+  ColumnarActivation(const ColumnarActivation&) = delete;
+  ColumnarActivation& operator=(const ColumnarActivation&) = delete;
+
+  // The number of rows.
+  size_t size() const { return size_; }
+
+  // Binds `path` to `column`, replacing any previous binding. Selecting the
+  // fields of a path bound to a column is not supported, nor is binding a
+  // path and a field of it.
+  absl::Status Bind(absl::string_view path, Column column);
+
+  // Returns the column bound to `path`, or nullptr if there is none.
+  const Column* Find(absl::string_view path) const;
+
+ private:
+  friend class runtime_internal::ColumnarEvaluator;
+
+  size_t size_;
+  absl::flat_hash_map<std::string, std::unique_ptr<const Column>> columns_;
+};
+
+struct ColumnarResult {
+  // The results which are values of the column's type, in the rows they are
+  // valid in. The type is the type of the expression if it was evaluated a
+  // column at a time, or else that of the first result of a column type.
+  Column column = Column::Bool({});
+  // The results of the other rows, e.g. errors, nulls, unknowns or values of
+  // other types, by row.
+  absl::flat_hash_map<size_t, Handle<Value>> other_results;
+  // Whether the expression was evaluated a column at a time, rather than
+  // falling back to evaluating every row with the program.
+  bool vectorized = false;
+  // The number of rows evaluated one at a time with the program.
+  size_t row_wise_rows = 0;
+};
+
+// An expression evaluated over a ColumnarActivation a column at a time, for
+// analytics over many rows.
+//
+// The vectorized subset consists of:
+//  - variables and field paths bound to columns,
+//  - bool, int, uint, double and string constants,
+//  - arithmetic and comparisons of operands of the same type,
+//  - `!`, `&&`, `||` and `_?_:_`,
+//  - `in` with a list of constants of the type of the operand,
+//  - `startsWith`, `endsWith` and `contains` on strings.
+// They run over whole columns with the semantics of the standard library.
+// Other subexpressions, such as comprehensions or other function calls, are
+// evaluated row by row with programs planned for them, and their results
+// used as columns.
+//
+// Rows whose result the kernels can't compute, because an operand is null
+// or not of the column's type, or the operation fails (e.g. overflows), are
+// evaluated again with the program of the whole expression. So is every
+// row if the column types don't fit the kernels, e.g. `x + y` with an int
+// `x` and a double `y`. The result is the same as evaluating the program
+// once per row, as long as the runtime keeps the standard definitions of
+// the functions above.
+//
+// Created with CreateColumnarProgram. Thread-safe like Program.
+class ColumnarProgram final {
+ public:
+  // Evaluates the expression for each row of `activation`.
+  absl::StatusOr<ColumnarResult> Evaluate(
+      const ColumnarActivation& activation,
+      ValueFactory& value_factory) const;
+
+  // Returns the rows of `activation` for which the expression is true, in
+  // ascending order, e.g. to filter a batch with a predicate.
+  //
+  // The clauses of a top level conjunction `a && b && ...` narrow a
+  // selection of rows in turn: each clause is computed only for the rows
+  // all previous clauses were true for, like `&&` short-circuits. Rows a
+  // clause can't be computed for are decided with the program of the whole
+  // expression. Errors and non-bool results are not selected.
+  absl::StatusOr<std::vector<size_t>> Filter(
+      const ColumnarActivation& activation,
+      ValueFactory& value_factory) const;
+
+  ~ColumnarProgram();
+
+ private:
+  friend class runtime_internal::ColumnarProgramBuilder;
+  friend class runtime_internal::ColumnarEvaluator;
+
+  struct Node;
+
+  ColumnarProgram();
+
+  std::unique_ptr<Program> program_;
+  std::unique_ptr<Node> root_;
+};
+
+// Plans ast in runtime for columnar evaluation.
+absl::StatusOr<std::unique_ptr<ColumnarProgram>> CreateColumnarProgram(
+    const Runtime& runtime, std::unique_ptr<Ast> ast);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_COLUMNAR_EVALUATE_H_
@@ -0,0 +1,295 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/columnar_evaluate.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/error_value.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using testing::IsEmpty;
+using cel::internal::StatusIs;
+
+// seen(int) -> true, recording its argument.
+class SeenFunction : public Function {
+ public:
+  explicit SeenFunction(std::vector<int64_t>* seen) : seen_(seen) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    seen_->push_back(args[0].As<IntValue>()->NativeValue());
+    return context.value_factory().CreateBoolValue(true);
+  }
+
+ private:
+  std::vector<int64_t>* seen_;
+};
+
+class ColumnarEvaluateTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK(builder.function_registry().Register(
+        FunctionDescriptor("seen", false, {Kind::kInt}),
+        std::make_unique<SeenFunction>(&seen_)));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<std::unique_ptr<ColumnarProgram>> CreateProgram(
+      absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<Ast> ast,
+                         CreateAstFromParsedExpr(std::move(parsed_expr)));
+    return CreateColumnarProgram(*runtime_, std::move(ast));
+  }
+
+  absl::StatusOr<ColumnarResult> Evaluate(
+      absl::string_view expr, const ColumnarActivation& activation) {
+    CEL_ASSIGN_OR_RETURN(auto program, CreateProgram(expr));
+    return program->Evaluate(activation, value_factory_.get());
+  }
+
+ protected:
+  std::vector<int64_t> seen_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+  std::unique_ptr<const Runtime> runtime_;
+};
+
+TEST_F(ColumnarEvaluateTest, Arithmetic) {
+  ColumnarActivation activation(3);
+  ASSERT_OK(activation.Bind("x", Column::Int({1, 2, 3})));
+  ASSERT_OK(activation.Bind("y", Column::Int({10, 20, 30})));
+
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result,
+                       Evaluate("x * 2 + y - 1", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_EQ(result.row_wise_rows, 0);
+  ASSERT_EQ(result.column.type(), Column::Type::kInt);
+  EXPECT_THAT(result.column.ints(), ElementsAre(11, 23, 35));
+  EXPECT_THAT(result.other_results, IsEmpty());
+}
+
+TEST_F(ColumnarEvaluateTest, ComparisonsAndLogic) {
+  ColumnarActivation activation(4);
+  ASSERT_OK(activation.Bind("price", Column::Double({1.5, 20.0, 7.25, 99.0})));
+  ASSERT_OK(activation.Bind(
+      "region", Column::String({"eu-west", "us-east", "eu-north", "ap"})));
+
+  ASSERT_OK_AND_ASSIGN(
+      ColumnarResult result,
+      Evaluate("price < 10.0 && region.startsWith('eu') || price > 50.0",
+               activation));
+
+  EXPECT_TRUE(result.vectorized);
+  ASSERT_EQ(result.column.type(), Column::Type::kBool);
+  EXPECT_THAT(result.column.bools(), ElementsAre(1, 0, 1, 1));
+}
+
+TEST_F(ColumnarEvaluateTest, InList) {
+  ColumnarActivation activation(3);
+  ASSERT_OK(activation.Bind("method", Column::String({"GET", "PUT", "HEAD"})));
+
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result,
+                       Evaluate("method in ['GET', 'HEAD']", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_THAT(result.column.bools(), ElementsAre(1, 0, 1));
+}
+
+TEST_F(ColumnarEvaluateTest, Ternary) {
+  ColumnarActivation activation(2);
+  ASSERT_OK(activation.Bind("x", Column::Int({-4, 5})));
+
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result,
+                       Evaluate("x < 0 ? -x : x", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_THAT(result.column.ints(), ElementsAre(4, 5));
+}
+
+TEST_F(ColumnarEvaluateTest, FieldPaths) {
+  ColumnarActivation activation(2);
+  ASSERT_OK(activation.Bind("request.size", Column::Int({100, 2000})));
+  ASSERT_OK(activation.Bind("request.path", Column::String({"/a", "/b"})));
+
+  ASSERT_OK_AND_ASSIGN(
+      ColumnarResult result,
+      Evaluate("request.size > 1000 || request.path == '/a'", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_THAT(result.column.bools(), ElementsAre(1, 1));
+}
+
+TEST_F(ColumnarEvaluateTest, OverflowFallsBackForTheRow) {
+  ColumnarActivation activation(2);
+  ASSERT_OK(activation.Bind(
+      "x", Column::Int({1, std::numeric_limits<int64_t>::max()})));
+
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result, Evaluate("x + 1", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_EQ(result.row_wise_rows, 1);
+  EXPECT_TRUE(result.column.IsValid(0));
+  EXPECT_FALSE(result.column.IsValid(1));
+  EXPECT_EQ(result.column.ints()[0], 2);
+  ASSERT_TRUE(result.other_results.contains(1));
+  ASSERT_TRUE(result.other_results[1]->Is<ErrorValue>());
+  EXPECT_THAT(result.other_results[1]->As<ErrorValue>().NativeValue(),
+              StatusIs(absl::StatusCode::kOutOfRange,
+                       HasSubstr("overflow")));
+}
+
+TEST_F(ColumnarEvaluateTest, NullOperandsFallBackForTheRow) {
+  ColumnarActivation activation(3);
+  ASSERT_OK(activation.Bind("flag", Column::Bool({1, 0, 0}, {1, 1, 0})));
+  ASSERT_OK(activation.Bind("x", Column::Int({1, 2, 3})));
+
+  // A null flag is only an error if the other operand doesn't decide the
+  // result.
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result,
+                       Evaluate("flag || x > 2", activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_EQ(result.row_wise_rows, 0);
+  EXPECT_THAT(result.column.bools(), ElementsAre(1, 0, 1));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate("!flag", activation));
+
+  EXPECT_EQ(result.row_wise_rows, 1);
+  EXPECT_THAT(result.column.validity(), ElementsAre(1, 1, 0));
+  ASSERT_TRUE(result.other_results.contains(2));
+  EXPECT_TRUE(result.other_results[2]->Is<ErrorValue>());
+}
+
+TEST_F(ColumnarEvaluateTest, UnsupportedSubexpressionsEvaluatedRowWise) {
+  ColumnarActivation activation(3);
+  ASSERT_OK(activation.Bind("name", Column::String({"a", "bcd", "ef"})));
+  ASSERT_OK(activation.Bind("limit", Column::Int({1, 2, 3})));
+
+  ASSERT_OK_AND_ASSIGN(
+      ColumnarResult result,
+      Evaluate("size(name) <= limit && [1, 2].exists(i, i == limit)",
+               activation));
+
+  EXPECT_TRUE(result.vectorized);
+  EXPECT_EQ(result.row_wise_rows, 0);
+  EXPECT_THAT(result.column.bools(), ElementsAre(1, 0, 0));
+}
+
+TEST_F(ColumnarEvaluateTest, MismatchedTypesFallBackForEveryRow) {
+  ColumnarActivation activation(2);
+  ASSERT_OK(activation.Bind("x", Column::Int({1, 2})));
+  ASSERT_OK(activation.Bind("y", Column::Double({0.5, 1.5})));
+
+  ASSERT_OK_AND_ASSIGN(ColumnarResult result, Evaluate("x + y", activation));
+
+  EXPECT_FALSE(result.vectorized);
+  EXPECT_EQ(result.row_wise_rows, 2);
+  EXPECT_EQ(result.other_results.size(), 2);
+  EXPECT_TRUE(result.other_results[0]->Is<ErrorValue>());
+}
+
+TEST_F(ColumnarEvaluateTest, FilterNarrowsSelection) {
+  ColumnarActivation activation(5);
+  ASSERT_OK(activation.Bind("x", Column::Int({1, 20, 3, 40, 50})));
+  ASSERT_OK(activation.Bind(
+      "name", Column::String({"a", "bb", "ccc", "dddd", "eeeee"})));
+
+  ASSERT_OK_AND_ASSIGN(
+      auto program,
+      CreateProgram("x > 10 && size(name) > 2 && name.endsWith('d')"));
+  ASSERT_OK_AND_ASSIGN(std::vector<size_t> rows,
+                       program->Filter(activation, value_factory_.get()));
+
+  EXPECT_THAT(rows, ElementsAre(3));
+}
+
+TEST_F(ColumnarEvaluateTest, FilterEvaluatesClausesForSelectedRowsOnly) {
+  ColumnarActivation activation(5);
+  ASSERT_OK(activation.Bind("x", Column::Int({1, 20, 3, 40, 50})));
+
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram("x > 10 && seen(x)"));
+  ASSERT_OK_AND_ASSIGN(std::vector<size_t> rows,
+                       program->Filter(activation, value_factory_.get()));
+
+  EXPECT_THAT(rows, ElementsAre(1, 3, 4));
+  EXPECT_THAT(seen_, ElementsAre(20, 40, 50));
+}
+
+TEST_F(ColumnarEvaluateTest, FilterDecidesUncomputedRowsWithProgram) {
+  ColumnarActivation activation(4);
+  ASSERT_OK(activation.Bind("flag", Column::Bool({1, 1, 0, 1}, {1, 0, 1, 1})));
+  ASSERT_OK(activation.Bind(
+      "x", Column::Int({1, 2, 3, std::numeric_limits<int64_t>::max()})));
+
+  ASSERT_OK_AND_ASSIGN(auto program,
+                       CreateProgram("x + 1 > 1 && (flag || x == 3)"));
+  ASSERT_OK_AND_ASSIGN(std::vector<size_t> rows,
+                       program->Filter(activation, value_factory_.get()));
+
+  // Row 1 has a null flag, an error, and row 3 overflows.
+  EXPECT_THAT(rows, ElementsAre(0, 2));
+}
+
+TEST_F(ColumnarEvaluateTest, BindValidatesColumns) {
+  ColumnarActivation activation(2);
+  EXPECT_THAT(activation.Bind("x", Column::Int({1})),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  ASSERT_OK(activation.Bind("request.size", Column::Int({1, 2})));
+  EXPECT_THAT(activation.Bind("request", Column::Int({1, 2})),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(activation.Find("x"), nullptr);
+  EXPECT_NE(activation.Find("request.size"), nullptr);
+}
+
+}  // namespace
+}  // namespace cel
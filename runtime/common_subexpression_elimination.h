@@ -0,0 +1,34 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_COMMON_SUBEXPRESSION_ELIMINATION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_COMMON_SUBEXPRESSION_ELIMINATION_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable common subexpression elimination in the runtime being built.
+//
+// Repeated side-effect-free subexpressions are extracted into cel.bind
+// definitions so they are evaluated at most once per evaluation. Calls to
+// extension functions are only extracted if all of their overloads are
+// registered as pure. Has no effect when lazy bind initialization is
+// disabled.
+absl::Status EnableCommonSubexpressionElimination(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_COMMON_SUBEXPRESSION_ELIMINATION_H_
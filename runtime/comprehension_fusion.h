@@ -0,0 +1,33 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_COMPREHENSION_FUSION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_COMPREHENSION_FUSION_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable comprehension fusion in the runtime being built.
+//
+// Comprehensions generated by the standard macros over the result of a map or
+// filter, and size() of such a result, are evaluated in a single pass over the
+// original range, without building the intermediate list. Errors of elements
+// that are never consumed, e.g. after exists found a match, are not reported.
+absl::Status EnableComprehensionFusion(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_COMPREHENSION_FUSION_H_
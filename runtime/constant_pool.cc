@@ -0,0 +1,90 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/constant_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace cel {
+
+namespace {
+
+// Literals are short; a chunk holds many of them.
+constexpr size_t kChunkSize = 4096;
+
+}  // namespace
+
+ConstantPool::~ConstantPool() {
+  for (const Chunk& chunk : chunks_) {
+    if (allocator_ != nullptr) {
+      allocator_->Deallocate(chunk.data, chunk.size);
+    } else {
+      delete[] chunk.data;
+    }
+  }
+}
+
+absl::string_view ConstantPool::InternString(absl::string_view value) {
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (auto it = strings_.find(value); it != strings_.end()) {
+      return *it;
+    }
+  }
+  absl::MutexLock lock(&mutex_);
+  if (auto it = strings_.find(value); it != strings_.end()) {
+    return *it;
+  }
+  absl::string_view copy = Copy(value);
+  strings_.insert(copy);
+  return copy;
+}
+
+size_t ConstantPool::size() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return strings_.size();
+}
+
+size_t ConstantPool::SpaceAllocated() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return space_allocated_;
+}
+
+absl::string_view ConstantPool::Copy(absl::string_view value) {
+  // Empty strings take a byte too, so that distinct strings have distinct
+  // addresses.
+  size_t space = std::max<size_t>(value.size(), 1);
+  if (chunks_.empty() || chunks_.back().size - offset_ < space) {
+    size_t size = std::max(kChunkSize, space);
+    char* data = allocator_ != nullptr
+                     ? static_cast<char*>(allocator_->Allocate(size))
+                     : new char[size];
+    chunks_.push_back(Chunk{data, size});
+    space_allocated_ += size;
+    offset_ = 0;
+  }
+  char* data = chunks_.back().data + offset_;
+  if (!value.empty()) {
+    std::memcpy(data, value.data(), value.size());
+  }
+  offset_ += space;
+  return absl::string_view(data, value.size());
+}
+
+}  // namespace cel
@@ -0,0 +1,89 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_CONSTANT_POOL_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_CONSTANT_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "runtime/plan_allocator.h"
+
+namespace cel {
+
+// Thread-safe pool of interned string and bytes constants, shared by the
+// programs planned with it (see RuntimeOptions::constant_pool).
+//
+// Programs referencing the same literal share a single copy of it, and
+// constant values refer to the pooled copy without owning it. Planned
+// programs keep the pool alive. A pool may be scoped to one runtime or shared
+// by every runtime in the process. Interned strings are never released, so a
+// pool should only be shared by programs with a bounded set of literals.
+//
+// The contents of the strings are packed into chunks allocated from the heap
+// or, if given, from a PlanAllocator.
+class ConstantPool {
+ public:
+  ConstantPool() = default;
+
+  explicit ConstantPool(std::shared_ptr<PlanAllocator> allocator)
+      : allocator_(std::move(allocator)) {}
+
+  ~ConstantPool();
+
+  ConstantPool(const ConstantPool&) = delete;
+  ConstantPool& operator=(const ConstantPool&) = delete;
+
+  // Returns the pooled copy of value, adding it if not yet present. The
+  // returned view is valid for the lifetime of the pool. Equal values always
+  // return the same view, so views may be compared by address.
+  absl::string_view InternString(absl::string_view value);
+
+  // Number of distinct strings in the pool.
+  size_t size() const;
+
+  // Bytes of the chunks holding the contents of the strings, including
+  // unused chunk tails.
+  size_t SpaceAllocated() const;
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+
+  // Returns a copy of value in chunk storage.
+  absl::string_view Copy(absl::string_view value)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Kept alive until the chunks are returned to it.
+  const std::shared_ptr<PlanAllocator> allocator_;
+  mutable absl::Mutex mutex_;
+  // Views of chunk storage, which never moves.
+  absl::flat_hash_set<absl::string_view> strings_ ABSL_GUARDED_BY(mutex_);
+  std::vector<Chunk> chunks_ ABSL_GUARDED_BY(mutex_);
+  // Offset of the next free byte in the last chunk.
+  size_t offset_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t space_allocated_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_CONSTANT_POOL_H_
@@ -0,0 +1,75 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/constant_pool.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "internal/testing.h"
+#include "runtime/plan_allocator.h"
+
+namespace cel {
+namespace {
+
+TEST(ConstantPool, InternsEqualStrings) {
+  ConstantPool pool;
+  std::string first = "resource.type";
+  std::string second = "resource.type";
+  absl::string_view interned = pool.InternString(first);
+  EXPECT_EQ(interned, "resource.type");
+  EXPECT_NE(interned.data(), first.data());
+  EXPECT_EQ(pool.InternString(second).data(), interned.data());
+  EXPECT_EQ(pool.size(), 1);
+}
+
+TEST(ConstantPool, DistinctStrings) {
+  ConstantPool pool;
+  absl::string_view admin = pool.InternString("admin");
+  absl::string_view viewer = pool.InternString("viewer");
+  EXPECT_NE(admin.data(), viewer.data());
+  EXPECT_EQ(pool.InternString("").size(), 0);
+  EXPECT_EQ(pool.size(), 3);
+  // Views stay valid as the pool grows.
+  for (int i = 0; i < 1000; ++i) {
+    pool.InternString(std::to_string(i));
+  }
+  EXPECT_EQ(admin, "admin");
+  EXPECT_EQ(pool.InternString("admin").data(), admin.data());
+}
+
+TEST(ConstantPool, EmptyStringHasDistinctAddress) {
+  ConstantPool pool;
+  absl::string_view empty = pool.InternString("");
+  absl::string_view admin = pool.InternString("admin");
+  EXPECT_NE(empty.data(), admin.data());
+  EXPECT_EQ(pool.InternString("").data(), empty.data());
+}
+
+TEST(ConstantPool, StoresStringsInPlanAllocator) {
+  auto allocator = std::make_shared<HugePageAllocator>();
+  {
+    ConstantPool pool(allocator);
+    absl::string_view admin = pool.InternString("admin");
+    std::string large(10000, 'x');
+    EXPECT_EQ(pool.InternString(large), large);
+    EXPECT_EQ(pool.InternString("admin").data(), admin.data());
+    EXPECT_EQ(allocator->GetStats().allocated_bytes, pool.SpaceAllocated());
+  }
+  EXPECT_EQ(allocator->GetStats().allocated_bytes, 0);
+}
+
+}  // namespace
+}  // namespace cel
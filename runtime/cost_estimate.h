@@ -0,0 +1,63 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_COST_ESTIMATE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_COST_ESTIMATE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace cel {
+
+// Inputs to the static cost estimate of a program.
+struct CostEstimateOptions {
+  // Assumed size (elements, entries, characters or bytes) of values whose
+  // size isn't known before evaluation, such as variables and function
+  // results.
+  uint64_t default_size = 100;
+
+  // Sizes of specific attributes, by their path, e.g. "request.headers".
+  absl::flat_hash_map<std::string, uint64_t> size_hints;
+};
+
+// Static estimate of the cost of evaluating a program, for rejecting or
+// throttling expensive expressions before they are used.
+//
+// The estimates assume that every branch is taken and every comprehension
+// runs over all of its range, with the sizes given by CostEstimateOptions.
+// They are not bounds: values larger than the assumed sizes, and extension
+// functions whose cost beyond their call is not known, make evaluations cost
+// more. Estimates saturate at the maximum uint64_t.
+struct CostEstimate {
+  // Number of steps in the planned program.
+  size_t plan_size = 0;
+
+  // Estimated steps executed by one evaluation. Regular expression matches
+  // count their compiled program size per character matched.
+  uint64_t steps = 0;
+
+  // Estimated values allocated by one evaluation: lists, maps, messages,
+  // strings and other results created by calls.
+  uint64_t allocations = 0;
+
+  // Deepest nesting of comprehensions (e.g. `x.all(y, y.exists(...))` is 2).
+  int max_comprehension_depth = 0;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_COST_ESTIMATE_H_
@@ -0,0 +1,124 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/cost_estimate.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using testing::Gt;
+
+class CostEstimateTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<CostEstimate> Estimate(
+      absl::string_view expr, CostEstimateOptions estimate_options = {}) {
+    CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(auto ast,
+                         CreateAstFromParsedExpr(std::move(parsed_expr)));
+    CostEstimate estimate;
+    Runtime::CreateProgramOptions options;
+    options.cost_estimate = &estimate;
+    options.cost_estimate_options = std::move(estimate_options);
+    CEL_RETURN_IF_ERROR(
+        runtime_->CreateProgram(std::move(ast), options).status());
+    return estimate;
+  }
+
+ protected:
+  std::unique_ptr<const Runtime> runtime_;
+};
+
+TEST_F(CostEstimateTest, Simple) {
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate, Estimate("a && b || c"));
+  EXPECT_THAT(estimate.plan_size, Gt(0));
+  EXPECT_EQ(estimate.steps, 5);
+  EXPECT_EQ(estimate.allocations, 0);
+  EXPECT_EQ(estimate.max_comprehension_depth, 0);
+}
+
+TEST_F(CostEstimateTest, ComprehensionsScaleWithSizeHints) {
+  CostEstimateOptions small;
+  small.size_hints["request.items"] = 10;
+  ASSERT_OK_AND_ASSIGN(CostEstimate small_estimate,
+                       Estimate("request.items.exists(x, x > 0)", small));
+
+  CostEstimateOptions large;
+  large.size_hints["request.items"] = 1000;
+  ASSERT_OK_AND_ASSIGN(CostEstimate large_estimate,
+                       Estimate("request.items.exists(x, x > 0)", large));
+
+  EXPECT_EQ(small_estimate.plan_size, large_estimate.plan_size);
+  EXPECT_EQ(small_estimate.max_comprehension_depth, 1);
+  EXPECT_THAT(large_estimate.steps, Gt(50 * small_estimate.steps));
+}
+
+TEST_F(CostEstimateTest, NestedComprehensions) {
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate,
+                       Estimate("[1, 2, 3].all(x, [4, 5].exists(y, x < y))"));
+  EXPECT_EQ(estimate.max_comprehension_depth, 2);
+
+  ASSERT_OK_AND_ASSIGN(CostEstimate single,
+                       Estimate("[1, 2, 3].all(x, x < 4)"));
+  EXPECT_THAT(estimate.steps, Gt(2 * single.steps));
+}
+
+TEST_F(CostEstimateTest, AllocationsInLoops) {
+  CostEstimateOptions options;
+  options.size_hints["xs"] = 1000;
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate,
+                       Estimate("xs.map(x, string(x))", options));
+  EXPECT_THAT(estimate.allocations, Gt(1000));
+}
+
+TEST_F(CostEstimateTest, RegexProgramSize) {
+  ASSERT_OK_AND_ASSIGN(CostEstimate simple, Estimate("s.matches('a')"));
+  ASSERT_OK_AND_ASSIGN(CostEstimate complex,
+                       Estimate("s.matches('(a|b|c)+[d-z]*(foo|bar)?')"));
+  EXPECT_THAT(complex.steps, Gt(simple.steps));
+}
+
+TEST_F(CostEstimateTest, Saturates) {
+  CostEstimateOptions options;
+  options.default_size = std::numeric_limits<uint64_t>::max() / 2;
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate,
+                       Estimate("xs.all(x, ys.all(y, x != y))", options));
+  EXPECT_EQ(estimate.steps, std::numeric_limits<uint64_t>::max());
+}
+
+}  // namespace
+}  // namespace cel
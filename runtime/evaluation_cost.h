@@ -0,0 +1,59 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_COST_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_COST_H_
+
+#include <cstdint>
+
+#include "absl/functional/any_invocable.h"
+
+namespace cel {
+
+// Actual cost of evaluations, gathered by TraceableProgram::EvaluateWithCost,
+// e.g. for billing or throttling the tenants of a shared runtime.
+//
+// Costs are added to those already recorded, so one EvaluationCost may
+// accumulate several evaluations. Evaluations that fail (e.g. because they
+// exceed RuntimeOptions::max_evaluation_cost) are recorded up to the failure.
+struct EvaluationCost {
+  // Returns a monotonic count of bytes allocated through the value factory,
+  // e.g. from a counting allocator or arena. It is sampled before and after
+  // each evaluation.
+  using AllocationCounter = absl::AnyInvocable<int64_t() const>;
+
+  // Execution steps.
+  int64_t steps = 0;
+
+  // Comprehension iterations.
+  int64_t iterations = 0;
+
+  // Function calls, each weighted by the cost of the overload called (see
+  // FunctionDescriptor::cost). Operators planned as dedicated steps (e.g.
+  // `&&` or `==`) only count as steps.
+  int64_t function_cost = 0;
+
+  // Bytes allocated as measured by allocation_counter. Zero if no counter is
+  // set.
+  int64_t allocated_bytes = 0;
+
+  AllocationCounter allocation_counter;
+
+  // The cost compared against RuntimeOptions::max_evaluation_cost.
+  int64_t total() const { return steps + iterations + function_cost; }
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_COST_H_
@@ -0,0 +1,80 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/evaluation_profile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace cel {
+
+void EvaluationProfile::Merge(const EvaluationProfile& other) {
+  for (const auto& [expr_id, other_stats] : other.stats_) {
+    ExprStats& stats = stats_[expr_id];
+    stats.count += other_stats.count;
+    stats.wall_time += other_stats.wall_time;
+    stats.allocations += other_stats.allocations;
+  }
+}
+
+std::string EvaluationProfile::Serialize() const {
+  std::vector<std::pair<int64_t, ExprStats>> sorted(stats_.begin(),
+                                                    stats_.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& lhs, const auto& rhs) {
+              return lhs.first < rhs.first;
+            });
+  std::string serialized;
+  for (const auto& [expr_id, stats] : sorted) {
+    absl::StrAppend(&serialized, expr_id, " ", stats.count, " ",
+                    absl::ToInt64Nanoseconds(stats.wall_time), " ",
+                    stats.allocations, "\n");
+  }
+  return serialized;
+}
+
+absl::StatusOr<EvaluationProfile> EvaluationProfile::Parse(
+    absl::string_view serialized) {
+  EvaluationProfile profile;
+  for (absl::string_view line :
+       absl::StrSplit(serialized, '\n', absl::SkipEmpty())) {
+    std::vector<absl::string_view> fields = absl::StrSplit(line, ' ');
+    int64_t expr_id;
+    int64_t wall_time_ns;
+    ExprStats stats;
+    if (fields.size() != 4 || !absl::SimpleAtoi(fields[0], &expr_id) ||
+        !absl::SimpleAtoi(fields[1], &stats.count) ||
+        !absl::SimpleAtoi(fields[2], &wall_time_ns) ||
+        !absl::SimpleAtoi(fields[3], &stats.allocations)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Malformed evaluation profile line: '", line, "'"));
+    }
+    stats.wall_time = absl::Nanoseconds(wall_time_ns);
+    profile.stats_[expr_id] = stats;
+  }
+  return profile;
+}
+
+}  // namespace cel
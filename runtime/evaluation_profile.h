@@ -0,0 +1,113 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_PROFILE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_PROFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace cel {
+
+// Per expression statistics gathered by TraceableProgram::Profile.
+//
+// Statistics are keyed by the AST expression id of the program steps, which
+// can be mapped back to source positions through the SourceInfo of the
+// checked or parsed expression. Steps the planner adds without a
+// corresponding AST node (e.g. jumps) are attributed to the expression they
+// were planned for, or to id -1.
+//
+// Wall time and allocations are exclusive: they cover the steps planned for
+// the node itself, not its subexpressions.
+//
+// Not thread-safe. Use one profile per thread and Merge them for
+// aggregation.
+class EvaluationProfile {
+ public:
+  struct ExprStats {
+    // Number of steps executed.
+    int64_t count = 0;
+    // Cumulative wall time spent executing the steps.
+    absl::Duration wall_time = absl::ZeroDuration();
+    // Cumulative allocations made by the steps, as measured by the
+    // allocation counter. Zero if no counter is set.
+    int64_t allocations = 0;
+  };
+
+  // Returns a monotonic count of allocations, e.g. from a counting allocator
+  // or arena. It is sampled before and after each step.
+  using AllocationCounter = absl::AnyInvocable<int64_t() const>;
+
+  EvaluationProfile() = default;
+
+  EvaluationProfile(EvaluationProfile&&) = default;
+  EvaluationProfile& operator=(EvaluationProfile&&) = default;
+
+  // Sets the counter used to attribute allocations to expressions. If unset,
+  // allocations are not collected.
+  void set_allocation_counter(AllocationCounter allocation_counter) {
+    allocation_counter_ = std::move(allocation_counter);
+  }
+
+  bool has_allocation_counter() const {
+    return static_cast<bool>(allocation_counter_);
+  }
+
+  int64_t CountAllocations() const {
+    return allocation_counter_ ? allocation_counter_() : 0;
+  }
+
+  // Records one executed step for expr_id.
+  void Record(int64_t expr_id, absl::Duration wall_time, int64_t allocations) {
+    ExprStats& stats = stats_[expr_id];
+    stats.count += 1;
+    stats.wall_time += wall_time;
+    stats.allocations += allocations;
+  }
+
+  // Adds the statistics of other to this profile.
+  void Merge(const EvaluationProfile& other);
+
+  // Drops all statistics. The allocation counter is kept.
+  void Clear() { stats_.clear(); }
+
+  // Returns the statistics as text, one line of `<expr id> <count> <wall time
+  // in nanoseconds> <allocations>` per expression ordered by id, e.g. to
+  // store a profile collected in production and plan with it later (see
+  // Runtime::CreateProgramOptions::profile). The allocation counter is not
+  // serialized.
+  std::string Serialize() const;
+
+  // Parses the output of Serialize.
+  static absl::StatusOr<EvaluationProfile> Parse(absl::string_view serialized);
+
+  const absl::flat_hash_map<int64_t, ExprStats>& stats() const {
+    return stats_;
+  }
+
+ private:
+  absl::flat_hash_map<int64_t, ExprStats> stats_;
+  AllocationCounter allocation_counter_;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_EVALUATION_PROFILE_H_
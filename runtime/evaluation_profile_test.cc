@@ -0,0 +1,93 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/evaluation_profile.h"
+
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+using ::cel::internal::StatusIs;
+using testing::SizeIs;
+
+TEST(EvaluationProfile, RecordAccumulatesByExprId) {
+  EvaluationProfile profile;
+  profile.Record(1, absl::Microseconds(2), 0);
+  profile.Record(1, absl::Microseconds(3), 1);
+  profile.Record(2, absl::Microseconds(1), 4);
+
+  ASSERT_THAT(profile.stats(), SizeIs(2));
+  EXPECT_EQ(profile.stats().at(1).count, 2);
+  EXPECT_EQ(profile.stats().at(1).wall_time, absl::Microseconds(5));
+  EXPECT_EQ(profile.stats().at(1).allocations, 1);
+  EXPECT_EQ(profile.stats().at(2).count, 1);
+  EXPECT_EQ(profile.stats().at(2).allocations, 4);
+
+  profile.Clear();
+  EXPECT_THAT(profile.stats(), SizeIs(0));
+}
+
+TEST(EvaluationProfile, Merge) {
+  EvaluationProfile total;
+  total.Record(1, absl::Microseconds(2), 1);
+
+  EvaluationProfile other;
+  other.Record(1, absl::Microseconds(3), 2);
+  other.Record(3, absl::Microseconds(4), 0);
+
+  total.Merge(other);
+  ASSERT_THAT(total.stats(), SizeIs(2));
+  EXPECT_EQ(total.stats().at(1).count, 2);
+  EXPECT_EQ(total.stats().at(1).wall_time, absl::Microseconds(5));
+  EXPECT_EQ(total.stats().at(1).allocations, 3);
+  EXPECT_EQ(total.stats().at(3).count, 1);
+  EXPECT_EQ(total.stats().at(3).wall_time, absl::Microseconds(4));
+}
+
+TEST(EvaluationProfile, SerializeRoundTrips) {
+  EvaluationProfile profile;
+  profile.Record(3, absl::Nanoseconds(20), 1);
+  profile.Record(3, absl::Nanoseconds(5), 0);
+  profile.Record(-1, absl::Microseconds(1), 0);
+  EXPECT_EQ(profile.Serialize(), "-1 1 1000 0\n3 2 25 1\n");
+
+  ASSERT_OK_AND_ASSIGN(EvaluationProfile parsed,
+                       EvaluationProfile::Parse(profile.Serialize()));
+  ASSERT_THAT(parsed.stats(), SizeIs(2));
+  EXPECT_EQ(parsed.stats().at(3).count, 2);
+  EXPECT_EQ(parsed.stats().at(3).wall_time, absl::Nanoseconds(25));
+  EXPECT_EQ(parsed.stats().at(3).allocations, 1);
+  EXPECT_EQ(parsed.stats().at(-1).wall_time, absl::Microseconds(1));
+
+  EXPECT_THAT(EvaluationProfile::Parse("1 2 3"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(EvaluationProfile, AllocationCounter) {
+  EvaluationProfile profile;
+  EXPECT_FALSE(profile.has_allocation_counter());
+  EXPECT_EQ(profile.CountAllocations(), 0);
+
+  profile.set_allocation_counter([]() -> int64_t { return 7; });
+  EXPECT_TRUE(profile.has_allocation_counter());
+  EXPECT_EQ(profile.CountAllocations(), 7);
+}
+
+}  // namespace
+}  // namespace cel
@@ -14,6 +14,8 @@
 
 #include "runtime/function_registry.h"
 
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -21,15 +23,20 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/node_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "base/function.h"
 #include "base/function_descriptor.h"
 #include "base/kind.h"
+#include "internal/status_macros.h"
 #include "runtime/activation_interface.h"
+#include "runtime/async_function.h"
+#include "runtime/batch_function.h"
 #include "runtime/function_overload_reference.h"
 #include "runtime/function_provider.h"
 
@@ -66,6 +73,34 @@ class ActivationFunctionProviderImpl
   }
 };
 
+// Provider for batch functions. EvaluateBatchWithBatchFunctions binds the
+// batching implementation in the activation; all other evaluations get the
+// fallback overload.
+class BatchFunctionProviderImpl
+    : public cel::runtime_internal::FunctionProvider {
+ public:
+  BatchFunctionProviderImpl(const cel::FunctionDescriptor& descriptor,
+                            const cel::Function& fallback)
+      : descriptor_(descriptor), fallback_(fallback) {}
+
+  absl::StatusOr<absl::optional<cel::FunctionOverloadReference>> GetFunction(
+      const cel::FunctionDescriptor& descriptor,
+      const cel::ActivationInterface& activation) const override {
+    CEL_ASSIGN_OR_RETURN(
+        absl::optional<cel::FunctionOverloadReference> overload,
+        activation_provider_.GetFunction(descriptor, activation));
+    if (!overload.has_value()) {
+      overload.emplace(cel::FunctionOverloadReference{descriptor_, fallback_});
+    }
+    return overload;
+  }
+
+ private:
+  const cel::FunctionDescriptor& descriptor_;
+  const cel::Function& fallback_;
+  ActivationFunctionProviderImpl activation_provider_;
+};
+
 // Create a CelFunctionProvider that just looks up the functions inserted in the
 // Activation. This is a convenience implementation for a simple, common
 // use-case.
@@ -74,6 +109,33 @@ CreateActivationFunctionProvider() {
   return std::make_unique<ActivationFunctionProviderImpl>();
 }
 
+// Same as cel::FunctionDescriptor::ShapeMatches for an overload that is not
+// materialized yet.
+bool DeferredShapeMatches(const FunctionRegistry::DeferredOverload& overload,
+                          bool receiver_style,
+                          absl::Span<const cel::Kind> types) {
+  if (overload.receiver_style != receiver_style ||
+      overload.types.size() != types.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (overload.types[i] != cel::Kind::kAny && types[i] != cel::Kind::kAny &&
+        overload.types[i] != types[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AllKindsAny(absl::Span<const cel::Kind> types) {
+  for (cel::Kind kind : types) {
+    if (kind != cel::Kind::kAny) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 absl::Status FunctionRegistry::Register(
@@ -89,14 +151,177 @@ absl::Status FunctionRegistry::Register(
                         "Only one overload is allowed for non-strict function");
   }
 
-  auto& overloads = functions_[descriptor.name()];
-  overloads.static_overloads.push_back(
+  AddStaticOverload(functions_[descriptor.name()], descriptor,
+                    std::move(implementation));
+  return absl::OkStatus();
+}
+
+void FunctionRegistry::AddStaticOverload(
+    RegistryEntry& entry, const cel::FunctionDescriptor& descriptor,
+    std::unique_ptr<cel::Function> implementation) const {
+  entry.static_overloads.push_back(
       StaticFunctionEntry(descriptor, std::move(implementation)));
+  const StaticFunctionEntry& overload = entry.static_overloads.back();
+  GetOrCreateShape(entry, descriptor)
+      .static_overloads.push_back(
+          {*overload.descriptor, *overload.implementation});
+}
+
+FunctionRegistry::ShapeIndexEntry& FunctionRegistry::GetOrCreateShape(
+    RegistryEntry& entry, const cel::FunctionDescriptor& descriptor) const {
+  std::pair<bool, size_t> key(descriptor.receiver_style(),
+                              descriptor.types().size());
+  if (auto shape = entry.by_shape.find(key); shape != entry.by_shape.end()) {
+    return shape->second;
+  }
+  // Overloads of the base are owned by the base, which outlives this layer.
+  // The overload references are not assignable, so the entry is copy
+  // constructed from the base's.
+  if (base_ != nullptr) {
+    if (const ShapeIndexEntry* base_shape =
+            base_->FindShape(descriptor.name(), descriptor.receiver_style(),
+                             descriptor.types().size());
+        base_shape != nullptr) {
+      return entry.by_shape.try_emplace(key, *base_shape).first->second;
+    }
+  }
+  return entry.by_shape.try_emplace(key).first->second;
+}
+
+absl::Status FunctionRegistry::RegisterDeferred(
+    absl::Span<const DeferredOverload> overloads) {
+  if (deferred_ == nullptr) {
+    deferred_ = std::make_unique<DeferredState>();
+  }
+  absl::MutexLock lock(&deferred_->mutex);
+  for (const DeferredOverload& overload : overloads) {
+    CEL_RETURN_IF_ERROR(ValidateDeferredOverload(overload));
+    deferred_->pending[overload.name].push_back(&overload);
+    functions_[overload.name];
+  }
+  deferred_->has_pending.store(!deferred_->pending.empty(),
+                               std::memory_order_release);
+  return absl::OkStatus();
+}
+
+absl::Status FunctionRegistry::ValidateDeferredOverload(
+    const DeferredOverload& overload) const {
+  if (base_ != nullptr) {
+    cel::FunctionDescriptor descriptor(
+        overload.name, overload.receiver_style,
+        std::vector<cel::Kind>(overload.types.begin(), overload.types.end()),
+        overload.is_strict);
+    if (base_->DescriptorRegistered(descriptor)) {
+      return absl::AlreadyExistsError(
+          "CelFunction with specified parameters already registered");
+    }
+    if (!base_->ValidateNonStrictOverload(descriptor)) {
+      return absl::AlreadyExistsError(
+          "Only one overload is allowed for non-strict function");
+    }
+  }
+  absl::optional<bool> first_is_strict;
+  if (auto pending = deferred_->pending.find(overload.name);
+      pending != deferred_->pending.end() && !pending->second.empty()) {
+    first_is_strict = pending->second.front()->is_strict;
+    for (const DeferredOverload* other : pending->second) {
+      if (DeferredShapeMatches(*other, overload.receiver_style,
+                               overload.types)) {
+        return absl::AlreadyExistsError(
+            "CelFunction with specified parameters already registered");
+      }
+    }
+  }
+  if (auto registered = functions_.find(overload.name);
+      registered != functions_.end()) {
+    const RegistryEntry& entry = registered->second;
+    for (const auto& other : entry.static_overloads) {
+      if (other.descriptor->ShapeMatches(overload.receiver_style,
+                                         overload.types)) {
+        return absl::AlreadyExistsError(
+            "CelFunction with specified parameters already registered");
+      }
+    }
+    for (const auto& other : entry.lazy_overloads) {
+      if (other.descriptor->ShapeMatches(overload.receiver_style,
+                                         overload.types)) {
+        return absl::AlreadyExistsError(
+            "CelFunction with specified parameters already registered");
+      }
+    }
+    if (!entry.static_overloads.empty()) {
+      first_is_strict = entry.static_overloads[0].descriptor->is_strict();
+    } else if (!entry.lazy_overloads.empty()) {
+      first_is_strict = entry.lazy_overloads[0].descriptor->is_strict();
+    }
+  }
+  // Same rule as ValidateNonStrictOverload.
+  if (first_is_strict.has_value() &&
+      (!overload.is_strict || !*first_is_strict)) {
+    return absl::AlreadyExistsError(
+        "Only one overload is allowed for non-strict function");
+  }
   return absl::OkStatus();
 }
 
+void FunctionRegistry::MaterializeDeferred(absl::string_view name) const {
+  if (deferred_ == nullptr ||
+      !deferred_->has_pending.load(std::memory_order_acquire)) {
+    return;
+  }
+  absl::MutexLock lock(&deferred_->mutex);
+  auto pending = deferred_->pending.find(name);
+  if (pending == deferred_->pending.end()) {
+    return;
+  }
+  RegistryEntry& entry = functions_.find(name)->second;
+  for (const DeferredOverload* overload : pending->second) {
+    AddStaticOverload(
+        entry,
+        cel::FunctionDescriptor(
+            overload->name, overload->receiver_style,
+            std::vector<cel::Kind>(overload->types.begin(),
+                                   overload->types.end()),
+            overload->is_strict, overload->is_pure),
+        overload->create());
+  }
+  deferred_->pending.erase(pending);
+  if (deferred_->pending.empty()) {
+    deferred_->has_pending.store(false, std::memory_order_release);
+  }
+}
+
+void FunctionRegistry::MaterializeAllDeferred() const {
+  if (deferred_ == nullptr ||
+      !deferred_->has_pending.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::vector<absl::string_view> names;
+  {
+    absl::MutexLock lock(&deferred_->mutex);
+    names.reserve(deferred_->pending.size());
+    for (const auto& pending : deferred_->pending) {
+      names.push_back(pending.first);
+    }
+  }
+  for (absl::string_view name : names) {
+    MaterializeDeferred(name);
+  }
+}
+
 absl::Status FunctionRegistry::RegisterLazyFunction(
     const cel::FunctionDescriptor& descriptor) {
+  return RegisterLazyFunctionWithProvider(
+      descriptor, [](const cel::FunctionDescriptor&) {
+        return CreateActivationFunctionProvider();
+      });
+}
+
+absl::Status FunctionRegistry::RegisterLazyFunctionWithProvider(
+    const cel::FunctionDescriptor& descriptor,
+    absl::FunctionRef<std::unique_ptr<cel::runtime_internal::FunctionProvider>(
+        const cel::FunctionDescriptor&)>
+        make_provider) {
   if (DescriptorRegistered(descriptor)) {
     return absl::Status(
         absl::StatusCode::kAlreadyExists,
@@ -108,26 +333,119 @@ absl::Status FunctionRegistry::RegisterLazyFunction(
   }
   auto& overloads = functions_[descriptor.name()];
 
-  overloads.lazy_overloads.push_back(
-      LazyFunctionEntry(descriptor, CreateActivationFunctionProvider()));
+  overloads.lazy_overloads.push_back(LazyFunctionEntry(descriptor, nullptr));
+  LazyFunctionEntry& entry = overloads.lazy_overloads.back();
+  entry.function_provider = make_provider(*entry.descriptor);
+  GetOrCreateShape(overloads, descriptor)
+      .lazy_overloads.push_back({*entry.descriptor, *entry.function_provider});
 
   return absl::OkStatus();
 }
 
+absl::Status FunctionRegistry::RegisterAsyncFunction(
+    const cel::FunctionDescriptor& descriptor,
+    std::unique_ptr<cel::AsyncFunction> implementation) {
+  CEL_RETURN_IF_ERROR(RegisterLazyFunction(descriptor));
+  async_functions_.push_back(
+      AsyncFunctionEntry(descriptor, std::move(implementation)));
+  return absl::OkStatus();
+}
+
+std::vector<FunctionRegistry::AsyncOverload>
+FunctionRegistry::ListAsyncFunctions() const {
+  std::vector<AsyncOverload> overloads;
+  if (base_ != nullptr) {
+    overloads = base_->ListAsyncFunctions();
+  }
+  overloads.reserve(overloads.size() + async_functions_.size());
+  for (const auto& entry : async_functions_) {
+    overloads.push_back({*entry.descriptor, *entry.implementation});
+  }
+  return overloads;
+}
+
+absl::Status FunctionRegistry::RegisterBatchFunction(
+    const cel::FunctionDescriptor& descriptor,
+    std::unique_ptr<cel::Function> fallback,
+    std::unique_ptr<cel::BatchFunction> implementation) {
+  const cel::FunctionDescriptor* registered = nullptr;
+  CEL_RETURN_IF_ERROR(RegisterLazyFunctionWithProvider(
+      descriptor, [&](const cel::FunctionDescriptor& registered_descriptor) {
+        registered = &registered_descriptor;
+        return std::make_unique<BatchFunctionProviderImpl>(
+            registered_descriptor, *fallback);
+      }));
+  batch_functions_.push_back(
+      {registered, std::move(fallback), std::move(implementation)});
+  return absl::OkStatus();
+}
+
+std::vector<FunctionRegistry::BatchOverload>
+FunctionRegistry::ListBatchFunctions() const {
+  std::vector<BatchOverload> overloads;
+  if (base_ != nullptr) {
+    overloads = base_->ListBatchFunctions();
+  }
+  overloads.reserve(overloads.size() + batch_functions_.size());
+  for (const auto& entry : batch_functions_) {
+    overloads.push_back(
+        {*entry.descriptor, *entry.fallback, *entry.implementation});
+  }
+  return overloads;
+}
+
+const FunctionRegistry::ShapeIndexEntry* FunctionRegistry::FindShape(
+    absl::string_view name, bool receiver_style, size_t arity) const {
+  MaterializeDeferred(name);
+  if (auto overloads = functions_.find(name); overloads != functions_.end()) {
+    auto shape = overloads->second.by_shape.find({receiver_style, arity});
+    if (shape != overloads->second.by_shape.end()) {
+      return &shape->second;
+    }
+  }
+  if (base_ != nullptr) {
+    return base_->FindShape(name, receiver_style, arity);
+  }
+  return nullptr;
+}
+
+absl::Span<const cel::FunctionOverloadReference>
+FunctionRegistry::FindStaticOverloadsByArity(absl::string_view name,
+                                             bool receiver_style,
+                                             size_t arity) const {
+  const ShapeIndexEntry* shape = FindShape(name, receiver_style, arity);
+  if (shape == nullptr) {
+    return {};
+  }
+  return shape->static_overloads;
+}
+
+absl::Span<const FunctionRegistry::LazyOverload>
+FunctionRegistry::FindLazyOverloadsByArity(absl::string_view name,
+                                           bool receiver_style,
+                                           size_t arity) const {
+  const ShapeIndexEntry* shape = FindShape(name, receiver_style, arity);
+  if (shape == nullptr) {
+    return {};
+  }
+  return shape->lazy_overloads;
+}
+
 std::vector<cel::FunctionOverloadReference>
 FunctionRegistry::FindStaticOverloads(absl::string_view name,
                                       bool receiver_style,
                                       absl::Span<const cel::Kind> types) const {
-  std::vector<cel::FunctionOverloadReference> matched_funcs;
-
-  auto overloads = functions_.find(name);
-  if (overloads == functions_.end()) {
-    return matched_funcs;
+  absl::Span<const cel::FunctionOverloadReference> candidates =
+      FindStaticOverloadsByArity(name, receiver_style, types.size());
+  if (AllKindsAny(types)) {
+    return std::vector<cel::FunctionOverloadReference>(candidates.begin(),
+                                                       candidates.end());
   }
 
-  for (const auto& overload : overloads->second.static_overloads) {
-    if (overload.descriptor->ShapeMatches(receiver_style, types)) {
-      matched_funcs.push_back({*overload.descriptor, *overload.implementation});
+  std::vector<cel::FunctionOverloadReference> matched_funcs;
+  for (const auto& overload : candidates) {
+    if (overload.descriptor.ShapeMatches(receiver_style, types)) {
+      matched_funcs.push_back(overload);
     }
   }
 
@@ -137,16 +455,16 @@ FunctionRegistry::FindStaticOverloads(absl::string_view name,
 std::vector<FunctionRegistry::LazyOverload> FunctionRegistry::FindLazyOverloads(
     absl::string_view name, bool receiver_style,
     absl::Span<const cel::Kind> types) const {
-  std::vector<FunctionRegistry::LazyOverload> matched_funcs;
-
-  auto overloads = functions_.find(name);
-  if (overloads == functions_.end()) {
-    return matched_funcs;
+  absl::Span<const LazyOverload> candidates =
+      FindLazyOverloadsByArity(name, receiver_style, types.size());
+  if (AllKindsAny(types)) {
+    return std::vector<LazyOverload>(candidates.begin(), candidates.end());
   }
 
-  for (const auto& entry : overloads->second.lazy_overloads) {
-    if (entry.descriptor->ShapeMatches(receiver_style, types)) {
-      matched_funcs.push_back({*entry.descriptor, *entry.function_provider});
+  std::vector<FunctionRegistry::LazyOverload> matched_funcs;
+  for (const auto& overload : candidates) {
+    if (overload.descriptor.ShapeMatches(receiver_style, types)) {
+      matched_funcs.push_back(overload);
     }
   }
 
@@ -155,13 +473,19 @@ std::vector<FunctionRegistry::LazyOverload> FunctionRegistry::FindLazyOverloads(
 
 absl::node_hash_map<std::string, std::vector<const cel::FunctionDescriptor*>>
 FunctionRegistry::ListFunctions() const {
+  MaterializeAllDeferred();
   absl::node_hash_map<std::string, std::vector<const cel::FunctionDescriptor*>>
       descriptor_map;
+  if (base_ != nullptr) {
+    descriptor_map = base_->ListFunctions();
+  }
 
   for (const auto& entry : functions_) {
-    std::vector<const cel::FunctionDescriptor*> descriptors;
+    std::vector<const cel::FunctionDescriptor*>& descriptors =
+        descriptor_map[entry.first];
     const RegistryEntry& function_entry = entry.second;
-    descriptors.reserve(function_entry.static_overloads.size() +
+    descriptors.reserve(descriptors.size() +
+                        function_entry.static_overloads.size() +
                         function_entry.lazy_overloads.size());
     for (const auto& entry : function_entry.static_overloads) {
       descriptors.push_back(entry.descriptor.get());
@@ -169,7 +493,6 @@ FunctionRegistry::ListFunctions() const {
     for (const auto& entry : function_entry.lazy_overloads) {
       descriptors.push_back(entry.descriptor.get());
     }
-    descriptor_map[entry.first] = std::move(descriptors);
   }
 
   return descriptor_map;
@@ -187,6 +510,10 @@ bool FunctionRegistry::DescriptorRegistered(
 
 bool FunctionRegistry::ValidateNonStrictOverload(
     const cel::FunctionDescriptor& descriptor) const {
+  if (base_ != nullptr && !base_->ValidateNonStrictOverload(descriptor)) {
+    return false;
+  }
+  MaterializeDeferred(descriptor.name());
   auto overloads = functions_.find(descriptor.name());
   if (overloads == functions_.end()) {
     return true;
@@ -15,19 +15,26 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_REGISTRY_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_REGISTRY_H_
 
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/node_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "base/function.h"
 #include "base/function_descriptor.h"
 #include "base/kind.h"
+#include "runtime/async_function.h"
+#include "runtime/batch_function.h"
 #include "runtime/function_overload_reference.h"
 #include "runtime/function_provider.h"
 
@@ -42,6 +49,9 @@ namespace cel {
 // The registry takes ownership of the cel::Function objects -- the registry
 // must outlive any program planned using it.
 //
+// A registry may be layered on top of a shared, immutable base registry; see
+// the constructor taking a base.
+//
 // This class is move-only.
 class FunctionRegistry {
  public:
@@ -51,8 +61,47 @@ class FunctionRegistry {
     const cel::runtime_internal::FunctionProvider& provider;
   };
 
+  // Represents a single overload for an asynchronous function.
+  struct AsyncOverload {
+    const cel::FunctionDescriptor& descriptor;
+    const cel::AsyncFunction& implementation;
+  };
+
+  // Represents a single overload for a batch function.
+  struct BatchOverload {
+    const cel::FunctionDescriptor& descriptor;
+    const cel::Function& fallback;
+    const cel::BatchFunction& implementation;
+  };
+
+  // Static description of an overload that is only materialized once a
+  // program being planned looks up its function, e.g.
+  //
+  //   constexpr cel::Kind kIntInt[] = {cel::Kind::kInt, cel::Kind::kInt};
+  //   constexpr FunctionRegistry::DeferredOverload kOverloads[] = {
+  //       {cel::builtin::kAdd, false, kIntInt, &CreateIntAdd},
+  //   };
+  struct DeferredOverload {
+    absl::string_view name;
+    bool receiver_style;
+    absl::Span<const cel::Kind> types;
+    // Creates the implementation. Called at most once per registry.
+    std::unique_ptr<cel::Function> (*create)();
+    bool is_strict = true;
+    bool is_pure = false;
+  };
+
   FunctionRegistry() = default;
 
+  // Create a registry layered on top of base.
+  //
+  // Lookups return the overloads of both layers. Registrations only modify
+  // this registry and fail if they conflict with an overload in base. base
+  // can no longer be modified, so a single base (e.g. with the standard
+  // definitions) can be shared by the registries of many runtimes.
+  explicit FunctionRegistry(std::shared_ptr<const FunctionRegistry> base)
+      : base_(std::move(base)) {}
+
   // Move-only
   FunctionRegistry(FunctionRegistry&&) = default;
   FunctionRegistry& operator=(FunctionRegistry&&) = default;
@@ -62,12 +111,41 @@ class FunctionRegistry {
   absl::Status Register(const cel::FunctionDescriptor& descriptor,
                         std::unique_ptr<cel::Function> implementation);
 
+  // Register a table of overloads that are materialized on demand.
+  //
+  // Only a pointer to each table entry is recorded. The descriptors and
+  // cel::Function objects of a function's deferred overloads are created the
+  // first time the function is looked up (or all functions are listed), so a
+  // registry only pays for the functions its programs reference. Conflicts
+  // with other overloads are reported here, as for Register. The table must
+  // outlive the registry.
+  absl::Status RegisterDeferred(absl::Span<const DeferredOverload> overloads);
+
   // Register a lazily provided function.
   // Internally, the registry binds a FunctionProvider that provides an overload
   // at evaluation time by resolving against the overloads provided by an
   // implementation of cel::ActivationInterface.
   absl::Status RegisterLazyFunction(const cel::FunctionDescriptor& descriptor);
 
+  // Register an asynchronous function.
+  // The descriptor is registered as a lazy function, so planning treats calls
+  // to it like any other lazily provided function. At evaluation time
+  // EvaluateWithAsyncFunctions provides the implementation; plain evaluation
+  // reports no matching overload for such calls.
+  absl::Status RegisterAsyncFunction(
+      const cel::FunctionDescriptor& descriptor,
+      std::unique_ptr<cel::AsyncFunction> implementation);
+
+  // Register a function with a vectorized implementation.
+  // The descriptor is registered as a lazy function. Evaluations through
+  // EvaluateBatchWithBatchFunctions call implementation once per round for
+  // the calls of all rows; every other evaluation, and calls that cannot be
+  // batched, use fallback like a statically registered overload.
+  absl::Status RegisterBatchFunction(
+      const cel::FunctionDescriptor& descriptor,
+      std::unique_ptr<cel::Function> fallback,
+      std::unique_ptr<cel::BatchFunction> implementation);
+
   // Find subset of cel::Function implementations that match overload conditions
   // As types may not be available during expression compilation,
   // further narrowing of this subset will happen at evaluation stage.
@@ -98,8 +176,39 @@ class FunctionRegistry {
       absl::string_view name, bool receiver_style,
       absl::Span<const cel::Kind> types) const;
 
+  // Returns every static overload registered under name with the given
+  // receiver style and argument count, without further filtering by kind.
+  //
+  // The lookup is served from an index maintained at registration time and
+  // does not allocate. The returned span is invalidated by any subsequent
+  // registration.
+  absl::Span<const cel::FunctionOverloadReference> FindStaticOverloadsByArity(
+      absl::string_view name, bool receiver_style, size_t arity) const;
+
+  // Returns every lazy overload registered under name with the given receiver
+  // style and argument count, without further filtering by kind.
+  //
+  // The lookup is served from an index maintained at registration time and
+  // does not allocate. The returned span is invalidated by any subsequent
+  // registration.
+  absl::Span<const LazyOverload> FindLazyOverloadsByArity(
+      absl::string_view name, bool receiver_style, size_t arity) const;
+
+  // Returns all registered asynchronous overloads.
+  //
+  // Results refer to underlying registry entries by reference. Results are
+  // invalid after the registry is deleted.
+  std::vector<AsyncOverload> ListAsyncFunctions() const;
+
+  // Returns all registered batch overloads.
+  //
+  // Results refer to underlying registry entries by reference. Results are
+  // invalid after the registry is deleted.
+  std::vector<BatchOverload> ListBatchFunctions() const;
+
   // Retrieve list of registered function descriptors. This includes both
-  // static and lazy functions.
+  // static and lazy functions of all layers, and materializes all deferred
+  // overloads.
   absl::node_hash_map<std::string, std::vector<const cel::FunctionDescriptor*>>
   ListFunctions() const;
 
@@ -129,11 +238,86 @@ class FunctionRegistry {
     std::unique_ptr<cel::runtime_internal::FunctionProvider> function_provider;
   };
 
+  // Overloads of one function sharing receiver style and arity. Entries refer
+  // to the heap allocated descriptors and implementations owned by the
+  // RegistryEntry, so they stay valid when the registry is moved.
+  struct ShapeIndexEntry {
+    std::vector<cel::FunctionOverloadReference> static_overloads;
+    std::vector<LazyOverload> lazy_overloads;
+  };
+
   struct RegistryEntry {
     std::vector<StaticFunctionEntry> static_overloads;
     std::vector<LazyFunctionEntry> lazy_overloads;
+    // Keyed by (receiver_style, arity).
+    absl::flat_hash_map<std::pair<bool, size_t>, ShapeIndexEntry> by_shape;
+  };
+
+  // Deferred overloads that are not materialized yet, by function name.
+  // Lookups are const and may run on several planning threads, so
+  // materialization is synchronized. The functions_ entry for a name with
+  // pending overloads is created at registration, so materializing never
+  // modifies functions_ itself, only the entry of the function looked up.
+  //
+  // Once every pending overload is materialized, has_pending is cleared and
+  // lookups no longer take the mutex.
+  struct DeferredState {
+    std::atomic<bool> has_pending{false};
+    absl::Mutex mutex;
+    absl::flat_hash_map<absl::string_view,
+                        std::vector<const DeferredOverload*>>
+        pending ABSL_GUARDED_BY(mutex);
+  };
+
+  // Materializes the deferred overloads of name before it is looked up. Falls
+  // back to the base registry if this layer has no overloads of the shape.
+  const ShapeIndexEntry* FindShape(absl::string_view name, bool receiver_style,
+                                   size_t arity) const;
+
+  // Returns the index entry of this layer for the shape of descriptor. A new
+  // entry starts with the overloads of the base registry for the shape, so
+  // that lookups only need to consult one layer.
+  ShapeIndexEntry& GetOrCreateShape(
+      RegistryEntry& entry, const cel::FunctionDescriptor& descriptor) const;
+
+  void MaterializeDeferred(absl::string_view name) const;
+
+  void MaterializeAllDeferred() const;
+
+  void AddStaticOverload(RegistryEntry& entry,
+                         const cel::FunctionDescriptor& descriptor,
+                         std::unique_ptr<cel::Function> implementation) const;
+
+  // Returns an error if overload conflicts with a registered or pending
+  // overload.
+  absl::Status ValidateDeferredOverload(const DeferredOverload& overload) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(deferred_->mutex);
+
+  struct AsyncFunctionEntry {
+    AsyncFunctionEntry(const cel::FunctionDescriptor& descriptor,
+                       std::unique_ptr<cel::AsyncFunction> impl)
+        : descriptor(std::make_unique<cel::FunctionDescriptor>(descriptor)),
+          implementation(std::move(impl)) {}
+
+    std::unique_ptr<cel::FunctionDescriptor> descriptor;
+    std::unique_ptr<cel::AsyncFunction> implementation;
   };
 
+  struct BatchFunctionEntry {
+    const cel::FunctionDescriptor* descriptor;
+    std::unique_ptr<cel::Function> fallback;
+    std::unique_ptr<cel::BatchFunction> implementation;
+  };
+
+  // Registers descriptor as a lazy function using the provider created by
+  // make_provider for the registered copy of the descriptor.
+  absl::Status RegisterLazyFunctionWithProvider(
+      const cel::FunctionDescriptor& descriptor,
+      absl::FunctionRef<
+          std::unique_ptr<cel::runtime_internal::FunctionProvider>(
+              const cel::FunctionDescriptor&)>
+          make_provider);
+
   // Returns whether the descriptor is registered either as a lazy function or
   // as a static function.
   bool DescriptorRegistered(const cel::FunctionDescriptor& descriptor) const;
@@ -143,8 +327,14 @@ class FunctionRegistry {
   bool ValidateNonStrictOverload(
       const cel::FunctionDescriptor& descriptor) const;
 
-  // indexed by function name (not type checker overload id).
-  absl::flat_hash_map<std::string, RegistryEntry> functions_;
+  // indexed by function name (not type checker overload id). Mutable for
+  // materializing deferred overloads.
+  mutable absl::flat_hash_map<std::string, RegistryEntry> functions_;
+  // Only allocated once deferred overloads are registered.
+  std::unique_ptr<DeferredState> deferred_;
+  std::shared_ptr<const FunctionRegistry> base_;
+  std::vector<AsyncFunctionEntry> async_functions_;
+  std::vector<BatchFunctionEntry> batch_functions_;
 };
 
 }  // namespace cel
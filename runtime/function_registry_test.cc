@@ -17,6 +17,7 @@
 #include <cstdint>
 #include <memory>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -94,6 +95,39 @@ TEST(FunctionRegistryTest, FindStaticOverloadsReturns) {
       << "Expected single ConstFunction()";
 }
 
+TEST(FunctionRegistryTest, FindOverloadsByArityUsesShapeIndex) {
+  FunctionRegistry registry;
+  ASSERT_OK(registry.Register({"F", false, {Kind::kInt}},
+                              std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(registry.Register({"F", false, {Kind::kString}},
+                              std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(registry.Register({"F", false, {Kind::kInt, Kind::kInt}},
+                              std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(registry.Register({"F", true, {Kind::kInt}},
+                              std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(registry.RegisterLazyFunction({"F", false, {Kind::kDouble}}));
+
+  EXPECT_THAT(registry.FindStaticOverloadsByArity("F", false, 1), SizeIs(2));
+  EXPECT_THAT(registry.FindStaticOverloadsByArity("F", false, 2), SizeIs(1));
+  EXPECT_THAT(registry.FindStaticOverloadsByArity("F", true, 1), SizeIs(1));
+  EXPECT_THAT(registry.FindStaticOverloadsByArity("F", true, 2), SizeIs(0));
+  EXPECT_THAT(registry.FindStaticOverloadsByArity("G", false, 1), SizeIs(0));
+  EXPECT_THAT(registry.FindLazyOverloadsByArity("F", false, 1), SizeIs(1));
+
+  EXPECT_THAT(registry.FindStaticOverloads("F", false, {Kind::kAny}),
+              SizeIs(2));
+  EXPECT_THAT(
+      registry.FindStaticOverloads("F", false, {Kind::kString}),
+      ElementsAre(Truly([](const cel::FunctionOverloadReference& overload) {
+        return overload.descriptor.types()[0] == Kind::kString;
+      })));
+  EXPECT_THAT(registry.FindLazyOverloads("F", false, {Kind::kInt}), SizeIs(0));
+
+  // The index stays valid when the registry is moved.
+  FunctionRegistry moved = std::move(registry);
+  EXPECT_THAT(moved.FindStaticOverloadsByArity("F", false, 1), SizeIs(2));
+}
+
 TEST(FunctionRegistryTest, ListFunctions) {
   cel::FunctionDescriptor lazy_function_desc{"LazyFunction", false, {}};
   FunctionRegistry registry;
@@ -180,6 +214,105 @@ TEST(FunctionRegistryTest, DefaultLazyProviderAmbiguousOverload) {
                HasSubstr("Couldn't resolve function")));
 }
 
+int deferred_creations = 0;
+
+std::unique_ptr<cel::Function> CreateConstIntFunction() {
+  ++deferred_creations;
+  return std::make_unique<ConstIntFunction>();
+}
+
+constexpr Kind kDeferredIntArg[] = {Kind::kInt};
+constexpr Kind kDeferredDoubleArg[] = {Kind::kDouble};
+
+constexpr FunctionRegistry::DeferredOverload kDeferredOverloads[] = {
+    {"deferred_a", false, kDeferredIntArg, &CreateConstIntFunction},
+    {"deferred_a", false, kDeferredDoubleArg, &CreateConstIntFunction},
+    {"deferred_b", true, kDeferredIntArg, &CreateConstIntFunction},
+};
+
+TEST(FunctionRegistryTest, DeferredOverloadsMaterializedOnLookup) {
+  deferred_creations = 0;
+  FunctionRegistry registry;
+  ASSERT_OK(registry.RegisterDeferred(kDeferredOverloads));
+  EXPECT_EQ(deferred_creations, 0);
+
+  EXPECT_THAT(registry.FindStaticOverloads("deferred_a", false, {Kind::kInt}),
+              SizeIs(1));
+  EXPECT_EQ(deferred_creations, 2);
+  EXPECT_THAT(registry.FindStaticOverloads("deferred_a", false, {Kind::kAny}),
+              SizeIs(2));
+  EXPECT_EQ(deferred_creations, 2);
+
+  auto functions = registry.ListFunctions();
+  EXPECT_EQ(deferred_creations, 3);
+  ASSERT_THAT(functions["deferred_b"], SizeIs(1));
+  EXPECT_TRUE(functions["deferred_b"][0]->receiver_style());
+}
+
+TEST(FunctionRegistryTest, DeferredOverloadsConflicts) {
+  deferred_creations = 0;
+  FunctionRegistry registry;
+  ASSERT_OK(registry.RegisterDeferred(kDeferredOverloads));
+
+  EXPECT_THAT(registry.RegisterDeferred(kDeferredOverloads),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_THAT(
+      registry.Register(cel::FunctionDescriptor("deferred_a", false,
+                                                {Kind::kAny}),
+                        std::make_unique<ConstIntFunction>()),
+      StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_OK(registry.RegisterLazyFunction(
+      cel::FunctionDescriptor("deferred_b", false, {Kind::kInt})));
+  EXPECT_EQ(deferred_creations, 3);
+}
+
+TEST(FunctionRegistryTest, LayeredRegistry) {
+  auto base = std::make_shared<FunctionRegistry>();
+  ASSERT_OK(base->Register({"F", false, {Kind::kInt}},
+                           std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(base->Register({"G", false, {Kind::kInt}},
+                           std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(base->RegisterDeferred(kDeferredOverloads));
+
+  FunctionRegistry overlay(base);
+  FunctionRegistry other_overlay(base);
+  ASSERT_OK(overlay.Register({"F", false, {Kind::kString}},
+                             std::make_unique<ConstIntFunction>()));
+  ASSERT_OK(overlay.RegisterLazyFunction({"H", false, {}}));
+
+  EXPECT_THAT(overlay.FindStaticOverloadsByArity("F", false, 1), SizeIs(2));
+  EXPECT_THAT(overlay.FindStaticOverloads("F", false, {Kind::kInt}),
+              SizeIs(1));
+  EXPECT_THAT(overlay.FindStaticOverloads("G", false, {Kind::kAny}),
+              SizeIs(1));
+  EXPECT_THAT(overlay.FindStaticOverloads("deferred_a", false, {Kind::kAny}),
+              SizeIs(2));
+  EXPECT_THAT(overlay.FindLazyOverloadsByArity("H", false, 0), SizeIs(1));
+  EXPECT_THAT(other_overlay.FindStaticOverloadsByArity("F", false, 1),
+              SizeIs(1));
+  EXPECT_THAT(other_overlay.FindLazyOverloadsByArity("H", false, 0),
+              SizeIs(0));
+  EXPECT_THAT(base->FindStaticOverloadsByArity("F", false, 1), SizeIs(1));
+
+  auto functions = overlay.ListFunctions();
+  EXPECT_THAT(functions["F"], SizeIs(2));
+  EXPECT_THAT(functions["G"], SizeIs(1));
+  EXPECT_THAT(functions["H"], SizeIs(1));
+  EXPECT_THAT(functions["deferred_b"], SizeIs(1));
+
+  // Overloads of the base can't be redefined.
+  EXPECT_THAT(overlay.Register({"G", false, {Kind::kAny}},
+                               std::make_unique<ConstIntFunction>()),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_THAT(overlay.RegisterDeferred(kDeferredOverloads),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+  EXPECT_THAT(
+      overlay.Register(cel::FunctionDescriptor("G", false, {Kind::kString},
+                                               /*is_strict=*/false),
+                       std::make_unique<ConstIntFunction>()),
+      StatusIs(absl::StatusCode::kAlreadyExists));
+}
+
 TEST(FunctionRegistryTest, CanRegisterNonStrictFunction) {
   {
     FunctionRegistry registry;
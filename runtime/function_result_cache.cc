@@ -0,0 +1,252 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/function_result_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/bytes_value.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/int_value.h"
+#include "base/values/string_value.h"
+#include "base/values/timestamp_value.h"
+#include "base/values/uint_value.h"
+#include "internal/status_macros.h"
+
+namespace cel {
+
+namespace {
+
+template <typename T>
+void AppendRaw(std::string& out, T value) {
+  char buffer[sizeof(T)];
+  std::memcpy(buffer, &value, sizeof(T));
+  out.append(buffer, sizeof(T));
+}
+
+void AppendString(std::string& out, absl::string_view value) {
+  AppendRaw<uint64_t>(out, value.size());
+  out.append(value.data(), value.size());
+}
+
+// Durations and timestamps may exceed the range of int64_t nanoseconds, so
+// they are encoded as whole seconds and the remaining nanoseconds.
+void AppendDuration(std::string& out, absl::Duration value) {
+  absl::Duration remainder;
+  AppendRaw(out, absl::IDivDuration(value, absl::Seconds(1), &remainder));
+  AppendRaw(out, absl::ToInt64Nanoseconds(remainder));
+}
+
+// Appends a self-delimiting encoding of value to out. Returns false if the
+// value kind is not cacheable.
+bool AppendValue(std::string& out, const Handle<Value>& value) {
+  out.push_back(static_cast<char>(value->kind()));
+  switch (value->kind()) {
+    case ValueKind::kNull:
+      return true;
+    case ValueKind::kBool:
+      out.push_back(value.As<BoolValue>()->NativeValue() ? 1 : 0);
+      return true;
+    case ValueKind::kInt:
+      AppendRaw(out, value.As<IntValue>()->NativeValue());
+      return true;
+    case ValueKind::kUint:
+      AppendRaw(out, value.As<UintValue>()->NativeValue());
+      return true;
+    case ValueKind::kDouble:
+      AppendRaw(out, value.As<DoubleValue>()->NativeValue());
+      return true;
+    case ValueKind::kString:
+      AppendString(out, value.As<StringValue>()->ToString());
+      return true;
+    case ValueKind::kBytes:
+      AppendString(out, value.As<BytesValue>()->ToString());
+      return true;
+    case ValueKind::kDuration:
+      AppendDuration(out, value.As<DurationValue>()->NativeValue());
+      return true;
+    case ValueKind::kTimestamp:
+      AppendDuration(out, value.As<TimestampValue>()->NativeValue() -
+                              absl::UnixEpoch());
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+FunctionResultCache::FunctionResultCache(size_t capacity, size_t shard_count)
+    : shard_count_(std::max<size_t>(shard_count, 1)) {
+  shard_capacity_ = std::max<size_t>(
+      1, (capacity + shard_count_ - 1) / shard_count_);
+  shards_ = std::make_unique<Shard[]>(shard_count_);
+}
+
+absl::optional<std::string> FunctionResultCache::MakeKey(
+    const FunctionDescriptor& descriptor,
+    absl::Span<const Handle<Value>> args) {
+  std::string key;
+  AppendString(key, descriptor.name());
+  key.push_back(descriptor.receiver_style() ? 1 : 0);
+  AppendRaw<uint64_t>(key, descriptor.types().size());
+  for (Kind kind : descriptor.types()) {
+    key.push_back(static_cast<char>(kind));
+  }
+  if (!AppendArgs(args, key)) {
+    return absl::nullopt;
+  }
+  return key;
+}
+
+bool FunctionResultCache::AppendArgs(absl::Span<const Handle<Value>> args,
+                                     std::string& key) {
+  for (const Handle<Value>& arg : args) {
+    if (!AppendValue(key, arg)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+FunctionResultCache::Shard& FunctionResultCache::ShardFor(
+    const std::string& key) {
+  return shards_[absl::HashOf(key) % shard_count_];
+}
+
+absl::StatusOr<absl::optional<Handle<Value>>> FunctionResultCache::Lookup(
+    const std::string& key, ValueFactory& value_factory) {
+  Shard& shard = ShardFor(key);
+  CachedValue cached;
+  {
+    absl::MutexLock lock(&shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return absl::nullopt;
+    }
+    cached = it->second;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+
+  struct Visitor {
+    ValueFactory& value_factory;
+
+    absl::StatusOr<Handle<Value>> operator()(Null) {
+      return value_factory.GetNullValue();
+    }
+    absl::StatusOr<Handle<Value>> operator()(bool value) {
+      return value_factory.CreateBoolValue(value);
+    }
+    absl::StatusOr<Handle<Value>> operator()(int64_t value) {
+      return value_factory.CreateIntValue(value);
+    }
+    absl::StatusOr<Handle<Value>> operator()(uint64_t value) {
+      return value_factory.CreateUintValue(value);
+    }
+    absl::StatusOr<Handle<Value>> operator()(double value) {
+      return value_factory.CreateDoubleValue(value);
+    }
+    absl::StatusOr<Handle<Value>> operator()(std::string& value) {
+      return value_factory.CreateUncheckedStringValue(std::move(value));
+    }
+    absl::StatusOr<Handle<Value>> operator()(Bytes& value) {
+      return value_factory.CreateBytesValue(std::move(value.value));
+    }
+    absl::StatusOr<Handle<Value>> operator()(absl::Duration value) {
+      return value_factory.CreateUncheckedDurationValue(value);
+    }
+    absl::StatusOr<Handle<Value>> operator()(absl::Time value) {
+      return value_factory.CreateUncheckedTimestampValue(value);
+    }
+  };
+  CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                       absl::visit(Visitor{value_factory}, cached));
+  return result;
+}
+
+void FunctionResultCache::Insert(std::string key, const Handle<Value>& result) {
+  CachedValue cached;
+  switch (result->kind()) {
+    case ValueKind::kNull:
+      cached = Null{};
+      break;
+    case ValueKind::kBool:
+      cached = result.As<BoolValue>()->NativeValue();
+      break;
+    case ValueKind::kInt:
+      cached = result.As<IntValue>()->NativeValue();
+      break;
+    case ValueKind::kUint:
+      cached = result.As<UintValue>()->NativeValue();
+      break;
+    case ValueKind::kDouble:
+      cached = result.As<DoubleValue>()->NativeValue();
+      break;
+    case ValueKind::kString:
+      cached = result.As<StringValue>()->ToString();
+      break;
+    case ValueKind::kBytes:
+      cached = Bytes{result.As<BytesValue>()->ToString()};
+      break;
+    case ValueKind::kDuration:
+      cached = result.As<DurationValue>()->NativeValue();
+      break;
+    case ValueKind::kTimestamp:
+      cached = result.As<TimestampValue>()->NativeValue();
+      break;
+    default:
+      return;
+  }
+
+  Shard& shard = ShardFor(key);
+  absl::MutexLock lock(&shard.mutex);
+  if (shard.entries.size() >= shard_capacity_ &&
+      !shard.entries.contains(key)) {
+    shard.entries.erase(shard.entries.begin());
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.entries.insert_or_assign(std::move(key), std::move(cached));
+}
+
+FunctionResultCache::Stats FunctionResultCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace cel
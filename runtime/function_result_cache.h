@@ -0,0 +1,119 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_CACHE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "absl/types/variant.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+
+namespace cel {
+
+// Bounded, thread-safe cache of the results of pure function calls (see
+// FunctionDescriptor::is_pure), shared across evaluations.
+//
+// Only calls whose arguments and result are null, bool, int, uint, double,
+// string, bytes, duration or timestamp values are cached. Results are stored
+// independently of the memory manager of the evaluation that computed them,
+// so a cache may be shared by evaluations using different memory managers.
+//
+// Entries are keyed by the overload's descriptor (name, receiver style and
+// argument kinds) and the argument values, so they stay valid across runtimes
+// and registries. A cache must only be shared by runtimes whose overloads with
+// the same descriptor compute the same results.
+//
+// Entries are spread across shards by key hash to limit lock contention. When
+// a shard is full, an arbitrary entry of the shard is evicted.
+class FunctionResultCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+  };
+
+  // capacity is the approximate maximum number of cached results.
+  explicit FunctionResultCache(size_t capacity, size_t shard_count = 16);
+
+  FunctionResultCache(const FunctionResultCache&) = delete;
+  FunctionResultCache& operator=(const FunctionResultCache&) = delete;
+
+  // Returns the cache key for calling the overload described by descriptor
+  // with args, or nullopt if the call cannot be cached.
+  static absl::optional<std::string> MakeKey(
+      const FunctionDescriptor& descriptor,
+      absl::Span<const Handle<Value>> args);
+
+  // Appends an encoding of args to key, for keys identifying calls by other
+  // means than the overload descriptor. Returns false if any of the
+  // arguments cannot be cached, leaving key partially appended.
+  static bool AppendArgs(absl::Span<const Handle<Value>> args,
+                         std::string& key);
+
+  // Returns the cached result for key, created with value_factory, or
+  // nullopt on a miss.
+  absl::StatusOr<absl::optional<Handle<Value>>> Lookup(
+      const std::string& key, ValueFactory& value_factory);
+
+  // Caches result for key if its kind is cacheable.
+  void Insert(std::string key, const Handle<Value>& result);
+
+  // Returns the hit, miss and eviction counts since construction.
+  Stats GetStats() const;
+
+ private:
+  // Memory manager independent representation of a cached result.
+  struct Bytes {
+    std::string value;
+  };
+  struct Null {};
+  using CachedValue =
+      absl::variant<Null, bool, int64_t, uint64_t, double, std::string, Bytes,
+                    absl::Duration, absl::Time>;
+
+  struct Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<std::string, CachedValue> entries
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& ShardFor(const std::string& key);
+
+  size_t shard_count_;
+  size_t shard_capacity_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> evictions_{0};
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_CACHE_H_
@@ -0,0 +1,234 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/function_result_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/function_adapter.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "base/values/string_value.h"
+#include "base/values/timestamp_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::Eq;
+using testing::Optional;
+using testing::Truly;
+using cel::internal::IsOkAndHolds;
+
+class FunctionResultCacheTest : public testing::Test {
+ public:
+  FunctionResultCacheTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(FunctionResultCacheTest, KeysDependOnDescriptorAndArguments) {
+  FunctionDescriptor f1("f", false, {Kind::kInt, Kind::kString});
+  FunctionDescriptor f2("g", false, {Kind::kInt, Kind::kString});
+  FunctionDescriptor f1_receiver("f", true, {Kind::kInt, Kind::kString});
+  FunctionDescriptor f1_any("f", false, {Kind::kInt, Kind::kAny});
+  std::vector<Handle<Value>> args = {value_factory_.CreateIntValue(1),
+                                     value_factory_.CreateUncheckedStringValue(
+                                         "a")};
+  std::vector<Handle<Value>> other_args = {
+      value_factory_.CreateIntValue(1),
+      value_factory_.CreateUncheckedStringValue("b")};
+
+  auto key = FunctionResultCache::MakeKey(f1, args);
+  ASSERT_TRUE(key.has_value());
+  EXPECT_THAT(FunctionResultCache::MakeKey(f1, args), Optional(Eq(*key)));
+  EXPECT_THAT(FunctionResultCache::MakeKey(
+                  FunctionDescriptor("f", false, {Kind::kInt, Kind::kString}),
+                  args),
+              Optional(Eq(*key)));
+  EXPECT_THAT(FunctionResultCache::MakeKey(f2, args),
+              Optional(testing::Ne(*key)));
+  EXPECT_THAT(FunctionResultCache::MakeKey(f1_receiver, args),
+              Optional(testing::Ne(*key)));
+  EXPECT_THAT(FunctionResultCache::MakeKey(f1_any, args),
+              Optional(testing::Ne(*key)));
+  EXPECT_THAT(FunctionResultCache::MakeKey(f1, other_args),
+              Optional(testing::Ne(*key)));
+
+  std::vector<Handle<Value>> error_args = {
+      value_factory_.CreateErrorValue(absl::InternalError("error"))};
+  EXPECT_EQ(FunctionResultCache::MakeKey(f1, error_args), absl::nullopt);
+}
+
+TEST_F(FunctionResultCacheTest, LookupAndStats) {
+  FunctionDescriptor f("f", false, {Kind::kAny});
+  FunctionResultCache cache(/*capacity=*/4);
+  std::vector<Handle<Value>> args = {value_factory_.CreateUncheckedStringValue(
+      "2023-01-01T00:00:00Z")};
+  auto key = FunctionResultCache::MakeKey(f, args);
+  ASSERT_TRUE(key.has_value());
+
+  EXPECT_THAT(cache.Lookup(*key, value_factory_), IsOkAndHolds(absl::nullopt));
+
+  absl::Time time = absl::FromUnixSeconds(1672531200);
+  cache.Insert(*key, value_factory_.CreateUncheckedTimestampValue(time));
+  EXPECT_THAT(cache.Lookup(*key, value_factory_),
+              IsOkAndHolds(Optional(Truly([&](const Handle<Value>& value) {
+                return value->Is<TimestampValue>() &&
+                       value.As<TimestampValue>()->NativeValue() == time;
+              }))));
+
+  FunctionResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+TEST_F(FunctionResultCacheTest, ErrorResultsAreNotCached) {
+  FunctionDescriptor f("f", false, {Kind::kAny});
+  FunctionResultCache cache(/*capacity=*/4);
+  auto key = FunctionResultCache::MakeKey(f, {});
+  ASSERT_TRUE(key.has_value());
+
+  cache.Insert(*key, value_factory_.CreateErrorValue(
+                         absl::InvalidArgumentError("error")));
+  EXPECT_THAT(cache.Lookup(*key, value_factory_), IsOkAndHolds(absl::nullopt));
+}
+
+TEST_F(FunctionResultCacheTest, Bounded) {
+  FunctionDescriptor f("f", false, {Kind::kAny});
+  FunctionResultCache cache(/*capacity=*/2, /*shard_count=*/1);
+  for (int64_t i = 0; i < 10; ++i) {
+    std::vector<Handle<Value>> args = {value_factory_.CreateIntValue(i)};
+    auto key = FunctionResultCache::MakeKey(f, args);
+    ASSERT_TRUE(key.has_value());
+    cache.Insert(*key, value_factory_.CreateIntValue(i * i));
+  }
+  EXPECT_EQ(cache.GetStats().evictions, 8);
+}
+
+// Runtimes sharing a cache, each registering pure square(int) and cube(int)
+// overloads that count their calls.
+class SharedFunctionResultCacheTest : public testing::Test {
+ public:
+  absl::StatusOr<std::unique_ptr<const Runtime>> CreateRuntime() {
+    RuntimeOptions options;
+    options.function_result_cache = cache_;
+    CEL_ASSIGN_OR_RETURN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    CEL_RETURN_IF_ERROR(builder.function_registry().Register(
+        FunctionDescriptor("square", false, {Kind::kInt}, /*is_strict=*/true,
+                           /*is_pure=*/true),
+        UnaryFunctionAdapter<int64_t, int64_t>::WrapFunction(
+            [this](ValueFactory&, int64_t x) -> int64_t {
+              ++calls_;
+              return x * x;
+            })));
+    CEL_RETURN_IF_ERROR(builder.function_registry().Register(
+        FunctionDescriptor("cube", false, {Kind::kInt}, /*is_strict=*/true,
+                           /*is_pure=*/true),
+        UnaryFunctionAdapter<int64_t, int64_t>::WrapFunction(
+            [this](ValueFactory&, int64_t x) -> int64_t {
+              ++calls_;
+              return x * x * x;
+            })));
+    return std::move(builder).Build();
+  }
+
+  absl::StatusOr<int64_t> Evaluate(const Runtime& runtime,
+                                   absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(auto program, ProtobufRuntimeAdapter::CreateProgram(
+                                           runtime, parsed_expr));
+    ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                      MemoryManagerRef::ReferenceCounting());
+    Activation activation;
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         program->Evaluate(activation, value_factory.get()));
+    if (!result->Is<IntValue>()) {
+      return absl::InternalError(result->DebugString());
+    }
+    return result.As<IntValue>()->NativeValue();
+  }
+
+ protected:
+  std::shared_ptr<FunctionResultCache> cache_ =
+      std::make_shared<FunctionResultCache>(/*capacity=*/16);
+  int calls_ = 0;
+};
+
+TEST_F(SharedFunctionResultCacheTest, ResultsOutliveTheRuntime) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime());
+  EXPECT_THAT(Evaluate(*runtime, "square(3)"), IsOkAndHolds(9));
+  EXPECT_EQ(calls_, 1);
+  runtime.reset();
+
+  // The overloads of the new runtime may reuse the addresses of the destroyed
+  // ones, so results must be keyed independently of them.
+  ASSERT_OK_AND_ASSIGN(runtime, CreateRuntime());
+  EXPECT_THAT(Evaluate(*runtime, "cube(3)"), IsOkAndHolds(27));
+  EXPECT_EQ(calls_, 2);
+  EXPECT_THAT(Evaluate(*runtime, "square(3)"), IsOkAndHolds(9));
+  EXPECT_EQ(calls_, 2);
+  EXPECT_EQ(cache_->GetStats().hits, 1);
+}
+
+TEST_F(SharedFunctionResultCacheTest, RuntimesShareResults) {
+  ASSERT_OK_AND_ASSIGN(auto runtime1, CreateRuntime());
+  ASSERT_OK_AND_ASSIGN(auto runtime2, CreateRuntime());
+
+  EXPECT_THAT(Evaluate(*runtime1, "square(4) + cube(2)"), IsOkAndHolds(24));
+  EXPECT_EQ(calls_, 2);
+  EXPECT_THAT(Evaluate(*runtime2, "cube(2) + square(4)"), IsOkAndHolds(24));
+  EXPECT_EQ(calls_, 2);
+  EXPECT_THAT(Evaluate(*runtime2, "square(2)"), IsOkAndHolds(4));
+  EXPECT_EQ(calls_, 3);
+}
+
+}  // namespace
+}  // namespace cel
@@ -0,0 +1,76 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/function_result_store.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+
+namespace cel {
+
+namespace {
+
+template <typename T>
+void AppendRaw(std::string& out, T value) {
+  char buffer[sizeof(T)];
+  std::memcpy(buffer, &value, sizeof(T));
+  out.append(buffer, sizeof(T));
+}
+
+}  // namespace
+
+FunctionResultStore::FunctionResultStore(size_t capacity)
+    : results_(capacity, /*shard_count=*/1) {}
+
+absl::optional<std::string> FunctionResultStore::MakeKey(
+    const FunctionDescriptor& descriptor, int64_t expr_id,
+    absl::Span<const Handle<Value>> args) {
+  std::string key;
+  AppendRaw(key, expr_id);
+  AppendRaw<uint64_t>(key, descriptor.name().size());
+  key.append(descriptor.name());
+  key.push_back(descriptor.receiver_style() ? 1 : 0);
+  AppendRaw<uint64_t>(key, descriptor.types().size());
+  for (Kind kind : descriptor.types()) {
+    key.push_back(static_cast<char>(kind));
+  }
+  if (!FunctionResultCache::AppendArgs(args, key)) {
+    return absl::nullopt;
+  }
+  return key;
+}
+
+absl::StatusOr<absl::optional<Handle<Value>>> FunctionResultStore::Lookup(
+    const std::string& key, ValueFactory& value_factory) {
+  return results_.Lookup(key, value_factory);
+}
+
+void FunctionResultStore::Insert(std::string key, const Handle<Value>& result) {
+  results_.Insert(std::move(key), result);
+}
+
+}  // namespace cel
@@ -0,0 +1,83 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_STORE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/function_result_cache.h"
+
+namespace cel {
+
+// Results of the function calls of one program, carried between the phases of
+// a multi-phase evaluation with unknown function results enabled (see
+// UnknownProcessingOptions::kAttributeAndFunction).
+//
+// Callers set the same store on the activation of each phase. Calls resolved
+// in an earlier phase are answered from the store instead of calling the
+// function again, so a function that reported an unknown result is called
+// until it returns a value, and not after. Unknown results are never stored.
+//
+// Entries are keyed by the function descriptor, the id of the call expression
+// and the argument values, so a store must only be used with one program.
+// Only calls whose arguments and result can be cached by FunctionResultCache
+// are stored. Results do not depend on the memory manager of the evaluation
+// that computed them.
+//
+// Thread-safe.
+class FunctionResultStore final {
+ public:
+  // capacity is the maximum number of stored results. Once it is reached,
+  // storing another result evicts an arbitrary one, whose call is then made
+  // again if it is evaluated.
+  explicit FunctionResultStore(size_t capacity = 4096);
+
+  FunctionResultStore(const FunctionResultStore&) = delete;
+  FunctionResultStore& operator=(const FunctionResultStore&) = delete;
+
+  // Returns the key for calling the overload described by descriptor from the
+  // call expression expr_id with args, or nullopt if the call cannot be
+  // stored.
+  static absl::optional<std::string> MakeKey(
+      const FunctionDescriptor& descriptor, int64_t expr_id,
+      absl::Span<const Handle<Value>> args);
+
+  // Returns the stored result for key, created with value_factory, or nullopt
+  // if there is none.
+  absl::StatusOr<absl::optional<Handle<Value>>> Lookup(
+      const std::string& key, ValueFactory& value_factory);
+
+  // Stores result for key if its kind can be stored.
+  void Insert(std::string key, const Handle<Value>& result);
+
+  // Returns how many lookups were answered from the store.
+  int64_t hits() const { return results_.GetStats().hits; }
+
+ private:
+  FunctionResultCache results_;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_FUNCTION_RESULT_STORE_H_
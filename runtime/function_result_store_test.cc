@@ -0,0 +1,153 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/function_result_store.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "base/function_adapter.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "base/values/unknown_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/internal/errors.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::Eq;
+using testing::Ne;
+using testing::Optional;
+
+TEST(FunctionResultStore, KeysDependOnDescriptorCallAndArguments) {
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  TypeManager type_manager(type_factory, TypeProvider::Builtin());
+  ValueFactory value_factory(type_manager);
+  FunctionDescriptor descriptor("f", false, {Kind::kInt});
+  std::vector<Handle<Value>> args = {value_factory.CreateIntValue(1)};
+
+  auto key = FunctionResultStore::MakeKey(descriptor, 1, args);
+  ASSERT_TRUE(key.has_value());
+  EXPECT_THAT(FunctionResultStore::MakeKey(descriptor, 1, args),
+              Optional(Eq(*key)));
+  EXPECT_THAT(FunctionResultStore::MakeKey(descriptor, 2, args),
+              Optional(Ne(*key)));
+  EXPECT_THAT(FunctionResultStore::MakeKey(
+                  FunctionDescriptor("f", true, {Kind::kInt}), 1, args),
+              Optional(Ne(*key)));
+  std::vector<Handle<Value>> other_args = {value_factory.CreateIntValue(2)};
+  EXPECT_THAT(FunctionResultStore::MakeKey(descriptor, 1, other_args),
+              Optional(Ne(*key)));
+}
+
+// Evaluates fetch(1) + 1 in phases, where fetch reports an unknown result
+// until its backend is ready.
+class FunctionResultStoreEvaluationTest : public testing::Test {
+ public:
+  void SetUp() override {
+    RuntimeOptions options;
+    options.unknown_processing =
+        UnknownProcessingOptions::kAttributeAndFunction;
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    ASSERT_OK(builder.function_registry().Register(
+        FunctionDescriptor("fetch", false, {Kind::kInt}),
+        UnaryFunctionAdapter<Handle<Value>, int64_t>::WrapFunction(
+            [this](ValueFactory& value_factory, int64_t x) -> Handle<Value> {
+              ++calls_;
+              if (!ready_) {
+                return value_factory.CreateErrorValue(
+                    runtime_internal::CreateUnknownFunctionResultError(
+                        "not ready"));
+              }
+              return value_factory.CreateIntValue(x * 10);
+            })));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+    ASSERT_OK_AND_ASSIGN(ParsedExpr expr, Parse("fetch(1) + 1"));
+    ASSERT_OK_AND_ASSIGN(
+        program_, ProtobufRuntimeAdapter::CreateProgram(*runtime_, expr));
+  }
+
+  absl::StatusOr<Handle<Value>> Evaluate(const Activation& activation) {
+    return program_->Evaluate(activation, value_factory_.get());
+  }
+
+ protected:
+  std::unique_ptr<const Runtime> runtime_;
+  std::unique_ptr<TraceableProgram> program_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+  bool ready_ = false;
+  int calls_ = 0;
+};
+
+TEST_F(FunctionResultStoreEvaluationTest, ResolvedCallsAreNotMadeAgain) {
+  FunctionResultStore store;
+  Activation activation;
+  activation.SetFunctionResultStore(&store);
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result, Evaluate(activation));
+  EXPECT_TRUE(result->Is<UnknownValue>());
+  EXPECT_EQ(calls_, 1);
+
+  ready_ = true;
+  ASSERT_OK_AND_ASSIGN(result, Evaluate(activation));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 11);
+  EXPECT_EQ(calls_, 2);
+
+  // The result is read from the store, even though fetch would report an
+  // unknown result again.
+  ready_ = false;
+  ASSERT_OK_AND_ASSIGN(result, Evaluate(activation));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 11);
+  EXPECT_EQ(calls_, 2);
+  EXPECT_EQ(store.hits(), 1);
+}
+
+TEST_F(FunctionResultStoreEvaluationTest, CallsAreMadeWithoutStore) {
+  Activation activation;
+  ready_ = true;
+  ASSERT_OK(Evaluate(activation));
+  ASSERT_OK(Evaluate(activation));
+  EXPECT_EQ(calls_, 2);
+}
+
+}  // namespace
+}  // namespace cel
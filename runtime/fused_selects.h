@@ -0,0 +1,34 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_FUSED_SELECTS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_FUSED_SELECTS_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable fused select steps in the runtime being built.
+//
+// Chains of field selections (`a.b.c`, `has(a.b.c)`), and comparisons of a
+// selected value against a constant (`a.b.c == 'x'`) or a constant list
+// (`a.b.c in ['x', 'y']`), are planned as single steps that don't push the
+// intermediate values. Not applied when unknown processing or missing
+// attribute errors are enabled.
+absl::Status EnableFusedSelects(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_FUSED_SELECTS_H_
@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/concat_list_value.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "internal/status_macros.h"
+
+namespace cel::runtime_internal {
+
+namespace {
+
+void AppendParts(const Handle<ListValue>& list,
+                 std::vector<Handle<ListValue>>& parts) {
+  if (list->Is<ConcatListValue>()) {
+    const auto& concat_parts = list->As<ConcatListValue>().parts();
+    parts.insert(parts.end(), concat_parts.begin(), concat_parts.end());
+  } else {
+    parts.push_back(list);
+  }
+}
+
+size_t PartCount(const Handle<ListValue>& list) {
+  if (list->Is<ConcatListValue>()) {
+    return list->As<ConcatListValue>().parts().size();
+  }
+  return 1;
+}
+
+class ConcatListValueIterator final : public ListValue::Iterator {
+ public:
+  ConcatListValueIterator(ValueFactory& value_factory,
+                          const std::vector<Handle<ListValue>>& parts)
+      : value_factory_(value_factory), parts_(parts) {}
+
+  bool HasNext() override {
+    while (part_iterator_ == nullptr || !part_iterator_->HasNext()) {
+      if (next_part_ >= parts_.size()) {
+        return false;
+      }
+      // Errors creating the iterator are reported by Next().
+      auto iterator = parts_[next_part_]->NewIterator(value_factory_);
+      if (!iterator.ok()) {
+        status_ = iterator.status();
+        return true;
+      }
+      part_iterator_ = *std::move(iterator);
+      ++next_part_;
+    }
+    return true;
+  }
+
+  absl::StatusOr<Handle<Value>> Next() override {
+    if (ABSL_PREDICT_FALSE(!HasNext())) {
+      return absl::FailedPreconditionError(
+          "ListValue::Iterator::Next() called when "
+          "ListValue::Iterator::HasNext() returns false");
+    }
+    if (ABSL_PREDICT_FALSE(!status_.ok())) {
+      return status_;
+    }
+    return part_iterator_->Next();
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const std::vector<Handle<ListValue>>& parts_;
+  size_t next_part_ = 0;
+  std::unique_ptr<ListValue::Iterator> part_iterator_;
+  absl::Status status_;
+};
+
+}  // namespace
+
+absl::StatusOr<Handle<ListValue>> ConcatListValue::Concat(
+    ValueFactory& value_factory, const Handle<ListValue>& lhs,
+    const Handle<ListValue>& rhs) {
+  size_t lhs_size = lhs->Size();
+  if (lhs_size == 0) {
+    return rhs;
+  }
+  size_t rhs_size = rhs->Size();
+  if (rhs_size == 0) {
+    return lhs;
+  }
+
+  // TODO(uncreated-issue/50): add option for checking lists have homogenous element
+  // types and use a more specialized list type when possible.
+  CEL_ASSIGN_OR_RETURN(Handle<ListType> list_type,
+                       value_factory.type_factory().CreateListType(
+                           value_factory.type_factory().GetDynType()));
+
+  if (lhs_size + rhs_size >= kMinLazySize &&
+      PartCount(lhs) + PartCount(rhs) <= kMaxParts) {
+    std::vector<Handle<ListValue>> parts;
+    parts.reserve(PartCount(lhs) + PartCount(rhs));
+    AppendParts(lhs, parts);
+    AppendParts(rhs, parts);
+    return value_factory.CreateListValue<ConcatListValue>(list_type,
+                                                          std::move(parts));
+  }
+
+  CEL_ASSIGN_OR_RETURN(auto list_builder,
+                       list_type->NewValueBuilder(value_factory));
+  list_builder->Reserve(lhs_size + rhs_size);
+  for (const Handle<ListValue>* list : {&lhs, &rhs}) {
+    CEL_ASSIGN_OR_RETURN(auto iterator, (*list)->NewIterator(value_factory));
+    while (iterator->HasNext()) {
+      CEL_ASSIGN_OR_RETURN(Handle<Value> element, iterator->Next());
+      CEL_RETURN_IF_ERROR(list_builder->Add(std::move(element)));
+    }
+  }
+  return std::move(*list_builder).Build();
+}
+
+ConcatListValue::ConcatListValue(const Handle<ListType>& type,
+                                 std::vector<Handle<ListValue>> parts)
+    : CEL_LIST_VALUE_CLASS(type), parts_(std::move(parts)), size_(0) {
+  ends_.reserve(parts_.size());
+  for (const auto& part : parts_) {
+    size_ += part->Size();
+    ends_.push_back(size_);
+  }
+}
+
+std::string ConcatListValue::DebugString() const {
+  std::string out = "[";
+  for (const auto& part : parts_) {
+    std::string part_string = part->DebugString();
+    // Strip the brackets of each part.
+    absl::StrAppend(&out, out.size() > 1 ? ", " : "",
+                    absl::string_view(part_string)
+                        .substr(1, part_string.size() - 2));
+  }
+  out.push_back(']');
+  return out;
+}
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<ListValue::Iterator>>>
+ConcatListValue::NewIterator(ValueFactory& value_factory) const {
+  return std::make_unique<ConcatListValueIterator>(value_factory, parts_);
+}
+
+absl::StatusOr<Handle<Value>> ConcatListValue::Contains(
+    ValueFactory& value_factory, const Handle<Value>& other) const {
+  for (const auto& part : parts_) {
+    CEL_ASSIGN_OR_RETURN(auto contains, part->Contains(value_factory, other));
+    if (contains->Is<BoolValue>() && contains->As<BoolValue>().NativeValue()) {
+      return contains;
+    }
+  }
+  return value_factory.CreateBoolValue(false);
+}
+
+absl::StatusOr<bool> ConcatListValue::AnyOf(ValueFactory& value_factory,
+                                            AnyOfCallback cb) const {
+  for (const auto& part : parts_) {
+    CEL_ASSIGN_OR_RETURN(bool any, part->AnyOf(value_factory, cb));
+    if (any) {
+      return true;
+    }
+  }
+  return false;
+}
+
+absl::StatusOr<Handle<Value>> ConcatListValue::GetImpl(
+    ValueFactory& value_factory, size_t index) const {
+  size_t part = std::upper_bound(ends_.begin(), ends_.end(), index) -
+                ends_.begin();
+  size_t start = part == 0 ? 0 : ends_[part - 1];
+  return parts_[part]->Get(value_factory, index - start);
+}
+
+CEL_IMPLEMENT_LIST_VALUE(ConcatListValue);
+
+}  // namespace cel::runtime_internal
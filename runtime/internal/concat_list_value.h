@@ -0,0 +1,89 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_CONCAT_LIST_VALUE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_CONCAT_LIST_VALUE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/nullability.h"
+#include "absl/status/statusor.h"
+#include "base/handle.h"
+#include "base/types/list_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+
+namespace cel::runtime_internal {
+
+// Immutable list value presenting the concatenation of other lists without
+// copying their elements. Concatenating a ConcatListValue splices its parts
+// into the result, so chains like `a + b + c` hold a flat list of parts.
+class ConcatListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  // Results with fewer elements are copied, which is cheaper than the
+  // indirection on every access.
+  static constexpr size_t kMinLazySize = 8;
+
+  // Results with more parts are copied, bounding the cost of indexing and of
+  // splicing the parts into the next concatenation.
+  static constexpr size_t kMaxParts = 64;
+
+  // Returns the concatenation of lhs and rhs.
+  static absl::StatusOr<Handle<ListValue>> Concat(ValueFactory& value_factory,
+                                                  const Handle<ListValue>& lhs,
+                                                  const Handle<ListValue>& rhs);
+
+  // parts must be non-empty lists.
+  ConcatListValue(const Handle<ListType>& type,
+                  std::vector<Handle<ListValue>> parts);
+
+  size_t Size() const override { return size_; }
+
+  bool IsEmpty() const override { return size_ == 0; }
+
+  std::string DebugString() const override;
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory ABSL_ATTRIBUTE_LIFETIME_BOUND) const
+      ABSL_ATTRIBUTE_LIFETIME_BOUND override;
+
+  absl::StatusOr<Handle<Value>> Contains(
+      ValueFactory& value_factory, const Handle<Value>& other) const override;
+
+  absl::StatusOr<bool> AnyOf(ValueFactory& value_factory,
+                             AnyOfCallback cb) const override;
+
+  const std::vector<Handle<ListValue>>& parts() const { return parts_; }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override;
+
+ private:
+  std::vector<Handle<ListValue>> parts_;
+  // ends_[i] is the index one past the last element of parts_[i].
+  std::vector<size_t> ends_;
+  size_t size_;
+
+  CEL_DECLARE_LIST_VALUE(ConcatListValue);
+};
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_CONCAT_LIST_VALUE_H_
@@ -0,0 +1,126 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/concat_list_value.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "base/values/list_value_builder.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+class ConcatListValueTest : public testing::Test {
+ public:
+  ConcatListValueTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  // Returns the list [start, start + 1, ..., start + size - 1].
+  Handle<ListValue> MakeIntList(int64_t start, int64_t size) {
+    ListValueBuilder<Value> builder(value_factory_,
+                                    type_factory_.GetDynType());
+    for (int64_t i = start; i < start + size; ++i) {
+      EXPECT_OK(builder.Add(value_factory_.CreateIntValue(i)));
+    }
+    return std::move(builder).Build().value();
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(ConcatListValueTest, EmptyOperand) {
+  auto list = MakeIntList(0, 10);
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       ConcatListValue::Concat(value_factory_, list,
+                                               MakeIntList(0, 0)));
+  EXPECT_EQ(&*result, &*list);
+}
+
+TEST_F(ConcatListValueTest, SmallResultCopied) {
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       ConcatListValue::Concat(value_factory_,
+                                               MakeIntList(0, 2),
+                                               MakeIntList(2, 2)));
+  EXPECT_FALSE(result->Is<ConcatListValue>());
+  EXPECT_EQ(result->DebugString(), "[0, 1, 2, 3]");
+}
+
+TEST_F(ConcatListValueTest, Chain) {
+  Handle<ListValue> result = MakeIntList(0, 5);
+  for (int64_t start = 5; start < 20; start += 5) {
+    ASSERT_OK_AND_ASSIGN(result,
+                         ConcatListValue::Concat(value_factory_, result,
+                                                 MakeIntList(start, 5)));
+  }
+  ASSERT_TRUE(result->Is<ConcatListValue>());
+  EXPECT_EQ(result->As<ConcatListValue>().parts().size(), 4);
+  EXPECT_EQ(result->Size(), 20);
+
+  for (int64_t i = 0; i < 20; ++i) {
+    ASSERT_OK_AND_ASSIGN(auto element, result->Get(value_factory_, i));
+    EXPECT_EQ(element->As<IntValue>().NativeValue(), i);
+  }
+
+  ASSERT_OK_AND_ASSIGN(auto iterator, result->NewIterator(value_factory_));
+  int64_t expected = 0;
+  while (iterator->HasNext()) {
+    ASSERT_OK_AND_ASSIGN(auto element, iterator->Next());
+    EXPECT_EQ(element->As<IntValue>().NativeValue(), expected++);
+  }
+  EXPECT_EQ(expected, 20);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto contains,
+      result->Contains(value_factory_, value_factory_.CreateUintValue(17)));
+  EXPECT_TRUE(contains->As<BoolValue>().NativeValue());
+  ASSERT_OK_AND_ASSIGN(
+      contains,
+      result->Contains(value_factory_, value_factory_.CreateIntValue(20)));
+  EXPECT_FALSE(contains->As<BoolValue>().NativeValue());
+
+  EXPECT_THAT(result->DebugString(),
+              testing::StartsWith("[0, 1, 2, 3, 4, 5, 6"));
+  ASSERT_OK_AND_ASSIGN(auto equal,
+                       result->Equals(value_factory_, *MakeIntList(0, 20)));
+  EXPECT_TRUE(equal->As<BoolValue>().NativeValue());
+}
+
+TEST_F(ConcatListValueTest, TooManyPartsCopied) {
+  Handle<ListValue> result = MakeIntList(0, 8);
+  for (size_t i = 1; i <= ConcatListValue::kMaxParts; ++i) {
+    ASSERT_OK_AND_ASSIGN(result,
+                         ConcatListValue::Concat(value_factory_, result,
+                                                 MakeIntList(i * 8, 8)));
+  }
+  EXPECT_FALSE(result->Is<ConcatListValue>());
+  EXPECT_EQ(result->Size(), (ConcatListValue::kMaxParts + 1) * 8);
+  ASSERT_OK_AND_ASSIGN(auto element, result->Get(value_factory_, 100));
+  EXPECT_EQ(element->As<IntValue>().NativeValue(), 100);
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
@@ -0,0 +1,274 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/copy_on_write_containers.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/map_value.h"
+#include "base/values/map_value_builder.h"
+#include "internal/status_macros.h"
+
+namespace cel::runtime_internal {
+
+namespace {
+
+std::string ElementsDebugString(const SharedListElements& elements) {
+  std::string out = "[";
+  for (const auto& element : elements) {
+    absl::StrAppend(&out, out.size() > 1 ? ", " : "", element->DebugString());
+  }
+  out.push_back(']');
+  return out;
+}
+
+std::string EntriesDebugString(const SharedMapEntries& entries) {
+  return base_internal::ComposeMapValueDebugString(
+      entries, [](const Handle<Value>& value) { return value->DebugString(); },
+      [](const Handle<Value>& value) { return value->DebugString(); });
+}
+
+}  // namespace
+
+CEL_IMPLEMENT_LIST_VALUE(SharedListValue);
+
+std::string SharedListValue::DebugString() const {
+  return ElementsDebugString(storage_.get());
+}
+
+CEL_IMPLEMENT_MAP_VALUE(SharedMapValue);
+
+std::string SharedMapValue::DebugString() const {
+  return EntriesDebugString(storage_.get());
+}
+
+absl::StatusOr<Handle<ListValue>> SharedMapValue::ListKeys(
+    ValueFactory& value_factory) const {
+  ListValueBuilder<Value> keys(value_factory, type()->key());
+  keys.Reserve(Size());
+  for (const auto& entry : storage_.get()) {
+    CEL_RETURN_IF_ERROR(keys.Add(entry.first));
+  }
+  return std::move(keys).Build();
+}
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<MapValue::Iterator>>>
+SharedMapValue::NewIterator(ValueFactory& value_factory) const {
+  return base_internal::NewMapValueStorageKeyIterator<Value>(value_factory,
+                                                             storage_.get());
+}
+
+absl::StatusOr<std::pair<Handle<Value>, bool>> SharedMapValue::FindImpl(
+    ValueFactory& value_factory, const Handle<Value>& key) const {
+  auto existing = storage_.get().find(key);
+  if (existing == storage_.get().end()) {
+    return std::make_pair(Handle<Value>(), false);
+  }
+  return std::make_pair(existing->second, true);
+}
+
+absl::StatusOr<Handle<Value>> SharedMapValue::HasImpl(
+    ValueFactory& value_factory, const Handle<Value>& key) const {
+  return value_factory.CreateBoolValue(storage_.get().contains(key));
+}
+
+CopyOnWriteListBuilder::CopyOnWriteListBuilder(ValueFactory& value_factory,
+                                               Handle<ListValue> list)
+    : ListValueBuilderInterface(value_factory),
+      type_(list->type()),
+      list_(std::move(list)) {
+  if (list_->Is<SharedListValue>()) {
+    storage_.emplace(list_->As<SharedListValue>().storage());
+  }
+}
+
+std::string CopyOnWriteListBuilder::DebugString() const {
+  if (storage_.has_value()) {
+    return ElementsDebugString(storage_->get());
+  }
+  return list_->DebugString();
+}
+
+absl::StatusOr<SharedListElements*> CopyOnWriteListBuilder::MutableElements() {
+  if (!modified_) {
+    if (!storage_.has_value()) {
+      SharedListStorage storage;
+      SharedListElements& elements = storage.mutable_get();
+      elements.reserve(std::max(reserve_, list_->Size()));
+      CEL_ASSIGN_OR_RETURN(auto iterator, list_->NewIterator(value_factory()));
+      while (iterator->HasNext()) {
+        CEL_ASSIGN_OR_RETURN(Handle<Value> element, iterator->Next());
+        elements.push_back(std::move(element));
+      }
+      storage_.emplace(std::move(storage));
+    }
+    // Drop the reference held through the list, so that the elements are
+    // only copied if they are referenced elsewhere.
+    list_ = Handle<ListValue>();
+    modified_ = true;
+    storage_->mutable_get().reserve(reserve_);
+  }
+  return &storage_->mutable_get();
+}
+
+absl::Status CopyOnWriteListBuilder::Add(Handle<Value> value) {
+  CEL_RETURN_IF_ERROR(
+      base_internal::CheckListElement(*type_->element(), *value));
+  CEL_ASSIGN_OR_RETURN(SharedListElements * elements, MutableElements());
+  elements->push_back(std::move(value));
+  return absl::OkStatus();
+}
+
+absl::Status CopyOnWriteListBuilder::Set(size_t index, Handle<Value> value) {
+  if (index >= Size()) {
+    return absl::OutOfRangeError(
+        absl::StrCat("index out of range: ", index, " >= ", Size()));
+  }
+  CEL_RETURN_IF_ERROR(
+      base_internal::CheckListElement(*type_->element(), *value));
+  CEL_ASSIGN_OR_RETURN(SharedListElements * elements, MutableElements());
+  (*elements)[index] = std::move(value);
+  return absl::OkStatus();
+}
+
+size_t CopyOnWriteListBuilder::Size() const {
+  if (storage_.has_value()) {
+    return storage_->get().size();
+  }
+  return list_->Size();
+}
+
+void CopyOnWriteListBuilder::Reserve(size_t size) {
+  reserve_ = std::max(reserve_, size);
+  if (modified_) {
+    storage_->mutable_get().reserve(reserve_);
+  }
+}
+
+absl::StatusOr<Handle<ListValue>> CopyOnWriteListBuilder::Build() && {
+  if (!modified_) {
+    return std::move(list_);
+  }
+  return value_factory().CreateListValue<SharedListValue>(
+      std::move(type_), *std::move(storage_));
+}
+
+CopyOnWriteMapBuilder::CopyOnWriteMapBuilder(ValueFactory& value_factory,
+                                             Handle<MapValue> map)
+    : MapValueBuilderInterface(value_factory),
+      type_(map->type()),
+      map_(std::move(map)) {
+  if (map_->Is<SharedMapValue>()) {
+    storage_.emplace(map_->As<SharedMapValue>().storage());
+  }
+}
+
+std::string CopyOnWriteMapBuilder::DebugString() const {
+  if (storage_.has_value()) {
+    return EntriesDebugString(storage_->get());
+  }
+  return map_->DebugString();
+}
+
+absl::StatusOr<SharedMapEntries*> CopyOnWriteMapBuilder::MutableEntries() {
+  if (!modified_) {
+    if (!storage_.has_value()) {
+      SharedMapStorage storage;
+      SharedMapEntries& entries = storage.mutable_get();
+      entries.reserve(map_->Size());
+      CEL_ASSIGN_OR_RETURN(auto iterator, map_->NewIterator(value_factory()));
+      while (iterator->HasNext()) {
+        CEL_ASSIGN_OR_RETURN(Handle<Value> key, iterator->Next());
+        CEL_ASSIGN_OR_RETURN(Handle<Value> value,
+                             map_->Get(value_factory(), key));
+        entries.insert_or_assign(std::move(key), std::move(value));
+      }
+      storage_.emplace(std::move(storage));
+    }
+    // Drop the reference held through the map, so that the entries are only
+    // copied if they are referenced elsewhere.
+    map_ = Handle<MapValue>();
+    modified_ = true;
+  }
+  return &storage_->mutable_get();
+}
+
+absl::Status CopyOnWriteMapBuilder::Put(Handle<Value> key,
+                                        Handle<Value> value) {
+  CEL_RETURN_IF_ERROR(base_internal::CheckMapKeyAndValue(
+      *type_->key(), *type_->value(), *key, *value));
+  CEL_ASSIGN_OR_RETURN(SharedMapEntries * entries, MutableEntries());
+  if (!entries->insert({std::move(key), std::move(value)}).second) {
+    return base_internal::DuplicateKeyError();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CopyOnWriteMapBuilder::InsertOrAssign(Handle<Value> key,
+                                                   Handle<Value> value) {
+  CEL_RETURN_IF_ERROR(base_internal::CheckMapKeyAndValue(
+      *type_->key(), *type_->value(), *key, *value));
+  CEL_ASSIGN_OR_RETURN(SharedMapEntries * entries, MutableEntries());
+  entries->insert_or_assign(std::move(key), std::move(value));
+  return absl::OkStatus();
+}
+
+absl::Status CopyOnWriteMapBuilder::Erase(const Handle<Value>& key) {
+  CEL_RETURN_IF_ERROR(MapValue::CheckKey(*key));
+  // Erasing a missing key doesn't modify the map.
+  if (storage_.has_value()) {
+    if (!storage_->get().contains(key)) {
+      return absl::OkStatus();
+    }
+  } else {
+    CEL_ASSIGN_OR_RETURN(Handle<Value> has, map_->Has(value_factory(), key));
+    if (!has->Is<BoolValue>() || !has->As<BoolValue>().NativeValue()) {
+      return absl::OkStatus();
+    }
+  }
+  CEL_ASSIGN_OR_RETURN(SharedMapEntries * entries, MutableEntries());
+  entries->erase(key);
+  return absl::OkStatus();
+}
+
+size_t CopyOnWriteMapBuilder::Size() const {
+  if (storage_.has_value()) {
+    return storage_->get().size();
+  }
+  return map_->Size();
+}
+
+absl::StatusOr<Handle<MapValue>> CopyOnWriteMapBuilder::Build() && {
+  if (!modified_) {
+    return std::move(map_);
+  }
+  return value_factory().CreateMapValue<SharedMapValue>(std::move(type_),
+                                                        *std::move(storage_));
+}
+
+}  // namespace cel::runtime_internal
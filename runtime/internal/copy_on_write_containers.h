@@ -0,0 +1,196 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_COPY_ON_WRITE_CONTAINERS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_COPY_ON_WRITE_CONTAINERS_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/base/nullability.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/types/list_type.h"
+#include "base/types/map_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/map_value.h"
+#include "base/values/map_value_builder.h"
+#include "internal/copy_on_write.h"
+
+namespace cel::runtime_internal {
+
+using SharedListElements = std::vector<Handle<Value>>;
+using SharedListStorage = internal::CopyOnWrite<SharedListElements>;
+
+using SharedMapEntries =
+    absl::flat_hash_map<Handle<Value>, Handle<Value>,
+                        base_internal::MapKeyHasher<Handle<Value>>,
+                        base_internal::MapKeyEqualer<Handle<Value>>>;
+using SharedMapStorage = internal::CopyOnWrite<SharedMapEntries>;
+
+// List value whose elements are shared with the CopyOnWriteListBuilders
+// created from it, and with the lists they build, until one of them is
+// modified.
+class SharedListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  SharedListValue(Handle<ListType> type, SharedListStorage storage)
+      : CEL_LIST_VALUE_CLASS(std::move(type)), storage_(std::move(storage)) {}
+
+  size_t Size() const override { return storage_.get().size(); }
+
+  bool IsEmpty() const override { return storage_.get().empty(); }
+
+  std::string DebugString() const override;
+
+  const SharedListStorage& storage() const { return storage_; }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return storage_.get()[index];
+  }
+
+ private:
+  SharedListStorage storage_;
+
+  CEL_DECLARE_LIST_VALUE(SharedListValue);
+};
+
+// Map value whose entries are shared with the CopyOnWriteMapBuilders created
+// from it, and with the maps they build, until one of them is modified.
+class SharedMapValue final : public CEL_MAP_VALUE_CLASS {
+ public:
+  SharedMapValue(Handle<MapType> type, SharedMapStorage storage)
+      : CEL_MAP_VALUE_CLASS(std::move(type)), storage_(std::move(storage)) {}
+
+  size_t Size() const override { return storage_.get().size(); }
+
+  bool IsEmpty() const override { return storage_.get().empty(); }
+
+  std::string DebugString() const override;
+
+  absl::StatusOr<Handle<ListValue>> ListKeys(
+      ValueFactory& value_factory) const override;
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory ABSL_ATTRIBUTE_LIFETIME_BOUND) const
+      ABSL_ATTRIBUTE_LIFETIME_BOUND override;
+
+  const SharedMapStorage& storage() const { return storage_; }
+
+ private:
+  absl::StatusOr<std::pair<Handle<Value>, bool>> FindImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override;
+
+  absl::StatusOr<Handle<Value>> HasImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override;
+
+  SharedMapStorage storage_;
+
+  CEL_DECLARE_MAP_VALUE(SharedMapValue);
+};
+
+// Builds a list starting from the elements of an existing list, e.g. to
+// derive a list with a few more or different elements.
+//
+// Elements of a SharedListValue are shared until the first modification,
+// which copies them only if the list is still referenced elsewhere; lists
+// built from a builder that was never modified are the original list.
+// Elements of other lists are copied on the first modification.
+class CopyOnWriteListBuilder final : public ListValueBuilderInterface {
+ public:
+  CopyOnWriteListBuilder(
+      ValueFactory& value_factory ABSL_ATTRIBUTE_LIFETIME_BOUND,
+      Handle<ListValue> list);
+
+  std::string DebugString() const override;
+
+  absl::Status Add(Handle<Value> value) override;
+
+  // Replaces the element at index, which must be less than Size().
+  absl::Status Set(size_t index, Handle<Value> value);
+
+  size_t Size() const override;
+
+  void Reserve(size_t size) override;
+
+  absl::StatusOr<Handle<ListValue>> Build() && override;
+
+ private:
+  // Returns the elements for modification, copying them if needed.
+  absl::StatusOr<SharedListElements*> MutableElements();
+
+  Handle<ListType> type_;
+  // The list, until the builder is modified.
+  Handle<ListValue> list_;
+  // The elements, once the builder is modified or if list_ is shared.
+  absl::optional<SharedListStorage> storage_;
+  // Capacity requested before the builder is modified.
+  size_t reserve_ = 0;
+  bool modified_ = false;
+};
+
+// Builds a map starting from the entries of an existing map, e.g. to merge
+// entries into it.
+//
+// Entries of a SharedMapValue are shared until the first modification, which
+// copies them only if the map is still referenced elsewhere; maps built from
+// a builder that was never modified are the original map. Entries of other
+// maps are copied on the first modification.
+class CopyOnWriteMapBuilder final : public MapValueBuilderInterface {
+ public:
+  CopyOnWriteMapBuilder(
+      ValueFactory& value_factory ABSL_ATTRIBUTE_LIFETIME_BOUND,
+      Handle<MapValue> map);
+
+  std::string DebugString() const override;
+
+  // Adds an entry, which is an error if the key is already present.
+  absl::Status Put(Handle<Value> key, Handle<Value> value) override;
+
+  // Adds an entry, replacing the value of the key if it is present.
+  absl::Status InsertOrAssign(Handle<Value> key, Handle<Value> value);
+
+  // Removes the entry of key, if any.
+  absl::Status Erase(const Handle<Value>& key);
+
+  size_t Size() const override;
+
+  absl::StatusOr<Handle<MapValue>> Build() && override;
+
+ private:
+  // Returns the entries for modification, copying them if needed.
+  absl::StatusOr<SharedMapEntries*> MutableEntries();
+
+  Handle<MapType> type_;
+  // The map, until the builder is modified.
+  Handle<MapValue> map_;
+  // The entries, once the builder is modified or if map_ is shared.
+  absl::optional<SharedMapStorage> storage_;
+  bool modified_ = false;
+};
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_COPY_ON_WRITE_CONTAINERS_H_
@@ -0,0 +1,199 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/copy_on_write_containers.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/map_value_builder.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using ::cel::internal::StatusIs;
+
+class CopyOnWriteContainersTest : public testing::Test {
+ public:
+  CopyOnWriteContainersTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  // Returns the list [0, 1, ..., size - 1].
+  Handle<ListValue> MakeIntList(int64_t size) {
+    ListValueBuilder<Value> builder(value_factory_,
+                                    type_factory_.GetDynType());
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_OK(builder.Add(value_factory_.CreateIntValue(i)));
+    }
+    return std::move(builder).Build().value();
+  }
+
+  // Returns the map {0: 0, 1: 10, ..., size - 1: (size - 1) * 10}.
+  Handle<MapValue> MakeIntMap(int64_t size) {
+    MapValueBuilder<Value, Value> builder(
+        value_factory_, type_factory_.GetDynType(), type_factory_.GetDynType());
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_OK(builder.Put(value_factory_.CreateIntValue(i),
+                            value_factory_.CreateIntValue(i * 10)));
+    }
+    return std::move(builder).Build().value();
+  }
+
+  int64_t GetInt(const Handle<MapValue>& map, int64_t key) {
+    auto value = map->Get(value_factory_, value_factory_.CreateIntValue(key));
+    EXPECT_OK(value);
+    return (*value)->As<IntValue>().NativeValue();
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(CopyOnWriteContainersTest, UnmodifiedListIsNotCopied) {
+  auto list = MakeIntList(3);
+  CopyOnWriteListBuilder builder(value_factory_, list);
+  EXPECT_EQ(builder.Size(), 3);
+  ASSERT_OK_AND_ASSIGN(auto result, std::move(builder).Build());
+  EXPECT_EQ(&*result, &*list);
+}
+
+TEST_F(CopyOnWriteContainersTest, ListCopiedOnFirstModification) {
+  auto list = MakeIntList(3);
+  CopyOnWriteListBuilder builder(value_factory_, list);
+  ASSERT_OK(builder.Add(value_factory_.CreateIntValue(3)));
+  ASSERT_OK(builder.Set(0, value_factory_.CreateIntValue(10)));
+  EXPECT_THAT(builder.Set(4, value_factory_.CreateIntValue(0)),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  ASSERT_OK_AND_ASSIGN(auto result, std::move(builder).Build());
+
+  EXPECT_TRUE(result->Is<SharedListValue>());
+  EXPECT_EQ(result->DebugString(), "[10, 1, 2, 3]");
+  EXPECT_EQ(list->DebugString(), "[0, 1, 2]");
+}
+
+TEST_F(CopyOnWriteContainersTest, ListElementsShared) {
+  CopyOnWriteListBuilder first_builder(value_factory_, MakeIntList(3));
+  ASSERT_OK(first_builder.Add(value_factory_.CreateIntValue(3)));
+  ASSERT_OK_AND_ASSIGN(auto first, std::move(first_builder).Build());
+  const auto* elements = &first->As<SharedListValue>().storage().get();
+
+  // Shared while unmodified, copied once modified since first still holds
+  // the elements.
+  CopyOnWriteListBuilder second_builder(value_factory_, first);
+  EXPECT_EQ(second_builder.DebugString(), "[0, 1, 2, 3]");
+  ASSERT_OK(second_builder.Add(value_factory_.CreateIntValue(4)));
+  ASSERT_OK_AND_ASSIGN(auto second, std::move(second_builder).Build());
+  EXPECT_NE(&second->As<SharedListValue>().storage().get(), elements);
+  EXPECT_EQ(first->DebugString(), "[0, 1, 2, 3]");
+  EXPECT_EQ(second->DebugString(), "[0, 1, 2, 3, 4]");
+
+  // Modified in place once first is only held by the builder.
+  CopyOnWriteListBuilder third_builder(value_factory_, std::move(first));
+  ASSERT_OK(third_builder.Add(value_factory_.CreateIntValue(5)));
+  ASSERT_OK_AND_ASSIGN(auto third, std::move(third_builder).Build());
+  EXPECT_EQ(&third->As<SharedListValue>().storage().get(), elements);
+  EXPECT_EQ(third->DebugString(), "[0, 1, 2, 3, 5]");
+}
+
+TEST_F(CopyOnWriteContainersTest, ListElementTypeChecked) {
+  ListValueBuilder<IntValue> int_builder(value_factory_,
+                                         type_factory_.GetIntType());
+  ASSERT_OK(int_builder.Add(value_factory_.CreateIntValue(1)));
+  ASSERT_OK_AND_ASSIGN(auto list, std::move(int_builder).Build());
+
+  CopyOnWriteListBuilder builder(value_factory_, list);
+  EXPECT_THAT(builder.Add(value_factory_.CreateBoolValue(true)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  ASSERT_OK_AND_ASSIGN(auto result, std::move(builder).Build());
+  EXPECT_EQ(&*result, &*list);
+}
+
+TEST_F(CopyOnWriteContainersTest, MapCopiedOnFirstModification) {
+  auto map = MakeIntMap(3);
+  CopyOnWriteMapBuilder builder(value_factory_, map);
+  // Erasing a missing key is not a modification.
+  ASSERT_OK(builder.Erase(value_factory_.CreateIntValue(3)));
+  EXPECT_THAT(builder.Put(value_factory_.CreateIntValue(0),
+                          value_factory_.CreateIntValue(1)),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+  ASSERT_OK(builder.InsertOrAssign(value_factory_.CreateIntValue(0),
+                                   value_factory_.CreateIntValue(1)));
+  ASSERT_OK(builder.Put(value_factory_.CreateIntValue(3),
+                        value_factory_.CreateIntValue(30)));
+  ASSERT_OK(builder.Erase(value_factory_.CreateIntValue(1)));
+  ASSERT_OK_AND_ASSIGN(auto result, std::move(builder).Build());
+
+  ASSERT_TRUE(result->Is<SharedMapValue>());
+  EXPECT_EQ(result->Size(), 3);
+  EXPECT_EQ(GetInt(result, 0), 1);
+  EXPECT_EQ(GetInt(result, 2), 20);
+  EXPECT_EQ(GetInt(result, 3), 30);
+  EXPECT_EQ(map->Size(), 3);
+  EXPECT_EQ(GetInt(map, 0), 0);
+  EXPECT_EQ(GetInt(map, 1), 10);
+}
+
+TEST_F(CopyOnWriteContainersTest, MapEntriesShared) {
+  CopyOnWriteMapBuilder first_builder(value_factory_, MakeIntMap(3));
+  ASSERT_OK(first_builder.Put(value_factory_.CreateIntValue(3),
+                              value_factory_.CreateIntValue(30)));
+  ASSERT_OK_AND_ASSIGN(auto first, std::move(first_builder).Build());
+  const auto* entries = &first->As<SharedMapValue>().storage().get();
+
+  CopyOnWriteMapBuilder unmodified(value_factory_, first);
+  ASSERT_OK(unmodified.Erase(value_factory_.CreateIntValue(4)));
+  ASSERT_OK_AND_ASSIGN(auto same, std::move(unmodified).Build());
+  EXPECT_EQ(&*same, &*first);
+  same = Handle<MapValue>();
+
+  CopyOnWriteMapBuilder second_builder(value_factory_, first);
+  ASSERT_OK(second_builder.Erase(value_factory_.CreateIntValue(0)));
+  ASSERT_OK_AND_ASSIGN(auto second, std::move(second_builder).Build());
+  EXPECT_NE(&second->As<SharedMapValue>().storage().get(), entries);
+  EXPECT_EQ(first->Size(), 4);
+  EXPECT_EQ(second->Size(), 3);
+
+  CopyOnWriteMapBuilder third_builder(value_factory_, std::move(first));
+  ASSERT_OK(third_builder.InsertOrAssign(value_factory_.CreateIntValue(0),
+                                         value_factory_.CreateIntValue(-1)));
+  ASSERT_OK_AND_ASSIGN(auto third, std::move(third_builder).Build());
+  EXPECT_EQ(&third->As<SharedMapValue>().storage().get(), entries);
+  EXPECT_EQ(GetInt(third, 0), -1);
+}
+
+TEST_F(CopyOnWriteContainersTest, MapKeyTypeChecked) {
+  CopyOnWriteMapBuilder builder(value_factory_, MakeIntMap(1));
+  EXPECT_THAT(builder.Put(value_factory_.CreateDoubleValue(1.0),
+                          value_factory_.CreateIntValue(1)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(builder.Erase(value_factory_.CreateDoubleValue(1.0)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(builder.Size(), 1);
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
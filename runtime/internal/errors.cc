@@ -13,10 +13,14 @@
 // limitations under the License.
 #include "runtime/internal/errors.h"
 
+#include <array>
+#include <cstddef>
+
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "base/builtins.h"
 
 namespace cel::runtime_internal {
 
@@ -26,6 +30,19 @@ const absl::Status* DurationOverflowError() {
   return kDurationOverflow;
 }
 
+const absl::Status* NoMatchingOverloadError(ControlFlowContext context) {
+  // Indexed by ControlFlowContext.
+  static const auto* const kErrors = new std::array<absl::Status, 6>{
+      CreateNoMatchingOverloadError("<jump_condition>"),
+      CreateNoMatchingOverloadError("<iter_range>"),
+      CreateNoMatchingOverloadError("<loop_condition>"),
+      CreateNoMatchingOverloadError(builtin::kAnd),
+      CreateNoMatchingOverloadError(builtin::kOr),
+      CreateNoMatchingOverloadError(builtin::kTernary),
+  };
+  return &(*kErrors)[static_cast<size_t>(context)];
+}
+
 absl::Status CreateNoMatchingOverloadError(absl::string_view fn) {
   return absl::UnknownError(
       absl::StrCat(kErrNoMatchingOverload, fn.empty() ? "" : " : ", fn));
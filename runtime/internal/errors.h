@@ -41,6 +41,23 @@ constexpr absl::Duration kDurationLow = absl::Seconds(-315576000001);
 
 const absl::Status* DurationOverflowError();
 
+// Constructs which raise a no matching overload error when a control flow
+// operand is not a bool or a list.
+enum class ControlFlowContext {
+  kJumpCondition,
+  kIterRange,
+  kLoopCondition,
+  kLogicalAnd,
+  kLogicalOr,
+  kTernary,
+};
+
+// Returns the no matching overload error for `context`, formatted once for the
+// lifetime of the process. These errors are frequently absorbed by `||`, `&&`
+// or `has()`, so raising them should not format a new message each time;
+// copying the returned status only takes a reference.
+const absl::Status* NoMatchingOverloadError(ControlFlowContext context);
+
 // At runtime, no matching overload could be found for a function invocation.
 absl::Status CreateNoMatchingOverloadError(absl::string_view fn);
 
@@ -0,0 +1,47 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/errors.h"
+
+#include "absl/status/status.h"
+#include "base/builtins.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using testing::Eq;
+
+TEST(NoMatchingOverloadError, MatchesFormattedError) {
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kJumpCondition),
+              Eq(CreateNoMatchingOverloadError("<jump_condition>")));
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kIterRange),
+              Eq(CreateNoMatchingOverloadError("<iter_range>")));
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kLoopCondition),
+              Eq(CreateNoMatchingOverloadError("<loop_condition>")));
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kLogicalAnd),
+              Eq(CreateNoMatchingOverloadError(builtin::kAnd)));
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kLogicalOr),
+              Eq(CreateNoMatchingOverloadError(builtin::kOr)));
+  EXPECT_THAT(*NoMatchingOverloadError(ControlFlowContext::kTernary),
+              Eq(CreateNoMatchingOverloadError(builtin::kTernary)));
+}
+
+TEST(NoMatchingOverloadError, Shared) {
+  EXPECT_THAT(NoMatchingOverloadError(ControlFlowContext::kLogicalOr),
+              Eq(NoMatchingOverloadError(ControlFlowContext::kLogicalOr)));
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
@@ -0,0 +1,230 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/indexed_list_value.h"
+
+#include <cstddef>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/casts.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/string_value.h"
+#include "base/values/uint_value.h"
+#include "internal/overloaded.h"
+#include "internal/status_macros.h"
+
+namespace cel::runtime_internal {
+
+namespace {
+
+// 2^63 and 2^64, the smallest doubles which do not fit in int64_t and
+// uint64_t respectively.
+constexpr double kInt64Limit = 9223372036854775808.0;
+constexpr double kUint64Limit = 18446744073709551616.0;
+
+}  // namespace
+
+absl::StatusOr<absl::optional<ListValueIndex>> ListValueIndex::Build(
+    ValueFactory& value_factory, const ListValue& list) {
+  ListValueIndex index;
+  std::vector<uint64_t> ints;
+  std::vector<uint64_t> uints;
+  for (size_t i = 0; i < list.Size(); ++i) {
+    CEL_ASSIGN_OR_RETURN(Handle<Value> element, list.Get(value_factory, i));
+    switch (element->kind()) {
+      case ValueKind::kNullType:
+        index.scalars_.insert(std::make_pair(ValueKind::kNullType, 0));
+        break;
+      case ValueKind::kBool:
+        index.scalars_.insert(std::make_pair(
+            ValueKind::kBool, element->As<BoolValue>().NativeValue() ? 1 : 0));
+        break;
+      case ValueKind::kInt:
+        ints.push_back(
+            absl::bit_cast<uint64_t>(element->As<IntValue>().NativeValue()));
+        break;
+      case ValueKind::kUint:
+        uints.push_back(element->As<UintValue>().NativeValue());
+        break;
+      case ValueKind::kDouble: {
+        double double_value = element->As<DoubleValue>().NativeValue();
+        // NaN is not equal to anything, including itself.
+        if (!std::isnan(double_value)) {
+          index.scalars_.insert(
+              std::make_pair(ValueKind::kDouble, DoubleKey(double_value)));
+        }
+        break;
+      }
+      case ValueKind::kString:
+        index.strings_.insert(element->As<StringValue>().ToString());
+        break;
+      default:
+        return absl::nullopt;
+    }
+  }
+  // Negative ints have their sign bit set, so a single comparison checks the
+  // bitset domain for both kinds.
+  auto add = [&index](ValueKind kind, const std::vector<uint64_t>& values,
+                      std::vector<bool>& bits) {
+    if (absl::c_all_of(values, [](uint64_t value) {
+          return value < kBitsetDomain;
+        })) {
+      if (!values.empty()) {
+        bits.resize(kBitsetDomain);
+      }
+      for (uint64_t value : values) {
+        bits[value] = true;
+      }
+      return;
+    }
+    for (uint64_t value : values) {
+      index.scalars_.insert(std::make_pair(kind, value));
+    }
+  };
+  add(ValueKind::kInt, ints, index.int_bits_);
+  add(ValueKind::kUint, uints, index.uint_bits_);
+  return index;
+}
+
+bool ListValueIndex::ContainsScalar(ValueKind kind, uint64_t bits) const {
+  if (kind == ValueKind::kInt && !int_bits_.empty()) {
+    return bits < kBitsetDomain && int_bits_[bits];
+  }
+  if (kind == ValueKind::kUint && !uint_bits_.empty()) {
+    return bits < kBitsetDomain && uint_bits_[bits];
+  }
+  return scalars_.contains(std::make_pair(kind, bits));
+}
+
+bool ListValueIndex::Contains(const Value& value, bool heterogeneous) const {
+  switch (value.kind()) {
+    case ValueKind::kNullType:
+      return ContainsScalar(ValueKind::kNullType, 0);
+    case ValueKind::kBool:
+      return ContainsScalar(ValueKind::kBool,
+                            value.As<BoolValue>().NativeValue() ? 1 : 0);
+    case ValueKind::kInt: {
+      int64_t int_value = value.As<IntValue>().NativeValue();
+      if (ContainsScalar(ValueKind::kInt,
+                         absl::bit_cast<uint64_t>(int_value))) {
+        return true;
+      }
+      if (!heterogeneous) {
+        return false;
+      }
+      if (int_value >= 0 &&
+          ContainsScalar(ValueKind::kUint, static_cast<uint64_t>(int_value))) {
+        return true;
+      }
+      double double_value = static_cast<double>(int_value);
+      return double_value < kInt64Limit &&
+             static_cast<int64_t>(double_value) == int_value &&
+             ContainsScalar(ValueKind::kDouble, DoubleKey(double_value));
+    }
+    case ValueKind::kUint: {
+      uint64_t uint_value = value.As<UintValue>().NativeValue();
+      if (ContainsScalar(ValueKind::kUint, uint_value)) {
+        return true;
+      }
+      if (!heterogeneous) {
+        return false;
+      }
+      if (uint_value <=
+              static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) &&
+          ContainsScalar(ValueKind::kInt, uint_value)) {
+        return true;
+      }
+      double double_value = static_cast<double>(uint_value);
+      return double_value < kUint64Limit &&
+             static_cast<uint64_t>(double_value) == uint_value &&
+             ContainsScalar(ValueKind::kDouble, DoubleKey(double_value));
+    }
+    case ValueKind::kDouble: {
+      double double_value = value.As<DoubleValue>().NativeValue();
+      if (std::isnan(double_value)) {
+        return false;
+      }
+      if (ContainsScalar(ValueKind::kDouble, DoubleKey(double_value))) {
+        return true;
+      }
+      if (!heterogeneous || std::trunc(double_value) != double_value) {
+        return false;
+      }
+      if (double_value >= -kInt64Limit && double_value < kInt64Limit &&
+          ContainsScalar(ValueKind::kInt,
+                         absl::bit_cast<uint64_t>(
+                             static_cast<int64_t>(double_value)))) {
+        return true;
+      }
+      return double_value >= 0 && double_value < kUint64Limit &&
+             ContainsScalar(ValueKind::kUint,
+                            static_cast<uint64_t>(double_value));
+    }
+    case ValueKind::kString:
+      return value.As<StringValue>().Visit(cel::internal::Overloaded{
+          [this](absl::string_view string) -> bool {
+            return strings_.contains(string);
+          },
+          [this](const absl::Cord& string) -> bool {
+            return strings_.contains(static_cast<std::string>(string));
+          }});
+    default:
+      // The list only holds indexable kinds, which are never equal to values
+      // of other kinds.
+      return false;
+  }
+}
+
+absl::StatusOr<Handle<ListValue>> IndexedListValue::Create(
+    ValueFactory& value_factory, Handle<ListValue> list) {
+  if (list->Size() < kMinIndexedSize) {
+    return list;
+  }
+  CEL_ASSIGN_OR_RETURN(absl::optional<ListValueIndex> index,
+                       ListValueIndex::Build(value_factory, *list));
+  if (!index.has_value()) {
+    return list;
+  }
+  Handle<ListType> type = list->type();
+  return value_factory.CreateListValue<IndexedListValue>(
+      type, std::move(list), *std::move(index));
+}
+
+IndexedListValue::IndexedListValue(const Handle<ListType>& type,
+                                   Handle<ListValue> list,
+                                   ListValueIndex index)
+    : CEL_LIST_VALUE_CLASS(type),
+      list_(std::move(list)),
+      index_(std::move(index)) {}
+
+CEL_IMPLEMENT_LIST_VALUE(IndexedListValue);
+
+}  // namespace cel::runtime_internal
@@ -0,0 +1,134 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_INDEXED_LIST_VALUE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_INDEXED_LIST_VALUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/types/list_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+
+namespace cel::runtime_internal {
+
+// Hash index over the elements of a list, answering membership tests without
+// scanning it. Only lists whose elements are all null, bool, int, uint, double
+// or string values can be indexed. Lookups follow both homogeneous and
+// heterogeneous equality, under which numbers of different kinds are equal if
+// they have the same mathematical value.
+class ListValueIndex final {
+ public:
+  // Int and uint elements in [0, kBitsetDomain) are kept in bitsets instead
+  // of the hash set if no element of that kind is outside the domain.
+  static constexpr uint64_t kBitsetDomain = uint64_t{1} << 16;
+
+  // Returns the index of list, or absl::nullopt if list holds elements which
+  // cannot be indexed.
+  static absl::StatusOr<absl::optional<ListValueIndex>> Build(
+      ValueFactory& value_factory, const ListValue& list);
+
+  ListValueIndex(ListValueIndex&&) = default;
+  ListValueIndex& operator=(ListValueIndex&&) = default;
+
+  // Returns whether the indexed list contains value. heterogeneous selects
+  // the equality semantics of RuntimeOptions::enable_heterogeneous_equality.
+  bool Contains(const Value& value, bool heterogeneous) const;
+
+ private:
+  // Null, bool, int, uint and double elements, keyed by kind and bit pattern.
+  using ScalarSet = absl::flat_hash_set<std::pair<ValueKind, uint64_t>>;
+  using StringSet = absl::flat_hash_set<std::string>;
+
+  ListValueIndex() = default;
+
+  // Key of a double element. Zero and negative zero are equal, so they share a
+  // key.
+  static uint64_t DoubleKey(double value) {
+    return absl::bit_cast<uint64_t>(value == 0 ? 0.0 : value);
+  }
+
+  bool ContainsScalar(ValueKind kind, uint64_t bits) const;
+
+  ScalarSet scalars_;
+  StringSet strings_;
+  // Bitsets over [0, kBitsetDomain) for int and uint elements, empty if not
+  // used for that kind.
+  std::vector<bool> int_bits_;
+  std::vector<bool> uint_bits_;
+};
+
+// Immutable list value with a ListValueIndex over its elements, used for
+// constant lists on the right hand side of `in` and constant arguments of the
+// sets extension functions.
+class IndexedListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  // Lists with fewer elements are scanned faster than they are hashed.
+  static constexpr size_t kMinIndexedSize = 8;
+
+  // Returns list wrapped with an index over its elements, or list itself if
+  // it is too small or holds elements which cannot be indexed.
+  static absl::StatusOr<Handle<ListValue>> Create(ValueFactory& value_factory,
+                                                  Handle<ListValue> list);
+
+  IndexedListValue(const Handle<ListType>& type, Handle<ListValue> list,
+                   ListValueIndex index);
+
+  size_t Size() const override { return list_->Size(); }
+
+  bool IsEmpty() const override { return list_->IsEmpty(); }
+
+  std::string DebugString() const override { return list_->DebugString(); }
+
+  absl::StatusOr<bool> AnyOf(ValueFactory& value_factory,
+                             AnyOfCallback cb) const override {
+    return list_->AnyOf(value_factory, cb);
+  }
+
+  // Returns whether the list contains value, or absl::nullopt if the index
+  // cannot answer and the caller must fall back to comparing each element.
+  absl::optional<bool> IndexedContains(const Value& value,
+                                       bool heterogeneous) const {
+    return index_.Contains(value, heterogeneous);
+  }
+
+  const ListValueIndex& index() const { return index_; }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return list_->Get(value_factory, index);
+  }
+
+ private:
+  Handle<ListValue> list_;
+  ListValueIndex index_;
+
+  CEL_DECLARE_LIST_VALUE(IndexedListValue);
+};
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_INDEXED_LIST_VALUE_H_
@@ -0,0 +1,194 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/indexed_list_value.h"
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "base/values/list_value_builder.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using testing::Eq;
+using testing::Optional;
+
+class IndexedListValueTest : public testing::Test {
+ public:
+  IndexedListValueTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  Handle<ListValue> MakeIntList(int64_t size) {
+    ListValueBuilder<Value> builder(value_factory_,
+                                    type_factory_.GetDynType());
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_OK(builder.Add(value_factory_.CreateIntValue(i)));
+    }
+    return std::move(builder).Build().value();
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(IndexedListValueTest, SmallListNotIndexed) {
+  ASSERT_OK_AND_ASSIGN(
+      auto list, IndexedListValue::Create(value_factory_, MakeIntList(3)));
+  EXPECT_FALSE(list->Is<IndexedListValue>());
+  EXPECT_EQ(list->Size(), 3);
+}
+
+TEST_F(IndexedListValueTest, UnindexableElementsNotIndexed) {
+  ListValueBuilder<Value> builder(value_factory_, type_factory_.GetDynType());
+  for (int64_t i = 0; i < 10; ++i) {
+    ASSERT_OK(builder.Add(value_factory_.CreateIntValue(i)));
+  }
+  ASSERT_OK(builder.Add(value_factory_.GetBytesValue()));
+  ASSERT_OK_AND_ASSIGN(auto elements, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(auto list,
+                       IndexedListValue::Create(value_factory_, elements));
+  EXPECT_FALSE(list->Is<IndexedListValue>());
+}
+
+TEST_F(IndexedListValueTest, Contains) {
+  ASSERT_OK_AND_ASSIGN(
+      auto list, IndexedListValue::Create(value_factory_, MakeIntList(10)));
+  ASSERT_TRUE(list->Is<IndexedListValue>());
+  EXPECT_EQ(list->Size(), 10);
+  ASSERT_OK_AND_ASSIGN(auto element, list->Get(value_factory_, 4));
+  EXPECT_EQ(element->As<IntValue>().NativeValue(), 4);
+
+  const auto& indexed = list->As<IndexedListValue>();
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateIntValue(7),
+                                      /*heterogeneous=*/false),
+              Optional(Eq(true)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateIntValue(70),
+                                      /*heterogeneous=*/false),
+              Optional(Eq(false)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateUintValue(7),
+                                      /*heterogeneous=*/false),
+              Optional(Eq(false)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateUintValue(7),
+                                      /*heterogeneous=*/true),
+              Optional(Eq(true)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateDoubleValue(7.0),
+                                      /*heterogeneous=*/false),
+              Optional(Eq(false)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateDoubleValue(7.0),
+                                      /*heterogeneous=*/true),
+              Optional(Eq(true)));
+  EXPECT_THAT(indexed.IndexedContains(*value_factory_.CreateDoubleValue(7.5),
+                                      /*heterogeneous=*/true),
+              Optional(Eq(false)));
+}
+
+TEST_F(IndexedListValueTest, HeterogeneousNumbers) {
+  ListValueBuilder<Value> builder(value_factory_, type_factory_.GetDynType());
+  for (int64_t i = 0; i < 8; ++i) {
+    ASSERT_OK(builder.Add(value_factory_.CreateDoubleValue(i * 0.5)));
+  }
+  ASSERT_OK(builder.Add(value_factory_.CreateDoubleValue(-0.0)));
+  ASSERT_OK(builder.Add(value_factory_.CreateUintValue(1ull << 60)));
+  ASSERT_OK(builder.Add(value_factory_.CreateIntValue((int64_t{1} << 53) + 1)));
+  ASSERT_OK_AND_ASSIGN(auto numbers, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(auto list,
+                       IndexedListValue::Create(value_factory_, numbers));
+  ASSERT_TRUE(list->Is<IndexedListValue>());
+  const auto& indexed = list->As<IndexedListValue>();
+
+  auto contains = [&](const Handle<Value>& value, bool heterogeneous) {
+    return indexed.IndexedContains(*value, heterogeneous);
+  };
+  EXPECT_THAT(contains(value_factory_.CreateDoubleValue(1.5), false),
+              Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateDoubleValue(-0.0), false),
+              Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateIntValue(3), false),
+              Optional(Eq(false)));
+  EXPECT_THAT(contains(value_factory_.CreateIntValue(3), true),
+              Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateUintValue(0), true),
+              Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateIntValue(int64_t{1} << 60), true),
+              Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateDoubleValue(0x1p60), true),
+              Optional(Eq(true)));
+  // 2^53 + 1 has no exact double representation.
+  EXPECT_THAT(contains(value_factory_.CreateDoubleValue(0x1p53), true),
+              Optional(Eq(false)));
+  EXPECT_THAT(
+      contains(value_factory_.CreateUintValue((uint64_t{1} << 53) + 1), true),
+      Optional(Eq(true)));
+  EXPECT_THAT(contains(value_factory_.CreateDoubleValue(std::nan("")), true),
+              Optional(Eq(false)));
+}
+
+TEST_F(IndexedListValueTest, IntsOutsideBitsetDomain) {
+  ListValueBuilder<Value> builder(value_factory_, type_factory_.GetDynType());
+  for (int64_t i = -5; i < 5; ++i) {
+    ASSERT_OK(builder.Add(value_factory_.CreateIntValue(i * 100000)));
+  }
+  ASSERT_OK_AND_ASSIGN(auto ints, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(absl::optional<ListValueIndex> index,
+                       ListValueIndex::Build(value_factory_, *ints));
+  ASSERT_TRUE(index.has_value());
+
+  EXPECT_TRUE(index->Contains(*value_factory_.CreateIntValue(-500000),
+                              /*heterogeneous=*/false));
+  EXPECT_TRUE(index->Contains(*value_factory_.CreateIntValue(400000),
+                              /*heterogeneous=*/false));
+  EXPECT_FALSE(index->Contains(*value_factory_.CreateIntValue(1),
+                               /*heterogeneous=*/false));
+  EXPECT_TRUE(index->Contains(*value_factory_.CreateUintValue(300000),
+                              /*heterogeneous=*/true));
+}
+
+TEST_F(IndexedListValueTest, ContainsString) {
+  ListValueBuilder<Value> builder(value_factory_, type_factory_.GetDynType());
+  for (const char* role : {"admin", "editor", "viewer", "owner", "auditor",
+                           "billing", "support", "guest"}) {
+    ASSERT_OK_AND_ASSIGN(auto value, value_factory_.CreateStringValue(role));
+    ASSERT_OK(builder.Add(std::move(value)));
+  }
+  ASSERT_OK_AND_ASSIGN(auto roles, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(auto list,
+                       IndexedListValue::Create(value_factory_, roles));
+  ASSERT_TRUE(list->Is<IndexedListValue>());
+
+  ASSERT_OK_AND_ASSIGN(auto owner, value_factory_.CreateStringValue("owner"));
+  ASSERT_OK_AND_ASSIGN(auto root, value_factory_.CreateStringValue("root"));
+  EXPECT_THAT(list->As<IndexedListValue>().IndexedContains(
+                  *owner, /*heterogeneous=*/true),
+              Optional(Eq(true)));
+  EXPECT_THAT(list->As<IndexedListValue>().IndexedContains(
+                  *root, /*heterogeneous=*/true),
+              Optional(Eq(false)));
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
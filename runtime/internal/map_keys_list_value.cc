@@ -0,0 +1,121 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/map_keys_list_value.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "base/values/map_value.h"
+#include "internal/status_macros.h"
+
+namespace cel::runtime_internal {
+
+namespace {
+
+// Adapts an iterator over the keys of a map to a list iterator.
+class MapKeysListValueIterator final : public ListValue::Iterator {
+ public:
+  explicit MapKeysListValueIterator(std::unique_ptr<MapValue::Iterator> keys)
+      : keys_(std::move(keys)) {}
+
+  bool HasNext() override { return keys_->HasNext(); }
+
+  absl::StatusOr<Handle<Value>> Next() override { return keys_->Next(); }
+
+ private:
+  std::unique_ptr<MapValue::Iterator> keys_;
+};
+
+}  // namespace
+
+absl::StatusOr<Handle<ListValue>> MapKeysListValue::Create(
+    ValueFactory& value_factory, Handle<MapValue> map) {
+  CEL_ASSIGN_OR_RETURN(auto type, value_factory.type_factory().CreateListType(
+                                      map->type()->key()));
+  return value_factory.CreateListValue<MapKeysListValue>(type, std::move(map));
+}
+
+MapKeysListValue::MapKeysListValue(const Handle<ListType>& type,
+                                   Handle<MapValue> map)
+    : CEL_LIST_VALUE_CLASS(type), map_(std::move(map)), size_(map_->Size()) {}
+
+std::string MapKeysListValue::DebugString() const {
+  // Keys can only be produced by a value factory, so describe the map instead.
+  return absl::StrCat("keys(", map_->DebugString(), ")");
+}
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<ListValue::Iterator>>>
+MapKeysListValue::NewIterator(ValueFactory& value_factory) const {
+  CEL_ASSIGN_OR_RETURN(auto keys, map_->NewIterator(value_factory));
+  return std::make_unique<MapKeysListValueIterator>(std::move(keys));
+}
+
+absl::StatusOr<bool> MapKeysListValue::AnyOf(ValueFactory& value_factory,
+                                             AnyOfCallback cb) const {
+  CEL_ASSIGN_OR_RETURN(auto keys, map_->NewIterator(value_factory));
+  while (keys->HasNext()) {
+    CEL_ASSIGN_OR_RETURN(auto key, keys->Next());
+    CEL_ASSIGN_OR_RETURN(bool condition, cb(key));
+    if (condition) {
+      return true;
+    }
+  }
+  return false;
+}
+
+absl::StatusOr<Handle<Value>> MapKeysListValue::GetImpl(
+    ValueFactory& value_factory, size_t index) const {
+  absl::MutexLock lock(&mutex_);
+  if (keys_) {
+    return keys_->Get(value_factory, index);
+  }
+  if (index + 1 == next_index_) {
+    return last_key_;
+  }
+  if (index == next_index_ &&
+      (iterator_ == nullptr || iterator_factory_ == &value_factory)) {
+    if (iterator_ == nullptr) {
+      CEL_ASSIGN_OR_RETURN(iterator_, map_->NewIterator(value_factory));
+      iterator_factory_ = &value_factory;
+    }
+    CEL_ASSIGN_OR_RETURN(last_key_, iterator_->Next());
+    ++next_index_;
+    if (next_index_ == size_) {
+      iterator_.reset();
+      iterator_factory_ = nullptr;
+    }
+    return last_key_;
+  }
+  // Out of order, or through a factory other than the iterator's, which may
+  // be gone by the time of the next access.
+  CEL_ASSIGN_OR_RETURN(keys_, map_->ListKeys(value_factory));
+  iterator_.reset();
+  iterator_factory_ = nullptr;
+  last_key_ = Handle<Value>();
+  return keys_->Get(value_factory, index);
+}
+
+CEL_IMPLEMENT_LIST_VALUE(MapKeysListValue);
+
+}  // namespace cel::runtime_internal
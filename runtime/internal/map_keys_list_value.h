@@ -0,0 +1,92 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_MAP_KEYS_LIST_VALUE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_MAP_KEYS_LIST_VALUE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/base/attributes.h"
+#include "absl/base/nullability.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "base/handle.h"
+#include "base/types/list_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "base/values/map_value.h"
+
+namespace cel::runtime_internal {
+
+// List of the keys of a map, used as the range of comprehensions over maps.
+//
+// Keys are streamed from MapValue::NewIterator as long as they are accessed
+// in order, so iterating the keys of a map does not copy them. Accessing a
+// key out of order materializes the key list with MapValue::ListKeys.
+//
+// The cursor is guarded by a mutex, as parallel comprehensions access the
+// range from several threads, each with its own value factory. The streaming
+// iterator is only advanced with the value factory it was created with;
+// accesses through another factory materialize the key list instead.
+class MapKeysListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  static absl::StatusOr<Handle<ListValue>> Create(ValueFactory& value_factory,
+                                                  Handle<MapValue> map);
+
+  MapKeysListValue(const Handle<ListType>& type, Handle<MapValue> map);
+
+  size_t Size() const override { return size_; }
+
+  bool IsEmpty() const override { return size_ == 0; }
+
+  std::string DebugString() const override;
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<Iterator>>> NewIterator(
+      ValueFactory& value_factory ABSL_ATTRIBUTE_LIFETIME_BOUND) const
+      ABSL_ATTRIBUTE_LIFETIME_BOUND override;
+
+  absl::StatusOr<bool> AnyOf(ValueFactory& value_factory,
+                             AnyOfCallback cb) const override;
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override;
+
+ private:
+  const Handle<MapValue> map_;
+  const size_t size_;
+
+  mutable absl::Mutex mutex_;
+  // Iterator over the keys of map_, positioned after the key at
+  // next_index_ - 1, which is cached in last_key_. It is created with the
+  // value factory of the first access, iterator_factory_.
+  mutable std::unique_ptr<MapValue::Iterator> iterator_
+      ABSL_GUARDED_BY(mutex_);
+  mutable const ValueFactory* iterator_factory_ ABSL_GUARDED_BY(mutex_) =
+      nullptr;
+  mutable size_t next_index_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable Handle<Value> last_key_ ABSL_GUARDED_BY(mutex_);
+  // Set once the keys have been accessed out of order.
+  mutable Handle<ListValue> keys_ ABSL_GUARDED_BY(mutex_);
+
+  CEL_DECLARE_LIST_VALUE(MapKeysListValue);
+};
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_MAP_KEYS_LIST_VALUE_H_
@@ -0,0 +1,120 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/map_keys_list_value.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "base/values/map_value_builder.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using ::cel::internal::IsOkAndHolds;
+
+constexpr int64_t kSize = 20;
+
+class MapKeysListValueTest : public testing::Test {
+ public:
+  MapKeysListValueTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+  void SetUp() override {
+    auto builder = MapValueBuilder<Value, Value>(
+        value_factory_, type_factory_.GetDynType(), type_factory_.GetDynType());
+    for (int64_t i = 0; i < kSize; ++i) {
+      ASSERT_OK(builder.Put(value_factory_.CreateIntValue(i * 10),
+                            value_factory_.CreateBoolValue(true)));
+    }
+    ASSERT_OK_AND_ASSIGN(auto map, std::move(builder).Build());
+    ASSERT_OK_AND_ASSIGN(keys_,
+                         MapKeysListValue::Create(value_factory_, map));
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+  Handle<ListValue> keys_;
+};
+
+TEST_F(MapKeysListValueTest, SequentialAccess) {
+  EXPECT_EQ(keys_->Size(), kSize);
+  for (int64_t i = 0; i < kSize; ++i) {
+    ASSERT_OK_AND_ASSIGN(auto key, keys_->Get(value_factory_, i));
+    EXPECT_EQ(key->As<IntValue>().NativeValue(), i * 10);
+    // Repeated access to the current key.
+    ASSERT_OK_AND_ASSIGN(key, keys_->Get(value_factory_, i));
+    EXPECT_EQ(key->As<IntValue>().NativeValue(), i * 10);
+  }
+}
+
+TEST_F(MapKeysListValueTest, RandomAccess) {
+  ASSERT_OK_AND_ASSIGN(auto key, keys_->Get(value_factory_, 0));
+  ASSERT_OK_AND_ASSIGN(key, keys_->Get(value_factory_, 7));
+  EXPECT_EQ(key->As<IntValue>().NativeValue(), 70);
+  ASSERT_OK_AND_ASSIGN(key, keys_->Get(value_factory_, 3));
+  EXPECT_EQ(key->As<IntValue>().NativeValue(), 30);
+}
+
+TEST_F(MapKeysListValueTest, SequentialAccessThroughOtherFactories) {
+  {
+    // Like the value factory of a parallel comprehension chunk, destroyed
+    // before the next access.
+    TypeManager type_manager(type_factory_, TypeProvider::Builtin());
+    ValueFactory chunk_factory(type_manager);
+    ASSERT_OK_AND_ASSIGN(auto key, keys_->Get(chunk_factory, 0));
+    EXPECT_EQ(key->As<IntValue>().NativeValue(), 0);
+  }
+  for (int64_t i = 1; i < kSize; ++i) {
+    ASSERT_OK_AND_ASSIGN(auto key, keys_->Get(value_factory_, i));
+    EXPECT_EQ(key->As<IntValue>().NativeValue(), i * 10);
+  }
+}
+
+TEST_F(MapKeysListValueTest, Iterate) {
+  ASSERT_OK_AND_ASSIGN(auto iterator, keys_->NewIterator(value_factory_));
+  int64_t count = 0;
+  while (iterator->HasNext()) {
+    ASSERT_OK_AND_ASSIGN(auto key, iterator->Next());
+    EXPECT_EQ(key->As<IntValue>().NativeValue(), count * 10);
+    ++count;
+  }
+  EXPECT_EQ(count, kSize);
+
+  EXPECT_THAT(
+      keys_->AnyOf(value_factory_,
+                   [](const Handle<Value>& key) -> absl::StatusOr<bool> {
+                     return key->As<IntValue>().NativeValue() == 190;
+                   }),
+      IsOkAndHolds(true));
+  ASSERT_OK_AND_ASSIGN(
+      auto contains,
+      keys_->Contains(value_factory_, value_factory_.CreateIntValue(15)));
+  EXPECT_FALSE(contains->As<BoolValue>().NativeValue());
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
@@ -19,14 +19,28 @@
 #include <string>
 #include <utility>
 
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/types/list_type.h"
 #include "base/types/opaque_type.h"
 #include "base/value.h"
 #include "base/values/list_value_builder.h"
 #include "common/native_type.h"
+#include "internal/no_destructor.h"
 
 namespace cel::runtime_internal {
 using ::cel::NativeTypeId;
 
+const cel::Handle<MutableListType>& MutableListType::Get() {
+  static const internal::NoDestructor<cel::Handle<MutableListType>> kType(
+      []() {
+        TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+        return *type_factory.CreateOpaqueType<MutableListType>();
+      }());
+  return *kType;
+}
+
 bool MutableListType::Is(const cel::Type& type) {
   return OpaqueType::Is(type) &&
          OpaqueType::TypeId(static_cast<const OpaqueType&>(type)) ==
@@ -37,6 +51,14 @@ NativeTypeId MutableListType::GetNativeTypeId() const {
   return cel::NativeTypeId::For<MutableListType>();
 }
 
+const cel::Handle<cel::ListType>& DynListType() {
+  static const internal::NoDestructor<cel::Handle<cel::ListType>> kType([]() {
+    TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+    return type_factory.GetJsonListType();
+  }());
+  return *kType;
+}
+
 MutableListValue::MutableListValue(
     cel::Handle<MutableListType> type,
     absl::Nonnull<std::unique_ptr<cel::ListValueBuilderInterface>> list_builder)
@@ -21,6 +21,7 @@
 
 #include "base/handle.h"
 #include "base/memory.h"
+#include "base/types/list_type.h"
 #include "base/types/opaque_type.h"
 #include "base/values/list_value_builder.h"
 #include "base/values/opaque_value.h"
@@ -38,6 +39,11 @@ constexpr char kMutableListTypeName[] = "#cel.MutableList";
 // and return the resulting immutable list.
 class MutableListType : public cel::OpaqueType {
  public:
+  // Returns the instance shared by all evaluations. The type holds no state,
+  // so steps resolve it while planning instead of creating one each time a
+  // list is built.
+  static const cel::Handle<MutableListType>& Get();
+
   static bool Is(const cel::Type& type);
 
   using OpaqueType::Is;
@@ -61,6 +67,10 @@ class MutableListType : public cel::OpaqueType {
   cel::NativeTypeId GetNativeTypeId() const override;
 };
 
+// Returns list(dyn), the type of the lists built by the evaluator, resolved
+// once per process.
+const cel::Handle<cel::ListType>& DynListType();
+
 // Runtime internal value type representing a list that is built from a
 // comprehension.
 // This should only be used as an optimization for the builtin comprehensions
@@ -41,6 +41,16 @@ TEST(MutableListImplType, Creation) {
   EXPECT_EQ(&opaque_type->As<MutableListType>(), &(*list_type));
 }
 
+TEST(MutableListImplType, SharedInstances) {
+  EXPECT_EQ(&*MutableListType::Get(), &*MutableListType::Get());
+  EXPECT_TRUE(MutableListType::Get()->Is<MutableListType>());
+
+  TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
+  ASSERT_OK_AND_ASSIGN(auto list_type,
+                       type_factory.CreateListType(type_factory.GetDynType()));
+  EXPECT_EQ(DynListType(), list_type);
+}
+
 TEST(MutableListImplValue, Creation) {
   TypeFactory type_factory(MemoryManagerRef::ReferenceCounting());
   TypeManager type_manager(type_factory, TypeProvider::Builtin());
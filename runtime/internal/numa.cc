@@ -0,0 +1,162 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/numa.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace cel::runtime_internal {
+
+namespace {
+
+constexpr absl::string_view kNodeDirectory = "/sys/devices/system/node";
+
+// Returns the ids listed in the sysfs file at path, or nullopt if it cannot
+// be read.
+absl::optional<std::vector<size_t>> ReadCpuList(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    return absl::nullopt;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return ParseCpuList(absl::StripAsciiWhitespace(contents.str()));
+}
+
+}  // namespace
+
+absl::optional<std::vector<size_t>> ParseCpuList(absl::string_view list) {
+  std::vector<size_t> ids;
+  if (list.empty()) {
+    return ids;
+  }
+  for (absl::string_view range : absl::StrSplit(list, ',')) {
+    std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+    size_t first;
+    size_t last;
+    if (bounds.size() > 2 || !absl::SimpleAtoi(bounds.front(), &first) ||
+        !absl::SimpleAtoi(bounds.back(), &last) || last < first) {
+      return absl::nullopt;
+    }
+    for (size_t id = first; id <= last; ++id) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+#ifdef __linux__
+namespace {
+
+// Returns the node of each CPU, indexed by CPU id, read once per process.
+// CPUs that are not listed by any node map to node 0.
+const std::vector<size_t>& CpuNodes() {
+  static const std::vector<size_t>* const cpu_nodes = []() {
+    auto* cpu_nodes = new std::vector<size_t>();
+    for (size_t node = 0; node < NumaNodeCount(); ++node) {
+      absl::optional<std::vector<size_t>> cpus = ReadCpuList(
+          absl::StrCat(kNodeDirectory, "/node", node, "/cpulist"));
+      if (!cpus.has_value()) {
+        continue;
+      }
+      for (size_t cpu : *cpus) {
+        if (cpu >= cpu_nodes->size()) {
+          cpu_nodes->resize(cpu + 1, 0);
+        }
+        (*cpu_nodes)[cpu] = node;
+      }
+    }
+    return cpu_nodes;
+  }();
+  return *cpu_nodes;
+}
+
+}  // namespace
+#endif  // __linux__
+
+size_t NumaNodeCount() {
+  static const size_t count = []() -> size_t {
+    absl::optional<std::vector<size_t>> nodes =
+        ReadCpuList(absl::StrCat(kNodeDirectory, "/online"));
+    if (!nodes.has_value() || nodes->empty()) {
+      return 1;
+    }
+    // Node ids may be sparse, ids are used as indices.
+    size_t max_node = 0;
+    for (size_t node : *nodes) {
+      max_node = std::max(max_node, node);
+    }
+    return max_node + 1;
+  }();
+  return count;
+}
+
+size_t CurrentNumaNode() {
+#ifdef __linux__
+  if (NumaNodeCount() > 1) {
+    // sched_getcpu() is served by the vDSO, without entering the kernel, and
+    // the CPU is mapped to its node with the table read from sysfs.
+    const std::vector<size_t>& cpu_nodes = CpuNodes();
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_nodes.size()) {
+      return cpu_nodes[cpu];
+    }
+  }
+#endif
+  return 0;
+}
+
+void RunOnNumaNode(size_t node, absl::FunctionRef<void()> fn) {
+  std::thread thread([node, fn]() {
+#ifdef __linux__
+    absl::optional<std::vector<size_t>> cpus = ReadCpuList(
+        absl::StrCat(kNodeDirectory, "/node", node, "/cpulist"));
+    if (cpus.has_value() && !cpus->empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (size_t cpu : *cpus) {
+        if (cpu < CPU_SETSIZE) {
+          CPU_SET(cpu, &set);
+        }
+      }
+      // Pins the calling thread only. Failure leaves it unpinned.
+      sched_setaffinity(0, sizeof(set), &set);
+    }
+#else
+    static_cast<void>(node);
+#endif
+    fn();
+  });
+  thread.join();
+}
+
+}  // namespace cel::runtime_internal
@@ -0,0 +1,51 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMA_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+
+namespace cel::runtime_internal {
+
+// Returns the number of NUMA nodes of the host, or 1 if the topology is not
+// known (including on platforms other than Linux). Read once per process.
+size_t NumaNodeCount();
+
+// Returns the NUMA node of the CPU the calling thread is running on, which is
+// always less than NumaNodeCount(). The thread may migrate right after, so the
+// result is a hint for locality only. Does not enter the kernel once the CPU
+// topology has been read, so it can be called on every evaluation.
+size_t CurrentNumaNode();
+
+// Calls fn on a new thread pinned to the CPUs of node, and waits for it to
+// return. Memory that fn allocates and touches first is then placed on node
+// by the default first-touch policy of the kernel.
+//
+// Best effort: if the thread cannot be pinned, fn still runs, unpinned.
+void RunOnNumaNode(size_t node, absl::FunctionRef<void()> fn);
+
+// Parses a Linux CPU or node list, e.g. "0-3,8,10-11", into the ids it
+// contains. Returns nullopt if list is malformed. Exposed for testing.
+absl::optional<std::vector<size_t>> ParseCpuList(absl::string_view list);
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMA_H_
@@ -0,0 +1,59 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/internal/numa.h"
+
+#include <cstddef>
+
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using testing::ElementsAre;
+using testing::Eq;
+using testing::IsEmpty;
+using testing::Lt;
+using testing::Optional;
+
+TEST(ParseCpuList, ParsesRangesAndSingleIds) {
+  EXPECT_THAT(ParseCpuList("0-3,8,10-11"),
+              Optional(ElementsAre(0, 1, 2, 3, 8, 10, 11)));
+  EXPECT_THAT(ParseCpuList("1"), Optional(ElementsAre(1)));
+  EXPECT_THAT(ParseCpuList(""), Optional(IsEmpty()));
+}
+
+TEST(ParseCpuList, RejectsMalformedLists) {
+  EXPECT_THAT(ParseCpuList("3-1"), Eq(absl::nullopt));
+  EXPECT_THAT(ParseCpuList("0-1-2"), Eq(absl::nullopt));
+  EXPECT_THAT(ParseCpuList("0,,1"), Eq(absl::nullopt));
+  EXPECT_THAT(ParseCpuList("a"), Eq(absl::nullopt));
+}
+
+TEST(Numa, CurrentNodeIsInRange) {
+  EXPECT_GE(NumaNodeCount(), 1);
+  EXPECT_THAT(CurrentNumaNode(), Lt(NumaNodeCount()));
+}
+
+TEST(Numa, RunsOnEveryNode) {
+  size_t calls = 0;
+  for (size_t node = 0; node < NumaNodeCount(); ++node) {
+    RunOnNumaNode(node, [&calls]() { ++calls; });
+  }
+  EXPECT_EQ(calls, NumaNodeCount());
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
@@ -0,0 +1,56 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/number_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/handle.h"
+#include "base/value_factory.h"
+#include "base/values/string_value.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+// The number of bytes absl::Cord stores inline, without allocating.
+constexpr size_t kMaxInlineCordSize = 15;
+
+Handle<StringValue> FromFormatted(ValueFactory& value_factory,
+                                  absl::string_view formatted) {
+  if (formatted.size() <= kMaxInlineCordSize) {
+    return value_factory.CreateUncheckedStringValue(absl::Cord(formatted));
+  }
+  return value_factory.CreateUncheckedStringValue(std::string(formatted));
+}
+
+}  // namespace
+
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, int64_t value) {
+  return FromFormatted(value_factory, absl::AlphaNum(value).Piece());
+}
+
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, uint64_t value) {
+  return FromFormatted(value_factory, absl::AlphaNum(value).Piece());
+}
+
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, double value) {
+  return FromFormatted(value_factory, absl::AlphaNum(value).Piece());
+}
+
+}  // namespace cel::runtime_internal
@@ -0,0 +1,36 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMBER_FORMAT_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMBER_FORMAT_H_
+
+#include <cstdint>
+
+#include "base/handle.h"
+#include "base/value_factory.h"
+#include "base/values/string_value.h"
+
+namespace cel::runtime_internal {
+
+// Returns the result of the standard `string()` conversion of value, formatted
+// as absl::StrCat formats it.
+//
+// The digits are formatted on the stack. Results short enough to be stored
+// inline in the value, which includes every double, don't allocate.
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, int64_t value);
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, uint64_t value);
+Handle<StringValue> FormatNumber(ValueFactory& value_factory, double value);
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_NUMBER_FORMAT_H_
@@ -0,0 +1,72 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/number_format.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "absl/strings/str_cat.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value_factory.h"
+#include "internal/testing.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+class NumberFormatTest : public testing::Test {
+ public:
+  NumberFormatTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(NumberFormatTest, Int) {
+  for (int64_t value : {int64_t{0}, int64_t{-1}, int64_t{42},
+                        std::numeric_limits<int64_t>::min(),
+                        std::numeric_limits<int64_t>::max()}) {
+    EXPECT_EQ(FormatNumber(value_factory_, value)->ToString(),
+              absl::StrCat(value));
+  }
+}
+
+TEST_F(NumberFormatTest, Uint) {
+  for (uint64_t value :
+       {uint64_t{0}, uint64_t{42}, std::numeric_limits<uint64_t>::max()}) {
+    EXPECT_EQ(FormatNumber(value_factory_, value)->ToString(),
+              absl::StrCat(value));
+  }
+}
+
+TEST_F(NumberFormatTest, Double) {
+  for (double value : {0.0, -0.0, 1.5, -2.25, 1e100, 1.0 / 3,
+                       std::numeric_limits<double>::infinity(),
+                       std::numeric_limits<double>::quiet_NaN(),
+                       std::numeric_limits<double>::lowest()}) {
+    EXPECT_EQ(FormatNumber(value_factory_, value)->ToString(),
+              absl::StrCat(value));
+  }
+}
+
+}  // namespace
+}  // namespace cel::runtime_internal
@@ -0,0 +1,353 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/internal/program_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/variant.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+
+namespace cel::runtime_internal {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Bytes;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::NullValue;
+using ::cel::ast_internal::Type;
+
+// Appends an unambiguous encoding of AST parts to a string. Every value is
+// preceded by a tag or has a fixed width, and strings are length prefixed.
+class KeyWriter {
+ public:
+  explicit KeyWriter(std::string& out) : out_(out) {}
+
+  void Tag(char tag) { out_.push_back(tag); }
+
+  void Int(int64_t value) { Raw(value); }
+
+  void Uint(uint64_t value) { Raw(value); }
+
+  void Double(double value) { Raw(value); }
+
+  void Bool(bool value) { out_.push_back(value ? '1' : '0'); }
+
+  void String(absl::string_view value) {
+    Uint(value.size());
+    out_.append(value.data(), value.size());
+  }
+
+  void WriteConstant(const Constant& constant) {
+    absl::visit(ConstantVisitor{*this}, constant.constant_kind());
+  }
+
+  // Types are shallow, so recursion is fine here unlike for expressions.
+  void WriteType(const Type& type) {
+    absl::visit(TypeVisitor{*this}, type.type_kind());
+  }
+
+  void WriteExpr(const Expr& root);
+
+ private:
+  struct ConstantVisitor {
+    void operator()(NullValue) { writer.Tag('n'); }
+    void operator()(bool value) {
+      writer.Tag('b');
+      writer.Bool(value);
+    }
+    void operator()(int64_t value) {
+      writer.Tag('i');
+      writer.Int(value);
+    }
+    void operator()(uint64_t value) {
+      writer.Tag('u');
+      writer.Uint(value);
+    }
+    void operator()(double value) {
+      writer.Tag('d');
+      writer.Double(value);
+    }
+    void operator()(const std::string& value) {
+      writer.Tag('s');
+      writer.String(value);
+    }
+    void operator()(const Bytes& value) {
+      writer.Tag('y');
+      writer.String(value.bytes);
+    }
+    void operator()(absl::Duration value) {
+      writer.Tag('D');
+      writer.Int(absl::ToInt64Nanoseconds(value));
+    }
+    void operator()(absl::Time value) {
+      writer.Tag('T');
+      writer.Int(absl::ToUnixNanos(value));
+    }
+
+    KeyWriter& writer;
+  };
+
+  struct TypeVisitor {
+    void operator()(ast_internal::DynamicType) { writer.Tag('d'); }
+    void operator()(NullValue) { writer.Tag('n'); }
+    void operator()(ast_internal::PrimitiveType type) {
+      writer.Tag('p');
+      writer.Int(static_cast<int64_t>(type));
+    }
+    void operator()(const ast_internal::PrimitiveTypeWrapper& type) {
+      writer.Tag('w');
+      writer.Int(static_cast<int64_t>(type.type()));
+    }
+    void operator()(ast_internal::WellKnownType type) {
+      writer.Tag('k');
+      writer.Int(static_cast<int64_t>(type));
+    }
+    void operator()(const ast_internal::ListType& type) {
+      writer.Tag('l');
+      writer.WriteType(type.elem_type());
+    }
+    void operator()(const ast_internal::MapType& type) {
+      writer.Tag('m');
+      writer.WriteType(type.key_type());
+      writer.WriteType(type.value_type());
+    }
+    void operator()(const ast_internal::FunctionType& type) {
+      writer.Tag('f');
+      writer.WriteType(type.result_type());
+      writer.Uint(type.arg_types().size());
+      for (const auto& arg_type : type.arg_types()) {
+        writer.WriteType(arg_type);
+      }
+    }
+    void operator()(const ast_internal::MessageType& type) {
+      writer.Tag('M');
+      writer.String(type.type());
+    }
+    void operator()(const ast_internal::ParamType& type) {
+      writer.Tag('P');
+      writer.String(type.type());
+    }
+    void operator()(const std::unique_ptr<ast_internal::Type>& type) {
+      writer.Tag('t');
+      if (type == nullptr) {
+        writer.Tag('d');
+        return;
+      }
+      writer.WriteType(*type);
+    }
+    void operator()(ast_internal::ErrorType) { writer.Tag('e'); }
+    void operator()(const ast_internal::AbstractType& type) {
+      writer.Tag('a');
+      writer.String(type.name());
+      writer.Uint(type.parameter_types().size());
+      for (const auto& parameter_type : type.parameter_types()) {
+        writer.WriteType(parameter_type);
+      }
+    }
+
+    KeyWriter& writer;
+  };
+
+  template <typename T>
+  void Raw(T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out_.append(bytes, sizeof(T));
+  }
+
+  std::string& out_;
+};
+
+// Encodes the expression in pre-order. Every node records how many children
+// follow it, so the encoding is unambiguous. Uses an explicit stack since
+// runtime ASTs are not bounded in depth.
+void KeyWriter::WriteExpr(const ast_internal::Expr& root) {
+  std::vector<const ast_internal::Expr*> stack = {&root};
+  // Children are pushed in reverse to be written in order.
+  auto push = [&stack](std::vector<const ast_internal::Expr*>& children) {
+    stack.insert(stack.end(), children.rbegin(), children.rend());
+    children.clear();
+  };
+  std::vector<const ast_internal::Expr*> children;
+  while (!stack.empty()) {
+    const ast_internal::Expr& expr = *stack.back();
+    stack.pop_back();
+    Int(expr.id());
+    if (expr.has_const_expr()) {
+      Tag('C');
+      WriteConstant(expr.const_expr());
+    } else if (expr.has_ident_expr()) {
+      Tag('I');
+      String(expr.ident_expr().name());
+    } else if (expr.has_select_expr()) {
+      const auto& select = expr.select_expr();
+      Tag('S');
+      String(select.field());
+      Bool(select.test_only());
+      children.push_back(&select.operand());
+    } else if (expr.has_call_expr()) {
+      const auto& call = expr.call_expr();
+      Tag('F');
+      String(call.function());
+      Bool(call.has_target());
+      Uint(call.args().size());
+      if (call.has_target()) {
+        children.push_back(&call.target());
+      }
+      for (const auto& arg : call.args()) {
+        children.push_back(&arg);
+      }
+    } else if (expr.has_list_expr()) {
+      const auto& list = expr.list_expr();
+      Tag('L');
+      Uint(list.elements().size());
+      Uint(list.optional_indices().size());
+      for (int32_t index : list.optional_indices()) {
+        Int(index);
+      }
+      for (const auto& element : list.elements()) {
+        children.push_back(&element);
+      }
+    } else if (expr.has_struct_expr()) {
+      const auto& create_struct = expr.struct_expr();
+      Tag('O');
+      String(create_struct.message_name());
+      Uint(create_struct.entries().size());
+      for (const auto& entry : create_struct.entries()) {
+        Int(entry.id());
+        Bool(entry.optional_entry());
+        Bool(entry.has_map_key());
+        if (entry.has_map_key()) {
+          children.push_back(&entry.map_key());
+        } else {
+          String(entry.field_key());
+        }
+        children.push_back(&entry.value());
+      }
+    } else if (expr.has_comprehension_expr()) {
+      const auto& comprehension = expr.comprehension_expr();
+      Tag('R');
+      String(comprehension.iter_var());
+      String(comprehension.accu_var());
+      children.push_back(&comprehension.iter_range());
+      children.push_back(&comprehension.accu_init());
+      children.push_back(&comprehension.loop_condition());
+      children.push_back(&comprehension.loop_step());
+      children.push_back(&comprehension.result());
+    } else {
+      Tag('U');
+    }
+    push(children);
+  }
+}
+
+template <typename V>
+std::vector<std::pair<int64_t, const V*>> SortedById(
+    const absl::flat_hash_map<int64_t, V>& map) {
+  std::vector<std::pair<int64_t, const V*>> sorted;
+  sorted.reserve(map.size());
+  for (const auto& [id, value] : map) {
+    sorted.push_back({id, &value});
+  }
+  std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.first < rhs.first;
+  });
+  return sorted;
+}
+
+}  // namespace
+
+std::string ProgramCache::Key(const AstImpl& ast) {
+  std::string key;
+  KeyWriter writer(key);
+  writer.Bool(ast.IsChecked());
+  writer.WriteExpr(ast.root_expr());
+
+  writer.Uint(ast.reference_map().size());
+  for (const auto& [id, reference] : SortedById(ast.reference_map())) {
+    writer.Int(id);
+    writer.String(reference->name());
+    writer.Uint(reference->overload_id().size());
+    for (const auto& overload_id : reference->overload_id()) {
+      writer.String(overload_id);
+    }
+    writer.Bool(reference->has_value());
+    if (reference->has_value()) {
+      writer.WriteConstant(reference->value());
+    }
+  }
+
+  writer.Uint(ast.type_map().size());
+  for (const auto& [id, type] : SortedById(ast.type_map())) {
+    writer.Int(id);
+    writer.WriteType(*type);
+  }
+  return key;
+}
+
+std::shared_ptr<const ProgramCache::Entry> ProgramCache::Lookup(
+    absl::string_view key) {
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    ++stats_.misses;
+    return nullptr;
+  }
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+std::shared_ptr<const ProgramCache::Entry> ProgramCache::Insert(
+    std::string key, std::shared_ptr<const Entry> entry) {
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+  if (max_entries_ == 0) {
+    return entry;
+  }
+  while (lru_.size() >= max_entries_) {
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+    ++stats_.evictions;
+  }
+  lru_.emplace_front(std::move(key), entry);
+  index_.insert({lru_.front().first, lru_.begin()});
+  return entry;
+}
+
+ProgramCache::Stats ProgramCache::stats() const {
+  absl::MutexLock lock(&mutex_);
+  Stats stats = stats_;
+  stats.entries = lru_.size();
+  return stats;
+}
+
+}  // namespace cel::runtime_internal
@@ -0,0 +1,94 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_PROGRAM_CACHE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_PROGRAM_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "base/ast_internal/ast_impl.h"
+#include "eval/eval/evaluator_core.h"
+#include "runtime/runtime_issue.h"
+
+namespace cel::runtime_internal {
+
+// Least recently used cache of planned programs of one runtime, so that
+// identical expressions compiled many times (e.g. by different tenants) are
+// planned once and share one FlatExpression.
+//
+// Thread-safe.
+class ProgramCache {
+ public:
+  struct Entry {
+    std::shared_ptr<const google::api::expr::runtime::FlatExpression> program;
+    // Issues reported while planning, returned again on every hit.
+    std::vector<RuntimeIssue> issues;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+  };
+
+  explicit ProgramCache(size_t max_entries) : max_entries_(max_entries) {}
+
+  ProgramCache(const ProgramCache&) = delete;
+  ProgramCache& operator=(const ProgramCache&) = delete;
+
+  // Returns the canonical encoding of the parts of ast that determine its
+  // plan: the expression, including its ids, and the references and types
+  // resolved by the type checker. Source positions and macro calls are not
+  // part of it. Options are not either, since a cache belongs to a runtime.
+  static std::string Key(const ast_internal::AstImpl& ast);
+
+  // Returns the entry for key and marks it most recently used, or nullptr.
+  std::shared_ptr<const Entry> Lookup(absl::string_view key);
+
+  // Adds entry for key, evicting the least recently used entry if the cache
+  // is full. If another thread added key meanwhile, its entry is kept and
+  // returned instead.
+  std::shared_ptr<const Entry> Insert(std::string key,
+                                      std::shared_ptr<const Entry> entry);
+
+  Stats stats() const;
+
+ private:
+  using LruList =
+      std::list<std::pair<std::string, std::shared_ptr<const Entry>>>;
+
+  const size_t max_entries_;
+  mutable absl::Mutex mutex_;
+  // Most recently used first.
+  LruList lru_ ABSL_GUARDED_BY(mutex_);
+  // Keys refer to the strings in lru_, whose nodes are stable.
+  absl::flat_hash_map<absl::string_view, LruList::iterator> index_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel::runtime_internal
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_PROGRAM_CACHE_H_
@@ -13,29 +13,54 @@
 // limitations under the License.
 #include "runtime/internal/runtime_impl.h"
 
+#include <cstddef>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
 #include "base/handle.h"
 #include "base/type_provider.h"
 #include "base/value.h"
+#include "eval/compiler/cost_estimation.h"
 #include "eval/eval/evaluator_core.h"
+#include "eval/eval/evaluator_state_pool.h"
 #include "internal/status_macros.h"
 #include "runtime/activation_interface.h"
+#include "runtime/evaluation_cost.h"
+#include "runtime/evaluation_profile.h"
+#include "runtime/internal/numa.h"
+#include "runtime/internal/program_cache.h"
+#include "runtime/referenced_attribute.h"
 #include "runtime/runtime.h"
+#include "runtime/trace_recorder.h"
 
 namespace cel::runtime_internal {
 namespace {
 
+using ::cel::ast_internal::AstImpl;
+using ::google::api::expr::runtime::EstimateCost;
+using ::google::api::expr::runtime::FlatExpression;
+
 class ProgramImpl final : public TraceableProgram {
  public:
   using EvaluationListener = TraceableProgram::EvaluationListener;
+  // replicas holds the program planned for each NUMA node, or a single
+  // program used on every node.
   ProgramImpl(
       const std::shared_ptr<const RuntimeImpl::Environment>& environment,
-      google::api::expr::runtime::FlatExpression impl)
-      : environment_(environment), impl_(std::move(impl)) {}
+      std::vector<std::shared_ptr<const FlatExpression>> replicas)
+      : environment_(environment) {
+    replicas_.reserve(replicas.size());
+    for (auto& program : replicas) {
+      replicas_.push_back(std::make_unique<Replica>(std::move(program)));
+    }
+  }
 
   absl::StatusOr<Handle<Value>> Evaluate(
       const ActivationInterface& activation,
@@ -46,18 +71,82 @@ class ProgramImpl final : public TraceableProgram {
   absl::StatusOr<Handle<Value>> Trace(
       const ActivationInterface& activation, EvaluationListener callback,
       ValueFactory& value_factory) const override {
-    auto state = impl_.MakeEvaluatorState(value_factory);
-    return impl_.EvaluateWithCallback(activation, std::move(callback), state);
+    const Replica& replica = LocalReplica();
+    auto lease = replica.state_pool.Acquire(*replica.program, value_factory);
+    return replica.program->EvaluateWithCallback(activation,
+                                                 std::move(callback),
+                                                 lease.state());
+  }
+
+  absl::StatusOr<Handle<Value>> Record(
+      const ActivationInterface& activation, TraceRecorder& recorder,
+      ValueFactory& value_factory) const override {
+    const Replica& replica = LocalReplica();
+    auto lease = replica.state_pool.Acquire(*replica.program, value_factory);
+    return replica.program->Record(activation, recorder, lease.state());
+  }
+
+  absl::StatusOr<Handle<Value>> Profile(
+      const ActivationInterface& activation, EvaluationProfile& profile,
+      ValueFactory& value_factory) const override {
+    const Replica& replica = LocalReplica();
+    auto lease = replica.state_pool.Acquire(*replica.program, value_factory);
+    return replica.program->Profile(activation, profile, lease.state());
+  }
+
+  absl::StatusOr<Handle<Value>> EvaluateWithCost(
+      const ActivationInterface& activation, EvaluationCost& cost,
+      ValueFactory& value_factory) const override {
+    const Replica& replica = LocalReplica();
+    auto lease = replica.state_pool.Acquire(*replica.program, value_factory);
+    return replica.program->EvaluateWithCost(activation, cost, lease.state());
+  }
+
+  absl::StatusOr<std::vector<Handle<Value>>> EvaluateBatch(
+      absl::Span<const ActivationInterface* const> activations,
+      ValueFactory& value_factory) const override {
+    const Replica& replica = LocalReplica();
+    auto lease = replica.state_pool.Acquire(*replica.program, value_factory);
+    return replica.program->EvaluateBatch(activations, lease.state());
   }
 
   const TypeProvider& GetTypeProvider() const override {
     return environment_->type_registry.GetComposedTypeProvider();
   }
 
+  absl::Span<const std::string> GetVariableNames() const override {
+    return replicas_.front()->program->variable_names();
+  }
+
+  absl::Span<const ReferencedAttribute> GetReferencedAttributes()
+      const override {
+    return replicas_.front()->program->referenced_attributes();
+  }
+
  private:
+  struct Replica {
+    explicit Replica(std::shared_ptr<const FlatExpression> program)
+        : program(std::move(program)) {}
+
+    // Shared with the program cache and other programs of the same AST,
+    // unless replicated.
+    std::shared_ptr<const FlatExpression> program;
+    // States are created by the threads that first evaluate on the node, so
+    // their memory is node-local too.
+    mutable google::api::expr::runtime::FlatExpressionEvaluatorStatePool
+        state_pool;
+  };
+
+  const Replica& LocalReplica() const {
+    if (replicas_.size() == 1) {
+      return *replicas_.front();
+    }
+    return *replicas_[CurrentNumaNode() % replicas_.size()];
+  }
+
   // Keep the Runtime environment alive while programs reference it.
   std::shared_ptr<const RuntimeImpl::Environment> environment_;
-  google::api::expr::runtime::FlatExpression impl_;
+  std::vector<std::unique_ptr<Replica>> replicas_;
 };
 
 }  // namespace
@@ -72,10 +161,95 @@ absl::StatusOr<std::unique_ptr<TraceableProgram>>
 RuntimeImpl::CreateTraceableProgram(
     std::unique_ptr<Ast> ast,
     const Runtime::CreateProgramOptions& options) const {
-  CEL_ASSIGN_OR_RETURN(auto flat_expr, expr_builder_.CreateExpressionImpl(
-                                           std::move(ast), options.issues));
+  if (options.cost_estimate != nullptr) {
+    // Estimated before planning, which consumes the AST.
+    *options.cost_estimate = EstimateCost(AstImpl::CastFromPublicAst(*ast),
+                                          options.cost_estimate_options);
+  }
 
-  return std::make_unique<ProgramImpl>(environment_, std::move(flat_expr));
+  const size_t node_count =
+      expr_builder_.options().enable_numa_replication ? NumaNodeCount() : 1;
+  std::shared_ptr<const FlatExpression> program;
+  std::vector<std::shared_ptr<const FlatExpression>> replicas;
+  if (node_count > 1) {
+    CEL_ASSIGN_OR_RETURN(replicas,
+                         PlanNumaReplicas(std::move(ast), options, node_count));
+    program = replicas.front();
+  } else if (program_cache_ == nullptr || options.profile != nullptr) {
+    CEL_ASSIGN_OR_RETURN(auto flat_expr,
+                         expr_builder_.CreateExpressionImpl(
+                             std::move(ast), options.issues,
+                             options.planner_stats, options.profile,
+                             options.metrics_label));
+    program = std::make_shared<const FlatExpression>(std::move(flat_expr));
+  } else {
+    std::string key = ProgramCache::Key(AstImpl::CastFromPublicAst(*ast));
+    // Keys are prefix-free, so appending the label keeps them unique.
+    key.append(options.metrics_label);
+    std::shared_ptr<const ProgramCache::Entry> entry =
+        program_cache_->Lookup(key);
+    if (entry == nullptr) {
+      auto new_entry = std::make_shared<ProgramCache::Entry>();
+      // Failures are not cached, they are expected to be rare and not
+      // repeated.
+      CEL_ASSIGN_OR_RETURN(auto flat_expr,
+                           expr_builder_.CreateExpressionImpl(
+                               std::move(ast), &new_entry->issues,
+                               options.planner_stats, /*profile=*/nullptr,
+                               options.metrics_label));
+      new_entry->program =
+          std::make_shared<const FlatExpression>(std::move(flat_expr));
+      entry = program_cache_->Insert(std::move(key), std::move(new_entry));
+    }
+    if (options.issues != nullptr) {
+      *options.issues = entry->issues;
+    }
+    program = entry->program;
+    if (options.planner_stats != nullptr) {
+      options.planner_stats->program_steps = program->path().size();
+      options.planner_stats->program_bytes = program->ResidentSize();
+    }
+  }
+
+  if (options.cost_estimate != nullptr) {
+    options.cost_estimate->plan_size = program->path().size();
+  }
+  if (replicas.empty()) {
+    replicas.push_back(std::move(program));
+  }
+  return std::make_unique<ProgramImpl>(environment_, std::move(replicas));
+}
+
+absl::StatusOr<std::vector<std::shared_ptr<const FlatExpression>>>
+RuntimeImpl::PlanNumaReplicas(std::unique_ptr<Ast> ast,
+                              const Runtime::CreateProgramOptions& options,
+                              size_t node_count) const {
+  const AstImpl& ast_impl = AstImpl::CastFromPublicAst(*ast);
+  std::vector<std::shared_ptr<const FlatExpression>> replicas(node_count);
+  for (size_t node = 0; node < node_count; ++node) {
+    // Planning consumes the AST, so every node but the last plans a copy.
+    std::unique_ptr<Ast> node_ast =
+        node + 1 < node_count ? std::make_unique<AstImpl>(ast_impl.DeepCopy())
+                              : std::move(ast);
+    // The replicas are planned from the same AST, so issues and planner
+    // statistics are only reported for the first one.
+    const bool report = node == 0;
+    absl::Status status;
+    RunOnNumaNode(node, [&]() {
+      auto flat_expr = expr_builder_.CreateExpressionImpl(
+          std::move(node_ast), report ? options.issues : nullptr,
+          report ? options.planner_stats : nullptr, options.profile,
+          options.metrics_label);
+      if (!flat_expr.ok()) {
+        status = flat_expr.status();
+        return;
+      }
+      replicas[node] =
+          std::make_shared<const FlatExpression>(*std::move(flat_expr));
+    });
+    CEL_RETURN_IF_ERROR(status);
+  }
+  return replicas;
 }
 
 }  // namespace cel::runtime_internal
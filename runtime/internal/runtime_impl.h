@@ -15,13 +15,18 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_RUNTIME_IMPL_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_INTERNAL_RUNTIME_IMPL_H_
 
+#include <cstddef>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/status/statusor.h"
 #include "base/ast.h"
 #include "base/type_provider.h"
 #include "common/native_type.h"
 #include "eval/compiler/flat_expr_builder.h"
+#include "eval/eval/evaluator_core.h"
+#include "runtime/internal/program_cache.h"
 #include "runtime/function_registry.h"
 #include "runtime/runtime.h"
 #include "runtime/runtime_options.h"
@@ -32,6 +37,14 @@ namespace cel::runtime_internal {
 class RuntimeImpl : public Runtime {
  public:
   struct Environment {
+    Environment() = default;
+    explicit Environment(std::shared_ptr<const FunctionRegistry> base_functions)
+        : function_registry(std::move(base_functions)) {}
+    Environment(std::shared_ptr<const FunctionRegistry> base_functions,
+                std::shared_ptr<const TypeRegistry> base_types)
+        : type_registry(std::move(base_types)),
+          function_registry(std::move(base_functions)) {}
+
     TypeRegistry type_registry;
     FunctionRegistry function_registry;
   };
@@ -41,6 +54,23 @@ class RuntimeImpl : public Runtime {
         expr_builder_(environment_->function_registry,
                       environment_->type_registry, options) {}
 
+  // The function registry of the runtime is layered on top of base_functions.
+  RuntimeImpl(const RuntimeOptions& options,
+              std::shared_ptr<const FunctionRegistry> base_functions)
+      : environment_(std::make_shared<Environment>(std::move(base_functions))),
+        expr_builder_(environment_->function_registry,
+                      environment_->type_registry, options) {}
+
+  // The function and type registries of the runtime are layered on top of
+  // base_functions and base_types.
+  RuntimeImpl(const RuntimeOptions& options,
+              std::shared_ptr<const FunctionRegistry> base_functions,
+              std::shared_ptr<const TypeRegistry> base_types)
+      : environment_(std::make_shared<Environment>(std::move(base_functions),
+                                                   std::move(base_types))),
+        expr_builder_(environment_->function_registry,
+                      environment_->type_registry, options) {}
+
   TypeRegistry& type_registry() { return environment_->type_registry; }
   const TypeRegistry& type_registry() const {
     return environment_->type_registry;
@@ -66,21 +96,51 @@ class RuntimeImpl : public Runtime {
     return environment_->type_registry.GetComposedTypeProvider();
   }
 
+  // The registries of the runtime, kept alive by the returned pointer.
+  std::shared_ptr<const Environment> environment() const {
+    return environment_;
+  }
+
   // exposed for extensions access
   google::api::expr::runtime::FlatExprBuilder& expr_builder() {
     return expr_builder_;
   }
 
+  // Caches planned programs by their AST, so that compiling an identical
+  // expression again shares the earlier program. Must be called before the
+  // runtime is used.
+  void EnableProgramCache(size_t max_entries) {
+    program_cache_ = std::make_unique<ProgramCache>(max_entries);
+  }
+
+  // nullptr unless the program cache is enabled.
+  const ProgramCache* program_cache() const { return program_cache_.get(); }
+
+  // Whether the runtime plans merged program sets (see
+  // cel::extensions::EnableProgramSets).
+  void set_program_sets_enabled() { program_sets_enabled_ = true; }
+  bool program_sets_enabled() const { return program_sets_enabled_; }
+
  private:
   NativeTypeId GetNativeTypeId() const override {
     return NativeTypeId::For<RuntimeImpl>();
   }
+
+  // Plans ast once per NUMA node, on a thread pinned to the node, and returns
+  // the programs indexed by node.
+  absl::StatusOr<std::vector<
+      std::shared_ptr<const google::api::expr::runtime::FlatExpression>>>
+  PlanNumaReplicas(std::unique_ptr<Ast> ast,
+                   const Runtime::CreateProgramOptions& options,
+                   size_t node_count) const;
   // Note: this is mutable, but should only be accessed in a const context after
   // building is complete.
   //
   // This is used to keep alive the registries while programs reference them.
   std::shared_ptr<Environment> environment_;
   google::api::expr::runtime::FlatExprBuilder expr_builder_;
+  std::unique_ptr<ProgramCache> program_cache_;
+  bool program_sets_enabled_ = false;
 };
 
 }  // namespace cel::runtime_internal
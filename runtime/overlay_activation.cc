@@ -0,0 +1,51 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/overlay_activation.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+
+namespace cel {
+
+absl::StatusOr<absl::optional<Handle<Value>>> OverlayActivation::FindVariable(
+    ValueFactory& factory, absl::string_view name) const {
+  for (const auto& entry : values_) {
+    if (entry.first == name) {
+      return entry.second;
+    }
+  }
+  return base_.FindVariable(factory, name);
+}
+
+bool OverlayActivation::InsertOrAssignValue(absl::string_view name,
+                                            Handle<Value> value) {
+  for (auto& entry : values_) {
+    if (entry.first == name) {
+      entry.second = std::move(value);
+      return false;
+    }
+  }
+  values_.emplace_back(std::string(name), std::move(value));
+  return true;
+}
+
+}  // namespace cel
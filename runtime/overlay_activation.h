@@ -0,0 +1,107 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_OVERLAY_ACTIVATION_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_OVERLAY_ACTIVATION_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/inlined_vector.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/function_overload_reference.h"
+
+namespace cel {
+
+// Activation which binds a few variables on top of a base activation.
+//
+// Intended for per-request variables layered over a large activation that is
+// built once and shared, e.g. per tenant. The base is not copied or modified,
+// so one base may back overlays on several threads as long as it is no longer
+// mutated. Variables are kept inline and searched linearly, so an overlay with
+// a handful of variables does not allocate.
+//
+// Variables of the overlay shadow those of the base. Functions and, unless
+// set on the overlay, unknown and missing attribute patterns come from the
+// base.
+class OverlayActivation final : public ActivationInterface {
+ public:
+  // base must outlive the overlay.
+  explicit OverlayActivation(const ActivationInterface& base) : base_(base) {}
+
+  // Implements ActivationInterface.
+  absl::StatusOr<absl::optional<Handle<Value>>> FindVariable(
+      ValueFactory& factory, absl::string_view name) const override;
+
+  std::vector<FunctionOverloadReference> FindFunctionOverloads(
+      absl::string_view name) const override {
+    return base_.FindFunctionOverloads(name);
+  }
+
+  absl::Span<const cel::AttributePattern> GetUnknownAttributes()
+      const override {
+    if (unknown_patterns_.has_value()) {
+      return *unknown_patterns_;
+    }
+    return base_.GetUnknownAttributes();
+  }
+
+  absl::Span<const cel::AttributePattern> GetMissingAttributes()
+      const override {
+    if (missing_patterns_.has_value()) {
+      return *missing_patterns_;
+    }
+    return base_.GetMissingAttributes();
+  }
+
+  FunctionResultStore* GetFunctionResultStore() const override {
+    return base_.GetFunctionResultStore();
+  }
+
+  // Bind a value to a named variable, shadowing any binding in the base.
+  //
+  // Returns false if the entry for name in the overlay was overwritten.
+  bool InsertOrAssignValue(absl::string_view name, Handle<Value> value);
+
+  // Replaces the unknown patterns of the base for evaluations using the
+  // overlay.
+  void SetUnknownPatterns(std::vector<cel::AttributePattern> patterns) {
+    unknown_patterns_ = std::move(patterns);
+  }
+
+  // Replaces the missing patterns of the base for evaluations using the
+  // overlay.
+  void SetMissingPatterns(std::vector<cel::AttributePattern> patterns) {
+    missing_patterns_ = std::move(patterns);
+  }
+
+ private:
+  const ActivationInterface& base_;
+  absl::InlinedVector<std::pair<std::string, Handle<Value>>, 4> values_;
+  absl::optional<std::vector<cel::AttributePattern>> unknown_patterns_;
+  absl::optional<std::vector<cel::AttributePattern>> missing_patterns_;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_OVERLAY_ACTIVATION_H_
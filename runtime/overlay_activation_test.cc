@@ -0,0 +1,139 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/overlay_activation.h"
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/attribute.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "base/values/null_value.h"
+#include "internal/testing.h"
+#include "runtime/activation.h"
+
+namespace cel {
+namespace {
+
+using cel::internal::IsOkAndHolds;
+using testing::IsEmpty;
+using testing::Optional;
+using testing::SizeIs;
+
+MATCHER_P(IsIntValue, x, absl::StrCat("is IntValue Handle with value ", x)) {
+  const Handle<Value>& handle = arg;
+
+  return handle->Is<IntValue>() && handle.As<IntValue>()->NativeValue() == x;
+}
+
+class NullFunction : public cel::Function {
+ public:
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& ctx,
+      absl::Span<const Handle<Value>> args) const override {
+    return Handle<NullValue>();
+  }
+};
+
+class OverlayActivationTest : public testing::Test {
+ public:
+  OverlayActivationTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {}
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+};
+
+TEST_F(OverlayActivationTest, ShadowsBase) {
+  Activation base;
+  base.InsertOrAssignValue("tenant", value_factory_.CreateIntValue(1));
+  base.InsertOrAssignValue("request", value_factory_.CreateIntValue(2));
+
+  OverlayActivation overlay(base);
+  EXPECT_TRUE(overlay.InsertOrAssignValue(
+      "request", value_factory_.CreateIntValue(3)));
+  EXPECT_FALSE(overlay.InsertOrAssignValue(
+      "request", value_factory_.CreateIntValue(4)));
+
+  EXPECT_THAT(overlay.FindVariable(value_factory_, "tenant"),
+              IsOkAndHolds(Optional(IsIntValue(1))));
+  EXPECT_THAT(overlay.FindVariable(value_factory_, "request"),
+              IsOkAndHolds(Optional(IsIntValue(4))));
+  EXPECT_THAT(overlay.FindVariable(value_factory_, "missing"),
+              IsOkAndHolds(absl::nullopt));
+  // The base is unchanged.
+  EXPECT_THAT(base.FindVariable(value_factory_, "request"),
+              IsOkAndHolds(Optional(IsIntValue(2))));
+}
+
+TEST_F(OverlayActivationTest, Stacks) {
+  Activation base;
+  base.InsertOrAssignValue("a", value_factory_.CreateIntValue(1));
+  OverlayActivation middle(base);
+  middle.InsertOrAssignValue("b", value_factory_.CreateIntValue(2));
+  OverlayActivation top(middle);
+  top.InsertOrAssignValue("a", value_factory_.CreateIntValue(3));
+
+  EXPECT_THAT(top.FindVariable(value_factory_, "a"),
+              IsOkAndHolds(Optional(IsIntValue(3))));
+  EXPECT_THAT(top.FindVariable(value_factory_, "b"),
+              IsOkAndHolds(Optional(IsIntValue(2))));
+}
+
+TEST_F(OverlayActivationTest, FunctionsFromBase) {
+  Activation base;
+  ASSERT_TRUE(base.InsertFunction(
+      FunctionDescriptor("fn", false, {Kind::kInt}),
+      std::make_unique<NullFunction>()));
+  OverlayActivation overlay(base);
+
+  EXPECT_THAT(overlay.FindFunctionOverloads("fn"), SizeIs(1));
+  EXPECT_THAT(overlay.FindFunctionOverloads("other"), IsEmpty());
+}
+
+TEST_F(OverlayActivationTest, Patterns) {
+  Activation base;
+  base.SetUnknownPatterns({AttributePattern("base", {})});
+  base.SetMissingPatterns({AttributePattern("base", {})});
+  OverlayActivation overlay(base);
+
+  EXPECT_THAT(overlay.GetUnknownAttributes(), SizeIs(1));
+  EXPECT_THAT(overlay.GetMissingAttributes(), SizeIs(1));
+
+  overlay.SetUnknownPatterns({});
+  overlay.SetMissingPatterns(
+      {AttributePattern("a", {}), AttributePattern("b", {})});
+  EXPECT_THAT(overlay.GetUnknownAttributes(), IsEmpty());
+  EXPECT_THAT(overlay.GetMissingAttributes(), SizeIs(2));
+  EXPECT_THAT(base.GetMissingAttributes(), SizeIs(1));
+}
+
+}  // namespace
+}  // namespace cel
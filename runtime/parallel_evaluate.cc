@@ -0,0 +1,135 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/parallel_evaluate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "runtime/activation_interface.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace {
+
+class ParallelBatch {
+ public:
+  ParallelBatch(const Program& program,
+                absl::Span<const ActivationInterface* const> activations,
+                MemoryManagerRef memory_manager, size_t chunk_size)
+      : program_(program),
+        activations_(activations),
+        memory_manager_(memory_manager),
+        chunk_size_(chunk_size),
+        results_(activations.size()) {}
+
+  // Claims and evaluates chunks until the batch is exhausted or fails.
+  void RunWorker() {
+    ManagedValueFactory value_factory(program_.GetTypeProvider(),
+                                      memory_manager_);
+    while (!failed_.load(std::memory_order_relaxed)) {
+      size_t start = next_.fetch_add(chunk_size_, std::memory_order_relaxed);
+      if (start >= activations_.size()) {
+        return;
+      }
+      size_t count = std::min(chunk_size_, activations_.size() - start);
+      absl::StatusOr<std::vector<Handle<Value>>> chunk =
+          program_.EvaluateBatch(activations_.subspan(start, count),
+                                 value_factory.get());
+      if (!chunk.ok()) {
+        Fail(std::move(chunk).status());
+        return;
+      }
+      std::move(chunk->begin(), chunk->end(), results_.begin() + start);
+    }
+  }
+
+  absl::StatusOr<std::vector<Handle<Value>>> Finish() && {
+    absl::MutexLock lock(&mutex_);
+    if (!status_.ok()) {
+      return std::move(status_);
+    }
+    return std::move(results_);
+  }
+
+ private:
+  void Fail(absl::Status status) {
+    failed_.store(true, std::memory_order_relaxed);
+    absl::MutexLock lock(&mutex_);
+    if (status_.ok()) {
+      status_ = std::move(status);
+    }
+  }
+
+  const Program& program_;
+  absl::Span<const ActivationInterface* const> activations_;
+  MemoryManagerRef memory_manager_;
+  const size_t chunk_size_;
+  // Workers write disjoint ranges, so results need no locking.
+  std::vector<Handle<Value>> results_;
+  std::atomic<size_t> next_{0};
+  std::atomic<bool> failed_{false};
+  absl::Mutex mutex_;
+  absl::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace
+
+absl::StatusOr<std::vector<Handle<Value>>> ParallelEvaluate(
+    const Program& program,
+    absl::Span<const ActivationInterface* const> activations,
+    MemoryManagerRef memory_manager, ParallelEvaluateScheduler schedule,
+    const ParallelEvaluateOptions& options) {
+  if (options.max_parallelism < 1 || options.chunk_size == 0) {
+    return absl::InvalidArgumentError(
+        "ParallelEvaluate requires max_parallelism >= 1 and chunk_size > 0");
+  }
+  size_t chunks =
+      (activations.size() + options.chunk_size - 1) / options.chunk_size;
+  size_t workers =
+      std::min(static_cast<size_t>(options.max_parallelism), chunks);
+
+  ParallelBatch batch(program, activations, memory_manager,
+                      options.chunk_size);
+  if (workers > 1) {
+    absl::BlockingCounter pending(static_cast<int>(workers - 1));
+    for (size_t i = 1; i < workers; ++i) {
+      schedule([&batch, &pending]() {
+        batch.RunWorker();
+        pending.DecrementCount();
+      });
+    }
+    batch.RunWorker();
+    pending.Wait();
+  } else {
+    batch.RunWorker();
+  }
+  return std::move(batch).Finish();
+}
+
+}  // namespace cel
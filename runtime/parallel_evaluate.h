@@ -0,0 +1,69 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_PARALLEL_EVALUATE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_PARALLEL_EVALUATE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+struct ParallelEvaluateOptions {
+  // Upper bound on the number of concurrent workers, including the calling
+  // thread.
+  int max_parallelism = 8;
+
+  // Number of consecutive activations a worker claims at a time. Workers that
+  // finish early keep claiming chunks, so uneven rows balance across the
+  // pool.
+  size_t chunk_size = 16;
+};
+
+// Schedules a task on a caller owned executor. Every scheduled task must
+// eventually run; ParallelEvaluate blocks until all of them complete.
+using ParallelEvaluateScheduler =
+    absl::FunctionRef<void(absl::AnyInvocable<void()>)>;
+
+// Evaluate program once per activation, splitting the batch across workers
+// started with schedule. The calling thread participates as one worker.
+//
+// Each worker uses a private value factory (and type manager) bound to
+// memory_manager and evaluates its chunks with Program::EvaluateBatch, so
+// workers do not share mutable evaluation state. memory_manager must be safe
+// to use from multiple threads; both the reference counting and the
+// protobuf arena memory managers are.
+//
+// Results are returned in activation order. If any activation produces a
+// non-ok status, remaining chunks are skipped and one such status is
+// returned.
+absl::StatusOr<std::vector<Handle<Value>>> ParallelEvaluate(
+    const Program& program,
+    absl::Span<const ActivationInterface* const> activations,
+    MemoryManagerRef memory_manager, ParallelEvaluateScheduler schedule,
+    const ParallelEvaluateOptions& options = ParallelEvaluateOptions());
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_PARALLEL_EVALUATE_H_
@@ -0,0 +1,180 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/parallel_evaluate.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "runtime/activation.h"
+#include "runtime/activation_interface.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+namespace {
+
+using testing::HasSubstr;
+using cel::internal::StatusIs;
+
+MATCHER_P(IsIntValue, x, absl::StrCat("is IntValue Handle with value ", x)) {
+  const Handle<Value>& handle = arg;
+
+  return handle->Is<IntValue>() && handle.As<IntValue>()->NativeValue() == x;
+}
+
+// Program computing `x * 2`. Fails if x is missing.
+class DoubleXProgram : public Program {
+ public:
+  absl::StatusOr<Handle<Value>> Evaluate(
+      const ActivationInterface& activation,
+      ValueFactory& value_factory) const override {
+    CEL_ASSIGN_OR_RETURN(auto x, activation.FindVariable(value_factory, "x"));
+    if (!x.has_value()) {
+      return absl::NotFoundError("x");
+    }
+    return value_factory.CreateIntValue((*x)->As<IntValue>().NativeValue() *
+                                        2);
+  }
+
+  const TypeProvider& GetTypeProvider() const override {
+    return TypeProvider::Builtin();
+  }
+};
+
+// Runs each scheduled task on a new thread, joined on destruction.
+class ThreadScheduler {
+ public:
+  ~ThreadScheduler() {
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Schedule(absl::AnyInvocable<void()> task) {
+    threads_.emplace_back(std::move(task));
+  }
+
+  auto AsFunction() {
+    return [this](absl::AnyInvocable<void()> task) {
+      Schedule(std::move(task));
+    };
+  }
+
+  size_t scheduled() const { return threads_.size(); }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
+class ParallelEvaluateTest : public testing::Test {
+ protected:
+  // Binds x to the row index, except for row `missing`.
+  void MakeActivations(int n, int missing = -1) {
+    activations_ = std::vector<Activation>(n);
+    batch_.clear();
+    for (int i = 0; i < n; ++i) {
+      if (i != missing) {
+        activations_[i].InsertOrAssignValue(
+            "x", value_factory_.CreateIntValue(i));
+      }
+      batch_.push_back(&activations_[i]);
+    }
+  }
+
+  ManagedValueFactory managed_value_factory_{
+      TypeProvider::Builtin(), MemoryManagerRef::ReferenceCounting()};
+  ValueFactory& value_factory_ = managed_value_factory_.get();
+  std::vector<Activation> activations_;
+  std::vector<const ActivationInterface*> batch_;
+  DoubleXProgram program_;
+};
+
+TEST_F(ParallelEvaluateTest, EvaluatesInOrder) {
+  MakeActivations(1000);
+  ThreadScheduler scheduler;
+  ParallelEvaluateOptions options;
+  options.max_parallelism = 4;
+  options.chunk_size = 7;
+
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      ParallelEvaluate(program_, batch_, MemoryManagerRef::ReferenceCounting(),
+                       scheduler.AsFunction(), options));
+
+  EXPECT_EQ(scheduler.scheduled(), 3);
+  ASSERT_EQ(results.size(), 1000);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_THAT(results[i], IsIntValue(i * 2));
+  }
+}
+
+TEST_F(ParallelEvaluateTest, SmallBatchRunsInline) {
+  MakeActivations(3);
+  ThreadScheduler scheduler;
+  ParallelEvaluateOptions options;
+  options.chunk_size = 16;
+
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      ParallelEvaluate(program_, batch_, MemoryManagerRef::ReferenceCounting(),
+                       scheduler.AsFunction(), options));
+
+  EXPECT_EQ(scheduler.scheduled(), 0);
+  ASSERT_EQ(results.size(), 3);
+  EXPECT_THAT(results[2], IsIntValue(4));
+}
+
+TEST_F(ParallelEvaluateTest, PropagatesErrors) {
+  MakeActivations(100, /*missing=*/57);
+  ThreadScheduler scheduler;
+  ParallelEvaluateOptions options;
+  options.max_parallelism = 4;
+  options.chunk_size = 5;
+
+  EXPECT_THAT(
+      ParallelEvaluate(program_, batch_, MemoryManagerRef::ReferenceCounting(),
+                       scheduler.AsFunction(), options),
+      StatusIs(absl::StatusCode::kNotFound, HasSubstr("x")));
+}
+
+TEST_F(ParallelEvaluateTest, InvalidOptions) {
+  MakeActivations(1);
+  ThreadScheduler scheduler;
+  ParallelEvaluateOptions options;
+  options.chunk_size = 0;
+
+  EXPECT_THAT(
+      ParallelEvaluate(program_, batch_, MemoryManagerRef::ReferenceCounting(),
+                       scheduler.AsFunction(), options),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace cel
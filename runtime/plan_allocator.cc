@@ -0,0 +1,180 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/plan_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace cel {
+
+namespace {
+
+// Size of a transparent huge page on x86-64 and of the default explicit huge
+// page on most Linux configurations.
+constexpr size_t kRegionSize = 2 * 1024 * 1024;
+constexpr size_t kLargeBlockSize = kRegionSize / 4;
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+size_t RoundUp(size_t n, size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+size_t PageSize() {
+#ifdef __linux__
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page_size;
+#else
+  return 4096;
+#endif
+}
+
+}  // namespace
+
+HugePageAllocator::HugePageAllocator(HugePageMode mode) : mode_(mode) {}
+
+HugePageAllocator::~HugePageAllocator() {
+  absl::MutexLock lock(&mutex_);
+  for (const Region& region : regions_) {
+    UnmapRegion(region);
+  }
+}
+
+void* HugePageAllocator::Allocate(size_t size) {
+  absl::MutexLock lock(&mutex_);
+  if (size > kLargeBlockSize) {
+    Region region = MapRegion(LargeBlockSize(size));
+    large_blocks_[region.data] = region;
+    stats_.allocated_bytes += region.size;
+    return region.data;
+  }
+  size = RoundUp(size == 0 ? 1 : size, kAlignment);
+  stats_.allocated_bytes += size;
+  if (auto it = free_lists_.find(size);
+      it != free_lists_.end() && !it->second.empty()) {
+    void* ptr = it->second.back();
+    it->second.pop_back();
+    return ptr;
+  }
+  if (remaining_ < size) {
+    // The tail of the previous region is abandoned; it is smaller than the
+    // largest shared block.
+    Region region = MapRegion(kRegionSize);
+    regions_.push_back(region);
+    next_ = static_cast<char*>(region.data);
+    remaining_ = region.size;
+  }
+  void* ptr = next_;
+  next_ += size;
+  remaining_ -= size;
+  return ptr;
+}
+
+void HugePageAllocator::Deallocate(void* ptr, size_t size) {
+  absl::MutexLock lock(&mutex_);
+  if (size > kLargeBlockSize) {
+    auto it = large_blocks_.find(ptr);
+    if (it == large_blocks_.end()) {
+      ABSL_LOG(FATAL) << "deallocating unknown plan block";
+    }
+    stats_.allocated_bytes -= it->second.size;
+    UnmapRegion(it->second);
+    large_blocks_.erase(it);
+    return;
+  }
+  size = RoundUp(size == 0 ? 1 : size, kAlignment);
+  stats_.allocated_bytes -= size;
+  free_lists_[size].push_back(ptr);
+}
+
+PlanAllocator::Stats HugePageAllocator::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+size_t HugePageAllocator::LargeBlockSize(size_t size) const {
+  return RoundUp(size, mode_ == HugePageMode::kNone ? PageSize() : kRegionSize);
+}
+
+HugePageAllocator::Region HugePageAllocator::MapRegion(size_t size) {
+  Region region{nullptr, size, false};
+#ifdef __linux__
+  constexpr int kProtection = PROT_READ | PROT_WRITE;
+  constexpr int kFlags = MAP_PRIVATE | MAP_ANONYMOUS;
+  if (mode_ == HugePageMode::kExplicit) {
+    void* data = mmap(nullptr, size, kProtection, kFlags | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      region.data = data;
+      region.huge_pages = true;
+    }
+  }
+  if (region.data == nullptr && mode_ == HugePageMode::kNone) {
+    void* data = mmap(nullptr, size, kProtection, kFlags, -1, 0);
+    if (data != MAP_FAILED) {
+      region.data = data;
+    }
+  } else if (region.data == nullptr) {
+    // Transparent huge pages are only used for huge page aligned ranges, so
+    // over-map and trim the unaligned ends.
+    size_t mapped = size + kRegionSize;
+    void* data = mmap(nullptr, mapped, kProtection, kFlags, -1, 0);
+    if (data != MAP_FAILED) {
+      char* begin = static_cast<char*>(data);
+      char* aligned = reinterpret_cast<char*>(
+          RoundUp(reinterpret_cast<uintptr_t>(begin), kRegionSize));
+      size_t head = aligned - begin;
+      if (head > 0) {
+        munmap(begin, head);
+      }
+      munmap(aligned + size, mapped - head - size);
+      region.data = aligned;
+      region.huge_pages = madvise(aligned, size, MADV_HUGEPAGE) == 0;
+    }
+  }
+  if (region.data == nullptr) {
+    ABSL_LOG(FATAL) << "failed to map " << size << " bytes of plan storage";
+  }
+#else
+  region.data = ::operator new(size);
+#endif
+  stats_.reserved_bytes += region.size;
+  if (region.huge_pages) {
+    stats_.huge_page_bytes += region.size;
+  }
+  return region;
+}
+
+void HugePageAllocator::UnmapRegion(const Region& region) {
+#ifdef __linux__
+  munmap(region.data, region.size);
+#else
+  ::operator delete(region.data);
+#endif
+  stats_.reserved_bytes -= region.size;
+  if (region.huge_pages) {
+    stats_.huge_page_bytes -= region.size;
+  }
+}
+
+}  // namespace cel
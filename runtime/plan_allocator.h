@@ -0,0 +1,121 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_PLAN_ALLOCATOR_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_PLAN_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace cel {
+
+// Source of the memory holding long-lived plan storage: the step arenas of
+// planned programs and the strings of constant pools (see
+// RuntimeOptions::plan_allocator).
+//
+// Plan storage is allocated in blocks of a few KiB while planning and
+// released when the program or pool is destroyed. Implementations must be
+// thread-safe.
+class PlanAllocator {
+ public:
+  struct Stats {
+    // Bytes reserved from the operating system, including free blocks.
+    int64_t reserved_bytes = 0;
+    // Part of reserved_bytes backed by, or advised to be backed by, huge
+    // pages.
+    int64_t huge_page_bytes = 0;
+    // Bytes of the blocks currently allocated.
+    int64_t allocated_bytes = 0;
+  };
+
+  virtual ~PlanAllocator() = default;
+
+  // Returns a block of size bytes aligned to alignof(std::max_align_t).
+  // Never returns null.
+  virtual void* Allocate(size_t size) = 0;
+
+  // Releases a block returned by Allocate with the same size.
+  virtual void Deallocate(void* ptr, size_t size) = 0;
+
+  virtual Stats GetStats() const = 0;
+};
+
+enum class HugePageMode {
+  // Regular pages.
+  kNone,
+  // Advise the kernel to back regions with transparent huge pages
+  // (madvise(MADV_HUGEPAGE)). Requires transparent huge pages to be enabled
+  // in "madvise" or "always" mode.
+  kTransparent,
+  // Map regions from the explicit huge page pool (MAP_HUGETLB). Falls back to
+  // kTransparent when the pool is exhausted.
+  kExplicit,
+};
+
+// Allocator packing plan storage into 2 MiB regions, so that the steps of
+// many programs share few TLB entries.
+//
+// Released blocks are kept on per-size free lists for reuse by later plans,
+// and regions are only returned to the operating system when the allocator
+// is destroyed. Blocks larger than a quarter of a region are mapped and
+// unmapped individually. On platforms other than Linux, the mode is ignored.
+class HugePageAllocator final : public PlanAllocator {
+ public:
+  explicit HugePageAllocator(HugePageMode mode = HugePageMode::kTransparent);
+  ~HugePageAllocator() override;
+
+  HugePageAllocator(const HugePageAllocator&) = delete;
+  HugePageAllocator& operator=(const HugePageAllocator&) = delete;
+
+  void* Allocate(size_t size) override;
+
+  void Deallocate(void* ptr, size_t size) override;
+
+  Stats GetStats() const override;
+
+ private:
+  struct Region {
+    void* data;
+    size_t size;
+    bool huge_pages;
+  };
+
+  size_t LargeBlockSize(size_t size) const;
+
+  Region MapRegion(size_t size) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void UnmapRegion(const Region& region) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const HugePageMode mode_;
+  mutable absl::Mutex mutex_;
+  // Regions shared by the blocks of up to a quarter of a region.
+  std::vector<Region> regions_ ABSL_GUARDED_BY(mutex_);
+  // Blocks mapped individually, by address.
+  absl::flat_hash_map<void*, Region> large_blocks_ ABSL_GUARDED_BY(mutex_);
+  // Free space at the end of the last shared region.
+  char* next_ ABSL_GUARDED_BY(mutex_) = nullptr;
+  size_t remaining_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<size_t, std::vector<void*>> free_lists_
+      ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_PLAN_ALLOCATOR_H_
@@ -0,0 +1,97 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/plan_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "internal/testing.h"
+
+namespace cel {
+namespace {
+
+constexpr size_t kMiB = 1024 * 1024;
+
+bool IsAligned(const void* ptr, size_t alignment) {
+  return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+class HugePageAllocatorTest : public testing::TestWithParam<HugePageMode> {};
+
+TEST_P(HugePageAllocatorTest, PacksSmallBlocks) {
+  HugePageAllocator allocator(GetParam());
+  void* first = allocator.Allocate(256);
+  void* second = allocator.Allocate(100);
+  EXPECT_TRUE(IsAligned(first, alignof(std::max_align_t)));
+  EXPECT_TRUE(IsAligned(second, alignof(std::max_align_t)));
+  EXPECT_EQ(static_cast<char*>(second), static_cast<char*>(first) + 256);
+  std::memset(first, 1, 256);
+  std::memset(second, 2, 100);
+
+  PlanAllocator::Stats stats = allocator.GetStats();
+  EXPECT_EQ(stats.reserved_bytes, 2 * kMiB);
+  EXPECT_EQ(stats.allocated_bytes, 256 + 112);
+  EXPECT_LE(stats.huge_page_bytes, stats.reserved_bytes);
+  if (GetParam() == HugePageMode::kNone) {
+    EXPECT_EQ(stats.huge_page_bytes, 0);
+  }
+
+  allocator.Deallocate(first, 256);
+  EXPECT_EQ(allocator.GetStats().allocated_bytes, 112);
+  // Released blocks are reused for the same size.
+  EXPECT_EQ(allocator.Allocate(256), first);
+  allocator.Deallocate(first, 256);
+  allocator.Deallocate(second, 100);
+  EXPECT_EQ(allocator.GetStats().allocated_bytes, 0);
+}
+
+TEST_P(HugePageAllocatorTest, MapsLargeBlocksIndividually) {
+  HugePageAllocator allocator(GetParam());
+  void* large = allocator.Allocate(3 * kMiB);
+  std::memset(large, 1, 3 * kMiB);
+  PlanAllocator::Stats stats = allocator.GetStats();
+  EXPECT_GE(stats.reserved_bytes, 3 * kMiB);
+  EXPECT_EQ(stats.allocated_bytes, stats.reserved_bytes);
+
+  allocator.Deallocate(large, 3 * kMiB);
+  stats = allocator.GetStats();
+  EXPECT_EQ(stats.reserved_bytes, 0);
+  EXPECT_EQ(stats.huge_page_bytes, 0);
+  EXPECT_EQ(stats.allocated_bytes, 0);
+}
+
+TEST_P(HugePageAllocatorTest, AddsRegionsAsNeeded) {
+  HugePageAllocator allocator(GetParam());
+  std::vector<void*> blocks;
+  for (int i = 0; i < 100; ++i) {
+    blocks.push_back(allocator.Allocate(64 * 1024));
+  }
+  // 32 blocks per region.
+  EXPECT_EQ(allocator.GetStats().reserved_bytes, 4 * 2 * kMiB);
+  for (void* block : blocks) {
+    allocator.Deallocate(block, 64 * 1024);
+  }
+  EXPECT_EQ(allocator.GetStats().allocated_bytes, 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, HugePageAllocatorTest,
+                         testing::Values(HugePageMode::kNone,
+                                         HugePageMode::kTransparent,
+                                         HugePageMode::kExplicit));
+
+}  // namespace
+}  // namespace cel
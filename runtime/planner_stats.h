@@ -0,0 +1,80 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_PLANNER_STATS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_PLANNER_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/time/time.h"
+
+namespace cel {
+
+// Time and memory spent creating programs, by planning phase.
+//
+// Phase statistics are added to those already recorded, so one PlannerStats
+// may accumulate the creation of several programs. The footprint is that of
+// the last program created.
+struct PlannerStats {
+  // Returns a monotonic count of allocations, e.g. from a counting allocator.
+  // It is sampled at the start and end of each phase.
+  using AllocationCounter = absl::AnyInvocable<int64_t() const>;
+
+  struct Phase {
+    absl::Duration wall_time = absl::ZeroDuration();
+    // Allocations made during the phase, as measured by the allocation
+    // counter. Zero if no counter is set.
+    int64_t allocations = 0;
+  };
+
+  // Conversion of protobuf expressions to the native AST. Only recorded by
+  // builders that take protobuf expressions.
+  Phase ast_conversion;
+
+  // AstTransforms, e.g. reference resolution and common subexpression
+  // elimination.
+  Phase ast_transforms;
+
+  // Flattening the AST into execution steps, excluding program optimizers.
+  Phase flattening;
+
+  // Creating and running ProgramOptimizers, e.g. constant folding.
+  Phase program_optimizers;
+
+  // Assembling the program from the steps, including the compact encoding
+  // and the analyses of the variables and attributes read.
+  Phase finalization;
+
+  // Number of steps of the last program created.
+  size_t program_steps = 0;
+
+  // Approximate bytes held by the last program created: its step tables and
+  // the steps allocated from a step arena. Memory owned indirectly by steps
+  // (e.g. constants) is not included.
+  size_t program_bytes = 0;
+
+  AllocationCounter allocation_counter;
+
+  absl::Duration total_wall_time() const {
+    return ast_conversion.wall_time + ast_transforms.wall_time +
+           flattening.wall_time + program_optimizers.wall_time +
+           finalization.wall_time;
+  }
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_PLANNER_STATS_H_
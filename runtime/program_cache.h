@@ -0,0 +1,58 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_CACHE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+struct ProgramCacheOptions {
+  // Maximum number of distinct programs kept. The least recently used program
+  // is dropped from the cache when it is full; programs already created from
+  // it stay valid.
+  size_t max_entries = 1024;
+};
+
+struct ProgramCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t entries = 0;
+};
+
+// Enable sharing of planned programs in the runtime being built.
+//
+// Creating a program for an AST identical to one planned before (the same
+// expression and ids, and for checked ASTs the same references and types)
+// reuses the earlier plan instead of planning again, which saves both the
+// planning time and the memory of the duplicate program. Source positions are
+// ignored. Planning failures are not cached.
+absl::Status EnableProgramCache(RuntimeBuilder& builder,
+                                const ProgramCacheOptions& options = {});
+
+// Returns the statistics of the program cache of runtime, or an error if it
+// is not enabled.
+absl::StatusOr<ProgramCacheStats> GetProgramCacheStats(const Runtime& runtime);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_CACHE_H_
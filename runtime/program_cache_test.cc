@@ -0,0 +1,138 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/program_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::internal::IsOkAndHolds;
+using ::cel::internal::StatusIs;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+
+class ProgramCacheTest : public testing::Test {
+ protected:
+  void BuildRuntime(const ProgramCacheOptions& cache_options) {
+    RuntimeOptions options;
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    ASSERT_OK(EnableProgramCache(builder, cache_options));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<int64_t> Evaluate(absl::string_view expression) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expression));
+    CEL_ASSIGN_OR_RETURN(
+        auto program,
+        ProtobufRuntimeAdapter::CreateProgram(*runtime_, parsed_expr));
+    ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                      MemoryManagerRef::ReferenceCounting());
+    Activation activation;
+    CEL_ASSIGN_OR_RETURN(Handle<Value> value,
+                         program->Evaluate(activation, value_factory.get()));
+    if (!value->Is<IntValue>()) {
+      return absl::InternalError("expected an int result");
+    }
+    return value.As<IntValue>()->NativeValue();
+  }
+
+  std::unique_ptr<const Runtime> runtime_;
+};
+
+TEST_F(ProgramCacheTest, SharesIdenticalPrograms) {
+  BuildRuntime({});
+
+  EXPECT_THAT(Evaluate("1 + 2"), IsOkAndHolds(3));
+  EXPECT_THAT(Evaluate("1 + 2"), IsOkAndHolds(3));
+  EXPECT_THAT(Evaluate("2 + 2"), IsOkAndHolds(4));
+
+  ASSERT_OK_AND_ASSIGN(ProgramCacheStats stats,
+                       GetProgramCacheStats(*runtime_));
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.evictions, 0);
+  EXPECT_EQ(stats.entries, 2);
+}
+
+TEST_F(ProgramCacheTest, EvictsLeastRecentlyUsed) {
+  ProgramCacheOptions cache_options;
+  cache_options.max_entries = 2;
+  BuildRuntime(cache_options);
+
+  EXPECT_THAT(Evaluate("1"), IsOkAndHolds(1));
+  EXPECT_THAT(Evaluate("2"), IsOkAndHolds(2));
+  EXPECT_THAT(Evaluate("1"), IsOkAndHolds(1));
+  // Evicts "2".
+  EXPECT_THAT(Evaluate("3"), IsOkAndHolds(3));
+  EXPECT_THAT(Evaluate("1"), IsOkAndHolds(1));
+  EXPECT_THAT(Evaluate("2"), IsOkAndHolds(2));
+
+  ASSERT_OK_AND_ASSIGN(ProgramCacheStats stats,
+                       GetProgramCacheStats(*runtime_));
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 4);
+  EXPECT_EQ(stats.evictions, 2);
+  EXPECT_EQ(stats.entries, 2);
+}
+
+TEST_F(ProgramCacheTest, PlanningErrorsNotCached) {
+  BuildRuntime({});
+
+  EXPECT_THAT(Evaluate("undefined_function(1)"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(Evaluate("undefined_function(1)"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  ASSERT_OK_AND_ASSIGN(ProgramCacheStats stats,
+                       GetProgramCacheStats(*runtime_));
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.misses, 2);
+  EXPECT_EQ(stats.entries, 0);
+}
+
+TEST(ProgramCacheStatsTest, NotEnabled) {
+  RuntimeOptions options;
+  ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                       CreateStandardRuntimeBuilder(options));
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+
+  EXPECT_THAT(GetProgramCacheStats(*runtime),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+}  // namespace
+}  // namespace cel::extensions
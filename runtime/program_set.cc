@@ -0,0 +1,117 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/program_set.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/macros.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/list_value.h"
+#include "common/native_type.h"
+#include "eval/compiler/program_set_optimization.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/internal/runtime_friend_access.h"
+#include "runtime/internal/runtime_impl.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::internal::down_cast;
+using ::cel::runtime_internal::RuntimeFriendAccess;
+using ::cel::runtime_internal::RuntimeImpl;
+using ::google::api::expr::runtime::CreateProgramSetOptimizer;
+using ::google::api::expr::runtime::MergeProgramSet;
+
+absl::StatusOr<RuntimeImpl*> RuntimeImplFromBuilder(RuntimeBuilder& builder) {
+  Runtime& runtime = RuntimeFriendAccess::GetMutableRuntime(builder);
+
+  if (RuntimeFriendAccess::RuntimeTypeId(runtime) !=
+      NativeTypeId::For<RuntimeImpl>()) {
+    return absl::UnimplementedError(
+        "program sets only supported on the default cel::Runtime "
+        "implementation.");
+  }
+
+  RuntimeImpl& runtime_impl = down_cast<RuntimeImpl&>(runtime);
+
+  return &runtime_impl;
+}
+
+}  // namespace
+
+absl::Status EnableProgramSets(RuntimeBuilder& builder) {
+  CEL_ASSIGN_OR_RETURN(RuntimeImpl * runtime_impl,
+                       RuntimeImplFromBuilder(builder));
+  ABSL_ASSERT(runtime_impl != nullptr);
+
+  runtime_impl->expr_builder().AddProgramOptimizer(CreateProgramSetOptimizer());
+  runtime_impl->set_program_sets_enabled();
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<Handle<Value>>> ProgramSet::Evaluate(
+    const ActivationInterface& activation, ValueFactory& value_factory) const {
+  CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                       program_->Evaluate(activation, value_factory));
+  if (!result->Is<ListValue>() || result->As<ListValue>().Size() != size_) {
+    return absl::InternalError("unexpected program set result");
+  }
+  const ListValue& list = result->As<ListValue>();
+  std::vector<Handle<Value>> results;
+  results.reserve(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    CEL_ASSIGN_OR_RETURN(results.emplace_back(), list.Get(value_factory, i));
+  }
+  return results;
+}
+
+absl::StatusOr<std::unique_ptr<ProgramSet>> CreateProgramSet(
+    const Runtime& runtime, std::vector<std::unique_ptr<Ast>> asts) {
+  if (RuntimeFriendAccess::RuntimeTypeId(runtime) !=
+          NativeTypeId::For<RuntimeImpl>() ||
+      !down_cast<const RuntimeImpl&>(runtime).program_sets_enabled()) {
+    return absl::FailedPreconditionError("program sets are not enabled");
+  }
+  std::vector<const AstImpl*> ast_impls;
+  ast_impls.reserve(asts.size());
+  for (const auto& ast : asts) {
+    if (ast == nullptr) {
+      return absl::InvalidArgumentError("program set AST must not be null");
+    }
+    ast_impls.push_back(&AstImpl::CastFromPublicAst(*ast));
+  }
+  CEL_ASSIGN_OR_RETURN(AstImpl merged, MergeProgramSet(ast_impls));
+  CEL_ASSIGN_OR_RETURN(
+      std::unique_ptr<Program> program,
+      runtime.CreateProgram(std::make_unique<AstImpl>(std::move(merged))));
+  return absl::WrapUnique(new ProgramSet(std::move(program), asts.size()));
+}
+
+}  // namespace cel::extensions
@@ -0,0 +1,83 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_SET_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_SET_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable the planning of program sets (see CreateProgramSet) in the runtime
+// being built.
+//
+// Subexpressions are only shared between the programs of a set if common
+// subexpression elimination is enabled as well (see
+// EnableCommonSubexpressionElimination).
+absl::Status EnableProgramSets(RuntimeBuilder& builder);
+
+// Independent expressions planned as a single program, for evaluating many
+// expressions (e.g. policies) over the same activation.
+//
+// Created with CreateProgramSet. Thread-safe like Program.
+class ProgramSet final {
+ public:
+  // Number of expressions in the set.
+  size_t size() const { return size_; }
+
+  // Evaluate all expressions, returning their results in the order the
+  // expressions were given to CreateProgramSet. Each result is the same as
+  // the result of evaluating its expression alone, including CEL errors and
+  // unknowns. Non-recoverable errors are returned as a non-ok status.
+  absl::StatusOr<std::vector<Handle<Value>>> Evaluate(
+      const ActivationInterface& activation, ValueFactory& value_factory) const;
+
+ private:
+  friend absl::StatusOr<std::unique_ptr<ProgramSet>> CreateProgramSet(
+      const Runtime& runtime, std::vector<std::unique_ptr<Ast>> asts);
+
+  ProgramSet(std::unique_ptr<Program> program, size_t size)
+      : program_(std::move(program)), size_(size) {}
+
+  std::unique_ptr<Program> program_;
+  size_t size_;
+};
+
+// Plan asts as one program in runtime, which must have been built with
+// EnableProgramSets.
+//
+// The expressions are merged into one, so with common subexpression
+// elimination a subexpression shared by several of them (the same predicate
+// over the same variables, for checked ASTs also with the same references) is
+// evaluated at most once per evaluation of the set, and only if one of the
+// expressions reaches it.
+absl::StatusOr<std::unique_ptr<ProgramSet>> CreateProgramSet(
+    const Runtime& runtime, std::vector<std::unique_ptr<Ast>> asts);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_PROGRAM_SET_H_
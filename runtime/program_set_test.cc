@@ -0,0 +1,187 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/program_set.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/common_subexpression_elimination.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::google::api::expr::parser::Parse;
+using testing::ElementsAre;
+using testing::HasSubstr;
+using cel::internal::StatusIs;
+
+// score(int) -> int computing 10 * x and counting calls.
+class ScoreFunction : public Function {
+ public:
+  explicit ScoreFunction(int* calls) : calls_(calls) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    ++*calls_;
+    return context.value_factory().CreateIntValue(
+        10 * args[0].As<IntValue>()->NativeValue());
+  }
+
+ private:
+  int* calls_;
+};
+
+class ProgramSetTest : public testing::Test {
+ public:
+  absl::StatusOr<std::unique_ptr<const Runtime>> CreateRuntime(
+      bool enable_program_sets) {
+    CEL_ASSIGN_OR_RETURN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    CEL_RETURN_IF_ERROR(builder.function_registry().Register(
+        FunctionDescriptor("score", false, {Kind::kInt}, /*is_strict=*/true,
+                           /*is_pure=*/true),
+        std::make_unique<ScoreFunction>(&calls_)));
+    CEL_RETURN_IF_ERROR(EnableCommonSubexpressionElimination(builder));
+    if (enable_program_sets) {
+      CEL_RETURN_IF_ERROR(EnableProgramSets(builder));
+    }
+    return std::move(builder).Build();
+  }
+
+  absl::StatusOr<std::vector<std::unique_ptr<Ast>>> ParseAll(
+      absl::Span<const absl::string_view> exprs) {
+    std::vector<std::unique_ptr<Ast>> asts;
+    for (absl::string_view expr : exprs) {
+      CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+      CEL_ASSIGN_OR_RETURN(asts.emplace_back(),
+                           CreateAstFromParsedExpr(std::move(parsed_expr)));
+    }
+    return asts;
+  }
+
+ protected:
+  int calls_ = 0;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+TEST_F(ProgramSetTest, SharesSubexpressionsAcrossPrograms) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime(true));
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"score(x) > 10 && x > 0",
+                                            "score(x) > 10 || x < 0",
+                                            "score(x) > 10 ? score(x) : 0"}));
+  ASSERT_OK_AND_ASSIGN(auto program_set,
+                       CreateProgramSet(*runtime, std::move(asts)));
+  EXPECT_EQ(program_set->size(), 3);
+
+  Activation activation;
+  activation.InsertOrAssignValue("x", value_factory_.get().CreateIntValue(2));
+  ASSERT_OK_AND_ASSIGN(std::vector<Handle<Value>> results,
+                       program_set->Evaluate(activation, value_factory_.get()));
+
+  ASSERT_EQ(results.size(), 3);
+  ASSERT_TRUE(results[0]->Is<BoolValue>());
+  EXPECT_TRUE(results[0].As<BoolValue>()->NativeValue());
+  ASSERT_TRUE(results[1]->Is<BoolValue>());
+  EXPECT_TRUE(results[1].As<BoolValue>()->NativeValue());
+  ASSERT_TRUE(results[2]->Is<IntValue>());
+  EXPECT_EQ(results[2].As<IntValue>()->NativeValue(), 20);
+  EXPECT_EQ(calls_, 1);
+}
+
+TEST_F(ProgramSetTest, ErrorsStayWithTheirProgram) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime(true));
+  ASSERT_OK_AND_ASSIGN(
+      auto asts,
+      ParseAll({"1 / 0 > 1", "2 + 3", "[1, 2].exists(i, score(i) > 10)"}));
+  ASSERT_OK_AND_ASSIGN(auto program_set,
+                       CreateProgramSet(*runtime, std::move(asts)));
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(std::vector<Handle<Value>> results,
+                       program_set->Evaluate(activation, value_factory_.get()));
+
+  ASSERT_EQ(results.size(), 3);
+  EXPECT_TRUE(results[0]->Is<ErrorValue>());
+  ASSERT_TRUE(results[1]->Is<IntValue>());
+  EXPECT_EQ(results[1].As<IntValue>()->NativeValue(), 5);
+  ASSERT_TRUE(results[2]->Is<BoolValue>());
+  EXPECT_TRUE(results[2].As<BoolValue>()->NativeValue());
+}
+
+TEST_F(ProgramSetTest, UnreachedSharedSubexpressionsAreNotEvaluated) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime(true));
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"x > 5 && score(x) > 10",
+                                            "x > 5 && score(x) > 10"}));
+  ASSERT_OK_AND_ASSIGN(auto program_set,
+                       CreateProgramSet(*runtime, std::move(asts)));
+
+  Activation activation;
+  activation.InsertOrAssignValue("x", value_factory_.get().CreateIntValue(2));
+  ASSERT_OK_AND_ASSIGN(std::vector<Handle<Value>> results,
+                       program_set->Evaluate(activation, value_factory_.get()));
+
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_FALSE(results[0].As<BoolValue>()->NativeValue());
+  EXPECT_FALSE(results[1].As<BoolValue>()->NativeValue());
+  EXPECT_EQ(calls_, 0);
+}
+
+TEST_F(ProgramSetTest, EmptySet) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime(true));
+  ASSERT_OK_AND_ASSIGN(auto program_set, CreateProgramSet(*runtime, {}));
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(std::vector<Handle<Value>> results,
+                       program_set->Evaluate(activation, value_factory_.get()));
+  EXPECT_THAT(results, ElementsAre());
+}
+
+TEST_F(ProgramSetTest, RequiresEnableProgramSets) {
+  ASSERT_OK_AND_ASSIGN(auto runtime, CreateRuntime(false));
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"1 + 1"}));
+  EXPECT_THAT(CreateProgramSet(*runtime, std::move(asts)),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("not enabled")));
+}
+
+}  // namespace
+}  // namespace cel::extensions
@@ -0,0 +1,38 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_REFERENCED_ATTRIBUTE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_REFERENCED_ATTRIBUTE_H_
+
+#include "base/attribute.h"
+
+namespace cel {
+
+// An attribute of the activation that a program may read.
+struct ReferencedAttribute {
+  // The variable and the longest path of field selections and constant
+  // indexes applied to it, e.g. `request.auth.claims` or `labels["env"]`.
+  // Reading the attribute may read any of its descendants as well.
+  Attribute attribute;
+
+  // Set if the attribute is only read on some evaluations: it is referenced
+  // only in the right operand of a logical operator, a branch of a
+  // conditional, or the body of a comprehension, so evaluation may skip it
+  // depending on other values.
+  bool conditional = false;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_REFERENCED_ATTRIBUTE_H_
@@ -20,6 +20,7 @@
 #include "common/native_type.h"
 #include "eval/compiler/regex_precompilation_optimization.h"
 #include "internal/casts.h"
+#include "internal/regex_pool.h"
 #include "internal/status_macros.h"
 #include "runtime/internal/runtime_friend_access.h"
 #include "runtime/internal/runtime_impl.h"
@@ -33,6 +34,7 @@ using ::cel::internal::down_cast;
 using ::cel::runtime_internal::RuntimeFriendAccess;
 using ::cel::runtime_internal::RuntimeImpl;
 using ::google::api::expr::runtime::CreateRegexPrecompilationExtension;
+using ::google::api::expr::runtime::CreateRegexSetExtension;
 
 absl::StatusOr<RuntimeImpl*> RuntimeImplFromBuilder(RuntimeBuilder& builder) {
   Runtime& runtime = RuntimeFriendAccess::GetMutableRuntime(builder);
@@ -56,10 +58,25 @@ absl::Status EnableRegexPrecompilation(RuntimeBuilder& builder) {
                        RuntimeImplFromBuilder(builder));
   ABSL_ASSERT(runtime_impl != nullptr);
 
+  const int regex_max_program_size =
+      runtime_impl->expr_builder().options().regex_max_program_size;
   runtime_impl->expr_builder().AddProgramOptimizer(
-      CreateRegexPrecompilationExtension(
-          runtime_impl->expr_builder().options().regex_max_program_size));
+      CreateRegexPrecompilationExtension(regex_max_program_size));
+  runtime_impl->expr_builder().AddProgramOptimizer(
+      CreateRegexSetExtension(regex_max_program_size));
   return absl::OkStatus();
 }
 
+SharedRegexPoolStats GetSharedRegexPoolStats() {
+  cel::internal::RegexPool::Stats stats =
+      cel::internal::RegexPool::Shared().stats();
+  SharedRegexPoolStats result;
+  result.patterns = stats.patterns;
+  result.program_size = stats.program_size;
+  result.pattern_bytes = stats.pattern_bytes;
+  result.hits = stats.hits;
+  result.misses = stats.misses;
+  return result;
+}
+
 }  // namespace cel::extensions
@@ -15,6 +15,9 @@
 #ifndef THIRD_PARTY_CEL_CPP_REGEX_PRECOMPILATION_FOLDING_H_
 #define THIRD_PARTY_CEL_CPP_REGEX_PRECOMPILATION_FOLDING_H_
 
+#include <cstddef>
+#include <cstdint>
+
 #include "absl/status/status.h"
 #include "base/memory.h"
 #include "runtime/runtime_builder.h"
@@ -31,6 +34,22 @@ namespace cel::extensions {
 // from builder.
 absl::Status EnableRegexPrecompilation(RuntimeBuilder& builder);
 
+// Memory held by the precompiled regular expressions shared between runtimes
+// (see RuntimeOptions::enable_shared_regex_pool).
+struct SharedRegexPoolStats {
+  // Number of distinct patterns in use.
+  size_t patterns = 0;
+  // Sum of RE2::ProgramSize() of their compiled programs.
+  int64_t program_size = 0;
+  // Sum of the sizes of the patterns, in bytes.
+  size_t pattern_bytes = 0;
+  // Patterns served with an already compiled program, and patterns compiled.
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+SharedRegexPoolStats GetSharedRegexPoolStats();
+
 }  // namespace cel::extensions
 
 #endif  // THIRD_PARTY_CEL_CPP_REGEX_PRECOMPILATION_FOLDING_H_
@@ -14,6 +14,7 @@
 
 #include "runtime/regex_precompilation.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -35,6 +36,7 @@
 #include "runtime/constant_folding.h"
 #include "runtime/managed_value_factory.h"
 #include "runtime/register_function_helper.h"
+#include "runtime/runtime.h"
 #include "runtime/runtime_builder.h"
 #include "runtime/runtime_options.h"
 #include "runtime/standard_runtime_builder_factory.h"
@@ -46,6 +48,7 @@ using ::google::api::expr::v1alpha1::ParsedExpr;
 using ::google::api::expr::parser::Parse;
 using testing::_;
 using testing::HasSubstr;
+using cel::internal::IsOkAndHolds;
 using cel::internal::StatusIs;
 
 using ValueMatcher = testing::Matcher<Handle<Value>>;
@@ -195,5 +198,42 @@ INSTANTIATE_TEST_SUITE_P(
       return info.param.name;
     });
 
+TEST(RegexPrecompilationSharedPoolTest, SharesProgramsBetweenRuntimes) {
+  RuntimeOptions options;
+  options.enable_shared_regex_pool = true;
+  std::vector<std::unique_ptr<Program>> programs;
+  SharedRegexPoolStats before = GetSharedRegexPoolStats();
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK_AND_ASSIGN(cel::RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    ASSERT_OK(EnableRegexPrecompilation(builder));
+    ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+    ASSERT_OK_AND_ASSIGN(
+        ParsedExpr parsed_expr,
+        Parse(R"(string_var.matches(r'shared_pool_test_\w+'))"));
+    ASSERT_OK_AND_ASSIGN(
+        programs.emplace_back(),
+        ProtobufRuntimeAdapter::CreateProgram(*runtime, parsed_expr));
+  }
+
+  SharedRegexPoolStats stats = GetSharedRegexPoolStats();
+  EXPECT_EQ(stats.patterns, before.patterns + 1);
+  EXPECT_EQ(stats.misses, before.misses + 1);
+  EXPECT_EQ(stats.hits, before.hits + 1);
+  EXPECT_GT(stats.program_size, before.program_size);
+
+  ManagedValueFactory value_factory(programs[1]->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(
+      auto var, value_factory.get().CreateStringValue("shared_pool_test_a"));
+  activation.InsertOrAssignValue("string_var", var);
+  EXPECT_THAT(programs[1]->Evaluate(activation, value_factory.get()),
+              IsOkAndHolds(IsBoolValue(true)));
+
+  programs.clear();
+  EXPECT_EQ(GetSharedRegexPoolStats().patterns, before.patterns);
+}
+
 }  // namespace
 }  // namespace cel::extensions
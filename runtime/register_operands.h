@@ -0,0 +1,33 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_REGISTER_OPERANDS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_REGISTER_OPERANDS_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable register operands in the runtime being built.
+//
+// Eagerly bound function calls whose arguments are all constants or
+// comprehension variables are planned as a single step that reads the
+// arguments in place, avoiding a push and pop per argument. Not applied when
+// unknown processing or missing attribute errors are enabled.
+absl::Status EnableRegisterOperands(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_REGISTER_OPERANDS_H_
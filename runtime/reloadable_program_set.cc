@@ -0,0 +1,138 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/reloadable_program_set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/program_set.h"
+#include "runtime/runtime.h"
+
+namespace cel::extensions {
+
+ReloadableProgramSet::ReloadableProgramSet(const Runtime& runtime,
+                                           ProgramSetReloadScheduler schedule,
+                                           ReloadableProgramSetOptions options)
+    : runtime_(runtime),
+      schedule_(std::move(schedule)),
+      options_(std::move(options)) {}
+
+ReloadableProgramSet::~ReloadableProgramSet() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](int* pending_reloads) { return *pending_reloads == 0; },
+      &pending_reloads_));
+}
+
+std::shared_ptr<const ReloadableProgramSet::Generation>
+ReloadableProgramSet::Current() const {
+  return std::atomic_load(&current_);
+}
+
+absl::StatusOr<std::vector<Handle<Value>>> ReloadableProgramSet::Evaluate(
+    const ActivationInterface& activation, ValueFactory& value_factory) const {
+  std::shared_ptr<const Generation> generation = Current();
+  if (generation == nullptr) {
+    return absl::FailedPreconditionError(
+        "no program set generation has been published");
+  }
+  return generation->programs->Evaluate(activation, value_factory);
+}
+
+void ReloadableProgramSet::Reload(std::vector<std::unique_ptr<Ast>> asts,
+                                  absl::AnyInvocable<void(absl::Status)> done) {
+  uint64_t version;
+  {
+    absl::MutexLock lock(&mutex_);
+    version = ++last_version_;
+    ++pending_reloads_;
+  }
+  schedule_([this, version, asts = std::move(asts),
+             done = std::move(done)]() mutable {
+    absl::Status status = BuildAndPublish(version, std::move(asts));
+    if (done != nullptr) {
+      std::move(done)(std::move(status));
+    }
+    absl::MutexLock lock(&mutex_);
+    --pending_reloads_;
+  });
+}
+
+absl::Status ReloadableProgramSet::BuildAndPublish(
+    uint64_t version, std::vector<std::unique_ptr<Ast>> asts) {
+  auto generation = std::make_shared<Generation>();
+  generation->version = version;
+  CEL_ASSIGN_OR_RETURN(generation->programs,
+                       CreateProgramSet(runtime_, std::move(asts)));
+  if (!options_.warm_up_activations.empty()) {
+    ManagedValueFactory value_factory(runtime_.GetTypeProvider(),
+                                      MemoryManagerRef::ReferenceCounting());
+    for (const auto& activation : options_.warm_up_activations) {
+      CEL_RETURN_IF_ERROR(
+          generation->programs->Evaluate(*activation, value_factory.get())
+              .status());
+    }
+  }
+
+  std::vector<std::shared_ptr<const Generation>> reclaimed;
+  {
+    absl::MutexLock lock(&mutex_);
+    std::shared_ptr<const Generation> previous = std::atomic_load(&current_);
+    if (previous != nullptr && previous->version > version) {
+      return absl::AbortedError(
+          "program set generation superseded by a later reload");
+    }
+    std::atomic_store(&current_,
+                      std::shared_ptr<const Generation>(std::move(generation)));
+    if (previous != nullptr) {
+      retired_.push_back(std::move(previous));
+    }
+    reclaimed = TakeReclaimable();
+  }
+  // The reclaimed generations are destroyed here, on the reload thread.
+  return absl::OkStatus();
+}
+
+std::vector<std::shared_ptr<const ReloadableProgramSet::Generation>>
+ReloadableProgramSet::TakeReclaimable() {
+  std::vector<std::shared_ptr<const Generation>> reclaimable;
+  for (std::shared_ptr<const Generation>& generation : retired_) {
+    // Retired generations can't be pinned again, so a count of one can't be
+    // raced by a reader.
+    if (generation.use_count() == 1) {
+      reclaimable.push_back(std::move(generation));
+    }
+  }
+  retired_.erase(std::remove(retired_.begin(), retired_.end(), nullptr),
+                 retired_.end());
+  return reclaimable;
+}
+
+}  // namespace cel::extensions
@@ -0,0 +1,130 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_RELOADABLE_PROGRAM_SET_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_RELOADABLE_PROGRAM_SET_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/program_set.h"
+#include "runtime/runtime.h"
+
+namespace cel::extensions {
+
+// Schedules a task on a caller owned executor, e.g. a thread pool separate
+// from the threads serving evaluations. Every scheduled task must eventually
+// run.
+using ProgramSetReloadScheduler =
+    absl::AnyInvocable<void(absl::AnyInvocable<void()>)>;
+
+struct ReloadableProgramSetOptions {
+  // Activations every new generation is evaluated with before it is
+  // published, so that state initialized on first use (value caches, lazily
+  // compiled regular expressions, type adapters) is warm when the first
+  // request reaches it. Results are discarded; a non-ok status fails the
+  // reload and keeps the current generation.
+  std::vector<std::shared_ptr<const ActivationInterface>> warm_up_activations;
+};
+
+// A program set (see CreateProgramSet) that is replaced as a whole when the
+// expressions change, e.g. when policies are reloaded.
+//
+// Each reload plans a new generation of the set on the scheduler, warms it
+// up and then publishes it with a single pointer swap. Readers never block
+// on a reload: they pin the generation that is current when they start and
+// keep evaluating it, however many generations are published meanwhile.
+// A replaced generation is destroyed by the first reload that finds it no
+// longer pinned by any reader, so readers never pay for its destruction
+// either.
+//
+// Thread-safe.
+class ReloadableProgramSet final {
+ public:
+  // One published version of the set.
+  struct Generation {
+    // Increases with every call to Reload, starting at 1.
+    uint64_t version;
+    std::unique_ptr<ProgramSet> programs;
+  };
+
+  // runtime must have been built with EnableProgramSets and outlive the
+  // ReloadableProgramSet.
+  ReloadableProgramSet(const Runtime& runtime,
+                       ProgramSetReloadScheduler schedule,
+                       ReloadableProgramSetOptions options = {});
+
+  ReloadableProgramSet(const ReloadableProgramSet&) = delete;
+  ReloadableProgramSet& operator=(const ReloadableProgramSet&) = delete;
+
+  // Waits for the reloads in progress.
+  ~ReloadableProgramSet();
+
+  // Returns the current generation, or nullptr before the first one is
+  // published. Holding the result keeps the generation alive.
+  std::shared_ptr<const Generation> Current() const;
+
+  // Evaluate the current generation, see ProgramSet::Evaluate. Returns a
+  // FailedPrecondition error before the first generation is published.
+  absl::StatusOr<std::vector<Handle<Value>>> Evaluate(
+      const ActivationInterface& activation, ValueFactory& value_factory) const;
+
+  // Plan asts as the next generation in the background and publish it once
+  // it is warmed up. done, if set, is called on the reload thread with the
+  // outcome: ok once the generation is published, the planning or warm-up
+  // error, or Aborted if a later reload was published first, in which case
+  // this generation is dropped. Generations are therefore published in the
+  // order of the calls to Reload.
+  void Reload(std::vector<std::unique_ptr<Ast>> asts,
+              absl::AnyInvocable<void(absl::Status)> done = nullptr);
+
+ private:
+  absl::Status BuildAndPublish(uint64_t version,
+                               std::vector<std::unique_ptr<Ast>> asts);
+
+  // Removes the retired generations no reader pins anymore, returning them
+  // to be destroyed outside of the lock.
+  std::vector<std::shared_ptr<const Generation>> TakeReclaimable()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Runtime& runtime_;
+  ProgramSetReloadScheduler schedule_;
+  const ReloadableProgramSetOptions options_;
+
+  // Accessed with the std::atomic_load / std::atomic_store overloads for
+  // shared_ptr; stores are additionally serialized by mutex_.
+  std::shared_ptr<const Generation> current_;
+
+  absl::Mutex mutex_;
+  uint64_t last_version_ ABSL_GUARDED_BY(mutex_) = 0;
+  int pending_reloads_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Replaced generations that may still be pinned by readers.
+  std::vector<std::shared_ptr<const Generation>> retired_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_RELOADABLE_PROGRAM_SET_H_
@@ -0,0 +1,224 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/reloadable_program_set.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/program_set.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel::extensions {
+namespace {
+
+using ::cel::internal::IsOkAndHolds;
+using ::cel::internal::StatusIs;
+using ::google::api::expr::parser::Parse;
+
+class ReloadableProgramSetTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK(EnableProgramSets(builder));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<std::vector<std::unique_ptr<Ast>>> ParseAll(
+      absl::Span<const absl::string_view> exprs) {
+    std::vector<std::unique_ptr<Ast>> asts;
+    for (absl::string_view expr : exprs) {
+      CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+      CEL_ASSIGN_OR_RETURN(asts.emplace_back(),
+                           CreateAstFromParsedExpr(std::move(parsed_expr)));
+    }
+    return asts;
+  }
+
+  // Evaluates the first expression of the current generation as an int.
+  absl::StatusOr<int64_t> EvaluateFirst(const ReloadableProgramSet& set) {
+    Activation activation;
+    activation.InsertOrAssignValue("x", value_factory_.get().CreateIntValue(3));
+    CEL_ASSIGN_OR_RETURN(std::vector<Handle<Value>> results,
+                         set.Evaluate(activation, value_factory_.get()));
+    if (results.empty() || !results[0]->Is<IntValue>()) {
+      return absl::InternalError("unexpected result");
+    }
+    return results[0].As<IntValue>()->NativeValue();
+  }
+
+ protected:
+  std::unique_ptr<const Runtime> runtime_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+// Runs tasks on the calling thread.
+void RunInline(absl::AnyInvocable<void()> task) { task(); }
+
+TEST_F(ReloadableProgramSetTest, PublishesGenerations) {
+  ReloadableProgramSet set(*runtime_, RunInline);
+  EXPECT_EQ(set.Current(), nullptr);
+  EXPECT_THAT(EvaluateFirst(set),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  absl::Status status = absl::UnknownError("not done");
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"x + 1", "x > 2"}));
+  set.Reload(std::move(asts), [&](absl::Status s) { status = s; });
+  ASSERT_OK(status);
+  ASSERT_NE(set.Current(), nullptr);
+  EXPECT_EQ(set.Current()->version, 1);
+  EXPECT_EQ(set.Current()->programs->size(), 2);
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(4));
+
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"x * 2"}));
+  set.Reload(std::move(asts));
+  EXPECT_EQ(set.Current()->version, 2);
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(6));
+}
+
+TEST_F(ReloadableProgramSetTest, ReadersKeepTheirGeneration) {
+  ReloadableProgramSet set(*runtime_, RunInline);
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"1"}));
+  set.Reload(std::move(asts));
+  std::shared_ptr<const ReloadableProgramSet::Generation> pinned =
+      set.Current();
+
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"2"}));
+  set.Reload(std::move(asts));
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"3"}));
+  set.Reload(std::move(asts));
+  EXPECT_EQ(set.Current()->version, 3);
+
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Handle<Value>> results,
+      pinned->programs->Evaluate(activation, value_factory_.get()));
+  ASSERT_TRUE(results[0]->Is<IntValue>());
+  EXPECT_EQ(results[0].As<IntValue>()->NativeValue(), 1);
+  // Only the pinned generation is still referenced by the set.
+  EXPECT_EQ(pinned.use_count(), 2);
+
+  pinned.reset();
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"4"}));
+  set.Reload(std::move(asts));
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(4));
+}
+
+TEST_F(ReloadableProgramSetTest, FailedReloadKeepsCurrentGeneration) {
+  ReloadableProgramSet set(*runtime_, RunInline);
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"x"}));
+  set.Reload(std::move(asts));
+
+  absl::Status status;
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"undefined_function(x)"}));
+  set.Reload(std::move(asts), [&](absl::Status s) { status = s; });
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(set.Current()->version, 1);
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(3));
+}
+
+TEST_F(ReloadableProgramSetTest, WarmsUpBeforePublishing) {
+  auto activation = std::make_shared<Activation>();
+  activation->InsertOrAssignValue("x", value_factory_.get().CreateIntValue(0));
+  ReloadableProgramSetOptions options;
+  options.warm_up_activations.push_back(activation);
+  ReloadableProgramSet set(*runtime_, RunInline, std::move(options));
+
+  absl::Status status;
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"x + 1", "1 / x"}));
+  // Evaluation errors are values, so they don't fail the warm-up.
+  set.Reload(std::move(asts), [&](absl::Status s) { status = s; });
+  ASSERT_OK(status);
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(4));
+}
+
+TEST_F(ReloadableProgramSetTest, DropsSupersededGenerations) {
+  std::vector<absl::AnyInvocable<void()>> tasks;
+  ReloadableProgramSet set(*runtime_, [&](absl::AnyInvocable<void()> task) {
+    tasks.push_back(std::move(task));
+  });
+  absl::Status first;
+  absl::Status second;
+  ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"1"}));
+  set.Reload(std::move(asts), [&](absl::Status s) { first = s; });
+  ASSERT_OK_AND_ASSIGN(asts, ParseAll({"2"}));
+  set.Reload(std::move(asts), [&](absl::Status s) { second = s; });
+  ASSERT_EQ(tasks.size(), 2);
+
+  std::move(tasks[1])();
+  std::move(tasks[0])();
+  EXPECT_OK(second);
+  EXPECT_THAT(first, StatusIs(absl::StatusCode::kAborted));
+  EXPECT_EQ(set.Current()->version, 2);
+  EXPECT_THAT(EvaluateFirst(set), IsOkAndHolds(2));
+}
+
+TEST_F(ReloadableProgramSetTest, ReloadsConcurrentlyWithReaders) {
+  std::vector<std::thread> threads;
+  {
+    ReloadableProgramSet set(*runtime_, [&](absl::AnyInvocable<void()> task) {
+      threads.emplace_back(std::move(task));
+    });
+    ASSERT_OK_AND_ASSIGN(auto asts, ParseAll({"0"}));
+    set.Reload(std::move(asts));
+    threads.back().join();
+    threads.clear();
+
+    std::thread reader([&]() {
+      ManagedValueFactory value_factory(TypeProvider::Builtin(),
+                                        MemoryManagerRef::ReferenceCounting());
+      Activation activation;
+      for (int i = 0; i < 1000; ++i) {
+        ASSERT_OK(set.Evaluate(activation, value_factory.get()));
+      }
+    });
+    for (int i = 1; i <= 8; ++i) {
+      ASSERT_OK_AND_ASSIGN(asts, ParseAll({absl::StrCat(i)}));
+      set.Reload(std::move(asts));
+    }
+    reader.join();
+    // The destructor waits for the reloads still in progress.
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+}  // namespace cel::extensions
@@ -0,0 +1,169 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/residual_ast.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/optional.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/bytes_value.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/int_value.h"
+#include "base/values/null_value.h"
+#include "base/values/string_value.h"
+#include "base/values/timestamp_value.h"
+#include "base/values/uint_value.h"
+#include "base/values/unknown_value.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+
+using ValueMap = absl::flat_hash_map<int64_t, Handle<Value>>;
+
+// Returns the literal for value, or nullopt if it has no literal form.
+absl::optional<Constant> ValueToConstant(const Handle<Value>& value) {
+  Constant constant;
+  if (value->Is<NullValue>()) {
+    constant.set_null_value(ast_internal::NullValue::kNullValue);
+  } else if (value->Is<BoolValue>()) {
+    constant.set_bool_value(value.As<BoolValue>()->NativeValue());
+  } else if (value->Is<IntValue>()) {
+    constant.set_int64_value(value.As<IntValue>()->NativeValue());
+  } else if (value->Is<UintValue>()) {
+    constant.set_uint64_value(value.As<UintValue>()->NativeValue());
+  } else if (value->Is<DoubleValue>()) {
+    constant.set_double_value(value.As<DoubleValue>()->NativeValue());
+  } else if (value->Is<StringValue>()) {
+    constant.set_string_value(value.As<StringValue>()->ToString());
+  } else if (value->Is<BytesValue>()) {
+    constant.set_bytes_value(value.As<BytesValue>()->ToString());
+  } else if (value->Is<DurationValue>()) {
+    constant.set_duration_value(value.As<DurationValue>()->NativeValue());
+  } else if (value->Is<TimestampValue>()) {
+    constant.set_time_value(value.As<TimestampValue>()->NativeValue());
+  } else {
+    return absl::nullopt;
+  }
+  return constant;
+}
+
+class ResidualAstBuilder {
+ public:
+  ResidualAstBuilder(const ValueMap& values, AstImpl& ast)
+      : values_(values), ast_(ast) {}
+
+  // Replaces expr with a literal if its value was known, otherwise folds its
+  // subexpressions.
+  void Fold(Expr& expr) {
+    if (auto it = values_.find(expr.id()); it != values_.end()) {
+      if (auto constant = ValueToConstant(it->second); constant.has_value()) {
+        expr.set_expr_kind(*std::move(constant));
+        // The reference of an identifier or call no longer applies.
+        ast_.reference_map().erase(expr.id());
+        return;
+      }
+    }
+    if (expr.has_select_expr()) {
+      auto& select = expr.mutable_select_expr();
+      if (select.has_operand()) {
+        Fold(select.mutable_operand());
+      }
+    } else if (expr.has_call_expr()) {
+      auto& call = expr.mutable_call_expr();
+      if (call.has_target()) {
+        Fold(call.mutable_target());
+      }
+      for (auto& arg : call.mutable_args()) {
+        Fold(arg);
+      }
+    } else if (expr.has_list_expr()) {
+      for (auto& element : expr.mutable_list_expr().mutable_elements()) {
+        Fold(element);
+      }
+    } else if (expr.has_struct_expr()) {
+      for (auto& entry : expr.mutable_struct_expr().mutable_entries()) {
+        if (entry.has_map_key()) {
+          Fold(entry.mutable_map_key());
+        }
+        if (entry.has_value()) {
+          Fold(entry.mutable_value());
+        }
+      }
+    } else if (expr.has_comprehension_expr()) {
+      // The loop condition and step are evaluated once per iteration, so the
+      // recorded values are those of the last iteration.
+      auto& comprehension = expr.mutable_comprehension_expr();
+      Fold(comprehension.mutable_iter_range());
+      Fold(comprehension.mutable_accu_init());
+      Fold(comprehension.mutable_result());
+    }
+  }
+
+ private:
+  const ValueMap& values_;
+  AstImpl& ast_;
+};
+
+}  // namespace
+
+absl::StatusOr<PartialEvaluationResult> PartiallyEvaluate(
+    const TraceableProgram& program, const Ast& ast,
+    const ActivationInterface& activation, ValueFactory& value_factory) {
+  ValueMap values;
+  auto listener = [&values](int64_t expr_id, const Handle<Value>& value,
+                            ValueFactory&) -> absl::Status {
+    // Unknown values are never folded, so are not worth keeping.
+    if (value->Is<UnknownValue>()) {
+      values.erase(expr_id);
+    } else {
+      values.insert_or_assign(expr_id, value);
+    }
+    return absl::OkStatus();
+  };
+  PartialEvaluationResult result;
+  CEL_ASSIGN_OR_RETURN(result.value,
+                       program.Trace(activation, listener, value_factory));
+  if (!result.value->Is<UnknownValue>()) {
+    return result;
+  }
+
+  auto residual =
+      std::make_unique<AstImpl>(AstImpl::CastFromPublicAst(ast).DeepCopy());
+  ResidualAstBuilder(values, *residual).Fold(residual->root_expr());
+  result.residual_ast = std::move(residual);
+  return result;
+}
+
+}  // namespace cel
@@ -0,0 +1,59 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_RESIDUAL_AST_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_RESIDUAL_AST_H_
+
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+// Result of PartiallyEvaluate.
+struct PartialEvaluationResult {
+  // The result of evaluating the program.
+  Handle<Value> value;
+
+  // Set if value is unknown. A copy of the program's AST in which every
+  // subexpression whose value was known, and can be written as a literal, is
+  // replaced by that literal. Planning and evaluating it with the attributes
+  // that were unknown gives the same result as evaluating the program with
+  // all attributes, without evaluating the known parts again.
+  std::unique_ptr<Ast> residual_ast;
+};
+
+// Evaluates program, which must have been planned from ast, and builds the
+// residual AST if the result is unknown.
+//
+// Intended for multi-phase evaluation, where the unknown attributes are only
+// available later: unknown processing should be enabled when planning the
+// program, and the residual AST cached until the attributes are known.
+// Subexpressions are folded using the values reported to the evaluation
+// listener, so the program should be planned with trace_sample_interval and
+// trace_expr_ids left unset. Subexpressions evaluated once per iteration of a
+// comprehension are never folded on their own.
+absl::StatusOr<PartialEvaluationResult> PartiallyEvaluate(
+    const TraceableProgram& program, const Ast& ast,
+    const ActivationInterface& activation, ValueFactory& value_factory);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_RESIDUAL_AST_H_
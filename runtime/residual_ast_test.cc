@@ -0,0 +1,155 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/residual_ast.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/attribute.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/values/bool_value.h"
+#include "base/values/int_value.h"
+#include "base/values/unknown_value.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::IsNull;
+using testing::NotNull;
+
+class ResidualAstTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    RuntimeOptions options;
+    options.unknown_processing = UnknownProcessingOptions::kAttributeOnly;
+    ASSERT_OK_AND_ASSIGN(auto builder, CreateStandardRuntimeBuilder(options));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  // Partially evaluates expression with x bound and y unknown.
+  absl::StatusOr<PartialEvaluationResult> PartiallyEvaluate(
+      absl::string_view expression, int64_t x) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr parsed_expr, Parse(expression));
+    CEL_ASSIGN_OR_RETURN(ast_, CreateAstFromParsedExpr(parsed_expr));
+    CEL_ASSIGN_OR_RETURN(auto program_ast,
+                         CreateAstFromParsedExpr(parsed_expr));
+    CEL_ASSIGN_OR_RETURN(auto program, runtime_->CreateTraceableProgram(
+                                           std::move(program_ast)));
+    Activation activation;
+    activation.InsertOrAssignValue("x", value_factory_.get().CreateIntValue(x));
+    activation.SetUnknownPatterns({AttributePattern("y", {})});
+    return cel::PartiallyEvaluate(*program, *ast_, activation,
+                                  value_factory_.get());
+  }
+
+  // Evaluates ast with only y bound.
+  absl::StatusOr<Handle<Value>> EvaluateResidual(std::unique_ptr<Ast> ast,
+                                                 int64_t y) {
+    CEL_ASSIGN_OR_RETURN(auto program,
+                         runtime_->CreateProgram(std::move(ast)));
+    Activation activation;
+    activation.InsertOrAssignValue("y", value_factory_.get().CreateIntValue(y));
+    return program->Evaluate(activation, value_factory_.get());
+  }
+
+  std::unique_ptr<const Runtime> runtime_;
+  std::unique_ptr<Ast> ast_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+TEST_F(ResidualAstTest, KnownResultHasNoResidual) {
+  ASSERT_OK_AND_ASSIGN(auto result, PartiallyEvaluate("x + 1", 5));
+
+  ASSERT_TRUE(result.value->Is<IntValue>());
+  EXPECT_EQ(result.value.As<IntValue>()->NativeValue(), 6);
+  EXPECT_THAT(result.residual_ast, IsNull());
+}
+
+TEST_F(ResidualAstTest, FoldsKnownSubexpressions) {
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       PartiallyEvaluate("x + 1 > 2 && y == x", 5));
+
+  ASSERT_TRUE(result.value->Is<UnknownValue>());
+  ASSERT_THAT(result.residual_ast, NotNull());
+  const auto& root =
+      AstImpl::CastFromPublicAst(*result.residual_ast).root_expr();
+  ASSERT_TRUE(root.has_call_expr());
+  const auto& args = root.call_expr().args();
+  ASSERT_EQ(args.size(), 2);
+  ASSERT_TRUE(args[0].has_const_expr());
+  EXPECT_TRUE(args[0].const_expr().bool_value());
+  // y == x only has x folded.
+  ASSERT_TRUE(args[1].has_call_expr());
+  EXPECT_TRUE(args[1].call_expr().args()[0].has_ident_expr());
+  ASSERT_TRUE(args[1].call_expr().args()[1].has_const_expr());
+  EXPECT_EQ(args[1].call_expr().args()[1].const_expr().int64_value(), 5);
+
+  // x is no longer needed.
+  ASSERT_OK_AND_ASSIGN(Handle<Value> value,
+                       EvaluateResidual(std::move(result.residual_ast), 5));
+  ASSERT_TRUE(value->Is<BoolValue>());
+  EXPECT_TRUE(value.As<BoolValue>()->NativeValue());
+}
+
+TEST_F(ResidualAstTest, DoesNotFoldLoopBody) {
+  ASSERT_OK_AND_ASSIGN(auto result,
+                       PartiallyEvaluate("[x, 2].exists(i, i == y)", 1));
+
+  ASSERT_TRUE(result.value->Is<UnknownValue>());
+  ASSERT_THAT(result.residual_ast, NotNull());
+
+  ASSERT_OK_AND_ASSIGN(Handle<Value> value,
+                       EvaluateResidual(std::move(result.residual_ast), 1));
+  ASSERT_TRUE(value->Is<BoolValue>());
+  EXPECT_TRUE(value.As<BoolValue>()->NativeValue());
+}
+
+TEST_F(ResidualAstTest, LeavesInputUnchanged) {
+  ASSERT_OK_AND_ASSIGN(auto result, PartiallyEvaluate("x < y", 1));
+
+  ASSERT_THAT(result.residual_ast, NotNull());
+  const auto& root = AstImpl::CastFromPublicAst(*ast_).root_expr();
+  EXPECT_TRUE(root.call_expr().args()[0].has_ident_expr());
+  EXPECT_TRUE(AstImpl::CastFromPublicAst(*result.residual_ast)
+                  .root_expr()
+                  .call_expr()
+                  .args()[0]
+                  .has_const_expr());
+}
+
+}  // namespace
+}  // namespace cel
@@ -0,0 +1,343 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/rule_list.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/error_value.h"
+#include "base/values/string_value.h"
+#include "base/values/unknown_value.h"
+#include "eval/compiler/subexpression_analysis.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/internal/errors.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+namespace runtime_internal {
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::CheckedExpr;
+using ::cel::ast_internal::Expr;
+using ::cel::ast_internal::Reference;
+using ::cel::ast_internal::SourceInfo;
+using ::google::api::expr::runtime::AppendAttributePath;
+using ::google::api::expr::runtime::ForEachChild;
+
+// Nesting limit of the decision DAG.
+constexpr int kMaxDepth = 4;
+
+// An equality test of an attribute to a string constant.
+struct EqualityTest {
+  // Attribute path, e.g. "request.method".
+  std::string attribute;
+  std::string constant;
+  // The rule testing the attribute, and the attribute in its AST.
+  size_t rule;
+  const Expr* attribute_expr;
+};
+
+// Collects the equality tests of the top-level conjunction expr. Only the
+// first test of each attribute is kept.
+void CollectEqualityTests(const AstImpl& ast, size_t rule, const Expr& expr,
+                          std::vector<EqualityTest>& tests) {
+  if (!expr.has_call_expr() || expr.call_expr().has_target() ||
+      expr.call_expr().args().size() != 2) {
+    return;
+  }
+  const auto& call = expr.call_expr();
+  if (call.function() == builtin::kAnd) {
+    CollectEqualityTests(ast, rule, call.args()[0], tests);
+    CollectEqualityTests(ast, rule, call.args()[1], tests);
+    return;
+  }
+  if (call.function() != builtin::kEqual) {
+    return;
+  }
+  const Expr* attribute = &call.args()[0];
+  const Expr* constant = &call.args()[1];
+  if (!constant->has_const_expr()) {
+    std::swap(attribute, constant);
+  }
+  if (!constant->has_const_expr() ||
+      !constant->const_expr().has_string_value()) {
+    return;
+  }
+  EqualityTest test;
+  if (!AppendAttributePath(ast, *attribute, test.attribute)) {
+    return;
+  }
+  for (const EqualityTest& other : tests) {
+    if (other.attribute == test.attribute) {
+      return;
+    }
+  }
+  test.constant = constant->const_expr().string_value();
+  test.rule = rule;
+  test.attribute_expr = attribute;
+  tests.push_back(std::move(test));
+}
+
+void CollectReferences(const AstImpl& ast, Expr& expr,
+                       absl::flat_hash_map<int64_t, Reference>& references) {
+  if (const Reference* reference = ast.GetReference(expr.id());
+      reference != nullptr) {
+    references.insert({expr.id(), *reference});
+  }
+  ForEachChild(expr, [&](Expr& child) {
+    CollectReferences(ast, child, references);
+  });
+}
+
+// Creates an AST evaluating the attribute expr of ast.
+std::unique_ptr<Ast> CreateAttributeAst(const AstImpl& ast, const Expr& expr) {
+  Expr attribute = expr.DeepCopy();
+  absl::flat_hash_map<int64_t, Reference> references;
+  CollectReferences(ast, attribute, references);
+  if (ast.IsChecked()) {
+    CheckedExpr checked_expr;
+    checked_expr.set_expr(std::move(attribute));
+    checked_expr.set_reference_map(std::move(references));
+    return std::make_unique<AstImpl>(std::move(checked_expr));
+  }
+  auto result =
+      std::make_unique<AstImpl>(std::move(attribute), SourceInfo());
+  result->reference_map() = std::move(references);
+  return result;
+}
+
+}  // namespace
+
+class RuleListBuilder {
+ public:
+  static absl::StatusOr<std::unique_ptr<RuleList>> Create(
+      const Runtime& runtime, std::vector<std::unique_ptr<Ast>> rules) {
+    std::vector<std::vector<EqualityTest>> tests(rules.size());
+    std::vector<size_t> indexes(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) {
+      if (rules[i] == nullptr) {
+        return absl::InvalidArgumentError("rule AST must not be null");
+      }
+      const AstImpl& ast = AstImpl::CastFromPublicAst(*rules[i]);
+      CollectEqualityTests(ast, i, ast.root_expr(), tests[i]);
+      indexes[i] = i;
+    }
+
+    auto rule_list = absl::WrapUnique(new RuleList());
+    RuleListBuilder builder(*rule_list, std::move(tests));
+    builder.Build(std::move(indexes), {});
+
+    for (const EqualityTest* test : builder.attributes_) {
+      // Evaluated like in the first rule testing the attribute.
+      CEL_ASSIGN_OR_RETURN(
+          rule_list->attributes_.emplace_back(),
+          runtime.CreateProgram(CreateAttributeAst(
+              AstImpl::CastFromPublicAst(*rules[test->rule]),
+              *test->attribute_expr)));
+    }
+    rule_list->rules_.reserve(rules.size());
+    for (auto& rule : rules) {
+      CEL_ASSIGN_OR_RETURN(rule_list->rules_.emplace_back(),
+                           runtime.CreateProgram(std::move(rule)));
+    }
+    return rule_list;
+  }
+
+ private:
+  RuleListBuilder(RuleList& rule_list,
+                  std::vector<std::vector<EqualityTest>> tests)
+      : rule_list_(rule_list), tests_(std::move(tests)) {}
+
+  // Builds the node for rules, given the attributes dispatched on already,
+  // and returns its index.
+  size_t Build(std::vector<size_t> rules, std::vector<std::string> dispatched) {
+    std::sort(dispatched.begin(), dispatched.end());
+    std::string key = absl::StrCat(absl::StrJoin(dispatched, ","), ";",
+                                   absl::StrJoin(rules, ","));
+    if (auto it = nodes_.find(key); it != nodes_.end()) {
+      return it->second;
+    }
+    size_t index = rule_list_.nodes_.size();
+    nodes_.insert({std::move(key), index});
+    rule_list_.nodes_.emplace_back().rules = rules;
+
+    if (dispatched.size() >= kMaxDepth) {
+      return index;
+    }
+    const EqualityTest* dispatch = ChooseAttribute(rules, dispatched);
+    if (dispatch == nullptr) {
+      return index;
+    }
+    std::string attribute = dispatch->attribute;
+    int attribute_index = AttributeIndex(*dispatch);
+    dispatched.push_back(attribute);
+
+    // Rules not testing the attribute may match whatever its value is.
+    std::vector<size_t> untested;
+    std::vector<std::string> constants;
+    for (size_t rule : rules) {
+      const EqualityTest* test = FindTest(rule, attribute);
+      if (test == nullptr) {
+        untested.push_back(rule);
+      } else if (std::find(constants.begin(), constants.end(),
+                           test->constant) == constants.end()) {
+        constants.push_back(test->constant);
+      }
+    }
+    absl::flat_hash_map<std::string, size_t> children;
+    for (const std::string& constant : constants) {
+      std::vector<size_t> child_rules;
+      for (size_t rule : rules) {
+        const EqualityTest* test = FindTest(rule, attribute);
+        if (test == nullptr || test->constant == constant) {
+          child_rules.push_back(rule);
+        }
+      }
+      children.insert({constant, Build(std::move(child_rules), dispatched)});
+    }
+    size_t default_child = Build(std::move(untested), dispatched);
+
+    // Not a reference, as building children may grow the nodes.
+    RuleList::Node& node = rule_list_.nodes_[index];
+    node.attribute = attribute_index;
+    node.children = std::move(children);
+    node.default_child = default_child;
+    return index;
+  }
+
+  const EqualityTest* FindTest(size_t rule, const std::string& attribute) {
+    for (const EqualityTest& test : tests_[rule]) {
+      if (test.attribute == attribute) {
+        return &test;
+      }
+    }
+    return nullptr;
+  }
+
+  // Returns a test of the attribute tested by most of rules, if at least two
+  // of them test one that isn't dispatched on already.
+  const EqualityTest* ChooseAttribute(
+      const std::vector<size_t>& rules,
+      const std::vector<std::string>& dispatched) {
+    absl::flat_hash_map<std::string, size_t> counts;
+    const EqualityTest* best = nullptr;
+    size_t best_count = 1;
+    for (size_t rule : rules) {
+      for (const EqualityTest& test : tests_[rule]) {
+        if (std::find(dispatched.begin(), dispatched.end(), test.attribute) !=
+            dispatched.end()) {
+          continue;
+        }
+        size_t count = ++counts[test.attribute];
+        if (count > best_count) {
+          best = &test;
+          best_count = count;
+        }
+      }
+    }
+    return best;
+  }
+
+  int AttributeIndex(const EqualityTest& test) {
+    for (size_t i = 0; i < attributes_.size(); ++i) {
+      if (attributes_[i]->attribute == test.attribute) {
+        return i;
+      }
+    }
+    attributes_.push_back(&test);
+    return attributes_.size() - 1;
+  }
+
+  RuleList& rule_list_;
+  std::vector<std::vector<EqualityTest>> tests_;
+  // The attribute dispatched on by each attribute index, as the test that
+  // introduced it.
+  std::vector<const EqualityTest*> attributes_;
+  absl::flat_hash_map<std::string, size_t> nodes_;
+};
+
+}  // namespace runtime_internal
+
+absl::StatusOr<Handle<Value>> RuleList::Evaluate(
+    const ActivationInterface& activation, ValueFactory& value_factory) const {
+  struct ChildFinder {
+    size_t operator()(absl::string_view value) const {
+      auto child = node.children.find(value);
+      return child != node.children.end() ? child->second : node.default_child;
+    }
+    size_t operator()(const absl::Cord& value) const {
+      return (*this)(static_cast<std::string>(value));
+    }
+
+    const Node& node;
+  };
+
+  size_t index = 0;
+  while (nodes_[index].attribute >= 0) {
+    const Node& node = nodes_[index];
+    CEL_ASSIGN_OR_RETURN(
+        Handle<Value> value,
+        attributes_[node.attribute]->Evaluate(activation, value_factory));
+    if (!value->Is<StringValue>()) {
+      break;
+    }
+    index = value->As<StringValue>().Visit(ChildFinder{node});
+  }
+  for (size_t rule : nodes_[index].rules) {
+    CEL_ASSIGN_OR_RETURN(Handle<Value> value,
+                         rules_[rule]->Evaluate(activation, value_factory));
+    if (!value->Is<BoolValue>()) {
+      if (value->Is<ErrorValue>() || value->Is<UnknownValue>()) {
+        return value;
+      }
+      return value_factory.CreateErrorValue(
+          runtime_internal::CreateNoMatchingOverloadError(builtin::kTernary));
+    }
+    if (value->As<BoolValue>().NativeValue()) {
+      return value_factory.CreateIntValue(rule);
+    }
+  }
+  return value_factory.CreateIntValue(-1);
+}
+
+absl::StatusOr<std::unique_ptr<RuleList>> CreateRuleList(
+    const Runtime& runtime, std::vector<std::unique_ptr<Ast>> rules) {
+  return runtime_internal::RuleListBuilder::Create(runtime, std::move(rules));
+}
+
+}  // namespace cel
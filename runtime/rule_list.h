@@ -0,0 +1,91 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_RULE_LIST_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_RULE_LIST_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace runtime_internal {
+class RuleListBuilder;
+}  // namespace runtime_internal
+
+// Ordered boolean expressions (rules) evaluated until one of them is true,
+// such as the rules of a firewall.
+//
+// Created with CreateRuleList. Thread-safe like Program.
+class RuleList final {
+ public:
+  // Number of rules in the list.
+  size_t size() const { return rules_.size(); }
+
+  // Returns the index of the first rule that is true as an int value, or -1
+  // if none is. If an earlier rule evaluates to an error, an unknown or a
+  // value that is not a bool, that is returned instead: the result is the
+  // same as for `rule_0 ? 0 : rule_1 ? 1 : ... : -1`.
+  //
+  // Rules that can't match are not evaluated. Rules are indexed on the
+  // equality tests of their top-level conjunctions that compare an attribute
+  // (e.g. `request.method`) to a string constant, so an attribute tested by
+  // many rules is evaluated once and its value selects the rules left to
+  // evaluate with a hash lookup. If the attribute isn't a string (e.g. it is
+  // an error), the remaining rules are evaluated in order.
+  absl::StatusOr<Handle<Value>> Evaluate(const ActivationInterface& activation,
+                                         ValueFactory& value_factory) const;
+
+ private:
+  friend class runtime_internal::RuleListBuilder;
+
+  // A node of the decision DAG. Nodes reached with the same remaining rules
+  // and tested attributes are shared.
+  struct Node {
+    // The rules that may still match, in order.
+    std::vector<size_t> rules;
+    // Index of the attribute dispatched on, or -1 for leaves.
+    int attribute = -1;
+    // Node for each constant the attribute is compared to.
+    absl::flat_hash_map<std::string, size_t> children;
+    // Node for other strings.
+    size_t default_child = 0;
+  };
+
+  RuleList() = default;
+
+  std::vector<std::unique_ptr<Program>> rules_;
+  std::vector<std::unique_ptr<Program>> attributes_;
+  // The root is nodes_[0].
+  std::vector<Node> nodes_;
+};
+
+// Plan rules in runtime and build their decision DAG.
+absl::StatusOr<std::unique_ptr<RuleList>> CreateRuleList(
+    const Runtime& runtime, std::vector<std::unique_ptr<Ast>> rules);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_RULE_LIST_H_
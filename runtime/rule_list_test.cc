@@ -0,0 +1,188 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/rule_list.h"
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/function.h"
+#include "base/function_descriptor.h"
+#include "base/handle.h"
+#include "base/kind.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "common/json.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+// hit(int) -> true, recording its argument.
+class HitFunction : public Function {
+ public:
+  explicit HitFunction(std::vector<int64_t>* hits) : hits_(hits) {}
+
+  absl::StatusOr<Handle<Value>> Invoke(
+      const FunctionEvaluationContext& context,
+      absl::Span<const Handle<Value>> args) const override {
+    hits_->push_back(args[0].As<IntValue>()->NativeValue());
+    return context.value_factory().CreateBoolValue(true);
+  }
+
+ private:
+  std::vector<int64_t>* hits_;
+};
+
+// Each rule records that it was evaluated before testing anything.
+constexpr absl::string_view kRules[] = {
+    "hit(0) && request.method == 'GET' && request.path == '/a'",
+    "hit(1) && request.method == 'POST'",
+    "hit(2) && 'GET' == request.method && request.path == '/b'",
+    "hit(3) && request.path == '/b'",
+    "hit(4) && request.method == 'PUT'",
+    "hit(5) && request.method == 'GET'",
+};
+
+class RuleListTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK(builder.function_registry().Register(
+        FunctionDescriptor("hit", false, {Kind::kInt}),
+        std::make_unique<HitFunction>(&hits_)));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+
+    std::vector<std::unique_ptr<Ast>> rules;
+    for (absl::string_view rule : kRules) {
+      ASSERT_OK_AND_ASSIGN(rules.emplace_back(), ParseAst(rule));
+    }
+    ASSERT_OK_AND_ASSIGN(rule_list_,
+                         CreateRuleList(*runtime_, std::move(rules)));
+
+    // The equivalent expression evaluating each rule in order.
+    std::string chain = "-1";
+    for (int i = std::size(kRules) - 1; i >= 0; --i) {
+      chain = absl::StrCat("(", kRules[i], ") ? ", i, " : ", chain);
+    }
+    ASSERT_OK_AND_ASSIGN(auto chain_ast, ParseAst(chain));
+    ASSERT_OK_AND_ASSIGN(chain_, runtime_->CreateProgram(std::move(chain_ast)));
+  }
+
+  absl::StatusOr<std::unique_ptr<Ast>> ParseAst(absl::string_view expr) {
+    CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+    return CreateAstFromParsedExpr(std::move(parsed_expr));
+  }
+
+  // Evaluates the rules for a request, checking that the result is the same
+  // as for the chain of conditionals.
+  absl::StatusOr<Handle<Value>> Evaluate(Json method, absl::string_view path) {
+    ValueFactory& value_factory = value_factory_.get();
+    Activation activation;
+    activation.InsertOrAssignValue(
+        "request", value_factory.CreateMapValueFromJson(MakeJsonObject(
+                       {{JsonString("method"), std::move(method)},
+                        {JsonString("path"), JsonString(path)}})));
+
+    CEL_ASSIGN_OR_RETURN(Handle<Value> expected,
+                         chain_->Evaluate(activation, value_factory));
+    hits_.clear();
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         rule_list_->Evaluate(activation, value_factory));
+    EXPECT_EQ(result->DebugString(), expected->DebugString());
+    return result;
+  }
+
+ protected:
+  std::vector<int64_t> hits_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+  std::unique_ptr<const Runtime> runtime_;
+  std::unique_ptr<RuleList> rule_list_;
+  std::unique_ptr<Program> chain_;
+};
+
+TEST_F(RuleListTest, DispatchesOnTestedAttributes) {
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       Evaluate(JsonString("GET"), "/b"));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 2);
+  EXPECT_THAT(hits_, ElementsAre(2));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate(JsonString("GET"), "/c"));
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 5);
+  EXPECT_THAT(hits_, ElementsAre(5));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate(JsonString("PUT"), "/b"));
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 3);
+  EXPECT_THAT(hits_, ElementsAre(3));
+}
+
+TEST_F(RuleListTest, NoMatch) {
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       Evaluate(JsonString("DELETE"), "/c"));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), -1);
+  EXPECT_THAT(hits_, ElementsAre(3));
+
+  ASSERT_OK_AND_ASSIGN(result, Evaluate(JsonString("POST"), "/a"));
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 1);
+  EXPECT_THAT(hits_, ElementsAre(1));
+}
+
+TEST_F(RuleListTest, EvaluatesInOrderIfAttributeIsNotAString) {
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result, Evaluate(Json(1.0), "/b"));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 3);
+  EXPECT_THAT(hits_, ElementsAre(0, 1, 2, 3));
+}
+
+TEST_F(RuleListTest, Empty) {
+  ASSERT_OK_AND_ASSIGN(auto rule_list, CreateRuleList(*runtime_, {}));
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       rule_list->Evaluate(activation, value_factory_.get()));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), -1);
+  EXPECT_THAT(hits_, IsEmpty());
+}
+
+}  // namespace
+}  // namespace cel
@@ -19,12 +19,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "base/ast.h"
 #include "base/handle.h"
 #include "base/type_provider.h"
@@ -32,7 +34,13 @@
 #include "base/value_factory.h"
 #include "common/native_type.h"
 #include "runtime/activation_interface.h"
+#include "runtime/cost_estimate.h"
+#include "runtime/evaluation_cost.h"
+#include "runtime/evaluation_profile.h"
+#include "runtime/planner_stats.h"
+#include "runtime/referenced_attribute.h"
 #include "runtime/runtime_issue.h"
+#include "runtime/trace_recorder.h"
 
 namespace cel {
 
@@ -77,7 +85,49 @@ class Program {
       const ActivationInterface& activation,
       ValueFactory& value_factory) const = 0;
 
+  // Evaluate the program once for each activation.
+  //
+  // Results are returned in activation order. A non-ok status for any
+  // activation stops the batch and is returned. This is equivalent to
+  // calling Evaluate for each activation, but implementations may amortize
+  // per-evaluation setup across the batch.
+  virtual absl::StatusOr<std::vector<Handle<Value>>> EvaluateBatch(
+      absl::Span<const ActivationInterface* const> activations,
+      ValueFactory& value_factory) const {
+    std::vector<Handle<Value>> results;
+    results.reserve(activations.size());
+    for (const ActivationInterface* activation : activations) {
+      absl::StatusOr<Handle<Value>> result =
+          Evaluate(*activation, value_factory);
+      if (!result.ok()) {
+        return std::move(result).status();
+      }
+      results.push_back(*std::move(result));
+    }
+    return results;
+  }
+
   virtual const TypeProvider& GetTypeProvider() const = 0;
+
+  // Returns the names of the variables the program may look up in the
+  // activation, each listed once. A BoundActivation created for these names
+  // lets the program read variables by position instead of by name.
+  //
+  // The returned span is valid for the lifetime of the program. May be empty
+  // if the implementation does not support binding variables by position.
+  virtual absl::Span<const std::string> GetVariableNames() const { return {}; }
+
+  // Returns the attributes of the activation the program may read, e.g. so
+  // that expensive variables can be fetched ahead of evaluation, and those
+  // only read conditionally fetched lazily. Derived from the expression, so
+  // attributes only read by extension functions are not included.
+  //
+  // The returned span is valid for the lifetime of the program. May be empty
+  // if the implementation does not support the analysis.
+  virtual absl::Span<const ReferencedAttribute> GetReferencedAttributes()
+      const {
+    return {};
+  }
 };
 
 // Representation for a traceable CEL expression.
@@ -108,6 +158,45 @@ class TraceableProgram : public Program {
   virtual absl::StatusOr<Handle<Value>> Trace(
       const ActivationInterface&, EvaluationListener evaluation_listener,
       ValueFactory& value_factory) const = 0;
+
+  // Evaluate the Program plan while gathering per expression execution
+  // counts, wall time and allocations into profile.
+  //
+  // Statistics are added to those already in profile, so one profile may
+  // accumulate several evaluations. Profiling adds a clock read per step and
+  // disables multi-threaded evaluation of comprehensions; it is intended for
+  // finding expensive subexpressions, not for every request.
+  virtual absl::StatusOr<Handle<Value>> Profile(
+      const ActivationInterface& activation, EvaluationProfile& profile,
+      ValueFactory& value_factory) const {
+    return absl::UnimplementedError("Profiling is not supported");
+  }
+
+  // Evaluate the Program plan, adding the actual steps, comprehension
+  // iterations, function call costs and allocations of the evaluation to
+  // cost. The cost is recorded even if evaluation fails, e.g. because it
+  // exceeds RuntimeOptions::max_evaluation_cost.
+  //
+  // Counting costs disables multi-threaded evaluation of comprehensions.
+  virtual absl::StatusOr<Handle<Value>> EvaluateWithCost(
+      const ActivationInterface& activation, EvaluationCost& cost,
+      ValueFactory& value_factory) const {
+    return absl::UnimplementedError("Cost tracking is not supported");
+  }
+
+  // Evaluate the Program plan, appending the result of each program step
+  // that corresponds to an AST node to recorder.
+  //
+  // Recording is much cheaper than tracing with a listener, so it is meant to
+  // be left on, e.g. for audits. It is not subject to
+  // RuntimeOptions::trace_sample_interval, but only records the expressions
+  // in RuntimeOptions::trace_expr_ids if set. Recording disables
+  // multi-threaded evaluation of comprehensions.
+  virtual absl::StatusOr<Handle<Value>> Record(
+      const ActivationInterface& activation, TraceRecorder& recorder,
+      ValueFactory& value_factory) const {
+    return absl::UnimplementedError("Trace recording is not supported");
+  }
 };
 
 // Interface for a CEL runtime.
@@ -122,6 +211,32 @@ class Runtime {
     // Optional output for collecting issues encountered while planning.
     // If non-null, vector is cleared and encountered issues are added.
     std::vector<RuntimeIssue>* issues = nullptr;
+
+    // Optional output for a static estimate of the cost of evaluating the
+    // program, e.g. to reject expressions that are too expensive before
+    // running them.
+    CostEstimate* cost_estimate = nullptr;
+    // Sizes assumed by cost_estimate.
+    CostEstimateOptions cost_estimate_options;
+
+    // Optional output for the time and allocations spent planning, by phase.
+    // If the program is found in the program cache, only its footprint is
+    // recorded.
+    PlannerStats* planner_stats = nullptr;
+
+    // Optional profile of earlier evaluations of the same AST, e.g. collected
+    // in production with TraceableProgram::Profile and restored with
+    // EvaluationProfile::Parse. The side-effect-free clauses of `&&` and `||`
+    // chains are ordered so that cheap clauses which usually decide the chain
+    // run first. When several clauses of a chain evaluate to errors, a
+    // different one of them may be reported. Programs planned with a profile
+    // are not cached.
+    const EvaluationProfile* profile = nullptr;
+
+    // Label the program is reported with to RuntimeOptions::metrics_sink,
+    // e.g. the name of the rule it implements. Programs of the same AST with
+    // different labels are cached separately.
+    std::string metrics_label;
   };
 
   virtual ~Runtime() = default;
@@ -33,7 +33,12 @@ class RuntimeFriendAccess;
 }  // namespace runtime_internal
 
 class RuntimeBuilder;
+struct FrozenRuntimeRegistries;
 RuntimeBuilder CreateRuntimeBuilder(const RuntimeOptions&);
+RuntimeBuilder CreateRuntimeBuilder(std::shared_ptr<const FunctionRegistry>,
+                                    const RuntimeOptions&);
+RuntimeBuilder ForkRuntimeBuilder(const FrozenRuntimeRegistries&,
+                                  const RuntimeOptions&);
 
 // RuntimeBuilder provides mutable accessors to configure a new runtime.
 //
@@ -61,6 +66,10 @@ class RuntimeBuilder {
  private:
   friend class runtime_internal::RuntimeFriendAccess;
   friend RuntimeBuilder CreateRuntimeBuilder(const RuntimeOptions&);
+  friend RuntimeBuilder CreateRuntimeBuilder(
+      std::shared_ptr<const FunctionRegistry>, const RuntimeOptions&);
+  friend RuntimeBuilder ForkRuntimeBuilder(const FrozenRuntimeRegistries&,
+                                           const RuntimeOptions&);
 
   // Constructor for a new runtime builder.
   //
@@ -17,26 +17,145 @@
 #include <memory>
 #include <utility>
 
+#include "absl/log/absl_check.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "common/native_type.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "runtime/algebraic_simplification.h"
+#include "runtime/common_subexpression_elimination.h"
+#include "runtime/comprehension_fusion.h"
+#include "runtime/function_registry.h"
+#include "runtime/fused_selects.h"
+#include "runtime/internal/runtime_friend_access.h"
 #include "runtime/internal/runtime_impl.h"
+#include "runtime/register_operands.h"
+#include "runtime/runtime.h"
 #include "runtime/runtime_builder.h"
 #include "runtime/runtime_options.h"
+#include "runtime/standard_operator_steps.h"
+#include "runtime/type_registry.h"
 
 namespace cel {
 
+namespace {
+
+// Returns options with the planner features that are registered by their
+// extension cleared. EnablePlannerFeatures sets them again when registering
+// the features.
+RuntimeOptions WithoutPlannerFeatures(RuntimeOptions options) {
+  options.enable_algebraic_simplification = false;
+  options.enable_comprehension_fusion = false;
+  options.enable_common_subexpression_elimination = false;
+  options.enable_register_operands = false;
+  options.enable_fused_selects = false;
+  options.enable_standard_operator_steps = false;
+  return options;
+}
+
+// Enables the planner features set in options, as the extensions would, in
+// the order the legacy CelExpressionBuilder factory registers them.
+RuntimeBuilder EnablePlannerFeatures(RuntimeBuilder builder,
+                                     const RuntimeOptions& options) {
+  absl::Status status;
+  if (options.enable_algebraic_simplification) {
+    status.Update(extensions::EnableAlgebraicSimplification(builder));
+  }
+  if (options.enable_comprehension_fusion) {
+    status.Update(extensions::EnableComprehensionFusion(builder));
+  }
+  if (options.enable_common_subexpression_elimination) {
+    status.Update(extensions::EnableCommonSubexpressionElimination(builder));
+  }
+  if (options.enable_register_operands) {
+    status.Update(extensions::EnableRegisterOperands(builder));
+  }
+  if (options.enable_fused_selects) {
+    status.Update(extensions::EnableFusedSelects(builder));
+  }
+  if (options.enable_standard_operator_steps) {
+    status.Update(extensions::EnableStandardOperatorSteps(builder));
+  }
+  // The extensions only fail for runtimes other than RuntimeImpl.
+  ABSL_CHECK(status.ok()) << status;
+  return builder;
+}
+
+}  // namespace
+
 RuntimeBuilder CreateRuntimeBuilder(const RuntimeOptions& options) {
   // TODO(uncreated-issue/57): and internal API for adding extensions that need to
   // downcast to the runtime impl.
   // TODO(uncreated-issue/56): add API for attaching an issue listener (replacing the
   // vector<status> overloads).
-  auto mutable_runtime =
-      std::make_unique<runtime_internal::RuntimeImpl>(options);
+  auto mutable_runtime = std::make_unique<runtime_internal::RuntimeImpl>(
+      WithoutPlannerFeatures(options));
+  mutable_runtime->expr_builder().set_container(options.container);
+
+  auto& type_registry = mutable_runtime->type_registry();
+  auto& function_registry = mutable_runtime->function_registry();
+
+  return EnablePlannerFeatures(
+      RuntimeBuilder(type_registry, function_registry,
+                     std::move(mutable_runtime)),
+      options);
+}
+
+RuntimeBuilder CreateRuntimeBuilder(
+    std::shared_ptr<const FunctionRegistry> base_functions,
+    const RuntimeOptions& options) {
+  auto mutable_runtime = std::make_unique<runtime_internal::RuntimeImpl>(
+      WithoutPlannerFeatures(options), std::move(base_functions));
+  mutable_runtime->expr_builder().set_container(options.container);
+
+  auto& type_registry = mutable_runtime->type_registry();
+  auto& function_registry = mutable_runtime->function_registry();
+
+  return EnablePlannerFeatures(
+      RuntimeBuilder(type_registry, function_registry,
+                     std::move(mutable_runtime)),
+      options);
+}
+
+absl::StatusOr<FrozenRuntimeRegistries> FreezeRuntimeBuilder(
+    RuntimeBuilder builder) {
+  CEL_ASSIGN_OR_RETURN(std::unique_ptr<const Runtime> runtime,
+                       std::move(builder).Build());
+  if (runtime_internal::RuntimeFriendAccess::RuntimeTypeId(*runtime) !=
+      NativeTypeId::For<runtime_internal::RuntimeImpl>()) {
+    return absl::UnimplementedError(
+        "freezing is only supported on the default cel::Runtime "
+        "implementation.");
+  }
+  // The registries outlive the runtime, the environment is kept alive by the
+  // aliasing pointers.
+  std::shared_ptr<const runtime_internal::RuntimeImpl::Environment>
+      environment =
+          cel::internal::down_cast<const runtime_internal::RuntimeImpl&>(
+              *runtime)
+              .environment();
+  return FrozenRuntimeRegistries{
+      std::shared_ptr<const FunctionRegistry>(
+          environment, &environment->function_registry),
+      std::shared_ptr<const TypeRegistry>(environment,
+                                          &environment->type_registry)};
+}
+
+RuntimeBuilder ForkRuntimeBuilder(const FrozenRuntimeRegistries& base,
+                                  const RuntimeOptions& options) {
+  auto mutable_runtime = std::make_unique<runtime_internal::RuntimeImpl>(
+      WithoutPlannerFeatures(options), base.function_registry,
+      base.type_registry);
   mutable_runtime->expr_builder().set_container(options.container);
 
   auto& type_registry = mutable_runtime->type_registry();
   auto& function_registry = mutable_runtime->function_registry();
 
-  return RuntimeBuilder(type_registry, function_registry,
-                        std::move(mutable_runtime));
+  return EnablePlannerFeatures(
+      RuntimeBuilder(type_registry, function_registry,
+                     std::move(mutable_runtime)),
+      options);
 }
 
 }  // namespace cel
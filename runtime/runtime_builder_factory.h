@@ -15,8 +15,13 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_BUILDER_FACTORY_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_BUILDER_FACTORY_H_
 
+#include <memory>
+
+#include "absl/status/statusor.h"
+#include "runtime/function_registry.h"
 #include "runtime/runtime_builder.h"
 #include "runtime/runtime_options.h"
+#include "runtime/type_registry.h"
 
 namespace cel {
 
@@ -28,6 +33,45 @@ namespace cel {
 // Callers must register appropriate builtins.
 RuntimeBuilder CreateRuntimeBuilder(const RuntimeOptions& options);
 
+// Create a builder whose function registry is layered on top of
+// base_functions: functions registered with the builder are only visible to
+// the built runtime, and lookups also consider the functions of
+// base_functions.
+//
+// base_functions is shared rather than copied, so many runtimes (e.g. one per
+// tenant) can be backed by a single registry with the standard definitions.
+// It must have been populated for options compatible with options.
+RuntimeBuilder CreateRuntimeBuilder(
+    std::shared_ptr<const FunctionRegistry> base_functions,
+    const RuntimeOptions& options);
+
+// The function and type registries of a configured builder, frozen so that
+// they can be shared by many runtimes (see ForkRuntimeBuilder).
+struct FrozenRuntimeRegistries {
+  std::shared_ptr<const FunctionRegistry> function_registry;
+  std::shared_ptr<const TypeRegistry> type_registry;
+};
+
+// Consumes builder and returns its registries, which can no longer be
+// modified. Typically builder was created with CreateStandardRuntimeBuilder
+// and has the extensions shared by all tenants registered.
+//
+// Only the registries are kept: planner extensions enabled on builder (e.g.
+// constant folding or reference resolution) must be enabled again on each
+// forked builder.
+absl::StatusOr<FrozenRuntimeRegistries> FreezeRuntimeBuilder(
+    RuntimeBuilder builder);
+
+// Create a builder whose registries are layered on top of base: functions
+// and types registered with the builder are only visible to the built
+// runtime, and lookups also consider those of base.
+//
+// Nothing is copied from base or registered again, so forking is cheap
+// enough to build a runtime per tenant on demand. base must have been
+// populated for options compatible with options.
+RuntimeBuilder ForkRuntimeBuilder(const FrozenRuntimeRegistries& base,
+                                  const RuntimeOptions& options);
+
 }  // namespace cel
 
 #endif  // THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_BUILDER_FACTORY_H_
@@ -0,0 +1,177 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "runtime/runtime_builder_factory.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "base/function_adapter.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/casts.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/internal/runtime_friend_access.h"
+#include "runtime/internal/runtime_impl.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_operator_steps.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::EnableStandardOperatorSteps;
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::cel::internal::down_cast;
+using ::cel::runtime_internal::RuntimeFriendAccess;
+using ::cel::runtime_internal::RuntimeImpl;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using cel::internal::IsOkAndHolds;
+using cel::internal::StatusIs;
+using testing::HasSubstr;
+
+absl::Status RegisterConstant(RuntimeBuilder& builder, const std::string& name,
+                              int64_t value) {
+  return builder.function_registry()
+      .Register(UnaryFunctionAdapter<int64_t, int64_t>::CreateDescriptor(
+                    name, /*receiver_style=*/false),
+                UnaryFunctionAdapter<int64_t, int64_t>::WrapFunction(
+                    [value](ValueFactory&, int64_t x) { return x + value; }));
+}
+
+absl::StatusOr<int64_t> EvaluateInt(const Runtime& runtime,
+                                    const std::string& expr) {
+  CEL_ASSIGN_OR_RETURN(ParsedExpr parsed, Parse(expr));
+  CEL_ASSIGN_OR_RETURN(std::unique_ptr<Program> program,
+                       ProtobufRuntimeAdapter::CreateProgram(runtime, parsed));
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    MemoryManagerRef::ReferenceCounting());
+  Activation activation;
+  CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory.get()));
+  if (!result->Is<IntValue>()) {
+    return absl::InvalidArgumentError(result->DebugString());
+  }
+  return result.As<IntValue>()->NativeValue();
+}
+
+const RuntimeOptions& PlannerOptions(RuntimeBuilder& builder) {
+  Runtime& runtime = RuntimeFriendAccess::GetMutableRuntime(builder);
+  return down_cast<RuntimeImpl&>(runtime).expr_builder().options();
+}
+
+TEST(CreateRuntimeBuilderTest, EnablesPlannerFeaturesOfOptions) {
+  RuntimeOptions options;
+  options.enable_standard_operator_steps = true;
+  options.enable_fused_selects = true;
+  ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                       CreateStandardRuntimeBuilder(options));
+  EXPECT_TRUE(PlannerOptions(builder).enable_standard_operator_steps);
+  EXPECT_TRUE(PlannerOptions(builder).enable_fused_selects);
+  EXPECT_FALSE(PlannerOptions(builder).enable_register_operands);
+  // Already enabled, not registered again.
+  ASSERT_OK(EnableStandardOperatorSteps(builder));
+
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+  EXPECT_THAT(EvaluateInt(*runtime, "1 + 2 + [3].size() + 4"),
+              IsOkAndHolds(8));
+}
+
+TEST(CreateRuntimeBuilderTest, ExtensionsSetPlannerOptions) {
+  ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                       CreateStandardRuntimeBuilder(RuntimeOptions()));
+  EXPECT_FALSE(PlannerOptions(builder).enable_standard_operator_steps);
+  ASSERT_OK(EnableStandardOperatorSteps(builder));
+  EXPECT_TRUE(PlannerOptions(builder).enable_standard_operator_steps);
+}
+
+class ForkRuntimeBuilderTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK(RegisterConstant(builder, "shared", 100));
+    ASSERT_OK_AND_ASSIGN(base_, FreezeRuntimeBuilder(std::move(builder)));
+  }
+
+ protected:
+  FrozenRuntimeRegistries base_;
+};
+
+TEST_F(ForkRuntimeBuilderTest, TenantsShareBaseFunctions) {
+  RuntimeBuilder first = ForkRuntimeBuilder(base_, RuntimeOptions());
+  ASSERT_OK(RegisterConstant(first, "tenant", 1));
+  ASSERT_OK_AND_ASSIGN(auto first_runtime, std::move(first).Build());
+
+  RuntimeBuilder second = ForkRuntimeBuilder(base_, RuntimeOptions());
+  ASSERT_OK(RegisterConstant(second, "tenant", 2));
+  ASSERT_OK_AND_ASSIGN(auto second_runtime, std::move(second).Build());
+
+  EXPECT_THAT(EvaluateInt(*first_runtime, "shared(tenant(1)) * 2"),
+              IsOkAndHolds(204));
+  EXPECT_THAT(EvaluateInt(*second_runtime, "shared(tenant(1)) * 2"),
+              IsOkAndHolds(206));
+}
+
+TEST_F(ForkRuntimeBuilderTest, TenantFunctionsAreNotShared) {
+  RuntimeBuilder first = ForkRuntimeBuilder(base_, RuntimeOptions());
+  ASSERT_OK(RegisterConstant(first, "tenant", 1));
+  ASSERT_OK_AND_ASSIGN(auto first_runtime, std::move(first).Build());
+
+  ASSERT_OK_AND_ASSIGN(auto other_runtime,
+                       ForkRuntimeBuilder(base_, RuntimeOptions()).Build());
+  EXPECT_THAT(EvaluateInt(*other_runtime, "tenant(1)"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("No overloads provided")));
+}
+
+TEST_F(ForkRuntimeBuilderTest, BaseOverloadsCannotBeRedefined) {
+  RuntimeBuilder builder = ForkRuntimeBuilder(base_, RuntimeOptions());
+  EXPECT_THAT(RegisterConstant(builder, "shared", 1),
+              StatusIs(absl::StatusCode::kAlreadyExists));
+}
+
+TEST_F(ForkRuntimeBuilderTest, OptionsAreNotShared) {
+  RuntimeOptions options;
+  options.comprehension_max_iterations = 2;
+  ASSERT_OK_AND_ASSIGN(auto limited,
+                       ForkRuntimeBuilder(base_, options).Build());
+  ASSERT_OK_AND_ASSIGN(auto unlimited,
+                       ForkRuntimeBuilder(base_, RuntimeOptions()).Build());
+
+  constexpr char kExpr[] = "[1, 2, 3].map(x, shared(x)).size()";
+  EXPECT_THAT(EvaluateInt(*limited, kExpr),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(EvaluateInt(*unlimited, kExpr), IsOkAndHolds(3));
+}
+
+}  // namespace
+}  // namespace cel
@@ -0,0 +1,88 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/runtime_metrics.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace cel {
+
+namespace {
+
+void Add(std::atomic<int64_t>& counter, int64_t value) {
+  counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t Get(const std::atomic<int64_t>& counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+void RuntimeMetricsCounters::OnEvaluation(const EvaluationMetrics& metrics) {
+  Add(evaluations_, 1);
+  switch (metrics.outcome) {
+    case EvaluationOutcome::kValue:
+      break;
+    case EvaluationOutcome::kError:
+      Add(errors_, 1);
+      break;
+    case EvaluationOutcome::kUnknown:
+      Add(unknowns_, 1);
+      break;
+    case EvaluationOutcome::kFailure:
+      Add(failures_, 1);
+      break;
+  }
+  Add(evaluation_wall_nanos_, absl::ToInt64Nanoseconds(metrics.wall_time));
+  if (metrics.comprehension_iterations != 0) {
+    Add(comprehension_iterations_, metrics.comprehension_iterations);
+  }
+  if (metrics.allocated_bytes != 0) {
+    Add(allocated_bytes_, metrics.allocated_bytes);
+  }
+  if (metrics.type_cache_misses != 0) {
+    Add(type_cache_misses_, metrics.type_cache_misses);
+  }
+}
+
+void RuntimeMetricsCounters::OnProgramPlanned(const PlanningMetrics& metrics) {
+  Add(programs_planned_, 1);
+  Add(planning_wall_nanos_, absl::ToInt64Nanoseconds(metrics.wall_time));
+  if (metrics.step_arena_bytes != 0) {
+    Add(step_arena_bytes_, static_cast<int64_t>(metrics.step_arena_bytes));
+  }
+}
+
+RuntimeMetricsCounters::Snapshot RuntimeMetricsCounters::Read() const {
+  Snapshot snapshot;
+  snapshot.evaluations = Get(evaluations_);
+  snapshot.errors = Get(errors_);
+  snapshot.unknowns = Get(unknowns_);
+  snapshot.failures = Get(failures_);
+  snapshot.evaluation_wall_time =
+      absl::Nanoseconds(Get(evaluation_wall_nanos_));
+  snapshot.comprehension_iterations = Get(comprehension_iterations_);
+  snapshot.allocated_bytes = Get(allocated_bytes_);
+  snapshot.type_cache_misses = Get(type_cache_misses_);
+  snapshot.programs_planned = Get(programs_planned_);
+  snapshot.planning_wall_time = absl::Nanoseconds(Get(planning_wall_nanos_));
+  snapshot.step_arena_bytes = Get(step_arena_bytes_);
+  return snapshot;
+}
+
+}  // namespace cel
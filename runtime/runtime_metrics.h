@@ -0,0 +1,150 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_METRICS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_METRICS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace cel {
+
+// Outcome of an evaluation.
+enum class EvaluationOutcome {
+  // The result is a value other than an error or unknown.
+  kValue,
+  // The result is an error value.
+  kError,
+  // The result is an unknown value.
+  kUnknown,
+  // The evaluation returned a non-ok status, e.g. because it exceeded a
+  // budget.
+  kFailure,
+};
+
+// Statistics of one evaluation, reported to RuntimeMetricsSink::OnEvaluation.
+struct EvaluationMetrics {
+  // Label of the program (see Runtime::CreateProgramOptions::metrics_label).
+  // Empty for programs created without a label. Only valid during the call.
+  absl::string_view program_label;
+
+  EvaluationOutcome outcome = EvaluationOutcome::kValue;
+
+  absl::Duration wall_time = absl::ZeroDuration();
+
+  // Comprehension iterations, including those of comprehensions evaluated on
+  // other threads.
+  int64_t comprehension_iterations = 0;
+
+  // Bytes used in the arena owned by the evaluator state, as reported by
+  // Arena::SpaceUsed. Zero for evaluations whose memory is managed by the
+  // caller, e.g. on a caller provided arena.
+  int64_t allocated_bytes = 0;
+
+  // Type names the type manager of the evaluation could not find in its
+  // cache and resolved through the type provider.
+  int64_t type_cache_misses = 0;
+};
+
+// Statistics of planning one program, reported to
+// RuntimeMetricsSink::OnProgramPlanned.
+struct PlanningMetrics {
+  // As for EvaluationMetrics.
+  absl::string_view program_label;
+
+  // Total time spent planning. See PlannerStats for a breakdown by phase.
+  absl::Duration wall_time = absl::ZeroDuration();
+
+  // Number of steps of the program.
+  size_t program_steps = 0;
+
+  // Bytes reserved for the steps of the program by its step arena, from the
+  // heap or RuntimeOptions::plan_allocator. Zero without a step arena.
+  size_t step_arena_bytes = 0;
+};
+
+// Receives statistics about the work of a runtime, e.g. to export them to a
+// monitoring system (see RuntimeOptions::metrics_sink).
+//
+// Callbacks are made on the thread doing the work, after it completed, and
+// may be made concurrently. They should be cheap: OnEvaluation is called once
+// per evaluation, including each row of a batch evaluation. Without a sink,
+// the runtime does not gather the statistics.
+//
+// Programs served from a program cache are not planned again, so they are
+// not reported to OnProgramPlanned. Hit rates of the shared regular
+// expression pool are process-wide and read with GetSharedRegexPoolStats.
+class RuntimeMetricsSink {
+ public:
+  virtual ~RuntimeMetricsSink() = default;
+
+  virtual void OnEvaluation(const EvaluationMetrics& metrics) {}
+
+  virtual void OnProgramPlanned(const PlanningMetrics& metrics) {}
+};
+
+// Sink accumulating the statistics of all programs in relaxed atomic
+// counters, for exporters that poll. Thread-safe.
+class RuntimeMetricsCounters final : public RuntimeMetricsSink {
+ public:
+  struct Snapshot {
+    int64_t evaluations = 0;
+    int64_t errors = 0;
+    int64_t unknowns = 0;
+    int64_t failures = 0;
+    absl::Duration evaluation_wall_time = absl::ZeroDuration();
+    int64_t comprehension_iterations = 0;
+    int64_t allocated_bytes = 0;
+    int64_t type_cache_misses = 0;
+    int64_t programs_planned = 0;
+    absl::Duration planning_wall_time = absl::ZeroDuration();
+    // Total over all programs planned, including destroyed ones. The storage
+    // currently in use is read with PlanAllocator::GetStats.
+    int64_t step_arena_bytes = 0;
+  };
+
+  RuntimeMetricsCounters() = default;
+
+  RuntimeMetricsCounters(const RuntimeMetricsCounters&) = delete;
+  RuntimeMetricsCounters& operator=(const RuntimeMetricsCounters&) = delete;
+
+  void OnEvaluation(const EvaluationMetrics& metrics) override;
+
+  void OnProgramPlanned(const PlanningMetrics& metrics) override;
+
+  // Returns the totals so far. Counters are read one at a time, so a
+  // snapshot taken during evaluations may be inconsistent between counters.
+  Snapshot Read() const;
+
+ private:
+  std::atomic<int64_t> evaluations_{0};
+  std::atomic<int64_t> errors_{0};
+  std::atomic<int64_t> unknowns_{0};
+  std::atomic<int64_t> failures_{0};
+  std::atomic<int64_t> evaluation_wall_nanos_{0};
+  std::atomic<int64_t> comprehension_iterations_{0};
+  std::atomic<int64_t> allocated_bytes_{0};
+  std::atomic<int64_t> type_cache_misses_{0};
+  std::atomic<int64_t> programs_planned_{0};
+  std::atomic<int64_t> planning_wall_nanos_{0};
+  std::atomic<int64_t> step_arena_bytes_{0};
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_RUNTIME_METRICS_H_
@@ -0,0 +1,155 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/runtime_metrics.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::AllOf;
+using testing::ElementsAre;
+using testing::Field;
+
+TEST(RuntimeMetricsCounters, AccumulatesEvaluations) {
+  RuntimeMetricsCounters counters;
+  EvaluationMetrics metrics;
+  metrics.wall_time = absl::Microseconds(2);
+  metrics.comprehension_iterations = 3;
+  metrics.allocated_bytes = 64;
+  counters.OnEvaluation(metrics);
+  metrics.outcome = EvaluationOutcome::kError;
+  counters.OnEvaluation(metrics);
+  metrics.outcome = EvaluationOutcome::kUnknown;
+  counters.OnEvaluation(metrics);
+  metrics.outcome = EvaluationOutcome::kFailure;
+  counters.OnEvaluation(metrics);
+  PlanningMetrics planning;
+  planning.wall_time = absl::Microseconds(5);
+  planning.step_arena_bytes = 256;
+  counters.OnProgramPlanned(planning);
+
+  RuntimeMetricsCounters::Snapshot snapshot = counters.Read();
+  EXPECT_EQ(snapshot.evaluations, 4);
+  EXPECT_EQ(snapshot.errors, 1);
+  EXPECT_EQ(snapshot.unknowns, 1);
+  EXPECT_EQ(snapshot.failures, 1);
+  EXPECT_EQ(snapshot.evaluation_wall_time, absl::Microseconds(8));
+  EXPECT_EQ(snapshot.comprehension_iterations, 12);
+  EXPECT_EQ(snapshot.allocated_bytes, 256);
+  EXPECT_EQ(snapshot.programs_planned, 1);
+  EXPECT_EQ(snapshot.planning_wall_time, absl::Microseconds(5));
+  EXPECT_EQ(snapshot.step_arena_bytes, 256);
+}
+
+// Keeps the metrics reported to it.
+class RecordingSink : public RuntimeMetricsSink {
+ public:
+  struct Evaluation {
+    std::string label;
+    EvaluationOutcome outcome;
+    int64_t comprehension_iterations;
+  };
+
+  void OnEvaluation(const EvaluationMetrics& metrics) override {
+    evaluations.push_back({std::string(metrics.program_label),
+                           metrics.outcome,
+                           metrics.comprehension_iterations});
+  }
+
+  void OnProgramPlanned(const PlanningMetrics& metrics) override {
+    planned.push_back(std::string(metrics.program_label));
+  }
+
+  std::vector<Evaluation> evaluations;
+  std::vector<std::string> planned;
+};
+
+class RuntimeMetricsSinkTest : public testing::Test {
+ public:
+  void SetUp() override {
+    RuntimeOptions options;
+    options.metrics_sink = sink_;
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(options));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<std::unique_ptr<TraceableProgram>> CreateProgram(
+      absl::string_view expression, absl::string_view label) {
+    CEL_ASSIGN_OR_RETURN(ParsedExpr expr, Parse(expression));
+    Runtime::CreateProgramOptions options;
+    options.metrics_label = std::string(label);
+    return ProtobufRuntimeAdapter::CreateProgram(*runtime_, expr, options);
+  }
+
+ protected:
+  std::shared_ptr<RecordingSink> sink_ = std::make_shared<RecordingSink>();
+  std::unique_ptr<const Runtime> runtime_;
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+TEST_F(RuntimeMetricsSinkTest, ReportsEvaluationsByProgram) {
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> all_positive,
+                       CreateProgram("[1, 2, 3].all(x, x > 0)", "positive"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> divide,
+                       CreateProgram("1 / 0", "divide"));
+  EXPECT_THAT(sink_->planned, ElementsAre("positive", "divide"));
+
+  Activation activation;
+  ASSERT_OK(all_positive->Evaluate(activation, value_factory_.get()));
+  ASSERT_OK(divide->Evaluate(activation, value_factory_.get()));
+
+  using Evaluation = RecordingSink::Evaluation;
+  EXPECT_THAT(
+      sink_->evaluations,
+      ElementsAre(
+          AllOf(Field(&Evaluation::label, "positive"),
+                Field(&Evaluation::outcome, EvaluationOutcome::kValue),
+                Field(&Evaluation::comprehension_iterations, 3)),
+          AllOf(Field(&Evaluation::label, "divide"),
+                Field(&Evaluation::outcome, EvaluationOutcome::kError),
+                Field(&Evaluation::comprehension_iterations, 0))));
+}
+
+}  // namespace
+}  // namespace cel
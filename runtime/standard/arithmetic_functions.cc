@@ -14,17 +14,23 @@
 
 #include "runtime/standard/arithmetic_functions.h"
 
+#include <cstdint>
 #include <limits>
+#include <memory>
 
+#include "absl/base/optimization.h"
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "base/builtins.h"
+#include "base/function.h"
 #include "base/function_adapter.h"
 #include "base/handle.h"
+#include "base/kind.h"
 #include "base/value.h"
 #include "base/value_factory.h"
 #include "internal/overflow.h"
-#include "internal/status_macros.h"
+#include "runtime/function_registry.h"
+#include "runtime/runtime_options.h"
 
 namespace cel {
 namespace {
@@ -36,21 +42,23 @@ Handle<Value> Add(ValueFactory&, Type v0, Type v1);
 template <>
 Handle<Value> Add<int64_t>(ValueFactory& value_factory, int64_t v0,
                            int64_t v1) {
-  auto sum = cel::internal::CheckedAdd(v0, v1);
-  if (!sum.ok()) {
-    return value_factory.CreateErrorValue(sum.status());
+  int64_t sum;
+  if (ABSL_PREDICT_TRUE(cel::internal::TryAdd(v0, v1, &sum))) {
+    return value_factory.CreateIntValue(sum);
   }
-  return value_factory.CreateIntValue(*sum);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedAdd(v0, v1).status());
 }
 
 template <>
 Handle<Value> Add<uint64_t>(ValueFactory& value_factory, uint64_t v0,
                             uint64_t v1) {
-  auto sum = cel::internal::CheckedAdd(v0, v1);
-  if (!sum.ok()) {
-    return value_factory.CreateErrorValue(sum.status());
+  uint64_t sum;
+  if (ABSL_PREDICT_TRUE(cel::internal::TryAdd(v0, v1, &sum))) {
+    return value_factory.CreateUintValue(sum);
   }
-  return value_factory.CreateUintValue(*sum);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedAdd(v0, v1).status());
 }
 
 template <>
@@ -64,21 +72,23 @@ Handle<Value> Sub(ValueFactory&, Type v0, Type v1);
 template <>
 Handle<Value> Sub<int64_t>(ValueFactory& value_factory, int64_t v0,
                            int64_t v1) {
-  auto diff = cel::internal::CheckedSub(v0, v1);
-  if (!diff.ok()) {
-    return value_factory.CreateErrorValue(diff.status());
+  int64_t diff;
+  if (ABSL_PREDICT_TRUE(cel::internal::TrySub(v0, v1, &diff))) {
+    return value_factory.CreateIntValue(diff);
   }
-  return value_factory.CreateIntValue(*diff);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedSub(v0, v1).status());
 }
 
 template <>
 Handle<Value> Sub<uint64_t>(ValueFactory& value_factory, uint64_t v0,
                             uint64_t v1) {
-  auto diff = cel::internal::CheckedSub(v0, v1);
-  if (!diff.ok()) {
-    return value_factory.CreateErrorValue(diff.status());
+  uint64_t diff;
+  if (ABSL_PREDICT_TRUE(cel::internal::TrySub(v0, v1, &diff))) {
+    return value_factory.CreateUintValue(diff);
   }
-  return value_factory.CreateUintValue(*diff);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedSub(v0, v1).status());
 }
 
 template <>
@@ -92,21 +102,23 @@ Handle<Value> Mul(ValueFactory&, Type v0, Type v1);
 template <>
 Handle<Value> Mul<int64_t>(ValueFactory& value_factory, int64_t v0,
                            int64_t v1) {
-  auto prod = cel::internal::CheckedMul(v0, v1);
-  if (!prod.ok()) {
-    return value_factory.CreateErrorValue(prod.status());
+  int64_t prod;
+  if (ABSL_PREDICT_TRUE(cel::internal::TryMul(v0, v1, &prod))) {
+    return value_factory.CreateIntValue(prod);
   }
-  return value_factory.CreateIntValue(*prod);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedMul(v0, v1).status());
 }
 
 template <>
 Handle<Value> Mul<uint64_t>(ValueFactory& value_factory, uint64_t v0,
                             uint64_t v1) {
-  auto prod = cel::internal::CheckedMul(v0, v1);
-  if (!prod.ok()) {
-    return value_factory.CreateErrorValue(prod.status());
+  uint64_t prod;
+  if (ABSL_PREDICT_TRUE(cel::internal::TryMul(v0, v1, &prod))) {
+    return value_factory.CreateUintValue(prod);
   }
-  return value_factory.CreateUintValue(*prod);
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedMul(v0, v1).status());
 }
 
 template <>
@@ -176,68 +188,70 @@ Handle<Value> Modulo<uint64_t>(ValueFactory& value_factory, uint64_t v0,
   return value_factory.CreateUintValue(*mod);
 }
 
-// Helper method
-// Registers all arithmetic functions for template parameter type.
-template <class Type>
-absl::Status RegisterArithmeticFunctionsForType(FunctionRegistry& registry) {
-  using FunctionAdapter = cel::BinaryFunctionAdapter<Handle<Value>, Type, Type>;
-  CEL_RETURN_IF_ERROR(registry.Register(
-      FunctionAdapter::CreateDescriptor(cel::builtin::kAdd, false),
-      FunctionAdapter::WrapFunction(&Add<Type>)));
+Handle<Value> NegateInt(ValueFactory& value_factory, int64_t value) {
+  int64_t inv;
+  if (ABSL_PREDICT_TRUE(cel::internal::TryNegation(value, &inv))) {
+    return value_factory.CreateIntValue(inv);
+  }
+  return value_factory.CreateErrorValue(
+      cel::internal::CheckedNegation(value).status());
+}
 
-  CEL_RETURN_IF_ERROR(registry.Register(
-      FunctionAdapter::CreateDescriptor(cel::builtin::kSubtract, false),
-      FunctionAdapter::WrapFunction(&Sub<Type>)));
+double NegateDouble(ValueFactory&, double value) { return -value; }
 
-  CEL_RETURN_IF_ERROR(registry.Register(
-      FunctionAdapter::CreateDescriptor(cel::builtin::kMultiply, false),
-      FunctionAdapter::WrapFunction(&Mul<Type>)));
+template <class Type, Handle<Value> (*Fn)(ValueFactory&, Type, Type)>
+std::unique_ptr<Function> CreateBinary() {
+  return BinaryFunctionAdapter<Handle<Value>, Type, Type>::WrapFunction(Fn);
+}
 
-  return registry.Register(
-      FunctionAdapter::CreateDescriptor(cel::builtin::kDivide, false),
-      FunctionAdapter::WrapFunction(&Div<Type>));
+std::unique_ptr<Function> CreateNegateInt() {
+  return UnaryFunctionAdapter<Handle<Value>, int64_t>::WrapFunction(
+      &NegateInt);
 }
 
+std::unique_ptr<Function> CreateNegateDouble() {
+  return UnaryFunctionAdapter<double, double>::WrapFunction(&NegateDouble);
+}
+
+constexpr Kind kIntInt[] = {Kind::kInt, Kind::kInt};
+constexpr Kind kUintUint[] = {Kind::kUint, Kind::kUint};
+constexpr Kind kDoubleDouble[] = {Kind::kDouble, Kind::kDouble};
+constexpr Kind kIntArg[] = {Kind::kInt};
+constexpr Kind kDoubleArg[] = {Kind::kDouble};
+
+// The overloads are only materialized when a program references them.
+constexpr FunctionRegistry::DeferredOverload kArithmeticOverloads[] = {
+    {builtin::kAdd, false, kIntInt, &CreateBinary<int64_t, &Add<int64_t>>},
+    {builtin::kSubtract, false, kIntInt, &CreateBinary<int64_t, &Sub<int64_t>>},
+    {builtin::kMultiply, false, kIntInt, &CreateBinary<int64_t, &Mul<int64_t>>},
+    {builtin::kDivide, false, kIntInt, &CreateBinary<int64_t, &Div<int64_t>>},
+    {builtin::kModulo, false, kIntInt,
+     &CreateBinary<int64_t, &Modulo<int64_t>>},
+    {builtin::kAdd, false, kUintUint, &CreateBinary<uint64_t, &Add<uint64_t>>},
+    {builtin::kSubtract, false, kUintUint,
+     &CreateBinary<uint64_t, &Sub<uint64_t>>},
+    {builtin::kMultiply, false, kUintUint,
+     &CreateBinary<uint64_t, &Mul<uint64_t>>},
+    {builtin::kDivide, false, kUintUint,
+     &CreateBinary<uint64_t, &Div<uint64_t>>},
+    {builtin::kModulo, false, kUintUint,
+     &CreateBinary<uint64_t, &Modulo<uint64_t>>},
+    {builtin::kAdd, false, kDoubleDouble, &CreateBinary<double, &Add<double>>},
+    {builtin::kSubtract, false, kDoubleDouble,
+     &CreateBinary<double, &Sub<double>>},
+    {builtin::kMultiply, false, kDoubleDouble,
+     &CreateBinary<double, &Mul<double>>},
+    {builtin::kDivide, false, kDoubleDouble,
+     &CreateBinary<double, &Div<double>>},
+    {builtin::kNeg, false, kIntArg, &CreateNegateInt},
+    {builtin::kNeg, false, kDoubleArg, &CreateNegateDouble},
+};
+
 }  // namespace
 
 absl::Status RegisterArithmeticFunctions(FunctionRegistry& registry,
                                          const RuntimeOptions& options) {
-  CEL_RETURN_IF_ERROR(RegisterArithmeticFunctionsForType<int64_t>(registry));
-  CEL_RETURN_IF_ERROR(RegisterArithmeticFunctionsForType<uint64_t>(registry));
-  CEL_RETURN_IF_ERROR(RegisterArithmeticFunctionsForType<double>(registry));
-
-  // Modulo
-  CEL_RETURN_IF_ERROR(registry.Register(
-      BinaryFunctionAdapter<Handle<Value>, int64_t, int64_t>::CreateDescriptor(
-          cel::builtin::kModulo, false),
-      BinaryFunctionAdapter<Handle<Value>, int64_t, int64_t>::WrapFunction(
-          &Modulo<int64_t>)));
-
-  CEL_RETURN_IF_ERROR(registry.Register(
-      BinaryFunctionAdapter<Handle<Value>, uint64_t,
-                            uint64_t>::CreateDescriptor(cel::builtin::kModulo,
-                                                        false),
-      BinaryFunctionAdapter<Handle<Value>, uint64_t, uint64_t>::WrapFunction(
-          &Modulo<uint64_t>)));
-
-  // Negation group
-  CEL_RETURN_IF_ERROR(registry.Register(
-      UnaryFunctionAdapter<Handle<Value>, int64_t>::CreateDescriptor(
-          cel::builtin::kNeg, false),
-      UnaryFunctionAdapter<Handle<Value>, int64_t>::WrapFunction(
-          [](ValueFactory& value_factory, int64_t value) -> Handle<Value> {
-            auto inv = cel::internal::CheckedNegation(value);
-            if (!inv.ok()) {
-              return value_factory.CreateErrorValue(inv.status());
-            }
-            return value_factory.CreateIntValue(*inv);
-          })));
-
-  return registry.Register(
-      UnaryFunctionAdapter<double, double>::CreateDescriptor(cel::builtin::kNeg,
-                                                             false),
-      UnaryFunctionAdapter<double, double>::WrapFunction(
-          [](ValueFactory&, double value) -> double { return -value; }));
+  return registry.RegisterDeferred(kArithmeticOverloads);
 }
 
 }  // namespace cel
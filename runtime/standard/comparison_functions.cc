@@ -33,7 +33,8 @@ namespace cel {
 
 namespace {
 
-using ::cel::internal::Number;
+using ::cel::internal::CompareNumeric;
+using ::cel::internal::ComparisonResult;
 
 // Comparison template functions
 template <class Type>
@@ -148,24 +149,28 @@ bool GreaterThanOrEqual(ValueFactory&, absl::Time t1, absl::Time t2) {
   return absl::operator>=(t1, t2);
 }
 
+// The operand types of the cross numeric overloads are fixed, so they are
+// compared directly rather than as Number.
 template <typename T, typename U>
 bool CrossNumericLessThan(ValueFactory&, T t, U u) {
-  return Number(t) < Number(u);
+  return CompareNumeric(t, u) == ComparisonResult::kLesser;
 }
 
 template <typename T, typename U>
 bool CrossNumericGreaterThan(ValueFactory&, T t, U u) {
-  return Number(t) > Number(u);
+  return CompareNumeric(t, u) == ComparisonResult::kGreater;
 }
 
 template <typename T, typename U>
 bool CrossNumericLessOrEqualTo(ValueFactory&, T t, U u) {
-  return Number(t) <= Number(u);
+  ComparisonResult cmp = CompareNumeric(t, u);
+  return cmp == ComparisonResult::kLesser || cmp == ComparisonResult::kEqual;
 }
 
 template <typename T, typename U>
 bool CrossNumericGreaterOrEqualTo(ValueFactory&, T t, U u) {
-  return Number(t) >= Number(u);
+  ComparisonResult cmp = CompareNumeric(t, u);
+  return cmp == ComparisonResult::kGreater || cmp == ComparisonResult::kEqual;
 }
 
 template <class Type>
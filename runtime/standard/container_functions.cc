@@ -26,12 +26,14 @@
 #include "base/values/map_value.h"
 #include "internal/status_macros.h"
 #include "runtime/function_registry.h"
+#include "runtime/internal/concat_list_value.h"
 #include "runtime/internal/mutable_list_impl.h"
 #include "runtime/runtime_options.h"
 
 namespace cel {
 namespace {
 
+using cel::runtime_internal::ConcatListValue;
 using cel::runtime_internal::MutableListValue;
 
 int64_t MapSizeImpl(ValueFactory&, const MapValue& value) {
@@ -43,37 +45,13 @@ int64_t ListSizeImpl(ValueFactory&, const ListValue& value) {
 }
 
 // Concatenation for CelList type.
+//
+// The result is a view over the operands, so chained concatenations do not
+// copy elements.
 absl::StatusOr<Handle<ListValue>> ConcatList(ValueFactory& factory,
                                              const Handle<ListValue>& value1,
                                              const Handle<ListValue>& value2) {
-  int size1 = value1->Size();
-  if (size1 == 0) {
-    return value2;
-  }
-  int size2 = value2->Size();
-  if (size2 == 0) {
-    return value1;
-  }
-
-  // TODO(uncreated-issue/50): add option for checking lists have homogenous element
-  // types and use a more specialized list type when possible.
-  CEL_ASSIGN_OR_RETURN(Handle<ListType> list_type,
-                       factory.type_factory().CreateListType(
-                           factory.type_factory().GetDynType()));
-  CEL_ASSIGN_OR_RETURN(auto list_builder, list_type->NewValueBuilder(factory));
-
-  list_builder->Reserve(size1 + size2);
-
-  for (int i = 0; i < size1; i++) {
-    CEL_ASSIGN_OR_RETURN(Handle<Value> elem, value1->Get(factory, i));
-    CEL_RETURN_IF_ERROR(list_builder->Add(std::move(elem)));
-  }
-  for (int i = 0; i < size2; i++) {
-    CEL_ASSIGN_OR_RETURN(Handle<Value> elem, value2->Get(factory, i));
-    CEL_RETURN_IF_ERROR(list_builder->Add(std::move(elem)));
-  }
-
-  return std::move(*list_builder).Build();
+  return ConcatListValue::Concat(factory, value1, value2);
 }
 
 // AppendList will append the elements in value2 to value1.
@@ -17,6 +17,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
 #include <utility>
 
 #include "absl/status/status.h"
@@ -30,10 +31,13 @@
 #include "base/values/bool_value.h"
 #include "base/values/double_value.h"
 #include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
 #include "base/values/uint_value.h"
 #include "internal/number.h"
 #include "internal/status_macros.h"
 #include "runtime/function_registry.h"
+#include "runtime/internal/indexed_list_value.h"
 #include "runtime/register_function_helper.h"
 #include "runtime/runtime_options.h"
 #include "runtime/standard/equality_functions.h"
@@ -86,10 +90,104 @@ bool ValueEquals(const Handle<Value>& value, const BytesValue& other) {
   return value->Is<BytesValue>() && (value->As<BytesValue>().Equals(other));
 }
 
+// Membership test for lists storing scalar elements natively, which are
+// scanned without creating a handle per element. Returns absl::nullopt if list
+// is not such a list.
+absl::optional<bool> NativeListIn(const base_internal::CompactScalar& value,
+                                  const ListValue& list, bool heterogeneous) {
+  using base_internal::CompactScalar;
+  auto contains = [&](const auto& elements, auto to_scalar) {
+    for (const auto& element : elements) {
+      if (value.Equals(to_scalar(element), heterogeneous)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (list.Is<base_internal::CompactListValue>()) {
+    return contains(list.As<base_internal::CompactListValue>().NativeValues(),
+                    [](const CompactScalar& element) { return element; });
+  }
+  if (list.Is<base_internal::StaticListValue<IntValue>>()) {
+    return contains(
+        list.As<base_internal::StaticListValue<IntValue>>().NativeValues(),
+        &CompactScalar::Int);
+  }
+  if (list.Is<base_internal::StaticListValue<UintValue>>()) {
+    return contains(
+        list.As<base_internal::StaticListValue<UintValue>>().NativeValues(),
+        &CompactScalar::Uint);
+  }
+  if (list.Is<base_internal::StaticListValue<DoubleValue>>()) {
+    return contains(
+        list.As<base_internal::StaticListValue<DoubleValue>>().NativeValues(),
+        &CompactScalar::Double);
+  }
+  if (list.Is<base_internal::StaticListValue<BoolValue>>()) {
+    return contains(
+        list.As<base_internal::StaticListValue<BoolValue>>().NativeValues(),
+        &CompactScalar::Bool);
+  }
+  return absl::nullopt;
+}
+
+base_internal::CompactScalar ToCompactScalar(bool value) {
+  return base_internal::CompactScalar::Bool(value);
+}
+
+base_internal::CompactScalar ToCompactScalar(int64_t value) {
+  return base_internal::CompactScalar::Int(value);
+}
+
+base_internal::CompactScalar ToCompactScalar(uint64_t value) {
+  return base_internal::CompactScalar::Uint(value);
+}
+
+base_internal::CompactScalar ToCompactScalar(double value) {
+  return base_internal::CompactScalar::Double(value);
+}
+
+Handle<Value> ToValue(ValueFactory& value_factory, bool value) {
+  return value_factory.CreateBoolValue(value);
+}
+
+Handle<Value> ToValue(ValueFactory& value_factory, int64_t value) {
+  return value_factory.CreateIntValue(value);
+}
+
+Handle<Value> ToValue(ValueFactory& value_factory, uint64_t value) {
+  return value_factory.CreateUintValue(value);
+}
+
+Handle<Value> ToValue(ValueFactory& value_factory, double value) {
+  return value_factory.CreateDoubleValue(value);
+}
+
 // Template function implementing CEL in() function
 template <typename T>
 absl::StatusOr<bool> In(ValueFactory& value_factory, T value,
                         const ListValue& list) {
+  if (list.Is<runtime_internal::IndexedListValue>()) {
+    const auto& indexed_list = list.As<runtime_internal::IndexedListValue>();
+    absl::optional<bool> found;
+    if constexpr (std::is_arithmetic_v<T>) {
+      found = indexed_list.IndexedContains(*ToValue(value_factory, value),
+                                           /*heterogeneous=*/false);
+    } else {
+      found = indexed_list.IndexedContains(value, /*heterogeneous=*/false);
+    }
+    if (found.has_value()) {
+      return *found;
+    }
+  }
+  if constexpr (std::is_arithmetic_v<T>) {
+    if (absl::optional<bool> found =
+            NativeListIn(ToCompactScalar(value), list,
+                         /*heterogeneous=*/false);
+        found.has_value()) {
+      return *found;
+    }
+  }
   size_t size = list.Size();
   for (int i = 0; i < size; i++) {
     CEL_ASSIGN_OR_RETURN(Handle<Value> element, list.Get(value_factory, i));
@@ -115,6 +213,23 @@ absl::StatusOr<Handle<Value>> HeterogeneousEqualityIn(
   if (list.Is<base_internal::LegacyListValue>()) {
     return list.Contains(value_factory, value);
   }
+  if (list.Is<runtime_internal::IndexedListValue>()) {
+    if (absl::optional<bool> found =
+            list.As<runtime_internal::IndexedListValue>().IndexedContains(
+                *value, /*heterogeneous=*/true);
+        found.has_value()) {
+      return value_factory.CreateBoolValue(*found);
+    }
+  }
+  if (absl::optional<base_internal::CompactScalar> scalar =
+          base_internal::CompactScalar::From(*value);
+      scalar.has_value()) {
+    if (absl::optional<bool> found =
+            NativeListIn(*scalar, list, /*heterogeneous=*/true);
+        found.has_value()) {
+      return value_factory.CreateBoolValue(*found);
+    }
+  }
   CEL_ASSIGN_OR_RETURN(
       bool exists,
       list.AnyOf(value_factory,
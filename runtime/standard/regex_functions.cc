@@ -53,7 +53,8 @@ absl::Status RegisterRegexFunctions(FunctionRegistry& registry,
                                 const StringValue&>;
       CEL_RETURN_IF_ERROR(
           registry.Register(MatchFnAdapter::CreateDescriptor(
-                                cel::builtin::kRegexMatch, receiver_style),
+                                cel::builtin::kRegexMatch, receiver_style,
+                                /*is_strict=*/true, /*is_pure=*/true),
                             MatchFnAdapter::WrapFunction(regex_matches)));
     }
   }  // if options.enable_regex
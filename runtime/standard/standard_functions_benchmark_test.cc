@@ -0,0 +1,264 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the standard functions, one expression per overload family,
+// evaluated through the legacy CelValue API and the modern cel::Value API
+// with either memory manager.
+//
+// Every benchmark takes the evaluation path and the size of the inputs:
+//   i, j  int; j is the size
+//   d     double
+//   str   string of size characters, ending with sub
+//   sub   string "b"
+//   list  list of the ints [0, size)
+//   t     timestamp
+//   dur   duration
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/time/time.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/error_value.h"
+#include "base/values/list_value_builder.h"
+#include "eval/public/activation.h"
+#include "eval/public/builtin_func_registrar.h"
+#include "eval/public/cel_expr_builder_factory.h"
+#include "eval/public/cel_expression.h"
+#include "eval/public/cel_options.h"
+#include "eval/public/cel_value.h"
+#include "eval/public/containers/container_backed_list_impl.h"
+#include "extensions/protobuf/memory_manager.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/benchmark.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+#include "google/protobuf/arena.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::cel::extensions::ProtoMemoryManagerRef;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::runtime::CelValue;
+using ::google::api::expr::runtime::ContainerBackedListImpl;
+
+enum Path : int64_t {
+  // CelExpressionBuilder and CelValue.
+  kLegacy = 0,
+  // Runtime and cel::Value, reference counted.
+  kReferenceCounting = 1,
+  // Runtime and cel::Value, allocated from an arena.
+  kPooling = 2,
+};
+
+// The inputs of a benchmark, in their native form.
+struct Inputs {
+  explicit Inputs(int64_t size)
+      : j(size), str(std::string(size > 0 ? size - 1 : 0, 'a') + "b") {
+    for (int64_t k = 0; k < size; ++k) {
+      list.push_back(k);
+    }
+  }
+
+  int64_t i = 7;
+  int64_t j;
+  double d = 2.5;
+  std::string str;
+  std::string sub = "b";
+  std::vector<int64_t> list;
+  absl::Time t = absl::FromUnixSeconds(1700000000);
+  absl::Duration dur = absl::Hours(25);
+};
+
+void RunLegacy(benchmark::State& state, const ParsedExpr& expr,
+               const Inputs& inputs) {
+  namespace legacy = ::google::api::expr::runtime;
+
+  legacy::InterpreterOptions options;
+  auto builder = legacy::CreateCelExpressionBuilder(options);
+  ASSERT_OK(legacy::RegisterBuiltinFunctions(builder->GetRegistry(), options));
+  ASSERT_OK_AND_ASSIGN(
+      auto cel_expr,
+      builder->CreateExpression(&expr.expr(), &expr.source_info()));
+
+  std::vector<CelValue> elements;
+  for (int64_t element : inputs.list) {
+    elements.push_back(CelValue::CreateInt64(element));
+  }
+  ContainerBackedListImpl list(std::move(elements));
+
+  legacy::Activation activation;
+  activation.InsertValue("i", CelValue::CreateInt64(inputs.i));
+  activation.InsertValue("j", CelValue::CreateInt64(inputs.j));
+  activation.InsertValue("d", CelValue::CreateDouble(inputs.d));
+  activation.InsertValue("str", CelValue::CreateString(&inputs.str));
+  activation.InsertValue("sub", CelValue::CreateString(&inputs.sub));
+  activation.InsertValue("list", CelValue::CreateList(&list));
+  activation.InsertValue("t", CelValue::CreateTimestamp(inputs.t));
+  activation.InsertValue("dur", CelValue::CreateDuration(inputs.dur));
+
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    ASSERT_OK_AND_ASSIGN(CelValue result,
+                         cel_expr->Evaluate(activation, &arena));
+    ASSERT_FALSE(result.IsError()) << result.DebugString();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+MemoryManagerRef MemoryManagerFor(Path path, google::protobuf::Arena& arena) {
+  return path == kPooling ? ProtoMemoryManagerRef(&arena)
+                          : MemoryManagerRef::ReferenceCounting();
+}
+
+void RunModern(benchmark::State& state, const ParsedExpr& expr,
+               const Inputs& inputs, Path path) {
+  RuntimeOptions options;
+  ASSERT_OK_AND_ASSIGN(auto builder, CreateStandardRuntimeBuilder(options));
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<Program> program,
+                       ProtobufRuntimeAdapter::CreateProgram(*runtime, expr));
+
+  // The inputs outlive the evaluations, so they are allocated apart from
+  // them.
+  google::protobuf::Arena inputs_arena;
+  ManagedValueFactory inputs_factory(program->GetTypeProvider(),
+                                     MemoryManagerFor(path, inputs_arena));
+  ValueFactory& value_factory = inputs_factory.get();
+
+  ListValueBuilder<Value> list_builder(
+      value_factory, value_factory.type_factory().GetDynType());
+  for (int64_t element : inputs.list) {
+    ASSERT_OK(list_builder.Add(value_factory.CreateIntValue(element)));
+  }
+  ASSERT_OK_AND_ASSIGN(auto list, std::move(list_builder).Build());
+
+  Activation activation;
+  activation.InsertOrAssignValue("i", value_factory.CreateIntValue(inputs.i));
+  activation.InsertOrAssignValue("j", value_factory.CreateIntValue(inputs.j));
+  activation.InsertOrAssignValue("d",
+                                 value_factory.CreateDoubleValue(inputs.d));
+  activation.InsertOrAssignValue(
+      "str", value_factory.CreateUncheckedStringValue(inputs.str));
+  activation.InsertOrAssignValue(
+      "sub", value_factory.CreateUncheckedStringValue(inputs.sub));
+  activation.InsertOrAssignValue("list", std::move(list));
+  activation.InsertOrAssignValue(
+      "t", value_factory.CreateUncheckedTimestampValue(inputs.t));
+  activation.InsertOrAssignValue(
+      "dur", value_factory.CreateUncheckedDurationValue(inputs.dur));
+
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    ManagedValueFactory evaluation_factory(program->GetTypeProvider(),
+                                           MemoryManagerFor(path, arena));
+    ASSERT_OK_AND_ASSIGN(
+        Handle<Value> result,
+        program->Evaluate(activation, evaluation_factory.get()));
+    ASSERT_FALSE(result->Is<ErrorValue>()) << result->DebugString();
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+void BM_StandardFunction(benchmark::State& state, const char* expression) {
+  auto path = static_cast<Path>(state.range(0));
+  Inputs inputs(state.range(1));
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, Parse(expression));
+
+  if (path == kLegacy) {
+    RunLegacy(state, expr, inputs);
+  } else {
+    RunModern(state, expr, inputs, path);
+  }
+}
+
+void Configure(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"path", "size"})
+      ->ArgsProduct({{kLegacy, kReferenceCounting, kPooling}, {1, 64, 4096}});
+}
+
+// Arithmetic
+BENCHMARK_CAPTURE(BM_StandardFunction, IntArithmetic, "i + j * 2 - j / 3 % 5")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, DoubleArithmetic, "d * 2.0 + d / 3.0")
+    ->Apply(Configure);
+
+// Comparison and equality
+BENCHMARK_CAPTURE(BM_StandardFunction, IntComparison, "i < j && j >= i")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringComparison, "str > sub")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringEquality, "str == str")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, ListEquality, "list == list")
+    ->Apply(Configure);
+
+// Strings
+BENCHMARK_CAPTURE(BM_StandardFunction, StringSize, "size(str)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringContains, "str.contains(sub)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringEndsWith, "str.endsWith(sub)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringConcat, "str + sub")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, RegexMatch, "str.matches('^a*b$')")
+    ->Apply(Configure);
+
+// Containers
+BENCHMARK_CAPTURE(BM_StandardFunction, ListSize, "size(list)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, ListIndex, "list[j - 1]")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, ListMembership, "j - 1 in list")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, ListConcat, "list + list")
+    ->Apply(Configure);
+
+// Time
+BENCHMARK_CAPTURE(BM_StandardFunction, TimestampAccessors,
+                  "t.getHours() + t.getDayOfYear('America/New_York')")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, TimeArithmetic, "t + dur - dur == t")
+    ->Apply(Configure);
+
+// Type conversions
+BENCHMARK_CAPTURE(BM_StandardFunction, IntToString, "string(j)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, StringToInt, "int(string(j))")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, IntToDouble, "double(j)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, TimestampToString, "string(t)")
+    ->Apply(Configure);
+BENCHMARK_CAPTURE(BM_StandardFunction, Type, "type(list) == list")
+    ->Apply(Configure);
+
+}  // namespace
+}  // namespace cel
@@ -15,7 +15,6 @@
 #include "runtime/standard/string_functions.h"
 
 #include "absl/status/status.h"
-#include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "base/builtins.h"
 #include "base/function_adapter.h"
@@ -51,17 +50,17 @@ absl::StatusOr<Handle<BytesValue>> ConcatBytes(ValueFactory& factory,
 
 bool StringContains(ValueFactory&, const StringValue& value,
                     const StringValue& substr) {
-  return absl::StrContains(value.ToString(), substr.ToString());
+  return value.Contains(substr);
 }
 
 bool StringEndsWith(ValueFactory&, const StringValue& value,
                     const StringValue& suffix) {
-  return absl::EndsWith(value.ToString(), suffix.ToString());
+  return value.EndsWith(suffix);
 }
 
 bool StringStartsWith(ValueFactory&, const StringValue& value,
                       const StringValue& prefix) {
-  return absl::StartsWith(value.ToString(), prefix.ToString());
+  return value.StartsWith(prefix);
 }
 
 absl::Status RegisterSizeFunctions(FunctionRegistry& registry) {
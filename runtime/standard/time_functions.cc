@@ -14,24 +14,74 @@
 
 #include "runtime/standard/time_functions.h"
 
+#include <cstddef>
 #include <functional>
 #include <string>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "base/builtins.h"
 #include "base/function_adapter.h"
 #include "base/handle.h"
 #include "base/value.h"
 #include "base/value_factory.h"
+#include "internal/no_destructor.h"
 #include "internal/overflow.h"
 #include "internal/status_macros.h"
 
 namespace cel {
 namespace {
 
+// Upper bound on distinct zone names remembered by LoadCachedTimeZone. Zone
+// arguments are almost always literals, so this is only reached by
+// expressions passing arbitrary strings; further names are loaded uncached.
+constexpr size_t kMaxCachedTimeZones = 256;
+
+// Resolves an IANA time zone name, remembering the outcome (including unknown
+// names) so that repeated accessor calls do not reload zone data.
+bool LoadCachedTimeZone(absl::string_view name, absl::TimeZone* time_zone) {
+  struct Cache {
+    absl::Mutex mutex;
+    absl::flat_hash_map<std::string, absl::optional<absl::TimeZone>> zones
+        ABSL_GUARDED_BY(mutex);
+  };
+  static internal::NoDestructor<Cache> cache;
+  {
+    absl::ReaderMutexLock lock(&cache->mutex);
+    auto it = cache->zones.find(name);
+    if (it != cache->zones.end()) {
+      if (!it->second.has_value()) {
+        return false;
+      }
+      *time_zone = *it->second;
+      return true;
+    }
+  }
+  absl::optional<absl::TimeZone> loaded;
+  absl::TimeZone zone;
+  if (absl::LoadTimeZone(name, &zone)) {
+    loaded = zone;
+  }
+  {
+    absl::MutexLock lock(&cache->mutex);
+    if (cache->zones.size() < kMaxCachedTimeZones) {
+      cache->zones.try_emplace(std::string(name), loaded);
+    }
+  }
+  if (!loaded.has_value()) {
+    return false;
+  }
+  *time_zone = *loaded;
+  return true;
+}
+
 // Timestamp
 absl::Status FindTimeBreakdown(absl::Time timestamp, absl::string_view tz,
                                absl::TimeZone::CivilInfo* breakdown) {
@@ -44,7 +94,7 @@ absl::Status FindTimeBreakdown(absl::Time timestamp, absl::string_view tz,
   }
 
   // Check to see whether the timezone is an IANA timezone.
-  if (absl::LoadTimeZone(tz, &time_zone)) {
+  if (LoadCachedTimeZone(tz, &time_zone)) {
     *breakdown = time_zone.At(timestamp);
     return absl::OkStatus();
   }
@@ -14,16 +14,24 @@
 
 #include "runtime/standard/type_conversion_functions.h"
 
+#include <string>
+
 #include "absl/status/status.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "base/builtins.h"
 #include "base/function_adapter.h"
 #include "base/handle.h"
 #include "base/value.h"
 #include "base/value_factory.h"
 #include "internal/overflow.h"
+#include "internal/overloaded.h"
 #include "internal/status_macros.h"
 #include "internal/time.h"
+#include "runtime/internal/number_format.h"
 
 namespace cel {
 namespace {
@@ -35,6 +43,21 @@ using ::cel::internal::MaxTimestamp;
 // Time representing `9999-12-31T23:59:59.999999999Z`.
 const absl::Time kMaxTime = MaxTimestamp();
 
+// Invokes `parse` on the contents of `value` as a string_view, copying only
+// fragmented cords.
+template <typename Parse>
+bool ParseFlat(const StringValue& value, Parse parse) {
+  return value.Visit(internal::Overloaded{
+      [&](absl::string_view flat) { return parse(flat); },
+      [&](const absl::Cord& cord) {
+        if (absl::optional<absl::string_view> flat = cord.TryFlat();
+            flat.has_value()) {
+          return parse(*flat);
+        }
+        return parse(static_cast<std::string>(cord));
+      }});
+}
+
 absl::Status RegisterIntConversionFunctions(FunctionRegistry& registry,
                                             const RuntimeOptions&) {
   // bool -> int
@@ -72,7 +95,9 @@ absl::Status RegisterIntConversionFunctions(FunctionRegistry& registry,
           [](ValueFactory& value_factory,
              const StringValue& s) -> Handle<Value> {
             int64_t result;
-            if (!absl::SimpleAtoi(s.ToString(), &result)) {
+            if (!ParseFlat(s, [&result](absl::string_view flat) {
+                  return absl::SimpleAtoi(flat, &result);
+                })) {
               return value_factory.CreateErrorValue(
                   absl::InvalidArgumentError("cannot convert string to int"));
             }
@@ -126,8 +151,7 @@ absl::Status RegisterStringConversionFunctions(FunctionRegistry& registry,
           cel::builtin::kString, false),
       UnaryFunctionAdapter<Handle<StringValue>, double>::WrapFunction(
           [](ValueFactory& value_factory, double value) -> Handle<StringValue> {
-            return value_factory.CreateUncheckedStringValue(
-                absl::StrCat(value));
+            return runtime_internal::FormatNumber(value_factory, value);
           })));
 
   // int -> string
@@ -137,8 +161,7 @@ absl::Status RegisterStringConversionFunctions(FunctionRegistry& registry,
       UnaryFunctionAdapter<Handle<StringValue>, int64_t>::WrapFunction(
           [](ValueFactory& value_factory,
              int64_t value) -> Handle<StringValue> {
-            return value_factory.CreateUncheckedStringValue(
-                absl::StrCat(value));
+            return runtime_internal::FormatNumber(value_factory, value);
           })));
 
   // string -> string
@@ -156,8 +179,7 @@ absl::Status RegisterStringConversionFunctions(FunctionRegistry& registry,
       UnaryFunctionAdapter<Handle<StringValue>, uint64_t>::WrapFunction(
           [](ValueFactory& value_factory,
              uint64_t value) -> Handle<StringValue> {
-            return value_factory.CreateUncheckedStringValue(
-                absl::StrCat(value));
+            return runtime_internal::FormatNumber(value_factory, value);
           })));
 
   // duration -> string
@@ -224,7 +246,9 @@ absl::Status RegisterUintConversionFunctions(FunctionRegistry& registry,
           [](ValueFactory& value_factory,
              const StringValue& s) -> Handle<Value> {
             uint64_t result;
-            if (!absl::SimpleAtoi(s.ToString(), &result)) {
+            if (!ParseFlat(s, [&result](absl::string_view flat) {
+                  return absl::SimpleAtoi(flat, &result);
+                })) {
               return value_factory.CreateErrorValue(
                   absl::InvalidArgumentError("doesn't convert to a string"));
             }
@@ -286,7 +310,9 @@ absl::Status RegisterDoubleConversionFunctions(FunctionRegistry& registry,
           [](ValueFactory& value_factory,
              const StringValue& s) -> Handle<Value> {
             double result;
-            if (absl::SimpleAtod(s.ToString(), &result)) {
+            if (ParseFlat(s, [&result](absl::string_view flat) {
+                  return absl::SimpleAtod(flat, &result);
+                })) {
               return value_factory.CreateDoubleValue(result);
             } else {
               return value_factory.CreateErrorValue(absl::InvalidArgumentError(
@@ -305,7 +331,9 @@ absl::Status RegisterDoubleConversionFunctions(FunctionRegistry& registry,
 Handle<Value> CreateDurationFromString(ValueFactory& value_factory,
                                        const StringValue& dur_str) {
   absl::Duration d;
-  if (!absl::ParseDuration(dur_str.ToString(), &d)) {
+  if (!ParseFlat(dur_str, [&d](absl::string_view flat) {
+        return absl::ParseDuration(flat, &d);
+      })) {
     return value_factory.CreateErrorValue(
         absl::InvalidArgumentError("String to Duration conversion failed"));
   }
@@ -324,7 +352,7 @@ absl::Status RegisterTimeConversionFunctions(FunctionRegistry& registry,
   // duration() conversion from string.
   CEL_RETURN_IF_ERROR(registry.Register(
       UnaryFunctionAdapter<Handle<Value>, const StringValue&>::CreateDescriptor(
-          cel::builtin::kDuration, false),
+          cel::builtin::kDuration, false, /*is_strict=*/true, /*is_pure=*/true),
       UnaryFunctionAdapter<Handle<Value>, const StringValue&>::WrapFunction(
           CreateDurationFromString)));
 
@@ -344,13 +372,15 @@ absl::Status RegisterTimeConversionFunctions(FunctionRegistry& registry,
       options.enable_timestamp_duration_overflow_errors;
   return registry.Register(
       UnaryFunctionAdapter<Handle<Value>, const StringValue&>::CreateDescriptor(
-          cel::builtin::kTimestamp, false),
+          cel::builtin::kTimestamp, false, /*is_strict=*/true, /*is_pure=*/true),
       UnaryFunctionAdapter<Handle<Value>, const StringValue&>::WrapFunction(
           [=](ValueFactory& value_factory,
               const StringValue& time_str) -> Handle<Value> {
             absl::Time ts;
-            if (!absl::ParseTime(absl::RFC3339_full, time_str.ToString(), &ts,
-                                 nullptr)) {
+            if (!ParseFlat(time_str, [&ts](absl::string_view flat) {
+                  return internal::ParseRfc3339Time(flat, &ts,
+                                                    /*err=*/nullptr);
+                })) {
               return value_factory.CreateErrorValue(absl::InvalidArgumentError(
                   "String to Timestamp conversion failed"));
             }
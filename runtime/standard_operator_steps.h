@@ -0,0 +1,34 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_OPERATOR_STEPS_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_OPERATOR_STEPS_H_
+
+#include "absl/status/status.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable type-specialized steps for standard operators in the runtime being
+// built.
+//
+// Eagerly bound calls such as `a + b`, `a < b`, `a == b`, `!a` and `size(a)`
+// evaluate arguments of a single primitive kind inline, e.g. int + int checks
+// for overflow without invoking the function adapter. Calls with other
+// arguments use the registered overloads.
+absl::Status EnableStandardOperatorSteps(RuntimeBuilder& builder);
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_OPERATOR_STEPS_H_
@@ -14,8 +14,11 @@
 
 #include "runtime/standard_runtime_builder_factory.h"
 
+#include <memory>
+
 #include "absl/status/statusor.h"
 #include "internal/status_macros.h"
+#include "runtime/function_registry.h"
 #include "runtime/runtime_builder.h"
 #include "runtime/runtime_builder_factory.h"
 #include "runtime/runtime_options.h"
@@ -33,4 +36,11 @@ absl::StatusOr<RuntimeBuilder> CreateStandardRuntimeBuilder(
   return result;
 }
 
+absl::StatusOr<std::shared_ptr<const FunctionRegistry>>
+CreateStandardFunctionRegistry(const RuntimeOptions& options) {
+  auto registry = std::make_shared<FunctionRegistry>();
+  CEL_RETURN_IF_ERROR(RegisterStandardFunctions(*registry, options));
+  return registry;
+}
+
 }  // namespace cel
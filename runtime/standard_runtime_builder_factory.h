@@ -15,7 +15,10 @@
 #ifndef THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_RUNTIME_BUILDER_FACTORY_H_
 #define THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_RUNTIME_BUILDER_FACTORY_H_
 
+#include <memory>
+
 #include "absl/status/statusor.h"
+#include "runtime/function_registry.h"
 #include "runtime/runtime_builder.h"
 #include "runtime/runtime_options.h"
 
@@ -25,6 +28,11 @@ namespace cel {
 absl::StatusOr<RuntimeBuilder> CreateStandardRuntimeBuilder(
     const RuntimeOptions& options);
 
+// Create a registry with the CEL standard definitions, to be shared as the
+// base registry of many runtimes (see CreateRuntimeBuilder).
+absl::StatusOr<std::shared_ptr<const FunctionRegistry>>
+CreateStandardFunctionRegistry(const RuntimeOptions& options);
+
 }  // namespace cel
 
 #endif  // THIRD_PARTY_CEL_CPP_RUNTIME_STANDARD_RUNTIME_BUILDER_FACTORY_H_
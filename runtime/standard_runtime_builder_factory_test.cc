@@ -14,6 +14,7 @@
 
 #include "runtime/standard_runtime_builder_factory.h"
 
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <memory>
@@ -24,7 +25,11 @@
 #include "google/api/expr/v1alpha1/syntax.pb.h"
 #include "absl/algorithm/container.h"
 #include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "base/function_adapter.h"
+#include "base/function_descriptor.h"
 #include "base/handle.h"
+#include "base/kind.h"
 #include "base/memory.h"
 #include "base/type_factory.h"
 #include "base/type_manager.h"
@@ -39,6 +44,8 @@
 #include "parser/macro.h"
 #include "parser/parser.h"
 #include "runtime/activation.h"
+#include "runtime/evaluation_cost.h"
+#include "runtime/evaluation_profile.h"
 #include "runtime/managed_value_factory.h"
 #include "runtime/runtime.h"
 #include "runtime/runtime_issue.h"
@@ -51,6 +58,7 @@ namespace {
 using ::cel::extensions::ProtobufRuntimeAdapter;
 using ::cel::extensions::ProtoMemoryManagerRef;
 using ::google::api::expr::v1alpha1::ParsedExpr;
+using ::cel::internal::StatusIs;
 using ::google::api::expr::parser::ParseWithMacros;
 using testing::ElementsAre;
 using testing::Truly;
@@ -543,5 +551,126 @@ TEST(StandardRuntimeTest, RuntimeIssueSupport) {
   }
 }
 
+TEST(StandardRuntimeTest, ProfileCountsStepsByExprId) {
+  RuntimeOptions options;
+  google::protobuf::Arena arena;
+  auto memory_manager = ProtoMemoryManagerRef(&arena);
+
+  ASSERT_OK_AND_ASSIGN(auto builder, CreateStandardRuntimeBuilder(options));
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr,
+                       ParseWithMacros("int_var + 1 > 2", GetMacros()));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> program,
+                       ProtobufRuntimeAdapter::CreateProgram(*runtime, expr));
+
+  TypeFactory type_factory(memory_manager);
+  TypeManager type_manager(type_factory, runtime->GetTypeProvider());
+  ValueFactory value_factory(type_manager);
+  Activation activation;
+  activation.InsertOrAssignValue("int_var", value_factory.CreateIntValue(42));
+
+  EvaluationProfile profile;
+  int64_t allocations = 0;
+  profile.set_allocation_counter([&allocations]() { return ++allocations; });
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                         program->Profile(activation, profile, value_factory));
+    ASSERT_TRUE(result->Is<BoolValue>()) << result->DebugString();
+    EXPECT_TRUE(result->As<BoolValue>().NativeValue());
+  }
+
+  // int_var, 1, _+_, 2, _>_
+  EXPECT_THAT(profile.stats(), testing::SizeIs(5));
+  for (const auto& [expr_id, stats] : profile.stats()) {
+    EXPECT_EQ(stats.count, 2) << expr_id;
+    EXPECT_EQ(stats.allocations, 2) << expr_id;
+    EXPECT_GE(stats.wall_time, absl::ZeroDuration()) << expr_id;
+  }
+  EXPECT_EQ(profile.stats().at(expr.expr().id()).count, 2);
+}
+
+TEST(StandardRuntimeTest, EvaluateWithCost) {
+  RuntimeOptions options;
+  google::protobuf::Arena arena;
+  auto memory_manager = ProtoMemoryManagerRef(&arena);
+
+  ASSERT_OK_AND_ASSIGN(auto builder, CreateStandardRuntimeBuilder(options));
+  ASSERT_OK(builder.function_registry().Register(
+      FunctionDescriptor("expensive", false, {Kind::kInt}, /*is_strict=*/true,
+                         /*is_pure=*/false, /*cost=*/100),
+      UnaryFunctionAdapter<int64_t, int64_t>::WrapFunction(
+          [](ValueFactory&, int64_t x) { return x; })));
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(
+      ParsedExpr expr,
+      ParseWithMacros("[1, 2, 3].exists(x, expensive(x) > 2)", GetMacros()));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> program,
+                       ProtobufRuntimeAdapter::CreateProgram(*runtime, expr));
+
+  ManagedValueFactory value_factory(program->GetTypeProvider(),
+                                    memory_manager);
+  Activation activation;
+  EvaluationCost cost;
+  int64_t allocated_bytes = 0;
+  cost.allocation_counter = [&allocated_bytes]() {
+    return allocated_bytes += 8;
+  };
+  ASSERT_OK_AND_ASSIGN(
+      Handle<Value> result,
+      program->EvaluateWithCost(activation, cost, value_factory.get()));
+  ASSERT_TRUE(result->Is<BoolValue>()) << result->DebugString();
+  EXPECT_TRUE(result->As<BoolValue>().NativeValue());
+
+  EXPECT_GT(cost.steps, 0);
+  EXPECT_GE(cost.iterations, 3);
+  EXPECT_EQ(cost.function_cost, 300);
+  EXPECT_EQ(cost.allocated_bytes, 8);
+  EXPECT_EQ(cost.total(), cost.steps + cost.iterations + 300);
+}
+
+TEST(StandardRuntimeTest, MaxEvaluationCost) {
+  RuntimeOptions options;
+  options.max_evaluation_cost = 250;
+  google::protobuf::Arena arena;
+  auto memory_manager = ProtoMemoryManagerRef(&arena);
+
+  ASSERT_OK_AND_ASSIGN(auto builder, CreateStandardRuntimeBuilder(options));
+  ASSERT_OK(builder.function_registry().Register(
+      FunctionDescriptor("expensive", false, {Kind::kInt}, /*is_strict=*/true,
+                         /*is_pure=*/false, /*cost=*/100),
+      UnaryFunctionAdapter<int64_t, int64_t>::WrapFunction(
+          [](ValueFactory&, int64_t x) { return x; })));
+  ASSERT_OK_AND_ASSIGN(auto runtime, std::move(builder).Build());
+  ManagedValueFactory value_factory(runtime->GetTypeProvider(),
+                                    memory_manager);
+  Activation activation;
+
+  ASSERT_OK_AND_ASSIGN(
+      ParsedExpr cheap,
+      ParseWithMacros("[1, 2, 3].exists(x, expensive(x) > 1)", GetMacros()));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> program,
+                       ProtobufRuntimeAdapter::CreateProgram(*runtime, cheap));
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Evaluate(activation, value_factory.get()));
+  EXPECT_TRUE(result->Is<BoolValue>() &&
+              result->As<BoolValue>().NativeValue());
+
+  ASSERT_OK_AND_ASSIGN(
+      ParsedExpr too_expensive,
+      ParseWithMacros("[1, 2, 3].exists(x, expensive(x) > 2)", GetMacros()));
+  ASSERT_OK_AND_ASSIGN(
+      program, ProtobufRuntimeAdapter::CreateProgram(*runtime, too_expensive));
+  EXPECT_THAT(program->Evaluate(activation, value_factory.get()),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+
+  // The cost is recorded up to the failure.
+  EvaluationCost cost;
+  EXPECT_THAT(
+      program->EvaluateWithCost(activation, cost, value_factory.get()),
+      StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_EQ(cost.function_cost, 300);
+  EXPECT_GT(cost.total(), 250);
+}
+
 }  // namespace
 }  // namespace cel
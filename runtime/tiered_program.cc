@@ -0,0 +1,656 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/tiered_program.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/ast.h"
+#include "base/ast_internal/ast_impl.h"
+#include "base/ast_internal/expr.h"
+#include "base/builtins.h"
+#include "base/handle.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/map_value.h"
+#include "base/values/struct_value.h"
+#include "base/values/uint_value.h"
+#include "internal/overflow.h"
+#include "internal/status_macros.h"
+#include "runtime/activation_interface.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace runtime_internal {
+
+namespace {
+
+using ::cel::ast_internal::AstImpl;
+using ::cel::ast_internal::Constant;
+using ::cel::ast_internal::Expr;
+
+// An unboxed value of the kinds the compiled expression computes.
+struct Scalar {
+  enum class Kind { kBool, kInt, kUint, kDouble };
+
+  Kind kind;
+  union {
+    bool bool_value;
+    int64_t int_value;
+    uint64_t uint_value;
+    double double_value;
+  };
+};
+
+// A compiled subexpression. Evaluate returns false if the interpreter has to
+// evaluate the expression instead, and otherwise sets result.
+class Node {
+ public:
+  virtual ~Node() = default;
+
+  virtual bool Evaluate(const ActivationInterface& activation,
+                        ValueFactory& value_factory, Scalar& result) const = 0;
+};
+
+class ConstantNode final : public Node {
+ public:
+  explicit ConstantNode(Scalar value) : value_(value) {}
+
+  bool Evaluate(const ActivationInterface&, ValueFactory&,
+                Scalar& result) const override {
+    result = value_;
+    return true;
+  }
+
+ private:
+  const Scalar value_;
+};
+
+// A variable, or a chain of fields selected from one.
+class AttributeNode final : public Node {
+ public:
+  AttributeNode(std::string variable, std::vector<std::string> fields)
+      : variable_(std::move(variable)), fields_(std::move(fields)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    absl::StatusOr<absl::optional<Handle<Value>>> variable =
+        activation.FindVariable(value_factory, variable_);
+    if (!variable.ok() || !variable->has_value()) {
+      return false;
+    }
+    Handle<Value> value = std::move(**variable);
+    for (const std::string& field : fields_) {
+      absl::StatusOr<Handle<Value>> selected;
+      if (value->Is<StructValue>()) {
+        selected = value->As<StructValue>().GetFieldByName(value_factory,
+                                                           field);
+      } else if (value->Is<MapValue>()) {
+        selected = value->As<MapValue>().Get(
+            value_factory, value_factory.CreateUncheckedStringValue(field));
+      } else {
+        return false;
+      }
+      if (!selected.ok()) {
+        return false;
+      }
+      value = *std::move(selected);
+    }
+    switch (value->kind()) {
+      case ValueKind::kBool:
+        result.kind = Scalar::Kind::kBool;
+        result.bool_value = value->As<BoolValue>().NativeValue();
+        return true;
+      case ValueKind::kInt:
+        result.kind = Scalar::Kind::kInt;
+        result.int_value = value->As<IntValue>().NativeValue();
+        return true;
+      case ValueKind::kUint:
+        result.kind = Scalar::Kind::kUint;
+        result.uint_value = value->As<UintValue>().NativeValue();
+        return true;
+      case ValueKind::kDouble:
+        result.kind = Scalar::Kind::kDouble;
+        result.double_value = value->As<DoubleValue>().NativeValue();
+        return true;
+      default:
+        // Errors, unknowns and values of other types.
+        return false;
+    }
+  }
+
+ private:
+  const std::string variable_;
+  const std::vector<std::string> fields_;
+};
+
+class NotNode final : public Node {
+ public:
+  explicit NotNode(std::unique_ptr<Node> operand)
+      : operand_(std::move(operand)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    if (!operand_->Evaluate(activation, value_factory, result) ||
+        result.kind != Scalar::Kind::kBool) {
+      return false;
+    }
+    result.bool_value = !result.bool_value;
+    return true;
+  }
+
+ private:
+  const std::unique_ptr<Node> operand_;
+};
+
+class NegateNode final : public Node {
+ public:
+  explicit NegateNode(std::unique_ptr<Node> operand)
+      : operand_(std::move(operand)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    if (!operand_->Evaluate(activation, value_factory, result)) {
+      return false;
+    }
+    switch (result.kind) {
+      case Scalar::Kind::kInt:
+        return cel::internal::TryNegation(result.int_value,
+                                          &result.int_value);
+      case Scalar::Kind::kDouble:
+        result.double_value = -result.double_value;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+ private:
+  const std::unique_ptr<Node> operand_;
+};
+
+// `&&` or `||`. An operand the compiled expression can't evaluate hands the
+// evaluation to the interpreter, even if the other operand decides the
+// result, as the interpreter would then absorb an error.
+class LogicalNode final : public Node {
+ public:
+  LogicalNode(bool conjunction, std::unique_ptr<Node> lhs,
+              std::unique_ptr<Node> rhs)
+      : conjunction_(conjunction), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    if (!lhs_->Evaluate(activation, value_factory, result) ||
+        result.kind != Scalar::Kind::kBool) {
+      return false;
+    }
+    if (result.bool_value != conjunction_) {
+      // false && _ or true || _.
+      return true;
+    }
+    return rhs_->Evaluate(activation, value_factory, result) &&
+           result.kind == Scalar::Kind::kBool;
+  }
+
+ private:
+  const bool conjunction_;
+  const std::unique_ptr<Node> lhs_;
+  const std::unique_ptr<Node> rhs_;
+};
+
+class TernaryNode final : public Node {
+ public:
+  TernaryNode(std::unique_ptr<Node> condition, std::unique_ptr<Node> lhs,
+              std::unique_ptr<Node> rhs)
+      : condition_(std::move(condition)),
+        lhs_(std::move(lhs)),
+        rhs_(std::move(rhs)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    if (!condition_->Evaluate(activation, value_factory, result) ||
+        result.kind != Scalar::Kind::kBool) {
+      return false;
+    }
+    return (result.bool_value ? lhs_ : rhs_)
+        ->Evaluate(activation, value_factory, result);
+  }
+
+ private:
+  const std::unique_ptr<Node> condition_;
+  const std::unique_ptr<Node> lhs_;
+  const std::unique_ptr<Node> rhs_;
+};
+
+enum class BinaryOp {
+  kAdd,
+  kSubtract,
+  kMultiply,
+  kDivide,
+  kModulo,
+  kEqual,
+  kNotEqual,
+  kLess,
+  kLessOrEqual,
+  kGreater,
+  kGreaterOrEqual,
+};
+
+template <typename T>
+bool Compare(BinaryOp op, T x, T y, Scalar& result) {
+  result.kind = Scalar::Kind::kBool;
+  switch (op) {
+    case BinaryOp::kEqual:
+      result.bool_value = x == y;
+      return true;
+    case BinaryOp::kNotEqual:
+      result.bool_value = x != y;
+      return true;
+    case BinaryOp::kLess:
+      result.bool_value = x < y;
+      return true;
+    case BinaryOp::kLessOrEqual:
+      result.bool_value = x <= y;
+      return true;
+    case BinaryOp::kGreater:
+      result.bool_value = x > y;
+      return true;
+    case BinaryOp::kGreaterOrEqual:
+      result.bool_value = x >= y;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IntArithmetic(BinaryOp op, int64_t x, int64_t y, int64_t& result) {
+  switch (op) {
+    case BinaryOp::kAdd:
+      return cel::internal::TryAdd(x, y, &result);
+    case BinaryOp::kSubtract:
+      return cel::internal::TrySub(x, y, &result);
+    case BinaryOp::kMultiply:
+      return cel::internal::TryMul(x, y, &result);
+    case BinaryOp::kDivide:
+      if (y == 0 || (x == std::numeric_limits<int64_t>::min() && y == -1)) {
+        return false;
+      }
+      result = x / y;
+      return true;
+    case BinaryOp::kModulo:
+      if (y == 0 || (x == std::numeric_limits<int64_t>::min() && y == -1)) {
+        return false;
+      }
+      result = x % y;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool UintArithmetic(BinaryOp op, uint64_t x, uint64_t y, uint64_t& result) {
+  switch (op) {
+    case BinaryOp::kAdd:
+      return cel::internal::TryAdd(x, y, &result);
+    case BinaryOp::kSubtract:
+      return cel::internal::TrySub(x, y, &result);
+    case BinaryOp::kMultiply:
+      return cel::internal::TryMul(x, y, &result);
+    case BinaryOp::kDivide:
+      if (y == 0) {
+        return false;
+      }
+      result = x / y;
+      return true;
+    case BinaryOp::kModulo:
+      if (y == 0) {
+        return false;
+      }
+      result = x % y;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool DoubleArithmetic(BinaryOp op, double x, double y, double& result) {
+  switch (op) {
+    case BinaryOp::kAdd:
+      result = x + y;
+      return true;
+    case BinaryOp::kSubtract:
+      result = x - y;
+      return true;
+    case BinaryOp::kMultiply:
+      result = x * y;
+      return true;
+    case BinaryOp::kDivide:
+      result = x / y;
+      return true;
+    default:
+      // There is no double modulo.
+      return false;
+  }
+}
+
+bool IsComparison(BinaryOp op) { return op >= BinaryOp::kEqual; }
+
+// Arithmetic and comparisons of operands of the same kind. Mixed kinds are
+// left to the interpreter, which may compare them numerically.
+class BinaryNode final : public Node {
+ public:
+  BinaryNode(BinaryOp op, std::unique_ptr<Node> lhs, std::unique_ptr<Node> rhs)
+      : op_(op), lhs_(std::move(lhs)), rhs_(std::move(rhs)) {}
+
+  bool Evaluate(const ActivationInterface& activation,
+                ValueFactory& value_factory, Scalar& result) const override {
+    Scalar rhs;
+    if (!lhs_->Evaluate(activation, value_factory, result) ||
+        !rhs_->Evaluate(activation, value_factory, rhs) ||
+        result.kind != rhs.kind) {
+      return false;
+    }
+    if (IsComparison(op_)) {
+      switch (result.kind) {
+        case Scalar::Kind::kBool:
+          return Compare(op_, result.bool_value, rhs.bool_value, result);
+        case Scalar::Kind::kInt:
+          return Compare(op_, result.int_value, rhs.int_value, result);
+        case Scalar::Kind::kUint:
+          return Compare(op_, result.uint_value, rhs.uint_value, result);
+        case Scalar::Kind::kDouble:
+          return Compare(op_, result.double_value, rhs.double_value, result);
+      }
+      return false;
+    }
+    switch (result.kind) {
+      case Scalar::Kind::kInt:
+        return IntArithmetic(op_, result.int_value, rhs.int_value,
+                             result.int_value);
+      case Scalar::Kind::kUint:
+        return UintArithmetic(op_, result.uint_value, rhs.uint_value,
+                              result.uint_value);
+      case Scalar::Kind::kDouble:
+        return DoubleArithmetic(op_, result.double_value, rhs.double_value,
+                                result.double_value);
+      default:
+        return false;
+    }
+  }
+
+ private:
+  const BinaryOp op_;
+  const std::unique_ptr<Node> lhs_;
+  const std::unique_ptr<Node> rhs_;
+};
+
+absl::optional<BinaryOp> BinaryOpOf(absl::string_view function) {
+  static constexpr std::pair<absl::string_view, BinaryOp> kOps[] = {
+      {builtin::kAdd, BinaryOp::kAdd},
+      {builtin::kSubtract, BinaryOp::kSubtract},
+      {builtin::kMultiply, BinaryOp::kMultiply},
+      {builtin::kDivide, BinaryOp::kDivide},
+      {builtin::kModulo, BinaryOp::kModulo},
+      {builtin::kEqual, BinaryOp::kEqual},
+      {builtin::kInequal, BinaryOp::kNotEqual},
+      {builtin::kLess, BinaryOp::kLess},
+      {builtin::kLessOrEqual, BinaryOp::kLessOrEqual},
+      {builtin::kGreater, BinaryOp::kGreater},
+      {builtin::kGreaterOrEqual, BinaryOp::kGreaterOrEqual},
+  };
+  for (const auto& [name, op] : kOps) {
+    if (function == name) {
+      return op;
+    }
+  }
+  return absl::nullopt;
+}
+
+absl::optional<Scalar> ScalarOf(const Constant& constant) {
+  Scalar scalar;
+  if (constant.has_bool_value()) {
+    scalar.kind = Scalar::Kind::kBool;
+    scalar.bool_value = constant.bool_value();
+  } else if (constant.has_int64_value()) {
+    scalar.kind = Scalar::Kind::kInt;
+    scalar.int_value = constant.int64_value();
+  } else if (constant.has_uint64_value()) {
+    scalar.kind = Scalar::Kind::kUint;
+    scalar.uint_value = constant.uint64_value();
+  } else if (constant.has_double_value()) {
+    scalar.kind = Scalar::Kind::kDouble;
+    scalar.double_value = constant.double_value();
+  } else {
+    return absl::nullopt;
+  }
+  return scalar;
+}
+
+// Compiles the expressions of the supported subset, returning nullptr for
+// any other.
+class Compiler final {
+ public:
+  explicit Compiler(const AstImpl& ast) : ast_(ast) {}
+
+  std::unique_ptr<Node> Compile(const Expr& expr) {
+    if (expr.has_const_expr()) {
+      absl::optional<Scalar> scalar = ScalarOf(expr.const_expr());
+      if (!scalar.has_value()) {
+        return nullptr;
+      }
+      return std::make_unique<ConstantNode>(*scalar);
+    }
+    if (expr.has_ident_expr() || expr.has_select_expr()) {
+      return CompileAttribute(expr);
+    }
+    if (!expr.has_call_expr() || expr.call_expr().has_target()) {
+      return nullptr;
+    }
+    const auto& call = expr.call_expr();
+    std::vector<std::unique_ptr<Node>> args;
+    for (const Expr& arg : call.args()) {
+      if (args.emplace_back(Compile(arg)) == nullptr) {
+        return nullptr;
+      }
+    }
+    absl::string_view function = call.function();
+    switch (args.size()) {
+      case 1:
+        if (function == builtin::kNot) {
+          return std::make_unique<NotNode>(std::move(args[0]));
+        }
+        if (function == builtin::kNeg) {
+          return std::make_unique<NegateNode>(std::move(args[0]));
+        }
+        return nullptr;
+      case 2:
+        if (function == builtin::kAnd || function == builtin::kOr) {
+          return std::make_unique<LogicalNode>(function == builtin::kAnd,
+                                               std::move(args[0]),
+                                               std::move(args[1]));
+        }
+        if (absl::optional<BinaryOp> op = BinaryOpOf(function);
+            op.has_value()) {
+          return std::make_unique<BinaryNode>(*op, std::move(args[0]),
+                                              std::move(args[1]));
+        }
+        return nullptr;
+      case 3:
+        if (function == builtin::kTernary) {
+          return std::make_unique<TernaryNode>(
+              std::move(args[0]), std::move(args[1]), std::move(args[2]));
+        }
+        return nullptr;
+      default:
+        return nullptr;
+    }
+  }
+
+ private:
+  std::unique_ptr<Node> CompileAttribute(const Expr& expr) {
+    std::vector<std::string> fields;
+    const Expr* operand = &expr;
+    while (true) {
+      if (const auto* reference = ast_.GetReference(operand->id());
+          reference != nullptr) {
+        // Enum constants and other values resolved by the checker are left
+        // to the interpreter.
+        if (reference->has_value() || reference->name().empty()) {
+          return nullptr;
+        }
+        std::reverse(fields.begin(), fields.end());
+        return std::make_unique<AttributeNode>(reference->name(),
+                                               std::move(fields));
+      }
+      if (operand->has_ident_expr()) {
+        std::reverse(fields.begin(), fields.end());
+        return std::make_unique<AttributeNode>(operand->ident_expr().name(),
+                                               std::move(fields));
+      }
+      if (!operand->has_select_expr() ||
+          operand->select_expr().test_only()) {
+        return nullptr;
+      }
+      fields.push_back(operand->select_expr().field());
+      operand = &operand->select_expr().operand();
+    }
+  }
+
+  const AstImpl& ast_;
+};
+
+}  // namespace
+
+class CompiledExpression final {
+ public:
+  explicit CompiledExpression(std::unique_ptr<Node> root)
+      : root_(std::move(root)) {}
+
+  // Returns the result, or nullopt if the interpreter has to evaluate the
+  // expression.
+  absl::optional<Handle<Value>> Evaluate(const ActivationInterface& activation,
+                                         ValueFactory& value_factory) const {
+    Scalar result;
+    if (!root_->Evaluate(activation, value_factory, result)) {
+      return absl::nullopt;
+    }
+    switch (result.kind) {
+      case Scalar::Kind::kBool:
+        return value_factory.CreateBoolValue(result.bool_value);
+      case Scalar::Kind::kInt:
+        return value_factory.CreateIntValue(result.int_value);
+      case Scalar::Kind::kUint:
+        return value_factory.CreateUintValue(result.uint_value);
+      case Scalar::Kind::kDouble:
+        return value_factory.CreateDoubleValue(result.double_value);
+    }
+    return absl::nullopt;
+  }
+
+ private:
+  const std::unique_ptr<Node> root_;
+};
+
+}  // namespace runtime_internal
+
+TieredProgram::TieredProgram(std::unique_ptr<Program> program,
+                             std::unique_ptr<Ast> ast,
+                             const TieredProgramOptions& options)
+    : program_(std::move(program)), options_(options), ast_(std::move(ast)) {}
+
+TieredProgram::~TieredProgram() = default;
+
+void TieredProgram::Compile() const {
+  const auto& ast = ast_internal::AstImpl::CastFromPublicAst(*ast_);
+  std::unique_ptr<runtime_internal::Node> root =
+      runtime_internal::Compiler(ast).Compile(ast.root_expr());
+  ast_.reset();
+  if (root == nullptr) {
+    return;
+  }
+  compiled_storage_ =
+      std::make_unique<runtime_internal::CompiledExpression>(std::move(root));
+  compiled_.store(compiled_storage_.get(), std::memory_order_release);
+}
+
+absl::StatusOr<Handle<Value>> TieredProgram::Evaluate(
+    const ActivationInterface& activation, ValueFactory& value_factory) const {
+  // Only the evaluation reaching the threshold compiles, so ast_ and
+  // compiled_storage_ are written by a single thread.
+  if (evaluations_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+      options_.compile_threshold) {
+    Compile();
+  }
+  const runtime_internal::CompiledExpression* compiled =
+      compiled_.load(std::memory_order_acquire);
+  // Unknown and missing attribute patterns may match any attribute, which
+  // only the interpreter tracks.
+  if (compiled != nullptr && activation.GetUnknownAttributes().empty() &&
+      activation.GetMissingAttributes().empty()) {
+    if (absl::optional<Handle<Value>> result =
+            compiled->Evaluate(activation, value_factory);
+        result.has_value()) {
+      compiled_evaluations_.fetch_add(1, std::memory_order_relaxed);
+      return *std::move(result);
+    }
+    fallbacks_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return program_->Evaluate(activation, value_factory);
+}
+
+TieredProgramStats TieredProgram::GetStats() const {
+  TieredProgramStats stats;
+  stats.evaluations = evaluations_.load(std::memory_order_relaxed);
+  stats.compiled_evaluations =
+      compiled_evaluations_.load(std::memory_order_relaxed);
+  stats.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+  stats.compiled = compiled_.load(std::memory_order_acquire) != nullptr;
+  return stats;
+}
+
+absl::StatusOr<std::unique_ptr<TieredProgram>> CreateTieredProgram(
+    const Runtime& runtime, std::unique_ptr<Ast> ast,
+    const TieredProgramOptions& options) {
+  if (ast == nullptr) {
+    return absl::InvalidArgumentError("AST must not be null");
+  }
+  auto copy = std::make_unique<ast_internal::AstImpl>(
+      ast_internal::AstImpl::CastFromPublicAst(*ast).DeepCopy());
+  CEL_ASSIGN_OR_RETURN(std::unique_ptr<Program> program,
+                       runtime.CreateProgram(std::move(copy)));
+  auto tiered = absl::WrapUnique(
+      new TieredProgram(std::move(program), std::move(ast), options));
+  if (options.compile_threshold == 0) {
+    tiered->Compile();
+  }
+  return tiered;
+}
+
+}  // namespace cel
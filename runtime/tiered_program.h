@@ -0,0 +1,130 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_TIERED_PROGRAM_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_TIERED_PROGRAM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "runtime/activation_interface.h"
+#include "runtime/referenced_attribute.h"
+#include "runtime/runtime.h"
+
+namespace cel {
+
+namespace runtime_internal {
+class CompiledExpression;
+}  // namespace runtime_internal
+
+struct TieredProgramOptions {
+  // The number of evaluations after which the expression is compiled. Zero
+  // compiles it when the program is created.
+  uint64_t compile_threshold = 10000;
+};
+
+struct TieredProgramStats {
+  uint64_t evaluations = 0;
+  // Evaluations completed by the compiled expression.
+  uint64_t compiled_evaluations = 0;
+  // Evaluations the compiled expression handed back to the interpreter.
+  uint64_t fallbacks = 0;
+  bool compiled = false;
+};
+
+// A program evaluated by the interpreter until it is hot, and then by a
+// compiled form of the expression for the supported subset:
+//  - bool, int, uint and double constants,
+//  - variables, and fields selected from them,
+//  - arithmetic, comparisons and negation of operands of the same type,
+//  - `!`, `&&`, `||` and `_?_:_`.
+// The compiled form is a tree of specialized nodes computing unboxed
+// scalars, without the value stack, the execution frame or function
+// dispatch of the interpreter.
+//
+// Expressions outside the subset are never compiled. Evaluations whose
+// operands or results the compiled form doesn't handle (values of other
+// types, errors, overflows, unknowns) are handed back to the interpreter,
+// so results are the same as the interpreter's, as long as the runtime
+// keeps the standard definitions of the functions above. Unchecked
+// expressions are compiled with variables named as written, so they should
+// only be compiled for runtimes without a container.
+//
+// Thread-safe like Program.
+class TieredProgram final : public Program {
+ public:
+  ~TieredProgram() override;
+
+  absl::StatusOr<Handle<Value>> Evaluate(
+      const ActivationInterface& activation,
+      ValueFactory& value_factory) const override;
+
+  const TypeProvider& GetTypeProvider() const override {
+    return program_->GetTypeProvider();
+  }
+
+  absl::Span<const std::string> GetVariableNames() const override {
+    return program_->GetVariableNames();
+  }
+
+  absl::Span<const ReferencedAttribute> GetReferencedAttributes()
+      const override {
+    return program_->GetReferencedAttributes();
+  }
+
+  TieredProgramStats GetStats() const;
+
+ private:
+  friend absl::StatusOr<std::unique_ptr<TieredProgram>> CreateTieredProgram(
+      const Runtime& runtime, std::unique_ptr<Ast> ast,
+      const TieredProgramOptions& options);
+
+  TieredProgram(std::unique_ptr<Program> program, std::unique_ptr<Ast> ast,
+                const TieredProgramOptions& options);
+
+  void Compile() const;
+
+  const std::unique_ptr<Program> program_;
+  const TieredProgramOptions options_;
+  // The AST, until it is compiled.
+  mutable std::unique_ptr<Ast> ast_;
+  // Set once by the evaluation reaching the threshold. Null if the
+  // expression is not compiled yet or can't be.
+  mutable std::unique_ptr<const runtime_internal::CompiledExpression>
+      compiled_storage_;
+  mutable std::atomic<const runtime_internal::CompiledExpression*> compiled_{
+      nullptr};
+  mutable std::atomic<uint64_t> evaluations_{0};
+  mutable std::atomic<uint64_t> compiled_evaluations_{0};
+  mutable std::atomic<uint64_t> fallbacks_{0};
+};
+
+// Plans ast in runtime, to be compiled after
+// `options.compile_threshold` evaluations.
+absl::StatusOr<std::unique_ptr<TieredProgram>> CreateTieredProgram(
+    const Runtime& runtime, std::unique_ptr<Ast> ast,
+    const TieredProgramOptions& options = {});
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_TIERED_PROGRAM_H_
@@ -0,0 +1,163 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/tiered_program.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/ast.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "common/json.h"
+#include "extensions/protobuf/ast_converters.h"
+#include "internal/status_macros.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::CreateAstFromParsedExpr;
+using ::google::api::expr::parser::Parse;
+using cel::internal::IsOkAndHolds;
+
+class TieredProgramTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                         CreateStandardRuntimeBuilder(RuntimeOptions()));
+    ASSERT_OK_AND_ASSIGN(runtime_, std::move(builder).Build());
+  }
+
+  absl::StatusOr<std::unique_ptr<TieredProgram>> CreateProgram(
+      absl::string_view expr, uint64_t compile_threshold) {
+    CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<Ast> ast,
+                         CreateAstFromParsedExpr(std::move(parsed_expr)));
+    TieredProgramOptions options;
+    options.compile_threshold = compile_threshold;
+    return CreateTieredProgram(*runtime_, std::move(ast), options);
+  }
+
+  // Evaluates program for x, checking that the result is the same as the
+  // interpreter's.
+  absl::StatusOr<std::string> Evaluate(const TieredProgram& program,
+                                       absl::string_view expr,
+                                       Handle<Value> x) {
+    ValueFactory& value_factory = value_factory_.get();
+    Activation activation;
+    activation.InsertOrAssignValue("x", std::move(x));
+    CEL_ASSIGN_OR_RETURN(Handle<Value> result,
+                         program.Evaluate(activation, value_factory));
+
+    CEL_ASSIGN_OR_RETURN(auto parsed_expr, Parse(expr));
+    CEL_ASSIGN_OR_RETURN(std::unique_ptr<Ast> ast,
+                         CreateAstFromParsedExpr(std::move(parsed_expr)));
+    CEL_ASSIGN_OR_RETURN(auto interpreted,
+                         runtime_->CreateProgram(std::move(ast)));
+    CEL_ASSIGN_OR_RETURN(Handle<Value> expected,
+                         interpreted->Evaluate(activation, value_factory));
+    EXPECT_EQ(result->DebugString(), expected->DebugString());
+    return result->DebugString();
+  }
+
+ protected:
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+  std::unique_ptr<const Runtime> runtime_;
+};
+
+TEST_F(TieredProgramTest, CompilesAfterThreshold) {
+  constexpr absl::string_view kExpr = "x * 2 + 1 > 10 ? x - 1 : -x";
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram(kExpr, 2));
+  ValueFactory& value_factory = value_factory_.get();
+
+  EXPECT_THAT(Evaluate(*program, kExpr, value_factory.CreateIntValue(7)),
+              IsOkAndHolds("6"));
+  EXPECT_FALSE(program->GetStats().compiled);
+  EXPECT_THAT(Evaluate(*program, kExpr, value_factory.CreateIntValue(3)),
+              IsOkAndHolds("-3"));
+  EXPECT_TRUE(program->GetStats().compiled);
+  EXPECT_THAT(Evaluate(*program, kExpr, value_factory.CreateIntValue(8)),
+              IsOkAndHolds("7"));
+
+  TieredProgramStats stats = program->GetStats();
+  EXPECT_EQ(stats.evaluations, 3);
+  EXPECT_EQ(stats.compiled_evaluations, 2);
+  EXPECT_EQ(stats.fallbacks, 0);
+}
+
+TEST_F(TieredProgramTest, FallsBackToInterpreter) {
+  constexpr absl::string_view kExpr = "x + 1 == 2 || x > 100";
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram(kExpr, 0));
+  ValueFactory& value_factory = value_factory_.get();
+
+  EXPECT_THAT(Evaluate(*program, kExpr, value_factory.CreateIntValue(1)),
+              IsOkAndHolds("true"));
+  // Overflows.
+  ASSERT_OK(Evaluate(
+      *program, kExpr,
+      value_factory.CreateIntValue(std::numeric_limits<int64_t>::max())));
+  // Mixed numeric types.
+  ASSERT_OK(Evaluate(*program, kExpr, value_factory.CreateDoubleValue(1.0)));
+  ASSERT_OK(Evaluate(*program, kExpr, value_factory.CreateUintValue(1)));
+
+  TieredProgramStats stats = program->GetStats();
+  EXPECT_TRUE(stats.compiled);
+  EXPECT_EQ(stats.compiled_evaluations, 1);
+  EXPECT_EQ(stats.fallbacks, 3);
+}
+
+TEST_F(TieredProgramTest, SelectsFields) {
+  constexpr absl::string_view kExpr = "x.size > 1000.0 && x.retries < 3.0";
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram(kExpr, 0));
+  ValueFactory& value_factory = value_factory_.get();
+
+  EXPECT_THAT(Evaluate(*program, kExpr,
+                       value_factory.CreateMapValueFromJson(MakeJsonObject(
+                           {{JsonString("size"), 2000.0},
+                            {JsonString("retries"), 1.0}}))),
+              IsOkAndHolds("true"));
+  EXPECT_EQ(program->GetStats().compiled_evaluations, 1);
+}
+
+TEST_F(TieredProgramTest, DoesNotCompileUnsupportedExpressions) {
+  constexpr absl::string_view kExpr = "size(x) > 2";
+  ASSERT_OK_AND_ASSIGN(auto program, CreateProgram(kExpr, 0));
+  ValueFactory& value_factory = value_factory_.get();
+
+  ASSERT_OK_AND_ASSIGN(auto x, value_factory.CreateStringValue("abc"));
+  EXPECT_THAT(Evaluate(*program, kExpr, std::move(x)), IsOkAndHolds("true"));
+  TieredProgramStats stats = program->GetStats();
+  EXPECT_FALSE(stats.compiled);
+  EXPECT_EQ(stats.compiled_evaluations, 0);
+  EXPECT_EQ(stats.fallbacks, 0);
+}
+
+}  // namespace
+}  // namespace cel
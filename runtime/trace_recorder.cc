@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/trace_recorder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/casts.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "base/kind.h"
+#include "base/value.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/duration_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/map_value.h"
+#include "base/values/timestamp_value.h"
+#include "base/values/uint_value.h"
+
+namespace cel {
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : records_(std::max<size_t>(capacity, 1)) {}
+
+uint64_t TraceRecorder::Payload(const Value& value) {
+  switch (value.kind()) {
+    case ValueKind::kBool:
+      return value.As<BoolValue>().NativeValue() ? 1 : 0;
+    case ValueKind::kInt:
+      return static_cast<uint64_t>(value.As<IntValue>().NativeValue());
+    case ValueKind::kUint:
+      return value.As<UintValue>().NativeValue();
+    case ValueKind::kDouble:
+      return absl::bit_cast<uint64_t>(value.As<DoubleValue>().NativeValue());
+    case ValueKind::kDuration:
+      return static_cast<uint64_t>(
+          absl::ToInt64Microseconds(value.As<DurationValue>().NativeValue()));
+    case ValueKind::kTimestamp:
+      return static_cast<uint64_t>(
+          absl::ToUnixMicros(value.As<TimestampValue>().NativeValue()));
+    case ValueKind::kList:
+      return value.As<ListValue>().Size();
+    case ValueKind::kMap:
+      return value.As<MapValue>().Size();
+    default:
+      return 0;
+  }
+}
+
+std::vector<TraceRecorder::Record> TraceRecorder::Records() const {
+  std::vector<Record> records;
+  records.reserve(size());
+  if (appended_ > records_.size()) {
+    // The buffer wrapped, the oldest record is the next to be overwritten.
+    records.insert(records.end(), records_.begin() + next_, records_.end());
+  }
+  records.insert(records.end(), records_.begin(), records_.begin() + next_);
+  return records;
+}
+
+std::string TraceRecorder::Describe(const Record& record) {
+  std::string description =
+      absl::StrCat("#", record.expr_id, " ", ValueKindToString(record.kind));
+  switch (record.kind) {
+    case ValueKind::kBool:
+      absl::StrAppend(&description, record.payload != 0 ? " true" : " false");
+      break;
+    case ValueKind::kInt:
+      absl::StrAppend(&description, " ", static_cast<int64_t>(record.payload));
+      break;
+    case ValueKind::kUint:
+      absl::StrAppend(&description, " ", record.payload, "u");
+      break;
+    case ValueKind::kDouble:
+      absl::StrAppend(&description, " ",
+                      absl::bit_cast<double>(record.payload));
+      break;
+    case ValueKind::kDuration:
+      absl::StrAppend(&description, " ",
+                      absl::FormatDuration(absl::Microseconds(
+                          static_cast<int64_t>(record.payload))));
+      break;
+    case ValueKind::kTimestamp:
+      absl::StrAppend(
+          &description, " ",
+          absl::FormatTime(absl::RFC3339_full,
+                           absl::FromUnixMicros(
+                               static_cast<int64_t>(record.payload)),
+                           absl::UTCTimeZone()));
+      break;
+    case ValueKind::kList:
+    case ValueKind::kMap:
+      absl::StrAppend(&description, " size=", record.payload);
+      break;
+    default:
+      break;
+  }
+  return description;
+}
+
+}  // namespace cel
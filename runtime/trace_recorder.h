@@ -0,0 +1,107 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_TRACE_RECORDER_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_TRACE_RECORDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/kind.h"
+#include "base/value.h"
+
+namespace cel {
+
+// Fixed size ring buffer of the subexpression results of evaluations,
+// recorded by TraceableProgram::Record.
+//
+// Unlike a listener, recording does not call back into user code or retain
+// values: each result is appended as a compact record of its expression id,
+// kind and a scalar payload, so tracing can stay enabled, e.g. as a flight
+// recorder for audits. Records are decoded on demand with Describe. When the
+// buffer is full, the oldest records are overwritten.
+//
+// The memory is allocated once, when the recorder is created. Not
+// thread-safe; use one recorder per thread.
+class TraceRecorder final {
+ public:
+  struct Record {
+    int64_t expr_id = 0;
+    // Depends on kind:
+    // - bool, int, uint: the value, as its two's complement bits.
+    // - double: the bits of the value.
+    // - duration: the number of microseconds.
+    // - timestamp: microseconds since the Unix epoch.
+    // - list, map: the number of elements.
+    // - others: zero.
+    uint64_t payload = 0;
+    ValueKind kind = ValueKind::kNull;
+  };
+
+  // capacity is the number of records kept, at least one.
+  explicit TraceRecorder(size_t capacity);
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  // Appends a record of the result of the expression expr_id, overwriting the
+  // oldest record if the buffer is full.
+  void Append(int64_t expr_id, const Value& value) {
+    Record& record = records_[next_];
+    record.expr_id = expr_id;
+    record.kind = value.kind();
+    record.payload = Payload(value);
+    if (++next_ == records_.size()) {
+      next_ = 0;
+    }
+    ++appended_;
+  }
+
+  size_t capacity() const { return records_.size(); }
+
+  // Returns the number of records held.
+  size_t size() const {
+    return appended_ < records_.size() ? static_cast<size_t>(appended_)
+                                       : records_.size();
+  }
+
+  // Returns the number of records overwritten since the last Clear.
+  uint64_t dropped() const { return appended_ - size(); }
+
+  // Returns the records held, oldest first.
+  std::vector<Record> Records() const;
+
+  // Drops all records, keeping the buffer.
+  void Clear() {
+    next_ = 0;
+    appended_ = 0;
+  }
+
+  // Renders record as text, e.g. `#3 int 42` or `#7 list size=2`.
+  static std::string Describe(const Record& record);
+
+ private:
+  static uint64_t Payload(const Value& value);
+
+  std::vector<Record> records_;
+  // Position of the next record.
+  size_t next_ = 0;
+  uint64_t appended_ = 0;
+};
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_TRACE_RECORDER_H_
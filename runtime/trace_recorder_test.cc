@@ -0,0 +1,127 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "runtime/trace_recorder.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "google/api/expr/v1alpha1/syntax.pb.h"
+#include "absl/time/time.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/int_value.h"
+#include "extensions/protobuf/runtime_adapter.h"
+#include "internal/testing.h"
+#include "parser/parser.h"
+#include "runtime/activation.h"
+#include "runtime/managed_value_factory.h"
+#include "runtime/runtime.h"
+#include "runtime/runtime_builder.h"
+#include "runtime/runtime_options.h"
+#include "runtime/standard_runtime_builder_factory.h"
+
+namespace cel {
+namespace {
+
+using ::cel::extensions::ProtobufRuntimeAdapter;
+using ::google::api::expr::parser::Parse;
+using ::google::api::expr::v1alpha1::ParsedExpr;
+using testing::ElementsAre;
+
+std::vector<std::string> Describe(const TraceRecorder& recorder) {
+  std::vector<std::string> descriptions;
+  for (const TraceRecorder::Record& record : recorder.Records()) {
+    descriptions.push_back(TraceRecorder::Describe(record));
+  }
+  return descriptions;
+}
+
+class TraceRecorderTest : public testing::Test {
+ protected:
+  ManagedValueFactory value_factory_{TypeProvider::Builtin(),
+                                     MemoryManagerRef::ReferenceCounting()};
+};
+
+TEST_F(TraceRecorderTest, DescribesScalarPayloads) {
+  ValueFactory& value_factory = value_factory_.get();
+  TraceRecorder recorder(8);
+  recorder.Append(1, *value_factory.CreateBoolValue(true));
+  recorder.Append(2, *value_factory.CreateIntValue(-3));
+  recorder.Append(3, *value_factory.CreateUintValue(4));
+  recorder.Append(4, *value_factory.CreateDoubleValue(1.5));
+  ASSERT_OK_AND_ASSIGN(auto duration,
+                       value_factory.CreateDurationValue(absl::Seconds(2)));
+  recorder.Append(5, *duration);
+  ASSERT_OK_AND_ASSIGN(
+      auto timestamp,
+      value_factory.CreateTimestampValue(absl::FromUnixSeconds(0)));
+  recorder.Append(6, *timestamp);
+  recorder.Append(7, *value_factory.GetNullValue());
+
+  EXPECT_THAT(Describe(recorder),
+              ElementsAre("#1 bool true", "#2 int -3", "#3 uint 4u",
+                          "#4 double 1.5", "#5 duration 2s",
+                          "#6 timestamp 1970-01-01T00:00:00+00:00",
+                          "#7 null_type"));
+  EXPECT_EQ(recorder.dropped(), 0u);
+}
+
+TEST_F(TraceRecorderTest, OverwritesOldestRecords) {
+  ValueFactory& value_factory = value_factory_.get();
+  TraceRecorder recorder(2);
+  for (int i = 1; i <= 5; ++i) {
+    recorder.Append(i, *value_factory.CreateIntValue(i * 10));
+  }
+
+  EXPECT_THAT(Describe(recorder), ElementsAre("#4 int 40", "#5 int 50"));
+  EXPECT_EQ(recorder.size(), 2u);
+  EXPECT_EQ(recorder.dropped(), 3u);
+
+  recorder.Clear();
+  EXPECT_THAT(recorder.Records(), testing::IsEmpty());
+  EXPECT_EQ(recorder.capacity(), 2u);
+}
+
+TEST_F(TraceRecorderTest, RecordsEvaluation) {
+  ASSERT_OK_AND_ASSIGN(RuntimeBuilder builder,
+                       CreateStandardRuntimeBuilder(RuntimeOptions()));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<const Runtime> runtime,
+                       std::move(builder).Build());
+  ASSERT_OK_AND_ASSIGN(ParsedExpr expr, Parse("[1, 2].size() + 3"));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<TraceableProgram> program,
+                       ProtobufRuntimeAdapter::CreateProgram(*runtime, expr));
+
+  TraceRecorder recorder(16);
+  Activation activation;
+  ASSERT_OK_AND_ASSIGN(Handle<Value> result,
+                       program->Record(activation, recorder,
+                                       value_factory_.get()));
+  ASSERT_TRUE(result->Is<IntValue>());
+  EXPECT_EQ(result.As<IntValue>()->NativeValue(), 5);
+
+  std::vector<std::string> descriptions = Describe(recorder);
+  ASSERT_FALSE(descriptions.empty());
+  EXPECT_THAT(descriptions.back(), testing::EndsWith("int 5"));
+  EXPECT_THAT(descriptions,
+              testing::Contains(testing::EndsWith("list size=2")));
+}
+
+}  // namespace
+}  // namespace cel
@@ -0,0 +1,42 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_RUNTIME_TYPE_INFERENCE_H_
+#define THIRD_PARTY_CEL_CPP_RUNTIME_TYPE_INFERENCE_H_
+
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "base/ast_internal/expr.h"
+#include "runtime/runtime_builder.h"
+
+namespace cel::extensions {
+
+// Enable type inference for parsed-only expressions in the runtime being
+// built.
+//
+// The types of literals, of the given variables, of message literals and
+// fields known to the type provider, and of the standard operators applied to
+// them are inferred before programs are planned, so calls can be bound to the
+// single overload matching their argument kinds as for checked expressions.
+// Inferred types are only hints: variables bound to values of other types are
+// still evaluated as they would be without inference.
+absl::Status EnableTypeInference(
+    RuntimeBuilder& builder,
+    absl::flat_hash_map<std::string, ast_internal::Type> variable_types = {});
+
+}  // namespace cel::extensions
+
+#endif  // THIRD_PARTY_CEL_CPP_RUNTIME_TYPE_INFERENCE_H_
@@ -14,19 +14,50 @@
 
 #include "runtime/type_registry.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_provider.h"
 
 namespace cel {
 
+namespace {
+
+// Provides the types of the base of a layered registry.
+class BaseTypeProvider final : public TypeProvider {
+ public:
+  explicit BaseTypeProvider(std::shared_ptr<const TypeRegistry> base)
+      : base_(std::move(base)) {}
+
+  absl::StatusOr<absl::optional<Handle<Type>>> ProvideType(
+      TypeFactory& factory, absl::string_view name) const override {
+    return base_->GetComposedTypeProvider().ProvideType(factory, name);
+  }
+
+ private:
+  std::shared_ptr<const TypeRegistry> base_;
+};
+
+}  // namespace
+
 TypeRegistry::TypeRegistry() {
   RegisterEnum("google.protobuf.NullValue", {{"NULL_VALUE", 0}});
 }
 
+TypeRegistry::TypeRegistry(std::shared_ptr<const TypeRegistry> base)
+    : enum_types_(base->resolveable_enums()) {
+  impl_.AddTypeProvider(std::make_unique<BaseTypeProvider>(std::move(base)));
+}
+
 void TypeRegistry::RegisterEnum(absl::string_view enum_name,
                                 std::vector<Enumerator> enumerators) {
   enum_types_[enum_name] =
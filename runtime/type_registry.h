@@ -48,6 +48,14 @@ class TypeRegistry {
 
   TypeRegistry();
 
+  // Create a registry layered on top of base.
+  //
+  // The types of base are provided before those of providers added to this
+  // registry, and the enums of base are resolved as well. base can no longer
+  // be modified, so a single base can be shared by the registries of many
+  // runtimes.
+  explicit TypeRegistry(std::shared_ptr<const TypeRegistry> base);
+
   // Move-only
   TypeRegistry(const TypeRegistry& other) = delete;
   TypeRegistry& operator=(TypeRegistry& other) = delete;
@@ -0,0 +1,916 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/flatbuffers_backed_value.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/nullability.h"
+#include "absl/base/optimization.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "base/handle.h"
+#include "base/type.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/types/list_type.h"
+#include "base/types/map_type.h"
+#include "base/types/struct_type.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/list_value_builder.h"
+#include "base/values/map_value.h"
+#include "base/values/string_value.h"
+#include "base/values/struct_value.h"
+#include "base/values/uint_value.h"
+#include "internal/overloaded.h"
+#include "internal/status_macros.h"
+#include "runtime/internal/errors.h"
+#include "flatbuffers/flatbuffers.h"
+#include "flatbuffers/reflection.h"
+
+namespace cel {
+
+namespace {
+
+using ::cel::base_internal::FieldIdFactory;
+
+using Object = FlatBuffersSchemaIndex::Object;
+using IndexedField = FlatBuffersSchemaIndex::Field;
+
+using TableVector =
+    flatbuffers::Vector<flatbuffers::Offset<flatbuffers::Table>>;
+using StringVector =
+    flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>;
+
+absl::string_view ToStringView(const flatbuffers::String* value) {
+  if (value == nullptr) {
+    return absl::string_view();
+  }
+  return absl::string_view(value->c_str(), value->size());
+}
+
+bool IsSignedScalar(reflection::BaseType type) {
+  return type == reflection::Byte || type == reflection::Short ||
+         type == reflection::Int || type == reflection::Long;
+}
+
+bool IsUnsignedScalar(reflection::BaseType type) {
+  return type == reflection::UByte || type == reflection::UShort ||
+         type == reflection::UInt || type == reflection::ULong;
+}
+
+bool IsFloatingScalar(reflection::BaseType type) {
+  return type == reflection::Float || type == reflection::Double;
+}
+
+bool IsScalar(reflection::BaseType type) {
+  return IsSignedScalar(type) || IsUnsignedScalar(type) ||
+         IsFloatingScalar(type) || type == reflection::Bool;
+}
+
+int64_t ReadSigned(reflection::BaseType type, const uint8_t* data) {
+  switch (type) {
+    case reflection::Byte:
+      return flatbuffers::ReadScalar<int8_t>(data);
+    case reflection::Short:
+      return flatbuffers::ReadScalar<int16_t>(data);
+    case reflection::Int:
+      return flatbuffers::ReadScalar<int32_t>(data);
+    default:
+      return flatbuffers::ReadScalar<int64_t>(data);
+  }
+}
+
+uint64_t ReadUnsigned(reflection::BaseType type, const uint8_t* data) {
+  switch (type) {
+    case reflection::UByte:
+    case reflection::Bool:
+      return flatbuffers::ReadScalar<uint8_t>(data);
+    case reflection::UShort:
+      return flatbuffers::ReadScalar<uint16_t>(data);
+    case reflection::UInt:
+      return flatbuffers::ReadScalar<uint32_t>(data);
+    default:
+      return flatbuffers::ReadScalar<uint64_t>(data);
+  }
+}
+
+double ReadFloating(reflection::BaseType type, const uint8_t* data) {
+  if (type == reflection::Float) {
+    return flatbuffers::ReadScalar<float>(data);
+  }
+  return flatbuffers::ReadScalar<double>(data);
+}
+
+// Returns the scalar of type `type` stored at `data`.
+Handle<Value> ScalarValue(ValueFactory& value_factory,
+                          reflection::BaseType type, const uint8_t* data) {
+  if (IsSignedScalar(type)) {
+    return value_factory.CreateIntValue(ReadSigned(type, data));
+  }
+  if (IsUnsignedScalar(type)) {
+    return value_factory.CreateUintValue(ReadUnsigned(type, data));
+  }
+  if (IsFloatingScalar(type)) {
+    return value_factory.CreateDoubleValue(ReadFloating(type, data));
+  }
+  return value_factory.CreateBoolValue(ReadUnsigned(type, data) != 0);
+}
+
+std::string ScalarDebugString(reflection::BaseType type, const uint8_t* data) {
+  if (IsSignedScalar(type)) {
+    return absl::StrCat(ReadSigned(type, data));
+  }
+  if (IsUnsignedScalar(type)) {
+    return absl::StrCat(ReadUnsigned(type, data), "u");
+  }
+  if (IsFloatingScalar(type)) {
+    return absl::StrCat(ReadFloating(type, data));
+  }
+  return ReadUnsigned(type, data) != 0 ? "true" : "false";
+}
+
+std::string StringDebugString(absl::string_view value) {
+  return absl::StrCat("\"", absl::CEscape(value), "\"");
+}
+
+// Returns the value of a string key without copying it if it is flat.
+template <typename F>
+auto WithKey(const Handle<Value>& key, F f) {
+  return key->As<StringValue>().Visit(cel::internal::Overloaded{
+      [&f](absl::string_view key) { return f(key); },
+      [&f](const absl::Cord& key) {
+        if (auto flat = key.TryFlat(); flat.has_value()) {
+          return f(*flat);
+        }
+        return f(static_cast<std::string>(key));
+      }});
+}
+
+absl::Status UnsupportedFieldError(const IndexedField& field) {
+  return absl::UnimplementedError(
+      absl::StrCat("selecting FlatBuffers field ", field.parent->name, ".",
+                   field.name, " of type ",
+                   reflection::EnumNameBaseType(field.base_type),
+                   " is not supported"));
+}
+
+absl::StatusOr<Handle<Type>> ScalarType(TypeFactory& type_factory,
+                                        reflection::BaseType type) {
+  if (IsSignedScalar(type)) {
+    return type_factory.GetIntType();
+  }
+  if (IsUnsignedScalar(type)) {
+    return type_factory.GetUintType();
+  }
+  if (IsFloatingScalar(type)) {
+    return type_factory.GetDoubleType();
+  }
+  if (type == reflection::Bool) {
+    return type_factory.GetBoolType();
+  }
+  if (type == reflection::String) {
+    return type_factory.GetStringType();
+  }
+  return type_factory.GetDynType();
+}
+
+absl::StatusOr<Handle<StructType>> TableType(TypeFactory& type_factory,
+                                             const Object& object);
+
+absl::StatusOr<Handle<Type>> FieldType(TypeFactory& type_factory,
+                                       const IndexedField& field) {
+  if (field.base_type == reflection::Obj) {
+    if (field.nested == nullptr || field.nested->object->is_struct()) {
+      return type_factory.GetDynType();
+    }
+    return TableType(type_factory, *field.nested);
+  }
+  if (field.base_type != reflection::Vector) {
+    return ScalarType(type_factory, field.base_type);
+  }
+  if (field.element == reflection::Byte || field.element == reflection::UByte) {
+    return type_factory.GetBytesType();
+  }
+  Handle<Type> element;
+  if (field.element == reflection::Obj && field.nested != nullptr &&
+      !field.nested->object->is_struct()) {
+    CEL_ASSIGN_OR_RETURN(element, TableType(type_factory, *field.nested));
+    if (field.key != nullptr) {
+      return type_factory.CreateMapType(type_factory.GetStringType(),
+                                        element);
+    }
+  } else {
+    CEL_ASSIGN_OR_RETURN(element, ScalarType(type_factory, field.element));
+  }
+  return type_factory.CreateListType(element);
+}
+
+class FlatBuffersStructType final : public CEL_STRUCT_TYPE_CLASS {
+ public:
+  explicit FlatBuffersStructType(const Object& object) : object_(object) {}
+
+  static absl::StatusOr<Field> MakeField(TypeFactory& type_factory,
+                                         const IndexedField& field) {
+    CEL_ASSIGN_OR_RETURN(auto type, FieldType(type_factory, field));
+    // The hint is the indexed field, as for FlatBuffersStructValue.
+    return Field(FieldIdFactory::Make(field.name), field.name, field.number,
+                 std::move(type), &field);
+  }
+
+  absl::string_view name() const override { return object_.name; }
+
+  size_t field_count() const override { return object_.fields.size(); }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByName(
+      TypeManager& type_manager, absl::string_view name) const override {
+    const auto* field = object_.FindField(name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return MakeField(type_manager.type_factory(), *field);
+  }
+
+  absl::StatusOr<absl::optional<Field>> FindFieldByNumber(
+      TypeManager& type_manager, int64_t number) const override {
+    for (const auto& field : object_.fields) {
+      if (field.number == number) {
+        return MakeField(type_manager.type_factory(), field);
+      }
+    }
+    return absl::nullopt;
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(TypeManager& type_manager) const override;
+
+ private:
+  const Object& object_;
+
+  CEL_DECLARE_STRUCT_TYPE(FlatBuffersStructType);
+};
+
+CEL_IMPLEMENT_STRUCT_TYPE(FlatBuffersStructType);
+
+class FlatBuffersStructTypeFieldIterator final
+    : public StructType::FieldIterator {
+ public:
+  FlatBuffersStructTypeFieldIterator(TypeManager& type_manager,
+                                     const Object& object)
+      : type_manager_(type_manager), object_(object) {}
+
+  bool HasNext() override { return index_ < object_.fields.size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= object_.fields.size())) {
+      return absl::FailedPreconditionError(
+          "StructType::FieldIterator::Next() called when "
+          "StructType::FieldIterator::HasNext() returns false");
+    }
+    return FlatBuffersStructType::MakeField(type_manager_.type_factory(),
+                                            object_.fields[index_++]);
+  }
+
+ private:
+  TypeManager& type_manager_;
+  const Object& object_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructType::FieldIterator>>>
+FlatBuffersStructType::NewFieldIterator(TypeManager& type_manager) const {
+  return std::make_unique<FlatBuffersStructTypeFieldIterator>(type_manager,
+                                                              object_);
+}
+
+absl::StatusOr<Handle<StructType>> TableType(TypeFactory& type_factory,
+                                             const Object& object) {
+  return type_factory.CreateStructType<FlatBuffersStructType>(object);
+}
+
+absl::StatusOr<Handle<Value>> CreateTableValue(
+    ValueFactory& value_factory, const Object& object,
+    const flatbuffers::Table* table);
+
+// List of the scalars of a vector, read in place.
+class ScalarListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  ScalarListValue(const Handle<ListType>& type, reflection::BaseType element,
+                  const flatbuffers::VectorOfAny* vector)
+      : CEL_LIST_VALUE_CLASS(type),
+        element_(element),
+        element_size_(flatbuffers::GetTypeSize(element)),
+        data_(vector != nullptr ? vector->Data() : nullptr),
+        size_(vector != nullptr ? vector->size() : 0) {}
+
+  std::string DebugString() const override {
+    std::string out = "[";
+    for (size_t i = 0; i < size_; ++i) {
+      if (i != 0) {
+        out.append(", ");
+      }
+      out.append(ScalarDebugString(element_, Element(i)));
+    }
+    out.push_back(']');
+    return out;
+  }
+
+  size_t Size() const override { return size_; }
+
+  // Compares elements in place when `other` has their kind. Other kinds are
+  // compared by the default implementation.
+  absl::StatusOr<Handle<Value>> Contains(
+      ValueFactory& value_factory, const Handle<Value>& other) const override {
+    if (IsSignedScalar(element_) && other->Is<IntValue>()) {
+      int64_t value = other->As<IntValue>().NativeValue();
+      return value_factory.CreateBoolValue(AnyElement([&](const uint8_t* e) {
+        return ReadSigned(element_, e) == value;
+      }));
+    }
+    if (IsUnsignedScalar(element_) && other->Is<UintValue>()) {
+      uint64_t value = other->As<UintValue>().NativeValue();
+      return value_factory.CreateBoolValue(AnyElement([&](const uint8_t* e) {
+        return ReadUnsigned(element_, e) == value;
+      }));
+    }
+    if (element_ == reflection::Bool && other->Is<BoolValue>()) {
+      bool value = other->As<BoolValue>().NativeValue();
+      return value_factory.CreateBoolValue(AnyElement([&](const uint8_t* e) {
+        return (ReadUnsigned(element_, e) != 0) == value;
+      }));
+    }
+    return CEL_LIST_VALUE_CLASS::Contains(value_factory, other);
+  }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return ScalarValue(value_factory, element_, Element(index));
+  }
+
+ private:
+  const uint8_t* Element(size_t index) const {
+    return data_ + index * element_size_;
+  }
+
+  template <typename P>
+  bool AnyElement(P predicate) const {
+    for (size_t i = 0; i < size_; ++i) {
+      if (predicate(Element(i))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const reflection::BaseType element_;
+  const size_t element_size_;
+  const uint8_t* const data_;
+  const size_t size_;
+
+  CEL_DECLARE_LIST_VALUE(ScalarListValue);
+};
+
+CEL_IMPLEMENT_LIST_VALUE(ScalarListValue);
+
+class StringListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  StringListValue(const Handle<ListType>& type, const StringVector* vector)
+      : CEL_LIST_VALUE_CLASS(type), vector_(vector) {}
+
+  std::string DebugString() const override {
+    std::string out = "[";
+    for (size_t i = 0; i < Size(); ++i) {
+      if (i != 0) {
+        out.append(", ");
+      }
+      out.append(StringDebugString(ToStringView(vector_->Get(i))));
+    }
+    out.push_back(']');
+    return out;
+  }
+
+  size_t Size() const override {
+    return vector_ != nullptr ? vector_->size() : 0;
+  }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return value_factory.CreateUnownedStringValue(
+        ToStringView(vector_->Get(index)));
+  }
+
+ private:
+  const StringVector* const vector_;
+
+  CEL_DECLARE_LIST_VALUE(StringListValue);
+};
+
+CEL_IMPLEMENT_LIST_VALUE(StringListValue);
+
+class TableListValue final : public CEL_LIST_VALUE_CLASS {
+ public:
+  TableListValue(const Handle<ListType>& type, const Object& object,
+                 const TableVector* vector)
+      : CEL_LIST_VALUE_CLASS(type), object_(object), vector_(vector) {}
+
+  std::string DebugString() const override {
+    return absl::StrCat("[", Size(), " x ", object_.name, "]");
+  }
+
+  size_t Size() const override {
+    return vector_ != nullptr ? vector_->size() : 0;
+  }
+
+ protected:
+  absl::StatusOr<Handle<Value>> GetImpl(ValueFactory& value_factory,
+                                        size_t index) const override {
+    return CreateTableValue(value_factory, object_, vector_->Get(index));
+  }
+
+ private:
+  const Object& object_;
+  const TableVector* const vector_;
+
+  CEL_DECLARE_LIST_VALUE(TableListValue);
+};
+
+CEL_IMPLEMENT_LIST_VALUE(TableListValue);
+
+// Map from the string keys of a vector of tables, which FlatBuffers sorts by
+// key, to the tables.
+class KeyedTableMapValue final : public CEL_MAP_VALUE_CLASS {
+ public:
+  KeyedTableMapValue(const Handle<MapType>& type, const Object& object,
+                     const IndexedField& key, const TableVector* vector)
+      : CEL_MAP_VALUE_CLASS(type),
+        object_(object),
+        key_(key),
+        vector_(vector) {}
+
+  std::string DebugString() const override {
+    return absl::StrCat("{", Size(), " x ", object_.name, "}");
+  }
+
+  size_t Size() const override {
+    return vector_ != nullptr ? vector_->size() : 0;
+  }
+
+  absl::StatusOr<Handle<ListValue>> ListKeys(
+      ValueFactory& value_factory) const override {
+    ListValueBuilder<StringValue> keys(
+        value_factory, value_factory.type_factory().GetStringType());
+    keys.Reserve(Size());
+    for (size_t i = 0; i < Size(); ++i) {
+      CEL_ASSIGN_OR_RETURN(auto key, value_factory.CreateUnownedStringValue(
+                                         Key(vector_->Get(i))));
+      CEL_RETURN_IF_ERROR(keys.Add(std::move(key)));
+    }
+    return std::move(keys).Build();
+  }
+
+ private:
+  absl::string_view Key(const flatbuffers::Table* table) const {
+    return ToStringView(
+        table->GetPointer<const flatbuffers::String*>(key_.offset));
+  }
+
+  const flatbuffers::Table* Find(absl::string_view key) const {
+    if (vector_ == nullptr) {
+      return nullptr;
+    }
+    auto it = std::lower_bound(
+        vector_->begin(), vector_->end(), key,
+        [this](const flatbuffers::Table* table, absl::string_view key) {
+          return Key(table) < key;
+        });
+    if (it == vector_->end() || Key(*it) != key) {
+      return nullptr;
+    }
+    return *it;
+  }
+
+  absl::StatusOr<std::pair<Handle<Value>, bool>> FindImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    if (!key->Is<StringValue>()) {
+      return std::make_pair(Handle<Value>(), false);
+    }
+    const flatbuffers::Table* table = WithKey(
+        key, [this](absl::string_view key) { return Find(key); });
+    if (table == nullptr) {
+      return std::make_pair(Handle<Value>(), false);
+    }
+    CEL_ASSIGN_OR_RETURN(auto value,
+                         CreateTableValue(value_factory, object_, table));
+    return std::make_pair(std::move(value), true);
+  }
+
+  absl::StatusOr<Handle<Value>> HasImpl(
+      ValueFactory& value_factory, const Handle<Value>& key) const override {
+    if (!key->Is<StringValue>()) {
+      return value_factory.CreateBoolValue(false);
+    }
+    return value_factory.CreateBoolValue(
+        WithKey(key, [this](absl::string_view key) {
+          return Find(key) != nullptr;
+        }));
+  }
+
+  const Object& object_;
+  const IndexedField& key_;
+  const TableVector* const vector_;
+
+  CEL_DECLARE_MAP_VALUE(KeyedTableMapValue);
+};
+
+CEL_IMPLEMENT_MAP_VALUE(KeyedTableMapValue);
+
+class FlatBuffersStructValue final : public CEL_STRUCT_VALUE_CLASS {
+ public:
+  FlatBuffersStructValue(const Handle<StructType>& type, const Object& object,
+                         const flatbuffers::Table* table)
+      : CEL_STRUCT_VALUE_CLASS(type), object_(object), table_(table) {}
+
+  std::string DebugString() const override {
+    // Printing fields would require a value factory.
+    return absl::StrCat(object_.name, "{", field_count(), " fields}");
+  }
+
+  size_t field_count() const override {
+    size_t count = 0;
+    for (const auto& field : object_.fields) {
+      if (HasField(field)) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByName(
+      ValueFactory& value_factory, absl::string_view name) const override {
+    const auto* field = object_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return GetField(value_factory, *field);
+  }
+
+  absl::StatusOr<Handle<Value>> GetFieldByNumber(
+      ValueFactory& value_factory, int64_t number) const override {
+    const auto* field = FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return GetField(value_factory, *field);
+  }
+
+  absl::StatusOr<bool> HasFieldByName(TypeManager& type_manager,
+                                      absl::string_view name) const override {
+    const auto* field = object_.FindField(name);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(name);
+    }
+    return HasField(*field);
+  }
+
+  absl::StatusOr<bool> HasFieldByNumber(TypeManager& type_manager,
+                                        int64_t number) const override {
+    const auto* field = FindFieldByNumber(number);
+    if (field == nullptr) {
+      return runtime_internal::CreateNoSuchFieldError(absl::StrCat(number));
+    }
+    return HasField(*field);
+  }
+
+  // The hint is the indexed field, which holds the offset of the field.
+  const void* FindFieldHint(absl::string_view name) const override {
+    return object_.FindField(name);
+  }
+
+  absl::StatusOr<absl::optional<Handle<Value>>> GetFieldByHint(
+      ValueFactory& value_factory, absl::string_view name, const void* hint,
+      bool unbox_null_wrapper_types) const override {
+    const auto* field = object_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return GetField(value_factory, *field);
+  }
+
+  absl::StatusOr<absl::optional<bool>> HasFieldByHint(
+      absl::string_view name, const void* hint) const override {
+    const auto* field = object_.FieldForHint(hint, name);
+    if (field == nullptr) {
+      return absl::nullopt;
+    }
+    return HasField(*field);
+  }
+
+  absl::StatusOr<absl::Nonnull<std::unique_ptr<FieldIterator>>>
+  NewFieldIterator(ValueFactory& value_factory) const override;
+
+  absl::StatusOr<Handle<Value>> GetField(ValueFactory& value_factory,
+                                         const IndexedField& field) const;
+
+  // Fields are present if they are in the vtable of the table. FlatBuffers
+  // omits scalars equal to their default unless forced to store them.
+  bool HasField(const IndexedField& field) const {
+    return table_->CheckField(field.offset);
+  }
+
+ private:
+  const IndexedField* FindFieldByNumber(int64_t number) const {
+    for (const auto& field : object_.fields) {
+      if (field.number == number) {
+        return &field;
+      }
+    }
+    return nullptr;
+  }
+
+  absl::StatusOr<Handle<Value>> GetVectorField(
+      ValueFactory& value_factory, const IndexedField& field) const;
+
+  const Object& object_;
+  const flatbuffers::Table* const table_;
+
+  CEL_DECLARE_STRUCT_VALUE(FlatBuffersStructValue);
+};
+
+CEL_IMPLEMENT_STRUCT_VALUE(FlatBuffersStructValue);
+
+class FlatBuffersStructValueFieldIterator final
+    : public StructValue::FieldIterator {
+ public:
+  FlatBuffersStructValueFieldIterator(ValueFactory& value_factory,
+                                      const FlatBuffersStructValue& value,
+                                      std::vector<const IndexedField*> fields)
+      : value_factory_(value_factory),
+        value_(value),
+        fields_(std::move(fields)) {}
+
+  bool HasNext() override { return index_ < fields_.size(); }
+
+  absl::StatusOr<Field> Next() override {
+    if (ABSL_PREDICT_FALSE(index_ >= fields_.size())) {
+      return absl::FailedPreconditionError(
+          "StructValue::FieldIterator::Next() called when "
+          "StructValue::FieldIterator::HasNext() returns false");
+    }
+    const auto* field = fields_[index_++];
+    CEL_ASSIGN_OR_RETURN(auto value, value_.GetField(value_factory_, *field));
+    return Field(FieldIdFactory::Make(field->name), std::move(value));
+  }
+
+ private:
+  ValueFactory& value_factory_;
+  const FlatBuffersStructValue& value_;
+  const std::vector<const IndexedField*> fields_;
+  size_t index_ = 0;
+};
+
+absl::StatusOr<absl::Nonnull<std::unique_ptr<StructValue::FieldIterator>>>
+FlatBuffersStructValue::NewFieldIterator(ValueFactory& value_factory) const {
+  std::vector<const IndexedField*> fields;
+  for (const auto& field : object_.fields) {
+    if (HasField(field)) {
+      fields.push_back(&field);
+    }
+  }
+  return std::make_unique<FlatBuffersStructValueFieldIterator>(
+      value_factory, *this, std::move(fields));
+}
+
+absl::StatusOr<Handle<Value>> FlatBuffersStructValue::GetField(
+    ValueFactory& value_factory, const IndexedField& field) const {
+  if (IsScalar(field.base_type)) {
+    if (const uint8_t* data = table_->GetAddressOf(field.offset);
+        data != nullptr) {
+      return ScalarValue(value_factory, field.base_type, data);
+    }
+    // Absent scalars have the default of the schema.
+    if (IsSignedScalar(field.base_type)) {
+      return value_factory.CreateIntValue(field.field->default_integer());
+    }
+    if (IsUnsignedScalar(field.base_type)) {
+      return value_factory.CreateUintValue(
+          static_cast<uint64_t>(field.field->default_integer()));
+    }
+    if (IsFloatingScalar(field.base_type)) {
+      return value_factory.CreateDoubleValue(field.field->default_real());
+    }
+    return value_factory.CreateBoolValue(field.field->default_integer() != 0);
+  }
+  switch (field.base_type) {
+    case reflection::String:
+      return value_factory.CreateUnownedStringValue(ToStringView(
+          table_->GetPointer<const flatbuffers::String*>(field.offset)));
+    case reflection::Obj: {
+      if (field.nested == nullptr || field.nested->object->is_struct()) {
+        return UnsupportedFieldError(field);
+      }
+      const auto* table =
+          table_->GetPointer<const flatbuffers::Table*>(field.offset);
+      if (table == nullptr) {
+        return value_factory.GetNullValue();
+      }
+      return CreateTableValue(value_factory, *field.nested, table);
+    }
+    case reflection::Vector:
+      return GetVectorField(value_factory, field);
+    default:
+      return UnsupportedFieldError(field);
+  }
+}
+
+absl::StatusOr<Handle<Value>> FlatBuffersStructValue::GetVectorField(
+    ValueFactory& value_factory, const IndexedField& field) const {
+  TypeFactory& type_factory = value_factory.type_factory();
+  if (field.element == reflection::Byte || field.element == reflection::UByte) {
+    const auto* vector =
+        table_->GetPointer<const flatbuffers::VectorOfAny*>(field.offset);
+    if (vector == nullptr) {
+      return value_factory.CreateUnownedBytesValue(absl::string_view());
+    }
+    return value_factory.CreateUnownedBytesValue(
+        absl::string_view(reinterpret_cast<const char*>(vector->Data()),
+                          vector->size()));
+  }
+  if (IsScalar(field.element)) {
+    CEL_ASSIGN_OR_RETURN(auto element, ScalarType(type_factory, field.element));
+    CEL_ASSIGN_OR_RETURN(auto type, type_factory.CreateListType(element));
+    return value_factory.CreateListValue<ScalarListValue>(
+        std::move(type), field.element,
+        table_->GetPointer<const flatbuffers::VectorOfAny*>(field.offset));
+  }
+  if (field.element == reflection::String) {
+    CEL_ASSIGN_OR_RETURN(auto type, type_factory.CreateListType(
+                                        type_factory.GetStringType()));
+    return value_factory.CreateListValue<StringListValue>(
+        std::move(type), table_->GetPointer<const StringVector*>(field.offset));
+  }
+  if (field.element != reflection::Obj || field.nested == nullptr ||
+      field.nested->object->is_struct()) {
+    return UnsupportedFieldError(field);
+  }
+  const auto* vector = table_->GetPointer<const TableVector*>(field.offset);
+  CEL_ASSIGN_OR_RETURN(auto element, TableType(type_factory, *field.nested));
+  if (field.key != nullptr) {
+    CEL_ASSIGN_OR_RETURN(auto type,
+                         type_factory.CreateMapType(
+                             type_factory.GetStringType(), std::move(element)));
+    return value_factory.CreateMapValue<KeyedTableMapValue>(
+        std::move(type), *field.nested, *field.key, vector);
+  }
+  CEL_ASSIGN_OR_RETURN(auto type,
+                       type_factory.CreateListType(std::move(element)));
+  return value_factory.CreateListValue<TableListValue>(std::move(type),
+                                                       *field.nested, vector);
+}
+
+absl::StatusOr<Handle<Value>> CreateTableValue(
+    ValueFactory& value_factory, const Object& object,
+    const flatbuffers::Table* table) {
+  CEL_ASSIGN_OR_RETURN(auto type,
+                       TableType(value_factory.type_factory(), object));
+  return value_factory.CreateStructValue<FlatBuffersStructValue>(
+      std::move(type), object, table);
+}
+
+// Returns the string key field of `object`, if any.
+const IndexedField* FindStringKey(const Object& object) {
+  for (const auto& field : object.fields) {
+    if (field.field->key() && field.base_type == reflection::String) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+const FlatBuffersSchemaIndex::Field* FlatBuffersSchemaIndex::Object::FindField(
+    absl::string_view name) const {
+  auto it = std::lower_bound(
+      fields.begin(), fields.end(), name,
+      [](const Field& field, absl::string_view name) {
+        return field.name < name;
+      });
+  if (it == fields.end() || it->name != name) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+const FlatBuffersSchemaIndex::Field*
+FlatBuffersSchemaIndex::Object::FieldForHint(const void* hint,
+                                             absl::string_view name) const {
+  // std::less orders unrelated pointers, unlike the built-in operators.
+  std::less<const void*> less;
+  const Field* begin = fields.data();
+  const Field* end = begin + fields.size();
+  if (less(hint, begin) || !less(hint, end)) {
+    return nullptr;
+  }
+  // A hint cached for a destroyed schema may point into the fields of this
+  // one, which reused its memory, so it must also be a whole field named
+  // `name`.
+  uintptr_t offset = reinterpret_cast<uintptr_t>(hint) -
+                     reinterpret_cast<uintptr_t>(begin);
+  if (offset % sizeof(Field) != 0) {
+    return nullptr;
+  }
+  const auto* field = static_cast<const Field*>(hint);
+  if (field->name != name) {
+    return nullptr;
+  }
+  return field;
+}
+
+FlatBuffersSchemaIndex::FlatBuffersSchemaIndex(
+    const reflection::Schema& schema)
+    : schema_(schema) {
+  const auto* objects = schema.objects();
+  objects_.resize(objects->size());
+  for (size_t i = 0; i < objects_.size(); ++i) {
+    const reflection::Object* object = objects->Get(i);
+    Object& indexed = objects_[i];
+    indexed.name = ToStringView(object->name());
+    indexed.object = object;
+    indexed.fields.reserve(object->fields()->size());
+    for (const reflection::Field* field : *object->fields()) {
+      Field& indexed_field = indexed.fields.emplace_back();
+      indexed_field.name = ToStringView(field->name());
+      indexed_field.number = field->id();
+      indexed_field.offset = field->offset();
+      indexed_field.base_type = field->type()->base_type();
+      indexed_field.element = field->type()->element();
+      indexed_field.field = field;
+      indexed_field.parent = &indexed;
+    }
+    if (object == schema.root_table()) {
+      root_ = &indexed;
+    }
+  }
+  // Link fields to the tables they reference, whose addresses are now
+  // stable.
+  for (Object& object : objects_) {
+    for (Field& field : object.fields) {
+      bool table_field = field.base_type == reflection::Obj ||
+                         (field.base_type == reflection::Vector &&
+                          field.element == reflection::Obj);
+      int32_t index = field.field->type()->index();
+      if (!table_field || index < 0 ||
+          static_cast<size_t>(index) >= objects_.size()) {
+        continue;
+      }
+      field.nested = &objects_[index];
+      if (field.base_type == reflection::Vector) {
+        field.key = FindStringKey(*field.nested);
+      }
+    }
+  }
+}
+
+absl::StatusOr<Handle<StructValue>> CreateFlatBuffersStructValue(
+    ValueFactory& value_factory, const FlatBuffersSchemaIndex& index,
+    const uint8_t* flatbuf) {
+  if (index.root() == nullptr) {
+    return absl::InvalidArgumentError("FlatBuffers schema has no root table");
+  }
+  CEL_ASSIGN_OR_RETURN(auto value,
+                       CreateTableValue(value_factory, *index.root(),
+                                        flatbuffers::GetAnyRoot(flatbuf)));
+  return std::move(value).As<StructValue>();
+}
+
+}  // namespace cel
@@ -0,0 +1,116 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef THIRD_PARTY_CEL_CPP_TOOLS_FLATBUFFERS_BACKED_VALUE_H_
+#define THIRD_PARTY_CEL_CPP_TOOLS_FLATBUFFERS_BACKED_VALUE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "base/handle.h"
+#include "base/value_factory.h"
+#include "base/values/struct_value.h"
+#include "flatbuffers/reflection.h"
+
+namespace cel {
+
+// Index of the tables of a FlatBuffers reflection schema, computed once so
+// that values over buffers of the schema read fields at their vtable offsets
+// instead of searching the schema on each access.
+//
+// Create one per schema and share it between evaluations. The schema must
+// outlive the index, and the index the values created with it.
+class FlatBuffersSchemaIndex final {
+ public:
+  struct Object;
+
+  // Layout of a field of a table.
+  struct Field {
+    absl::string_view name;
+    // The field id, which is the number of the field.
+    int64_t number;
+    // Offset of the field in the vtable of the table.
+    flatbuffers::voffset_t offset;
+    reflection::BaseType base_type;
+    // Type of the elements of vectors.
+    reflection::BaseType element;
+    const reflection::Field* field;
+    // The table this field belongs to.
+    const Object* parent;
+    // The table of table fields and of vectors of tables, nullptr otherwise.
+    const Object* nested = nullptr;
+    // The string key field of the tables of a vector. Vectors of tables with
+    // a key are sorted by it and accessed as maps.
+    const Field* key = nullptr;
+  };
+
+  struct Object {
+    absl::string_view name;
+    const reflection::Object* object;
+    // Ordered by name, as in the schema.
+    std::vector<Field> fields;
+
+    // Returns the field `name`, or nullptr if there is no such field.
+    const Field* FindField(absl::string_view name) const;
+
+    // Returns the field `name` if `hint` points to it among the fields of this
+    // table, or nullptr. `hint` may be any pointer: it is only dereferenced
+    // once it is known to point to a field of this table.
+    const Field* FieldForHint(const void* hint, absl::string_view name) const;
+  };
+
+  explicit FlatBuffersSchemaIndex(
+      const reflection::Schema& schema ABSL_ATTRIBUTE_LIFETIME_BOUND);
+
+  FlatBuffersSchemaIndex(const FlatBuffersSchemaIndex&) = delete;
+  FlatBuffersSchemaIndex& operator=(const FlatBuffersSchemaIndex&) = delete;
+
+  const reflection::Schema& schema() const { return schema_; }
+
+  // The root table of the schema, or nullptr if it has none.
+  const Object* root() const { return root_; }
+
+  const std::vector<Object>& objects() const { return objects_; }
+
+ private:
+  const reflection::Schema& schema_;
+  std::vector<Object> objects_;
+  const Object* root_ = nullptr;
+};
+
+// Returns a struct value over the root table of `flatbuf`, without copying
+// it. `flatbuf` must outlive the returned value and every value derived from
+// it, e.g. request data kept alive until evaluation results are discarded.
+//
+// Tables are struct values whose type is named after the table. Scalars are
+// int, uint, double or bool values and absent scalars have their schema
+// default. Vectors of [u]byte are bytes values, other vectors of scalars and
+// vectors of strings are list values reading the vector in place. Vectors of
+// tables are list values, or maps from the key to the table if the table has
+// a string key field. Absent tables are null, absent vectors are empty.
+// Selecting fields of struct, enum, union or array type is unimplemented.
+//
+// Field selection supports hints: a select step resolves a field by name once
+// and then reads it at its offset, as does a planner which obtains the hint
+// from the `StructType::Field` of the type.
+absl::StatusOr<Handle<StructValue>> CreateFlatBuffersStructValue(
+    ValueFactory& value_factory, const FlatBuffersSchemaIndex& index,
+    const uint8_t* flatbuf);
+
+}  // namespace cel
+
+#endif  // THIRD_PARTY_CEL_CPP_TOOLS_FLATBUFFERS_BACKED_VALUE_H_
@@ -0,0 +1,251 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/flatbuffers_backed_value.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "base/handle.h"
+#include "base/memory.h"
+#include "base/type_factory.h"
+#include "base/type_manager.h"
+#include "base/type_provider.h"
+#include "base/value.h"
+#include "base/value_factory.h"
+#include "base/values/bool_value.h"
+#include "base/values/bytes_value.h"
+#include "base/values/double_value.h"
+#include "base/values/int_value.h"
+#include "base/values/list_value.h"
+#include "base/values/map_value.h"
+#include "base/values/null_value.h"
+#include "base/values/string_value.h"
+#include "base/values/struct_value.h"
+#include "base/values/uint_value.h"
+#include "internal/testing.h"
+#include "flatbuffers/idl.h"
+#include "flatbuffers/reflection.h"
+
+namespace cel {
+namespace {
+
+using ::cel::base_internal::AbstractStructValue;
+using cel::internal::IsOkAndHolds;
+using cel::internal::StatusIs;
+
+constexpr char kReflectionBufferPath[] = "tools/testdata/flatbuffers.bfbs";
+
+class FlatBuffersValueTest : public testing::Test {
+ public:
+  FlatBuffersValueTest()
+      : type_factory_(MemoryManagerRef::ReferenceCounting()),
+        type_manager_(type_factory_, TypeProvider::Builtin()),
+        value_factory_(type_manager_) {
+    EXPECT_TRUE(
+        flatbuffers::LoadFile(kReflectionBufferPath, true, &schema_file_));
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const uint8_t*>(schema_file_.data()),
+        schema_file_.size());
+    EXPECT_TRUE(reflection::VerifySchemaBuffer(verifier));
+    EXPECT_TRUE(parser_.Deserialize(
+        reinterpret_cast<const uint8_t*>(schema_file_.data()),
+        schema_file_.size()));
+    index_ = std::make_unique<FlatBuffersSchemaIndex>(
+        *reflection::GetSchema(schema_file_.data()));
+  }
+
+  Handle<StructValue> LoadJson(const std::string& data) {
+    EXPECT_TRUE(parser_.Parse(data.data()));
+    auto value = CreateFlatBuffersStructValue(
+        value_factory_, *index_, parser_.builder_.GetBufferPointer());
+    EXPECT_OK(value);
+    return *std::move(value);
+  }
+
+  Handle<Value> GetField(const Handle<StructValue>& value,
+                         absl::string_view name) {
+    auto field = value->GetFieldByName(value_factory_, name);
+    EXPECT_OK(field);
+    return *std::move(field);
+  }
+
+ protected:
+  TypeFactory type_factory_;
+  TypeManager type_manager_;
+  ValueFactory value_factory_;
+  std::string schema_file_;
+  flatbuffers::Parser parser_;
+  std::unique_ptr<FlatBuffersSchemaIndex> index_;
+};
+
+TEST_F(FlatBuffersValueTest, ScalarFields) {
+  auto value = LoadJson(R"({
+    f_byte: -1,
+    f_ubyte: 1,
+    f_int: -3,
+    f_ulong: 4,
+    f_float: 5.0,
+    f_double: 6.0,
+    f_bool: false,
+    f_string: "test"
+  })");
+  EXPECT_EQ(value->type()->name(), "google.api.expr.TestBuffer");
+  EXPECT_EQ(GetField(value, "f_byte")->As<IntValue>().NativeValue(), -1);
+  EXPECT_EQ(GetField(value, "f_ubyte")->As<UintValue>().NativeValue(), 1);
+  EXPECT_EQ(GetField(value, "f_int")->As<IntValue>().NativeValue(), -3);
+  EXPECT_EQ(GetField(value, "f_ulong")->As<UintValue>().NativeValue(), 4);
+  EXPECT_EQ(GetField(value, "f_float")->As<DoubleValue>().NativeValue(), 5.0);
+  EXPECT_EQ(GetField(value, "f_double")->As<DoubleValue>().NativeValue(),
+            6.0);
+  EXPECT_FALSE(GetField(value, "f_bool")->As<BoolValue>().NativeValue());
+  EXPECT_EQ(GetField(value, "f_string")->As<StringValue>().ToString(), "test");
+  EXPECT_THAT(value->GetFieldByName(value_factory_, "f_unknown"),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST_F(FlatBuffersValueTest, Defaults) {
+  auto value = LoadJson("{}");
+  EXPECT_EQ(GetField(value, "f_short")->As<IntValue>().NativeValue(), 150);
+  EXPECT_TRUE(GetField(value, "f_bool")->As<BoolValue>().NativeValue());
+  EXPECT_EQ(GetField(value, "f_string")->As<StringValue>().ToString(), "");
+  EXPECT_TRUE(GetField(value, "f_obj")->Is<NullValue>());
+  EXPECT_EQ(GetField(value, "r_int")->As<ListValue>().Size(), 0);
+  EXPECT_EQ(GetField(value, "r_indexed")->As<MapValue>().Size(), 0);
+  EXPECT_EQ(GetField(value, "r_byte")->As<BytesValue>().ToString(), "");
+  EXPECT_THAT(value->HasFieldByName(type_manager_, "f_short"),
+              IsOkAndHolds(false));
+  EXPECT_EQ(value->field_count(), 0);
+}
+
+TEST_F(FlatBuffersValueTest, FieldHints) {
+  auto value = LoadJson(R"({f_int: 7, f_obj: {f_int: 8}})");
+  const auto& struct_value = AbstractStructValue::Cast(*value);
+  const void* hint = struct_value.FindFieldHint("f_int");
+  ASSERT_NE(hint, nullptr);
+  EXPECT_EQ(struct_value.FindFieldHint("f_unknown"), nullptr);
+
+  // The hint is also available from the type, e.g. when planning.
+  ASSERT_OK_AND_ASSIGN(auto field,
+                       value->type()->FindFieldByName(type_manager_, "f_int"));
+  ASSERT_TRUE(field.has_value());
+  EXPECT_EQ(field->hint, hint);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto selected,
+      struct_value.GetFieldByHint(value_factory_, "f_int", hint,
+                                  /*unbox_null_wrapper_types=*/false));
+  ASSERT_TRUE(selected.has_value());
+  EXPECT_EQ((*selected)->As<IntValue>().NativeValue(), 7);
+  EXPECT_THAT(struct_value.HasFieldByHint("f_int", hint),
+              IsOkAndHolds(absl::optional<bool>(true)));
+
+  // A hint pointing to another field, e.g. one cached for a destroyed schema
+  // whose memory was reused, does not apply.
+  EXPECT_THAT(struct_value.GetFieldByHint(value_factory_, "other", hint, false),
+              IsOkAndHolds(absl::nullopt));
+  EXPECT_THAT(struct_value.HasFieldByHint("other", hint),
+              IsOkAndHolds(absl::nullopt));
+
+  // Hints of other tables do not apply.
+  auto nested = GetField(value, "f_obj").As<StructValue>();
+  const auto& nested_value = AbstractStructValue::Cast(*nested);
+  EXPECT_THAT(nested_value.GetFieldByHint(value_factory_, "f_int", hint, false),
+              IsOkAndHolds(absl::nullopt));
+  EXPECT_THAT(nested_value.HasFieldByHint("f_int", &schema_file_),
+              IsOkAndHolds(absl::nullopt));
+  EXPECT_EQ(GetField(nested, "f_int")->As<IntValue>().NativeValue(), 8);
+}
+
+TEST_F(FlatBuffersValueTest, VectorFields) {
+  auto value = LoadJson(R"({
+    r_ubyte: [1, 2],
+    r_short: [-1, 2, 3],
+    r_ulong: [4],
+    r_double: [0.5],
+    r_bool: [false, true],
+    r_string: ["a", "b"],
+    r_obj: [{f_string: "x"}, {f_int: 2}]
+  })");
+  EXPECT_EQ(GetField(value, "r_ubyte")->As<BytesValue>().ToString(),
+            std::string("\x01\x02"));
+
+  auto shorts = GetField(value, "r_short").As<ListValue>();
+  EXPECT_EQ(shorts->Size(), 3);
+  EXPECT_EQ(shorts->DebugString(), "[-1, 2, 3]");
+  ASSERT_OK_AND_ASSIGN(auto element, shorts->Get(value_factory_, 0));
+  EXPECT_EQ(element->As<IntValue>().NativeValue(), -1);
+  ASSERT_OK_AND_ASSIGN(
+      auto contains,
+      shorts->Contains(value_factory_, value_factory_.CreateIntValue(3)));
+  EXPECT_TRUE(contains->As<BoolValue>().NativeValue());
+  ASSERT_OK_AND_ASSIGN(
+      contains,
+      shorts->Contains(value_factory_, value_factory_.CreateIntValue(4)));
+  EXPECT_FALSE(contains->As<BoolValue>().NativeValue());
+
+  ASSERT_OK_AND_ASSIGN(
+      element, GetField(value, "r_ulong")->As<ListValue>().Get(value_factory_,
+                                                                0));
+  EXPECT_EQ(element->As<UintValue>().NativeValue(), 4);
+  ASSERT_OK_AND_ASSIGN(
+      element, GetField(value, "r_double")->As<ListValue>().Get(value_factory_,
+                                                                 0));
+  EXPECT_EQ(element->As<DoubleValue>().NativeValue(), 0.5);
+  ASSERT_OK_AND_ASSIGN(
+      element, GetField(value, "r_bool")->As<ListValue>().Get(value_factory_,
+                                                               1));
+  EXPECT_TRUE(element->As<BoolValue>().NativeValue());
+  ASSERT_OK_AND_ASSIGN(
+      element, GetField(value, "r_string")->As<ListValue>().Get(value_factory_,
+                                                                 1));
+  EXPECT_EQ(element->As<StringValue>().ToString(), "b");
+
+  auto objects = GetField(value, "r_obj").As<ListValue>();
+  EXPECT_EQ(objects->Size(), 2);
+  ASSERT_OK_AND_ASSIGN(element, objects->Get(value_factory_, 1));
+  EXPECT_EQ(GetField(element.As<StructValue>(), "f_int")
+                ->As<IntValue>()
+                .NativeValue(),
+            2);
+}
+
+TEST_F(FlatBuffersValueTest, IndexedObjectVectorField) {
+  auto value = LoadJson(R"({
+    r_indexed: [
+      {f_string: "a", f_int: 16},
+      {f_string: "b", f_int: 32},
+      {f_string: "c", f_int: 64}
+    ]
+  })");
+  auto map = GetField(value, "r_indexed").As<MapValue>();
+  EXPECT_EQ(map->Size(), 3);
+  ASSERT_OK_AND_ASSIGN(
+      auto entry,
+      map->Get(value_factory_, value_factory_.CreateUncheckedStringValue("b")));
+  EXPECT_EQ(GetField(entry.As<StructValue>(), "f_int")
+                ->As<IntValue>()
+                .NativeValue(),
+            32);
+  ASSERT_OK_AND_ASSIGN(
+      auto has,
+      map->Has(value_factory_, value_factory_.CreateUncheckedStringValue("d")));
+  EXPECT_FALSE(has->As<BoolValue>().NativeValue());
+  ASSERT_OK_AND_ASSIGN(auto keys, map->ListKeys(value_factory_));
+  EXPECT_EQ(keys->Size(), 3);
+}
+
+}  // namespace
+}  // namespace cel
@@ -15,6 +15,7 @@
 #ifndef THIRD_PARTY_CEL_CPP_TOOLS_INTERNAL_NAVIGABLE_AST_INTERNAL_H_
 #define THIRD_PARTY_CEL_CPP_TOOLS_INTERNAL_NAVIGABLE_AST_INTERNAL_H_
 
+#include "absl/log/absl_check.h"
 #include "absl/types/span.h"
 
 namespace cel::tools_internal {
@@ -47,7 +48,9 @@ class SpanRange {
     }
 
     bool operator==(const SpanForwardIter& other) const {
-      return i_ == other.i_ && span_ == other.span_;
+      // Compares the spans by identity: Span's operator== compares elements.
+      return i_ == other.i_ && span_.data() == other.span_.data() &&
+             span_.size() == other.span_.size();
     }
 
     bool operator!=(const SpanForwardIter& other) const {
@@ -14,7 +14,10 @@
 
 #include "tools/navigable_ast.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -23,7 +26,7 @@
 #include "google/api/expr/v1alpha1/checked.pb.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
-#include "absl/memory/memory.h"
+#include "absl/base/nullability.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
 #include "eval/public/ast_traverse.h"
@@ -37,15 +40,86 @@ namespace tools_internal {
 
 AstNodeData& AstMetadata::NodeDataAt(size_t index) {
   ABSL_CHECK(index < nodes.size());
-  return nodes[index]->data_;
+  return nodes[index].data_;
 }
 
 size_t AstMetadata::AddNode() {
   size_t index = nodes.size();
-  nodes.push_back(absl::WrapUnique(new AstNode()));
+  nodes.push_back(AstNode());
   return index;
 }
 
+absl::Nullable<const AstNode*> AstMetadata::FindId(int64_t id) const {
+  size_t index = kNoNode;
+  if (!id_to_node.empty()) {
+    if (id >= 0 && static_cast<uint64_t>(id) < id_to_node.size()) {
+      index = id_to_node[id];
+    }
+  } else if (auto it = sparse_id_to_node.find(id);
+             it != sparse_id_to_node.end()) {
+    index = it->second;
+  }
+  return index == kNoNode ? nullptr : &nodes[index];
+}
+
+void AstMetadata::Index() {
+  const size_t size = nodes.size();
+  std::vector<size_t> depth(size);
+  postorder.resize(size);
+  children.clear();
+  children.reserve(size);
+  int64_t min_id = 0;
+  int64_t max_id = 0;
+  for (size_t i = 0; i < size; ++i) {
+    AstNodeData& node = nodes[i].data_;
+    node.metadata = this;
+    node.index = i;
+    depth[i] = node.parent == AstNodeData::kNoParent ? 0
+                                                    : depth[node.parent] + 1;
+    // In postorder, the descendants start after the preorder predecessors
+    // other than the ancestors, which follow them instead.
+    node.postorder_index = i - depth[i];
+    postorder[node.postorder_index + node.weight - 1] = &nodes[i];
+
+    node.children_offset = children.size();
+    node.children_size = 0;
+    for (size_t child = i + 1; child < i + node.weight;
+         child += nodes[child].data_.weight) {
+      nodes[child].data_.child_index = static_cast<int>(node.children_size++);
+      children.push_back(&nodes[child]);
+    }
+    if (node.parent == AstNodeData::kNoParent) {
+      node.child_index = -1;
+    }
+
+    int64_t id = node.expr->id();
+    min_id = i == 0 ? id : std::min(min_id, id);
+    max_id = i == 0 ? id : std::max(max_id, id);
+  }
+
+  // Ids assigned by the parser are dense, so a vector usually suffices.
+  id_to_node.clear();
+  sparse_id_to_node.clear();
+  unique_ids = 0;
+  bool dense = min_id >= 0 && static_cast<uint64_t>(max_id) < 2 * size + 16;
+  if (dense) {
+    id_to_node.assign(size == 0 ? 0 : max_id + 1, kNoNode);
+  }
+  for (size_t i = 0; i < size; ++i) {
+    int64_t id = nodes[i].data_.expr->id();
+    bool inserted;
+    if (dense) {
+      inserted = id_to_node[id] == kNoNode;
+      if (inserted) {
+        id_to_node[id] = i;
+      }
+    } else {
+      inserted = sparse_id_to_node.insert({id, i}).second;
+    }
+    unique_ids += inserted ? 1 : 0;
+  }
+}
+
 }  // namespace tools_internal
 
 namespace {
@@ -135,54 +209,43 @@ ChildKind GetChildKind(const tools_internal::AstNodeData& parent_node,
 class NavigableExprBuilderVisitor
     : public google::api::expr::runtime::AstVisitorBase {
  public:
-  NavigableExprBuilderVisitor()
-      : metadata_(std::make_unique<tools_internal::AstMetadata>()) {}
+  explicit NavigableExprBuilderVisitor(tools_internal::AstMetadata& metadata)
+      : metadata_(metadata) {}
 
   void PreVisitExpr(const Expr* expr, const SourcePosition* position) override {
-    AstNode* parent = parent_stack_.empty()
-                          ? nullptr
-                          : metadata_->nodes[parent_stack_.back()].get();
-    size_t index = metadata_->AddNode();
-    tools_internal::AstNodeData& node_data = metadata_->NodeDataAt(index);
-    node_data.parent = parent;
+    size_t index = metadata_.AddNode();
+    tools_internal::AstNodeData& node_data = metadata_.NodeDataAt(index);
+    node_data.parent = tools_internal::AstNodeData::kNoParent;
     node_data.expr = expr;
     node_data.parent_relation = ChildKind::kUnspecified;
     node_data.node_kind = GetNodeKind(*expr);
     node_data.weight = 1;
-    node_data.index = index;
-    node_data.metadata = metadata_.get();
 
-    metadata_->id_to_node.insert({expr->id(), index});
-    metadata_->expr_to_node.insert({expr, index});
     if (!parent_stack_.empty()) {
-      auto& parent_node_data = metadata_->NodeDataAt(parent_stack_.back());
-      size_t child_index = parent_node_data.children.size();
-      parent_node_data.children.push_back(metadata_->nodes[index].get());
-      node_data.parent_relation = GetChildKind(parent_node_data, child_index);
+      auto& [parent_index, child_count] = parent_stack_.back();
+      node_data.parent = parent_index;
+      node_data.parent_relation =
+          GetChildKind(metadata_.NodeDataAt(parent_index), child_count++);
     }
-    parent_stack_.push_back(index);
+    parent_stack_.push_back({index, 0});
   }
 
   void PostVisitExpr(const Expr* expr,
                      const SourcePosition* position) override {
-    size_t idx = parent_stack_.back();
+    size_t idx = parent_stack_.back().first;
     parent_stack_.pop_back();
-    metadata_->postorder.push_back(metadata_->nodes[idx].get());
-    tools_internal::AstNodeData& node = metadata_->NodeDataAt(idx);
+    tools_internal::AstNodeData& node = metadata_.NodeDataAt(idx);
     if (!parent_stack_.empty()) {
       tools_internal::AstNodeData& parent_node_data =
-          metadata_->NodeDataAt(parent_stack_.back());
+          metadata_.NodeDataAt(parent_stack_.back().first);
       parent_node_data.weight += node.weight;
     }
   }
 
-  std::unique_ptr<tools_internal::AstMetadata> Consume() && {
-    return std::move(metadata_);
-  }
-
  private:
-  std::unique_ptr<tools_internal::AstMetadata> metadata_;
-  std::vector<size_t> parent_stack_;
+  tools_internal::AstMetadata& metadata_;
+  // Index and number of children visited so far of the ancestors.
+  std::vector<std::pair<size_t, size_t>> parent_stack_;
 };
 
 }  // namespace
@@ -245,18 +308,16 @@ std::string NodeKindName(NodeKind kind) {
   }
 }
 
-int AstNode::child_index() const {
-  if (data_.parent == nullptr) {
-    return -1;
-  }
-  int i = 0;
-  for (const AstNode* ptr : data_.parent->children()) {
-    if (ptr->expr() == expr()) {
-      return i;
-    }
-    i++;
+absl::Nullable<const AstNode*> AstNode::parent() const {
+  if (data_.parent == tools_internal::AstNodeData::kNoParent) {
+    return nullptr;
   }
-  return -1;
+  return &data_.metadata->nodes[data_.parent];
+}
+
+absl::Span<const AstNode* const> AstNode::children() const {
+  return absl::MakeConstSpan(data_.metadata->children)
+      .subspan(data_.children_offset, data_.children_size);
 }
 
 AstNode::PreorderRange AstNode::DescendantsPreorder() const {
@@ -266,13 +327,77 @@ AstNode::PreorderRange AstNode::DescendantsPreorder() const {
 
 AstNode::PostorderRange AstNode::DescendantsPostorder() const {
   return AstNode::PostorderRange(absl::MakeConstSpan(data_.metadata->postorder)
-                                     .subspan(data_.index, data_.weight));
+                                     .subspan(data_.postorder_index,
+                                              data_.weight));
 }
 
 NavigableAst NavigableAst::Build(const Expr& expr) {
-  NavigableExprBuilderVisitor visitor;
+  auto metadata = std::make_unique<tools_internal::AstMetadata>();
+  NavigableExprBuilderVisitor visitor(*metadata);
   AstTraverse(&expr, /*source_info=*/nullptr, &visitor);
-  return NavigableAst(std::move(visitor).Consume());
+  metadata->Index();
+  return NavigableAst(std::move(metadata));
+}
+
+absl::Nullable<const AstNode*> NavigableAst::FindExpr(const Expr* expr) const {
+  const AstNode* node = metadata_->FindId(expr->id());
+  if (node != nullptr && node->expr() == expr) {
+    return node;
+  }
+  if (IdsAreUnique()) {
+    return nullptr;
+  }
+  for (const AstNode& candidate : metadata_->nodes) {
+    if (candidate.expr() == expr) {
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+const AstNode& NavigableAst::ReplaceSubtree(const AstNode& node) {
+  using tools_internal::AstNodeData;
+  const size_t index = node.data_.index;
+  const size_t old_weight = node.data_.weight;
+  const size_t parent = node.data_.parent;
+  const ChildKind parent_relation = node.data_.parent_relation;
+  std::vector<AstNode>& nodes = metadata_->nodes;
+
+  tools_internal::AstMetadata subtree;
+  NavigableExprBuilderVisitor visitor(subtree);
+  AstTraverse(node.expr(), /*source_info=*/nullptr, &visitor);
+  const size_t new_weight = subtree.nodes.size();
+  for (AstNode& subtree_node : subtree.nodes) {
+    if (subtree_node.data_.parent == AstNodeData::kNoParent) {
+      subtree_node.data_.parent = parent;
+      subtree_node.data_.parent_relation = parent_relation;
+    } else {
+      subtree_node.data_.parent += index;
+    }
+  }
+
+  // The nodes following the subtree are not its descendants, so their parents
+  // either precede the subtree or follow it too.
+  for (size_t i = index + old_weight; i < nodes.size(); ++i) {
+    size_t& node_parent = nodes[i].data_.parent;
+    if (node_parent != AstNodeData::kNoParent &&
+        node_parent >= index + old_weight) {
+      node_parent = node_parent - old_weight + new_weight;
+    }
+  }
+  for (size_t ancestor = parent; ancestor != AstNodeData::kNoParent;
+       ancestor = nodes[ancestor].data_.parent) {
+    nodes[ancestor].data_.weight =
+        nodes[ancestor].data_.weight - old_weight + new_weight;
+  }
+
+  // node is invalidated from here on.
+  nodes.erase(nodes.begin() + index, nodes.begin() + index + old_weight);
+  nodes.insert(nodes.begin() + index,
+               std::make_move_iterator(subtree.nodes.begin()),
+               std::make_move_iterator(subtree.nodes.end()));
+  metadata_->Index();
+  return nodes[index];
 }
 
 }  // namespace cel
@@ -86,25 +86,50 @@ struct AstMetadata;
 //
 // This is exposed separately to allow building up the AST relationships
 // without exposing too much mutable state on the non-internal classes.
+//
+// Relationships are stored as indexes into the arrays of AstMetadata rather
+// than pointers, so that a subtree can be replaced without rebuilding the
+// rest of the AST.
 struct AstNodeData {
-  AstNode* parent;
+  static constexpr size_t kNoParent = static_cast<size_t>(-1);
+
+  const AstMetadata* metadata;
   const ::google::api::expr::v1alpha1::Expr* expr;
+  // Preorder index of the parent, kNoParent for the root.
+  size_t parent;
   ChildKind parent_relation;
   NodeKind node_kind;
-  const AstMetadata* metadata;
+  // Preorder index, the descendants are the weight - 1 nodes following it.
   size_t index;
   size_t weight;
-  std::vector<AstNode*> children;
+  // Start of the descendants in AstMetadata::postorder.
+  size_t postorder_index;
+  // Range of the children in AstMetadata::children.
+  size_t children_offset;
+  size_t children_size;
+  int child_index;
 };
 
 struct AstMetadata {
-  std::vector<std::unique_ptr<AstNode>> nodes;
+  // All nodes, in preorder.
+  std::vector<AstNode> nodes;
   std::vector<const AstNode*> postorder;
-  absl::flat_hash_map<int64_t, size_t> id_to_node;
-  absl::flat_hash_map<const google::api::expr::v1alpha1::Expr*, size_t> expr_to_node;
+  // Children of each node, consecutively.
+  std::vector<const AstNode*> children;
+  // Preorder index by id for the usual case of small non-negative ids,
+  // kNoNode where absent. Otherwise, sparse_id_to_node is used instead.
+  static constexpr size_t kNoNode = static_cast<size_t>(-1);
+  std::vector<size_t> id_to_node;
+  absl::flat_hash_map<int64_t, size_t> sparse_id_to_node;
+  size_t unique_ids = 0;
 
   AstNodeData& NodeDataAt(size_t index);
   size_t AddNode();
+  absl::Nullable<const AstNode*> FindId(int64_t id) const;
+
+  // Recomputes everything other than the preorder nodes: the parent, weight,
+  // expr and kinds of each node must be set.
+  void Index();
 };
 
 struct PostorderTraits {
@@ -113,10 +138,8 @@ struct PostorderTraits {
 };
 
 struct PreorderTraits {
-  using UnderlyingType = std::unique_ptr<AstNode>;
-  static const AstNode& Adapt(const std::unique_ptr<AstNode>& node) {
-    return *node;
-  }
+  using UnderlyingType = AstNode;
+  static const AstNode& Adapt(const AstNode& node) { return node; }
 };
 
 }  // namespace tools_internal
@@ -130,15 +153,20 @@ class AstNode {
       tools_internal::SpanRange<tools_internal::PostorderTraits>;
 
  public:
+  // Movable for storage in AstMetadata only, nodes are only handed out by
+  // const reference.
+  AstNode(AstNode&&) = default;
+  AstNode& operator=(AstNode&&) = default;
+
   // The parent of this node or nullptr if it is a root.
-  absl::Nullable<const AstNode*> parent() const { return data_.parent; }
+  absl::Nullable<const AstNode*> parent() const;
 
   absl::Nonnull<const google::api::expr::v1alpha1::Expr*> expr() const {
     return data_.expr;
   }
 
-  // The index of this node in the parent's children.
-  int child_index() const;
+  // The index of this node in the parent's children, -1 for the root.
+  int child_index() const { return data_.child_index; }
 
   // The type of traversal from parent to this node.
   ChildKind parent_relation() const { return data_.parent_relation; }
@@ -146,9 +174,7 @@ class AstNode {
   // The type of this node, analogous to Expr::ExprKindCase.
   NodeKind node_kind() const { return data_.node_kind; }
 
-  absl::Span<const AstNode* const> children() const {
-    return absl::MakeConstSpan(data_.children);
-  }
+  absl::Span<const AstNode* const> children() const;
 
   // Range over the descendants of this node (including self) using preorder
   // semantics. Each node is visited immediately before all of its descendants.
@@ -175,6 +201,7 @@ class AstNode {
 
  private:
   friend struct tools_internal::AstMetadata;
+  friend class NavigableAst;
 
   AstNode() = default;
   AstNode(const AstNode&) = delete;
@@ -213,25 +240,26 @@ class NavigableAst {
   // If ids are non-unique, the first pre-order node encountered with id is
   // returned.
   absl::Nullable<const AstNode*> FindId(int64_t id) const {
-    auto it = metadata_->id_to_node.find(id);
-    if (it == metadata_->id_to_node.end()) {
-      return nullptr;
-    }
-    return metadata_->nodes[it->second].get();
+    return metadata_->FindId(id);
   }
 
   // Return ptr to the AST node representing the given Expr protobuf node.
+  //
+  // Constant time if ids are unique, linear otherwise.
   absl::Nullable<const AstNode*> FindExpr(
-      const google::api::expr::v1alpha1::Expr* expr) const {
-    auto it = metadata_->expr_to_node.find(expr);
-    if (it == metadata_->expr_to_node.end()) {
-      return nullptr;
-    }
-    return metadata_->nodes[it->second].get();
-  }
+      const google::api::expr::v1alpha1::Expr* expr) const;
 
   // The root of the AST.
-  const AstNode& Root() const { return *metadata_->nodes[0]; }
+  const AstNode& Root() const { return metadata_->nodes[0]; }
+
+  // Updates the navigable AST after the subtree of node has been rewritten in
+  // place, e.g. by an optimization pass assigning a new Expr to node.expr().
+  // Only the new subtree is traversed; the nodes outside of it must not have
+  // changed.
+  //
+  // Invalidates all AstNode pointers and references obtained from this
+  // instance. Returns the node for the new subtree.
+  const AstNode& ReplaceSubtree(const AstNode& node);
 
   // Check whether the source AST used unique IDs for each node.
   //
@@ -239,7 +267,7 @@ class NavigableAst {
   // guarantee uniqueness for nodes generated by some macros and ASTs modified
   // outside of CEL's parse/type check may not have unique IDs.
   bool IdsAreUnique() const {
-    return metadata_->id_to_node.size() == metadata_->nodes.size();
+    return metadata_->unique_ids == metadata_->nodes.size();
   }
 
   // Equality operators test for identity. They are intended to distinguish
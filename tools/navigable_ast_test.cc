@@ -14,6 +14,7 @@
 
 #include "tools/navigable_ast.h"
 
+#include <cstdint>
 #include <utility>
 #include <vector>
 
@@ -404,5 +405,72 @@ TEST(ChildKind, Stringify) {
             "Unknown ChildKind 255");
 }
 
+TEST(NavigableAst, DescendantsPostorderOfSubtree) {
+  ASSERT_OK_AND_ASSIGN(auto parsed_expr, Parse("1 + (x * 3)"));
+
+  NavigableAst ast = NavigableAst::Build(parsed_expr.expr());
+  const AstNode& mult = *ast.Root().children()[1];
+
+  std::vector<NodeKind> node_kinds;
+  for (const AstNode& node : mult.DescendantsPostorder()) {
+    node_kinds.push_back(node.node_kind());
+  }
+
+  EXPECT_THAT(node_kinds, ElementsAre(NodeKind::kIdent, NodeKind::kConstant,
+                                      NodeKind::kCall));
+}
+
+TEST(NavigableAst, ReplaceSubtree) {
+  ASSERT_OK_AND_ASSIGN(auto parsed_expr, Parse("[x * 3, y]"));
+  Expr& expr = *parsed_expr.mutable_expr();
+
+  NavigableAst ast = NavigableAst::Build(expr);
+  ASSERT_THAT(ast.Root().children(), SizeIs(2));
+
+  // Replace x * 3 by [1, 2, 3].
+  Expr* elem = expr.mutable_list_expr()->mutable_elements(0);
+  ASSERT_OK_AND_ASSIGN(auto replacement, Parse("[1, 2, 3]"));
+  int64_t next_id = 100;
+  *elem = replacement.expr();
+  elem->set_id(next_id++);
+  for (Expr& list_elem : *elem->mutable_list_expr()->mutable_elements()) {
+    list_elem.set_id(next_id++);
+  }
+
+  const AstNode& replaced = ast.ReplaceSubtree(*ast.Root().children()[0]);
+
+  EXPECT_EQ(replaced.expr(), elem);
+  EXPECT_EQ(replaced.node_kind(), NodeKind::kList);
+  EXPECT_EQ(replaced.parent_relation(), ChildKind::kListElem);
+  EXPECT_EQ(replaced.parent(), &ast.Root());
+  EXPECT_THAT(replaced.children(), SizeIs(3));
+  EXPECT_TRUE(ast.IdsAreUnique());
+  EXPECT_EQ(ast.FindId(101), replaced.children()[0]);
+  EXPECT_EQ(ast.FindExpr(elem), &replaced);
+
+  const AstNode& y = *ast.Root().children()[1];
+  EXPECT_EQ(y.node_kind(), NodeKind::kIdent);
+  EXPECT_EQ(y.child_index(), 1);
+  EXPECT_EQ(ast.FindExpr(&expr.list_expr().elements(1)), &y);
+
+  std::vector<NodeKind> preorder;
+  for (const AstNode& node : ast.Root().DescendantsPreorder()) {
+    preorder.push_back(node.node_kind());
+  }
+  EXPECT_THAT(preorder,
+              ElementsAre(NodeKind::kList, NodeKind::kList, NodeKind::kConstant,
+                          NodeKind::kConstant, NodeKind::kConstant,
+                          NodeKind::kIdent));
+
+  std::vector<NodeKind> postorder;
+  for (const AstNode& node : ast.Root().DescendantsPostorder()) {
+    postorder.push_back(node.node_kind());
+  }
+  EXPECT_THAT(postorder,
+              ElementsAre(NodeKind::kConstant, NodeKind::kConstant,
+                          NodeKind::kConstant, NodeKind::kList,
+                          NodeKind::kIdent, NodeKind::kList));
+}
+
 }  // namespace
 }  // namespace cel